@@ -21,6 +21,7 @@
 #define FDB_API_VERSION 520
 
 #include "fdbclient/MultiVersionTransaction.h"
+#include "fdbclient/MultiVersionAssignmentVars.h"
 #include "foundationdb/fdb_c.h"
 
 int g_api_version = 0;
@@ -49,6 +50,11 @@ int g_api_version = 0;
 static_assert( sizeof(FDBKeyValue) == sizeof(KeyValueRef),
 			   "FDBKeyValue / KeyValueRef size mismatch" );
 
+/* Likewise for returning a Standalone<VectorRef<KeyRef>> as an array of
+   FDBKey. */
+static_assert( sizeof(FDBKey) == sizeof(KeyRef),
+			   "FDBKey / KeyRef size mismatch" );
+
 
 #define TSAV_ERROR(type, error) ((FDBFuture*)(ThreadFuture<type>(error())).extractPtr())
 
@@ -222,6 +228,11 @@ fdb_error_t fdb_future_get_version( FDBFuture* f, int64_t* out_version ) {
 	CATCH_AND_RETURN( *out_version = TSAV(Version, f)->get(); );
 }
 
+extern "C" DLLEXPORT
+fdb_error_t fdb_future_get_int64( FDBFuture* f, int64_t* out_value ) {
+	CATCH_AND_RETURN( *out_value = TSAV(int64_t, f)->get(); );
+}
+
 extern "C" DLLEXPORT
 fdb_error_t fdb_future_get_key( FDBFuture* f, uint8_t const** out_key,
 								int* out_key_length ) {
@@ -231,6 +242,14 @@ fdb_error_t fdb_future_get_key( FDBFuture* f, uint8_t const** out_key,
 		*out_key_length = key.size(); );
 }
 
+extern "C" DLLEXPORT
+fdb_error_t fdb_future_get_key_array( FDBFuture* f, FDBKey const** out_key_array, int* out_count ) {
+	CATCH_AND_RETURN(
+		Standalone<VectorRef<KeyRef>> keys = TSAV(Standalone<VectorRef<KeyRef>>, f)->get();
+		*out_key_array = (FDBKey*)keys.begin();
+		*out_count = keys.size(); );
+}
+
 extern "C" DLLEXPORT
 fdb_error_t fdb_future_get_cluster( FDBFuture* f, FDBCluster** out_cluster ) {
 	CATCH_AND_RETURN(
@@ -279,6 +298,35 @@ fdb_error_t fdb_future_get_keyvalue_array_v13(
 		*out_count = rrr.size(); );
 }
 
+extern "C" DLLEXPORT
+fdb_error_t fdb_future_get_keyvalue_buffer(
+	FDBFuture* f, uint8_t* buffer, int buffer_length, int* out_offsets,
+	int offsets_length, int* out_count, int* out_length, fdb_bool_t* out_more )
+{
+	CATCH_AND_RETURN(
+		Standalone<RangeResultRef> rrr = TSAV(Standalone<RangeResultRef>, f)->get();
+		int length = 0;
+		for( auto& kv : rrr )
+			length += kv.key.size() + kv.value.size();
+		*out_count = rrr.size();
+		*out_length = length;
+		*out_more = rrr.more;
+
+		if( buffer && buffer_length >= length && offsets_length >= 2*rrr.size()+1 ) {
+			int offset = 0;
+			for( int i = 0; i < rrr.size(); i++ ) {
+				out_offsets[2*i] = offset;
+				memcpy( buffer + offset, rrr[i].key.begin(), rrr[i].key.size() );
+				offset += rrr[i].key.size();
+
+				out_offsets[2*i+1] = offset;
+				memcpy( buffer + offset, rrr[i].value.begin(), rrr[i].value.size() );
+				offset += rrr[i].value.size();
+			}
+			out_offsets[2*rrr.size()] = offset;
+		} );
+}
+
 extern "C"
 fdb_error_t fdb_future_get_string_array(
 	FDBFuture* f, const char*** out_strings, int* out_count)
@@ -374,6 +422,32 @@ FDBFuture* fdb_transaction_get_impl( FDBTransaction* tr, uint8_t const* key_name
 		( TXN(tr)->get( KeyRef( key_name, key_name_length ), snapshot ).extractPtr() );
 }
 
+extern "C" DLLEXPORT
+FDBFuture* fdb_transaction_get_multi( FDBTransaction* tr, uint8_t const* const* key_names,
+									  int const* key_name_lengths, int count, fdb_bool_t snapshot )
+{
+	Standalone<VectorRef<KeyRef>> keys;
+	std::vector<ThreadFuture<Optional<Value>>> values;
+	for( int i = 0; i < count; i++ ) {
+		keys.push_back_deep( keys.arena(), KeyRef( key_names[i], key_name_lengths[i] ) );
+		values.push_back( TXN(tr)->get( keys.back(), snapshot ) );
+	}
+
+	return (FDBFuture*)( mapThreadFuture<Void, Standalone<RangeResultRef>>( waitForAllThreadFutures( values ),
+		[keys, values](ErrorOr<Void> ready) mutable -> ErrorOr<Standalone<RangeResultRef>> {
+			if( ready.isError() )
+				return ready.getError();
+
+			Standalone<RangeResultRef> result;
+			for( int i = 0; i < values.size(); i++ ) {
+				Optional<Value> value = values[i].get();
+				if( value.present() )
+					result.push_back_deep( result.arena(), KeyValueRef( keys[i], value.get() ) );
+			}
+			return result;
+		} ).extractPtr() );
+}
+
 extern "C"
 FDBFuture* fdb_transaction_get_v13( FDBTransaction* tr, uint8_t const* key_name,
 									int key_name_length )
@@ -407,6 +481,45 @@ FDBFuture* fdb_transaction_get_addresses_for_key( FDBTransaction* tr, uint8_t co
 
 }
 
+extern "C" DLLEXPORT
+FDBFuture* fdb_transaction_get_estimated_range_size_bytes( FDBTransaction* tr, uint8_t const* begin_key_name,
+														   int begin_key_name_length, uint8_t const* end_key_name,
+														   int end_key_name_length )
+{
+	KeyRef begin( begin_key_name, begin_key_name_length );
+	KeyRef end( end_key_name, end_key_name_length );
+	if( begin > end )
+		return TSAV_ERROR( int64_t, inverted_range );
+	return (FDBFuture*)( TXN(tr)->getEstimatedRangeSizeBytes( KeyRangeRef( begin, end ) ).extractPtr() );
+}
+
+extern "C" DLLEXPORT
+FDBFuture* fdb_transaction_get_range_split_points( FDBTransaction* tr, uint8_t const* begin_key_name,
+												   int begin_key_name_length, uint8_t const* end_key_name,
+												   int end_key_name_length, int64_t chunk_size )
+{
+	KeyRef begin( begin_key_name, begin_key_name_length );
+	KeyRef end( end_key_name, end_key_name_length );
+	if( begin > end )
+		return TSAV_ERROR( Standalone<VectorRef<KeyRef>>, inverted_range );
+	return (FDBFuture*)( TXN(tr)->getRangeSplitPoints( KeyRangeRef( begin, end ), chunk_size ).extractPtr() );
+}
+
+extern "C" DLLEXPORT
+FDBFuture* fdb_transaction_get_large_value( FDBTransaction* tr, uint8_t const* key_name,
+											int key_name_length, int64_t offset, int length,
+											fdb_bool_t snapshot )
+{
+	return (FDBFuture*)( TXN(tr)->getLargeValue( KeyRef( key_name, key_name_length ), offset, length, snapshot ).extractPtr() );
+}
+
+extern "C" DLLEXPORT
+FDBFuture* fdb_transaction_get_large_value_size( FDBTransaction* tr, uint8_t const* key_name,
+												 int key_name_length, fdb_bool_t snapshot )
+{
+	return (FDBFuture*)( TXN(tr)->getLargeValueSize( KeyRef( key_name, key_name_length ), snapshot ).extractPtr() );
+}
+
 extern "C"
 FDBFuture* fdb_transaction_get_range_impl(
 		FDBTransaction* tr, uint8_t const* begin_key_name,
@@ -542,6 +655,22 @@ void fdb_transaction_clear_range(
 								end_key_name_length ) ); );
 }
 
+extern "C" DLLEXPORT
+void fdb_transaction_set_large_value( FDBTransaction* tr, uint8_t const* key_name,
+									  int key_name_length, uint8_t const* value,
+									  int value_length ) {
+	CATCH_AND_DIE(
+		TXN(tr)->setLargeValue( KeyRef( key_name, key_name_length ),
+								ValueRef( value, value_length ) ); );
+}
+
+extern "C" DLLEXPORT
+void fdb_transaction_clear_large_value( FDBTransaction* tr, uint8_t const* key_name,
+										int key_name_length ) {
+	CATCH_AND_DIE(
+		TXN(tr)->clearLargeValue( KeyRef( key_name, key_name_length ) ); );
+}
+
 extern "C" DLLEXPORT
 FDBFuture* fdb_transaction_watch( FDBTransaction *tr, uint8_t const* key_name,
 									int key_name_length)
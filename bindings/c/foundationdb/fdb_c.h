@@ -98,6 +98,11 @@ extern "C" {
         const void* value;
         int value_length;
     } FDBKeyValue;
+
+    typedef struct key {
+        const uint8_t* key;
+        int key_length;
+    } FDBKey;
 #pragma pack(pop)
 
     DLLEXPORT void fdb_future_cancel( FDBFuture *f );
@@ -124,10 +129,17 @@ extern "C" {
     DLLEXPORT WARN_UNUSED_RESULT fdb_error_t
     fdb_future_get_version( FDBFuture* f, int64_t* out_version );
 
+    DLLEXPORT WARN_UNUSED_RESULT fdb_error_t
+    fdb_future_get_int64( FDBFuture* f, int64_t* out_value );
+
     DLLEXPORT WARN_UNUSED_RESULT fdb_error_t
     fdb_future_get_key( FDBFuture* f, uint8_t const** out_key,
                         int* out_key_length );
 
+    DLLEXPORT WARN_UNUSED_RESULT fdb_error_t
+    fdb_future_get_key_array( FDBFuture* f, FDBKey const** out_key_array,
+                              int* out_count );
+
     DLLEXPORT WARN_UNUSED_RESULT fdb_error_t
     fdb_future_get_cluster( FDBFuture* f, FDBCluster** out_cluster );
 
@@ -145,6 +157,19 @@ extern "C" {
                                    int* out_count, fdb_bool_t* out_more );
 #endif
 
+    /* Copies the keys and values of a range result (or of a
+       fdb_transaction_get_multi result) into buffer one after another, key
+       then value for each pair, and writes to out_offsets the 2*count+1
+       offsets at which they begin and end.  *out_count and *out_length are
+       always set to the number of pairs and the number of bytes needed; if
+       buffer is NULL or buffer_length or offsets_length is too small, nothing
+       is copied. */
+    DLLEXPORT WARN_UNUSED_RESULT fdb_error_t
+    fdb_future_get_keyvalue_buffer( FDBFuture* f, uint8_t* buffer,
+                                    int buffer_length, int* out_offsets,
+                                    int offsets_length, int* out_count,
+                                    int* out_length, fdb_bool_t* out_more );
+
     DLLEXPORT WARN_UNUSED_RESULT fdb_error_t fdb_future_get_string_array(FDBFuture* f,
                             const char*** out_strings, int* out_count);
 
@@ -191,6 +216,17 @@ extern "C" {
                          int key_name_length, fdb_bool_t snapshot );
 #endif
 
+    /* Reads count keys with a single future, which becomes ready when all of
+       the reads are done.  Its result is read with
+       fdb_future_get_keyvalue_array or fdb_future_get_keyvalue_buffer, and
+       holds the keys that are present with their values, in the order they
+       were given. */
+    DLLEXPORT WARN_UNUSED_RESULT FDBFuture*
+    fdb_transaction_get_multi( FDBTransaction* tr,
+                               uint8_t const* const* key_names,
+                               int const* key_name_lengths, int count,
+                               fdb_bool_t snapshot );
+
 #if FDB_API_VERSION >= 14
     DLLEXPORT WARN_UNUSED_RESULT FDBFuture*
     fdb_transaction_get_key( FDBTransaction* tr, uint8_t const* key_name,
@@ -202,6 +238,47 @@ extern "C" {
     fdb_transaction_get_addresses_for_key(FDBTransaction* tr, uint8_t const* key_name,
                             int key_name_length);
 
+    /* Estimates the number of bytes stored in a range from the storage
+       servers' samples, without reading it.  The result is read with
+       fdb_future_get_int64. */
+    DLLEXPORT WARN_UNUSED_RESULT FDBFuture*
+    fdb_transaction_get_estimated_range_size_bytes( FDBTransaction* tr,
+                                                    uint8_t const* begin_key_name,
+                                                    int begin_key_name_length,
+                                                    uint8_t const* end_key_name,
+                                                    int end_key_name_length );
+
+    /* Returns keys that divide a range into chunks of roughly chunk_size
+       bytes, estimated in the same way.  The result is read with
+       fdb_future_get_key_array; it begins with the begin key, ends with the
+       end key, and includes every shard boundary in between. */
+    DLLEXPORT WARN_UNUSED_RESULT FDBFuture*
+    fdb_transaction_get_range_split_points( FDBTransaction* tr,
+                                            uint8_t const* begin_key_name,
+                                            int begin_key_name_length,
+                                            uint8_t const* end_key_name,
+                                            int end_key_name_length,
+                                            int64_t chunk_size );
+
+    /* Reads up to length bytes (the rest of the value, if length is
+       negative) starting at offset from a value written with
+       fdb_transaction_set_large_value.  Every chunk the read covers is
+       fetched at once; a large value can be streamed by reading successive
+       windows of it.  The result is read with fdb_future_get_value, and a
+       key holding an ordinary value is read as if it were a large one. */
+    DLLEXPORT WARN_UNUSED_RESULT FDBFuture*
+    fdb_transaction_get_large_value( FDBTransaction* tr, uint8_t const* key_name,
+                                     int key_name_length, int64_t offset,
+                                     int length, fdb_bool_t snapshot );
+
+    /* The total size of the value at a key, read with fdb_future_get_int64;
+       -1 if the key has no value. */
+    DLLEXPORT WARN_UNUSED_RESULT FDBFuture*
+    fdb_transaction_get_large_value_size( FDBTransaction* tr,
+                                          uint8_t const* key_name,
+                                          int key_name_length,
+                                          fdb_bool_t snapshot );
+
 #if FDB_API_VERSION >= 14
     DLLEXPORT WARN_UNUSED_RESULT FDBFuture* fdb_transaction_get_range(
         FDBTransaction* tr, uint8_t const* begin_key_name,
@@ -231,6 +308,20 @@ extern "C" {
         int begin_key_name_length, uint8_t const* end_key_name,
         int end_key_name_length );
 
+    /* Writes a value larger than the value size limit, split into chunks
+       stored in the system keyspace.  The whole value still counts towards
+       the transaction size limit. */
+    DLLEXPORT void
+    fdb_transaction_set_large_value( FDBTransaction* tr, uint8_t const* key_name,
+                                     int key_name_length, uint8_t const* value,
+                                     int value_length );
+
+    /* Clears a key and the chunks of any large value it holds. */
+    DLLEXPORT void
+    fdb_transaction_clear_large_value( FDBTransaction* tr,
+                                       uint8_t const* key_name,
+                                       int key_name_length );
+
     DLLEXPORT WARN_UNUSED_RESULT FDBFuture* fdb_transaction_watch( FDBTransaction *tr,
                                                 uint8_t const* key_name,
                                                 int key_name_length);
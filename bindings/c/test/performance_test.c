@@ -270,6 +270,45 @@ struct RunResult parallelGet(struct ResultSet *rs, FDBTransaction *tr) {
 	return RES(PARALLEL_GET_COUNT/(end - start), 0);
 }
 
+const char *PARALLEL_GET_MULTI_KPI = "C parallel get_multi throughput (local client)";
+struct RunResult parallelGetMulti(struct ResultSet *rs, FDBTransaction *tr) {
+	fdb_error_t e = maybeLogError(setRetryLimit(rs, tr, 5), "setting retry limit", rs);
+	if(e) return RES(0, e);
+
+	uint8_t const **multiKeys = (uint8_t const**)malloc((sizeof(uint8_t*)) * PARALLEL_GET_COUNT);
+	int *multiKeyLengths = (int*)malloc((sizeof(int)) * PARALLEL_GET_COUNT);
+
+	double start = getTime();
+
+	int i;
+	for(i = 0; i < PARALLEL_GET_COUNT; i++) {
+		int k = ((uint64_t)rand()) % numKeys;
+		multiKeys[i] = keys[k];
+		multiKeyLengths[i] = keySize;
+	}
+
+	FDBFuture *f = fdb_transaction_get_multi(tr, multiKeys, multiKeyLengths, PARALLEL_GET_COUNT, 0);
+
+	const FDBKeyValue *outKv;
+	int outCount;
+	fdb_bool_t outMore;
+
+	e = maybeLogError(fdb_future_block_until_ready(f), "waiting for get_multi future", rs);
+	if(!e) {
+		e = maybeLogError(fdb_future_get_keyvalue_array(f, &outKv, &outCount, &outMore), "getting get_multi values", rs);
+	}
+
+	fdb_future_destroy(f);
+
+	double end = getTime();
+
+	free(multiKeys);
+	free(multiKeyLengths);
+	if(e) return RES(0, e);
+
+	return RES(PARALLEL_GET_COUNT/(end - start), 0);
+}
+
 uint32_t ALTERNATING_GET_SET_COUNT = 2000;
 const char *ALTERNATING_GET_SET_KPI = "C alternating get set throughput (local client)";
 struct RunResult alternatingGetSet(struct ResultSet *rs, FDBTransaction *tr) {
@@ -446,6 +485,78 @@ struct RunResult getRange(struct ResultSet *rs, FDBTransaction *tr) {
 	return RES(GET_RANGE_COUNT/(end - start), 0);
 }
 
+const char *GET_RANGE_BUFFER_KPI = "C get range into buffer throughput (local client)";
+struct RunResult getRangeBuffer(struct ResultSet *rs, FDBTransaction *tr) {
+	fdb_error_t e = maybeLogError(setRetryLimit(rs, tr, 5), "setting retry limit", rs);
+	if(e) return RES(0, e);
+
+	uint32_t startKey = ((uint64_t)rand()) % (numKeys - GET_RANGE_COUNT - 1);
+
+	int bufferLength = GET_RANGE_COUNT * (keySize + valueSize);
+	uint8_t *buffer = (uint8_t*)malloc((sizeof(uint8_t)) * bufferLength);
+	int offsetsLength = 2 * GET_RANGE_COUNT + 1;
+	int *offsets = (int*)malloc((sizeof(int)) * offsetsLength);
+
+	double start = getTime();
+
+	int outCount;
+	int outLength;
+	fdb_bool_t outMore = 1;
+	int totalOut = 0;
+	int iteration = 0;
+
+	FDBFuture *f = fdb_transaction_get_range(tr,
+		keys[startKey], keySize, 1, 0,
+		keys[startKey + GET_RANGE_COUNT], keySize, 1, 0,
+		0, 0,
+		FDB_STREAMING_MODE_WANT_ALL, ++iteration, 0, 0);
+
+	while(outMore) {
+		e = maybeLogError(fdb_future_block_until_ready(f), "getting range", rs);
+		if(!e) {
+			e = maybeLogError(fdb_future_get_keyvalue_buffer(f, buffer, bufferLength, offsets, offsetsLength, &outCount, &outLength, &outMore), "reading range buffer", rs);
+		}
+		if(!e && outLength > bufferLength) {
+			logError(4100, "verifying range fits in buffer", rs);
+			e = 4100;
+		}
+		if(e) {
+			fdb_future_destroy(f);
+			free(buffer);
+			free(offsets);
+			return RES(0, e);
+		}
+
+		totalOut += outCount;
+
+		if(outMore) {
+			FDBFuture *f2 = fdb_transaction_get_range(tr,
+				buffer + offsets[2 * outCount - 2], offsets[2 * outCount - 1] - offsets[2 * outCount - 2], 1, 1,
+				keys[startKey + GET_RANGE_COUNT], keySize, 1, 0,
+				0, 0,
+				FDB_STREAMING_MODE_WANT_ALL, ++iteration, 0, 0);
+			fdb_future_destroy(f);
+			f = f2;
+		}
+	}
+
+	fdb_future_destroy(f);
+	free(buffer);
+	free(offsets);
+
+	if(totalOut != GET_RANGE_COUNT) {
+		char *msg = (char*)malloc((sizeof(char)) * 200);
+		sprintf(msg, "verifying out count (%d != %d)", totalOut, GET_RANGE_COUNT);
+		logError(4100, msg, rs);
+		free(msg);
+		return RES(0, 4100);
+	}
+
+	double end = getTime();
+
+	return RES(GET_RANGE_COUNT/(end - start), 0);
+}
+
 uint32_t GET_KEY_COUNT = 2000;
 const char *GET_KEY_KPI = "C get key throughput (local client)";
 struct RunResult getKey(struct ResultSet *rs, FDBTransaction *tr) {
@@ -556,6 +667,62 @@ struct RunResult writeTransaction(struct ResultSet *rs, FDBDatabase *db) {
 	return RES(WRITE_TRANSACTION_COUNT/(end - start), 0);
 }
 
+uint32_t MULTITHREADED_FUTURE_COUNT = 100000;
+int MULTITHREADED_THREAD_COUNT = 8;
+const char *MULTITHREADED_FUTURE_KPI = "C multithreaded future throughput (local client)";
+
+struct MultithreadedArgs {
+	FDBDatabase *db;
+	fdb_error_t e;
+};
+
+// Each thread repeatedly waits on an already cached read version, so the work is dominated by handing
+// requests to the network thread and completions back
+void* multithreadedFutureThread(void *p) {
+	struct MultithreadedArgs *args = (struct MultithreadedArgs*)p;
+	FDBTransaction *tr = NULL;
+	args->e = fdb_database_create_transaction(args->db, &tr);
+	if(args->e) return NULL;
+
+	int i;
+	for(i = 0; i < MULTITHREADED_FUTURE_COUNT && !args->e; i++) {
+		FDBFuture *f = fdb_transaction_get_read_version(tr);
+		args->e = waitError(f);
+		fdb_future_destroy(f);
+	}
+
+	fdb_transaction_destroy(tr);
+	return NULL;
+}
+
+struct RunResult multithreadedFutures(struct ResultSet *rs, FDBDatabase *db) {
+	pthread_t *threads = malloc(sizeof(pthread_t)*MULTITHREADED_THREAD_COUNT);
+	struct MultithreadedArgs *args = malloc(sizeof(struct MultithreadedArgs)*MULTITHREADED_THREAD_COUNT);
+
+	double start = getTime();
+	int i;
+	for(i = 0; i < MULTITHREADED_THREAD_COUNT; i++) {
+		args[i].db = db;
+		args[i].e = 0;
+		pthread_create(&threads[i], NULL, &multithreadedFutureThread, &args[i]);
+	}
+
+	fdb_error_t e = 0;
+	for(i = 0; i < MULTITHREADED_THREAD_COUNT; i++) {
+		pthread_join(threads[i], NULL);
+		if(!e) e = args[i].e;
+	}
+	double end = getTime();
+
+	free(threads);
+	free(args);
+
+	maybeLogError(e, "getting read version", rs);
+	if(e) return RES(0, e);
+
+	return RES(MULTITHREADED_FUTURE_COUNT*MULTITHREADED_THREAD_COUNT/(end - start), 0);
+}
+
 void runTests(struct ResultSet *rs) {
 	FDBDatabase *db = openDatabase(rs, &netThread);
 
@@ -577,6 +744,9 @@ void runTests(struct ResultSet *rs) {
 	printf("parallel_get\n");
 	runTest(&parallelGet, db, rs, PARALLEL_GET_KPI);
 
+	printf("parallel_get_multi\n");
+	runTest(&parallelGetMulti, db, rs, PARALLEL_GET_MULTI_KPI);
+
 	printf("alternating_get_set\n");
 	runTest(&alternatingGetSet, db, rs, ALTERNATING_GET_SET_KPI);
 
@@ -586,6 +756,9 @@ void runTests(struct ResultSet *rs) {
 	printf("get_range\n");
 	runTest(&getRange, db, rs, GET_RANGE_KPI);
 
+	printf("get_range_buffer\n");
+	runTest(&getRangeBuffer, db, rs, GET_RANGE_BUFFER_KPI);
+
 	printf("get_key\n");
 	runTest(&getKey, db, rs, GET_KEY_KPI);
 
@@ -595,6 +768,9 @@ void runTests(struct ResultSet *rs) {
 	printf("write_transaction\n");
 	runTestDb(&writeTransaction, db, rs, WRITE_TRANSACTION_KPI);
 
+	printf("multithreaded_future\n");
+	runTestDb(&multithreadedFutures, db, rs, MULTITHREADED_FUTURE_KPI);
+
 	fdb_database_destroy(db);
 	fdb_stop_network();
 }
@@ -26,6 +26,8 @@ namespace FDB {
 	const StringRef DirectoryLayer::HIGH_CONTENTION_KEY = LiteralStringRef("hca");
 	const StringRef DirectoryLayer::LAYER_KEY = LiteralStringRef("layer");
 	const StringRef DirectoryLayer::VERSION_KEY = LiteralStringRef("version");
+	const StringRef DirectoryLayer::METADATA_VERSION_KEY = LiteralStringRef("metadataVersion");
+	const int DirectoryLayer::MAX_CACHED_NODES = 10000;
 	const int64_t DirectoryLayer::SUB_DIR_KEY = 0;
 
 	const uint32_t DirectoryLayer::VERSION[3] = {1, 0, 0};
@@ -35,8 +37,8 @@ namespace FDB {
 	const Subspace DirectoryLayer::DEFAULT_CONTENT_SUBSPACE = Subspace();
 	const StringRef DirectoryLayer::PARTITION_LAYER = LiteralStringRef("partition");
 
-	DirectoryLayer::DirectoryLayer(Subspace nodeSubspace, Subspace contentSubspace, bool allowManualPrefixes) :
-		nodeSubspace(nodeSubspace), contentSubspace(contentSubspace), allowManualPrefixes(allowManualPrefixes),
+	DirectoryLayer::DirectoryLayer(Subspace nodeSubspace, Subspace contentSubspace, bool allowManualPrefixes, bool cacheNodes) :
+		nodeSubspace(nodeSubspace), contentSubspace(contentSubspace), allowManualPrefixes(allowManualPrefixes), cacheNodes(cacheNodes),
 		rootNode(nodeSubspace.get(nodeSubspace.key())), allocator(rootNode.get(HIGH_CONTENTION_KEY))
 	{ }
 
@@ -56,6 +58,29 @@ namespace FDB {
 	ACTOR Future<DirectoryLayer::Node> find(Reference<DirectoryLayer> dirLayer, Reference<Transaction> tr, IDirectory::Path path) {
 		state int pathIndex = 0;
 		state DirectoryLayer::Node node = DirectoryLayer::Node(dirLayer, dirLayer->rootNode, IDirectory::Path(), path);
+		state Optional<std::string> metadataVersion;
+
+		// The metadata version is read without snapshot isolation, so a cache hit still conflicts with any concurrent
+		// change to the directory tree just as reading the nodes themselves would have.
+		if(dirLayer->cacheNodes && path.size()) {
+			Optional<FDBStandalone<ValueRef>> version = wait(tr->get(dirLayer->rootNode.pack(DirectoryLayer::METADATA_VERSION_KEY)));
+			if(version.present()) {
+				metadataVersion = version.get().toString();
+				if(metadataVersion.get() != dirLayer->cachedMetadataVersion) {
+					dirLayer->nodeCache.clear();
+					dirLayer->cachedMetadataVersion = metadataVersion.get();
+				}
+				else {
+					auto cached = dirLayer->nodeCache.find(path);
+					if(cached != dirLayer->nodeCache.end()) {
+						node = DirectoryLayer::Node(dirLayer, cached->second.subspace, cached->second.path, path);
+						node.layer = cached->second.layer;
+						node.loadedMetadata = true;
+						return node;
+					}
+				}
+			}
+		}
 
 		for(; pathIndex != path.size(); ++pathIndex) {
 			ASSERT(node.subspace.present());
@@ -68,7 +93,7 @@ namespace FDB {
 			node = _node;
 
 			if(!node.exists() || node.layer == DirectoryLayer::PARTITION_LAYER) {
-				return node;
+				break;
 			}
 		}
 
@@ -77,6 +102,16 @@ namespace FDB {
 			node = _node;
 		}
 
+		if(metadataVersion.present() && metadataVersion.get() == dirLayer->cachedMetadataVersion && node.exists()) {
+			if(dirLayer->nodeCache.size() >= DirectoryLayer::MAX_CACHED_NODES) {
+				dirLayer->nodeCache.clear();
+			}
+			DirectoryLayer::CachedNode &cached = dirLayer->nodeCache[path];
+			cached.subspace = node.subspace.get();
+			cached.path = node.path;
+			cached.layer = node.layer;
+		}
+
 		return node;
 	}
 
@@ -120,6 +155,13 @@ namespace FDB {
 		tr->set(rootNode.pack(VERSION_KEY), StringRef((uint8_t*)VERSION, 12));
 	}
 
+	// Every change to the directory tree sets a new random metadata version both before and after it writes, so that
+	// nodes cached while the change is in progress are keyed by a version that is never committed.
+	void DirectoryLayer::bumpMetadataVersion(Reference<Transaction> const& tr) const {
+		std::string version = g_random->randomUniqueID().toString();
+		tr->set(rootNode.pack(METADATA_VERSION_KEY), StringRef(version));
+	}
+
 	ACTOR Future<Void> checkVersionInternal(const DirectoryLayer* dirLayer, Reference<Transaction> tr, bool writeAccess) {
 		Optional<FDBStandalone<ValueRef>> versionBytes = wait(tr->get(dirLayer->rootNode.pack(DirectoryLayer::VERSION_KEY)));
 
@@ -225,11 +267,13 @@ namespace FDB {
 			throw directory_prefix_in_use();
 		}
 
+		dirLayer->bumpMetadataVersion(tr);
 		Subspace parentNode = wait(getParentNode(dirLayer, tr, path));
 		Subspace node = dirLayer->nodeWithPrefix(newPrefix);
 
 		tr->set(parentNode.get(DirectoryLayer::SUB_DIR_KEY).get(path.back(), true).key(), newPrefix);
 		tr->set(node.get(DirectoryLayer::LAYER_KEY).key(), layer);
+		dirLayer->bumpMetadataVersion(tr);
 		return dirLayer->contentsOfNode(node, path, layer);
 	}
 
@@ -385,8 +429,10 @@ namespace FDB {
 			throw parent_directory_does_not_exist();
 		}
 
+		dirLayer->bumpMetadataVersion(tr);
 		tr->set(parentNode.subspace.get().get(DirectoryLayer::SUB_DIR_KEY).get(newPath.back(), true).key(), dirLayer->nodeSubspace.unpack(oldNode.subspace.get().key()).getString(0));
 		Void _ = wait(removeFromParent(dirLayer, tr, oldPath));
+		dirLayer->bumpMetadataVersion(tr);
 
 		return dirLayer->contentsOfNode(oldNode.subspace.get(), newPath, oldNode.layer);
 	}
@@ -454,12 +500,13 @@ namespace FDB {
 			return recurse;
 		}
 
-
+		dirLayer->bumpMetadataVersion(tr);
 		state std::vector<Future<Void>> futures;
 		futures.push_back(removeRecursive(dirLayer, tr, node.subspace.get()));
 		futures.push_back(removeFromParent(dirLayer, tr, path));
 
 		Void _ = wait(waitForAll(futures));
+		dirLayer->bumpMetadataVersion(tr);
 
 		return true;
 	}
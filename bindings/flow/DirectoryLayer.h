@@ -30,7 +30,10 @@
 namespace FDB {
 	class DirectoryLayer : public IDirectory {
 	public:
-		DirectoryLayer(Subspace nodeSubspace = DEFAULT_NODE_SUBSPACE, Subspace contentSubspace = DEFAULT_CONTENT_SUBSPACE, bool allowManualPrefixes = false);
+		// If cacheNodes is set, the results of path lookups are cached and reused for as long as the directory metadata
+		// version is unchanged.  This is only safe if every client that modifies the directory layer bumps that version,
+		// which directory layers from other bindings do not.
+		DirectoryLayer(Subspace nodeSubspace = DEFAULT_NODE_SUBSPACE, Subspace contentSubspace = DEFAULT_CONTENT_SUBSPACE, bool allowManualPrefixes = false, bool cacheNodes = false);
 
 		Future<Reference<DirectorySubspace>> create(Reference<Transaction> const& tr, Path const& path, Standalone<StringRef> const& layer = Standalone<StringRef>(), Optional<Standalone<StringRef>> const& prefix = Optional<Standalone<StringRef>>());
 		Future<Reference<DirectorySubspace>> open(Reference<Transaction> const& tr, Path const& path, Standalone<StringRef> const& layer = Standalone<StringRef>());
@@ -58,6 +61,8 @@ namespace FDB {
 		static const StringRef HIGH_CONTENTION_KEY;
 		static const StringRef LAYER_KEY;
 		static const StringRef VERSION_KEY;
+		static const StringRef METADATA_VERSION_KEY;
+		static const int MAX_CACHED_NODES;
 		static const int64_t SUB_DIR_KEY;
 		static const uint32_t VERSION[3];
 		static const StringRef DEFAULT_NODE_SUBSPACE_PREFIX;
@@ -84,11 +89,19 @@ namespace FDB {
 			bool loadedMetadata;
 		};
 
+		// What find() learned about a path, without the reference back to the directory layer
+		struct CachedNode {
+			Subspace subspace;
+			Path path;
+			Standalone<StringRef> layer;
+		};
+
 		Reference<DirectorySubspace> openInternal(Standalone<StringRef> const& layer, Node const& existingNode, bool allowOpen);
 		Future<Reference<DirectorySubspace>> createOrOpenInternal(Reference<Transaction> const& tr, Path const& path, Standalone<StringRef> const& layer, Optional<Standalone<StringRef>> const& prefix, bool allowCreate, bool allowOpen);
 
 		void initializeDirectory(Reference<Transaction> const& tr) const;
 		Future<Void> checkVersion(Reference<Transaction> const& tr, bool writeAccess) const;
+		void bumpMetadataVersion(Reference<Transaction> const& tr) const;
 
 		template <class T>
 		Optional<Subspace> nodeWithPrefix(Optional<T> const& prefix) const;
@@ -104,6 +117,10 @@ namespace FDB {
 		HighContentionAllocator allocator;
 		bool allowManualPrefixes;
 
+		bool cacheNodes;
+		std::string cachedMetadataVersion;
+		std::map<Path, CachedNode> nodeCache;
+
 		Path path;
 	};
 }
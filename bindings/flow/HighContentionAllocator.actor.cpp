@@ -21,11 +21,16 @@
 #include "HighContentionAllocator.h"
 
 namespace FDB {
-	ACTOR Future<Standalone<StringRef>> _allocate(Reference<Transaction> tr, Subspace counters, Subspace recent){
+	// Allocates prefixCount distinct prefixes in one transaction.  The counter for the current window is bumped by as many
+	// prefixes as are wanted from it at once and their candidates are all checked concurrently, so a batch costs about as
+	// many round trips as a single allocation unless it spans several windows.
+	ACTOR Future<std::vector<Standalone<StringRef>>> _allocate(Reference<Transaction> tr, Subspace counters, Subspace recent, int prefixCount){
 		state int64_t start = 0;
 		state int64_t window = 0;
+		state std::vector<Standalone<StringRef>> prefixes;
+		state std::set<int64_t> tried;
 
-		loop {
+		while(prefixes.size() < prefixCount) {
 			FDBStandalone<RangeResultRef> range = wait(tr->getRange(counters.range(), 1, true, true));
 
 			if(range.size() > 0) {
@@ -33,7 +38,12 @@ namespace FDB {
 			}
 
 			state bool windowAdvanced = false;
+			state int64_t inc;
 			loop {
+				// Take no more than a quarter of a window at a time so that a batch always leaves it with room to spare
+				window = HighContentionAllocator::windowSize(start);
+				inc = std::min<int64_t>(prefixCount - prefixes.size(), std::max<int64_t>(window / 4, 1));
+
 				// if thread safety is needed, this should be locked {
 				if(windowAdvanced) {
 					tr->clear(KeyRangeRef(counters.key(), counters.get(start).key()));
@@ -41,7 +51,6 @@ namespace FDB {
 					tr->clear(KeyRangeRef(recent.key(), recent.get(start).key()));
 				}
 
-				int64_t inc = 1;
 				tr->atomicOp(counters.get(start).key(), StringRef((uint8_t*)&inc, 8), FDB_MUTATION_TYPE_ADD);
 				Future<Optional<FDBStandalone<ValueRef>>> countFuture = tr->get(counters.get(start).key(), true);
 				// }
@@ -56,7 +65,6 @@ namespace FDB {
 					count = *(int64_t*)countValue.get().begin();
 				}
 
-				window = HighContentionAllocator::windowSize(start);
 				if(count * 2 < window) {
 					break;
 				}
@@ -65,17 +73,31 @@ namespace FDB {
 				windowAdvanced = true;
 			}
 
+			state size_t target = prefixes.size() + inc;
 			loop {
-				state int64_t candidate = g_random->randomInt(start, start + window);
+				state std::vector<int64_t> candidates;
+				state std::vector<Future<Optional<FDBStandalone<ValueRef>>>> candidateValues;
+				candidates.clear();
+				candidateValues.clear();
 
 				// if thread safety is needed, this should be locked {
 				state Future<FDBStandalone<RangeResultRef>> latestCounter = tr->getRange(counters.range(), 1, true, true);
-				state Future<Optional<FDBStandalone<ValueRef>>> candidateValue = tr->get(recent.get(candidate).key());
-				tr->setOption(FDBTransactionOption::FDB_TR_OPTION_NEXT_WRITE_NO_WRITE_CONFLICT_RANGE);
-				tr->set(recent.get(candidate).key(), ValueRef());
+				for(size_t i = prefixes.size(); i < target; ++i) {
+					int64_t candidate = g_random->randomInt(start, start + window);
+					for(int retries = 0; tried.count(candidate) && retries < 10; ++retries) {
+						candidate = g_random->randomInt(start, start + window);
+					}
+					if(!tried.insert(candidate).second) {
+						continue;
+					}
+					candidates.push_back(candidate);
+					candidateValues.push_back(tr->get(recent.get(candidate).key()));
+					tr->setOption(FDBTransactionOption::FDB_TR_OPTION_NEXT_WRITE_NO_WRITE_CONFLICT_RANGE);
+					tr->set(recent.get(candidate).key(), ValueRef());
+				}
 				// }
 
-				Void _ = wait(success(latestCounter) && success(candidateValue));
+				Void _ = wait(success(latestCounter) && waitForAll(candidateValues));
 				int64_t currentWindowStart = 0;
 				if(latestCounter.get().size() > 0) {
 					currentWindowStart = counters.unpack(latestCounter.get()[0].key).getInt(0);
@@ -85,16 +107,29 @@ namespace FDB {
 					break;
 				}
 
-				if(!candidateValue.get().present()) {
-					tr->addWriteConflictKey(recent.get(candidate).key());
-					return Tuple().append(candidate).pack();
+				for(int i = 0; i < candidates.size(); ++i) {
+					if(!candidateValues[i].get().present()) {
+						tr->addWriteConflictKey(recent.get(candidates[i]).key());
+						prefixes.push_back(Tuple().append(candidates[i]).pack());
+					}
+				}
+
+				// Also go back for a fresh count if this window seems to be out of candidates
+				if(prefixes.size() >= target || candidates.empty()) {
+					break;
 				}
 			}
 		}
+
+		return prefixes;
 	}
 
 	Future<Standalone<StringRef>> HighContentionAllocator::allocate(Reference<Transaction> const& tr) const {
-		return _allocate(tr, counters, recent);
+		return map(_allocate(tr, counters, recent, 1), [](std::vector<Standalone<StringRef>> const& prefixes) { return prefixes[0]; });
+	}
+
+	Future<std::vector<Standalone<StringRef>>> HighContentionAllocator::allocate(Reference<Transaction> const& tr, int count) const {
+		return _allocate(tr, counters, recent, count);
 	}
 
 	int64_t HighContentionAllocator::windowSize(int64_t start) {
@@ -31,6 +31,10 @@ namespace FDB {
 		HighContentionAllocator(Subspace subspace) : counters(subspace.get(0)), recent(subspace.get(1)) {}
 		Future<Standalone<StringRef>> allocate(Reference<Transaction> const& tr) const;
 
+		// Reserves count distinct prefixes in a single transaction.  Once it commits they stay reserved, so a caller
+		// creating many directories can hand them out itself as manual prefixes in later transactions.
+		Future<std::vector<Standalone<StringRef>>> allocate(Reference<Transaction> const& tr, int count) const;
+
 		static int64_t windowSize(int64_t start);
 	private:
 		Subspace counters;
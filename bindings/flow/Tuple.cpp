@@ -158,20 +158,30 @@ namespace FDB {
 	Tuple& Tuple::append(StringRef const& str, bool utf8) {
 		offsets.push_back(data.size());
 
-		const uint8_t utfChar = utf8 ? STRING_CODE : BYTES_CODE;
-		data.append(data.arena(), &utfChar, 1);
-
-		size_t lastPos = 0;
-		for(size_t pos = 0; pos < str.size(); ++pos) {
-			if(str[pos] == '\x00') {
-				data.append(data.arena(), str.begin() + lastPos, pos - lastPos);
-				data.push_back(data.arena(), (uint8_t)'\x00');
-				data.push_back(data.arena(), (uint8_t)'\xff');
-				lastPos = pos + 1;
+		// Size the encoding up front so that it is written with at most one reallocation
+		int nulls = 0;
+		for(const uint8_t *p = str.begin(); p < str.end() && (p = (const uint8_t*)memchr(p, 0, str.end() - p)) != NULL; ++p)
+			++nulls;
+		data.reserve(data.arena(), data.size() + str.size() + nulls + 2);
+
+		data.push_back(data.arena(), utf8 ? STRING_CODE : BYTES_CODE);
+
+		if(nulls == 0) {
+			data.append(data.arena(), str.begin(), str.size());
+		}
+		else {
+			size_t lastPos = 0;
+			for(size_t pos = 0; pos < str.size(); ++pos) {
+				if(str[pos] == '\x00') {
+					data.append(data.arena(), str.begin() + lastPos, pos - lastPos);
+					data.push_back(data.arena(), (uint8_t)'\x00');
+					data.push_back(data.arena(), (uint8_t)'\xff');
+					lastPos = pos + 1;
+				}
 			}
+			data.append(data.arena(), str.begin() + lastPos, str.size() - lastPos);
 		}
 
-		data.append(data.arena(), str.begin() + lastPos, str.size() - lastPos);
 		data.push_back(data.arena(), (uint8_t)'\x00');
 
 		return *this;
@@ -332,26 +342,34 @@ namespace FDB {
 			e = data.size();
 		}
 
-		Standalone<StringRef> result;
-		VectorRef<uint8_t> staging;
+		// The element ends in a terminating null and each escaped null inside it is two bytes, so count them to size the
+		// result exactly and copy it in one allocation.
+		int nulls = 0;
+		for(const uint8_t *p = data.begin() + b; p < data.begin() + e && (p = (const uint8_t*)memchr(p, 0, data.begin() + e - p)) != NULL; p += 2)
+			++nulls;
+
+		Standalone<StringRef> result = makeString(e - b - nulls);
+		uint8_t *out = mutateString(result);
 
 		for (size_t i = b; i < e; ++i) {
 			if(data[i] == '\x00') {
-				staging.append(result.arena(), data.begin() + b, i - b);
+				memcpy(out, data.begin() + b, i - b);
+				out += i - b;
 				++i;
 				b = i + 1;
 
 				if(i < e) {
-					staging.push_back(result.arena(), '\x00');
+					*out++ = '\x00';
 				}
 			}
 		}
 
 		if(b < e) {
-			staging.append(result.arena(), data.begin() + b, e - b);
+			memcpy(out, data.begin() + b, e - b);
+			out += e - b;
 		}
 
-		result.StringRef::operator=(StringRef(staging.begin(), staging.size()));
+		ASSERT(out == result.end());
 		return result;
 	}
 
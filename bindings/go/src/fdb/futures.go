@@ -26,6 +26,7 @@ package fdb
  #cgo LDFLAGS: -lfdb_c -lm
  #define FDB_API_VERSION 520
  #include <foundationdb/fdb_c.h>
+ #include <stdlib.h>
  #include <string.h>
 
  extern void unlockMutex(void*);
@@ -37,6 +38,39 @@ package fdb
  void go_set_callback(void* f, void* m) {
      fdb_future_set_callback(f, (FDBCallback)&go_callback, m);
  }
+
+ typedef struct {
+     int remaining;
+     void* m;
+ } go_batch;
+
+ void go_batch_callback(FDBFuture* f, void* b) {
+     go_batch* batch = (go_batch*)b;
+     if (__sync_sub_and_fetch(&batch->remaining, 1) == 0) {
+         unlockMutex(batch->m);
+         free(batch);
+     }
+ }
+
+ // Returns 1 if every future was already ready, and otherwise arranges for m
+ // to be unlocked once the last of them becomes ready and returns 0.
+ int go_set_batch_callback(FDBFuture** fs, int count, void* m) {
+     int i;
+     go_batch* batch = (go_batch*)malloc(sizeof(go_batch));
+     batch->remaining = 1;
+     batch->m = m;
+     for (i = 0; i < count; i++) {
+         if (!fdb_future_is_ready(fs[i])) {
+             __sync_add_and_fetch(&batch->remaining, 1);
+             fdb_future_set_callback(fs[i], (FDBCallback)&go_batch_callback, batch);
+         }
+     }
+     if (__sync_sub_and_fetch(&batch->remaining, 1) == 0) {
+         free(batch);
+         return 1;
+     }
+     return 0;
+ }
 */
 import "C"
 
@@ -97,6 +131,40 @@ func (f future) BlockUntilReady() {
 	fdb_future_block_until_ready(f.ptr)
 }
 
+func (f future) getPtr() *C.FDBFuture {
+	return f.ptr
+}
+
+type nativeFuture interface {
+	getPtr() *C.FDBFuture
+}
+
+// BlockUntilReadyAll blocks the calling goroutine until all of the provided
+// futures are ready. It makes a single call into the FoundationDB C library
+// for all of the futures returned by this package, rather than one call per
+// future as calling BlockUntilReady on each of them in turn would. Any other
+// implementations of Future are waited on with BlockUntilReady.
+func BlockUntilReadyAll(futures ...Future) {
+	ptrs := make([]*C.FDBFuture, 0, len(futures))
+	for _, f := range futures {
+		if nf, ok := f.(nativeFuture); ok {
+			ptrs = append(ptrs, nf.getPtr())
+		} else {
+			f.BlockUntilReady()
+		}
+	}
+
+	if len(ptrs) == 0 {
+		return
+	}
+
+	m := &sync.Mutex{}
+	m.Lock()
+	if C.go_set_batch_callback(&ptrs[0], C.int(len(ptrs)), unsafe.Pointer(m)) == 0 {
+		m.Lock()
+	}
+}
+
 func (f future) IsReady() bool {
 	return C.fdb_future_is_ready(f.ptr) != 0
 }
@@ -252,16 +320,25 @@ type futureKeyValueArray struct {
 	*future
 }
 
-func stringRefToSlice(ptr unsafe.Pointer) []byte {
-	size := *((*C.int)(unsafe.Pointer(uintptr(ptr) + 8)))
+func stringRefSize(ptr unsafe.Pointer) int {
+	return int(*((*C.int)(unsafe.Pointer(uintptr(ptr) + 8))))
+}
+
+// stringRefToSlice copies the string at ptr into buf at offset, returning the
+// copy and the offset following it.
+func stringRefToSlice(ptr unsafe.Pointer, buf []byte, offset int) ([]byte, int) {
+	size := stringRefSize(ptr)
 
 	if size == 0 {
-		return []byte{}
+		return []byte{}, offset
 	}
 
 	src := unsafe.Pointer(*(**C.uint8_t)(unsafe.Pointer(ptr)))
+	end := offset + size
+
+	copy(buf[offset:end], (*[1 << 30]byte)(src)[:size:size])
 
-	return C.GoBytes(src, size)
+	return buf[offset:end:end], end
 }
 
 func (f futureKeyValueArray) Get() ([]KeyValue, bool, error) {
@@ -277,11 +354,22 @@ func (f futureKeyValueArray) Get() ([]KeyValue, bool, error) {
 
 	ret := make([]KeyValue, int(count))
 
+	// All of the keys and values are copied into one buffer, which the returned
+	// slices share, instead of being allocated one at a time
+	total := 0
+	for i := 0; i < int(count); i++ {
+		kvptr := unsafe.Pointer(uintptr(unsafe.Pointer(kvs)) + uintptr(i*24))
+
+		total += stringRefSize(kvptr) + stringRefSize(unsafe.Pointer(uintptr(kvptr)+12))
+	}
+
+	buf := make([]byte, total)
+	offset := 0
 	for i := 0; i < int(count); i++ {
 		kvptr := unsafe.Pointer(uintptr(unsafe.Pointer(kvs)) + uintptr(i*24))
 
-		ret[i].Key = stringRefToSlice(kvptr)
-		ret[i].Value = stringRefToSlice(unsafe.Pointer(uintptr(kvptr) + 12))
+		ret[i].Key, offset = stringRefToSlice(kvptr, buf, offset)
+		ret[i].Value, offset = stringRefToSlice(unsafe.Pointer(uintptr(kvptr)+12), buf, offset)
 	}
 
 	return ret, (more != 0), nil
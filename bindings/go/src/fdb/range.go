@@ -150,7 +150,7 @@ func (rr RangeResult) GetSliceWithError() ([]KeyValue, error) {
 		}
 		ret = append(ret, ri.kvs...)
 		ri.index = len(ri.kvs)
-		ri.fetchNextBatch()
+		ri.nextBatch()
 	}
 
 	return ret, nil
@@ -184,7 +184,9 @@ func (rr RangeResult) Iterator() *RangeIterator {
 
 // RangeIterator returns the key-value pairs in the database (as KeyValue
 // objects) satisfying the range specified in a range read. RangeIterator is
-// constructed with the (RangeResult).Iterator method.
+// constructed with the (RangeResult).Iterator method. As soon as a batch of
+// key-value pairs arrives, RangeIterator starts reading the following batch, so
+// the database is read while the current batch is being consumed.
 //
 // You must call Advance and get a true result prior to calling Get or MustGet.
 //
@@ -204,6 +206,7 @@ type RangeIterator struct {
 	index     int
 	err       error
 	snapshot  bool
+	next      *futureKeyValueArray
 }
 
 // Advance attempts to advance the iterator to the next key-value pair. Advance
@@ -223,34 +226,51 @@ func (ri *RangeIterator) Advance() bool {
 	ri.index = 0
 	ri.f = nil
 
-	if ri.err != nil || len(ri.kvs) > 0 {
+	if ri.err != nil {
+		return true
+	}
+
+	if len(ri.kvs) > 0 {
+		ri.prefetchNextBatch()
 		return true
 	}
 
 	return false
 }
 
-func (ri *RangeIterator) fetchNextBatch() {
-	if !ri.more || ri.index == ri.options.Limit {
-		ri.done = true
+// prefetchNextBatch starts reading the batch that follows ri.kvs, so that it
+// is fetched from the database while the current batch is being consumed.
+func (ri *RangeIterator) prefetchNextBatch() {
+	if !ri.more || len(ri.kvs) == ri.options.Limit {
+		ri.next = nil
 		return
 	}
 
 	if ri.options.Limit > 0 {
 		// Not worried about this being zero, checked equality above
-		ri.options.Limit -= ri.index
+		ri.options.Limit -= len(ri.kvs)
 	}
 
 	if ri.options.Reverse {
-		ri.sr.End = FirstGreaterOrEqual(ri.kvs[ri.index-1].Key)
+		ri.sr.End = FirstGreaterOrEqual(ri.kvs[len(ri.kvs)-1].Key)
 	} else {
-		ri.sr.Begin = FirstGreaterThan(ri.kvs[ri.index-1].Key)
+		ri.sr.Begin = FirstGreaterThan(ri.kvs[len(ri.kvs)-1].Key)
 	}
 
 	ri.iteration += 1
 
 	f := ri.t.doGetRange(ri.sr, ri.options, ri.snapshot, ri.iteration)
-	ri.f = &f
+	ri.next = &f
+}
+
+func (ri *RangeIterator) nextBatch() {
+	if ri.next == nil {
+		ri.done = true
+		return
+	}
+
+	ri.f = ri.next
+	ri.next = nil
 }
 
 // Get returns the next KeyValue in a range read, or an error if one of the
@@ -268,7 +288,7 @@ func (ri *RangeIterator) Get() (kv KeyValue, e error) {
 	ri.index += 1
 
 	if ri.index == len(ri.kvs) {
-		ri.fetchNextBatch()
+		ri.nextBatch()
 	}
 
 	return
@@ -25,6 +25,14 @@ package fdb
 /*
  #define FDB_API_VERSION 520
  #include <foundationdb/fdb_c.h>
+
+ void go_transaction_get_many(FDBTransaction* t, const uint8_t* keys, const int* lengths, int count, fdb_bool_t snapshot, FDBFuture** fs) {
+     int i;
+     for (i = 0; i < count; i++) {
+         fs[i] = fdb_transaction_get(t, keys, lengths[i], snapshot);
+         keys += lengths[i];
+     }
+ }
 */
 import "C"
 
@@ -246,6 +254,37 @@ func (t Transaction) Get(key KeyConvertible) FutureByteSlice {
 	return t.get(key.FDBKey(), 0)
 }
 
+func (t *transaction) getMany(keys []KeyConvertible, snapshot int) []FutureByteSlice {
+	if len(keys) == 0 {
+		return nil
+	}
+
+	var buf []byte
+	lengths := make([]C.int, len(keys))
+	for i, k := range keys {
+		key := k.FDBKey()
+		buf = append(buf, key...)
+		lengths[i] = C.int(len(key))
+	}
+
+	ptrs := make([]*C.FDBFuture, len(keys))
+	C.go_transaction_get_many(t.ptr, byteSliceToPtr(buf), &lengths[0], C.int(len(keys)), C.fdb_bool_t(snapshot), &ptrs[0])
+
+	ret := make([]FutureByteSlice, len(keys))
+	for i, ptr := range ptrs {
+		ret[i] = &futureByteSlice{future: newFuture(ptr)}
+	}
+	return ret
+}
+
+// GetMany returns the (future) values associated with each of the specified
+// keys, in the same order. It is equivalent to calling Get on each key, but
+// issues all of the reads with a single call into the FoundationDB C library.
+// The results may be waited on together with BlockUntilReadyAll.
+func (t Transaction) GetMany(keys []KeyConvertible) []FutureByteSlice {
+	return t.getMany(keys, 0)
+}
+
 func (t *transaction) doGetRange(r Range, options RangeOptions, snapshot bool, iteration int) futureKeyValueArray {
 	begin, end := r.FDBRangeKeySelectors()
 	bsel := begin.FDBKeySelector()
@@ -346,7 +346,7 @@ JNIEXPORT jobject JNICALL Java_com_apple_foundationdb_FutureResults_FutureResult
 	return result;
 }
 
-// SOMEDAY: explore doing this more efficiently with Direct ByteBuffers
+// See FutureResults_getDirect for a variant that returns the whole batch in one direct ByteBuffer
 JNIEXPORT jobject JNICALL Java_com_apple_foundationdb_FutureResults_FutureResults_1get(JNIEnv *jenv, jobject, jlong future) {
 	if( !future ) {
 		throwParamNotNull(jenv);
@@ -423,6 +423,70 @@ JNIEXPORT jobject JNICALL Java_com_apple_foundationdb_FutureResults_FutureResult
 	return result;
 }
 
+JNIEXPORT jobject JNICALL Java_com_apple_foundationdb_FutureResults_FutureResults_1getDirect(JNIEnv *jenv, jobject, jlong future) {
+	if( !future ) {
+		throwParamNotNull(jenv);
+		return JNI_NULL;
+	}
+
+	FDBFuture *f = (FDBFuture *)future;
+
+	const FDBKeyValue *kvs;
+	int count;
+	fdb_bool_t more;
+	fdb_error_t err = fdb_future_get_keyvalue_array( f, &kvs, &count, &more );
+	if( err ) {
+		safeThrow( jenv, getThrowable( jenv, err ) );
+		return JNI_NULL;
+	}
+
+	// The buffer holds the count and more flag, then the offset, key length and value length of each pair, then the keys and values
+	int headerSize = (2 + count * 3) * sizeof(jint);
+	int totalSize = headerSize;
+	for(int i = 0; i < count; i++) {
+		totalSize += kvs[i].key_length + kvs[i].value_length;
+	}
+
+	jclass bufferCls = jenv->FindClass("java/nio/ByteBuffer");
+	if( jenv->ExceptionOccurred() )
+		return JNI_NULL;
+	jmethodID allocateId = jenv->GetStaticMethodID(bufferCls, "allocateDirect", "(I)Ljava/nio/ByteBuffer;");
+	if( jenv->ExceptionOccurred() )
+		return JNI_NULL;
+
+	jobject buffer = jenv->CallStaticObjectMethod(bufferCls, allocateId, (jint)totalSize);
+	if( !buffer ) {
+		if( !jenv->ExceptionOccurred() )
+			throwOutOfMem(jenv);
+		return JNI_NULL;
+	}
+
+	uint8_t *buffer_barr = (uint8_t *)jenv->GetDirectBufferAddress(buffer);
+	if( !buffer_barr ) {
+		throwRuntimeEx( jenv, "Error getting handle to native resources" );
+		return JNI_NULL;
+	}
+
+	jint *header = (jint *)buffer_barr;
+	header[0] = count;
+	header[1] = more;
+
+	int offset = headerSize;
+	for(int i = 0; i < count; i++) {
+		header[ 2 + i * 3 ] = offset;
+		header[ 3 + i * 3 ] = kvs[i].key_length;
+		header[ 4 + i * 3 ] = kvs[i].value_length;
+
+		memcpy(buffer_barr + offset, kvs[i].key, kvs[i].key_length);
+		offset += kvs[i].key_length;
+
+		memcpy(buffer_barr + offset, kvs[i].value, kvs[i].value_length);
+		offset += kvs[i].value_length;
+	}
+
+	return buffer;
+}
+
 // SOMEDAY: explore doing this more efficiently with Direct ByteBuffers
 JNIEXPORT jbyteArray JNICALL Java_com_apple_foundationdb_FutureResult_FutureResult_1get(JNIEnv *jenv, jobject, jlong future) {
 	if( !future ) {
@@ -85,6 +85,7 @@ public class FDB {
 	private volatile boolean netStarted = false;
 	private volatile boolean netStopped = false;
 	volatile boolean warnOnUnclosed = true;
+	volatile boolean enableDirectBufferQueries = false;
 	private final Semaphore netRunning = new Semaphore(1);
 	private final NetworkOptions options;
 
@@ -200,6 +201,29 @@ public class FDB {
 		this.warnOnUnclosed = warnOnUnclosed;
 	}
 
+	/**
+	 * Enables or disables returning range read results in a single direct {@code ByteBuffer}
+	 *  per batch. When enabled, the keys and values of a batch are copied once out of native
+	 *  memory, and each {@link KeyValue} is only created when it is read. This reduces
+	 *  garbage collection pressure for large scans that skip or stop early. By default, this
+	 *  feature is disabled.
+	 *
+	 * @param enabled Whether range results should be returned in direct buffers
+	 */
+	public void enableDirectBufferQuery(boolean enabled) {
+		this.enableDirectBufferQueries = enabled;
+	}
+
+	/**
+	 * Returns whether range read results are returned in direct buffers, as set by
+	 *  {@link #enableDirectBufferQuery(boolean) enableDirectBufferQuery()}.
+	 *
+	 * @return {@code true} if range results are returned in direct buffers
+	 */
+	public boolean isDirectBufferQueriesEnabled() {
+		return enableDirectBufferQueries;
+	}
+
 	/**
 	 * Returns the API version that was selected by the {@link #selectAPIVersion(int) selectAPIVersion()}
 	 *  call. This can be used to guard different parts of client code against different versions
@@ -20,6 +20,7 @@
 
 package com.apple.foundationdb;
 
+import java.nio.ByteBuffer;
 import java.util.concurrent.Executor;
 
 class FutureResults extends NativeFuture<RangeResultInfo> {
@@ -57,6 +58,9 @@ class FutureResults extends NativeFuture<RangeResultInfo> {
 	public RangeResult getResults() {
 		try {
 			pointerReadLock.lock();
+			if(FDB.instance().enableDirectBufferQueries) {
+				return new RangeResult(FutureResults_getDirect(getPtr()));
+			}
 			return FutureResults_get(getPtr());
 		}
 		finally {
@@ -66,4 +70,5 @@ class FutureResults extends NativeFuture<RangeResultInfo> {
 
 	private native RangeResultSummary FutureResults_getSummary(long ptr) throws FDBException;
 	private native RangeResult FutureResults_get(long cPtr) throws FDBException;
+	private native ByteBuffer FutureResults_getDirect(long cPtr) throws FDBException;
 }
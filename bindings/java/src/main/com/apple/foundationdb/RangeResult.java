@@ -20,6 +20,9 @@
 
 package com.apple.foundationdb;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.AbstractList;
 import java.util.ArrayList;
 import java.util.List;
 
@@ -51,4 +54,47 @@ class RangeResult {
 		}
 		this.more = more;
 	}
+
+	RangeResult(ByteBuffer buffer) {
+		buffer.order(ByteOrder.nativeOrder());
+		values = new DirectBufferValues(buffer, buffer.getInt(0));
+		more = buffer.getInt(Integer.BYTES) != 0;
+	}
+
+	// A read-only view of the key-value pairs in a buffer filled by FutureResults_getDirect(), which holds
+	//  the count and more flag, then the offset and lengths of each pair, then the keys and values themselves.
+	//  The key and value of a pair are only copied out of the buffer when that pair is read.
+	private static class DirectBufferValues extends AbstractList<KeyValue> {
+		private final ByteBuffer buffer;
+		private final int count;
+
+		DirectBufferValues(ByteBuffer buffer, int count) {
+			this.buffer = buffer;
+			this.count = count;
+		}
+
+		@Override
+		public int size() {
+			return count;
+		}
+
+		@Override
+		public KeyValue get(int index) {
+			if(index < 0 || index >= count) {
+				throw new IndexOutOfBoundsException("Index: " + index + ", Size: " + count);
+			}
+
+			int position = (2 + index * 3) * Integer.BYTES;
+			int offset = buffer.getInt(position);
+			byte[] k = new byte[buffer.getInt(position + Integer.BYTES)];
+			byte[] v = new byte[buffer.getInt(position + 2 * Integer.BYTES)];
+
+			synchronized(buffer) {
+				buffer.position(offset);
+				buffer.get(k);
+				buffer.get(v);
+			}
+			return new KeyValue(k, v);
+		}
+	}
 }
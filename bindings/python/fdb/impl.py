@@ -361,6 +361,7 @@ class FDBRange(object):
 
         iteration = 1  # the first read was fired off when the FDBRange was initialized
         future = self._future
+        next_future = None
 
         done = False
 
@@ -373,13 +374,8 @@ class FDBRange(object):
                 if not count:
                     return
 
-            result = kvs[index]
-            index += 1
-
-            if index == count:
-                if not more or limit == count:
-                    done = True
-                else:
+                # Start reading the next batch while this one is being consumed
+                if more and limit != count:
                     iteration += 1
                     if limit > 0:
                         limit = limit - count
@@ -387,7 +383,18 @@ class FDBRange(object):
                         esel = KeySelector.first_greater_or_equal(kvs[-1].key)
                     else:
                         bsel = KeySelector.first_greater_than(kvs[-1].key)
-                    future = self._tr._get_range(bsel, esel, limit, mode, iteration, self._reverse)
+                    next_future = self._tr._get_range(bsel, esel, limit, mode, iteration, self._reverse)
+                else:
+                    next_future = None
+
+            result = kvs[index]
+            index += 1
+
+            if index == count:
+                if next_future is None:
+                    done = True
+                else:
+                    future = next_future
 
             yield result
 
@@ -543,6 +550,16 @@ class Transaction(TransactionRead):
     def get_versionstamp(self):
         return Key(self.capi.fdb_transaction_get_versionstamp(self.tpointer))
 
+    def get_estimated_range_size_bytes(self, begin_key, end_key):
+        begin_key = keyToBytes(begin_key)
+        end_key = keyToBytes(end_key)
+        return FutureInt64(self.capi.fdb_transaction_get_estimated_range_size_bytes(self.tpointer, begin_key, len(begin_key), end_key, len(end_key)))
+
+    def get_range_split_points(self, begin_key, end_key, chunk_size):
+        begin_key = keyToBytes(begin_key)
+        end_key = keyToBytes(end_key)
+        return FutureKeyArray(self.capi.fdb_transaction_get_range_split_points(self.tpointer, begin_key, len(begin_key), end_key, len(end_key), chunk_size))
+
     def on_error(self, error):
         if isinstance(error, FDBError):
             code = error.code
@@ -679,6 +696,23 @@ class FutureVersion(Future):
         return version.value
 
 
+class FutureInt64(Future):
+    def wait(self):
+        self.block_until_ready()
+        value = ctypes.c_int64()
+        self.capi.fdb_future_get_int64(self.fpointer, ctypes.byref(value))
+        return value.value
+
+
+class FutureKeyArray(Future):
+    def wait(self):
+        self.block_until_ready()
+        keys = ctypes.pointer(KeyStruct())
+        count = ctypes.c_int()
+        self.capi.fdb_future_get_key_array(self.fpointer, ctypes.byref(keys), ctypes.byref(count))
+        return [ctypes.string_at(x.key, x.key_length) for x in keys[0:count.value]]
+
+
 class FutureKeyValueArray(Future):
     def wait(self):
         self.block_until_ready()
@@ -1184,6 +1218,12 @@ class KeyValueStruct(ctypes.Structure):
     _pack_ = 4
 
 
+class KeyStruct(ctypes.Structure):
+    _fields_ = [('key', ctypes.POINTER(ctypes.c_byte)),
+                ('key_length', ctypes.c_int)]
+    _pack_ = 4
+
+
 class KeyValue(object):
     def __init__(self, key, value):
         self.key = key
@@ -1360,6 +1400,14 @@ _capi.fdb_future_get_key.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.POIN
 _capi.fdb_future_get_key.restype = ctypes.c_int
 _capi.fdb_future_get_key.errcheck = check_error_code
 
+_capi.fdb_future_get_int64.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_int64)]
+_capi.fdb_future_get_int64.restype = ctypes.c_int
+_capi.fdb_future_get_int64.errcheck = check_error_code
+
+_capi.fdb_future_get_key_array.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.POINTER(KeyStruct)), ctypes.POINTER(ctypes.c_int)]
+_capi.fdb_future_get_key_array.restype = int
+_capi.fdb_future_get_key_array.errcheck = check_error_code
+
 _capi.fdb_future_get_cluster.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_void_p)]
 _capi.fdb_future_get_cluster.restype = ctypes.c_int
 _capi.fdb_future_get_cluster.errcheck = check_error_code
@@ -1436,6 +1484,12 @@ _capi.fdb_transaction_add_conflict_range.errcheck = check_error_code
 _capi.fdb_transaction_get_addresses_for_key.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int]
 _capi.fdb_transaction_get_addresses_for_key.restype = ctypes.c_void_p
 
+_capi.fdb_transaction_get_estimated_range_size_bytes.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_int]
+_capi.fdb_transaction_get_estimated_range_size_bytes.restype = ctypes.c_void_p
+
+_capi.fdb_transaction_get_range_split_points.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_int, ctypes.c_int64]
+_capi.fdb_transaction_get_range_split_points.restype = ctypes.c_void_p
+
 _capi.fdb_transaction_set_option.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_int]
 _capi.fdb_transaction_set_option.restype = ctypes.c_int
 _capi.fdb_transaction_set_option.errcheck = check_error_code
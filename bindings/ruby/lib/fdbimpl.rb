@@ -784,6 +784,7 @@ module FDB
 
         iteration = 1 # the first read was fired off when the RangeEnum was initialized
         future = @future
+        next_future = nil
 
         done = false
 
@@ -794,15 +795,9 @@ module FDB
             future = nil
 
             return if count.zero?
-          end
 
-          result = kvs[index]
-          index += 1
-
-          if index == count
-            if more.zero? || limit == count
-              done = true
-            else
+            # Start reading the next batch while this one is being consumed
+            if more.nonzero? && limit != count
               iteration += 1
               if limit.nonzero?
                 limit -= count
@@ -812,7 +807,20 @@ module FDB
               else
                 bsel = KeySelector.first_greater_than(kvs.last.key)
               end
-              future = @get_range.call(bsel, esel, limit, @mode, iteration, @reverse)
+              next_future = @get_range.call(bsel, esel, limit, @mode, iteration, @reverse)
+            else
+              next_future = nil
+            end
+          end
+
+          result = kvs[index]
+          index += 1
+
+          if index == count
+            if next_future.nil?
+              done = true
+            else
+              future = next_future
             end
           end
 
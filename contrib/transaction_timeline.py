@@ -0,0 +1,166 @@
+#!/usr/bin/env python
+#
+# transaction_timeline.py
+#
+# This source file is part of the FoundationDB open source project
+#
+# Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Turns the TransactionDebug, CommitDebug and GetValueDebug events of traced transactions (those with debugTransaction()
+# called on them, or sampled at CLIENT_KNOBS->TRANSACTION_TRACE_SAMPLE_RATE) into OpenTelemetry spans.
+#
+# The debug ID of a transaction is passed along with its requests to the proxies, resolvers, logs and storage servers, and
+# each *AttachID event records that one ID (a commit batch on a proxy, say) was started on behalf of another.  Each ID
+# becomes a span, a child of the ID it was attached to, with one span event for each location it passed through and one
+# child span for the time between each pair of consecutive locations.  A commit batch shared by several transactions appears
+# in the trace of each of them.
+#
+# Give it the trace files of every process involved; the output is an OTLP/JSON ExportTraceServiceRequest, which can be
+# posted to an OpenTelemetry collector's /v1/traces endpoint.
+#
+#   transaction_timeline.py [--min-duration SECONDS] [--output FILE] trace.*.xml
+
+import argparse
+import collections
+import hashlib
+import json
+import re
+import sys
+
+ATTRIBUTE = re.compile(r'(\w+)="([^"]*)"')
+DEBUG_TYPES = ('TransactionDebug', 'CommitDebug', 'GetValueDebug', 'GetValuePrefixDebug', 'WatchValueDebug')
+
+Event = collections.namedtuple('Event', ['time', 'type', 'machine', 'location'])
+
+
+def read_events(files):
+    events = collections.defaultdict(list)  # id -> [Event]
+    parents = collections.defaultdict(set)  # id -> ids it was attached to
+    for name in files:
+        with open(name) as f:
+            for line in f:
+                if 'Debug"' not in line and 'AttachID"' not in line:
+                    continue
+                attrs = dict(ATTRIBUTE.findall(line))
+                type = attrs.get('Type', '')
+                if type.endswith('AttachID') and 'To' in attrs:
+                    parents[attrs['To']].add(attrs['ID'])
+                elif type in DEBUG_TYPES and 'Location' in attrs:
+                    events[attrs['ID']].append(Event(float(attrs['Time']), type, attrs.get('Machine', ''), attrs['Location']))
+    for e in events.values():
+        e.sort()
+    return events, parents
+
+
+def span_id(*parts):
+    return hashlib.sha1('/'.join(parts).encode()).hexdigest()[:16]
+
+
+def nanos(t):
+    return str(int(t * 1e9))
+
+
+def string_attribute(key, value):
+    return {'key': key, 'value': {'stringValue': value}}
+
+
+def build_traces(events, parents):
+    children = collections.defaultdict(set)
+    for id, ps in parents.items():
+        for p in ps:
+            children[p].add(id)
+    roots = [id for id in set(events) | set(children) if not parents.get(id)]
+
+    traces = []
+    for root in roots:
+        trace_id = (root + root)[:32].rjust(32, '0')
+        spans = []
+
+        # Returns the (start, end) of the span for id, which covers those of its children
+        def add_span(id, parent_span, depth):
+            own = events.get(id, [])
+            sid = span_id(root, id)
+            start = min([e.time for e in own] or [float('inf')])
+            end = max([e.time for e in own] or [float('-inf')])
+            if depth < 64:
+                for child in sorted(children.get(id, ())):
+                    s, e = add_span(child, sid, depth + 1)
+                    start, end = min(start, s), max(end, e)
+            if start == float('inf'):
+                return start, end
+
+            span = {
+                'traceId': trace_id,
+                'spanId': sid,
+                'name': own[0].type if own else 'Transaction',
+                'kind': 1,
+                'startTimeUnixNano': nanos(start),
+                'endTimeUnixNano': nanos(end),
+                'attributes': [string_attribute('fdb.debug_id', id)],
+                'events': [{'timeUnixNano': nanos(e.time), 'name': e.location,
+                            'attributes': [string_attribute('fdb.machine', e.machine)]} for e in own],
+            }
+            if own:
+                span['attributes'].append(string_attribute('fdb.machine', own[0].machine))
+            if parent_span:
+                span['parentSpanId'] = parent_span
+            spans.append(span)
+
+            # Where the time went between one location and the next
+            for i in range(1, len(own)):
+                a, b = own[i - 1], own[i]
+                spans.append({
+                    'traceId': trace_id,
+                    'spanId': span_id(root, id, str(i)),
+                    'parentSpanId': sid,
+                    'name': '%s -> %s' % (a.location, b.location),
+                    'kind': 1,
+                    'startTimeUnixNano': nanos(a.time),
+                    'endTimeUnixNano': nanos(b.time),
+                    'attributes': [string_attribute('fdb.machine', b.machine)],
+                })
+            return start, end
+
+        start, end = add_span(root, None, 0)
+        if spans:
+            traces.append((end - start, spans))
+    return traces
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Export the timelines of traced transactions as OpenTelemetry spans')
+    parser.add_argument('files', nargs='+', help='trace files (XML) from every process involved')
+    parser.add_argument('--min-duration', type=float, default=0.0, help='only export transactions that took at least this many seconds')
+    parser.add_argument('--output', help='where to write the OTLP/JSON (default: standard output)')
+    args = parser.parse_args()
+
+    events, parents = read_events(args.files)
+    spans = []
+    for duration, trace_spans in sorted(build_traces(events, parents), key=lambda t: -t[0]):
+        if duration >= args.min_duration:
+            spans.extend(trace_spans)
+
+    request = {'resourceSpans': [{
+        'resource': {'attributes': [string_attribute('service.name', 'foundationdb')]},
+        'scopeSpans': [{'scope': {'name': 'fdb.trace_batch'}, 'spans': spans}],
+    }]}
+    out = open(args.output, 'w') if args.output else sys.stdout
+    json.dump(request, out, indent=1)
+    out.write('\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -76,7 +76,7 @@ enum enumProgramExe {
 };
 
 enum enumBackupType {
-	BACKUP_UNDEFINED=0, BACKUP_START, BACKUP_STATUS, BACKUP_ABORT, BACKUP_WAIT, BACKUP_DISCONTINUE, BACKUP_PAUSE, BACKUP_RESUME, BACKUP_EXPIRE, BACKUP_DELETE, BACKUP_DESCRIBE, BACKUP_LIST
+	BACKUP_UNDEFINED=0, BACKUP_START, BACKUP_STATUS, BACKUP_ABORT, BACKUP_WAIT, BACKUP_DISCONTINUE, BACKUP_PAUSE, BACKUP_RESUME, BACKUP_EXPIRE, BACKUP_DELETE, BACKUP_DESCRIBE, BACKUP_LIST, BACKUP_EXPORT
 };
 
 enum enumDBType {
@@ -394,6 +394,35 @@ CSimpleOpt::SOption g_rgBackupDescribeOptions[] = {
 	SO_END_OF_OPTIONS
 };
 
+CSimpleOpt::SOption g_rgBackupExportOptions[] = {
+#ifdef _WIN32
+	{ OPT_PARENTPID,      "--parentpid",       SO_REQ_SEP },
+#endif
+	{ OPT_CLUSTERFILE,     "-C",               SO_REQ_SEP },
+	{ OPT_CLUSTERFILE,     "--cluster_file",   SO_REQ_SEP },
+	{ OPT_DESTCONTAINER,   "-d",               SO_REQ_SEP },
+	{ OPT_DESTCONTAINER,   "--destcontainer",  SO_REQ_SEP },
+	{ OPT_BACKUPKEYS,      "-k",               SO_REQ_SEP },
+	{ OPT_BACKUPKEYS,      "--keys",           SO_REQ_SEP },
+	{ OPT_TRACE,           "--log",            SO_NONE },
+	{ OPT_TRACE_DIR,       "--logdir",         SO_REQ_SEP },
+	{ OPT_QUIET,           "-q",               SO_NONE },
+	{ OPT_QUIET,           "--quiet",          SO_NONE },
+	{ OPT_VERSION,         "-v",               SO_NONE },
+	{ OPT_VERSION,         "--version",        SO_NONE },
+	{ OPT_CRASHONERROR,    "--crash",          SO_NONE },
+	{ OPT_MEMLIMIT,        "-m",               SO_REQ_SEP },
+	{ OPT_MEMLIMIT,        "--memory",         SO_REQ_SEP },
+	{ OPT_HELP,            "-?",               SO_NONE },
+	{ OPT_HELP,            "-h",               SO_NONE },
+	{ OPT_HELP,            "--help",           SO_NONE },
+	{ OPT_DEVHELP,         "--dev-help",       SO_NONE },
+	{ OPT_BLOB_CREDENTIALS, "--blob_credentials", SO_REQ_SEP },
+	{ OPT_KNOB,            "--knob_",          SO_REQ_SEP },
+
+	SO_END_OF_OPTIONS
+};
+
 CSimpleOpt::SOption g_rgBackupListOptions[] = {
 #ifdef _WIN32
 	{ OPT_PARENTPID,      "--parentpid",       SO_REQ_SEP },
@@ -707,13 +736,13 @@ void printBackupContainerInfo() {
 
 static void printBackupUsage(bool devhelp) {
 	printf("FoundationDB " FDB_VT_PACKAGE_NAME " (v" FDB_VT_VERSION ")\n");
-	printf("Usage: %s (start | status | abort | wait | discontinue | pause | resume | expire | delete | describe | list) [OPTIONS]\n\n", exeBackup.toString().c_str());
+	printf("Usage: %s (start | status | abort | wait | discontinue | pause | resume | expire | delete | describe | list | export) [OPTIONS]\n\n", exeBackup.toString().c_str());
 	printf("  -C CONNFILE    The path of a file containing the connection string for the\n"
 		   "                 FoundationDB cluster. The default is first the value of the\n"
 		   "                 FDB_CLUSTER_FILE environment variable, then `./fdb.cluster',\n"
 		   "                 then `%s'.\n", platform::getDefaultClusterFilePath().c_str());
 	printf("  -d, --destcontainer URL\n"
-	       "                 The Backup container URL for start, describe, expire, and delete operations.\n");
+	       "                 The Backup container URL for start, describe, expire, delete, and export operations.\n");
 	printBackupContainerInfo();
 	printf("  -b, --base_url BASEURL\n"
 		   "                 Base backup URL for list operations.  This looks like a Backup URL but without a backup name.\n");
@@ -734,8 +763,8 @@ static void printBackupUsage(bool devhelp) {
 	printf("  -s, --snapshot_interval DURATION\n"
 	       "                 For start operations, specifies the backup's target snapshot interval as DURATION seconds.  Defaults to %d.\n", CLIENT_KNOBS->BACKUP_DEFAULT_SNAPSHOT_INTERVAL_SEC);
 	printf("  -e ERRORLIMIT  The maximum number of errors printed by status (default is 10).\n");
-	printf("  -k KEYS        List of key ranges to backup.\n"
-		   "                 If not specified, the entire database will be backed up.\n");
+	printf("  -k KEYS        List of key ranges to backup or export.\n"
+		   "                 If not specified, the entire database will be backed up or exported.\n");
 	printf("  -n, --dry-run  For start or restore operations, performs a trial run with no actual changes made.\n");
 	printf("  -v, --version  Print version information and exit.\n");
 	printf("  -w, --wait     Wait for the backup to complete (allowed with `start' and `discontinue').\n");
@@ -969,6 +998,7 @@ enumBackupType	getBackupType(std::string backupType)
 		values["delete"] = BACKUP_DELETE;
 		values["describe"] = BACKUP_DESCRIBE;
 		values["list"] = BACKUP_LIST;
+		values["export"] = BACKUP_EXPORT;
 	}
 
 	auto i = values.find(backupType);
@@ -1050,8 +1080,10 @@ ACTOR Future<std::string> getLayerStatus(Reference<ReadYourWritesTransaction> tr
 		blobstats.create("total") = current_stats.getJSON();
 		BlobStoreEndpoint::Stats diff = current_stats - last_stats;
 		json_spirit::mObject diffObj = diff.getJSON();
-		if(last_ts > 0)
+		if(last_ts > 0) {
 			diffObj["bytes_per_second"] = double(current_stats.bytes_sent - last_stats.bytes_sent) / (now() - last_ts);
+			diffObj["read_bytes_per_second"] = double(current_stats.bytes_read - last_stats.bytes_read) / (now() - last_ts);
+		}
 		blobstats.create("recent") = diffObj;
 		last_stats = current_stats;
 		last_ts = now();
@@ -1060,6 +1092,21 @@ ACTOR Future<std::string> getLayerStatus(Reference<ReadYourWritesTransaction> tr
 		for(auto &p : diffObj)
 			totalBlobStats.create(p.first + ".$sum") = p.second;
 
+		static FileBackupAgent::RangeStats last_range_stats;
+		static double last_range_ts = 0;
+		FileBackupAgent::RangeStats range_stats = FileBackupAgent::s_rangeStats;
+		JSONDoc snapshotStats = o.create("snapshot_stats");
+		snapshotStats.create("range_tasks_split") = range_stats.tasks_split;
+		snapshotStats.create("range_files_written") = range_stats.files_written;
+		snapshotStats.create("range_keys_written") = range_stats.keys_written;
+		snapshotStats.create("range_bytes_written") = range_stats.bytes_written;
+		snapshotStats.create("range_files_reused") = range_stats.files_reused;
+		snapshotStats.create("range_bytes_reused") = range_stats.bytes_reused;
+		if(last_range_ts > 0)
+			snapshotStats.create("range_bytes_per_second") = double(range_stats.bytes_written - last_range_stats.bytes_written) / (now() - last_range_ts);
+		last_range_stats = range_stats;
+		last_range_ts = now();
+
 		state FileBackupAgent fba;
 		state std::vector<KeyBackedTag> backupTags = wait(getAllBackupTags(tr));
 		state std::vector<Future<Version>> tagLastRestorableVersions;
@@ -1904,6 +1951,28 @@ ACTOR Future<Void> describeBackup(const char *name, std::string destinationConta
 	return Void();
 }
 
+ACTOR Future<Void> exportSnapshot(Database db, std::string url, Standalone<VectorRef<KeyRangeRef>> ranges) {
+	try {
+		state FileBackupAgent backupAgent;
+
+		// Export everything, if no ranges were specified
+		if (ranges.size() == 0) {
+			ranges.push_back_deep(ranges.arena(), normalKeys);
+		}
+
+		Version version = wait(backupAgent.exportSnapshot(db, KeyRef(url), ranges));
+		printf("Exported a snapshot at version %lld to `%s'.\n", (long long)version, url.c_str());
+	}
+	catch (Error& e) {
+		if(e.code() == error_code_actor_cancelled)
+			throw;
+		fprintf(stderr, "ERROR: %s\n", e.what());
+		throw;
+	}
+
+	return Void();
+}
+
 ACTOR Future<Void> listBackup(std::string baseUrl) {
 	try {
 		std::vector<std::string> containers = wait(IBackupContainer::listContainers(baseUrl));
@@ -2153,6 +2222,9 @@ int main(int argc, char* argv[]) {
 				case BACKUP_LIST:
 					args = new CSimpleOpt(argc - 1, &argv[1], g_rgBackupListOptions, SO_O_EXACT);
 					break;
+				case BACKUP_EXPORT:
+					args = new CSimpleOpt(argc - 1, &argv[1], g_rgBackupExportOptions, SO_O_EXACT);
+					break;
 				case BACKUP_UNDEFINED:
 				default:
 					// Display help, if requested
@@ -2856,6 +2928,13 @@ int main(int argc, char* argv[]) {
 				f = stopAfter( listBackup(baseUrl) );
 				break;
 
+			case BACKUP_EXPORT:
+				if(!initCluster())
+					return FDB_EXIT_ERROR;
+				openBackupContainer(argv[0], destinationContainer);
+				f = stopAfter( exportSnapshot(db, destinationContainer, backupKeys) );
+				break;
+
 			case BACKUP_UNDEFINED:
 			default:
 				fprintf(stderr, "ERROR: Unsupported backup action %s\n", argv[1]);
@@ -438,17 +438,17 @@ void initHelp() {
 		"clear a range of keys from the database",
 		"All keys between BEGINKEY (inclusive) and ENDKEY (exclusive) are cleared from the database. This command will succeed even if the specified range is empty, but may fail because of conflicts." ESCAPINGK);
 	helpMap["configure"] = CommandHelp(
-		"configure [new] <single|double|triple|three_data_hall|three_datacenter|ssd|memory|proxies=<PROXIES>|logs=<LOGS>|resolvers=<RESOLVERS>>*",
+		"configure [new] <single|double|triple|three_data_hall|three_datacenter|ssd|memory|lsm|proxies=<PROXIES>|logs=<LOGS>|resolvers=<RESOLVERS>>*",
 		"change database configuration",
-		"The `new' option, if present, initializes a new database with the given configuration rather than changing the configuration of an existing one. When used, both a redundancy mode and a storage engine must be specified.\n\nRedundancy mode:\n  single - one copy of the data.  Not fault tolerant.\n  double - two copies of data (survive one failure).\n  triple - three copies of data (survive two failures).\n  three_data_hall - See the Admin Guide.\n  three_datacenter - See the Admin Guide.\n\nStorage engine:\n  ssd - B-Tree storage engine optimized for solid state disks.\n  memory - Durable in-memory storage engine for small datasets.\n\nproxies=<PROXIES>: Sets the desired number of proxies in the cluster. Must be at least 1, or set to -1 which restores the number of proxies to the default value.\n\nlogs=<LOGS>: Sets the desired number of log servers in the cluster. Must be at least 1, or set to -1 which restores the number of logs to the default value.\n\nresolvers=<RESOLVERS>: Sets the desired number of resolvers in the cluster. Must be at least 1, or set to -1 which restores the number of resolvers to the default value.\n\nSee the FoundationDB Administration Guide for more information.");
+		"The `new' option, if present, initializes a new database with the given configuration rather than changing the configuration of an existing one. When used, both a redundancy mode and a storage engine must be specified.\n\nRedundancy mode:\n  single - one copy of the data.  Not fault tolerant.\n  double - two copies of data (survive one failure).\n  triple - three copies of data (survive two failures).\n  three_data_hall - See the Admin Guide.\n  three_datacenter - See the Admin Guide.\n\nStorage engine:\n  ssd - B-Tree storage engine optimized for solid state disks.\n  memory - Durable in-memory storage engine for small datasets.\n  lsm - Log-structured merge tree storage engine for write heavy workloads.\n\nproxies=<PROXIES>: Sets the desired number of proxies in the cluster. Must be at least 1, or set to -1 which restores the number of proxies to the default value.\n\nlogs=<LOGS>: Sets the desired number of log servers in the cluster. Must be at least 1, or set to -1 which restores the number of logs to the default value.\n\nresolvers=<RESOLVERS>: Sets the desired number of resolvers in the cluster. Must be at least 1, or set to -1 which restores the number of resolvers to the default value.\n\nSee the FoundationDB Administration Guide for more information.");
 	helpMap["coordinators"] = CommandHelp(
 		"coordinators auto|<ADDRESS>+ [description=new_cluster_description]",
 		"change cluster coordinators or description",
 		"If 'auto' is specified, coordinator addresses will be choosen automatically to support the configured redundancy level. (If the current set of coordinators are healthy and already support the redundancy level, nothing will be changed.)\n\nOtherwise, sets the coordinators to the list of IP:port pairs specified by <ADDRESS>+. An fdbserver process must be running on each of the specified addresses.\n\ne.g. coordinators 10.0.0.1:4000 10.0.0.2:4000 10.0.0.3:4000\n\nIf 'description=desc' is specified then the description field in the cluster\nfile is changed to desc, which must match [A-Za-z0-9_]+.");
 	helpMap["exclude"] = CommandHelp(
-		"exclude <ADDRESS>*",
+		"exclude [DRAIN] <ADDRESS>*",
 		"exclude servers from the database",
-		"If no addresses are specified, lists the set of excluded servers.\n\nFor each IP address or IP:port pair in <ADDRESS>*, adds the address to the set of excluded servers then waits until all database state has been safely moved away from the specified servers.");
+		"If no addresses are specified, lists the set of excluded servers.\n\nFor each IP address or IP:port pair in <ADDRESS>*, adds the address to the set of excluded servers then waits until all database state has been safely moved away from the specified servers.\n\nIf `DRAIN' is specified, data is moved off the servers ahead of rebalancing and with more parallelism, and `status' reports the bytes left to move and an estimated time to completion.");
 	helpMap["include"] = CommandHelp(
 		"include all|<ADDRESS>*",
 		"permit previously-excluded servers to rejoin the database",
@@ -461,6 +461,10 @@ void initHelp() {
 		"status [minimal] [details] [json]",
 		"get the status of a FoundationDB cluster",
 		"If the cluster is down, this command will print a diagnostic which may be useful in figuring out what is wrong. If the cluster is running, this command will print cluster statistics.\n\nSpecifying 'minimal' will provide a minimal description of the status of your database.\n\nSpecifying 'details' will provide load information for individual workers.\n\nSpecifying 'json' will provide status information in a machine readable JSON format.");
+	helpMap["hotkeys"] = CommandHelp(
+		"hotkeys",
+		"show the keys receiving the most reads, writes and conflicts",
+		"Prints the estimated rates of the most read and most written keys, as sampled by the storage servers, and of the begin keys of the read conflict ranges that most often made transactions fail to commit, as sampled by the resolvers. The begin key of a range read or conflict range stands for the whole range. Rates decay over time, so they reflect the last several seconds.");
 	helpMap["exit"] = CommandHelp("exit", "exit the CLI", "");
 	helpMap["quit"] = CommandHelp();
 	helpMap["waitconnected"] = CommandHelp();
@@ -653,6 +657,30 @@ std::string logBackupDR(const char *context, std::map<std::string, std::string>
 	return outputString;
 }
 
+void printHotKeys(StatusObjectReader statusObj) {
+	StatusObjectReader hotKeys;
+	if (!statusObj.get("cluster.hot_keys", hotKeys)) {
+		printf("Unable to retrieve hot keys from the cluster.\n");
+		return;
+	}
+
+	const char* sections[][2] = { {"reads", "Most read keys"}, {"writes", "Most written keys"}, {"conflicts", "Keys most often conflicting"} };
+	for (auto& section : sections) {
+		printf("%s:\n", section[1]);
+		if (!hotKeys.has(section[0]) || !hotKeys.last().get_array().size()) {
+			printf("  (none)\n");
+			continue;
+		}
+		for (StatusObjectReader k : hotKeys.last().get_array()) {
+			std::string key;
+			double hz = 0;
+			k.get("key", key);
+			k.get("hz", hz);
+			printf("  %10.1f Hz  %s\n", hz, key.c_str());
+		}
+	}
+}
+
 void printStatus(StatusObjectReader statusObj, StatusClient::StatusLevel level, bool displayDatabaseAvailable = true, bool hideErrorMessages = false) {
 	if (FlowTransport::transport().incompatibleOutgoingConnectionsPresent()) {
 		printf("WARNING: One or more of the processes in the cluster is incompatible with this version of fdbcli.\n\n");
@@ -1047,6 +1075,18 @@ void printStatus(StatusObjectReader statusObj, StatusClient::StatusLevel level,
 					outputString += "\n  Moving data            - unknown";
 				}
 
+				if (statusObjData.has("exclusion_drain")) {
+					StatusObjectReader exclusionDrain = statusObjData.last();
+					int drainingServers;
+					double remainingBytes, secondsRemaining;
+					if (exclusionDrain.get("servers", drainingServers) && exclusionDrain.get("remaining_bytes", remainingBytes)) {
+						outputString += format("\n  Draining servers       - %d (%.3f GB left", drainingServers, remainingBytes / 1e9);
+						if (exclusionDrain.get("estimated_seconds_remaining", secondsRemaining))
+							outputString += format(", about %.0f minutes", std::ceil(secondsRemaining / 60));
+						outputString += ")";
+					}
+				}
+
 				outputString += "\n  Sum of key-value sizes - ";
 
 				if (statusObjData.has("total_kv_size_bytes")){
@@ -1713,10 +1753,13 @@ ACTOR Future<bool> exclude( Database db, std::vector<StringRef> tokens, Referenc
 	} else {
 		state std::vector<AddressExclusion> addresses;
 		state std::set<AddressExclusion> exclusions;
+		state bool drain = false;
 		bool force = false;
 		for(auto t = tokens.begin()+1; t != tokens.end(); ++t) {
 			if(*t == LiteralStringRef("FORCE")) {
 				force = true;
+			} else if(*t == LiteralStringRef("DRAIN")) {
+				drain = true;
 			} else {
 				auto a = AddressExclusion::parse( *t );
 				if (!a.isValid()) {
@@ -1816,7 +1859,7 @@ ACTOR Future<bool> exclude( Database db, std::vector<StringRef> tokens, Referenc
 			}
 		}
 
-		Void _ = wait( makeInterruptable(excludeServers(db,addresses)) );
+		Void _ = wait( makeInterruptable(excludeServers(db,addresses,drain)) );
 
 		printf("Waiting for state to be removed from all excluded servers. This may take a while.\n");
 		printf("(Interrupting this wait with CTRL+C will not cancel the data movement.)\n");
@@ -1871,6 +1914,49 @@ ACTOR Future<bool> exclude( Database db, std::vector<StringRef> tokens, Referenc
 	return false;
 }
 
+// Sends profileRequest to each of the processes named by tokens[firstHost..], or to every process if that is just `all'
+ACTOR Future<bool> sendProfilerRequests( Reference<ReadYourWritesTransaction> tr, ProfilerRequest profileRequest, std::vector<StringRef> tokens, int firstHost ) {
+	Standalone<RangeResultRef> kvs = wait(makeInterruptable(
+	    tr->getRange(KeyRangeRef(LiteralStringRef("\xff\xff/worker_interfaces"),
+	                             LiteralStringRef("\xff\xff\xff")),
+	                 1)));
+	std::map<Key, ClientWorkerInterface> interfaces;
+	state std::vector<Key> all_profiler_addresses;
+	state std::vector<Future<ErrorOr<Void>>> all_profiler_responses;
+	for (const auto& pair : kvs) {
+		interfaces.emplace(pair.key, BinaryReader::fromStringRef<ClientWorkerInterface>(pair.value, IncludeVersion()));
+	}
+	if (tokens.size() == firstHost + 1 && tokencmp(tokens[firstHost], "all")) {
+		for (const auto& pair : interfaces) {
+			all_profiler_addresses.push_back(pair.first);
+			all_profiler_responses.push_back(pair.second.profiler.tryGetReply(profileRequest));
+		}
+	} else {
+		bool is_error = false;
+		for (int tokenidx = firstHost; tokenidx < tokens.size(); tokenidx++) {
+			auto element = interfaces.find(tokens[tokenidx]);
+			if (element == interfaces.end()) {
+				printf("ERROR: process '%s' not recognized.\n", printable(tokens[tokenidx]).c_str());
+				is_error = true;
+			}
+		}
+		if (is_error)
+			return true;
+		for (int tokenidx = firstHost; tokenidx < tokens.size(); tokenidx++) {
+			all_profiler_addresses.push_back(tokens[tokenidx]);
+			all_profiler_responses.push_back(interfaces[tokens[tokenidx]].profiler.tryGetReply(profileRequest));
+		}
+	}
+	Void _ = wait(waitForAll(all_profiler_responses));
+	for (int i = 0; i < all_profiler_responses.size(); i++) {
+		const ErrorOr<Void>& err = all_profiler_responses[i].get();
+		if (err.isError()) {
+			printf("ERROR: %s: %s: %s\n", printable(all_profiler_addresses[i]).c_str(), err.getError().name(), err.getError().what());
+		}
+	}
+	return false;
+}
+
 ACTOR Future<bool> setClass( Database db, std::vector<StringRef> tokens ) {
 	if( tokens.size() == 1 ) {
 		vector<ProcessData> _workers = wait( makeInterruptable(getWorkers(db)) );
@@ -1984,7 +2070,7 @@ void onoff_generator(const char* text, const char *line, std::vector<std::string
 }
 
 void configure_generator(const char* text, const char *line, std::vector<std::string>& lc) {
-	const char* opts[] = {"new", "single", "double", "triple", "three_data_hall", "three_datacenter", "ssd", "ssd-1", "ssd-2", "memory", "proxies=", "logs=", "resolvers=", NULL};
+	const char* opts[] = {"new", "single", "double", "triple", "three_data_hall", "three_datacenter", "ssd", "ssd-1", "ssd-2", "memory", "lsm", "proxies=", "logs=", "resolvers=", NULL};
 	array_generator(text, line, opts, lc);
 }
 
@@ -2435,6 +2521,18 @@ ACTOR Future<int> cli(CLIOptions opt, LineNoise* plinenoise) {
 					continue;
 				}
 
+				if (tokencmp(tokens[0], "hotkeys")) {
+					if (tokens.size() != 1) {
+						printUsage(tokens[0]);
+						is_error = true;
+						continue;
+					}
+
+					StatusObject s = wait( makeInterruptable( StatusClient::statusFetcher( ccf ) ) );
+					printHotKeys(s);
+					continue;
+				}
+
 				if (tokencmp(tokens[0], "configure")) {
 					bool err = wait( configure( db, tokens, ccf, &linenoise, warn ) );
 					if (err) is_error = true;
@@ -2619,7 +2717,7 @@ ACTOR Future<int> cli(CLIOptions opt, LineNoise* plinenoise) {
 
 				if (tokencmp(tokens[0], "profile")) {
 					if (tokens.size() == 1) {
-						printf("ERROR: Usage: profile <client|list|flow>\n");
+						printf("ERROR: Usage: profile <client|list|flow|heap>\n");
 						is_error = true;
 						continue;
 					}
@@ -2716,75 +2814,69 @@ ACTOR Future<int> cli(CLIOptions opt, LineNoise* plinenoise) {
 					}
 					if (tokencmp(tokens[1], "flow")) {
 						if (tokens.size() == 2) {
-							printf("ERROR: Usage: profile flow <run>\n");
+							printf("ERROR: Usage: profile flow <run|dump>\n");
 							is_error = true;
 							continue;
 						}
-						if (tokencmp(tokens[2], "run")) {
-							if (tokens.size() < 6) {
-								printf("ERROR: Usage: profile flow run <duration in seconds> <filename> <hosts>\n");
+						if (tokencmp(tokens[2], "run") || tokencmp(tokens[2], "dump")) {
+							// `dump' writes out the samples the continuous profiler already holds, so it takes no duration
+							bool dump = tokencmp(tokens[2], "dump");
+							int fileIdx = dump ? 3 : 4;
+							if (tokens.size() < fileIdx + 2) {
+								if (dump)
+									printf("ERROR: Usage: profile flow dump <filename> <hosts>\n");
+								else
+									printf("ERROR: Usage: profile flow run <duration in seconds> <filename> <hosts>\n");
 								is_error = true;
 								continue;
 							}
+							ProfilerRequest profileRequest;
+							profileRequest.type = ProfilerRequest::Type::FLOW;
+							profileRequest.action = dump ? ProfilerRequest::Action::DUMP : ProfilerRequest::Action::RUN;
+							profileRequest.duration = 0;
+							profileRequest.outputFile = tokens[fileIdx];
+							if (!dump) {
+								char *duration_end;
+								profileRequest.duration = std::strtol((const char*)tokens[3].begin(), &duration_end, 10);
+								if (!std::isspace(*duration_end)) {
+									printf("ERROR: Failed to parse %s as an integer.", printable(tokens[3]).c_str());
+									is_error = true;
+									continue;
+								}
+							}
 							getTransaction(db, tr, options, intrans);
-							Standalone<RangeResultRef> kvs = wait(makeInterruptable(
-							    tr->getRange(KeyRangeRef(LiteralStringRef("\xff\xff/worker_interfaces"),
-							                             LiteralStringRef("\xff\xff\xff")),
-							                 1)));
-							char *duration_end;
-							int duration = std::strtol((const char*)tokens[3].begin(), &duration_end, 10);
-							if (!std::isspace(*duration_end)) {
-								printf("ERROR: Failed to parse %s as an integer.", printable(tokens[3]).c_str());
+							bool err = wait(sendProfilerRequests(tr, profileRequest, tokens, fileIdx + 1));
+							if (err) is_error = true;
+							continue;
+						}
+					}
+					if (tokencmp(tokens[1], "heap")) {
+						if (tokens.size() == 2) {
+							printf("ERROR: Usage: profile heap <on|off|dump>\n");
+							is_error = true;
+							continue;
+						}
+						if (tokencmp(tokens[2], "on") || tokencmp(tokens[2], "off") || tokencmp(tokens[2], "dump")) {
+							// Sampling stays on until turned off, so that `dump' can attribute memory that grew over a long time
+							bool dump = tokencmp(tokens[2], "dump");
+							int firstHost = dump ? 4 : 3;
+							if (tokens.size() < firstHost + 1) {
+								if (dump)
+									printf("ERROR: Usage: profile heap dump <filename> <hosts>\n");
+								else
+									printf("ERROR: Usage: profile heap %s <hosts>\n", printable(tokens[2]).c_str());
 								is_error = true;
 								continue;
 							}
-							std::map<Key, ClientWorkerInterface> interfaces;
-							state std::vector<Key> all_profiler_addresses;
-							state std::vector<Future<ErrorOr<Void>>> all_profiler_responses;
-							for (const auto& pair : kvs) {
-								interfaces.emplace(pair.key, BinaryReader::fromStringRef<ClientWorkerInterface>(pair.value, IncludeVersion()));
-							}
-							if (tokens.size() == 6 && tokencmp(tokens[5], "all")) {
-								for (const auto& pair : interfaces) {
-									ProfilerRequest profileRequest;
-									profileRequest.type = ProfilerRequest::Type::FLOW;
-									profileRequest.action = ProfilerRequest::Action::RUN;
-									profileRequest.duration = duration;
-									profileRequest.outputFile = tokens[4];
-									all_profiler_addresses.push_back(pair.first);
-									all_profiler_responses.push_back(pair.second.profiler.tryGetReply(profileRequest));
-								}
-							} else {
-								for (int tokenidx = 5; tokenidx < tokens.size(); tokenidx++) {
-									auto element = interfaces.find(tokens[tokenidx]);
-									if (element == interfaces.end()) {
-										printf("ERROR: process '%s' not recognized.\n", printable(tokens[tokenidx]).c_str());
-										is_error = true;
-									}
-								}
-								if (!is_error) {
-									for (int tokenidx = 5; tokenidx < tokens.size(); tokenidx++) {
-										ProfilerRequest profileRequest;
-										profileRequest.type = ProfilerRequest::Type::FLOW;
-										profileRequest.action = ProfilerRequest::Action::RUN;
-										profileRequest.duration = duration;
-										profileRequest.outputFile = tokens[4];
-										all_profiler_addresses.push_back(tokens[tokenidx]);
-										all_profiler_responses.push_back(interfaces[tokens[tokenidx]].profiler.tryGetReply(profileRequest));
-									}
-								}
-							}
-							if (!is_error) {
-								Void _ = wait(waitForAll(all_profiler_responses));
-								for (int i = 0; i < all_profiler_responses.size(); i++) {
-									const ErrorOr<Void>& err = all_profiler_responses[i].get();
-									if (err.isError()) {
-										printf("ERROR: %s: %s: %s\n", printable(all_profiler_addresses[i]).c_str(), err.getError().name(), err.getError().what());
-									}
-								}
-							}
-							all_profiler_addresses.clear();
-							all_profiler_responses.clear();
+							ProfilerRequest profileRequest;
+							profileRequest.type = ProfilerRequest::Type::HEAP;
+							profileRequest.action = dump ? ProfilerRequest::Action::DUMP : tokencmp(tokens[2], "on") ? ProfilerRequest::Action::ENABLE : ProfilerRequest::Action::DISABLE;
+							profileRequest.duration = 0;
+							if (dump)
+								profileRequest.outputFile = tokens[3];
+							getTransaction(db, tr, options, intrans);
+							bool err = wait(sendProfilerRequests(tr, profileRequest, tokens, firstHost));
+							if (err) is_error = true;
 							continue;
 						}
 					}
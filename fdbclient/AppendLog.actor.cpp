@@ -0,0 +1,103 @@
+/*
+ * AppendLog.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flow/actorcompiler.h"
+#include "AppendLog.h"
+#include "ReadYourWrites.h"
+
+AppendLog::AppendLog( Key prefix, int shardCount ) : prefix(prefix), shardCount(shardCount) {
+	ASSERT( shardCount >= 1 && shardCount <= 256 );
+}
+
+KeyRange AppendLog::shardRange( int shard ) const {
+	uint8_t s = shard;
+	return prefixRange( StringRef(&s, 1).withPrefix(prefix) );
+}
+
+void AppendLog::append( Reference<ReadYourWritesTransaction> tr, VectorRef<ValueRef> values ) {
+	ASSERT( values.size() <= std::numeric_limits<uint16_t>::max() + 1 );
+
+	// prefix, shard, versionstamp, index, and the little endian offset of the versionstamp that SetVersionstampedKey expects
+	Key key = makeString( prefix.size() + 1 + PositionSize + 2 );
+	uint8_t* k = mutateString( key );
+	memcpy( k, prefix.begin(), prefix.size() );
+	k[prefix.size()] = g_random->randomInt( 0, shardCount );
+	memset( k + prefix.size() + 1, 0, VersionstampSize );
+	uint16_t offset = littleEndian16( uint16_t( prefix.size() + 1 ) );
+	memcpy( k + key.size() - 2, &offset, 2 );
+
+	for( int i = 0; i < values.size(); i++ ) {
+		uint16_t index = bigEndian16( uint16_t( i ) );
+		memcpy( k + prefix.size() + 1 + VersionstampSize, &index, 2 );
+		tr->atomicOp( key, values[i], MutationRef::SetVersionstampedKey );
+	}
+}
+
+void AppendLog::trim( Reference<ReadYourWritesTransaction> tr, KeyRef upTo ) {
+	ASSERT( upTo.size() == PositionSize );
+	for( int s = 0; s < shardCount; s++ ) {
+		KeyRange r = shardRange( s );
+		tr->clear( KeyRangeRef( r.begin, keyAfter( upTo.withPrefix( r.begin ) ) ) );
+	}
+}
+
+ACTOR static Future<Standalone<RangeResultRef>> readAppendLog( Reference<ReadYourWritesTransaction> tr, AppendLog log, Key after, int limit, bool snapshot ) {
+	state std::vector<Future<Standalone<RangeResultRef>>> shards;
+	for( int s = 0; s < log.getShardCount(); s++ ) {
+		KeyRange r = log.shardRange( s );
+		KeySelector begin = after.size() ? firstGreaterThan( after.withPrefix( r.begin ) ) : firstGreaterOrEqual( r.begin );
+		// Only a row limit, so that large reads are streamed from the storage servers
+		shards.push_back( tr->getRange( begin, firstGreaterOrEqual( r.end ), GetRangeLimits( limit ), snapshot ) );
+	}
+	std::vector<Standalone<RangeResultRef>> results = wait( getAll( shards ) );
+
+	// Each shard is in position order.  A shard that stopped early bounds the positions that can be returned, since
+	// its next entries are unknown.
+	Standalone<RangeResultRef> merged;
+	std::vector<KeyValueRef> entries;
+	Optional<KeyRef> bound;
+	int keyOffset = log.shardRange( 0 ).begin.size();
+	for( auto& r : results ) {
+		merged.arena().dependsOn( r.arena() );
+		for( auto& kv : r ) {
+			ASSERT( kv.key.size() == keyOffset + AppendLog::PositionSize );
+			entries.push_back( KeyValueRef( kv.key.substr( keyOffset ), kv.value ) );
+		}
+		if( r.more && r.size() && ( !bound.present() || r.back().key.substr( keyOffset ) < bound.get() ) )
+			bound = r.back().key.substr( keyOffset );
+	}
+	std::sort( entries.begin(), entries.end(), KeyValueRef::OrderByKey() );
+
+	for( auto& kv : entries ) {
+		if( merged.size() == limit || ( bound.present() && kv.key > bound.get() ) ) {
+			merged.more = true;
+			break;
+		}
+		merged.push_back( merged.arena(), kv );
+	}
+	if( bound.present() )
+		merged.more = true;
+	return merged;
+}
+
+Future<Standalone<RangeResultRef>> AppendLog::read( Reference<ReadYourWritesTransaction> tr, KeyRef after, int limit, bool snapshot ) {
+	ASSERT( after.size() == 0 || after.size() == PositionSize );
+	return readAppendLog( tr, *this, after, limit, snapshot );
+}
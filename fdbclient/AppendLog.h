@@ -0,0 +1,65 @@
+/*
+ * AppendLog.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FDBCLIENT_APPEND_LOG_H
+#define FDBCLIENT_APPEND_LOG_H
+#pragma once
+
+#include "flow/flow.h"
+#include "FDBTypes.h"
+#include "NativeAPI.h"
+
+class ReadYourWritesTransaction;
+
+// An ordered log that any number of clients can append to without conflicting.  Appends are written with
+// SetVersionstampedKey, so their order is commit order and no transaction reads or writes a shared tail key.  To keep
+// every append from landing at the end of one key range (and so on one storage team), each append batch goes to one
+// of shardCount sub-ranges, and read() merges the shards back into a single ordered sequence.
+//
+// An entry's position is its 10 byte commit versionstamp followed by its 2 byte big endian index in its batch.
+// Entries are stored at prefix + shard byte + position.
+class AppendLog {
+public:
+	enum { VersionstampSize = 10, PositionSize = VersionstampSize + 2 };
+
+	AppendLog( Key prefix, int shardCount );
+
+	// Appends values, in order, to a randomly chosen shard.  Positions are assigned when tr commits, so the entries can't
+	// be read back by tr.  It must be called at most once per transaction: two batches in one transaction would share
+	// a versionstamp, and so positions.
+	void append( Reference<ReadYourWritesTransaction> tr, VectorRef<ValueRef> values );
+
+	// Returns up to limit entries, in order, starting after position after (or at the beginning if after is empty).
+	// The key of each result is its position, which can be passed back as after to continue reading.  Since positions
+	// are commit versions, a reader continuing from its last position never misses an entry committed later.
+	Future<Standalone<RangeResultRef>> read( Reference<ReadYourWritesTransaction> tr, KeyRef after, int limit, bool snapshot = false );
+
+	// Removes every entry at or before position upTo
+	void trim( Reference<ReadYourWritesTransaction> tr, KeyRef upTo );
+
+	int getShardCount() const { return shardCount; }
+	KeyRange shardRange( int shard ) const;
+
+private:
+	Key prefix;
+	int shardCount;
+};
+
+#endif
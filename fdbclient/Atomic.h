@@ -220,6 +220,43 @@ static ValueRef doByteMin(const Optional<ValueRef>& existingValueOptional, const
 	return otherOperand;
 }
 
+/*
+* If applying atomic op a and then atomic op b (to the same key, at the same version) always has the same effect as
+* applying one mutation, sets a to that mutation and returns true.  The numeric ops only fuse when their operands are the
+* same length, since each op first truncates or zero extends the existing value to its operand's length.
+*/
+static bool fuseAtomicOps(MutationRef& a, MutationRef const& b, Arena& ar) {
+	if (a.type != b.type || a.param1 != b.param1)
+		return false;
+
+	switch(a.type) {
+		case MutationRef::AddValue:
+			if (a.param2.size() != b.param2.size()) return false;
+			a.param2 = doLittleEndianAdd(a.param2, b.param2, ar);
+			return true;
+		case MutationRef::Max:
+			if (a.param2.size() != b.param2.size()) return false;
+			a.param2 = doMax(a.param2, b.param2, ar);
+			return true;
+		case MutationRef::MinV2:
+			if (a.param2.size() != b.param2.size()) return false;
+			a.param2 = doMinV2(a.param2, b.param2, ar);
+			return true;
+		case MutationRef::ByteMin:
+			a.param2 = doByteMin(a.param2, b.param2, ar);
+			return true;
+		case MutationRef::ByteMax:
+			a.param2 = doByteMax(a.param2, b.param2, ar);
+			return true;
+		default:
+			return false;
+	}
+}
+
+static bool isFusableAtomicOp(MutationRef::Type type) {
+	return type == MutationRef::AddValue || type == MutationRef::Max || type == MutationRef::MinV2 || type == MutationRef::ByteMin || type == MutationRef::ByteMax;
+}
+
 /*
 * Returns the range corresponding to the specified versionstamp key.
 */
@@ -277,6 +277,13 @@ public:
 	// will return when the backup directory is restorable.
 	Future<int> waitBackup(Database cx, std::string tagName, bool stopWhenDone = true);
 
+	// Writes ranges, as of one version, to a new snapshot in the container at url and returns the version.  The snapshot needs
+	// no logs to restore.  Instead of passing through this process, each shard is written by one of its storage servers, which
+	// read it at a version kept pinned (see Transaction::pinSnapshot) for as long as the export runs, so this only works on a
+	// storage engine with snapshot support.  Each range file holds a contiguous, sorted part of the keyspace in blocks that decode
+	// independently, so readers can split the snapshot among themselves by file or by block.
+	Future<Version> exportSnapshot(Database cx, Key url, Standalone<VectorRef<KeyRangeRef>> ranges);
+
 	static const Key keyLastRestorable;
 
 	Future<int64_t> getTaskCount(Reference<ReadYourWritesTransaction> tr) { return taskBucket->getTaskCount(tr); }
@@ -285,6 +292,20 @@ public:
 
 	Future<bool> checkActive(Database cx) { return taskBucket->checkActive(cx); }
 
+	// Progress of the snapshot range tasks run by this process, reported in the backup agent's status
+	struct RangeStats {
+		RangeStats() : tasks_split(0), files_written(0), keys_written(0), bytes_written(0), files_reused(0), bytes_reused(0) {}
+
+		int64_t tasks_split;
+		int64_t files_written;
+		int64_t keys_written;
+		int64_t bytes_written;
+		int64_t files_reused;  // Files of the previous snapshot found unchanged and added to the current one instead of being written again
+		int64_t bytes_reused;
+	};
+
+	static RangeStats s_rangeStats;
+
 	friend class FileBackupAgentImpl;
 	static const int dataFooterSize;
 
@@ -431,6 +452,7 @@ Future<Void> logError(Reference<ReadYourWritesTransaction> tr, Key keyErrors, co
 Future<Void> checkVersion(Reference<ReadYourWritesTransaction> const& tr);
 Future<Void> readCommitted(Database const& cx, PromiseStream<RangeResultWithVersion> const& results, Reference<FlowLock> const& lock, KeyRangeRef const& range, bool const& terminator = true, bool const& systemAccess = false, bool const& lockAware = false);
 Future<Void> readCommitted(Database const& cx, PromiseStream<RCGroup> const& results, Future<Void> const& active, Reference<FlowLock> const& lock, KeyRangeRef const& range, std::function< std::pair<uint64_t, uint32_t>(Key key) > const& groupBy, bool const& terminator = true, bool const& systemAccess = false, bool const& lockAware = false);
+Future<Void> writeRangeFileKVs(Reference<IBackupFile> const& file, int const& blockSize, KeyRange const& range, Standalone<VectorRef<KeyValueRef>> const& kvs, bool const& compressBlocks);
 Future<Void> applyMutations(Database const& cx, Key const& uid, Key const& addPrefix, Key const& removePrefix, Version const& beginVersion, Version* const& endVersion, RequestStream<CommitTransactionRequest> const& commit, NotifiedVersion* const& committedVersion, Reference<KeyRangeMap<Version>> const& keyVersion);
 
 typedef BackupAgentBase::enumState EBackupState;
@@ -593,8 +615,9 @@ public:
 		Version version;
 		std::string fileName;
 		int64_t fileSize;
+		std::string digest;  // Of the file's key value pairs (see BACKUP_INCREMENTAL_SNAPSHOTS), or empty if not computed
 		Tuple pack() const {
-			return Tuple().append(begin).append(version).append(StringRef(fileName)).append(fileSize);
+			return Tuple().append(begin).append(version).append(StringRef(fileName)).append(fileSize).append(StringRef(digest));
 		}
 		static RangeSlice unpack(Tuple const &t) {
 			RangeSlice r;
@@ -603,6 +626,8 @@ public:
 			r.version = t.getInt(i++);
 			r.fileName = t.getString(i++).toString();
 			r.fileSize = t.getInt(i++);
+			if(i < t.size())
+				r.digest = t.getString(i++).toString();
 			return r;
 		}
 	};
@@ -613,6 +638,12 @@ public:
 		return configSpace.pack(LiteralStringRef(__FUNCTION__));
 	}
 
+	// The non overlapping files that made up the last snapshot, in the same form, for the range tasks of the next
+	// one to reuse the files of ranges that have not changed since
+	RangeFileMapT previousSnapshotRangeFileMap() {
+		return configSpace.pack(LiteralStringRef(__FUNCTION__));
+	}
+
 	// Coalesced set of ranges already dispatched for writing.
 	typedef KeyBackedMap<Key, bool> RangeDispatchMapT;
 	RangeDispatchMapT snapshotRangeDispatchMap() {
@@ -647,6 +678,15 @@ public:
 		return configSpace.pack(LiteralStringRef(__FUNCTION__));
 	}
 
+	// Whether any range file of the current snapshot was written with compressed blocks
+	KeyBackedProperty<bool> snapshotCompressedBlocks() {
+		return configSpace.pack(LiteralStringRef(__FUNCTION__));
+	}
+
+	KeyBackedProperty<bool> previousSnapshotCompressedBlocks() {
+		return configSpace.pack(LiteralStringRef(__FUNCTION__));
+	}
+
 	Future<Void> initNewSnapshot(Reference<ReadYourWritesTransaction> tr, int64_t intervalSeconds = -1) {
 		BackupConfig &copy = *this;  // Capture this by value instead of this ptr
 
@@ -662,6 +702,7 @@ public:
 			copy.snapshotBatchSize().clear(tr);
 			copy.snapshotBatchFuture().clear(tr);
 			copy.snapshotBatchDispatchDoneKey().clear(tr);
+			copy.snapshotCompressedBlocks().clear(tr);
 
 			if(intervalSeconds < 0)
 				intervalSeconds = defaultInterval.get();
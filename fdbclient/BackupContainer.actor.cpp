@@ -180,6 +180,38 @@ public:
 	// Delete a file
 	virtual Future<Void> deleteFile(std::string fileName) = 0;
 
+	// Delete many files.  Parallelism is limited because the corresponding delete actor states could use a lot of memory
+	// if they all existed at the same time.
+	ACTOR static Future<Void> deleteFiles_impl(Reference<BackupContainerFileSystem> bc, std::vector<std::string> fileNames) {
+		state std::list<Future<Void>> deleteFutures;
+
+		while(!fileNames.empty() || !deleteFutures.empty()) {
+
+			// While there are files to delete and budget in the deleteFutures list, start a delete
+			while(!fileNames.empty() && deleteFutures.size() < CLIENT_KNOBS->BACKUP_CONCURRENT_DELETES) {
+				deleteFutures.push_back(bc->deleteFile(fileNames.back()));
+				fileNames.pop_back();
+			}
+
+			// Wait for deletes to finish until there are only targetDeletesInFlight remaining.
+			// If there are no files left to start then this value is 0, otherwise it is one less
+			// than the delete concurrency limit.
+			state int targetFuturesSize = fileNames.empty() ? 0 : (CLIENT_KNOBS->BACKUP_CONCURRENT_DELETES - 1);
+
+			while(deleteFutures.size() > targetFuturesSize) {
+				Void _ = wait(deleteFutures.front());
+				deleteFutures.pop_front();
+			}
+		}
+
+		return Void();
+	}
+
+	// Containers which can delete several files at once override this
+	virtual Future<Void> deleteFiles(std::vector<std::string> fileNames) {
+		return deleteFiles_impl(Reference<BackupContainerFileSystem>::addRef(this), fileNames);
+	}
+
 	// Delete entire container.  During the process, if pNumDeleted is not null it will be
 	// updated with the count of deleted files so that progress can be seen.
 	virtual Future<Void> deleteContainer(int *pNumDeleted) = 0;
@@ -307,7 +339,7 @@ public:
 		return readKeyspaceSnapshot_impl(Reference<BackupContainerFileSystem>::addRef(this), snapshot);
 	}
 
-	ACTOR static Future<Void> writeKeyspaceSnapshotFile_impl(Reference<BackupContainerFileSystem> bc, std::vector<std::string> fileNames, int64_t totalBytes) {
+	ACTOR static Future<Void> writeKeyspaceSnapshotFile_impl(Reference<BackupContainerFileSystem> bc, std::vector<std::string> fileNames, int64_t totalBytes, bool compressedBlocks) {
 		ASSERT(!fileNames.empty());
 
 
@@ -339,6 +371,8 @@ public:
 		doc.create("totalBytes") = totalBytes;
 		doc.create("beginVersion") = minVer;
 		doc.create("endVersion") = maxVer;
+		// Readers tell block formats apart by each block's header; this records that some blocks need inflating
+		doc.create("compressedBlocks") = compressedBlocks;
 
 		Void _ = wait(yield());
 		state std::string docString = json_spirit::write_string(json);
@@ -350,8 +384,8 @@ public:
 		return Void();
 	}
 
-	Future<Void> writeKeyspaceSnapshotFile(std::vector<std::string> fileNames, int64_t totalBytes) {
-		return writeKeyspaceSnapshotFile_impl(Reference<BackupContainerFileSystem>::addRef(this), fileNames, totalBytes);
+	Future<Void> writeKeyspaceSnapshotFile(std::vector<std::string> fileNames, int64_t totalBytes, bool compressedBlocks) {
+		return writeKeyspaceSnapshotFile_impl(Reference<BackupContainerFileSystem>::addRef(this), fileNames, totalBytes, compressedBlocks);
 	};
 
 	// List log files which contain data at any version >= beginVersion and < endVersion
@@ -587,10 +621,14 @@ public:
 			scanBegin = expiredEnd.get();
 		}
 
-		// Get log files that contain any data at or before expireEndVersion
-		state std::vector<LogFile> logs = wait(bc->listLogFiles(scanBegin, expireEndVersion));
-		// Get range files up to and including expireEndVersion
-		state std::vector<RangeFile> ranges = wait(bc->listRangeFiles(scanBegin, expireEndVersion));
+		// Get log files that contain any data at or before expireEndVersion, and range files up to and including
+		// expireEndVersion, listing both at once
+		state Future<std::vector<LogFile>> fLogs = bc->listLogFiles(scanBegin, expireEndVersion);
+		state Future<std::vector<RangeFile>> fRanges = bc->listRangeFiles(scanBegin, expireEndVersion);
+		state std::vector<LogFile> logs = wait(fLogs);
+		state std::vector<RangeFile> ranges = wait(fRanges);
+		fLogs = Future<std::vector<LogFile>>();
+		fRanges = Future<std::vector<RangeFile>>();
 
 		// The new logBeginVersion will be taken from the last log file, if there is one
 		state Optional<Version> newLogBeginVersion;
@@ -667,28 +705,8 @@ public:
 			}
 		}
 
-		// Delete files, but limit parallelism because the file list could use a lot of memory and the corresponding
-		// delete actor states would use even more if they all existed at the same time.
-		state std::list<Future<Void>> deleteFutures;
-
-		while(!toDelete.empty() || !deleteFutures.empty()) {
-
-			// While there are files to delete and budget in the deleteFutures list, start a delete
-			while(!toDelete.empty() && deleteFutures.size() < CLIENT_KNOBS->BACKUP_CONCURRENT_DELETES) {
-				deleteFutures.push_back(bc->deleteFile(toDelete.back()));
-				toDelete.pop_back();
-			}
-
-			// Wait for deletes to finish until there are only targetDeletesInFlight remaining.
-			// If there are no files left to start then this value is 0, otherwise it is one less
-			// than the delete concurrency limit.
-			state int targetFuturesSize = toDelete.empty() ? 0 : (CLIENT_KNOBS->BACKUP_CONCURRENT_DELETES - 1);
-
-			while(deleteFutures.size() > targetFuturesSize) {
-				Void _ = wait(deleteFutures.front());
-				deleteFutures.pop_front();
-			}
-		}
+		// Delete files
+		Void _ = wait(bc->deleteFiles(std::move(toDelete)));
 
 		// Update the expiredEndVersion property.
 		Void _ = wait(bc->expiredEndVersion().set(expireEndVersion));
@@ -1080,6 +1098,12 @@ public:
 		return m_bstore->deleteObject(BUCKET, dataPath(path));
 	}
 
+	Future<Void> deleteFiles(std::vector<std::string> paths) {
+		for(auto &path : paths)
+			path = dataPath(path);
+		return m_bstore->deleteObjects(BUCKET, paths);
+	}
+
 	ACTOR static Future<FilesAndSizesT> listFiles_impl(Reference<BackupContainerBlobStore> bc, std::string path, std::function<bool(std::string const &)> pathFilter) {
 		// pathFilter expects container based paths, so create a wrapper which converts a raw path
 		// to a container path by removing the known backup name prefix.
@@ -1089,12 +1113,37 @@ public:
 			return pathFilter(folderPath.substr(prefixTrim));
 		};
 
-		state BlobStoreEndpoint::ListResult result = wait(bc->m_bstore->listBucket(BUCKET, bc->dataPath(path), '/', std::numeric_limits<int>::max(), rawPathFilter));
-		FilesAndSizesT files;
-		for(auto &o : result.objects) {
-			ASSERT(o.name.size() >= prefixTrim);
-			files.push_back({o.name.substr(prefixTrim), o.size});
+		// Consume the listing as it streams in rather than collecting a complete ListResult and then copying it
+		state PromiseStream<BlobStoreEndpoint::ListResult> resultStream;
+		state Future<Void> done = bc->m_bstore->listBucketStream(BUCKET, resultStream, bc->dataPath(path), '/', std::numeric_limits<int>::max(), rawPathFilter);
+		// listBucketStream() does not send end_of_stream, because many of its recursive calls write to the same stream
+		done = map(done, [=](Void) {
+			resultStream.sendError(end_of_stream());
+			return Void();
+		});
+
+		state FilesAndSizesT files;
+		try {
+			loop {
+				choose {
+					// Throw if done throws, otherwise don't stop until end_of_stream
+					when(Void _ = wait(done)) {
+						done = Never();
+					}
+
+					when(BlobStoreEndpoint::ListResult result = waitNext(resultStream.getFuture())) {
+						for(auto &o : result.objects) {
+							ASSERT(o.name.size() >= prefixTrim);
+							files.push_back({o.name.substr(prefixTrim), o.size});
+						}
+					}
+				}
+			}
+		} catch(Error &e) {
+			if(e.code() != error_code_end_of_stream)
+				throw;
 		}
+
 		return files;
 	}
 
@@ -61,13 +61,15 @@ struct ProfilerRequest {
 
 	enum class Type : std::int8_t {
 		GPROF = 1,
-		FLOW = 2
+		FLOW = 2,
+		HEAP = 3  // The sampling heap profiler in FastAlloc
 	};
 
 	enum class Action : std::int8_t {
 		DISABLE = 0,
 		ENABLE = 1,
-		RUN = 2
+		RUN = 2,
+		DUMP = 3  // Write out the continuous profile, or the live heap samples
 	};
 
 	Type type;
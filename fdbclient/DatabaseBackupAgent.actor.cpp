@@ -615,16 +615,9 @@ namespace dbBackup {
 			}
 		}
 
-		ACTOR static Future<Void> _execute(Database cx, Reference<TaskBucket> taskBucket, Reference<FutureBucket> futureBucket, Reference<Task> task) {
-			state Reference<FlowLock> lock(new FlowLock(CLIENT_KNOBS->BACKUP_LOCK_BYTES));
-
-			Void _ = wait(checkTaskVersion(cx, task, CopyLogRangeTaskFunc::name, CopyLogRangeTaskFunc::version));
-
-			state Version beginVersion = BinaryReader::fromStringRef<Version>(task->params[DatabaseBackupAgent::keyBeginVersion], Unversioned());
-			state Version endVersion = BinaryReader::fromStringRef<Version>(task->params[DatabaseBackupAgent::keyEndVersion], Unversioned());
-			state Version newEndVersion = std::min(endVersion, (((beginVersion-1) / CLIENT_KNOBS->BACKUP_BLOCK_SIZE) + 2 + (g_network->isSimulated() ? CLIENT_KNOBS->BACKUP_SIM_COPY_LOG_RANGES : 0)) * CLIENT_KNOBS->BACKUP_BLOCK_SIZE);
-
-			state Standalone<VectorRef<KeyRangeRef>> ranges = getLogRanges(beginVersion, newEndVersion, task->params[BackupAgentBase::destUid], CLIENT_KNOBS->BACKUP_BLOCK_SIZE);
+		// Copy the mutation log for versions [beginVersion, endVersion) to the destination's apply log
+		ACTOR static Future<Void> copyWindow(Database cx, Reference<TaskBucket> taskBucket, Reference<Task> task, Reference<FlowLock> lock, Version beginVersion, Version endVersion) {
+			state Standalone<VectorRef<KeyRangeRef>> ranges = getLogRanges(beginVersion, endVersion, task->params[BackupAgentBase::destUid], CLIENT_KNOBS->BACKUP_BLOCK_SIZE);
 			state std::vector<PromiseStream<RCGroup>> results;
 			state std::vector<Future<Void>> rc;
 			state std::vector<Future<Void>> dump;
@@ -636,6 +629,38 @@ namespace dbBackup {
 			}
 
 			Void _ = wait(waitForAll(dump));
+			return Void();
+		}
+
+		ACTOR static Future<Void> _execute(Database cx, Reference<TaskBucket> taskBucket, Reference<FutureBucket> futureBucket, Reference<Task> task) {
+			state Reference<FlowLock> lock(new FlowLock(CLIENT_KNOBS->BACKUP_LOCK_BYTES));
+
+			Void _ = wait(checkTaskVersion(cx, task, CopyLogRangeTaskFunc::name, CopyLogRangeTaskFunc::version));
+
+			state Version beginVersion = BinaryReader::fromStringRef<Version>(task->params[DatabaseBackupAgent::keyBeginVersion], Unversioned());
+			state Version endVersion = BinaryReader::fromStringRef<Version>(task->params[DatabaseBackupAgent::keyEndVersion], Unversioned());
+
+			// Rather than finishing and adding a new task for every window of versions, keep copying windows for up to
+			// BACKUP_COPY_LOG_RANGE_DURATION with the next ones read while earlier ones are being written.  Windows can be
+			// written in any order because the destination applies the log in version order.  The lock bounds the memory
+			// used by all of them together.
+			state double stopTime = now() + CLIENT_KNOBS->BACKUP_COPY_LOG_RANGE_DURATION;
+			state Version newEndVersion = beginVersion;
+			state std::deque<Future<Void>> windows;
+
+			loop {
+				while(newEndVersion < endVersion && windows.size() < std::max(1, CLIENT_KNOBS->BACKUP_COPY_LOG_PIPELINE_DEPTH) && (newEndVersion == beginVersion || now() < stopTime)) {
+					Version windowEnd = std::min(endVersion, (((newEndVersion-1) / CLIENT_KNOBS->BACKUP_BLOCK_SIZE) + 2 + (g_network->isSimulated() ? CLIENT_KNOBS->BACKUP_SIM_COPY_LOG_RANGES : 0)) * CLIENT_KNOBS->BACKUP_BLOCK_SIZE);
+					windows.push_back(copyWindow(cx, taskBucket, task, lock, newEndVersion, windowEnd));
+					newEndVersion = windowEnd;
+				}
+
+				if(windows.empty())
+					break;
+
+				Void _ = wait(windows.front());
+				windows.pop_front();
+			}
 
 			if (newEndVersion < endVersion) {
 				task->params[CopyLogRangeTaskFunc::keyNextBeginVersion] = BinaryWriter::toValue(newEndVersion, Unversioned());
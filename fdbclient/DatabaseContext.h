@@ -110,8 +110,30 @@ public:
 	struct VersionBatcher {
 		PromiseStream< std::pair< Promise<GetReadVersionReply>, Optional<UID> > > stream;
 		Future<Void> actor;
+		Future<GetReadVersionReply> sharedReply;  // The last read version requested while readVersionStaleness > 0...
+		double sharedReplyRequested;              // ... and when it was requested
+		VersionBatcher() : sharedReplyRequested(0) {}
 	};
 	std::map<uint32_t, VersionBatcher> versionBatcher;
+	double readVersionStaleness;  // FDBDatabaseOptions::READ_VERSION_STALENESS, in seconds
+
+	// The newest version this client has been given by a proxy, as a read version or a commit version, and the latest time at
+	// which it was already as recent as every commit acknowledged before then; see FDBTransactionOptions::USE_RECENT_READ_VERSION
+	Version recentReadVersion;
+	double recentReadVersionTime;
+	bool recentReadVersionLocked;  // Whether the database was locked at the last read version reply
+	void updateRecentReadVersion( Version version, double requestTime ) {
+		recentReadVersion = std::max( recentReadVersion, version );
+		recentReadVersionTime = std::max( recentReadVersionTime, requestTime );
+	}
+
+	// Point read batching; a batch is sent by the read which created it, see getValueBatched()
+	struct GetValuesBatch : ReferenceCounted<GetValuesBatch> {
+		Reference<LocationInfo> location;
+		std::vector< std::pair< Key, Promise<Optional<Value>> > > requests;  // Reads which joined the batch after it was created
+		explicit GetValuesBatch( Reference<LocationInfo> const& location ) : location(location) {}
+	};
+	std::map< std::pair<Version, Key>, Reference<GetValuesBatch> > getValuesBatches;  // Batches still accepting reads, by version and shard begin
 
 	// Client status updater
 	struct ClientStatusUpdater {
@@ -132,8 +154,13 @@ public:
 	Standalone<StringRef> dbId;
 
 	int64_t transactionReadVersions;
+	int64_t transactionReadVersionBatches;
+	int64_t transactionReadVersionsShared;
+	int64_t transactionReadVersionsRecent;
 	int64_t transactionLogicalReads;
 	int64_t transactionPhysicalReads;
+	int64_t transactionBatchedPointReads;
+	int64_t transactionStreamedRangeReads;
 	int64_t transactionCommittedMutations;
 	int64_t transactionCommittedMutationBytes;
 	int64_t transactionsCommitStarted;
@@ -147,6 +174,40 @@ public:
 	int outstandingWatches;
 	int maxOutstandingWatches;
 
+	// Watches of the same key and value from any number of transactions share one watchValue() loop, and so one
+	// outstanding storage server request that is reissued on timeouts and shard moves
+	struct SharedWatch : ReferenceCounted<SharedWatch>, NonCopyable {
+		Optional<Value> value;
+		Future<Version> watch;
+		int waiters;
+
+		explicit SharedWatch( Optional<Value> const& value ) : value(value), waiters(1) {}
+	};
+	std::map<Key, Reference<SharedWatch>> sharedWatches;
+	int64_t watchesShared;
+
+	// Client read cache, of values in the ranges registered under clientCacheRangesRange; see getValueCached()
+	struct CachedRange : ReferenceCounted<CachedRange>, NonCopyable {
+		Key begin, end;
+		Version validationVersion;  // The newest read version at which this client has asked for the range's clientCacheVersionKeyFor()...
+		Future<Optional<Value>> validation;  // ... and the answer
+		Version generation;  // The version of the last change to the range before the entries were read
+		std::map<Key, Optional<Value>> entries;
+		int64_t bytes;
+
+		CachedRange( KeyRef begin, KeyRef end ) : begin(begin), end(end), validationVersion(invalidVersion), generation(invalidVersion), bytes(0) {}
+	};
+	std::map<Key, Reference<CachedRange>> cachedRanges;  // By begin; refreshed from clientCacheRangesRange every CLIENT_CACHE_RANGES_REFRESH_INTERVAL
+	int64_t readCacheLimit;  // FDBDatabaseOptions::CLIENT_READ_CACHE_SIZE; 0 disables the cache
+	int64_t readCacheBytes;
+	int64_t transactionCachedReads;
+	Future<Void> cachedRangesMonitor;
+	void clearCachedRange( CachedRange* range ) {
+		readCacheBytes -= range->bytes;
+		range->bytes = 0;
+		range->entries.clear();
+	}
+
 	Future<Void> logger;
 
 	int taskID;
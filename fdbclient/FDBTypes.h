@@ -474,6 +474,7 @@ struct KeyValueStoreType {
 		SSD_BTREE_V1,
 		MEMORY,
 		SSD_BTREE_V2,
+		LSM,
 		END
 	};
 
@@ -492,6 +493,7 @@ struct KeyValueStoreType {
 			case SSD_BTREE_V1: return "ssd-1";
 			case SSD_BTREE_V2: return "ssd-2";
 			case MEMORY: return "memory";
+			case LSM: return "lsm";
 			default: return "unknown";
 		}
 	}
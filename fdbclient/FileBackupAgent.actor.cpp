@@ -28,6 +28,8 @@
 #include <ctime>
 #include <climits>
 #include "fdbrpc/IAsyncFile.h"
+#include "fdbrpc/zlib/zlib.h"
+#include "fdbrpc/md5/md5.h"
 #include "flow/genericactors.actor.h"
 #include "flow/Hash3.h"
 #include <numeric>
@@ -407,6 +409,115 @@ namespace fileBackup {
 	// may not be initialized yet a conservative constant is being used.
 	std::string paddingFFs(128 * 1024, 0xFF);
 
+	// Compressed blocks, range file version 1002 and log file version 2002, are the version header, the network order
+	// lengths of the block's contents before and after compression, the contents deflated by zlib, and 0xFF padding.
+	// Blocks still start at every multiple of the block size so they can be read in parallel like uncompressed ones.
+	//
+	// The contents of a compressed range block are the begin key, the network order count of kv pairs, each pair's key
+	// as the length of the prefix it shares with the previous key and the rest of it, each pair's value, and the end
+	// key encoded like the pairs' keys.  The contents of a compressed log block are the pairs as in a version 2001 block.
+	struct BlockCompressor {
+		static const int headerSize = sizeof(uint32_t) * 3;
+
+		// New compressors start from the ratio last seen in this process so that a file's first block is not mostly padding
+		static double lastRatio;
+
+		BlockCompressor(uint32_t fileVersion = 0, int blockSize = 0) : fileVersion(fileVersion), blockSize(blockSize), ratio(lastRatio) {}
+
+		// Returns contents as a compressed block, or an empty string if it does not fit in blockSize bytes
+		Standalone<StringRef> deflateBlock(StringRef contents) {
+			uLongf compressedLen = compressBound(contents.size());
+			Standalone<StringRef> block = makeString(headerSize + compressedLen);
+			uint8_t *p = mutateString(block);
+			if(compress2(p + headerSize, &compressedLen, contents.begin(), contents.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+				throw internal_error();
+			if(headerSize + compressedLen > blockSize)
+				return Standalone<StringRef>();
+
+			uint32_t uncompressedLenBE = bigEndian32((uint32_t)contents.size());
+			uint32_t compressedLenBE = bigEndian32((uint32_t)compressedLen);
+			memcpy(p, &fileVersion, sizeof(fileVersion));
+			memcpy(p + sizeof(fileVersion), &uncompressedLenBE, sizeof(uncompressedLenBE));
+			memcpy(p + sizeof(fileVersion) + sizeof(uncompressedLenBE), &compressedLenBE, sizeof(compressedLenBE));
+
+			// Aim a little below the observed ratio, and bound how much content a writer buffers
+			ratio = lastRatio = std::max(1.0, std::min(16.0, 0.9 * contents.size() / (headerSize + compressedLen)));
+			return Standalone<StringRef>(block.substr(0, headerSize + compressedLen), block.arena());
+		}
+
+		// How many bytes of contents are likely to fit in one block
+		int64_t targetContentBytes() const { return blockSize * ratio; }
+
+		uint32_t fileVersion;
+		int blockSize;
+		double ratio;
+	};
+	double BlockCompressor::lastRatio = 2.0;
+
+	static void appendNetworkUInt32(BinaryWriter &wr, uint32_t x) {
+		uint32_t be = bigEndian32(x);
+		wr.serializeBytes(&be, sizeof(be));
+	}
+
+	static void appendStringWithLen(BinaryWriter &wr, StringRef s) {
+		appendNetworkUInt32(wr, s.size());
+		wr.serializeBytes(s);
+	}
+
+	static void appendPrefixCompressedKey(BinaryWriter &wr, KeyRef prev, KeyRef key) {
+		int prefix = 0;
+		int maxPrefix = std::min(prev.size(), key.size());
+		while(prefix < maxPrefix && prev[prefix] == key[prefix])
+			++prefix;
+		appendNetworkUInt32(wr, prefix);
+		appendStringWithLen(wr, key.substr(prefix));
+	}
+
+	// Encodes the contents of a compressed range block holding the first n of kvs
+	static void encodeRangeBlock(BinaryWriter &wr, KeyRef begin, VectorRef<KeyValueRef> const& kvs, int n, KeyRef end) {
+		appendStringWithLen(wr, begin);
+		appendNetworkUInt32(wr, n);
+		KeyRef prev = begin;
+		for(int i = 0; i < n; ++i) {
+			appendPrefixCompressedKey(wr, prev, kvs[i].key);
+			appendStringWithLen(wr, kvs[i].value);
+			prev = kvs[i].key;
+		}
+		appendPrefixCompressedKey(wr, prev, end);
+	}
+
+	// Encodes the contents of a compressed log block holding the first n of kvs
+	static void encodeLogBlock(BinaryWriter &wr, VectorRef<KeyValueRef> const& kvs, int n) {
+		for(int i = 0; i < n; ++i) {
+			appendStringWithLen(wr, kvs[i].key);
+			appendStringWithLen(wr, kvs[i].value);
+		}
+	}
+
+	// Appends each of blocks to file at the next multiple of blockSize, padding the end of the current block with 0xFF first
+	ACTOR Future<Void> appendCompressedBlocks(Reference<IBackupFile> file, int64_t *blockEnd, int blockSize, std::vector<Standalone<StringRef>> blocks) {
+		state int i = 0;
+		for(; i < blocks.size(); ++i) {
+			loop {
+				int bytesLeft = std::min<int64_t>(*blockEnd - file->size(), paddingFFs.size());
+				if(bytesLeft <= 0)
+					break;
+				Void _ = wait(file->append((uint8_t *)paddingFFs.data(), bytesLeft));
+			}
+			*blockEnd += blockSize;
+			Void _ = wait(file->append(blocks[i].begin(), blocks[i].size()));
+		}
+		return Void();
+	}
+
+	// Removes the first n of kvs
+	static void dropFirst(Standalone<VectorRef<KeyValueRef>> &kvs, int n) {
+		Standalone<VectorRef<KeyValueRef>> rest;
+		for(int i = n; i < kvs.size(); ++i)
+			rest.push_back_deep(rest.arena(), kvs[i]);
+		kvs = rest;
+	}
+
 	// File Format handlers.
 	// Both Range and Log formats are designed to be readable starting at any 1MB boundary
 	// so they can be read in parallel.
@@ -440,7 +551,56 @@ namespace fileBackup {
 	//   then the space after the final key to the next 1MB boundary would
 	//   just be padding anyway.
 	struct RangeFileWriter {
-		RangeFileWriter(Reference<IBackupFile> file = Reference<IBackupFile>(), int blockSize = 0) : file(file), blockSize(blockSize), blockEnd(0), fileVersion(1001) {}
+		RangeFileWriter(Reference<IBackupFile> file = Reference<IBackupFile>(), int blockSize = 0, bool compressBlocks = false)
+			: file(file), blockSize(blockSize), compressBlocks(compressBlocks), blockEnd(0), fileVersion(compressBlocks ? 1002 : 1001),
+			  compressor(1002, blockSize), pendingBytes(0), begun(false) {}
+
+		// Returns compressed blocks holding the pending kv pairs, ending with endKey.  Unless final, pairs that don't fit
+		// in a block with what comes before them are left pending.
+		std::vector<Standalone<StringRef>> takeCompressedBlocks(KeyRef endKey, bool final) {
+			std::vector<Standalone<StringRef>> blocks;
+			loop {
+				int n = pending.size();
+				BinaryWriter wr(Unversioned());
+				encodeRangeBlock(wr, blockBegin, pending, n, endKey);
+				Standalone<StringRef> block = compressor.deflateBlock(wr.toStringRef());
+				if(block.size()) {
+					blocks.push_back(block);
+					pending = Standalone<VectorRef<KeyValueRef>>();
+					pendingBytes = 0;
+					blockBegin = endKey;
+					return blocks;
+				}
+
+				// Find the most pending pairs that fit in a block, which then ends where the next pending pair begins
+				int best = 0;
+				int lo = 1, hi = n - 1;
+				while(lo <= hi) {
+					int m = (lo + hi) / 2;
+					BinaryWriter prefixWr(Unversioned());
+					encodeRangeBlock(prefixWr, blockBegin, pending, m, pending[m].key);
+					Standalone<StringRef> prefixBlock = compressor.deflateBlock(prefixWr.toStringRef());
+					if(prefixBlock.size()) {
+						best = m;
+						block = prefixBlock;
+						lo = m + 1;
+					} else {
+						hi = m - 1;
+					}
+				}
+				if(!best)
+					throw backup_bad_block_size();
+
+				blocks.push_back(block);
+				blockBegin = pending[best].key;
+				dropFirst(pending, best);
+				pendingBytes = 0;
+				for(auto &kv : pending)
+					pendingBytes += kv.expectedSize();
+				if(!final)
+					return blocks;
+			}
+		}
 
 		// Handles the first block and internal blocks.  Ends current block if needed.
 		ACTOR static Future<Void> newBlock(RangeFileWriter *self, int bytesNeeded) {
@@ -479,6 +639,16 @@ namespace fileBackup {
 
 		// Start a new block if needed, then write the key and value
 		ACTOR static Future<Void> writeKV_impl(RangeFileWriter *self, Key k, Value v) {
+			if(self->compressBlocks) {
+				// If this pair would make the pending ones unlikely to fit in a block, write them in blocks ending at this key
+				if(self->pending.size() && self->pendingBytes + k.size() + v.size() > self->compressor.targetContentBytes()) {
+					Void _ = wait(appendCompressedBlocks(self->file, &self->blockEnd, self->blockSize, self->takeCompressedBlocks(k, false)));
+				}
+				self->pending.push_back_deep(self->pending.arena(), KeyValueRef(k, v));
+				self->pendingBytes += k.size() + v.size();
+				return Void();
+			}
+
 			int toWrite = sizeof(int32_t) + k.size() + sizeof(int32_t) + v.size();
 			Void _ = wait(self->newBlockIfNeeded(toWrite));
 			Void _ = wait(self->file->appendStringRefWithLen(k));
@@ -492,6 +662,16 @@ namespace fileBackup {
 
 		// Write begin key or end key.
 		ACTOR static Future<Void> writeKey_impl(RangeFileWriter *self, Key k) {
+			if(self->compressBlocks) {
+				if(!self->begun) {
+					self->blockBegin = k;
+					self->begun = true;
+					return Void();
+				}
+				Void _ = wait(appendCompressedBlocks(self->file, &self->blockEnd, self->blockSize, self->takeCompressedBlocks(k, true)));
+				return Void();
+			}
+
 			int toWrite = sizeof(uint32_t) + k.size();
 			Void _ = wait(self->newBlockIfNeeded(toWrite));
 			Void _ = wait(self->file->appendStringRefWithLen(k));
@@ -502,12 +682,20 @@ namespace fileBackup {
 
 		Reference<IBackupFile> file;
 		int blockSize;
+		bool compressBlocks;
 
 	private:
 		int64_t blockEnd;
 		uint32_t fileVersion;
 		Key lastKey;
 		Key lastValue;
+
+		// Compressed blocks are encoded once their last pair is known
+		BlockCompressor compressor;
+		Key blockBegin;
+		Standalone<VectorRef<KeyValueRef>> pending;
+		int64_t pendingBytes;
+		bool begun;
 	};
 
 	// Helper class for reading restore data from a buffer and throwing the right errors.
@@ -546,6 +734,82 @@ namespace fileBackup {
 		Error failure_error;
 	};
 
+	// Consumes the lengths and deflated contents of a compressed block whose version header has been read, and returns
+	// the inflated contents.
+	static Standalone<StringRef> inflateBlock(StringRefReader &reader) {
+		uint32_t uncompressedLen = reader.consumeNetworkUInt32();
+		uint32_t compressedLen = reader.consumeNetworkUInt32();
+		const uint8_t *compressed = reader.consume(compressedLen);
+
+		Standalone<StringRef> contents = makeString(uncompressedLen);
+		uLongf outLen = uncompressedLen;
+		if(uncompress(mutateString(contents), &outLen, compressed, compressedLen) != Z_OK || outLen != uncompressedLen)
+			throw restore_corrupted_data();
+		return contents;
+	}
+
+	static KeyRef consumePrefixCompressedKey(StringRefReader &reader, KeyRef prev, Arena &arena) {
+		uint32_t prefix = reader.consumeNetworkUInt32();
+		uint32_t suffixLen = reader.consumeNetworkUInt32();
+		const uint8_t *suffix = reader.consume(suffixLen);
+		if(prefix > prev.size())
+			throw restore_corrupted_data();
+
+		KeyRef key = makeString(prefix + suffixLen, arena);
+		uint8_t *p = mutateString(key);
+		memcpy(p, prev.begin(), prefix);
+		memcpy(p + prefix, suffix, suffixLen);
+		return key;
+	}
+
+	// Decodes the rest of a version 1002 range file block, after its header, in the same form as a version 1001 block
+	static Standalone<VectorRef<KeyValueRef>> decodeCompressedRangeBlock(StringRefReader &reader) {
+		Standalone<StringRef> contents = inflateBlock(reader);
+		Standalone<VectorRef<KeyValueRef>> results({}, contents.arena());
+		StringRefReader contentReader(contents, restore_corrupted_data());
+
+		uint32_t kLen = contentReader.consumeNetworkUInt32();
+		KeyRef prev = KeyRef(contentReader.consume(kLen), kLen);
+		results.push_back(results.arena(), KeyValueRef(prev, ValueRef()));
+
+		uint32_t count = contentReader.consumeNetworkUInt32();
+		for(uint32_t i = 0; i < count; ++i) {
+			KeyRef k = consumePrefixCompressedKey(contentReader, prev, results.arena());
+			uint32_t vLen = contentReader.consumeNetworkUInt32();
+			const uint8_t *v = contentReader.consume(vLen);
+			results.push_back(results.arena(), KeyValueRef(k, ValueRef(v, vLen)));
+			prev = k;
+		}
+
+		results.push_back(results.arena(), KeyValueRef(consumePrefixCompressedKey(contentReader, prev, results.arena()), ValueRef()));
+		if(!contentReader.eof())
+			throw restore_corrupted_data();
+		return results;
+	}
+
+	// Decodes the rest of a version 2002 log file block, after its header, in the same form as a version 2001 block
+	static Standalone<VectorRef<KeyValueRef>> decodeCompressedLogBlock(StringRefReader &reader) {
+		Standalone<StringRef> contents = inflateBlock(reader);
+		Standalone<VectorRef<KeyValueRef>> results({}, contents.arena());
+		StringRefReader contentReader(contents, restore_corrupted_data());
+
+		while(!contentReader.eof()) {
+			uint32_t kLen = contentReader.consumeNetworkUInt32();
+			const uint8_t *k = contentReader.consume(kLen);
+			uint32_t vLen = contentReader.consumeNetworkUInt32();
+			const uint8_t *v = contentReader.consume(vLen);
+			results.push_back(results.arena(), KeyValueRef(KeyRef(k, kLen), ValueRef(v, vLen)));
+		}
+		return results;
+	}
+
+	// Checks that the rest of a block is 0xFF padding
+	static void checkBlockPadding(StringRefReader &reader) {
+		for(auto b : reader.remainder())
+			if(b != 0xFF)
+				throw restore_corrupted_data_padding();
+	}
+
 	ACTOR Future<Standalone<VectorRef<KeyValueRef>>> decodeRangeFileBlock(Reference<IAsyncFile> file, int64_t offset, int len) {
 		state Standalone<StringRef> buf = makeString(len);
 		int rLen = wait(file->read(mutateString(buf), len, offset));
@@ -556,8 +820,14 @@ namespace fileBackup {
 		state StringRefReader reader(buf, restore_corrupted_data());
 
 		try {
-			// Read header, currently only decoding version 1001
-			if(reader.consume<int32_t>() != 1001)
+			// Read header, decoding versions 1001 and 1002
+			int32_t fileVersion = reader.consume<int32_t>();
+			if(fileVersion == 1002) {
+				Standalone<VectorRef<KeyValueRef>> decoded = decodeCompressedRangeBlock(reader);
+				checkBlockPadding(reader);
+				return decoded;
+			}
+			if(fileVersion != 1001)
 				throw restore_unsupported_file_version();
 
 			// Read begin key, if this fails then block was invalid.
@@ -612,10 +882,67 @@ namespace fileBackup {
 	struct LogFileWriter {
 		static const std::string &FFs;
 
-		LogFileWriter(Reference<IBackupFile> file = Reference<IBackupFile>(), int blockSize = 0) : file(file), blockSize(blockSize), blockEnd(0), fileVersion(2001) {}
+		LogFileWriter(Reference<IBackupFile> file = Reference<IBackupFile>(), int blockSize = 0, bool compressBlocks = false)
+			: file(file), blockSize(blockSize), compressBlocks(compressBlocks), blockEnd(0), fileVersion(compressBlocks ? 2002 : 2001),
+			  compressor(2002, blockSize), pendingBytes(0) {}
+
+		// Returns compressed blocks holding the pending kv pairs.  Unless final, pairs that don't fit in a block with what
+		// comes before them are left pending.
+		std::vector<Standalone<StringRef>> takeCompressedBlocks(bool final) {
+			std::vector<Standalone<StringRef>> blocks;
+			while(pending.size()) {
+				int n = pending.size();
+				BinaryWriter wr(Unversioned());
+				encodeLogBlock(wr, pending, n);
+				Standalone<StringRef> block = compressor.deflateBlock(wr.toStringRef());
+				if(block.size()) {
+					blocks.push_back(block);
+					pending = Standalone<VectorRef<KeyValueRef>>();
+					pendingBytes = 0;
+					break;
+				}
+
+				// Find the most pending pairs that fit in a block
+				int best = 0;
+				int lo = 1, hi = n - 1;
+				while(lo <= hi) {
+					int m = (lo + hi) / 2;
+					BinaryWriter prefixWr(Unversioned());
+					encodeLogBlock(prefixWr, pending, m);
+					Standalone<StringRef> prefixBlock = compressor.deflateBlock(prefixWr.toStringRef());
+					if(prefixBlock.size()) {
+						best = m;
+						block = prefixBlock;
+						lo = m + 1;
+					} else {
+						hi = m - 1;
+					}
+				}
+				if(!best)
+					throw backup_bad_block_size();
+
+				blocks.push_back(block);
+				dropFirst(pending, best);
+				pendingBytes = 0;
+				for(auto &kv : pending)
+					pendingBytes += kv.expectedSize();
+				if(!final)
+					break;
+			}
+			return blocks;
+		}
 
 		// Start a new block if needed, then write the key and value
 		ACTOR static Future<Void> writeKV_impl(LogFileWriter *self, Key k, Value v) {
+			if(self->compressBlocks) {
+				if(self->pending.size() && self->pendingBytes + k.size() + v.size() > self->compressor.targetContentBytes()) {
+					Void _ = wait(appendCompressedBlocks(self->file, &self->blockEnd, self->blockSize, self->takeCompressedBlocks(false)));
+				}
+				self->pending.push_back_deep(self->pending.arena(), KeyValueRef(k, v));
+				self->pendingBytes += k.size() + v.size();
+				return Void();
+			}
+
 			// If key and value do not fit in this block, end it and start a new one
 			int toWrite = sizeof(int32_t) + k.size() + sizeof(int32_t) + v.size();
 			if(self->file->size() + toWrite > self->blockEnd) {
@@ -644,12 +971,24 @@ namespace fileBackup {
 
 		Future<Void> writeKV(Key k, Value v) { return writeKV_impl(this, k, v); }
 
+		// Writes out any pairs still buffered for compression; must be called before finishing the file
+		Future<Void> flush() {
+			if(!compressBlocks || !pending.size())
+				return Void();
+			return appendCompressedBlocks(file, &blockEnd, blockSize, takeCompressedBlocks(true));
+		}
+
 		Reference<IBackupFile> file;
 		int blockSize;
+		bool compressBlocks;
 
 	private:
 		int64_t blockEnd;
 		uint32_t fileVersion;
+
+		BlockCompressor compressor;
+		Standalone<VectorRef<KeyValueRef>> pending;
+		int64_t pendingBytes;
 	};
 
 	ACTOR Future<Standalone<VectorRef<KeyValueRef>>> decodeLogFileBlock(Reference<IAsyncFile> file, int64_t offset, int len) {
@@ -662,8 +1001,14 @@ namespace fileBackup {
 		state StringRefReader reader(buf, restore_corrupted_data());
 
 		try {
-			// Read header, currently only decoding version 2001
-			if(reader.consume<int32_t>() != 2001)
+			// Read header, decoding versions 2001 and 2002
+			int32_t fileVersion = reader.consume<int32_t>();
+			if(fileVersion == 2002) {
+				Standalone<VectorRef<KeyValueRef>> decoded = decodeCompressedLogBlock(reader);
+				checkBlockPadding(reader);
+				return decoded;
+			}
+			if(fileVersion != 2001)
 				throw restore_unsupported_file_version();
 
 			// Read k/v pairs.  Block ends either at end of last value exactly or with 0xFF as first key len byte.
@@ -880,6 +1225,10 @@ namespace fileBackup {
 			static TaskParam<bool> addBackupRangeTasks() {
 				return LiteralStringRef(__FUNCTION__);
 			}
+			// Serialized vector<Key> of boundaries, from beginKey to endKey, to split the range at instead of its shard boundaries
+			static TaskParam<Key> splitKeys() {
+				return LiteralStringRef(__FUNCTION__);
+			}
 		} Params;
 
 		std::string toString(Reference<Task> task) {
@@ -895,20 +1244,9 @@ namespace fileBackup {
 		Future<Void> execute(Database cx, Reference<TaskBucket> tb, Reference<FutureBucket> fb, Reference<Task> task) { return _execute(cx, tb, fb, task); };
 		Future<Void> finish(Reference<ReadYourWritesTransaction> tr, Reference<TaskBucket> tb, Reference<FutureBucket> fb, Reference<Task> task) { return _finish(tr, tb, fb, task); };
 
-		// Finish (which flushes/syncs) the file, and then in a single transaction, make some range backup progress durable.  
-		// This means:
-		//  - increment the backup config's range bytes written
-		//  - update the range file map
-		//  - update the task begin key
-		//  - save/extend the task with the new params
-		// Returns whether or not the caller should continue executing the task.
-		ACTOR static Future<bool> finishRangeFile(Reference<IBackupFile> file, Database cx, Reference<Task> task, Reference<TaskBucket> taskBucket, KeyRange range, Version version) {
-			Void _ = wait(file->finish());
-
-			// Ignore empty ranges.
-			if(range.empty())
-				return false;
-
+		// The durable part of finishRangeFile(), also used to put a file of the previous snapshot in this one, in which case
+		// bytesWritten is 0.
+		ACTOR static Future<bool> addRangeFile(Database cx, Reference<Task> task, Reference<TaskBucket> taskBucket, KeyRange range, BackupConfig::RangeSlice slice, bool compressedBlocks, int64_t bytesWritten) {
 			state Reference<ReadYourWritesTransaction> tr(new ReadYourWritesTransaction(cx));
 			state BackupConfig backup(task);
 			state bool usedFile = false;
@@ -931,12 +1269,15 @@ namespace fileBackup {
 					state Version newTimeout = wait(taskBucket->extendTimeout(tr, task, true));
 
 					// Update the range bytes written in the backup config
-					backup.rangeBytesWritten().atomicOp(tr, file->size(), MutationRef::AddValue);
+					if(bytesWritten)
+						backup.rangeBytesWritten().atomicOp(tr, bytesWritten, MutationRef::AddValue);
 
 					// See if there is already a file for this key which has an earlier begin, update the map if not.
 					Optional<BackupConfig::RangeSlice> s = wait(backup.snapshotRangeFileMap().get(tr, range.end));
 					if(!s.present() || s.get().begin >= range.begin) {
-						backup.snapshotRangeFileMap().set(tr, range.end, {range.begin, version, file->getFileName(), file->size()});
+						backup.snapshotRangeFileMap().set(tr, range.end, slice);
+						if(compressedBlocks)
+							backup.snapshotCompressedBlocks().set(tr, true);
 						usedFile = true;
 					}
 
@@ -951,6 +1292,121 @@ namespace fileBackup {
 			return usedFile;
 		}
 
+		// Finish (which flushes/syncs) the file, and then in a single transaction, make some range backup progress durable.  
+		// This means:
+		//  - increment the backup config's range bytes written
+		//  - update the range file map
+		//  - update the task begin key
+		//  - save/extend the task with the new params
+		// Returns whether or not the caller should continue executing the task.
+		ACTOR static Future<bool> finishRangeFile(Reference<IBackupFile> file, Database cx, Reference<Task> task, Reference<TaskBucket> taskBucket, KeyRange range, Version version, bool compressedBlocks, std::string digest) {
+			Void _ = wait(file->finish());
+
+			// Ignore empty ranges.
+			if(range.empty())
+				return false;
+
+			BackupConfig::RangeSlice slice = {range.begin, version, file->getFileName(), file->size(), digest};
+			bool usedFile = wait(addRangeFile(cx, task, taskBucket, range, slice, compressedBlocks, file->size()));
+			return usedFile;
+		}
+
+		// The digest recorded with each range file in incremental mode, of the file's key value pairs in order
+		static void digestKVs(MD5_CTX *ctx, VectorRef<KeyValueRef> const& kvs) {
+			for(auto &kv : kvs) {
+				uint32_t len = kv.key.size();
+				MD5_Update(ctx, &len, sizeof(len));
+				MD5_Update(ctx, kv.key.begin(), kv.key.size());
+				len = kv.value.size();
+				MD5_Update(ctx, &len, sizeof(len));
+				MD5_Update(ctx, kv.value.begin(), kv.value.size());
+			}
+		}
+
+		static std::string finishDigest(MD5_CTX *ctx) {
+			std::string digest(16, 0);
+			MD5_Final((unsigned char *)&digest[0], ctx);
+			return digest;
+		}
+
+		ACTOR static Future<std::string> digestRange(Database cx, KeyRange range) {
+			state Reference<FlowLock> lock(new FlowLock(CLIENT_KNOBS->BACKUP_LOCK_BYTES));
+			state PromiseStream<RangeResultWithVersion> results;
+			state Future<Void> rc = readCommitted(cx, results, lock, range, true, true, true);
+			state MD5_CTX ctx;
+			MD5_Init(&ctx);
+			try {
+				loop {
+					RangeResultWithVersion values = waitNext(results.getFuture());
+					digestKVs(&ctx, values.first);
+					lock->release(values.first.expectedSize());
+				}
+			} catch(Error &e) {
+				if(e.code() != error_code_end_of_stream)
+					throw;
+			}
+			return finishDigest(&ctx);
+		}
+
+		// In incremental mode, a range task first looks for files of the previous snapshot that still hold just what is in
+		// their part of the task's range, and puts those in this snapshot's range file map instead of writing the data again.
+		// Whether a range is unchanged is decided by reading it and comparing its digest to the file's, so the database is
+		// read as much as before but the container only gets the ranges that changed.  Files older than
+		// BACKUP_INCREMENTAL_SNAPSHOT_MAX_AGE are written again regardless, since restoring from a snapshot needs the logs since
+		// its oldest file.  Returns the key up to which the range starting at beginKey was covered this way.
+		ACTOR static Future<Key> reusePreviousFiles(Database cx, Reference<Task> task, Reference<TaskBucket> taskBucket, Key beginKey, Key endKey) {
+			state BackupConfig backup(task);
+			state Reference<ReadYourWritesTransaction> tr(new ReadYourWritesTransaction(cx));
+			state BackupConfig::RangeFileMapT::PairsType previous;
+			state Version snapshotBeginVersion;
+			state bool compressedBlocks = false;
+
+			loop {
+				try {
+					tr->setOption(FDBTransactionOptions::ACCESS_SYSTEM_KEYS);
+					tr->setOption(FDBTransactionOptions::LOCK_AWARE);
+
+					// The files ending in (beginKey, endKey], in order
+					Void _ = wait(store(backup.previousSnapshotRangeFileMap().getRange(tr, keyAfter(beginKey), keyAfter(endKey), CLIENT_KNOBS->TOO_MANY), previous)
+								&& store(backup.snapshotBeginVersion().getOrThrow(tr), snapshotBeginVersion)
+								&& store(backup.previousSnapshotCompressedBlocks().getD(tr, false), compressedBlocks));
+					break;
+				} catch(Error &e) {
+					Void _ = wait(tr->onError(e));
+				}
+			}
+
+			state Version oldestVersion = snapshotBeginVersion - CLIENT_KNOBS->BACKUP_INCREMENTAL_SNAPSHOT_MAX_AGE * CLIENT_KNOBS->CORE_VERSIONSPERSECOND;
+			state int i = 0;
+			for(; i < previous.size(); ++i) {
+				state KeyRange range = KeyRangeRef(previous[i].second.begin, previous[i].first);
+				state BackupConfig::RangeSlice slice = previous[i].second;
+				if(range.begin != beginKey || slice.digest.empty() || slice.version < oldestVersion)
+					break;
+
+				std::string digest = wait(digestRange(cx, range));
+				if(digest != slice.digest)
+					break;
+
+				bool usedFile = wait(addRangeFile(cx, task, taskBucket, range, slice, compressedBlocks, 0));
+				FileBackupAgent::s_rangeStats.files_reused++;
+				FileBackupAgent::s_rangeStats.bytes_reused += slice.fileSize;
+				TraceEvent("FileBackupReusedRangeFile")
+					.detail("BackupUID", backup.getUid())
+					.detail("FileName", slice.fileName)
+					.detail("Size", slice.fileSize)
+					.detail("Version", slice.version)
+					.detail("BeginKey", range.begin.printable())
+					.detail("EndKey", range.end.printable())
+					.detail("AddedFileToMap", usedFile)
+					.suppressFor(60, true);
+
+				beginKey = range.end;
+			}
+
+			return beginKey;
+		}
+
 		ACTOR static Future<Key> addTask(Reference<ReadYourWritesTransaction> tr, Reference<TaskBucket> taskBucket, Reference<Task> parentTask, int priority, Key begin, Key end, TaskCompletionKey completionKey, Reference<TaskFuture> waitFor = Reference<TaskFuture>(), Version scheduledVersion = invalidVersion) {
 			Key key = wait(addBackupTask(BackupRangeTaskFunc::name,
 										 BackupRangeTaskFunc::version,
@@ -968,6 +1424,37 @@ namespace fileBackup {
 			return key;
 		}
 
+		// Returns boundaries from range.begin to range.end splitting range into parts of about BACKUP_RANGE_TASK_TARGET_BYTES
+		// according to the storage servers' byte samples, or just range.begin and range.end if it is small or the samples
+		// can't be had quickly.
+		ACTOR static Future<std::vector<Key>> getRangeSplits(Database cx, KeyRange range) {
+			state std::vector<Key> boundaries;
+			state Transaction tr(cx);
+
+			StorageMetrics limit;
+			limit.bytes = CLIENT_KNOBS->BACKUP_RANGE_TASK_TARGET_BYTES;
+			limit.bytesPerKSecond = limit.infinity;
+			limit.iosPerKSecond = limit.infinity;
+			limit.bytesReadPerKSecond = limit.infinity;
+
+			boundaries.push_back(range.begin);
+			try {
+				Standalone<VectorRef<KeyRef>> splits = wait( timeout( tr.splitStorageMetrics( range, limit, StorageMetrics() ),
+					CLIENT_KNOBS->BACKUP_RANGE_SPLIT_TIMEOUT, Standalone<VectorRef<KeyRef>>() ) );
+				for(auto &k : splits) {
+					if(k > boundaries.back() && k < range.end)
+						boundaries.push_back(k);
+				}
+			} catch( Error &e ) {
+				if( e.code() == error_code_actor_cancelled )
+					throw;
+				TraceEvent(SevWarn, "FileBackupRangeSplitError").error(e).suppressFor(60, true);
+			}
+			boundaries.push_back(range.end);
+
+			return boundaries;
+		}
+
 		ACTOR static Future<Void> _execute(Database cx, Reference<TaskBucket> taskBucket, Reference<FutureBucket> futureBucket, Reference<Task> task) {
 			state Reference<FlowLock> lock(new FlowLock(CLIENT_KNOBS->BACKUP_LOCK_BYTES));
 
@@ -995,6 +1482,26 @@ namespace fileBackup {
 				return Void();
 			}
 
+			// A single shard can still be too much for one task to dump in a reasonable time, so split large ones by size
+			// and let other task executors work on the parts in parallel.
+			if (CLIENT_KNOBS->BACKUP_RANGE_TASK_TARGET_BYTES > 0) {
+				std::vector<Key> splits = wait(getRangeSplits(cx, KeyRangeRef(beginKey, endKey)));
+				if (splits.size() > 2) {
+					TEST(true); // Backup range task split within a shard
+					Params.splitKeys().set(task, BinaryWriter::toValue(splits, IncludeVersion()));
+					Params.addBackupRangeTasks().set(task, true);
+					FileBackupAgent::s_rangeStats.tasks_split++;
+					return Void();
+				}
+			}
+
+			if (CLIENT_KNOBS->BACKUP_INCREMENTAL_SNAPSHOTS) {
+				Key reusedEnd = wait(reusePreviousFiles(cx, task, taskBucket, beginKey, endKey));
+				beginKey = reusedEnd;
+				if(beginKey == endKey)
+					return Void();
+			}
+
 			// Read everything from beginKey to endKey, write it to an output file, run the output file processor, and
 			// then set on_done. If we are still writing after X seconds, end the output file and insert a new backup_range
 			// task for the remainder.
@@ -1018,13 +1525,14 @@ namespace fileBackup {
 
 			state bool done = false;
 			state int64_t nrKeys = 0;
+			state bool computeDigest = CLIENT_KNOBS->BACKUP_INCREMENTAL_SNAPSHOTS;
+			state MD5_CTX digest;
 
 			loop{
 				state RangeResultWithVersion values;
 				try {
 					RangeResultWithVersion _values = waitNext(results.getFuture());
 					values = _values;
-					lock->release(values.first.expectedSize());
 				} catch(Error &e) {
 					if(e.code() == error_code_end_of_stream)
 						done = true;
@@ -1039,7 +1547,9 @@ namespace fileBackup {
 						state Key nextKey = done ? endKey : keyAfter(lastKey);
 						Void _ = wait(rangeFile.writeKey(nextKey));
 
-						bool usedFile = wait(finishRangeFile(outFile, cx, task, taskBucket, KeyRangeRef(beginKey, nextKey), outVersion));
+						bool usedFile = wait(finishRangeFile(outFile, cx, task, taskBucket, KeyRangeRef(beginKey, nextKey), outVersion, rangeFile.compressBlocks, computeDigest ? finishDigest(&digest) : std::string()));
+						FileBackupAgent::s_rangeStats.files_written++;
+						FileBackupAgent::s_rangeStats.bytes_written += outFile->size();
 						TraceEvent("FileBackupWroteRangeFile")
 							.detail("BackupUID", backup.getUid())
 							.detail("Size", outFile->size())
@@ -1065,8 +1575,10 @@ namespace fileBackup {
 					outFile = f;
 
 					// Initialize range file writer and write begin key
-					rangeFile = RangeFileWriter(outFile, blockSize);
+					rangeFile = RangeFileWriter(outFile, blockSize, CLIENT_KNOBS->BACKUP_COMPRESS_FILE_BLOCKS);
 					Void _ = wait(rangeFile.writeKey(beginKey));
+					if(computeDigest)
+						MD5_Init(&digest);
 				}
 
 				// write kvData to file, update lastKey and key count
@@ -1075,9 +1587,15 @@ namespace fileBackup {
 					for (; i < values.first.size(); ++i) {
 						Void _ = wait(rangeFile.writeKV(values.first[i].key, values.first[i].value));
 					}
+					if(computeDigest)
+						digestKVs(&digest, values.first);
 					lastKey = values.first.back().key;
 					nrKeys += values.first.size();
+					FileBackupAgent::s_rangeStats.keys_written += values.first.size();
 				}
+
+				// Release only once written so that reading ahead is limited by how fast the container accepts the file
+				lock->release(values.first.expectedSize());
 			}
 		}
 
@@ -1087,7 +1605,16 @@ namespace fileBackup {
 			state Key nextKey = Params.beginKey().get(task);
 			state Key endKey = Params.endKey().get(task);
 
-			state Standalone<VectorRef<KeyRef>> keys = wait(getBlockOfShards(tr, nextKey, endKey, CLIENT_KNOBS->BACKUP_SHARD_TASK_LIMIT));
+			state Standalone<VectorRef<KeyRef>> keys;
+			if (Params.splitKeys().exists(task)) {
+				std::vector<Key> splits = BinaryReader::fromStringRef<std::vector<Key>>(Params.splitKeys().get(task), IncludeVersion());
+				for (auto &k : splits) {
+					keys.push_back_deep(keys.arena(), k);
+				}
+			} else {
+				Standalone<VectorRef<KeyRef>> shardKeys = wait(getBlockOfShards(tr, nextKey, endKey, CLIENT_KNOBS->BACKUP_SHARD_TASK_LIMIT));
+				keys = shardKeys;
+			}
 
 			std::vector<Future<Key>> addTaskVector;
 			for (int idx = 0; idx < keys.size(); ++idx) {
@@ -1695,7 +2222,7 @@ namespace fileBackup {
 			// Block size must be at least large enough for 1 max size key, 1 max size value, and overhead, so conservatively 125k.
 			state int blockSize = BUGGIFY ? g_random->randomInt(125e3, 4e6) : CLIENT_KNOBS->BACKUP_LOGFILE_BLOCK_SIZE;
 			state Reference<IBackupFile> outFile = wait(bc->writeLogFile(beginVersion, endVersion, blockSize));
-			state LogFileWriter logFile(outFile, blockSize);
+			state LogFileWriter logFile(outFile, blockSize, CLIENT_KNOBS->BACKUP_COMPRESS_FILE_BLOCKS);
 			state size_t idx;
 
 			state PromiseStream<RangeResultWithVersion> results;
@@ -1740,6 +2267,7 @@ namespace fileBackup {
 			// Make sure this task is still alive, if it's not then the data read above could be incomplete.
 			Void _ = wait(taskBucket->keepRunning(cx, task));
 
+			Void _ = wait(logFile.flush());
 			Void _ = wait(outFile->finish());
 
 			TraceEvent("FileBackupWroteLogFile")
@@ -2063,6 +2591,7 @@ namespace fileBackup {
 			state std::map<Key, BackupConfig::RangeSlice> localmap;
 			state Key startKey;
 			state int batchSize = BUGGIFY ? 1 : 1000000;
+			state bool compressedBlocks = false;
 
 			loop {
 				try {
@@ -2076,6 +2605,8 @@ namespace fileBackup {
 						Void _ = wait(store(config.backupContainer().getOrThrow(tr), bc));
 					}
 
+					Void _ = wait(store(config.snapshotCompressedBlocks().getD(tr, false), compressedBlocks));
+
 					BackupConfig::RangeFileMapT::PairsType rangeresults = wait(config.snapshotRangeFileMap().getRange(tr, startKey, {}, batchSize));
 
 					for(auto &p : rangeresults) {
@@ -2093,6 +2624,7 @@ namespace fileBackup {
 			}
 
 			std::vector<std::string> files;
+			state std::vector<std::pair<Key, BackupConfig::RangeSlice>> chosen;
 			state Version maxVer = 0;
 			state Version minVer = std::numeric_limits<Version>::max();
 			state int64_t totalBytes = 0;
@@ -2107,6 +2639,8 @@ namespace fileBackup {
 
 					// Add file to final file list
 					files.push_back(r.fileName);
+					if(CLIENT_KNOBS->BACKUP_INCREMENTAL_SNAPSHOTS)
+						chosen.push_back(*i);
 
 					// Update version range seen
 					if(r.version < minVer)
@@ -2129,7 +2663,38 @@ namespace fileBackup {
 			}
 
 			Params.endVersion().set(task, maxVer);
-			Void _ = wait(bc->writeKeyspaceSnapshotFile(files, totalBytes));
+			Void _ = wait(bc->writeKeyspaceSnapshotFile(files, totalBytes, compressedBlocks));
+
+			// Keep the files of this snapshot for the range tasks of the next one to reuse, replacing the last snapshot's, which must
+			// not be reused once this snapshot allows expiring the data before it.  If this task is restarted part way through, the
+			// next execution starts over.
+			state int next = 0;
+			state int batchEnd;
+			state bool cleared = false;
+			state int writeBatchSize = BUGGIFY ? 1 : 10000;
+			tr->reset();
+			while(next < chosen.size() || !cleared) {
+				try {
+					tr->setOption(FDBTransactionOptions::ACCESS_SYSTEM_KEYS);
+					tr->setOption(FDBTransactionOptions::LOCK_AWARE);
+					Void _ = wait(taskBucket->keepRunning(tr, task));
+
+					if(!cleared) {
+						config.previousSnapshotRangeFileMap().clear(tr);
+						config.previousSnapshotCompressedBlocks().set(tr, compressedBlocks);
+					}
+					batchEnd = std::min<int>(chosen.size(), next + writeBatchSize);
+					for(int j = next; j < batchEnd; j++)
+						config.previousSnapshotRangeFileMap().set(tr, chosen[j].first, chosen[j].second);
+
+					Void _ = wait(tr->commit());
+					cleared = true;
+					next = batchEnd;
+					tr->reset();
+				} catch(Error &e) {
+					Void _ = wait(tr->onError(e));
+				}
+			}
 
 			TraceEvent(SevInfo, "FileBackupWroteSnapshotManifest")
 				.detail("BackupUID", config.getUid())
@@ -2444,37 +3009,61 @@ namespace fileBackup {
 			}
 			fileRange = KeyRangeRef(std::max(fileRange.begin, restoreRange.get().begin).removePrefix(removePrefix.get()).withPrefix(addPrefix.get()),fileEnd);
 
-			state int start = 0;
-			state int end = data.size();
+			// Write the block in transactions of about dataSizeLimit bytes.  They cover disjoint key ranges so they are
+			// committed concurrently rather than one after another.
 			state int dataSizeLimit = BUGGIFY ? g_random->randomInt(256 * 1024, 10e6) : CLIENT_KNOBS->RESTORE_WRITE_TX_SIZE;
+			state Reference<FlowLock> commitLock(new FlowLock(CLIENT_KNOBS->RESTORE_WRITE_TX_PARALLELISM));
+			state std::vector<Future<Void>> writes;
+			int start = 0;
+			while(start < data.size()) {
+				int txBytes = 0;
+				int iend = start;
+				for(; iend < data.size() && txBytes < dataSizeLimit; ++iend) {
+					txBytes += data[iend].key.expectedSize();
+					txBytes += data[iend].value.expectedSize();
+				}
+				writes.push_back(writeChunk(cx, taskBucket, task, commitLock, data, start, iend, fileRange, originalFileRange, addPrefix.get(), removePrefix.get()));
+				start = iend;
+			}
+			if(data.size() == 0) {
+				// Still clear the file's range
+				writes.push_back(writeChunk(cx, taskBucket, task, commitLock, data, 0, 0, fileRange, originalFileRange, addPrefix.get(), removePrefix.get()));
+			}
+
+			Void _ = wait(waitForAll(writes));
+			return Void();
+		}
+
+		// Clears the part of fileRange covered by data[start, end) and sets those pairs in one transaction, or in two halves
+		// if that is too large.  data must stay alive until it is done.
+		ACTOR static Future<Void> writeChunk(Database cx, Reference<TaskBucket> taskBucket, Reference<Task> task, Reference<FlowLock> commitLock, VectorRef<KeyValueRef> data, int start, int end, KeyRange fileRange, KeyRange originalFileRange, Key addPrefix, Key removePrefix) {
+			state RestoreConfig restore(task);
+			state RestoreFile rangeFile = Params.inputFile().get(task);
+			state Reference<ReadYourWritesTransaction> tr(new ReadYourWritesTransaction(cx));
+			state bool split = false;
+
+			// Clear the range we are about to set.
+			// If start == 0 then use fileBegin for the start of the range, else data[start]
+			// If end == data.size() then use fileEnd for the end of the range, else data[end]
+			state KeyRange trRange = KeyRangeRef((start == 0 ) ? fileRange.begin : data[start].key.removePrefix(removePrefix).withPrefix(addPrefix)
+											   , (end == data.size()) ? fileRange.end : data[end].key.removePrefix(removePrefix).withPrefix(addPrefix));
+
+			Void _ = wait(commitLock->take());
+			state FlowLock::Releaser releaser(*commitLock);
 
-			tr->reset();
 			loop {
 				try {
 					tr->setOption(FDBTransactionOptions::ACCESS_SYSTEM_KEYS);
 					tr->setOption(FDBTransactionOptions::LOCK_AWARE);
 
-					state int i = start;
-					state int txBytes = 0;
-					state int iend = start;
-
-					// find iend that results in the desired transaction size
-					for(; iend < end && txBytes < dataSizeLimit; ++iend) {
-						txBytes += data[iend].key.expectedSize();
-						txBytes += data[iend].value.expectedSize();
-					}
-
-					// Clear the range we are about to set.
-					// If start == 0 then use fileBegin for the start of the range, else data[start]
-					// If iend == end then use fileEnd for the end of the range, else data[iend]
-					state KeyRange trRange = KeyRangeRef((start == 0 ) ? fileRange.begin : data[start].key.removePrefix(removePrefix.get()).withPrefix(addPrefix.get())
-													   , (iend == end) ? fileRange.end   : data[iend ].key.removePrefix(removePrefix.get()).withPrefix(addPrefix.get()));
-
 					tr->clear(trRange);
 
-					for(; i < iend; ++i) {
+					state int txBytes = 0;
+					for(int i = start; i < end; ++i) {
 						tr->setOption(FDBTransactionOptions::NEXT_WRITE_NO_WRITE_CONFLICT_RANGE);
-						tr->set(data[i].key.removePrefix(removePrefix.get()).withPrefix(addPrefix.get()), data[i].value);
+						tr->set(data[i].key.removePrefix(removePrefix).withPrefix(addPrefix), data[i].value);
+						txBytes += data[i].key.expectedSize();
+						txBytes += data[i].value.expectedSize();
 					}
 
 					// Add to bytes written count
@@ -2493,32 +3082,35 @@ namespace fileBackup {
 						.detail("FileName", rangeFile.fileName)
 						.detail("FileVersion", rangeFile.version)
 						.detail("FileSize", rangeFile.fileSize)
-						.detail("ReadOffset", readOffset)
-						.detail("ReadLen", readLen)
+						.detail("ReadOffset", Params.readOffset().get(task))
+						.detail("ReadLen", Params.readLen().get(task))
 						.detail("CommitVersion", tr->getCommittedVersion())
 						.detail("BeginRange", printable(trRange.begin))
 						.detail("EndRange", printable(trRange.end))
 						.detail("StartIndex", start)
-						.detail("EndIndex", i)
+						.detail("EndIndex", end)
 						.detail("DataSize", data.size())
 						.detail("Bytes", txBytes)
 						.detail("OriginalFileRange", printable(originalFileRange))
-						.detail("TaskInstance", (uint64_t)this)
 						.suppressFor(60, true);
 
-					// Commit succeeded, so advance starting point
-					start = i;
-
-					if(start == end)
-						return Void();
-					tr->reset();
+					return Void();
 				} catch(Error &e) {
-					if(e.code() == error_code_transaction_too_large)
-						dataSizeLimit /= 2;
+					if(e.code() == error_code_transaction_too_large && end - start > 1)
+						split = true;
 					else
 						Void _ = wait(tr->onError(e));
 				}
+				if(split)
+					break;
 			}
+
+			// Give up our turn before waiting on the halves, which need turns of their own
+			releaser.release();
+			state int mid = start + (end - start) / 2;
+			Void _ = wait(writeChunk(cx, taskBucket, task, commitLock, data, start, mid, fileRange, originalFileRange, addPrefix, removePrefix) &&
+			              writeChunk(cx, taskBucket, task, commitLock, data, mid, end, fileRange, originalFileRange, addPrefix, removePrefix));
+			return Void();
 		}
 
 		ACTOR static Future<Void> _finish(Reference<ReadYourWritesTransaction> tr, Reference<TaskBucket> taskBucket, Reference<FutureBucket> futureBucket, Reference<Task> task) {
@@ -2619,22 +3211,45 @@ namespace fileBackup {
 			state Reference<IAsyncFile> inFile = wait(bc->readFile(logFile.fileName));
 			state Standalone<VectorRef<KeyValueRef>> data = wait(decodeLogFileBlock(inFile, readOffset, readLen));
 
-			state int start = 0;
-			state int end = data.size();
+			// The log keys are all distinct, so as in RestoreRangeTaskFunc the transactions are committed concurrently.
+			// Their order does not matter since applyMutations replays the log in version order.
 			state int dataSizeLimit = BUGGIFY ? g_random->randomInt(256 * 1024, 10e6) : CLIENT_KNOBS->RESTORE_WRITE_TX_SIZE;
+			state Reference<FlowLock> commitLock(new FlowLock(CLIENT_KNOBS->RESTORE_WRITE_TX_PARALLELISM));
+			state std::vector<Future<Void>> writes;
+			int start = 0;
+			while(start < data.size()) {
+				int txBytes = 0;
+				int iend = start;
+				for(; iend < data.size() && txBytes < dataSizeLimit; ++iend) {
+					txBytes += data[iend].key.expectedSize() + mutationLogPrefix.size();
+					txBytes += data[iend].value.expectedSize();
+				}
+				writes.push_back(writeChunk(cx, taskBucket, task, commitLock, data, start, iend, mutationLogPrefix));
+				start = iend;
+			}
+
+			Void _ = wait(waitForAll(writes));
+			return Void();
+		}
+
+		// Writes data[start, end) under mutationLogPrefix in one transaction, or in two halves if that is too large.
+		// data must stay alive until it is done.
+		ACTOR static Future<Void> writeChunk(Database cx, Reference<TaskBucket> taskBucket, Reference<Task> task, Reference<FlowLock> commitLock, VectorRef<KeyValueRef> data, int start, int end, Key mutationLogPrefix) {
+			state RestoreConfig restore(task);
+			state RestoreFile logFile = Params.inputFile().get(task);
+			state Reference<ReadYourWritesTransaction> tr(new ReadYourWritesTransaction(cx));
+			state bool split = false;
+
+			Void _ = wait(commitLock->take());
+			state FlowLock::Releaser releaser(*commitLock);
 
-			tr->reset();
 			loop {
 				try {
-					if(start == end)
-						return Void();
-
 					tr->setOption(FDBTransactionOptions::ACCESS_SYSTEM_KEYS);
 					tr->setOption(FDBTransactionOptions::LOCK_AWARE);
 
-					state int i = start;
 					state int txBytes = 0;
-					for(; i < end && txBytes < dataSizeLimit; ++i) {
+					for(int i = start; i < end; ++i) {
 						Key k = data[i].key.withPrefix(mutationLogPrefix);
 						ValueRef v = data[i].value;
 						tr->set(k, v);
@@ -2658,26 +3273,32 @@ namespace fileBackup {
 						.detail("FileBeginVersion", logFile.version)
 						.detail("FileEndVersion", logFile.endVersion)
 						.detail("FileSize", logFile.fileSize)
-						.detail("ReadOffset", readOffset)
-						.detail("ReadLen", readLen)
+						.detail("ReadOffset", Params.readOffset().get(task))
+						.detail("ReadLen", Params.readLen().get(task))
 						.detail("CommitVersion", tr->getCommittedVersion())
 						.detail("StartIndex", start)
-						.detail("EndIndex", i)
+						.detail("EndIndex", end)
 						.detail("DataSize", data.size())
 						.detail("Bytes", txBytes)
-						.detail("TaskInstance", (uint64_t)this)
 						.suppressFor(60, true);
 
-					// Commit succeeded, so advance starting point
-					start = i;
-					tr->reset();
+					return Void();
 				} catch(Error &e) {
-					if(e.code() == error_code_transaction_too_large)
-						dataSizeLimit /= 2;
+					if(e.code() == error_code_transaction_too_large && end - start > 1)
+						split = true;
 					else
 						Void _ = wait(tr->onError(e));
 				}
+				if(split)
+					break;
 			}
+
+			// Give up our turn before waiting on the halves, which need turns of their own
+			releaser.release();
+			state int mid = start + (end - start) / 2;
+			Void _ = wait(writeChunk(cx, taskBucket, task, commitLock, data, start, mid, mutationLogPrefix) &&
+			              writeChunk(cx, taskBucket, task, commitLock, data, mid, end, mutationLogPrefix));
+			return Void();
 		}
 
 		ACTOR static Future<Void> _finish(Reference<ReadYourWritesTransaction> tr, Reference<TaskBucket> taskBucket, Reference<FutureBucket> futureBucket, Reference<Task> task) {
@@ -3279,6 +3900,20 @@ namespace fileBackup {
 	REGISTER_TASKFUNC(StartFullRestoreTaskFunc);
 }
 
+// Writes kvs, which must be sorted and within range, as a complete range file covering range and finishes file.  This is how
+// storage servers exporting their shards write files in exactly the format backups do.
+ACTOR Future<Void> writeRangeFileKVs(Reference<IBackupFile> file, int blockSize, KeyRange range, Standalone<VectorRef<KeyValueRef>> kvs, bool compressBlocks) {
+	state fileBackup::RangeFileWriter rangeFile(file, blockSize, compressBlocks);
+	Void _ = wait(rangeFile.writeKey(range.begin));
+	state int i = 0;
+	for(; i < kvs.size(); ++i) {
+		Void _ = wait(rangeFile.writeKV(kvs[i].key, kvs[i].value));
+	}
+	Void _ = wait(rangeFile.writeKey(range.end));
+	Void _ = wait(file->finish());
+	return Void();
+}
+
 struct LogInfo : public ReferenceCounted<LogInfo> {
 	std::string fileName;
 	Reference<IAsyncFile> logFile;
@@ -3938,11 +4573,69 @@ public:
 		Version ver = wait( restore(backupAgent, cx, tagName, KeyRef(bc->getURL()), true, -1, true, range, addPrefix, removePrefix, true, randomUid) );
 		return ver;
 	}
+
+	// Keeps the pins of tr's read version on ranges from running out, until cancelled
+	ACTOR static Future<Void> renewSnapshotPins(Transaction* tr, Standalone<VectorRef<KeyRangeRef>> ranges) {
+		loop {
+			Void _ = wait(delay(CLIENT_KNOBS->EXPORT_SNAPSHOT_RENEW_INTERVAL));
+			state std::vector<Future<Void>> pins;
+			for(auto &r : ranges)
+				pins.push_back(tr->pinSnapshot(r, CLIENT_KNOBS->EXPORT_SNAPSHOT_LEASE));
+			Void _ = wait(waitForAll(pins));
+		}
+	}
+
+	ACTOR static Future<Version> exportSnapshot(Database cx, Key url, Standalone<VectorRef<KeyRangeRef>> ranges) {
+		state Reference<IBackupContainer> bc = IBackupContainer::openContainer(url.toString());
+		Void _ = wait(timeoutError(bc->create(), 30));
+
+		state Transaction tr(cx);
+		state Future<Void> renewer;
+		loop {
+			try {
+				tr.setOption(FDBTransactionOptions::LOCK_AWARE);
+				state Version version = wait(tr.getReadVersion());
+
+				// Pin right away, while the storage servers still hold the version in memory
+				state std::vector<Future<Void>> pins;
+				for(auto &r : ranges)
+					pins.push_back(tr.pinSnapshot(r, CLIENT_KNOBS->EXPORT_SNAPSHOT_LEASE));
+				Void _ = wait(waitForAll(pins));
+
+				renewer = renewSnapshotPins(&tr, ranges);
+				state std::vector<Future<ExportRangeReply>> exports;
+				for(auto &r : ranges)
+					exports.push_back(tr.exportRange(r, bc->getURL(), CLIENT_KNOBS->BACKUP_COMPRESS_FILE_BLOCKS));
+				Void _ = wait(waitForAll(exports) || renewer);
+				renewer.cancel();
+
+				state std::vector<std::string> fileNames;
+				state int64_t totalBytes = 0;
+				for(auto &e : exports) {
+					fileNames.insert(fileNames.end(), e.get().fileNames.begin(), e.get().fileNames.end());
+					totalBytes += e.get().bytes;
+				}
+				Void _ = wait(bc->writeKeyspaceSnapshotFile(fileNames, totalBytes, CLIENT_KNOBS->BACKUP_COMPRESS_FILE_BLOCKS));
+
+				TraceEvent("FileBackupExportedSnapshot")
+					.detail("URL", bc->getURL())
+					.detail("Version", version)
+					.detail("Files", fileNames.size())
+					.detail("Bytes", totalBytes);
+				return version;
+			} catch(Error &e) {
+				renewer.cancel();
+				TraceEvent(SevWarn, "FileBackupExportSnapshotError").error(e);
+				Void _ = wait(tr.onError(e));
+			}
+		}
+	}
 };
 
 const std::string BackupAgentBase::defaultTagName = "default";
 const int BackupAgentBase::logHeaderSize = 12;
 const int FileBackupAgent::dataFooterSize = 20;
+FileBackupAgent::RangeStats FileBackupAgent::s_rangeStats;
 
 Future<Version> FileBackupAgent::restore(Database cx, Key tagName, Key url, bool waitForComplete, Version targetVersion, bool verbose, KeyRange range, Key addPrefix, Key removePrefix, bool lockDB) {
 	return FileBackupAgentImpl::restore(this, cx, tagName, url, waitForComplete, targetVersion, verbose, range, addPrefix, removePrefix, lockDB, g_random->randomUniqueID());
@@ -3998,3 +4691,7 @@ Future<int> FileBackupAgent::waitBackup(Database cx, std::string tagName, bool s
 	return FileBackupAgentImpl::waitBackup(this, cx, tagName, stopWhenDone);
 }
 
+Future<Version> FileBackupAgent::exportSnapshot(Database cx, Key url, Standalone<VectorRef<KeyRangeRef>> ranges) {
+	return FileBackupAgentImpl::exportSnapshot(cx, url, ranges);
+}
+
@@ -46,6 +46,10 @@ public:
 	virtual ThreadFuture<Standalone<RangeResultRef>> getRange( const KeyRangeRef& keys, GetRangeLimits limits, bool snapshot=false, bool reverse=false) = 0;
 	virtual ThreadFuture<Standalone<VectorRef<const char*>>> getAddressesForKey(const KeyRef& key) = 0;
 	virtual ThreadFuture<Standalone<StringRef>> getVersionstamp() = 0;
+	virtual ThreadFuture<int64_t> getEstimatedRangeSizeBytes(const KeyRangeRef& keys) = 0;
+	virtual ThreadFuture<Standalone<VectorRef<KeyRef>>> getRangeSplitPoints(const KeyRangeRef& keys, int64_t chunkSize) = 0;
+	virtual ThreadFuture<Optional<Value>> getLargeValue(const KeyRef& key, int64_t offset, int length, bool snapshot=false) = 0;
+	virtual ThreadFuture<int64_t> getLargeValueSize(const KeyRef& key, bool snapshot=false) = 0;
 
 	virtual void addReadConflictRange(const KeyRangeRef& keys) = 0;
 
@@ -54,6 +58,8 @@ public:
 	virtual void clear(const KeyRef& begin, const KeyRef& end) = 0;
 	virtual void clear(const KeyRangeRef& range) = 0;
 	virtual void clear(const KeyRef& key) = 0;
+	virtual void setLargeValue(const KeyRef& key, const ValueRef& value) = 0;
+	virtual void clearLargeValue(const KeyRef& key) = 0;
 
 	virtual ThreadFuture<Void> watch(const KeyRef& key) = 0;
 
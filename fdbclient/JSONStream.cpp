@@ -0,0 +1,221 @@
+/*
+ * JSONStream.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JSONStream.h"
+#include "fdbclient/json_spirit/json_spirit_writer_template.h"
+#include "fdbclient/json_spirit/json_spirit_reader_template.h"
+#include "flow/UnitTest.h"
+#include "fdbrpc/rapidjson/writer.h"
+#include "fdbrpc/rapidjson/reader.h"
+#include "fdbrpc/rapidjson/stringbuffer.h"
+#include <limits>
+#include <vector>
+
+typedef rapidjson::Writer<rapidjson::StringBuffer, rapidjson::UTF8<>, rapidjson::UTF8<>, rapidjson::CrtAllocator, rapidjson::kWriteNanAndInfFlag> JSONWriter;
+
+static void writeValue( JSONWriter& w, json_spirit::mValue const& v ) {
+	switch( v.type() ) {
+		case json_spirit::obj_type:
+			w.StartObject();
+			for(auto& field : v.get_obj()) {
+				w.Key( field.first.c_str(), (rapidjson::SizeType)field.first.size() );
+				writeValue( w, field.second );
+			}
+			w.EndObject();
+			break;
+		case json_spirit::array_type:
+			w.StartArray();
+			for(auto& element : v.get_array())
+				writeValue( w, element );
+			w.EndArray();
+			break;
+		case json_spirit::str_type:
+			w.String( v.get_str().c_str(), (rapidjson::SizeType)v.get_str().size() );
+			break;
+		case json_spirit::bool_type:
+			w.Bool( v.get_bool() );
+			break;
+		case json_spirit::int_type:
+			if( v.is_uint64() )
+				w.Uint64( v.get_uint64() );
+			else
+				w.Int64( v.get_int64() );
+			break;
+		case json_spirit::real_type:
+			w.Double( v.get_real() );
+			break;
+		case json_spirit::null_type:
+			w.Null();
+			break;
+	}
+}
+
+std::string writeJSON( json_spirit::mValue const& value ) {
+	rapidjson::StringBuffer buffer;
+	JSONWriter w( buffer );
+	writeValue( w, value );
+	return std::string( buffer.GetString(), buffer.GetSize() );
+}
+
+// Builds a json_spirit value from the events of rapidjson's SAX reader.  Each value is constructed in place in its parent, so
+// nothing is copied on the way.
+struct JSONValueBuilder : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, JSONValueBuilder> {
+	json_spirit::mValue& root;
+	std::vector<json_spirit::mValue*> open;  // The objects and arrays not yet ended, outermost first
+	std::string key;
+
+	explicit JSONValueBuilder( json_spirit::mValue& root ) : root(root) {}
+
+	// Neither an object's fields nor an array's elements move while one of them is open, since nothing is added to a
+	// container until its last element has ended
+	json_spirit::mValue* add( json_spirit::mValue const& v ) {
+		if( open.empty() ) {
+			root = v;
+			return &root;
+		}
+		json_spirit::mValue& parent = *open.back();
+		if( parent.type() == json_spirit::obj_type ) {
+			json_spirit::mValue& field = parent.get_obj()[key];
+			field = v;
+			return &field;
+		}
+		parent.get_array().push_back( v );
+		return &parent.get_array().back();
+	}
+
+	bool Null() { add( json_spirit::mValue() ); return true; }
+	bool Bool( bool b ) { add( json_spirit::mValue(b) ); return true; }
+	bool Int( int i ) { add( json_spirit::mValue( (int64_t)i ) ); return true; }
+	bool Uint( unsigned u ) { add( json_spirit::mValue( (int64_t)u ) ); return true; }
+	bool Int64( int64_t i ) { add( json_spirit::mValue(i) ); return true; }
+	bool Uint64( uint64_t u ) {
+		// As json_spirit reads them, only integers too large for an int64_t are unsigned
+		if( u > (uint64_t)std::numeric_limits<int64_t>::max() )
+			add( json_spirit::mValue(u) );
+		else
+			add( json_spirit::mValue( (int64_t)u ) );
+		return true;
+	}
+	bool Double( double d ) { add( json_spirit::mValue(d) ); return true; }
+	bool String( const char* str, rapidjson::SizeType length, bool copy ) { add( json_spirit::mValue( std::string(str, length) ) ); return true; }
+	bool Key( const char* str, rapidjson::SizeType length, bool copy ) { key.assign( str, length ); return true; }
+	bool StartObject() { open.push_back( add( json_spirit::mObject() ) ); return true; }
+	bool EndObject( rapidjson::SizeType ) { open.pop_back(); return true; }
+	bool StartArray() { open.push_back( add( json_spirit::mArray() ) ); return true; }
+	bool EndArray( rapidjson::SizeType ) { open.pop_back(); return true; }
+};
+
+bool readJSON( std::string const& text, json_spirit::mValue& value ) {
+	value = json_spirit::mValue();
+	JSONValueBuilder builder( value );
+	rapidjson::Reader reader;
+	rapidjson::StringStream stream( text.c_str() );
+	return !reader.Parse<rapidjson::kParseNanAndInfFlag | rapidjson::kParseFullPrecisionFlag>( stream, builder ).IsError();
+}
+
+TEST_CASE("fdbclient/JSONStream/roundTrip") {
+	json_spirit::mValue v;
+	std::string text = "{\"a\":[1,2.5,{\"b\":null,\"c\":true}],\"big\":18446744073709551615,\"neg\":-5,\"s\":\"x\\u00e9\\n\"}";
+	ASSERT( readJSON( text, v ) );
+	ASSERT( v.get_obj().at("big").is_uint64() && v.get_obj().at("neg").get_int64() == -5 );
+	ASSERT( v.get_obj().at("a").get_array()[1].type() == json_spirit::real_type );
+
+	json_spirit::mValue fromSpirit, fromRapid;
+	json_spirit::read_string( writeJSON(v), fromSpirit );
+	ASSERT( fromSpirit == v );
+	// json_spirit escapes each byte of a non-ASCII character separately unless told not to
+	ASSERT( readJSON( json_spirit::write_string( v, json_spirit::Output_options::raw_utf8 ), fromRapid ) && fromRapid == v );
+
+	ASSERT( !readJSON( "{\"a\":", v ) );
+	ASSERT( !readJSON( "", v ) );
+	return Void();
+}
+
+// A status document shaped like that of a cluster of the given number of processes, each with a few roles
+static json_spirit::mValue syntheticStatus( int processes ) {
+	json_spirit::mObject processMap;
+	for(int i = 0; i < processes; i++) {
+		json_spirit::mObject process;
+		process["address"] = format("10.0.%d.%d:4500", i / 256, i % 256);
+		process["machine_id"] = format("%016llx", (long long)i * 0x9e3779b97f4a7c15LL);
+		process["excluded"] = false;
+		json_spirit::mObject cpu;
+		cpu["usage_cores"] = 0.01 * i;
+		process["cpu"] = cpu;
+		json_spirit::mObject memory;
+		memory["used_bytes"] = (int64_t)i << 20;
+		memory["limit_bytes"] = (int64_t)8 << 30;
+		process["memory"] = memory;
+		json_spirit::mArray roles;
+		for(int r = 0; r < 3; r++) {
+			json_spirit::mObject role;
+			role["role"] = r ? "storage" : "log";
+			role["id"] = format("%016x", i * 3 + r);
+			role["kvstore_used_bytes"] = (int64_t)i * 123456789;
+			json_spirit::mObject rate;
+			rate["hz"] = 1.5 * i;
+			rate["counter"] = (int64_t)i * 99;
+			rate["roughness"] = 0.25;
+			role["input_bytes"] = rate;
+			role["durable_bytes"] = rate;
+			roles.push_back( role );
+		}
+		process["roles"] = roles;
+		processMap[format("%032x", i)] = process;
+	}
+	json_spirit::mObject cluster;
+	cluster["processes"] = processMap;
+	json_spirit::mObject status;
+	status["cluster"] = cluster;
+	return status;
+}
+
+TEST_CASE("fdbclient/perf/statusJSON") {
+	json_spirit::mValue status = syntheticStatus( 1000 );
+	const int N = 5;
+
+	double start = timer();
+	std::string spiritText;
+	for(int i = 0; i < N; i++)
+		spiritText = json_spirit::write_string( status );
+	double spiritWrite = (timer() - start) / N;
+
+	start = timer();
+	std::string text;
+	for(int i = 0; i < N; i++)
+		text = writeJSON( status );
+	double rapidWrite = (timer() - start) / N;
+
+	json_spirit::mValue parsed;
+	start = timer();
+	for(int i = 0; i < N; i++)
+		json_spirit::read_string( spiritText, parsed );
+	double spiritRead = (timer() - start) / N;
+
+	start = timer();
+	for(int i = 0; i < N; i++)
+		ASSERT( readJSON( text, parsed ) );
+	double rapidRead = (timer() - start) / N;
+	ASSERT( parsed == status );
+
+	printf("1000 process status, %d bytes: write %.1f ms (json_spirit %.1f ms), read %.1f ms (json_spirit %.1f ms)\n",
+		(int)text.size(), rapidWrite * 1e3, spiritWrite * 1e3, rapidRead * 1e3, spiritRead * 1e3);
+	return Void();
+}
@@ -0,0 +1,38 @@
+/*
+ * JSONStream.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FDBCLIENT_JSONSTREAM_H
+#define FDBCLIENT_JSONSTREAM_H
+#pragma once
+
+#include "fdbclient/json_spirit/json_spirit_value.h"
+#include <string>
+
+// Serialize and parse json_spirit values with rapidjson's streaming writer and SAX reader, which are many times faster than
+// json_spirit's own write_string() and read_string() and don't build intermediate copies.  Status documents go through these
+// whenever they are sent between processes or handed to a client.
+
+// Compact JSON, with strings written as raw UTF-8
+std::string writeJSON( json_spirit::mValue const& value );
+
+// Returns false if text is not valid JSON, in which case value holds whatever was parsed before the error
+bool readJSON( std::string const& text, json_spirit::mValue& value );
+
+#endif
@@ -23,6 +23,7 @@
 #include "CommitTransaction.h"
 #include "FDBTypes.h"
 #include "ReadYourWrites.h"
+#include "flow/UnitTest.h"
 
 void KeyRangeActorMap::getRangesAffectedByInsertion( const KeyRangeRef& keys, vector< KeyRange >& affectedRanges ) {
 	auto s = map.rangeContaining( keys.begin );
@@ -215,3 +216,77 @@ ACTOR Future<Void> krmSetRangeCoalescing( Transaction *tr, Key mapPrefix, KeyRan
 
 	return Void();
 }
+
+// Sorted, disjoint ranges of the keys 0000..9999, some adjacent and some empty
+static std::vector<std::pair<KeyRangeRef, int>> randomSortedRanges( Arena& arena, int count, int maxValue ) {
+	std::vector<int> points;
+	for(int i = 0; i < 2*count; i++)
+		points.push_back( g_random->randomInt(0, 10000) );
+	std::sort( points.begin(), points.end() );
+	std::vector<std::pair<KeyRangeRef, int>> ranges;
+	for(int i = 0; i < count; i++) {
+		int begin = points[2*i], end = (i+1 < count && g_random->coinflip()) ? points[2*i+2] : points[2*i+1];
+		ranges.push_back( std::make_pair( KeyRangeRef( StringRef(arena, format("%04d", begin)), StringRef(arena, format("%04d", end)) ), g_random->randomInt(0, maxValue) ) );
+	}
+	return ranges;
+}
+
+template <class Map>
+static bool sameRanges( Map& a, Map& b ) {
+	auto ra = a.ranges(), rb = b.ranges();
+	auto ia = ra.begin(), ib = rb.begin();
+	for(; ia != ra.end() && ib != rb.end(); ++ia, ++ib)
+		if( ia->begin() != ib->begin() || ia->value() != ib->value() )
+			return false;
+	return ia == ra.end() && ib == rb.end();
+}
+
+TEST_CASE("fdbclient/KeyRangeMap/bulk insert") {
+	for(int test = 0; test < 1000; test++) {
+		KeyRangeMap<int> one, bulk;
+		CoalescedKeyRangeMap<int> coalescedOne, coalescedBulk;
+		for(int round = 0; round < 5; round++) {
+			Arena arena;
+			auto ranges = randomSortedRanges( arena, g_random->randomInt(0, 50), g_random->randomInt(1, 4) );
+			for(auto& r : ranges) {
+				one.insert( r.first, r.second );
+				coalescedOne.insert( r.first, r.second );
+			}
+			bulk.insert( ranges );
+			coalescedBulk.insert( ranges );
+			ASSERT( sameRanges( one, bulk ) );
+			ASSERT( sameRanges( coalescedOne, coalescedBulk ) );
+			coalescedBulk.validateCoalesced();
+		}
+	}
+	return Void();
+}
+
+TEST_CASE("fdbclient/KeyRangeMap/bulk insert performance") {
+	// Not a correctness test; compares inserting the same ranges one at a time and in bulk
+	Arena arena;
+	std::vector<std::pair<KeyRangeRef, int>> ranges;
+	for(int i = 0; i < 200000; i++)
+		ranges.push_back( std::make_pair( KeyRangeRef( StringRef(arena, format("%08d", 2*i)), StringRef(arena, format("%08d", 2*i+1)) ), i%3 ) );
+
+	KeyRangeMap<int> one, bulk;
+	double start = timer();
+	for(auto& r : ranges)
+		one.insert( r.first, r.second );
+	double mid = timer();
+	bulk.insert( ranges );
+	double end = timer();
+	ASSERT( sameRanges( one, bulk ) );
+	printf("KeyRangeMap: %0.1f Kinsert/sec one at a time, %0.1f Kinsert/sec in bulk\n", ranges.size() / 1000.0 / (mid - start), ranges.size() / 1000.0 / (end - mid));
+
+	CoalescedKeyRangeMap<int> coalescedOne, coalescedBulk;
+	start = timer();
+	for(auto& r : ranges)
+		coalescedOne.insert( r.first, r.second );
+	mid = timer();
+	coalescedBulk.insert( ranges );
+	end = timer();
+	ASSERT( sameRanges( coalescedOne, coalescedBulk ) );
+	printf("CoalescedKeyRangeMap: %0.1f Kinsert/sec one at a time, %0.1f Kinsert/sec in bulk\n", ranges.size() / 1000.0 / (mid - start), ranges.size() / 1000.0 / (end - mid));
+	return Void();
+}
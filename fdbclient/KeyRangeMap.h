@@ -39,6 +39,7 @@ public:
 	void operator=(KeyRangeMap&& r) noexcept(true) { mapEnd = std::move(r.mapEnd); RangeMap<Key,Val,KeyRangeRef,Metric,MetricFunc>::operator=(std::move(r)); }
 	void insert( const KeyRangeRef& keys, const Val& value ) { RangeMap<Key,Val,KeyRangeRef,Metric,MetricFunc>::insert(keys, value); }
 	void insert( const KeyRef& key, const Val& value ) { RangeMap<Key,Val,KeyRangeRef,Metric,MetricFunc>::insert( singleKeyRange(key), value); }
+	void insert( const std::vector<std::pair<KeyRangeRef, Val>>& ranges ) { RangeMap<Key,Val,KeyRangeRef,Metric,MetricFunc>::insert(ranges); }
 	std::vector<KeyRangeWith<Val>> getAffectedRangesAfterInsertion( const KeyRangeRef& keys, const Val &insertionValue = Val());
 	typename RangeMap<Key,Val,KeyRangeRef,Metric,MetricFunc>::Ranges modify( const KeyRangeRef& keys ) // Returns ranges, the first of which begins at keys.begin and the last of which ends at keys.end
 	{
@@ -80,6 +81,8 @@ public:
 	void operator=(CoalescedKeyRangeMap&& r) noexcept(true) { mapEnd = std::move(r.mapEnd); RangeMap<Key,Val,KeyRangeRef,Metric,MetricFunc>::operator=(std::move(r)); }
 	void insert( const KeyRangeRef& keys, const Val& value );
 	void insert( const KeyRef& key, const Val& value );
+	// Same as calling insert() for each range in order, for ranges which are sorted and do not overlap
+	void insert( const std::vector<std::pair<KeyRangeRef, Val>>& ranges );
 	Key mapEnd;
 };
 
@@ -178,6 +181,21 @@ void CoalescedKeyRangeMap<Val,Metric,MetricFunc>::insert( const KeyRangeRef& key
 	}
 }
 
+template <class Val, class Metric, class MetricFunc>
+void CoalescedKeyRangeMap<Val,Metric,MetricFunc>::insert( const std::vector<std::pair<KeyRangeRef, Val>>& ranges ) {
+	int first = 0, last = ranges.size()-1;
+	while( first <= last && ranges[first].first.empty() ) first++;
+	while( last >= first && ranges[last].first.empty() ) last--;
+	if( first > last )
+		return;
+	ASSERT(ranges[last].first.end <= mapEnd);
+
+	// The new boundaries go in with one bulk insert, and then a single pass over the span merges any neighbors that ended up
+	// with the same value
+	RangeMap<Key,Val,KeyRangeRef,Metric,MetricFunc>::insert(ranges);
+	RangeMap<Key,Val,KeyRangeRef,Metric,MetricFunc>::coalesce( KeyRangeRef( ranges[first].first.begin, ranges[last].first.end ) );
+}
+
 template <class Val, class Metric, class MetricFunc>
 void CoalescedKeyRangeMap<Val,Metric,MetricFunc>::insert( const KeyRef& key, const Val& value ) {
 	ASSERT(key < mapEnd);
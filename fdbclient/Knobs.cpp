@@ -39,6 +39,7 @@ ClientKnobs::ClientKnobs(bool randomize) {
 	init( FAILURE_MIN_DELAY,                       5.0 ); if( randomize && BUGGIFY ) FAILURE_MIN_DELAY = 2.0;
 	init( FAILURE_TIMEOUT_DELAY,     FAILURE_MIN_DELAY );
 	init( CLIENT_FAILURE_TIMEOUT_DELAY, FAILURE_MIN_DELAY );
+	init( CLIENT_INFO_REQUEST_JITTER,              1.0 ); if( randomize && BUGGIFY ) CLIENT_INFO_REQUEST_JITTER = g_random->coinflip() ? 0.0 : 5.0;
 
 	// wrong_shard_server sometimes comes from the only nonfailed server, so we need to avoid a fast spin
 
@@ -50,22 +51,34 @@ ClientKnobs::ClientKnobs(bool randomize) {
 	init( BACKOFF_GROWTH_RATE,                     2.0 );
 
 	init( TRANSACTION_SIZE_LIMIT,                  1e7 );
+	init( COMPACT_COMMIT_MUTATIONS,                  0 ); if( randomize && BUGGIFY ) COMPACT_COMMIT_MUTATIONS = 1;
 	init( KEY_SIZE_LIMIT,                          1e4 );
 	init( SYSTEM_KEY_SIZE_LIMIT,                   3e4 );
 	init( VALUE_SIZE_LIMIT,                        1e5 );
+	init( LARGE_VALUE_CHUNK_BYTES,               65536 ); if( randomize && BUGGIFY ) LARGE_VALUE_CHUNK_BYTES = g_random->randomInt(1, 1000);
 	init( SPLIT_KEY_SIZE_LIMIT,                    KEY_SIZE_LIMIT/2 ); if( randomize && BUGGIFY ) SPLIT_KEY_SIZE_LIMIT = KEY_SIZE_LIMIT - serverKeysPrefixFor(UID()).size() - 1;
 
 	init( MAX_BATCH_SIZE,                           20 ); if( randomize && BUGGIFY ) MAX_BATCH_SIZE = 1; // Note that SERVER_KNOBS->START_TRANSACTION_MAX_BUDGET_SIZE is set to match this value
 	init( GRV_BATCH_TIMEOUT,                     0.005 ); if( randomize && BUGGIFY ) GRV_BATCH_TIMEOUT = 0.1;
+	init( MAX_TRANSACTION_TAG_LENGTH,                16 );
+	init( GET_VALUES_BATCH_MAX,                    100 ); if( randomize && BUGGIFY ) GET_VALUES_BATCH_MAX = g_random->randomInt(1, 4);
+	init( RANGE_STREAM_CHUNKS,                       4 ); if( randomize && BUGGIFY ) RANGE_STREAM_CHUNKS = g_random->randomInt(1, 4);
+	init( TRANSACTION_POOL_SIZE,                   100 ); if( randomize && BUGGIFY ) TRANSACTION_POOL_SIZE = g_random->randomInt(0, 3);
+	init( CLIENT_CACHE_RANGES_REFRESH_INTERVAL,   10.0 ); if( randomize && BUGGIFY ) CLIENT_CACHE_RANGES_REFRESH_INTERVAL = 0.5;
 
 	init( LOCATION_CACHE_EVICTION_SIZE,         100000 );
 	init( LOCATION_CACHE_EVICTION_SIZE_SIM,         10 ); if( randomize && BUGGIFY ) LOCATION_CACHE_EVICTION_SIZE_SIM = 3;
 
+	init( LOCATION_PREFETCH_SHARD_LIMIT,            10 ); if( randomize && BUGGIFY ) LOCATION_PREFETCH_SHARD_LIMIT = g_random->randomInt(1, 4);
 	init( GET_RANGE_SHARD_LIMIT,                     2 );
+	init( MAX_RANGE_PARALLELISM,                    16 );
 	init( WARM_RANGE_SHARD_LIMIT,                  100 );
 	init( STORAGE_METRICS_SHARD_LIMIT,             100 ); if( randomize && BUGGIFY ) STORAGE_METRICS_SHARD_LIMIT = 3;
 	init( STORAGE_METRICS_UNFAIR_SPLIT_LIMIT,  2.0/3.0 );
 	init( STORAGE_METRICS_TOO_MANY_SHARDS_DELAY,  15.0 );
+	init( RANGE_AGGREGATE_SHARD_LIMIT,              20 ); if( randomize && BUGGIFY ) RANGE_AGGREGATE_SHARD_LIMIT = 2;
+	init( RANGE_AGGREGATE_BYTE_LIMIT,              1e7 ); if( randomize && BUGGIFY ) RANGE_AGGREGATE_BYTE_LIMIT = 1;
+	init( EXPORT_RANGE_SHARD_LIMIT,                 20 ); if( randomize && BUGGIFY ) EXPORT_RANGE_SHARD_LIMIT = 2;
 
 	//KeyRangeMap
 	init( KRM_GET_RANGE_LIMIT,                     1e5 ); if( randomize && BUGGIFY ) KRM_GET_RANGE_LIMIT = 10;
@@ -73,6 +86,7 @@ ClientKnobs::ClientKnobs(bool randomize) {
 
 	init( DEFAULT_MAX_OUTSTANDING_WATCHES,         1e4 );
 	init( ABSOLUTE_MAX_WATCHES,                    1e6 );
+	init( MAX_CLIENT_THREADS_PER_VERSION,           64 );
 	init( WATCH_POLLING_TIME,                      1.0 ); if( randomize && BUGGIFY ) WATCH_POLLING_TIME = 5.0;
 	init( NO_RECENT_UPDATES_DURATION,             20.0 ); if( randomize && BUGGIFY ) NO_RECENT_UPDATES_DURATION = 0.1;
 	init( FAST_WATCH_TIMEOUT,                     20.0 ); if( randomize && BUGGIFY ) FAST_WATCH_TIMEOUT = 1.0;
@@ -92,6 +106,7 @@ ClientKnobs::ClientKnobs(bool randomize) {
 	init( TASKBUCKET_CHECK_ACTIVE_AMOUNT,           10 );
 	init( TASKBUCKET_TIMEOUT_VERSIONS,     60*CORE_VERSIONSPERSECOND ); if( randomize && BUGGIFY ) TASKBUCKET_TIMEOUT_VERSIONS = 30*CORE_VERSIONSPERSECOND;
 	init( TASKBUCKET_MAX_TASK_KEYS,               1000 ); if( randomize && BUGGIFY ) TASKBUCKET_MAX_TASK_KEYS = 20;
+	init( TASKBUCKET_CLAIM_BATCH_SIZE,               4 ); if( randomize && BUGGIFY ) TASKBUCKET_CLAIM_BATCH_SIZE = g_random->randomInt(1, 10);
 
 	//Backup
 	init( BACKUP_CONCURRENT_DELETES,               100 );
@@ -116,14 +131,24 @@ ClientKnobs::ClientKnobs(bool randomize) {
 	init( BACKUP_MAP_KEY_UPPER_LIMIT,              1e5 ); if( buggifyMapLimits ) BACKUP_MAP_KEY_UPPER_LIMIT = 30;
 	init( BACKUP_COPY_TASKS,                        90 );
 	init( BACKUP_BLOCK_SIZE,   LOG_RANGE_BLOCK_SIZE/10 );
+	init( BACKUP_COPY_LOG_PIPELINE_DEPTH,            4 ); if( randomize && BUGGIFY ) BACKUP_COPY_LOG_PIPELINE_DEPTH = 1;
+	init( BACKUP_COPY_LOG_RANGE_DURATION,         10.0 ); if( randomize && BUGGIFY ) BACKUP_COPY_LOG_RANGE_DURATION = 0.0; // 0 copies one window per task execution
 	init( BACKUP_TASKS_PER_AGENT,                   20 );
 	init( SIM_BACKUP_TASKS_PER_AGENT,               10 );
 	init( BACKUP_RANGEFILE_BLOCK_SIZE,      1024 * 1024);
 	init( BACKUP_LOGFILE_BLOCK_SIZE,        1024 * 1024);
 	init( BACKUP_DISPATCH_ADDTASK_SIZE,             50 );
+	init( BACKUP_RANGE_TASK_TARGET_BYTES,        100e6 ); if( randomize && BUGGIFY ) BACKUP_RANGE_TASK_TARGET_BYTES = g_random->coinflip() ? 0 : 10e3; // 0 disables splitting ranges within a shard
+	init( BACKUP_RANGE_SPLIT_TIMEOUT,              5.0 );
+	init( BACKUP_COMPRESS_FILE_BLOCKS,               0 ); if( randomize && BUGGIFY ) BACKUP_COMPRESS_FILE_BLOCKS = 1; // Compressed blocks can only be restored by versions that read file versions 1002 and 2002
+	init( BACKUP_INCREMENTAL_SNAPSHOTS,              0 ); if( randomize && BUGGIFY ) BACKUP_INCREMENTAL_SNAPSHOTS = 1;
+	init( BACKUP_INCREMENTAL_SNAPSHOT_MAX_AGE,  30*24*3600 ); if( randomize && BUGGIFY ) BACKUP_INCREMENTAL_SNAPSHOT_MAX_AGE = g_random->coinflip() ? 0 : 60; // Seconds; a snapshot is restorable only with the logs since its oldest file
+	init( EXPORT_SNAPSHOT_LEASE,                  60.0 );
+	init( EXPORT_SNAPSHOT_RENEW_INTERVAL,         10.0 ); if( randomize && BUGGIFY ) EXPORT_SNAPSHOT_RENEW_INTERVAL = 0.5; // Must be well under the storage servers' MAX_PINNED_SNAPSHOT_LEASE
 	init( RESTORE_DISPATCH_ADDTASK_SIZE,           150 );
 	init( RESTORE_DISPATCH_BATCH_SIZE,           30000 ); if( randomize && BUGGIFY ) RESTORE_DISPATCH_BATCH_SIZE = 1;
 	init( RESTORE_WRITE_TX_SIZE,            256 * 1024 );
+	init( RESTORE_WRITE_TX_PARALLELISM,              8 ); if( randomize && BUGGIFY ) RESTORE_WRITE_TX_PARALLELISM = g_random->randomInt(1, 4);
 	init( APPLY_MAX_LOCK_BYTES,                    1e9 );
 	init( APPLY_MIN_LOCK_BYTES,                   11e6 ); //Must be bigger than TRANSACTION_SIZE_LIMIT
 	init( APPLY_BLOCK_SIZE,     LOG_RANGE_BLOCK_SIZE/5 );
@@ -152,6 +177,7 @@ ClientKnobs::ClientKnobs(bool randomize) {
 
 	init( BLOBSTORE_CONCURRENT_UPLOADS, BACKUP_TASKS_PER_AGENT*2 );
 	init( BLOBSTORE_CONCURRENT_LISTS,               20 );
+	init( BLOBSTORE_DELETE_BATCH_SIZE,            1000 ); // S3 allows at most 1000 objects per multi-object delete
 	init( BLOBSTORE_CONCURRENT_REQUESTS, BLOBSTORE_CONCURRENT_UPLOADS + BLOBSTORE_CONCURRENT_LISTS + 5);
 
 	init( BLOBSTORE_CONCURRENT_WRITES_PER_FILE,      5 );
@@ -159,14 +185,18 @@ ClientKnobs::ClientKnobs(bool randomize) {
 	init( BLOBSTORE_READ_BLOCK_SIZE,       1024 * 1024 );
 	init( BLOBSTORE_READ_AHEAD_BLOCKS,               0 );
 	init( BLOBSTORE_READ_CACHE_BLOCKS_PER_FILE,      2 );
+	init( BLOBSTORE_SHARED_READ_CACHE_BYTES,      64e6 ); // 0 disables the cache of blob reads shared by all files in the process
 	init( BLOBSTORE_MULTIPART_MAX_PART_SIZE,  20000000 );
 	init( BLOBSTORE_MULTIPART_MIN_PART_SIZE,   5242880 );
+	init( BLOBSTORE_MULTIPART_TARGET_SECONDS,       10 ); // 0 uses the min part size for every part
 
 	// These are basically unlimited by default but can be used to reduce blob IO if needed
 	init( BLOBSTORE_REQUESTS_PER_SECOND,            200 );
 	init( BLOBSTORE_MAX_SEND_BYTES_PER_SECOND,      1e9 );
 	init( BLOBSTORE_MAX_RECV_BYTES_PER_SECOND,      1e9 );
 
+	init( BLOBSTORE_HASH_THREADS,                    1 ); // 0 hashes upload content on the network thread
+
 	// Client Status Info
 	init(CSI_SAMPLING_PROBABILITY, -1.0);
 	init(CSI_SIZE_LIMIT, std::numeric_limits<int64_t>::max());
@@ -175,6 +205,10 @@ ClientKnobs::ClientKnobs(bool randomize) {
 		CSI_SIZE_LIMIT = g_random->randomInt(1024 * 1024, 100 * 1024 * 1024); // 1 MB - 100 MB
 	}
 	init(CSI_STATUS_DELAY,						  10.0  );
+	init(CSI_PROFILE_FILE,                           "" ); // If set, sampled transaction profiles are appended to this file instead of being written to the database
+
+	// Transactions sampled at this rate are traced as if debugTransaction() had been called on them (see contrib/transaction_timeline.py)
+	init( TRANSACTION_TRACE_SAMPLE_RATE,            0.0 ); if( randomize && BUGGIFY ) TRANSACTION_TRACE_SAMPLE_RATE = 0.01;
 
 	init( CONSISTENCY_CHECK_RATE_LIMIT,            50e6 );
 	init( CONSISTENCY_CHECK_RATE_WINDOW,            1.0 );
@@ -38,6 +38,7 @@ public:
 	double FAILURE_MIN_DELAY;
 	double FAILURE_TIMEOUT_DELAY;
 	double CLIENT_FAILURE_TIMEOUT_DELAY;
+	double CLIENT_INFO_REQUEST_JITTER; // Clients that already have a ClientDBInfo spread their next request to the cluster controller over this many seconds
 
 	// wrong_shard_server sometimes comes from the only nonfailed server, so we need to avoid a fast spin
 	double WRONG_SHARD_SERVER_DELAY; // SOMEDAY: This delay can limit performance of retrieving data when the cache is mostly wrong (e.g. dumping the database after a test)
@@ -48,23 +49,35 @@ public:
 	double BACKOFF_GROWTH_RATE;
 
 	int64_t TRANSACTION_SIZE_LIMIT;
+	int COMPACT_COMMIT_MUTATIONS; // If nonzero, redundant mutations and conflict ranges are removed from a transaction before it is sent to a proxy
 	int64_t KEY_SIZE_LIMIT;
 	int64_t SYSTEM_KEY_SIZE_LIMIT;
 	int64_t VALUE_SIZE_LIMIT;
+	int LARGE_VALUE_CHUNK_BYTES; // The values written with setLargeValue() are split into chunks of this size; must be no more than VALUE_SIZE_LIMIT
 	int64_t SPLIT_KEY_SIZE_LIMIT;
 
 	int MAX_BATCH_SIZE;
 	double GRV_BATCH_TIMEOUT;
+	int MAX_TRANSACTION_TAG_LENGTH;
+	int GET_VALUES_BATCH_MAX; // Concurrent point reads at the same version to the same shard are sent as one request of at most this many keys; 1 disables batching
+	int RANGE_STREAM_CHUNKS; // Range reads that need more than one reply ask a storage server to stream up to this many replies ahead; 1 disables streaming
+	int TRANSACTION_POOL_SIZE; // Each thread safe database keeps up to this many destroyed transactions, reset, to reuse for new ones; 0 disables pooling
+	double CLIENT_CACHE_RANGES_REFRESH_INTERVAL; // How often a database with a client read cache rereads which ranges may be cached
 
 	// When locationCache in DatabaseContext gets to be this size, items will be evicted
 	int LOCATION_CACHE_EVICTION_SIZE;
 	int LOCATION_CACHE_EVICTION_SIZE_SIM;
 
+	int LOCATION_PREFETCH_SHARD_LIMIT; // Shard locations fetched (and cached) on a location cache miss
 	int GET_RANGE_SHARD_LIMIT;
+	int MAX_RANGE_PARALLELISM; // Largest value accepted for the read_range_parallelism transaction option
 	int WARM_RANGE_SHARD_LIMIT;
 	int STORAGE_METRICS_SHARD_LIMIT;
 	double STORAGE_METRICS_UNFAIR_SPLIT_LIMIT;
 	double STORAGE_METRICS_TOO_MANY_SHARDS_DELAY;
+	int RANGE_AGGREGATE_SHARD_LIMIT; // Shards aggregated at once by getRangeAggregate
+	int RANGE_AGGREGATE_BYTE_LIMIT; // Bytes a storage server reads for one range aggregate request
+	int EXPORT_RANGE_SHARD_LIMIT; // Shards exported at once by exportRange
 
 	//KeyRangeMap
 	int KRM_GET_RANGE_LIMIT;
@@ -72,6 +85,7 @@ public:
 
 	int DEFAULT_MAX_OUTSTANDING_WATCHES;
 	int ABSOLUTE_MAX_WATCHES; //The client cannot set the max outstanding watches higher than this
+	int MAX_CLIENT_THREADS_PER_VERSION; //The client cannot set client_threads_per_version higher than this
 	double WATCH_POLLING_TIME;
 	double NO_RECENT_UPDATES_DURATION;
 	double FAST_WATCH_TIMEOUT;
@@ -94,6 +108,7 @@ public:
 	int TASKBUCKET_CHECK_ACTIVE_AMOUNT;
 	int TASKBUCKET_TIMEOUT_VERSIONS;
 	int TASKBUCKET_MAX_TASK_KEYS;
+	int TASKBUCKET_CLAIM_BATCH_SIZE;
 
 	// Backup
 	int BACKUP_CONCURRENT_DELETES;
@@ -117,15 +132,25 @@ public:
 	int BACKUP_MAP_KEY_UPPER_LIMIT;
 	int BACKUP_COPY_TASKS;
 	int BACKUP_BLOCK_SIZE;
+	int BACKUP_COPY_LOG_PIPELINE_DEPTH;
+	double BACKUP_COPY_LOG_RANGE_DURATION;
 	int BACKUP_TASKS_PER_AGENT;
 	int CLEAR_LOG_RANGE_COUNT;
 	int SIM_BACKUP_TASKS_PER_AGENT;
 	int BACKUP_RANGEFILE_BLOCK_SIZE;
 	int BACKUP_LOGFILE_BLOCK_SIZE;
 	int BACKUP_DISPATCH_ADDTASK_SIZE;
+	int64_t BACKUP_RANGE_TASK_TARGET_BYTES;
+	double BACKUP_RANGE_SPLIT_TIMEOUT;
+	int BACKUP_COMPRESS_FILE_BLOCKS;
+	int BACKUP_INCREMENTAL_SNAPSHOTS;
+	int64_t BACKUP_INCREMENTAL_SNAPSHOT_MAX_AGE;
+	double EXPORT_SNAPSHOT_LEASE;
+	double EXPORT_SNAPSHOT_RENEW_INTERVAL;
 	int RESTORE_DISPATCH_ADDTASK_SIZE;
 	int RESTORE_DISPATCH_BATCH_SIZE;
 	int RESTORE_WRITE_TX_SIZE;
+	int RESTORE_WRITE_TX_PARALLELISM;
 	int APPLY_MAX_LOCK_BYTES;
 	int APPLY_MIN_LOCK_BYTES;
 	int APPLY_BLOCK_SIZE;
@@ -144,6 +169,9 @@ public:
 	double CSI_SAMPLING_PROBABILITY;
 	int64_t CSI_SIZE_LIMIT;
 	double CSI_STATUS_DELAY;
+	std::string CSI_PROFILE_FILE;
+
+	double TRANSACTION_TRACE_SAMPLE_RATE;
 
 	int HTTP_SEND_SIZE;
 	int HTTP_READ_SIZE;
@@ -157,15 +185,19 @@ public:
 	int BLOBSTORE_CONCURRENT_REQUESTS;
 	int BLOBSTORE_MULTIPART_MAX_PART_SIZE;
 	int BLOBSTORE_MULTIPART_MIN_PART_SIZE;
+	int BLOBSTORE_MULTIPART_TARGET_SECONDS;
 	int BLOBSTORE_CONCURRENT_UPLOADS;
 	int BLOBSTORE_CONCURRENT_LISTS;
+	int BLOBSTORE_DELETE_BATCH_SIZE;
 	int BLOBSTORE_CONCURRENT_WRITES_PER_FILE;
 	int BLOBSTORE_CONCURRENT_READS_PER_FILE;
 	int BLOBSTORE_READ_BLOCK_SIZE;
 	int BLOBSTORE_READ_AHEAD_BLOCKS;
 	int BLOBSTORE_READ_CACHE_BLOCKS_PER_FILE;
+	int64_t BLOBSTORE_SHARED_READ_CACHE_BYTES;
 	int BLOBSTORE_MAX_SEND_BYTES_PER_SECOND;
 	int BLOBSTORE_MAX_RECV_BYTES_PER_SECOND;
+	int BLOBSTORE_HASH_THREADS;
 
 	int CONSISTENCY_CHECK_RATE_LIMIT;
 	int CONSISTENCY_CHECK_RATE_WINDOW;
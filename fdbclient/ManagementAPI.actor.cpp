@@ -88,6 +88,8 @@ std::map<std::string, std::string> configForToken( std::string const& mode ) {
 		storeType = KeyValueStoreType::SSD_BTREE_V2;
 	} else if (mode == "memory") {
 		storeType= KeyValueStoreType::MEMORY;
+	} else if (mode == "lsm") {
+		storeType= KeyValueStoreType::LSM;
 	}
 	// Add any new store types to fdbserver/workloads/ConfigureDatabase, too
 
@@ -957,7 +959,7 @@ struct AutoQuorumChange : IQuorumChange {
 };
 Reference<IQuorumChange> autoQuorumChange( int desired ) { return Reference<IQuorumChange>(new AutoQuorumChange(desired)); }
 
-ACTOR Future<Void> excludeServers( Database cx, vector<AddressExclusion> servers ) {
+ACTOR Future<Void> excludeServers( Database cx, vector<AddressExclusion> servers, bool drain ) {
 	state Transaction tr(cx);
 	state std::string versionKey = g_random->randomUniqueID().toString();
 	loop {
@@ -969,9 +971,9 @@ ACTOR Future<Void> excludeServers( Database cx, vector<AddressExclusion> servers
 			tr.addReadConflictRange( singleKeyRange(excludedServersVersionKey) ); //To conflict with parallel includeServers
 			tr.set( excludedServersVersionKey, versionKey );
 			for(auto& s : servers)
-				tr.set( encodeExcludedServersKey(s), StringRef() );
+				tr.set( encodeExcludedServersKey(s), drain ? excludedServersDrainValue : StringRef() );
 
-			TraceEvent("ExcludeServersCommit").detail("Servers", describe(servers));
+			TraceEvent("ExcludeServersCommit").detail("Servers", describe(servers)).detail("Drain", drain);
 
 			Void _ = wait( tr.commit() );
 			return Void();
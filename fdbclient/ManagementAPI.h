@@ -121,8 +121,9 @@ Reference<IQuorumChange> specifiedQuorumChange(vector<NetworkAddress> const&);
 Reference<IQuorumChange> nameQuorumChange(std::string const& name, Reference<IQuorumChange> const& other);
 
 // Exclude the given set of servers from use as state servers.  Returns as soon as the change is durable, without necessarily waiting for
-// the servers to be evacuated.  A NetworkAddress with a port of 0 means all servers on the given IP.
-Future<Void> excludeServers( Database const& cx, vector<AddressExclusion> const& servers );
+// the servers to be evacuated.  A NetworkAddress with a port of 0 means all servers on the given IP.  If drain is true, data distribution
+// moves data off the servers ahead of rebalancing and with more parallelism, and status reports how long that should take.
+Future<Void> excludeServers( Database const& cx, vector<AddressExclusion> const& servers, bool const& drain = false );
 
 // Remove the given servers from the exclusion list.  A NetworkAddress with a port of 0 means all servers on the given IP.  A NetworkAddress() means
 // all servers (don't exclude anything)
@@ -25,6 +25,7 @@
 #include "FDBTypes.h"
 #include "StorageServerInterface.h"
 #include "CommitTransaction.h"
+#include "flow/Hash3.h"
 
 struct MasterProxyInterface {
 	enum { LocationAwareLoadBalance = 1 };
@@ -63,24 +64,27 @@ struct MasterProxyInterface {
 struct CommitID {
 	Version version; 			// returns invalidVersion if transaction conflicts
 	uint16_t txnBatchId;
+	Optional<KeyRange> conflictingKeyRange;  // A read conflict range that conflicted, for a conflicting transaction with FLAG_REPORT_CONFLICTING_KEYS
 
 	template <class Ar>
 	void serialize(Ar& ar) {
-		ar & version & txnBatchId;
+		ar & version & txnBatchId & conflictingKeyRange;
 	}
 
 	CommitID() : version(invalidVersion), txnBatchId(0) {}
-	CommitID( Version version, uint16_t txnBatchId ) : version(version), txnBatchId(txnBatchId) {}
+	CommitID( Version version, uint16_t txnBatchId, Optional<KeyRange> conflictingKeyRange = Optional<KeyRange>() ) : version(version), txnBatchId(txnBatchId), conflictingKeyRange(conflictingKeyRange) {}
 };
 
 struct CommitTransactionRequest {
 	enum { 
 		FLAG_IS_LOCK_AWARE = 0x1,
-		FLAG_FIRST_IN_BATCH = 0x2
+		FLAG_FIRST_IN_BATCH = 0x2,
+		FLAG_REPORT_CONFLICTING_KEYS = 0x4
 	};
 
 	bool isLockAware() const { return flags & FLAG_IS_LOCK_AWARE; }
 	bool firstInBatch() const { return flags & FLAG_FIRST_IN_BATCH; }
+	bool reportConflictingKeys() const { return flags & FLAG_REPORT_CONFLICTING_KEYS; }
 	
 	Arena arena;
 	CommitTransactionRef transaction;
@@ -127,23 +131,25 @@ struct GetReadVersionRequest {
 	};
 	enum { 
 		FLAG_CAUSAL_READ_RISKY = 1,
+		FLAG_USE_CACHED_READ_VERSION = 2,  // The proxy may answer with a recently obtained live committed version instead of contacting the other proxies
 		FLAG_PRIORITY_MASK = PRIORITY_SYSTEM_IMMEDIATE,
 	};
 
 	uint32_t transactionCount;
 	uint32_t flags;
 	Optional<UID> debugID;
+	Optional<Standalone<StringRef>> tag;  // Client-supplied workload tag; ratekeeper may limit the start rate of busy tags
 	ReplyPromise<GetReadVersionReply> reply;
 
 	GetReadVersionRequest() : transactionCount( 1 ), flags( PRIORITY_DEFAULT ) {}
-	GetReadVersionRequest( uint32_t transactionCount, uint32_t flags, Optional<UID> debugID = Optional<UID>() ) : transactionCount( transactionCount ), flags( flags ), debugID( debugID ) {}
+	GetReadVersionRequest( uint32_t transactionCount, uint32_t flags, Optional<UID> debugID = Optional<UID>(), Optional<Standalone<StringRef>> tag = Optional<Standalone<StringRef>>() ) : transactionCount( transactionCount ), flags( flags ), debugID( debugID ), tag( tag ) {}
 	
 	int priority() const { return flags & FLAG_PRIORITY_MASK; }
 	bool operator < (GetReadVersionRequest const& rhs) const { return priority() < rhs.priority(); }
 
 	template <class Ar> 
 	void serialize(Ar& ar) { 
-		ar & transactionCount & flags & debugID & reply;
+		ar & transactionCount & flags & debugID & tag & reply;
 	}
 };
 
@@ -218,12 +224,29 @@ struct TxnStateRequest {
 	VectorRef<KeyValueRef> data;
 	Sequence sequence;
 	bool last;
-	ReplyPromise<Void> reply;
+	// If present, data is empty and the proxy should fill cachedRange from the copy of the txnStateStore left behind by an earlier
+	// proxy in its process, provided that copy's contents of the range match cachedChecksum. The reply says whether it did.
+	Optional<KeyRangeRef> cachedRange;
+	uint64_t cachedChecksum;
+	ReplyPromise<bool> reply;
+
+	TxnStateRequest() : sequence(0), last(false), cachedChecksum(0) {}
 
 	template <class Ar> 
 	void serialize(Ar& ar) { 
-		ar & data & sequence & last & reply & arena;
+		ar & data & sequence & last & cachedRange & cachedChecksum & reply & arena;
 	}
 };
 
+inline uint64_t txnStateChecksum( KeyValueRef const* begin, KeyValueRef const* end ) {
+	uint32_t a = 0, b = 0;
+	for(auto kv = begin; kv != end; ++kv) {
+		int sizes[2] = { kv->key.size(), kv->value.size() };
+		hashlittle2( sizes, sizeof(sizes), &a, &b );
+		hashlittle2( kv->key.begin(), kv->key.size(), &a, &b );
+		hashlittle2( kv->value.begin(), kv->value.size(), &a, &b );
+	}
+	return (uint64_t(a) << 32) | b;
+}
+
 #endif
@@ -24,6 +24,7 @@
 #include "fdbclient/DatabaseContext.h"
 #include "fdbclient/ReadYourWrites.h"
 #include "fdbclient/KeyBackedTypes.h"
+#include "flow/Net2Packet.h"
 #include <cmath>
 
 struct MetricsRule {
@@ -398,6 +399,125 @@ ACTOR Future<Void> runMetrics( Future<Database> fcx, Key prefix ) {
 	return Void();
 }
 
+// Writes samples of numeric metrics in the line protocol of an external metrics agent, so that a batch of samples is
+// simply their concatenation.
+struct IMetricExportFormat {
+	virtual ~IMetricExportFormat() {}
+	virtual void writeSample(PacketWriter &wr, StringRef name, double value, int64_t timestamp) = 0;
+};
+
+struct StatsdExportFormat : IMetricExportFormat {
+	void writeSample(PacketWriter &wr, StringRef name, double value, int64_t timestamp) {
+		char buf[64];
+		// A gauge value with a sign is a change rather than a value in statsd, so a negative value is set from zero
+		if(value < 0) {
+			wr.serializeBytes(name);
+			wr.serializeBytes(LiteralStringRef(":0|g\n"));
+		}
+		int len = snprintf(buf, sizeof(buf), ":%.17g|g\n", value);
+		wr.serializeBytes(name);
+		wr.serializeBytes(buf, len);
+	}
+};
+
+struct GraphiteExportFormat : IMetricExportFormat {
+	void writeSample(PacketWriter &wr, StringRef name, double value, int64_t timestamp) {
+		char buf[64];
+		int len = snprintf(buf, sizeof(buf), " %.17g %lld\n", value, (long long)timestamp);
+		wr.serializeBytes(name);
+		wr.serializeBytes(buf, len);
+	}
+};
+
+static IMetricExportFormat* createMetricExportFormat(std::string const &format) {
+	if(format == "statsd")
+		return new StatsdExportFormat();
+	if(format == "graphite")
+		return new GraphiteExportFormat();
+	return nullptr;
+}
+
+// Appends s to name as one dot separated component, replacing characters that agents treat as separators
+static void appendMetricNameComponent(std::string &name, StringRef s) {
+	if(!name.empty())
+		name += '.';
+	for(uint8_t c : s)
+		name += (isalnum(c) || c == '-' || c == '_') ? (char)c : '_';
+}
+
+// Sends the current value of every numeric metric to a metrics agent at exportAddress (host:port) every
+// METRIC_EXPORT_INTERVAL seconds.  This is independent of runMetrics(), does not depend on the metric rules, and
+// does not write to any database.
+ACTOR Future<Void> exportMetrics( std::string exportAddress, std::string format ) {
+	state std::unique_ptr<IMetricExportFormat> exportFormat(createMetricExportFormat(format));
+	if(!exportFormat) {
+		TraceEvent(SevWarnAlways, "TDMetricsExportUnknownFormat").detail("Format", format);
+		return Void();
+	}
+	size_t colon = exportAddress.rfind(':');
+	if(colon == std::string::npos) {
+		TraceEvent(SevWarnAlways, "TDMetricsExportBadAddress").detail("Address", exportAddress);
+		return Void();
+	}
+	state std::string host = exportAddress.substr(0, colon);
+	state std::string service = exportAddress.substr(colon + 1);
+
+	state TDMetricCollection *metrics = nullptr;
+	loop {
+		metrics = TDMetricCollection::getTDMetrics();
+		if(metrics != nullptr)
+			if(metrics->init())
+				break;
+		Void _ = wait(delay(1.0));
+	}
+
+	state Reference<IConnection> conn;
+	state UnsentPacketQueue unsent;
+	state std::string name;  // Reused for each metric so that its buffer is only allocated once
+	loop {
+		try {
+			if(!conn) {
+				Reference<IConnection> c = wait(INetworkConnections::net()->connect(host, service));
+				conn = c;
+				TraceEvent("TDMetricsExportConnected").detail("Address", exportAddress).detail("Format", format);
+			}
+
+			// Only the latest values are worth sending, so anything left from a failed send is dropped
+			unsent.discardAll();
+			PacketWriter wr(unsent.getWriteBuffer(), nullptr, Unversioned());
+			int64_t timestamp = (int64_t)timer();
+			for(auto &it : metrics->metricMap) {
+				double value;
+				if(!it.value->getNumericValue(value))
+					continue;
+				name.clear();
+				appendMetricNameComponent(name, LiteralStringRef("fdb"));
+				appendMetricNameComponent(name, metrics->address);
+				appendMetricNameComponent(name, it.value->metricName.name);
+				if(it.value->metricName.id.size())
+					appendMetricNameComponent(name, it.value->metricName.id);
+				exportFormat->writeSample(wr, StringRef(name), value, timestamp);
+			}
+			unsent.setWriteBuffer(wr.finish());
+
+			while(!unsent.empty()) {
+				Void _ = wait(conn->onWritable());
+				int len = conn->write(unsent.getUnsent());
+				unsent.sent(len);
+			}
+		} catch(Error &e) {
+			if(e.code() == error_code_actor_cancelled)
+				throw;
+			TraceEvent(SevWarn, "TDMetricsExportError").error(e).suppressFor(60.0).detail("Address", exportAddress);
+			if(conn) {
+				conn->close();
+				conn.clear();
+			}
+		}
+		Void _ = wait(delay(FLOW_KNOBS->METRIC_EXPORT_INTERVAL));
+	}
+}
+
 TEST_CASE("fdbserver/metrics/TraceEvents") {
 	auto getenv2 = [](const char *s) -> const char * {s = getenv(s); return s ? s : ""; };
 	std::string metricsConnFile = getenv2("METRICS_CONNFILE");
@@ -23,3 +23,7 @@
 #include "NativeAPI.h"
 
 Future<Void> runMetrics( Future<Database> const& fcx, Key const& metricsPrefix );
+
+// Periodically sends numeric metrics to an external agent at exportAddress (host:port) in the given format
+// ("statsd" or "graphite").  Unlike runMetrics(), this does not need or write to a database.
+Future<Void> exportMetrics( std::string const& exportAddress, std::string const& format );
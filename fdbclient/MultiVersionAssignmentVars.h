@@ -392,4 +392,79 @@ ThreadFuture<T> flatMapThreadFuture(ThreadFuture<S> source, std::function<ErrorO
 	return ThreadFuture<T>(new FlatMapSingleAssignmentVar<S, T>(source, mapValue));
 }
 
+// Becomes ready when all of its sources are ready, or with the first error that any of them is set to
+template<class T>
+class AllSingleAssignmentVar : public ThreadSingleAssignmentVar<Void>, ThreadCallback {
+public:
+	AllSingleAssignmentVar(std::vector<ThreadFuture<T>> const& sources) : sources(sources), remaining(sources.size()), hasBeenSet(false) {
+		if(sources.empty()) {
+			hasBeenSet = true;
+			ThreadSingleAssignmentVar<Void>::send(Void());
+			return;
+		}
+
+		int userParam;
+		for(int i = 0; i < this->sources.size(); i++) {
+			ThreadSingleAssignmentVar<Void>::addref();
+			this->sources[i].callOrSetAsCallback(this, userParam, 0);
+		}
+	}
+
+	virtual void cancel() {
+		for(auto& source : sources) {
+			source.getPtr()->addref(); // Cancel will delref our future, but we don't want to destroy it until this callback gets destroyed
+			source.getPtr()->cancel();
+		}
+		ThreadSingleAssignmentVar<Void>::cancel();
+	}
+
+	virtual void cleanupUnsafe() {
+		for(auto& source : sources) {
+			source.getPtr()->releaseMemory();
+		}
+		ThreadSingleAssignmentVar<Void>::cleanupUnsafe();
+	}
+
+	bool canFire(int notMadeActive) { return true; }
+
+	void fire(const Void &unused, int& userParam) {
+		lock.enter();
+		bool doSend = --remaining == 0 && !hasBeenSet;
+		if(doSend) {
+			hasBeenSet = true;
+		}
+		lock.leave();
+
+		if(doSend) {
+			ThreadSingleAssignmentVar<Void>::send(Void());
+		}
+		ThreadSingleAssignmentVar<Void>::delref();
+	}
+
+	void error(const Error& e, int& userParam) {
+		lock.enter();
+		--remaining;
+		bool doSend = !hasBeenSet;
+		hasBeenSet = true;
+		lock.leave();
+
+		if(doSend) {
+			ThreadSingleAssignmentVar<Void>::sendError(e);
+		}
+		ThreadSingleAssignmentVar<Void>::delref();
+	}
+
+private:
+	std::vector<ThreadFuture<T>> sources;
+	int remaining;
+	bool hasBeenSet;
+
+	ThreadSpinLock lock;
+};
+
+template<class T>
+ThreadFuture<Void> waitForAllThreadFutures(std::vector<ThreadFuture<T>> const& sources) {
+	return ThreadFuture<Void>(new AllSingleAssignmentVar<T>(sources));
+}
+
 #endif
@@ -125,6 +125,77 @@ ThreadFuture<Standalone<VectorRef<const char*>>> DLTransaction::getAddressesForK
 	});
 }
 
+ThreadFuture<int64_t> DLTransaction::getEstimatedRangeSizeBytes(const KeyRangeRef& keys) {
+	if(!api->transactionGetEstimatedRangeSizeBytes) {
+		return unsupported_operation();
+	}
+
+	FdbCApi::FDBFuture *f = api->transactionGetEstimatedRangeSizeBytes(tr, keys.begin.begin(), keys.begin.size(), keys.end.begin(), keys.end.size());
+
+	return toThreadFuture<int64_t>(api, f, [](FdbCApi::FDBFuture *f, FdbCApi *api) {
+		int64_t bytes;
+		FdbCApi::fdb_error_t error = api->futureGetInt64(f, &bytes);
+		ASSERT(!error);
+		return bytes;
+	});
+}
+
+ThreadFuture<Standalone<VectorRef<KeyRef>>> DLTransaction::getRangeSplitPoints(const KeyRangeRef& keys, int64_t chunkSize) {
+	if(!api->transactionGetRangeSplitPoints) {
+		return unsupported_operation();
+	}
+
+	FdbCApi::FDBFuture *f = api->transactionGetRangeSplitPoints(tr, keys.begin.begin(), keys.begin.size(), keys.end.begin(), keys.end.size(), chunkSize);
+
+	return toThreadFuture<Standalone<VectorRef<KeyRef>>>(api, f, [](FdbCApi::FDBFuture *f, FdbCApi *api) {
+		const FdbCApi::FDBKey *splitKeys;
+		int count;
+		FdbCApi::fdb_error_t error = api->futureGetKeyArray(f, &splitKeys, &count);
+		ASSERT(!error);
+
+		// The memory for this is stored in the FDBFuture and is released when the future gets destroyed
+		return Standalone<VectorRef<KeyRef>>(VectorRef<KeyRef>((KeyRef*)splitKeys, count), Arena());
+	});
+}
+
+ThreadFuture<Optional<Value>> DLTransaction::getLargeValue(const KeyRef& key, int64_t offset, int length, bool snapshot) {
+	if(!api->transactionGetLargeValue) {
+		return unsupported_operation();
+	}
+
+	FdbCApi::FDBFuture *f = api->transactionGetLargeValue(tr, key.begin(), key.size(), offset, length, snapshot);
+
+	return toThreadFuture<Optional<Value>>(api, f, [](FdbCApi::FDBFuture *f, FdbCApi *api) {
+		FdbCApi::fdb_bool_t present;
+		const uint8_t *value;
+		int valueLength;
+		FdbCApi::fdb_error_t error = api->futureGetValue(f, &present, &value, &valueLength);
+		ASSERT(!error);
+		if(present) {
+			// The memory for this is stored in the FDBFuture and is released when the future gets destroyed
+			return Optional<Value>(Value(ValueRef(value, valueLength), Arena()));
+		}
+		else {
+			return Optional<Value>();
+		}
+	});
+}
+
+ThreadFuture<int64_t> DLTransaction::getLargeValueSize(const KeyRef& key, bool snapshot) {
+	if(!api->transactionGetLargeValueSize) {
+		return unsupported_operation();
+	}
+
+	FdbCApi::FDBFuture *f = api->transactionGetLargeValueSize(tr, key.begin(), key.size(), snapshot);
+
+	return toThreadFuture<int64_t>(api, f, [](FdbCApi::FDBFuture *f, FdbCApi *api) {
+		int64_t size;
+		FdbCApi::fdb_error_t error = api->futureGetInt64(f, &size);
+		ASSERT(!error);
+		return size;
+	});
+}
+
 ThreadFuture<Standalone<StringRef>> DLTransaction::getVersionstamp() {
 	if(!api->transactionGetVersionstamp) {
 		return unsupported_operation();
@@ -167,6 +238,20 @@ void DLTransaction::clear(const KeyRef& key) {
 	api->transactionClear(tr, key.begin(), key.size());
 }
 
+void DLTransaction::setLargeValue(const KeyRef& key, const ValueRef& value) {
+	if(!api->transactionSetLargeValue) {
+		throw unsupported_operation();
+	}
+	api->transactionSetLargeValue(tr, key.begin(), key.size(), value.begin(), value.size());
+}
+
+void DLTransaction::clearLargeValue(const KeyRef& key) {
+	if(!api->transactionClearLargeValue) {
+		throw unsupported_operation();
+	}
+	api->transactionClearLargeValue(tr, key.begin(), key.size());
+}
+
 ThreadFuture<Void> DLTransaction::watch(const KeyRef& key) {
 	FdbCApi::FDBFuture *f = api->transactionWatch(tr, key.begin(), key.size());
 
@@ -283,6 +368,12 @@ void DLApi::init() {
 	loadClientFunction(&api->transactionGetAddressesForKey, lib, fdbCPath, "fdb_transaction_get_addresses_for_key");
 	loadClientFunction(&api->transactionGetRange, lib, fdbCPath, "fdb_transaction_get_range");
 	loadClientFunction(&api->transactionGetVersionstamp, lib, fdbCPath, "fdb_transaction_get_versionstamp", headerVersion >= 410);
+	loadClientFunction(&api->transactionGetEstimatedRangeSizeBytes, lib, fdbCPath, "fdb_transaction_get_estimated_range_size_bytes", false);
+	loadClientFunction(&api->transactionGetRangeSplitPoints, lib, fdbCPath, "fdb_transaction_get_range_split_points", false);
+	loadClientFunction(&api->transactionGetLargeValue, lib, fdbCPath, "fdb_transaction_get_large_value", false);
+	loadClientFunction(&api->transactionGetLargeValueSize, lib, fdbCPath, "fdb_transaction_get_large_value_size", false);
+	loadClientFunction(&api->transactionSetLargeValue, lib, fdbCPath, "fdb_transaction_set_large_value", false);
+	loadClientFunction(&api->transactionClearLargeValue, lib, fdbCPath, "fdb_transaction_clear_large_value", false);
 	loadClientFunction(&api->transactionSet, lib, fdbCPath, "fdb_transaction_set");
 	loadClientFunction(&api->transactionClear, lib, fdbCPath, "fdb_transaction_clear");
 	loadClientFunction(&api->transactionClearRange, lib, fdbCPath, "fdb_transaction_clear_range");
@@ -298,11 +389,13 @@ void DLApi::init() {
 	loadClientFunction(&api->futureGetCluster, lib, fdbCPath, "fdb_future_get_cluster");
 	loadClientFunction(&api->futureGetDatabase, lib, fdbCPath, "fdb_future_get_database");
 	loadClientFunction(&api->futureGetVersion, lib, fdbCPath, "fdb_future_get_version");
+	loadClientFunction(&api->futureGetInt64, lib, fdbCPath, "fdb_future_get_int64", false);
 	loadClientFunction(&api->futureGetError, lib, fdbCPath, "fdb_future_get_error");
 	loadClientFunction(&api->futureGetKey, lib, fdbCPath, "fdb_future_get_key");
 	loadClientFunction(&api->futureGetValue, lib, fdbCPath, "fdb_future_get_value");
 	loadClientFunction(&api->futureGetStringArray, lib, fdbCPath, "fdb_future_get_string_array");
 	loadClientFunction(&api->futureGetKeyValueArray, lib, fdbCPath, "fdb_future_get_keyvalue_array");
+	loadClientFunction(&api->futureGetKeyArray, lib, fdbCPath, "fdb_future_get_key_array", false);
 	loadClientFunction(&api->futureSetCallback, lib, fdbCPath, "fdb_future_set_callback");
 	loadClientFunction(&api->futureCancel, lib, fdbCPath, "fdb_future_cancel");
 	loadClientFunction(&api->futureDestroy, lib, fdbCPath, "fdb_future_destroy");
@@ -451,6 +544,30 @@ ThreadFuture<Standalone<VectorRef<const char*>>> MultiVersionTransaction::getAdd
 	return abortableFuture(f, tr.onChange);
 }
 
+ThreadFuture<int64_t> MultiVersionTransaction::getEstimatedRangeSizeBytes(const KeyRangeRef& keys) {
+	auto tr = getTransaction();
+	auto f = tr.transaction ? tr.transaction->getEstimatedRangeSizeBytes(keys) : ThreadFuture<int64_t>(Never());
+	return abortableFuture(f, tr.onChange);
+}
+
+ThreadFuture<Standalone<VectorRef<KeyRef>>> MultiVersionTransaction::getRangeSplitPoints(const KeyRangeRef& keys, int64_t chunkSize) {
+	auto tr = getTransaction();
+	auto f = tr.transaction ? tr.transaction->getRangeSplitPoints(keys, chunkSize) : ThreadFuture<Standalone<VectorRef<KeyRef>>>(Never());
+	return abortableFuture(f, tr.onChange);
+}
+
+ThreadFuture<Optional<Value>> MultiVersionTransaction::getLargeValue(const KeyRef& key, int64_t offset, int length, bool snapshot) {
+	auto tr = getTransaction();
+	auto f = tr.transaction ? tr.transaction->getLargeValue(key, offset, length, snapshot) : ThreadFuture<Optional<Value>>(Never());
+	return abortableFuture(f, tr.onChange);
+}
+
+ThreadFuture<int64_t> MultiVersionTransaction::getLargeValueSize(const KeyRef& key, bool snapshot) {
+	auto tr = getTransaction();
+	auto f = tr.transaction ? tr.transaction->getLargeValueSize(key, snapshot) : ThreadFuture<int64_t>(Never());
+	return abortableFuture(f, tr.onChange);
+}
+
 void MultiVersionTransaction::addReadConflictRange(const KeyRangeRef& keys) {
 	auto tr = getTransaction();
 	if(tr.transaction) {
@@ -493,6 +610,20 @@ void MultiVersionTransaction::clear(const KeyRef& key) {
 	}
 }
 
+void MultiVersionTransaction::setLargeValue(const KeyRef& key, const ValueRef& value) {
+	auto tr = getTransaction();
+	if(tr.transaction) {
+		tr.transaction->setLargeValue(key, value);
+	}
+}
+
+void MultiVersionTransaction::clearLargeValue(const KeyRef& key) {
+	auto tr = getTransaction();
+	if(tr.transaction) {
+		tr.transaction->clearLargeValue(key);
+	}
+}
+
 ThreadFuture<Void> MultiVersionTransaction::watch(const KeyRef& key) {
 	auto tr = getTransaction();
 	auto f = tr.transaction ? tr.transaction->watch(key) : ThreadFuture<Void>(Never());
@@ -666,7 +797,7 @@ void MultiVersionDatabase::DatabaseState::cancelCallbacks() {
 }
 
 // MultiVersionCluster
-MultiVersionCluster::MultiVersionCluster(MultiVersionApi *api, std::string clusterFilePath, Reference<ICluster> cluster) : clusterState(new ClusterState()) {
+MultiVersionCluster::MultiVersionCluster(MultiVersionApi *api, std::string clusterFilePath, Reference<ICluster> cluster, int threadIndex) : clusterState(new ClusterState()) {
 	clusterState->cluster = cluster;
 	clusterState->clusterVar->set(cluster);
 
@@ -678,8 +809,10 @@ MultiVersionCluster::MultiVersionCluster(MultiVersionApi *api, std::string clust
 		clusterState->currentClientIndex = -1;
 	}
 
-	api->runOnExternalClients([this, clusterFilePath](Reference<ClientInfo> client) {
-		clusterState->addConnection(client, clusterFilePath);
+	api->runOnExternalClients([this, clusterFilePath, threadIndex](Reference<ClientInfo> client) {
+		if(client->threadIndex == threadIndex) {
+			clusterState->addConnection(client, clusterFilePath);
+		}
 	});
 
 	clusterState->startConnections();
@@ -1005,6 +1138,41 @@ void MultiVersionApi::disableLocalClient() {
 	localClientDisabled = true;
 }
 
+void MultiVersionApi::setThreadCount(int threadCount) {
+	MutexHolder holder(lock);
+	if(networkStartSetup || bypassMultiClientApi) {
+		throw invalid_option();
+	}
+
+	this->threadCount = threadCount;
+}
+
+// A library loaded from a second path gets its own copy of all its globals, and therefore its own network thread
+void MultiVersionApi::copyExternalLibraries() {
+#ifdef _WIN32
+	const char *tmp = getenv("TEMP");
+	std::string tmpDir = tmp ? tmp : ".";
+#else
+	const char *tmp = getenv("TMPDIR");
+	std::string tmpDir = tmp ? tmp : "/tmp";
+#endif
+
+	std::vector<std::pair<std::string, Reference<ClientInfo>>> copies;
+	for(auto &c : externalClients) {
+		std::string bytes = readFileBytes(c.second->libPath, std::numeric_limits<int>::max());
+		for(int i = 1; i < threadCount; i++) {
+			std::string copy = abspath(joinPath(tmpDir, format("fdb_%08x_%d_%s", platform::getRandomSeed(), i, c.first.c_str())));
+			writeFileBytes(copy, bytes.c_str(), bytes.size());
+			libraryCopies.push_back(copy);
+
+			TraceEvent("AddingExternalClientCopy").detail("LibraryPath", c.first).detail("CopyPath", copy).detail("ThreadIndex", i);
+			copies.push_back(std::make_pair(format("%s_%d", c.first.c_str(), i), Reference<ClientInfo>(new ClientInfo(new DLApi(copy), copy, i))));
+		}
+	}
+
+	externalClients.insert(copies.begin(), copies.end());
+}
+
 void MultiVersionApi::setSupportedClientVersions(Standalone<StringRef> versions) {
 	MutexHolder holder(lock);
 	ASSERT(networkSetup);
@@ -1050,6 +1218,10 @@ void MultiVersionApi::setNetworkOptionInternal(FDBNetworkOptions::Option option,
 		validateOption(value, false, true);
 		disableLocalClient();
 	}
+	else if(option == FDBNetworkOptions::CLIENT_THREADS_PER_VERSION) {
+		validateOption(value, true, false, false);
+		setThreadCount((int)extractIntOption(value, 1, CLIENT_KNOBS->MAX_CLIENT_THREADS_PER_VERSION));
+	}
 	else if(option == FDBNetworkOptions::SUPPORTED_CLIENT_VERSIONS) {
 		ASSERT(value.present());
 		setSupportedClientVersions(value.get());
@@ -1089,8 +1261,17 @@ void MultiVersionApi::setupNetwork() {
 			throw network_already_setup();
 		}
 
+		if(threadCount > 1 && (externalClients.empty() || bypassMultiClientApi)) {
+			throw invalid_option(); // Only external clients can be run more than once
+		}
+
 		networkStartSetup = true;
 
+		if(threadCount > 1) {
+			localClientDisabled = true;
+			copyExternalLibraries();
+		}
+
 		if(externalClients.empty()) {
 			bypassMultiClientApi = true; // SOMEDAY: we won't be able to set this option once it becomes possible to add clients after setupNetwork is called
 		}
@@ -1112,6 +1293,14 @@ void MultiVersionApi::setupNetwork() {
 			client->loadProtocolVersion();
 		});
 
+#ifndef _WIN32
+		// The copies stay mapped after being unlinked
+		for(auto &copy : libraryCopies) {
+			deleteFile(copy);
+		}
+		libraryCopies.clear();
+#endif
+
 		MutexHolder holder(lock);
 		runOnExternalClients([this, transportId](Reference<ClientInfo> client) {
 			for(auto option : options) {
@@ -1248,7 +1437,33 @@ ThreadFuture<Reference<ICluster>> MultiVersionApi::createCluster(const char *clu
 
 	std::string clusterFile(clusterFilePath);
 	if(localClientDisabled) {
-		return Reference<ICluster>(new MultiVersionCluster(this, clusterFile, Reference<ICluster>()));
+		// With a single usable client there is nothing to switch to when the cluster version changes, and that client reconnects
+		// on its own, so its clusters are handed out directly rather than paying for the multi-version wrappers on every operation
+		Reference<ClientInfo> onlyClient;
+		if(threadCount == 1) {
+			MutexHolder holder(lock);
+			int usableClients = 0;
+			runOnExternalClients([&onlyClient, &usableClients](Reference<ClientInfo> client) {
+				onlyClient = client;
+				++usableClients;
+			});
+			if(usableClients != 1) {
+				onlyClient = Reference<ClientInfo>();
+			}
+		}
+		if(onlyClient) {
+			TraceEvent("CreatingClusterOnOnlyClient").detail("LibraryPath", onlyClient->libPath);
+			return onlyClient->api->createCluster(clusterFilePath);
+		}
+
+		int threadIndex = 0;
+		if(threadCount > 1) {
+			MutexHolder holder(lock);
+			threadIndex = nextThread;
+			nextThread = (nextThread + 1) % threadCount;
+		}
+
+		return Reference<ICluster>(new MultiVersionCluster(this, clusterFile, Reference<ICluster>(), threadIndex));
 	}
 
 	auto clusterFuture = localClient->api->createCluster(clusterFilePath);
@@ -1274,6 +1489,10 @@ void MultiVersionApi::updateSupportedVersions() {
 		Standalone<VectorRef<uint8_t>> versionStr;
 
 		runOnExternalClients([&versionStr](Reference<ClientInfo> client){
+			if(client->threadIndex > 0) {
+				return; // Copies of a library that has already been listed
+			}
+
 			const char *ver = client->api->getClientVersion();
 			versionStr.append(versionStr.arena(), (uint8_t*)ver, (int)strlen(ver));
 			versionStr.append(versionStr.arena(), (uint8_t*)";", 1);
@@ -1369,7 +1588,7 @@ void MultiVersionApi::loadEnvironmentVariableNetworkOptions() {
 	envOptionsLoaded = true;
 }
 
-MultiVersionApi::MultiVersionApi() : bypassMultiClientApi(false), networkStartSetup(false), networkSetup(false), callbackOnMainThread(true), externalClient(false), localClientDisabled(false), apiVersion(0), envOptionsLoaded(false) {}
+MultiVersionApi::MultiVersionApi() : bypassMultiClientApi(false), networkStartSetup(false), networkSetup(false), callbackOnMainThread(true), externalClient(false), localClientDisabled(false), apiVersion(0), envOptionsLoaded(false), threadCount(1), nextThread(0) {}
 
 MultiVersionApi* MultiVersionApi::api = new MultiVersionApi();
 
@@ -41,6 +41,11 @@ struct FdbCApi : public ThreadSafeReferenceCounted<FdbCApi> {
 		const void *value;
 		int valueLength;
 	} FDBKeyValue;
+
+	typedef struct key {
+		const uint8_t *key;
+		int keyLength;
+	} FDBKey;
 #pragma pack(pop)
 
 	typedef int fdb_error_t;
@@ -81,11 +86,17 @@ struct FdbCApi : public ThreadSafeReferenceCounted<FdbCApi> {
 										uint8_t const *endKeyName, int endKeyNameLength, fdb_bool_t endOrEqual, int endOffset, int limit, int targetBytes,
 										FDBStreamingModes::Option mode, int iteration, fdb_bool_t snapshot, fdb_bool_t reverse);
 	FDBFuture* (*transactionGetVersionstamp)(FDBTransaction* tr);
+	FDBFuture* (*transactionGetEstimatedRangeSizeBytes)(FDBTransaction *tr, uint8_t const *beginKeyName, int beginKeyNameLength, uint8_t const *endKeyName, int endKeyNameLength);
+	FDBFuture* (*transactionGetRangeSplitPoints)(FDBTransaction *tr, uint8_t const *beginKeyName, int beginKeyNameLength, uint8_t const *endKeyName, int endKeyNameLength, int64_t chunkSize);
+	FDBFuture* (*transactionGetLargeValue)(FDBTransaction *tr, uint8_t const *keyName, int keyNameLength, int64_t offset, int length, fdb_bool_t snapshot);
+	FDBFuture* (*transactionGetLargeValueSize)(FDBTransaction *tr, uint8_t const *keyName, int keyNameLength, fdb_bool_t snapshot);
 
 	void (*transactionSet)(FDBTransaction *tr, uint8_t const *keyName, int keyNameLength, uint8_t const *value, int valueLength);
 	void (*transactionClear)(FDBTransaction *tr, uint8_t const *keyName, int keyNameLength);
 	void (*transactionClearRange)(FDBTransaction *tr, uint8_t const *beginKeyName, int beginKeyNameLength, uint8_t const *endKeyName, int endKeyNameLength);
 	void (*transactionAtomicOp)(FDBTransaction *tr, uint8_t const *keyName, int keyNameLength, uint8_t const *param, int paramLength, FDBMutationTypes::Option operationType);
+	void (*transactionSetLargeValue)(FDBTransaction *tr, uint8_t const *keyName, int keyNameLength, uint8_t const *value, int valueLength);
+	void (*transactionClearLargeValue)(FDBTransaction *tr, uint8_t const *keyName, int keyNameLength);
 	
 	FDBFuture* (*transactionCommit)(FDBTransaction *tr);
 	fdb_error_t (*transactionGetCommittedVersion)(FDBTransaction *tr, int64_t *outVersion);
@@ -101,11 +112,13 @@ struct FdbCApi : public ThreadSafeReferenceCounted<FdbCApi> {
 	fdb_error_t (*futureGetCluster)(FDBFuture *f, FDBCluster **outCluster);
 	fdb_error_t (*futureGetDatabase)(FDBFuture *f, FDBDatabase **outDb);
 	fdb_error_t (*futureGetVersion)(FDBFuture *f, int64_t *outVersion);
+	fdb_error_t (*futureGetInt64)(FDBFuture *f, int64_t *outValue);
 	fdb_error_t (*futureGetError)(FDBFuture *f);
 	fdb_error_t (*futureGetKey)(FDBFuture *f, uint8_t const **outKey, int *outKeyLength);
 	fdb_error_t (*futureGetValue)(FDBFuture *f, fdb_bool_t *outPresent, uint8_t const **outValue, int *outValueLength);
 	fdb_error_t (*futureGetStringArray)(FDBFuture *f, const char ***outStrings, int *outCount);
 	fdb_error_t (*futureGetKeyValueArray)(FDBFuture *f, FDBKeyValue const ** outKV, int *outCount, fdb_bool_t *outMore);
+	fdb_error_t (*futureGetKeyArray)(FDBFuture *f, FDBKey const ** outKeys, int *outCount);
 	fdb_error_t (*futureSetCallback)(FDBFuture *f, FDBCallback callback, void *callback_parameter);
 	void (*futureCancel)(FDBFuture *f);
 	void (*futureDestroy)(FDBFuture *f);
@@ -128,6 +141,10 @@ public:
 	ThreadFuture<Standalone<RangeResultRef>> getRange( const KeyRangeRef& keys, GetRangeLimits limits, bool snapshot=false, bool reverse=false);
 	ThreadFuture<Standalone<VectorRef<const char*>>> getAddressesForKey(const KeyRef& key);
 	ThreadFuture<Standalone<StringRef>> getVersionstamp();
+	ThreadFuture<int64_t> getEstimatedRangeSizeBytes(const KeyRangeRef& keys);
+	ThreadFuture<Standalone<VectorRef<KeyRef>>> getRangeSplitPoints(const KeyRangeRef& keys, int64_t chunkSize);
+	ThreadFuture<Optional<Value>> getLargeValue(const KeyRef& key, int64_t offset, int length, bool snapshot=false);
+	ThreadFuture<int64_t> getLargeValueSize(const KeyRef& key, bool snapshot=false);
  
 	void addReadConflictRange(const KeyRangeRef& keys);
 
@@ -136,6 +153,8 @@ public:
 	void clear(const KeyRef& begin, const KeyRef& end);
 	void clear(const KeyRangeRef& range);
 	void clear(const KeyRef& key);
+	void setLargeValue(const KeyRef& key, const ValueRef& value);
+	void clearLargeValue(const KeyRef& key);
 
 	ThreadFuture<Void> watch(const KeyRef& key);
 
@@ -230,6 +249,10 @@ public:
 	ThreadFuture<Standalone<RangeResultRef>> getRange( const KeyRangeRef& keys, GetRangeLimits limits, bool snapshot=false, bool reverse=false);
 	ThreadFuture<Standalone<VectorRef<const char*>>> getAddressesForKey(const KeyRef& key);
 	ThreadFuture<Standalone<StringRef>> getVersionstamp();
+	ThreadFuture<int64_t> getEstimatedRangeSizeBytes(const KeyRangeRef& keys);
+	ThreadFuture<Standalone<VectorRef<KeyRef>>> getRangeSplitPoints(const KeyRangeRef& keys, int64_t chunkSize);
+	ThreadFuture<Optional<Value>> getLargeValue(const KeyRef& key, int64_t offset, int length, bool snapshot=false);
+	ThreadFuture<int64_t> getLargeValueSize(const KeyRef& key, bool snapshot=false);
  
 	void addReadConflictRange(const KeyRangeRef& keys);
 
@@ -238,6 +261,8 @@ public:
 	void clear(const KeyRef& begin, const KeyRef& end);
 	void clear(const KeyRangeRef& range);
 	void clear(const KeyRef& key);
+	void setLargeValue(const KeyRef& key, const ValueRef& value);
+	void clearLargeValue(const KeyRef& key);
 
 	ThreadFuture<Void> watch(const KeyRef& key);
 
@@ -320,11 +345,12 @@ struct ClientInfo : ThreadSafeReferenceCounted<ClientInfo> {
 	std::string libPath;
 	bool external;
 	bool failed;
+	int threadIndex; // Which copy of its library this is, when CLIENT_THREADS_PER_VERSION > 1
 	std::vector<std::pair<void (*)(void*), void*>> threadCompletionHooks;
 
-	ClientInfo() : protocolVersion(0), api(NULL), external(false), failed(true) {}
-	ClientInfo(IClientApi *api) : protocolVersion(0), api(api), libPath("internal"), external(false), failed(false) {}
-	ClientInfo(IClientApi *api, std::string libPath) : protocolVersion(0), api(api), libPath(libPath), external(true), failed(false) {}
+	ClientInfo() : protocolVersion(0), api(NULL), external(false), failed(true), threadIndex(0) {}
+	ClientInfo(IClientApi *api) : protocolVersion(0), api(api), libPath("internal"), external(false), failed(false), threadIndex(0) {}
+	ClientInfo(IClientApi *api, std::string libPath, int threadIndex = 0) : protocolVersion(0), api(api), libPath(libPath), external(true), failed(false), threadIndex(threadIndex) {}
 
 	void loadProtocolVersion();
 	bool canReplace(Reference<ClientInfo> other) const;
@@ -335,7 +361,7 @@ class MultiVersionApi;
 class MultiVersionCluster : public ICluster, ThreadSafeReferenceCounted<MultiVersionCluster> {
 public:
 	MultiVersionCluster() : clusterState(new ClusterState()) {} // Used in testing workloads
-	MultiVersionCluster(MultiVersionApi *api, std::string clusterFilePath, Reference<ICluster> cluster);
+	MultiVersionCluster(MultiVersionApi *api, std::string clusterFilePath, Reference<ICluster> cluster, int threadIndex = 0);
 	~MultiVersionCluster();
 
 	ThreadFuture<Reference<IDatabase>> createDatabase(Standalone<StringRef> dbName);
@@ -427,11 +453,17 @@ private:
 	void addExternalLibraryDirectory(std::string path);
 	void disableLocalClient();
 	void setSupportedClientVersions(Standalone<StringRef> versions);
+	void setThreadCount(int threadCount);
+	void copyExternalLibraries();
 
 	void setNetworkOptionInternal(FDBNetworkOptions::Option option, Optional<StringRef> value);
 
 	Reference<ClientInfo> localClient;
 	std::map<std::string, Reference<ClientInfo>> externalClients;
+	std::vector<std::string> libraryCopies;
+
+	int threadCount;
+	int nextThread; // The thread index of the next cluster created
 
 	bool networkStartSetup;
 	volatile bool networkSetup;
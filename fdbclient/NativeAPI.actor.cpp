@@ -40,6 +40,8 @@
 #include "flow/Knobs.h"
 #include "fdbclient/Knobs.h"
 #include "fdbrpc/Net2FileSystem.h"
+#include "fdbrpc/IAsyncFile.h"
+#include "flow/UnitTest.h"
 
 #include <iterator>
 
@@ -207,8 +209,13 @@ ACTOR Future<Void> databaseLogger( DatabaseContext *cx ) {
 		Void _ = wait( delay( CLIENT_KNOBS->SYSTEM_MONITOR_INTERVAL, cx->taskID ) );
 		TraceEvent("TransactionMetrics")
 			.detail("ReadVersions", cx->transactionReadVersions)
+			.detail("ReadVersionBatches", cx->transactionReadVersionBatches)
+			.detail("ReadVersionsShared", cx->transactionReadVersionsShared)
+			.detail("ReadVersionsRecent", cx->transactionReadVersionsRecent)
 			.detail("LogicalUncachedReads", cx->transactionLogicalReads)
 			.detail("PhysicalReadRequests", cx->transactionPhysicalReads)
+			.detail("BatchedPointReads", cx->transactionBatchedPointReads)
+			.detail("StreamedRangeReads", cx->transactionStreamedRangeReads)
 			.detail("CommittedMutations", cx->transactionCommittedMutations)
 			.detail("CommittedMutationBytes", cx->transactionCommittedMutationBytes)
 			.detail("CommitStarted", cx->transactionsCommitStarted)
@@ -217,6 +224,11 @@ ACTOR Future<Void> databaseLogger( DatabaseContext *cx ) {
 			.detail("FutureVersions", cx->transactionsFutureVersions)
 			.detail("NotCommitted", cx->transactionsNotCommitted)
 			.detail("MaybeCommitted", cx->transactionsMaybeCommitted)
+			.detail("OutstandingWatches", cx->outstandingWatches)
+			.detail("SharedWatches", cx->sharedWatches.size())
+			.detail("WatchesShared", cx->watchesShared)
+			.detail("CachedReads", cx->transactionCachedReads)
+			.detail("ReadCacheBytes", cx->readCacheBytes)
 			.detail("MeanLatency", 1000 * cx->latencies.mean())
 			.detail("MedianLatency", 1000 * cx->latencies.median())
 			.detail("Latency90", 1000 * cx->latencies.percentile(0.90))
@@ -343,6 +355,33 @@ ACTOR static Future<Void> delExcessClntTxnEntriesActor(Transaction *tr, int64_t
 	}
 }
 
+// Appends each buffered transaction profile to fileName as a 32-bit little endian length followed by its serialized events (the
+// bytes that would otherwise be split into chunks under fdbClientInfoPrefixRange), so that profiling at a useful rate adds no
+// load to the cluster being profiled.  Another process can follow the file; once it grows past sizeLimit it is moved to
+// <fileName>.old and a new one is started.
+ACTOR static Future<Void> writeTransactionProfiles(std::vector<BinaryWriter> *profiles, std::string fileName, int64_t sizeLimit) {
+	state BinaryWriter wr(Unversioned());
+	for (auto &bw : *profiles) {
+		wr << littleEndian32(uint32_t(bw.getLength()));
+		wr.serializeBytes(bw.getData(), bw.getLength());
+	}
+	if (!wr.getLength())
+		return Void();
+
+	state int flags = IAsyncFile::OPEN_NO_AIO | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE;
+	state Reference<IAsyncFile> f = wait(IAsyncFileSystem::filesystem()->open(fileName, flags, 0644));
+	state int64_t size = wait(f->size());
+	if (size > 0 && size + wr.getLength() > sizeLimit) {
+		f = Reference<IAsyncFile>();
+		renameFile(fileName, fileName + ".old");
+		Reference<IAsyncFile> newFile = wait(IAsyncFileSystem::filesystem()->open(fileName, flags, 0644));
+		f = newFile;
+		size = 0;
+	}
+	Void _ = wait(f->write(wr.getData(), wr.getLength(), size));
+	return Void();
+}
+
 // The reason for getting a pointer to DatabaseContext instead of a reference counted object is because reference counting will increment reference count for
 // DatabaseContext which holds the future of this actor. This creates a cyclic reference and hence this actor and Database object will not be destroyed at all.
 ACTOR static Future<Void> clientStatusUpdateActor(DatabaseContext *cx) {
@@ -352,6 +391,24 @@ ACTOR static Future<Void> clientStatusUpdateActor(DatabaseContext *cx) {
 	state int txBytes = 0;
 
 	loop {
+		if (!CLIENT_KNOBS->CSI_PROFILE_FILE.empty()) {
+			ASSERT(cx->clientStatusUpdater.outStatusQ.empty());
+			cx->clientStatusUpdater.inStatusQ.swap(cx->clientStatusUpdater.outStatusQ);
+			try {
+				int64_t sizeLimit = cx->clientInfo->get().clientTxnInfoSizeLimit == -1 ? CLIENT_KNOBS->CSI_SIZE_LIMIT : cx->clientInfo->get().clientTxnInfoSizeLimit;
+				Void _ = wait(writeTransactionProfiles(&cx->clientStatusUpdater.outStatusQ, CLIENT_KNOBS->CSI_PROFILE_FILE, sizeLimit));
+			}
+			catch (Error& e) {
+				if (e.code() == error_code_actor_cancelled) {
+					throw;
+				}
+				TraceEvent(SevWarnAlways, "UnableToWriteClientProfiles").error(e).detail("File", CLIENT_KNOBS->CSI_PROFILE_FILE);
+			}
+			cx->clientStatusUpdater.outStatusQ.clear();
+			Void _ = wait(delay(CLIENT_KNOBS->CSI_STATUS_DELAY));
+			continue;
+		}
+
 		try {
 			ASSERT(cx->clientStatusUpdater.outStatusQ.empty());
 			cx->clientStatusUpdater.inStatusQ.swap(cx->clientStatusUpdater.outStatusQ);
@@ -465,9 +522,9 @@ DatabaseContext::DatabaseContext(
 	Standalone<StringRef> dbName, Standalone<StringRef> dbId,
 	int taskID, LocalityData clientLocality, bool enableLocalityLoadBalance, bool lockAware )
   : clientInfo(clientInfo), masterProxiesChangeTrigger(), cluster(cluster), clientInfoMonitor(clientInfoMonitor), dbName(dbName), dbId(dbId),
-	transactionReadVersions(0), transactionLogicalReads(0), transactionPhysicalReads(0), transactionCommittedMutations(0), transactionCommittedMutationBytes(0), transactionsCommitStarted(0), 
+	transactionReadVersions(0), transactionReadVersionBatches(0), transactionReadVersionsShared(0), transactionReadVersionsRecent(0), readVersionStaleness(0), recentReadVersion(invalidVersion), recentReadVersionTime(0), recentReadVersionLocked(false), transactionLogicalReads(0), transactionPhysicalReads(0), transactionBatchedPointReads(0), transactionStreamedRangeReads(0), transactionCommittedMutations(0), transactionCommittedMutationBytes(0), transactionsCommitStarted(0), 
 	transactionsCommitCompleted(0), transactionsTooOld(0), transactionsFutureVersions(0), transactionsNotCommitted(0), transactionsMaybeCommitted(0), taskID(taskID),
-	outstandingWatches(0), maxOutstandingWatches(CLIENT_KNOBS->DEFAULT_MAX_OUTSTANDING_WATCHES), clientLocality(clientLocality), enableLocalityLoadBalance(enableLocalityLoadBalance), lockAware(lockAware),
+	outstandingWatches(0), maxOutstandingWatches(CLIENT_KNOBS->DEFAULT_MAX_OUTSTANDING_WATCHES), watchesShared(0), readCacheLimit(0), readCacheBytes(0), transactionCachedReads(0), clientLocality(clientLocality), enableLocalityLoadBalance(enableLocalityLoadBalance), lockAware(lockAware),
 	latencies(1000), readLatencies(1000), commitLatencies(1000), GRVLatencies(1000), mutationsPerCommit(1000), bytesPerCommit(1000) 
 {
 	logger = databaseLogger( this );
@@ -487,6 +544,13 @@ ACTOR static Future<Void> monitorClientInfo( Reference<AsyncVar<Optional<Cluster
 {
 	try {
 		loop {
+			// Every client gets its reply (or sees a new cluster controller) at the same moment, so those that already have usable
+			// information wait a random while before asking again.  A change in the meantime is not lost, since the cluster controller
+			// answers immediately when knownClientInfoID is out of date.
+			if( outInfo->get().id != UID() && clusterInterface->get().present() ) {
+				Void _ = wait( delay( g_random->random01() * CLIENT_KNOBS->CLIENT_INFO_REQUEST_JITTER ) );
+			}
+
 			OpenDatabaseRequest req;
 			req.knownClientInfoID = outInfo->get().id;
 			req.dbName = dbName;
@@ -543,6 +607,7 @@ Database DatabaseContext::create( Reference<AsyncVar<ClientDBInfo>> info, Future
 
 DatabaseContext::~DatabaseContext() {
 	monitorMasterProxiesInfoChange.cancel();
+	cachedRangesMonitor.cancel();
 	for(auto it = ssid_locationInfo.begin(); it != ssid_locationInfo.end(); it = ssid_locationInfo.erase(it))
 		it->second->notifyContextDestroyed();
 	ASSERT( ssid_locationInfo.empty() );
@@ -635,6 +700,39 @@ int64_t extractIntOption( Optional<StringRef> value, int64_t minValue, int64_t m
 	return passed;
 }
 
+// Keeps cx->cachedRanges up to date with clientCacheRangesRange.  A stale list only costs cache misses, since getValueCached() checks
+// keys against the end the proxies store with each range's version, rather than against this list.
+ACTOR static Future<Void> monitorCachedRanges( DatabaseContext* cx ) {
+	state Transaction tr;
+	loop {
+		try {
+			tr = Transaction( Database( Reference<DatabaseContext>::addRef( cx ) ) );
+			tr.setOption( FDBTransactionOptions::LOCK_AWARE );
+			Standalone<RangeResultRef> ranges = wait( tr.getRange( clientCacheRangesRange, CLIENT_KNOBS->TOO_MANY ) );
+
+			std::map<Key, Reference<DatabaseContext::CachedRange>> updated;
+			for( auto& kv : ranges ) {
+				Key begin = decodeClientCacheRangeKey( kv.key );
+				auto old = cx->cachedRanges.find( begin );
+				if( old != cx->cachedRanges.end() && old->second->end == kv.value )
+					updated[begin] = old->second;
+				else if( begin < kv.value )
+					updated[begin] = Reference<DatabaseContext::CachedRange>( new DatabaseContext::CachedRange( begin, kv.value ) );
+			}
+			for( auto& r : cx->cachedRanges )
+				if( !updated.count( r.first ) )
+					cx->clearCachedRange( r.second.getPtr() );
+			cx->cachedRanges.swap( updated );
+		} catch( Error& e ) {
+			if( e.code() == error_code_actor_cancelled )
+				throw;
+			TraceEvent(SevWarn, "ClientCacheRangesError").error(e);
+		}
+		tr = Transaction();  // So that the database can be destroyed in the meantime
+		Void _ = wait( delay( CLIENT_KNOBS->CLIENT_CACHE_RANGES_REFRESH_INTERVAL, cx->taskID ) );
+	}
+}
+
 uint64_t extractHexOption( StringRef value ) {
 	char* end;
 	uint64_t id = strtoull( value.toString().c_str(), &end, 16 );
@@ -655,6 +753,20 @@ void DatabaseContext::setOption( FDBDatabaseOptions::Option option, Optional<Str
 			ssid_locationInfo.clear();
 			locationCache.insert( allKeys, Reference<LocationInfo>() );
 			break;
+		case FDBDatabaseOptions::READ_VERSION_STALENESS:
+			readVersionStaleness = extractIntOption(value, 0, std::numeric_limits<int>::max()) / 1000.0;
+			break;
+		case FDBDatabaseOptions::CLIENT_READ_CACHE_SIZE:
+			readCacheLimit = extractIntOption(value, 0);
+			for(auto& r : cachedRanges)
+				if( readCacheBytes > readCacheLimit )
+					clearCachedRange( r.second.getPtr() );
+			if( !readCacheLimit ) {
+				cachedRanges.clear();
+				cachedRangesMonitor = Future<Void>();
+			} else if( !cachedRangesMonitor.isValid() )
+				cachedRangesMonitor = monitorCachedRanges( this );
+			break;
 		case FDBDatabaseOptions::MAX_WATCHES:
 			maxOutstandingWatches = (int)extractIntOption(value, 0, CLIENT_KNOBS->ABSOLUTE_MAX_WATCHES);
 			break;
@@ -757,6 +869,10 @@ void setNetworkOption(FDBNetworkOptions::Option option, Optional<StringRef> valu
 			if(value.present())
 				networkOptions.traceLogGroup = value.get().toString();
 			break;
+		case FDBNetworkOptions::TRACE_RATE_LIMIT:
+			validateOptionValue(value, true);
+			setTraceEventRateLimits(value.get().toString());
+			break;
 		case FDBNetworkOptions::KNOB: {
 			validateOptionValue(value, true);
 
@@ -1065,16 +1181,37 @@ ACTOR Future< pair<KeyRange,Reference<LocationInfo>> > getKeyLocation( Database
 
 	if( info.debugID.present() )
 		g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getKeyLocation.Before");
-	
+
+	// Ask for the locations of the whole uncached gap around key (up to LOCATION_PREFETCH_SHARD_LIMIT shards), so that a client
+	// with a cold cache doesn't pay a proxy round trip for each neighbouring shard it touches
+	state GetKeyServerLocationsRequest req(key, Optional<KeyRef>(), 100, isBackward, key.arena());
+	auto gap = isBackward ? cx->locationCache.rangeContainingKeyBefore(key) : cx->locationCache.rangeContaining(key);
+	if( !gap.value() && CLIENT_KNOBS->LOCATION_PREFETCH_SHARD_LIMIT > 1 ) {
+		req.limit = CLIENT_KNOBS->LOCATION_PREFETCH_SHARD_LIMIT;
+		if( isBackward ) {
+			req.begin = KeyRef(req.arena, gap.begin());
+			req.end = key;
+		} else {
+			req.end = KeyRef(req.arena, gap.end());
+		}
+	}
+
 	loop {
 		choose {
 			when ( Void _ = wait( cx->onMasterProxiesChanged() ) ) {}
-			when ( GetKeyServerLocationsReply rep = wait( loadBalance( cx->getMasterProxies(), &MasterProxyInterface::getKeyServersLocations, GetKeyServerLocationsRequest(key, Optional<KeyRef>(), 100, isBackward, key.arena()), TaskDefaultPromiseEndpoint ) ) ) {
+			when ( GetKeyServerLocationsReply _rep = wait( loadBalance( cx->getMasterProxies(), &MasterProxyInterface::getKeyServersLocations, req, TaskDefaultPromiseEndpoint ) ) ) {
+				state GetKeyServerLocationsReply rep = _rep;
 				if( info.debugID.present() )
 					g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getKeyLocation.After");
-				ASSERT( rep.results.size() == 1 );
+				ASSERT( rep.results.size() >= 1 && rep.results.size() <= req.limit );
+				ASSERT( isBackward ? rep.results[0].first.begin < key && key <= rep.results[0].first.end : rep.results[0].first.contains(key) );
 
-				auto locationInfo = cx->setCachedLocation(rep.results[0].first, rep.results[0].second);
+				state Reference<LocationInfo> locationInfo = cx->setCachedLocation(rep.results[0].first, rep.results[0].second);
+				state int shard = 1;
+				for (; shard < rep.results.size(); shard++) {
+					cx->setCachedLocation(rep.results[shard].first, rep.results[shard].second);
+					Void _ = wait(yield());
+				}
 				return std::make_pair(KeyRange(rep.results[0].first, rep.arena), locationInfo);
 			}
 		}
@@ -1088,7 +1225,8 @@ ACTOR Future< vector< pair<KeyRange,Reference<LocationInfo>> > > getKeyRangeLoca
 	loop {
 		choose {
 			when ( Void _ = wait( cx->onMasterProxiesChanged() ) ) {}
-			when ( GetKeyServerLocationsReply _rep = wait( loadBalance( cx->getMasterProxies(), &MasterProxyInterface::getKeyServersLocations, GetKeyServerLocationsRequest(keys.begin, keys.end, limit, reverse, keys.arena()), TaskDefaultPromiseEndpoint ) ) ) {
+			// Locations past the requested limit (up to LOCATION_PREFETCH_SHARD_LIMIT shards) are only cached, for the requests that will follow this one
+			when ( GetKeyServerLocationsReply _rep = wait( loadBalance( cx->getMasterProxies(), &MasterProxyInterface::getKeyServersLocations, GetKeyServerLocationsRequest(keys.begin, keys.end, std::max(limit, CLIENT_KNOBS->LOCATION_PREFETCH_SHARD_LIMIT), reverse, keys.arena()), TaskDefaultPromiseEndpoint ) ) ) {
 				state GetKeyServerLocationsReply rep = _rep;
 				if( info.debugID.present() )
 					g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getKeyLocations.After");
@@ -1098,7 +1236,9 @@ ACTOR Future< vector< pair<KeyRange,Reference<LocationInfo>> > > getKeyRangeLoca
 				state int shard = 0;
 				for (; shard < rep.results.size(); shard++) {
 					//FIXME: these shards are being inserted into the map sequentially, it would be much more CPU efficient to save the map pairs and insert them all at once.
-					results.push_back( make_pair(rep.results[shard].first & keys, cx->setCachedLocation(rep.results[shard].first, rep.results[shard].second)) );
+					auto locationInfo = cx->setCachedLocation(rep.results[shard].first, rep.results[shard].second);
+					if( shard < limit )
+						results.push_back( make_pair(rep.results[shard].first & keys, locationInfo) );
 					Void _ = wait(yield());
 				}
 
@@ -1143,6 +1283,92 @@ Future<Void> Transaction::warmRange(Database cx, KeyRange keys) {
 	return warmRange_impl(this, cx, keys);
 }
 
+Optional<Value> findBatchedValue( GetValuesReply const& reply, KeyRef const& key ) {
+	auto kv = std::lower_bound( reply.data.begin(), reply.data.end(), key, KeyValueRef::OrderByKey() );
+	if( kv != reply.data.end() && kv->key == key )
+		return Value( kv->value, reply.arena );
+	return Optional<Value>();
+}
+
+// Point reads issued in the same run loop iteration at the same version to the same shard are sent as a single GetValuesRequest.
+// The read which creates a batch sends it once the others have had a chance to join and hands them their results.  If it is
+// cancelled first, the reads that joined see broken_promise and batch again.
+ACTOR Future<Optional<Value>> getValueBatched( Database cx, Key key, Version ver, pair<KeyRange, Reference<LocationInfo>> ssi, int taskID )
+{
+	state std::pair<Version, Key> batchKey( ver, ssi.first.begin );
+	loop {
+		state Future<Optional<Value>> joined;
+		{
+			auto existing = cx->getValuesBatches.find( batchKey );
+			if( existing != cx->getValuesBatches.end() && existing->second->location == ssi.second && existing->second->requests.size() + 1 < CLIENT_KNOBS->GET_VALUES_BATCH_MAX ) {
+				Promise<Optional<Value>> p;
+				existing->second->requests.push_back( std::make_pair( key, p ) );
+				joined = p.getFuture();
+			}
+		}
+
+		if( joined.isValid() ) {
+			try {
+				Optional<Value> value = wait( joined );
+				return value;
+			} catch( Error& e ) {
+				if( e.code() != error_code_broken_promise )
+					throw;
+				TEST( true ); // Point read batch abandoned by its sender
+			}
+		} else {
+			state Reference<DatabaseContext::GetValuesBatch> batch( new DatabaseContext::GetValuesBatch( ssi.second ) );
+			cx->getValuesBatches[batchKey] = batch;
+			try {
+				Void _ = wait( delay( 0, taskID ) );
+			} catch( Error& e ) {
+				auto it = cx->getValuesBatches.find( batchKey );
+				if( it != cx->getValuesBatches.end() && it->second == batch )
+					cx->getValuesBatches.erase( it );
+				throw;
+			}
+			{
+				auto it = cx->getValuesBatches.find( batchKey );
+				if( it != cx->getValuesBatches.end() && it->second == batch )
+					cx->getValuesBatches.erase( it );
+			}
+
+			++cx->transactionPhysicalReads;
+			if( batch->requests.empty() ) {
+				GetValueReply reply = wait( loadBalance( ssi.second, &StorageServerInterface::getValue, GetValueRequest(key, ver, Optional<UID>()), TaskDefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL ) );
+				return reply.value;
+			}
+
+			state GetValuesRequest req;
+			req.version = ver;
+			{
+				std::vector<KeyRef> keys;
+				keys.push_back( key );
+				for( auto& r : batch->requests )
+					keys.push_back( r.first );
+				std::sort( keys.begin(), keys.end() );
+				keys.resize( std::unique( keys.begin(), keys.end() ) - keys.begin() );
+				for( auto& k : keys )
+					req.keys.push_back_deep( req.arena, k );
+			}
+			cx->transactionBatchedPointReads += batch->requests.size() + 1;
+
+			try {
+				GetValuesReply reply = wait( loadBalance( ssi.second, &StorageServerInterface::getValues, req, TaskDefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL ) );
+				for( auto& r : batch->requests )
+					r.second.send( findBatchedValue( reply, r.first ) );
+				return findBatchedValue( reply, key );
+			} catch( Error& e ) {
+				if( e.code() == error_code_actor_cancelled )
+					throw;
+				for( auto& r : batch->requests )
+					r.second.sendError( e );
+				throw;
+			}
+		}
+	}
+}
+
 ACTOR Future<Optional<Value>> getValue( Future<Version> version, Key key, Database cx, TransactionInfo info, Reference<TransactionLogInfo> trLogInfo )
 {
 	state Version ver = wait( version );
@@ -1175,12 +1401,19 @@ ACTOR Future<Optional<Value>> getValue( Future<Version> version, Key key, Databa
 			++cx->getValueSubmitted;
 			startTime = timer_int();
 			startTimeD = now();
-			++cx->transactionPhysicalReads;
-			state GetValueReply reply = wait( loadBalance( ssi.second, &StorageServerInterface::getValue, GetValueRequest(key, ver, getValueID), TaskDefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL ) );
+			state Optional<Value> value;
+			if( CLIENT_KNOBS->GET_VALUES_BATCH_MAX > 1 && !getValueID.present() && info.readPriority == ReadPriorityDefault ) {
+				Optional<Value> v = wait( getValueBatched( cx, key, ver, ssi, info.taskID ) );
+				value = v;
+			} else {
+				++cx->transactionPhysicalReads;
+				GetValueReply reply = wait( loadBalance( ssi.second, &StorageServerInterface::getValue, GetValueRequest(key, ver, getValueID, info.readPriority), TaskDefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL ) );
+				value = reply.value;
+			}
 			double latency = now() - startTimeD;
 			cx->readLatencies.addSample(latency);
 			if (trLogInfo) {
-				int valueSize = reply.value.present() ? reply.value.get().size() : 0;
+				int valueSize = value.present() ? value.get().size() : 0;
 				trLogInfo->addLog(FdbClientLogEvents::EventGet(startTimeD, latency, valueSize, key));
 			}
 			cx->getValueCompleted->latency = timer_int() - startTime;
@@ -1193,7 +1426,7 @@ ACTOR Future<Optional<Value>> getValue( Future<Version> version, Key key, Databa
 					.detail("ReqVersion", ver)
 					.detail("ReplySize", reply.value.present() ? reply.value.get().size() : -1);*/
 			}
-			return reply.value;
+			return value;
 		} catch (Error& e) {
 			cx->getValueCompleted->latency = timer_int() - startTime;
 			cx->getValueCompleted->log();
@@ -1217,6 +1450,61 @@ ACTOR Future<Optional<Value>> getValue( Future<Version> version, Key key, Databa
 	}
 }
 
+// Reads key, which is in range, from what this client has cached of the range where it can.  The proxies set the range's
+// clientCacheVersionKeyFor() to the version of every commit that writes in it, so read at version v it gives the last change to the range
+// at or before v, and any value read from the range since that change is still its value at v.  The cache keeps the entries of one such
+// generation of a range at a time, and uses them at a read version only once it has read the range's version key at that version.  That
+// read is shared by all the reads from the range at the same version, so the cache pays off when transactions read several keys of a range,
+// or share read versions (see FDBDatabaseOptions::READ_VERSION_STALENESS).
+ACTOR Future<Optional<Value>> getValueCached( Future<Version> version, Key key, Reference<DatabaseContext::CachedRange> range, Database cx, TransactionInfo info, Reference<TransactionLogInfo> trLogInfo )
+{
+	state Version ver = wait( version );
+	if( ver > range->validationVersion ) {
+		range->validationVersion = ver;
+		range->validation = getValue( ver, clientCacheVersionKeyFor( range->begin ), cx, info, Reference<TransactionLogInfo>() );
+	}
+
+	if( ver == range->validationVersion ) {
+		state Future<Optional<Value>> validation = range->validation;
+		Optional<Value> v = wait( validation );
+		state Version changed;
+		KeyRef end;
+		if( v.present() && decodeClientCacheVersionValue( v.get(), &changed, &end ) && key < end ) {
+			if( changed > range->generation ) {
+				cx->clearCachedRange( range.getPtr() );
+				range->generation = changed;
+			}
+			if( changed == range->generation ) {
+				auto e = range->entries.find( key );
+				if( e != range->entries.end() ) {
+					++cx->transactionCachedReads;
+					return e->second;
+				}
+
+				state Optional<Value> value = wait( getValue( ver, key, cx, info, trLogInfo ) );
+				auto current = cx->cachedRanges.find( range->begin );
+				if( range->generation == changed && current != cx->cachedRanges.end() && current->second.getPtr() == range.getPtr() && !range->entries.count( key ) ) {
+					int64_t bytes = key.size() + (value.present() ? value.get().size() : 0) + 64;
+					range->entries[key] = value;
+					range->bytes += bytes;
+					cx->readCacheBytes += bytes;
+					while( cx->readCacheBytes > cx->readCacheLimit && range->entries.size() ) {
+						auto evict = range->entries.begin();
+						int64_t evictBytes = evict->first.size() + (evict->second.present() ? evict->second.get().size() : 0) + 64;
+						range->bytes -= evictBytes;
+						cx->readCacheBytes -= evictBytes;
+						range->entries.erase( evict );
+					}
+				}
+				return value;
+			}
+		}
+	}
+
+	Optional<Value> value = wait( getValue( ver, key, cx, info, trLogInfo ) );
+	return value;
+}
+
 ACTOR Future<Key> getKey( Database cx, KeySelector k, Future<Version> version, TransactionInfo info ) {
 	Version ver = wait(version);
 
@@ -1289,7 +1577,8 @@ ACTOR Future<Version> waitForCommittedVersion( Database cx, Version version ) {
 
 Future<Void> readVersionBatcher( DatabaseContext* const& cx, FutureStream< std::pair< Promise<GetReadVersionReply>, Optional<UID> > > const& versionStream, uint32_t const& flags );
 
-ACTOR Future< Void > watchValue( Future<Version> version, Key key, Optional<Value> value, Database cx, int readVersionFlags, TransactionInfo info )
+// Returns the version at which key was seen to no longer have value, once that version is known to be committed
+ACTOR Future< Version > watchValue( Future<Version> version, Key key, Optional<Value> value, Database cx, int readVersionFlags, TransactionInfo info )
 {
 	state Version ver = wait( version );
 	validateVersion(ver);
@@ -1322,7 +1611,7 @@ ACTOR Future< Void > watchValue( Future<Version> version, Key key, Optional<Valu
 			//TraceEvent("watcherCommitted").detail("committedVersion", v).detail("watchVersion", resp).detail("key", printable( key )).detail("value", printable(value));
 
 			if( v - resp < 50000000 ) // False if there is a master failure between getting the response and getting the committed version, Dependent on SERVER_KNOBS->MAX_VERSIONS_IN_FLIGHT
-				return Void();
+				return resp;
 			ver = v;
 		} catch (Error& e) {
 			if (e.code() == error_code_wrong_shard_server || e.code() == error_code_all_alternatives_failed) {
@@ -1364,51 +1653,80 @@ void transformRangeLimits(GetRangeLimits limits, bool reverse, GetKeyValuesReque
 	}
 }
 
+Future<GetKeyValuesReply> getExactRangeShard( Database const& cx, Version version, pair<KeyRange, Reference<LocationInfo>> const& location,
+	GetRangeLimits limits, bool reverse, TransactionInfo const& info, Optional<ReadFilter> const& filter )
+{
+	GetKeyValuesRequest req;
+	req.version = version;
+	req.begin = firstGreaterOrEqual( location.first.begin );
+	req.end = firstGreaterOrEqual( location.first.end );
+	if( filter.present() )
+		req.filter = ReadFilterRef( req.arena, filter.get() );
+
+	transformRangeLimits(limits, reverse, req);
+	ASSERT(req.limitBytes > 0 && req.limit != 0 && req.limit < 0 == reverse);
+
+	//FIXME: buggify byte limits on internal functions that use them, instead of globally
+	req.debugID = info.debugID;
+	req.priority = info.readPriority;
+
+	if( info.debugID.present() ) {
+		g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getExactRange.Before");
+		/*TraceEvent("TransactionDebugGetExactRangeInfo", info.debugID.get())
+		.detail("ReqBeginKey", printable(req.begin.getKey()))
+		.detail("ReqEndKey", printable(req.end.getKey()))
+		.detail("ReqLimit", req.limit)
+		.detail("ReqLimitBytes", req.limitBytes)
+		.detail("ReqVersion", req.version)
+		.detail("Reverse", reverse)
+		.detail("Servers", location.second->description());*/
+	}
+	++cx->transactionPhysicalReads;
+	return loadBalance( location.second, &StorageServerInterface::getKeyValues, req, TaskDefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL );
+}
+
+// With a filter, the rows returned are those that pass it, and if there are more the result's readThrough is where the next read
+// should begin (or in reverse, end)
 ACTOR Future<Standalone<RangeResultRef>> getExactRange( Database cx, Version version,
-	KeyRange keys, GetRangeLimits limits, bool reverse, TransactionInfo info )
+	KeyRange keys, GetRangeLimits limits, bool reverse, TransactionInfo info, Optional<ReadFilter> filter )
 {
 	state Standalone<RangeResultRef> output;
 
 	//printf("getExactRange( '%s', '%s' )\n", keys.begin.toString().c_str(), keys.end.toString().c_str());
 	loop {
-		state vector< pair<KeyRange, Reference<LocationInfo>> > locations = getCachedKeyRangeLocations( cx, keys, CLIENT_KNOBS->GET_RANGE_SHARD_LIMIT, reverse, &StorageServerInterface::getKeyValues);
+		state int shardLimit = std::max( CLIENT_KNOBS->GET_RANGE_SHARD_LIMIT, info.rangeParallelism );
+		state vector< pair<KeyRange, Reference<LocationInfo>> > locations = getCachedKeyRangeLocations( cx, keys, shardLimit, reverse, &StorageServerInterface::getKeyValues);
 		if (!locations.size()) {
-			vector< pair<KeyRange, Reference<LocationInfo>> > _locations = wait( getKeyRangeLocations( cx, keys, CLIENT_KNOBS->GET_RANGE_SHARD_LIMIT, reverse, info ) );
+			vector< pair<KeyRange, Reference<LocationInfo>> > _locations = wait( getKeyRangeLocations( cx, keys, shardLimit, reverse, info ) );
 			locations = std::move(_locations);
 		}
 
 		ASSERT( locations.size() );
 		state int shard = 0;
+		// Outstanding requests for the current shard and up to info.rangeParallelism-1 shards after it, each made with the limits
+		// that were left when it was sent
+		state vector<Future<GetKeyValuesReply>> replies( locations.size() );
 		loop {
-			const KeyRangeRef& range = locations[shard].first;
-
-			GetKeyValuesRequest req;
-			req.version = version;
-			req.begin = firstGreaterOrEqual( range.begin );
-			req.end = firstGreaterOrEqual( range.end );
-
-			transformRangeLimits(limits, reverse, req);
-			ASSERT(req.limitBytes > 0 && req.limit != 0 && req.limit < 0 == reverse);
-
-			//FIXME: buggify byte limits on internal functions that use them, instead of globally
-			req.debugID = info.debugID;
+			for( int s = shard; s < std::min<int>( shard + info.rangeParallelism, locations.size() ); s++ ) {
+				if( !replies[s].isValid() )
+					replies[s] = getExactRangeShard( cx, version, locations[s], limits, reverse, info, filter );
+			}
 
 			try {
-				if( info.debugID.present() ) {
-					g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getExactRange.Before");
-					/*TraceEvent("TransactionDebugGetExactRangeInfo", info.debugID.get())
-					.detail("ReqBeginKey", printable(req.begin.getKey()))
-					.detail("ReqEndKey", printable(req.end.getKey()))
-					.detail("ReqLimit", req.limit)
-					.detail("ReqLimitBytes", req.limitBytes)
-					.detail("ReqVersion", req.version)
-					.detail("Reverse", reverse)
-					.detail("Servers", locations[shard].second->description());*/
-				}
-				++cx->transactionPhysicalReads;
-				GetKeyValuesReply rep = wait( loadBalance( locations[shard].second, &StorageServerInterface::getKeyValues, req, TaskDefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL ) );
+				GetKeyValuesReply rep = wait( replies[shard] );
+				replies[shard] = Future<GetKeyValuesReply>();
 				if( info.debugID.present() )
 					g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getExactRange.After");
+
+				// A shard requested ahead of time may return more rows than the earlier shards left room for
+				if( limits.hasRowLimit() && rep.data.size() > limits.rows ) {
+					TEST(true); // Parallel getExactRange reply truncated to the remaining row limit
+					ASSERT( info.rangeParallelism > 1 );
+					rep.data.resize( rep.arena, limits.rows );
+					rep.more = true;
+					rep.scannedThrough = Optional<KeyRef>();
+				}
+
 				output.arena().dependsOn( rep.arena );
 				output.append( output.arena(), rep.data.begin(), rep.data.size() );
 
@@ -1418,18 +1736,31 @@ ACTOR Future<Standalone<RangeResultRef>> getExactRange( Database cx, Version ver
 				}
 				limits.decrement( rep.data );
 
+				// Where the next request to this shard continues from: after the last row returned, or with a filter that dropped
+				// rows, after the last row read
+				Key resumeKey;
+				if( rep.scannedThrough.present() )
+					resumeKey = rep.scannedThrough.get();
+				else if( rep.data.size() )
+					resumeKey = rep.data.back().key;
+
 				if (limits.isReached()) {
+					if( filter.present() && filter.get().dropsRows() ) {
+						Key next = reverse ? resumeKey : keyAfter( resumeKey );
+						output.arena().dependsOn( next.arena() );
+						output.readThrough = next;
+					}
 					output.more = true;
 					return output;
 				}
 
 				bool more = rep.more;
 				// If the reply says there is more but we know that we finished the shard, then fix rep.more
-				if( reverse && more && rep.data.size() > 0 && output[output.size()-1].key == locations[shard].first.begin )
+				if( reverse && more && (rep.data.size() > 0 || rep.scannedThrough.present()) && resumeKey == locations[shard].first.begin )
 					more = false;
 
 				if (more) {
-					if( !rep.data.size() ) {
+					if( !rep.data.size() && !rep.scannedThrough.present() ) {
 						TraceEvent(SevError, "GetExactRangeError").detail("Reason", "More data indicated but no rows present")
 							.detail("LimitBytes", limits.bytes).detail("LimitRows", limits.rows)
 							.detail("OutputSize", output.size()).detail("OutputBytes", output.expectedSize())
@@ -1439,9 +1770,9 @@ ACTOR Future<Standalone<RangeResultRef>> getExactRange( Database cx, Version ver
 					TEST(true);   // GetKeyValuesReply.more in getExactRange
 					// Make next request to the same shard with a beginning key just after the last key returned
 					if( reverse )
-						locations[shard].first = KeyRangeRef( locations[shard].first.begin, output[output.size()-1].key );
+						locations[shard].first = KeyRangeRef( locations[shard].first.begin, resumeKey );
 					else
-						locations[shard].first = KeyRangeRef( keyAfter( output[output.size()-1].key ), locations[shard].first.end );
+						locations[shard].first = KeyRangeRef( keyAfter( resumeKey ), locations[shard].first.end );
 				}
 
 				if (!more || locations[shard].first.empty()) {
@@ -1466,8 +1797,12 @@ ACTOR Future<Standalone<RangeResultRef>> getExactRange( Database cx, Version ver
 
 				// Soft byte limit - return results early if the user specified a byte limit and we got results
 				// This can prevent problems where the desired range spans many shards and would be too slow to
-				// fetch entirely.
-				if(limits.hasSatisfiedMinRows() && output.size() > 0) {
+				// fetch entirely.  Replies that have already arrived for the following shards are still used.
+				if(limits.hasSatisfiedMinRows() && output.size() > 0 && !(replies[shard].isValid() && replies[shard].isReady() && !replies[shard].isError())) {
+					if( filter.present() && filter.get().dropsRows() ) {
+						output.arena().dependsOn( locations[shard].first.arena() );
+						output.readThrough = reverse ? locations[shard].first.end : locations[shard].first.begin;
+					}
 					output.more = true;
 					return output;
 				}
@@ -1531,7 +1866,7 @@ ACTOR Future<Standalone<RangeResultRef>> getRangeFallback( Database cx, Version
 	//if b is allKeys.begin, we have either read through the beginning of the database,
 	//or allKeys.begin exists in the database and will be part of the conflict range anyways
 
-	Standalone<RangeResultRef> _r = wait( getExactRange(cx, version, KeyRangeRef(b, e), limits, reverse, info) );
+	Standalone<RangeResultRef> _r = wait( getExactRange(cx, version, KeyRangeRef(b, e), limits, reverse, info, Optional<ReadFilter>()) );
 	Standalone<RangeResultRef> r = _r;
 
 	if(b == allKeys.begin && ((reverse && !r.more) || !reverse))
@@ -1600,6 +1935,38 @@ void getRangeFinished(Reference<TransactionLogInfo> trLogInfo, double startTime,
 	}
 }
 
+ACTOR Future<GetKeyValuesReply> getKeyValuesStreamChunk( Future<ErrorOr<GetKeyValuesReply>> chunk ) {
+	ErrorOr<GetKeyValuesReply> rep = wait( chunk );
+	// Losing the storage server part way through a stream is retried the same way as a getKeyValues that ran out of alternatives, and a
+	// server that is behind or shedding load the same way as one whose alternatives were all behind
+	if( rep.isError() ) {
+		if( rep.getError().code() == error_code_request_maybe_delivered )
+			throw all_alternatives_failed();
+		if( rep.getError().code() == error_code_process_behind )
+			throw future_version();
+		throw rep.getError();
+	}
+	return rep.get();
+}
+
+// Sends req to a randomly chosen server for the shard that is not known to be failed (preferring the best ones), and appends a future for
+// each of its chunks to chunks.  Returns false without sending anything if every server is failed.
+bool sendGetKeyValuesStream( Reference<LocationInfo> const& location, GetKeyValuesStreamRequest& req, Deque<Future<GetKeyValuesReply>>* chunks ) {
+	std::vector<int> candidates;
+	for( int i = 0; i < location->size() && (candidates.empty() || i < location->countBest()); i++ )
+		if( !IFailureMonitor::failureMonitor().getState( location->get(i, &StorageServerInterface::getKeyValuesStream).getEndpoint() ).failed )
+			candidates.push_back(i);
+	if( candidates.empty() )
+		return false;
+
+	auto const& stream = location->get( candidates[g_random->randomInt(0, candidates.size())], &StorageServerInterface::getKeyValuesStream );
+	Future<Void> disc = IFailureMonitor::failureMonitor().onDisconnectOrFailure( stream.getEndpoint() );
+	stream.send( req );
+	for( auto& reply : req.replies )
+		chunks->push_back( getKeyValuesStreamChunk( waitValueOrSignal( reply.getFuture(), disc, stream.getEndpoint(), reply ) ) );
+	return true;
+}
+
 ACTOR Future<Standalone<RangeResultRef>> getRange( Database cx, Reference<TransactionLogInfo> trLogInfo, Future<Version> fVersion,
 	KeySelector begin, KeySelector end, GetRangeLimits limits, Promise<std::pair<Key, Key>> conflictRange, bool snapshot, bool reverse, 
 	TransactionInfo info )
@@ -1625,6 +1992,28 @@ ACTOR Future<Standalone<RangeResultRef>> getRange( Database cx, Reference<Transa
 		ASSERT( !limits.isReached() );
 		ASSERT( (!limits.hasRowLimit() || limits.rows >= limits.minRows) && limits.minRows >= 0 );
 
+		// A range between two known keys can be split at shard boundaries up front and read from several shards at once
+		if( info.rangeParallelism > 1 && readVersion != latestVersion && begin.isFirstGreaterOrEqual() && end.isFirstGreaterOrEqual() ) {
+			TEST(true); // Parallel getRange
+			if( begin.getKey() >= end.getKey() ) {
+				getRangeFinished(trLogInfo, startTime, originalBegin, originalEnd, snapshot, conflictRange, reverse, output);
+				return output;
+			}
+
+			Standalone<RangeResultRef> result = wait( getExactRange(cx, readVersion, KeyRangeRef(begin.getKey(), end.getKey()), limits, reverse, info, Optional<ReadFilter>()) );
+			if(begin.getKey() == allKeys.begin && ((reverse && !result.more) || !reverse))
+				result.readToBegin = true;
+			if(end.getKey() == allKeys.end && ((!reverse && !result.more) || reverse))
+				result.readThroughEnd = true;
+
+			getRangeFinished(trLogInfo, startTime, originalBegin, originalEnd, snapshot, conflictRange, reverse, result);
+			return result;
+		}
+
+		// Replies already requested from a storage server streaming the rest of the current shard's range, which ends at streamEnd
+		state Deque<Future<GetKeyValuesReply>> streamChunks;
+		state Key streamEnd;
+
 		loop {
 			if( end.getKey() == allKeys.begin && (end.offset < 1 || end.isFirstGreaterOrEqual()) ) {
 				getRangeFinished(trLogInfo, startTime, originalBegin, originalEnd, snapshot, conflictRange, reverse, output);
@@ -1663,6 +2052,7 @@ ACTOR Future<Standalone<RangeResultRef>> getRange( Database cx, Reference<Transa
 			ASSERT(req.limitBytes > 0 && req.limit != 0 && req.limit < 0 == reverse);
 
 			req.debugID = info.debugID;
+			req.priority = info.readPriority;
 			try {
 				if( info.debugID.present() ) {
 					g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getRange.Before");
@@ -1682,8 +2072,42 @@ ACTOR Future<Standalone<RangeResultRef>> getRange( Database cx, Reference<Transa
 						.detail("Servers", beginServer.second->description());*/
 				}
 
-				++cx->transactionPhysicalReads;
-				GetKeyValuesReply rep = wait( loadBalance(beginServer.second, &StorageServerInterface::getKeyValues, req, TaskDefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL ) );
+				if( !streamChunks.empty() && !(req.end.isFirstGreaterOrEqual() && req.end.getKey() == streamEnd) )
+					streamChunks.clear();
+
+				// A read with no byte limit will usually need many replies, so ask for several at once rather than waiting out a round trip for each
+				if( streamChunks.empty() && CLIENT_KNOBS->RANGE_STREAM_CHUNKS > 1 && !reverse && !limits.hasByteLimit() &&
+					(req.begin.isFirstGreaterOrEqual() || req.begin.isFirstGreaterThan()) && req.end.isFirstGreaterOrEqual() )
+				{
+					Key streamBegin = req.begin.isFirstGreaterOrEqual() ? Key(req.begin.getKey()) : keyAfter(req.begin.getKey());
+					if( streamBegin < req.end.getKey() ) {
+						GetKeyValuesStreamRequest sreq;
+						sreq.keys = KeyRangeRef( sreq.arena, KeyRangeRef(streamBegin, req.end.getKey()) );
+						sreq.version = readVersion;
+						sreq.limit = limits.hasRowLimit() ? limits.rows : std::numeric_limits<int>::max();
+						sreq.limitBytes = CLIENT_KNOBS->REPLY_BYTE_LIMIT;
+						sreq.debugID = info.debugID;
+						sreq.priority = info.readPriority;
+						sreq.replies.resize( CLIENT_KNOBS->RANGE_STREAM_CHUNKS );
+						if( sendGetKeyValuesStream( beginServer.second, sreq, &streamChunks ) ) {
+							streamEnd = req.end.getKey();
+							++cx->transactionPhysicalReads;
+							++cx->transactionStreamedRangeReads;
+						}
+					}
+				}
+
+				state Future<GetKeyValuesReply> fRep;
+				if( !streamChunks.empty() ) {
+					fRep = streamChunks.front();
+					streamChunks.pop_front();
+				} else {
+					++cx->transactionPhysicalReads;
+					fRep = loadBalance(beginServer.second, &StorageServerInterface::getKeyValues, req, TaskDefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL );
+				}
+				GetKeyValuesReply rep = wait( fRep );
+				if( !rep.more )
+					streamChunks.clear();
 
 				if( info.debugID.present() ) {
 					g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getRange.After");//.detail("SizeOf", rep.data.size());
@@ -1772,6 +2196,7 @@ ACTOR Future<Standalone<RangeResultRef>> getRange( Database cx, Reference<Transa
 
 
 			} catch ( Error& e ) {
+				streamChunks.clear();
 				if( info.debugID.present() ) {
 					g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getRange.Error");
 					TraceEvent("TransactionDebugError", info.debugID.get()).error(e);
@@ -1812,12 +2237,24 @@ Future<Standalone<RangeResultRef>> getRange( Database const& cx, Future<Version>
 	return getRange(cx, Reference<TransactionLogInfo>(), fVersion, begin, end, limits, Promise<std::pair<Key, Key>>(), true, reverse, info);
 }
 
+// A debug ID for a transaction sampled for tracing, so that every server it touches records its timeline
+static Optional<UID> sampleTransactionDebugID() {
+	if( CLIENT_KNOBS->TRANSACTION_TRACE_SAMPLE_RATE <= 0 || g_random->random01() >= CLIENT_KNOBS->TRANSACTION_TRACE_SAMPLE_RATE )
+		return Optional<UID>();
+	UID id = g_random->randomUniqueID();
+	g_traceBatch.addEvent("TransactionDebug", id.first(), "NativeAPI.Transaction.Sampled");
+	return id;
+}
+
 Transaction::Transaction( Database const& cx )
 	: cx(cx), info(cx->taskID), backoff(CLIENT_KNOBS->DEFAULT_BACKOFF), committedVersion(invalidVersion), versionstampPromise(Promise<Standalone<StringRef>>()), numErrors(0), trLogInfo(createTrLogInfoProbabilistically(cx))
 {
 	setPriority(GetReadVersionRequest::PRIORITY_DEFAULT);
 	if(cx->lockAware)
 		options.lockAware = true;
+	if(BUGGIFY)
+		info.rangeParallelism = g_random->randomInt(2, 5);
+	info.debugID = sampleTransactionDebugID();
 }
 
 Transaction::~Transaction() {
@@ -1839,6 +2276,7 @@ void Transaction::operator=(Transaction&& r) noexcept(true) {
 	numErrors = r.numErrors;
 	committedVersion = r.committedVersion;
 	versionstampPromise = std::move(r.versionstampPromise);
+	conflictingKeyRange = std::move(r.conflictingKeyRange);
 	watches = r.watches;
 	trLogInfo = std::move(r.trLogInfo);
 }
@@ -1876,6 +2314,12 @@ Future<Optional<Value>> Transaction::get( const Key& key, bool snapshot ) {
 	if( !snapshot )
 		tr.transaction.read_conflict_ranges.push_back(tr.arena, singleKeyRange(key, tr.arena));
 
+	if( cx->readCacheLimit && cx->cachedRanges.size() && !key.startsWith(systemKeys.begin) ) {
+		auto r = cx->cachedRanges.upper_bound( key );
+		if( r != cx->cachedRanges.begin() && key < (--r)->second->end )
+			return getValueCached( ver, key, r->second, cx, info, trLogInfo );
+	}
+
 	return getValue( ver, key, cx, info, trLogInfo );
 }
 
@@ -2022,6 +2466,57 @@ Future< Standalone<RangeResultRef> > Transaction::getRange(
 	return ::getRange(cx, trLogInfo, getReadVersion(), b, e, limits, conflictRange, snapshot, reverse, info);
 }
 
+ACTOR Future<Standalone<RangeResultRef>> getFilteredRange( Database cx, Reference<TransactionLogInfo> trLogInfo, Future<Version> fVersion,
+	KeyRange keys, ReadFilter filter, GetRangeLimits limits, Promise<std::pair<Key, Key>> conflictRange, bool snapshot, bool reverse,
+	TransactionInfo info )
+{
+	state double startTime = now();
+	Version version = wait( fVersion );
+	validateVersion(version);
+
+	Standalone<RangeResultRef> result = wait( getExactRange(cx, version, keys, limits, reverse, info, filter) );
+
+	// The rows read but filtered out are as much a part of the result as those returned, so the conflict range covers everything
+	// up to readThrough rather than up to the last row
+	getRangeFinished(trLogInfo, startTime, firstGreaterOrEqual(keys.begin), firstGreaterOrEqual(keys.end), true, conflictRange, reverse, result);
+	if( !snapshot ) {
+		Key rangeBegin = keys.begin, rangeEnd = keys.end;
+		if( result.more ) {
+			Key through;
+			if( result.readThrough.present() )
+				through = result.readThrough.get();
+			else
+				through = reverse ? Key(result.end()[-1].key) : keyAfter(result.end()[-1].key);
+			if( reverse )
+				rangeBegin = through;
+			else
+				rangeEnd = through;
+		}
+		conflictRange.send(std::make_pair(rangeBegin, rangeEnd));
+	}
+	return result;
+}
+
+Future< Standalone<RangeResultRef> > Transaction::getFilteredRange( const KeyRange& keys, ReadFilter const& filter, GetRangeLimits limits, bool snapshot, bool reverse ) {
+	++cx->transactionLogicalReads;
+
+	if( limits.isReached() || keys.empty() )
+		return Standalone<RangeResultRef>();
+
+	if( !limits.isValid() )
+		return range_limits_invalid();
+
+	if( !filter.isValid() )
+		return client_invalid_operation();
+
+	Promise<std::pair<Key, Key>> conflictRange;
+	if(!snapshot) {
+		extraConflictRanges.push_back( conflictRange.getFuture() );
+	}
+
+	return ::getFilteredRange(cx, trLogInfo, getReadVersion(), keys, filter, limits, conflictRange, snapshot, reverse, info);
+}
+
 Future< Standalone<RangeResultRef> > Transaction::getRange(
 	const KeySelector& begin,
 	const KeySelector& end,
@@ -2180,16 +2675,19 @@ void Transaction::reset() {
 	readVersion = Future<Version>();
 	extraConflictRanges.clear();
 	versionstampPromise = Promise<Standalone<StringRef>>();
+	conflictingKeyRange = Optional<KeyRange>();
 	commitResult = Promise<Void>();
 	committing = Future<Void>();
 	info.taskID = cx->taskID;
-	info.debugID = Optional<UID>();
+	info.debugID = sampleTransactionDebugID();
 	flushTrLogsIfEnabled();
 	trLogInfo = Reference<TransactionLogInfo>(createTrLogInfoProbabilistically(cx));
 	cancelWatches();
 
 	if(apiVersionAtLeast(16)) {
 		options.reset();
+		info.tag = Optional<Standalone<StringRef>>();
+		info.rangeParallelism = 1;
 		setPriority(GetReadVersionRequest::PRIORITY_DEFAULT);
 		if(cx->lockAware)
 			options.lockAware = true;
@@ -2244,6 +2742,109 @@ Optional<KeyRangeRef> intersects(VectorRef<KeyRangeRef> lhs, VectorRef<KeyRangeR
 	return Optional<KeyRangeRef>();
 }
 
+// Sorts ranges and replaces any that overlap or touch with their union
+void mergeConflictRanges( Arena& arena, VectorRef<KeyRangeRef>& ranges ) {
+	if( ranges.size() < 2 )
+		return;
+
+	std::sort( ranges.begin(), ranges.end(), compareBegin );
+	int merged = 0;
+	for( int i = 1; i < ranges.size(); i++ ) {
+		if( ranges[i].begin <= ranges[merged].end ) {
+			if( ranges[merged].end < ranges[i].end )
+				ranges[merged] = KeyRangeRef( ranges[merged].begin, ranges[i].end );
+		} else
+			ranges[++merged] = ranges[i];
+	}
+	ranges.resize( arena, merged+1 );
+}
+
+static bool isOverwritable( uint8_t type ) {
+	return type == MutationRef::SetValue || ( isAtomicOp( (MutationRef::Type)type ) && type != MutationRef::SetVersionstampedKey && type != MutationRef::SetVersionstampedValue );
+}
+
+// Atomic operations which, applied twice with operands of the same length, have the same effect as applying them once to the
+// result of combining the two operands (see WriteMap::coalesce).  Max and Min are excluded because they compare against an
+// existing value of a different length before truncating it.
+static Optional<ValueRef> combineOperands( uint8_t type, ValueRef const& first, ValueRef const& second, Arena& arena ) {
+	if( !first.size() || first.size() != second.size() )
+		return Optional<ValueRef>();
+	switch( type ) {
+		case MutationRef::AddValue: return doLittleEndianAdd( first, second, arena );
+		case MutationRef::And: return doAnd( first, second, arena );
+		case MutationRef::AndV2: return doAndV2( first, second, arena );
+		case MutationRef::Or: return doOr( first, second, arena );
+		case MutationRef::Xor: return doXor( first, second, arena );
+		case MutationRef::ByteMin: return doByteMin( first, second, arena );
+		case MutationRef::ByteMax: return doByteMax( first, second, arena );
+		default: return Optional<ValueRef>();
+	}
+}
+
+// Removes mutations that are entirely overwritten by a later set or clear, folds consecutive atomic operations of the same type
+// on a key into one, and merges conflict ranges.  The resulting transaction has exactly the same effect when committed.  Mutations
+// to system keys can have side effects on the proxies, so transactions with any are left as they are except for conflict ranges.
+void compactCommitTransaction( Arena& arena, CommitTransactionRef& tr ) {
+	mergeConflictRanges( arena, tr.read_conflict_ranges );
+	mergeConflictRanges( arena, tr.write_conflict_ranges );
+
+	VectorRef<MutationRef>& mutations = tr.mutations;
+	for( auto const& m : mutations ) {
+		if( m.param1 >= systemKeys.begin || ( m.type == MutationRef::ClearRange && m.param2 > systemKeys.begin ) )
+			return;
+	}
+
+	std::vector<bool> dropped( mutations.size() );
+	std::map<KeyRef, std::vector<int>> live;  // For each key, the surviving mutations to it (oldest first) since it was last cleared
+	int mergeBarrier = -1;  // A versionstamped key may be any key, so operations on either side of one cannot be folded together
+
+	for( int i = 0; i < mutations.size(); i++ ) {
+		MutationRef& m = mutations[i];
+		if( m.type == MutationRef::ClearRange || m.type == MutationRef::SetValue ) {
+			auto begin = live.lower_bound( m.param1 );
+			auto end = m.type == MutationRef::ClearRange ? live.lower_bound( m.param2 ) : live.upper_bound( m.param1 );
+			for( auto it = begin; it != end; ) {
+				std::vector<int> kept;
+				for( int j : it->second ) {
+					if( isOverwritable( mutations[j].type ) )
+						dropped[j] = true;
+					else
+						kept.push_back(j);
+				}
+				if( kept.empty() )
+					live.erase( it++ );
+				else {
+					it->second = std::move(kept);
+					++it;
+				}
+			}
+			if( m.type == MutationRef::SetValue )
+				live[m.param1].push_back(i);
+		} else if( m.type == MutationRef::SetVersionstampedKey ) {
+			mergeBarrier = i;
+		} else if( isAtomicOp( (MutationRef::Type)m.type ) ) {
+			std::vector<int>& ops = live[m.param1];
+			if( ops.size() && ops.back() > mergeBarrier && mutations[ops.back()].type == m.type ) {
+				Optional<ValueRef> combined = combineOperands( m.type, mutations[ops.back()].param2, m.param2, arena );
+				if( combined.present() ) {
+					mutations[ops.back()].param2 = combined.get();
+					dropped[i] = true;
+					continue;
+				}
+			}
+			ops.push_back(i);
+		}
+	}
+
+	int kept = 0;
+	for( int i = 0; i < mutations.size(); i++ ) {
+		if( !dropped[i] )
+			mutations[kept++] = mutations[i];
+	}
+	TEST( kept < mutations.size() ); // Commit compaction removed mutations
+	mutations.resize( arena, kept );
+}
+
 ACTOR void checkWrites( Database cx, Future<Void> committed, Promise<Void> outCommitted, CommitTransactionRequest req, Transaction* checkTr )
 {
 	state Version version;
@@ -2337,6 +2938,57 @@ ACTOR static Future<Void> commitDummyTransaction( Database cx, KeyRange range, T
 	}
 }
 
+// Joins the running watch of key for value, or starts one from version
+Reference<DatabaseContext::SharedWatch> joinSharedWatch( Database cx, Key key, Optional<Value> value, Version version, int readVersionFlags, TransactionInfo info ) {
+	auto it = cx->sharedWatches.find( key );
+	if( it != cx->sharedWatches.end() && it->second->value == value && !it->second->watch.isReady() ) {
+		TEST(true); // Watch shared with another transaction watching the same key
+		cx->watchesShared++;
+		it->second->waiters++;
+		return it->second;
+	}
+
+	Reference<DatabaseContext::SharedWatch> shared( new DatabaseContext::SharedWatch( value ) );
+	shared->watch = watchValue( version, key, value, cx, readVersionFlags, info );
+	// A running watch for a different value keeps its place; this one just isn't shared
+	if( it == cx->sharedWatches.end() )
+		cx->sharedWatches[key] = shared;
+	else if( it->second->watch.isReady() )
+		it->second = shared;
+	return shared;
+}
+
+// Once the last waiter leaves (or the watch has fired) the watch is no longer offered to new watches.  Removing it
+// from the map also breaks the cycle through its watchValue() actor, which holds the database.
+void leaveSharedWatch( Database cx, Key key, Reference<DatabaseContext::SharedWatch> const& shared ) {
+	if( --shared->waiters == 0 || shared->watch.isReady() ) {
+		auto it = cx->sharedWatches.find( key );
+		if( it != cx->sharedWatches.end() && it->second == shared )
+			cx->sharedWatches.erase( it );
+	}
+}
+
+ACTOR Future< Void > sharedWatchValue( Future<Version> version, Key key, Optional<Value> value, Database cx, int readVersionFlags, TransactionInfo info ) {
+	state Version ver = wait( version );
+	validateVersion(ver);
+	ASSERT(ver != latestVersion);
+
+	loop {
+		state Reference<DatabaseContext::SharedWatch> shared = joinSharedWatch( cx, key, value, ver, readVersionFlags, info );
+		try {
+			Version changed = wait( shared->watch );
+			leaveSharedWatch( cx, key, shared );
+			if( changed >= ver )
+				return Void();
+			// The shared watch saw a change that this watch had already read past, so wait for the next one
+			TEST(true); // Shared watch triggered before the version of a later watch
+		} catch( Error &e ) {
+			leaveSharedWatch( cx, key, shared );
+			throw;
+		}
+	}
+}
+
 void Transaction::cancelWatches(Error const& e) {
 	for(int i = 0; i < watches.size(); ++i)
 		if(!watches[i]->onChangeTrigger.isSet())
@@ -2350,7 +3002,7 @@ void Transaction::setupWatches() {
 		Future<Version> watchVersion = getCommittedVersion() > 0 ? getCommittedVersion() : getReadVersion();
 
 		for(int i = 0; i < watches.size(); ++i)
-			watches[i]->setWatch(watchValue( watchVersion, watches[i]->key, watches[i]->value, cx, options.getReadVersionFlags, info ));
+			watches[i]->setWatch(sharedWatchValue( watchVersion, watches[i]->key, watches[i]->value, cx, options.getReadVersionFlags, info ));
 
 		watches.clear();
 	}
@@ -2395,6 +3047,7 @@ ACTOR static Future<Void> tryCommit( Database cx, Reference<TransactionLogInfo>
 			when (CommitID ci = wait( reply )) {
 				Version v = ci.version;
 				if (v != invalidVersion) {
+					cx->updateRecentReadVersion( v, startTime );
 					if (info.debugID.present())
 						TraceEvent(interval.end()).detail("CommittedVersion", v);
 					*pCommittedVersion = v;
@@ -2418,8 +3071,13 @@ ACTOR static Future<Void> tryCommit( Database cx, Reference<TransactionLogInfo>
 						trLogInfo->addLog(FdbClientLogEvents::EventCommit(startTime, latency, req.transaction.mutations.size(), req.transaction.mutations.expectedSize(), req));
 					return Void();
 				} else {
-					if (info.debugID.present())
-						TraceEvent(interval.end()).detail("Conflict", 1);
+					tr->conflictingKeyRange = ci.conflictingKeyRange;
+					if (info.debugID.present()) {
+						TraceEvent ev(interval.end());
+						ev.detail("Conflict", 1);
+						if (ci.conflictingKeyRange.present())
+							ev.detail("ConflictingBegin", printable(ci.conflictingKeyRange.get().begin)).detail("ConflictingEnd", printable(ci.conflictingKeyRange.get().end));
+					}
 
 					if(info.debugID.present())
 						g_traceBatch.addEvent("CommitDebug", commitID.get().first(), "NativeAPI.commit.After");
@@ -2518,12 +3176,18 @@ Future<Void> Transaction::commitMutations() {
 				TraceEvent("TransactionMutation", u).detail("T", i->type).detail("P1", printable(i->param1)).detail("P2", printable(i->param2));
 		}
 
+		if( CLIENT_KNOBS->COMPACT_COMMIT_MUTATIONS )
+			compactCommitTransaction( tr.arena, tr.transaction );
+
 		if(options.lockAware) {
 			tr.flags = tr.flags | CommitTransactionRequest::FLAG_IS_LOCK_AWARE;
 		}
 		if(options.firstInBatch) {
 			tr.flags = tr.flags | CommitTransactionRequest::FLAG_FIRST_IN_BATCH;
 		}
+		if(options.reportConflictingKeys) {
+			tr.flags = tr.flags | CommitTransactionRequest::FLAG_REPORT_CONFLICTING_KEYS;
+		}
 
 		Future<Void> commitResult = tryCommit( cx, trLogInfo, tr, readVersion, info, &this->committedVersion, this, options );
 
@@ -2576,6 +3240,7 @@ Future<Void> Transaction::commit() {
 
 void Transaction::setPriority( uint32_t priorityFlag ) {
 	options.getReadVersionFlags = (options.getReadVersionFlags & ~GetReadVersionRequest::FLAG_PRIORITY_MASK) | priorityFlag;
+	info.readPriority = priorityFlag == GetReadVersionRequest::PRIORITY_BATCH ? ReadPriorityBatch : ReadPriorityDefault;
 }
 
 void Transaction::setOption( FDBTransactionOptions::Option option, Optional<StringRef> value ) {
@@ -2593,6 +3258,28 @@ void Transaction::setOption( FDBTransactionOptions::Option option, Optional<Stri
 			options.getReadVersionFlags |= GetReadVersionRequest::FLAG_CAUSAL_READ_RISKY;
 			break;
 
+		case FDBTransactionOptions::USE_CACHED_READ_VERSION:
+			validateOptionValue(value, false);
+			options.getReadVersionFlags |= GetReadVersionRequest::FLAG_USE_CACHED_READ_VERSION;
+			break;
+
+		case FDBTransactionOptions::USE_RECENT_READ_VERSION:
+			validateOptionValue(value, true);
+			options.maxReadVersionStaleness = extractIntOption(value, 0, std::numeric_limits<int>::max()) / 1000.0;
+			break;
+
+		case FDBTransactionOptions::TRANSACTION_TAG:
+			validateOptionValue(value, true);
+			if(value.get().size() > CLIENT_KNOBS->MAX_TRANSACTION_TAG_LENGTH)
+				throw invalid_option_value();
+			info.tag = Standalone<StringRef>(value.get());
+			break;
+
+		case FDBTransactionOptions::READ_RANGE_PARALLELISM:
+			validateOptionValue(value, true);
+			info.rangeParallelism = (int)extractIntOption(value, 1, CLIENT_KNOBS->MAX_RANGE_PARALLELISM);
+			break;
+
 		case FDBTransactionOptions::PRIORITY_SYSTEM_IMMEDIATE:
 			validateOptionValue(value, false);
 			setPriority(GetReadVersionRequest::PRIORITY_SYSTEM_IMMEDIATE);
@@ -2669,23 +3356,34 @@ void Transaction::setOption( FDBTransactionOptions::Option option, Optional<Stri
 			options.firstInBatch = true;
 			break;
 
+		case FDBTransactionOptions::REPORT_CONFLICTING_KEYS:
+			validateOptionValue(value, false);
+			options.reportConflictingKeys = true;
+			break;
+
 		default:
 			break;
 	}
 }
 
-ACTOR Future<GetReadVersionReply> getConsistentReadVersion( DatabaseContext *cx, uint32_t transactionCount, uint32_t flags, Optional<UID> debugID ) {
+ACTOR Future<GetReadVersionReply> getConsistentReadVersion( DatabaseContext *cx, uint32_t transactionCount, uint32_t flags, Optional<UID> debugID, Optional<Standalone<StringRef>> tag ) {
 	try {
 		if( debugID.present() )
 			g_traceBatch.addEvent("TransactionDebug", debugID.get().first(), "NativeAPI.getConsistentReadVersion.Before");
 		loop {
-			state GetReadVersionRequest req( transactionCount, flags, debugID );
+			state GetReadVersionRequest req( transactionCount, flags, debugID, tag );
+			state double requestTime = now();
 			choose {
 				when ( Void _ = wait( cx->onMasterProxiesChanged() ) ) {}
 				when ( GetReadVersionReply v = wait( loadBalance( cx->getMasterProxies(), &MasterProxyInterface::getConsistentReadVersion, req, cx->taskID ) ) ) {
 					if( debugID.present() )
 						g_traceBatch.addEvent("TransactionDebug", debugID.get().first(), "NativeAPI.getConsistentReadVersion.After");
 					ASSERT( v.version > 0 );
+					// Versions from the proxy's cache, or that are causally risky, may predate commits acknowledged before the request
+					if( !(flags & (GetReadVersionRequest::FLAG_CAUSAL_READ_RISKY | GetReadVersionRequest::FLAG_USE_CACHED_READ_VERSION)) ) {
+						cx->updateRecentReadVersion( v.version, requestTime );
+						cx->recentReadVersionLocked = v.locked;
+					}
 					return v;
 				}
 			}
@@ -2739,6 +3437,7 @@ ACTOR Future<Void> readVersionBatcher( DatabaseContext *cx, FutureStream< std::p
 		if (send_batch) {
 			int count = requests.size();
 			ASSERT(count);
+			cx->transactionReadVersionBatches++;
 
 			// dynamic batching
 			Promise<GetReadVersionReply> GRVReply;
@@ -2747,7 +3446,7 @@ ACTOR Future<Void> readVersionBatcher( DatabaseContext *cx, FutureStream< std::p
 
 			Future<Void> batch =
 				broadcast(
-					getConsistentReadVersion(cx, count, flags, std::move(debugID)),
+					getConsistentReadVersion(cx, count, flags, std::move(debugID), Optional<Standalone<StringRef>>()),
 					std::vector< Promise<GetReadVersionReply> >(std::move(requests)));
 			debugID = Optional<UID>();
 			requests = std::vector< Promise<GetReadVersionReply> >();
@@ -2778,10 +3477,35 @@ Future<Version> Transaction::getReadVersion(uint32_t flags) {
 		batcher.actor = readVersionBatcher( cx.getPtr(), batcher.stream.getFuture(), flags );
 	}
 	if (!readVersion.isValid()) {
+		startTime = now();
+		// Tagged transactions are counted and possibly throttled by the proxies, so each one asks for its own version
+		if( info.tag.present() ) {
+			readVersion = extractReadVersion( cx.getPtr(), trLogInfo, getConsistentReadVersion( cx.getPtr(), 1, flags, info.debugID, info.tag ), options.lockAware, startTime);
+			return readVersion;
+		}
+
+		if( options.maxReadVersionStaleness > 0 && startTime - cx->recentReadVersionTime <= options.maxReadVersionStaleness && ( !cx->recentReadVersionLocked || options.lockAware ) ) {
+			cx->transactionReadVersionsRecent++;
+			readVersion = cx->recentReadVersion;
+			return readVersion;
+		}
+
+		// A version requested after (now - readVersionStaleness) is at least as recent as every commit acknowledged before then
+		if( cx->readVersionStaleness > 0 && batcher.sharedReply.isValid() && !batcher.sharedReply.isError() && startTime - batcher.sharedReplyRequested <= cx->readVersionStaleness ) {
+			cx->transactionReadVersionsShared++;
+			readVersion = extractReadVersion( cx.getPtr(), trLogInfo, batcher.sharedReply, options.lockAware, startTime);
+			return readVersion;
+		}
+
 		Promise<GetReadVersionReply> p;
 		batcher.stream.send( std::make_pair( p, info.debugID ) );
-		startTime = now();
 		readVersion = extractReadVersion( cx.getPtr(), trLogInfo, p.getFuture(), options.lockAware, startTime);
+		if( cx->readVersionStaleness > 0 ) {
+			batcher.sharedReply = p.getFuture();
+			batcher.sharedReplyRequested = startTime;
+		} else {
+			batcher.sharedReply = Future<GetReadVersionReply>();
+		}
 	}
 	return readVersion;
 }
@@ -3016,6 +3740,219 @@ Future< Standalone<VectorRef<KeyRef>> > Transaction::splitStorageMetrics( KeyRan
 	return ::splitStorageMetrics( cx, keys, limit, estimated );
 }
 
+ACTOR Future< int64_t > getEstimatedRangeSizeBytes( Database cx, KeyRange keys, TransactionInfo info ) {
+	state int64_t total = 0;
+	state Key begin = keys.begin;
+	state vector<Future<StorageMetrics>> fMetrics;
+	while( begin < keys.end ) {
+		state KeyRange remaining = KeyRangeRef( begin, keys.end );
+		state vector< pair<KeyRange, Reference<LocationInfo>> > locations = wait( getKeyRangeLocations( cx, remaining, CLIENT_KNOBS->STORAGE_METRICS_SHARD_LIMIT, false, info ) );
+		try {
+			fMetrics.clear();
+			for(auto& location : locations) {
+				// Metrics outside of [min, max] are returned immediately, and no metrics are in [0, -1]
+				WaitMetricsRequest req( location.first, StorageMetrics(), StorageMetrics() );
+				req.min.bytes = 0;
+				req.max.bytes = -1;
+				fMetrics.push_back( loadBalance( location.second, &StorageServerInterface::waitMetrics, req, info.taskID ) );
+			}
+			Void _ = wait( waitForAll(fMetrics) );
+
+			for(auto& m : fMetrics)
+				total += m.get().bytes;
+			begin = locations.back().first.end;
+		} catch (Error& e) {
+			if (e.code() != error_code_wrong_shard_server && e.code() != error_code_all_alternatives_failed)
+				throw;
+			cx->invalidateCache( remaining );
+			Void _ = wait( delay( CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, info.taskID ) );
+		}
+	}
+	return total;
+}
+
+ACTOR Future< Standalone<VectorRef<KeyRef>> > getRangeSplitPoints( Database cx, KeyRange keys, int64_t chunkSize, TransactionInfo info ) {
+	state Standalone<VectorRef<KeyRef>> results;
+	state Key begin = keys.begin;
+	state vector<Future<SplitRangeReply>> fReplies;
+	results.push_back_deep( results.arena(), keys.begin );
+	while( begin < keys.end ) {
+		state KeyRange remaining = KeyRangeRef( begin, keys.end );
+		state vector< pair<KeyRange, Reference<LocationInfo>> > locations = wait( getKeyRangeLocations( cx, remaining, CLIENT_KNOBS->STORAGE_METRICS_SHARD_LIMIT, false, info ) );
+		try {
+			fReplies.clear();
+			for(auto& location : locations)
+				fReplies.push_back( loadBalance( location.second, &StorageServerInterface::getRangeSplitPoints, SplitRangeRequest( location.first, chunkSize ), info.taskID ) );
+			Void _ = wait( waitForAll(fReplies) );
+
+			for(int i = 0; i < locations.size(); i++) {
+				if( locations[i].first.begin != keys.begin )
+					results.push_back_deep( results.arena(), locations[i].first.begin );
+				for(auto& split : fReplies[i].get().splitPoints)
+					results.push_back_deep( results.arena(), split );
+			}
+			begin = locations.back().first.end;
+		} catch (Error& e) {
+			if (e.code() != error_code_wrong_shard_server && e.code() != error_code_all_alternatives_failed)
+				throw;
+			cx->invalidateCache( remaining );
+			Void _ = wait( delay( CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, info.taskID ) );
+		}
+	}
+	results.push_back_deep( results.arena(), keys.end );
+	return results;
+}
+
+ACTOR Future< RangeAggregate > getShardAggregate( Database cx, pair<KeyRange, Reference<LocationInfo>> location, Version version, TransactionInfo info ) {
+	state RangeAggregate total;
+	state Key begin = location.first.begin;
+	loop {
+		++cx->transactionPhysicalReads;
+		GetRangeAggregateRequest req( KeyRangeRef( begin, location.first.end ), version, CLIENT_KNOBS->RANGE_AGGREGATE_BYTE_LIMIT, info.readPriority );
+		GetRangeAggregateReply rep = wait( loadBalance( location.second, &StorageServerInterface::getRangeAggregate, req, TaskDefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL ) );
+		total += rep.aggregate;
+		if( !rep.resumeKey.present() )
+			return total;
+		TEST(true); // Range aggregate of a shard took several requests
+		begin = rep.resumeKey.get();
+	}
+}
+
+// Aggregates up to RANGE_AGGREGATE_SHARD_LIMIT shards at a time, each with its own series of requests
+ACTOR Future< RangeAggregate > getRangeAggregate( Database cx, KeyRange keys, Future<Version> fVersion, TransactionInfo info ) {
+	state Version version = wait( fVersion );
+	validateVersion(version);
+
+	state RangeAggregate total;
+	state Key begin = keys.begin;
+	state vector<Future<RangeAggregate>> fShards;
+	while( begin < keys.end ) {
+		state KeyRange remaining = KeyRangeRef( begin, keys.end );
+		state vector< pair<KeyRange, Reference<LocationInfo>> > locations = wait( getKeyRangeLocations( cx, remaining, CLIENT_KNOBS->RANGE_AGGREGATE_SHARD_LIMIT, false, info ) );
+		try {
+			fShards.clear();
+			for(auto& location : locations)
+				fShards.push_back( getShardAggregate( cx, location, version, info ) );
+			Void _ = wait( waitForAll(fShards) );
+
+			for(auto& a : fShards)
+				total += a.get();
+			begin = locations.back().first.end;
+		} catch (Error& e) {
+			if (e.code() != error_code_wrong_shard_server && e.code() != error_code_all_alternatives_failed)
+				throw;
+			cx->invalidateCache( remaining );
+			Void _ = wait( delay( CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, info.taskID ) );
+		}
+	}
+	return total;
+}
+
+Future< RangeAggregate > Transaction::getRangeAggregate( KeyRange const& keys, bool snapshot ) {
+	++cx->transactionLogicalReads;
+
+	if( keys.empty() )
+		return RangeAggregate();
+
+	if( !snapshot )
+		addReadConflictRange( keys );
+
+	return ::getRangeAggregate( cx, keys, getReadVersion(), info );
+}
+
+ACTOR Future<Void> pinSnapshot( Database cx, KeyRange keys, double lease, Future<Version> fVersion, TransactionInfo info ) {
+	state Version version = wait( fVersion );
+	validateVersion(version);
+
+	state Key begin = keys.begin;
+	while( begin < keys.end ) {
+		state KeyRange remaining = KeyRangeRef( begin, keys.end );
+		state vector< pair<KeyRange, Reference<LocationInfo>> > locations = wait( getKeyRangeLocations( cx, remaining, CLIENT_KNOBS->STORAGE_METRICS_SHARD_LIMIT, false, info ) );
+		try {
+			// Every replica, since a later read may be load balanced to any of them
+			state vector<Future<ErrorOr<Void>>> pins;
+			std::set<UID> servers;
+			for(auto& location : locations)
+				for(int i = 0; i < location.second->size(); i++)
+					if( servers.insert( location.second->getId(i) ).second )
+						pins.push_back( location.second->getInterface(i).pinSnapshot.getReplyUnlessFailedFor( PinSnapshotRequest( version, lease ), 2, 0 ) );
+			Void _ = wait( waitForAll(pins) );
+
+			// A failed server won't be read from, so it does not need the pin
+			for(auto& p : pins)
+				if( p.get().isError() && p.get().getError().code() != error_code_request_maybe_delivered )
+					throw p.get().getError();
+			begin = locations.back().first.end;
+		} catch (Error& e) {
+			if (e.code() != error_code_wrong_shard_server && e.code() != error_code_all_alternatives_failed)
+				throw;
+			cx->invalidateCache( remaining );
+			Void _ = wait( delay( CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, info.taskID ) );
+		}
+	}
+	return Void();
+}
+
+Future< Void > Transaction::pinSnapshot( KeyRange const& keys, double lease ) {
+	if( keys.empty() )
+		return Void();
+	return ::pinSnapshot( cx, keys, lease, getReadVersion(), info );
+}
+
+// Exports up to EXPORT_RANGE_SHARD_LIMIT shards at a time, each by one of its replicas.  When some of them fail with
+// wrong_shard_server, the files of those before the first failure are kept and the rest are exported again.
+ACTOR Future< ExportRangeReply > exportRange( Database cx, KeyRange keys, std::string containerURL, bool compressBlocks, Future<Version> fVersion, TransactionInfo info ) {
+	state Version version = wait( fVersion );
+	validateVersion(version);
+
+	state ExportRangeReply result;
+	state Key begin = keys.begin;
+	state vector<Future<ErrorOr<ExportRangeReply>>> fShards;
+	while( begin < keys.end ) {
+		state KeyRange remaining = KeyRangeRef( begin, keys.end );
+		state vector< pair<KeyRange, Reference<LocationInfo>> > locations = wait( getKeyRangeLocations( cx, remaining, CLIENT_KNOBS->EXPORT_RANGE_SHARD_LIMIT, false, info ) );
+		fShards.clear();
+		for(auto& location : locations)
+			fShards.push_back( errorOr( loadBalance( location.second, &StorageServerInterface::exportRange, ExportRangeRequest( location.first, version, containerURL, compressBlocks ), TaskDefaultPromiseEndpoint ) ) );
+		Void _ = wait( waitForAll(fShards) );
+
+		state int i = 0;
+		for(; i < fShards.size(); i++) {
+			ErrorOr<ExportRangeReply> const& r = fShards[i].get();
+			if( r.isError() ) {
+				if (r.getError().code() != error_code_wrong_shard_server && r.getError().code() != error_code_all_alternatives_failed)
+					throw r.getError();
+				break;
+			}
+			result.fileNames.insert( result.fileNames.end(), r.get().fileNames.begin(), r.get().fileNames.end() );
+			result.bytes += r.get().bytes;
+			begin = locations[i].first.end;
+		}
+		if( i < fShards.size() ) {
+			TEST(true); // Export of a shard retried
+			cx->invalidateCache( KeyRangeRef( begin, keys.end ) );
+			Void _ = wait( delay( CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, info.taskID ) );
+		}
+	}
+	return result;
+}
+
+Future< ExportRangeReply > Transaction::exportRange( KeyRange const& keys, std::string const& containerURL, bool compressBlocks ) {
+	if( keys.empty() )
+		return ExportRangeReply();
+	return ::exportRange( cx, keys, containerURL, compressBlocks, getReadVersion(), info );
+}
+
+Future< int64_t > Transaction::getEstimatedRangeSizeBytes( KeyRange const& keys ) {
+	return ::getEstimatedRangeSizeBytes( cx, keys, info );
+}
+
+Future< Standalone<VectorRef<KeyRef>> > Transaction::getRangeSplitPoints( KeyRange const& keys, int64_t chunkSize ) {
+	if( chunkSize <= 0 )
+		return client_invalid_operation();
+	return ::getRangeSplitPoints( cx, keys, chunkSize, info );
+}
+
 void Transaction::checkDeferredError() { cx->checkDeferredError(); }
 
 Reference<TransactionLogInfo> Transaction::createTrLogInfoProbabilistically(const Database &cx) {
@@ -3031,3 +3968,144 @@ void enableClientInfoLogging() {
 	networkOptions.logClientInfo = true;
 	TraceEvent(SevInfo, "ClientInfoLoggingEnabled");
 }
+
+static GetKeyValuesReply roundTripKeyValuesReply( GetKeyValuesReply const& reply, uint64_t protocolVersion ) {
+	BinaryWriter wr( AssumeVersion(protocolVersion) );
+	wr << reply;
+	Arena arena;
+	StringRef message( arena, wr.toStringRef() );
+	GetKeyValuesReply result;
+	ArenaReader rd( arena, message, AssumeVersion(protocolVersion) );
+	rd >> result;
+	return result;
+}
+
+TEST_CASE("fdbclient/NativeAPI/prefixCompressedKeyValues") {
+	Void _ = wait(Future<Void>(Void()));
+
+	GetKeyValuesReply reply;
+	reply.version = 7;
+	reply.more = true;
+	std::string prefix = "index/";
+	for(int i = 0; i < 100; i++) {
+		if (g_random->random01() < 0.1)
+			prefix = g_random->randomAlphaNumeric(g_random->randomInt(0, 10));
+		KeyRef key = StringRef(reply.arena, prefix + g_random->randomAlphaNumeric(g_random->randomInt(0, 5)));
+		ValueRef value = StringRef(reply.arena, g_random->randomAlphaNumeric(g_random->randomInt(0, 20)));
+		reply.data.push_back(reply.arena, KeyValueRef(key, value));
+	}
+
+	uint64_t versions[] = { currentProtocolVersion, 0x0FDB00A560010001LL };
+	for(int v = 0; v < 2; v++) {
+		GetKeyValuesReply result = roundTripKeyValuesReply(reply, versions[v]);
+		ASSERT( result.version == reply.version && result.more == reply.more );
+		ASSERT( result.data.size() == reply.data.size() );
+		for(int i = 0; i < reply.data.size(); i++)
+			ASSERT( result.data[i].key == reply.data[i].key && result.data[i].value == reply.data[i].value );
+	}
+	return Void();
+}
+
+TEST_CASE("fdbclient/NativeAPI/readFilter") {
+	Void _ = wait(Future<Void>(Void()));
+
+	Arena arena;
+	Tuple key = Tuple().append(LiteralStringRef("index")).append((int64_t)7).append(LiteralStringRef("id"));
+	KeyValueRef indexEntry( arena, KeyValueRef( key.pack(), LiteralStringRef("\x0f\x10value") ) );
+	KeyValueRef other( LiteralStringRef("\xffnot a tuple"), LiteralStringRef("\x01") );
+
+	Standalone<StringRef> seven = Tuple().append((int64_t)7).pack();
+	ASSERT( ReadFilterRef::tupleElement( 1, seven ).matches( indexEntry ) );
+	ASSERT( !ReadFilterRef::tupleElement( 0, seven ).matches( indexEntry ) );
+	ASSERT( !ReadFilterRef::tupleElement( 3, seven ).matches( indexEntry ) );
+	ASSERT( !ReadFilterRef::tupleElement( 1, seven ).matches( other ) );
+
+	ASSERT( ReadFilterRef::valuePrefix( LiteralStringRef("\x0f\x10") ).matches( indexEntry ) );
+	ASSERT( !ReadFilterRef::valuePrefix( LiteralStringRef("\x0f\x10") ).matches( other ) );
+	ASSERT( ReadFilterRef::valueMask( LiteralStringRef("\x0f\xf0"), LiteralStringRef("\x0f\x10") ).matches( indexEntry ) );
+	ASSERT( !ReadFilterRef::valueMask( LiteralStringRef("\xff\xff"), LiteralStringRef("\x0f\x11") ).matches( indexEntry ) );
+	ASSERT( !ReadFilterRef::valueMask( LiteralStringRef("\x01\x00"), LiteralStringRef("\x01\x00") ).matches( other ) );
+	ASSERT( !ReadFilterRef::valueMask( LiteralStringRef("\x01"), LiteralStringRef("\x01\x00") ).isValid() );
+
+	KeyValueRef keyOnly = ReadFilterRef::keysOnly().project( arena, indexEntry );
+	ASSERT( keyOnly.key == indexEntry.key && keyOnly.value.size() == 0 );
+	ReadFilterRef length;
+	length.projection = ReadFilterRef::VALUE_LENGTH;
+	KeyValueRef lengthOnly = length.project( arena, indexEntry );
+	uint32_t size;
+	ASSERT( lengthOnly.value.size() == 4 );
+	memcpy( &size, lengthOnly.value.begin(), 4 );
+	ASSERT( size == indexEntry.value.size() );
+
+	GetKeyValuesReply reply;
+	reply.version = 7;
+	reply.more = true;
+	reply.data.push_back_deep( reply.arena, indexEntry );
+	reply.scannedThrough = StringRef( reply.arena, LiteralStringRef("z") );
+	GetKeyValuesReply result = roundTripKeyValuesReply( reply, currentProtocolVersion );
+	ASSERT( result.scannedThrough.present() && result.scannedThrough.get() == LiteralStringRef("z") );
+	result = roundTripKeyValuesReply( reply, 0x0FDB00A570010004LL );
+	ASSERT( !result.scannedThrough.present() && result.data.size() == 1 );
+	return Void();
+}
+
+TEST_CASE("fdbclient/NativeAPI/rangeAggregate") {
+	Void _ = wait(Future<Void>(Void()));
+
+	Arena arena;
+	int64_t counters[] = { 5, -2, int64_t(1)<<40 };
+	VectorRef<KeyValueRef> data;
+	for(int i = 0; i < 3; i++)
+		data.push_back_deep( arena, KeyValueRef( StringRef( arena, format("counter/%d", i) ), StringRef( (const uint8_t*)&counters[i], 8 ) ) );
+	data.push_back( arena, KeyValueRef( LiteralStringRef("short"), LiteralStringRef("\x01\x01") ) );
+	data.push_back( arena, KeyValueRef( LiteralStringRef("empty"), ValueRef() ) );
+
+	RangeAggregate whole, first, rest;
+	whole.add( data );
+	first.add( data[0] );
+	for(int i = 1; i < data.size(); i++)
+		rest.add( data[i] );
+	first += rest;
+
+	ASSERT( whole.keys == 5 && whole.sum == 5 - 2 + (int64_t(1)<<40) + 257 );
+	ASSERT( whole.bytes == data.expectedSize() - data.size() * sizeof(KeyValueRef) );
+	ASSERT( first.keys == whole.keys && first.bytes == whole.bytes && first.sum == whole.sum );
+
+	RangeAggregate wraps;
+	int64_t maxValue = std::numeric_limits<int64_t>::max();
+	wraps.add( KeyValueRef( LiteralStringRef("a"), StringRef( (const uint8_t*)&maxValue, 8 ) ) );
+	wraps.add( KeyValueRef( LiteralStringRef("b"), LiteralStringRef("\x02") ) );
+	ASSERT( wraps.sum == std::numeric_limits<int64_t>::min() + 1 );
+	return Void();
+}
+
+TEST_CASE("fdbclient/NativeAPI/compactCommitTransaction") {
+	Void _ = wait(Future<Void>(Void()));
+
+	Arena arena;
+	CommitTransactionRef tr;
+	uint8_t one[] = { 1, 0 }, two[] = { 2, 0 }, wide[] = { 1, 0, 0 };
+	tr.mutations.push_back(arena, MutationRef(MutationRef::SetValue, LiteralStringRef("a"), LiteralStringRef("1")));
+	tr.mutations.push_back(arena, MutationRef(MutationRef::AddValue, LiteralStringRef("b"), StringRef(one, 2)));
+	tr.mutations.push_back(arena, MutationRef(MutationRef::SetValue, LiteralStringRef("c"), LiteralStringRef("1")));
+	tr.mutations.push_back(arena, MutationRef(MutationRef::AddValue, LiteralStringRef("b"), StringRef(two, 2)));
+	tr.mutations.push_back(arena, MutationRef(MutationRef::SetValue, LiteralStringRef("a"), LiteralStringRef("2")));
+	tr.mutations.push_back(arena, MutationRef(MutationRef::ClearRange, LiteralStringRef("c"), LiteralStringRef("d")));
+	tr.mutations.push_back(arena, MutationRef(MutationRef::AddValue, LiteralStringRef("b"), StringRef(wide, 3)));
+	tr.write_conflict_ranges.push_back(arena, KeyRangeRef(LiteralStringRef("e"), LiteralStringRef("f")));
+	tr.write_conflict_ranges.push_back(arena, KeyRangeRef(LiteralStringRef("a"), LiteralStringRef("b")));
+	tr.write_conflict_ranges.push_back(arena, KeyRangeRef(LiteralStringRef("b"), LiteralStringRef("c")));
+	tr.write_conflict_ranges.push_back(arena, KeyRangeRef(LiteralStringRef("a"), LiteralStringRef("a\x00")));
+
+	compactCommitTransaction(arena, tr);
+
+	ASSERT( tr.mutations.size() == 4 );
+	ASSERT( tr.mutations[0].type == MutationRef::AddValue && tr.mutations[0].param2 == LiteralStringRef("\x03\x00") );
+	ASSERT( tr.mutations[1].type == MutationRef::SetValue && tr.mutations[1].param2 == LiteralStringRef("2") );
+	ASSERT( tr.mutations[2].type == MutationRef::ClearRange );
+	ASSERT( tr.mutations[3].type == MutationRef::AddValue && tr.mutations[3].param2.size() == 3 );
+	ASSERT( tr.write_conflict_ranges.size() == 2 );
+	ASSERT( tr.write_conflict_ranges[0] == KeyRangeRef(LiteralStringRef("a"), LiteralStringRef("c")) );
+	ASSERT( tr.write_conflict_ranges[1] == KeyRangeRef(LiteralStringRef("e"), LiteralStringRef("f")) );
+	return Void();
+}
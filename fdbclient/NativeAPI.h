@@ -144,6 +144,7 @@ struct TransactionOptions {
 	double maxBackoff;
 	uint32_t getReadVersionFlags;
 	uint32_t customTransactionSizeLimit;
+	double maxReadVersionStaleness;  // FDBTransactionOptions::USE_RECENT_READ_VERSION, in seconds
 	bool checkWritesEnabled : 1;
 	bool causalWriteRisky : 1;
 	bool commitOnFirstProxy : 1;
@@ -151,6 +152,7 @@ struct TransactionOptions {
 	bool lockAware : 1;
 	bool readOnly : 1;
 	bool firstInBatch : 1;
+	bool reportConflictingKeys : 1;
 
 	TransactionOptions() {
 		reset();
@@ -167,9 +169,12 @@ struct TransactionOptions {
 
 struct TransactionInfo {
 	Optional<UID> debugID;
+	Optional<Standalone<StringRef>> tag;  // FDBTransactionOptions::TRANSACTION_TAG
 	int taskID;
+	uint8_t readPriority;  // ReadPriority of the transaction's storage server reads
+	int rangeParallelism;  // FDBTransactionOptions::READ_RANGE_PARALLELISM
 
-	explicit TransactionInfo( int taskID ) : taskID( taskID ) {}
+	explicit TransactionInfo( int taskID ) : taskID( taskID ), readPriority( ReadPriorityDefault ), rangeParallelism( 1 ) {}
 };
 
 struct TransactionLogInfo : public ReferenceCounted<TransactionLogInfo>, NonCopyable {
@@ -246,6 +251,10 @@ public:
 		return getRange( KeySelector( firstGreaterOrEqual(keys.begin), keys.arena() ),
 			KeySelector( firstGreaterOrEqual(keys.end), keys.arena() ), limits, snapshot, reverse ); 
 	}
+	// Only the rows that pass the filter are returned, projected as it says; limits apply to those.  The filter is evaluated by
+	// the storage servers.  If there are more, the result's readThrough is where to continue: the next read begins there, or in
+	// reverse ends there.  Not available through ReadYourWritesTransaction, whose cache needs the rows as they are.
+	Future< Standalone<RangeResultRef> > getFilteredRange( const KeyRange& keys, ReadFilter const& filter, GetRangeLimits limits, bool snapshot = false, bool reverse = false );
 
 	Future< Standalone<VectorRef< const char*>>> getAddressesForKey (const Key& key );
 
@@ -260,6 +269,27 @@ public:
 	Future< StorageMetrics > getStorageMetrics( KeyRange const& keys, int shardLimit );
 	Future< Standalone<VectorRef<KeyRef>> > splitStorageMetrics( KeyRange const& keys, StorageMetrics const& limit, StorageMetrics const& estimated );
 
+	// Estimated from the storage servers' byte samples, without reading the range.  The split points begin with keys.begin,
+	// end with keys.end, and include every shard boundary in between, so each chunk can be read from a single team.
+	Future< int64_t > getEstimatedRangeSizeBytes( KeyRange const& keys );
+
+	// Computed by the storage servers at the read version, without sending the range to the client.  Not available through
+	// ReadYourWritesTransaction, which would have to apply its uncommitted writes to the result.
+	Future< RangeAggregate > getRangeAggregate( KeyRange const& keys, bool snapshot = false );
+
+	// Keeps reads of keys at the read version possible for lease seconds (at most SERVER_KNOBS->MAX_PINNED_SNAPSHOT_LEASE), past the
+	// MVCC window, so a long read-only scan need not restart on transaction_too_old.  Call it again before the lease runs out to
+	// renew it.  The transaction must not write, and its read version must still be newer than what the storage servers have made
+	// durable, so pin right after getting it.  Fails with unsupported_operation unless the storage engine supports snapshots.
+	Future< Void > pinSnapshot( KeyRange const& keys, double lease );
+
+	// Has the storage servers write keys, as of the read version, to the backup container at containerURL as range files of the
+	// format backups use, each server writing its own shards (see ExportRangeRequest).  The reply lists the files in key order.
+	// Pin the range first (see pinSnapshot), since an export takes longer than the MVCC window.  Files written by an attempt that
+	// failed are left in the container, unreferenced.
+	Future< ExportRangeReply > exportRange( KeyRange const& keys, std::string const& containerURL, bool compressBlocks );
+	Future< Standalone<VectorRef<KeyRef>> > getRangeSplitPoints( KeyRange const& keys, int64_t chunkSize );
+
 	// If checkWriteConflictRanges is true, existing write conflict ranges will be searched for this key
 	void set( const KeyRef& key, const ValueRef& value, bool addConflictRange = true );
 	void atomicOp( const KeyRef& key, const ValueRef& value, MutationRef::Type operationType, bool addConflictRange = true );
@@ -274,6 +304,10 @@ public:
 
 	Promise<Standalone<StringRef>> versionstampPromise;
 
+	// Set when commit() fails with not_committed, if FDBTransactionOptions::REPORT_CONFLICTING_KEYS was set and the resolver
+	// identified a conflicting read range
+	Optional<KeyRange> conflictingKeyRange;
+
 	Future<Void> onError( Error const& e );
 	void flushTrLogsIfEnabled();
 
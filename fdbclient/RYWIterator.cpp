@@ -541,6 +541,41 @@ TEST_CASE("fdbclient/WriteMap/addValue") {
 	return Void();
 }
 
+TEST_CASE("fdbclient/WriteMap/blindSets") {
+	Arena arena = Arena();
+	WriteMap writes = WriteMap(&arena);
+	std::map<KeyRef, std::pair<ValueRef, bool>> expected;
+
+	// Sets into an unmodified map are buffered and built into the tree in one pass when it is next read
+	int count = g_random->randomInt(1, 1000);
+	for (int i = 0; i < count; i++) {
+		KeyRef key = StringRef(arena, format("%d", g_random->randomInt(0, 500)));
+		if (g_random->random01() < 0.01)
+			key = KeyRef();
+		ValueRef value = StringRef(arena, format("%d", i));
+		bool addConflict = g_random->random01() < 0.5;
+		writes.mutate(key, MutationRef::SetValue, value, addConflict);
+		auto& e = expected[key];
+		e.first = value;
+		e.second = e.second || addConflict;
+	}
+
+	WriteMap::iterator it(&writes);
+	it.skip(allKeys.begin);
+	for (auto const& e : expected) {
+		if (!it.is_operation())
+			++it;
+		ASSERT(it.is_operation() && it.beginKey() == e.first);
+		ASSERT(it.op().size() == 1 && it.op().top().value.get() == e.second.first);
+		ASSERT(it.is_conflict_range() == e.second.second);
+		++it;
+	}
+	ASSERT(it.is_unmodified_range() && it.endKey() == allKeys.end);
+	ASSERT(getWriteMapCount(&writes) == 2*expected.size() + (expected.count(KeyRef()) ? 0 : 1));
+
+	return Void();
+}
+
 TEST_CASE("fdbclient/WriteMap/random") {
 	Arena arena = Arena();
 	WriteMap writes = WriteMap(&arena);
@@ -733,3 +768,92 @@ TEST_CASE("fdbclient/WriteMap/random") {
 
 	return Void();
 }
+
+TEST_CASE("fdbclient/VersionedMap/random") {
+	// Checks every version still in the window against a copy of the map taken when that version was the latest
+	VersionedMap<int,int> vm;
+	std::map<int,int> latest;
+	std::map<Version, std::map<int,int>> history;
+
+	for(int v = 1; v <= 200; v++) {
+		vm.createNewVersion(v);
+		for(int i = 0; i < 100; i++) {
+			int k = g_random->randomInt(0, 2000);
+			if( g_random->random01() < 0.8 ) {
+				vm.insert(k, v);
+				latest[k] = v;
+			} else {
+				vm.erase(k, k+10);
+				latest.erase(latest.lower_bound(k), latest.lower_bound(k+10));
+			}
+		}
+		history[v] = latest;
+
+		if( v > 50 ) {
+			vm.forgetVersionsBefore(v-50);
+			history.erase(v-51);
+		}
+	}
+
+	for(auto& h : history) {
+		auto view = vm.at(h.first);
+		auto it = view.begin();
+		for(auto& kv : h.second) {
+			ASSERT( it != view.end() && it.key() == kv.first && *it == kv.second );
+			++it;
+		}
+		ASSERT( it == view.end() );
+	}
+
+	return Void();
+}
+
+static ValueRef randomBytesForTest(int length, Arena& ar) {
+	uint8_t* buf = new (ar) uint8_t[length];
+	for (int i = 0; i < length; i++)
+		buf[i] = g_random->randomInt(0, 4) ? g_random->randomInt(0, 256) : 0;
+	return ValueRef(buf, length);
+}
+
+static ValueRef applyAtomicOpForTest(Optional<ValueRef> existing, MutationRef const& m, Arena& ar) {
+	switch (m.type) {
+		case MutationRef::AddValue: return doLittleEndianAdd(existing, m.param2, ar);
+		case MutationRef::Max: return doMax(existing, m.param2, ar);
+		case MutationRef::MinV2: return doMinV2(existing, m.param2, ar);
+		case MutationRef::ByteMin: return doByteMin(existing, m.param2, ar);
+		case MutationRef::ByteMax: return doByteMax(existing, m.param2, ar);
+		default: ASSERT(false); return ValueRef();
+	}
+}
+
+TEST_CASE("fdbclient/Atomic/fuse") {
+	MutationRef::Type types[] = { MutationRef::AddValue, MutationRef::Max, MutationRef::MinV2, MutationRef::ByteMin, MutationRef::ByteMax };
+	for (int i = 0; i < 10000; i++) {
+		Arena ar;
+		MutationRef::Type type = types[g_random->randomInt(0, 5)];
+		int opSize = g_random->randomInt(0, 4);
+		Optional<ValueRef> existing;
+		if (g_random->coinflip())
+			existing = randomBytesForTest(g_random->randomInt(0, 4), ar);
+
+		Optional<ValueRef> expected = existing;
+		MutationRef fused;
+		for (int j = g_random->randomInt(1, 5); j > 0; j--) {
+			MutationRef m(type, LiteralStringRef("key"), randomBytesForTest(opSize, ar));
+			expected = applyAtomicOpForTest(expected, m, ar);
+			if (!fused.param1.size())
+				fused = m;
+			else
+				ASSERT(fuseAtomicOps(fused, m, ar));
+		}
+		ASSERT(applyAtomicOpForTest(existing, fused, ar) == expected.get());
+	}
+
+	Arena ar;
+	MutationRef a(MutationRef::AddValue, LiteralStringRef("key"), LiteralStringRef("\x01"));
+	ASSERT(!fuseAtomicOps(a, MutationRef(MutationRef::AddValue, LiteralStringRef("key"), LiteralStringRef("\x01\x00")), ar));
+	ASSERT(!fuseAtomicOps(a, MutationRef(MutationRef::AddValue, LiteralStringRef("other"), LiteralStringRef("\x01")), ar));
+	ASSERT(!fuseAtomicOps(a, MutationRef(MutationRef::Max, LiteralStringRef("key"), LiteralStringRef("\x01")), ar));
+	ASSERT(!fuseAtomicOps(a, MutationRef(MutationRef::Or, LiteralStringRef("key"), LiteralStringRef("\x01")), ar));
+	return Void();
+}
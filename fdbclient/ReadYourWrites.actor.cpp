@@ -271,13 +271,62 @@ public:
 	}
 	template <class Req> static inline Future<typename Req::Result> readWithConflictRange( ReadYourWritesTransaction* ryw, Req const& req, bool snapshot ) {
 		if (ryw->options.readYourWritesDisabled) {
-			return readWithConflictRangeThrough(ryw, req, snapshot);
-		} else if (snapshot && ryw->options.snapshotRywEnabled <= 0) {
+			return readWithConflictRangeThrough(ryw, req, snapshot || ryw->options.readOnly);
+		} else if (ryw->options.readOnly || (snapshot && ryw->options.snapshotRywEnabled <= 0)) {
+			// With no writes to see, a read-only transaction's reads are the same as snapshot reads
 			return readWithConflictRangeSnapshot(ryw, req);
 		}
 		return readWithConflictRangeRYW(ryw, req, snapshot);
 	}
 
+	// Reads the header at key, then the chunks covering [offset, offset+length) all at once.  A key holding an ordinary value is
+	// read as a large value of one chunk.
+	ACTOR static Future< Optional<Value> > getLargeValue( ReadYourWritesTransaction* ryw, Key key, int64_t offset, int length, bool snapshot ) {
+		state Optional<Value> header = wait( readWithConflictRange( ryw, GetValueReq(key), snapshot ) );
+		if( !header.present() )
+			return header;
+
+		state int64_t size;
+		state int chunkBytes;
+		if( !decodeLargeValueHeader( header.get(), &size, &chunkBytes ) ) {
+			int begin = std::min<int64_t>( offset, header.get().size() );
+			return Value( header.get().substr( begin, length < 0 ? header.get().size() - begin : std::min( length, header.get().size() - begin ) ), header.get().arena() );
+		}
+
+		state int64_t begin = std::min( offset, size );
+		state int64_t end = length < 0 ? size : std::min( size, begin + length );
+		state int firstChunk = begin / chunkBytes;
+		state std::vector<Future<Optional<Value>>> chunks;
+		for(int64_t c = firstChunk; c * chunkBytes < end; c++)
+			chunks.push_back( readWithConflictRange( ryw, GetValueReq( largeValueChunkKey( key, c ) ), snapshot ) );
+		Void _ = wait( waitForAll( chunks ) );
+
+		Standalone<StringRef> result = makeString( end - begin );
+		uint8_t* out = mutateString( result );
+		for(int i = 0; i < chunks.size(); i++) {
+			int64_t chunkBegin = int64_t(firstChunk + i) * chunkBytes;
+			Optional<Value> const& chunk = chunks[i].get();
+			if( !chunk.present() || chunk.get().size() != std::min<int64_t>( chunkBytes, size - chunkBegin ) ) {
+				TraceEvent(SevWarnAlways, "LargeValueChunkMissing").detail("Key", printable(key)).detail("Chunk", firstChunk + i).detail("Size", size);
+				throw client_invalid_operation();
+			}
+			int64_t from = std::max( begin, chunkBegin ), to = std::min( end, chunkBegin + chunk.get().size() );
+			memcpy( out + (from - begin), chunk.get().begin() + (from - chunkBegin), to - from );
+		}
+		return Value( result );
+	}
+
+	ACTOR static Future< int64_t > getLargeValueSize( ReadYourWritesTransaction* ryw, Key key, bool snapshot ) {
+		Optional<Value> header = wait( readWithConflictRange( ryw, GetValueReq(key), snapshot ) );
+		if( !header.present() )
+			return -1;
+		int64_t size;
+		int chunkBytes;
+		if( !decodeLargeValueHeader( header.get(), &size, &chunkBytes ) )
+			return header.get().size();
+		return size;
+	}
+
 	template<class Iter> static void resolveKeySelectorFromCache( KeySelector& key, Iter& it, KeyRef const& maxKey, bool* readToBegin, bool* readThroughEnd, int* actualOffset ) {
 		// If the key indicated by `key` can be determined without reading unknown data from the snapshot, then it.kv().key is the resolved key.
 		// If the indicated key is determined to be "off the beginning or end" of the database, it points to the first or last segment in the DB,
@@ -604,20 +653,29 @@ public:
 				resolveKeySelectorFromCache( begin, it, ryw->getMaxReadKey(), &readToBegin, &readThroughEnd, &actualBeginOffset );
 				resolveKeySelectorFromCache( end, itEnd, ryw->getMaxReadKey(), &readToBegin, &readThroughEnd, &actualEndOffset );
 			} else if (it.is_kv()) {
-				KeyValueRef const* start = &it.kv(ryw->arena);
-				it.skipContiguous( end.isFirstGreaterOrEqual() ? end.getKey() : ryw->getMaxReadKey() ); //not technically correct since this would add end.getKey(), but that is protected above
-				
-				int maxCount = &it.kv(ryw->arena) - start + 1;
-				int count = 0;
-				for(; count < maxCount && !limits.isReached(); count++ ) {
-					limits.decrement(start[count]);
-				}
+				// Consume the whole run of known segments here rather than one segment per trip around the outer loop: none of
+				// the checks above can change their outcome until the iterator reaches an unknown or unreadable range, itEnd, or the limits
+				loop {
+					if (it.is_kv()) {
+						KeyValueRef const* start = &it.kv(ryw->arena);
+						it.skipContiguous( end.isFirstGreaterOrEqual() ? end.getKey() : ryw->getMaxReadKey() ); //not technically correct since this would add end.getKey(), but that is protected above
+
+						int maxCount = &it.kv(ryw->arena) - start + 1;
+						int count = 0;
+						for(; count < maxCount && !limits.isReached(); count++ ) {
+							limits.decrement(start[count]);
+						}
 
-				itemsPastEnd += maxCount - count;
-				
-				//TraceEvent("RYWaddKV", randomID).detail("key", printable(it.beginKey().toStandaloneStringRef())).detail("count", count).detail("maxCount", maxCount).detail("itemsPastEnd", itemsPastEnd);
-				if( count ) result.append( result.arena(), start, count );
-				++it;
+						itemsPastEnd += maxCount - count;
+
+						//TraceEvent("RYWaddKV", randomID).detail("key", printable(it.beginKey().toStandaloneStringRef())).detail("count", count).detail("maxCount", maxCount).detail("itemsPastEnd", itemsPastEnd);
+						if( count ) result.append( result.arena(), start, count );
+					}
+					++it;
+
+					if( it.is_unknown_range() || it.is_unreadable() || it == itEnd || it.beginKey() > itEnd.beginKey() || ( limits.isReached() && itemsPastEnd >= 1-end.offset ) )
+						break;
+				}
 			} else
 				++it;
 		}
@@ -1028,12 +1086,16 @@ public:
 				return Void();
 			}
 			
-			ryw->writeRangeToNativeTransaction(KeyRangeRef(StringRef(), ryw->getMaxWriteKey()));
-
-			auto conflictRanges = ryw->readConflicts.ranges();
-			for( auto iter = conflictRanges.begin(); iter != conflictRanges.end(); ++iter ) {
-				if( iter->value() ) {
-					ryw->tr.addReadConflictRange( iter->range() );
+			// A read-only transaction has nothing to write and didn't record its read conflict ranges, so the native transaction
+			// commits without contacting the proxies (but still starts any watches)
+			if( !ryw->options.readOnly ) {
+				ryw->writeRangeToNativeTransaction(KeyRangeRef(StringRef(), ryw->getMaxWriteKey()));
+
+				auto conflictRanges = ryw->readConflicts.ranges();
+				for( auto iter = conflictRanges.begin(); iter != conflictRanges.end(); ++iter ) {
+					if( iter->value() ) {
+						ryw->tr.addReadConflictRange( iter->range() );
+					}
 				}
 			}
 
@@ -1125,7 +1187,7 @@ Future<Version> ReadYourWritesTransaction::getReadVersion() {
 
 Optional<Value> getValueFromJSON(StatusObject statusObj) {
 	try {
-		Value output = StringRef(json_spirit::write_string(json_spirit::mValue(statusObj), json_spirit::Output_options::raw_utf8).c_str());
+		Value output = StringRef(writeJSON(json_spirit::mValue(statusObj)));
 		return output;
 	}
 	catch (std::exception& e){
@@ -1197,6 +1259,14 @@ Future< Optional<Value> > ReadYourWritesTransaction::get( const Key& key, bool s
 		return Optional<Value>();
 	}
 
+	// Set by a commit that failed with not_committed when FDBTransactionOptions::REPORT_CONFLICTING_KEYS is set
+	if (key == LiteralStringRef("\xff\xff/conflicting_range/begin") || key == LiteralStringRef("\xff\xff/conflicting_range/end")) {
+		if (!tr.conflictingKeyRange.present())
+			return Optional<Value>();
+		Optional<Value> output = key.endsWith(LiteralStringRef("/begin")) ? tr.conflictingKeyRange.get().begin : tr.conflictingKeyRange.get().end;
+		return output;
+	}
+
 	if(checkUsedDuringCommit()) {
 		return used_during_commit();
 	}
@@ -1312,6 +1382,76 @@ Future< Standalone<VectorRef<const char*> >> ReadYourWritesTransaction::getAddre
 	return result;
 }
 
+// Neither reads the range nor conflicts with writes to it, and writes in this transaction are not counted
+Future< int64_t > ReadYourWritesTransaction::getEstimatedRangeSizeBytes( const KeyRange& keys ) {
+	if(checkUsedDuringCommit()) {
+		return used_during_commit();
+	}
+
+	if( resetPromise.isSet() )
+		return resetPromise.getFuture().getError();
+
+	if( keys.end > getMaxReadKey() )
+		return key_outside_legal_range();
+
+	return waitOrError( tr.getEstimatedRangeSizeBytes(keys), resetPromise.getFuture() );
+}
+
+Future< Standalone<VectorRef<KeyRef>> > ReadYourWritesTransaction::getRangeSplitPoints( const KeyRange& keys, int64_t chunkSize ) {
+	if(checkUsedDuringCommit()) {
+		return used_during_commit();
+	}
+
+	if( resetPromise.isSet() )
+		return resetPromise.getFuture().getError();
+
+	if( keys.end > getMaxReadKey() )
+		return key_outside_legal_range();
+
+	return waitOrError( tr.getRangeSplitPoints(keys, chunkSize), resetPromise.getFuture() );
+}
+
+Future< Optional<Value> > ReadYourWritesTransaction::getLargeValue( const Key& key, int64_t offset, int length, bool snapshot ) {
+	if(checkUsedDuringCommit()) {
+		return used_during_commit();
+	}
+
+	if( resetPromise.isSet() )
+		return resetPromise.getFuture().getError();
+
+	if(key >= getMaxReadKey())
+		return key_outside_legal_range();
+
+	if(offset < 0)
+		return client_invalid_operation();
+
+	if(key.size() > (key.startsWith(systemKeys.begin) ? CLIENT_KNOBS->SYSTEM_KEY_SIZE_LIMIT : CLIENT_KNOBS->KEY_SIZE_LIMIT))
+		return Optional<Value>();
+
+	Future< Optional<Value> > result = RYWImpl::getLargeValue( this, key, offset, length, snapshot );
+	reading.add( success( result ) );
+	return result;
+}
+
+Future< int64_t > ReadYourWritesTransaction::getLargeValueSize( const Key& key, bool snapshot ) {
+	if(checkUsedDuringCommit()) {
+		return used_during_commit();
+	}
+
+	if( resetPromise.isSet() )
+		return resetPromise.getFuture().getError();
+
+	if(key >= getMaxReadKey())
+		return key_outside_legal_range();
+
+	if(key.size() > (key.startsWith(systemKeys.begin) ? CLIENT_KNOBS->SYSTEM_KEY_SIZE_LIMIT : CLIENT_KNOBS->KEY_SIZE_LIMIT))
+		return int64_t(-1);
+
+	Future< int64_t > result = RYWImpl::getLargeValueSize( this, key, snapshot );
+	reading.add( success( result ) );
+	return result;
+}
+
 void ReadYourWritesTransaction::addReadConflictRange( KeyRangeRef const& keys ) {
 	if(checkUsedDuringCommit()) {
 		throw used_during_commit();
@@ -1323,6 +1463,10 @@ void ReadYourWritesTransaction::addReadConflictRange( KeyRangeRef const& keys )
 		}
 	}
 
+	if(options.readOnly) {
+		return;
+	}
+
 	//There aren't any keys in the database with size larger than KEY_SIZE_LIMIT, so if range contains large keys
 	//we can translate it to an equivalent one with smaller keys
 	KeyRef begin = keys.begin;
@@ -1476,6 +1620,9 @@ void ReadYourWritesTransaction::atomicOp( const KeyRef& key, const ValueRef& ope
 		throw used_during_commit();
 	}
 
+	if(options.readOnly)
+		throw transaction_read_only();
+
 	if(key >= getMaxWriteKey())
 		throw key_outside_legal_range();
 
@@ -1532,6 +1679,9 @@ void ReadYourWritesTransaction::set( const KeyRef& key, const ValueRef& value )
 		throw used_during_commit();
 	}
 
+	if(options.readOnly)
+		throw transaction_read_only();
+
 	if(key >= getMaxWriteKey())
 		throw key_outside_legal_range();
 
@@ -1559,6 +1709,9 @@ void ReadYourWritesTransaction::clear( const KeyRangeRef& range ) {
 		throw used_during_commit();
 	}
 
+	if(options.readOnly)
+		throw transaction_read_only();
+
 	KeyRef maxKey = getMaxWriteKey();
 	if(range.begin > maxKey || range.end > maxKey)
 		throw key_outside_legal_range();
@@ -1596,6 +1749,9 @@ void ReadYourWritesTransaction::clear( const KeyRef& key ) {
 		throw used_during_commit();
 	}
 
+	if(options.readOnly)
+		throw transaction_read_only();
+
 	if(key >= getMaxWriteKey())
 		throw key_outside_legal_range();
 
@@ -1614,6 +1770,42 @@ void ReadYourWritesTransaction::clear( const KeyRef& key ) {
 	RYWImpl::triggerWatches(this, r, Optional<ValueRef>());
 }
 
+// The chunk keys are in the system keyspace whether or not this transaction may write there.  Since the chunk keys of a key
+// don't depend on the size of its value, the old chunks are cleared without being read.
+void ReadYourWritesTransaction::setLargeValue( const KeyRef& key, const ValueRef& value ) {
+	if(value.size() > CLIENT_KNOBS->TRANSACTION_SIZE_LIMIT)
+		throw transaction_too_large();
+
+	int chunkBytes = CLIENT_KNOBS->LARGE_VALUE_CHUNK_BYTES;
+	set( key, largeValueHeaderValue( value.size(), chunkBytes ) );
+
+	bool writeSystemKeys = options.writeSystemKeys;
+	options.writeSystemKeys = true;
+	try {
+		clear( largeValueChunkRange(key) );
+		for(int64_t c = 0; c * chunkBytes < value.size(); c++)
+			set( largeValueChunkKey( key, c ), value.substr( c * chunkBytes, std::min<int64_t>( chunkBytes, value.size() - c * chunkBytes ) ) );
+	} catch( Error& ) {
+		options.writeSystemKeys = writeSystemKeys;
+		throw;
+	}
+	options.writeSystemKeys = writeSystemKeys;
+}
+
+void ReadYourWritesTransaction::clearLargeValue( const KeyRef& key ) {
+	clear( key );
+
+	bool writeSystemKeys = options.writeSystemKeys;
+	options.writeSystemKeys = true;
+	try {
+		clear( largeValueChunkRange(key) );
+	} catch( Error& ) {
+		options.writeSystemKeys = writeSystemKeys;
+		throw;
+	}
+	options.writeSystemKeys = writeSystemKeys;
+}
+
 Future<Void> ReadYourWritesTransaction::watch(const Key& key) {
 	if(checkUsedDuringCommit()) {
 		return used_during_commit();
@@ -1639,6 +1831,9 @@ void ReadYourWritesTransaction::addWriteConflictRange( KeyRangeRef const& keys )
 		throw used_during_commit();
 	}
 
+	if(options.readOnly)
+		throw transaction_read_only();
+
 	if (tr.apiVersionAtLeast(300)) {
 		if (keys.begin > getMaxWriteKey() || keys.end > getMaxWriteKey()) {
 			throw key_outside_legal_range();
@@ -1700,6 +1895,15 @@ void ReadYourWritesTransaction::setOption( FDBTransactionOptions::Option option,
 			options.readYourWritesDisabled = true;
 			break;
 
+		case FDBTransactionOptions::READ_ONLY:
+			validateOptionValue(value, false);
+
+			if (!writes.empty())
+				throw client_invalid_operation();
+
+			options.readOnly = true;
+			break;
+
 		case FDBTransactionOptions::READ_AHEAD_DISABLE:
 			validateOptionValue(value, false);
 
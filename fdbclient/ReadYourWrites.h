@@ -37,6 +37,7 @@ struct ReadYourWritesTransactionOptions {
 	bool nextWriteDisableConflictRange : 1;
 	bool debugRetryLogging : 1;
 	bool disableUsedDuringCommitProtection : 1;
+	bool readOnly : 1;
 	double timeoutInSeconds;
 	int maxRetries;
 	int snapshotRywEnabled;
@@ -88,6 +89,18 @@ public:
 	}
 
 	Future< Standalone<VectorRef<const char*>> > getAddressesForKey(const Key& key);
+	Future< int64_t > getEstimatedRangeSizeBytes( const KeyRange& keys );
+	Future< Standalone<VectorRef<KeyRef>> > getRangeSplitPoints( const KeyRange& keys, int64_t chunkSize );
+
+	// Values too large for set() are split into chunks of CLIENT_KNOBS->LARGE_VALUE_CHUNK_BYTES under largeValueChunkKeys, with a
+	// header at the key itself.  getLargeValue() returns up to length bytes (all of them if length is negative) starting at
+	// offset, reading every chunk it needs at once, so a large value can be streamed by reading successive windows of it.  An
+	// ordinary value at key is read as one chunk.  Set or clear such a key with set() or clear() and its chunks are left behind:
+	// use clearLargeValue().
+	Future< Optional<Value> > getLargeValue( const Key& key, int64_t offset, int length, bool snapshot = false );
+	Future< int64_t > getLargeValueSize( const Key& key, bool snapshot = false );  // -1 if there is no value at key
+	void setLargeValue( const KeyRef& key, const ValueRef& value );
+	void clearLargeValue( const KeyRef& key );
 
 	void addReadConflictRange( KeyRangeRef const& keys );
 	void makeSelfConflicting() { tr.makeSelfConflicting(); }
@@ -119,6 +132,7 @@ public:
 
 	void cancel();
 	void reset();
+	void restartTimeout() { creationTime = now(); }  // For a transaction that was reset some time before it is used again
 	double getBackoff() { return tr.getBackoff(); }
 	void debugTransaction(UID dID) { tr.debugTransaction(dID); }
 
@@ -22,6 +22,7 @@
 #define FDBCLIENT_STATUS_H
 
 #include "../fdbrpc/JSONDoc.h"
+#include "JSONStream.h"
 
 struct StatusObject : json_spirit::mObject {
 	typedef json_spirit::mObject Map;
@@ -39,7 +40,7 @@ void load(Ar& ar, StatusObject& statusObj) {
 	value.resize(length);
 	ar.serializeBytes( &value[0], (int)value.length() );
 	json_spirit::mValue mv;
-	json_spirit::read_string( value, mv );
+	readJSON( value, mv );
 	statusObj = StatusObject(mv.get_obj());
 
 	ASSERT( ar.protocolVersion() != 0 );
@@ -47,7 +48,7 @@ void load(Ar& ar, StatusObject& statusObj) {
 
 template <class Ar>
 void save(Ar& ar, StatusObject const& statusObj) {
-	std::string value = json_spirit::write_string(json_spirit::mValue(statusObj));
+	std::string value = writeJSON(json_spirit::mValue(statusObj));
 	ar << (int32_t)value.length();
 	ar.serializeBytes( (void*)&value[0], (int)value.length() );
 	ASSERT( ar.protocolVersion() != 0 );
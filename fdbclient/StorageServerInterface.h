@@ -23,10 +23,13 @@
 #pragma once
 
 #include "FDBTypes.h"
+#include "Tuple.h"
 #include "fdbrpc/Locality.h"
 #include "fdbrpc/QueueModel.h"
 #include "fdbrpc/fdbrpc.h"
 #include "fdbrpc/LoadBalance.actor.h"
+#include "flow/CompressedInt.h"
+#include "flow/Hash3.h"
 
 struct StorageServerInterface {
 	enum { 
@@ -42,15 +45,27 @@ struct StorageServerInterface {
 
 	RequestStream<ReplyPromise<Version>> getVersion;
 	RequestStream<struct GetValueRequest> getValue;
+	RequestStream<struct GetValuesRequest> getValues;
 	RequestStream<struct GetKeyRequest> getKey;
 
 	// Throws a wrong_shard_server if the keys in the request or result depend on data outside this server OR if a large selector offset prevents
 	// all data from being read in one range read
 	RequestStream<struct GetKeyValuesRequest> getKeyValues;
+	// Reads a range in successive chunks, one per reply promise in the request; the same shard restrictions apply
+	RequestStream<struct GetKeyValuesStreamRequest> getKeyValuesStream;
+	// Hashes a range (within a single shard) instead of returning it, so that replicas can be compared cheaply
+	RequestStream<struct GetRangeChecksumRequest> getRangeChecksum;
+	// Counts and sums a range (within a single shard) instead of returning it
+	RequestStream<struct GetRangeAggregateRequest> getRangeAggregate;
+	// Keeps a version readable, from a snapshot of the storage engine, after it leaves the window of versions held in memory
+	RequestStream<struct PinSnapshotRequest> pinSnapshot;
+	// Writes a range (within a single shard) to a backup container as range files, for exportSnapshot()
+	RequestStream<struct ExportRangeRequest> exportRange;
 
 	RequestStream<struct GetShardStateRequest> getShardState;
 	RequestStream<struct WaitMetricsRequest> waitMetrics;
 	RequestStream<struct SplitMetricsRequest> splitMetrics;
+	RequestStream<struct SplitRangeRequest> getRangeSplitPoints;
 	RequestStream<struct GetPhysicalMetricsRequest> getPhysicalMetrics;
 	RequestStream<ReplyPromise<Void>> waitFailure;
 	RequestStream<struct StorageQueuingMetricsRequest> getQueuingMetrics;
@@ -72,13 +87,29 @@ struct StorageServerInterface {
 
 		if( ar.protocolVersion() >= 0x0FDB00A200090001LL )
 			ar & watchValue;
+		if( ar.protocolVersion() >= 0x0FDB00A570010001LL )
+			ar & getValues & getKeyValuesStream;
+		if( ar.protocolVersion() >= 0x0FDB00A570010003LL )
+			ar & getRangeChecksum;
+		if( ar.protocolVersion() >= 0x0FDB00A570010004LL )
+			ar & getRangeSplitPoints;
+		if( ar.protocolVersion() >= 0x0FDB00A570010006LL )
+			ar & getRangeAggregate;
+		if( ar.protocolVersion() >= 0x0FDB00A570010007LL )
+			ar & pinSnapshot;
+		if( ar.protocolVersion() >= 0x0FDB00A570010008LL )
+			ar & exportRange;
 	}
 	bool operator == (StorageServerInterface const& s) const { return uniqueID == s.uniqueID; }
 	bool operator < (StorageServerInterface const& s) const { return uniqueID < s.uniqueID; }
 	void initEndpoints() {
 		getValue.getEndpoint( TaskLoadBalancedEndpoint );
+		getValues.getEndpoint( TaskLoadBalancedEndpoint );
 		getKey.getEndpoint( TaskLoadBalancedEndpoint );
 		getKeyValues.getEndpoint( TaskLoadBalancedEndpoint );
+		getKeyValuesStream.getEndpoint( TaskLoadBalancedEndpoint );
+		getRangeChecksum.getEndpoint( TaskLoadBalancedEndpoint );
+		getRangeAggregate.getEndpoint( TaskLoadBalancedEndpoint );
 	}
 };
 
@@ -88,12 +119,21 @@ struct StorageInfo : NonCopyable, public ReferenceCounted<StorageInfo> {
 	StorageInfo() : tag(invalidTag) {}
 };
 
-struct ServerCacheInfo {
+// The storage servers of a shard as seen by a proxy.  Shards with the same source and destination teams share one
+// ServerCacheInfo, so the proxy's keyInfo map costs a pointer per shard rather than a copy of the team.
+struct ServerCacheInfo : NonCopyable, public ReferenceCounted<ServerCacheInfo> {
 	std::vector<Tag> tags;
 	std::vector<Reference<StorageInfo>> src_info;
 	std::vector<Reference<StorageInfo>> dest_info;
 };
 
+// Storage servers schedule and shed the reads of each priority separately.  Batch priority transactions read at ReadPriorityBatch.
+enum ReadPriority {
+	ReadPriorityDefault = 0,
+	ReadPriorityBatch = 1,
+	ReadPriorityCount = 2
+};
+
 struct GetValueReply : public LoadBalancedReply {
 	Optional<Value> value;
 
@@ -110,14 +150,41 @@ struct GetValueRequest {
 	Key key;
 	Version version;
 	Optional<UID> debugID;
+	uint8_t priority;  // ReadPriority
 	ReplyPromise<GetValueReply> reply;
 
-	GetValueRequest(){}
-	GetValueRequest(const Key& key, Version ver, Optional<UID> debugID) : key(key), version(ver), debugID(debugID) {}
+	GetValueRequest() : priority(ReadPriorityDefault) {}
+	GetValueRequest(const Key& key, Version ver, Optional<UID> debugID, uint8_t priority = ReadPriorityDefault) : key(key), version(ver), debugID(debugID), priority(priority) {}
 	
 	template <class Ar> 
 	void serialize( Ar& ar ) {
-		ar & key & version & debugID & reply;
+		ar & key & version & debugID & priority & reply;
+	}
+};
+
+struct GetValuesReply : public LoadBalancedReply {
+	Arena arena;
+	VectorRef<KeyValueRef> data;	// The requested keys which have values, in key order
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & *(LoadBalancedReply*)this & data & arena;
+	}
+};
+
+struct GetValuesRequest {
+	Arena arena;
+	VectorRef<KeyRef> keys;		// Sorted and unique
+	Version version;
+	Optional<UID> debugID;
+	uint8_t priority;  // ReadPriority
+	ReplyPromise<GetValuesReply> reply;
+
+	GetValuesRequest() : priority(ReadPriorityDefault) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & keys & version & debugID & priority & reply & arena;
 	}
 };
 
@@ -137,15 +204,171 @@ struct WatchValueRequest {
 	}
 };
 
+// Serializes a range result with each key front coded against the key before it.  The shared prefix, suffix
+// and value lengths of every row are written first as a column of CompressedInts, followed by all of the key
+// suffixes and then all of the values, so a result whose keys share long prefixes costs little more than its
+// distinct bytes.  Deserialized keys which share nothing with their predecessor point into the message itself.
+struct PrefixCompressedKeyValues {
+	VectorRef<KeyValueRef>& data;
+	explicit PrefixCompressedKeyValues( VectorRef<KeyValueRef>& data ) : data(data) {}
+};
+
+inline int sharedPrefixLength( KeyRef a, KeyRef b ) {
+	int n = std::min(a.size(), b.size());
+	for(int i = 0; i < n; i++)
+		if (a[i] != b[i])
+			return i;
+	return n;
+}
+
+template <class Archive>
+inline void save( Archive& ar, const PrefixCompressedKeyValues& kvs ) {
+	VectorRef<KeyValueRef> const& data = kvs.data;
+	ar << CompressedInt<int>(data.size());
+	for(int i = 0; i < data.size(); i++) {
+		int shared = i ? sharedPrefixLength(data[i-1].key, data[i].key) : 0;
+		ar << CompressedInt<int>(shared) << CompressedInt<int>(data[i].key.size() - shared) << CompressedInt<int>(data[i].value.size());
+	}
+	for(int i = 0; i < data.size(); i++) {
+		int shared = i ? sharedPrefixLength(data[i-1].key, data[i].key) : 0;
+		ar.serializeBytes(data[i].key.begin() + shared, data[i].key.size() - shared);
+	}
+	for(int i = 0; i < data.size(); i++)
+		ar.serializeBytes(data[i].value.begin(), data[i].value.size());
+}
+
+template <class Archive>
+inline void load( Archive& ar, PrefixCompressedKeyValues& kvs ) {
+	VectorRef<KeyValueRef>& data = kvs.data;
+	CompressedInt<int> count;
+	ar >> count;
+	UNSTOPPABLE_ASSERT( count.value >= 0 && count.value*sizeof(KeyValueRef) < (100<<20) );
+	data.resize(ar.arena(), count.value);
+
+	std::vector<int> lengths( 3*count.value );
+	for(int i = 0; i < lengths.size(); i++) {
+		CompressedInt<int> length;
+		ar >> length;
+		UNSTOPPABLE_ASSERT( length.value >= 0 );
+		lengths[i] = length.value;
+	}
+	for(int i = 0; i < data.size(); i++) {
+		int shared = lengths[3*i], suffix = lengths[3*i+1];
+		UNSTOPPABLE_ASSERT( shared <= (i ? data[i-1].key.size() : 0) );
+		const uint8_t* suffixBytes = ar.arenaRead(suffix);
+		if (shared) {
+			uint8_t* key = new (ar.arena()) uint8_t[shared + suffix];
+			memcpy(key, data[i-1].key.begin(), shared);
+			memcpy(key + shared, suffixBytes, suffix);
+			data[i].key = KeyRef(key, shared + suffix);
+		} else {
+			data[i].key = KeyRef(suffixBytes, suffix);
+		}
+	}
+	for(int i = 0; i < data.size(); i++)
+		data[i].value = ValueRef(ar.arenaRead(lengths[3*i+2]), lengths[3*i+2]);
+}
+
+// A filter evaluated by the storage server on each row of a range read, so that rows the client does not want, and the parts of
+// rows it does not need, are never sent.  The predicate decides which rows are returned and the projection what is returned of
+// each of them.
+struct ReadFilterRef {
+	enum Projection { KEY_VALUE = 0, KEYS_ONLY = 1, VALUE_LENGTH = 2 };
+	enum Predicate {
+		ALL = 0,
+		VALUE_PREFIX = 1,      // The value starts with param
+		VALUE_MASK = 2,        // (value[i] & mask[i]) == param[i] for every i < param.size(); mask and param are the same size
+		TUPLE_ELEMENT = 3      // The key is a tuple whose element tupleIndex, packed on its own, is param
+	};
+
+	uint8_t projection, predicate;
+	int tupleIndex;
+	StringRef param, mask;
+
+	ReadFilterRef() : projection(KEY_VALUE), predicate(ALL), tupleIndex(0) {}
+	ReadFilterRef( Arena& a, ReadFilterRef const& r ) : projection(r.projection), predicate(r.predicate), tupleIndex(r.tupleIndex), param(a, r.param), mask(a, r.mask) {}
+
+	static ReadFilterRef keysOnly() { ReadFilterRef f; f.projection = KEYS_ONLY; return f; }
+	static ReadFilterRef valuePrefix( StringRef prefix ) { ReadFilterRef f; f.predicate = VALUE_PREFIX; f.param = prefix; return f; }
+	static ReadFilterRef valueMask( StringRef mask, StringRef bits ) { ReadFilterRef f; f.predicate = VALUE_MASK; f.mask = mask; f.param = bits; return f; }
+	static ReadFilterRef tupleElement( int index, StringRef packedElement ) { ReadFilterRef f; f.predicate = TUPLE_ELEMENT; f.tupleIndex = index; f.param = packedElement; return f; }
+
+	bool isValid() const {
+		return projection <= VALUE_LENGTH && predicate <= TUPLE_ELEMENT && (predicate != VALUE_MASK || mask.size() == param.size()) && tupleIndex >= 0;
+	}
+	bool dropsRows() const { return predicate != ALL; }
+	int expectedSize() const { return param.size() + mask.size(); }
+
+	bool matches( KeyValueRef const& kv ) const {
+		switch( predicate ) {
+			case VALUE_PREFIX:
+				return kv.value.startsWith( param );
+			case VALUE_MASK:
+				if( kv.value.size() < param.size() )
+					return false;
+				for(int i = 0; i < param.size(); i++)
+					if( (kv.value[i] & mask[i]) != param[i] )
+						return false;
+				return true;
+			case TUPLE_ELEMENT:
+				try {
+					Tuple t = Tuple::unpack( kv.key );
+					return tupleIndex < t.size() && t.subTuple( tupleIndex, tupleIndex+1 ).pack() == param;
+				} catch( Error& e ) {
+					if( e.code() != error_code_invalid_tuple_data_type )
+						throw;
+					return false;  // Not a tuple
+				}
+			default:
+				return true;
+		}
+	}
+
+	// What is sent of a row that matches()
+	KeyValueRef project( Arena& arena, KeyValueRef const& kv ) const {
+		switch( projection ) {
+			case KEYS_ONLY:
+				return KeyValueRef( kv.key, ValueRef() );
+			case VALUE_LENGTH: {
+				uint8_t* length = new (arena) uint8_t[4];
+				uint32_t size = kv.value.size();
+				memcpy( length, &size, 4 );
+				return KeyValueRef( kv.key, ValueRef( length, 4 ) );
+			}
+			default:
+				return kv;
+		}
+	}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & projection & predicate & tupleIndex & param & mask;
+	}
+};
+typedef Standalone<ReadFilterRef> ReadFilter;
+
 struct GetKeyValuesReply : public LoadBalancedReply {
 	Arena arena;
 	VectorRef<KeyValueRef> data;
 	Version version; // useful when latestVersion was requested
 	bool more;
+	// With a filter that drops rows, the last key read when there are more; the next read begins after it rather than after the last
+	// key in data, which may be long before it (or absent)
+	Optional<KeyRef> scannedThrough;
 
 	template <class Ar>
 	void serialize( Ar& ar ) {
-		ar & *(LoadBalancedReply*)this & data & version & more & arena;
+		ar & *(LoadBalancedReply*)this;
+		if( ar.protocolVersion() >= 0x0FDB00A570010001LL ) {
+			PrefixCompressedKeyValues compressed(data);
+			ar & compressed;
+		} else {
+			ar & data;
+		}
+		ar & version & more;
+		if( ar.protocolVersion() >= 0x0FDB00A570010005LL )
+			ar & scannedThrough;
+		ar & arena;
 	}
 };
 
@@ -155,13 +378,38 @@ struct GetKeyValuesRequest {
 	Version version;		// or latestVersion
 	int limit, limitBytes;
 	Optional<UID> debugID;
+	uint8_t priority;  // ReadPriority
+	Optional<ReadFilterRef> filter;  // limit counts the rows read, not the rows that pass; limitBytes counts the bytes read
 	ReplyPromise<GetKeyValuesReply> reply;
 
-	GetKeyValuesRequest() {}
+	GetKeyValuesRequest() : priority(ReadPriorityDefault) {}
 //	GetKeyValuesRequest(const KeySelectorRef& begin, const KeySelectorRef& end, Version version, int limit, int limitBytes, Optional<UID> debugID) : begin(begin), end(end), version(version), limit(limit), limitBytes(limitBytes) {}
 	template <class Ar>
 	void serialize( Ar& ar ) {
-		ar & begin & end & version & limit & limitBytes & debugID & reply & arena;
+		ar & begin & end & version & limit & limitBytes & debugID & priority & reply;
+		if( ar.protocolVersion() >= 0x0FDB00A570010005LL )
+			ar & filter;
+		ar & arena;
+	}
+};
+
+// Streams the range keys (which must lie within a single shard) forward in chunks of at most limitBytes each, one chunk per reply promise.
+// Each chunk begins just after the last key of the chunk before it, and all chunks are read at the same version.  Once the range or the
+// row limit (a total across all chunks) is exhausted the remaining promises are answered with empty replies, so the number of promises
+// is the client's flow control window.
+struct GetKeyValuesStreamRequest {
+	Arena arena;
+	KeyRangeRef keys;
+	Version version;		// or latestVersion
+	int limit, limitBytes;
+	Optional<UID> debugID;
+	uint8_t priority;  // ReadPriority
+	std::vector<ReplyPromise<GetKeyValuesReply>> replies;
+
+	GetKeyValuesStreamRequest() : priority(ReadPriorityDefault) {}
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & keys & version & limit & limitBytes & debugID & priority & replies & arena;
 	}
 };
 
@@ -192,6 +440,176 @@ struct GetKeyRequest {
 	}
 };
 
+// A hash of a sequence of key-value pairs, in order.  Two replicas of a range produce the same checksum exactly when
+// (barring a 64 bit collision) they hold the same data, so only ranges whose checksums differ need to be compared in full.
+struct RangeChecksum {
+	uint32_t primary, secondary;
+	int64_t keys, bytes;
+
+	RangeChecksum() : primary(0), secondary(0), keys(0), bytes(0) {}
+
+	void add( KeyValueRef const& kv ) {
+		// The lengths keep ("ab","c") and ("a","bc") from hashing alike
+		int32_t lengths[2] = { kv.key.size(), kv.value.size() };
+		hashlittle2( lengths, sizeof(lengths), &primary, &secondary );
+		hashlittle2( kv.key.begin(), kv.key.size(), &primary, &secondary );
+		hashlittle2( kv.value.begin(), kv.value.size(), &primary, &secondary );
+		++keys;
+		bytes += kv.expectedSize();
+	}
+	void add( VectorRef<KeyValueRef> const& data ) {
+		for(auto& kv : data)
+			add( kv );
+	}
+
+	bool operator==( RangeChecksum const& r ) const { return primary == r.primary && secondary == r.secondary && keys == r.keys && bytes == r.bytes; }
+	bool operator!=( RangeChecksum const& r ) const { return !(*this == r); }
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & primary & secondary & keys & bytes;
+	}
+};
+
+struct GetRangeChecksumReply : public LoadBalancedReply {
+	RangeChecksum checksum;
+	Version version;
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & *(LoadBalancedReply*)this & checksum & version;
+	}
+};
+
+struct GetRangeChecksumRequest {
+	Arena arena;
+	KeyRangeRef keys;
+	Version version;		// or latestVersion
+	uint8_t priority;  // ReadPriority
+	ReplyPromise<GetRangeChecksumReply> reply;
+
+	GetRangeChecksumRequest() : priority(ReadPriorityBatch) {}
+	GetRangeChecksumRequest( KeyRangeRef const& keys, Version version ) : keys(arena, keys), version(version), priority(ReadPriorityBatch) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & keys & version & priority & reply & arena;
+	}
+};
+
+// The number of keys in a range, their total size, and the sum of their values read as little endian integers, as the ADD atomic
+// operation reads them: values shorter than 8 bytes are zero extended, longer ones truncated, and the sum wraps around.  Aggregates
+// of adjacent ranges add up to the aggregate of their union.
+struct RangeAggregate {
+	int64_t keys, bytes, sum;
+
+	RangeAggregate() : keys(0), bytes(0), sum(0) {}
+
+	void add( KeyValueRef const& kv ) {
+		uint64_t value = 0;
+		memcpy( &value, kv.value.begin(), std::min( kv.value.size(), 8 ) );
+		sum = int64_t( uint64_t(sum) + value );
+		++keys;
+		bytes += kv.expectedSize();
+	}
+	void add( VectorRef<KeyValueRef> const& data ) {
+		for(auto& kv : data)
+			add( kv );
+	}
+	RangeAggregate& operator+=( RangeAggregate const& r ) {
+		keys += r.keys;
+		bytes += r.bytes;
+		sum = int64_t( uint64_t(sum) + uint64_t(r.sum) );
+		return *this;
+	}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & keys & bytes & sum;
+	}
+};
+
+struct GetRangeAggregateReply : public LoadBalancedReply {
+	RangeAggregate aggregate;
+	Version version;
+	Optional<Key> resumeKey;  // If present, the aggregate is of the range up to here, and the rest was not read
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & *(LoadBalancedReply*)this & aggregate & version & resumeKey;
+	}
+};
+
+// Stops reading once limitBytes have been read, so that a large shard is aggregated in several requests rather than one that
+// may outlive the versions the storage server keeps
+struct GetRangeAggregateRequest {
+	Arena arena;
+	KeyRangeRef keys;
+	Version version;		// or latestVersion
+	int limitBytes;
+	uint8_t priority;  // ReadPriority
+	ReplyPromise<GetRangeAggregateReply> reply;
+
+	GetRangeAggregateRequest() : priority(ReadPriorityDefault) {}
+	GetRangeAggregateRequest( KeyRangeRef const& keys, Version version, int limitBytes, uint8_t priority ) : keys(arena, keys), version(version), limitBytes(limitBytes), priority(priority) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & keys & version & limitBytes & priority & reply & arena;
+	}
+};
+
+// Asks a storage server to keep reads at version possible for lease seconds, however far the server gets past it.  The
+// version must still be newer than what the server has made durable.  Pinning a version that is already pinned extends the
+// lease.  Fails with unsupported_operation if the storage engine cannot open snapshots, and with operation_failed if the
+// server already has SERVER_KNOBS->MAX_PINNED_SNAPSHOTS versions pinned.
+struct PinSnapshotRequest {
+	Version version;
+	double lease;
+	ReplyPromise<Void> reply;
+
+	PinSnapshotRequest() {}
+	PinSnapshotRequest( Version version, double lease ) : version(version), lease(lease) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & version & lease & reply;
+	}
+};
+
+struct ExportRangeReply {
+	std::vector<std::string> fileNames;  // In key order; each file covers the part of the range after the one before it
+	int64_t bytes;  // The total size of the files
+
+	ExportRangeReply() : bytes(0) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & fileNames & bytes;
+	}
+};
+
+// Asks a storage server to write the range, which must lie within a single shard, as it was at version to the backup container
+// at containerURL.  The server writes range files in the format backups use, of about SERVER_KNOBS->EXPORT_RANGE_FILE_BYTES
+// each, so it has to be able to open the container itself.  The version can be older than the server's MVCC window if it has
+// been pinned (see PinSnapshotRequest), which an export of more than a few seconds of data needs.
+struct ExportRangeRequest {
+	Arena arena;
+	KeyRangeRef keys;
+	Version version;
+	std::string containerURL;
+	bool compressBlocks;
+	ReplyPromise<ExportRangeReply> reply;
+
+	ExportRangeRequest() : compressBlocks(false) {}
+	ExportRangeRequest( KeyRangeRef const& keys, Version version, std::string const& containerURL, bool compressBlocks ) : keys(arena, keys), version(version), containerURL(containerURL), compressBlocks(compressBlocks) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & keys & version & containerURL & compressBlocks & reply & arena;
+	}
+};
+
 struct GetShardStateRequest {
 	enum waitMode {
 		NO_WAIT = 0,
@@ -215,35 +633,39 @@ struct StorageMetrics {
 	int64_t bytes;				// total storage
 	int64_t bytesPerKSecond;	// network bandwidth (average over 10s)
 	int64_t iosPerKSecond;
+	int64_t bytesReadPerKSecond;	// bytes returned to readers (average over 10s)
 
 	static const int64_t infinity = 1LL<<60;
 
-	StorageMetrics() : bytes(0), bytesPerKSecond(0), iosPerKSecond(0) {}
+	StorageMetrics() : bytes(0), bytesPerKSecond(0), iosPerKSecond(0), bytesReadPerKSecond(0) {}
 
 	bool allLessOrEqual( const StorageMetrics& rhs ) const {
-		return bytes <= rhs.bytes && bytesPerKSecond <= rhs.bytesPerKSecond && iosPerKSecond <= rhs.iosPerKSecond;
+		return bytes <= rhs.bytes && bytesPerKSecond <= rhs.bytesPerKSecond && iosPerKSecond <= rhs.iosPerKSecond && bytesReadPerKSecond <= rhs.bytesReadPerKSecond;
 	}
 	void operator += ( const StorageMetrics& rhs ) {
 		bytes += rhs.bytes;
 		bytesPerKSecond += rhs.bytesPerKSecond;
 		iosPerKSecond += rhs.iosPerKSecond;
+		bytesReadPerKSecond += rhs.bytesReadPerKSecond;
 	}
 	void operator -= ( const StorageMetrics& rhs ) {
 		bytes -= rhs.bytes;
 		bytesPerKSecond -= rhs.bytesPerKSecond;
 		iosPerKSecond -= rhs.iosPerKSecond;
+		bytesReadPerKSecond -= rhs.bytesReadPerKSecond;
 	}
 	template <class F>
 	void operator *= ( F f ) {
 		bytes *= f;
 		bytesPerKSecond *= f;
 		iosPerKSecond *= f;
+		bytesReadPerKSecond *= f;
 	}
-	bool allZero() const { return !bytes && !bytesPerKSecond && !iosPerKSecond; }
+	bool allZero() const { return !bytes && !bytesPerKSecond && !iosPerKSecond && !bytesReadPerKSecond; }
 
 	template <class Ar>
 	void serialize( Ar& ar ) {
-		ar & bytes & bytesPerKSecond & iosPerKSecond;
+		ar & bytes & bytesPerKSecond & iosPerKSecond & bytesReadPerKSecond;
 	}
 
 	void negate() { operator*=(-1.0); }
@@ -253,11 +675,11 @@ struct StorageMetrics {
 	template <class F> StorageMetrics operator * ( F f ) const { StorageMetrics x(*this); x*=f; return x; }
 
 	bool operator == ( StorageMetrics const& rhs ) const {
-		return bytes == rhs.bytes && bytesPerKSecond == rhs.bytesPerKSecond && iosPerKSecond == rhs.iosPerKSecond;
+		return bytes == rhs.bytes && bytesPerKSecond == rhs.bytesPerKSecond && iosPerKSecond == rhs.iosPerKSecond && bytesReadPerKSecond == rhs.bytesReadPerKSecond;
 	}
 
 	std::string toString() const {
-		return format("Bytes: %lld, BPerKSec: %lld, iosPerKSec: %lld", bytes, bytesPerKSecond, iosPerKSecond);
+		return format("Bytes: %lld, BPerKSec: %lld, iosPerKSec: %lld, BReadPerKSec: %lld", bytes, bytesPerKSecond, iosPerKSecond, bytesReadPerKSecond);
 	}
 };
 
@@ -309,6 +731,31 @@ struct SplitMetricsRequest {
 	}
 };
 
+struct SplitRangeReply {
+	Standalone<VectorRef<KeyRef>> splitPoints;
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & splitPoints;
+	}
+};
+
+// Asks for the keys that divide a range into chunks of about chunkSize bytes each, estimated from the byte sample
+struct SplitRangeRequest {
+	Arena arena;
+	KeyRangeRef keys;
+	int64_t chunkSize;
+	ReplyPromise<SplitRangeReply> reply;
+
+	SplitRangeRequest() {}
+	SplitRangeRequest( KeyRangeRef const& keys, int64_t chunkSize ) : keys( arena, keys ), chunkSize( chunkSize ) {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		ar & keys & chunkSize & reply & arena;
+	}
+};
+
 struct GetPhysicalMetricsReply {
 	StorageMetrics load;
 	StorageMetrics free;
@@ -349,6 +349,7 @@ const KeyRef configKeysPrefix = configKeys.begin;
 const KeyRangeRef excludedServersKeys( LiteralStringRef("\xff/conf/excluded/"), LiteralStringRef("\xff/conf/excluded0") );
 const KeyRef excludedServersPrefix = excludedServersKeys.begin;
 const KeyRef excludedServersVersionKey = LiteralStringRef("\xff/conf/excluded");
+const ValueRef excludedServersDrainValue = LiteralStringRef("drain");
 const AddressExclusion decodeExcludedServersKey( KeyRef const& key ) {
 	ASSERT( key.startsWith( excludedServersPrefix ) );
 	// Returns an invalid NetworkAddress if given an invalid key (within the prefix)
@@ -423,6 +424,44 @@ const KeyRangeRef timeKeeperPrefixRange(LiteralStringRef("\xff\x02/timeKeeper/ma
 const KeyRef timeKeeperVersionKey = LiteralStringRef("\xff\x02/timeKeeper/version");
 const KeyRef timeKeeperDisableKey = LiteralStringRef("\xff\x02/timeKeeper/disable");
 
+// Chunked large values
+const KeyRangeRef largeValueChunkKeys(LiteralStringRef("\xff\x02/largeValue/"), LiteralStringRef("\xff\x02/largeValue0"));
+const StringRef largeValueHeaderMagic = LiteralStringRef("\xff\x02LV\x01");
+
+static Key largeValueChunkPrefix( KeyRef const& key ) {
+	BinaryWriter wr(Unversioned());
+	wr.serializeBytes( largeValueChunkKeys.begin );
+	wr << bigEndian32( key.size() );
+	wr.serializeBytes( key );
+	return wr.toStringRef();
+}
+
+Key largeValueChunkKey( KeyRef const& key, int chunk ) {
+	BinaryWriter wr(Unversioned());
+	wr.serializeBytes( largeValueChunkPrefix(key) );
+	wr << bigEndian32( chunk );
+	return wr.toStringRef();
+}
+
+KeyRange largeValueChunkRange( KeyRef const& key ) {
+	return prefixRange( largeValueChunkPrefix(key) );
+}
+
+Value largeValueHeaderValue( int64_t size, int chunkBytes ) {
+	BinaryWriter wr(Unversioned());
+	wr.serializeBytes( largeValueHeaderMagic );
+	wr << size << chunkBytes;
+	return wr.toStringRef();
+}
+
+bool decodeLargeValueHeader( ValueRef const& header, int64_t* size, int* chunkBytes ) {
+	if( header.size() != largeValueHeaderMagic.size() + sizeof(int64_t) + sizeof(int) || !header.startsWith( largeValueHeaderMagic ) )
+		return false;
+	BinaryReader rd( header.substr( largeValueHeaderMagic.size() ), Unversioned() );
+	rd >> *size >> *chunkBytes;
+	return *size >= 0 && *chunkBytes > 0;
+}
+
 // Backup Log Mutation constant variables
 const KeyRef backupEnabledKey = LiteralStringRef("\xff/backupEnabled");
 const KeyRangeRef backupLogKeys(LiteralStringRef("\xff\x02/blog/"), LiteralStringRef("\xff\x02/blog0"));
@@ -567,3 +606,40 @@ std::pair<MetricNameRef, KeyRef> decodeMetricConfKey( KeyRef const& prefix, KeyR
 const KeyRef maxUIDKey = LiteralStringRef("\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff");
 
 const KeyRef databaseLockedKey = LiteralStringRef("\xff/dbLocked");
+
+const KeyRangeRef clientCacheRangesRange(LiteralStringRef("\xff/clientCacheRanges/"), LiteralStringRef("\xff/clientCacheRanges0"));
+
+Key clientCacheRangeKeyFor( KeyRef const& begin ) {
+	return begin.withPrefix( clientCacheRangesRange.begin );
+}
+
+KeyRef decodeClientCacheRangeKey( KeyRef const& key ) {
+	return key.removePrefix( clientCacheRangesRange.begin );
+}
+
+const KeyRangeRef clientCacheVersionRange(LiteralStringRef("\xff\x02/clientCacheVersion/"), LiteralStringRef("\xff\x02/clientCacheVersion0"));
+
+Key clientCacheVersionKeyFor( KeyRef const& begin ) {
+	return begin.withPrefix( clientCacheVersionRange.begin );
+}
+
+KeyRef decodeClientCacheVersionKey( KeyRef const& key ) {
+	return key.removePrefix( clientCacheVersionRange.begin );
+}
+
+Value clientCacheVersionValue( Version version, KeyRef const& end ) {
+	BinaryWriter wr(Unversioned());
+	wr << bigEndian64(version);
+	wr.serializeBytes(end);
+	return wr.toStringRef();
+}
+
+bool decodeClientCacheVersionValue( ValueRef const& value, Version* version, KeyRef* end ) {
+	if( value.size() < sizeof(Version) )
+		return false;
+	Version v;
+	memcpy( &v, value.begin(), sizeof(Version) );
+	*version = bigEndian64(v);
+	*end = value.substr( sizeof(Version) );
+	return true;
+}
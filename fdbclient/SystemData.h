@@ -112,13 +112,14 @@ extern const KeyRangeRef configKeys;
 extern const KeyRef configKeysPrefix;
 
 //   "\xff/conf/excluded/1.2.3.4" := ""
-//   "\xff/conf/excluded/1.2.3.4:4000" := ""
+//   "\xff/conf/excluded/1.2.3.4:4000" := "" | "drain"
 //   These are inside configKeysPrefix since they represent a form of configuration and they are convenient
 //   to track in the same way by the tlog and recovery process, but they are ignored by the DatabaseConfiguration
 //   class.
 extern const KeyRef excludedServersPrefix;
 extern const KeyRangeRef excludedServersKeys;
 extern const KeyRef excludedServersVersionKey;  // The value of this key shall be changed by any transaction that modifies the excluded servers list
+extern const ValueRef excludedServersDrainValue;  // The value of an exclusion whose data should be moved off as fast as possible
 const AddressExclusion decodeExcludedServersKey( KeyRef const& key ); // where key.startsWith(excludedServersPrefix)
 std::string encodeExcludedServersKey( AddressExclusion const& );
 
@@ -204,6 +205,16 @@ extern const KeyRangeRef timeKeeperPrefixRange;
 extern const KeyRef timeKeeperVersionKey;
 extern const KeyRef timeKeeperDisableKey;
 
+// Values written with ReadYourWritesTransaction::setLargeValue().  The key itself holds a header with the size of the value,
+// and the value is split across chunk keys:
+// \xff\x02/largeValue/[4-byte big endian key length][key][4-byte big endian chunk index] := chunk
+extern const KeyRangeRef largeValueChunkKeys;
+Key largeValueChunkKey( KeyRef const& key, int chunk );
+KeyRange largeValueChunkRange( KeyRef const& key );  // Every chunk of the value at key
+Value largeValueHeaderValue( int64_t size, int chunkBytes );
+// Returns false if header is not a large value header (in which case the key holds an ordinary value)
+bool decodeLargeValueHeader( ValueRef const& header, int64_t* size, int* chunkBytes );
+
 // Layer status metadata prefix
 extern const KeyRangeRef layerStatusMetaPrefixRange;
 
@@ -246,4 +257,19 @@ extern const KeyRef maxUIDKey;
 
 extern const KeyRef databaseLockedKey;
 
+// Ranges whose values clients with FDBDatabaseOptions::CLIENT_READ_CACHE_SIZE may cache
+// \xff/clientCacheRanges/[begin key] := [end key]
+extern const KeyRangeRef clientCacheRangesRange;
+Key clientCacheRangeKeyFor( KeyRef const& begin );
+KeyRef decodeClientCacheRangeKey( KeyRef const& key );
+
+// Kept by the proxies for each range in clientCacheRangesRange: the version of the last commit that wrote in (or registered) the range
+// \xff\x02/clientCacheVersion/[begin key] := [8-byte big endian version][end key]
+extern const KeyRangeRef clientCacheVersionRange;
+Key clientCacheVersionKeyFor( KeyRef const& begin );
+KeyRef decodeClientCacheVersionKey( KeyRef const& key );
+Value clientCacheVersionValue( Version version, KeyRef const& end );
+// Returns false if value is not one written by clientCacheVersionValue()
+bool decodeClientCacheVersionValue( ValueRef const& value, Version* version, KeyRef* end );
+
 #endif
@@ -130,7 +130,7 @@ unsigned int Task::getPriority() const {
 class TaskBucketImpl {
 public:
 	ACTOR static Future<Optional<Key>> getTaskKey(Reference<ReadYourWritesTransaction> tr, Reference<TaskBucket> taskBucket, int priority = 0) {
-		Standalone<StringRef> uid = StringRef(g_random->randomUniqueID().toString());
+		state Standalone<StringRef> uid = StringRef(g_random->randomUniqueID().toString());
 
 		// Get keyspace for the specified priority level
 		state Subspace space = taskBucket->getAvailableSpace(priority);
@@ -140,15 +140,18 @@ public:
 		if(space.contains(k))
 			return Optional<Key>(k);
 
-		// Get a task key that is <= the maximum possible UID, if successful return it.
-		Key k = wait(tr->getKey(lastLessOrEqual(space.pack(maxUIDKey)), true));
+		// Otherwise take the first task key after it.  Wrapping around to the last key instead would make the last task
+		// twice as likely to be picked as its neighbors, and so more likely to be picked by more than one agent at a time.
+		Key k = wait(tr->getKey(firstGreaterOrEqual(space.pack(uid)), true));
 		if(space.contains(k))
 			return Optional<Key>(k);
 
 		return Optional<Key>();
 	}
 	
-	ACTOR static Future<Reference<Task>> getOne(Reference<ReadYourWritesTransaction> tr, Reference<TaskBucket> taskBucket) {
+	// Claims up to maxTasks tasks, all of the highest priority that has any available, by probing for task keys at random
+	// points.  Claiming several in one transaction keeps an agent's concurrent claims from conflicting with each other.
+	ACTOR static Future<std::vector<Reference<Task>>> getTasks(Reference<ReadYourWritesTransaction> tr, Reference<TaskBucket> taskBucket, int maxTasks) {
 		if (taskBucket->priority_batch)
 			tr->setOption( FDBTransactionOptions::PRIORITY_BATCH );
 
@@ -171,6 +174,7 @@ public:
 		// Task key and subspace it is located in.
 		state Optional<Key> taskKey;
 		state Subspace availableSpace;
+		state int taskPriority;
 
 		// In priority order from highest to lowest, wait for fetch to finish and if it found a task then cancel the rest.
 		for(pri = CLIENT_KNOBS->TASKBUCKET_MAX_PRIORITY; pri >= 0; --pri) {
@@ -182,6 +186,7 @@ public:
 				if(key.present()) {
 					taskKey = key;
 					availableSpace = taskBucket->getAvailableSpace(pri);
+					taskPriority = pri;
 				}
 			}
 		}
@@ -192,37 +197,62 @@ public:
 			// If there were timeouts, try to get a task since there should now be one in one of the available spaces.
 			if(anyTimeouts) {
 				TEST(true); // Try to get one task from timeouts subspace
-				Reference<Task> task = wait(getOne(tr, taskBucket));
-				return task;
+				std::vector<Reference<Task>> tasks = wait(getTasks(tr, taskBucket, maxTasks));
+				return tasks;
 			}
-			return Reference<Task>();
+			return std::vector<Reference<Task>>();
 		}
 
-		// Now we know the task key is present and we have the available space for the task's priority
-		state Tuple t = availableSpace.unpack(taskKey.get());
-		state Key taskUID = t.getString(0);
-		state Subspace taskAvailableSpace = availableSpace.get(taskUID);
-
-		state Reference<Task> task(new Task());
-		task->key = taskUID;
+		// Now we know a task key is present and we have the available space for its priority.  Look for more at the same priority.
+		state std::set<Key> taskUIDs;
+		taskUIDs.insert(availableSpace.unpack(taskKey.get()).getString(0));
+		if(maxTasks > 1) {
+			state std::vector<Future<Optional<Key>>> moreKeys;
+			for(int i = 1; i < maxTasks; ++i)
+				moreKeys.push_back(getTaskKey(tr, taskBucket, taskPriority));
+			Void _ = wait(waitForAll(moreKeys));
+			for(auto &k : moreKeys) {
+				if(k.get().present())
+					taskUIDs.insert(availableSpace.unpack(k.get().get()).getString(0));
+			}
+			TEST(taskUIDs.size() > 1); // Claimed several tasks in one transaction
+		}
 
-		state Standalone<RangeResultRef> values = wait(tr->getRange(taskAvailableSpace.range(), CLIENT_KNOBS->TOO_MANY));
+		state std::vector<Future<Standalone<RangeResultRef>>> taskValues;
+		for(auto &uid : taskUIDs)
+			taskValues.push_back(tr->getRange(availableSpace.get(uid).range(), CLIENT_KNOBS->TOO_MANY));
+		Void _ = wait(waitForAll(taskValues));
 		Version version = wait(tr->getReadVersion());
-		task->timeoutVersion = version + (uint64_t)(taskBucket->timeout * (CLIENT_KNOBS->TASKBUCKET_TIMEOUT_JITTER_OFFSET + CLIENT_KNOBS->TASKBUCKET_TIMEOUT_JITTER_RANGE * g_random->random01()));
 
-		Subspace timeoutSpace = taskBucket->timeouts.get(task->timeoutVersion).get(taskUID);
+		std::vector<Reference<Task>> tasks;
+		int i = 0;
+		for(auto &uid : taskUIDs) {
+			Subspace taskAvailableSpace = availableSpace.get(uid);
+			Reference<Task> task(new Task());
+			task->key = uid;
+			task->timeoutVersion = version + (uint64_t)(taskBucket->timeout * (CLIENT_KNOBS->TASKBUCKET_TIMEOUT_JITTER_OFFSET + CLIENT_KNOBS->TASKBUCKET_TIMEOUT_JITTER_RANGE * g_random->random01()));
 
-		for (auto & s : values) {
-			Key param = taskAvailableSpace.unpack(s.key).getString(0);
-			task->params[param] = s.value;
-			tr->set(timeoutSpace.pack(param), s.value);
+			Subspace timeoutSpace = taskBucket->timeouts.get(task->timeoutVersion).get(uid);
+
+			for (auto & s : taskValues[i++].get()) {
+				Key param = taskAvailableSpace.unpack(s.key).getString(0);
+				task->params[param] = s.value;
+				tr->set(timeoutSpace.pack(param), s.value);
+			}
+
+			// Clear task definition in the available keyspace
+			tr->clear(taskAvailableSpace.range());
+			tasks.push_back(task);
 		}
 
-		// Clear task definition in the available keyspace
-		tr->clear(taskAvailableSpace.range());
 		tr->set(taskBucket->active.key(), g_random->randomUniqueID().toString());
 
-		return task;
+		return tasks;
+	}
+
+	ACTOR static Future<Reference<Task>> getOne(Reference<ReadYourWritesTransaction> tr, Reference<TaskBucket> taskBucket) {
+		std::vector<Reference<Task>> tasks = wait(getTasks(tr, taskBucket, 1));
+		return tasks.empty() ? Reference<Task>() : tasks[0];
 	}
 
 	// Verify that the user configured task verification key still has the user specificied value
@@ -420,15 +450,18 @@ public:
 		for(int i = 0; i < tasks.size(); ++i)
 			availableSlots.push_back(i);
 
-		state std::vector<Future<Reference<Task>>> getTasks;
+		state std::vector<Future<std::vector<Reference<Task>>>> getTasks;
 		state unsigned int getBatchSize = 1;
 
 		loop {
 			// Start running tasks while slots are available and we keep finding work to do
 			while(!availableSlots.empty()) {
 				getTasks.clear();
-				for(int i = 0, imax = std::min<unsigned int>(getBatchSize, availableSlots.size()); i < imax; ++i)
-					getTasks.push_back(taskBucket->getOne(cx));
+				for(int remaining = std::min<unsigned int>(getBatchSize, availableSlots.size()); remaining > 0; ) {
+					int claim = std::min(remaining, std::max(1, CLIENT_KNOBS->TASKBUCKET_CLAIM_BATCH_SIZE));
+					getTasks.push_back(taskBucket->getTasks(cx, claim));
+					remaining -= claim;
+				}
 				Void _ = wait(waitForAllReady(getTasks));
 
 				bool done = false;
@@ -437,15 +470,14 @@ public:
 						done = true;
 						continue;
 					}
-					Reference<Task> task = getTasks[i].get();
-					if(task) {
+					if(getTasks[i].get().empty())
+						done = true;
+					for(auto &task : getTasks[i].get()) {
 						// Start the task
 						int slot = availableSlots.back();
 						availableSlots.pop_back();
 						tasks[slot] = taskBucket->doTask(cx, futureBucket, task);
 					}
-					else
-						done = true;
 				}
 
 				if(done) {
@@ -861,6 +893,10 @@ Future<Reference<Task>> TaskBucket::getOne(Reference<ReadYourWritesTransaction>
 	return TaskBucketImpl::getOne(tr, Reference<TaskBucket>::addRef(this));
 }
 
+Future<std::vector<Reference<Task>>> TaskBucket::getTasks(Reference<ReadYourWritesTransaction> tr, int maxTasks) {
+	return TaskBucketImpl::getTasks(tr, Reference<TaskBucket>::addRef(this), maxTasks);
+}
+
 Future<bool> TaskBucket::doOne(Database cx, Reference<FutureBucket> futureBucket) {
 	return TaskBucketImpl::doOne(cx, Reference<TaskBucket>::addRef(this), futureBucket);
 }
@@ -153,6 +153,12 @@ public:
 		return runRYWTransaction(cx, [=](Reference<ReadYourWritesTransaction> tr){ return getOne(tr); });
 	}
 
+	// Claim up to maxTasks tasks in one transaction
+	Future<std::vector<Reference<Task>>> getTasks(Reference<ReadYourWritesTransaction> tr, int maxTasks);
+	Future<std::vector<Reference<Task>>> getTasks(Database cx, int maxTasks) {
+		return runRYWTransaction(cx, [=](Reference<ReadYourWritesTransaction> tr){ return getTasks(tr, maxTasks); });
+	}
+
 	Future<bool> doTask(Database cx, Reference<FutureBucket> futureBucket, Reference<Task> task);
 
 	Future<bool> doOne(Database cx, Reference<FutureBucket> futureBucket);
@@ -103,7 +103,41 @@ void ThreadSafeDatabase::setOption( FDBDatabaseOptions::Option option, Optional<
 
 ThreadSafeDatabase::~ThreadSafeDatabase() {
 	DatabaseContext* db = this->db;
-	onMainThreadVoid( [db](){ db->delref(); }, NULL );
+	std::vector<ReadYourWritesTransaction*> pooled;
+	{
+		ThreadSpinLockHolder holder( poolLock );
+		pooled.swap( transactionPool );
+	}
+	onMainThreadVoid( [db, pooled](){
+		for(auto tr : pooled)
+			tr->delref();
+		db->delref();
+	}, NULL );
+}
+
+ReadYourWritesTransaction* ThreadSafeDatabase::takePooledTransaction() {
+	ThreadSpinLockHolder holder( poolLock );
+	if( transactionPool.empty() )
+		return NULL;
+	ReadYourWritesTransaction* tr = transactionPool.back();
+	transactionPool.pop_back();
+	return tr;
+}
+
+bool ThreadSafeDatabase::recycleTransaction( ReadYourWritesTransaction* tr ) {
+	// Before API version 16, reset() kept a transaction's options
+	if( db->cluster && !db->cluster->apiVersionAtLeast(16) )
+		return false;
+	{
+		ThreadSpinLockHolder holder( poolLock );
+		if( transactionPool.size() >= CLIENT_KNOBS->TRANSACTION_POOL_SIZE )
+			return false;
+	}
+	// Fails anything still outstanding on the transaction, as destroying it would, and releases its arena
+	tr->reset();
+	ThreadSpinLockHolder holder( poolLock );
+	transactionPool.push_back( tr );
+	return true;
 }
 
 ThreadSafeTransaction::ThreadSafeTransaction( ThreadSafeDatabase *cx ) {
@@ -115,15 +149,34 @@ ThreadSafeTransaction::ThreadSafeTransaction( ThreadSafeDatabase *cx ) {
 	// immediately after this call, it will defer the DatabaseContext::delref (and onMainThread preserves the order of
 	// these operations).
 	DatabaseContext* db = cx->db;
-	ReadYourWritesTransaction *tr = this->tr = ReadYourWritesTransaction::allocateOnForeignThread();
+	cx->addref();
+	this->cx = cx;
+
+	// A transaction from the pool was reset when its last user destroyed it
+	ReadYourWritesTransaction *tr = this->tr = cx->takePooledTransaction();
+	if( tr ) {
+		onMainThreadVoid( [tr](){ tr->restartTimeout(); }, NULL );
+		return;
+	}
+
+	tr = this->tr = ReadYourWritesTransaction::allocateOnForeignThread();
 	// No deferred error -- if the construction of the RYW transaction fails, we have no where to put it
 	onMainThreadVoid( [tr,db](){ db->addref(); new (tr) ReadYourWritesTransaction( Database(db) ); }, NULL );
 }
 
 ThreadSafeTransaction::~ThreadSafeTransaction() {
 	ReadYourWritesTransaction *tr = this->tr;
-	if (tr)
-		onMainThreadVoid( [tr](){ tr->delref(); }, NULL );
+	ThreadSafeDatabase *cx = this->cx;
+	if (tr) {
+		// The database is released on the main thread, after tr is returned to its pool
+		onMainThreadVoid( [tr, cx](){
+			if( !cx || !cx->recycleTransaction(tr) )
+				tr->delref();
+			if( cx )
+				cx->delref();
+		}, NULL );
+	} else if (cx)
+		cx->delref();
 }
 
 void ThreadSafeTransaction::cancel() {
@@ -196,6 +249,46 @@ ThreadFuture<Standalone<VectorRef<const char*>>> ThreadSafeTransaction::getAddre
 	} );
 }
 
+ThreadFuture<int64_t> ThreadSafeTransaction::getEstimatedRangeSizeBytes( const KeyRangeRef& keys ) {
+	KeyRange r = keys;
+
+	ReadYourWritesTransaction *tr = this->tr;
+	return onMainThread( [tr, r]() -> Future<int64_t> {
+		tr->checkDeferredError();
+		return tr->getEstimatedRangeSizeBytes(r);
+	} );
+}
+
+ThreadFuture<Standalone<VectorRef<KeyRef>>> ThreadSafeTransaction::getRangeSplitPoints( const KeyRangeRef& keys, int64_t chunkSize ) {
+	KeyRange r = keys;
+
+	ReadYourWritesTransaction *tr = this->tr;
+	return onMainThread( [tr, r, chunkSize]() -> Future<Standalone<VectorRef<KeyRef>>> {
+		tr->checkDeferredError();
+		return tr->getRangeSplitPoints(r, chunkSize);
+	} );
+}
+
+ThreadFuture<Optional<Value>> ThreadSafeTransaction::getLargeValue( const KeyRef& key, int64_t offset, int length, bool snapshot ) {
+	Key k = key;
+
+	ReadYourWritesTransaction *tr = this->tr;
+	return onMainThread( [tr, k, offset, length, snapshot]() -> Future<Optional<Value>> {
+		tr->checkDeferredError();
+		return tr->getLargeValue(k, offset, length, snapshot);
+	} );
+}
+
+ThreadFuture<int64_t> ThreadSafeTransaction::getLargeValueSize( const KeyRef& key, bool snapshot ) {
+	Key k = key;
+
+	ReadYourWritesTransaction *tr = this->tr;
+	return onMainThread( [tr, k, snapshot]() -> Future<int64_t> {
+		tr->checkDeferredError();
+		return tr->getLargeValueSize(k, snapshot);
+	} );
+}
+
 void ThreadSafeTransaction::addReadConflictRange( const KeyRangeRef& keys) {
 	KeyRange r = keys;
 
@@ -251,6 +344,21 @@ void ThreadSafeTransaction::clear( const KeyRef& key ) {
 	onMainThreadVoid( [tr, k](){ tr->clear(k); }, &tr->deferred_error );
 }
 
+void ThreadSafeTransaction::setLargeValue( const KeyRef& key, const ValueRef& value ) {
+	Key k = key;
+	Value v = value;
+
+	ReadYourWritesTransaction *tr = this->tr;
+	onMainThreadVoid( [tr, k, v](){ tr->setLargeValue(k, v); }, &tr->deferred_error );
+}
+
+void ThreadSafeTransaction::clearLargeValue( const KeyRef& key ) {
+	Key k = key;
+
+	ReadYourWritesTransaction *tr = this->tr;
+	onMainThreadVoid( [tr, k](){ tr->clearLargeValue(k); }, &tr->deferred_error );
+}
+
 ThreadFuture< Void > ThreadSafeTransaction::watch( const KeyRef& key ) {
 	Key k = key;
 
@@ -315,12 +423,16 @@ ThreadFuture<Void> ThreadSafeTransaction::onError( Error const& e ) {
 
 void ThreadSafeTransaction::operator=(ThreadSafeTransaction&& r) noexcept(true) {
 	tr = r.tr;
+	cx = r.cx;
 	r.tr = NULL;
+	r.cx = NULL;
 }
 
 ThreadSafeTransaction::ThreadSafeTransaction(ThreadSafeTransaction&& r) noexcept(true) {
 	tr = r.tr;
+	cx = r.cx;
 	r.tr = NULL;
+	r.cx = NULL;
 }
 
 void ThreadSafeTransaction::reset() {
@@ -64,6 +64,12 @@ private:
 	friend class ThreadSafeCluster;
 	friend class ThreadSafeTransaction;
 	DatabaseContext* db;
+
+	// Transactions that were destroyed and then reset on the main thread, to be reused by createTransaction() from any thread
+	ThreadSpinLock poolLock;
+	std::vector<ReadYourWritesTransaction*> transactionPool;
+	ReadYourWritesTransaction* takePooledTransaction();
+	bool recycleTransaction( ReadYourWritesTransaction* tr );  // Only on the main thread; false if the pool is full
 public:  // Internal use only
 	ThreadSafeDatabase( DatabaseContext* db ) : db(db) {}
 	DatabaseContext* unsafeGetPtr() const { return db; }
@@ -91,6 +97,10 @@ public:
 	}
 
 	ThreadFuture<Standalone<VectorRef<const char*>>> getAddressesForKey(const KeyRef& key);
+	ThreadFuture<int64_t> getEstimatedRangeSizeBytes(const KeyRangeRef& keys);
+	ThreadFuture<Standalone<VectorRef<KeyRef>>> getRangeSplitPoints(const KeyRangeRef& keys, int64_t chunkSize);
+	ThreadFuture<Optional<Value>> getLargeValue(const KeyRef& key, int64_t offset, int length, bool snapshot = false);
+	ThreadFuture<int64_t> getLargeValueSize(const KeyRef& key, bool snapshot = false);
 
 	void addReadConflictRange( const KeyRangeRef& keys );
 	void makeSelfConflicting();
@@ -100,6 +110,8 @@ public:
 	void clear( const KeyRef& begin, const KeyRef& end);
 	void clear( const KeyRangeRef& range );
 	void clear( const KeyRef& key );
+	void setLargeValue( const KeyRef& key, const ValueRef& value );
+	void clearLargeValue( const KeyRef& key );
 
 	ThreadFuture< Void > watch( const KeyRef& key );
 
@@ -115,7 +127,7 @@ public:
 	ThreadFuture<Void> onError( Error const& e );
 
 	// These are to permit use as state variables in actors:
-	ThreadSafeTransaction() : tr(NULL) {}
+	ThreadSafeTransaction() : tr(NULL), cx(NULL) {}
 	void operator=(ThreadSafeTransaction&& r) noexcept(true);
 	ThreadSafeTransaction(ThreadSafeTransaction&& r) noexcept(true);
 
@@ -126,6 +138,7 @@ public:
 
 private:
 	ReadYourWritesTransaction *tr;
+	ThreadSafeDatabase *cx;  // Where tr is returned when this is destroyed
 };
 
 class ThreadSafeApi : public IClientApi, ThreadSafeReferenceCounted<ThreadSafeApi> {
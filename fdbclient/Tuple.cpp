@@ -19,6 +19,7 @@
  */
 
 #include "Tuple.h"
+#include "flow/UnitTest.h"
 
 static size_t find_string_terminator(const StringRef data, size_t offset) {
 	size_t i = offset;
@@ -68,20 +69,30 @@ Tuple& Tuple::append(Tuple const& tuple) {
 Tuple& Tuple::append(StringRef const& str, bool utf8) {
 	offsets.push_back(data.size());
 
-	const uint8_t utfChar = uint8_t(utf8 ? '\x02' : '\x01');
-	data.append(data.arena(), &utfChar, 1);
+	// Size the encoding up front so that it is written with at most one reallocation
+	int nulls = 0;
+	for(const uint8_t *p = str.begin(); p < str.end() && (p = (const uint8_t*)memchr(p, 0, str.end() - p)) != NULL; ++p)
+		++nulls;
+	data.reserve(data.arena(), data.size() + str.size() + nulls + 2);
 
-	size_t lastPos = 0;
-	for(size_t pos = 0; pos < str.size(); ++pos) {
-		if(str[pos] == '\x00') {
-			data.append(data.arena(), str.begin() + lastPos, pos - lastPos);
-			data.push_back(data.arena(), (uint8_t)'\x00');
-			data.push_back(data.arena(), (uint8_t)'\xff');
-			lastPos = pos + 1;
+	data.push_back(data.arena(), (uint8_t)(utf8 ? '\x02' : '\x01'));
+
+	if(nulls == 0) {
+		data.append(data.arena(), str.begin(), str.size());
+	}
+	else {
+		size_t lastPos = 0;
+		for(size_t pos = 0; pos < str.size(); ++pos) {
+			if(str[pos] == '\x00') {
+				data.append(data.arena(), str.begin() + lastPos, pos - lastPos);
+				data.push_back(data.arena(), (uint8_t)'\x00');
+				data.push_back(data.arena(), (uint8_t)'\xff');
+				lastPos = pos + 1;
+			}
 		}
+		data.append(data.arena(), str.begin() + lastPos, str.size() - lastPos);
 	}
 
-	data.append(data.arena(), str.begin() + lastPos, str.size() - lastPos);
 	data.push_back(data.arena(), (uint8_t)'\x00');
 
 	return *this;
@@ -160,26 +171,34 @@ Standalone<StringRef> Tuple::getString(size_t index) const {
 		e = data.size();
 	}
 
-	Standalone<StringRef> result;
-	VectorRef<uint8_t> staging;
+	// The element ends in a terminating null and each escaped null inside it is two bytes, so count them to size the
+	// result exactly and copy it in one allocation.
+	int nulls = 0;
+	for(const uint8_t *p = data.begin() + b; p < data.begin() + e && (p = (const uint8_t*)memchr(p, 0, data.begin() + e - p)) != NULL; p += 2)
+		++nulls;
+
+	Standalone<StringRef> result = makeString(e - b - nulls);
+	uint8_t *out = mutateString(result);
 
 	for (size_t i = b; i < e; ++i) {
 		if(data[i] == '\x00') {
-			staging.append(result.arena(), data.begin() + b, i - b);
+			memcpy(out, data.begin() + b, i - b);
+			out += i - b;
 			++i;
 			b = i + 1;
 
 			if(i < e) {
-				staging.push_back(result.arena(), '\x00');
+				*out++ = '\x00';
 			}
 		}
 	}
 
 	if(b < e) {
-		staging.append(result.arena(), data.begin() + b, e - b);
+		memcpy(out, data.begin() + b, e - b);
+		out += e - b;
 	}
 
-	result.StringRef::operator=(StringRef(staging.begin(), staging.size()));
+	ASSERT(out == result.end());
 	return result;
 }
 
@@ -244,3 +263,44 @@ Tuple Tuple::subTuple(size_t start, size_t end) const {
 	size_t endPos = end < offsets.size() ? offsets[end] : data.size();
 	return Tuple(StringRef(data.begin() + offsets[start], endPos - offsets[start]));
 }
+
+TEST_CASE("fdbclient/Tuple/encodeDecode") {
+	// Typical index keys: a few short strings, some with embedded nulls, and an integer or two
+	std::vector<std::string> strings;
+	for(int i = 0; i < 100; i++) {
+		std::string s = g_random->randomAlphaNumeric(g_random->randomInt(0, 20));
+		if(g_random->random01() < 0.3)
+			s.insert(g_random->randomInt(0, s.size() + 1), 1, '\x00');
+		strings.push_back(s);
+	}
+
+	for(int i = 0; i < 100; i++) {
+		std::string a = g_random->randomChoice(strings), b = g_random->randomChoice(strings);
+		int64_t n = g_random->randomInt64(std::numeric_limits<int64_t>::min() + 1, std::numeric_limits<int64_t>::max());
+		Tuple t = Tuple().append(StringRef(a)).append(n).append(StringRef(b), true).appendNull();
+		Tuple u = Tuple::unpack(t.pack());
+		ASSERT(u.size() == 4);
+		ASSERT(u.getString(0) == StringRef(a) && u.getType(0) == Tuple::ElementType::BYTES);
+		ASSERT(u.getInt(1) == n);
+		ASSERT(u.getString(2) == StringRef(b) && u.getType(2) == Tuple::ElementType::UTF8);
+		ASSERT(u.getType(3) == Tuple::ElementType::NULL_TYPE);
+		ASSERT(u.pack() == t.pack());
+	}
+
+	const int iterations = 100000;
+	double start = timer();
+	int64_t bytes = 0;
+	for(int i = 0; i < iterations; i++) {
+		Tuple t = Tuple().append(StringRef(strings[i % 100])).append(StringRef(strings[(i + 1) % 100])).append((int64_t)i).append(StringRef(strings[(i + 7) % 100]));
+		bytes += t.pack().size();
+	}
+	double encoded = timer();
+	for(int i = 0; i < iterations; i++) {
+		Tuple t = Tuple::unpack(Tuple().append(StringRef(strings[i % 100])).append((int64_t)i).append(StringRef(strings[(i + 3) % 100])).pack());
+		bytes += t.getString(0).size() + t.getString(2).size() + t.getInt(1);
+	}
+	double decoded = timer();
+	printf("Tuple encode: %0.1f Ktuples/sec, encode+decode: %0.1f Ktuples/sec (%lld)\n", iterations / 1000.0 / (encoded - start), iterations / 1000.0 / (decoded - encoded), (long long)bytes);
+
+	return Void();
+}
@@ -39,13 +39,46 @@ namespace PTreeImpl {
 
 	#pragma warning(disable: 4800)
 
+	// Per thread free lists of PTree nodes of a single size.  Nodes are carved out of 4KB blocks in slots of exactly Size bytes, rather than
+	// being rounded up to the next power of two as FastAllocated would; a storage server's nodes are 80 bytes, so this saves a third of the
+	// memory its MVCC window uses.  As with FastAllocator, freed memory is reused but never returned.
+	template <int Size>
+	struct PTreeAllocator {
+		static void* allocate() {
+			if (!freeList) {
+				uint8_t* block = (uint8_t*)FastAllocator<4096>::allocate();
+				for (int i = 4096/Size - 1; i >= 0; i--)
+					release( block + i*Size );
+				memoryUsed += 4096;
+			}
+			void* p = freeList;
+			freeList = *(void**)p;
+			return p;
+		}
+		static void release(void* p) {
+			*(void**)p = freeList;
+			freeList = p;
+		}
+		static int64_t getMemoryUsed() { return memoryUsed; }  // By this thread
+
+	private:
+		static_assert( Size % 16 == 0 && Size <= 1024, "PTree node size" );
+		static thread_local void* freeList;
+		static thread_local int64_t memoryUsed;
+	};
+
+	template <int Size> thread_local void* PTreeAllocator<Size>::freeList = nullptr;
+	template <int Size> thread_local int64_t PTreeAllocator<Size>::memoryUsed = 0;
+
 	template<class T>
-	struct PTree : public ReferenceCounted<PTree<T>>, FastAllocated<PTree<T>>, NonCopyable {
-		uint32_t priority;
+	struct PTree : public ReferenceCounted<PTree<T>>, NonCopyable {
+		// Together with the reference count this header is 40 bytes, so the fields a search reads (the child pointers, the update flags and
+		// lastUpdateVersion) share a cache line with at least the start of data
+		uint32_t priority : 30;
+		uint32_t updated : 1;
+		uint32_t replacedPointer : 1;
 		Reference<PTree> pointer[3];
 		Version lastUpdateVersion;
-		bool updated;
-		bool replacedPointer;
 		T data;
 
 		Reference<PTree> child(bool which, Version at) const {
@@ -57,12 +90,22 @@ namespace PTreeImpl {
 		Reference<PTree> left(Version at) const { return child(false, at); }
 		Reference<PTree> right(Version at) const { return child(true, at); }
 
-		PTree(const T& data, Version ver) : data(data), lastUpdateVersion(ver), updated(false) {
-			priority = g_random->randomUInt32();
+		PTree(const T& data, Version ver) : updated(false), replacedPointer(false), lastUpdateVersion(ver), data(data) {
+			priority = g_random->randomUInt32() >> 2;
 		}
-		PTree( uint32_t pri, T const& data, Reference<PTree> const& left, Reference<PTree> const& right, Version ver ) : priority(pri), data(data), lastUpdateVersion(ver), updated(false) {
+		PTree( uint32_t pri, T const& data, Reference<PTree> const& left, Reference<PTree> const& right, Version ver ) : priority(pri), updated(false), replacedPointer(false), lastUpdateVersion(ver), data(data) {
 			pointer[0] = left; pointer[1] = right;
 		}
+
+		static const int allocatedSize = (sizeof(T) + 40 + 15) / 16 * 16;
+		static void* operator new(size_t s) {
+			static_assert( sizeof(PTree) <= allocatedSize, "PTree header is not 40 bytes" );
+			return PTreeAllocator<allocatedSize>::allocate();
+		}
+		static void operator delete(void* p) {
+			PTreeAllocator<allocatedSize>::release(p);
+		}
+		static int64_t getMemoryUsed() { return PTreeAllocator<allocatedSize>::getMemoryUsed(); }
 	private:
 		PTree(PTree const&);
 	};
@@ -221,6 +264,26 @@ namespace PTreeImpl {
 		}
 	}
 
+	// Modifies p to point to a new PTree containing exactly the items of sorted, which must be strictly increasing.
+	// This takes linear time (a treap is the Cartesian tree of its items' priorities) rather than the O(n log n) of n inserts
+	template<class T>
+	void buildFromSorted(Reference<PTree<T>>& p, Version at, std::vector<T> const& sorted) {
+		std::vector<Reference<PTree<T>>> rightSpine;
+		for(auto const& x : sorted) {
+			Reference<PTree<T>> n( new PTree<T>(x, at) );
+			Reference<PTree<T>> last;
+			while (rightSpine.size() && rightSpine.back()->priority < n->priority) {
+				last = std::move(rightSpine.back());
+				rightSpine.pop_back();
+			}
+			n->pointer[0] = std::move(last);
+			if (rightSpine.size())
+				rightSpine.back()->pointer[1] = n;
+			rightSpine.push_back(std::move(n));
+		}
+		p = rightSpine.size() ? rightSpine[0] : Reference<PTree<T>>();
+	}
+
 	template<class T>
 	Reference<PTree<T>> firstNode(const Reference<PTree<T>>& p, Version at) {
 		if (!p) ASSERT(false);
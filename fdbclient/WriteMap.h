@@ -122,18 +122,25 @@ private:
 	typedef Reference<PTreeT> Tree;
 
 public:
-	explicit WriteMap(Arena* arena) : arena(arena), ver(-1), scratch_iterator(this), writeMapEmpty(true)  {
+	explicit WriteMap(Arena* arena) : arena(arena), ver(-1), treeInitial(true), scratch_iterator(this), writeMapEmpty(true)  {
 		PTreeImpl::insert( writes, ver, WriteMapEntry( allKeys.begin, OperationStack(), false, false, false, false, false ) );
 		PTreeImpl::insert( writes, ver, WriteMapEntry( allKeys.end, OperationStack(), false, false, false, false, false ) );
 		PTreeImpl::insert( writes, ver, WriteMapEntry( afterAllKeys, OperationStack(), false, false, false, false, false ) );
 	}
 
-	WriteMap(WriteMap&& r) noexcept(true) : writeMapEmpty(r.writeMapEmpty), writes(std::move(r.writes)), ver(r.ver), scratch_iterator(std::move(r.scratch_iterator)), arena(r.arena) {}
-	WriteMap& operator=(WriteMap&& r) noexcept(true) { writeMapEmpty = r.writeMapEmpty; writes = std::move(r.writes); ver = r.ver; scratch_iterator = std::move(r.scratch_iterator); arena = r.arena; return *this; }
+	WriteMap(WriteMap&& r) noexcept(true) : writeMapEmpty(r.writeMapEmpty), writes(std::move(r.writes)), ver(r.ver), pendingSets(std::move(r.pendingSets)), treeInitial(r.treeInitial), scratch_iterator(std::move(r.scratch_iterator)), arena(r.arena) {}
+	WriteMap& operator=(WriteMap&& r) noexcept(true) { writeMapEmpty = r.writeMapEmpty; writes = std::move(r.writes); ver = r.ver; pendingSets = std::move(r.pendingSets); treeInitial = r.treeInitial; scratch_iterator = std::move(r.scratch_iterator); arena = r.arena; return *this; }
 
 	//a write with addConflict false on top of an existing write with a conflict range will not remove the conflict
 	void mutate( KeyRef key, MutationRef::Type operation, ValueRef param, bool addConflict ) {
 		writeMapEmpty = false;
+		if( treeInitial && operation == MutationRef::SetValue ) {
+			pendingSets.push_back( PendingSet( key, param, addConflict ) );
+			return;
+		}
+		flushPendingSets();
+		treeInitial = false;
+
 		auto& it = scratch_iterator;
 		it.reset(writes, ver);
 		it.skip( key );
@@ -181,6 +188,8 @@ public:
 
 	void clear( KeyRangeRef keys, bool addConflict ) {
 		writeMapEmpty = false;
+		flushPendingSets();
+		treeInitial = false;
 		if( !addConflict ) {
 			clearNoConflict( keys );
 			return;
@@ -216,6 +225,8 @@ public:
 	}
 
 	void addUnmodifiedAndUnreadableRange( KeyRangeRef keys ) {
+		flushPendingSets();
+		treeInitial = false;
 		auto& it = scratch_iterator;
 		it.reset(writes, ver);
 		it.skip( keys.begin );
@@ -247,6 +258,8 @@ public:
 
 	void addConflictRange( KeyRangeRef keys ) {
 		writeMapEmpty = false;
+		flushPendingSets();
+		treeInitial = false;
 		auto& it = scratch_iterator;
 		it.reset(writes, ver);
 		it.skip( keys.begin );
@@ -301,7 +314,7 @@ public:
 		// Modified keys may be dependent (need to be collapsed with a snapshot value) or independent (value is known regardless of the snapshot value)
 		// Every key will belong to exactly one segment.  The first segment begins at "" and the last segment ends at \xff\xff.
 
-		explicit iterator( WriteMap* map ) : tree(map->writes), at( map->ver ), offset(false) { ++map->ver; }
+		explicit iterator( WriteMap* map ) : tree(map->flushedWrites()), at( map->ver ), offset(false) { ++map->ver; }
 			// Creates an iterator which is conceptually before the beginning of map (you may essentially only call skip() or ++ on it)
 			// This iterator also represents a snapshot (will be unaffected by future writes)
 
@@ -536,8 +549,57 @@ private:
 	bool writeMapEmpty;
 	Tree writes;
 	Version ver;  // an internal version number for the tree - no connection to database versions!  Currently this is incremented after reads, so that consecutive writes have the same version and those separated by reads have different versions.
+
+	// Until anything but a set is written, writes holds only its three boundary entries and sets are just appended to pendingSets.
+	// They are sorted and built into a tree in one pass when the map is next read or otherwise modified, which is much cheaper than
+	// inserting them one at a time for the common transaction that does thousands of blind sets and then commits.
+	struct PendingSet {
+		KeyRef key;
+		ValueRef value;
+		bool addConflict;
+		PendingSet( KeyRef key, ValueRef value, bool addConflict ) : key(key), value(value), addConflict(addConflict) {}
+	};
+	std::vector<PendingSet> pendingSets;
+	bool treeInitial;  // writes has not been modified since construction, although pendingSets may not be empty
+
 	iterator scratch_iterator;   // Avoid unnecessary memory allocation in write operations
 
+	Tree const& flushedWrites() {
+		flushPendingSets();
+		return writes;
+	}
+
+	void flushPendingSets() {
+		if( pendingSets.empty() )
+			return;
+
+		// Later sets of a key replace earlier ones, but a conflict added by any of them is kept (as in mutate())
+		std::stable_sort( pendingSets.begin(), pendingSets.end(), [](PendingSet const& a, PendingSet const& b) { return a.key < b.key; } );
+
+		KeyRef boundaries[] = { allKeys.begin, allKeys.end, afterAllKeys };
+		int nextBoundary = 0;
+		std::vector<WriteMapEntry> entries;
+		entries.reserve( pendingSets.size() + 3 );
+		for( int i = 0; i < pendingSets.size(); i++ ) {
+			bool is_conflict = pendingSets[i].addConflict;
+			while( i+1 < pendingSets.size() && pendingSets[i+1].key == pendingSets[i].key )
+				is_conflict = pendingSets[++i].addConflict || is_conflict;
+			PendingSet const& s = pendingSets[i];
+
+			for(; nextBoundary < 3 && boundaries[nextBoundary] <= s.key; nextBoundary++) {
+				if( boundaries[nextBoundary] != s.key )
+					entries.push_back( WriteMapEntry( boundaries[nextBoundary], OperationStack(), false, false, false, false, false ) );
+			}
+			entries.push_back( WriteMapEntry( s.key, OperationStack( RYWMutation( s.value, MutationRef::SetValue ) ), false, false, is_conflict, false, false ) );
+		}
+		for(; nextBoundary < 3; nextBoundary++)
+			entries.push_back( WriteMapEntry( boundaries[nextBoundary], OperationStack(), false, false, false, false, false ) );
+
+		pendingSets.clear();
+		PTreeImpl::buildFromSorted( writes, ver, entries );
+		treeInitial = false;
+	}
+
 	void dump() {
 		iterator it( this );
 		it.skip(allKeys.begin);
@@ -33,6 +33,8 @@
 #include <sys/inotify.h>
 #include <time.h>
 #include <linux/limits.h>
+#include <sched.h>
+#include <sys/syscall.h>
 #endif
 
 #ifdef __APPLE__
@@ -46,7 +48,9 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <map>
 #include <vector>
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <iterator>
@@ -78,6 +82,13 @@ typedef int fdb_fd_set;
 
 #define CANONICAL_PATH_SEPARATOR '/'
 
+#ifdef __linux__
+#define MAX_NUMA_NODES 256
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+#endif
+
 void monitor_fd( fdb_fd_set list, int fd, int* maxfd, void* cmd ) {
 #ifdef __linux__
 	FD_SET( fd, list );
@@ -187,6 +198,165 @@ const char* get_value_multi(const CSimpleIni& ini, const char* key, ...) {
 	return ret;
 }
 
+#ifdef __linux__
+/* Parses a CPU list in the kernel's format, such as "0-7,16-23" */
+bool parse_cpu_list(const char* s, std::vector<int>& cpus) {
+	cpus.clear();
+	while (*s && *s != '\n') {
+		char* end;
+		long first = strtol(s, &end, 10);
+		if (end == s || first < 0)
+			return false;
+		long last = first;
+		if (*end == '-') {
+			s = end + 1;
+			last = strtol(s, &end, 10);
+			if (end == s || last < first)
+				return false;
+		}
+		if (last >= CPU_SETSIZE)
+			return false;
+		for (long c = first; c <= last; c++)
+			cpus.push_back(c);
+		s = end;
+		if (*s == ',')
+			s++;
+		else if (*s && *s != '\n')
+			return false;
+	}
+	std::sort(cpus.begin(), cpus.end());
+	cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+	return !cpus.empty();
+}
+
+std::string format_cpu_list(const std::vector<int>& cpus) {
+	std::string s;
+	for (size_t i = 0; i < cpus.size();) {
+		size_t j = i;
+		while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+			j++;
+		if (!s.empty())
+			s += ",";
+		s += std::to_string(cpus[i]);
+		if (j > i)
+			s += "-" + std::to_string(cpus[j]);
+		i = j + 1;
+	}
+	return s;
+}
+
+/* The CPUs of each NUMA node, indexed by node number (nodes with no CPUs, or that don't exist, are empty).  If the kernel
+   exposes no NUMA topology, every online CPU is in node 0. */
+std::vector<std::vector<int>> get_numa_nodes() {
+	std::vector<std::vector<int>> nodes;
+	for (int n = 0; n < MAX_NUMA_NODES; n++) {
+		char path[64];
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", n);
+		FILE* f = fopen(path, "r");
+		if (!f)
+			continue;
+		char buf[4096];
+		nodes.resize(n + 1);
+		if (fgets(buf, sizeof(buf), f))
+			parse_cpu_list(buf, nodes[n]);
+		fclose(f);
+	}
+	if (nodes.empty()) {
+		nodes.resize(1);
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		for (long c = 0; c < online && c < CPU_SETSIZE; c++)
+			nodes[0].push_back(c);
+	}
+	return nodes;
+}
+
+/* Works out the NUMA node and CPUs of process id in section from its numa_node ("auto" or a node number) and cpu_affinity
+   ("auto" or a CPU list) settings, either of which may be NULL.  Automatic placement goes through the processes of the
+   section in order of id: the processes of each class (with numa_node = auto) are dealt round robin across the nodes that
+   have CPUs, and then the CPUs of each node are divided evenly among the processes on it with cpu_affinity = auto. */
+bool get_placement(const CSimpleIni& ini, const std::string& section, uint64_t id, const char* numa, const char* cpus, int& node, std::vector<int>& affinity) {
+	std::vector<std::vector<int>> nodes = get_numa_nodes();
+	std::vector<int> usable, all;
+	for (int n = 0; n < nodes.size(); n++) {
+		if (!nodes[n].empty())
+			usable.push_back(n);
+		all.insert(all.end(), nodes[n].begin(), nodes[n].end());
+	}
+	std::sort(all.begin(), all.end());
+	if (usable.empty())
+		return false;
+
+	struct Sibling {
+		std::string process_class;
+		const char* numa;
+		const char* cpus;
+		int node;
+	};
+	std::map<uint64_t, Sibling> siblings;
+	CSimpleIniA::TNamesDepend sections;
+	ini.GetAllSections(sections);
+	for (auto i : sections) {
+		const char* dot = strrchr(i.pItem, '.');
+		if (!dot || section.compare(0, std::string::npos, i.pItem, dot - i.pItem) != 0)
+			continue;
+		char* end;
+		uint64_t sid = strtoull(dot + 1, &end, 10);
+		if (*end != '\0' || !(sid > 0))
+			continue;
+		const char* c = get_value_multi(ini, "class", i.pItem, section.c_str(), "general", NULL);
+		Sibling& s = siblings[sid];
+		s.process_class = c ? c : "";
+		s.numa = get_value_multi(ini, "numa_node", i.pItem, section.c_str(), "general", NULL);
+		s.cpus = get_value_multi(ini, "cpu_affinity", i.pItem, section.c_str(), "general", NULL);
+		s.node = -1;
+	}
+	if (!siblings.count(id))
+		return false;
+
+	std::map<std::string, int> class_count;
+	for (auto& s : siblings) {
+		if (!s.second.numa)
+			continue;
+		if (!strcmp(s.second.numa, "auto")) {
+			s.second.node = usable[class_count[s.second.process_class]++ % usable.size()];
+		} else {
+			char* end;
+			long n = strtol(s.second.numa, &end, 10);
+			if (*end == '\0' && end != s.second.numa && n >= 0 && n < nodes.size() && !nodes[n].empty())
+				s.second.node = n;
+			else if (s.first == id) {
+				log_msg(SevError, "Invalid numa_node %s for %s.%llu\n", s.second.numa, section.c_str(), id);
+				return false;
+			}
+		}
+	}
+
+	node = siblings[id].node;
+	const std::vector<int>& pool = node >= 0 ? nodes[node] : all;
+	if (!cpus) {
+		affinity = node >= 0 ? pool : std::vector<int>();
+	} else if (!strcmp(cpus, "auto")) {
+		int index = 0, count = 0;
+		for (auto& s : siblings) {
+			if (s.second.cpus && !strcmp(s.second.cpus, "auto") && s.second.node == node) {
+				if (s.first == id)
+					index = count;
+				count++;
+			}
+		}
+		affinity.clear();
+		if (count > pool.size())
+			affinity.push_back(pool[index % pool.size()]);
+		else
+			affinity.insert(affinity.end(), pool.begin() + index * pool.size() / count, pool.begin() + (index + 1) * pool.size() / count);
+	} else if (!parse_cpu_list(cpus, affinity)) {
+		log_msg(SevError, "Unable to parse cpu_affinity %s for %s.%llu\n", cpus, section.c_str(), id);
+		return false;
+	}
+	return true;
+}
+#endif
+
 double timer() {
 #if defined(__linux__)
 	struct timespec ts;
@@ -283,11 +453,16 @@ public:
 	bool deconfigured;
 	bool kill_on_configuration_change;
 
+	// Where the process is placed: the CPUs it may run on (all of them if empty) and the NUMA node its memory is allocated
+	// from (any if -1)
+	std::vector<int> cpu_affinity;
+	int numa_node;
+
 	// one pair for each of stdout and stderr
 	int pipes[2][2];
 
 	Command() : argv(NULL) { }
-	Command(const CSimpleIni& ini, std::string _section, uint64_t id, fdb_fd_set fds, int* maxfd) : section(_section), argv(NULL), fork_retry_time(-1), quiet(false), delete_envvars(NULL), fds(fds), deconfigured(false), kill_on_configuration_change(true) {
+	Command(const CSimpleIni& ini, std::string _section, uint64_t id, fdb_fd_set fds, int* maxfd) : section(_section), argv(NULL), fork_retry_time(-1), quiet(false), delete_envvars(NULL), fds(fds), deconfigured(false), kill_on_configuration_change(true), numa_node(-1) {
 		char _ssection[strlen(section.c_str()) + 22];
 		snprintf(_ssection, strlen(section.c_str()) + 22, "%s.%llu", section.c_str(), id);
 		ssection = _ssection;
@@ -385,6 +560,19 @@ public:
 			kill_on_configuration_change = false;
 		}
 
+		const char* numa = get_value_multi(ini, "numa_node", ssection.c_str(), section.c_str(), "general", NULL);
+		const char* cpus = get_value_multi(ini, "cpu_affinity", ssection.c_str(), section.c_str(), "general", NULL);
+		if (numa || cpus) {
+#ifdef __linux__
+			if (!get_placement(ini, section, id, numa, cpus, numa_node, cpu_affinity)) {
+				log_msg(SevError, "Unable to place %s\n", ssection.c_str());
+				return;
+			}
+#else
+			log_msg(SevWarn, "Ignoring numa_node and cpu_affinity for %s, which are only supported on Linux\n", ssection.c_str());
+#endif
+		}
+
 		const char* binary = get_value_multi(ini, "command", ssection.c_str(), section.c_str(), "general", NULL);
 		if (!binary) {
 			log_msg(SevError, "Unable to resolve command for %s\n", ssection.c_str());
@@ -398,7 +586,7 @@ public:
 		for (auto i : keys) {
 			if (!strcmp(i.pItem, "command") || !strcmp(i.pItem, "restart_delay") || !strcmp(i.pItem, "initial_restart_delay") || !strcmp(i.pItem, "restart_backoff") ||
 				!strcmp(i.pItem, "restart_delay_reset_interval") || !strcmp(i.pItem, "disable_lifecycle_logging") || !strcmp(i.pItem, "delete_envvars") ||
-				!strcmp(i.pItem, "kill_on_configuration_change"))
+				!strcmp(i.pItem, "kill_on_configuration_change") || !strcmp(i.pItem, "numa_node") || !strcmp(i.pItem, "cpu_affinity"))
 			{
 				continue;
 			}
@@ -454,7 +642,7 @@ public:
 		current_restart_delay = std::max<double>(initial_restart_delay, current_restart_delay);
 	}
 	bool operator!=(const Command& rhs) {
-		if (rhs.commands.size() != commands.size())
+		if (rhs.commands.size() != commands.size() || rhs.cpu_affinity != cpu_affinity || rhs.numa_node != numa_node)
 			return true;
 
 		for (size_t i = 0; i < commands.size(); i++) {
@@ -569,7 +757,31 @@ void start_process(Command* cmd, uint64_t id, uid_t uid, gid_t gid, int delay, s
 			exit(0);
 #endif
 
+#ifdef __linux__
+		/* Placement is only a matter of performance, so the process is launched even if it fails */
+		if (!cmd->cpu_affinity.empty()) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for (int c : cmd->cpu_affinity)
+				CPU_SET(c, &set);
+			if (sched_setaffinity(0, sizeof(set), &set) != 0)
+				fprintf(stderr, "Unable to set CPU affinity of %s to %s (sched_setaffinity error %d: %s)\n", cmd->ssection.c_str(), format_cpu_list(cmd->cpu_affinity).c_str(), errno, strerror(errno));
+		}
+		if (cmd->numa_node >= 0) {
+			unsigned long nodemask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = {};
+			nodemask[cmd->numa_node / (8 * sizeof(unsigned long))] |= 1UL << (cmd->numa_node % (8 * sizeof(unsigned long)));
+			/* maxnode is one more than the number of bits in the mask */
+			if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodemask, 8 * sizeof(nodemask) + 1) != 0)
+				fprintf(stderr, "Unable to set NUMA node of %s to %d (set_mempolicy error %d: %s)\n", cmd->ssection.c_str(), cmd->numa_node, errno, strerror(errno));
+		}
+#endif
+
 		if (!cmd->quiet) {
+#ifdef __linux__
+			if (!cmd->cpu_affinity.empty() || cmd->numa_node >= 0)
+				fprintf(stdout, "Launching %s (%d) for %s on CPUs %s, NUMA node %d\n", cmd->argv[0], getpid(), cmd->ssection.c_str(), cmd->cpu_affinity.empty() ? "any" : format_cpu_list(cmd->cpu_affinity).c_str(), cmd->numa_node);
+			else
+#endif
 			fprintf(stdout, "Launching %s (%d) for %s\n", cmd->argv[0], getpid(), cmd->ssection.c_str());
 			fflush(stdout);
 		}
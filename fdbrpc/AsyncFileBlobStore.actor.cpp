@@ -28,8 +28,73 @@ Future<int64_t> AsyncFileBlobStoreRead::size() {
 	return m_size;
 }
 
+// Recently read ranges of blob store objects, shared by every AsyncFileBlobStoreRead in the process.  Each restore task opens
+// its file again, so without this a block read ahead for one task would be thrown away before the next could use it.
+// Backup files are never modified once written so cached ranges do not go stale.
+struct SharedBlobReadCache {
+	// Endpoint host, bucket, object, offset, length
+	typedef std::tuple<std::string, std::string, std::string, int64_t, int> RangeID;
+
+	struct Entry {
+		Future<Standalone<StringRef>> data;
+		std::list<RangeID>::iterator lruPosition;
+	};
+
+	std::map<RangeID, Entry> ranges;
+	std::list<RangeID> lru;  // Least recently used at the front
+	int64_t bytes;
+
+	SharedBlobReadCache() : bytes(0) {}
+
+	ACTOR static Future<Standalone<StringRef>> readRange(Reference<BlobStoreEndpoint> bstore, std::string bucket, std::string object, int length, int64_t offset) {
+		state Standalone<StringRef> buf = makeString(length);
+		int len = wait(bstore->readObject(bucket, object, mutateString(buf), length, offset));
+		return buf.substr(0, std::min(len, length));
+	}
+
+	Future<Standalone<StringRef>> get(Reference<BlobStoreEndpoint> bstore, std::string const &bucket, std::string const &object, int length, int64_t offset) {
+		RangeID id(bstore->host, bucket, object, offset, length);
+		auto i = ranges.find(id);
+		if(i != ranges.end() && !i->second.data.isError()) {
+			++BlobStoreEndpoint::s_stats.read_cache_hits;
+			lru.splice(lru.end(), lru, i->second.lruPosition);
+			return i->second.data;
+		}
+		++BlobStoreEndpoint::s_stats.read_cache_misses;
+
+		if(i != ranges.end())
+			erase(i);
+		Future<Standalone<StringRef>> data = readRange(bstore, bucket, object, length, offset);
+		ranges[id] = Entry({data, lru.insert(lru.end(), id)});
+		bytes += length;
+
+		// Evicting a range still being read cancels the read unless a reader is waiting for it
+		while(bytes > CLIENT_KNOBS->BLOBSTORE_SHARED_READ_CACHE_BYTES && lru.front() != id)
+			erase(ranges.find(lru.front()));
+
+		return data;
+	}
+
+	void erase(std::map<RangeID, Entry>::iterator i) {
+		bytes -= std::get<4>(i->first);
+		lru.erase(i->second.lruPosition);
+		ranges.erase(i);
+	}
+};
+
+ACTOR static Future<int> readCached(Future<Standalone<StringRef>> range, void *data) {
+	Standalone<StringRef> buf = wait(range);
+	memcpy(data, buf.begin(), buf.size());
+	return buf.size();
+}
+
 Future<int> AsyncFileBlobStoreRead::read( void *data, int length, int64_t offset ) {
-	return m_bstore->readObject(m_bucket, m_object, data, length, offset);
+	if(length > CLIENT_KNOBS->BLOBSTORE_SHARED_READ_CACHE_BYTES)
+		return m_bstore->readObject(m_bucket, m_object, data, length, offset);
+
+	// Never destroyed, since cached reads can still be in progress at exit
+	static SharedBlobReadCache *cache = new SharedBlobReadCache();
+	return readCached(cache->get(m_bstore, m_bucket, m_object, length, offset), data);
 }
 
 
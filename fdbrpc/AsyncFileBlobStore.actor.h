@@ -35,8 +35,6 @@
 #include "flow/Net2Packet.h"
 #include "IRateControl.h"
 #include "BlobStore.h"
-#include "md5/md5.h"
-#include "libb64/encode.h"
 
 ACTOR template<typename T> static Future<T> joinErrorGroup(Future<T> f, Promise<Void> p) {
 	try {
@@ -58,47 +56,39 @@ public:
 	virtual void delref() { ReferenceCounted<AsyncFileBlobStoreWrite>::delref(); }
 
 	struct Part : ReferenceCounted<Part> {
-		Part(int n) : number(n), writer(content.getWriteBuffer(), NULL, Unversioned()), length(0) {
+		Part(int n, int size) : number(n), size(size), writer(content.getWriteBuffer(), NULL, Unversioned()), length(0) {
 			etag = std::string();
-			::MD5_Init(&content_md5_buf);
 		}
 		virtual ~Part() {
 			etag.cancel();
 		}
 		Future<std::string> etag;
 		int number;
+		int size;  // Length at which the part is ended
 		UnsentPacketQueue content;
-		std::string md5string;
 		PacketWriter writer;
 		int length;
 		void write(const uint8_t *buf, int len) {
 			writer.serializeBytes(buf, len);
-			::MD5_Update(&content_md5_buf, buf, len);
 			length += len;
 		}
-		// MD5 sum can only be finalized once, further calls will do nothing so new writes will be reflected in the sum.
-		void finalizeMD5() {
-			if(md5string.empty()) {
-				std::string sumBytes;
-				sumBytes.resize(16);
-				::MD5_Final((unsigned char *)sumBytes.data(), &content_md5_buf);
-				md5string = base64::encoder::from_string(sumBytes);
-				md5string.resize(md5string.size() - 1);
-			}
+		// The MD5 sum is started once, when the part is complete, and no more can be written to it after that.
+		Future<std::string> md5;
+		Future<std::string> finalizeMD5() {
+			if(!md5.isValid())
+				md5 = BlobStoreEndpoint::calculateContentMD5(&content);
+			return md5;
 		}
-
-	private:
-		MD5_CTX content_md5_buf;
 	};
 
 	virtual Future<int> read( void *data, int length, int64_t offset ) { throw file_not_readable(); }
 
 	ACTOR static Future<Void> write_impl(Reference<AsyncFileBlobStoreWrite> f, const uint8_t *data, int length) {
 		state Part *p = f->m_parts.back().getPtr();
-		// If this write will cause the part to cross the min part size boundary then write to the boundary and start a new part.
-		while(p->length + length >= f->m_bstore->knobs.multipart_min_part_size) {
+		// If this write will cause the part to cross its size boundary then write to the boundary and start a new part.
+		while(p->length + length >= p->size) {
 			// Finish off this part
-			int finishlen = f->m_bstore->knobs.multipart_min_part_size - p->length;
+			int finishlen = p->size - p->length;
 			p->write((const uint8_t *)data, finishlen);
 
 			// Adjust source buffer args
@@ -129,18 +119,18 @@ public:
 	}
 
 	ACTOR static Future<std::string> doPartUpload(AsyncFileBlobStoreWrite *f, Part *p) {
-		p->finalizeMD5();
+		state std::string md5 = wait(p->finalizeMD5());
 		std::string upload_id = wait(f->getUploadID());
-		std::string etag = wait(f->m_bstore->uploadPart(f->m_bucket, f->m_object, upload_id, p->number, &p->content, p->length, p->md5string));
+		std::string etag = wait(f->m_bstore->uploadPart(f->m_bucket, f->m_object, upload_id, p->number, &p->content, p->length, md5));
 		return etag;
 	}
 
 	ACTOR static Future<Void> doFinishUpload(AsyncFileBlobStoreWrite* f) {
 		// If there is only 1 part then it has not yet been uploaded so just write the whole file at once.
 		if(f->m_parts.size() == 1) {
-			Reference<Part> part = f->m_parts.back();
-			part->finalizeMD5();
-			Void _ = wait(f->m_bstore->writeEntireFileFromBuffer(f->m_bucket, f->m_object, &part->content, part->length, part->md5string));
+			state Reference<Part> part = f->m_parts.back();
+			std::string md5 = wait(part->finalizeMD5());
+			Void _ = wait(f->m_bstore->writeEntireFileFromBuffer(f->m_bucket, f->m_object, &part->content, part->length, md5));
 			return Void();
 		}
 
@@ -219,6 +209,9 @@ private:
 		if(f->m_parts.back()->length == 0)
 			return Void();
 
+		// Start hashing the part while waiting for an upload slot
+		f->m_parts.back()->finalizeMD5();
+
 		// Wait for an upload slot to be available
 		Void _ = wait(f->m_concurrentUploads.take());
 
@@ -230,7 +223,7 @@ private:
 
 		// Make a new part to write to
 		if(startNew)
-			f->m_parts.push_back(Reference<Part>(new Part(f->m_parts.size() + 1)));
+			f->m_parts.push_back(Reference<Part>(new Part(f->m_parts.size() + 1, f->m_bstore->getTargetPartSize())));
 
 		return Void();
 	}
@@ -246,7 +239,7 @@ public:
 		: m_bstore(bstore), m_bucket(bucket), m_object(object), m_cursor(0), m_concurrentUploads(bstore->knobs.concurrent_writes_per_file) {
 
 		// Add first part
-		m_parts.push_back(Reference<Part>(new Part(1)));
+		m_parts.push_back(Reference<Part>(new Part(1, bstore->getTargetPartSize())));
 	}
 
 };
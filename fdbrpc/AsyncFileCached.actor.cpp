@@ -37,6 +37,8 @@ EvictablePage::~EvictablePage() {
 		pageCache->pages[index] = pageCache->pages.back();
 		pageCache->pages[index]->index = index;
 		pageCache->pages.pop_back();
+		if (pageCache->policy == EvictablePageCache::SLRU)
+			(protectedPage ? pageCache->protectedPages : pageCache->probationPages).erase(lruEntry);
 	}
 }
 
@@ -46,7 +48,7 @@ void AsyncFileCached::remove_page( AFCPage* page ) {
 	pages.erase( page->pageOffset );
 }
 
-Future<Reference<IAsyncFile>> AsyncFileCached::open_impl( std::string filename, int flags, int mode ) {
+Reference<EvictablePageCache> AsyncFileCached::getPageCache( int flags ) {
 	Reference<EvictablePageCache> pageCache;
 
 	//In a simulated environment, each machine needs its own caches
@@ -55,7 +57,7 @@ Future<Reference<IAsyncFile>> AsyncFileCached::open_impl( std::string filename,
 		if(cacheItr == simulatorPageCaches.end()) {
 			int64_t pageCacheSize4k = (BUGGIFY) ? FLOW_KNOBS->BUGGIFY_SIM_PAGE_CACHE_4K : FLOW_KNOBS->SIM_PAGE_CACHE_4K;
 			int64_t pageCacheSize64k = (BUGGIFY) ? FLOW_KNOBS->BUGGIFY_SIM_PAGE_CACHE_64K : FLOW_KNOBS->SIM_PAGE_CACHE_64K;
-			auto caches = std::make_pair(Reference<EvictablePageCache>(new EvictablePageCache(4096, pageCacheSize4k)), Reference<EvictablePageCache>(new EvictablePageCache(65536, pageCacheSize64k)));
+			auto caches = std::make_pair(Reference<EvictablePageCache>(new EvictablePageCache(FLOW_KNOBS->PAGE_CACHE_PAGE_SIZE, pageCacheSize4k)), Reference<EvictablePageCache>(new EvictablePageCache(65536, pageCacheSize64k)));
 			simulatorPageCaches[g_network->getLocalAddress()] = caches;
 			pageCache = (flags & IAsyncFile::OPEN_LARGE_PAGES) ? caches.second : caches.first;
 		}
@@ -67,12 +69,15 @@ Future<Reference<IAsyncFile>> AsyncFileCached::open_impl( std::string filename,
 			if(!pc64k.present()) pc64k = Reference<EvictablePageCache>(new EvictablePageCache(65536, FLOW_KNOBS->PAGE_CACHE_64K));
 			pageCache = pc64k.get();
 		} else {
-			if(!pc4k.present()) pc4k = Reference<EvictablePageCache>(new EvictablePageCache(4096, FLOW_KNOBS->PAGE_CACHE_4K));
+			if(!pc4k.present()) pc4k = Reference<EvictablePageCache>(new EvictablePageCache(FLOW_KNOBS->PAGE_CACHE_PAGE_SIZE, FLOW_KNOBS->PAGE_CACHE_4K));
 			pageCache = pc4k.get();
 		}
 	}
+	return pageCache;
+}
 
-	return open_impl(filename, flags, mode, pageCache);
+Future<Reference<IAsyncFile>> AsyncFileCached::open_impl( std::string filename, int flags, int mode ) {
+	return open_impl(filename, flags, mode, getPageCache(flags));
 }
 
 Future<Void> AsyncFileCached::read_write_impl( AsyncFileCached* self, void* data, int length, int64_t offset, bool writing ) {
@@ -95,8 +100,16 @@ Future<Void> AsyncFileCached::read_write_impl( AsyncFileCached* self, void* data
 		++self->countCacheFinds;
 		auto p = self->pages.find( pageOffset );
 		if ( p == self->pages.end() ) {
+			++self->countFileCacheMisses;
+			++self->countCacheMisses;
+			++self->pageCache->misses;
 			AFCPage* page = new AFCPage( self, pageOffset );
 			p = self->pages.insert( std::make_pair(pageOffset, page) ).first;
+		} else {
+			++self->countFileCacheHits;
+			++self->countCacheHits;
+			++self->pageCache->hits;
+			self->pageCache->updateHit( p->second );
 		}
 
 		int bytesInPage = std::min(self->pageCache->pageSize - offsetInPage, remaining);
@@ -131,8 +144,16 @@ Future<Void> AsyncFileCached::readZeroCopy( void** data, int* length, int64_t of
 
 	auto p = pages.find( offset );
 	if ( p == pages.end() ) {
+		++countFileCacheMisses;
+		++countCacheMisses;
+		++pageCache->misses;
 		AFCPage* page = new AFCPage( this, offset );
 		p = pages.insert( std::make_pair(offset, page) ).first;
+	} else {
+		++countFileCacheHits;
+		++countCacheHits;
+		++pageCache->hits;
+		pageCache->updateHit( p->second );
 	}
 
 	*data = p->second->data;
@@ -146,6 +167,75 @@ void AsyncFileCached::releaseZeroCopy( void* data, int length, int64_t offset )
 	p->second->releaseZeroCopy();
 }
 
+Future<int> AsyncFileCached::readUncached( void* data, int length, int64_t offset ) {
+	++countFileCacheReads;
+	++countCacheReads;
+	if (offset + length > this->length) {
+		length = int(this->length - offset);
+		ASSERT(length >= 0);
+	}
+
+	std::vector<Future<Void>> actors;
+
+	uint8_t* cdata = static_cast<uint8_t*>(data);
+
+	int offsetInPage = offset % pageCache->pageSize;
+	int64_t pageOffset = offset - offsetInPage;
+
+	// The current run of consecutive pages that are not in the cache, which is read from the underlying file in one request
+	uint8_t* runData = cdata;
+	int64_t runOffset = offset;
+	int64_t runPageOffset = pageOffset;
+	int runLength = 0;
+	int runPages = 0;
+
+	int remaining = length;
+
+	while (remaining) {
+		++countFileCacheFinds;
+		++countCacheFinds;
+		int bytesInPage = std::min(pageCache->pageSize - offsetInPage, remaining);
+
+		auto p = pages.find( pageOffset );
+		if ( p == pages.end() ) {
+			++countFileCacheBypassed;
+			++countCacheBypassed;
+			if (!runPages) {
+				runData = cdata;
+				runOffset = pageOffset + offsetInPage;
+				runPageOffset = pageOffset;
+				runLength = 0;
+			}
+			runLength += bytesInPage;
+			++runPages;
+		} else {
+			// Pages which are cached (and possibly dirty) have to be read through the cache, but aren't promoted
+			if (runPages) {
+				actors.push_back( readAround( uncached, runData, runLength, runOffset, runPageOffset, runPages * pageCache->pageSize ) );
+				runPages = 0;
+			}
+			++countFileCacheHits;
+			++countCacheHits;
+			auto r = p->second->read( cdata, bytesInPage, offsetInPage );
+			if (!r.isReady() || r.isError())
+				actors.push_back( r );
+		}
+
+		cdata += bytesInPage;
+		pageOffset += pageCache->pageSize;
+		offsetInPage = 0;
+
+		remaining -= bytesInPage;
+	}
+	if (runPages)
+		actors.push_back( readAround( uncached, runData, runLength, runOffset, runPageOffset, runPages * pageCache->pageSize ) );
+
+	if (actors.empty()) return length;
+	++countFileCacheReadsBlocked;
+	++countCacheReadsBlocked;
+	return tag( waitForAll( actors ), length );
+}
+
 Future<Void> AsyncFileCached::truncate( int64_t size ) {
 	++countFileCacheWrites;
 	++countCacheWrites;
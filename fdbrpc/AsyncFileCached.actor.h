@@ -37,16 +37,29 @@ struct EvictablePage {
 	void* data;
 	int index;
 	class Reference<struct EvictablePageCache> pageCache;
+	std::list<EvictablePage*>::iterator lruEntry; // Only used by the SLRU policy
+	bool protectedPage; // True if lruEntry is in pageCache->protectedPages rather than pageCache->probationPages
 
 	virtual bool evict() = 0; // true if page was evicted, false if it isn't immediately evictable (but will be evicted regardless if possible)
 
-	EvictablePage(Reference<EvictablePageCache> pageCache) : data(0), index(-1), pageCache(pageCache) {}
+	EvictablePage(Reference<EvictablePageCache> pageCache) : data(0), index(-1), pageCache(pageCache), protectedPage(false) {}
 	virtual ~EvictablePage();
 };
 
 struct EvictablePageCache : ReferenceCounted<EvictablePageCache> {
-	EvictablePageCache() : pageSize(0), maxPages(0) {}
-	explicit EvictablePageCache(int pageSize, int64_t maxSize) : pageSize(pageSize), maxPages(maxSize / pageSize) {}
+	enum EvictionPolicy { RANDOM, SLRU };
+
+	EvictablePageCache() : pageSize(0), maxPages(0), policy(RANDOM), maxProtectedPages(0), hits(0), misses(0), governor(NULL) {}
+	explicit EvictablePageCache(int pageSize, int64_t maxSize) : pageSize(pageSize), maxPages(maxSize / pageSize), policy(evictionPolicyFromString(FLOW_KNOBS->CACHE_EVICTION_POLICY)), hits(0), misses(0), governor(NULL) {
+		maxProtectedPages = std::max<int64_t>(1, maxPages * FLOW_KNOBS->CACHE_PROTECTED_FRACTION);
+	}
+
+	static EvictionPolicy evictionPolicyFromString(std::string const& policy) {
+		if (policy == "random") return RANDOM;
+		if (policy == "slru") return SLRU;
+		TraceEvent(SevWarnAlways, "UnknownCacheEvictionPolicy").detail("Policy", policy);
+		return RANDOM;
+	}
 
 	void allocate(EvictablePage* page) {
 		try_evict();
@@ -54,10 +67,58 @@ struct EvictablePageCache : ReferenceCounted<EvictablePageCache> {
 		page->data = pageSize == 4096 ? FastAllocator<4096>::allocate() : aligned_alloc(4096,pageSize);
 		page->index = pages.size();
 		pages.push_back(page);
+		if (policy == SLRU) {
+			// New pages start out on probation, so a scan that touches each page once can only push out other
+			// pages that have not been reused.
+			page->lruEntry = probationPages.insert(probationPages.begin(), page);
+		}
+	}
+
+	// Called when a page that is already cached is read or written again
+	void updateHit(EvictablePage* page) {
+		if (policy != SLRU) return;
+		if (page->protectedPage) {
+			protectedPages.splice(protectedPages.begin(), protectedPages, page->lruEntry);
+			return;
+		}
+
+		protectedPages.splice(protectedPages.begin(), probationPages, page->lruEntry);
+		page->protectedPage = true;
+		if (protectedPages.size() > maxProtectedPages) {
+			EvictablePage* demoted = protectedPages.back();
+			probationPages.splice(probationPages.begin(), protectedPages, demoted->lruEntry);
+			demoted->protectedPage = false;
+		}
+	}
+
+	int64_t getSizeBytes() const { return (int64_t)pages.size() * pageSize; }
+	int64_t getMaxSizeBytes() const { return maxPages * pageSize; }
+
+	// Changes the size limit, evicting pages (as far as they can be evicted) until the cache is within it
+	void setMaxSize(int64_t maxSize) {
+		maxPages = std::max<int64_t>(1, maxSize / pageSize);
+		maxProtectedPages = std::max<int64_t>(1, maxPages * FLOW_KNOBS->CACHE_PROTECTED_FRACTION);
+		while (policy == SLRU && protectedPages.size() > maxProtectedPages) {
+			EvictablePage* demoted = protectedPages.back();
+			probationPages.splice(probationPages.begin(), protectedPages, demoted->lruEntry);
+			demoted->protectedPage = false;
+		}
+		while (pages.size() > (uint64_t)maxPages) {
+			size_t before = pages.size();
+			try_evict();
+			if (pages.size() == before)
+				break;
+		}
 	}
 
 	void try_evict() {
 		if (pages.size() >= (uint64_t)maxPages && !pages.empty()) {
+			if (policy == SLRU) {
+				// If we don't manage to evict anything, just go ahead and exceed the cache limit
+				if (!evictLeastRecentlyUsed(probationPages))
+					evictLeastRecentlyUsed(protectedPages);
+				return;
+			}
 			for (int i = 0; i < FLOW_KNOBS->MAX_EVICT_ATTEMPTS; i++) { // If we don't manage to evict anything, just go ahead and exceed the cache limit
 				int toEvict = g_random->randomInt(0, pages.size());
 				if (pages[toEvict]->evict())
@@ -66,9 +127,27 @@ struct EvictablePageCache : ReferenceCounted<EvictablePageCache> {
 		}
 	}
 
+	// Tries to evict one of the least recently used pages in the given list, returning true if one was evicted
+	bool evictLeastRecentlyUsed(std::list<EvictablePage*>& lru) {
+		auto it = lru.end();
+		for (int i = 0; i < FLOW_KNOBS->MAX_EVICT_ATTEMPTS && it != lru.begin(); i++) {
+			auto candidate = std::prev(it);
+			if ((*candidate)->evict()) // destroys the page, which erases candidate from the list
+				return true;
+			it = candidate;
+		}
+		return false;
+	}
+
 	std::vector<EvictablePage*> pages;
+	std::list<EvictablePage*> probationPages;
+	std::list<EvictablePage*> protectedPages;
 	int pageSize;
 	int64_t maxPages;
+	EvictionPolicy policy;
+	uint64_t maxProtectedPages;
+	int64_t hits, misses;  // Of page lookups, since the cache was created
+	const void* governor;  // Whoever is sizing the cache with setMaxSize(), if anyone; see the storage server's memoryGovernor()
 };
 
 struct OpenFileInfo : NonCopyable {
@@ -90,6 +169,9 @@ class AsyncFileCached : public IAsyncFile, public ReferenceCounted<AsyncFileCach
 	friend struct AFCPage;
 
 public:
+	// The cache that files opened with the given flags share: one per process, or per simulated machine
+	static Reference<EvictablePageCache> getPageCache( int flags );
+
 	static Future<Reference<IAsyncFile>> open( std::string filename, int flags, int mode ) {
 		//TraceEvent("AsyncFileCachedOpen").detail("Filename", filename);
 		if ( openFiles.find(filename) == openFiles.end() ) {
@@ -132,6 +214,8 @@ public:
 	virtual Future<Void> readZeroCopy( void** data, int* length, int64_t offset );
 	virtual void releaseZeroCopy( void* data, int length, int64_t offset );
 
+	virtual Future<int> readUncached( void* data, int length, int64_t offset );
+
 	virtual Future<Void> truncate( int64_t size );
 
 	ACTOR Future<Void> truncate_impl( AsyncFileCached* self, int64_t size, Future<Void> truncates ) {
@@ -194,6 +278,10 @@ private:
 	Int64MetricHandle countFileCacheWritesBlocked;
 	Int64MetricHandle countFileCachePageReadsMerged;
 	Int64MetricHandle countFileCacheReadBytes;
+	Int64MetricHandle countFileCacheHits;
+	Int64MetricHandle countFileCacheMisses;
+	Int64MetricHandle countFileCacheEvictions;
+	Int64MetricHandle countFileCacheBypassed;
 
 	Int64MetricHandle countCacheFinds;
 	Int64MetricHandle countCacheReads;
@@ -202,6 +290,10 @@ private:
 	Int64MetricHandle countCacheWritesBlocked;
 	Int64MetricHandle countCachePageReadsMerged;
 	Int64MetricHandle countCacheReadBytes;
+	Int64MetricHandle countCacheHits;
+	Int64MetricHandle countCacheMisses;
+	Int64MetricHandle countCacheEvictions;
+	Int64MetricHandle countCacheBypassed;
 
 	AsyncFileCached( Reference<IAsyncFile> uncached, const std::string& filename, int64_t length, Reference<EvictablePageCache> pageCache ) 
 		: uncached(uncached), filename(filename), length(length), prevLength(length), pageCache(pageCache) {
@@ -213,6 +305,10 @@ private:
 			countFileCachePageReadsMerged.init(LiteralStringRef("AsyncFile.CountFileCachePageReadsMerged"), filename);
 			countFileCacheFinds.init(          LiteralStringRef("AsyncFile.CountFileCacheFinds"), filename);
 			countFileCacheReadBytes.init(      LiteralStringRef("AsyncFile.CountFileCacheReadBytes"), filename);
+			countFileCacheHits.init(           LiteralStringRef("AsyncFile.CountFileCacheHits"), filename);
+			countFileCacheMisses.init(         LiteralStringRef("AsyncFile.CountFileCacheMisses"), filename);
+			countFileCacheEvictions.init(      LiteralStringRef("AsyncFile.CountFileCacheEvictions"), filename);
+			countFileCacheBypassed.init(       LiteralStringRef("AsyncFile.CountFileCacheBypassed"), filename);
 
 			countCacheWrites.init(         LiteralStringRef("AsyncFile.CountCacheWrites"));
 			countCacheReads.init(          LiteralStringRef("AsyncFile.CountCacheReads"));
@@ -221,6 +317,10 @@ private:
 			countCachePageReadsMerged.init(LiteralStringRef("AsyncFile.CountCachePageReadsMerged"));
 			countCacheFinds.init(          LiteralStringRef("AsyncFile.CountCacheFinds"));
 			countCacheReadBytes.init(      LiteralStringRef("AsyncFile.CountCacheReadBytes"));
+			countCacheHits.init(           LiteralStringRef("AsyncFile.CountCacheHits"));
+			countCacheMisses.init(         LiteralStringRef("AsyncFile.CountCacheMisses"));
+			countCacheEvictions.init(      LiteralStringRef("AsyncFile.CountCacheEvictions"));
+			countCacheBypassed.init(       LiteralStringRef("AsyncFile.CountCacheBypassed"));
 
 		}
 	}
@@ -261,6 +361,23 @@ private:
 
 	static Future<Void> read_write_impl( AsyncFileCached* self, void* data, int length, int64_t offset, bool writing );
 
+	// Reads the page aligned range [pageOffset, pageOffset+pagesLength) from the underlying file into a temporary buffer
+	// and copies the length bytes at offset into data, without creating any pages
+	ACTOR static Future<Void> readAround( Reference<IAsyncFile> uncached, uint8_t* data, int length, int64_t offset, int64_t pageOffset, int pagesLength ) {
+		state void* buf = aligned_alloc(4096, pagesLength);
+		try {
+			int readBytes = wait( uncached->read( buf, pagesLength, pageOffset ) );
+			int available = std::max<int64_t>( 0, std::min<int64_t>( length, pageOffset + readBytes - offset ) );
+			memcpy( data, static_cast<uint8_t*>(buf) + (offset - pageOffset), available );
+			memset( data + available, 0, length - available );
+		} catch (Error& e) {
+			aligned_free(buf);
+			throw;
+		}
+		aligned_free(buf);
+		return Void();
+	}
+
 	static Future<Void> truncate_impl( AsyncFileCached* self, int64_t size );
 
 	void remove_page( AFCPage* page );
@@ -269,6 +386,8 @@ private:
 struct AFCPage : public EvictablePage, public FastAllocated<AFCPage> {
 	virtual bool evict() {
 		if ( notReading.isReady() && notFlushing.isReady() && !dirty && !zeroCopyRefCount && !truncated ) {
+			++owner->countFileCacheEvictions;
+			++owner->countCacheEvictions;
 			owner->remove_page( this );
 			delete this;
 			return true;
@@ -109,14 +109,14 @@ public:
 	virtual Future<int> read( void* data, int length, int64_t offset ) {
 		++countFileLogicalReads;
 		++countLogicalReads;
-		return read_impl(fd, data, length, offset);
+		return read_impl(fd, latencies, data, length, offset);
 	}
 	virtual Future<Void> write( void const* data, int length, int64_t offset ) // Copies data synchronously
 	{
 		++countFileLogicalWrites;
 		++countLogicalWrites;
 		//Standalone<StringRef> copy = StringRef((const uint8_t*)data, length);
-		return write_impl( fd, err, StringRef((const uint8_t*)data, length), offset );
+		return write_impl( fd, latencies, err, StringRef((const uint8_t*)data, length), offset );
 	}
 	virtual Future<Void> truncate( int64_t size ) {
 		++countFileLogicalWrites;
@@ -230,7 +230,12 @@ private:
 	Int64MetricHandle countLogicalWrites;
 	Int64MetricHandle countLogicalReads;
 
-	AsyncFileEIO( int fd, int flags, std::string const& filename ) : fd(fd), flags(flags), filename(filename), err(new ErrorInfo) {
+	DiskLatencyProfile::Latencies* latencies;  // Of the device the file is on
+
+	AsyncFileEIO( int fd, int flags, std::string const& filename ) : fd(fd), flags(flags), filename(filename), err(new ErrorInfo), latencies(NULL) {
+		struct stat buf;
+		if (!fstat( fd, &buf ))
+			latencies = &g_network->diskLatencyProfile.byDevice[buf.st_dev];
 		if( !g_network->isSimulated() ) {
 			countFileLogicalWrites.init(LiteralStringRef("AsyncFile.CountFileLogicalWrites"), filename);
 			countFileLogicalReads.init( LiteralStringRef("AsyncFile.CountFileLogicalReads"), filename);
@@ -248,6 +253,7 @@ private:
 		if( flags & OPEN_READONLY )  oflags |= O_RDONLY;
 		if( flags & OPEN_READWRITE ) oflags |= O_RDWR;
 		if( flags & OPEN_ATOMIC_WRITE_AND_CREATE ) oflags |= O_TRUNC;
+		if( flags & OPEN_DSYNC )     oflags |= O_DSYNC;
 		return oflags;
 	}
 
@@ -267,12 +273,14 @@ private:
 		TraceEvent("AsyncFileClosed").detail("fd", fd).suppressFor(1.0);
 	}
 
-	ACTOR static Future<int> read_impl( int fd, void* data, int length, int64_t offset ) {
+	ACTOR static Future<int> read_impl( int fd, DiskLatencyProfile::Latencies* latencies, void* data, int length, int64_t offset ) {
 		state int taskID = g_network->getCurrentTask();
 		state Promise<Void> p;
+		state double begin = timer_monotonic();
 		//fprintf(stderr, "eio_read (fd=%d length=%d offset=%lld)\n", fd, length, offset);
 		state eio_req* r = eio_read(fd, data, length, offset, 0, eio_callback, &p);
 		try { Void _ = wait( p.getFuture() ); } catch (...) { g_network->setCurrentTask( taskID ); eio_cancel(r); throw; }
+		if (latencies) g_network->diskLatencyProfile.record( latencies, false, timer_monotonic() - begin, 1, std::max<int64_t>( r->result, 0 ) );
 		try {
 			state int result = r->result;
 			//printf("eio read: %d/%d\n", r->result, length);
@@ -290,11 +298,13 @@ private:
 		}
 	}
 
-	ACTOR static Future<Void> write_impl( int fd, Reference<ErrorInfo> err, StringRef data, int64_t offset ) {
+	ACTOR static Future<Void> write_impl( int fd, DiskLatencyProfile::Latencies* latencies, Reference<ErrorInfo> err, StringRef data, int64_t offset ) {
 		state int taskID = g_network->getCurrentTask();
 		state Promise<Void> p;
+		state double begin = timer_monotonic();
 		state eio_req* r = eio_write(fd, (void*)data.begin(), data.size(), offset, 0, eio_callback, &p);
 		try { Void _ = wait( p.getFuture() ); } catch (...) { g_network->setCurrentTask( taskID ); eio_cancel(r); throw; }
+		if (latencies) g_network->diskLatencyProfile.record( latencies, true, timer_monotonic() - begin, 1, std::max<int64_t>( r->result, 0 ) );
 		if (r->result != data.size()) error("WriteError", fd, r, err);
 		Void _ = wait( delay(0, taskID) );
 		return Void();
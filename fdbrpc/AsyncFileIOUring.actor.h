@@ -0,0 +1,675 @@
+/*
+ * AsyncFileIOUring.actor.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifdef __linux__
+
+// When actually compiled (NO_INTELLISENSE), include the generated version of this file.  In intellisense use the source version.
+#if defined(NO_INTELLISENSE) && !defined(FLOW_ASYNCFILEIOURING_ACTOR_G_H)
+	#define FLOW_ASYNCFILEIOURING_ACTOR_G_H
+	#include "AsyncFileIOUring.actor.g.h"
+#elif !defined(FLOW_ASYNCFILEIOURING_ACTOR_H)
+	#define FLOW_ASYNCFILEIOURING_ACTOR_H
+
+#include "IAsyncFile.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include "fdbrpc/linux_uring.h"
+#include "flow/Knobs.h"
+#include "flow/UnitTest.h"
+#include "flow/genericactors.actor.h"
+
+// An unbuffered (O_DIRECT) file whose reads, writes and syncs are submitted to a single io_uring shared by the process.
+// Like AsyncFileKAIO, operations are queued by priority and submitted as a batch once per run loop iteration (launch()),
+// and completions are signalled through the reactor's eventfd, which is registered with the ring.
+class AsyncFileIOUring : public IAsyncFile, public ReferenceCounted<AsyncFileIOUring> {
+public:
+	static Future<Reference<IAsyncFile>> open( std::string filename, int flags, int mode, void* ignore ) {
+		ASSERT( flags & OPEN_UNBUFFERED );
+
+		if (flags & OPEN_LOCK)
+			mode |= 02000;  // Enable mandatory locking for this file if it is supported by the filesystem
+
+		std::string open_filename = filename;
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE) {
+			ASSERT( (flags & OPEN_CREATE) && (flags & OPEN_READWRITE) && !(flags & OPEN_EXCLUSIVE) );
+			open_filename = filename + ".part";
+		}
+
+		int fd = ::open( open_filename.c_str(), openFlags(flags) | O_DIRECT, mode );
+		if (fd<0) {
+			Error e = errno==ENOENT ? file_not_found() : io_error();
+			TraceEvent("AsyncFileIOUringOpenFailed").detail("Filename", filename).detailf("Flags", "%x", flags)
+				.detailf("OSFlags", "%x", openFlags(flags) | O_DIRECT).detailf("mode", "0%o", mode).error(e).GetLastError();
+			return e;
+		} else {
+			TraceEvent("AsyncFileIOUringOpen")
+				.detail("Filename", filename)
+				.detail("Flags", flags)
+				.detail("mode", mode)
+				.detail("fd", fd);
+		}
+
+		Reference<AsyncFileIOUring> r(new AsyncFileIOUring( fd, flags, filename ));
+
+		if (flags & OPEN_LOCK) {
+			// Acquire a "write" lock for the entire file
+			flock lockDesc;
+			lockDesc.l_type = F_WRLCK;
+			lockDesc.l_whence = SEEK_SET;
+			lockDesc.l_start = 0;
+			lockDesc.l_len = 0;
+			lockDesc.l_pid = 0;
+			if (fcntl(fd, F_SETLK, &lockDesc) == -1) {
+				TraceEvent(SevError, "UnableToLockFile").detail("filename", filename).GetLastError();
+				return io_error();
+			}
+		}
+
+		struct stat buf;
+		if (fstat( fd, &buf )) {
+			TraceEvent("AsyncFileIOUringFStatError").detail("fd",fd).detail("filename", filename).GetLastError();
+			return io_error();
+		}
+
+		r->lastFileSize = r->nextFileSize = buf.st_size;
+		return Reference<IAsyncFile>(std::move(r));
+	}
+
+	// Sets up the process-wide ring.  Returns false if io_uring is unavailable (e.g. on kernels older than 5.1), in which
+	// case nothing has been changed and the caller should fall back to AsyncFileKAIO.
+	static bool init( Reference<IEventFD> ev, double ioTimeout ) {
+		linux_uring_params params;
+		memset(&params, 0, sizeof(params));
+		if (FLOW_KNOBS->IO_URING_SQPOLL) {
+			params.flags |= IORING_SETUP_SQPOLL;
+			params.sq_thread_idle = 1000; // ms before the kernel submission thread goes to sleep
+		}
+
+		int ringFd = io_uring_setup( FLOW_KNOBS->MAX_OUTSTANDING, &params );
+		if (ringFd < 0) {
+			TraceEvent(SevWarnAlways, "IOUringSetupError").detail("SQPoll", FLOW_KNOBS->IO_URING_SQPOLL).GetLastError();
+			return false;
+		}
+
+		size_t sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+		size_t cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(linux_uring_cqe);
+		size_t sqesSize = params.sq_entries * sizeof(linux_uring_sqe);
+		uint8_t* sqRing = (uint8_t*)mmap( 0, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING );
+		uint8_t* cqRing = (uint8_t*)mmap( 0, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING );
+		void* sqes = mmap( 0, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES );
+		int evfd = ev->getFD();
+		if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED || io_uring_register( ringFd, IORING_REGISTER_EVENTFD, &evfd, 1 ) < 0) {
+			TraceEvent(SevWarnAlways, "IOUringMapError").GetLastError();
+			if (sqRing != MAP_FAILED) munmap( sqRing, sqRingSize );
+			if (cqRing != MAP_FAILED) munmap( cqRing, cqRingSize );
+			if (sqes != MAP_FAILED) munmap( sqes, sqesSize );
+			close( ringFd );
+			return false;
+		}
+
+		ctx.ringFd = ringFd;
+		ctx.sqPoll = FLOW_KNOBS->IO_URING_SQPOLL != 0;
+		ctx.sqHead = (uint32_t*)(sqRing + params.sq_off.head);
+		ctx.sqTail = (uint32_t*)(sqRing + params.sq_off.tail);
+		ctx.sqMask = *(uint32_t*)(sqRing + params.sq_off.ring_mask);
+		ctx.sqEntries = *(uint32_t*)(sqRing + params.sq_off.ring_entries);
+		ctx.sqFlags = (uint32_t*)(sqRing + params.sq_off.flags);
+		ctx.sqArray = (uint32_t*)(sqRing + params.sq_off.array);
+		ctx.sqes = (linux_uring_sqe*)sqes;
+		ctx.cqHead = (uint32_t*)(cqRing + params.cq_off.head);
+		ctx.cqTail = (uint32_t*)(cqRing + params.cq_off.tail);
+		ctx.cqMask = *(uint32_t*)(cqRing + params.cq_off.ring_mask);
+		ctx.cqes = (linux_uring_cqe*)(cqRing + params.cq_off.cqes);
+		ctx.evfd = evfd;
+
+		// Reserve a table of fixed file slots so that the kernel doesn't have to look up and reference count the file on
+		// every request. Files opened after the table is full (or if registration isn't supported) use their fd directly.
+		if (FLOW_KNOBS->IO_URING_FIXED_FILES > 0) {
+			std::vector<int> fds( FLOW_KNOBS->IO_URING_FIXED_FILES, -1 );
+			if (io_uring_register( ringFd, IORING_REGISTER_FILES, &fds[0], fds.size() ) == 0) {
+				for (int i = fds.size() - 1; i >= 0; i--)
+					ctx.freeFileSlots.push_back(i);
+			} else {
+				TraceEvent("IOUringRegisterFilesError").GetLastError();
+			}
+		}
+
+		if( !g_network->isSimulated() ) {
+			ctx.countAIOSubmit.init(LiteralStringRef("AsyncFile.CountAIOSubmit"));
+			ctx.countAIOCollect.init(LiteralStringRef("AsyncFile.CountAIOCollect"));
+			ctx.submitMetric.init(LiteralStringRef("AsyncFile.Submit"));
+			ctx.countPreSubmitTruncate.init(LiteralStringRef("AsyncFile.CountPreAIOSubmitTruncate"));
+			ctx.preSubmitTruncateBytes.init(LiteralStringRef("AsyncFile.PreAIOSubmitTruncateBytes"));
+		}
+
+		TraceEvent("IOUringInit").detail("Entries", ctx.sqEntries).detail("SQPoll", ctx.sqPoll).detail("FixedFiles", ctx.freeFileSlots.size());
+
+		setTimeout(ioTimeout);
+		poll(ev);
+
+		g_network->setGlobal(INetwork::enRunCycleFunc, (flowGlobalType) &AsyncFileIOUring::launch);
+		return true;
+	}
+
+	static bool isInitialized() { return ctx.ringFd >= 0; }
+	static void setTimeout(double ioTimeout) { ctx.setIOTimeout(ioTimeout); }
+
+	virtual void addref() { ReferenceCounted<AsyncFileIOUring>::addref(); }
+	virtual void delref() { ReferenceCounted<AsyncFileIOUring>::delref(); }
+
+	virtual Future<int> read( void* data, int length, int64_t offset ) {
+		++countFileLogicalReads;
+		++countLogicalReads;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		IOBlock *io = new IOBlock(IORING_OP_READV, 0);
+		io->iov.iov_base = data;
+		io->iov.iov_len = length;
+		io->offset = offset;
+
+		enqueue(io, this);
+		return io->result.getFuture();
+	}
+	virtual Future<Void> write( void const* data, int length, int64_t offset ) {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		IOBlock *io = new IOBlock(IORING_OP_WRITEV, 0);
+		io->iov.iov_base = (void*)data;
+		io->iov.iov_len = length;
+		io->offset = offset;
+
+		nextFileSize = std::max( nextFileSize, offset+length );
+
+		enqueue(io, this);
+		return success(io->result.getFuture());
+	}
+#ifndef FALLOC_FL_ZERO_RANGE
+#define FALLOC_FL_ZERO_RANGE 0x10
+#endif
+	virtual Future<Void> zeroRange( int64_t offset, int64_t length ) override {
+		bool success = false;
+		if (ctx.fallocateZeroSupported) {
+			int rc = fallocate( fd, FALLOC_FL_ZERO_RANGE, offset, length );
+			if (rc == EOPNOTSUPP) {
+				ctx.fallocateZeroSupported = false;
+			}
+			if (rc == 0) {
+				success = true;
+			}
+		}
+		return success ? Void() : IAsyncFile::zeroRange(offset, length);
+	}
+	virtual Future<Void> truncate( int64_t size ) {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		int result = -1;
+		bool completed = false;
+		if( ctx.fallocateSupported && size >= lastFileSize ) {
+			result = fallocate( fd, 0, 0, size);
+			if (result != 0) {
+				int fallocateErrCode = errno;
+				TraceEvent("AsyncFileIOUringAllocateError").detail("fd",fd).detail("filename", filename).GetLastError();
+				if ( fallocateErrCode == EOPNOTSUPP ) {
+					// Mark fallocate as unsupported. Try again with truncate.
+					ctx.fallocateSupported = false;
+				} else {
+					return io_error();
+				}
+			} else {
+				completed = true;
+			}
+		}
+		if ( !completed )
+			result = ftruncate(fd, size);
+
+		if(result != 0) {
+			TraceEvent("AsyncFileIOUringTruncateError").detail("fd",fd).detail("filename", filename).GetLastError();
+			return io_error();
+		}
+
+		lastFileSize = nextFileSize = size;
+
+		return Void();
+	}
+
+	ACTOR static Future<Void> throwErrorIfFailed( Reference<AsyncFileIOUring> self, Future<Void> sync ) {
+		Void _ = wait( sync );
+		if(self->failed) {
+			throw io_timeout();
+		}
+		return Void();
+	}
+
+	virtual Future<Void> sync() {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		// Unlike kernel AIO, io_uring implements fdatasync, so we don't need a thread pool for it
+		IOBlock *io = new IOBlock(IORING_OP_FSYNC, IORING_FSYNC_DATASYNC);
+		enqueue(io, this);
+		Future<Void> fsync = throwErrorIfFailed(Reference<AsyncFileIOUring>::addRef(this), success(io->result.getFuture()));
+
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE) {
+			flags &= ~OPEN_ATOMIC_WRITE_AND_CREATE;
+
+			return AsyncFileEIO::waitAndAtomicRename( fsync, filename+".part", filename );
+		}
+
+		return fsync;
+	}
+	virtual Future<int64_t> size() { return nextFileSize; }
+	virtual int64_t debugFD() {
+		return fd;
+	}
+	virtual std::string getFilename() {
+		return filename;
+	}
+	~AsyncFileIOUring() {
+		if (fixedFileSlot >= 0) {
+			ctx.updateFixedFile(fixedFileSlot, -1);
+			ctx.freeFileSlots.push_back(fixedFileSlot);
+		}
+		close(fd);
+	}
+
+	static void launch() {
+		uint32_t tail = *ctx.sqTail;
+		uint32_t unsubmitted = tail - __atomic_load_n(ctx.sqHead, __ATOMIC_ACQUIRE);
+		if ((ctx.queue.size() || (unsubmitted && !ctx.sqPoll)) && ctx.outstanding < FLOW_KNOBS->MAX_OUTSTANDING - FLOW_KNOBS->MIN_SUBMIT) {
+			ctx.submitMetric = true;
+
+			double begin = timer_monotonic();
+			if (!ctx.outstanding) ctx.ioStallBegin = begin;
+
+			int n = std::min<size_t>(FLOW_KNOBS->MAX_OUTSTANDING - ctx.outstanding, ctx.queue.size());
+			n = std::min<int>(n, ctx.sqEntries - unsubmitted);
+
+			for(int i=0; i<n; i++) {
+				auto io = ctx.queue.top();
+				ctx.queue.pop();
+				io->startTime = now();
+
+				if(ctx.ioTimeout > 0) {
+					ctx.appendToRequestList(io);
+				}
+
+				if (io->owner->lastFileSize != io->owner->nextFileSize) {
+					++ctx.countPreSubmitTruncate;
+					int64_t truncateSize = io->owner->nextFileSize - io->owner->lastFileSize;
+					ASSERT(truncateSize > 0);
+					ctx.preSubmitTruncateBytes += truncateSize;
+					io->owner->truncate(io->owner->nextFileSize);
+				}
+
+				uint32_t index = tail & ctx.sqMask;
+				io->prepare( &ctx.sqes[index] );
+				ctx.sqArray[index] = index;
+				++tail;
+			}
+			__atomic_store_n(ctx.sqTail, tail, __ATOMIC_RELEASE);
+			ctx.outstanding += n;
+			unsubmitted += n;
+
+			// Everything in the submission queue is submitted by a single system call (or none, if the kernel is polling
+			// the queue).  Entries the kernel doesn't accept stay in the queue and are submitted by the next launch().
+			if (!ctx.sqPoll) {
+				int rc;
+				loop {
+					rc = io_uring_enter( ctx.ringFd, unsubmitted, 0, 0 );
+					if (rc>=0 || errno!=EINTR) break;
+				}
+				if (rc<0 && errno != EAGAIN && errno != EBUSY) {
+					TraceEvent(SevError, "IOUringEnterError").GetLastError();
+					throw io_error();
+				}
+			} else if (__atomic_load_n(ctx.sqFlags, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP) {
+				io_uring_enter( ctx.ringFd, 0, 0, IORING_ENTER_SQ_WAKEUP );
+			}
+
+			ctx.submitMetric = false;
+			++ctx.countAIOSubmit;
+
+			double elapsed = timer_monotonic() - begin;
+			g_network->networkMetrics.secSquaredSubmit += elapsed*elapsed/2;
+		}
+	}
+
+	bool failed;
+private:
+	int fd, flags;
+	int fixedFileSlot; // index in the ring's registered file table, or -1
+	int64_t lastFileSize, nextFileSize;
+	std::string filename;
+	Int64MetricHandle countFileLogicalWrites;
+	Int64MetricHandle countFileLogicalReads;
+
+	Int64MetricHandle countLogicalWrites;
+	Int64MetricHandle countLogicalReads;
+
+	struct IOBlock : FastAllocated<IOBlock> {
+		Promise<int> result;
+		Reference<AsyncFileIOUring> owner;
+		uint8_t opcode;
+		uint32_t opFlags;
+		struct iovec iov;
+		int64_t offset;
+		int64_t prio;
+		IOBlock *prev;
+		IOBlock *next;
+		double startTime;
+
+		struct indirect_order_by_priority { bool operator () ( IOBlock* a, IOBlock* b ) { return a->prio < b->prio; } };
+
+		IOBlock(uint8_t opcode, uint32_t opFlags) : opcode(opcode), opFlags(opFlags), offset(0), prev(nullptr), next(nullptr), startTime(0) {
+			iov.iov_base = nullptr;
+			iov.iov_len = 0;
+		}
+
+		int getTask() const { return (prio>>32)+1; }
+
+		void prepare( linux_uring_sqe* sqe ) {
+			memset( sqe, 0, sizeof(linux_uring_sqe) );
+			sqe->opcode = opcode;
+			if (owner->fixedFileSlot >= 0) {
+				sqe->fd = owner->fixedFileSlot;
+				sqe->flags |= IOSQE_FIXED_FILE;
+			} else {
+				sqe->fd = owner->fd;
+			}
+			if (opcode != IORING_OP_FSYNC) {
+				sqe->addr = (uint64_t)&iov;
+				sqe->len = 1;
+				sqe->off = offset;
+			}
+			sqe->op_flags = opFlags;
+			sqe->user_data = (uint64_t)this;
+		}
+
+		ACTOR static void deliver( Promise<int> result, bool failed, int r, int task ) {
+			Void _ = wait( delay(0, task) );
+			if (failed) result.sendError(io_timeout());
+			else if (r < 0) result.sendError(io_error());
+			else result.send(r);
+		}
+
+		void setResult( int r ) {
+			if (r<0) {
+				struct stat fst;
+				fstat( owner->fd, &fst );
+
+				errno = -r;
+				TraceEvent("AsyncFileIOUringIOError").GetLastError().detail("fd", owner->fd).detail("op", opcode).detail("nbytes", iov.iov_len).detail("offset", offset).detail("ptr", int64_t(iov.iov_base))
+					.detail("Size", fst.st_size).detail("filename", owner->filename);
+			}
+			deliver( result, owner->failed, r, getTask() );
+			delete this;
+		}
+
+		void timeout(bool warnOnly) {
+			TraceEvent(SevWarnAlways, "AsyncFileIOUringTimeout").detail("fd", owner->fd).detail("op", opcode).detail("nbytes", iov.iov_len).detail("offset", offset).detail("ptr", int64_t(iov.iov_base))
+				.detail("filename", owner->filename);
+			g_network->setGlobal(INetwork::enASIOTimedOut, (flowGlobalType)true);
+
+			if(!warnOnly)
+				owner->failed = true;
+		}
+	};
+
+	struct Context {
+		int ringFd;
+		bool sqPoll;
+		uint32_t *sqHead, *sqTail, *sqFlags, *sqArray;
+		uint32_t sqMask, sqEntries;
+		linux_uring_sqe* sqes;
+		uint32_t *cqHead, *cqTail;
+		uint32_t cqMask;
+		linux_uring_cqe* cqes;
+		std::vector<int> freeFileSlots;
+
+		int evfd;
+		int outstanding;
+		double ioStallBegin;
+		bool fallocateSupported;
+		bool fallocateZeroSupported;
+		std::priority_queue<IOBlock*, std::vector<IOBlock*>, IOBlock::indirect_order_by_priority> queue;
+		Int64MetricHandle countAIOSubmit;
+		Int64MetricHandle countAIOCollect;
+		Int64MetricHandle submitMetric;
+
+		double ioTimeout;
+		bool timeoutWarnOnly;
+		IOBlock *submittedRequestList;
+
+		Int64MetricHandle countPreSubmitTruncate;
+		Int64MetricHandle preSubmitTruncateBytes;
+
+		uint32_t opsIssued;
+		Context() : ringFd(-1), sqPoll(false), sqHead(nullptr), sqTail(nullptr), sqFlags(nullptr), sqArray(nullptr), sqMask(0), sqEntries(0), sqes(nullptr),
+			cqHead(nullptr), cqTail(nullptr), cqMask(0), cqes(nullptr), evfd(-1), outstanding(0), opsIssued(0), ioStallBegin(0),
+			fallocateSupported(true), fallocateZeroSupported(true), submittedRequestList(nullptr) {
+			setIOTimeout(0);
+		}
+
+		void setIOTimeout(double timeout) {
+			ioTimeout = fabs(timeout);
+			timeoutWarnOnly = timeout < 0;
+		}
+
+		bool updateFixedFile(int slot, int fd) {
+			linux_uring_files_update update;
+			update.offset = slot;
+			update.resv = 0;
+			update.fds = (uint64_t)&fd;
+			return io_uring_register( ringFd, IORING_REGISTER_FILES_UPDATE, &update, 1 ) == 1;
+		}
+
+		void appendToRequestList(IOBlock *io) {
+			ASSERT(!io->next && !io->prev);
+
+			if(submittedRequestList) {
+				io->prev = submittedRequestList->prev;
+				io->prev->next = io;
+
+				submittedRequestList->prev = io;
+				io->next = submittedRequestList;
+			}
+			else {
+				submittedRequestList = io;
+				io->next = io->prev = io;
+			}
+		}
+
+		void removeFromRequestList(IOBlock *io) {
+			if(io->next == nullptr) {
+				ASSERT(io->prev == nullptr);
+				return;
+			}
+
+			ASSERT(io->prev != nullptr);
+
+			if(io == io->next) {
+				ASSERT(io == submittedRequestList && io == io->prev);
+				submittedRequestList = nullptr;
+			}
+			else {
+				io->next->prev = io->prev;
+				io->prev->next = io->next;
+
+				if(submittedRequestList == io) {
+					submittedRequestList = io->next;
+				}
+			}
+
+			io->next = io->prev = nullptr;
+		}
+	};
+	static Context ctx;
+
+	explicit AsyncFileIOUring(int fd, int flags, std::string const& filename) : fd(fd), flags(flags), filename(filename), failed(false), fixedFileSlot(-1) {
+		if( !g_network->isSimulated() ) {
+			countFileLogicalWrites.init(LiteralStringRef("AsyncFile.CountFileLogicalWrites"), filename);
+			countFileLogicalReads.init( LiteralStringRef("AsyncFile.CountFileLogicalReads"), filename);
+			countLogicalWrites.init(LiteralStringRef("AsyncFile.CountLogicalWrites"));
+			countLogicalReads.init( LiteralStringRef("AsyncFile.CountLogicalReads"));
+		}
+
+		if (!ctx.freeFileSlots.empty()) {
+			int slot = ctx.freeFileSlots.back();
+			if (ctx.updateFixedFile(slot, fd)) {
+				ctx.freeFileSlots.pop_back();
+				fixedFileSlot = slot;
+			}
+		}
+	}
+
+	void enqueue( IOBlock* io, AsyncFileIOUring* owner ) {
+		ASSERT( int64_t(io->iov.iov_base) % 4096 == 0 && io->offset % 4096 == 0 && io->iov.iov_len % 4096 == 0 );
+
+		io->prio = (int64_t(g_network->getCurrentTask())<<32) - (++ctx.opsIssued);
+		io->owner = Reference<AsyncFileIOUring>::addRef(owner);
+
+		ctx.queue.push(io);
+	}
+
+	static int openFlags(int flags) {
+		int oflags = 0;
+		ASSERT( bool(flags & OPEN_READONLY) != bool(flags & OPEN_READWRITE) );  // readonly xor readwrite
+		if( flags & OPEN_EXCLUSIVE ) oflags |= O_EXCL;
+		if( flags & OPEN_CREATE )    oflags |= O_CREAT;
+		if( flags & OPEN_READONLY )  oflags |= O_RDONLY;
+		if( flags & OPEN_READWRITE ) oflags |= O_RDWR;
+		if( flags & OPEN_ATOMIC_WRITE_AND_CREATE ) oflags |= O_TRUNC;
+		if( flags & OPEN_DSYNC )     oflags |= O_DSYNC;
+		return oflags;
+	}
+
+	ACTOR static void poll( Reference<IEventFD> ev ) {
+		loop {
+			int64_t evfd_count = wait( ev->read() );
+
+			Void _ = wait(delay(0, TaskDiskIOComplete));
+
+			uint32_t head = *ctx.cqHead;
+			uint32_t tail = __atomic_load_n(ctx.cqTail, __ATOMIC_ACQUIRE);
+			int n = tail - head;
+
+			++ctx.countAIOCollect;
+			if (n) {
+				double t = timer_monotonic();
+				double elapsed = t - ctx.ioStallBegin;
+				ctx.ioStallBegin = t;
+				g_network->networkMetrics.secSquaredDiskStall += elapsed*elapsed/2;
+			}
+
+			ctx.outstanding -= n;
+
+			if(ctx.ioTimeout > 0) {
+				double currentTime = now();
+				while(ctx.submittedRequestList && currentTime - ctx.submittedRequestList->startTime > ctx.ioTimeout) {
+					ctx.submittedRequestList->timeout(ctx.timeoutWarnOnly);
+					ctx.removeFromRequestList(ctx.submittedRequestList);
+				}
+			}
+
+			for(; head != tail; ++head) {
+				linux_uring_cqe const& cqe = ctx.cqes[head & ctx.cqMask];
+				IOBlock* iob = (IOBlock*)cqe.user_data;
+
+				if(ctx.ioTimeout > 0) {
+					ctx.removeFromRequestList(iob);
+				}
+
+				iob->setResult( cqe.res );
+			}
+			__atomic_store_n(ctx.cqHead, tail, __ATOMIC_RELEASE);
+		}
+	}
+};
+
+ACTOR Future<Void> ioUringReadWriteTest(Reference<IAsyncFile> f, int fileSize) {
+	state uint8_t* writeBuf = (uint8_t*)FastAllocator<4096>::allocate();
+	state uint8_t* readBuf = (uint8_t*)FastAllocator<4096>::allocate();
+	state std::vector<Future<Void>> writes;
+	state int page;
+
+	// Write a distinct pattern to every page, making it durable, then read each page back
+	for(page = 0; page < fileSize / 4096; page++) {
+		memset(writeBuf, page & 0xff, 4096);
+		Void _ = wait(f->write(writeBuf, 4096, page * 4096));
+	}
+	Void _ = wait(f->sync());
+
+	for(page = 0; page < fileSize / 4096; page++) {
+		int bytesRead = wait(f->read(readBuf, 4096, page * 4096));
+		ASSERT(bytesRead == 4096);
+		for(int i = 0; i < 4096; i++)
+			ASSERT(readBuf[i] == (page & 0xff));
+	}
+
+	FastAllocator<4096>::release(writeBuf);
+	FastAllocator<4096>::release(readBuf);
+	return Void();
+}
+
+TEST_CASE("fdbrpc/AsyncFileIOUring/ReadWrite") {
+	if(!g_network->isSimulated() && AsyncFileIOUring::isInitialized()) { // This test does nothing unless the process is using io_uring
+		state Reference<IAsyncFile> f = wait(AsyncFileIOUring::open("/tmp/__IOURING_TEST_FILE__", IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_CREATE, 0666, nullptr));
+		try {
+			state int fileSize = 1<<20;
+			Void _ = wait(f->truncate(fileSize));
+			Void _ = wait(ioUringReadWriteTest(f, fileSize));
+		}
+		catch(Error &e) {
+			state Error err = e;
+			Void _ = wait(AsyncFileEIO::deleteFile(f->getFilename(), true));
+			throw err;
+		}
+
+		Void _ = wait(AsyncFileEIO::deleteFile(f->getFilename(), true));
+	}
+
+	return Void();
+}
+
+AsyncFileIOUring::Context AsyncFileIOUring::ctx;
+
+#endif
+#endif
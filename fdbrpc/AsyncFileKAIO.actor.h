@@ -33,6 +33,7 @@
 #include <sys/stat.h>
 #include <sys/eventfd.h>
 #include <sys/syscall.h>
+#include <sys/uio.h>
 #include "fdbrpc/linux_kaio.h"
 #include "flow/Knobs.h"
 #include "flow/UnitTest.h"
@@ -148,6 +149,8 @@ public:
 		}
 
 		r->lastFileSize = r->nextFileSize = buf.st_size;
+		r->device = buf.st_dev;
+		r->latencies = &g_network->diskLatencyProfile.byDevice[buf.st_dev];
 		return Reference<IAsyncFile>(std::move(r));
 	}
 
@@ -159,6 +162,7 @@ public:
 			ctx.countPreSubmitTruncate.init(LiteralStringRef("AsyncFile.CountPreAIOSubmitTruncate"));
 			ctx.preSubmitTruncateBytes.init(LiteralStringRef("AsyncFile.PreAIOSubmitTruncateBytes"));
 			ctx.slowAioSubmitMetric.init(LiteralStringRef("AsyncFile.SlowAIOSubmit"));
+			ctx.countCoalesced.init(LiteralStringRef("AsyncFile.CountAIOCoalesced"));
 		}
 		
 		int rc = io_setup( FLOW_KNOBS->MAX_OUTSTANDING, &ctx.iocx );
@@ -353,24 +357,27 @@ public:
 			if (!ctx.outstanding) ctx.ioStallBegin = begin;
 
 			IOBlock* toStart[FLOW_KNOBS->MAX_OUTSTANDING];
-			int n = std::min<size_t>(FLOW_KNOBS->MAX_OUTSTANDING - ctx.outstanding, ctx.queue.size());
+			int limit = std::min<size_t>(FLOW_KNOBS->MAX_OUTSTANDING - ctx.outstanding, ctx.queue.size());
+			int n = 0;
 
 			int64_t previousTruncateCount = ctx.countPreSubmitTruncate;
 			int64_t previousTruncateBytes = ctx.preSubmitTruncateBytes;
 			int64_t largestTruncate = 0;
 
-			for(int i=0; i<n; i++) {
+			// Operations whose file or device is already at its queue depth limit wait for a later launch, so that
+			// (for example) background reads can't occupy every slot in the device queue ahead of a log commit
+			std::vector<IOBlock*> deferred;
+			while(n < limit && ctx.queue.size()) {
 				auto io = ctx.queue.top();
+				ctx.queue.pop();
+				if (!ctx.reserve(io)) {
+					deferred.push_back(io);
+					continue;
+				}
 
 				KAIOLogBlockEvent(io, OpLogEntry::LAUNCH);
 
-				ctx.queue.pop();
-				toStart[i] = io;
-				io->startTime = now();
-
-				if(ctx.ioTimeout > 0) {
-					ctx.appendToRequestList(io);
-				}
+				toStart[n++] = io;
 
 				if (io->owner->lastFileSize != io->owner->nextFileSize) {
 					++ctx.countPreSubmitTruncate;
@@ -381,7 +388,20 @@ public:
 					io->owner->truncate(io->owner->nextFileSize);
 				}
 			}
+			for(auto io : deferred)
+				ctx.queue.push(io);
+
+			n = coalesce(toStart, n);
+			for(int i=0; i<n; i++) {
+				toStart[i]->startTime = now();
+				if(ctx.ioTimeout > 0) {
+					ctx.appendToRequestList(toStart[i]);
+				}
+			}
+
 			double truncateComplete = timer_monotonic();
+			for(int i=0; i<n; i++)
+				toStart[i]->submitTime = truncateComplete;
 			int rc = io_submit( ctx.iocx, n, (linux_iocb**)toStart );
 			double end = timer_monotonic();
 
@@ -417,6 +437,7 @@ public:
 				} else {
 					KAIOLogBlockEvent(toStart[0], OpLogEntry::COMPLETE, errno ? -errno : -1000000);
 					// Other errors are assumed to represent failure to issue the first I/O in the list
+					ctx.removeFromRequestList(toStart[0]);
 					toStart[0]->setResult( errno ? -errno : -1000000 );
 					rc = 1;
 				}
@@ -425,15 +446,24 @@ public:
 			// Any unsubmitted I/Os need to be requeued
 			for(int i=rc; i<n; i++) {
 				KAIOLogBlockEvent(toStart[i], OpLogEntry::REQUEUE);
+				ctx.removeFromRequestList(toStart[i]);
+				ctx.release(toStart[i]);
 				ctx.queue.push(toStart[i]);
 			}
 		}
 	}
 
+	// Limits the number of this file's I/Os that are submitted to the kernel at once (0 for no limit beyond MAX_OUTSTANDING)
+	void setMaxOutstanding( int maxOutstanding ) { this->maxOutstanding = maxOutstanding; }
+
 	bool failed;
 private:
 	int fd, flags;
 	int64_t lastFileSize, nextFileSize;
+	dev_t device;
+	DiskLatencyProfile::Latencies* latencies;
+	int outstanding;
+	int maxOutstanding;
 	std::string filename;
 	Int64MetricHandle countFileLogicalWrites;
 	Int64MetricHandle countFileLogicalReads;
@@ -448,13 +478,22 @@ private:
 		IOBlock *prev;
 		IOBlock *next;
 		double startTime;
+		double submitTime; // timer_monotonic() when io_submit() was called
+		bool reserved; // counted against the owner's and device's queue depth limits
+		std::vector<IOBlock*> coalesced; // I/Os merged into this one, which complete when it does
+		std::vector<struct iovec> iovecs; // if coalesced is nonempty, this I/O's own buffer followed by each of theirs
 #if KAIO_LOGGING
 		int32_t iolog_id;
 #endif
 
 		struct indirect_order_by_priority { bool operator () ( IOBlock* a, IOBlock* b ) { return a->prio < b->prio; } };
+		struct order_by_position { bool operator () ( IOBlock* a, IOBlock* b ) {
+			if (a->owner.getPtr() != b->owner.getPtr()) return a->owner.getPtr() < b->owner.getPtr();
+			if (a->aio_lio_opcode != b->aio_lio_opcode) return a->aio_lio_opcode < b->aio_lio_opcode;
+			return a->offset < b->offset;
+		} };
 
-		IOBlock(int op, int fd) : prev(nullptr), next(nullptr), startTime(0) {
+		IOBlock(int op, int fd) : prev(nullptr), next(nullptr), startTime(0), submitTime(0), reserved(false) {
 			memset((linux_iocb*)this, 0, sizeof(linux_iocb));
 			aio_lio_opcode = op;
 			aio_fildes = fd;
@@ -464,6 +503,24 @@ private:
 		}
 
 		int getTask() const { return (prio>>32)+1; }
+		bool isBackground() const { return getTask() < TaskDefaultYield; }
+
+		// Turns this I/O into a vectored one that also performs io, which must immediately follow it in the same file
+		void coalesce( IOBlock* io ) {
+			if (coalesced.empty()) {
+				iovecs.push_back(iovec());
+				iovecs.back().iov_base = buf;
+				iovecs.back().iov_len = nbytes;
+			}
+			iovecs.push_back(iovec());
+			iovecs.back().iov_base = io->buf;
+			iovecs.back().iov_len = io->nbytes;
+			coalesced.push_back(io);
+
+			aio_lio_opcode = aio_lio_opcode == IO_CMD_PREAD || aio_lio_opcode == IO_CMD_PREADV ? IO_CMD_PREADV : IO_CMD_PWRITEV;
+			buf = &iovecs[0];
+			nbytes = iovecs.size();
+		}
 
 		ACTOR static void deliver( Promise<int> result, bool failed, int r, int task ) {
 			Void _ = wait( delay(0, task) );
@@ -472,6 +529,17 @@ private:
 			else result.send(r);
 		}
 
+		// Records the latency and bytes of this I/O, and of the I/Os coalesced into it, against the device
+		void recordLatency( double completeTime, int64_t result ) {
+			if (!owner || !owner->latencies) return;
+			double latency = completeTime - submitTime;
+			int64_t bytes = std::max<int64_t>( result, 0 );
+			if (aio_lio_opcode == IO_CMD_PREAD || aio_lio_opcode == IO_CMD_PREADV)
+				g_network->diskLatencyProfile.record(owner->latencies, false, latency, 1 + coalesced.size(), bytes);
+			else if (aio_lio_opcode == IO_CMD_PWRITE || aio_lio_opcode == IO_CMD_PWRITEV)
+				g_network->diskLatencyProfile.record(owner->latencies, true, latency, 1 + coalesced.size(), bytes);
+		}
+
 		void setResult( int r ) {
 			if (r<0) {
 				struct stat fst;
@@ -481,6 +549,21 @@ private:
 				TraceEvent("AsyncFileKAIOIOError").GetLastError().detail("fd", aio_fildes).detail("op", aio_lio_opcode).detail("nbytes", nbytes).detail("offset", offset).detail("ptr", int64_t(buf))
 					.detail("Size", fst.st_size).detail("filename", owner->filename);
 			}
+			ctx.release(this);
+
+			if (!coalesced.empty()) {
+				// Split the result of a vectored I/O between the operations that were merged into it
+				int64_t bytesBefore = iovecs[0].iov_len;
+				for(int i = 0; i < coalesced.size(); i++) {
+					int64_t length = iovecs[i+1].iov_len;
+					int pieceResult = r < 0 ? r : (int)std::max<int64_t>(0, std::min<int64_t>(length, r - bytesBefore));
+					deliver( coalesced[i]->result, owner->failed, pieceResult, coalesced[i]->getTask() );
+					delete coalesced[i];
+					bytesBefore += length;
+				}
+				if (r >= 0) r = std::min<int64_t>(r, iovecs[0].iov_len);
+			}
+
 			deliver( result, owner->failed, r, getTask() );
 			delete this;
 		}
@@ -513,9 +596,37 @@ private:
 
 		Int64MetricHandle countPreSubmitTruncate;
 		Int64MetricHandle preSubmitTruncateBytes;
+		Int64MetricHandle countCoalesced;
 
 		EventMetricHandle<SlowAioSubmit> slowAioSubmitMetric;
 
+		std::map<dev_t, int> backgroundOutstanding; // per device
+
+		// Counts io against its file's and device's queue depth limits, returning false if either is already reached
+		bool reserve( IOBlock* io ) {
+			ASSERT( !io->reserved );
+			AsyncFileKAIO* file = io->owner.getPtr();
+			if (file->maxOutstanding > 0 && file->outstanding >= file->maxOutstanding)
+				return false;
+			if (io->isBackground()) {
+				int& deviceOutstanding = backgroundOutstanding[file->device];
+				if (FLOW_KNOBS->KAIO_MAX_BACKGROUND_OUTSTANDING_PER_DEVICE > 0 && deviceOutstanding >= FLOW_KNOBS->KAIO_MAX_BACKGROUND_OUTSTANDING_PER_DEVICE)
+					return false;
+				++deviceOutstanding;
+			}
+			++file->outstanding;
+			io->reserved = true;
+			return true;
+		}
+
+		void release( IOBlock* io ) {
+			if (!io->reserved) return;
+			io->reserved = false;
+			--io->owner->outstanding;
+			if (io->isBackground())
+				--backgroundOutstanding[io->owner->device];
+		}
+
 		uint32_t opsIssued;
 		Context() : iocx(0), evfd(-1), outstanding(0), opsIssued(0), ioStallBegin(0), fallocateSupported(true), fallocateZeroSupported(true), submittedRequestList(nullptr) {
 			setIOTimeout(0);
@@ -568,7 +679,7 @@ private:
 	};
 	static Context ctx;
 
-	explicit AsyncFileKAIO(int fd, int flags, std::string const& filename) : fd(fd), flags(flags), filename(filename), failed(false) {
+	explicit AsyncFileKAIO(int fd, int flags, std::string const& filename) : fd(fd), flags(flags), filename(filename), failed(false), device(0), latencies(NULL), outstanding(0), maxOutstanding(FLOW_KNOBS->KAIO_MAX_OUTSTANDING_PER_FILE) {
 
 		if( !g_network->isSimulated() ) {
 			countFileLogicalWrites.init(LiteralStringRef("AsyncFile.CountFileLogicalWrites"), filename);
@@ -625,6 +736,35 @@ private:
 		ctx.queue.push(io);
 	}
 
+	// Merges reads (or writes) in toStart[0..n) which are contiguous in the same file into vectored I/Os, so that they
+	// take a single slot in the kernel and device queues.  Returns the number of I/Os left in toStart.
+	static int coalesce( IOBlock** toStart, int n ) {
+		if (FLOW_KNOBS->KAIO_COALESCE_LIMIT <= 1 || n <= 1)
+			return n;
+
+		std::sort( toStart, toStart + n, IOBlock::order_by_position() );
+		int count = 0;
+		int op = -1; // the operation that can be merged into toStart[count-1], if any
+		int64_t end = 0;
+		for(int i = 0; i < n; i++) {
+			IOBlock* io = toStart[i];
+			if (count && io->aio_lio_opcode == op && io->owner == toStart[count-1]->owner && io->offset == end &&
+				toStart[count-1]->coalesced.size() + 1 < FLOW_KNOBS->KAIO_COALESCE_LIMIT)
+			{
+				toStart[count-1]->coalesce(io);
+				ctx.release(io);
+				++ctx.countCoalesced;
+				end += io->nbytes;
+				continue;
+			}
+			toStart[count++] = io;
+			// I/Os that are already vectored were requeued after a partial submission and are left alone
+			op = io->aio_lio_opcode == IO_CMD_PREAD || io->aio_lio_opcode == IO_CMD_PWRITE ? io->aio_lio_opcode : -1;
+			end = io->offset + io->nbytes;
+		}
+		return count;
+	}
+
 	static int openFlags(int flags) {
 		int oflags = 0;
 		ASSERT( bool(flags & OPEN_READONLY) != bool(flags & OPEN_READWRITE) );  // readonly xor readwrite
@@ -633,6 +773,7 @@ private:
 		if( flags & OPEN_READONLY )  oflags |= O_RDONLY;
 		if( flags & OPEN_READWRITE ) oflags |= O_RDWR;
 		if( flags & OPEN_ATOMIC_WRITE_AND_CREATE ) oflags |= O_TRUNC;
+		if( flags & OPEN_DSYNC )     oflags |= O_DSYNC;
 		return oflags;
 	}
 
@@ -659,8 +800,8 @@ private:
 				TraceEvent("IOGetEventsError").GetLastError();
 				throw io_error();
 			}
+			double t = timer_monotonic();
 			if (n) {
-				double t = timer_monotonic();
 				double elapsed = t - ctx.ioStallBegin;
 				ctx.ioStallBegin = t;
 				g_network->networkMetrics.secSquaredDiskStall += elapsed*elapsed/2;
@@ -685,6 +826,7 @@ private:
 					ctx.removeFromRequestList(iob);
 				}
 
+				iob->recordLatency( t, ev[i].result );
 				iob->setResult( ev[i].result );
 			}
 		}
@@ -27,6 +27,7 @@
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
 #include "IAsyncFile.h"
+#include "flow/IThreadPool.h"
 
 json_spirit::mObject BlobStoreEndpoint::Stats::getJSON() {
 	json_spirit::mObject o;
@@ -34,6 +35,9 @@ json_spirit::mObject BlobStoreEndpoint::Stats::getJSON() {
 	o["requests_failed"] = requests_failed;
 	o["requests_successful"] = requests_successful;
 	o["bytes_sent"] = bytes_sent;
+	o["bytes_read"] = bytes_read;
+	o["read_cache_hits"] = read_cache_hits;
+	o["read_cache_misses"] = read_cache_misses;
 
 	return o;
 }
@@ -43,6 +47,9 @@ BlobStoreEndpoint::Stats BlobStoreEndpoint::Stats::operator-(const Stats &rhs) {
 	r.requests_failed = requests_failed - rhs.requests_failed;
 	r.requests_successful = requests_successful - rhs.requests_successful;
 	r.bytes_sent = bytes_sent - rhs.bytes_sent;
+	r.bytes_read = bytes_read - rhs.bytes_read;
+	r.read_cache_hits = read_cache_hits - rhs.read_cache_hits;
+	r.read_cache_misses = read_cache_misses - rhs.read_cache_misses;
 	return r;
 }
 
@@ -58,8 +65,10 @@ BlobStoreEndpoint::BlobKnobs::BlobKnobs() {
 	concurrent_requests = CLIENT_KNOBS->BLOBSTORE_CONCURRENT_REQUESTS;
 	multipart_max_part_size = CLIENT_KNOBS->BLOBSTORE_MULTIPART_MAX_PART_SIZE;
 	multipart_min_part_size = CLIENT_KNOBS->BLOBSTORE_MULTIPART_MIN_PART_SIZE;
+	multipart_target_seconds = CLIENT_KNOBS->BLOBSTORE_MULTIPART_TARGET_SECONDS;
 	concurrent_uploads = CLIENT_KNOBS->BLOBSTORE_CONCURRENT_UPLOADS;
 	concurrent_lists = CLIENT_KNOBS->BLOBSTORE_CONCURRENT_LISTS;
+	delete_batch_size = CLIENT_KNOBS->BLOBSTORE_DELETE_BATCH_SIZE;
 	concurrent_reads_per_file = CLIENT_KNOBS->BLOBSTORE_CONCURRENT_READS_PER_FILE;
 	concurrent_writes_per_file = CLIENT_KNOBS->BLOBSTORE_CONCURRENT_WRITES_PER_FILE;
 	read_block_size = CLIENT_KNOBS->BLOBSTORE_READ_BLOCK_SIZE;
@@ -80,8 +89,10 @@ bool BlobStoreEndpoint::BlobKnobs::set(StringRef name, int value) {
 	TRY_PARAM(concurrent_requests, cr);
 	TRY_PARAM(multipart_max_part_size, maxps);
 	TRY_PARAM(multipart_min_part_size, minps);
+	TRY_PARAM(multipart_target_seconds, mpts);
 	TRY_PARAM(concurrent_uploads, cu);
 	TRY_PARAM(concurrent_lists, cl);
+	TRY_PARAM(delete_batch_size, dbs);
 	TRY_PARAM(concurrent_reads_per_file, crpf);
 	TRY_PARAM(concurrent_writes_per_file, cwpf);
 	TRY_PARAM(read_block_size, rbs);
@@ -107,8 +118,10 @@ std::string BlobStoreEndpoint::BlobKnobs::getURLParameters() const {
 	_CHECK_PARAM(concurrent_requests, cr);
 	_CHECK_PARAM(multipart_max_part_size, maxps);
 	_CHECK_PARAM(multipart_min_part_size, minps);
+	_CHECK_PARAM(multipart_target_seconds, mpts);
 	_CHECK_PARAM(concurrent_uploads, cu);
 	_CHECK_PARAM(concurrent_lists, cl);
+	_CHECK_PARAM(delete_batch_size, dbs);
 	_CHECK_PARAM(concurrent_reads_per_file, crpf);
 	_CHECK_PARAM(concurrent_writes_per_file, cwpf);
 	_CHECK_PARAM(read_block_size, rbs);
@@ -215,6 +228,87 @@ Future<Void> BlobStoreEndpoint::deleteObject(std::string const &bucket, std::str
 	return deleteObject_impl(Reference<BlobStoreEndpoint>::addRef(this), bucket, object);
 }
 
+static std::string xmlEscape(std::string const &s) {
+	std::string r;
+	for(char c : s) {
+		switch(c) {
+			case '&': r.append("&amp;"); break;
+			case '<': r.append("&lt;"); break;
+			case '>': r.append("&gt;"); break;
+			case '"': r.append("&quot;"); break;
+			case '\'': r.append("&apos;"); break;
+			default: r.push_back(c);
+		}
+	}
+	return r;
+}
+
+// Delete objects with one multi-object delete request, or one at a time if the blob store does not support that
+ACTOR Future<Void> deleteObjectBatch(Reference<BlobStoreEndpoint> b, std::string bucket, std::vector<std::string> objects) {
+	if(objects.size() > 1 && !b->batchDeleteUnsupported) {
+		state UnsentPacketQueue packets;
+		state int contentLen;
+		{
+			// In quiet mode the response only lists objects that could not be deleted
+			std::string content = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><Delete><Quiet>true</Quiet>";
+			for(auto &object : objects)
+				content.append("<Object><Key>").append(xmlEscape(object)).append("</Key></Object>");
+			content.append("</Delete>");
+			PacketWriter pw(packets.getWriteBuffer(), NULL, Unversioned());
+			pw.serializeBytes(content);
+			contentLen = content.size();
+		}
+
+		// Required by the blob store for multi-object deletes
+		std::string contentMD5 = wait(BlobStoreEndpoint::calculateContentMD5(&packets));
+		HTTP::Headers headers;
+		headers["Content-MD5"] = contentMD5;
+		Reference<HTTP::Response> r = wait(b->doRequest("POST", std::string("/") + bucket + "?delete", headers, &packets, contentLen, {200, 400, 404, 405, 501}));
+
+		if(r->code == 200) {
+			if(r->content.find("Error") == std::string::npos)
+				return Void();
+			TraceEvent(SevWarn, "BlobStoreEndpointBatchDeleteIncomplete").detail("Bucket", bucket).detail("Objects", objects.size()).suppressFor(60, true);
+		}
+		else {
+			TraceEvent(SevWarn, "BlobStoreEndpointBatchDeleteUnsupported").detail("Bucket", bucket).detail("Code", r->code).suppressFor(60, true);
+			b->batchDeleteUnsupported = true;
+		}
+	}
+
+	// Deleting objects which are already gone is harmless, so after a partial failure just delete all of them individually
+	std::vector<Future<Void>> deletes;
+	for(auto &object : objects)
+		deletes.push_back(b->deleteObject(bucket, object));
+	Void _ = wait(waitForAll(deletes));
+	return Void();
+}
+
+ACTOR Future<Void> deleteObjects_impl(Reference<BlobStoreEndpoint> b, std::string bucket, std::vector<std::string> objects) {
+	state int batchSize = std::max(1, b->knobs.delete_batch_size);
+	state std::list<Future<Void>> batches;
+	state int begin = 0;
+
+	while(begin < objects.size()) {
+		int end = std::min<int>(objects.size(), begin + batchSize);
+		batches.push_back(deleteObjectBatch(b, bucket, std::vector<std::string>(objects.begin() + begin, objects.begin() + end)));
+		begin = end;
+
+		// Batches beyond the request concurrency limit would just wait, so don't build them yet
+		while(batches.size() > b->knobs.concurrent_requests) {
+			Void _ = wait(batches.front());
+			batches.pop_front();
+		}
+	}
+
+	Void _ = wait(waitForAll(std::vector<Future<Void>>(batches.begin(), batches.end())));
+	return Void();
+}
+
+Future<Void> BlobStoreEndpoint::deleteObjects(std::string const &bucket, std::vector<std::string> const &objects) {
+	return deleteObjects_impl(Reference<BlobStoreEndpoint>::addRef(this), bucket, objects);
+}
+
 ACTOR Future<Void> deleteRecursively_impl(Reference<BlobStoreEndpoint> b, std::string bucket, std::string prefix, int *pNumDeleted) {
 	state PromiseStream<BlobStoreEndpoint::ListResult> resultStream;
 	// Start a recursive parallel listing which will send results to resultStream as they are received
@@ -226,6 +320,8 @@ ACTOR Future<Void> deleteRecursively_impl(Reference<BlobStoreEndpoint> b, std::s
 	});
 
 	state std::list<Future<Void>> deleteFutures;
+	state std::vector<std::string> batch;
+	state int batchSize = std::max(1, b->knobs.delete_batch_size);
 	try {
 		loop {
 			choose {
@@ -235,17 +331,23 @@ ACTOR Future<Void> deleteRecursively_impl(Reference<BlobStoreEndpoint> b, std::s
 				}
 
 				when(BlobStoreEndpoint::ListResult list = waitNext(resultStream.getFuture())) {
-					for(auto &object : list.objects) {
-						int *pNumDeletedCopy = pNumDeleted;   // avoid capture of this
-						deleteFutures.push_back(map(b->deleteObject(bucket, object.name), [pNumDeletedCopy](Void) -> Void {
-							if(pNumDeletedCopy != nullptr)
-								++*pNumDeletedCopy;
-							return Void();
-						}));
-					}
+					for(auto &object : list.objects)
+						batch.push_back(std::move(object.name));
 				}
 			}
 
+			// Send full batches, the last one is sent once listing is done
+			while(batch.size() >= batchSize) {
+				int *pNumDeletedCopy = pNumDeleted;   // avoid capture of this
+				int count = batchSize;
+				deleteFutures.push_back(map(b->deleteObjects(bucket, std::vector<std::string>(batch.end() - count, batch.end())), [pNumDeletedCopy, count](Void) -> Void {
+					if(pNumDeletedCopy != nullptr)
+						*pNumDeletedCopy += count;
+					return Void();
+				}));
+				batch.resize(batch.size() - count);
+			}
+
 			// This is just a precaution to avoid having too many outstanding delete actors waiting to run
 			while(deleteFutures.size() > CLIENT_KNOBS->BLOBSTORE_CONCURRENT_REQUESTS) {
 				Void _ = wait(deleteFutures.front());
@@ -257,6 +359,16 @@ ACTOR Future<Void> deleteRecursively_impl(Reference<BlobStoreEndpoint> b, std::s
 			throw;
 	}
 
+	if(!batch.empty()) {
+		int *pNumDeletedCopy = pNumDeleted;
+		int count = batch.size();
+		deleteFutures.push_back(map(b->deleteObjects(bucket, batch), [pNumDeletedCopy, count](Void) -> Void {
+			if(pNumDeletedCopy != nullptr)
+				*pNumDeletedCopy += count;
+			return Void();
+		}));
+	}
+
 	while(deleteFutures.size() > 0) {
 		Void _ = wait(deleteFutures.front());
 		deleteFutures.pop_front();
@@ -381,8 +493,8 @@ Future<Void> BlobStoreEndpoint::updateSecret() {
 ACTOR Future<BlobStoreEndpoint::ReusableConnection> connect_impl(Reference<BlobStoreEndpoint> b) {
 	// First try to get a connection from the pool
 	while(!b->connectionPool.empty()) {
-		BlobStoreEndpoint::ReusableConnection rconn = b->connectionPool.front();
-		b->connectionPool.pop();
+		BlobStoreEndpoint::ReusableConnection rconn = b->connectionPool.back();
+		b->connectionPool.pop_back();
 
 		// If the connection expires in the future then return it
 		if(rconn.expirationTime > now()) {
@@ -412,10 +524,15 @@ Future<BlobStoreEndpoint::ReusableConnection> BlobStoreEndpoint::connect() {
 }
 
 void BlobStoreEndpoint::returnConnection(ReusableConnection &rconn) {
-	// If it expires in the future then add it to the pool in the front
+	// If it expires in the future then add it to the back of the pool, where it will be reused first since it is the least
+	// likely to have been idled out by the server
 	if(rconn.expirationTime > now())
-		connectionPool.push(rconn);
+		connectionPool.push_back(rconn);
 	rconn.conn = Reference<IConnection>();
+
+	// Connections at the front are the ones unused for longest, so drop any there that have expired
+	while(!connectionPool.empty() && connectionPool.front().expirationTime <= now())
+		connectionPool.pop_front();
 }
 
 // Do a request, get a Response.
@@ -827,14 +944,7 @@ ACTOR Future<Void> writeEntireFile_impl(Reference<BlobStoreEndpoint> bstore, std
 	// TODO:  If this actor is used to send large files then combine the summing and packetization into a loop with a yield() every 20k or so.
 	Void _ = wait(yield());
 
-	MD5_CTX sum;
-	::MD5_Init(&sum);
-	::MD5_Update(&sum, content.data(), content.size());
-	std::string sumBytes;
-	sumBytes.resize(16);
-	::MD5_Final((unsigned char *)sumBytes.data(), &sum);
-	std::string contentMD5 = base64::encoder::from_string(sumBytes);
-	contentMD5.resize(contentMD5.size() - 1);
+	state std::string contentMD5 = wait(BlobStoreEndpoint::calculateContentMD5(&packets));
 
 	Void _ = wait(writeEntireFileFromBuffer_impl(bstore, bucket, object, &packets, content.size(), contentMD5));
 	return Void();
@@ -859,6 +969,7 @@ ACTOR Future<int> readObject_impl(Reference<BlobStoreEndpoint> bstore, std::stri
 		throw file_not_found();
 	if(r->contentLen != r->content.size())  // Double check that this wasn't a header-only response, probably unnecessary
 		throw io_error();
+	bstore->s_stats.bytes_read += r->contentLen;
 	// Copy the output bytes, server could have sent more or less bytes than requested so copy at most length bytes
 	memcpy(data, r->content.data(), std::min<int64_t>(r->contentLen, length));
 	return r->contentLen;
@@ -894,7 +1005,12 @@ ACTOR Future<std::string> uploadPart_impl(Reference<BlobStoreEndpoint> bstore, s
 	HTTP::Headers headers;
 	// Send MD5 sum for content so blobstore can verify it
 	headers["Content-MD5"] = contentMD5;
+	state double startTime = now();
 	state Reference<HTTP::Response> r = wait(bstore->doRequest("PUT", resource, headers, pContent, contentLen, {200}));
+
+	// Track upload speed for part sizing
+	double rate = contentLen / std::max(now() - startTime, 0.001);
+	bstore->uploadBytesPerSecond = bstore->uploadBytesPerSecond == 0 ? rate : 0.8 * bstore->uploadBytesPerSecond + 0.2 * rate;
 	// TODO:  In the event that the client times out just before the request completes (so the client is unaware) then the next retry
 	// will see error 400.  That could be detected and handled gracefully by retrieving the etag for the successful request.
 
@@ -936,3 +1052,66 @@ ACTOR Future<Void> finishMultiPartUpload_impl(Reference<BlobStoreEndpoint> bstor
 Future<Void> BlobStoreEndpoint::finishMultiPartUpload(std::string const &bucket, std::string const &object, std::string const &uploadID, MultiPartSetT const &parts) {
 	return finishMultiPartUpload_impl(Reference<BlobStoreEndpoint>::addRef(this), bucket, object, uploadID, parts);
 }
+
+int BlobStoreEndpoint::getTargetPartSize() const {
+	int64_t size = knobs.multipart_min_part_size;
+	if(knobs.multipart_target_seconds > 0)
+		size = std::max<int64_t>(size, std::min<double>(uploadBytesPerSecond * knobs.multipart_target_seconds, knobs.multipart_max_part_size));
+	return size;
+}
+
+static std::string contentMD5(std::vector<PacketBuffer *> const &buffers) {
+	MD5_CTX sum;
+	::MD5_Init(&sum);
+	for(PacketBuffer *p : buffers)
+		::MD5_Update(&sum, p->data, p->bytes_written);
+	std::string sumBytes;
+	sumBytes.resize(16);
+	::MD5_Final((unsigned char *)sumBytes.data(), &sum);
+	std::string md5 = base64::encoder::from_string(sumBytes);
+	md5.resize(md5.size() - 1);
+	return md5;
+}
+
+static Reference<IThreadPool> getHashThreads() {
+	// Shared by all endpoints and never stopped
+	static Reference<IThreadPool> threads;
+	if(!threads && CLIENT_KNOBS->BLOBSTORE_HASH_THREADS > 0) {
+		threads = createGenericThreadPool();
+		for(int i = 0; i < CLIENT_KNOBS->BLOBSTORE_HASH_THREADS; ++i)
+			threads->addThread(new NullThreadPoolReceiver);
+	}
+	return threads;
+}
+
+// buffers have been addref()'d by the caller and are released once the hash thread is done with them, so this must not be cancelled
+ACTOR static Future<std::string> calculateContentMD5_impl(std::vector<PacketBuffer *> buffers) {
+	state Optional<Error> err;
+	state std::string md5;
+	try {
+		std::string result = wait(runOnThreadPool<std::string>(getHashThreads(), [buffers]() { return contentMD5(buffers); }));
+		md5 = result;
+	} catch(Error &e) {
+		err = e;
+	}
+
+	for(PacketBuffer *p : buffers)
+		p->delref();
+	if(err.present())
+		throw err.get();
+	return md5;
+}
+
+Future<std::string> BlobStoreEndpoint::calculateContentMD5(UnsentPacketQueue *pContent) {
+	std::vector<PacketBuffer *> buffers;
+	for(PacketBuffer *p = pContent->getUnsent(); p != nullptr; p = p->nextPacketBuffer())
+		buffers.push_back(p);
+
+	// Thread timing would make simulation nondeterministic
+	if(g_network->isSimulated() || CLIENT_KNOBS->BLOBSTORE_HASH_THREADS <= 0)
+		return contentMD5(buffers);
+
+	for(PacketBuffer *p : buffers)
+		p->addref();
+	return uncancellable(calculateContentMD5_impl(buffers));
+}
@@ -21,6 +21,7 @@
 #pragma once
 
 #include <map>
+#include <deque>
 #include <functional>
 #include "flow/flow.h"
 #include "flow/Net2Packet.h"
@@ -34,7 +35,7 @@
 class BlobStoreEndpoint : public ReferenceCounted<BlobStoreEndpoint> {
 public:
 	struct Stats {
-		Stats() : requests_successful(0), requests_failed(0), bytes_sent(0) {}
+		Stats() : requests_successful(0), requests_failed(0), bytes_sent(0), bytes_read(0), read_cache_hits(0), read_cache_misses(0) {}
 		Stats operator-(const Stats &rhs);
 		void clear() { memset(this, sizeof(*this), 0); }
 		json_spirit::mObject getJSON();
@@ -42,6 +43,9 @@ public:
 		int64_t requests_successful;
 		int64_t requests_failed;
 		int64_t bytes_sent;
+		int64_t bytes_read;
+		int64_t read_cache_hits;
+		int64_t read_cache_misses;
 	};
 
 	static Stats s_stats;
@@ -56,9 +60,11 @@ public:
 			requests_per_second,
 			multipart_max_part_size,
 			multipart_min_part_size,
+			multipart_target_seconds,
 			concurrent_requests,
 			concurrent_uploads,
 			concurrent_lists,
+			delete_batch_size,
 			concurrent_reads_per_file,
 			concurrent_writes_per_file,
 			read_block_size,
@@ -78,9 +84,11 @@ public:
 				"requests_per_second (or rps)          Max number of requests to start per second.",
 				"multipart_max_part_size (or maxps)    Max part size for multipart uploads.",
 				"multipart_min_part_size (or minps)    Min part size for multipart uploads.",
+				"multipart_target_seconds (or mpts)    Seconds each part should take to upload at the measured upload speed, within the part size limits.  0 always uses the min part size.",
 				"concurrent_requests (or cr)           Max number of total requests in progress at once, regardless of operation-specific concurrency limits.",
 				"concurrent_uploads (or cu)            Max concurrent uploads (part or whole) that can be in progress at once.",
 				"concurrent_lists (or cl)              Max concurrent list operations that can be in progress at once.",
+				"delete_batch_size (or dbs)            Max objects to delete with one multi-object delete request.  1 deletes objects one at a time.",
 				"concurrent_reads_per_file (or crps)   Max concurrent reads in progress for any one file.",
 				"concurrent_writes_per_file (or cwps)  Max concurrent uploads in progress for any one file.",
 				"read_block_size (or rbs)              Block size in bytes to be used for reads.",
@@ -99,7 +107,9 @@ public:
 		recvRate(new SpeedLimit(knobs.max_recv_bytes_per_second, 1)),
 		concurrentRequests(knobs.concurrent_requests),
 		concurrentUploads(knobs.concurrent_uploads),
-		concurrentLists(knobs.concurrent_lists) {
+		concurrentLists(knobs.concurrent_lists),
+		uploadBytesPerSecond(0),
+		batchDeleteUnsupported(false) {
 
 		if(host.empty())
 			throw connection_string_invalid();
@@ -120,7 +130,8 @@ public:
 		Reference<IConnection> conn;
 		double expirationTime;
 	};
-	std::queue<ReusableConnection> connectionPool;
+	// Most recently returned connections are at the back and are reused first
+	std::deque<ReusableConnection> connectionPool;
 	Future<ReusableConnection> connect();
 	void returnConnection(ReusableConnection &conn);
 
@@ -139,6 +150,19 @@ public:
 	FlowLock concurrentUploads;
 	FlowLock concurrentLists;
 
+	// Smoothed throughput of recent part uploads, or 0 if there have been none
+	double uploadBytesPerSecond;
+
+	// Set once a multi-object delete request has been refused, after which objects are deleted one at a time
+	bool batchDeleteUnsupported;
+
+	// Size for the next part of a multipart upload, from multipart_target_seconds and uploadBytesPerSecond
+	int getTargetPartSize() const;
+
+	// Returns the base64 encoded MD5 sum of the content, computed on a thread pool unless BLOBSTORE_HASH_THREADS is 0 or
+	// the network is simulated.  The content must not change until the result is ready.
+	static Future<std::string> calculateContentMD5(UnsentPacketQueue *pContent);
+
 	Future<Void> updateSecret();
 
 	// Calculates the authentication string from the secret key
@@ -185,6 +209,10 @@ public:
 	// Delete an object in a bucket
 	Future<Void> deleteObject(std::string const &bucket, std::string const &object);
 
+	// Delete objects in a bucket using multi-object delete requests of up to delete_batch_size objects, if the blob store
+	// supports them.  Objects which do not exist are ignored.
+	Future<Void> deleteObjects(std::string const &bucket, std::vector<std::string> const &objects);
+
 	// Delete all objects in a bucket under a prefix.  Note this is not atomic as blob store does not
 	// support this operation directly. This method is just a convenience method that lists and deletes
 	// all of the objects in the bucket under the given prefix.
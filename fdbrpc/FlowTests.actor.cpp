@@ -24,6 +24,7 @@
 #include "flow/UnitTest.h"
 #include "flow/DeterministicRandom.h"
 #include "flow/IThreadPool.h"
+#include "flow/ActorCollection.h"
 #include "fdbrpc.h"
 #include "IAsyncFile.h"
 
@@ -74,6 +75,11 @@ ACTOR static Future<Void> emptyActor() {
 	return Void();
 }
 
+// The plain function counterpart of emptyActor(): only the SAV is allocated, not a whole actor object
+static Future<Void> readyFuture() {
+	return Void();
+}
+
 ACTOR static void oneWaitVoidActor(Future<Void> f) {
 	Void _ = wait(f);
 }
@@ -83,6 +89,13 @@ ACTOR static Future<Void> oneWaitActor(Future<Void> f) {
 	return Void();
 }
 
+// A synchronous fast path in front of oneWaitActor(), the pattern used by hot actors that usually finish without waiting
+static Future<Void> oneWaitFastPath(Future<Void> f) {
+	if (f.isReady())
+		return f;
+	return oneWaitActor(f);
+}
+
 Future<Void> g_cheese;
 ACTOR static Future<Void> cheeseWaitActor() {
 	Void _ = wait(g_cheese);
@@ -714,6 +727,40 @@ TEST_CASE("flow/flow/chooseTwoActor")
 	return Void();
 }
 
+TEST_CASE("flow/flow/IntrusiveActorCollection")
+{
+	Promise<Void> a, b, e;
+	int c1 = 0, c2 = 0, c3 = 0;
+	{
+		IntrusiveActorCollection actors;
+		actors.add(Void());  // Ready futures are not tracked
+		actors.add(oneWaitActor(a.getFuture()));
+		actors.add(oneWaitActor(b.getFuture()));
+		ASSERT(actors.size() == 2);
+		a.send(Void());
+		ASSERT(actors.size() == 1 && !actors.getResult().isReady());
+
+		// The first error is the result, and the rest are cancelled
+		actors.add(noteCancel(&c1));
+		actors.add(oneWaitActor(e.getFuture()));
+		Future<Void> result = actors.getResult();
+		e.sendError(io_error());
+		ASSERT(result.isError() && result.getError().code() == error_code_io_error);
+		ASSERT(actors.size() == 0 && c1 == 1 && b.getFutureReferenceCount() == 0);
+
+		// Once there is an error, anything added is cancelled
+		actors.add(noteCancel(&c2));
+		ASSERT(c2 == 1 && actors.size() == 0);
+	}
+	{
+		IntrusiveActorCollection actors;
+		actors.add(noteCancel(&c3));
+		ASSERT(c3 == 0);
+	}
+	ASSERT(c3 == 1);
+	return Void();
+}
+
 TEST_CASE("flow/flow/perf/actor patterns")
 {
 	double start;
@@ -736,6 +783,12 @@ TEST_CASE("flow/flow/perf/actor patterns")
 
 	ASSERT(expectActorCount(0));
 
+	start = timer();
+	for (int i = 0; i < N; i++) {
+		readyFuture();
+	}
+	printf("readyFuture(): %0.1f M/sec\n", N / 1e6 / (timer() - start));
+
 	Promise<Void> neverSet;
 	Future<Void> never = neverSet.getFuture();
 	Future<Void> already = Void();
@@ -761,6 +814,16 @@ TEST_CASE("flow/flow/perf/actor patterns")
 		printf("oneWaitActor(already): %0.1f M/sec\n", N / 1e6 / (timer() - start));
 	}
 
+	{
+		start = timer();
+		for (int i = 0; i < N; i++) {
+			Future<Void> f = oneWaitFastPath(already);
+			ASSERT(f.isReady());
+		}
+		printf("oneWaitFastPath(already): %0.1f M/sec\n", N / 1e6 / (timer() - start));
+		ASSERT(expectActorCount(0));
+	}
+
 	{
 		start = timer();
 		for (int i = 0; i < N; i++) {
@@ -1183,6 +1246,48 @@ ACTOR static Future<Void> waitAfterCancel( int* output ) {
 	return Void();
 }
 
+TEST_CASE("flow/perf/serialize VectorRef")
+{
+	double start;
+	int N = 1000;
+
+	Arena arena;
+	VectorRef<int64_t> v;
+	for (int i = 0; i < 10000; i++)
+		v.push_back(arena, g_random->randomInt64(0, 1e12));
+
+	// The item by item encoding that VectorRefs of binary serializable types used to have
+	start = timer();
+	for (int n = 0; n < N; n++) {
+		BinaryWriter wr(IncludeVersion());
+		wr << (uint32_t)v.size();
+		for (int i = 0; i < v.size(); i++)
+			wr << v[i];
+	}
+	printf("VectorRef<int64_t> item by item: %0.1f MB/sec\n", N * v.size() * sizeof(int64_t) / 1e6 / (timer() - start));
+
+	Standalone<StringRef> encoded;
+	start = timer();
+	for (int n = 0; n < N; n++) {
+		BinaryWriter wr(IncludeVersion());
+		wr << v;
+		encoded = wr.toStringRef();
+	}
+	printf("VectorRef<int64_t> save: %0.1f MB/sec\n", N * v.size() * sizeof(int64_t) / 1e6 / (timer() - start));
+
+	start = timer();
+	for (int n = 0; n < N; n++) {
+		Arena readArena;
+		VectorRef<int64_t> r;
+		ArenaReader rd(readArena, encoded, IncludeVersion());
+		rd >> r;
+		ASSERT( r == v );
+	}
+	printf("VectorRef<int64_t> load: %0.1f MB/sec\n", N * v.size() * sizeof(int64_t) / 1e6 / (timer() - start));
+
+	return Void();
+}
+
 TEST_CASE("fdbrpc/flow/wait_expression_after_cancel")
 {
 	int a = -1;
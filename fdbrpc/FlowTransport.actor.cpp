@@ -26,6 +26,12 @@
 #include "flow/TDMetric.actor.h"
 #include "FailureMonitor.h"
 #include "crc32c.h"
+#include "ContinuousSample.h"
+#include "zlib/zlib.h"
+#include <deque>
+#ifdef __linux__
+#include <cxxabi.h>
+#endif
 #include "simulator.h"
 
 #if VALGRIND
@@ -131,10 +137,7 @@ struct PingReceiver : NetworkMessageReceiver {
 		endpoints.insert(this, e, TaskReadSocket);
 		ASSERT( e == WLTOKEN_PING_PACKET );
 	}
-	virtual void receive( ArenaReader& reader ) {
-		ReplyPromise<Void> reply; reader >> reply;
-		reply.send(Void());
-	}
+	virtual void receive( ArenaReader& reader );
 };
 
 class TransportData {
@@ -155,6 +158,10 @@ public:
 		countConnEstablished.init(LiteralStringRef("Net2.CountConnEstablished"));
 		countConnClosedWithError.init(LiteralStringRef("Net2.CountConnClosedWithError"));
 		countConnClosedWithoutError.init(LiteralStringRef("Net2.CountConnClosedWithoutError"));
+		compressionInputBytes.init(LiteralStringRef("Net2.CompressionInputBytes"));
+		compressionOutputBytes.init(LiteralStringRef("Net2.CompressionOutputBytes"));
+		compressionMicroseconds.init(LiteralStringRef("Net2.CompressionMicroseconds"));
+		decompressionMicroseconds.init(LiteralStringRef("Net2.DecompressionMicroseconds"));
 	}
 
 	struct Peer* getPeer( NetworkAddress const& address, bool doConnect = true );
@@ -176,6 +183,18 @@ public:
 	Int64MetricHandle countConnEstablished;
 	Int64MetricHandle countConnClosedWithError;
 	Int64MetricHandle countConnClosedWithoutError;
+	Int64MetricHandle compressionInputBytes;   // Bytes of packets that were sent compressed, before compression
+	Int64MetricHandle compressionOutputBytes;  // ... and after
+	Int64MetricHandle compressionMicroseconds;
+	Int64MetricHandle decompressionMicroseconds;
+
+	struct RpcLatencyStats {
+		int64_t count;
+		ContinuousSample<double> latency;
+		ContinuousSample<int> requestBytes;
+		RpcLatencyStats() : count(0), latency(FLOW_KNOBS->RPC_LATENCY_SAMPLE_SIZE), requestBytes(FLOW_KNOBS->RPC_LATENCY_SAMPLE_SIZE) {}
+	};
+	std::map<const char*, RpcLatencyStats> rpcLatency;  // Keyed by the typeid name of the request type, since the last logRpcLatencyMetrics()
 
 	std::map<NetworkAddress, std::pair<uint64_t, double>> incompatiblePeers;
 	uint32_t numIncompatibleConnections;
@@ -188,6 +207,8 @@ public:
 
 #define CONNECT_PACKET_V0 0x0FDB00A444020001LL
 #define CONNECT_PACKET_V1 0x0FDB00A446030001LL
+#define COMPRESSED_PACKETS_VERSION 0x0FDB00A570010002LL  // Peers at this version or later can inflate packets flagged PACKET_COMPRESSED
+#define PACKET_COMPRESSED 0x80000000  // Set in the length of a packet whose body is its uncompressed length followed by a zlib stream
 #define CONNECT_PACKET_V0_SIZE 14
 #define CONNECT_PACKET_V1_SIZE 22
 #define CONNECT_PACKET_V2_SIZE 26
@@ -212,7 +233,14 @@ static_assert( sizeof(ConnectPacket) == CONNECT_PACKET_V2_SIZE, "ConnectPacket p
 
 static Future<Void> connectionReader( TransportData* const& transport, Reference<IConnection> const& conn, Peer* const& peer, Promise<Peer*> const& onConnected );
 
-static PacketID sendPacket( TransportData* self, ISerializeSource const& what, const Endpoint& destination, bool reliable );
+static PacketID sendPacket( TransportData* self, ISerializeSource const& what, const Endpoint& destination, bool reliable, bool urgent = false );
+
+void PingReceiver::receive( ArenaReader& reader ) {
+	// Reply on the urgent lane directly rather than through a ReplyPromise, so that a ping isn't timed out waiting behind bulk replies
+	Endpoint replyTo;
+	FlowTransport::transport().loadEndpoint( reader, replyTo );
+	FlowTransport::transport().sendUrgent( SerializeBoolAnd<Void>(true, Void()), replyTo );
+}
 
 struct Peer : NonCopyable {
 	// FIXME: Peers don't die!
@@ -220,26 +248,42 @@ struct Peer : NonCopyable {
 	TransportData* transport;
 	NetworkAddress destination;
 	UnsentPacketQueue unsent;
+	UnsentPacketQueue urgentUnsent;  // Pings and their replies, which are written between the packets of unsent so that they don't wait behind bulk transfers
+	std::deque<int> unsentPacketBytes;  // The size of each packet in unsent, if unsentPacketsKnown
+	int unsentPacketWritten;  // Bytes of the first packet in unsentPacketBytes that have already been written
+	bool unsentPacketsKnown;  // False when unsent holds packets, such as compacted reliable packets, that unsentPacketBytes doesn't describe
+	bool connectPacketSent;  // Urgent packets can't be written before the ConnectPacket
+	bool urgentInProgress;  // Urgent packets are written all the way to the end of urgentUnsent, since their boundaries aren't tracked
 	ReliablePacketList reliable;
-	AsyncTrigger dataToSend;  // Triggered when unsent.empty() becomes false
+	AsyncTrigger dataToSend;  // Triggered when unsent.empty() && urgentUnsent.empty() becomes false
 	Future<Void> connect;
 	AsyncTrigger incompatibleDataRead;
 	bool compatible;
+	bool acceptsCompressedPackets;  // Learned from the ConnectPacket of the current connection
 	bool outgoingConnectionIdle;  // We don't actually have a connection open and aren't trying to open one because we don't have anything to send
 	double lastConnectTime;
 	double reconnectionDelay;
 
 	explicit Peer( TransportData* transport, NetworkAddress const& destination, bool doConnect = true ) 
-		: transport(transport), destination(destination), outgoingConnectionIdle(!doConnect), lastConnectTime(0.0), reconnectionDelay(FLOW_KNOBS->INITIAL_RECONNECTION_TIME), compatible(true)
+		: transport(transport), destination(destination), outgoingConnectionIdle(!doConnect), lastConnectTime(0.0), reconnectionDelay(FLOW_KNOBS->INITIAL_RECONNECTION_TIME), compatible(true), acceptsCompressedPackets(false),
+		  unsentPacketWritten(0), unsentPacketsKnown(true), connectPacketSent(true), urgentInProgress(false)
 	{
 		if(doConnect) {
 			connect = connectionKeeper(this);
 		}
 	}
 
-	void send(PacketBuffer* pb, ReliablePacket* rp, bool firstUnsent) {
+	bool empty() const { return unsent.empty() && urgentUnsent.empty(); }
+
+	void send(PacketBuffer* pb, ReliablePacket* rp, bool firstUnsent, int bytes) {
 		unsent.setWriteBuffer(pb);
 		if (rp) reliable.insert(rp);
+		if (unsentPacketsKnown) unsentPacketBytes.push_back(bytes);
+		if (firstUnsent) dataToSend.trigger();
+	}
+
+	void sendUrgent(PacketBuffer* pb, bool firstUnsent) {
+		urgentUnsent.setWriteBuffer(pb);
 		if (firstUnsent) dataToSend.trigger();
 	}
 
@@ -262,16 +306,71 @@ struct Peer : NonCopyable {
 		PacketWriter wr( pb_first, NULL, Unversioned() );
 		wr.serializeBinaryItem(pkt);
 		unsent.prependWriteBuffer(pb_first, wr.finish());
+		if (unsentPacketsKnown) unsentPacketBytes.push_front(sizeof(pkt));
+		connectPacketSent = false;
 	}
 
 	void discardUnreliablePackets() {
 		// Throw away the current unsent list, dropping the reference count on each PacketBuffer that accounts for presence in the unsent list
 		unsent.discardAll();
+		urgentUnsent.discardAll();
+		urgentInProgress = false;
 
 		// Compact reliable packets into a new unsent range
 		PacketBuffer* pb = unsent.getWriteBuffer();
 		pb = reliable.compact(pb, NULL);
 		unsent.setWriteBuffer(pb);
+
+		unsentPacketBytes.clear();
+		unsentPacketWritten = 0;
+		unsentPacketsKnown = unsent.empty();
+	}
+
+	bool writeUnsent( Reference<IConnection> const& conn ) {
+		// Writes as much as conn will take, switching to the urgent packets whenever unsent is between packets.
+		// Returns true if everything was written.
+		loop {
+			if (unsent.empty()) {
+				// Everything that was in unsent, including any ConnectPacket, has been written
+				unsentPacketBytes.clear();
+				unsentPacketWritten = 0;
+				unsentPacketsKnown = true;
+				connectPacketSent = true;
+			}
+
+			if (!urgentUnsent.empty() && (urgentInProgress || (unsentPacketsKnown && connectPacketSent && !unsentPacketWritten))) {
+				int sent = conn->write( urgentUnsent.getUnsent() );
+				if (sent) {
+					transport->bytesSent += sent;
+					urgentUnsent.sent(sent);
+				}
+				urgentInProgress = !urgentUnsent.empty();
+				if (urgentInProgress) return false;
+				continue;
+			}
+
+			if (unsent.empty()) return urgentUnsent.empty();
+
+			// Stop at the end of the current packet if there are urgent packets waiting for it
+			int limit = std::numeric_limits<int>::max();
+			if (!urgentUnsent.empty() && unsentPacketsKnown && unsentPacketBytes.size())
+				limit = unsentPacketBytes.front() - unsentPacketWritten;
+
+			int sent = conn->write( unsent.getUnsent(), limit );
+			if (sent) {
+				transport->bytesSent += sent;
+				unsent.sent(sent);
+			}
+			if (unsentPacketsKnown) {
+				unsentPacketWritten += sent;
+				while (unsentPacketBytes.size() && unsentPacketWritten >= unsentPacketBytes.front()) {
+					unsentPacketWritten -= unsentPacketBytes.front();
+					unsentPacketBytes.pop_front();
+					connectPacketSent = true;
+				}
+			}
+			if (sent < limit && !unsent.empty()) return false;
+		}
 	}
 
 	void onIncomingConnection( Reference<IConnection> conn, Future<Void> reader ) {
@@ -334,12 +433,7 @@ struct Peer : NonCopyable {
 			loop {
 				lastWriteTime = now();
 
-				int sent = conn->write( self->unsent.getUnsent() );
-				if (sent) {
-					self->transport->bytesSent += sent;
-					self->unsent.sent(sent);
-				}
-				if (self->unsent.empty()) break;
+				if (self->writeUnsent(conn)) break;
 
 				TEST(true); // We didn't write everything, so apparently the write buffer is full.  Wait for it to be nonfull.
 				Void _ = wait( conn->onWritable() );
@@ -347,7 +441,7 @@ struct Peer : NonCopyable {
 			}
 
 			// Wait until there is something to send
-			while ( self->unsent.empty() )
+			while ( self->empty() )
 				Void _ = wait( self->dataToSend.onTrigger() );
 		}
 	}
@@ -363,7 +457,7 @@ struct Peer : NonCopyable {
 				if (!conn) {  // Always, except for the first loop with an incoming connection
 					self->outgoingConnectionIdle = true;
 					// Wait until there is something to send
-					while ( self->unsent.empty() )
+					while ( self->empty() )
 						Void _ = wait( self->dataToSend.onTrigger() );
 					ASSERT( self->destination.isPublic() );
 					self->outgoingConnectionIdle = false;
@@ -406,6 +500,10 @@ struct Peer : NonCopyable {
 				}
 				self->discardUnreliablePackets();
 				reader = Future<Void>();
+				// Until the next connection has said otherwise, the peer might have been replaced by a process that can't inflate packets.
+				// When we are cancelled for an incoming connection, that connection has already set this.
+				if (e.code() != error_code_actor_cancelled)
+					self->acceptsCompressedPackets = false;
 				bool ok = e.code() == error_code_connection_failed || e.code() == error_code_actor_cancelled || ( g_network->isSimulated() && e.code() == error_code_checksum_failed );
 
 				if(self->compatible) {
@@ -459,6 +557,35 @@ ACTOR static void deliver( TransportData* self, Endpoint destination, ArenaReade
 		g_network->setCurrentTask( TaskReadSocket );
 }
 
+static int pendingPacketSize( TransportData* transport, uint8_t* unprocessed_begin, uint8_t* e, NetworkAddress const& peerAddress ) {
+	// Returns the size, including its header, of the incomplete packet at unprocessed_begin, or 0 if its header hasn't been read yet
+	int headerSize = transport->localAddress.isTLS() || peerAddress.isTLS() ? sizeof(uint32_t) : sizeof(uint32_t) * 2;
+	if (e-unprocessed_begin < headerSize) return 0;
+	uint32_t packetLen = *(uint32_t*)unprocessed_begin & ~PACKET_COMPRESSED;
+	if (packetLen > FLOW_KNOBS->PACKET_LIMIT) return 0;  // scanPackets will reject it
+	return headerSize + packetLen;
+}
+
+static StringRef inflatePacket( TransportData* transport, StringRef packet, Arena& packetArena, NetworkAddress const& peerAddress ) {
+	uint32_t uncompressedLen;
+	if (packet.size() < sizeof(uncompressedLen) || (uncompressedLen = *(uint32_t*)packet.begin()) > FLOW_KNOBS->PACKET_LIMIT) {
+		TraceEvent(SevError, "Net2_BadCompressedPacket").detail("FromPeer", peerAddress.toString()).detail("Length", packet.size());
+		throw platform_error();
+	}
+
+	double start = timer();
+	packetArena = Arena( uncompressedLen );
+	uint8_t* out = new (packetArena) uint8_t[ uncompressedLen ];
+	uLongf outLen = uncompressedLen;
+	int r = uncompress( out, &outLen, packet.begin() + sizeof(uncompressedLen), packet.size() - sizeof(uncompressedLen) );
+	if (r != Z_OK || outLen != uncompressedLen) {
+		TraceEvent(SevError, "Net2_BadCompressedPacket").detail("FromPeer", peerAddress.toString()).detail("Length", packet.size()).detail("ZlibResult", r);
+		throw platform_error();
+	}
+	transport->decompressionMicroseconds += (int64_t)((timer() - start) * 1e6);
+	return StringRef(out, uncompressedLen);
+}
+
 static void scanPackets( TransportData* transport, uint8_t*& unprocessed_begin, uint8_t* e, Arena& arena, NetworkAddress const& peerAddress, uint64_t peerProtocolVersion ) {
 	// Find each complete packet in the given byte range and queue a ready task to deliver it.
 	// Remove the complete packets from the range by increasing unprocessed_begin.
@@ -483,6 +610,9 @@ static void scanPackets( TransportData* transport, uint8_t*& unprocessed_begin,
 			packetLen = *(uint32_t*)p; p += sizeof(uint32_t);
 		}
 
+		bool compressed = packetLen & PACKET_COMPRESSED;
+		packetLen &= ~PACKET_COMPRESSED;
+
 		if (packetLen > FLOW_KNOBS->PACKET_LIMIT) {
 			TraceEvent(SevError, "Net2_PacketLimitExceeded").detail("FromPeer", peerAddress.toString()).detail("Length", (int)packetLen);
 			throw platform_error();
@@ -531,7 +661,13 @@ static void scanPackets( TransportData* transport, uint8_t*& unprocessed_begin,
 #if VALGRIND
 		VALGRIND_CHECK_MEM_IS_DEFINED(p, packetLen);
 #endif
-		ArenaReader reader( arena, StringRef(p, packetLen), AssumeVersion(peerProtocolVersion) );
+		StringRef packet(p, packetLen);
+		Arena packetArena = arena;
+		if (compressed) {
+			packet = inflatePacket( transport, packet, packetArena, peerAddress );
+		}
+
+		ArenaReader reader( packetArena, packet, AssumeVersion(peerProtocolVersion) );
 		UID token; reader >> token;
 
 		++transport->countPacketsReceived;
@@ -579,10 +715,13 @@ ACTOR static Future<Void> connectionReader(
 		loop {
 			loop {
 				int readAllBytes = buffer_end - unprocessed_end;
-				if (readAllBytes < 4096) {
+				int packetBytes = compatible ? pendingPacketSize( transport, unprocessed_begin, unprocessed_end, peerAddress ) : 0;
+				if (readAllBytes < 4096 || packetBytes > buffer_end - unprocessed_begin) {
+					// A packet whose length is already known gets a buffer it fits in, so that the rest of it is read in place instead of
+					// being copied again each time the buffer grows
 					Arena newArena;
 					int unproc_len = unprocessed_end - unprocessed_begin;
-					int len = std::max( 65536, unproc_len*2 );
+					int len = std::max( 65536, packetBytes ? packetBytes : unproc_len*2 );
 					uint8_t* newBuffer = new (newArena) uint8_t[ len ];
 					memcpy( newBuffer, unprocessed_begin, unproc_len );
 					arena = newArena;
@@ -651,6 +790,7 @@ ACTOR static Future<Void> connectionReader(
 
 						peerProtocolVersion = p->protocolVersion;
 						if (peer != nullptr) {
+							peer->acceptsCompressedPackets = peerProtocolVersion >= COMPRESSED_PACKETS_VERSION;
 							// Outgoing connection; port information should be what we expect
 							TraceEvent("ConnectedOutgoing").detail("PeerAddr", NetworkAddress( p->canonicalRemoteIp, p->canonicalRemotePort ) ).suppressFor(1.0);
 							peer->compatible = compatible;
@@ -663,6 +803,7 @@ ACTOR static Future<Void> connectionReader(
 							}
 							peer = transport->getPeer(peerAddress);
 							peer->compatible = compatible;
+							peer->acceptsCompressedPackets = peerProtocolVersion >= COMPRESSED_PACKETS_VERSION;
 							if (!compatible)
 								peer->transport->numIncompatibleConnections++;
 							onConnected.send( peer );
@@ -821,7 +962,35 @@ void FlowTransport::addWellKnownEndpoint( Endpoint& endpoint, NetworkMessageRece
 	ASSERT( endpoint.token == otoken );
 }
 
-static PacketID sendPacket( TransportData* self, ISerializeSource const& what, const Endpoint& destination, bool reliable ) {
+static bool serializeCompressed( TransportData* self, PacketWriter& wr, UID const& token, ISerializeSource const& what ) {
+	// Writes the packet body deflated if it is big enough and compresses well, or as is otherwise; returns true if it was deflated
+	BinaryWriter bw( AssumeVersion(currentProtocolVersion) );
+	bw << token;
+	what.serializeBinaryWriter(bw);
+
+	if (bw.getLength() >= FLOW_KNOBS->PACKET_COMPRESSION_MIN_BYTES) {
+		double start = timer();
+		uLongf compressedLen = compressBound( bw.getLength() );
+		Arena arena( compressedLen );
+		uint8_t* compressedData = new (arena) uint8_t[ compressedLen ];
+		int r = compress2( compressedData, &compressedLen, (const uint8_t*)bw.getData(), bw.getLength(), FLOW_KNOBS->PACKET_COMPRESSION_LEVEL );
+		self->compressionMicroseconds += (int64_t)((timer() - start) * 1e6);
+
+		if (r == Z_OK && compressedLen + sizeof(uint32_t) < bw.getLength()) {
+			uint32_t uncompressedLen = bw.getLength();
+			wr << uncompressedLen;
+			wr.serializeBytes( compressedData, compressedLen );
+			self->compressionInputBytes += uncompressedLen;
+			self->compressionOutputBytes += compressedLen + sizeof(uncompressedLen);
+			return true;
+		}
+	}
+
+	wr.serializeBytes( bw.getData(), bw.getLength() );
+	return false;
+}
+
+static PacketID sendPacket( TransportData* self, ISerializeSource const& what, const Endpoint& destination, bool reliable, bool urgent ) {
 	if (destination.address == self->localAddress) {
 		TEST(true); // "Loopback" delivery
 		// SOMEDAY: Would it be better to avoid (de)serialization by doing this check in flow?
@@ -852,9 +1021,10 @@ static PacketID sendPacket( TransportData* self, ISerializeSource const& what, c
 			return (PacketID)NULL;
 		}
 
-		bool firstUnsent = peer->unsent.empty();
+		bool firstUnsent = peer->empty();
 
-		PacketBuffer* pb = peer->unsent.getWriteBuffer();
+		urgent = (urgent || destination.token == WLTOKEN_PING_PACKET) && !reliable;
+		PacketBuffer* pb = urgent ? peer->urgentUnsent.getWriteBuffer() : peer->unsent.getWriteBuffer();
 		ReliablePacket* rp = reliable ? new ReliablePacket : 0;
 
 		void*p = pb->data+pb->bytes_written;
@@ -872,8 +1042,14 @@ static PacketID sendPacket( TransportData* self, ISerializeSource const& what, c
 		}
 
 		wr.writeAhead(packetInfoSize , &packetInfoBuffer);
-		wr << destination.token;
-		what.serializePacketWriter(wr);
+		bool compressed = false;
+		if (!reliable && peer->acceptsCompressedPackets && FLOW_KNOBS->PACKET_COMPRESSION_MIN_BYTES) {
+			// Reliable packets are left alone since they may be resent on a later connection, to a peer that can't inflate them
+			compressed = serializeCompressed( self, wr, destination.token, what );
+		} else {
+			wr << destination.token;
+			what.serializePacketWriter(wr);
+		}
 		pb = wr.finish();
 		len = wr.size() - packetInfoSize;
 
@@ -897,7 +1073,8 @@ static PacketID sendPacket( TransportData* self, ISerializeSource const& what, c
 		}
 
 		// Write packet length and checksum into packet buffer
-		packetInfoBuffer.write(&len, sizeof(len));
+		uint32_t flaggedLen = compressed ? len | PACKET_COMPRESSED : len;
+		packetInfoBuffer.write(&flaggedLen, sizeof(flaggedLen));
 		if (checksumEnabled) {
 			packetInfoBuffer.write(&checksum, sizeof(checksum), sizeof(len));
 		}
@@ -928,7 +1105,10 @@ static PacketID sendPacket( TransportData* self, ISerializeSource const& what, c
 		}
 #endif
 
-		peer->send(pb, rp, firstUnsent);
+		if (urgent)
+			peer->sendUrgent(pb, firstUnsent);
+		else
+			peer->send(pb, rp, firstUnsent, wr.size());
 
 		return (PacketID)rp;
 	}
@@ -948,10 +1128,57 @@ void FlowTransport::sendUnreliable( ISerializeSource const& what, const Endpoint
 	sendPacket( self, what, destination, false );
 }
 
+void FlowTransport::sendUrgent( ISerializeSource const& what, const Endpoint& destination ) {
+	sendPacket( self, what, destination, false, true );
+}
+
 int FlowTransport::getEndpointCount() { 
 	return -1; 
 }
 
+void FlowTransport::recordRpcLatency( const char* requestType, double latency, int requestBytes ) {
+	auto& stats = self->rpcLatency[requestType];
+	stats.count++;
+	stats.latency.addSample(latency);
+	stats.requestBytes.addSample(requestBytes);
+}
+
+static std::string requestTypeName( const char* typeName ) {
+	std::string s;
+#ifdef __linux__
+	char *demangled = abi::__cxa_demangle(typeName, NULL, NULL, NULL);
+	if (demangled) {
+		s = demangled;
+		free(demangled);
+	} else
+		s = typeName;
+#else
+	s = typeName;
+	if (StringRef(s).startsWith(LiteralStringRef("struct ")))
+		s = s.substr(LiteralStringRef("struct ").size());
+	else if (StringRef(s).startsWith(LiteralStringRef("class ")))
+		s = s.substr(LiteralStringRef("class ").size());
+#endif
+	return s;
+}
+
+void FlowTransport::logRpcLatencyMetrics() {
+	// Each request type gets a detail Rpc<n> = "count meanRequestBytes medianSeconds p90Seconds p99Seconds maxSeconds typeName";
+	// type names can't be detail names in XML traces
+	if (FLOW_KNOBS->RPC_LATENCY_SAMPLE_RATE <= 0)
+		return;
+
+	TraceEvent ev("RpcLatencyMetrics");
+	int n = 0;
+	for(auto& it : self->rpcLatency) {
+		auto& stats = it.second;
+		ev.detail(format("Rpc%d", n++).c_str(), format("%lld %.1f %g %g %g %g %s", (long long)stats.count, stats.requestBytes.mean(),
+			stats.latency.median(), stats.latency.percentile(0.9), stats.latency.percentile(0.99), stats.latency.max(), requestTypeName(it.first).c_str()));
+	}
+	ev.detail("RequestTypes", n).trackLatest("RpcLatencyMetrics");
+	self->rpcLatency.clear();
+}
+
 bool FlowTransport::incompatibleOutgoingConnectionsPresent() {
 	return self->numIncompatibleConnections;
 }
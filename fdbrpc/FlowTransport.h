@@ -104,6 +104,15 @@ public:
 
 	void sendUnreliable( ISerializeSource const& what, const Endpoint& destination );// { cancelReliable(sendReliable(what,destination)); }
 
+	void sendUrgent( ISerializeSource const& what, const Endpoint& destination );
+	// Like sendUnreliable, but the packet may overtake bulk packets already queued for the destination.  Only for small messages that don't need ordering.
+
+	void recordRpcLatency( const char* requestType, double latency, int requestBytes );
+	// Adds one sampled request-to-reply latency to this process's histograms for the given request type (a typeid name)
+
+	void logRpcLatencyMetrics();
+	// Traces the RPC latency histograms gathered since the last call as RpcLatencyMetrics and starts new ones
+
 	int getEndpointCount();
 	// for tracing only
 
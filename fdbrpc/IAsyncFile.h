@@ -47,7 +47,8 @@ public:
 		OPEN_ATOMIC_WRITE_AND_CREATE = 0x80000,  // A temporary file is opened, and on the first call to sync() it is atomically renamed to the given filename
 		OPEN_LARGE_PAGES = 0x100000, 
 		OPEN_NO_AIO = 0x200000,                   // Don't use AsyncFileKAIO or similar implementations that rely on filesystem support for AIO
-		OPEN_CACHED_READ_ONLY = 0x400000          // AsyncFileCached opens files read/write even if you specify read only
+		OPEN_CACHED_READ_ONLY = 0x400000,         // AsyncFileCached opens files read/write even if you specify read only
+		OPEN_DSYNC = 0x800000                     // Writes complete only once their data is durable (O_DSYNC), so sync() has little left to flush
 	};  
 
 	virtual void addref() = 0;
@@ -79,6 +80,11 @@ public:
 	virtual Future<Void> readZeroCopy( void** data, int* length, int64_t offset ) { return io_error(); }
 	virtual void releaseZeroCopy( void* data, int length, int64_t offset ) {}
 
+	// Like read(), but a hint that the bytes are unlikely to be read again soon (e.g. a bulk scan), so an
+	//   implementation with a page cache should serve what it already has cached and read the rest without
+	//   populating (and evicting from) the cache.
+	virtual Future<int> readUncached( void* data, int length, int64_t offset ) { return read( data, length, offset ); }
+
 	virtual int64_t debugFD() = 0;
 };
 
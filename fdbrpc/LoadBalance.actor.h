@@ -177,7 +177,8 @@ Future< REPLY_TYPE(Request) > loadBalance(
 	ASSERT( alternatives->size() );
 
 	state int bestAlt = g_random->randomInt(0, alternatives->countBest());
-	state int nextAlt = g_random->randomInt(0, std::max(alternatives->size() - 1,1));
+	// Keep the fallback in the closest tier (e.g. the client's own datacenter) when it has more than one member
+	state int nextAlt = g_random->randomInt(0, std::max((alternatives->countBest() > 1 ? alternatives->countBest() : alternatives->size()) - 1,1));
 	if( nextAlt >= bestAlt )
 		nextAlt++;
 
@@ -186,6 +187,7 @@ Future< REPLY_TYPE(Request) > loadBalance(
 		double nextMetric = 1e9;
 		double bestTime = 1e9;
 		double nextTime = 1e9;
+		double bestHedgeTime = 0;
 		for(int i=0; i<alternatives->size(); i++) {
 			if(bestMetric < 1e8 && i == alternatives->countBest()) {
 				break;
@@ -207,6 +209,7 @@ Future< REPLY_TYPE(Request) > loadBalance(
 						bestAlt = i;
 						bestMetric = thisMetric;
 						bestTime = thisTime;
+						bestHedgeTime = qd.hedgeLatency;
 					} else if( thisMetric < nextMetric ) {
 						nextAlt = i;
 						nextMetric = thisMetric;
@@ -217,6 +220,11 @@ Future< REPLY_TYPE(Request) > loadBalance(
 		}
 		if( nextMetric > 1e8 ) {
 			for(int i=alternatives->countBest(); i<alternatives->size(); i++) {
+				// Only look at farther alternatives (e.g. remote regions) if nothing closer is available
+				if( nextMetric < 1e8 && alternatives->getDistance(i) > alternatives->getDistance(nextAlt) ) {
+					break;
+				}
+
 				RequestStream<Request> const* thisStream = &alternatives->get( i, channel );
 				if (!IFailureMonitor::failureMonitor().getState( thisStream->getEndpoint() ).failed) {
 					auto& qd = model->getMeasurement(thisStream->getEndpoint().token.first());
@@ -238,7 +246,8 @@ Future< REPLY_TYPE(Request) > loadBalance(
 			if(bestTime > FLOW_KNOBS->INSTANT_SECOND_REQUEST_MULTIPLIER*(model->secondMultiplier*(nextTime) + FLOW_KNOBS->BASE_SECOND_REQUEST_TIME)) {
 				secondDelay = Void();
 			} else {
-				secondDelay = delay( model->secondMultiplier*nextTime + FLOW_KNOBS->BASE_SECOND_REQUEST_TIME );
+				// Hedge once the first request has outlived most of its server's recent replies
+				secondDelay = delay( model->secondMultiplier*(bestHedgeTime > 0 ? bestHedgeTime : nextTime) + FLOW_KNOBS->BASE_SECOND_REQUEST_TIME );
 			}
 		}
 		else {
@@ -35,6 +35,7 @@
 #include "AsyncFileEIO.actor.h"
 #include "AsyncFileWinASIO.actor.h"
 #include "AsyncFileKAIO.actor.h"
+#include "AsyncFileIOUring.actor.h"
 #include "flow/AsioReactor.h"
 #include "flow/Platform.h"
 #include "AsyncFileWriteChecker.h"
@@ -58,7 +59,9 @@ Future< Reference<class IAsyncFile> > Net2FileSystem::open( std::string filename
 
 	Future<Reference<IAsyncFile>> f;
 #ifdef __linux__
-	if ( (flags & IAsyncFile::OPEN_UNBUFFERED) && !(flags & IAsyncFile::OPEN_NO_AIO) )
+	if ( (flags & IAsyncFile::OPEN_UNBUFFERED) && !(flags & IAsyncFile::OPEN_NO_AIO) && AsyncFileIOUring::isInitialized() )
+		f = AsyncFileIOUring::open(filename, flags, mode, NULL);
+	else if ( (flags & IAsyncFile::OPEN_UNBUFFERED) && !(flags & IAsyncFile::OPEN_NO_AIO) )
 		f = AsyncFileKAIO::open(filename, flags, mode, NULL);
 	else
 #endif
@@ -83,7 +86,9 @@ Net2FileSystem::Net2FileSystem(double ioTimeout, std::string fileSystemPath)
 {
 	Net2AsyncFile::init();
 #ifdef __linux__
-	AsyncFileKAIO::init( Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout );
+	// Only one of io_uring and kernel AIO is used, since both would compete for the reactor's eventfd and run loop hook
+	if ( !FLOW_KNOBS->USE_IO_URING || !AsyncFileIOUring::init( Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout ) )
+		AsyncFileKAIO::init( Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout );
 
 	if (fileSystemPath.empty()) {
 		checkFileSystem = false;
@@ -27,6 +27,16 @@ void QueueModel::endRequest( uint64_t id, double latency, double penalty, double
 
 	if(clean) {
 		d.latency = latency;
+
+		// Stepping the estimate up by p and down by 1-p (relative to its size) settles where a fraction 1-p of replies are slower,
+		// so it tracks the p'th percentile without keeping samples
+		double p = FLOW_KNOBS->SECOND_REQUEST_LATENCY_PERCENTILE;
+		if(d.hedgeLatency == 0)
+			d.hedgeLatency = latency;
+		else if(latency > d.hedgeLatency)
+			d.hedgeLatency *= 1 + FLOW_KNOBS->SECOND_REQUEST_PERCENTILE_STEP * p;
+		else
+			d.hedgeLatency *= 1 - FLOW_KNOBS->SECOND_REQUEST_PERCENTILE_STEP * (1 - p);
 	} else {
 		d.latency = std::max(d.latency, latency);
 	}
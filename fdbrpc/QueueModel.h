@@ -31,11 +31,12 @@
 struct QueueData {
 	Smoother smoothOutstanding;
 	double latency;
+	double hedgeLatency; // Running estimate of the SECOND_REQUEST_LATENCY_PERCENTILE'th clean latency, 0 until the first clean reply
 	double penalty;
 	double failedUntil;
 	double futureVersionBackoff;
 	double increaseBackoffTime;
-	QueueData() : latency(0.001), penalty(1.0), smoothOutstanding(FLOW_KNOBS->QUEUE_MODEL_SMOOTHING_AMOUNT), failedUntil(0), futureVersionBackoff(FLOW_KNOBS->FUTURE_VERSION_INITIAL_BACKOFF), increaseBackoffTime(0) {}
+	QueueData() : latency(0.001), hedgeLatency(0), penalty(1.0), smoothOutstanding(FLOW_KNOBS->QUEUE_MODEL_SMOOTHING_AMOUNT), failedUntil(0), futureVersionBackoff(FLOW_KNOBS->FUTURE_VERSION_INITIAL_BACKOFF), increaseBackoffTime(0) {}
 };
 
 typedef double TimeEstimate;
@@ -38,6 +38,22 @@ public:
 template <class Key>
 RangeMapRange<Key> rangeMapRange( Key const& begin, Key const& end ) { return RangeMapRange<Key>(begin,end); }
 
+// Converts a range boundary to the key type of a map.  A batch of Standalone<StringRef> keys is copied into one arena that the
+// keys share, rather than each key allocating its own.
+template <class Key>
+struct RangeMapKeys {
+	template <class K>
+	static Key make( Arena&, K const& k ) { return Key(k); }
+	template <class K>
+	static int bytes( K const& ) { return 0; }
+};
+
+template <>
+struct RangeMapKeys<Standalone<StringRef>> {
+	static Standalone<StringRef> make( Arena& arena, StringRef const& k ) { return Standalone<StringRef>( StringRef(arena, k), arena ); }
+	static int bytes( StringRef const& k ) { return k.size(); }
+};
+
 template <class Metric>
 struct ConstantMetric {
 	template<typename pair_type>
@@ -153,6 +169,8 @@ public:
 	//void clear( const Val& value ) { ranges.clear(); ranges.insert(std::make_pair(Key(),value)); }
 
 	void insert( const Range& keys, const Val& value );
+	// Same as calling insert() for each range in order, for ranges which are sorted and do not overlap
+	void insert( const std::vector<std::pair<Range, Val>>& ranges );
 
 protected:
 	Map<Key,Val,pair_type,Metric> map;
@@ -245,4 +263,42 @@ void RangeMap<Key,Val,Range,Metric,MetricFunc>::insert( const Range& keys, const
 	map.insert(beginPair, true, mf(beginPair));
 }
 
+template <class Key, class Val, class Range, class Metric, class MetricFunc>
+void RangeMap<Key,Val,Range,Metric,MetricFunc>::insert( const std::vector<std::pair<Range, Val>>& ranges ) {
+	// The ranges are visited last to first, so that erasing the boundaries inside one range does not change the value found
+	// after the end of the range before it, and the new boundaries are then added with a single sorted bulk insert
+	int keyBytes = 0;
+	for(auto& r : ranges)
+		keyBytes += RangeMapKeys<Key>::bytes(r.first.begin) + RangeMapKeys<Key>::bytes(r.first.end);
+	Arena arena(keyBytes);
+
+	std::vector<std::pair<pair_type, Metric>> boundaries;
+	boundaries.reserve( 2*ranges.size() );
+	const Range* next = NULL;
+	for(int i = ranges.size()-1; i >= 0; i--) {
+		const Range& keys = ranges[i].first;
+		if(keys.begin == keys.end)
+			continue;
+		ASSERT( !next || !(next->begin < keys.end) );
+
+		auto end = map.lower_bound( keys.end );
+		if( end->key != keys.end && !(next && next->begin == keys.end) ) {
+			auto beforeEnd = end;
+			beforeEnd.decrementNonEnd();
+			pair_type endPair(RangeMapKeys<Key>::make(arena, keys.end), beforeEnd->value);
+			Metric m = mf(endPair);
+			boundaries.push_back( std::make_pair( std::move(endPair), m ) );
+		}
+
+		map.erase( map.lower_bound( keys.begin ), end );
+		pair_type beginPair(RangeMapKeys<Key>::make(arena, keys.begin), ranges[i].second);
+		Metric m = mf(beginPair);
+		boundaries.push_back( std::make_pair( std::move(beginPair), m ) );
+		next = &keys;
+	}
+
+	std::reverse( boundaries.begin(), boundaries.end() );
+	map.insert( boundaries, true );
+}
+
 #endif
\ No newline at end of file
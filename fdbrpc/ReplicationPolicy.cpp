@@ -147,56 +147,84 @@ PolicyAcross::~PolicyAcross()
 	return;
 }
 
+AttribKey PolicyAcross::groupKeyIndex(LocalitySetRef const& fromServers) const
+{
+	// The key map can be cleared or copied over, so check that the remembered index still names the key
+	Reference<StringToIntMap> const& keyMap = fromServers->getGroupKeyMap();
+	if ((!(keyMap == _groupKeyMap)) || (_groupKey._id < 0) || (_groupKey._id >= keyMap->_lookuparray.size()) || (keyMap->_lookuparray[_groupKey._id] != _attribKey)) {
+		_groupKeyMap = keyMap;
+		_groupKey = AttribKey(keyMap->convertString(_attribKey));
+	}
+	return _groupKey;
+}
+
+static bool compareValueEntries(const std::pair<AttribValue, LocalityEntry>& lhs, const std::pair<AttribValue, LocalityEntry>& rhs)
+{ return lhs.first < rhs.first; }
+
 bool PolicyAcross::validate(
 		std::vector<LocalityEntry>	const&	solutionSet,
 		LocalitySetRef const&				fromServers ) const
 {
 	bool			valid = true;
 	int				count = 0;
-	AttribKey	indexKey = fromServers->keyIndex(_attribKey);
-	auto			groupIndexKey = fromServers->getGroupKeyIndex(indexKey);
-	std::map<AttribValue, std::vector<LocalityEntry>>	validMap;
+	auto			groupIndexKey = groupKeyIndex(fromServers);
+
+	// Group the solution by value, keeping each group in solution order
+	std::vector<std::pair<AttribValue, LocalityEntry>>	valueEntries;
+	valueEntries.reserve(solutionSet.size());
 	for (auto& item : solutionSet) {
 		auto value = fromServers->getValueViaGroupKey(item, groupIndexKey);
 		if (value.present()) {
-			auto itValue = validMap.find(value.get());
-			if (itValue != validMap.end()) {
-				validMap[value.get()].push_back(item);
-			}
-			else {
-				validMap[value.get()] = {item};
-			}
+			valueEntries.push_back(std::make_pair(value.get(), item));
 		}
 	}
-	if (validMap.size() < _count) {
+	std::stable_sort(valueEntries.begin(), valueEntries.end(), compareValueEntries);
+	int	valueCount = 0;
+	for (int index = 0; index < valueEntries.size(); index ++) {
+		if ((!index) || !(valueEntries[index].first == valueEntries[index-1].first)) {
+			valueCount ++;
+		}
+	}
+
+	if (valueCount < _count) {
 		if (g_replicationdebug > 3) {
-			printf("Across too few values:%3lu <%2d key: %-7s policy: %-10s => %s\n", validMap.size(), _count, _attribKey.c_str(), _policy->name().c_str(), _policy->info().c_str());
+			printf("Across too few values:%3d <%2d key: %-7s policy: %-10s => %s\n", valueCount, _count, _attribKey.c_str(), _policy->name().c_str(), _policy->info().c_str());
 		}
 		valid = false;
 	}
+	// One replica from each value is all PolicyOne asks for, so there is no need to split up the solution
+	else if ((dynamic_cast<PolicyOne*>(_policy.getPtr())) && (fromServers->size() > 0)) {
+		if (g_replicationdebug > 3) {
+			printf("Across check values:%9d key: %-7s solutions:%2lu count:%2d policy: %-10s => %s\n", valueCount, _attribKey.c_str(), solutionSet.size(), _count, _policy->name().c_str(), _policy->info().c_str());
+		}
+	}
 	else {
 		if (g_replicationdebug > 3) {
-			printf("Across check values:%9lu key: %-7s solutions:%2lu count:%2d policy: %-10s => %s\n", validMap.size(), _attribKey.c_str(), solutionSet.size(), _count, _policy->name().c_str(), _policy->info().c_str());
-			for (auto& itValue : validMap) {
-				printf("   value: (%3d) %-10s\n", itValue.first._id, fromServers->valueText(itValue.first).c_str());
-			}
+			printf("Across check values:%9d key: %-7s solutions:%2lu count:%2d policy: %-10s => %s\n", valueCount, _attribKey.c_str(), solutionSet.size(), _count, _policy->name().c_str(), _policy->info().c_str());
 		}
-		for (auto& itValid : validMap) {
-			if (_policy->validate(itValid.second, fromServers)) {
+		std::vector<LocalityEntry>	group;
+		for (int begin = 0, end; begin < valueEntries.size(); begin = end) {
+			AttribValue	value = valueEntries[begin].first;
+			group.clear();
+			for (end = begin; (end < valueEntries.size()) && (valueEntries[end].first == value); end ++) {
+				group.push_back(valueEntries[end].second);
+			}
+			if (_policy->validate(group, fromServers)) {
 				if (g_replicationdebug > 4) {
-					printf("Across valid solution: %6lu key: %-7s count:%3d of%3d value: (%3d) %-10s policy: %-10s => %s\n", itValid.second.size(), _attribKey.c_str(), count+1, _count, itValid.first._id, fromServers->valueText(itValid.first).c_str(), _policy->name().c_str(), _policy->info().c_str());
+					printf("Across valid solution: %6lu key: %-7s count:%3d of%3d value: (%3d) %-10s policy: %-10s => %s\n", group.size(), _attribKey.c_str(), count+1, _count, value._id, fromServers->valueText(value).c_str(), _policy->name().c_str(), _policy->info().c_str());
 					if (g_replicationdebug > 5) {
-						for (auto& entry : itValid.second) {
+						for (auto& entry : group) {
 							printf("   entry: %s\n", fromServers->getEntryInfo(entry).c_str());
 						}
 					}
 				}
 				count ++;
+				if (count >= _count) break;
 			}
 			else if (g_replicationdebug > 4) {
-				printf("Across invalid solution:%5lu key: %-7s value: (%3d) %-10s policy: %-10s => %s\n", itValid.second.size(), _attribKey.c_str(), itValid.first._id, fromServers->valueText(itValid.first).c_str(), _policy->name().c_str(), _policy->info().c_str());
+				printf("Across invalid solution:%5lu key: %-7s value: (%3d) %-10s policy: %-10s => %s\n", group.size(), _attribKey.c_str(), value._id, fromServers->valueText(value).c_str(), _policy->name().c_str(), _policy->info().c_str());
 				if (g_replicationdebug > 5) {
-					for (auto& entry : itValid.second) {
+					for (auto& entry : group) {
 						printf("   entry: %s\n", fromServers->getEntryInfo(entry).c_str());
 					}
 				}
@@ -204,7 +232,7 @@ bool PolicyAcross::validate(
 		}
 		if (count < _count) {
 			if (g_replicationdebug > 3) {
-				printf("Across failed solution: %3lu  key: %-7s values:%3lu count: %d=%d policy: %-10s => %s\n", solutionSet.size(), _attribKey.c_str(), validMap.size(),  count, _count, _policy->name().c_str(), _policy->info().c_str());
+				printf("Across failed solution: %3lu  key: %-7s values:%3d count: %d=%d policy: %-10s => %s\n", solutionSet.size(), _attribKey.c_str(), valueCount,  count, _count, _policy->name().c_str(), _policy->info().c_str());
 				for (auto& entry : solutionSet) {
 					printf("   entry: %s\n", fromServers->getEntryInfo(entry).c_str());
 				}
@@ -222,7 +250,7 @@ bool PolicyAcross::selectReplicas(
 {
 	int					count = 0;
 	AttribKey		indexKey = fromServers->keyIndex(_attribKey);
-	auto				groupIndexKey = fromServers->getGroupKeyIndex(indexKey);
+	auto				groupIndexKey = groupKeyIndex(fromServers);
 	int					resultsSize, resultsAdded;
 	int					resultsInit = results.size();
 
@@ -237,8 +265,7 @@ bool PolicyAcross::selectReplicas(
 	for (auto& alsoServer : alsoServers) {
 		auto value = fromServers->getValueViaGroupKey(alsoServer, groupIndexKey);
 		if (value.present()) {
-			auto lowerBound = std::lower_bound(_usedValues.begin(), _usedValues.end(), value.get());
-			if ((lowerBound == _usedValues.end()) || (*lowerBound != value.get())) {
+			if (!isUsedValue(value.get())) {
 				_selected = fromServers->restrict(indexKey, value.get());
 				if (_selected->size()) {
 					// Pass only the also array item which are valid for the value
@@ -259,7 +286,7 @@ bool PolicyAcross::selectReplicas(
 							printf("Across !added:%3d key: %-7s count:%3d of%3d value: (%3d) %-10s entry: %s\n", resultsAdded, _attribKey.c_str(), count, _count, value.get()._id, fromServers->valueText(value.get()).c_str(), fromServers->getEntryInfo(alsoServer).c_str());
 						}
 						if (count >= _count) break;
-						_usedValues.insert(lowerBound, value.get());
+						addUsedValue(value.get());
 					}
 					else if (g_replicationdebug > 5) {
 						printf("Across !no answer key: %-7s value: (%3d) %-10s entry: %s\n", _attribKey.c_str(), value.get()._id, fromServers->valueText(value.get()).c_str(), fromServers->getEntryInfo(alsoServer).c_str());
@@ -324,8 +351,7 @@ bool PolicyAcross::selectReplicas(
 			auto& entry = mutableArray[recordIndex];
 			auto value = fromServers->getValueViaGroupKey(entry, groupIndexKey);
 			if (value.present()) {
-				auto lowerBound = std::lower_bound(_usedValues.begin(), _usedValues.end(), value.get());
-				if ((lowerBound == _usedValues.end()) || (*lowerBound != value.get())) {
+				if (!isUsedValue(value.get())) {
 					_selected = fromServers->restrict(indexKey, value.get());
 					if (_selected->size()) {
 						if (g_replicationdebug > 5) {
@@ -338,7 +364,7 @@ bool PolicyAcross::selectReplicas(
 							}
 							count ++;
 							if (count >= _count) break;
-							_usedValues.insert(lowerBound, value.get());
+							addUsedValue(value.get());
 						}
 						else if (g_replicationdebug > 5) {
 							printf("Across no answer  key: %-7s value: (%3d) %-10s entry: %s\n", _attribKey.c_str(), value.get()._id, fromServers->valueText(value.get()).c_str(), fromServers->getEntryInfo(entry).c_str());
@@ -149,8 +149,22 @@ protected:
 	std::string												_attribKey;
 	IRepPolicyRef								_policy;
 
+	// The index of _attribKey in the key map of fromServers' locality group, remembered from the last call since looking it
+	// up goes through a string map
+	AttribKey groupKeyIndex(LocalitySetRef const& fromServers) const;
+	mutable Reference<StringToIntMap>	_groupKeyMap;
+	mutable AttribKey									_groupKey;
+
+	// The values already used by selectReplicas(), as a bitset indexed by value id (ids are dense in the group's value map)
+	bool isUsedValue(AttribValue value) const
+	{ return (value._id >> 6) < _usedValues.size() && ((_usedValues[value._id >> 6] >> (value._id & 63)) & 1); }
+	void addUsedValue(AttribValue value) {
+		if ((value._id >> 6) >= _usedValues.size()) _usedValues.resize((value._id >> 6) + 1, 0);
+		_usedValues[value._id >> 6] |= uint64_t(1) << (value._id & 63);
+	}
+
 	// Cache temporary members
-	std::vector<AttribValue>					_usedValues;
+	std::vector<uint64_t>							_usedValues;
 	std::vector<LocalityEntry>				_newResults;
 	LocalitySetRef										_selected;
 	VectorRef<std::pair<int,int>>			_addedResults;
@@ -224,7 +238,7 @@ protected:
 	std::vector<IRepPolicyRef>			_sortedPolicies;
 };
 
-extern int testReplication();
+extern int testReplication(int rackScale, int defaultTests);
 
 
 template <class Ar>
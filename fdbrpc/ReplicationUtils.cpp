@@ -698,7 +698,7 @@ IRepPolicyRef const randomAcrossPolicy(LocalitySet const&	serverSet)
 	return policy;
 }
 
-int testReplication()
+int testReplication(int rackScale, int defaultTests)
 {
 	const char*							testTotalEnv = getenv("REPLICATION_TESTTOTAL");
 	const char* 						debugLevelEnv = getenv("REPLICATION_DEBUGLEVEL");
@@ -713,7 +713,7 @@ int testReplication()
 	const char*							rateSampleEnv = getenv("REPLICATION_RATESAMPLE");
 	const char*							policySampleEnv = getenv("REPLICATION_POLICYSAMPLE");
 	const char*							policyMinEnv = getenv("REPLICATION_POLICYEXTRA");
-	int											totalTests = testTotalEnv ? atoi(testTotalEnv) : 10000;
+	int											totalTests = testTotalEnv ? atoi(testTotalEnv) : defaultTests;
 	int											skipTotal = skipTotalEnv ? atoi(skipTotalEnv) : 0;
 	int											findBest = findBestEnv ? atoi(findBestEnv) : 0;
 	int											policyIndexStatic = policyIndexEnv ? atoi(policyIndexEnv) : -1;
@@ -733,7 +733,7 @@ int testReplication()
 	if (debugLevelEnv) g_replicationdebug = atoi(debugLevelEnv);
 	debugBackup = g_replicationdebug;
 
-	testServers = createTestLocalityMap(serverIndexes, g_random->randomInt(1, 5), g_random->randomInt(1, 6), g_random->randomInt(1, 10), g_random->randomInt(1, 10), g_random->randomInt(0, 4), g_random->randomInt(1, 5));
+	testServers = createTestLocalityMap(serverIndexes, g_random->randomInt(1, 5), g_random->randomInt(1, 6), g_random->randomInt(1, 10) * rackScale, g_random->randomInt(1, 10), g_random->randomInt(0, 4), g_random->randomInt(1, 5));
 	maxAlsoSize = testServers->size() / g_random->randomInt(2, 20);
 
 	if (g_replicationdebug >= 0) printf("Running %d Replication test\n", totalTests);
@@ -841,3 +841,15 @@ TEST_CASE("fdbrpc/Replication/test") {
 	ASSERT(testReplication() == 0);
 	return Void();
 }
+
+TEST_CASE("fdbrpc/Replication/large") {
+	printf("Running large replication test\n");
+
+	platform::setEnvironmentVar("REPLICATION_STOPONERROR", "1", 0);
+	platform::setEnvironmentVar("REPLICATION_VALIDATE", "1", 0);
+
+	double start = timer();
+	ASSERT(testReplication(50, 200) == 0);
+	printf("Large replication test took %.3f seconds\n", timer() - start);
+	return Void();
+}
@@ -31,7 +31,8 @@ typedef std::string	repTestType;
 extern repTestType	convertToTestType(int	iValue);
 
 
-extern int testReplication();
+// rackScale multiplies the number of racks in the test locality map, for timing policies over large clusters
+extern int testReplication(int rackScale = 1, int defaultTests = 10000);
 
 extern double ratePolicy(
 	LocalitySetRef &					localitySet,
@@ -136,18 +136,28 @@ int TLSConnection::write( SendBuffer const* buffer, int limit ) {
 	handshook.get();
 
 	write_wants = 0;
-	int toSend = std::min(limit, buffer->bytes_written - buffer->bytes_sent);
-	ASSERT(toSend);
-	int w = session->write( buffer->data + buffer->bytes_sent, toSend );
-	if ( w > 0 )
-		return w;
-
-	if ( w == ITLSSession::FAILED ) throw connection_failed();
 
-	ASSERT( w == ITLSSession::WANT_WRITE || w == ITLSSession::WANT_READ );
+	// Keep writing buffers until the session stops taking them, rather than returning after the first one and making
+	// connectionWriter wait for onWritable() and yield once per PacketBuffer
+	int sent = 0;
+	for(auto p = buffer; p && limit > 0; p = p->next) {
+		int toSend = std::min(limit, p->bytes_written - p->bytes_sent);
+		if (!toSend) continue;
+
+		int w = session->write( p->data + p->bytes_sent, toSend );
+		if ( w == ITLSSession::FAILED ) throw connection_failed();
+		if ( w <= 0 ) {
+			ASSERT( w == ITLSSession::WANT_WRITE || w == ITLSSession::WANT_READ );
+			write_wants = w;
+			break;
+		}
 
-	write_wants = w;
-	return 0;
+		sent += w;
+		limit -= w;
+		if ( w < toSend ) break;
+	}
+	ASSERT( sent || write_wants );
+	return sent;
 }
 
 ACTOR Future<Reference<IConnection>> wrap( Reference<ITLSPolicy> policy, bool is_client, Future<Reference<IConnection>> c ) {
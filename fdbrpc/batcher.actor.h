@@ -47,7 +47,7 @@ bool firstInBatch(CommitTransactionRequest x) {
 }
 
 ACTOR template <class X>
-Future<Void> batcher(PromiseStream<std::vector<X>> out, FutureStream<X> in, double avgMinDelay, double* avgMaxDelay, double emptyBatchTimeout, int maxCount, int desiredBytes, int maxBytes, Optional<PromiseStream<Void>> batchStartedStream, int taskID = TaskDefaultDelay, Counter* counter = 0)
+Future<Void> batcher(PromiseStream<std::vector<X>> out, FutureStream<X> in, double avgMinDelay, double* avgMaxDelay, double emptyBatchTimeout, int* maxCount, int* desiredBytes, int maxBytes, Optional<PromiseStream<Void>> batchStartedStream, int taskID = TaskDefaultDelay, Counter* counter = 0)
 {
 	Void _ = wait( delayJittered(*avgMaxDelay, taskID) );  // smooth out
 	// This is set up to deliver even zero-size batches if emptyBatchTimeout elapses, because that's what master proxy wants.  The source control history
@@ -65,7 +65,8 @@ Future<Void> batcher(PromiseStream<std::vector<X>> out, FutureStream<X> in, doub
 		else
 			timeout = delayJittered(emptyBatchTimeout, taskID);
 
-		while (!timeout.isReady() && !(batch.size() == maxCount || batchBytes >= desiredBytes)) {
+		// The caller may adjust *maxCount and *desiredBytes (like *avgMaxDelay) between batches
+		while (!timeout.isReady() && !(batch.size() >= *maxCount || batchBytes >= *desiredBytes)) {
 			choose {
 				when ( X x  = waitNext(in) ) {
 					if (counter) ++*counter;
@@ -29,14 +29,22 @@
 
 #define NOMINMAX
 
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC32C_ARM 1
+#include <arm_acle.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CRC32C_X86 1
 #include <nmmintrin.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <random>
 #include <algorithm>
 #include "Platform.h"
 #include "generated-constants.cpp"
+#ifdef CRC32C_X86
 #pragma GCC target("sse4.2")
+#endif
 
 static uint32_t append_trivial(uint32_t crc, const uint8_t * input, size_t length)
 {
@@ -91,14 +99,14 @@ static uint32_t append_adler_table(uint32_t crci, const uint8_t * input, size_t
 static uint32_t append_table(uint32_t crci, const uint8_t * input, size_t length)
 {
     const uint8_t * next = input;
-#ifdef _M_X64
+#if defined(_M_X64) || defined(__x86_64__) || defined(__aarch64__)
     uint64_t crc;
 #else
     uint32_t crc;
 #endif
 
     crc = crci ^ 0xffffffff;
-#ifdef _M_X64
+#if defined(_M_X64) || defined(__x86_64__) || defined(__aarch64__)
     while (length && ((uintptr_t)next & 7) != 0)
     {
         crc = table[0][(crc ^ *next++) & 0xff] ^ (crc >> 8);
@@ -171,153 +179,104 @@ static inline uint32_t shift_crc(uint32_t shift_table[][256], uint32_t crc)
         ^ shift_table[3][crc >> 24];
 }
 
-/* Compute CRC-32C using the Intel hardware instruction. */
+/* The hardware CRC-32C instructions, eight bytes or one byte at a time.  32-bit x86 has no eight byte form, so two
+   four byte instructions stand in for it. */
+#if defined(CRC32C_ARM) || defined(CRC32C_X86)
+#if defined(CRC32C_ARM)
+static inline uint32_t hw_crc_u8(uint32_t crc, uint8_t v) { return __crc32cb(crc, v); }
+static inline uint32_t hw_crc_u64(uint32_t crc, uint64_t v) { return __crc32cd(crc, v); }
+#elif defined(_M_X64) || defined(__x86_64__)
+static inline uint32_t hw_crc_u8(uint32_t crc, uint8_t v) { return _mm_crc32_u8(crc, v); }
+static inline uint32_t hw_crc_u64(uint32_t crc, uint64_t v) { return static_cast<uint32_t>(_mm_crc32_u64(crc, v)); }
+#else
+static inline uint32_t hw_crc_u8(uint32_t crc, uint8_t v) { return _mm_crc32_u8(crc, v); }
+static inline uint32_t hw_crc_u64(uint32_t crc, uint64_t v) { return _mm_crc32_u32(_mm_crc32_u32(crc, static_cast<uint32_t>(v)), static_cast<uint32_t>(v >> 32)); }
+#endif
+
+/* Compute the crc on 3*shift byte blocks, executing three independent crc instructions, each on shift bytes, and
+   combining them with the zeros operator for shift bytes.  The crc instructions have a throughput of one per cycle
+   but a latency of three cycles on Intel processors since Nehalem (and similarly on ARM), so three independent
+   streams keep the unit busy where a single dependent chain would run at a third of the speed. */
+static inline uint32_t append_hw_blocks(uint32_t crc0, const uint8_t *& next, size_t& len, size_t shift, uint32_t shift_table[][256])
+{
+    while (len >= 3 * shift)
+    {
+        uint32_t crc1 = 0;
+        uint32_t crc2 = 0;
+        const uint8_t * end = next + shift;
+        do
+        {
+            crc0 = hw_crc_u64(crc0, *reinterpret_cast<const uint64_t *>(next));
+            crc1 = hw_crc_u64(crc1, *reinterpret_cast<const uint64_t *>(next + shift));
+            crc2 = hw_crc_u64(crc2, *reinterpret_cast<const uint64_t *>(next + 2 * shift));
+            next += 8;
+        } while (next < end);
+        crc0 = shift_crc(shift_table, crc0) ^ crc1;
+        crc0 = shift_crc(shift_table, crc0) ^ crc2;
+        next += 2 * shift;
+        len -= 3 * shift;
+    }
+    return crc0;
+}
+
+/* Compute CRC-32C using the hardware instruction. */
 static uint32_t append_hw(uint32_t crc, const uint8_t * buf, size_t len)
 {
     const uint8_t * next = buf;
-    const uint8_t * end;
-#ifdef _M_X64
-    uint64_t crc0, crc1, crc2;      /* need to be 64 bits for crc32q */
-#else
-    uint32_t crc0, crc1, crc2;
-#endif
 
     /* pre-process the crc */
-    crc0 = crc ^ 0xffffffff;
+    uint32_t crc0 = crc ^ 0xffffffff;
 
     /* compute the crc for up to seven leading bytes to bring the data pointer
        to an eight-byte boundary */
     while (len && ((uintptr_t)next & 7) != 0)
     {
-        crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *next);
+        crc0 = hw_crc_u8(crc0, *next);
         ++next;
         --len;
     }
 
-#ifdef _M_X64
-    /* compute the crc on sets of LONG_SHIFT*3 bytes, executing three independent crc
-       instructions, each on LONG_SHIFT bytes -- this is optimized for the Nehalem,
-       Westmere, Sandy Bridge, and Ivy Bridge architectures, which have a
-       throughput of one crc per cycle, but a latency of three cycles */
-    while (len >= 3 * LONG_SHIFT)
-    {
-        crc1 = 0;
-        crc2 = 0;
-        end = next + LONG_SHIFT;
-        do
-        {
-            crc0 = _mm_crc32_u64(crc0, *reinterpret_cast<const uint64_t *>(next));
-            crc1 = _mm_crc32_u64(crc1, *reinterpret_cast<const uint64_t *>(next + LONG_SHIFT));
-            crc2 = _mm_crc32_u64(crc2, *reinterpret_cast<const uint64_t *>(next + 2 * LONG_SHIFT));
-            next += 8;
-        } while (next < end);
-        crc0 = shift_crc(long_shifts, static_cast<uint32_t>(crc0)) ^ crc1;
-        crc0 = shift_crc(long_shifts, static_cast<uint32_t>(crc0)) ^ crc2;
-        next += 2 * LONG_SHIFT;
-        len -= 3 * LONG_SHIFT;
-    }
-
-    /* do the same thing, but now on SHORT_SHIFT*3 blocks for the remaining data less
-       than a LONG_SHIFT*3 block */
-    while (len >= 3 * SHORT_SHIFT)
-    {
-        crc1 = 0;
-        crc2 = 0;
-        end = next + SHORT_SHIFT;
-        do
-        {
-            crc0 = _mm_crc32_u64(crc0, *reinterpret_cast<const uint64_t *>(next));
-            crc1 = _mm_crc32_u64(crc1, *reinterpret_cast<const uint64_t *>(next + SHORT_SHIFT));
-            crc2 = _mm_crc32_u64(crc2, *reinterpret_cast<const uint64_t *>(next + 2 * SHORT_SHIFT));
-            next += 8;
-        } while (next < end);
-        crc0 = shift_crc(short_shifts, static_cast<uint32_t>(crc0)) ^ crc1;
-        crc0 = shift_crc(short_shifts, static_cast<uint32_t>(crc0)) ^ crc2;
-        next += 2 * SHORT_SHIFT;
-        len -= 3 * SHORT_SHIFT;
-    }
+    /* interleave three streams over large blocks, then over smaller blocks for the remaining data less than
+       a LONG_SHIFT*3 block */
+    crc0 = append_hw_blocks(crc0, next, len, LONG_SHIFT, long_shifts);
+    crc0 = append_hw_blocks(crc0, next, len, SHORT_SHIFT, short_shifts);
 
     /* compute the crc on the remaining eight-byte units less than a SHORT_SHIFT*3
-    block */
-    end = next + (len - (len & 7));
+       block */
+    const uint8_t * end = next + (len - (len & 7));
     while (next < end)
     {
-        crc0 = _mm_crc32_u64(crc0, *reinterpret_cast<const uint64_t *>(next));
+        crc0 = hw_crc_u64(crc0, *reinterpret_cast<const uint64_t *>(next));
         next += 8;
     }
-#else
-    /* compute the crc on sets of LONG_SHIFT*3 bytes, executing three independent crc
-    instructions, each on LONG_SHIFT bytes -- this is optimized for the Nehalem,
-    Westmere, Sandy Bridge, and Ivy Bridge architectures, which have a
-    throughput of one crc per cycle, but a latency of three cycles */
-    while (len >= 3 * LONG_SHIFT)
-    {
-        crc1 = 0;
-        crc2 = 0;
-        end = next + LONG_SHIFT;
-        do
-        {
-            crc0 = _mm_crc32_u32(crc0, *reinterpret_cast<const uint32_t *>(next));
-            crc1 = _mm_crc32_u32(crc1, *reinterpret_cast<const uint32_t *>(next + LONG_SHIFT));
-            crc2 = _mm_crc32_u32(crc2, *reinterpret_cast<const uint32_t *>(next + 2 * LONG_SHIFT));
-            next += 4;
-        } while (next < end);
-        crc0 = shift_crc(long_shifts, static_cast<uint32_t>(crc0)) ^ crc1;
-        crc0 = shift_crc(long_shifts, static_cast<uint32_t>(crc0)) ^ crc2;
-        next += 2 * LONG_SHIFT;
-        len -= 3 * LONG_SHIFT;
-    }
-
-    /* do the same thing, but now on SHORT_SHIFT*3 blocks for the remaining data less
-    than a LONG_SHIFT*3 block */
-    while (len >= 3 * SHORT_SHIFT)
-    {
-        crc1 = 0;
-        crc2 = 0;
-        end = next + SHORT_SHIFT;
-        do
-        {
-            crc0 = _mm_crc32_u32(crc0, *reinterpret_cast<const uint32_t *>(next));
-            crc1 = _mm_crc32_u32(crc1, *reinterpret_cast<const uint32_t *>(next + SHORT_SHIFT));
-            crc2 = _mm_crc32_u32(crc2, *reinterpret_cast<const uint32_t *>(next + 2 * SHORT_SHIFT));
-            next += 4;
-        } while (next < end);
-        crc0 = shift_crc(short_shifts, static_cast<uint32_t>(crc0)) ^ crc1;
-        crc0 = shift_crc(short_shifts, static_cast<uint32_t>(crc0)) ^ crc2;
-        next += 2 * SHORT_SHIFT;
-        len -= 3 * SHORT_SHIFT;
-    }
-
-    /* compute the crc on the remaining eight-byte units less than a SHORT_SHIFT*3
-    block */
-    end = next + (len - (len & 7));
-    while (next < end)
-    {
-        crc0 = _mm_crc32_u32(crc0, *reinterpret_cast<const uint32_t *>(next));
-        next += 4;
-    }
-#endif
     len &= 7;
 
     /* compute the crc for up to seven trailing bytes */
     while (len)
     {
-        crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *next);
+        crc0 = hw_crc_u8(crc0, *next);
         ++next;
         --len;
     }
 
     /* return a post-processed crc */
-    return static_cast<uint32_t>(crc0) ^ 0xffffffff;
+    return crc0 ^ 0xffffffff;
 }
 
 
+#endif // CRC32C_ARM || CRC32C_X86
+
+#if defined(CRC32C_ARM)
+static bool hw_available = true;  // The compiler was told that the target has the CRC extension
+#elif defined(CRC32C_X86)
 static bool hw_available = platform::isSse42Supported();
+#endif
 
 extern "C" uint32_t crc32c_append(uint32_t crc, const uint8_t * input, size_t length)
 {
+#if defined(CRC32C_ARM) || defined(CRC32C_X86)
     if (hw_available)
         return append_hw(crc, input, length);
-    else
-        return append_table(crc, input, length);
+#endif
+    return append_table(crc, input, length);
 }
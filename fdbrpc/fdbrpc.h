@@ -25,6 +25,7 @@
 #include "flow/flow.h"
 #include "FlowTransport.h" // NetworkMessageReceiver Endpoint
 #include "FailureMonitor.h"
+#include <typeinfo>
 
 
 struct FlowReceiver : private NetworkMessageReceiver {
@@ -234,7 +235,7 @@ public:
 	template <class X>
 	Future< REPLY_TYPE(X) > getReply(const X& value) const {
 		if (queue->isRemoteEndpoint()) {
-			return sendCanceler(getReplyPromise(value), FlowTransport::transport().sendReliable(SerializeSource<T>(value), getEndpoint()), getEndpoint());
+			return sampleLatency(value, sendCanceler(getReplyPromise(value), FlowTransport::transport().sendReliable(SerializeSource<T>(value), getEndpoint()), getEndpoint()));
 		}
 		send(value);
 		return reportEndpointFailure(getReplyPromise(value).getFuture(), getEndpoint());
@@ -270,7 +271,7 @@ public:
 			}
 			FlowTransport::transport().sendUnreliable(SerializeSource<T>(value), getEndpoint(taskID));
 			auto& p = getReplyPromise(value);
-			return waitValueOrSignal(p.getFuture(), disc, getEndpoint(taskID), p);
+			return sampleLatency(value, waitValueOrSignal(p.getFuture(), disc, getEndpoint(taskID), p));
 		}
 		send(value);
 		auto& p = getReplyPromise(value);
@@ -286,7 +287,7 @@ public:
 			}
 			FlowTransport::transport().sendUnreliable(SerializeSource<T>(value), getEndpoint());
 			auto& p = getReplyPromise(value);
-			return waitValueOrSignal(p.getFuture(), disc, getEndpoint(), p);
+			return sampleLatency(value, waitValueOrSignal(p.getFuture(), disc, getEndpoint(), p));
 		}
 		else {
 			send(value);
@@ -346,6 +347,15 @@ public:
 
 private:
 	NetNotifiedQueue<T>* queue;
+
+	template <class X, class R>
+	Future<R> sampleLatency(const X& value, Future<R> reply) const {
+		if (FLOW_KNOBS->RPC_LATENCY_SAMPLE_RATE <= 0 || reply.isReady() || g_random->random01() >= FLOW_KNOBS->RPC_LATENCY_SAMPLE_RATE)
+			return reply;
+		BinaryWriter wr(AssumeVersion(currentProtocolVersion));
+		wr << static_cast<const T&>(value);
+		return recordReplyLatency(reply, typeid(T).name(), wr.getLength());
+	}
 };
 
 template <class Ar, class T>
@@ -192,6 +192,21 @@ Future<T> sendCanceler( ReplyPromise<T> reply, PacketID send, Endpoint endpoint
 	}
 }
 
+template <class X>
+bool isSuccessfulReply( X const& ) { return true; }
+template <class X>
+bool isSuccessfulReply( ErrorOr<X> const& reply ) { return reply.present(); }
+
+// Implements latency sampling for getReply and tryGetReply
+ACTOR template <class X>
+Future<X> recordReplyLatency( Future<X> reply, const char* requestType, int requestBytes ) {
+	state double startTime = now();
+	X x = wait(reply);
+	if (isSuccessfulReply(x))
+		FlowTransport::transport().recordRpcLatency(requestType, now() - startTime, requestBytes);
+	return x;
+}
+
 ACTOR template <class X>
 Future<X> reportEndpointFailure( Future<X> value, Endpoint endpoint ) {
 	try { 
@@ -26,7 +26,9 @@ enum {
 	IO_CMD_PREAD = 0,
 	IO_CMD_PWRITE = 1,
 	IO_CMD_FSYNC = 2,
-	IO_CMD_FDSYNC = 3
+	IO_CMD_FDSYNC = 3,
+	IO_CMD_PREADV = 7,
+	IO_CMD_PWRITEV = 8
 };
 
 struct linux_iocb {
@@ -0,0 +1,124 @@
+/*
+ * linux_uring.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// io_uring system calls and kernel ABI (Linux 5.1+).  Defined here, like linux_kaio.h, so that we do not depend
+// on the kernel headers or liburing being present on the build machine.
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+enum {
+	IORING_OP_NOP = 0,
+	IORING_OP_READV = 1,
+	IORING_OP_WRITEV = 2,
+	IORING_OP_FSYNC = 3
+};
+
+enum {
+	IORING_SETUP_IOPOLL = 1u << 0,
+	IORING_SETUP_SQPOLL = 1u << 1
+};
+
+enum { IOSQE_FIXED_FILE = 1u << 0 };
+enum { IORING_FSYNC_DATASYNC = 1u << 0 };
+enum { IORING_SQ_NEED_WAKEUP = 1u << 0 };
+
+enum {
+	IORING_ENTER_GETEVENTS = 1u << 0,
+	IORING_ENTER_SQ_WAKEUP = 1u << 1
+};
+
+enum {
+	IORING_REGISTER_FILES = 2,
+	IORING_UNREGISTER_FILES = 3,
+	IORING_REGISTER_EVENTFD = 4,
+	IORING_UNREGISTER_EVENTFD = 5,
+	IORING_REGISTER_FILES_UPDATE = 6
+};
+
+static const uint64_t IORING_OFF_SQ_RING = 0ULL;
+static const uint64_t IORING_OFF_CQ_RING = 0x8000000ULL;
+static const uint64_t IORING_OFF_SQES = 0x10000000ULL;
+
+struct linux_uring_sqe {
+	uint8_t opcode;
+	uint8_t flags;
+	uint16_t ioprio;
+	int32_t fd;
+	uint64_t off;
+	uint64_t addr;
+	uint32_t len;
+	uint32_t op_flags; // rw_flags or fsync_flags, depending on opcode
+	uint64_t user_data;
+	uint16_t buf_index;
+	uint16_t personality;
+	int32_t splice_fd_in;
+	uint64_t pad[2];
+};
+
+struct linux_uring_cqe {
+	uint64_t user_data;
+	int32_t res;
+	uint32_t flags;
+};
+
+struct linux_uring_sqring_offsets {
+	uint32_t head, tail, ring_mask, ring_entries, flags, dropped, array, resv1;
+	uint64_t resv2;
+};
+
+struct linux_uring_cqring_offsets {
+	uint32_t head, tail, ring_mask, ring_entries, overflow, cqes, flags, resv1;
+	uint64_t resv2;
+};
+
+struct linux_uring_params {
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+	uint32_t flags;
+	uint32_t sq_thread_cpu;
+	uint32_t sq_thread_idle;
+	uint32_t features;
+	uint32_t wq_fd;
+	uint32_t resv[3];
+	linux_uring_sqring_offsets sq_off;
+	linux_uring_cqring_offsets cq_off;
+};
+
+struct linux_uring_files_update {
+	uint32_t offset;
+	uint32_t resv;
+	uint64_t fds; // pointer to an array of int
+};
+
+static_assert( sizeof(linux_uring_sqe) == 64, "io_uring sqe ABI mismatch" );
+static_assert( sizeof(linux_uring_cqe) == 16, "io_uring cqe ABI mismatch" );
+static_assert( sizeof(linux_uring_params) == 120, "io_uring params ABI mismatch" );
+
+static int io_uring_setup(unsigned entries, linux_uring_params* p) { return syscall( __NR_io_uring_setup, entries, p ); }
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) { return syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0 ); }
+static int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) { return syscall( __NR_io_uring_register, fd, opcode, arg, nr_args ); }
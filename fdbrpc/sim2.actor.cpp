@@ -938,6 +938,9 @@ public:
 
 			self->execTask(t);
 			self->yielded = false;
+
+			if (FLOW_KNOBS->SIM_PROFILE_INTERVAL > 0 && timer() - self->profileStartTime >= FLOW_KNOBS->SIM_PROFILE_INTERVAL)
+				self->logProfile();
 		}
 		self->currentProcess = callingMachine;
 		self->net2->stop();
@@ -1500,7 +1503,7 @@ public:
 		machines.erase(zoneId);
 	}
 
-	Sim2() : time(0.0), taskCount(0), yielded(false), yield_limit(0), currentTaskID(-1) {
+	Sim2() : time(0.0), taskCount(0), yielded(false), yield_limit(0), currentTaskID(-1), profileStartTime(timer()) {
 		// Not letting currentProcess be NULL eliminates some annoying special cases
 		currentProcess = new ProcessInfo( "NoMachine", LocalityData(Optional<Standalone<StringRef>>(), StringRef(), StringRef(), StringRef()), ProcessClass(), NetworkAddress(), this, "", "" );
 		g_network = net2 = newNet2(NetworkAddress(), false, true);
@@ -1539,6 +1542,7 @@ public:
 			mutex.leave();
 
 			this->currentProcess = t.machine;
+			double before = FLOW_KNOBS->SIM_PROFILE_INTERVAL > 0 ? timer() : 0;
 			try {
 				//auto before = getCPUTicks();
 				t.action.send(Void());
@@ -1553,6 +1557,11 @@ public:
 				TraceEvent(SevError, "UnhandledSimulationEventError").error(e, true);
 				killProcess(t.machine, KillInstantly);
 			}
+			if (before) {
+				double elapsed = timer() - before;
+				profileByClass[t.machine->startingClass.classType()].add(elapsed);
+				profileByTaskID[t.taskID].add(elapsed);
+			}
 
 			//if( this->time > 45.522817 ) {
 			//	printf("foo\n");
@@ -1563,6 +1572,35 @@ public:
 		}
 	}
 
+	// Traces where the simulator's own (wall clock) time went since the last call, by the starting class of the simulated process
+	// and by the task priority that ran, so that slow tests can be sped up
+	void logProfile() {
+		double elapsed = timer() - profileStartTime;
+		double busy = 0;
+		for(auto& c : profileByClass) {
+			busy += c.second.seconds;
+			TraceEvent("SimulatorProfileByClass").detail("Class", ProcessClass(c.first, ProcessClass::CommandLineSource).toString())
+				.detail("Tasks", c.second.tasks).detail("Seconds", c.second.seconds).detail("Fraction", c.second.seconds / elapsed);
+		}
+
+		std::vector<std::pair<double, int>> byTime;
+		for(auto& p : profileByTaskID)
+			byTime.push_back( std::make_pair(p.second.seconds, p.first) );
+		std::sort( byTime.begin(), byTime.end(), std::greater<std::pair<double, int>>() );
+		for(int i = 0; i < std::min<int>(byTime.size(), 10); i++) {
+			auto& p = profileByTaskID[byTime[i].second];
+			TraceEvent("SimulatorProfileByTask").detail("TaskID", byTime[i].second)
+				.detail("Tasks", p.tasks).detail("Seconds", p.seconds).detail("Fraction", p.seconds / elapsed);
+		}
+
+		TraceEvent("SimulatorProfile").detail("Elapsed", elapsed).detail("RunningTasks", busy).detail("SimulatedTime", time)
+			.detail("QueuedTasks", tasks.size()).detail("Processes", addressMap.size());
+
+		profileByClass.clear();
+		profileByTaskID.clear();
+		profileStartTime = timer();
+	}
+
 	virtual void onMainThread( Promise<Void>&& signal, int taskID ) {
 		// This is presumably coming from either a "fake" thread pool thread, i.e. it is actually on this thread
 		// or a thread created with g_network->startThread
@@ -1598,6 +1636,16 @@ public:
 	//tasks is guarded by ISimulator::mutex
 	std::priority_queue<Task, std::vector<Task>> tasks;
 
+	struct ProfileBucket {
+		int64_t tasks;
+		double seconds;
+		ProfileBucket() : tasks(0), seconds(0) {}
+		void add( double s ) { ++tasks; seconds += s; }
+	};
+	std::map<ProcessClass::ClassType, ProfileBucket> profileByClass;
+	std::map<int, ProfileBucket> profileByTaskID;
+	double profileStartTime;
+
 	//Sim2Net network;
 	INetwork *net2;
 
@@ -42,12 +42,95 @@ struct applyMutationsData {
 	Reference<KeyRangeMap<Version>> keyVersion;
 };
 
+// Interns the ServerCacheInfo of each distinct (src, dest) team referenced by a proxy's keyInfo map
+struct ServerTeamCache {
+	std::map<std::pair<vector<UID>, vector<UID>>, Reference<ServerCacheInfo>> teams;
+	int liveTeams;
+	uint64_t keyInfoChanges;	// Incremented whenever the keyInfo map using these teams is modified
+
+	ServerTeamCache() : liveTeams(0), keyInfoChanges(0) {}
+
+	// Teams that no shard uses any more are only referenced by this cache; drop them once the cache has about doubled
+	void prune() {
+		if(teams.size() <= 2 * (size_t)liveTeams + 10)
+			return;
+		for(auto it = teams.begin(); it != teams.end(); ) {
+			if(it->second->isSoleOwner())
+				teams.erase(it++);
+			else
+				++it;
+		}
+		liveTeams = teams.size();
+	}
+};
+
+static Reference<StorageInfo> getStorageInfo( UID id, std::map<UID, Reference<StorageInfo>>* storageCache, IKeyValueStore* txnStateStore ) {
+	Reference<StorageInfo> storageInfo;
+	auto cacheItr = storageCache->find(id);
+	if(cacheItr == storageCache->end()) {
+		storageInfo = Reference<StorageInfo>( new StorageInfo() );
+		storageInfo->tag = decodeServerTagValue( txnStateStore->readValue( serverTagKeyFor(id) ).get().get() );
+		storageInfo->interf = decodeServerListValue( txnStateStore->readValue( serverListKeyFor(id) ).get().get() );
+		(*storageCache)[id] = storageInfo;
+	} else {
+		storageInfo = cacheItr->second;
+	}
+	ASSERT(storageInfo->tag != invalidTag);
+	return storageInfo;
+}
+
+// Returns the ServerCacheInfo shared by every shard with source servers src and destination servers dest
+static Reference<ServerCacheInfo> getServerCacheInfo( vector<UID> const& src, vector<UID> const& dest, ServerTeamCache* teamCache, std::map<UID, Reference<StorageInfo>>* storageCache, IKeyValueStore* txnStateStore ) {
+	Reference<ServerCacheInfo>& info = teamCache->teams[std::make_pair(src, dest)];
+	if(!info) {
+		info = Reference<ServerCacheInfo>( new ServerCacheInfo() );
+		info->tags.reserve(src.size() + dest.size());
+		info->src_info.reserve(src.size());
+		info->dest_info.reserve(dest.size());
+
+		for(auto id : src) {
+			Reference<StorageInfo> storageInfo = getStorageInfo(id, storageCache, txnStateStore);
+			info->tags.push_back( storageInfo->tag );
+			info->src_info.push_back( storageInfo );
+		}
+		for(auto id : dest) {
+			Reference<StorageInfo> storageInfo = getStorageInfo(id, storageCache, txnStateStore);
+			info->tags.push_back( storageInfo->tag );
+			info->dest_info.push_back( storageInfo );
+		}
+		uniquify(info->tags);
+	}
+	return info;
+}
+
+// The ranges registered under clientCacheRangesRange, so that a proxy can set the clientCacheVersionKeyFor() each range it commits writes to
+struct ClientCacheRangeMap {
+	KeyRangeMap<std::set<Key>> versionKeys;  // Of the ranges containing each key
+	std::set<Key> changed;  // Version keys of the ranges registered, changed or unregistered since the proxy last took them
+
+	void remove( KeyRef begin, KeyRef end, Key const& versionKey ) {
+		if( begin < end ) {
+			for( auto& r : versionKeys.modify( KeyRangeRef( begin, end ) ) )
+				r->value().erase( versionKey );
+			versionKeys.coalesce( allKeys );
+		}
+		changed.insert( versionKey );
+	}
+	void add( KeyRef begin, KeyRef end, Key const& versionKey ) {
+		if( begin < end ) {
+			for( auto& r : versionKeys.modify( KeyRangeRef( begin, end ) ) )
+				r->value().insert( versionKey );
+		}
+		changed.insert( versionKey );
+	}
+};
+
 // It is incredibly important that any modifications to txnStateStore are done in such a way that
 // the same operations will be done on all proxies at the same time. Otherwise, the data stored in
 // txnStateStore will become corrupted.
 static void applyMetadataMutations(UID const& dbgid, Arena &arena, VectorRef<MutationRef> const& mutations, IKeyValueStore* txnStateStore, LogPushData* toCommit, bool *confChange, Reference<ILogSystem> logSystem = Reference<ILogSystem>(), Version popVersion = 0,
-	KeyRangeMap<std::set<Key> >* vecBackupKeys = NULL, KeyRangeMap<ServerCacheInfo>* keyInfo = NULL, std::map<Key, applyMutationsData>* uid_applyMutationsData = NULL,
-	RequestStream<CommitTransactionRequest> commit = RequestStream<CommitTransactionRequest>(), Database cx = Database(), NotifiedVersion* commitVersion = NULL, std::map<UID, Reference<StorageInfo>>* storageCache = NULL, bool initialCommit = false ) {
+	KeyRangeMap<std::set<Key> >* vecBackupKeys = NULL, KeyRangeMap<Reference<ServerCacheInfo>>* keyInfo = NULL, std::map<Key, applyMutationsData>* uid_applyMutationsData = NULL,
+	RequestStream<CommitTransactionRequest> commit = RequestStream<CommitTransactionRequest>(), Database cx = Database(), NotifiedVersion* commitVersion = NULL, std::map<UID, Reference<StorageInfo>>* storageCache = NULL, ServerTeamCache* teamCache = NULL, bool initialCommit = false, ClientCacheRangeMap* clientCacheRanges = NULL ) {
 	for (auto const& m : mutations) {
 		//TraceEvent("MetadataMutation", dbgid).detail("M", m.toString());
 
@@ -61,43 +144,10 @@ static void applyMetadataMutations(UID const& dbgid, Arena &arena, VectorRef<Mut
 						vector<UID> src, dest;
 						decodeKeyServersValue(m.param2, src, dest);
 
-						ASSERT(storageCache);
-						Reference<StorageInfo> storageInfo;
-						ServerCacheInfo info;
-						info.tags.reserve(src.size() + dest.size());
-						info.src_info.reserve(src.size());
-						info.dest_info.reserve(dest.size());
-
-						for(auto id : src) {
-							auto cacheItr = storageCache->find(id);
-							if(cacheItr == storageCache->end()) {
-								storageInfo = Reference<StorageInfo>( new StorageInfo() );
-								storageInfo->tag = decodeServerTagValue( txnStateStore->readValue( serverTagKeyFor(id) ).get().get() );
-								storageInfo->interf = decodeServerListValue( txnStateStore->readValue( serverListKeyFor(id) ).get().get() );
-								(*storageCache)[id] = storageInfo;
-							} else {
-								storageInfo = cacheItr->second;
-							}
-							ASSERT(storageInfo->tag != invalidTag);
-							info.tags.push_back( storageInfo->tag );
-							info.src_info.push_back( storageInfo );
-						}
-						for(auto id : dest) {
-							auto cacheItr = storageCache->find(id);
-							if(cacheItr == storageCache->end()) {
-								storageInfo = Reference<StorageInfo>( new StorageInfo() );
-								storageInfo->tag = decodeServerTagValue( txnStateStore->readValue( serverTagKeyFor(id) ).get().get() );
-								storageInfo->interf = decodeServerListValue( txnStateStore->readValue( serverListKeyFor(id) ).get().get() );
-								(*storageCache)[id] = storageInfo;
-							} else {
-								storageInfo = cacheItr->second;
-							}
-							ASSERT(storageInfo->tag != invalidTag);
-							info.tags.push_back( storageInfo->tag );
-							info.dest_info.push_back( storageInfo );
-						}
-						uniquify(info.tags);
-						keyInfo->insert(insertRange,info);
+						ASSERT(storageCache && teamCache);
+						keyInfo->insert(insertRange, getServerCacheInfo(src, dest, teamCache, storageCache, txnStateStore));
+						teamCache->keyInfoChanges++;
+						teamCache->prune();
 					}
 				}
 				if(!initialCommit) txnStateStore->set(KeyValueRef(m.param1, m.param2));
@@ -140,8 +190,8 @@ static void applyMetadataMutations(UID const& dbgid, Arena &arena, VectorRef<Mut
 						} else {
 							cacheItr->second->tag = tag;
 							//These tag vectors will be repopulated by the proxy when it detects their sizes are 0.
-							for(auto& it : keyInfo->ranges()) {
-								it.value().tags.clear();
+							for(auto& it : teamCache->teams) {
+								it.second->tags.clear();
 							}
 						}
 					}
@@ -231,6 +281,17 @@ static void applyMetadataMutations(UID const& dbgid, Arena &arena, VectorRef<Mut
 						.detail("logRangeBegin", printable(logRangeBegin)).detail("logRangeEnd", printable(logRangeEnd));
 				}
 			}
+			else if (m.param1.startsWith(clientCacheRangesRange.begin)) {
+				if (clientCacheRanges) {
+					KeyRef begin = decodeClientCacheRangeKey(m.param1);
+					Key versionKey = clientCacheVersionKeyFor(begin);
+					Optional<Value> oldEnd = txnStateStore->readValue(m.param1).get();
+					if (oldEnd.present())
+						clientCacheRanges->remove(begin, oldEnd.get(), versionKey);
+					clientCacheRanges->add(begin, m.param2, versionKey);
+				}
+				if(!initialCommit) txnStateStore->set(KeyValueRef(m.param1, m.param2));
+			}
 			else if (m.param1.startsWith(globalKeysPrefix)) {
 				if(toCommit) {
 					// Notifies all servers that a Master's server epoch ends
@@ -267,7 +328,10 @@ static void applyMetadataMutations(UID const& dbgid, Arena &arena, VectorRef<Mut
 				KeyRangeRef r = range & keyServersKeys;
 				if(keyInfo) {
 					KeyRangeRef clearRange(r.begin.removePrefix(keyServersPrefix), r.end.removePrefix(keyServersPrefix));
-					keyInfo->insert(clearRange, clearRange.begin == StringRef() ? ServerCacheInfo() : keyInfo->rangeContainingKeyBefore(clearRange.begin).value());
+					ASSERT(teamCache);
+					keyInfo->insert(clearRange, clearRange.begin == StringRef() ? getServerCacheInfo(vector<UID>(), vector<UID>(), teamCache, storageCache, txnStateStore) : keyInfo->rangeContainingKeyBefore(clearRange.begin).value());
+					teamCache->keyInfoChanges++;
+					teamCache->prune();
 				}
 
 				if(!initialCommit) txnStateStore->clear(r);
@@ -404,6 +468,17 @@ static void applyMetadataMutations(UID const& dbgid, Arena &arena, VectorRef<Mut
 
 				if(!initialCommit) txnStateStore->clear(commonLogRange);
 			}
+			if (range.intersects(clientCacheRangesRange)) {
+				KeyRangeRef r = range & clientCacheRangesRange;
+				if (clientCacheRanges) {
+					auto removed = txnStateStore->readRange(r).get();	// read is expected to be immediately available
+					for (auto& kv : removed) {
+						KeyRef begin = decodeClientCacheRangeKey(kv.key);
+						clientCacheRanges->remove(begin, kv.value, clientCacheVersionKeyFor(begin));
+					}
+				}
+				if(!initialCommit) txnStateStore->clear(r);
+			}
 		}
 	}
 }
@@ -50,13 +50,17 @@ struct WorkerInfo : NonCopyable {
 	ProcessClass initialClass;
 	ProcessClass processClass;
 	ClusterControllerPriorityInfo priorityInfo;
+	double diskLatency;  // The p99 latency of the disk operations in the last health report
+	double lastHealthReport;
+	double degradedUntil;  // Recruitment avoids the worker until then
 
-	WorkerInfo() : gen(-1), reboots(0), priorityInfo(ProcessClass::UnsetFit, false, ClusterControllerPriorityInfo::FitnessUnknown) {}
+	WorkerInfo() : gen(-1), reboots(0), priorityInfo(ProcessClass::UnsetFit, false, ClusterControllerPriorityInfo::FitnessUnknown), diskLatency(0), lastHealthReport(-1e9), degradedUntil(0) {}
 	WorkerInfo( Future<Void> watcher, ReplyPromise<RegisterWorkerReply> reply, Generation gen, WorkerInterface interf, ProcessClass initialClass, ProcessClass processClass, ClusterControllerPriorityInfo priorityInfo ) :
-		watcher(watcher), reply(reply), gen(gen), reboots(0), interf(interf), initialClass(initialClass), processClass(processClass), priorityInfo(priorityInfo) {}
+		watcher(watcher), reply(reply), gen(gen), reboots(0), interf(interf), initialClass(initialClass), processClass(processClass), priorityInfo(priorityInfo), diskLatency(0), lastHealthReport(-1e9), degradedUntil(0) {}
 
 	WorkerInfo( WorkerInfo&& r ) noexcept(true) : watcher(std::move(r.watcher)), reply(std::move(r.reply)), gen(r.gen),
-		reboots(r.reboots), interf(std::move(r.interf)), initialClass(r.initialClass), processClass(r.processClass), priorityInfo(r.priorityInfo) {}
+		reboots(r.reboots), interf(std::move(r.interf)), initialClass(r.initialClass), processClass(r.processClass), priorityInfo(r.priorityInfo),
+		diskLatency(r.diskLatency), lastHealthReport(r.lastHealthReport), degradedUntil(r.degradedUntil) {}
 	void operator=( WorkerInfo&& r ) noexcept(true) {
 		watcher = std::move(r.watcher);
 		reply = std::move(r.reply);
@@ -66,7 +70,12 @@ struct WorkerInfo : NonCopyable {
 		initialClass = r.initialClass;
 		processClass = r.processClass;
 		priorityInfo = r.priorityInfo;
+		diskLatency = r.diskLatency;
+		lastHealthReport = r.lastHealthReport;
+		degradedUntil = r.degradedUntil;
 	}
+
+	bool isDegraded() const { return now() < degradedUntil; }
 };
 
 struct WorkerFitnessInfo {
@@ -174,6 +183,7 @@ public:
 					!excludedMachines.count(it.second.interf.locality.zoneId()) &&
 					( includeDCs.size() == 0 || includeDCs.count(it.second.interf.locality.dcId()) ) &&
 					!addressExcluded(excludedAddresses, it.second.interf.address()) &&
+					!it.second.isDegraded() &&
 					it.second.processClass.machineClassFitness( ProcessClass::Storage ) <= ProcessClass::UnsetFit ) {
 				return std::make_pair(it.second.interf, it.second.processClass);
 			}
@@ -183,6 +193,9 @@ public:
 			Optional<std::pair<WorkerInterface, ProcessClass>> bestInfo;
 			for( auto& it : id_worker ) {
 				ProcessClass::Fitness fit = it.second.processClass.machineClassFitness( ProcessClass::Storage );
+				if( it.second.isDegraded() && fit != ProcessClass::NeverAssign ) {
+					fit = std::max( fit, ProcessClass::ExcludeFit );
+				}
 				if( workerAvailable( it.second, false ) &&
 						!excludedMachines.count(it.second.interf.locality.zoneId()) &&
 						( includeDCs.size() == 0 || includeDCs.count(it.second.interf.locality.dcId()) ) &&
@@ -210,6 +223,9 @@ public:
 
 		for( auto& it : id_worker ) {
 			auto fitness = it.second.processClass.machineClassFitness( ProcessClass::Storage );
+			if( it.second.isDegraded() && fitness != ProcessClass::NeverAssign ) {
+				fitness = std::max( fitness, ProcessClass::ExcludeFit );
+			}
 			if( workerAvailable(it.second, false) && !conf.isExcludedServer(it.second.interf.address()) && fitness != ProcessClass::NeverAssign && ( !dcId.present() || it.second.interf.locality.dcId()==dcId.get() ) ) {
 				fitness_workers[ fitness ].push_back(std::make_pair(it.second.interf, it.second.processClass));
 			}
@@ -255,6 +271,9 @@ public:
 
 		for( auto& it : id_worker ) {
 			auto fitness = it.second.processClass.machineClassFitness( ProcessClass::TLog );
+			if( it.second.isDegraded() && fitness != ProcessClass::NeverAssign ) {
+				fitness = std::max( fitness, ProcessClass::ExcludeFit );
+			}
 			if( workerAvailable(it.second, checkStable) && !conf.isExcludedServer(it.second.interf.address()) && fitness != ProcessClass::NeverAssign && (!dcIds.size() || dcIds.count(it.second.interf.locality.dcId())) ) {
 				fitness_workers[ fitness ].push_back(std::make_pair(it.second.interf, it.second.processClass));
 			}
@@ -386,15 +405,22 @@ public:
 	}
 
 	WorkerFitnessInfo getWorkerForRoleInDatacenter(Optional<Standalone<StringRef>> const& dcId, ProcessClass::ClusterRole role, ProcessClass::Fitness unacceptableFitness, DatabaseConfiguration const& conf, std::map< Optional<Standalone<StringRef>>, int>& id_used, bool checkStable = false ) {
-		std::map<std::pair<ProcessClass::Fitness,int>, vector<std::pair<WorkerInterface, ProcessClass>>> fitness_workers;
-
-		for( auto& it : id_worker ) {
-			auto fitness = it.second.processClass.machineClassFitness( role );
-			if(conf.isExcludedServer(it.second.interf.address())) {
-				fitness = std::max(fitness, ProcessClass::ExcludeFit);
-			}
-			if( workerAvailable(it.second, checkStable) && fitness < unacceptableFitness && it.second.interf.locality.dcId()==dcId ) {
-				fitness_workers[ std::make_pair(fitness, id_used[it.first]) ].push_back(std::make_pair(it.second.interf, it.second.processClass));
+		std::map<std::pair<ProcessClass::Fitness,int>, vector<WorkerInfo const*>> fitness_workers;
+
+		auto dcWorkers = dcId_processIds.find( dcId );
+		if( dcWorkers != dcId_processIds.end() ) {
+			for( auto& processId : dcWorkers->second ) {
+				auto& it = *id_worker.find( processId );
+				auto fitness = it.second.processClass.machineClassFitness( role );
+				if( fitness >= unacceptableFitness || !workerAvailable(it.second, checkStable) ) {
+					continue;
+				}
+				if(conf.isExcludedServer(it.second.interf.address())) {
+					fitness = std::max(fitness, ProcessClass::ExcludeFit);
+				}
+				if( fitness < unacceptableFitness ) {
+					fitness_workers[ std::make_pair(fitness, id_used[it.first]) ].push_back(&it.second);
+				}
 			}
 		}
 
@@ -402,8 +428,8 @@ public:
 			auto& w = it.second;
 			g_random->randomShuffle(w);
 			for( int i=0; i < w.size(); i++ ) {
-				id_used[w[i].first.locality.processId()]++;
-				return WorkerFitnessInfo(w[i], it.first.first, it.first.second);
+				id_used[w[i]->interf.locality.processId()]++;
+				return WorkerFitnessInfo(std::make_pair(w[i]->interf, w[i]->processClass), it.first.first, it.first.second);
 			}
 		}
 
@@ -411,16 +437,21 @@ public:
 	}
 
 	vector<std::pair<WorkerInterface, ProcessClass>> getWorkersForRoleInDatacenter(Optional<Standalone<StringRef>> const& dcId, ProcessClass::ClusterRole role, int amount, DatabaseConfiguration const& conf, std::map< Optional<Standalone<StringRef>>, int>& id_used, Optional<WorkerFitnessInfo> minWorker = Optional<WorkerFitnessInfo>(), bool checkStable = false ) {
-		std::map<std::pair<ProcessClass::Fitness,int>, vector<std::pair<WorkerInterface, ProcessClass>>> fitness_workers;
+		std::map<std::pair<ProcessClass::Fitness,int>, vector<WorkerInfo const*>> fitness_workers;
 		vector<std::pair<WorkerInterface, ProcessClass>> results;
 		if (amount <= 0)
 			return results;
 
-		for( auto& it : id_worker ) {
+		auto dcWorkers = dcId_processIds.find( dcId );
+		if( dcWorkers == dcId_processIds.end() )
+			return results;
+
+		for( auto& processId : dcWorkers->second ) {
+			auto& it = *id_worker.find( processId );
 			auto fitness = it.second.processClass.machineClassFitness( role );
-			if( workerAvailable(it.second, checkStable) && !conf.isExcludedServer(it.second.interf.address()) && it.second.interf.locality.dcId() == dcId &&
-			  ( !minWorker.present() || ( it.second.interf.id() != minWorker.get().worker.first.id() && ( fitness < minWorker.get().fitness || (fitness == minWorker.get().fitness && id_used[it.first] <= minWorker.get().used ) ) ) ) ) {
-				fitness_workers[ std::make_pair(fitness, id_used[it.first]) ].push_back(std::make_pair(it.second.interf, it.second.processClass));
+			if( ( !minWorker.present() || ( it.second.interf.id() != minWorker.get().worker.first.id() && ( fitness < minWorker.get().fitness || (fitness == minWorker.get().fitness && id_used[it.first] <= minWorker.get().used ) ) ) ) &&
+			  workerAvailable(it.second, checkStable) && !conf.isExcludedServer(it.second.interf.address()) ) {
+				fitness_workers[ std::make_pair(fitness, id_used[it.first]) ].push_back(&it.second);
 			}
 		}
 
@@ -428,8 +459,8 @@ public:
 			auto& w = it.second;
 			g_random->randomShuffle(w);
 			for( int i=0; i < w.size(); i++ ) {
-				results.push_back(w[i]);
-				id_used[w[i].first.locality.processId()]++;
+				results.push_back(std::make_pair(w[i]->interf, w[i]->processClass));
+				id_used[w[i]->interf.locality.processId()]++;
 				if( results.size() == amount )
 					return results;
 			}
@@ -527,6 +558,7 @@ public:
 
 	ErrorOr<RecruitFromConfigurationReply> findWorkersForConfiguration( RecruitFromConfigurationRequest const& req, Optional<Key> dcId ) {
 		RecruitFromConfigurationReply result;
+		result.configuration = req.configuration;
 		std::map< Optional<Standalone<StringRef>>, int> id_used;
 		id_used[masterProcessId]++;
 		id_used[clusterControllerProcessId]++;
@@ -656,6 +688,7 @@ public:
 			throw no_more_servers();
 		} else {
 			RecruitFromConfigurationReply result;
+			result.configuration = req.configuration;
 			result.logRouterCount = 0;
 			std::map< Optional<Standalone<StringRef>>, int> id_used;
 			id_used[masterProcessId]++;
@@ -775,6 +808,18 @@ public:
 	}
 
 	//FIXME: determine when to fail the cluster controller when a primaryDC has not been set
+	// A log on a degraded disk slows every commit, so it fits no better than an excluded one and the log system gets recruited
+	// away from it once somewhere better is available
+	RoleFitness tlogFitness( vector<std::pair<WorkerInterface, ProcessClass>> const& workers ) {
+		RoleFitness fit( workers, ProcessClass::TLog );
+		for( auto& it : workers ) {
+			auto worker = id_worker.find( it.first.locality.processId() );
+			if( worker != id_worker.end() && worker->second.isDegraded() )
+				fit.worstFit = std::max( fit.worstFit, ProcessClass::ExcludeFit );
+		}
+		return fit;
+	}
+
 	bool betterMasterExists() {
 		ServerDBInfo dbi = db.serverInfo->get();
 
@@ -885,18 +930,18 @@ public:
 		}
 
 		// Check tLog fitness
-		RoleFitness oldTLogFit(tlogs, ProcessClass::TLog);
-		RoleFitness newTLogFit(getWorkersForTlogs(db.config, db.config.tLogReplicationFactor, db.config.desiredTLogCount, db.config.tLogPolicy, id_used, true, primaryDC), ProcessClass::TLog);
+		RoleFitness oldTLogFit = tlogFitness(tlogs);
+		RoleFitness newTLogFit = tlogFitness(getWorkersForTlogs(db.config, db.config.tLogReplicationFactor, db.config.desiredTLogCount, db.config.tLogPolicy, id_used, true, primaryDC));
 
 		if(oldTLogFit < newTLogFit) return false;
 
-		RoleFitness oldSatelliteTLogFit(satellite_tlogs, ProcessClass::TLog);
-		RoleFitness newSatelliteTLogFit(region.satelliteTLogReplicationFactor > 0 ? getWorkersForTlogs(db.config, region.satelliteTLogReplicationFactor, db.config.getDesiredSatelliteLogs(clusterControllerDcId), region.satelliteTLogPolicy, id_used, true, satelliteDCs) : satellite_tlogs, ProcessClass::TLog);
+		RoleFitness oldSatelliteTLogFit = tlogFitness(satellite_tlogs);
+		RoleFitness newSatelliteTLogFit = tlogFitness(region.satelliteTLogReplicationFactor > 0 ? getWorkersForTlogs(db.config, region.satelliteTLogReplicationFactor, db.config.getDesiredSatelliteLogs(clusterControllerDcId), region.satelliteTLogPolicy, id_used, true, satelliteDCs) : satellite_tlogs);
 
 		if(oldSatelliteTLogFit < newSatelliteTLogFit) return false;
 
-		RoleFitness oldRemoteTLogFit(remote_tlogs, ProcessClass::TLog);
-		RoleFitness newRemoteTLogFit((db.config.remoteTLogReplicationFactor > 0 && dbi.recoveryState == RecoveryState::REMOTE_RECOVERED) ? getWorkersForTlogs(db.config, db.config.remoteTLogReplicationFactor, db.config.getDesiredRemoteLogs(), db.config.remoteTLogPolicy, id_used, true, remoteDC) : remote_tlogs, ProcessClass::TLog);
+		RoleFitness oldRemoteTLogFit = tlogFitness(remote_tlogs);
+		RoleFitness newRemoteTLogFit = tlogFitness((db.config.remoteTLogReplicationFactor > 0 && dbi.recoveryState == RecoveryState::REMOTE_RECOVERED) ? getWorkersForTlogs(db.config, db.config.remoteTLogReplicationFactor, db.config.getDesiredRemoteLogs(), db.config.remoteTLogPolicy, id_used, true, remoteDC) : remote_tlogs);
 
 		if(oldRemoteTLogFit < newRemoteTLogFit) return false;
 
@@ -935,6 +980,7 @@ public:
 	}
 
 	std::map< Optional<Standalone<StringRef>>, WorkerInfo > id_worker;
+	std::map< Optional<Standalone<StringRef>>, std::set<Optional<Standalone<StringRef>>> > dcId_processIds; // the keys of id_worker by datacenter, so recruiting in one datacenter does not scan every worker
 	std::map<  Optional<Standalone<StringRef>>, ProcessClass > id_class; //contains the mapping from process id to process class from the database
 	Standalone<RangeResultRef> lastProcessClasses;
 	bool gotProcessClasses;
@@ -971,6 +1017,34 @@ public:
 	~ClusterControllerData() {
 		ac.clear(false);
 		id_worker.clear();
+		dcId_processIds.clear();
+	}
+
+	void addWorker( Optional<Standalone<StringRef>> const& processId, WorkerInfo&& worker ) {
+		dcId_processIds[worker.interf.locality.dcId()].insert( processId );
+		id_worker[processId] = std::move(worker);
+	}
+
+	void removeWorker( Optional<Standalone<StringRef>> const& processId ) {
+		auto w = id_worker.find( processId );
+		if( w == id_worker.end() )
+			return;
+		auto dcWorkers = dcId_processIds.find( w->second.interf.locality.dcId() );
+		dcWorkers->second.erase( processId );
+		if( dcWorkers->second.empty() )
+			dcId_processIds.erase( dcWorkers );
+		id_worker.erase( w );
+	}
+
+	void setWorkerInterface( WorkerInfo& worker, Optional<Standalone<StringRef>> const& processId, WorkerInterface const& interf ) {
+		if( worker.interf.locality.dcId() != interf.locality.dcId() ) {
+			auto dcWorkers = dcId_processIds.find( worker.interf.locality.dcId() );
+			dcWorkers->second.erase( processId );
+			if( dcWorkers->second.empty() )
+				dcId_processIds.erase( dcWorkers );
+			dcId_processIds[interf.locality.dcId()].insert( processId );
+		}
+		worker.interf = interf;
 	}
 };
 
@@ -1134,6 +1208,9 @@ ACTOR Future<Void> clusterOpenDatabase(
 		}
 	}
 
+	// All of the waiting clients wake up together on a change; spread the replies so the cluster controller stays responsive
+	Void _ = wait( yield() );
+
 	removeIssue( db->clientsWithIssues, reply.getEndpoint().address, issues, issueID );
 	db->clientVersionMap.erase(reply.getEndpoint().address);
 	db->traceLogGroupMap.erase(reply.getEndpoint().address);
@@ -1263,11 +1340,11 @@ ACTOR Future<Void> workerAvailabilityWatch( WorkerInterface worker, ProcessClass
 				}
 			}
 			when( Void _ = wait( failed ) ) {  // remove workers that have failed
-				WorkerInfo& failedWorkerInfo = cluster->id_worker[ worker.locality.processId() ];
-				if (!failedWorkerInfo.reply.isSet()) {
-					failedWorkerInfo.reply.send( RegisterWorkerReply(failedWorkerInfo.processClass, failedWorkerInfo.priorityInfo) );
+				auto failedWorker = cluster->id_worker.find( worker.locality.processId() );
+				if (failedWorker != cluster->id_worker.end() && !failedWorker->second.reply.isSet()) {
+					failedWorker->second.reply.send( RegisterWorkerReply(failedWorker->second.processClass, failedWorker->second.priorityInfo) );
 				}
-				cluster->id_worker.erase( worker.locality.processId() );
+				cluster->removeWorker( worker.locality.processId() );
 				cluster->updateWorkerList.set( worker.locality.processId(), Optional<ProcessData>() );
 				return Void();
 			}
@@ -1297,6 +1374,9 @@ ACTOR Future<Void> failureDetectionServer( UID uniqueID, FutureStream< FailureMo
 	state Version currentVersion = 0;
 	state std::map<NetworkAddress, FailureStatusInfo> currentStatus;	// The status at currentVersion
 	state std::deque<SystemFailureStatus> statusHistory;	// The last change in statusHistory is from currentVersion-1 to currentVersion
+	state VectorRef<SystemFailureStatus> allStatus;	// currentStatus as of allStatusVersion, shared by every full reply sent at that version
+	state Arena allStatusArena;
+	state Version allStatusVersion = -1;
 	state Future<Void> periodically = Void();
 	state double lastT = 0;
 
@@ -1353,14 +1433,35 @@ ACTOR Future<Void> failureDetectionServer( UID uniqueID, FutureStream< FailureMo
 					// Send everything
 					TEST(true); // failureDetectionServer sending all current data to requester
 					reply.allOthersFailed = true;
-					for(auto it = currentStatus.begin(); it != currentStatus.end(); ++it)
-						reply.changes.push_back( reply.arena, SystemFailureStatus( it->first, it->second.status ) );
+					// Every process that (re)connects needs the whole table, so build it once per version rather than once per requester
+					if( allStatusVersion != currentVersion ) {
+						allStatusArena = Arena();
+						allStatus = VectorRef<SystemFailureStatus>();
+						allStatus.reserve( allStatusArena, currentStatus.size() );
+						for(auto it = currentStatus.begin(); it != currentStatus.end(); ++it)
+							allStatus.push_back( allStatusArena, SystemFailureStatus( it->first, it->second.status ) );
+						allStatusVersion = currentVersion;
+					} else {
+						TEST(true); // failureDetectionServer reusing full status
+					}
+					reply.changes = allStatus;
+					reply.arena.dependsOn( allStatusArena );
 				} else {
 					TEST(true); // failureDetectionServer sending delta-compressed data to requester
-					// SOMEDAY: Send only the last change for a given address?
 					reply.allOthersFailed = false;
-					for(int v = reqVersion - currentVersion + statusHistory.size(); v < statusHistory.size(); v++) {
-						reply.changes.push_back( reply.arena, statusHistory[v] );
+					int firstChange = reqVersion - currentVersion + statusHistory.size();
+					if( statusHistory.size() - firstChange > 1 ) {
+						// Only the last change for a given address matters to the requester
+						std::map<NetworkAddress, FailureStatus> lastChange;
+						for(int v = firstChange; v < statusHistory.size(); v++)
+							lastChange[ statusHistory[v].address ] = statusHistory[v].status;
+						TEST( lastChange.size() < statusHistory.size() - firstChange ); // failureDetectionServer coalesced changes to the same address
+						reply.changes.reserve( reply.arena, lastChange.size() );
+						for(auto& it : lastChange)
+							reply.changes.push_back( reply.arena, SystemFailureStatus( it.first, it.second ) );
+					} else {
+						for(int v = firstChange; v < statusHistory.size(); v++)
+							reply.changes.push_back( reply.arena, statusHistory[v] );
 					}
 				}
 				req.reply.send( reply );
@@ -1445,6 +1546,13 @@ void clusterRecruitStorage( ClusterControllerData* self, RecruitStorageRequest r
 ACTOR Future<Void> clusterRecruitFromConfiguration( ClusterControllerData* self, RecruitFromConfigurationRequest req ) {
 	// At the moment this doesn't really need to be an actor (it always completes immediately)
 	TEST(true); //ClusterController RecruitTLogsRequest
+	if( !req.configuration.isValid() ) {
+		if( !self->db.config.isValid() ) {
+			req.reply.sendError( operation_failed() );
+			return Void();
+		}
+		req.configuration = self->db.config;
+	}
 	loop {
 		try {
 			req.reply.send( self->findWorkersForConfiguration( req ) );
@@ -1570,6 +1678,43 @@ void clusterRegisterMaster( ClusterControllerData* self, RegisterMasterRequest c
 	checkOutstandingMasterRequests(self);
 }
 
+void updateWorkerHealth( ClusterControllerData* self, UpdateWorkerHealthRequest const& req ) {
+	auto info = self->id_worker.find( req.processId );
+	LatencyHistogram latencies;
+	if( info == self->id_worker.end() || !latencies.fromString( req.diskLatencies ) || latencies.count() < SERVER_KNOBS->DEGRADED_DISK_MIN_OPERATIONS )
+		return;
+
+	WorkerInfo& worker = info->second;
+	worker.diskLatency = latencies.percentile( 0.99 );
+	worker.lastHealthReport = now();
+
+	// Disks that serve the same class of process do similar work, so one is judged against the median of the others
+	std::vector<double> peers;
+	for( auto& it : self->id_worker ) {
+		if( &it.second != &worker && it.second.processClass.classType() == worker.processClass.classType() &&
+				now() - it.second.lastHealthReport < SERVER_KNOBS->DEGRADED_DISK_DURATION ) {
+			peers.push_back( it.second.diskLatency );
+		}
+	}
+	double peerMedian = 0;
+	if( peers.size() >= SERVER_KNOBS->DEGRADED_DISK_MIN_PEERS ) {
+		std::nth_element( peers.begin(), peers.begin() + peers.size()/2, peers.end() );
+		peerMedian = peers[peers.size()/2];
+	}
+
+	bool degraded = worker.diskLatency >= SERVER_KNOBS->DEGRADED_DISK_LATENCY ||
+		( peerMedian > 0 && worker.diskLatency >= SERVER_KNOBS->DEGRADED_DISK_PEER_MIN_LATENCY && worker.diskLatency >= SERVER_KNOBS->DEGRADED_DISK_PEER_RATIO * peerMedian );
+	if( !degraded )
+		return;
+
+	if( !worker.isDegraded() ) {
+		TraceEvent(SevWarnAlways, "DegradedDisk", self->id).detail("Address", worker.interf.address()).detail("Latency", worker.diskLatency)
+			.detail("PeerMedian", peerMedian).detail("Peers", peers.size()).detail("Operations", latencies.count());
+	}
+	worker.degradedUntil = now() + SERVER_KNOBS->DEGRADED_DISK_DURATION;
+	checkOutstandingRequests( self );
+}
+
 void registerWorker( RegisterWorkerRequest req, ClusterControllerData *self ) {
 	WorkerInterface w = req.wi;
 	ProcessClass newProcessClass = req.processClass;
@@ -1612,7 +1757,7 @@ void registerWorker( RegisterWorkerRequest req, ClusterControllerData *self ) {
 	}
 
 	if( info == self->id_worker.end() ) {
-		self->id_worker[w.locality.processId()] = WorkerInfo( workerAvailabilityWatch( w, newProcessClass, self ), req.reply, req.generation, w, req.initialClass, newProcessClass, newPriorityInfo );
+		self->addWorker( w.locality.processId(), WorkerInfo( workerAvailabilityWatch( w, newProcessClass, self ), req.reply, req.generation, w, req.initialClass, newProcessClass, newPriorityInfo ) );
 		checkOutstandingRequests( self );
 		return;
 	}
@@ -1628,7 +1773,7 @@ void registerWorker( RegisterWorkerRequest req, ClusterControllerData *self ) {
 		info->second.gen = req.generation;
 
 		if(info->second.interf.id() != w.id()) {
-			info->second.interf = w;
+			self->setWorkerInterface( info->second, w.locality.processId(), w );
 			info->second.watcher = workerAvailabilityWatch( w, newProcessClass, self );
 		}
 		checkOutstandingRequests( self );
@@ -1701,6 +1846,28 @@ ACTOR Future<Void> timeKeeper(ClusterControllerData *self) {
 	}
 }
 
+ACTOR Future<ErrorOr<StatusReply>> getClusterStatus(ClusterControllerData *self, ServerCoordinators coordinators, double delayFor)
+{
+	Void _ = wait(delay(delayFor));
+
+	vector<std::pair<WorkerInterface, ProcessClass>> workers;
+	for(auto& it : self->id_worker)
+		workers.push_back(std::make_pair(it.second.interf, it.second.processClass));
+
+	std::vector<NetworkAddress> incompatibleConnections;
+	for(auto it = self->db.incompatibleConnections.begin(); it != self->db.incompatibleConnections.end();) {
+		if(it->second < now()) {
+			it = self->db.incompatibleConnections.erase(it);
+		} else {
+			incompatibleConnections.push_back(it->first);
+			it++;
+		}
+	}
+
+	ErrorOr<StatusReply> result = wait(errorOr(clusterGetStatus(self->db.serverInfo, self->cx, workers, self->db.workersWithIssues, self->db.clientsWithIssues, self->db.clientVersionMap, self->db.traceLogGroupMap, coordinators, incompatibleConnections)));
+	return result;
+}
+
 ACTOR Future<Void> statusServer(FutureStream< StatusRequest> requests,
 								ClusterControllerData *self,
 								ServerCoordinators coordinators)
@@ -1708,56 +1875,92 @@ ACTOR Future<Void> statusServer(FutureStream< StatusRequest> requests,
 	// Seconds since the END of the last GetStatus executed
 	state double last_request_time = 0.0;
 
-	// Place to accumulate a batch of requests to respond to
+	// Requests that will be answered by the GetStatus in progress, and requests that arrived after it started
 	state std::vector<StatusRequest> requests_batch;
+	state std::vector<StatusRequest> requests_waiting;
+
+	// The last status generated, which is handed out without generating a new one for up to STATUS_CACHE_MAX_AGE
+	// seconds after the GetStatus that produced it began
+	state Optional<StatusReply> cached_status;
+	state double cached_status_time = 0.0;
+
+	state Future<ErrorOr<StatusReply>> refresh = Never();
+	state bool refreshing = false;
+	state double refresh_start_time = 0.0;
 
 	loop {
 		try {
-			// Wait til first request is ready
-			StatusRequest req = waitNext(requests);
-			requests_batch.push_back(req);
+			choose {
+				when( StatusRequest req = waitNext(requests) ) {
+					double age = now() - cached_status_time;
+					bool startRefresh = false;
+					if (cached_status.present() && age <= SERVER_KNOBS->STATUS_CACHE_MAX_AGE) {
+						StatusReply reply = cached_status.get();
+						reply.statusObj["status_age_seconds"] = age;
+						req.reply.send(reply);
+						// Refresh a cache that is halfway to expiring, so that a steady stream of requests never waits
+						startRefresh = !refreshing && age > SERVER_KNOBS->STATUS_CACHE_MAX_AGE / 2;
+					} else if (refreshing) {
+						requests_waiting.push_back(req);
+					} else {
+						requests_batch.push_back(req);
+						startRefresh = true;
+					}
 
-			// Earliest time at which we may begin a new request
-			double next_allowed_request_time = last_request_time + SERVER_KNOBS->STATUS_MIN_TIME_BETWEEN_REQUESTS;
+					if (startRefresh) {
+						// Wait if needed to satisfy min_time knob, also allows more requests to queue up.
+						double minwait = std::max(last_request_time + SERVER_KNOBS->STATUS_MIN_TIME_BETWEEN_REQUESTS - now(), 0.0);
+						refresh_start_time = now() + minwait;
+						refresh = getClusterStatus(self, coordinators, minwait);
+						refreshing = true;
+					}
+				}
+				when( ErrorOr<StatusReply> result = wait(refresh) ) {
+					if (result.isError() && result.getError().code() == error_code_actor_cancelled)
+						throw result.getError();
 
-			// Wait if needed to satisfy min_time knob, also allows more requets to queue up.
-			double minwait = std::max(next_allowed_request_time - now(), 0.0);
-			Void _ = wait(delay(minwait));
+					refresh = Never();
+					refreshing = false;
 
-			// Get all requests that are ready right *now*, before GetStatus() begins.
-			// All of these requests will be responded to with the next GetStatus() result.
-			while (requests.isReady())
-				requests_batch.push_back(requests.pop());
+					// Update last_request_time now because GetStatus is finished and the delay is to be measured between requests
+					last_request_time = now();
 
-			// Get status but trap errors to send back to client.
-			vector<std::pair<WorkerInterface, ProcessClass>> workers;
-			for(auto& it : self->id_worker)
-				workers.push_back(std::make_pair(it.second.interf, it.second.processClass));
-
-			std::vector<NetworkAddress> incompatibleConnections;
-			for(auto it = self->db.incompatibleConnections.begin(); it != self->db.incompatibleConnections.end();) {
-				if(it->second < now()) {
-					it = self->db.incompatibleConnections.erase(it);
-				} else {
-					incompatibleConnections.push_back(it->first);
-					it++;
-				}
-			}
+					if (!result.isError()) {
+						cached_status = result.get();
+						cached_status.get().statusObj["status_age_seconds"] = 0.0;
+						cached_status_time = refresh_start_time;
+					}
 
-			ErrorOr<StatusReply> result = wait(errorOr(clusterGetStatus(self->db.serverInfo, self->cx, workers, self->db.workersWithIssues, self->db.clientsWithIssues, self->db.clientVersionMap, self->db.traceLogGroupMap, coordinators, incompatibleConnections)));
-			if (result.isError() && result.getError().code() == error_code_actor_cancelled)
-				throw result.getError();
+					while (!requests_batch.empty())
+					{
+						if (result.isError())
+							requests_batch.back().reply.sendError(result.getError());
+						else
+							requests_batch.back().reply.send(result.get());
+						requests_batch.pop_back();
+					}
 
-			// Update last_request_time now because GetStatus is finished and the delay is to be measured between requests
-			last_request_time = now();
+					// Requests that arrived while GetStatus ran can use its result if it is recent enough for them;
+					// the rest need another one.
+					for (auto& req : requests_waiting) {
+						double age = now() - cached_status_time;
+						if (!result.isError() && age <= SERVER_KNOBS->STATUS_CACHE_MAX_AGE) {
+							StatusReply reply = cached_status.get();
+							reply.statusObj["status_age_seconds"] = age;
+							req.reply.send(reply);
+						} else {
+							requests_batch.push_back(req);
+						}
+					}
+					requests_waiting.clear();
 
-			while (!requests_batch.empty())
-			{
-				if (result.isError())
-					requests_batch.back().reply.sendError(result.getError());
-				else
-					requests_batch.back().reply.send(result.get());
-				requests_batch.pop_back();
+					if (!requests_batch.empty()) {
+						double minwait = std::max(last_request_time + SERVER_KNOBS->STATUS_MIN_TIME_BETWEEN_REQUESTS - now(), 0.0);
+						refresh_start_time = now() + minwait;
+						refresh = getClusterStatus(self, coordinators, minwait);
+						refreshing = true;
+					}
+				}
 			}
 		}
 		catch (Error &e) {
@@ -1978,6 +2181,10 @@ ACTOR Future<Void> clusterControllerCore( ClusterControllerFullInterface interf,
 		when( RegisterWorkerRequest req = waitNext( interf.registerWorker.getFuture() ) ) {
 			registerWorker( req, &self );
 		}
+		when( UpdateWorkerHealthRequest req = waitNext( interf.updateWorkerHealth.getFuture() ) ) {
+			updateWorkerHealth( &self, req );
+			req.reply.send( Void() );
+		}
 		when( GetWorkersRequest req = waitNext( interf.getWorkers.getFuture() ) ) {
 			vector<std::pair<WorkerInterface, ProcessClass>> workers;
 
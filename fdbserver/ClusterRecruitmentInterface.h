@@ -41,6 +41,7 @@ struct ClusterControllerFullInterface {
 	RequestStream< struct GetWorkersRequest > getWorkers;
 	RequestStream< struct RegisterMasterRequest > registerMaster;
 	RequestStream< struct GetServerDBInfoRequest > getServerDBInfo;
+	RequestStream< struct UpdateWorkerHealthRequest > updateWorkerHealth;
 
 	UID id() const { return clientInterface.id(); }
 	bool operator == (ClusterControllerFullInterface const& r) const { return id() == r.id(); }
@@ -55,17 +56,18 @@ struct ClusterControllerFullInterface {
 		getWorkers.getEndpoint( TaskClusterController );
 		registerMaster.getEndpoint( TaskClusterController );
 		getServerDBInfo.getEndpoint( TaskClusterController );
+		updateWorkerHealth.getEndpoint( TaskClusterController );
 	}
 
 	template <class Ar>
 	void serialize( Ar& ar ) {
 		ASSERT( ar.protocolVersion() >= 0x0FDB00A200040001LL );
-		ar & clientInterface & recruitFromConfiguration & recruitRemoteFromConfiguration & recruitStorage & registerWorker & getWorkers & registerMaster & getServerDBInfo;
+		ar & clientInterface & recruitFromConfiguration & recruitRemoteFromConfiguration & recruitStorage & registerWorker & getWorkers & registerMaster & getServerDBInfo & updateWorkerHealth;
 	}
 };
 
 struct RecruitFromConfigurationRequest {
-	DatabaseConfiguration configuration;
+	DatabaseConfiguration configuration;  // If not valid, the configuration last registered by a master is used
 	bool recruitSeedServers;
 	ReplyPromise< struct RecruitFromConfigurationReply > reply;
 
@@ -87,10 +89,11 @@ struct RecruitFromConfigurationReply {
 	vector<WorkerInterface> storageServers;
 	int logRouterCount;
 	Optional<Key> dcId;
+	DatabaseConfiguration configuration;  // The configuration the workers were chosen for
 
 	template <class Ar>
 	void serialize( Ar& ar ) {
-		ar & tLogs & satelliteTLogs & proxies & resolvers & storageServers & dcId & logRouterCount;
+		ar & tLogs & satelliteTLogs & proxies & resolvers & storageServers & dcId & logRouterCount & configuration;
 	}
 };
 
@@ -173,6 +176,20 @@ struct RegisterWorkerRequest {
 	}
 };
 
+struct UpdateWorkerHealthRequest {
+	Optional<Standalone<StringRef>> processId;
+	std::string diskLatencies;  // A LatencyHistogram, as toString(), of every read and write since the last report
+	ReplyPromise<Void> reply;
+
+	UpdateWorkerHealthRequest() {}
+	UpdateWorkerHealthRequest( Optional<Standalone<StringRef>> processId, std::string const& diskLatencies ) : processId(processId), diskLatencies(diskLatencies) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & processId & diskLatencies & reply;
+	}
+};
+
 struct GetWorkersRequest {
 	enum { TESTER_CLASS_ONLY = 0x1, NON_EXCLUDED_PROCESSES_ONLY = 0x2 };
 
@@ -29,6 +29,15 @@ ConflictSet* newConflictSet();
 void clearConflictSet( ConflictSet*, Version );
 void destroyConflictSet(ConflictSet*);
 
+// Removes up to nodeBudget version history entries that are older than the oldest version the conflict set
+//   still has to answer for, resuming where the previous call stopped.  Returns the number of entries removed,
+//   and sets *passFinished if the call reached the end of a full pass over the key space.
+int compactConflictSet( ConflictSet*, int nodeBudget, bool* passFinished = NULL );
+
+// How far (in versions) the oldest relevant version has moved past the one the last completed compaction pass
+//   was started at; entries that expired within this window may still be in the version history.
+Version getConflictSetCompactionBacklog( ConflictSet* );
+
 struct ConflictBatch {
 	explicit ConflictBatch( ConflictSet* );
 	~ConflictBatch();
@@ -40,7 +49,9 @@ struct ConflictBatch {
 	};
 
 	void addTransaction( const CommitTransactionRef& transaction );
-	void detectConflicts(Version now, Version newOldestVersion, vector<int>& nonConflicting, vector<int>* tooOldTransactions = NULL);
+	// If conflictingRanges is given, it is set to the index in each transaction's read_conflict_ranges of a range found to
+	//   conflict, or -1 for transactions that did not conflict (or were too old)
+	void detectConflicts(Version now, Version newOldestVersion, vector<int>& nonConflicting, vector<int>* tooOldTransactions = NULL, vector<int>* conflictingRanges = NULL);
 	void GetTooOldTransactions(vector<int>& tooOldTransactions);
 
 private:
@@ -51,6 +62,7 @@ private:
 	vector< pair<StringRef,StringRef> > combinedWriteConflictRanges;
 	vector< struct ReadConflictRange > combinedReadConflictRanges;
 	bool* transactionConflictStatus;
+	vector<int> transactionConflictingRange;
 
 	void checkIntraBatchConflicts();
 	void combineWriteConflictRanges();
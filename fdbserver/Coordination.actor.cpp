@@ -197,6 +197,19 @@ TEST_CASE("fdbserver/Coordination/localGenerationReg/simple") {
 	return Void();
 }
 
+// Answers the outstanding leader polls of a register in batches, so a large fleet of clients does not stall the coordinator (and the
+// generation registers it serves to a recovering master) right when the leader changes.
+ACTOR Future<Void> notifyLeaderChange( vector<ReplyPromise<Optional<LeaderInfo>>> notify, Optional<LeaderInfo> nominee ) {
+	state int i = 0;
+	for(; i < notify.size(); i++) {
+		if( i && i % SERVER_KNOBS->LEADER_NOTIFY_BATCH_SIZE == 0 ) {
+			Void _ = wait( yield() );
+		}
+		notify[i].send( nominee );
+	}
+	return Void();
+}
+
 // This actor implements a *single* leader-election register (essentially, it ignores
 // the .key member of each request).  It returns any time the leader election is in the
 // default state, so that only active registers consume memory.
@@ -205,6 +218,7 @@ ACTOR Future<Void> leaderRegister(LeaderElectionRegInterface interf, Key key) {
 	state std::set<LeaderInfo> availableLeaders;
 	state Optional<LeaderInfo> currentNominee;
 	state vector<ReplyPromise<Optional<LeaderInfo>>> notify;
+	state ActorCollection notifiers(false);
 	state Future<Void> nextInterval = delay( 0 );
 	state double candidateDelay = SERVER_KNOBS->CANDIDATE_MIN_DELAY;
 	state int leaderIntervalCount = 0;
@@ -240,6 +254,7 @@ ACTOR Future<Void> leaderRegister(LeaderElectionRegInterface interf, Key key) {
 			req.reply.send( Void() );
 			return Void();
 		}
+		when ( Void _ = wait( notifiers.getResult() ) ) { ASSERT(false); throw internal_error(); }
 		when ( Void _ = wait(nextInterval) ) {
 			if (!availableLeaders.size() && !availableCandidates.size() && !notify.size() &&
 				!currentNominee.present())
@@ -262,8 +277,13 @@ ACTOR Future<Void> leaderRegister(LeaderElectionRegInterface interf, Key key) {
 				if ( currentNominee.present() != nextNominee.present() || (currentNominee.present() && currentNominee.get().leaderChangeRequired(nextNominee.get())) || !availableLeaders.size() ) {
 					TraceEvent("NominatingLeader").detail("Nominee", nextNominee.present() ? nextNominee.get().changeID : UID())
 						.detail("Changed", nextNominee != currentNominee).detail("Key", printable(key));
-					for(int i=0; i<notify.size(); i++)
-						notify[i].send( nextNominee );
+					if( notify.size() > SERVER_KNOBS->LEADER_NOTIFY_BATCH_SIZE ) {
+						TEST(true); // Leader change notifications sent in batches
+						notifiers.add( notifyLeaderChange( notify, nextNominee ) );
+					} else {
+						for(int i=0; i<notify.size(); i++)
+							notify[i].send( nextNominee );
+					}
 					notify.clear();
 					currentNominee = nextNominee;
 				} else if (currentNominee.present() && nextNominee.present() && currentNominee.get().equalInternalId(nextNominee.get())) {
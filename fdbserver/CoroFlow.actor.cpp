@@ -23,6 +23,11 @@
 #include "fdbrpc/libcoroutine/Coro.h"
 #include "flow/TDMetric.actor.h"
 #include "fdbrpc/simulator.h"
+#include "Knobs.h"
+#ifndef USE_FIBERS
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 
 Coro *current_coro = 0, *main_coro = 0;
@@ -44,14 +49,86 @@ protected:
 };*/
 
 
+// Coroutine stacks are big enough that malloc would get each one straight from mmap and give it back with munmap, so instead
+// they are kept for reuse, by size.  Each has an inaccessible guard page below it, so that overflowing it faults rather than
+// corrupting whatever is next to it, and is faulted in when it is first allocated rather than a page at a time under SQLite.
+// Only the network thread creates and destroys coroutines.
+struct CoroStackPool {
+	std::map<size_t, std::vector<void*>> freeStacks;
+	int64_t created, allocated, reused, freed;  // Since the metrics were last logged
+	int64_t inUse, pooled;
+
+	CoroStackPool() : created(0), allocated(0), reused(0), freed(0), inUse(0), pooled(0) {}
+
+#ifndef USE_FIBERS
+	static size_t guardSize() {
+		static size_t pageSize = sysconf(_SC_PAGESIZE);
+		return pageSize;
+	}
+
+	void* get( size_t size ) {
+		++created;
+		++inUse;
+		auto& f = freeStacks[size];
+		if( f.size() ) {
+			void* stack = f.back();
+			f.pop_back();
+			--pooled;
+			++reused;
+			return stack;
+		}
+
+		++allocated;
+		int flags = MAP_PRIVATE | MAP_ANON;
+#ifdef MAP_POPULATE
+		flags |= MAP_POPULATE;
+#endif
+		char* base = (char*)mmap( NULL, size + guardSize(), PROT_READ | PROT_WRITE, flags, -1, 0 );
+		if( base == MAP_FAILED )
+			platform::outOfMemory();
+		if( mprotect( base, guardSize(), PROT_NONE ) )
+			TraceEvent(SevWarnAlways, "CoroStackGuardFailed").GetLastError();
+#ifndef MAP_POPULATE
+		memset( base + guardSize(), 0, size );
+#endif
+		return base + guardSize();
+	}
+
+	void put( void* stack, size_t size ) {
+		--inUse;
+		auto& f = freeStacks[size];
+		if( f.size() < SERVER_KNOBS->CORO_STACK_POOL_SIZE ) {
+			f.push_back( stack );
+			++pooled;
+		} else {
+			++freed;
+			munmap( (char*)stack - guardSize(), size + guardSize() );
+		}
+	}
+#endif
+};
+
+static CoroStackPool coroStacks;
+
 struct Coroutine /*: IThreadlike*/ {
-	Coroutine() {
+	explicit Coroutine( size_t stackSize ) : stackSize(stackSize) {
 		coro = Coro_new();
 		if (coro == NULL)
 			platform::outOfMemory();
+#ifndef USE_FIBERS
+		// Coro_allocStackIfNeeded() leaves a stack of the requested size alone
+		coro->stack = coroStacks.get( stackSize );
+		coro->requestedStackSize = coro->allocatedStackSize = stackSize;
+#else
+		++coroStacks.created;
+#endif
 	}
 
 	~Coroutine() {
+#ifndef USE_FIBERS
+		coroStacks.put( coro->stack, stackSize );
+		coro->stack = NULL;
+#endif
 		Coro_free(coro);
 	}
 
@@ -89,6 +166,7 @@ private:
 	}
 
 	Coro* coro;
+	size_t stackSize;
 	Promise<Void> blocked;
 };
 
@@ -99,12 +177,13 @@ class WorkPool : public IThreadPool, public ReferenceCounted<WorkPool<Threadlike
 	// Pool can survive the destruction of WorkPool while it waits for workers to terminate
 	struct Pool : ReferenceCounted<Pool> {
 		Mutex queueLock;
-		Deque<PThreadAction> work;
+		ThreadPoolQueue work;
 		std::vector<Worker*> idle, workers;
 		ActorCollection anyError, allStopped;
 		Future<Void> m_holdRefUntilStopped;
+		size_t stackSize;
 
-		Pool() : anyError(false), allStopped(true) {
+		explicit Pool( size_t stackSize ) : anyError(false), allStopped(true), stackSize(stackSize) {
 			m_holdRefUntilStopped = holdRefUntilStopped(this);
 		}
 
@@ -128,7 +207,7 @@ class WorkPool : public IThreadPool, public ReferenceCounted<WorkPool<Threadlike
 		ThreadReturnPromise<Void> stopped;
 		ThreadReturnPromise<Void> error;
 
-		Worker( Pool* pool,  IThreadPoolReceiver* userData ) : pool(pool), userData(userData), stop(false) {
+		Worker( Pool* pool,  IThreadPoolReceiver* userData ) : Threadlike(pool->stackSize), pool(pool), userData(userData), stop(false) {
 		}
 
 		virtual void run() {
@@ -143,8 +222,7 @@ class WorkPool : public IThreadPool, public ReferenceCounted<WorkPool<Threadlike
 						pool->queueLock.leave();
 						Threadlike::block();
 					} else {
-						PThreadAction a = pool->work.front();
-						pool->work.pop_front();
+						PThreadAction a = pool->work.pop( now() );
 						pool->queueLock.leave();
 						(*a)(userData);
 						if(IS_CORO) CoroThreadPool::waitFor(yield());
@@ -194,7 +272,7 @@ class WorkPool : public IThreadPool, public ReferenceCounted<WorkPool<Threadlike
 	}
 
 public:
-	WorkPool() : pool( new Pool ) {
+	explicit WorkPool( size_t stackSize ) : pool( new Pool(stackSize) ) {
 		m_stopOnError = stopOnError( this );
 	}
 
@@ -217,10 +295,13 @@ public:
 		w->start();
 	}
 	virtual void post( PThreadAction action ) {
+		post( action, THREAD_POOL_NORMAL );
+	}
+	virtual void post( PThreadAction action, ThreadPoolLane lane ) {
 		checkError();
 
 		pool->queueLock.enter();
-		pool->work.push_back(action);
+		pool->work.push( action, lane, now() );
 		if (!pool->idle.empty()) {
 			Worker* c = pool->idle.back();
 			pool->idle.pop_back();
@@ -236,9 +317,7 @@ public:
 		TraceEvent("WorkPool_Stop").detail("Workers", pool->workers.size()).detail("Idle", pool->idle.size())
 			.detail("Work", pool->work.size());
 
-		for(int i=0; i<pool->work.size(); i++)
-			pool->work[i]->cancel();   // What if cancel() does something to this?
-		pool->work.clear();
+		pool->work.cancelAll();   // What if cancel() does something to this?
 		for(int i=0; i<pool->workers.size(); i++)
 			pool->workers[i]->stop = true;
 
@@ -253,6 +332,12 @@ public:
 
 		return pool->allStopped.getResult();
 	}
+	virtual ThreadPoolQueueMetrics getQueueMetrics() {
+		pool->queueLock.enter();
+		ThreadPoolQueueMetrics m = pool->work.takeMetrics();
+		pool->queueLock.leave();
+		return m;
+	}
 	virtual bool isCoro() const { return IS_CORO; }
 	virtual void addref() { ReferenceCounted<WorkPool>::addref(); }
 	virtual void delref() { ReferenceCounted<WorkPool>::delref(); }
@@ -301,6 +386,17 @@ void CoroThreadPool::init()
 }
 
 
-Reference<IThreadPool> CoroThreadPool::createThreadPool() {
-	return Reference<IThreadPool>( new CoroPool );
+Reference<IThreadPool> CoroThreadPool::createThreadPool( int stackSize ) {
+	return Reference<IThreadPool>( new CoroPool( stackSize ? stackSize : CORO_DEFAULT_STACK_SIZE ) );
+}
+
+void CoroThreadPool::logMetrics() {
+	TraceEvent("CoroutineMetrics")
+		.detail("Created", coroStacks.created)
+		.detail("StacksAllocated", coroStacks.allocated)
+		.detail("StacksReused", coroStacks.reused)
+		.detail("StacksFreed", coroStacks.freed)
+		.detail("Live", coroStacks.inUse)
+		.detail("StacksPooled", coroStacks.pooled);
+	coroStacks.created = coroStacks.allocated = coroStacks.reused = coroStacks.freed = 0;
 }
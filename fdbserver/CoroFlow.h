@@ -33,7 +33,11 @@ public:
 	static void init();
 	static void waitFor( Future<Void> what );
 
-	static Reference<IThreadPool> createThreadPool();
+	// Each coroutine of the pool gets a stack of stackSize bytes, or the libcoroutine default if it is 0
+	static Reference<IThreadPool> createThreadPool( int stackSize = 0 );
+
+	// Logs how many coroutines were created, and how many of their stacks had to be allocated, since the last call
+	static void logMetrics();
 
 protected:
 	CoroThreadPool() {}
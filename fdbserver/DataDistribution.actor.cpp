@@ -31,6 +31,7 @@
 #include "IKeyValueStore.h"
 #include "fdbclient/ManagementAPI.h"
 #include "fdbrpc/Replication.h"
+#include "fdbrpc/Smoother.h"
 #include "flow/UnitTest.h"
 
 class TCTeamInfo;
@@ -254,13 +255,14 @@ struct ServerStatus {
 	bool isFailed;
 	bool isUndesired;
 	bool isWrongConfiguration;
+	bool isDraining;  // Excluded with a request to move its data off quickly
 	LocalityData locality;
-	ServerStatus() : isFailed(true), isUndesired(false), isWrongConfiguration(false) {}
-	ServerStatus( bool isFailed, bool isUndesired, LocalityData const& locality ) : isFailed(isFailed), isUndesired(isUndesired), locality(locality), isWrongConfiguration(false) {}
+	ServerStatus() : isFailed(true), isUndesired(false), isWrongConfiguration(false), isDraining(false) {}
+	ServerStatus( bool isFailed, bool isUndesired, LocalityData const& locality ) : isFailed(isFailed), isUndesired(isUndesired), locality(locality), isWrongConfiguration(false), isDraining(false) {}
 	bool isUnhealthy() const { return isFailed || isUndesired; }
-	const char* toString() const { return isFailed ? "Failed" : isUndesired ? "Undesired" : "Healthy"; }
+	const char* toString() const { return isFailed ? "Failed" : isDraining ? "Draining" : isUndesired ? "Undesired" : "Healthy"; }
 
-	bool operator == (ServerStatus const& r) const { return isFailed == r.isFailed && isUndesired == r.isUndesired && isWrongConfiguration == r.isWrongConfiguration && locality.zoneId() == r.locality.zoneId(); }
+	bool operator == (ServerStatus const& r) const { return isFailed == r.isFailed && isUndesired == r.isUndesired && isWrongConfiguration == r.isWrongConfiguration && isDraining == r.isDraining && locality.zoneId() == r.locality.zoneId(); }
 
 	//If a process has reappeared without the storage server that was on it (isFailed == true), we don't need to exclude it
 	//We also don't need to exclude processes who are in the wrong configuration (since those servers will be removed)
@@ -502,6 +504,7 @@ struct DDTeamCollection {
 	int64_t unhealthyServers;
 	std::map<UID, Reference<TCServerInfo>> server_info;
 	vector<Reference<TCTeamInfo>> teams;
+	std::multiset<vector<UID>> teamServerIDs; // The server IDs of each of teams, so that teamExists() doesn't have to scan them
 	Reference<ShardsAffectedByTeamFailure> shardsAffectedByTeamFailure;
 	PromiseStream<UID> removedServers;
 	std::set<UID> recruitingIds; // The IDs of the SS which are being recruited
@@ -521,6 +524,7 @@ struct DDTeamCollection {
 	AsyncVar<bool> zeroOptimalTeams;
 
 	AsyncMap< AddressExclusion, bool > excludedServers;  // true if an address is in the excluded list in the database.  Updated asynchronously (eventually)
+	AsyncMap< AddressExclusion, bool > drainingServers;  // true if an address is excluded with excludedServersDrainValue
 
 	std::vector<Optional<Key>> includedDCs;
 	Optional<std::vector<Optional<Key>>> otherTrackedDCs;
@@ -857,14 +861,7 @@ struct DDTeamCollection {
 	}
 
 	bool teamExists( vector<UID> &team ) {
-		bool exists = false;
-		for (int i=0;i<teams.size();i++){
-			if (teams[i]->getServerIDs() == team) {
-				exists = true;
-				break;
-			}
-		}
-		return exists;
+		return teamServerIDs.count( team ) > 0;
 	}
 
 	void addTeam( std::set<UID> const& team ) {
@@ -884,6 +881,7 @@ struct DDTeamCollection {
 		TraceEvent("TeamCreation", masterId).detail("Team", teamInfo->getDesc());
 		teamInfo->tracker = teamTracker( this, teamInfo );
 		teams.push_back( teamInfo );
+		teamServerIDs.insert( teamInfo->getServerIDs() );
 		for (int i=0;i<newTeamServers.size();i++) {
 			server_info[ newTeamServers[i]->id ]->teams.push_back( teamInfo );
 		}
@@ -1089,7 +1087,13 @@ struct DDTeamCollection {
 
 				state vector<std::vector<UID>> builtTeams;
 
-				if( self->configuration.storageTeamSize > 3) {
+				// addAllTeams() only helps when there are too few possible new teams for addTeamsBestOf() to find them randomly, and
+				// enumerating every combination of hundreds of servers would stall data distribution, so large clusters skip it
+				double possibleTeams = 1;
+				for( int i = 0; i < self->configuration.storageTeamSize; i++ )
+					possibleTeams = possibleTeams * (serverCount - i) / (i + 1);
+
+				if( self->configuration.storageTeamSize > 3 || possibleTeams > SERVER_KNOBS->DD_MAX_ENUMERATED_TEAMS ) {
 					int addedTeams = self->addTeamsBestOf( teamsToBuild );
 					TraceEvent("AddTeamsBestOf", self->masterId).detail("CurrentTeams", self->teams.size()).detail("AddedTeams", addedTeams);
 				} else {
@@ -1203,6 +1207,7 @@ struct DDTeamCollection {
 		// SOMEDAY: can we avoid walking through all teams, since we have an index of teams in which removedServer participated
 		for(int t=0; t<teams.size(); t++) {
 			if ( std::count( teams[t]->getServerIDs().begin(), teams[t]->getServerIDs().end(), removedServer ) ) {
+				teamServerIDs.erase( teamServerIDs.find( teams[t]->getServerIDs() ) );
 				teams[t]->tracker.cancel();
 				teams[t--] = teams.back();
 				teams.pop_back();
@@ -1221,6 +1226,7 @@ struct DDTeamCollection {
 ACTOR Future<Void> teamTracker( DDTeamCollection *self, Reference<IDataDistributionTeam> team) {
 	state int lastServersLeft = team->getServerIDs().size();
 	state bool lastAnyUndesired = false;
+	state bool lastAnyDraining = false;
 	state bool wrongSize = team->getServerIDs().size() != self->configuration.storageTeamSize;
 	state bool lastReady = self->initialFailureReactionDelay.isReady();
 	state bool lastHealthy = team->isHealthy();
@@ -1248,6 +1254,7 @@ ACTOR Future<Void> teamTracker( DDTeamCollection *self, Reference<IDataDistribut
 			state vector<Future<Void>> change;
 			auto servers = team->getServerIDs();
 			bool anyUndesired = false;
+			bool anyDraining = false;
 			bool anyWrongConfiguration = false;
 			Reference<LocalityGroup> teamLocality(new LocalityGroup());
 
@@ -1258,6 +1265,8 @@ ACTOR Future<Void> teamTracker( DDTeamCollection *self, Reference<IDataDistribut
 					teamLocality->add( status.locality );
 				if (status.isUndesired)
 					anyUndesired = true;
+				if (status.isDraining)
+					anyDraining = true;
 				if (status.isWrongConfiguration)
 					anyWrongConfiguration = true;
 			}
@@ -1273,7 +1282,7 @@ ACTOR Future<Void> teamTracker( DDTeamCollection *self, Reference<IDataDistribut
 			lastReady = self->initialFailureReactionDelay.isReady();
 			lastZeroHealthy = self->zeroHealthyTeams->get();
 
-			if( serversLeft != lastServersLeft || anyUndesired != lastAnyUndesired || anyWrongConfiguration != lastWrongConfiguration || wrongSize || recheck ) {
+			if( serversLeft != lastServersLeft || anyUndesired != lastAnyUndesired || anyDraining != lastAnyDraining || anyWrongConfiguration != lastWrongConfiguration || wrongSize || recheck ) {
 				TraceEvent("TeamHealthChanged", self->masterId)
 					.detail("Team", team->getDesc()).detail("serversLeft", serversLeft)
 					.detail("lastServersLeft", lastServersLeft).detail("ContainsUndesiredServer", anyUndesired)
@@ -1313,6 +1322,7 @@ ACTOR Future<Void> teamTracker( DDTeamCollection *self, Reference<IDataDistribut
 
 				lastServersLeft = serversLeft;
 				lastAnyUndesired = anyUndesired;
+				lastAnyDraining = anyDraining;
 				lastWrongConfiguration = anyWrongConfiguration;
 				wrongSize = false;
 
@@ -1329,6 +1339,8 @@ ACTOR Future<Void> teamTracker( DDTeamCollection *self, Reference<IDataDistribut
 				}
 				else if ( team->getServerIDs().size() != self->configuration.storageTeamSize )
 					team->setPriority( PRIORITY_TEAM_UNHEALTHY );
+				else if( anyDraining )
+					team->setPriority( PRIORITY_TEAM_CONTAINS_DRAINING_SERVER );
 				else if( anyUndesired )
 					team->setPriority( PRIORITY_TEAM_CONTAINS_UNDESIRED_SERVER );
 				else
@@ -1406,6 +1418,45 @@ ACTOR Future<Void> teamTracker( DDTeamCollection *self, Reference<IDataDistribut
 	}
 }
 
+// Reports how much data is left on draining servers, how fast it has been moving off of them, and so when they should be empty
+ACTOR Future<Void> trackExclusionDrain( DDTeamCollection *self ) {
+	state Smoother drainedBytes( SERVER_KNOBS->DD_EXCLUSION_DRAIN_RATE_FOLDING_TIME );
+	state int64_t lastRemainingBytes = -1;
+	state int lastServers = 0;
+	loop {
+		Void _ = wait( delay( SERVER_KNOBS->DATA_DISTRIBUTION_LOGGING_INTERVAL, TaskDataDistribution ) );
+
+		int servers = 0;
+		int64_t remainingBytes = 0;
+		for(auto& s : self->server_info) {
+			if( self->server_status.get( s.first ).isDraining ) {
+				servers++;
+				if( s.second->serverMetrics.present() )
+					remainingBytes += s.second->serverMetrics.get().load.bytes;
+			}
+		}
+
+		if( !servers ) {
+			drainedBytes.reset(0);
+			lastRemainingBytes = -1;
+		} else {
+			// Only data leaving the same set of servers counts toward the rate
+			if( lastRemainingBytes >= 0 && servers == lastServers )
+				drainedBytes.addDelta( std::max<int64_t>( 0, lastRemainingBytes - remainingBytes ) );
+			lastRemainingBytes = remainingBytes;
+		}
+		lastServers = servers;
+
+		double rate = drainedBytes.smoothRate();
+		TraceEvent("ExclusionDrain", self->masterId)
+			.detail("Servers", servers)
+			.detail("RemainingBytes", remainingBytes)
+			.detail("BytesPerSecond", rate)
+			.detail("EstimatedSecondsRemaining", servers && rate > 0 ? remainingBytes / rate : -1)
+			.trackLatest( format("%s/%sExclusionDrain", printable(self->cx->dbName).c_str(), self->primary ? "" : "Remote").c_str() );
+	}
+}
+
 ACTOR Future<Void> trackExcludedServers( DDTeamCollection *self, Database cx ) {
 	loop {
 		// Fetch the list of excluded servers
@@ -1422,16 +1473,27 @@ ACTOR Future<Void> trackExcludedServers( DDTeamCollection *self, Database cx ) {
 				ASSERT( !results.more && results.size() < CLIENT_KNOBS->TOO_MANY );
 
 				std::set<AddressExclusion> excluded;
+				std::set<AddressExclusion> draining;
 				for(auto r = results.begin(); r != results.end(); ++r) {
 					AddressExclusion addr = decodeExcludedServersKey(r->key);
-					if (addr.isValid())
+					if (addr.isValid()) {
 						excluded.insert( addr );
+						if (r->value == excludedServersDrainValue)
+							draining.insert( addr );
+					}
 				}
 
-				TraceEvent("DDExcludedServersChanged", self->masterId).detail("Rows", results.size()).detail("Exclusions", excluded.size());
+				TraceEvent("DDExcludedServersChanged", self->masterId).detail("Rows", results.size()).detail("Exclusions", excluded.size()).detail("Draining", draining.size());
 
 				// Reset and reassign self->excludedServers based on excluded, but weonly
-				// want to trigger entries that are different
+				// want to trigger entries that are different.  drainingServers goes first, so that a server newly
+				// excluded with drain is seen as draining as soon as it is seen as excluded.
+				auto oldDraining = self->drainingServers.getKeys();
+				for(auto& o : oldDraining)
+					if (!draining.count(o))
+						self->drainingServers.set(o, false);
+				for(auto& n : draining)
+					self->drainingServers.set(n, true);
 				auto old = self->excludedServers.getKeys();
 				for(auto& o : old)
 					if (!excluded.count(o))
@@ -1582,6 +1644,7 @@ ACTOR Future<Void> storageServerTracker(
 		loop {
 			status.isUndesired = false;
 			status.isWrongConfiguration = false;
+			status.isDraining = false;
 
 			// If there is any other server on this exact NetworkAddress, this server is undesired and will eventually be eliminated
 			state std::vector<Future<Void>> otherChanges;
@@ -1645,9 +1708,12 @@ ACTOR Future<Void> storageServerTracker(
 					.detail("Excluded", self->excludedServers.get( addr ) ? addr.toString() : ipaddr.toString());
 				status.isUndesired = true;
 				status.isWrongConfiguration = true;
+				status.isDraining = self->drainingServers.get( addr ) || self->drainingServers.get( ipaddr );
 			}
 			otherChanges.push_back( self->excludedServers.onChange( addr ) );
 			otherChanges.push_back( self->excludedServers.onChange( ipaddr ) );
+			otherChanges.push_back( self->drainingServers.onChange( addr ) );
+			otherChanges.push_back( self->drainingServers.onChange( ipaddr ) );
 
 			failureTracker = storageServerFailureTracker( cx, server->lastKnownInterface, statusMap, &status, serverFailures, &self->unhealthyServers, masterId );
 
@@ -1895,6 +1961,7 @@ ACTOR Future<Void> dataDistributionTeamCollection(
 		storageServerRecruitmentMonitor = monitorStorageServerRecruitment( &self );
 		interfaceChanges = waitServerListChange( &self, cx, serverRemoved.getFuture() );
 		trackExcluded = trackExcludedServers( &self, cx );
+		self.addActor.send( trackExclusionDrain( &self ) );
 
 		// SOMEDAY: Monitor FF/serverList for (new) servers that aren't in allServers and add or remove them
 
@@ -2403,3 +2470,20 @@ TEST_CASE("DataDistribution/AddTeamsBestOf/NotEnoughServers") {
 
 	return Void();
 }
+
+TEST_CASE("DataDistribution/AddTeamsBestOf/LargeCluster") {
+	Void _ = wait(Future<Void>(Void()));
+
+	IRepPolicyRef policy = IRepPolicyRef(new PolicyAcross(3, "zoneid", IRepPolicyRef(new PolicyOne())));
+	state DDTeamCollection* collection = testTeamCollection(3, policy, 1000);
+
+	double start = timer();
+	int result = collection->addTeamsBestOf(5000);
+	TraceEvent("AddTeamsBestOfLargeCluster").detail("Teams", result).detail("Elapsed", timer() - start);
+
+	ASSERT(result == 5000);
+	ASSERT(collection->teamServerIDs.size() == collection->teams.size());
+	delete(collection);
+
+	return Void();
+}
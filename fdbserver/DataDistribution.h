@@ -42,6 +42,7 @@ enum {
 	PRIORITY_REBALANCE_OVERUTILIZED_TEAM  = 121,
 	PRIORITY_TEAM_HEALTHY    = 140,
 	PRIORITY_TEAM_CONTAINS_UNDESIRED_SERVER = 150,
+	PRIORITY_TEAM_CONTAINS_DRAINING_SERVER = 200,
 
 	PRIORITY_MERGE_SHARD     = 240,
 	PRIORITY_SPLIT_SHARD     = 250,
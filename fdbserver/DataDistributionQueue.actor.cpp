@@ -38,13 +38,14 @@ struct RelocateData {
 	double startTime;
 	UID randomId;
 	int workFactor;
+	int64_t bytes;  // Estimated once the source servers are known, or -1
 	std::vector<UID> src;
 	std::vector<UID> completeSources;
 	bool wantsNewServers;
 	TraceInterval interval;
 
-	RelocateData() : startTime(-1), priority(-1), workFactor(0), wantsNewServers(false), interval("QueuedRelocation") {}
-	RelocateData( RelocateShard const& rs ) : keys(rs.keys), priority(rs.priority), startTime(now()), randomId(g_random->randomUniqueID()), workFactor(0),
+	RelocateData() : startTime(-1), priority(-1), workFactor(0), bytes(-1), wantsNewServers(false), interval("QueuedRelocation") {}
+	RelocateData( RelocateShard const& rs ) : keys(rs.keys), priority(rs.priority), startTime(now()), randomId(g_random->randomUniqueID()), workFactor(0), bytes(-1),
 		wantsNewServers(
 			rs.priority == PRIORITY_REBALANCE_SHARD ||
 			rs.priority == PRIORITY_REBALANCE_OVERUTILIZED_TEAM ||
@@ -270,28 +271,33 @@ struct Busyness {
 	}
 };
 
-// find the "workFactor" for this, were it launched now
-int getWorkFactor( RelocateData const& relocation ) {
+// find the "workFactor" for this, were it launched now.  workScale (see DDQueueData::relocationWorkScale) makes a move that
+// will keep its sources busy for longer count for more.
+int getWorkFactor( RelocateData const& relocation, double workScale ) {
 	// Avoid the divide by 0!
 	ASSERT( relocation.src.size() );
 
-	if( relocation.priority >= PRIORITY_TEAM_1_LEFT )
-		return WORK_FULL_UTILIZATION / SERVER_KNOBS->RELOCATION_PARALLELISM_PER_SOURCE_SERVER;
+	double work;
+	if( relocation.priority == PRIORITY_TEAM_CONTAINS_DRAINING_SERVER )
+		work = WORK_FULL_UTILIZATION / relocation.src.size() / SERVER_KNOBS->RELOCATION_PARALLELISM_PER_DRAINING_SOURCE_SERVER;
+	else if( relocation.priority >= PRIORITY_TEAM_1_LEFT )
+		work = WORK_FULL_UTILIZATION / SERVER_KNOBS->RELOCATION_PARALLELISM_PER_SOURCE_SERVER;
 	else if( relocation.priority >= PRIORITY_TEAM_2_LEFT )
-		return WORK_FULL_UTILIZATION / 2 / SERVER_KNOBS->RELOCATION_PARALLELISM_PER_SOURCE_SERVER;
+		work = WORK_FULL_UTILIZATION / 2 / SERVER_KNOBS->RELOCATION_PARALLELISM_PER_SOURCE_SERVER;
 	else // for now we assume that any message at a lower priority can best be assumed to have a full team left for work
-		return WORK_FULL_UTILIZATION / relocation.src.size() / SERVER_KNOBS->RELOCATION_PARALLELISM_PER_SOURCE_SERVER;
+		work = WORK_FULL_UTILIZATION / relocation.src.size() / SERVER_KNOBS->RELOCATION_PARALLELISM_PER_SOURCE_SERVER;
+	return std::max( 1, std::min<int>( WORK_FULL_UTILIZATION, work * workScale ) );
 }
 
 // return true if servers are not too busy to launch the relocation
 bool canLaunch( RelocateData & relocation, int teamSize, std::map<UID, Busyness> & busymap,
-		std::vector<RelocateData> cancellableRelocations ) {
+		std::vector<RelocateData> cancellableRelocations, double workScale ) {
 	// assert this has not already been launched
 	ASSERT( relocation.workFactor == 0 );
 	ASSERT( relocation.src.size() != 0 );
 
 	// find the "workFactor" for this, were it launched now
-	int workFactor = getWorkFactor( relocation );
+	int workFactor = getWorkFactor( relocation, workScale );
 	int neededServers = std::max( 1, (int)relocation.src.size() - teamSize + 1 );
 	// see if each of the SS can launch this task
 	for( int i = 0; i < relocation.src.size(); i++ ) {
@@ -313,9 +319,9 @@ bool canLaunch( RelocateData & relocation, int teamSize, std::map<UID, Busyness>
 }
 
 // update busyness for each server
-void launch( RelocateData & relocation, std::map<UID, Busyness> & busymap ) {
+void launch( RelocateData & relocation, std::map<UID, Busyness> & busymap, double workScale ) {
 	// if we are here this means that we can launch and should adjust all the work the servers can do
-	relocation.workFactor = getWorkFactor( relocation );
+	relocation.workFactor = getWorkFactor( relocation, workScale );
 	for( int i = 0; i < relocation.src.size(); i++ )
 		busymap[ relocation.src[i] ].addWork( relocation.priority, relocation.workFactor );
 }
@@ -348,6 +354,51 @@ struct DDQueueData {
 	int durableStorageQuorumPerTeam;
 
 	std::map<UID, Busyness> busymap;
+	std::map<UID, Reference<FlowLock>> destinationFetchLocks; // In megabytes being fetched by each destination server
+
+	FlowLock* getDestinationFetchLock( UID server ) {
+		auto& lock = destinationFetchLocks[server];
+		if( !lock )
+			lock = Reference<FlowLock>( new FlowLock( SERVER_KNOBS->RELOCATION_MAX_MB_IN_FLIGHT_PER_DEST_SERVER ) );
+		return lock.getPtr();
+	}
+
+	// In megabytes being fetched by all relocations below PRIORITY_TEAM_UNHEALTHY.  adjustMovementBudget() holds back part
+	// of it while the foreground is saturated.
+	FlowLock movementBudget;
+	int movementBudgetHeldBack;
+
+	std::map<UID, double> fetchBytesPerSecond; // Smoothed throughput of the relocations each server was a source or destination of
+
+	double getFetchRate( UID server ) const {
+		auto it = fetchBytesPerSecond.find( server );
+		return it != fetchBytesPerSecond.end() ? it->second : SERVER_KNOBS->DD_DEFAULT_FETCH_BYTES_PER_SECOND;
+	}
+
+	void recordFetchRate( std::vector<UID> const& servers, double bytesPerSecond ) {
+		for( auto& s : servers ) {
+			auto it = fetchBytesPerSecond.find( s );
+			if( it == fetchBytesPerSecond.end() )
+				fetchBytesPerSecond[s] = bytesPerSecond;
+			else
+				it->second += SERVER_KNOBS->DD_FETCH_RATE_SMOOTHING * ( bytesPerSecond - it->second );
+		}
+	}
+
+	// How many relocations' worth of work rd is for its sources: the time it should take at their measured throughput, in
+	// units of DD_RELOCATION_WORK_SECONDS.  A shard too big to move quickly can take a source's whole share of relocations.
+	double relocationWorkScale( RelocateData const& rd ) const {
+		if( rd.bytes < 0 || !rd.src.size() )
+			return 1.0;
+		double rate = 0;
+		for( auto& s : rd.src )
+			rate += getFetchRate( s );
+		rate /= rd.src.size();
+		double seconds = rd.bytes / std::max( rate, 1.0 );
+		double parallelism = rd.priority == PRIORITY_TEAM_CONTAINS_DRAINING_SERVER ? SERVER_KNOBS->RELOCATION_PARALLELISM_PER_DRAINING_SOURCE_SERVER : SERVER_KNOBS->RELOCATION_PARALLELISM_PER_SOURCE_SERVER;
+		return std::max( SERVER_KNOBS->DD_RELOCATION_MIN_WORK_SCALE,
+			std::min( parallelism, seconds / SERVER_KNOBS->DD_RELOCATION_WORK_SECONDS ) );
+	}
 
 	KeyRangeMap< RelocateData > queueMap;
 	std::set<RelocateData, std::greater<RelocateData>> fetchingSourcesQueue;
@@ -378,7 +429,8 @@ struct DDQueueData {
 			shardsAffectedByTeamFailure( sABTF ), getAverageShardBytes( getAverageShardBytes ), mi( mi ), lock( lock ),
 			cx( cx ), teamSize( teamSize ), durableStorageQuorumPerTeam( durableStorageQuorumPerTeam ), input( input ),
 			getShardMetrics( getShardMetrics ), startMoveKeysParallelismLock( SERVER_KNOBS->DD_MOVE_KEYS_PARALLELISM ),
-			finishMoveKeysParallelismLock( SERVER_KNOBS->DD_MOVE_KEYS_PARALLELISM ), lastLimited(lastLimited), suppressIntervals(0), lastInterval(0) {}
+			finishMoveKeysParallelismLock( SERVER_KNOBS->DD_MOVE_KEYS_PARALLELISM ), lastLimited(lastLimited), suppressIntervals(0), lastInterval(0),
+			movementBudget( SERVER_KNOBS->DD_MOVEMENT_BUDGET_MB ), movementBudgetHeldBack(0) {}
 
 	void validate() {
 		if( EXPENSIVE_VALIDATION ) {
@@ -483,9 +535,10 @@ struct DDQueueData {
 		}
 	}
 
-	ACTOR Future<Void> getSourceServersForRange( Database cx, MasterInterface mi, RelocateData input, PromiseStream<RelocateData> output ) {
+	ACTOR Future<Void> getSourceServersForRange( Database cx, MasterInterface mi, RelocateData input, PromiseStream<RelocateData> output, PromiseStream<GetMetricsRequest> getShardMetrics ) {
 		state std::set<UID> servers;
 		state Transaction tr(cx);
+		state Future<StorageMetrics> metrics = brokenPromiseToNever( getShardMetrics.getReply( GetMetricsRequest( input.keys ) ) );
 
 		// FIXME: is the merge case needed
 		if( input.priority == PRIORITY_MERGE_SHARD ) {
@@ -543,6 +596,8 @@ struct DDQueueData {
 		}
 
 		input.src = std::vector<UID>( servers.begin(), servers.end() );
+		StorageMetrics m = wait( metrics );
+		input.bytes = m.bytes;
 		output.send( input );
 		return Void();
 	}
@@ -626,10 +681,12 @@ struct DDQueueData {
 				priority_relocations[rrs.priority]++;
 
 				fetchingSourcesQueue.insert( rrs );
-				getSourceActors.insert( rrs.keys, getSourceServersForRange( cx, mi, rrs, fetchSourceServersComplete ) );
+				getSourceActors.insert( rrs.keys, getSourceServersForRange( cx, mi, rrs, fetchSourceServersComplete, getShardMetrics ) );
 			} else {
 				RelocateData newData( rrs );
 				newData.keys = affectedQueuedItems[r];
+				if( newData.keys != rrs.keys )
+					newData.bytes = -1;  // Only part of the measured range is still queued
 				ASSERT( rrs.src.size() || rrs.startTime == -1 );
 
 				bool foundActiveRelocation = false;
@@ -767,7 +824,7 @@ struct DDQueueData {
 
 			// SOMEDAY: the list of source servers may be outdated since they were fetched when the work was put in the queue
 			// FIXME: we need spare capacity even when we're just going to be cancelling work via TEAM_HEALTHY
-			if( !canLaunch( rd, teamSize, busymap, cancellableRelocations ) ) {
+			if( !canLaunch( rd, teamSize, busymap, cancellableRelocations, relocationWorkScale( rd ) ) ) {
 				//logRelocation( rd, "SkippingQueuedRelocation" );
 				continue;
 			}
@@ -801,8 +858,10 @@ struct DDQueueData {
 			for(int r=0; r<ranges.size(); r++) {
 				RelocateData& rrs = inFlight.rangeContaining(ranges[r].begin)->value();
 				rrs.keys = ranges[r];
+				if( rrs.bytes >= 0 )
+					rrs.bytes = rd.bytes / ranges.size();
 
-				launch( rrs, busymap );
+				launch( rrs, busymap, relocationWorkScale( rrs ) );
 				activeRelocations++;
 				priority_relocations[ rrs.priority ]++;
 				inFlightActors.insert( rrs.keys, dataDistributionRelocator( this, rrs ) );
@@ -826,6 +885,52 @@ struct DDQueueData {
 
 extern bool noUnseed;
 
+// Takes a share of the global movement budget and of each destination server's fetch budget for a relocation of the given
+// size. A destination that has been fetching slowly is charged more of its own budget for the same bytes. The global budget is
+// taken first and the destination locks in server order, so relocations waiting on overlapping destinations can't deadlock
+// each other.
+ACTOR Future<Void> takeDestinationFetchLocks( DDQueueData* self, std::vector<UID> servers, int64_t bytes, std::vector<FlowLock::Releaser>* releasers ) {
+	state int i = 0;
+	state int budgetMegabytes = std::max<int64_t>( 1, std::min<int64_t>( bytes / 1000000,
+		std::min( SERVER_KNOBS->DD_MOVEMENT_BUDGET_MIN_MB, SERVER_KNOBS->DD_MOVEMENT_BUDGET_MB ) ) );
+	Void _ = wait( self->movementBudget.take( TaskDataDistributionLaunch, budgetMegabytes ) );
+	releasers->push_back( FlowLock::Releaser( self->movementBudget, budgetMegabytes ) );
+
+	std::sort( servers.begin(), servers.end() );
+	servers.resize( std::unique( servers.begin(), servers.end() ) - servers.begin() );
+	for(; i < servers.size(); i++) {
+		double slowdown = std::max( 1.0, SERVER_KNOBS->DD_DEFAULT_FETCH_BYTES_PER_SECOND / std::max( self->getFetchRate( servers[i] ), 1.0 ) );
+		state int megabytes = std::max<int64_t>( 1, std::min<double>( slowdown * bytes / 1000000, SERVER_KNOBS->RELOCATION_MAX_MB_IN_FLIGHT_PER_DEST_SERVER ) );
+		state FlowLock* lock = self->getDestinationFetchLock( servers[i] );
+		Void _ = wait( lock->take( TaskDataDistributionLaunch, megabytes ) );
+		releasers->push_back( FlowLock::Releaser( *lock, megabytes ) );
+	}
+	return Void();
+}
+
+// Shrinks the movement budget while ratekeeper is limiting the foreground, and lets it recover once it is not: the budget is
+// halved each interval the foreground is saturated and grows back linearly.  Relocations at PRIORITY_TEAM_UNHEALTHY and up
+// don't use it, so repairs are never held back.
+ACTOR Future<Void> adjustMovementBudget( DDQueueData* self ) {
+	state FlowLock::Releaser heldBack( self->movementBudget, 0 );
+	state int minBudget = std::min( SERVER_KNOBS->DD_MOVEMENT_BUDGET_MIN_MB, SERVER_KNOBS->DD_MOVEMENT_BUDGET_MB );
+	loop {
+		Void _ = wait( delay( SERVER_KNOBS->DD_MOVEMENT_BUDGET_ADJUST_INTERVAL, TaskDataDistributionLaunch ) );
+		state int budget = SERVER_KNOBS->DD_MOVEMENT_BUDGET_MB - heldBack.remaining;
+		if( now() - (*self->lastLimited) < SERVER_KNOBS->BG_DD_SATURATION_DELAY ) {
+			state int cut = budget - std::max<int>( minBudget, budget * SERVER_KNOBS->DD_MOVEMENT_BUDGET_DECREASE_RATIO );
+			if( cut > 0 ) {
+				// Waits for relocations already holding the budget to finish, and keeps new ones from starting meanwhile
+				Void _ = wait( self->movementBudget.take( TaskDataDistributionLaunch, cut ) );
+				heldBack.remaining += cut;
+			}
+		} else if( heldBack.remaining ) {
+			heldBack.release( SERVER_KNOBS->DD_MOVEMENT_BUDGET_INCREASE_MB );
+		}
+		self->movementBudgetHeldBack = heldBack.remaining;
+	}
+}
+
 // This actor relocates the specified keys to a good place.
 // These live in the inFlightActor key range map.
 ACTOR Future<Void> dataDistributionRelocator( DDQueueData *self, RelocateData rd )
@@ -839,6 +944,7 @@ ACTOR Future<Void> dataDistributionRelocator( DDQueueData *self, RelocateData rd
 	state ParallelTCInfo destination;
 	state std::vector<ShardsAffectedByTeamFailure::Team> destinationTeams;
 	state ParallelTCInfo healthyDestinations;
+	state std::vector<FlowLock::Releaser> destinationFetchReleasers;
 	state bool anyHealthy = false;
 	state int durableStorageQuorum = 0;
 
@@ -878,6 +984,7 @@ ACTOR Future<Void> dataDistributionRelocator( DDQueueData *self, RelocateData rd
 					double inflightPenalty = SERVER_KNOBS->INFLIGHT_PENALTY_HEALTHY;
 					if(rd.priority >= PRIORITY_TEAM_UNHEALTHY) inflightPenalty = SERVER_KNOBS->INFLIGHT_PENALTY_UNHEALTHY;
 					if(rd.priority >= PRIORITY_TEAM_1_LEFT) inflightPenalty = SERVER_KNOBS->INFLIGHT_PENALTY_ONE_LEFT;
+					if(rd.priority == PRIORITY_TEAM_CONTAINS_DRAINING_SERVER) inflightPenalty = SERVER_KNOBS->INFLIGHT_PENALTY_DRAIN;
 
 					auto req = GetTeamRequest(rd.wantsNewServers, rd.priority == PRIORITY_REBALANCE_UNDERUTILIZED_TEAM, true, inflightPenalty);
 					req.sources = rd.src;
@@ -915,6 +1022,12 @@ ACTOR Future<Void> dataDistributionRelocator( DDQueueData *self, RelocateData rd
 				Void _ = wait( delay( SERVER_KNOBS->BEST_TEAM_STUCK_DELAY, TaskDataDistributionLaunch ) );
 			}
 
+			// Repairs go ahead regardless, but rebalancing, splits and merges don't pile more fetches onto a busy destination
+			destinationFetchReleasers.clear();
+			if( rd.priority < PRIORITY_TEAM_UNHEALTHY ) {
+				Void _ = wait( takeDestinationFetchLocks( self, destination.getServerIDs(), metrics.bytes, &destinationFetchReleasers ) );
+			}
+
 			self->shardsAffectedByTeamFailure->moveShard(rd.keys, destinationTeams);
 
 			//FIXME: do not add data in flight to servers that were already in the src.
@@ -925,6 +1038,7 @@ ACTOR Future<Void> dataDistributionRelocator( DDQueueData *self, RelocateData rd
 				.detail("DestinationTeam", destination.getDesc());
 
 			state Error error = success();
+			state double moveStart = now();
 			state Promise<Void> dataMovementComplete;
 			state Future<Void> doMoveKeys = moveKeys(
 				self->cx, rd.keys, destination.getServerIDs(), healthyDestinations.getServerIDs(), self->lock,
@@ -988,6 +1102,11 @@ ACTOR Future<Void> dataDistributionRelocator( DDQueueData *self, RelocateData rd
 					}
 
 					self->bytesWritten += metrics.bytes;
+					if( metrics.bytes >= SERVER_KNOBS->MIN_SHARD_BYTES ) {
+						std::vector<UID> servers = destination.getServerIDs();
+						servers.insert( servers.end(), rd.src.begin(), rd.src.end() );
+						self->recordFetchRate( servers, metrics.bytes / std::max( now() - moveStart, 0.001 ) );
+					}
 					relocationComplete.send( rd );
 					return Void();
 				} else {
@@ -1148,6 +1267,7 @@ ACTOR Future<Void> dataDistributionQueue(
 		balancingFutures.push_back(BgDDMountainChopper(&self, i));
 		balancingFutures.push_back(BgDDValleyFiller(&self, i));
 	}
+	balancingFutures.push_back(adjustMovementBudget(&self));
 
 	try {
 		loop {
@@ -1225,6 +1345,8 @@ ACTOR Future<Void> dataDistributionQueue(
 						.detail( "HighPriorityRelocations", highPriorityRelocations )
 						.detail( "HighestPriority", highestPriorityRelocation )
 						.detail( "BytesWritten", self.bytesWritten )
+						.detail( "MovementBudgetMB", SERVER_KNOBS->DD_MOVEMENT_BUDGET_MB - self.movementBudgetHeldBack )
+						.detail( "MovementBudgetInUseMB", self.movementBudget.activePermits() - self.movementBudgetHeldBack )
 						.trackLatest( format("%s/MovingData", printable(cx->dbName).c_str() ).c_str() );
 				}
 				when ( Void _ = wait( self.error.getFuture() ) ) {}  // Propagate errors from dataDistributionRelocator
@@ -41,6 +41,10 @@ BandwidthStatus getBandwidthStatus( StorageMetrics const& metrics ) {
 	return BandwidthStatusNormal;
 }
 
+bool isReadHot( StorageMetrics const& metrics ) {
+	return metrics.bytesReadPerKSecond > SERVER_KNOBS->SHARD_MAX_BYTES_READ_PER_KSEC;
+}
+
 ACTOR Future<Void> updateMaxShardSize( Standalone<StringRef> dbName, Reference<AsyncVar<int64_t>> dbSizeEstimate, Reference<AsyncVar<Optional<int64_t>>> maxShardSize ) {
 	state int64_t lastDbSize = 0;
 	state int64_t granularity = g_network->isSimulated() ?
@@ -109,6 +113,7 @@ ShardSizeBounds getShardSizeBounds(KeyRangeRef shard, int64_t maxShardSize) {
 
 	bounds.max.bytesPerKSecond = bounds.max.infinity;
 	bounds.max.iosPerKSecond = bounds.max.infinity;
+	bounds.max.bytesReadPerKSecond = bounds.max.infinity;
 
 	//The first shard can have arbitrarily small size
 	if(shard.begin == allKeys.begin) {
@@ -119,11 +124,13 @@ ShardSizeBounds getShardSizeBounds(KeyRangeRef shard, int64_t maxShardSize) {
 
 	bounds.min.bytesPerKSecond = 0;
 	bounds.min.iosPerKSecond = 0;
+	bounds.min.bytesReadPerKSecond = 0;
 
 	//The permitted error is 1/3 of the general-case minimum bytes (even in the special case where this is the last shard)
 	bounds.permittedError.bytes = bounds.max.bytes / SERVER_KNOBS->SHARD_BYTES_RATIO / 3;
 	bounds.permittedError.bytesPerKSecond = bounds.permittedError.infinity;
 	bounds.permittedError.iosPerKSecond = bounds.permittedError.infinity;
+	bounds.permittedError.bytesReadPerKSecond = bounds.permittedError.infinity;
 
 	return bounds;
 }
@@ -176,6 +183,16 @@ ACTOR Future<Void> trackShardBytes(
 					} else
 						ASSERT( false );
 
+					// Wake up when the shard becomes read hot (or cools down), so that it can be split by read bandwidth
+					if( isReadHot( shardSize->get().get() ) ) {
+						bounds.max.bytesReadPerKSecond = bounds.max.infinity;
+						bounds.min.bytesReadPerKSecond = SERVER_KNOBS->SHARD_MAX_BYTES_READ_PER_KSEC;
+						bounds.permittedError.bytesReadPerKSecond = bounds.min.bytesReadPerKSecond / 4;
+					} else {
+						bounds.max.bytesReadPerKSecond = SERVER_KNOBS->SHARD_MAX_BYTES_READ_PER_KSEC;
+						bounds.min.bytesReadPerKSecond = 0;
+						bounds.permittedError.bytesReadPerKSecond = bounds.max.bytesReadPerKSecond / 4;
+					}
 				} else {
 					bounds.max.bytes = -1;
 					bounds.min.bytes = -1;
@@ -183,6 +200,9 @@ ACTOR Future<Void> trackShardBytes(
 					bounds.max.bytesPerKSecond = bounds.max.infinity;
 					bounds.min.bytesPerKSecond = 0;
 					bounds.permittedError.bytesPerKSecond = bounds.permittedError.infinity;
+					bounds.max.bytesReadPerKSecond = bounds.max.infinity;
+					bounds.min.bytesReadPerKSecond = 0;
+					bounds.permittedError.bytesReadPerKSecond = bounds.permittedError.infinity;
 				}
 
 				bounds.max.iosPerKSecond = bounds.max.infinity;
@@ -327,6 +347,7 @@ ACTOR Future<Void> shardSplitter(
 	splitMetrics.bytes = shardBounds.max.bytes / 2;
 	splitMetrics.bytesPerKSecond = keys.begin >= keyServersKeys.begin ? splitMetrics.infinity : SERVER_KNOBS->SHARD_SPLIT_BYTES_PER_KSEC;
 	splitMetrics.iosPerKSecond = splitMetrics.infinity;
+	splitMetrics.bytesReadPerKSecond = keys.begin >= keyServersKeys.begin ? splitMetrics.infinity : SERVER_KNOBS->SHARD_SPLIT_BYTES_READ_PER_KSEC;
 
 	state Standalone<VectorRef<KeyRef>> splitKeys = wait( getSplitKeys(self, keys, splitMetrics, metrics ) );
 	//fprintf(stderr, "split keys:\n");
@@ -344,6 +365,7 @@ ACTOR Future<Void> shardSplitter(
 			.detail("MetricsBytes", metrics.bytes)
 			.detail("Bandwidth", bandwidthStatus == BandwidthStatusHigh ? "High" : bandwidthStatus == BandwidthStatusNormal ? "Normal" : "Low")
 			.detail("BytesPerKSec", metrics.bytesPerKSecond)
+			.detail("BytesReadPerKSec", metrics.bytesReadPerKSecond)
 			.detail("numShards", numShards);
 	}
 
@@ -430,6 +452,7 @@ Future<Void> shardMerger(
 		auto shardBounds = getShardSizeBounds( merged, maxShardSize );
 		if( endingStats.bytes >= shardBounds.min.bytes ||
 				getBandwidthStatus( endingStats ) != BandwidthStatusLow ||
+				endingStats.bytesReadPerKSecond >= SERVER_KNOBS->SHARD_SPLIT_BYTES_READ_PER_KSEC ||
 				shardsMerged >= SERVER_KNOBS->DD_MERGE_LIMIT ) {
 			// The merged range is larger than the min bounds se we cannot continue merging in this direction.
 			//  This means that:
@@ -483,9 +506,10 @@ ACTOR Future<Void> shardEvaluator(
 	StorageMetrics const& stats = shardSize->get().get();
 
 	bool shouldSplit = stats.bytes > shardBounds.max.bytes ||
-							( getBandwidthStatus( stats ) == BandwidthStatusHigh && keys.begin < keyServersKeys.begin );
+							( ( getBandwidthStatus( stats ) == BandwidthStatusHigh || isReadHot( stats ) ) && keys.begin < keyServersKeys.begin );
 	bool shouldMerge = stats.bytes < shardBounds.min.bytes &&
-							getBandwidthStatus( stats ) == BandwidthStatusLow;
+							getBandwidthStatus( stats ) == BandwidthStatusLow &&
+							stats.bytesReadPerKSecond < SERVER_KNOBS->SHARD_SPLIT_BYTES_READ_PER_KSEC;
 
 	// Every invocation must set this or clear it
 	if(shouldMerge && !self->anyZeroHealthyTeams->get()) {
@@ -225,6 +225,8 @@ StatusObject DatabaseConfiguration::toJSON(bool noPolicies) const {
 			result["storage_engine"] = "ssd-2";
 		} else if( tLogDataStoreType == KeyValueStoreType::MEMORY && storageServerStoreType == KeyValueStoreType::MEMORY ) {
 			result["storage_engine"] = "memory";
+		} else if( tLogDataStoreType == KeyValueStoreType::LSM && storageServerStoreType == KeyValueStoreType::LSM ) {
+			result["storage_engine"] = "lsm";
 		}
 
 		if( remoteTLogReplicationFactor == 0 ) {
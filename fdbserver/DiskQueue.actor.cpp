@@ -23,6 +23,9 @@
 #include "fdbrpc/IAsyncFile.h"
 #include "Knobs.h"
 #include "fdbrpc/simulator.h"
+#include "fdbrpc/ContinuousSample.h"
+#include "flow/Histogram.h"
+#include "fdbrpc/crc32c.h"
 
 typedef bool(*compare_pages)(void*,void*);
 typedef int64_t loc_t;
@@ -84,13 +87,14 @@ struct StringBuffer {
 
 struct SyncQueue : ReferenceCounted<SyncQueue> {
 	SyncQueue( int outstandingLimit, Reference<IAsyncFile> file )
-		: outstandingLimit(outstandingLimit), file(file)
+		: outstandingLimit(outstandingLimit), file(file), unsyncedCalls(0), syncLatencyEstimate(0), lastLogged(now()), batchSizes(1000)
 	{
 		for(int i=0; i<outstandingLimit; i++)
 			outstanding.push_back( Void() );
 	}
 
 	Future<Void> onSync() {  // Future is set when all writes completed before the call to onSync are complete
+		++unsyncedCalls;
 		if (outstanding.size() <= outstandingLimit)
 			outstanding.push_back( waitAndSync(this) );
 		return outstanding.back();
@@ -101,10 +105,41 @@ private:
 	Deque<Future<Void>> outstanding;
 	Reference<IAsyncFile> file;
 
+	int unsyncedCalls;  // Calls to onSync() which will be satisfied by the next sync to start
+	double syncLatencyEstimate;
+	double lastLogged;
+	ContinuousSample<int> batchSizes;
+	LatencyHistogram syncLatencies;
+
 	ACTOR static Future<Void> waitAndSync(SyncQueue* self) {
 		Void _ = wait( self->outstanding.front() );
+
+		// Group commit: commits which arrive while this sync is still waiting to start join it rather than queueing another sync.  The wait is a fraction
+		// of recent sync latency, so it costs little latency on devices with fast syncs and batches more commits on devices with slow ones.
+		state double groupDelay = std::min( SERVER_KNOBS->DISK_QUEUE_GROUP_COMMIT_MAX_DELAY, SERVER_KNOBS->DISK_QUEUE_GROUP_COMMIT_LATENCY_FRACTION * self->syncLatencyEstimate );
+		if (groupDelay > 0)
+			Void _ = wait( delay(groupDelay) );
+
 		self->outstanding.pop_front();
+		self->batchSizes.addSample( self->unsyncedCalls );
+		self->unsyncedCalls = 0;
+
+		state double startTime = now();
 		Void _ = wait( self->file->sync() );
+
+		double latency = now() - startTime;
+		self->syncLatencies.record( latency );
+		self->syncLatencyEstimate = self->syncLatencyEstimate ? 0.9 * self->syncLatencyEstimate + 0.1 * latency : latency;
+
+		if (now() - self->lastLogged >= SERVER_KNOBS->WORKER_LOGGING_INTERVAL) {
+			TraceEvent("DiskQueueSyncMetrics").detail("Filename", self->file->getFilename())
+				.detail("BatchSizeMedian", self->batchSizes.median()).detail("BatchSizeP99", self->batchSizes.percentile(0.99)).detail("BatchSizeMax", self->batchSizes.max())
+				.detail("SyncLatencyMedian", self->syncLatencies.median()).detail("SyncLatencyP99", self->syncLatencies.percentile(0.99)).detail("SyncLatencyMax", self->syncLatencies.max())
+				.detail("GroupDelay", groupDelay);
+			self->batchSizes.clear();
+			self->syncLatencies.clear();
+			self->lastLogged = now();
+		}
 		return Void();
 	}
 };
@@ -113,7 +148,7 @@ class RawDiskQueue_TwoFiles {
 public:
 	RawDiskQueue_TwoFiles( std::string basename, UID dbgid, int64_t fileSizeWarningLimit )
 		: basename(basename), onError(delayed(error.getFuture())), onStopped(stopped.getFuture()),
-		readingFile(-1), readingPage(-1), writingPos(-1), dbgid(dbgid),
+		readingFile(-1), readingPage(-1), readAheadFile(-1), readAheadPage(-1), writingPos(-1), dbgid(dbgid),
 		dbg_file0BeginSeq(0), fileExtensionBytes(10<<20), readingBuffer( dbgid ),
 		readyToPush(Void()), fileSizeWarningLimit(fileSizeWarningLimit), lastCommit(Void()), isFirstCommit(true)
 	{
@@ -139,6 +174,8 @@ public:
 		TraceEvent("RDQSetStart", dbgid).detail("f",file).detail("p",page).detail("file0name", files[0].dbgFilename);
 		readingFile = file;
 		readingPage = page;
+		readAheadFile = file;
+		readAheadPage = page;
 	}
 
 	Future<Void> setPoppedPage( int file, int64_t page, int64_t debugSeq ) { return setPoppedPage(this, file, page, debugSeq); }
@@ -146,6 +183,10 @@ public:
 	Future<Standalone<StringRef>> readNextPage() { return readNextPage(this); }
 	Future<Void> truncateBeforeLastReadPage() { return truncateBeforeLastReadPage(this); }
 
+	// Reads the pages with sequence numbers in [beginSeq, endSeq) directly from the files.  Only valid after recovery, for pages which
+	// have been committed and not yet overwritten.
+	Future<Standalone<StringRef>> readPages( int64_t beginSeq, int64_t endSeq ) { return readPages(this, beginSeq, endSeq); }
+
 	Future<Void> getError() { return onError; }
 	Future<Void> onClosed() { return onStopped; }
 	void dispose() { shutdown(this, true); }
@@ -197,6 +238,16 @@ public:
 	int readingFile;  // i if the next page after readingBuffer should be read from files[i], 2 if recovery is complete
 	int64_t readingPage;  // Page within readingFile that is the next page after readingBuffer
 
+	struct ReadAheadChunk {
+		int file;
+		int64_t page;  // First page of the chunk within file
+		Future<Standalone<StringRef>> data;
+		ReadAheadChunk( int file, int64_t page, Future<Standalone<StringRef>> data ) : file(file), page(page), data(data) {}
+	};
+	Deque<ReadAheadChunk> readAhead;  // Reads issued during recovery but not yet moved into readingBuffer, in file order
+	int readAheadFile;  // The file and page at which the next read ahead will begin
+	int64_t readAheadPage;
+
 	int64_t writingPos;  // Position within files[1] that will be next written
 
 	int64_t fileExtensionBytes;
@@ -217,6 +268,12 @@ public:
 
 	Future<Void> truncateFile(int file, int64_t pos) { return truncateFile(this, file, pos); }
 
+	enum { FORMAT_CHUNK_BYTES = 1<<20 };
+
+	// With DISK_QUEUE_WRITE_DSYNC the pages are durable when their writes complete, and the syncs issued by commits only need to cover
+	// changes to the file sizes.
+	int writeModeFlags() const { return SERVER_KNOBS->DISK_QUEUE_WRITE_DSYNC ? IAsyncFile::OPEN_DSYNC : 0; }
+
 	Future<Void> push(StringRef pageData, vector<Reference<SyncQueue>>& toSync) {
 		// Write the given data to the queue files, swapping or extending them if necessary.
 		// Don't do any syncs, but push the modified file(s) onto toSync.
@@ -359,7 +416,7 @@ public:
 	ACTOR static Future<Void> openFiles( RawDiskQueue_TwoFiles* self ) {
 		state vector<Future<Reference<IAsyncFile>>> fs;
 		for(int i=0; i<2; i++)
-			fs.push_back( IAsyncFileSystem::filesystem()->open( self->filename(i), IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_LOCK, 0 ) );
+			fs.push_back( IAsyncFileSystem::filesystem()->open( self->filename(i), IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_LOCK | self->writeModeFlags(), 0 ) );
 		Void _ = wait( waitForAllReady(fs) );
 
 		// Treatment of errors here is important.  If only one of the two files is present
@@ -375,7 +432,7 @@ public:
 			// OPEN_ATOMIC_WRITE_AND_CREATE defers creation (using a .part file) until the calls to sync() below
 			TraceEvent("DiskQueueCreate").detail("File0", self->filename(0));
 			for(int i=0; i<2; i++)
-				fs[i] = IAsyncFileSystem::filesystem()->open( self->filename(i), IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_LOCK, 0600 );
+				fs[i] = IAsyncFileSystem::filesystem()->open( self->filename(i), IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_LOCK | self->writeModeFlags(), 0600 );
 
 			// Any error here is fatal
 			Void _ = wait( waitForAll(fs) );
@@ -482,9 +539,14 @@ public:
 
 				//Truncate both files, since perhaps only the first pages are corrupted.  This avoids cases where overwritting the first page and then terminating makes
 				//subsequent pages valid upon recovery.
+				//With DISK_QUEUE_PREALLOCATE_BYTES the files are instead formatted with zeros up to their preallocated size, so that the queue
+				//cycles through the two files without changing their sizes or allocating extents in steady state.
 				vector<Future<Void>> truncates;
+				int64_t preallocateBytes = SERVER_KNOBS->DISK_QUEUE_PREALLOCATE_BYTES / 2 / sizeof(Page) * sizeof(Page);
 				for(int i = 0; i < 2; ++i)
-					if(self->files[i].size > 0)
+					if(preallocateBytes > 0)
+						truncates.push_back(self->formatFile(self, i, preallocateBytes));
+					else if(self->files[i].size > 0)
 						truncates.push_back(self->truncateFile(self, i, 0));
 
 				Void _ = wait(waitForAll(truncates));
@@ -539,29 +601,34 @@ public:
 		}
 	}
 
-	Future<int> fillReadingBuffer() {
-		// If we're right at the end of a file...
-		if ( readingPage*sizeof(Page) >= (size_t)files[readingFile].size ) {
-			readingFile++;
-			readingPage = 0;
-			if (readingFile>=2) {
-				// Recovery complete
-				readingBuffer.clear();
-				writingPos = files[1].size;
-				return 0;
+	void startReadAhead() {
+		// Keep up to DISK_QUEUE_RECOVERY_READ_AHEAD reads of up to DISK_QUEUE_RECOVERY_READ_BYTES outstanding, so that recovery
+		// isn't waiting on a single read at a time
+		while ( readAhead.size() < SERVER_KNOBS->DISK_QUEUE_RECOVERY_READ_AHEAD && readAheadFile < 2 ) {
+			// If we're right at the end of a file...
+			if ( readAheadPage*sizeof(Page) >= (size_t)files[readAheadFile].size ) {
+				readAheadFile++;
+				readAheadPage = 0;
+				continue;
 			}
-		}
 
-		// Read up to 1MB into readingBuffer
-		int len = std::min<int64_t>( (files[readingFile].size/sizeof(Page) - readingPage)*sizeof(Page), BUGGIFY_WITH_PROB(1.0) ? sizeof(Page)*g_random->randomInt(1,4) : (1<<20) );
-		readingBuffer.clear();
-		readingBuffer.alignReserve( sizeof(Page), len );
-		void* p = readingBuffer.append(len);
+			int len = std::min<int64_t>( (files[readAheadFile].size/sizeof(Page) - readAheadPage)*sizeof(Page), BUGGIFY_WITH_PROB(1.0) ? sizeof(Page)*g_random->randomInt(1,4) : SERVER_KNOBS->DISK_QUEUE_RECOVERY_READ_BYTES );
+			readAhead.push_back( ReadAheadChunk( readAheadFile, readAheadPage, readChunk( this, readAheadFile, readAheadPage*sizeof(Page), len ) ) );
+			readAheadPage += len / sizeof(Page);
+		}
+	}
 
-		auto pos = readingPage * sizeof(Page);
-		readingPage += len / sizeof(Page);
+	ACTOR static UNCANCELLABLE Future<Standalone<StringRef>> readChunk(RawDiskQueue_TwoFiles* self, int file, int64_t pos, int len) {
+		// The chunk owns its buffer, and TrackMe keeps the queue from shutting down, until the read finishes even if recovery has stopped waiting for it
+		state TrackMe trackMe(self);
+		state StringBuffer buffer( self->dbgid );
+		buffer.alignReserve( sizeof(Page), len );
+		void* p = buffer.append(len);
 		ASSERT( int64_t(p) % sizeof(Page) == 0 );
-		return files[readingFile].f->read( p, len, pos );
+
+		int read = wait( self->files[file].f->read( p, len, pos ) );
+		ASSERT( read == len );
+		return buffer.str;
 	}
 
 	ACTOR static UNCANCELLABLE Future<Standalone<StringRef>> readNextPage(RawDiskQueue_TwoFiles* self) {
@@ -571,17 +638,26 @@ public:
 			ASSERT( self->readingFile < 2 );
 			ASSERT( self->files[0].f && self->files[1].f );
 
-
 			if (!self->readingBuffer.size()) {
-				state Future<Void> f = Void();
-				//if (BUGGIFY) f = delay( g_random->random01() * 0.1 );
+				self->startReadAhead();
+				if (self->readAhead.empty()) {
+					// Recovery complete
+					self->readingFile = 2;
+					self->readingBuffer.clear();
+					self->writingPos = self->files[1].size;
+					return Standalone<StringRef>();
+				}
 
-				int read = wait( self->fillReadingBuffer() );
-				ASSERT( read == self->readingBuffer.size() );
+				state ReadAheadChunk chunk = self->readAhead.front();
+				self->readAhead.pop_front();
+				Standalone<StringRef> data = wait( chunk.data );
 
-				Void _ = wait(f);
+				self->readingFile = chunk.file;
+				self->readingPage = chunk.page + data.size() / sizeof(Page);
+				self->readingBuffer.str = data;
+				self->readingBuffer.reserved = data.size();
+				self->startReadAhead();
 			}
-			if (!self->readingBuffer.size()) return Standalone<StringRef>();
 
 			ASSERT( self->readingBuffer.size() >= sizeof(Page) );
 			Standalone<StringRef> result = self->readingBuffer.pop_front( sizeof(Page) );
@@ -604,6 +680,30 @@ public:
 		return Void();
 	}
 
+	// Writes zeros over the whole of the given file, first extending it to at least minSize.  Unlike zeroRange(), this leaves every
+	// extent of the file allocated and written, so later page writes don't change any file system metadata.
+	ACTOR static UNCANCELLABLE Future<Void> formatFile(RawDiskQueue_TwoFiles* self, int file, int64_t minSize) {
+		state TrackMe trackMe(self);
+		state Reference<IAsyncFile> f = self->files[file].f;
+		state StringBuffer zeros( self->dbgid );
+		state int64_t pos = 0;
+
+		self->files[file].size = std::max(self->files[file].size, minSize);
+		TraceEvent("DQFormatFile", self->dbgid).detail("File", file).detail("Size", self->files[file].size).detail("File0Name", self->files[0].dbgFilename);
+
+		zeros.alignReserve( sizeof(Page), FORMAT_CHUNK_BYTES );
+		memset( zeros.append(FORMAT_CHUNK_BYTES), 0, FORMAT_CHUNK_BYTES );
+
+		Void _ = wait( f->truncate( self->files[file].size ) );
+		while (pos < self->files[file].size) {
+			int64_t len = std::min<int64_t>( FORMAT_CHUNK_BYTES, self->files[file].size - pos );
+			Void _ = wait( f->write( zeros.str.begin(), len, pos ) );
+			pos += len;
+		}
+		Void _ = wait( self->files[file].syncQueue->onSync() );
+		return Void();
+	}
+
 	ACTOR static Future<Void> truncateBeforeLastReadPage( RawDiskQueue_TwoFiles* self ) {
 		try {
 			state int file = self->readingFile;
@@ -616,6 +716,8 @@ public:
 
 			self->readingFile = 2;
 			self->readingBuffer.clear();
+			self->readAhead.clear();
+			self->readAheadFile = 2;
 			self->writingPos = pos;
 
 			while (file < 2) {
@@ -638,6 +740,56 @@ public:
 			throw;
 		}
 	}
+
+	ACTOR static UNCANCELLABLE Future<Standalone<StringRef>> readPages( RawDiskQueue_TwoFiles* self, int64_t beginSeq, int64_t endSeq ) {
+		state TrackMe trackMe(self);
+		state StringBuffer result( self->dbgid );
+		state vector<Reference<IAsyncFile>> files;  // Hold onto references in case the files are swapped during the reads
+		state vector<Future<int>> reads;
+		state vector<int> lengths;
+
+		ASSERT( self->readingFile == 2 );
+		ASSERT( beginSeq % sizeof(Page) == 0 && endSeq % sizeof(Page) == 0 && beginSeq <= endSeq );
+
+		if (beginSeq < self->dbg_file0BeginSeq || endSeq > self->dbg_file0BeginSeq + self->files[0].size + self->files[1].size) {
+			TraceEvent(SevError, "RDQ_readPages_OutOfRange", self->dbgid).detail("BeginSeq", beginSeq).detail("EndSeq", endSeq)
+				.detail("File0BeginSeq", self->dbg_file0BeginSeq).detail("file0name", self->files[0].dbgFilename);
+			throw io_error();
+		}
+
+		result.alignReserve( sizeof(Page), endSeq - beginSeq );
+		uint8_t* p = (uint8_t*)result.append( endSeq - beginSeq );
+
+		int64_t fileBeginSeq = self->dbg_file0BeginSeq;
+		for(int i=0; i<2; i++) {
+			int64_t b = std::max( beginSeq, fileBeginSeq );
+			int64_t e = std::min( endSeq, fileBeginSeq + self->files[i].size );
+			if (b < e) {
+				files.push_back( self->files[i].f );
+				reads.push_back( files.back()->read( p + (b - beginSeq), e - b, b - fileBeginSeq ) );
+				lengths.push_back( e - b );
+			}
+			fileBeginSeq += self->files[i].size;
+		}
+
+		try {
+			Void _ = wait( waitForAll(reads) );
+		} catch (Error& e) {
+			TraceEvent(SevError, "RDQ_readPages_Error", self->dbgid).detail("file0name", self->files[0].dbgFilename).error(e, true);
+			if (!self->error.isSet()) self->error.sendError(e);
+			throw;
+		}
+
+		for(int i=0; i<reads.size(); i++) {
+			if (reads[i].get() != lengths[i]) {
+				TraceEvent(SevError, "RDQ_readPages_ShortRead", self->dbgid).detail("BeginSeq", beginSeq).detail("EndSeq", endSeq)
+					.detail("Expected", lengths[i]).detail("Read", reads[i].get()).detail("file0name", self->files[0].dbgFilename);
+				throw io_error();
+			}
+		}
+
+		return result.str;
+	}
 };
 
 class DiskQueue : public IDiskQueue {
@@ -739,6 +891,8 @@ public:
 
 	virtual location getNextReadLocation() { return nextReadLocation; }
 
+	virtual Future<Standalone<StringRef>> read( location from, location to ) { return read(this, from, to); }
+
 	virtual Future<Void> getError() { return rawQueue->getError(); }
 	virtual Future<Void> onClosed() { return rawQueue->onClosed(); }
 	virtual void dispose() {
@@ -776,17 +930,20 @@ private:
 
 		int remainingCapacity() const { return maxPayload - payloadSize; }
 		uint64_t endSeq() const { return seq + sizeof(PageHeader) + payloadSize; }
-		void updateHash() {
-			// SOMEDAY: Better hash?
+		// The second half of the hash says how the first half was computed, so that pages written either way can be read
+		enum { HASHLITTLE2_MARKER = 0xfdb, CRC32C_MARKER = 0xfdc };
+		UID computeHash( bool useCrc32c ) const {
+			if (useCrc32c)
+				return UID( crc32c_append( 0x12345678, (const uint8_t*)&seq, sizeof(Page)-sizeof(hash) ), CRC32C_MARKER );
 			uint32_t part[2] = { 0x12345678, 0xbeefabcd };
 			hashlittle2( &seq, sizeof(Page)-sizeof(hash), &part[0], &part[1] );
-			hash = UID( (int64_t(part[0])<<32)+part[1], 0xfdb );
+			return UID( (int64_t(part[0])<<32)+part[1], HASHLITTLE2_MARKER );
+		}
+		void updateHash() {
+			hash = computeHash( SERVER_KNOBS->USE_CRC32C_PAGE_CHECKSUMS );
 		}
 		bool checkHash() {
-			UID h = hash;
-			updateHash();
-			if (h != hash) { std::swap(h, hash); return false; }
-			return true;
+			return hash == computeHash( hash.second() == CRC32C_MARKER );
 		}
 		void zeroPad() {
 			memset( payload+payloadSize, 0, maxPayload-payloadSize );
@@ -916,6 +1073,39 @@ private:
 		return result.str;
 	}
 
+	ACTOR static Future<Standalone<StringRef>> read( DiskQueue* self, location from, location to ) {
+		ASSERT( self->recovered );
+		ASSERT( from.hi == 0 && to.hi == 0 && from.lo <= to.lo );
+		ASSERT( self->poppedSeq/sizeof(Page)*sizeof(Page) <= from.lo && to.lo <= self->lastCommittedSeq );
+
+		state loc_t beginSeq = from.lo/sizeof(Page)*sizeof(Page);
+		loc_t endSeq = (to.lo + sizeof(Page) - 1)/sizeof(Page)*sizeof(Page);
+		Standalone<StringRef> pages = wait( self->rawQueue->readPages( beginSeq, endSeq ) );
+
+		// Each page holds the payload bytes [seq+sizeof(PageHeader), endSeq()), so concatenate the parts of those ranges between from and to
+		Standalone<StringRef> result;
+		uint8_t* buf = new (result.arena()) uint8_t[to.lo - from.lo];
+		int len = 0;
+		for(int i = 0; i < pages.size() / sizeof(Page); i++) {
+			Page* page = (Page*)pages.begin() + i;
+			loc_t seq = beginSeq + i*sizeof(Page);
+			if (!page->checkHash() || loc_t(page->seq) != seq) {
+				TraceEvent(SevError, "DQReadInvalidPage", self->dbgid).detail("From", from.lo).detail("To", to.lo).detail("Expect", seq)
+					.detail("seq", page->seq).detail("hashCheck", page->checkHash()).detail("file0name", self->rawQueue->files[0].dbgFilename);
+				throw io_error();
+			}
+			loc_t b = std::max<loc_t>( from.lo, seq + sizeof(PageHeader) );
+			loc_t e = std::min<loc_t>( to.lo, page->endSeq() );
+			if (b < e) {
+				memcpy( buf + len, page->payload + (b - seq - sizeof(PageHeader)), e - b );
+				len += e - b;
+			}
+		}
+
+		result.contents() = StringRef( buf, len );
+		return result;
+	}
+
 	ACTOR static Future<bool> findStart( DiskQueue* self ) {
 		Standalone<StringRef> epbuf = wait( self->rawQueue->readFirstAndLastPages( &comparePages ) );
 		ASSERT( epbuf.size() % sizeof(Page) == 0 );
@@ -1048,6 +1238,8 @@ public:
 
 	virtual location getNextReadLocation() { return queue->getNextReadLocation(); }
 
+	virtual Future<Standalone<StringRef>> read( location from, location to ) { return queue->read(from, to); }
+
 	virtual location push( StringRef contents ) {
 		pushed = queue->push(contents);
 		return pushed;
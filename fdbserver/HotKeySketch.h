@@ -0,0 +1,128 @@
+/*
+ * HotKeySketch.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FDBSERVER_HOTKEYSKETCH_H
+#define FDBSERVER_HOTKEYSKETCH_H
+#pragma once
+
+#include "flow/flow.h"
+#include "flow/Hash3.h"
+#include "flow/Trace.h"
+#include "fdbclient/FDBTypes.h"
+#include "Knobs.h"
+
+// Finds the keys that account for the most of a stream of (key, amount) pairs too large to count exactly, such as the reads
+// of a storage server.  A count-min sketch (with conservative update) estimates the total amount of any key, never low and
+// high by only a small fraction of the whole stream, and each key whose estimate puts it among the top K seen is kept as a
+// candidate.  decay() scales everything down, so with periodic decay the estimates follow a recent, exponentially weighted
+// rate rather than all of history.
+class HotKeySketch : NonCopyable {
+public:
+	HotKeySketch( int depth, int width, int topK ) : depth(depth), width(width), topK(topK), counts(depth*width, 0.0), total(0), minCandidate(0) {}
+	HotKeySketch() : HotKeySketch( SERVER_KNOBS->HOT_KEY_SKETCH_DEPTH, SERVER_KNOBS->HOT_KEY_SKETCH_WIDTH, SERVER_KNOBS->HOT_KEY_TOP_K ) {}
+
+	void add( KeyRef const& key, double amount = 1 ) {
+		total += amount;
+		double est = 0;
+		for(int r = 0; r < depth; r++) {
+			double c = counts[ slot(key, r) ];
+			est = r ? std::min( est, c ) : c;
+		}
+		est += amount;
+		for(int r = 0; r < depth; r++) {
+			double& c = counts[ slot(key, r) ];
+			c = std::max( c, est );
+		}
+
+		for(auto& c : candidates) {
+			if( c.first == key ) {
+				c.second = est;
+				return;
+			}
+		}
+		if( candidates.size() < topK ) {
+			candidates.push_back( std::make_pair( Key(key), est ) );
+			minCandidate = candidates.size() == 1 ? est : std::min( minCandidate, est );
+		} else if( est > minCandidate ) {
+			// minCandidate is only a lower bound, since candidates' estimates grow
+			int least = 0;
+			for(int c = 1; c < candidates.size(); c++)
+				if( candidates[c].second < candidates[least].second )
+					least = c;
+			if( est > candidates[least].second )
+				candidates[least] = std::make_pair( Key(key), est );
+			minCandidate = est;
+			for(auto& c : candidates)
+				minCandidate = std::min( minCandidate, c.second );
+		}
+	}
+
+	double estimate( KeyRef const& key ) const {
+		double est = 0;
+		for(int r = 0; r < depth; r++) {
+			double c = counts[ slot(key, r) ];
+			est = r ? std::min( est, c ) : c;
+		}
+		return est;
+	}
+
+	// The candidates, most first
+	std::vector<std::pair<Key, double>> top() const {
+		std::vector<std::pair<Key, double>> result = candidates;
+		std::sort( result.begin(), result.end(), []( std::pair<Key, double> const& a, std::pair<Key, double> const& b ) { return a.second > b.second; } );
+		return result;
+	}
+
+	double getTotal() const { return total; }
+
+	void decay( double factor ) {
+		for(auto& c : counts)
+			c *= factor;
+		for(auto& c : candidates)
+			c.second *= factor;
+		total *= factor;
+		minCandidate *= factor;
+	}
+
+	// Details <prefix>Key<i> and <prefix>Hz<i> for each candidate, where estimates decayed by `factor` every `interval` seconds
+	// are converted to rates.  Status reads them back to combine the candidates of many servers.
+	void addDetails( TraceEvent& ev, std::string const& prefix, double interval, double factor ) const {
+		auto t = top();
+		double scale = (1 - factor) / interval;
+		for(int i = 0; i < t.size(); i++) {
+			KeyRef key = t[i].first.substr( 0, std::min<int>( t[i].first.size(), SERVER_KNOBS->HOT_KEY_MAX_REPORTED_BYTES ) );
+			ev.detail( format("%sKey%d", prefix.c_str(), i).c_str(), printable(key) ).detail( format("%sHz%d", prefix.c_str(), i).c_str(), t[i].second * scale );
+		}
+		ev.detail( (prefix + "Hz").c_str(), total * scale );
+	}
+
+private:
+	int depth, width, topK;
+	std::vector<double> counts;  // depth rows of width counters
+	std::vector<std::pair<Key, double>> candidates;  // At most topK
+	double total;
+	double minCandidate;  // No greater than the least estimate in candidates
+
+	int slot( KeyRef const& key, int row ) const {
+		return row * width + int( hashlittle( key.begin(), key.size(), row * 0x9e3779b9 + 1 ) % width );
+	}
+};
+
+#endif
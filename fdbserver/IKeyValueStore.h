@@ -36,9 +36,21 @@ public:
 
 class IKeyValueStore : public IClosable {
 public:
+	// READ_BULK marks a large scan whose pages aren't expected to be read again soon, so a store with a page cache may read
+	// around the cache rather than evict the working set of point reads to make room for it
+	enum ReadType { READ_NORMAL, READ_BULK };
+
 	virtual KeyValueStoreType getType() = 0;
 	virtual void set( KeyValueRef keyValue, const Arena* arena = NULL ) = 0;
 	virtual void clear( KeyRangeRef range, const Arena* arena = NULL ) = 0;
+
+	// Equivalent to set() for each of sortedKeyValues, whose keys must be distinct and ascending.  Stores with a cheaper way to
+	// write a sorted run (such as one queued operation for the whole run) override this.
+	virtual void ingestSorted( VectorRef<KeyValueRef> sortedKeyValues, const Arena* arena = NULL ) {
+		for(auto& kv : sortedKeyValues)
+			set( kv, arena );
+	}
+
 	virtual Future<Void> commit(bool sequential = false) = 0;  // returns when prior sets and clears are (atomically) durable
 
 	virtual Future<Optional<Value>> readValue( KeyRef key, Optional<UID> debugID = Optional<UID>() ) = 0;
@@ -48,7 +60,7 @@ public:
 
 	// If rowLimit>=0, reads first rows sorted ascending, otherwise reads last rows sorted descending
 	// The total size of the returned value (less the last entry) will be less than byteLimit
-	virtual Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30 ) = 0;
+	virtual Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30, ReadType type = READ_NORMAL ) = 0;
 
 	//Returns the amount of free and total space for this store, in bytes
 	virtual StorageBytes getStorageBytes() = 0;
@@ -56,6 +68,12 @@ public:
 	virtual void resyncLog() {}
 
 	virtual void enableSnapshot() {}
+
+	// Whether openSnapshot() is supported
+	virtual bool canOpenSnapshot() { return false; }
+	// Returns a read-only view of the store as of the last call to commit(), which later sets, clears and commits don't change.
+	// The view takes no part in the durability of the store and does not survive its closing.
+	virtual Reference<class IKeyValueSnapshot> openSnapshot();
 	/*
 	Concurrency contract
 		Causal consistency:
@@ -75,8 +93,21 @@ protected:
 	virtual ~IKeyValueStore() {}
 };
 
-extern IKeyValueStore* keyValueStoreSQLite( std::string const& filename, UID logID, KeyValueStoreType storeType, bool checkChecksums=false, bool checkIntegrity=false );
+class IKeyValueSnapshot : public ReferenceCounted<IKeyValueSnapshot> {
+public:
+	virtual Future<Optional<Value>> readValue( KeyRef key ) = 0;
+	// Has the same limits and ordering as IKeyValueStore::readRange()
+	virtual Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30, IKeyValueStore::ReadType type = IKeyValueStore::READ_NORMAL ) = 0;
+
+	virtual ~IKeyValueSnapshot() {}
+};
+
+inline Reference<IKeyValueSnapshot> IKeyValueStore::openSnapshot() { return Reference<IKeyValueSnapshot>(); }
+
+// pageSize only applies if the file has to be created; 0 uses SQLITE_PAGE_SIZE
+extern IKeyValueStore* keyValueStoreSQLite( std::string const& filename, UID logID, KeyValueStoreType storeType, bool checkChecksums=false, bool checkIntegrity=false, int pageSize=0 );
 extern IKeyValueStore* keyValueStoreMemory( std::string const& basename, UID logID, int64_t memoryLimit );
+extern IKeyValueStore* keyValueStoreLSM( std::string const& filename, UID logID );
 extern IKeyValueStore* keyValueStoreLogSystem( class IDiskQueue* queue, UID logID, int64_t memoryLimit, bool disableSnapshot );
 
 inline IKeyValueStore* openKVStore( KeyValueStoreType storeType, std::string const& filename, UID logID, int64_t memoryLimit, bool checkChecksums=false, bool checkIntegrity=false ) {
@@ -87,6 +118,8 @@ inline IKeyValueStore* openKVStore( KeyValueStoreType storeType, std::string con
 		return keyValueStoreSQLite(filename, logID, KeyValueStoreType::SSD_BTREE_V2, checkChecksums, checkIntegrity);
 	case KeyValueStoreType::MEMORY:
 		return keyValueStoreMemory( filename, logID, memoryLimit );
+	case KeyValueStoreType::LSM:
+		return keyValueStoreLSM( filename, logID );
 	default:
 		UNREACHABLE();
 	}
@@ -95,5 +128,6 @@ inline IKeyValueStore* openKVStore( KeyValueStoreType storeType, std::string con
 
 Future<Void> GenerateIOLogChecksumFile(std::string const & filename);
 Future<Void> KVFileCheck(std::string const & filename, bool const &integrity);
+Future<Void> kvBench(std::string const & folder);
 
 #endif
\ No newline at end of file
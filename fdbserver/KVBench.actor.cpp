@@ -0,0 +1,302 @@
+/*
+ * KVBench.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flow/actorcompiler.h"
+#include "IKeyValueStore.h"
+#include "Knobs.h"
+#include "flow/ActorCollection.h"
+#include "flow/Histogram.h"
+
+extern std::string filenameFromId( KeyValueStoreType storeType, std::string folder, std::string prefix, UID id );
+
+// `fdbserver -r kvbench`: opens a storage engine in the data directory, without a cluster, and runs a YCSB-style mix of point
+// reads, scans, sets and clears against it at a target rate.  The engine and the mix are set by the KV_BENCH_* knobs.  Writes
+// are committed every KV_BENCH_COMMIT_INTERVAL, and the latency of a write is the time until the commit holding it is durable.
+// Write amplification is the bytes the process wrote to disk over the key and value bytes it set (and key bytes it cleared);
+// space amplification is the store's size over the bytes of the keys and values in it.
+
+struct KVBenchStats {
+	enum Op { POINT_READ, SCAN, SET, CLEAR, OPS };
+
+	LatencyHistogram latency[OPS];
+	int64_t count[OPS];
+	int64_t dropped;  // Reads not started because KV_BENCH_MAX_OUTSTANDING_READS were outstanding
+	int64_t logicalBytes;
+	int64_t diskBytes;
+
+	KVBenchStats() { clear(); }
+
+	void clear() {
+		for(int op = 0; op < OPS; op++) {
+			latency[op].clear();
+			count[op] = 0;
+		}
+		dropped = logicalBytes = diskBytes = 0;
+	}
+
+	void merge( KVBenchStats const& r ) {
+		for(int op = 0; op < OPS; op++) {
+			latency[op].merge( r.latency[op] );
+			count[op] += r.count[op];
+		}
+		dropped += r.dropped;
+		logicalBytes += r.logicalBytes;
+		diskBytes += r.diskBytes;
+	}
+};
+
+struct KVBench {
+	IKeyValueStore* store;
+	int keyCount, keyBytes, valueBytes;
+	std::vector<bool> present;
+	int64_t liveKeys;
+	Standalone<StringRef> valueBlock;  // Values are substrings of this, so that making them costs nothing
+
+	KVBenchStats stats;  // Since the last report
+	std::vector<std::pair<KVBenchStats::Op, double>> uncommitted;  // Writes since the last commit began, and when they were made
+	IntrusiveActorCollection reads;
+
+	KVBench( IKeyValueStore* store ) : store(store), keyCount(SERVER_KNOBS->KV_BENCH_KEY_COUNT), valueBytes(SERVER_KNOBS->KV_BENCH_VALUE_BYTES), liveKeys(0) {
+		keyBytes = std::max<int>( SERVER_KNOBS->KV_BENCH_KEY_BYTES, format("%d", keyCount).size() );
+		present.resize( keyCount );
+		valueBlock = makeString( 2*valueBytes + 1 );
+		uint8_t* data = mutateString( valueBlock );
+		for(int i = 0; i < valueBlock.size(); i++)
+			data[i] = (uint8_t)g_random->randomInt(0, 256);
+	}
+
+	Key keyFor( int i ) const { return StringRef( format("%0*d", keyBytes, i) ); }
+	int randomKey() const { return std::min<int>( keyCount-1, int( keyCount * pow( g_random->random01(), SERVER_KNOBS->KV_BENCH_KEY_SKEW ) ) ); }
+	ValueRef randomValue() const { return valueBlock.substr( g_random->randomInt(0, valueBytes+1), valueBytes ); }
+
+	void set( int i ) {
+		Key key = keyFor(i);
+		store->set( KeyValueRef( key, randomValue() ) );
+		if( !present[i] ) {
+			present[i] = true;
+			liveKeys++;
+		}
+		stats.logicalBytes += key.size() + valueBytes;
+	}
+
+	void clear( int i ) {
+		Key key = keyFor(i);
+		store->clear( singleKeyRange(key) );
+		if( present[i] ) {
+			present[i] = false;
+			liveKeys--;
+		}
+		stats.logicalBytes += key.size();
+	}
+
+	void report( const char* name, KVBenchStats const& s, double elapsed ) {
+		static const char* opNames[KVBenchStats::OPS] = { "PointRead", "Scan", "Set", "Clear" };
+		elapsed = std::max( elapsed, 1e-9 );
+		TraceEvent ev("KVBenchReport");
+		ev.detail("Name", name).detail("Elapsed", elapsed);
+		fprintf( stderr, "%s (%.1f sec):\n", name, elapsed );
+		for(int op = 0; op < KVBenchStats::OPS; op++) {
+			if( !s.count[op] )
+				continue;
+			LatencyHistogram const& l = s.latency[op];
+			fprintf( stderr, "  %-10s %9.0f ops/sec, latency us p50 %.0f p90 %.0f p99 %.0f max %.0f\n", opNames[op], s.count[op] / elapsed,
+				1e6*l.percentile(0.5), 1e6*l.percentile(0.9), 1e6*l.percentile(0.99), 1e6*l.max() );
+			ev.detail(format("%sRate", opNames[op]).c_str(), s.count[op] / elapsed).detail(format("%sLatencyP50", opNames[op]).c_str(), l.percentile(0.5))
+				.detail(format("%sLatencyP99", opNames[op]).c_str(), l.percentile(0.99)).detail(format("%sLatencyMax", opNames[op]).c_str(), l.max());
+		}
+
+		int64_t used = store->getStorageBytes().used;
+		int64_t liveBytes = liveKeys * (keyBytes + valueBytes);
+		double writeAmp = s.logicalBytes ? double(s.diskBytes) / s.logicalBytes : 0;
+		double spaceAmp = liveBytes ? double(used) / liveBytes : 0;
+		fprintf( stderr, "  %.2f MB/sec written to disk, write amplification %.2f, %lld keys in %.1f MB, space amplification %.2f",
+			s.diskBytes / elapsed / 1e6, writeAmp, (long long)liveKeys, used / 1e6, spaceAmp );
+		if( s.dropped )
+			fprintf( stderr, ", %lld reads dropped", (long long)s.dropped );
+		fprintf( stderr, "\n" );
+		ev.detail("DiskBytesWritten", s.diskBytes).detail("LogicalBytesWritten", s.logicalBytes).detail("WriteAmplification", writeAmp)
+			.detail("Keys", liveKeys).detail("StorageBytesUsed", used).detail("SpaceAmplification", spaceAmp).detail("DroppedReads", s.dropped);
+	}
+};
+
+ACTOR Future<Void> kvBenchPointRead( KVBench* b, int i ) {
+	state double start = timer_monotonic();
+	Optional<Value> v = wait( b->store->readValue( b->keyFor(i) ) );
+	b->stats.latency[KVBenchStats::POINT_READ].record( timer_monotonic() - start );
+	b->stats.count[KVBenchStats::POINT_READ]++;
+	return Void();
+}
+
+ACTOR Future<Void> kvBenchScan( KVBench* b, int i ) {
+	state double start = timer_monotonic();
+	Standalone<VectorRef<KeyValueRef>> rows = wait( b->store->readRange( KeyRangeRef( b->keyFor(i), LiteralStringRef("\xff") ), SERVER_KNOBS->KV_BENCH_SCAN_ROWS ) );
+	b->stats.latency[KVBenchStats::SCAN].record( timer_monotonic() - start );
+	b->stats.count[KVBenchStats::SCAN]++;
+	return Void();
+}
+
+ACTOR Future<Void> kvBenchCommit( KVBench* b ) {
+	state std::vector<std::pair<KVBenchStats::Op, double>> writes;
+	std::swap( writes, b->uncommitted );
+	Void _ = wait( b->store->commit() );
+	double end = timer_monotonic();
+	for(auto& w : writes) {
+		b->stats.latency[w.first].record( end - w.second );
+		b->stats.count[w.first]++;
+	}
+	return Void();
+}
+
+// Finds the keys already in the store, or loads KV_BENCH_KEY_COUNT of them if it is empty
+ACTOR Future<Void> kvBenchLoad( KVBench* b ) {
+	state double start = timer_monotonic();
+	state int64_t diskBytes = g_network->diskLatencyProfile.bytesWritten;
+	state Key begin = b->keyFor(0);
+	loop {
+		Standalone<VectorRef<KeyValueRef>> rows = wait( b->store->readRange( KeyRangeRef( begin, LiteralStringRef("\xff") ), 10000 ) );
+		for(auto& kv : rows) {
+			int i = atoi( kv.key.toString().c_str() );
+			if( i >= 0 && i < b->keyCount && !b->present[i] ) {
+				b->present[i] = true;
+				b->liveKeys++;
+			}
+		}
+		if( rows.size() < 10000 )
+			break;
+		begin = keyAfter( rows.back().key );
+	}
+	if( b->liveKeys ) {
+		fprintf( stderr, "Found %lld keys in %.1f sec\n", (long long)b->liveKeys, timer_monotonic() - start );
+		return Void();
+	}
+
+	state int i = 0;
+	for(; i < b->keyCount; i++) {
+		b->set(i);
+		if( i % 10000 == 9999 ) {
+			Void _ = wait( b->store->commit() );
+		}
+	}
+	Void _ = wait( b->store->commit() );
+	b->stats.diskBytes = g_network->diskLatencyProfile.bytesWritten - diskBytes;
+	b->report( "load", b->stats, timer_monotonic() - start );
+	b->stats.clear();
+	return Void();
+}
+
+ACTOR Future<Void> kvBenchRun( KVBench* b ) {
+	state double start = timer_monotonic();
+	state double reportStart = start;
+	state int64_t reportDiskBytes = g_network->diskLatencyProfile.bytesWritten;
+	state double lastCommit = start;
+	state double nextOp = start;
+	state Future<Void> commit = Void();
+	state KVBenchStats total;
+
+	loop {
+		state double t = timer_monotonic();
+		if( t - start >= SERVER_KNOBS->KV_BENCH_DURATION )
+			break;
+
+		// Open loop: operations are due at the target rate whether or not earlier ones have finished
+		for(; nextOp <= t; nextOp += 1.0 / SERVER_KNOBS->KV_BENCH_OPERATIONS_PER_SECOND) {
+			double r = g_random->random01();
+			if( r < SERVER_KNOBS->KV_BENCH_READ_FRACTION + SERVER_KNOBS->KV_BENCH_SCAN_FRACTION ) {
+				if( b->reads.size() >= SERVER_KNOBS->KV_BENCH_MAX_OUTSTANDING_READS )
+					b->stats.dropped++;
+				else if( r < SERVER_KNOBS->KV_BENCH_READ_FRACTION )
+					b->reads.add( kvBenchPointRead( b, b->randomKey() ) );
+				else
+					b->reads.add( kvBenchScan( b, b->randomKey() ) );
+			} else if( r < SERVER_KNOBS->KV_BENCH_READ_FRACTION + SERVER_KNOBS->KV_BENCH_SCAN_FRACTION + SERVER_KNOBS->KV_BENCH_CLEAR_FRACTION ) {
+				b->clear( b->randomKey() );
+				b->uncommitted.push_back( std::make_pair( KVBenchStats::CLEAR, t ) );
+			} else {
+				b->set( b->randomKey() );
+				b->uncommitted.push_back( std::make_pair( KVBenchStats::SET, t ) );
+			}
+		}
+
+		if( commit.isReady() && t - lastCommit >= SERVER_KNOBS->KV_BENCH_COMMIT_INTERVAL && b->uncommitted.size() ) {
+			commit.get();  // Throws if the last commit failed
+			lastCommit = t;
+			commit = kvBenchCommit( b );
+		}
+
+		if( t - reportStart >= SERVER_KNOBS->KV_BENCH_REPORT_INTERVAL ) {
+			int64_t diskBytes = g_network->diskLatencyProfile.bytesWritten;
+			b->stats.diskBytes = diskBytes - reportDiskBytes;
+			b->report( "interval", b->stats, t - reportStart );
+			total.merge( b->stats );
+			b->stats.clear();
+			reportStart = t;
+			reportDiskBytes = diskBytes;
+		}
+
+		choose {
+			when( Void _ = wait( delay( std::max( 0.0, std::min( nextOp, lastCommit + SERVER_KNOBS->KV_BENCH_COMMIT_INTERVAL ) - timer_monotonic() ) ) ) ) {}
+			when( Void _ = wait( b->reads.getResult() ) ) {}
+		}
+	}
+
+	while( b->reads.size() ) {
+		Void _ = wait( delay( 0.01 ) );
+	}
+	Void _ = wait( commit );
+	Void _ = wait( kvBenchCommit( b ) );
+
+	b->stats.diskBytes = g_network->diskLatencyProfile.bytesWritten - reportDiskBytes;
+	total.merge( b->stats );
+	b->report( "total", total, timer_monotonic() - start );
+	return Void();
+}
+
+static KeyValueStoreType kvBenchStoreType( std::string const& name ) {
+	for(int t = 0; t < KeyValueStoreType::END; t++)
+		if( KeyValueStoreType( KeyValueStoreType::StoreType(t) ).toString() == name )
+			return KeyValueStoreType::StoreType(t);
+	fprintf( stderr, "ERROR: Unknown KV_BENCH_STORE_TYPE `%s'\n", name.c_str() );
+	throw invalid_option_value();
+}
+
+ACTOR Future<Void> kvBench( std::string folder ) {
+	state KeyValueStoreType storeType = kvBenchStoreType( SERVER_KNOBS->KV_BENCH_STORE_TYPE );
+	// The same file every time, so that a benchmark can be rerun against the data an earlier one loaded
+	state std::string filename = filenameFromId( storeType, folder, "kvbench-", UID() );
+	state IKeyValueStore* store = openKVStore( storeType, filename, g_random->randomUniqueID(), SERVER_KNOBS->KV_BENCH_MEMORY_LIMIT );
+	state KVBench* bench = new KVBench( store );
+	state Error err = success();
+
+	fprintf( stderr, "Benchmarking %s store %s\n", storeType.toString().c_str(), filename.c_str() );
+	try {
+		Void _ = wait( kvBenchLoad( bench ) );
+		Void _ = wait( kvBenchRun( bench ) );
+	} catch( Error& e ) {
+		err = e;
+	}
+	delete bench;
+
+	state Future<Void> closed = store->onClosed();
+	store->close();
+	Void _ = wait( closed );
+	if( err.code() != error_code_success )
+		throw err;
+	return Void();
+}
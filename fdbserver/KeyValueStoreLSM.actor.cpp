@@ -0,0 +1,1810 @@
+/*
+ * KeyValueStoreLSM.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flow/actorcompiler.h"
+#include "IKeyValueStore.h"
+#include "IDiskQueue.h"
+#include "Knobs.h"
+#include "flow/Hash3.h"
+#include "flow/UnitTest.h"
+#include "fdbrpc/IAsyncFile.h"
+#include <deque>
+#include <list>
+
+// A log-structured merge tree.  Committed mutations are applied to an in-memory table (the memtable) and logged to a
+// DiskQueue.  Once the memtable is large enough it is frozen and written out as an immutable sorted table in level 0,
+// after which its log is popped.  Tables in level 0 may overlap one another; tables in every deeper level are sorted
+// and disjoint, and each level is LSM_LEVEL_SIZE_MULTIPLIER times larger than the one above.  A single background actor
+// merges tables down the levels and (with priority) flushes frozen memtables.
+//
+// Every layer (the memtable or a table) holds point values and cleared ranges.  A layer's points take precedence over its
+// own cleared ranges, and its cleared ranges hide any data in older layers.  Clears are dropped when they reach the
+// bottom level.
+//
+// Files, for a store named B:
+//   B                 manifest listing the live tables, rewritten atomically after every flush or compaction
+//   B-log0.fdq, -log1 DiskQueue holding mutations not yet flushed to a table
+//   B-########.sst    tables: prefix compressed data blocks followed by a meta region holding the block index, bloom
+//                     filter and clears
+
+static const uint32_t LSM_FORMAT_VERSION = 1;
+static const int LSM_PAGE_SIZE = 4096;
+static const int LSM_MEMTABLE_ENTRY_OVERHEAD = 64;  // rough per-entry cost of a std::map node holding a Key and Value
+
+static uint32_t lsmChecksum( const void* data, int length ) {
+	return hashlittle( data, length, 0 );
+}
+
+// Returns the index of the first entry with a key >= key
+static int lsmLowerBound( VectorRef<KeyValueRef> const& data, KeyRef key ) {
+	int lo = 0, hi = data.size();
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (data[mid].key < key) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+// Returns the range in the sorted, disjoint ranges which contains key
+static Optional<KeyRangeRef> lsmFindClear( VectorRef<KeyRangeRef> const& clears, KeyRef key ) {
+	int lo = 0, hi = clears.size();
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (clears[mid].begin <= key) lo = mid + 1;
+		else hi = mid;
+	}
+	if (lo > 0 && key < clears[lo-1].end)
+		return clears[lo-1];
+	return Optional<KeyRangeRef>();
+}
+
+// Sorted, coalesced set of cleared ranges belonging to a memtable or compaction
+struct LSMClearSet {
+	std::map<Key, Key> ranges;  // begin -> end
+
+	bool empty() const { return ranges.empty(); }
+
+	void add( KeyRangeRef range ) {
+		if (range.empty()) return;
+		Key begin = range.begin, end = range.end;
+		auto it = ranges.upper_bound( begin );
+		if (it != ranges.begin()) {
+			auto prev = it;
+			--prev;
+			if (prev->second >= begin) {
+				begin = prev->first;
+				if (prev->second > end) end = prev->second;
+				it = prev;
+			}
+		}
+		while (it != ranges.end() && it->first <= end) {
+			if (it->second > end) end = it->second;
+			ranges.erase(it++);
+		}
+		ranges[begin] = end;
+	}
+
+	void add( VectorRef<KeyRangeRef> const& clears ) {
+		for(auto& r : clears)
+			add(r);
+	}
+
+	Optional<KeyRangeRef> find( KeyRef key ) const {
+		auto it = ranges.upper_bound( key );
+		if (it == ranges.begin()) return Optional<KeyRangeRef>();
+		--it;
+		if (key < it->second) return KeyRangeRef( it->first, it->second );
+		return Optional<KeyRangeRef>();
+	}
+
+	// The cleared ranges intersecting keys, clipped to keys
+	Standalone<VectorRef<KeyRangeRef>> get( KeyRangeRef keys ) const {
+		Standalone<VectorRef<KeyRangeRef>> result;
+		auto it = ranges.upper_bound( keys.begin );
+		if (it != ranges.begin()) --it;
+		for(; it != ranges.end() && it->first < keys.end; ++it) {
+			if (it->second <= keys.begin) continue;
+			result.push_back_deep( result.arena(), keys & KeyRangeRef( it->first, it->second ) );
+		}
+		return result;
+	}
+};
+
+struct LSMBloomFilter {
+	// A filter is a bit array followed by a single byte holding the number of probes.  An empty filter matches every key.
+	static void hash( KeyRef key, uint32_t& h1, uint32_t& h2 ) {
+		h1 = 0;
+		h2 = 0x9e3779b9;
+		hashlittle2( key.begin(), key.size(), &h1, &h2 );
+	}
+
+	static bool mayContain( StringRef filter, KeyRef key ) {
+		if (filter.size() < 2) return true;
+		int probes = filter[filter.size()-1];
+		uint32_t bits = (filter.size()-1) * 8;
+		uint32_t h1, h2;
+		hash( key, h1, h2 );
+		for(int i = 0; i < probes; i++) {
+			uint32_t bit = (h1 + i*h2) % bits;
+			if (!(filter[bit/8] & (1<<(bit%8))))
+				return false;
+		}
+		return true;
+	}
+
+	std::vector<std::pair<uint32_t, uint32_t>> hashes;
+
+	void add( KeyRef key ) {
+		uint32_t h1, h2;
+		hash( key, h1, h2 );
+		hashes.push_back( std::make_pair(h1, h2) );
+	}
+
+	Standalone<StringRef> finish( int bitsPerKey ) const {
+		if (bitsPerKey <= 0 || hashes.empty()) return Standalone<StringRef>();
+		int probes = std::max( 1, std::min( 30, int(bitsPerKey * 0.69) ) );  // ln(2) * bits per key minimizes false positives
+		uint32_t bits = std::max<int64_t>( 64, int64_t(hashes.size()) * bitsPerKey );
+		bits = (bits + 7) / 8 * 8;
+
+		Standalone<StringRef> filter = makeString( bits/8 + 1 );
+		uint8_t* data = mutateString( filter );
+		memset( data, 0, bits/8 );
+		data[bits/8] = probes;
+		for(auto& h : hashes) {
+			for(int i = 0; i < probes; i++) {
+				uint32_t bit = (h.first + i*h.second) % bits;
+				data[bit/8] |= 1<<(bit%8);
+			}
+		}
+		return filter;
+	}
+};
+
+static void lsmPutVarint( std::vector<uint8_t>& out, uint32_t v ) {
+	while (v >= 0x80) {
+		out.push_back( (v & 0x7f) | 0x80 );
+		v >>= 7;
+	}
+	out.push_back( v );
+}
+
+static uint32_t lsmGetVarint( const uint8_t*& p, const uint8_t* end ) {
+	uint32_t v = 0;
+	for(int shift = 0; shift < 35; shift += 7) {
+		if (p == end) throw file_corrupt();
+		uint8_t b = *p++;
+		v |= uint32_t(b & 0x7f) << shift;
+		if (!(b & 0x80)) return v;
+	}
+	throw file_corrupt();
+}
+
+// Keys within a block are prefix compressed against the preceding key.  Every LSM_BLOCK_RESTART_INTERVAL entries a
+// restart point stores its key in full, so that a lookup can binary search the restart points and decode forward from
+// just one of them.
+//   entry:   varint shared prefix length, varint suffix length, varint value length, key suffix, value
+//   trailer: uint32 offset of each restart point, uint32 restart point count
+struct LSMBlockBuilder {
+	std::vector<uint8_t> data;
+	std::vector<uint32_t> restarts;
+	std::string lastKey;
+	int count;
+	int restartInterval;
+
+	explicit LSMBlockBuilder( int restartInterval ) : count(0), restartInterval(std::max( 1, restartInterval )) {}
+
+	bool empty() const { return count == 0; }
+	int size() const { return data.size() + (restarts.size() + 1) * sizeof(uint32_t); }
+
+	void add( KeyValueRef kv ) {
+		int shared = 0;
+		if (count % restartInterval == 0) {
+			restarts.push_back( data.size() );
+		} else {
+			int limit = std::min<int>( kv.key.size(), lastKey.size() );
+			while (shared < limit && kv.key[shared] == (uint8_t)lastKey[shared])
+				shared++;
+		}
+		lsmPutVarint( data, shared );
+		lsmPutVarint( data, kv.key.size() - shared );
+		lsmPutVarint( data, kv.value.size() );
+		data.insert( data.end(), kv.key.begin() + shared, kv.key.end() );
+		data.insert( data.end(), kv.value.begin(), kv.value.end() );
+		lastKey.assign( (const char*)kv.key.begin(), kv.key.size() );
+		count++;
+	}
+
+	// Appends the trailer and returns the finished block, which is valid until reset()
+	StringRef finish() {
+		for(uint32_t r : restarts)
+			data.insert( data.end(), (const uint8_t*)&r, (const uint8_t*)(&r + 1) );
+		uint32_t n = restarts.size();
+		data.insert( data.end(), (const uint8_t*)&n, (const uint8_t*)(&n + 1) );
+		return StringRef( &data[0], data.size() );
+	}
+
+	void reset() {
+		data.clear();
+		restarts.clear();
+		lastKey.clear();
+		count = 0;
+	}
+};
+
+struct LSMBlockReader {
+	const uint8_t* begin;
+	const uint8_t* entriesEnd;
+	int restartCount;
+
+	explicit LSMBlockReader( StringRef block ) : begin(block.begin()) {
+		uint32_t n;
+		if (block.size() < sizeof(n)) throw file_corrupt();
+		memcpy( &n, block.end() - sizeof(n), sizeof(n) );
+		if (n == 0 || n > (block.size() - sizeof(n)) / sizeof(uint32_t)) throw file_corrupt();
+		restartCount = n;
+		entriesEnd = block.end() - sizeof(n) - n * sizeof(uint32_t);
+	}
+
+	const uint8_t* restart( int i ) const {
+		uint32_t r;
+		memcpy( &r, entriesEnd + i * sizeof(uint32_t), sizeof(r) );
+		if (begin + r >= entriesEnd) throw file_corrupt();
+		return begin + r;
+	}
+
+	bool atEnd( const uint8_t* p ) const { return p == entriesEnd; }
+
+	// Decodes the entry at p, replacing key (which holds the preceding key) with the entry's key, and returns the next entry
+	const uint8_t* next( const uint8_t* p, std::string& key, StringRef& value ) const {
+		uint32_t shared = lsmGetVarint( p, entriesEnd );
+		uint32_t unshared = lsmGetVarint( p, entriesEnd );
+		uint32_t valueLength = lsmGetVarint( p, entriesEnd );
+		if (shared > key.size() || unshared + valueLength > entriesEnd - p) throw file_corrupt();
+		key.resize( shared );
+		key.append( (const char*)p, unshared );
+		value = StringRef( p + unshared, valueLength );
+		return p + unshared + valueLength;
+	}
+
+	// Returns the value of key, which points into the block
+	Optional<StringRef> find( KeyRef key ) const {
+		// Find the last restart point whose key is <= key
+		std::string k;
+		StringRef value;
+		int lo = 0, hi = restartCount;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			k.clear();
+			next( restart( mid ), k, value );
+			if (StringRef(k) <= key) lo = mid + 1;
+			else hi = mid;
+		}
+		if (lo == 0) return Optional<StringRef>();
+
+		k.clear();
+		for(const uint8_t* p = restart( lo - 1 ); !atEnd( p ); ) {
+			p = next( p, k, value );
+			int c = StringRef(k).compare( key );
+			if (c == 0) return value;
+			if (c > 0) break;
+		}
+		return Optional<StringRef>();
+	}
+};
+
+// Decodes every entry of a block.  Values refer to the block's memory.
+static Standalone<VectorRef<KeyValueRef>> lsmDecodeBlock( Standalone<StringRef> block ) {
+	LSMBlockReader reader( block );
+	Standalone<VectorRef<KeyValueRef>> result;
+	result.arena().dependsOn( block.arena() );
+	std::string k;
+	StringRef value;
+	for(const uint8_t* p = reader.begin; !reader.atEnd( p ); ) {
+		p = reader.next( p, k, value );
+		result.push_back( result.arena(), KeyValueRef( StringRef( result.arena(), StringRef(k) ), value ) );
+	}
+	return result;
+}
+
+struct LSMBlockHandle {
+	Key firstKey;
+	int64_t offset;
+	int size;
+	uint32_t checksum;
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & firstKey & offset & size & checksum;
+	}
+};
+
+// Describes a table in the manifest
+struct LSMTableInfo {
+	int64_t number;
+	int level;
+	Key begin, end;  // every point and clear in the table lies within [begin, end)
+	int64_t fileSize;
+	int64_t metaOffset;
+	int metaSize;
+	uint32_t metaChecksum;
+
+	LSMTableInfo() : number(0), level(0), fileSize(0), metaOffset(0), metaSize(0), metaChecksum(0) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		ar & number & level & begin & end & fileSize & metaOffset & metaSize & metaChecksum;
+	}
+};
+
+struct LSMTable : ReferenceCounted<LSMTable>, NonCopyable {
+	LSMTableInfo info;
+	std::string filename;
+	Reference<IAsyncFile> file;
+	std::vector<LSMBlockHandle> blocks;
+	Standalone<StringRef> bloom;
+	Standalone<VectorRef<KeyRangeRef>> clears;
+
+	LSMTable( LSMTableInfo const& info, std::string const& filename, Reference<IAsyncFile> file ) : info(info), filename(filename), file(file) {}
+
+	KeyRangeRef range() const { return KeyRangeRef( info.begin, info.end ); }
+	bool contains( KeyRef key ) const { return info.begin <= key && key < info.end; }
+	bool intersects( KeyRangeRef keys ) const { return info.begin < keys.end && keys.begin < info.end; }
+
+	// Returns the last block whose first key is <= key, or -1 if key precedes every block
+	int findBlock( KeyRef key ) const {
+		int lo = 0, hi = blocks.size();
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (blocks[mid].firstKey <= key) lo = mid + 1;
+			else hi = mid;
+		}
+		return lo - 1;
+	}
+};
+
+// Returns the index of the first of the sorted, disjoint tables which ends after key
+static int lsmFindTable( std::vector<Reference<LSMTable>> const& tables, KeyRef key ) {
+	int lo = 0, hi = tables.size();
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (tables[mid]->info.end <= key) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+// An immutable snapshot of the tables in each level.  Level 0 is ordered newest first; deeper levels are ordered by key.
+struct LSMTree : ReferenceCounted<LSMTree>, NonCopyable {
+	std::vector<std::vector<Reference<LSMTable>>> levels;
+
+	Reference<LSMTree> clone() const {
+		Reference<LSMTree> t( new LSMTree );
+		t->levels = levels;
+		return t;
+	}
+
+	int64_t levelBytes( int level ) const {
+		int64_t bytes = 0;
+		for(auto& t : levels[level])
+			bytes += t->info.fileSize;
+		return bytes;
+	}
+};
+
+struct LSMMemTable : ReferenceCounted<LSMMemTable>, NonCopyable {
+	std::map<Key, Value> points;
+	LSMClearSet clears;
+	int64_t bytes;
+	IDiskQueue::location logEnd;  // the end of the last commit applied to this memtable
+	Future<Void> committed;        // ready when that commit is durable
+
+	LSMMemTable() : bytes(0), committed(Void()) {}
+
+	bool empty() const { return points.empty() && clears.empty(); }
+
+	void set( KeyValueRef kv ) {
+		auto it = points.find( kv.key );
+		if (it != points.end()) {
+			bytes += kv.value.size() - it->second.size();
+			it->second = Value( kv.value );
+		} else {
+			points[kv.key] = kv.value;
+			bytes += kv.key.size() + kv.value.size() + LSM_MEMTABLE_ENTRY_OVERHEAD;
+		}
+	}
+
+	void clear( KeyRangeRef range ) {
+		if (range.empty()) return;
+		auto begin = points.lower_bound( range.begin );
+		auto end = points.lower_bound( range.end );
+		for(auto it = begin; it != end; ++it)
+			bytes -= it->first.size() + it->second.size() + LSM_MEMTABLE_ENTRY_OVERHEAD;
+		points.erase( begin, end );
+		clears.add( range );
+		bytes += range.begin.size() + range.end.size() + LSM_MEMTABLE_ENTRY_OVERHEAD;
+	}
+
+	// Returns the value of key if this memtable determines it (as a set or a clear), or an empty optional if older layers must be read
+	Optional<Optional<Value>> get( KeyRef key ) const {
+		auto it = points.find( key );
+		if (it != points.end()) return Optional<Value>( it->second );
+		if (clears.find( key ).present()) return Optional<Value>();
+		return Optional<Optional<Value>>();
+	}
+
+	KeyRange range() const {
+		ASSERT( !empty() );
+		Key begin, end;
+		if (points.size()) {
+			begin = points.begin()->first;
+			end = keyAfter( points.rbegin()->first );
+		}
+		if (!clears.empty()) {
+			if (!points.size() || clears.ranges.begin()->first < begin) begin = clears.ranges.begin()->first;
+			if (!points.size() || clears.ranges.rbegin()->second > end) end = clears.ranges.rbegin()->second;
+		}
+		return KeyRangeRef( begin, end );
+	}
+};
+
+// LRU cache of decoded table blocks
+struct LSMBlockCache : ReferenceCounted<LSMBlockCache>, NonCopyable {
+	typedef std::pair<int64_t, int> BlockID;  // table number, block index
+	struct Entry {
+		BlockID id;
+		Standalone<StringRef> data;  // still prefix compressed
+		int64_t bytes;
+	};
+
+	std::list<Entry> lru;  // most recently used first
+	std::map<BlockID, std::list<Entry>::iterator> index;
+	int64_t bytes, capacity;
+
+	explicit LSMBlockCache( int64_t capacity ) : bytes(0), capacity(capacity) {}
+
+	Optional<Standalone<StringRef>> get( BlockID id ) {
+		auto it = index.find( id );
+		if (it == index.end()) return Optional<Standalone<StringRef>>();
+		lru.splice( lru.begin(), lru, it->second );
+		return it->second->data;
+	}
+
+	void insert( BlockID id, Standalone<StringRef> data ) {
+		if (capacity <= 0 || index.count( id )) return;
+		Entry e;
+		e.id = id;
+		e.data = data;
+		e.bytes = data.size() + sizeof(Entry);
+		lru.push_front( e );
+		index[id] = lru.begin();
+		bytes += e.bytes;
+		while (bytes > capacity && lru.size() > 1) {
+			bytes -= lru.back().bytes;
+			index.erase( lru.back().id );
+			lru.pop_back();
+		}
+	}
+
+	// Drops every block of the given table
+	void erase( int64_t number ) {
+		auto it = index.lower_bound( BlockID( number, 0 ) );
+		while (it != index.end() && it->first.first == number) {
+			bytes -= it->second->bytes;
+			lru.erase( it->second );
+			index.erase( it++ );
+		}
+	}
+};
+
+ACTOR static Future<Standalone<StringRef>> lsmReadAligned( Reference<IAsyncFile> file, int64_t offset, int length ) {
+	state int64_t begin = offset & ~int64_t(LSM_PAGE_SIZE-1);
+	state int alignedLength = ((offset + length + LSM_PAGE_SIZE - 1) & ~int64_t(LSM_PAGE_SIZE-1)) - begin;
+	state void* buffer = aligned_alloc( LSM_PAGE_SIZE, alignedLength );
+	try {
+		int readBytes = wait( file->read( buffer, alignedLength, begin ) );
+		if (readBytes < offset - begin + length)
+			throw file_corrupt();
+		Standalone<StringRef> result( StringRef( (const uint8_t*)buffer + (offset - begin), length ) );
+		aligned_free( buffer );
+		return result;
+	} catch (Error& e) {
+		aligned_free( buffer );
+		throw;
+	}
+}
+
+ACTOR static Future<Standalone<StringRef>> lsmReadBlockFromDisk( Reference<LSMBlockCache> cache, Reference<LSMTable> table, int block, bool fillCache ) {
+	state LSMBlockHandle handle = table->blocks[block];
+	Standalone<StringRef> data = wait( lsmReadAligned( table->file, handle.offset, handle.size ) );
+	if (lsmChecksum( data.begin(), data.size() ) != handle.checksum) {
+		TraceEvent(SevError, "LSMBlockChecksumMismatch").detail("Filename", table->filename).detail("Block", block).detail("Offset", handle.offset);
+		throw checksum_failed();
+	}
+	if (fillCache)
+		cache->insert( LSMBlockCache::BlockID( table->info.number, block ), data );
+	return data;
+}
+
+static Future<Standalone<StringRef>> lsmReadBlock( Reference<LSMBlockCache> cache, Reference<LSMTable> table, int block, bool fillCache ) {
+	auto cached = cache->get( LSMBlockCache::BlockID( table->info.number, block ) );
+	if (cached.present()) return cached.get();
+	return lsmReadBlockFromDisk( cache, table, block, fillCache );
+}
+
+// Builds a table file.  Blocks are staged in page aligned chunks which are written out by drain() as they fill.
+struct LSMTableWriter : ReferenceCounted<LSMTableWriter>, NonCopyable {
+	struct Chunk {
+		uint8_t* buffer;
+		int length;
+		int64_t offset;
+	};
+
+	std::string filename;
+	Reference<IAsyncFile> file;
+	LSMTableInfo info;
+	std::vector<LSMBlockHandle> handles;
+	LSMBloomFilter bloom;
+
+	LSMBlockBuilder block;
+
+	int chunkSize;
+	uint8_t* chunk;
+	int chunkUsed;
+	int64_t chunkOffset;
+	std::deque<Chunk> ready;  // full chunks waiting to be written
+	int64_t offset;           // bytes appended so far
+
+	LSMTableWriter( std::string const& filename, int64_t number, int level )
+		: filename(filename), block(SERVER_KNOBS->LSM_BLOCK_RESTART_INTERVAL), chunkSize(SERVER_KNOBS->LSM_WRITE_CHUNK_BYTES), chunkUsed(0), chunkOffset(0), offset(0)
+	{
+		info.number = number;
+		info.level = level;
+		chunk = (uint8_t*)aligned_alloc( LSM_PAGE_SIZE, chunkSize );
+	}
+	~LSMTableWriter() {
+		if (chunk) aligned_free( chunk );
+		for(auto& c : ready)
+			aligned_free( c.buffer );
+	}
+
+	int64_t estimatedSize() const { return offset + block.size(); }
+	bool needsDrain() const { return !ready.empty(); }
+
+	void add( KeyValueRef kv ) {
+		if (block.empty()) {
+			LSMBlockHandle h;
+			h.firstKey = kv.key;
+			handles.push_back( h );
+		}
+		block.add( kv );
+		bloom.add( kv.key );
+		if (block.size() >= SERVER_KNOBS->LSM_BLOCK_BYTES)
+			finishBlock();
+	}
+
+	void finishBlock() {
+		if (block.empty()) return;
+		StringRef data = block.finish();
+		LSMBlockHandle& h = handles.back();
+		h.offset = offset;
+		h.size = data.size();
+		h.checksum = lsmChecksum( data.begin(), data.size() );
+		append( data.begin(), data.size() );
+		block.reset();
+	}
+
+	void append( const uint8_t* data, int length ) {
+		while (length) {
+			int n = std::min( length, chunkSize - chunkUsed );
+			memcpy( chunk + chunkUsed, data, n );
+			chunkUsed += n;
+			data += n;
+			length -= n;
+			offset += n;
+			if (chunkUsed == chunkSize) {
+				Chunk c = { chunk, chunkSize, chunkOffset };
+				ready.push_back( c );
+				chunk = (uint8_t*)aligned_alloc( LSM_PAGE_SIZE, chunkSize );
+				chunkOffset += chunkSize;
+				chunkUsed = 0;
+			}
+		}
+	}
+
+	// Pads the last chunk to a page boundary and queues it; nothing may be appended afterwards
+	void finishChunk() {
+		int length = (chunkUsed + LSM_PAGE_SIZE - 1) & ~(LSM_PAGE_SIZE-1);
+		memset( chunk + chunkUsed, 0, length - chunkUsed );
+		if (length) {
+			Chunk c = { chunk, length, chunkOffset };
+			ready.push_back( c );
+		} else {
+			aligned_free( chunk );
+		}
+		chunk = NULL;
+		info.fileSize = chunkOffset + length;
+	}
+
+	ACTOR static Future<Void> drain( Reference<LSMTableWriter> self ) {
+		if (!self->file) {
+			Reference<IAsyncFile> f = wait( IAsyncFileSystem::filesystem()->open( self->filename,
+				IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED, 0600 ) );
+			self->file = f;
+		}
+		while (!self->ready.empty()) {
+			Void _ = wait( self->file->write( self->ready.front().buffer, self->ready.front().length, self->ready.front().offset ) );
+			aligned_free( self->ready.front().buffer );
+			self->ready.pop_front();
+		}
+		return Void();
+	}
+
+	// Writes out the meta region, syncs the file (which moves it into place) and returns the finished table.
+	// clears must already be clipped to range.
+	ACTOR static Future<Reference<LSMTable>> finish( Reference<LSMTableWriter> self, KeyRange range, Standalone<VectorRef<KeyRangeRef>> clears ) {
+		self->finishBlock();
+		state Standalone<StringRef> bloom = self->bloom.finish( SERVER_KNOBS->LSM_BLOOM_BITS_PER_KEY );
+		{
+			BinaryWriter meta( IncludeVersion() );
+			meta << self->handles << bloom << clears;
+			self->info.metaOffset = self->offset;
+			self->info.metaSize = meta.getLength();
+			self->info.metaChecksum = lsmChecksum( meta.getData(), meta.getLength() );
+			self->append( (const uint8_t*)meta.getData(), meta.getLength() );
+		}
+		self->finishChunk();
+		self->info.begin = range.begin;
+		self->info.end = range.end;
+
+		Void _ = wait( drain( self ) );
+		Void _ = wait( self->file->sync() );
+
+		Reference<LSMTable> table( new LSMTable( self->info, self->filename, self->file ) );
+		table->blocks.swap( self->handles );
+		table->bloom = bloom;
+		table->clears = clears;
+		return table;
+	}
+};
+
+// One source of a merge: an in-memory layer, or a set of sorted, disjoint tables
+struct LSMRun {
+	bool inMemory;
+	Standalone<VectorRef<KeyValueRef>> points;  // for an in-memory run
+	Standalone<VectorRef<KeyRangeRef>> clears;  // for an in-memory run
+	std::vector<Reference<LSMTable>> tables;
+
+	LSMRun() : inMemory(false) {}
+
+	Optional<KeyRangeRef> findClear( KeyRef key ) const {
+		if (inMemory) return lsmFindClear( clears, key );
+		int t = lsmFindTable( tables, key );
+		if (t < tables.size() && tables[t]->contains( key ))
+			return lsmFindClear( tables[t]->clears, key );
+		return Optional<KeyRangeRef>();
+	}
+};
+
+struct LSMCursor {
+	Standalone<VectorRef<KeyValueRef>> data;
+	int pos;
+	int table, block;
+	bool needLoad, done, seeking;
+	Key seekKey;
+
+	LSMCursor() : pos(0), table(0), block(0), needLoad(false), done(true), seeking(false) {}
+
+	KeyRef key() const { return data[pos].key; }
+};
+
+// Merges runs ordered newest first, in either direction, yielding the visible entries within keys.  When a newer run
+// clears the key under an older cursor, every older cursor skips over the cleared range.
+struct LSMMerger : ReferenceCounted<LSMMerger>, NonCopyable {
+	enum StepResult { NEED_LOAD, DONE, ENTRY };
+
+	std::vector<LSMRun> runs;
+	std::vector<LSMCursor> cursors;
+	KeyRange keys;
+	bool forward, fillCache;
+	Reference<LSMBlockCache> cache;
+
+	LSMMerger( KeyRange keys, bool forward, bool fillCache, Reference<LSMBlockCache> cache ) : keys(keys), forward(forward), fillCache(fillCache), cache(cache) {}
+
+	void start() {
+		cursors.resize( runs.size() );
+		for(int j = 0; j < runs.size(); j++)
+			seek( j, forward ? keys.begin : keys.end );
+	}
+
+	// Positions cursor j at the first entry >= key going forward, or the last entry < key in reverse
+	void seek( int j, KeyRef key ) {
+		LSMCursor& c = cursors[j];
+		LSMRun& run = runs[j];
+		c.done = false;
+		c.seeking = false;
+		if (run.inMemory) {
+			c.data = run.points;
+			int p = lsmLowerBound( c.data, key );
+			c.pos = forward ? p : p-1;
+			c.done = c.pos < 0 || c.pos >= c.data.size();
+			c.needLoad = false;
+			return;
+		}
+
+		if (forward) {
+			c.table = lsmFindTable( run.tables, key );
+			if (c.table == run.tables.size()) { c.done = true; return; }
+			c.block = std::max( 0, run.tables[c.table]->findBlock( key ) );
+		} else {
+			c.table = lsmFindTable( run.tables, key );
+			if (c.table == run.tables.size() || run.tables[c.table]->info.begin >= key) c.table--;
+			if (c.table < 0) { c.done = true; return; }
+			c.block = run.tables[c.table]->findBlock( key );
+		}
+		c.seeking = true;
+		c.seekKey = key;
+		c.needLoad = true;
+	}
+
+	// Moves cursor j to the adjacent block of its run, which must then be loaded
+	void moveBlock( int j ) {
+		LSMCursor& c = cursors[j];
+		LSMRun& run = runs[j];
+		c.seeking = false;
+		c.needLoad = true;
+		if (forward) {
+			if (++c.block >= int(run.tables[c.table]->blocks.size())) {
+				c.block = 0;
+				if (++c.table == run.tables.size()) c.done = true;
+			}
+		} else {
+			if (--c.block < 0) {
+				if (--c.table < 0) c.done = true;
+				else c.block = int(run.tables[c.table]->blocks.size()) - 1;
+			}
+		}
+	}
+
+	bool blockInRange( int j ) const {
+		return cursors[j].block >= 0 && cursors[j].block < runs[j].tables[cursors[j].table]->blocks.size();
+	}
+
+	// Called once the current block of cursor j has been loaded
+	void position( int j ) {
+		LSMCursor& c = cursors[j];
+		c.needLoad = false;
+		if (c.seeking) {
+			int p = lsmLowerBound( c.data, c.seekKey );
+			c.pos = forward ? p : p-1;
+			c.seeking = false;
+		} else {
+			c.pos = forward ? 0 : c.data.size()-1;
+		}
+		if (c.pos < 0 || c.pos >= c.data.size())
+			moveBlock( j );
+	}
+
+	void advance( int j ) {
+		LSMCursor& c = cursors[j];
+		c.pos += forward ? 1 : -1;
+		if (c.pos < 0 || c.pos >= c.data.size()) {
+			if (runs[j].inMemory) c.done = true;
+			else moveBlock( j );
+		}
+	}
+
+	// The returned entry refers to block memory which remains valid until the next call to load()
+	StepResult next( KeyValueRef& kv ) {
+		loop {
+			int best = -1;
+			for(int j = 0; j < cursors.size(); j++) {
+				LSMCursor& c = cursors[j];
+				if (c.done) continue;
+				if (c.needLoad) return NEED_LOAD;
+				if (best < 0 || (forward ? c.key() < cursors[best].key() : c.key() > cursors[best].key()))
+					best = j;
+			}
+			if (best < 0) return DONE;
+
+			KeyRef key = cursors[best].key();
+			if (forward ? key >= keys.end : key < keys.begin) return DONE;
+
+			Optional<KeyRangeRef> hidden;
+			int hiddenBy = 0;
+			for(; hiddenBy < best; hiddenBy++) {
+				hidden = runs[hiddenBy].findClear( key );
+				if (hidden.present()) break;
+			}
+			if (hidden.present()) {
+				KeyRangeRef cleared = hidden.get();
+				for(int j = hiddenBy+1; j < cursors.size(); j++) {
+					if (cursors[j].done) continue;
+					if (forward && cursors[j].key() < cleared.end) seek( j, cleared.end );
+					else if (!forward && cursors[j].key() >= cleared.begin) seek( j, cleared.begin );
+				}
+				continue;
+			}
+
+			kv = cursors[best].data[cursors[best].pos];
+			for(int j = 0; j < cursors.size(); j++)
+				if (!cursors[j].done && cursors[j].key() == kv.key)
+					advance( j );
+			return ENTRY;
+		}
+	}
+
+	ACTOR static Future<Void> settle( Reference<LSMMerger> self, int j ) {
+		loop {
+			if (self->cursors[j].done || !self->cursors[j].needLoad) return Void();
+			if (!self->blockInRange( j )) {
+				self->moveBlock( j );
+				continue;
+			}
+			Standalone<StringRef> block = wait( lsmReadBlock( self->cache, self->runs[j].tables[self->cursors[j].table], self->cursors[j].block, self->fillCache ) );
+			self->cursors[j].data = lsmDecodeBlock( block );
+			self->position( j );
+		}
+	}
+
+	static Future<Void> load( Reference<LSMMerger> const& self ) {
+		std::vector<Future<Void>> loads;
+		for(int j = 0; j < self->cursors.size(); j++)
+			if (!self->cursors[j].done && self->cursors[j].needLoad)
+				loads.push_back( settle( self, j ) );
+		if (loads.empty()) return Void();
+		return waitForAll( loads );
+	}
+};
+
+struct LSMCompaction {
+	int level;  // tables move from level to level+1
+	std::vector<Reference<LSMTable>> inputs;    // from level, newest first
+	std::vector<Reference<LSMTable>> overlaps;  // from level+1
+};
+
+class KeyValueStoreLSM : public IKeyValueStore, NonCopyable {
+public:
+	KeyValueStoreLSM( std::string const& filename, UID id );
+
+	// IClosable
+	virtual Future<Void> getError() { return delayed( log->getError() || error.getFuture() ); }
+	virtual Future<Void> onClosed() { return stopped.getFuture(); }
+	virtual void dispose() { doClose( this, true ); }
+	virtual void close() { doClose( this, false ); }
+
+	// IKeyValueStore
+	virtual KeyValueStoreType getType() { return KeyValueStoreType::LSM; }
+
+	virtual StorageBytes getStorageBytes() {
+		int64_t free, total;
+		g_network->getDiskBytes( parentDirectory(filename), free, total );
+
+		int64_t tableBytes = 0, obsoleteBytes = 0;
+		for(auto& level : tree->levels)
+			for(auto& t : level)
+				tableBytes += t->info.fileSize;
+		for(auto& t : obsolete)
+			obsoleteBytes += t->info.fileSize;
+
+		return StorageBytes( free, total, tableBytes + obsoleteBytes + log->getStorageBytes().used, free + obsoleteBytes );
+	}
+
+	virtual void set( KeyValueRef keyValue, const Arena* arena = NULL ) {
+		pending.push_back_deep( pending.arena(), OpRef( OpSet, keyValue.key, keyValue.value ) );
+	}
+
+	virtual void clear( KeyRangeRef range, const Arena* arena = NULL ) {
+		pending.push_back_deep( pending.arena(), OpRef( OpClear, range.begin, range.end ) );
+	}
+
+	virtual Future<Void> commit( bool sequential = false ) {
+		if(recovering.isError()) throw recovering.getError();
+		if(!recovering.isReady())
+			return waitAndCommit(this, sequential);
+
+		if (!pending.size())
+			return lastCommit;
+
+		for(auto& o : pending) {
+			if (o.op == OpSet)
+				mem->set( KeyValueRef( o.p1, o.p2 ) );
+			else
+				mem->clear( KeyRangeRef( o.p1, o.p2 ) );
+			log_op( (OpType)o.op, o.p1, o.p2 );
+		}
+		pending = Standalone<VectorRef<OpRef>>();
+
+		mem->logEnd = log_op( OpCommit, StringRef(), StringRef() );
+		lastCommit = mem->committed = log->commit();
+
+		if (!imm && mem->bytes >= SERVER_KNOBS->LSM_MEMTABLE_BYTES) {
+			imm = mem;
+			mem = Reference<LSMMemTable>( new LSMMemTable );
+			workAvailable.trigger();
+		}
+
+		if (writesStalled())
+			return waitForCapacity( this, lastCommit );
+		return lastCommit;
+	}
+
+	virtual Future<Optional<Value>> readValue( KeyRef key, Optional<UID> debugID = Optional<UID>() ) {
+		if(recovering.isError()) throw recovering.getError();
+		if (!recovering.isReady()) return waitAndReadValue(this, key);
+		return readLayersValue( mem, imm, tree, cache, key );
+	}
+
+	virtual Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID = Optional<UID>() ) {
+		return readPrefix( readValue( key, debugID ), maxLength );
+	}
+
+	// If rowLimit>=0, reads first rows sorted ascending, otherwise reads last rows sorted descending
+	// The total size of the returned value (less the last entry) will be less than byteLimit
+	virtual Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30, ReadType type = READ_NORMAL ) {
+		if(recovering.isError()) throw recovering.getError();
+		if (!recovering.isReady()) return waitAndReadRange(this, keys, rowLimit, byteLimit, type);
+		return readLayersRange( mem, imm, tree, cache, keys, rowLimit, byteLimit, type );
+	}
+
+	virtual bool canOpenSnapshot() { return true; }
+
+	// The tables and the frozen memtable are immutable, so the snapshot shares them (and keeps the tables from being deleted
+	// until it is gone); only the active memtable, at most LSM_MEMTABLE_BYTES, is copied.
+	virtual Reference<IKeyValueSnapshot> openSnapshot() {
+		ASSERT( recovering.isReady() && !recovering.isError() && !pending.size() );
+		Reference<LSMMemTable> copy( new LSMMemTable );
+		copy->points = mem->points;
+		copy->clears = mem->clears;
+		copy->bytes = mem->bytes;
+		return Reference<IKeyValueSnapshot>( new Snapshot( copy, imm, tree, cache ) );
+	}
+
+private:
+	struct Snapshot : IKeyValueSnapshot, NonCopyable {
+		Reference<LSMMemTable> mem, imm;
+		Reference<LSMTree> tree;
+		Reference<LSMBlockCache> cache;
+
+		Snapshot( Reference<LSMMemTable> mem, Reference<LSMMemTable> imm, Reference<LSMTree> tree, Reference<LSMBlockCache> cache ) : mem(mem), imm(imm), tree(tree), cache(cache) {}
+
+		virtual Future<Optional<Value>> readValue( KeyRef key ) {
+			return readLayersValue( mem, imm, tree, cache, key );
+		}
+		virtual Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30, ReadType type = READ_NORMAL ) {
+			return readLayersRange( mem, imm, tree, cache, keys, rowLimit, byteLimit, type );
+		}
+	};
+
+	// Reads key from the memtable mem, the frozen memtable imm (if any) and the tables of tree, newest first
+	static Future<Optional<Value>> readLayersValue( Reference<LSMMemTable> const& mem, Reference<LSMMemTable> const& imm, Reference<LSMTree> const& tree,
+		Reference<LSMBlockCache> const& cache, KeyRef key )
+	{
+		Optional<Optional<Value>> v = mem->get( key );
+		if (v.present()) return v.get();
+		if (imm) {
+			v = imm->get( key );
+			if (v.present()) return v.get();
+		}
+
+		std::vector<Reference<LSMTable>> candidates;
+		for(auto& t : tree->levels[0])
+			if (t->contains( key ))
+				candidates.push_back( t );
+		for(int l = 1; l < tree->levels.size(); l++) {
+			auto& tables = tree->levels[l];
+			int t = lsmFindTable( tables, key );
+			if (t < tables.size() && tables[t]->contains( key ))
+				candidates.push_back( tables[t] );
+		}
+		if (candidates.empty()) return Optional<Value>();
+		return readValueFromTables( cache, candidates, key );
+	}
+
+	static Future<Standalone<VectorRef<KeyValueRef>>> readLayersRange( Reference<LSMMemTable> const& mem, Reference<LSMMemTable> const& imm, Reference<LSMTree> const& tree,
+		Reference<LSMBlockCache> const& cache, KeyRangeRef keys, int rowLimit, int byteLimit, ReadType type )
+	{
+		bool forward = rowLimit >= 0;
+		Reference<LSMMerger> m( new LSMMerger( keys, forward, type != READ_BULK, cache ) );
+		m->runs.push_back( memRun( mem, NULL, keys, forward, std::abs(rowLimit), byteLimit ) );
+		if (imm)
+			m->runs.push_back( memRun( imm, &mem->clears, keys, forward, std::abs(rowLimit), byteLimit ) );
+		for(auto& t : tree->levels[0]) {
+			if (t->intersects( keys )) {
+				LSMRun r;
+				r.tables.push_back( t );
+				m->runs.push_back( r );
+			}
+		}
+		for(int l = 1; l < tree->levels.size(); l++) {
+			LSMRun r;
+			for(auto& t : tree->levels[l])
+				if (t->intersects( keys ))
+					r.tables.push_back( t );
+			if (r.tables.size())
+				m->runs.push_back( r );
+		}
+		m->start();
+		return readRangeFromMerger( m, rowLimit, byteLimit );
+	}
+
+	enum OpType {
+		OpSet,
+		OpClear,
+		OpCommit,   // only in log
+		OpRollback  // only in log
+	};
+
+	struct OpRef {
+		int op;
+		StringRef p1, p2;
+		OpRef() {}
+		OpRef( int op, StringRef p1, StringRef p2 ) : op(op), p1(p1), p2(p2) {}
+		OpRef( Arena& a, OpRef const& o ) : op(o.op), p1(a,o.p1), p2(a,o.p2) {}
+		size_t expectedSize() const {
+			return p1.expectedSize() + p2.expectedSize();
+		}
+	};
+	struct OpHeader {
+		int op;
+		int len1, len2;
+	};
+
+	std::string filename;
+	UID id;
+	IDiskQueue* log;
+	Future<Void> recovering, background;
+	Promise<Void> error, stopped;
+
+	Standalone<VectorRef<OpRef>> pending;  // mutations since the last commit
+	Future<Void> lastCommit;
+
+	Reference<LSMMemTable> mem, imm;  // imm, if set, is frozen and being flushed
+	Reference<LSMTree> tree;
+	std::vector<Reference<LSMTable>> obsolete;  // tables no longer in the tree, deleted once no reader holds them
+	std::vector<Key> compactPointers;           // per level, where the next size triggered compaction starts
+	int64_t nextFileNumber;
+	Reference<LSMBlockCache> cache;
+	AsyncTrigger workAvailable, treeChanged;
+
+	std::string tableFilename( int64_t number ) const {
+		return format( "%s-%08lld.sst", filename.c_str(), number );
+	}
+
+	IDiskQueue::location log_op( OpType op, StringRef v1, StringRef v2 ) {
+		OpHeader h = {(int)op, v1.size(), v2.size()};
+		log->push( StringRef((const uint8_t*)&h, sizeof(h)) );
+		log->push( v1 );
+		log->push( v2 );
+		return log->push( LiteralStringRef("\x01") );
+	}
+
+	bool writesStalled() const {
+		return tree->levels[0].size() >= SERVER_KNOBS->LSM_L0_STOP_WRITES_TRIGGER || (imm && mem->bytes >= SERVER_KNOBS->LSM_MEMTABLE_BYTES);
+	}
+
+	// Copies the points of an in-memory layer in keys, skipping those hidden by newerClears, as far as a read with the
+	// given limits could reach.  Only keys are charged against byteLimit: a point shadowed by a newer layer is returned
+	// with that layer's value, so its own value size says nothing about how far the read gets.
+	static LSMRun memRun( Reference<LSMMemTable> const& m, LSMClearSet const* newerClears, KeyRangeRef keys, bool forward, int rowLimit, int byteLimit ) {
+		LSMRun r;
+		r.inMemory = true;
+		r.clears = m->clears.get( keys );
+		if (forward) {
+			for(auto it = m->points.lower_bound( keys.begin ); it != m->points.end() && it->first < keys.end && rowLimit && byteLimit >= 0; ++it) {
+				if (newerClears && newerClears->find( it->first ).present()) continue;
+				byteLimit -= sizeof(KeyValueRef) + it->first.size();
+				r.points.push_back_deep( r.points.arena(), KeyValueRef( it->first, it->second ) );
+				--rowLimit;
+			}
+		} else {
+			auto it = m->points.lower_bound( keys.end );
+			while (it != m->points.begin() && rowLimit && byteLimit >= 0) {
+				--it;
+				if (it->first < keys.begin) break;
+				if (newerClears && newerClears->find( it->first ).present()) continue;
+				byteLimit -= sizeof(KeyValueRef) + it->first.size();
+				r.points.push_back_deep( r.points.arena(), KeyValueRef( it->first, it->second ) );
+				--rowLimit;
+			}
+			std::reverse( r.points.begin(), r.points.end() );
+		}
+		return r;
+	}
+
+	ACTOR static Future<Optional<Value>> readValueFromTables( Reference<LSMBlockCache> cache, std::vector<Reference<LSMTable>> candidates, Key key ) {
+		state int i;
+		for(i = 0; i < candidates.size(); i++) {
+			if (LSMBloomFilter::mayContain( candidates[i]->bloom, key ) && candidates[i]->findBlock( key ) >= 0) {
+				Standalone<StringRef> block = wait( lsmReadBlock( cache, candidates[i], candidates[i]->findBlock( key ), true ) );
+				Optional<StringRef> value = LSMBlockReader( block ).find( key );
+				if (value.present())
+					return Optional<Value>( Value( value.get(), block.arena() ) );
+			}
+			if (lsmFindClear( candidates[i]->clears, key ).present())
+				return Optional<Value>();
+		}
+		return Optional<Value>();
+	}
+
+	ACTOR static Future<Optional<Value>> readPrefix( Future<Optional<Value>> read, int maxLength ) {
+		Optional<Value> v = wait( read );
+		if (v.present() && maxLength < v.get().size())
+			return Optional<Value>( v.get().substr( 0, maxLength ) );
+		return v;
+	}
+
+	ACTOR static Future<Standalone<VectorRef<KeyValueRef>>> readRangeFromMerger( Reference<LSMMerger> m, int rowLimit, int byteLimit ) {
+		state Standalone<VectorRef<KeyValueRef>> result;
+		if (rowLimit < 0) rowLimit = -rowLimit;
+		loop {
+			Void _ = wait( LSMMerger::load( m ) );
+			loop {
+				if (!rowLimit || byteLimit < 0) return result;
+				KeyValueRef kv;
+				LSMMerger::StepResult r = m->next( kv );
+				if (r == LSMMerger::DONE) return result;
+				if (r == LSMMerger::NEED_LOAD) break;
+				byteLimit -= sizeof(KeyValueRef) + kv.key.size() + kv.value.size();
+				result.push_back_deep( result.arena(), kv );
+				--rowLimit;
+			}
+		}
+	}
+
+	Optional<LSMCompaction> pickCompaction() {
+		int maxLevel = tree->levels.size() - 1;
+		LSMCompaction c;
+		KeyRange hull;
+
+		if (tree->levels[0].size() >= SERVER_KNOBS->LSM_L0_COMPACTION_TRIGGER) {
+			c.level = 0;
+			c.inputs = tree->levels[0];
+		} else {
+			double limit = SERVER_KNOBS->LSM_LEVEL1_BYTES;
+			for(int l = 1; l < maxLevel && !c.inputs.size(); l++, limit *= SERVER_KNOBS->LSM_LEVEL_SIZE_MULTIPLIER) {
+				auto& tables = tree->levels[l];
+				if (tables.empty() || tree->levelBytes( l ) <= limit) continue;
+				// Round robin through the level so that each part of the key space is compacted in turn
+				int t = lsmFindTable( tables, compactPointers[l] );
+				if (t == tables.size()) t = 0;
+				compactPointers[l] = tables[t]->info.end;
+				c.level = l;
+				c.inputs.push_back( tables[t] );
+			}
+			if (!c.inputs.size()) return Optional<LSMCompaction>();
+		}
+
+		Key begin = c.inputs[0]->info.begin, end = c.inputs[0]->info.end;
+		for(auto& t : c.inputs) {
+			if (t->info.begin < begin) begin = t->info.begin;
+			if (t->info.end > end) end = t->info.end;
+		}
+		for(auto& t : tree->levels[c.level+1])
+			if (t->intersects( KeyRangeRef( begin, end ) ))
+				c.overlaps.push_back( t );
+		return c;
+	}
+
+	ACTOR static Future<Void> installTree( KeyValueStoreLSM* self, Reference<LSMTree> tree, std::vector<Reference<LSMTable>> removed ) {
+		Void _ = wait( writeManifest( self->filename, self->nextFileNumber, tree ) );
+		self->tree = tree;
+		self->obsolete.insert( self->obsolete.end(), removed.begin(), removed.end() );
+		self->treeChanged.trigger();
+		return Void();
+	}
+
+	ACTOR static Future<Void> flushMemTable( KeyValueStoreLSM* self ) {
+		state Reference<LSMMemTable> imm = self->imm;
+		state Reference<LSMTableWriter> writer;
+		state std::map<Key, Value>::iterator it;
+		state int count = 0;
+		state double startTime = now();
+		state Reference<LSMTree> tree = self->tree->clone();
+
+		// The log can't be popped past a commit which might not be durable yet
+		Void _ = wait( imm->committed );
+
+		if (!imm->empty()) {
+			writer = Reference<LSMTableWriter>( new LSMTableWriter( self->tableFilename( self->nextFileNumber ), self->nextFileNumber, 0 ) );
+			self->nextFileNumber++;
+			for(it = imm->points.begin(); it != imm->points.end(); ++it) {
+				writer->add( KeyValueRef( it->first, it->second ) );
+				if (writer->needsDrain())
+					Void _ = wait( LSMTableWriter::drain( writer ) );
+				if (++count % 1000 == 0)
+					Void _ = wait( yield() );
+			}
+			KeyRange range = imm->range();
+			Reference<LSMTable> table = wait( LSMTableWriter::finish( writer, range, imm->clears.get( range ) ) );
+			tree->levels[0].insert( tree->levels[0].begin(), table );
+		}
+
+		Void _ = wait( installTree( self, tree, std::vector<Reference<LSMTable>>() ) );
+		self->log->pop( imm->logEnd );
+		self->imm.clear();
+		self->treeChanged.trigger();
+
+		TraceEvent("LSMFlush", self->id)
+			.detail("Entries", imm->points.size())
+			.detail("Bytes", imm->bytes)
+			.detail("FileBytes", writer ? writer->info.fileSize : 0)
+			.detail("L0Tables", self->tree->levels[0].size())
+			.detail("Elapsed", now() - startTime);
+		return Void();
+	}
+
+	ACTOR static Future<Void> compact( KeyValueStoreLSM* self, LSMCompaction c ) {
+		state int outputLevel = c.level + 1;
+		state bool bottom = outputLevel == self->tree->levels.size() - 1;
+		state Reference<LSMTree> tree = self->tree->clone();
+		state std::vector<Reference<LSMTable>> removed;
+		state std::vector<Reference<LSMTable>> outputs;
+		state Reference<LSMTableWriter> writer;
+		state Reference<LSMMerger> m;
+		state Standalone<VectorRef<KeyRangeRef>> clears;
+		state Key outputBegin;
+		state KeyValueRef kv;
+		state LSMMerger::StepResult step;
+		state int64_t entries = 0;
+		state int64_t inputBytes = 0;
+		state double startTime = now();
+
+		removed = c.inputs;
+		removed.insert( removed.end(), c.overlaps.begin(), c.overlaps.end() );
+
+		if (c.overlaps.empty() && (c.level > 0 || c.inputs.size() == 1)) {
+			// Nothing to merge with, so the table can move down without being rewritten
+			TEST(true);  // LSM trivial move
+			auto& to = tree->levels[outputLevel];
+			removeTables( tree->levels[c.level], c.inputs );
+			for(auto& t : c.inputs)
+				to.insert( to.begin() + lsmFindTable( to, t->info.begin ), t );
+			Void _ = wait( installTree( self, tree, std::vector<Reference<LSMTable>>() ) );
+			return Void();
+		}
+
+		{
+			Key begin = removed[0]->info.begin, end = removed[0]->info.end;
+			for(auto& t : removed) {
+				if (t->info.begin < begin) begin = t->info.begin;
+				if (t->info.end > end) end = t->info.end;
+				inputBytes += t->info.fileSize;
+			}
+			m = Reference<LSMMerger>( new LSMMerger( KeyRangeRef( begin, end ), true, false, self->cache ) );
+
+			// Each level 0 table is its own run since they may overlap; the single input from a deeper level and its
+			// overlaps are each disjoint
+			if (c.level == 0) {
+				for(auto& t : c.inputs) {
+					LSMRun r;
+					r.tables.push_back( t );
+					m->runs.push_back( r );
+				}
+			} else {
+				LSMRun r;
+				r.tables = c.inputs;
+				m->runs.push_back( r );
+			}
+			if (c.overlaps.size()) {
+				LSMRun r;
+				r.tables = c.overlaps;
+				m->runs.push_back( r );
+			}
+			m->start();
+
+			if (!bottom) {
+				LSMClearSet clearSet;
+				for(auto& t : removed)
+					clearSet.add( t->clears );
+				clears = clearSet.get( m->keys );
+			}
+		}
+		outputBegin = m->keys.begin;
+
+		loop {
+			Void _ = wait( LSMMerger::load( m ) );
+			step = m->next( kv );
+			if (step == LSMMerger::NEED_LOAD) continue;
+			if (step == LSMMerger::DONE) break;
+
+			if (writer && writer->estimatedSize() >= SERVER_KNOBS->LSM_TARGET_FILE_BYTES) {
+				// kv stays valid here since the merger doesn't load again until the next iteration
+				KeyRange range( KeyRangeRef( outputBegin, kv.key ) );
+				Reference<LSMTable> t = wait( LSMTableWriter::finish( writer, range, clipClears( clears, range ) ) );
+				outputs.push_back( t );
+				outputBegin = kv.key;
+				writer.clear();
+			}
+			if (!writer) {
+				writer = Reference<LSMTableWriter>( new LSMTableWriter( self->tableFilename( self->nextFileNumber ), self->nextFileNumber, outputLevel ) );
+				self->nextFileNumber++;
+			}
+			writer->add( kv );
+			if (writer->needsDrain())
+				Void _ = wait( LSMTableWriter::drain( writer ) );
+			if (++entries % 1000 == 0)
+				Void _ = wait( yield() );
+		}
+
+		if (!writer && !outputs.size() && clears.size()) {
+			TEST(true);  // LSM compaction output holds only clears
+			writer = Reference<LSMTableWriter>( new LSMTableWriter( self->tableFilename( self->nextFileNumber ), self->nextFileNumber, outputLevel ) );
+			self->nextFileNumber++;
+		}
+		if (writer) {
+			KeyRange range( KeyRangeRef( outputBegin, m->keys.end ) );
+			Reference<LSMTable> t = wait( LSMTableWriter::finish( writer, range, clipClears( clears, range ) ) );
+			outputs.push_back( t );
+		}
+		TEST( bottom && !outputs.size() );  // LSM compaction removed everything it read
+
+		removeTables( tree->levels[c.level], c.inputs );
+		removeTables( tree->levels[outputLevel], c.overlaps );
+		{
+			auto& to = tree->levels[outputLevel];
+			to.insert( to.begin() + lsmFindTable( to, m->keys.begin ), outputs.begin(), outputs.end() );
+		}
+
+		Void _ = wait( installTree( self, tree, removed ) );
+
+		TraceEvent("LSMCompaction", self->id)
+			.detail("Level", c.level)
+			.detail("Inputs", c.inputs.size())
+			.detail("Overlaps", c.overlaps.size())
+			.detail("Outputs", outputs.size())
+			.detail("InputBytes", inputBytes)
+			.detail("Entries", entries)
+			.detail("Bottom", bottom)
+			.detail("Elapsed", now() - startTime);
+		return Void();
+	}
+
+	static void removeTables( std::vector<Reference<LSMTable>>& level, std::vector<Reference<LSMTable>> const& tables ) {
+		for(auto& t : tables) {
+			for(int i = 0; i < level.size(); i++) {
+				if (level[i].getPtr() == t.getPtr()) {
+					level.erase( level.begin() + i );
+					break;
+				}
+			}
+		}
+	}
+
+	static Standalone<VectorRef<KeyRangeRef>> clipClears( VectorRef<KeyRangeRef> const& clears, KeyRangeRef range ) {
+		Standalone<VectorRef<KeyRangeRef>> result;
+		for(auto& r : clears)
+			if (r.begin < range.end && range.begin < r.end)
+				result.push_back_deep( result.arena(), range & r );
+		return result;
+	}
+
+	ACTOR static Future<Void> deleteObsoleteTables( KeyValueStoreLSM* self ) {
+		state int i = 0;
+		state std::string deleting;
+		while (i < self->obsolete.size()) {
+			if (!self->obsolete[i]->isSoleOwner()) {
+				i++;
+				continue;
+			}
+			deleting = self->obsolete[i]->filename;
+			self->cache->erase( self->obsolete[i]->info.number );
+			self->obsolete.erase( self->obsolete.begin() + i );
+			Void _ = wait( IAsyncFileSystem::filesystem()->deleteFile( deleting, false ) );
+		}
+		return Void();
+	}
+
+	ACTOR static Future<Void> backgroundWork( KeyValueStoreLSM* self ) {
+		state Optional<LSMCompaction> c;
+		try {
+			Void _ = wait( self->recovering );
+			loop {
+				Void _ = wait( deleteObsoleteTables( self ) );
+				if (self->imm) {
+					Void _ = wait( flushMemTable( self ) );
+					continue;
+				}
+				c = self->pickCompaction();
+				if (c.present()) {
+					Void _ = wait( compact( self, c.get() ) );
+					c = Optional<LSMCompaction>();
+					continue;
+				}
+				choose {
+					when( Void _ = wait( self->workAvailable.onTrigger() ) ) {}
+					when( Void _ = wait( self->obsolete.size() ? delay( SERVER_KNOBS->LSM_OBSOLETE_FILE_CHECK_INTERVAL ) : Future<Void>( Never() ) ) ) {}
+				}
+			}
+		} catch (Error& e) {
+			if (e.code() != error_code_actor_cancelled) {
+				TraceEvent(SevError, "LSMBackgroundError", self->id).error(e, true);
+				self->error.sendError( e );
+			}
+			throw;
+		}
+	}
+
+	ACTOR static Future<Void> waitForCapacity( KeyValueStoreLSM* self, Future<Void> commit ) {
+		TEST(true);  // LSM commit stalled on flush or compaction
+		while (self->writesStalled())
+			Void _ = wait( self->treeChanged.onTrigger() );
+		Void _ = wait( commit );
+		return Void();
+	}
+
+	static Standalone<StringRef> encodeManifest( int64_t nextFileNumber, Reference<LSMTree> const& tree ) {
+		std::vector<LSMTableInfo> infos;
+		for(int l = 0; l < tree->levels.size(); l++) {
+			for(auto& t : tree->levels[l]) {
+				infos.push_back( t->info );
+				infos.back().level = l;
+			}
+		}
+		BinaryWriter wr( IncludeVersion() );
+		wr << LSM_FORMAT_VERSION << nextFileNumber << infos;
+		return wr.toStringRef();
+	}
+
+	ACTOR static Future<Void> writeManifest( std::string filename, int64_t nextFileNumber, Reference<LSMTree> tree ) {
+		state Standalone<StringRef> payload = encodeManifest( nextFileNumber, tree );
+		state int length = (sizeof(uint32_t)*2 + payload.size() + LSM_PAGE_SIZE - 1) & ~(LSM_PAGE_SIZE-1);
+		state uint8_t* buffer = (uint8_t*)aligned_alloc( LSM_PAGE_SIZE, length );
+		try {
+			uint32_t header[2] = { (uint32_t)payload.size(), lsmChecksum( payload.begin(), payload.size() ) };
+			memset( buffer, 0, length );
+			memcpy( buffer, header, sizeof(header) );
+			memcpy( buffer + sizeof(header), payload.begin(), payload.size() );
+
+			state Reference<IAsyncFile> file = wait( IAsyncFileSystem::filesystem()->open( filename,
+				IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED, 0600 ) );
+			Void _ = wait( file->write( buffer, length, 0 ) );
+			Void _ = wait( file->sync() );
+		} catch (Error& e) {
+			aligned_free( buffer );
+			throw;
+		}
+		aligned_free( buffer );
+		return Void();
+	}
+
+	ACTOR static Future<Reference<LSMTable>> openTable( std::string filename, LSMTableInfo info ) {
+		state Reference<IAsyncFile> file = wait( IAsyncFileSystem::filesystem()->open( filename, IAsyncFile::OPEN_READONLY | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED, 0 ) );
+		Standalone<StringRef> meta = wait( lsmReadAligned( file, info.metaOffset, info.metaSize ) );
+		if (lsmChecksum( meta.begin(), meta.size() ) != info.metaChecksum) {
+			TraceEvent(SevError, "LSMTableMetaChecksumMismatch").detail("Filename", filename);
+			throw file_corrupt();
+		}
+		Reference<LSMTable> table( new LSMTable( info, filename, file ) );
+		BinaryReader rd( meta, IncludeVersion() );
+		rd >> table->blocks >> table->bloom >> table->clears;
+		return table;
+	}
+
+	// Table files in the store's directory, including partially written ones
+	std::vector<std::string> listTableFiles() const {
+		std::string dir = parentDirectory( filename );
+		std::string prefix = basename( filename ) + "-";
+		std::vector<std::string> result;
+		for(auto& ext : { std::string(".sst"), std::string(".sst.part") }) {
+			for(auto& f : platform::listFiles( dir, ext ))
+				if (StringRef(f).startsWith( StringRef(prefix) ))
+					result.push_back( joinPath( dir, f ) );
+		}
+		return result;
+	}
+
+	ACTOR static Future<Void> recover( KeyValueStoreLSM* self ) {
+		state std::vector<LSMTableInfo> infos;
+		state std::vector<Future<Reference<LSMTable>>> opens;
+		state std::vector<std::string> orphans;
+		state Reference<IAsyncFile> manifest;
+		state int i;
+		state OpHeader h;
+		state int zeroFillSize = 0;
+		state int dbgMutationCount = 0;
+		state int dbgCommitCount = 0;
+		state double startt = now();
+		state UID dbgid = self->id;
+		state Standalone<VectorRef<OpRef>> recoveryOps;
+
+		TraceEvent("LSMRecoveryStarted", self->id).detail("Filename", self->filename);
+
+		try {
+			try {
+				Reference<IAsyncFile> f = wait( IAsyncFileSystem::filesystem()->open( self->filename, IAsyncFile::OPEN_READONLY | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED, 0 ) );
+				manifest = f;
+			} catch (Error& e) {
+				if (e.code() != error_code_file_not_found) throw;
+			}
+
+			if (manifest) {
+				int64_t size = wait( manifest->size() );
+				Standalone<StringRef> data = wait( lsmReadAligned( manifest, 0, size ) );
+				uint32_t header[2];
+				if (data.size() < sizeof(header)) throw file_corrupt();
+				memcpy( header, data.begin(), sizeof(header) );
+				if (sizeof(header) + header[0] > data.size() || lsmChecksum( data.begin() + sizeof(header), header[0] ) != header[1]) {
+					TraceEvent(SevError, "LSMManifestChecksumMismatch", self->id).detail("Filename", self->filename);
+					throw file_corrupt();
+				}
+				BinaryReader rd( data.substr( sizeof(header), header[0] ), IncludeVersion() );
+				uint32_t format;
+				rd >> format;
+				if (format != LSM_FORMAT_VERSION) {
+					TraceEvent(SevError, "LSMManifestUnknownFormat", self->id).detail("Filename", self->filename).detail("Format", format);
+					throw file_corrupt();
+				}
+				rd >> self->nextFileNumber >> infos;
+				manifest.clear();
+			} else {
+				// Create the manifest right away so that the store can be found on disk from now on
+				Void _ = wait( writeManifest( self->filename, self->nextFileNumber, self->tree ) );
+			}
+
+			for(auto& info : infos)
+				opens.push_back( openTable( self->tableFilename( info.number ), info ) );
+			Void _ = wait( waitForAll( opens ) );
+
+			{
+				Reference<LSMTree> tree( new LSMTree );
+				int levels = SERVER_KNOBS->LSM_MAX_LEVELS;
+				for(auto& info : infos)
+					levels = std::max( levels, info.level + 1 );
+				tree->levels.resize( levels );
+				for(i = 0; i < infos.size(); i++)
+					tree->levels[infos[i].level].push_back( opens[i].get() );
+				std::sort( tree->levels[0].begin(), tree->levels[0].end(), [](Reference<LSMTable> const& a, Reference<LSMTable> const& b) { return a->info.number > b->info.number; } );
+				for(int l = 1; l < levels; l++)
+					std::sort( tree->levels[l].begin(), tree->levels[l].end(), [](Reference<LSMTable> const& a, Reference<LSMTable> const& b) { return a->info.begin < b->info.begin; } );
+				self->tree = tree;
+				self->compactPointers.resize( levels );
+			}
+
+			// Tables which were being written, or which were replaced but not yet deleted, when the process stopped
+			{
+				std::set<std::string> live;
+				for(auto& info : infos)
+					live.insert( basename( self->tableFilename( info.number ) ) );
+				for(auto& f : self->listTableFiles())
+					if (!live.count( basename( f ) ))
+						orphans.push_back( f );
+			}
+			for(i = 0; i < orphans.size(); i++) {
+				TraceEvent("LSMDeletingOrphanedTable", self->id).detail("Filename", orphans[i]);
+				Void _ = wait( IAsyncFileSystem::filesystem()->deleteFile( orphans[i], false ) );
+			}
+
+			loop {
+				Standalone<StringRef> data = wait( self->log->readNext( sizeof(OpHeader) ) );
+				if (data.size() != sizeof(OpHeader)) {
+					if (data.size()) {
+						TEST(true);  // zero fill partial header in KeyValueStoreLSM
+						memset(&h, 0, sizeof(OpHeader));
+						memcpy(&h, data.begin(), data.size());
+						zeroFillSize = sizeof(OpHeader)-data.size() + h.len1 + h.len2 + 1;
+					}
+					break;
+				}
+				h = *(OpHeader*)data.begin();
+				Standalone<StringRef> data = wait( self->log->readNext( h.len1 + h.len2+1 ) );
+				if (data.size() != h.len1 + h.len2 + 1) {
+					zeroFillSize = h.len1 + h.len2 + 1 - data.size();
+					break;
+				}
+
+				if (data[data.size()-1]) {
+					StringRef p1 = data.substr(0, h.len1);
+					StringRef p2 = data.substr(h.len1, h.len2);
+
+					if (h.op == OpSet || h.op == OpClear) {
+						recoveryOps.push_back_deep( recoveryOps.arena(), OpRef( h.op, p1, p2 ) );
+						++dbgMutationCount;
+					} else if (h.op == OpCommit) {
+						for(auto& o : recoveryOps) {
+							if (o.op == OpSet)
+								self->mem->set( KeyValueRef( o.p1, o.p2 ) );
+							else
+								self->mem->clear( KeyRangeRef( o.p1, o.p2 ) );
+						}
+						recoveryOps = Standalone<VectorRef<OpRef>>();
+						self->mem->logEnd = self->log->getNextReadLocation();
+						++dbgCommitCount;
+					} else if (h.op == OpRollback) {
+						recoveryOps = Standalone<VectorRef<OpRef>>();
+					} else
+						ASSERT(false);
+				}
+
+				Void _ = wait( yield() );
+			}
+
+			if (zeroFillSize) {
+				TEST( true );  // Fixing a partial commit at the end of the KeyValueStoreLSM log
+				for(i=0; i<zeroFillSize; i++)
+					self->log->push( StringRef((const uint8_t*)"",1) );
+			}
+			// make sure that before any new operations are added to the log that all uncommitted operations are "rolled back"
+			self->log_op( OpRollback, StringRef(), StringRef() );
+
+			int tables = 0;
+			for(auto& level : self->tree->levels)
+				tables += level.size();
+			TraceEvent("LSMRecovered", self->id)
+				.detail("Tables", tables)
+				.detail("OrphanedTables", orphans.size())
+				.detail("MemTableBytes", self->mem->bytes)
+				.detail("Mutations", dbgMutationCount)
+				.detail("Commits", dbgCommitCount)
+				.detail("TimeTaken", now()-startt);
+			return Void();
+		} catch( Error &e ) {
+			bool ok = e.code() == error_code_operation_cancelled || e.code() == error_code_actor_cancelled || e.code() == error_code_file_not_found;
+			TraceEvent(ok ? SevInfo : SevError, "LSMErrorDuringRecovery", dbgid).error(e, true);
+			throw e;
+		}
+	}
+
+	ACTOR static void doClose( KeyValueStoreLSM* self, bool deleteOnClose ) {
+		state Error error = success();
+		state std::vector<std::string> files;
+		state int i;
+		state Future<Void> logClosed;
+		try {
+			TraceEvent("LSMClose", self->id).detail("Del", deleteOnClose);
+			self->recovering.cancel();
+			self->background.cancel();
+			if (deleteOnClose) {
+				self->tree = Reference<LSMTree>( new LSMTree );
+				self->obsolete.clear();
+				self->cache = Reference<LSMBlockCache>( new LSMBlockCache( 0 ) );
+				files = self->listTableFiles();
+				for(i = 0; i < files.size(); i++)
+					Void _ = wait( IAsyncFileSystem::filesystem()->deleteFile( files[i], false ) );
+				Void _ = wait( IAsyncFileSystem::filesystem()->deleteFile( self->filename, true ) );
+			}
+			logClosed = self->log->onClosed();
+			if (deleteOnClose) self->log->dispose();
+			else self->log->close();
+			Void _ = wait( logClosed );
+		} catch (Error& e) {
+			TraceEvent(SevError, "LSMDoCloseError", self->id)
+				.detail("Reason", e.code() == error_code_platform_error ? "could not delete database" : "unknown")
+				.error(e,true);
+			error = e;
+		}
+
+		TraceEvent("LSMClosed", self->id);
+		if( error.code() != error_code_actor_cancelled ) {
+			self->stopped.send(Void());
+			delete self;
+		}
+	}
+
+	ACTOR static Future<Optional<Value>> waitAndReadValue( KeyValueStoreLSM* self, Key key ) {
+		Void _ = wait( self->recovering );
+		Optional<Value> v = wait( self->readValue(key) );
+		return v;
+	}
+	ACTOR static Future<Standalone<VectorRef<KeyValueRef>>> waitAndReadRange( KeyValueStoreLSM* self, KeyRange keys, int rowLimit, int byteLimit, ReadType type ) {
+		Void _ = wait( self->recovering );
+		Standalone<VectorRef<KeyValueRef>> result = wait( self->readRange(keys, rowLimit, byteLimit, type) );
+		return result;
+	}
+	ACTOR static Future<Void> waitAndCommit( KeyValueStoreLSM* self, bool sequential ) {
+		Void _ = wait( self->recovering );
+		Void _ = wait( self->commit(sequential) );
+		return Void();
+	}
+};
+
+KeyValueStoreLSM::KeyValueStoreLSM( std::string const& filename, UID id )
+	: filename(filename), id(id), lastCommit(Void()), mem(new LSMMemTable), tree(new LSMTree), nextFileNumber(1),
+	  cache(new LSMBlockCache(SERVER_KNOBS->LSM_BLOCK_CACHE_BYTES))
+{
+	tree->levels.resize( SERVER_KNOBS->LSM_MAX_LEVELS );
+	compactPointers.resize( SERVER_KNOBS->LSM_MAX_LEVELS );
+	log = openDiskQueue( filename + "-log", id );
+	recovering = recover( this );
+	background = backgroundWork( this );
+}
+
+IKeyValueStore* keyValueStoreLSM( std::string const& filename, UID logID ) {
+	TraceEvent("LSMOpening", logID).detail("Filename", filename);
+	return new KeyValueStoreLSM( filename, logID );
+}
+
+TEST_CASE("fdbserver/KeyValueStoreLSM/clearSet") {
+	LSMClearSet s;
+	s.add( KeyRangeRef( LiteralStringRef("d"), LiteralStringRef("f") ) );
+	s.add( KeyRangeRef( LiteralStringRef("a"), LiteralStringRef("b") ) );
+	s.add( KeyRangeRef( LiteralStringRef("b"), LiteralStringRef("c") ) );
+	s.add( KeyRangeRef( LiteralStringRef("e"), LiteralStringRef("g") ) );
+	s.add( KeyRangeRef( LiteralStringRef("x"), LiteralStringRef("x") ) );
+
+	ASSERT( s.ranges.size() == 2 );
+	ASSERT( s.find( LiteralStringRef("a") ).get() == KeyRangeRef( LiteralStringRef("a"), LiteralStringRef("c") ) );
+	ASSERT( s.find( LiteralStringRef("f") ).get() == KeyRangeRef( LiteralStringRef("d"), LiteralStringRef("g") ) );
+	ASSERT( !s.find( LiteralStringRef("c") ).present() );
+	ASSERT( !s.find( LiteralStringRef("x") ).present() );
+
+	Standalone<VectorRef<KeyRangeRef>> clipped = s.get( KeyRangeRef( LiteralStringRef("bb"), LiteralStringRef("e") ) );
+	ASSERT( clipped.size() == 2 );
+	ASSERT( clipped[0] == KeyRangeRef( LiteralStringRef("bb"), LiteralStringRef("c") ) );
+	ASSERT( clipped[1] == KeyRangeRef( LiteralStringRef("d"), LiteralStringRef("e") ) );
+	ASSERT( lsmFindClear( clipped, LiteralStringRef("d") ).present() );
+	ASSERT( !lsmFindClear( clipped, LiteralStringRef("e") ).present() );
+
+	return Void();
+}
+
+TEST_CASE("fdbserver/KeyValueStoreLSM/bloomFilter") {
+	LSMBloomFilter bloom;
+	for(int i = 0; i < 1000; i++)
+		bloom.add( StringRef( format("key%d", i) ) );
+	Standalone<StringRef> filter = bloom.finish( 10 );
+
+	for(int i = 0; i < 1000; i++)
+		ASSERT( LSMBloomFilter::mayContain( filter, StringRef( format("key%d", i) ) ) );
+	int falsePositives = 0;
+	for(int i = 1000; i < 11000; i++)
+		falsePositives += LSMBloomFilter::mayContain( filter, StringRef( format("key%d", i) ) );
+	ASSERT( falsePositives < 500 );  // about 1% is expected at 10 bits per key
+
+	ASSERT( LSMBloomFilter::mayContain( LSMBloomFilter().finish( 10 ), LiteralStringRef("anything") ) );
+
+	return Void();
+}
+
+TEST_CASE("fdbserver/KeyValueStoreLSM/blockFormat") {
+	Standalone<VectorRef<KeyValueRef>> kvs;
+	for(int i = 0; i < 200; i++) {
+		// Sorted keys sharing a long prefix, as tuple encoded keys do
+		static const char prefix[] = "\x02" "application" "\x00" "\x02" "table" "\x00" "\x15";
+		std::string k = std::string( prefix, sizeof(prefix) - 1 ) + format("%03d", i/10);
+		k.resize( k.size() + i%10, 'x' );
+		kvs.push_back_deep( kvs.arena(), KeyValueRef( StringRef(k), StringRef( format("v%d", i) ) ) );
+	}
+
+	for(int interval : { 1, 3, 16, 1000 }) {
+		LSMBlockBuilder builder( interval );
+		int64_t fullBytes = 0;
+		for(auto& kv : kvs) {
+			builder.add( kv );
+			fullBytes += kv.key.size() + kv.value.size();
+		}
+		Standalone<StringRef> block( builder.finish() );
+		if (interval > 1)
+			ASSERT( block.size() < fullBytes );
+
+		Standalone<VectorRef<KeyValueRef>> decoded = lsmDecodeBlock( block );
+		ASSERT( decoded.size() == kvs.size() );
+		LSMBlockReader reader( block );
+		for(int i = 0; i < kvs.size(); i++) {
+			ASSERT( decoded[i] == kvs[i] );
+			ASSERT( reader.find( kvs[i].key ).get() == kvs[i].value );
+			ASSERT( !reader.find( keyAfter( kvs[i].key ) ).present() || (i+1 < kvs.size() && keyAfter( kvs[i].key ) == kvs[i+1].key) );
+		}
+		ASSERT( !reader.find( LiteralStringRef("") ).present() );
+		ASSERT( !reader.find( LiteralStringRef("\xff") ).present() );
+	}
+
+	return Void();
+}
@@ -25,44 +25,60 @@
 #include "flow/ActorCollection.h"
 #include "fdbclient/Notified.h"
 #include "fdbclient/SystemData.h"
+#include "Knobs.h"
+#include "flow/IThreadPool.h"
+#include "flow/ThreadPrimitives.h"
+#include "CoroFlow.h"
+#include <atomic>
 
 #define OP_DISK_OVERHEAD (sizeof(OpHeader) + 1)
 
 //Stored in the IndexedSets that hold the database.
-//Each KeyValueMapPair is 32 bytes, excluding arena memory.
-//It is stored in an IndexedSet<KeyValueMapPair, uint64_t>::Node, for a total size of 72 bytes.
+//Each KeyValueMapPair is 24 bytes, excluding arena memory.  The value is stored in the arena directly after the key, so it needs no
+//pointer of its own.  It is stored in an IndexedSet<KeyValueMapPair, uint64_t>::Node, for a total size of 64 bytes, which is the
+//smallest FastAllocator size a node can have.  (With separate key and value StringRefs the node would be 72 bytes, and would take
+//a 128 byte allocation.)
 struct KeyValueMapPair {
 	Arena arena; //8 Bytes (excluding arena memory)
-	KeyRef key; //12 Bytes
-	ValueRef value; //12 Bytes
-
-	void operator= ( KeyValueMapPair const& rhs ) { arena = rhs.arena; key = rhs.key; value = rhs.value; }
-	KeyValueMapPair( KeyValueMapPair const& rhs ) : arena(rhs.arena), key(rhs.key), value(rhs.value) {}
+	const uint8_t* bytes; //8 Bytes
+	int keySize; //4 Bytes
+	int valueSize; //4 Bytes
+
+	void operator= ( KeyValueMapPair const& rhs ) { arena = rhs.arena; bytes = rhs.bytes; keySize = rhs.keySize; valueSize = rhs.valueSize; }
+	KeyValueMapPair( KeyValueMapPair const& rhs ) : arena(rhs.arena), bytes(rhs.bytes), keySize(rhs.keySize), valueSize(rhs.valueSize) {}
+
+	KeyValueMapPair(KeyRef key, ValueRef value) : arena(key.size() + value.size()), keySize(key.size()), valueSize(value.size()) {
+		uint8_t* b = new (arena) uint8_t[keySize + valueSize];
+		memcpy(b, key.begin(), keySize);
+		memcpy(b + keySize, value.begin(), valueSize);
+		bytes = b;
+	}
 
-	KeyValueMapPair(KeyRef key, ValueRef value) : arena(key.expectedSize() + value.expectedSize()), key(arena, key), value(arena, value) { }
+	KeyRef key() const { return KeyRef(bytes, keySize); }
+	ValueRef value() const { return ValueRef(bytes + keySize, valueSize); }
 
-	bool operator<(KeyValueMapPair const& r) const { return key < r.key; }
-	bool operator==(KeyValueMapPair const& r) const { return key == r.key; }
-	bool operator!=(KeyValueMapPair const& r) const { return key != r.key; }
+	bool operator<(KeyValueMapPair const& r) const { return key() < r.key(); }
+	bool operator==(KeyValueMapPair const& r) const { return key() == r.key(); }
+	bool operator!=(KeyValueMapPair const& r) const { return key() != r.key(); }
 };
 
 template <class CompatibleWithKey>
-bool operator<(KeyValueMapPair const& l, CompatibleWithKey const& r) { return l.key < r; }
+bool operator<(KeyValueMapPair const& l, CompatibleWithKey const& r) { return l.key() < r; }
 
 template <class CompatibleWithKey>
-bool operator<(CompatibleWithKey const& l, KeyValueMapPair const& r) { return l < r.key; }
+bool operator<(CompatibleWithKey const& l, KeyValueMapPair const& r) { return l < r.key(); }
 
 extern bool noUnseed;
 
 class KeyValueStoreMemory : public IKeyValueStore, NonCopyable {
 public:
-	KeyValueStoreMemory( IDiskQueue* log, UID id, int64_t memoryLimit, bool disableSnapshot );
+	KeyValueStoreMemory( IDiskQueue* log, UID id, int64_t memoryLimit, bool disableSnapshot, int readThreadCount = 0 );
 
 	// IClosable
-	virtual Future<Void> getError() { return log->getError(); }
+	virtual Future<Void> getError() { return readThreads ? log->getError() || readThreads->getError() : log->getError(); }
 	virtual Future<Void> onClosed() { return log->onClosed(); }
-	virtual void dispose() { recovering.cancel(); log->dispose(); delete this; }
-	virtual void close() { recovering.cancel(); log->close(); delete this; }
+	virtual void dispose() { recovering.cancel(); if(readThreads) stopReadThreadsAndClose(this, true); else { log->dispose(); delete this; } }
+	virtual void close() { recovering.cancel(); if(readThreads) stopReadThreadsAndClose(this, false); else { log->close(); delete this; } }
 
 	// IKeyValueStore
 	virtual KeyValueStoreType getType() { return KeyValueStoreType::MEMORY; }
@@ -110,6 +126,7 @@ public:
 			return;
 
 		if(transactionIsLarge) {
+			DataWriteHolder holder( dataLock );
 			KeyValueMapPair pair(keyValue.key, keyValue.value);
 			data.insert(pair, pair.arena.getSize() + data.getElementBytes());
 		}
@@ -127,6 +144,7 @@ public:
 			return;
 
 		if(transactionIsLarge) {
+			DataWriteHolder holder( dataLock );
 			data.erase(data.lower_bound(range.begin), data.lower_bound(range.end));
 		}
 		else {
@@ -195,52 +213,41 @@ public:
 		if(recovering.isError()) throw recovering.getError();
 		if (!recovering.isReady()) return waitAndReadValue(this, key);
 
-		auto it = data.find(key);
-		if (it == data.end()) return Optional<Value>();
-		return Optional<Value>(it->value);
+		if(readThreads) {
+			auto p = new Reader::ReadValueAction(key);
+			auto f = p->result.getFuture();
+			readThreads->post(p);
+			return f;
+		}
+		return getValue(key);
 	}
 
 	virtual Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID = Optional<UID>() ) {
 		if(recovering.isError()) throw recovering.getError();
 		if (!recovering.isReady()) return waitAndReadValuePrefix(this, key, maxLength);
 
-		auto it = data.find(key);
-		if (it == data.end()) return Optional<Value>();
-		auto val = it->value;
-		if(maxLength < val.size()) {
-			return Optional<Value>(val.substr(0, maxLength));
-		}
-		else {
-			return Optional<Value>(val);
+		if(readThreads) {
+			auto p = new Reader::ReadValuePrefixAction(key, maxLength);
+			auto f = p->result.getFuture();
+			readThreads->post(p);
+			return f;
 		}
+		return getValuePrefix(key, maxLength);
 	}
 
 	// If rowLimit>=0, reads first rows sorted ascending, otherwise reads last rows sorted descending
 	// The total size of the returned value (less the last entry) will be less than byteLimit
-	virtual Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30 ) {
+	virtual Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30, ReadType type = READ_NORMAL ) {
 		if(recovering.isError()) throw recovering.getError();
 		if (!recovering.isReady()) return waitAndReadRange(this, keys, rowLimit, byteLimit);
 
-		Standalone<VectorRef<KeyValueRef>> result;
-		if (rowLimit >= 0) {
-			auto it = data.lower_bound(keys.begin);
-			while (it!=data.end() && it->key < keys.end && rowLimit && byteLimit>=0) {
-				byteLimit -= sizeof(KeyValueRef) + it->key.size() + it->value.size();
-				result.push_back_deep( result.arena(), KeyValueRef(it->key, it->value) );
-				++it;
-				--rowLimit;
-			}
-		} else {
-			rowLimit = -rowLimit;
-			auto it = data.previous( data.lower_bound(keys.end) );
-			while (it!=data.end() && it->key >= keys.begin && rowLimit && byteLimit>=0) {
-				byteLimit -= sizeof(KeyValueRef) + it->key.size() + it->value.size();
-				result.push_back_deep( result.arena(), KeyValueRef(it->key, it->value) );
-				it = data.previous(it);
-				--rowLimit;
-			}
+		if(readThreads) {
+			auto p = new Reader::ReadRangeAction(keys, rowLimit, byteLimit);
+			auto f = p->result.getFuture();
+			readThreads->post(p);
+			return f;
 		}
-		return result;
+		return getRange(keys, rowLimit, byteLimit);
 	}
 
 	virtual void resyncLog() {
@@ -336,6 +343,114 @@ private:
 
 	IndexedSet< KeyValueMapPair, uint64_t > data;
 
+	// With read threads, any number of them may search data at once, but not while the network thread is modifying it.  A
+	// reader registers itself while holding mutex; a modification holds mutex, so that no new readers can register, and waits
+	// for the registered readers to finish.
+	struct DataLock : NonCopyable {
+		Mutex mutex;
+		std::atomic<int> readers;
+		DataLock() : readers(0) {}
+	};
+	struct DataReadHolder : NonCopyable {
+		DataLock& lock;
+		explicit DataReadHolder( DataLock& lock ) : lock(lock) { MutexHolder h(lock.mutex); ++lock.readers; }
+		~DataReadHolder() { --lock.readers; }
+	};
+	struct DataWriteHolder : NonCopyable {
+		DataLock& lock;
+		explicit DataWriteHolder( DataLock& lock ) : lock(lock) {
+			lock.mutex.enter();
+			while (lock.readers.load())
+				threadYield();
+		}
+		~DataWriteHolder() { lock.mutex.leave(); }
+	};
+	DataLock dataLock;
+	Reference<IThreadPool> readThreads;  // Only if KVS_MEMORY_READ_THREADS > 0
+
+	Optional<Value> getValue( KeyRef key ) {
+		auto it = data.find(key);
+		if (it == data.end()) return Optional<Value>();
+		return Optional<Value>(it->value());
+	}
+
+	Optional<Value> getValuePrefix( KeyRef key, int maxLength ) {
+		auto it = data.find(key);
+		if (it == data.end()) return Optional<Value>();
+		auto val = it->value();
+		if(maxLength < val.size()) {
+			return Optional<Value>(val.substr(0, maxLength));
+		}
+		else {
+			return Optional<Value>(val);
+		}
+	}
+
+	Standalone<VectorRef<KeyValueRef>> getRange( KeyRangeRef keys, int rowLimit, int byteLimit ) {
+		Standalone<VectorRef<KeyValueRef>> result;
+		if (rowLimit >= 0) {
+			auto it = data.lower_bound(keys.begin);
+			while (it!=data.end() && it->key() < keys.end && rowLimit && byteLimit>=0) {
+				byteLimit -= sizeof(KeyValueRef) + it->key().size() + it->value().size();
+				result.push_back_deep( result.arena(), KeyValueRef(it->key(), it->value()) );
+				++it;
+				--rowLimit;
+			}
+		} else {
+			rowLimit = -rowLimit;
+			auto it = data.previous( data.lower_bound(keys.end) );
+			while (it!=data.end() && it->key() >= keys.begin && rowLimit && byteLimit>=0) {
+				byteLimit -= sizeof(KeyValueRef) + it->key().size() + it->value().size();
+				result.push_back_deep( result.arena(), KeyValueRef(it->key(), it->value()) );
+				it = data.previous(it);
+				--rowLimit;
+			}
+		}
+		return result;
+	}
+
+	struct Reader : IThreadPoolReceiver {
+		KeyValueStoreMemory* store;
+
+		explicit Reader( KeyValueStoreMemory* store ) : store(store) {}
+		virtual void init() {}
+
+		struct ReadValueAction : TypedAction<Reader, ReadValueAction>, FastAllocated<ReadValueAction> {
+			Key key;
+			ThreadReturnPromise<Optional<Value>> result;
+			explicit ReadValueAction(KeyRef key) : key(key) {}
+			virtual double getTimeEstimate() { return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE; }
+		};
+		void action( ReadValueAction& rv ) {
+			DataReadHolder holder( store->dataLock );
+			rv.result.send( store->getValue(rv.key) );
+		}
+
+		struct ReadValuePrefixAction : TypedAction<Reader, ReadValuePrefixAction>, FastAllocated<ReadValuePrefixAction> {
+			Key key;
+			int maxLength;
+			ThreadReturnPromise<Optional<Value>> result;
+			ReadValuePrefixAction(KeyRef key, int maxLength) : key(key), maxLength(maxLength) {}
+			virtual double getTimeEstimate() { return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE; }
+		};
+		void action( ReadValuePrefixAction& rv ) {
+			DataReadHolder holder( store->dataLock );
+			rv.result.send( store->getValuePrefix(rv.key, rv.maxLength) );
+		}
+
+		struct ReadRangeAction : TypedAction<Reader, ReadRangeAction>, FastAllocated<ReadRangeAction> {
+			KeyRange keys;
+			int rowLimit, byteLimit;
+			ThreadReturnPromise<Standalone<VectorRef<KeyValueRef>>> result;
+			ReadRangeAction(KeyRangeRef keys, int rowLimit, int byteLimit) : keys(keys), rowLimit(rowLimit), byteLimit(byteLimit) {}
+			virtual double getTimeEstimate() { return SERVER_KNOBS->READ_RANGE_TIME_ESTIMATE; }
+		};
+		void action( ReadRangeAction& rr ) {
+			DataReadHolder holder( store->dataLock );
+			rr.result.send( store->getRange(rr.keys, rr.rowLimit, rr.byteLimit) );
+		}
+	};
+
 	OpQueue queue; // mutations not yet commit()ted
 	IDiskQueue *log;
 	Future<Void> recovering, snapshotting;
@@ -358,6 +473,7 @@ private:
 	std::vector<std::pair<KeyValueMapPair, uint64_t>> dataSets;
 
 	int64_t commit_queue(OpQueue &ops, bool log, bool sequential = false) {
+		DataWriteHolder holder( dataLock );
 		int64_t total = 0, count = 0;
 		IDiskQueue::location log_location = 0;
 
@@ -586,8 +702,8 @@ private:
 		int count = 0;
 		int64_t snapshotSize = 0;
 		for(auto kv = snapshotData.begin(); kv != snapshotData.end(); ++kv) {
-			log_op(OpSnapshotItem, kv->key, kv->value);
-			snapshotSize += kv->key.size() + kv->value.size() + OP_DISK_OVERHEAD;
+			log_op(OpSnapshotItem, kv->key(), kv->value());
+			snapshotSize += kv->key().size() + kv->value().size() + OP_DISK_OVERHEAD;
 			++count;
 		}
 
@@ -622,7 +738,6 @@ private:
 				self->resetSnapshot = false;
 			}
 
-			auto next = nextKeyAfter ? self->data.upper_bound(nextKey) : self->data.lower_bound(nextKey);
 			int diff = self->notifiedCommittedWriteBytes.get() - snapshotTotalWrittenBytes;
 			if( diff > lastDiff && diff > 5e7 )
 				TraceEvent(SevWarnAlways, "ManyWritesAtOnce", self->id)
@@ -632,50 +747,80 @@ private:
 					.detail("LastOperationWasASnapshot", nextKey == Key() && !nextKeyAfter);
 			lastDiff = diff;
 
-			if (next == self->data.end()) {
-				auto thisSnapshotEnd = self->log_op( OpSnapshotEnd, StringRef(), StringRef() );
-				//TraceEvent("SnapshotEnd", self->id)
-				//	.detail("lastKey", printable(lastKey.present() ? lastKey.get() : LiteralStringRef("<none>")))
-				//	.detail("currentSnapshotEndLoc", self->currentSnapshotEnd)
-				//	.detail("previousSnapshotEndLoc", self->previousSnapshotEnd)
-				//	.detail("thisSnapshotEnd", thisSnapshotEnd)
-				//	.detail("Items", snapItems)
-				//	.detail("CommittedWrites", self->notifiedCommittedWriteBytes.get())
-				//	.detail("SnapshotSize", snapshotBytes);
-
-				ASSERT(thisSnapshotEnd >= self->currentSnapshotEnd);
-				self->previousSnapshotEnd = self->currentSnapshotEnd;
-				self->currentSnapshotEnd = thisSnapshotEnd;
-				nextKey = Key();
-				nextKeyAfter = false;
-				snapItems = 0;
-
-				snapshotBytes = 0;
-
-				snapshotTotalWrittenBytes += OP_DISK_OVERHEAD;
-			} else {
-				self->log_op( OpSnapshotItem, next->key, next->value );
-				nextKey = next->key;
-				nextKeyAfter = true;
-				snapItems++;
-				uint64_t opBytes = next->key.size() + next->value.size() + OP_DISK_OVERHEAD;
-				snapshotBytes += opBytes;
-				snapshotTotalWrittenBytes += opBytes;
+			// Write snapshot items until the snapshot has caught up with committed writes, or until a batch of
+			// KVS_MEMORY_SNAPSHOT_BATCH_BYTES has been written.  Nothing can modify data until we wait, so a single search
+			// finds the start of the whole batch.
+			auto next = nextKeyAfter ? self->data.upper_bound(nextKey) : self->data.lower_bound(nextKey);
+			uint64_t batchBytes = 0;
+			while( snapshotTotalWrittenBytes < self->notifiedCommittedWriteBytes.get() && batchBytes < SERVER_KNOBS->KVS_MEMORY_SNAPSHOT_BATCH_BYTES ) {
+				if (next == self->data.end()) {
+					auto thisSnapshotEnd = self->log_op( OpSnapshotEnd, StringRef(), StringRef() );
+					//TraceEvent("SnapshotEnd", self->id)
+					//	.detail("lastKey", printable(lastKey.present() ? lastKey.get() : LiteralStringRef("<none>")))
+					//	.detail("currentSnapshotEndLoc", self->currentSnapshotEnd)
+					//	.detail("previousSnapshotEndLoc", self->previousSnapshotEnd)
+					//	.detail("thisSnapshotEnd", thisSnapshotEnd)
+					//	.detail("Items", snapItems)
+					//	.detail("CommittedWrites", self->notifiedCommittedWriteBytes.get())
+					//	.detail("SnapshotSize", snapshotBytes);
+
+					ASSERT(thisSnapshotEnd >= self->currentSnapshotEnd);
+					self->previousSnapshotEnd = self->currentSnapshotEnd;
+					self->currentSnapshotEnd = thisSnapshotEnd;
+					nextKey = Key();
+					nextKeyAfter = false;
+					snapItems = 0;
+
+					snapshotBytes = 0;
+
+					snapshotTotalWrittenBytes += OP_DISK_OVERHEAD;
+					batchBytes += OP_DISK_OVERHEAD;
+					next = self->data.begin();
+				} else {
+					self->log_op( OpSnapshotItem, next->key(), next->value() );
+					nextKey = next->key();
+					nextKeyAfter = true;
+					snapItems++;
+					uint64_t opBytes = next->key().size() + next->value().size() + OP_DISK_OVERHEAD;
+					snapshotBytes += opBytes;
+					snapshotTotalWrittenBytes += opBytes;
+					batchBytes += opBytes;
+					++next;
+				}
 			}
+
+			// Let commits and reads run between batches
+			Void _ = wait( yield() );
 		}
 	}
 
 	ACTOR static Future<Optional<Value>> waitAndReadValue( KeyValueStoreMemory* self, Key key ) {
 		Void _ = wait( self->recovering );
-		return self->readValue(key).get();
+		Optional<Value> value = wait( self->readValue(key) );
+		return value;
 	}
 	ACTOR static Future<Optional<Value>> waitAndReadValuePrefix( KeyValueStoreMemory* self, Key key, int maxLength) {
 		Void _ = wait( self->recovering );
-		return self->readValuePrefix(key, maxLength).get();
+		Optional<Value> value = wait( self->readValuePrefix(key, maxLength) );
+		return value;
 	}
 	ACTOR static Future<Standalone<VectorRef<KeyValueRef>>> waitAndReadRange( KeyValueStoreMemory* self, KeyRange keys, int rowLimit, int byteLimit ) {
 		Void _ = wait( self->recovering );
-		return self->readRange(keys, rowLimit, byteLimit).get();
+		Standalone<VectorRef<KeyValueRef>> result = wait( self->readRange(keys, rowLimit, byteLimit) );
+		return result;
+	}
+	ACTOR static void stopReadThreadsAndClose( KeyValueStoreMemory* self, bool dispose ) {
+		// The read threads search data, so they must all have stopped before it is destroyed
+		try {
+			Void _ = wait( self->readThreads->stop() );
+		} catch( Error &e ) {
+			TraceEvent(SevError, "KVSMemReadThreadsStopError", self->id).error(e, true);
+		}
+		if (dispose)
+			self->log->dispose();
+		else
+			self->log->close();
+		delete self;
 	}
 	ACTOR static Future<Void> waitAndCommit(KeyValueStoreMemory* self, bool sequential) {
 		Void _ = wait(self->recovering);
@@ -689,7 +834,7 @@ private:
 	}
 };
 
-KeyValueStoreMemory::KeyValueStoreMemory( IDiskQueue* log, UID id, int64_t memoryLimit, bool disableSnapshot )
+KeyValueStoreMemory::KeyValueStoreMemory( IDiskQueue* log, UID id, int64_t memoryLimit, bool disableSnapshot, int readThreadCount )
 	: log(log), id(id), previousSnapshotEnd(-1), currentSnapshotEnd(-1),
 	  resetSnapshot(false), memoryLimit(memoryLimit), committedWriteBytes(0),
 	  committedDataSize(0), transactionSize(0), transactionIsLarge(false), disableSnapshot(disableSnapshot)
@@ -697,12 +842,19 @@ KeyValueStoreMemory::KeyValueStoreMemory( IDiskQueue* log, UID id, int64_t memor
 	recovering = recover( this );
 	snapshotting = snapshot( this );
 	commitActors = actorCollection( addActor.getFuture() );
+
+	if( readThreadCount > 0 ) {
+		// Coroutines keep simulation deterministic; real threads are what let reads use more than one core
+		readThreads = g_network->isSimulated() ? CoroThreadPool::createThreadPool() : createGenericThreadPool();
+		for(int i=0; i<readThreadCount; i++)
+			readThreads->addThread( new Reader(this) );
+	}
 }
 
 IKeyValueStore* keyValueStoreMemory( std::string const& basename, UID logID, int64_t memoryLimit ) {
 	TraceEvent("KVSMemOpening", logID).detail("Basename", basename).detail("MemoryLimit", memoryLimit);
 	IDiskQueue *log = openDiskQueue( basename, logID );
-	return new KeyValueStoreMemory( log, logID, memoryLimit, false );
+	return new KeyValueStoreMemory( log, logID, memoryLimit, false, SERVER_KNOBS->KVS_MEMORY_READ_THREADS );
 }
 
 IKeyValueStore* keyValueStoreLogSystem( class IDiskQueue* queue, UID logID, int64_t memoryLimit, bool disableSnapshot ) {
@@ -25,6 +25,7 @@
 #include "CoroFlow.h"
 #include "Knobs.h"
 #include "flow/Hash3.h"
+#include "fdbrpc/crc32c.h"
 
 extern "C" {
 #include "sqlite/sqliteInt.h"
@@ -64,6 +65,18 @@ struct SpringCleaningStats {
 	SpringCleaningStats() : springCleaningCount(0), lazyDeletePages(0), vacuumedPages(0), springCleaningTime(0.0), vacuumTime(0.0), lazyDeleteTime(0.0) {}
 };
 
+// Time the single writer thread spends committing, as opposed to applying sets and clears, so that DiskMetrics shows when it is saturated
+struct WriterCommitStats {
+	int64_t commits;
+	double commitTime;		// Committing the SQLite transaction to the WAL
+	double checkpointTime;	// Checkpointing the WAL into the database file, which is where the commit becomes durable
+	double checkpointDeferTime;	// Waiting for queued reads to drain before checkpointing
+	int64_t checkpointFrames;	// WAL frames (pages) copied into the database file
+	int lastCheckpointFrames;	// The checkpoint backlog: WAL frames written by the last commit
+
+	WriterCommitStats() : commits(0), commitTime(0.0), checkpointTime(0.0), checkpointDeferTime(0.0), checkpointFrames(0), lastCheckpointFrames(0) {}
+};
+
 struct PageChecksumCodec {
 	PageChecksumCodec(std::string const &filename) : pageSize(0), reserveSize(0), filename(filename), silent(false) {}
 
@@ -79,6 +92,21 @@ struct PageChecksumCodec {
 		std::string toString() { return format("0x%08x%08x", part1, part2); }
 	};
 
+	// A crc32c sum keeps this in part2 so that it can be told apart from a hashlittle2 sum
+	enum { CRC32C_MARKER = 0xc32cc32c };
+
+	static void calculateSum(Pgno pageNumber, char *pData, int dataLen, bool useCrc32c, SumType *sum) {
+		if(useCrc32c) {
+			sum->part1 = crc32c_append(pageNumber, (const uint8_t *)pData, dataLen);
+			sum->part2 = CRC32C_MARKER;
+		}
+		else {
+			sum->part1 = pageNumber; //DO NOT CHANGE
+			sum->part2 = 0x5ca1ab1e;
+			hashlittle2(pData, dataLen, &sum->part1, &sum->part2);
+		}
+	}
+
 	// Calculates and then either stores or verifies a checksum.
 	// The checksum is read/stored at the end of the page buffer.
 	// Page size is passed in as pageLen because this->pageSize is not always appropriate.
@@ -94,10 +122,16 @@ struct PageChecksumCodec {
 		SumType *pSumInPage = (SumType *)(pData + dataLen);
 
 		// Write sum directly to page or to sum variable based on mode
-		SumType *sumOut = write ? pSumInPage : &sum;
-		sumOut->part1 = pageNumber; //DO NOT CHANGE
-		sumOut->part2 = 0x5ca1ab1e;
-		hashlittle2(pData, dataLen, &sumOut->part1, &sumOut->part2);
+		if(write) {
+			calculateSum(pageNumber, pData, dataLen, SERVER_KNOBS->USE_CRC32C_PAGE_CHECKSUMS, pSumInPage);
+		}
+		else {
+			// Pages are verified the way they say they were written.  A hashlittle2 sum can end in the marker by chance.
+			bool crc32c = pSumInPage->part2 == CRC32C_MARKER;
+			calculateSum(pageNumber, pData, dataLen, crc32c, &sum);
+			if(crc32c && sum != *pSumInPage)
+				calculateSum(pageNumber, pData, dataLen, false, &sum);
+		}
 
 		// Verify if not in write mode
 		if(!write && sum != *pSumInPage) {
@@ -182,6 +216,7 @@ struct SQLiteDB : NonCopyable {
 	Reference<IAsyncFile> dbFile, walFile;
 	bool page_checksums;
 	bool fragment_values;
+	int newPageSize;  // The page size of the file if open() has to create it; an existing file keeps the page size in its header
 	PageChecksumCodec *pPagerCodec;  // we do NOT own this pointer, db does.
 
 	void beginTransaction(bool write) {
@@ -197,7 +232,9 @@ struct SQLiteDB : NonCopyable {
 	void open(bool writable);
 	void createFromScratch();
 
-	SQLiteDB( std::string filename, bool page_checksums, bool fragment_values): filename(filename), db(NULL), btree(NULL), table(-1), freetable(-1), haveMutex(false), page_checksums(page_checksums), fragment_values(fragment_values) {}
+	SQLiteDB( std::string filename, bool page_checksums, bool fragment_values, int newPageSize = 0 )
+		: filename(filename), db(NULL), btree(NULL), table(-1), freetable(-1), haveMutex(false), page_checksums(page_checksums), fragment_values(fragment_values),
+		  newPageSize(newPageSize ? newPageSize : SERVER_KNOBS->SQLITE_PAGE_SIZE) {}
 
 	~SQLiteDB() {
 		if (db) {
@@ -208,6 +245,26 @@ struct SQLiteDB : NonCopyable {
 		}
 	}
 
+	// Only meaningful once the database header has been read, e.g. inside a transaction
+	int pageSize() {
+		return sqlite3BtreeGetPageSize(btree);
+	}
+
+	// The largest fragment key and value bytes that fit in a primary btree page, and the value bytes in an overflow page.  The knobs
+	// describe 4KB pages; for other page sizes the same SQLite formulas are applied to this database's usable page size.
+	void getFragmentPageUsable( int& primaryPageUsable, int& overflowPageUsable ) {
+		int size = pageSize();
+		if(size == 4096) {
+			primaryPageUsable = SERVER_KNOBS->SQLITE_FRAGMENT_PRIMARY_PAGE_USABLE;
+			overflowPageUsable = SERVER_KNOBS->SQLITE_FRAGMENT_OVERFLOW_PAGE_USABLE;
+			return;
+		}
+		int usable = size - (4096 - SERVER_KNOBS->SQLITE_BTREE_PAGE_USABLE);
+		int cellMaxLocal = (usable - 12) * 64/255 - 23;
+		primaryPageUsable = SERVER_KNOBS->SQLITE_FRAGMENT_PRIMARY_PAGE_USABLE + (cellMaxLocal - SERVER_KNOBS->SQLITE_BTREE_CELL_MAX_LOCAL);
+		overflowPageUsable = SERVER_KNOBS->SQLITE_FRAGMENT_OVERFLOW_PAGE_USABLE + (usable - SERVER_KNOBS->SQLITE_BTREE_PAGE_USABLE);
+	}
+
 	void initPagerCodec() {
 		if(page_checksums) {
 			int r = sqlite3_test_control(SQLITE_TESTCTRL_RESERVE, db, sizeof(PageChecksumCodec::SumType));
@@ -238,7 +295,8 @@ struct SQLiteDB : NonCopyable {
 			throw err;
 		}
 	}
-	void checkpoint( bool restart ) {
+	// Returns the number of frames that were in the WAL
+	int checkpoint( bool restart ) {
 		int logSize=0, checkpointCount=0;
 		//double t = timer();
 		while (true) {
@@ -252,6 +310,7 @@ struct SQLiteDB : NonCopyable {
 				checkError("checkpoint", rc);
 		}
 		//printf("Checkpoint (%0.1f ms): %d frames in log, %d checkpointed\n", (timer()-t)*1000, logSize, checkpointCount);
+		return logSize;
 	}
 	uint32_t freePages() {
 		u32 fp = 0;
@@ -263,8 +322,22 @@ struct SQLiteDB : NonCopyable {
 		if (rc && rc != SQLITE_DONE) checkError("vacuum", rc);
 		return rc == SQLITE_DONE;
 	}
+	// Switches reads of the database file between the page cache and large read ahead around it (see SQLITE_FCNTL_BULK_READ in
+	// VFSAsync).  This is only a hint, so a VFS which doesn't implement it is not an error.
+	void setBulkRead( bool on ) {
+		int arg = on;
+		sqlite3_file_control(db, 0, SQLITE_FCNTL_BULK_READ, &arg);
+	}
+	struct BulkReadScope : NonCopyable {
+		SQLiteDB& db;
+		bool on;
+		BulkReadScope( SQLiteDB& db, bool on ) : db(db), on(on) { if (on) db.setBulkRead(true); }
+		~BulkReadScope() { if (on) db.setBulkRead(false); }
+	};
+
 	int check(bool verbose) {
 		int errors = 0;
+		BulkReadScope bulk( *this, true );
 		int tables[] = {1, table, freetable};
 		TraceEvent("BTreeIntegrityCheckBegin").detail("Filename", filename);
 		char* e = sqlite3BtreeIntegrityCheck(btree, tables, 3, 1000, &errors, verbose);
@@ -730,8 +803,8 @@ struct RawCursor {
 				seekResult = moveTo(kv.key, true);
 			}
 
-			const int primaryPageUsable = SERVER_KNOBS->SQLITE_FRAGMENT_PRIMARY_PAGE_USABLE;
-			const int overflowPageUsable = SERVER_KNOBS->SQLITE_FRAGMENT_OVERFLOW_PAGE_USABLE;
+			int primaryPageUsable, overflowPageUsable;
+			db.getFragmentPageUsable(primaryPageUsable, overflowPageUsable);
 
 			int fragments = 1;
 			int valuePerFragment = kv.value.size();
@@ -828,21 +901,32 @@ struct RawCursor {
 			remove();
 		}
 	}
-	void fastClear( KeyRangeRef keys, bool& freeTableEmpty ) {
+	// Unlinks the subtrees under keys and records their root pages in the free table, from which lazyDelete()
+	// reclaims them a few pages at a time.  Returns true if keys is then known to be empty; otherwise the one
+	// key left at a cursor (or its fragments) must still be cleared row by row.
+	bool fastClear( KeyRangeRef keys, bool& freeTableEmpty ) {
 		vector<int> clearBuffer( SERVER_KNOBS->CLEAR_BUFFER_SIZE );
 		clearBuffer[0] = 0;
+		bool empty = false;
 
 		while (true) {
 			if (moveTo( keys.begin )<0) moveNext();
 			RawCursor endCursor(db, db.table, false);
 			if (endCursor.moveTo( keys.end )>=0) endCursor.movePrevious();
 
-			if (!valid || !endCursor
-				|| (db.fragment_values ? (decodeKVFragment(getEncodedRow()).get().key >= decodeKVFragment(endCursor.getEncodedRow()).get().key)
-				                    : (decodeKV(getEncodedRow()).key > decodeKV(endCursor.getEncodedRow()).key)
-				   )
-			)
-				break;  // If empty stop!
+			if (!valid || !endCursor) {
+				empty = true;
+				break;
+			}
+			Value firstRow = getEncodedRow(), lastRow = endCursor.getEncodedRow();
+			KeyRef first = db.fragment_values ? decodeKVFragment(firstRow).get().key : decodeKV(firstRow).key;
+			KeyRef last = db.fragment_values ? decodeKVFragment(lastRow).get().key : decodeKV(lastRow).key;
+			if (first > last) {
+				empty = true;
+				break;
+			}
+			if (db.fragment_values && first == last)
+				break;  // Fragments of a single key
 
 			int rc = sqlite3BtreeDeleteRange(cursor, endCursor.cursor, &clearBuffer[0], &clearBuffer[0]+clearBuffer.size());
 			if (rc == 201) continue;
@@ -858,6 +942,7 @@ struct RawCursor {
 			ASSERT(pagesDeleted == 0);
 			freeTableEmpty = false;
 		}
+		return empty;
 	}
 	int lazyDelete( int desiredPages ) {
 		vector<int> clearBuffer( SERVER_KNOBS->CLEAR_BUFFER_SIZE );
@@ -1120,6 +1205,66 @@ struct RawCursor {
 		return result;
 	}
 
+	// Returns up to parts-1 keys strictly within keys, in order, which divide it into pieces holding similar
+	// numbers of rows.  The keys come from the interior pages nearest the root, so only a few (usually cached)
+	// pages are read; a range too small to contain any of their cells is not split.
+	Standalone<VectorRef<KeyRef>> getSplitKeys( KeyRangeRef keys, int parts ) {
+		SplitKeyVisitor visitor(keys);
+		for(int depth = 1; depth <= 2 && visitor.candidates.size() < parts - 1; depth++) {
+			visitor.candidates = Standalone<VectorRef<KeyRef>>();
+			db.checkError("BtreeVisitInteriorCells", sqlite3BtreeVisitInteriorCells(cursor, depth, &SplitKeyVisitor::visit, &visitor));
+		}
+		valid = false;
+
+		Standalone<VectorRef<KeyRef>> const& candidates = visitor.candidates;
+		int splits = std::min<int>(parts - 1, candidates.size());
+		Standalone<VectorRef<KeyRef>> result;
+		result.arena().dependsOn(candidates.arena());
+		for(int i = 0; i < splits; i++)
+			result.push_back(result.arena(), candidates[(int64_t)(i + 1) * candidates.size() / (splits + 1)]);
+		return result;
+	}
+
+	struct SplitKeyVisitor {
+		KeyRangeRef keys;
+		Standalone<VectorRef<KeyRef>> candidates;
+		std::vector<uint8_t> buffer;
+
+		explicit SplitKeyVisitor( KeyRangeRef keys ) : keys(keys) {}
+
+		// Called by sqlite, so errors are returned rather than thrown.  Only the key field of the encoded row
+		// (the first field in both the plain and fragmented formats) is read.
+		static int visit( BtCursor* cursor, void* arg ) {
+			SplitKeyVisitor& self = *(SplitKeyVisitor*)arg;
+			i64 size;
+			int rc = sqlite3BtreeKeySize(cursor, &size);
+			if (rc) return rc;
+
+			uint8_t header[20];
+			int headerBytes = std::min<i64>(size, sizeof(header));
+			rc = sqlite3BtreeKey(cursor, 0, headerBytes, header);
+			if (rc) return rc;
+			u64 headerSize, keyCode;
+			int n = sqlite3GetVarint(header, &headerSize);
+			if (n >= headerBytes) return SQLITE_CORRUPT;
+			n += sqlite3GetVarint(header + n, &keyCode);
+			if (n > headerBytes || keyCode < 12 || (keyCode & 1)) return SQLITE_CORRUPT;
+			u64 keySize = (keyCode - 12) / 2;
+			if (headerSize + keySize > (u64)size) return SQLITE_CORRUPT;
+			if (!keySize) return SQLITE_OK;  // the empty key is never inside a range
+
+			self.buffer.resize(keySize);
+			rc = sqlite3BtreeKey(cursor, headerSize, keySize, &self.buffer[0]);
+			if (rc) return rc;
+			KeyRef key(&self.buffer[0], keySize);
+
+			// Fragments of one value may be split across cells, so skip repeats of the previous key
+			if (key > self.keys.begin && key < self.keys.end && (self.candidates.empty() || key != self.candidates.back()))
+				self.candidates.push_back_deep(self.candidates.arena(), key);
+			return SQLITE_OK;
+		}
+	};
+
 	int moveTo( KeyRef key, bool ignore_fragment_mode = false ) {
 		UnpackedRecord r;
 		r.pKeyInfo = &keyInfo;
@@ -1167,11 +1312,21 @@ struct ReadCursor : ReferenceCounted<ReadCursor>, FastAllocated<ReadCursor> {
 
 	ReadCursor() : valid(false) {}
 
-	void init(SQLiteDB& db) { new (&cursor) Cursor(db, false); valid = true; }
+	// The writer bumps commitGeneration before and after each commit, so a cursor whose transaction began while
+	//   it held the same even value on both sides sees exactly the state that generation names.  Otherwise the
+	//   cursor's generation is unknown (-1).  Parts of a split range read must agree on it.
+	void init(SQLiteDB& db, volatile int64_t const& commitGeneration) {
+		int64_t before = commitGeneration;
+		new (&cursor) Cursor(db, false);
+		valid = true;
+		generation = (before == commitGeneration && !(before & 1)) ? before : -1;
+	}
 	~ReadCursor() { if (valid) get().~Cursor(); }
 
 	Cursor& get() { return *((Cursor*)&cursor); }
 
+	int64_t generation;
+
 private:
 	std::aligned_storage< sizeof(Cursor), __alignof(Cursor) >::type cursor;
 	bool valid;
@@ -1202,7 +1357,6 @@ int SQLiteDB::checkAllPageChecksums() {
 
 	// Now that the file itself is open and locked, let sqlite open the database
 	// Note that VFSAsync will also call g_network->open (including for the WAL), so its flags are important, too
-	// TODO:  If better performance is needed, make AsyncFileReadAheadCache work and be enabled by SQLITE_OPEN_READAHEAD which was added for that purpose.
 	int result = sqlite3_open_v2(apath.c_str(), &db, SQLITE_OPEN_READONLY, NULL);
 	checkError("open", result);
 
@@ -1224,6 +1378,8 @@ int SQLiteDB::checkAllPageChecksums() {
 	haveMutex = true;
 
 	pPagerCodec->silent = true;
+	// Every page is read once, so read ahead around the page cache rather than flush it
+	setBulkRead(true);
 	Pgno p = 1;
 	int readErrors = 0;
 	int corruptPages = 0;
@@ -1272,6 +1428,44 @@ int SQLiteDB::checkAllPageChecksums() {
 	return totalErrors;
 }
 
+// The template databases hold the two empty tables in four 4KB pages.  For another page size the same pages are laid out at that
+//   size: only the page size in the header and the start of each b-tree page's (empty) cell content area depend on it, and the
+//   page checksums, if any, are recomputed.  SQLite reads the page size back from the header whenever the file is opened.
+static std::string templateDatabase( std::string const& filename, bool pageChecksums, int pageSize ) {
+	static_assert( sizeof(template_fdb_with_page_checksums) == sizeof(template_fdb_without_page_checksums), "Template databases differ in size" );
+	const char* source = pageChecksums ? template_fdb_with_page_checksums : template_fdb_without_page_checksums;
+	const int templateBytes = sizeof(template_fdb_with_page_checksums) - 1;  // without the string literal's terminator
+	const int templatePageSize = 4096;
+	const int pages = templateBytes / templatePageSize;
+
+	if(pageSize == templatePageSize)
+		return std::string(source, sizeof(template_fdb_with_page_checksums));
+
+	ASSERT( pageSize > templatePageSize && pageSize <= SQLITE_MAX_PAGE_SIZE && !(pageSize & (pageSize-1)) );
+	int reserve = pageChecksums ? sizeof(PageChecksumCodec::SumType) : 0;
+	std::string db( pages * pageSize, '\0' );
+	for(int p = 0; p < pages; p++)
+		memcpy( &db[p * pageSize], source + p * templatePageSize, templatePageSize - reserve );
+
+	auto put16 = [&db](int offset, int value) {
+		db[offset] = (value >> 8) & 0xff;
+		db[offset+1] = value & 0xff;
+	};
+	put16( 16, pageSize == 65536 ? 1 : pageSize );  // The header encodes a 64KB page size as 1
+	int contentStart = (pageSize - reserve) & 0xffff;  // ... and a cell content area starting at 64KB as 0
+	put16( 100 + 5, contentStart );  // Page 1's b-tree header follows the 100 byte database header
+	for(int p = 2; p < pages; p++)  // Page 2 is the pointer map page; pages 3 and 4 are the tables
+		put16( p * pageSize + 5, contentStart );
+
+	if(pageChecksums) {
+		PageChecksumCodec codec(filename);
+		codec.checksum( 1, &db[0], SQLITE_DEFAULT_PAGE_SIZE, true );  // See PageChecksumCodec::codec() for why page 1 has two checksums
+		for(int p = 0; p < pages; p++)
+			codec.checksum( p + 1, &db[p * pageSize], pageSize, true );
+	}
+	return db;
+}
+
 void SQLiteDB::open(bool writable) {
 	ASSERT( !haveMutex );
 	double startT = timer();
@@ -1307,12 +1501,10 @@ void SQLiteDB::open(bool writable) {
 			walFile = waitForAndGet( IAsyncFileSystem::filesystem()->open( walpath, IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_LOCK, 0600 ) );
 			waitFor( walFile.get()->sync() );
 			dbFile = waitForAndGet( IAsyncFileSystem::filesystem()->open( apath, IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_LOCK, 0600 ) );
-			if(page_checksums)
-				waitFor( dbFile.get()->write( template_fdb_with_page_checksums, sizeof(template_fdb_with_page_checksums), 0 ) );
-			else
-				waitFor( dbFile.get()->write( template_fdb_without_page_checksums, sizeof(template_fdb_without_page_checksums), 0 ) );
+			std::string dbTemplate = templateDatabase( filename, page_checksums, newPageSize );
+			waitFor( dbFile.get()->write( dbTemplate.data(), dbTemplate.size(), 0 ) );
 			waitFor( dbFile.get()->sync() ); // renames filename.part to filename, fsyncs data and directory
-			TraceEvent("CreatedDBFile").detail("Filename", apath);
+			TraceEvent("CreatedDBFile").detail("Filename", apath).detail("PageSize", newPageSize);
 		}
 	}
 	if (dbFile.isError()) throw dbFile.getError(); // If we've failed to open the file, throw an exception
@@ -1364,7 +1556,7 @@ void SQLiteDB::createFromScratch() {
 	int sqliteFlags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
 	checkError("open", sqlite3_open_v2(filename.c_str(), &db, sqliteFlags, NULL));
 
-	Statement(*this, "PRAGMA page_size = 4096").nextRow(); //fast
+	Statement(*this, "PRAGMA page_size = 4096").nextRow(); //fast; the template is always built with 4KB pages, see templateDatabase()
 	btree = db->aDb[0].pBt;
 	initPagerCodec();
 
@@ -1422,13 +1614,14 @@ public:
 
 	virtual void set( KeyValueRef keyValue, const Arena* arena = NULL );
 	virtual void clear( KeyRangeRef range, const Arena* arena = NULL );
+	virtual void ingestSorted( VectorRef<KeyValueRef> sortedKeyValues, const Arena* arena = NULL );
 	virtual Future<Void> commit(bool sequential = false);
 
 	virtual Future<Optional<Value>> readValue( KeyRef key, Optional<UID> debugID );
 	virtual Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID );
-	virtual Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30 );
+	virtual Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30, ReadType type = READ_NORMAL );
 
-	KeyValueStoreSQLite(std::string const& filename, UID logID, KeyValueStoreType type, bool checkChecksums, bool checkIntegrity);
+	KeyValueStoreSQLite(std::string const& filename, UID logID, KeyValueStoreType type, bool checkChecksums, bool checkIntegrity, int newPageSize);
 	~KeyValueStoreSQLite();
 
 	Future<Void> doClean();
@@ -1446,19 +1639,28 @@ private:
 	ThreadSafeCounter readsComplete;
 	volatile int64_t writesComplete;
 	volatile SpringCleaningStats springCleaningStats;
+	volatile WriterCommitStats writerCommitStats;
 	volatile int64_t diskBytesUsed;
 	volatile int64_t freeListPages;
+	volatile int pageSize;
+	volatile int64_t commitGeneration;
+
+	vector< Reference<ReadCursor> > readCursors;  // one per possible read thread
+	int nReadThreads;
 
-	vector< Reference<ReadCursor> > readCursors;
+	void addReadThread();
+	void postRead( PThreadAction action, ThreadPoolLane lane );
+	Future<Standalone<VectorRef<KeyRef>>> getSplitKeys( KeyRangeRef keys, int parts );
 
 	struct Reader : IThreadPoolReceiver {
 		SQLiteDB conn;
 		ThreadSafeCounter& counter;
+		volatile int64_t const& commitGeneration;
 		UID dbgid;
 		Reference<ReadCursor>* ppReadCursor;
 
-		explicit Reader( std::string const& filename, bool is_btree_v2, ThreadSafeCounter& counter, UID dbgid, Reference<ReadCursor>* ppReadCursor )
-			: conn( filename, is_btree_v2, is_btree_v2 ), counter(counter), dbgid(dbgid), ppReadCursor(ppReadCursor)
+		explicit Reader( std::string const& filename, bool is_btree_v2, ThreadSafeCounter& counter, volatile int64_t const& commitGeneration, UID dbgid, Reference<ReadCursor>* ppReadCursor )
+			: conn( filename, is_btree_v2, is_btree_v2 ), counter(counter), commitGeneration(commitGeneration), dbgid(dbgid), ppReadCursor(ppReadCursor)
 		{
 		}
 		~Reader() {
@@ -1466,6 +1668,7 @@ private:
 		}
 
 		virtual void init() {
+			setThreadName("sqlite_reader");
 			conn.open(false);
 		}
 
@@ -1473,7 +1676,7 @@ private:
 			Reference<ReadCursor> cursor = *ppReadCursor;
 			if (!cursor) {
 				*ppReadCursor = cursor = Reference<ReadCursor>(new ReadCursor);
-				cursor->init(conn);
+				cursor->init(conn, commitGeneration);
 			}
 			return cursor;
 		}
@@ -1520,15 +1723,53 @@ private:
 		struct ReadRangeAction : TypedAction<Reader, ReadRangeAction>, FastAllocated<ReadRangeAction> {
 			KeyRange keys;
 			int rowLimit, byteLimit;
+			IKeyValueStore::ReadType type;
 			ThreadReturnPromise<Standalone<VectorRef<KeyValueRef>>> result;
-			ReadRangeAction(KeyRange keys, int rowLimit, int byteLimit) : keys(keys), rowLimit(rowLimit), byteLimit(byteLimit) {}
+			ReadRangeAction(KeyRange keys, int rowLimit, int byteLimit, IKeyValueStore::ReadType type) : keys(keys), rowLimit(rowLimit), byteLimit(byteLimit), type(type) {}
 			virtual double getTimeEstimate() { return SERVER_KNOBS->READ_RANGE_TIME_ESTIMATE; }
 		};
 		void action( ReadRangeAction& rr ) {
+			SQLiteDB::BulkReadScope bulk( conn, rr.type == IKeyValueStore::READ_BULK );
 			rr.result.send( getCursor()->get().getRange(rr.keys, rr.rowLimit, rr.byteLimit) );
 			++counter;
 		}
+
+		struct RangeReadPart {
+			Standalone<VectorRef<KeyValueRef>> rows;
+			int64_t generation;  // of the cursor the rows were read with
+			RangeReadPart() : generation(-1) {}
+		};
+		struct ReadRangePartAction : TypedAction<Reader, ReadRangePartAction>, FastAllocated<ReadRangePartAction> {
+			KeyRange keys;
+			int rowLimit, byteLimit;
+			IKeyValueStore::ReadType type;
+			ThreadReturnPromise<RangeReadPart> result;
+			ReadRangePartAction(KeyRange keys, int rowLimit, int byteLimit, IKeyValueStore::ReadType type) : keys(keys), rowLimit(rowLimit), byteLimit(byteLimit), type(type) {}
+			virtual double getTimeEstimate() { return SERVER_KNOBS->READ_RANGE_TIME_ESTIMATE; }
+		};
+		void action( ReadRangePartAction& rr ) {
+			SQLiteDB::BulkReadScope bulk( conn, rr.type == IKeyValueStore::READ_BULK );
+			Reference<ReadCursor> cursor = getCursor();
+			RangeReadPart part;
+			part.rows = cursor->get().getRange(rr.keys, rr.rowLimit, rr.byteLimit);
+			part.generation = cursor->generation;
+			rr.result.send( part );
+			++counter;
+		}
+
+		struct GetSplitKeysAction : TypedAction<Reader, GetSplitKeysAction>, FastAllocated<GetSplitKeysAction> {
+			KeyRange keys;
+			int parts;
+			ThreadReturnPromise<Standalone<VectorRef<KeyRef>>> result;
+			GetSplitKeysAction(KeyRange keys, int parts) : keys(keys), parts(parts) {}
+			virtual double getTimeEstimate() { return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE; }
+		};
+		void action( GetSplitKeysAction& sk ) {
+			sk.result.send( getCursor()->get().getSplitKeys(sk.keys, sk.parts) );
+			++counter;
+		}
 	};
+	Future<Reader::RangeReadPart> readRangePart( KeyRangeRef keys, int rowLimit, int byteLimit, ReadType type );
 
 	struct Writer : IThreadPoolReceiver {
 		SQLiteDB conn;
@@ -1537,22 +1778,32 @@ private:
 		int setsThisCommit;
 		bool freeTableEmpty; // true if we are sure the freetable (pages pending lazy deletion) is empty
 		volatile int64_t& writesComplete;
+		int64_t const& readsRequested;
+		ThreadSafeCounter const& readsComplete;
 		volatile SpringCleaningStats& springCleaningStats;
+		volatile WriterCommitStats& writerCommitStats;
 		volatile int64_t& diskBytesUsed;
 		volatile int64_t& freeListPages;
+		volatile int& pageSize;
+		volatile int64_t& commitGeneration;
 		UID dbgid;
 		vector<Reference<ReadCursor>>& readThreads;
 		bool checkAllChecksumsOnOpen;
 		bool checkIntegrityOnOpen;
 
-		explicit Writer( std::string const& filename, bool isBtreeV2, bool checkAllChecksumsOnOpen, bool checkIntegrityOnOpen, volatile int64_t& writesComplete, volatile SpringCleaningStats& springCleaningStats, volatile int64_t& diskBytesUsed, volatile int64_t& freeListPages, UID dbgid, vector<Reference<ReadCursor>>* pReadThreads )
-			: conn( filename, isBtreeV2, isBtreeV2 ),
+		explicit Writer( std::string const& filename, bool isBtreeV2, bool checkAllChecksumsOnOpen, bool checkIntegrityOnOpen, volatile int64_t& writesComplete, int64_t const& readsRequested, ThreadSafeCounter const& readsComplete, volatile SpringCleaningStats& springCleaningStats, volatile WriterCommitStats& writerCommitStats, volatile int64_t& diskBytesUsed, volatile int64_t& freeListPages, volatile int& pageSize, volatile int64_t& commitGeneration, UID dbgid, vector<Reference<ReadCursor>>* pReadThreads, int newPageSize )
+			: conn( filename, isBtreeV2, isBtreeV2, newPageSize ),
 			  commits(), setsThisCommit(),
 			  freeTableEmpty(false),
 			  writesComplete(writesComplete),
+			  readsRequested(readsRequested),
+			  readsComplete(readsComplete),
 			  springCleaningStats(springCleaningStats),
+			  writerCommitStats(writerCommitStats),
 			  diskBytesUsed(diskBytesUsed),
 			  freeListPages(freeListPages),
+			  pageSize(pageSize),
+			  commitGeneration(commitGeneration),
 			  cursor(NULL),
 			  dbgid(dbgid),
 			  readThreads(*pReadThreads),
@@ -1566,6 +1817,7 @@ private:
 			TraceEvent("KVWriterDestroyed", dbgid);
 		}
 		virtual void init() {
+			setThreadName("sqlite_writer");
 			if(checkAllChecksumsOnOpen) {
 				if(conn.checkAllPageChecksums() != 0) {
 					// It's not strictly necessary to discard the file immediately if a page checksum error is found
@@ -1583,6 +1835,7 @@ private:
 			fullCheckpoint();
 
 			cursor = new Cursor(conn, true);
+			pageSize = conn.pageSize();
 
 			if (checkIntegrityOnOpen || EXPENSIVE_VALIDATION) {
 				if(conn.check(false) != 0) {
@@ -1620,6 +1873,22 @@ private:
 				TraceEvent("SetActionFinished", dbgid).detail("Elapsed", now()-s);
 		}
 
+		struct IngestSortedAction : TypedAction<Writer, IngestSortedAction>, FastAllocated<IngestSortedAction> {
+			Standalone<VectorRef<KeyValueRef>> kvs;
+			IngestSortedAction( VectorRef<KeyValueRef> const& sorted ) {
+				kvs.append_deep( kvs.arena(), sorted.begin(), sorted.size() );
+			}
+			virtual double getTimeEstimate() { return SERVER_KNOBS->SET_TIME_ESTIMATE * kvs.size(); }
+		};
+		void action(IngestSortedAction& a) {
+			for(auto& kv : a.kvs) {
+				checkFreePages();
+				cursor->set(kv);
+			}
+			setsThisCommit += a.kvs.size();
+			++writesComplete;
+		}
+
 		struct ClearAction : TypedAction<Writer, ClearAction>, FastAllocated<ClearAction> {
 			KeyRange range;
 			ClearAction( KeyRange range ) : range(range) {}
@@ -1627,8 +1896,8 @@ private:
 		};
 		void action(ClearAction& a) {
 			double s = now();
-			cursor->fastClear(a.range, freeTableEmpty);
-			cursor->clear(a.range);  // TODO: at most one
+			if (!cursor->fastClear(a.range, freeTableEmpty))
+				cursor->clear(a.range);
 			++writesComplete;
 			if (g_network->isSimulated() && g_simulator.getCurrentProcess()->rebooting)
 				TraceEvent("ClearActionFinished", dbgid).detail("Elapsed", now()-s);
@@ -1642,17 +1911,29 @@ private:
 		};
 		void action(CommitAction& a) {
 			double t1 = now();
+			++commitGeneration;
 			cursor->commit();
 			delete cursor;
 			cursor = NULL;
 
 			double t2 = now();
 
-			fullCheckpoint();
+			deferCheckpoint();
+
+			double tDeferred = now();
+
+			int frames = fullCheckpoint();
+			++commitGeneration;
 
 			double t3 = now();
 
 			++commits;
+			++writerCommitStats.commits;
+			writerCommitStats.commitTime += t2-t1;
+			writerCommitStats.checkpointDeferTime += tDeferred-t2;
+			writerCommitStats.checkpointTime += t3-tDeferred;
+			writerCommitStats.checkpointFrames += frames;
+			writerCommitStats.lastCheckpointFrames = frames;
 			//if ( !(commits % 100) )
 			//printf("dbf=%lld bytes, wal=%lld bytes\n", getFileSize((kv->filename+".fdb").c_str()), getFileSize((kv->filename+".fdb-wal").c_str()));
 
@@ -1662,7 +1943,7 @@ private:
 			checkFreePages();
 			++writesComplete;
 			if (t3-a.issuedTime > 10.0*g_random->random01())
-				TraceEvent("KVCommit10s_sample", dbgid).detail("Queued", t1-a.issuedTime).detail("Commit", t2-t1).detail("Checkpoint", t3-t2);
+				TraceEvent("KVCommit10s_sample", dbgid).detail("Queued", t1-a.issuedTime).detail("Commit", t2-t1).detail("Deferred", tDeferred-t2).detail("Checkpoint", t3-tDeferred).detail("Frames", frames);
 
 			diskBytesUsed = waitForAndGet( conn.dbFile->size() ) + waitForAndGet( conn.walFile->size() );
 
@@ -1670,16 +1951,28 @@ private:
 				TraceEvent("CommitActionFinished", dbgid).detail("Elapsed", now()-t1);
 		}
 
-		//Checkpoints the database and resets the wal file back to the beginning
-		void fullCheckpoint() {
+		//Checkpoints the database and resets the wal file back to the beginning.  Returns the number of frames that were in the wal.
+		int fullCheckpoint() {
 			//A checkpoint cannot succeed while there is an outstanding transaction
 			ASSERT(cursor == NULL);
 
 			resetReaders();
-			conn.checkpoint(false);
+			int frames = conn.checkpoint(false);
 
 			resetReaders();
 			conn.checkpoint(true);
+			return frames;
+		}
+
+		// The checkpoint after each commit copies every page the commit wrote into the database file and syncs it, which competes
+		// with reads for the disk.  While more than SQLITE_CHECKPOINT_DEFER_READ_QUEUE reads are queued, wait for them to drain,
+		// but for no longer than SQLITE_CHECKPOINT_MAX_DEFERRAL, since the commit is not durable until the checkpoint is done.
+		void deferCheckpoint() {
+			if(SERVER_KNOBS->SQLITE_CHECKPOINT_DEFER_READ_QUEUE <= 0)
+				return;
+			double end = now() + SERVER_KNOBS->SQLITE_CHECKPOINT_MAX_DEFERRAL;
+			while(readsRequested - readsComplete > SERVER_KNOBS->SQLITE_CHECKPOINT_DEFER_READ_QUEUE && now() < end)
+				waitFor( delay(SERVER_KNOBS->SQLITE_CHECKPOINT_DEFER_POLL_INTERVAL, TaskDiskWrite) );
 		}
 
 		void resetReaders() {
@@ -1778,19 +2071,92 @@ private:
 	};
 
 
+	// Concatenates the parts of a split range read in the read's direction, applying its limits just as one
+	// getRange() over the whole range would.  Returns false if the parts were not all read from the same snapshot.
+	static bool mergeRangeParts( std::vector<Future<Reader::RangeReadPart>> const& parts, int rowLimit, int byteLimit, Standalone<VectorRef<KeyValueRef>>& result ) {
+		for(auto& part : parts)
+			if (part.get().generation < 0 || part.get().generation != parts[0].get().generation)
+				return false;
+
+		int rowsLeft = std::abs(rowLimit);
+		int accumulatedBytes = 0;
+		for(int i = 0; i < parts.size() && rowsLeft && accumulatedBytes < byteLimit; i++) {
+			Standalone<VectorRef<KeyValueRef>> const& rows = parts[rowLimit >= 0 ? i : parts.size() - 1 - i].get().rows;
+			result.arena().dependsOn(rows.arena());
+			for(int r = 0; r < rows.size() && rowsLeft && accumulatedBytes < byteLimit; r++) {
+				result.push_back(result.arena(), rows[r]);
+				accumulatedBytes += sizeof(KeyValueRef) + rows[r].expectedSize();
+				--rowsLeft;
+			}
+		}
+		return true;
+	}
+
+	// Reads keys as several parts on idle readers at once.  Each part is given the whole read's limits, so no part
+	// stops short of what the merged result needs.  If a commit lands between the parts they are read again whole.
+	ACTOR static Future<Standalone<VectorRef<KeyValueRef>>> readRangeSplit( KeyValueStoreSQLite* self, KeyRange keys, int rowLimit, int byteLimit, ReadType type, int parts ) {
+		state Standalone<VectorRef<KeyRef>> splitKeys = wait( self->getSplitKeys(keys, parts) );
+		state std::vector<Future<Reader::RangeReadPart>> reads;
+		state Standalone<VectorRef<KeyValueRef>> result;
+
+		if (splitKeys.size()) {
+			KeyRef begin = keys.begin;
+			for(int i = 0; i < splitKeys.size(); i++) {
+				reads.push_back( self->readRangePart(KeyRangeRef(begin, splitKeys[i]), rowLimit, byteLimit, type) );
+				begin = splitKeys[i];
+			}
+			reads.push_back( self->readRangePart(KeyRangeRef(begin, keys.end), rowLimit, byteLimit, type) );
+			Void _ = wait( waitForAll(reads) );
+
+			if (mergeRangeParts(reads, rowLimit, byteLimit, result))
+				return result;
+			TEST(true);  // SQLite split range read parts saw different snapshots
+		}
+
+		Reader::RangeReadPart whole = wait( self->readRangePart(keys, rowLimit, byteLimit, type) );
+		return whole.rows;
+	}
+
 	ACTOR static Future<Void> logPeriodically( KeyValueStoreSQLite* self ) {
 		state int64_t lastReadsComplete = 0;
 		state int64_t lastWritesComplete = 0;
+		state int64_t lastCommits = 0;
+		state double lastCommitTime = 0;
+		state double lastCheckpointTime = 0;
+		state double lastCheckpointDeferTime = 0;
+		state int64_t lastCheckpointFrames = 0;
 		loop {
 			Void _ = wait( delay(SERVER_KNOBS->DISK_METRIC_LOGGING_INTERVAL) );
 
 			int64_t rc = self->readsComplete, wc = self->writesComplete;
+			int64_t commits = self->writerCommitStats.commits;
+			double commitTime = self->writerCommitStats.commitTime, checkpointTime = self->writerCommitStats.checkpointTime;
+			double checkpointDeferTime = self->writerCommitStats.checkpointDeferTime;
+			int64_t checkpointFrames = self->writerCommitStats.checkpointFrames;
+			ThreadPoolQueueMetrics readQueue = self->readThreads->getQueueMetrics();
+			ThreadPoolQueueMetrics writeQueue = self->writeThread->getQueueMetrics();
 			TraceEvent("DiskMetrics", self->logID)
 				.detail("ReadOps", rc - lastReadsComplete)
 				.detail("WriteOps", wc - lastWritesComplete)
 				.detail("ReadQueue", self->readsRequested - rc)
+				.detail("ReadThreads", self->nReadThreads)
 				.detail("WriteQueue", self->writesRequested - wc)
+				.detail("PointReadQueueDelay", readQueue.delay[THREAD_POOL_URGENT].percentile(0.99))
+				.detail("RangeReadQueueDelay", readQueue.delay[THREAD_POOL_NORMAL].percentile(0.99))
+				.detail("BulkReadQueueDelay", readQueue.delay[THREAD_POOL_BULK].percentile(0.99))
+				.detail("WriteQueueDelay", writeQueue.delay[THREAD_POOL_NORMAL].percentile(0.99))
+				.detail("Commits", commits - lastCommits)
+				.detail("WriterCommitTime", commitTime - lastCommitTime)
+				.detail("WriterCheckpointTime", checkpointTime - lastCheckpointTime)
+				.detail("CheckpointDeferTime", checkpointDeferTime - lastCheckpointDeferTime)
+				.detail("CheckpointBytes", (checkpointFrames - lastCheckpointFrames) * self->pageSize)
+				.detail("CheckpointBacklogBytes", int64_t(self->writerCommitStats.lastCheckpointFrames) * self->pageSize)
 				.detail("GlobalSQLiteMemoryHighWater", (int64_t)sqlite3_memory_highwater(1));
+			lastCommits = commits;
+			lastCommitTime = commitTime;
+			lastCheckpointTime = checkpointTime;
+			lastCheckpointDeferTime = checkpointDeferTime;
+			lastCheckpointFrames = checkpointFrames;
 
 			TraceEvent("SpringCleaningMetrics", self->logID)
 				.detail("SpringCleaningCount", self->springCleaningStats.springCleaningCount)
@@ -1844,8 +2210,8 @@ private:
 		}
 	}
 };
-IKeyValueStore* keyValueStoreSQLite( std::string const& filename, UID logID, KeyValueStoreType storeType, bool checkChecksums, bool checkIntegrity) {
-	return new KeyValueStoreSQLite(filename, logID, storeType, checkChecksums, checkIntegrity);
+IKeyValueStore* keyValueStoreSQLite( std::string const& filename, UID logID, KeyValueStoreType storeType, bool checkChecksums, bool checkIntegrity, int pageSize) {
+	return new KeyValueStoreSQLite(filename, logID, storeType, checkChecksums, checkIntegrity, pageSize);
 }
 
 ACTOR Future<Void> cleanPeriodically( KeyValueStoreSQLite* self ) {
@@ -1864,13 +2230,13 @@ ACTOR static Future<Void> startReadThreadsWhen( KeyValueStoreSQLite* kv, Future<
 sqlite3_vfs *vfsAsync();
 static int vfs_registered = 0;
 
-KeyValueStoreSQLite::KeyValueStoreSQLite(std::string const& filename, UID id, KeyValueStoreType storeType, bool checkChecksums, bool checkIntegrity)
+KeyValueStoreSQLite::KeyValueStoreSQLite(std::string const& filename, UID id, KeyValueStoreType storeType, bool checkChecksums, bool checkIntegrity, int newPageSize)
 	: type(storeType),
 	  filename(filename),
 	  logID(id),
-	  readThreads(CoroThreadPool::createThreadPool()),
-	  writeThread(CoroThreadPool::createThreadPool()),
-	  readsRequested(0), writesRequested(0), writesComplete(0), diskBytesUsed(0), freeListPages(0)
+	  readThreads(CoroThreadPool::createThreadPool(SERVER_KNOBS->SQLITE_READER_STACK_SIZE)),
+	  writeThread(CoroThreadPool::createThreadPool(SERVER_KNOBS->SQLITE_WRITER_STACK_SIZE)),
+	  readsRequested(0), writesRequested(0), writesComplete(0), diskBytesUsed(0), freeListPages(0), pageSize(_PAGE_SIZE), commitGeneration(0), nReadThreads(0)
 {
 	stopOnErr = stopOnError(this);
 
@@ -1885,12 +2251,12 @@ KeyValueStoreSQLite::KeyValueStoreSQLite(std::string const& filename, UID id, Ke
 	//The DB file should not already be open
 	ASSERT(!vfsAsyncIsOpen(filename));
 
-	readCursors.resize(64); //< number of read threads
+	readCursors.resize(SERVER_KNOBS->SQLITE_READ_THREADS_MAX); //< maximum number of read threads
 
 	sqlite3_soft_heap_limit64( SERVER_KNOBS->SOFT_HEAP_LIMIT );  // SOMEDAY: Is this a performance issue?  Should we drop the cache sizes for individual threads?
 	int taskId = g_network->getCurrentTask();
 	g_network->setCurrentTask(TaskDiskWrite);
-	writeThread->addThread( new Writer(filename, type==KeyValueStoreType::SSD_BTREE_V2, checkChecksums, checkIntegrity, writesComplete, springCleaningStats, diskBytesUsed, freeListPages, id, &readCursors) );
+	writeThread->addThread( new Writer(filename, type==KeyValueStoreType::SSD_BTREE_V2, checkChecksums, checkIntegrity, writesComplete, readsRequested, readsComplete, springCleaningStats, writerCommitStats, diskBytesUsed, freeListPages, pageSize, commitGeneration, id, &readCursors, newPageSize) );
 	g_network->setCurrentTask(taskId);
 	auto p = new Writer::InitAction();
 	auto f = p->result.getFuture();
@@ -1909,22 +2275,40 @@ StorageBytes KeyValueStoreSQLite::getStorageBytes() {
 
 	g_network->getDiskBytes(parentDirectory(filename), free, total);
 
-	return StorageBytes(free, total, diskBytesUsed, free + _PAGE_SIZE * freeListPages);
+	return StorageBytes(free, total, diskBytesUsed, free + int64_t(pageSize) * freeListPages);
 }
 
 void KeyValueStoreSQLite::startReadThreads() {
-	int nReadThreads = readCursors.size();
+	int initialReadThreads = std::min<int>(SERVER_KNOBS->SQLITE_READ_THREADS_INITIAL, readCursors.size());
+	while (nReadThreads < initialReadThreads)
+		addReadThread();
+}
+
+void KeyValueStoreSQLite::addReadThread() {
 	int taskId = g_network->getCurrentTask();
 	g_network->setCurrentTask(TaskDiskRead);
-	for(int i=0; i<nReadThreads; i++)
-		readThreads->addThread( new Reader(filename, type==KeyValueStoreType::SSD_BTREE_V2, readsComplete, logID, &readCursors[i]) );
+	readThreads->addThread( new Reader(filename, type==KeyValueStoreType::SSD_BTREE_V2, readsComplete, commitGeneration, logID, &readCursors[nReadThreads]) );
 	g_network->setCurrentTask(taskId);
+	++nReadThreads;
+}
+
+void KeyValueStoreSQLite::postRead( PThreadAction action, ThreadPoolLane lane ) {
+	++readsRequested;
+	// Once started, readers are added whenever more reads are queued than there are readers to take them
+	if (nReadThreads && nReadThreads < readCursors.size() && readsRequested - readsComplete > nReadThreads)
+		addReadThread();
+	readThreads->post(action, lane);
 }
 
 void KeyValueStoreSQLite::set( KeyValueRef keyValue, const Arena* arena ) {
 	++writesRequested;
 	writeThread->post( new Writer::SetAction(keyValue) );
 }
+void KeyValueStoreSQLite::ingestSorted( VectorRef<KeyValueRef> sortedKeyValues, const Arena* arena ) {
+	if (!sortedKeyValues.size()) return;
+	++writesRequested;
+	writeThread->post( new Writer::IngestSortedAction(sortedKeyValues) );
+}
 void KeyValueStoreSQLite::clear( KeyRangeRef range, const Arena* arena ) {
 	++writesRequested;
 	writeThread->post( new Writer::ClearAction(range) );
@@ -1937,31 +2321,49 @@ Future<Void> KeyValueStoreSQLite::commit(bool sequential) {
 	return f;
 }
 Future<Optional<Value>> KeyValueStoreSQLite::readValue( KeyRef key, Optional<UID> debugID ) {
-	++readsRequested;
 	auto p = new Reader::ReadValueAction(key, debugID);
 	auto f = p->result.getFuture();
-	readThreads->post(p);
+	postRead(p, THREAD_POOL_URGENT);
 	return f;
 }
 Future<Optional<Value>> KeyValueStoreSQLite::readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID ) {
-	++readsRequested;
 	auto p = new Reader::ReadValuePrefixAction(key, maxLength, debugID);
 	auto f = p->result.getFuture();
-	readThreads->post(p);
+	postRead(p, THREAD_POOL_URGENT);
 	return f;
 }
-Future<Standalone<VectorRef<KeyValueRef>>> KeyValueStoreSQLite::readRange( KeyRangeRef keys, int rowLimit, int byteLimit ) {
-	++readsRequested;
-	auto p = new Reader::ReadRangeAction(keys, rowLimit, byteLimit);
+Future<Standalone<VectorRef<KeyValueRef>>> KeyValueStoreSQLite::readRange( KeyRangeRef keys, int rowLimit, int byteLimit, ReadType type ) {
+	// Reads that may return a great deal are split across whichever readers are idle
+	if (std::abs(rowLimit) >= SERVER_KNOBS->SQLITE_SPLIT_READ_MIN_ROWS && byteLimit >= SERVER_KNOBS->SQLITE_SPLIT_READ_MIN_BYTES) {
+		int64_t idleReadThreads = nReadThreads - (readsRequested - readsComplete);
+		int parts = std::min<int64_t>(SERVER_KNOBS->SQLITE_SPLIT_READ_PARTS, idleReadThreads);
+		if (parts > 1)
+			return readRangeSplit(this, keys, rowLimit, byteLimit, type, parts);
+	}
+
+	auto p = new Reader::ReadRangeAction(keys, rowLimit, byteLimit, type);
+	auto f = p->result.getFuture();
+	postRead(p, type == READ_BULK ? THREAD_POOL_BULK : THREAD_POOL_NORMAL);
+	return f;
+}
+Future<KeyValueStoreSQLite::Reader::RangeReadPart> KeyValueStoreSQLite::readRangePart( KeyRangeRef keys, int rowLimit, int byteLimit, ReadType type ) {
+	auto p = new Reader::ReadRangePartAction(keys, rowLimit, byteLimit, type);
+	auto f = p->result.getFuture();
+	postRead(p, type == READ_BULK ? THREAD_POOL_BULK : THREAD_POOL_NORMAL);
+	return f;
+}
+Future<Standalone<VectorRef<KeyRef>>> KeyValueStoreSQLite::getSplitKeys( KeyRangeRef keys, int parts ) {
+	auto p = new Reader::GetSplitKeysAction(keys, parts);
 	auto f = p->result.getFuture();
-	readThreads->post(p);
+	postRead(p, THREAD_POOL_BULK);
 	return f;
 }
 Future<Void> KeyValueStoreSQLite::doClean() {
 	++writesRequested;
+	// Spring cleaning doesn't touch the data, so it can wait behind sets and commits posted after it
 	auto p = new Writer::SpringCleaningAction;
 	auto f = p->result.getFuture();
-	writeThread->post(p);
+	writeThread->post(p, THREAD_POOL_BULK);
 	return f;
 }
 
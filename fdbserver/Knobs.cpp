@@ -52,7 +52,20 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( TLOG_MESSAGE_BLOCK_OVERHEAD_FACTOR,      double(TLOG_MESSAGE_BLOCK_BYTES) / (TLOG_MESSAGE_BLOCK_BYTES - MAX_MESSAGE_SIZE) ); //1.0121466709838096006362758832473
 	init( PEEK_TRACKER_EXPIRATION_TIME,                          600 ); if( randomize && BUGGIFY ) PEEK_TRACKER_EXPIRATION_TIME = g_random->coinflip() ? 0.1 : 60;
 	init( PARALLEL_GET_MORE_REQUESTS,                             32 ); if( randomize && BUGGIFY ) PARALLEL_GET_MORE_REQUESTS = 2;
+	init( PARALLEL_GET_MORE_MIN_REQUESTS,                          2 ); if( randomize && BUGGIFY ) PARALLEL_GET_MORE_MIN_REQUESTS = 1; // A pipelined cursor starts here and doubles its depth, up to PARALLEL_GET_MORE_REQUESTS, while it is behind the tLog
 	init( MAX_QUEUE_COMMIT_BYTES,                               15e6 ); if( randomize && BUGGIFY ) MAX_QUEUE_COMMIT_BYTES = 5000;
+	init( TLOG_SPILL_REFERENCE,                                    0 ); if( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE = 1; // Only affects newly created TLog files, existing ones keep the mode recorded in their format key
+	init( TLOG_SPILL_REFERENCE_MAX_PEEK_VERSIONS,                100 ); if( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_PEEK_VERSIONS = g_random->randomInt(1, 10);
+	init( TLOG_PEEK_CACHE_BYTES,                                50e6 ); if( randomize && BUGGIFY ) TLOG_PEEK_CACHE_BYTES = g_random->coinflip() ? 0 : 1e5;
+	init( TLOG_PEEK_CACHE_EXPIRATION_TIME,                       1.0 ); if( randomize && BUGGIFY ) TLOG_PEEK_CACHE_EXPIRATION_TIME = g_random->coinflip() ? 0.01 : 10.0;
+	init( TLOG_POP_BATCH_INTERVAL,                               1.0 ); if( randomize && BUGGIFY ) TLOG_POP_BATCH_INTERVAL = g_random->coinflip() ? 0.01 : 5.0;
+	init( DISK_QUEUE_GROUP_COMMIT_MAX_DELAY,                  0.0005 ); if( randomize && BUGGIFY ) DISK_QUEUE_GROUP_COMMIT_MAX_DELAY = g_random->coinflip() ? 0.0 : 0.01;
+	init( DISK_QUEUE_GROUP_COMMIT_LATENCY_FRACTION,             0.25 ); if( randomize && BUGGIFY ) DISK_QUEUE_GROUP_COMMIT_LATENCY_FRACTION = g_random->random01();
+	init( DISK_QUEUE_WRITE_DSYNC,                                  0 );
+	init( DISK_QUEUE_RECOVERY_READ_BYTES,                     4<<20 ); if( randomize && BUGGIFY ) DISK_QUEUE_RECOVERY_READ_BYTES = 4096 * g_random->randomInt(1, 64);
+	init( DISK_QUEUE_RECOVERY_READ_AHEAD,                          4 ); if( randomize && BUGGIFY ) DISK_QUEUE_RECOVERY_READ_AHEAD = g_random->randomInt(1, 10);
+	init( DISK_QUEUE_PREALLOCATE_BYTES,                            0 ); if( randomize && BUGGIFY ) DISK_QUEUE_PREALLOCATE_BYTES = g_random->randomInt(1, 5) << 20;
+	init( USE_CRC32C_PAGE_CHECKSUMS,                               0 ); if( randomize && BUGGIFY ) USE_CRC32C_PAGE_CHECKSUMS = 1;
 
 	// Versions
 	init( MAX_VERSIONS_IN_FLIGHT,                          100000000 );
@@ -68,6 +81,17 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( BG_DD_POLLING_INTERVAL,                               10.0 );
 	init( DD_QUEUE_LOGGING_INTERVAL,                             5.0 );
 	init( RELOCATION_PARALLELISM_PER_SOURCE_SERVER,                4 ); if( randomize && BUGGIFY ) RELOCATION_PARALLELISM_PER_SOURCE_SERVER = 1;
+	init( RELOCATION_PARALLELISM_PER_DRAINING_SOURCE_SERVER,      16 ); if( randomize && BUGGIFY ) RELOCATION_PARALLELISM_PER_DRAINING_SOURCE_SERVER = 2;
+	init( RELOCATION_MAX_MB_IN_FLIGHT_PER_DEST_SERVER,          1000 ); if( randomize && BUGGIFY ) RELOCATION_MAX_MB_IN_FLIGHT_PER_DEST_SERVER = 1;
+	init( DD_DEFAULT_FETCH_BYTES_PER_SECOND,                    20e6 );
+	init( DD_FETCH_RATE_SMOOTHING,                               0.2 );
+	init( DD_RELOCATION_WORK_SECONDS,                            5.0 ); if( randomize && BUGGIFY ) DD_RELOCATION_WORK_SECONDS = 0.1;
+	init( DD_RELOCATION_MIN_WORK_SCALE,                         0.25 );
+	init( DD_MOVEMENT_BUDGET_MB,                               10000 ); if( randomize && BUGGIFY ) DD_MOVEMENT_BUDGET_MB = 10;
+	init( DD_MOVEMENT_BUDGET_MIN_MB,                             500 ); if( randomize && BUGGIFY ) DD_MOVEMENT_BUDGET_MIN_MB = 1;
+	init( DD_MOVEMENT_BUDGET_ADJUST_INTERVAL,                    1.0 );
+	init( DD_MOVEMENT_BUDGET_DECREASE_RATIO,                     0.5 );
+	init( DD_MOVEMENT_BUDGET_INCREASE_MB,                        100 );
 	init( DD_QUEUE_MAX_KEY_SERVERS,                              100 ); if( randomize && BUGGIFY ) DD_QUEUE_MAX_KEY_SERVERS = 1;
 	init( DD_REBALANCE_PARALLELISM,                               50 );
 	init( DD_REBALANCE_RESET_AMOUNT,                              30 );
@@ -79,6 +103,7 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( INFLIGHT_PENALTY_HEALTHY,                              1.0 );
 	init( INFLIGHT_PENALTY_UNHEALTHY,                           10.0 );
 	init( INFLIGHT_PENALTY_ONE_LEFT,                          1000.0 );
+	init( INFLIGHT_PENALTY_DRAIN,                               10.0 );
 
 	// Data distribution
 	init( RETRY_RELOCATESHARD_DELAY,                             0.1 );
@@ -127,6 +152,18 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 		If this value is too small relative to SHARD_MIN_BYTES_PER_KSEC immediate merging work will be generated.
 		*/
 
+	init( SHARD_MAX_BYTES_READ_PER_KSEC,            8LL*1000000*1000 ); if( buggifySmallBandwidthSplit ) SHARD_MAX_BYTES_READ_PER_KSEC = 100LL*1000*1000;
+	/* 8*1MB/sec * 1000sec/ksec
+		Shards returning more than this many bytes to readers will be split immediately, so that the pieces can be moved to other teams.
+		Reads are cheaper to serve than writes and don't have to be replicated, so this is much higher than SHARD_MAX_BYTES_PER_KSEC.
+		*/
+
+	init( SHARD_SPLIT_BYTES_READ_PER_KSEC,          2LL*1000000*1000 ); if( buggifySmallBandwidthSplit ) SHARD_SPLIT_BYTES_READ_PER_KSEC = 25LL*1000*1000;
+	/* 2*1MB/sec * 1000sec/ksec
+		When splitting a shard, it is split into pieces with less read bandwidth than this, and shards are not merged past it.
+		This should be less than half of SHARD_MAX_BYTES_READ_PER_KSEC, so that merged shards are not split again right away.
+		*/
+
 	init( STORAGE_METRIC_TIMEOUT,                              600.0 ); if( randomize && BUGGIFY ) STORAGE_METRIC_TIMEOUT = g_random->coinflip() ? 10.0 : 60.0;
 	init( METRIC_DELAY,                                          0.1 ); if( randomize && BUGGIFY ) METRIC_DELAY = 1.0;
 	init( ALL_DATA_REMOVED_DELAY,                                1.0 );
@@ -135,10 +172,12 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( BEST_TEAM_MAX_TEAM_TRIES,                               10 );
 	init( BEST_TEAM_OPTION_COUNT,                                  4 );
 	init( BEST_OF_AMT,                                             4 );
+	init( DD_MAX_ENUMERATED_TEAMS,                            100000 ); if( randomize && BUGGIFY ) DD_MAX_ENUMERATED_TEAMS = 10;
 	init( SERVER_LIST_DELAY,                                     1.0 );
 	init( RECRUITMENT_IDLE_DELAY,                                1.0 );
 	init( STORAGE_RECRUITMENT_DELAY,                             0.5 );
 	init( DATA_DISTRIBUTION_LOGGING_INTERVAL,                    5.0 );
+	init( DD_EXCLUSION_DRAIN_RATE_FOLDING_TIME,                120.0 );
 	init( DD_ENABLED_CHECK_DELAY,                                1.0 );
 	init( DD_MERGE_COALESCE_DELAY,                             120.0 ); if( randomize && BUGGIFY ) DD_MERGE_COALESCE_DELAY = 0.001;
 	init( STORAGE_METRICS_POLLING_DELAY,                         2.0 ); if( randomize && BUGGIFY ) STORAGE_METRICS_POLLING_DELAY = 15.0;
@@ -167,6 +206,10 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( SOFT_HEAP_LIMIT,                                     300e6 );
 
 	init( SQLITE_PAGE_SCAN_ERROR_LIMIT,                        10000 );
+	init( SQLITE_CHECKPOINT_DEFER_READ_QUEUE,                      0 ); if( randomize && BUGGIFY ) SQLITE_CHECKPOINT_DEFER_READ_QUEUE = g_random->randomInt(1, 10); // 0 never defers checkpoints for reads
+	init( SQLITE_CHECKPOINT_MAX_DEFERRAL,                       0.05 ); if( randomize && BUGGIFY ) SQLITE_CHECKPOINT_MAX_DEFERRAL = 0.5;
+	init( SQLITE_CHECKPOINT_DEFER_POLL_INTERVAL,               0.001 );
+	init( SQLITE_PAGE_SIZE,                                     4096 ); if( randomize && BUGGIFY ) SQLITE_PAGE_SIZE = 4096 << g_random->randomInt(0, 4); // Power of two from 4096 to 65536, for new files only
 	init( SQLITE_BTREE_PAGE_USABLE,                          4096 - 8);  // pageSize - reserveSize for page checksum
 
 	// Maximum and minimum cell payload bytes allowed on primary page as calculated in SQLite.
@@ -190,6 +233,15 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 					 - 4 // next pageNumber size
 	);
 	init( SQLITE_FRAGMENT_MIN_SAVINGS,                          0.20 );
+	init( SQLITE_BULK_READ_AHEAD_BYTES,                          1<<20 ); if( randomize && BUGGIFY ) SQLITE_BULK_READ_AHEAD_BYTES = 4096 * g_random->randomInt(1, 64);
+	init( SQLITE_READ_THREADS_INITIAL,                               8 ); if( randomize && BUGGIFY ) SQLITE_READ_THREADS_INITIAL = g_random->randomInt(1, 4);
+	init( SQLITE_READ_THREADS_MAX,                                  64 ); if( randomize && BUGGIFY ) SQLITE_READ_THREADS_MAX = g_random->randomInt(SQLITE_READ_THREADS_INITIAL, 17);
+	init( SQLITE_SPLIT_READ_PARTS,                                   4 ); if( randomize && BUGGIFY ) SQLITE_SPLIT_READ_PARTS = g_random->randomInt(2, 9);
+	init( SQLITE_SPLIT_READ_MIN_ROWS,                            10000 ); if( randomize && BUGGIFY ) SQLITE_SPLIT_READ_MIN_ROWS = 1;
+	init( SQLITE_SPLIT_READ_MIN_BYTES,                            10e6 ); if( randomize && BUGGIFY ) SQLITE_SPLIT_READ_MIN_BYTES = 1;
+	init( SQLITE_READER_STACK_SIZE,                          128<<10 );
+	init( SQLITE_WRITER_STACK_SIZE,                          256<<10 );
+	init( CORO_STACK_POOL_SIZE,                                   64 ); if( randomize && BUGGIFY ) CORO_STACK_POOL_SIZE = g_random->randomInt(0, 3);
 
 	// KeyValueStoreSqlite spring cleaning
 	init( CLEANING_INTERVAL,                                     1.0 );
@@ -201,6 +253,25 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( SPRING_CLEANING_MIN_VACUUM_PAGES,                        1 ); if( randomize && BUGGIFY ) SPRING_CLEANING_MIN_VACUUM_PAGES = g_random->randomInt(0, 100);
 	init( SPRING_CLEANING_MAX_VACUUM_PAGES,                      1e9 ); if( randomize && BUGGIFY ) SPRING_CLEANING_MAX_VACUUM_PAGES = g_random->coinflip() ? 0 : g_random->randomInt(1, 1e4);
 
+	// KeyValueStoreMemory
+	init( KVS_MEMORY_SNAPSHOT_BATCH_BYTES,                       1e6 ); if( randomize && BUGGIFY ) KVS_MEMORY_SNAPSHOT_BATCH_BYTES = g_random->randomInt(1, 1e4);
+	init( KVS_MEMORY_READ_THREADS,                                 0 ); if( randomize && BUGGIFY ) KVS_MEMORY_READ_THREADS = g_random->randomInt(1, 4);
+
+	// KeyValueStoreLSM
+	init( LSM_MEMTABLE_BYTES,                                   64e6 ); if( randomize && BUGGIFY ) LSM_MEMTABLE_BYTES = g_random->randomInt(1e3, 1e6);
+	init( LSM_BLOCK_BYTES,                                     16384 ); if( randomize && BUGGIFY ) LSM_BLOCK_BYTES = g_random->randomInt(100, 16384);
+	init( LSM_BLOCK_RESTART_INTERVAL,                             16 ); if( randomize && BUGGIFY ) LSM_BLOCK_RESTART_INTERVAL = g_random->randomInt(1, 32);
+	init( LSM_TARGET_FILE_BYTES,                                 8e6 ); if( randomize && BUGGIFY ) LSM_TARGET_FILE_BYTES = g_random->randomInt(1e4, 1e6);
+	init( LSM_WRITE_CHUNK_BYTES,                             1 << 20 ); if( randomize && BUGGIFY ) LSM_WRITE_CHUNK_BYTES = 4096 * g_random->randomInt(1, 16);
+	init( LSM_L0_COMPACTION_TRIGGER,                               4 ); if( randomize && BUGGIFY ) LSM_L0_COMPACTION_TRIGGER = g_random->randomInt(1, 8);
+	init( LSM_L0_STOP_WRITES_TRIGGER,                             12 ); if( randomize && BUGGIFY ) LSM_L0_STOP_WRITES_TRIGGER = LSM_L0_COMPACTION_TRIGGER + g_random->randomInt(1, 8);
+	init( LSM_LEVEL1_BYTES,                                     64e6 ); if( randomize && BUGGIFY ) LSM_LEVEL1_BYTES = g_random->randomInt(1e5, 1e7);
+	init( LSM_LEVEL_SIZE_MULTIPLIER,                              10 ); if( randomize && BUGGIFY ) LSM_LEVEL_SIZE_MULTIPLIER = g_random->randomInt(2, 10);
+	init( LSM_MAX_LEVELS,                                          7 ); if( randomize && BUGGIFY ) LSM_MAX_LEVELS = g_random->randomInt(2, 7);
+	init( LSM_BLOOM_BITS_PER_KEY,                                 10 ); if( randomize && BUGGIFY ) LSM_BLOOM_BITS_PER_KEY = g_random->randomInt(1, 20);
+	init( LSM_BLOCK_CACHE_BYTES,                               256e6 ); if( randomize && BUGGIFY ) LSM_BLOCK_CACHE_BYTES = g_random->coinflip() ? 0 : g_random->randomInt(1e4, 1e7);
+	init( LSM_OBSOLETE_FILE_CHECK_INTERVAL,                      1.0 );
+
 	// Leader election
 	bool longLeaderElection = randomize && BUGGIFY;
 	init( CANDIDATE_MIN_DELAY,                                  0.05 );
@@ -208,6 +279,7 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( CANDIDATE_GROWTH_RATE,                                 1.2 );
 	init( POLLING_FREQUENCY,                                     1.0 ); if( longLeaderElection ) POLLING_FREQUENCY = 8.0;
 	init( HEARTBEAT_FREQUENCY,                                  0.25 ); if( longLeaderElection ) HEARTBEAT_FREQUENCY = 1.0;
+	init( LEADER_NOTIFY_BATCH_SIZE,                             1000 ); if( randomize && BUGGIFY ) LEADER_NOTIFY_BATCH_SIZE = g_random->randomInt(1, 10);
 
 	// Master Proxy
 	init( START_TRANSACTION_BATCH_INTERVAL_MIN,                 1e-6 );
@@ -217,12 +289,17 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( START_TRANSACTION_BATCH_QUEUE_CHECK_INTERVAL,        0.001 );
 	init( START_TRANSACTION_MAX_TRANSACTIONS_TO_START,         10000 );
 	init( START_TRANSACTION_MAX_BUDGET_SIZE,                      20 ); // Currently set to match CLIENT_KNOBS->MAX_BATCH_SIZE
+	// Read version requests flagged USE_CACHED_READ_VERSION are answered from a live committed version at most this old; 0 answers them as ordinary requests
+	init( START_TRANSACTION_CACHED_VERSION_MAX_STALENESS,        0.0 ); if( randomize && BUGGIFY ) START_TRANSACTION_CACHED_VERSION_MAX_STALENESS = 0.005;
+	init( START_TRANSACTION_CACHED_VERSION_REFRESH_INTERVAL,   0.001 );
 
 	init( COMMIT_TRANSACTION_BATCH_INTERVAL_FROM_IDLE,         0.0005 ); if( randomize && BUGGIFY ) COMMIT_TRANSACTION_BATCH_INTERVAL_FROM_IDLE = 0.005;
 	init( COMMIT_TRANSACTION_BATCH_INTERVAL_MIN,                0.001 ); if( randomize && BUGGIFY ) COMMIT_TRANSACTION_BATCH_INTERVAL_MIN = 0.1;
 	init( COMMIT_TRANSACTION_BATCH_INTERVAL_MAX,                0.020 );
 	init( COMMIT_TRANSACTION_BATCH_INTERVAL_LATENCY_FRACTION,     0.1 );
 	init( COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA,       0.1 );
+	init( COMMIT_VERSION_REQUESTS_IN_FLIGHT_MAX,                   10 ); if( randomize && BUGGIFY ) COMMIT_VERSION_REQUESTS_IN_FLIGHT_MAX = 1;
+	init( COMMIT_VERSION_REQUEST_BATCHES_MAX,                      20 ); if( randomize && BUGGIFY ) COMMIT_VERSION_REQUEST_BATCHES_MAX = g_random->randomInt(1, 4);
 	init( COMMIT_TRANSACTION_BATCH_COUNT_MAX,                   32768 ); if( randomize && BUGGIFY ) COMMIT_TRANSACTION_BATCH_COUNT_MAX = 1000; // Do NOT increase this number beyond 32768, as CommitIds only budget 2 bytes for storing transaction id within each batch
 
 	// these settings disable batch bytes scaling.  Try COMMIT_TRANSACTION_BATCH_BYTES_MAX=1e6, COMMIT_TRANSACTION_BATCH_BYTES_SCALE_BASE=50000, COMMIT_TRANSACTION_BATCH_BYTES_SCALE_POWER=0.5?
@@ -231,10 +308,20 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( COMMIT_TRANSACTION_BATCH_BYTES_SCALE_BASE,           100000 );
 	init( COMMIT_TRANSACTION_BATCH_BYTES_SCALE_POWER,             0.0 );
 
+	// A positive latency target replaces the batch interval and size settings above with a feedback controller that sizes batches to the target
+	init( COMMIT_BATCH_LATENCY_TARGET,                            0.0 ); if( randomize && BUGGIFY ) COMMIT_BATCH_LATENCY_TARGET = g_random->random01() * 0.05;
+	init( COMMIT_BATCH_ADAPTIVE_BYTES_MIN,                      10000 );
+	init( COMMIT_BATCH_ADAPTIVE_BYTES_MAX,                    2000000 );
+	init( COMMIT_BATCH_ADAPTIVE_COUNT_MIN,                         10 ); if( randomize && BUGGIFY ) COMMIT_BATCH_ADAPTIVE_COUNT_MIN = 1;
+	init( COMMIT_BATCH_ADAPTIVE_RESIZE_FACTOR,                    1.1 );
+
 	init( TRANSACTION_BUDGET_TIME,							   0.050 ); if( randomize && BUGGIFY ) TRANSACTION_BUDGET_TIME = 0.0;
 	init( RESOLVER_COALESCE_TIME,                                1.0 );
 	init( BUGGIFIED_ROW_LIMIT,                  APPLY_MUTATION_BYTES ); if( randomize && BUGGIFY ) BUGGIFIED_ROW_LIMIT = g_random->randomInt(3, 30);
 	init( PROXY_SPIN_DELAY,                                     0.01 );
+	init( PROXY_COALESCE_CONFLICT_RANGES,                          1 ); if( randomize && BUGGIFY ) PROXY_COALESCE_CONFLICT_RANGES = 0;
+	init( PROXY_MAX_COMMIT_BATCHES_LOGGING,                      100 ); if( randomize && BUGGIFY ) PROXY_MAX_COMMIT_BATCHES_LOGGING = g_random->randomInt(1, 4); // 0 means unbounded
+	init( PROXY_FLAT_KEY_INFO_INDEX,                               1 ); if( randomize && BUGGIFY ) PROXY_FLAT_KEY_INFO_INDEX = 0;
 
 	// Master Server
 	init( MASTER_LOGGING_DELAY,                                  1.0 );
@@ -251,11 +338,19 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( SAMPLE_EXPIRATION_TIME,                                1.0 );
 	init( SAMPLE_POLL_TIME,                                      0.1 );
 	init( RESOLVER_STATE_MEMORY_LIMIT,                           1e6 );
+	init( RESOLVER_CONFLICT_SET_THREADS,                           0 ); // 0 runs conflict detection on the network thread
+	init( RESOLVER_CONFLICT_DETECTION_THREAD,                      0 ); if( randomize && BUGGIFY ) RESOLVER_CONFLICT_DETECTION_THREAD = 1;
+	init( RESOLVER_CONFLICT_SET_PARALLEL_MIN_RANGES,             200 ); // Smaller batches are not worth waking the conflict set worker threads for
+	init( RESOLVER_BATCH_COMPACTION_NODES_PER_RANGE,               3 ); if( randomize && BUGGIFY ) RESOLVER_BATCH_COMPACTION_NODES_PER_RANGE = 0;
+	init( RESOLVER_COMPACTION_INTERVAL,                          0.5 ); if( randomize && BUGGIFY ) RESOLVER_COMPACTION_INTERVAL = 0.01;
+	init( RESOLVER_COMPACTION_NODES_PER_STEP,                   1000 ); if( randomize && BUGGIFY ) RESOLVER_COMPACTION_NODES_PER_STEP = 10;
 	init( LAST_LIMITED_RATIO,                                    0.6 );
 
 	//Cluster Controller
 	init( MASTER_FAILURE_REACTION_TIME,                          0.4 ); if( randomize && BUGGIFY ) MASTER_FAILURE_REACTION_TIME = 10.0;
 	init( MASTER_FAILURE_SLOPE_DURING_RECOVERY,                  0.1 );
+	init( MASTER_SPECULATIVE_RECRUITMENT,                          1 ); if( randomize && BUGGIFY ) MASTER_SPECULATIVE_RECRUITMENT = 0;
+	init( TXN_STATE_CACHED_TRANSFER,                               1 ); if( randomize && BUGGIFY ) TXN_STATE_CACHED_TRANSFER = 0;
 	init( WORKER_COORDINATION_PING_DELAY,                         60 );
 	init( SIM_SHUTDOWN_TIMEOUT,                                   10 );
 	init( SHUTDOWN_TIMEOUT,                                      600 ); if( randomize && BUGGIFY ) SHUTDOWN_TIMEOUT = 60.0;
@@ -272,6 +367,12 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( EXPECTED_PROXY_FITNESS,              ProcessClass::GoodFit );
 	init( EXPECTED_RESOLVER_FITNESS,           ProcessClass::GoodFit );
 	init( RECRUITMENT_TIMEOUT,                                   600 ); if( randomize && BUGGIFY ) RECRUITMENT_TIMEOUT = g_random->coinflip() ? 60.0 : 1.0;
+	init( DEGRADED_DISK_MIN_OPERATIONS,                          100 );
+	init( DEGRADED_DISK_LATENCY,                                 1.0 );
+	init( DEGRADED_DISK_PEER_RATIO,                             10.0 );
+	init( DEGRADED_DISK_PEER_MIN_LATENCY,                       0.05 );
+	init( DEGRADED_DISK_MIN_PEERS,                                 3 );
+	init( DEGRADED_DISK_DURATION,                              120.0 ); if( randomize && BUGGIFY ) DEGRADED_DISK_DURATION = 10.0;
 
 	init( POLICY_RATING_TESTS,                                   200 ); if( randomize && BUGGIFY ) POLICY_RATING_TESTS = 20;
 	init( POLICY_GENERATIONS,                                    100 ); if( randomize && BUGGIFY ) POLICY_GENERATIONS = 10;
@@ -313,6 +414,11 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 
 	init( MAX_TL_SS_VERSION_DIFFERENCE,                         1e99 ); // if( randomize && BUGGIFY ) MAX_TL_SS_VERSION_DIFFERENCE = std::max(1.0, 0.25 * VERSIONS_PER_SECOND); // spring starts at half this value //FIXME: this knob causes ratekeeper to clamp on idle cluster in simulation that have a large number of logs
 	init( MAX_MACHINES_FALLING_BEHIND,                             1 );
+	init( RATEKEEPER_PREDICTION_HORIZON,                         1.0 ); if( randomize && BUGGIFY ) RATEKEEPER_PREDICTION_HORIZON = g_random->coinflip() ? 0.0 : 5.0; // Queues and lags are extrapolated this many seconds ahead at their smoothed rate of change
+	init( TAG_THROTTLE_MIN_SHARE,                                0.1 ); if( randomize && BUGGIFY ) TAG_THROTTLE_MIN_SHARE = 0.01; // The fraction of released transactions a tag must account for before it is throttled
+	init( TAG_THROTTLE_MIN_TPS,                                  1.0 );
+	init( TAG_THROTTLE_RELAX_RATE,                              1.02 ); if( randomize && BUGGIFY ) TAG_THROTTLE_RELAX_RATE = 1.2; // Growth of a tag's limit per METRIC_UPDATE_RATE once it is no longer needed
+	init( TAG_THROTTLE_MAX_TRACKED_TAGS,                        1000 );
 
 	//Storage Metrics
 	init( STORAGE_METRICS_AVERAGE_INTERVAL,                    120.0 );
@@ -320,6 +426,15 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( SPLIT_JITTER_AMOUNT,                                  0.05 ); if( randomize && BUGGIFY ) SPLIT_JITTER_AMOUNT = 0.2;
 	init( IOPS_UNITS_PER_SAMPLE,                                10000 * 1000 / STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS / 100 );
 	init( BANDWIDTH_UNITS_PER_SAMPLE,                           SHARD_MIN_BYTES_PER_KSEC / STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS / 25 );
+	init( BYTES_READ_UNITS_PER_SAMPLE,                          SHARD_SPLIT_BYTES_READ_PER_KSEC / STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS / 100 );
+
+	//Hot keys
+	init( HOT_KEY_SKETCH_DEPTH,                                    4 );
+	init( HOT_KEY_SKETCH_WIDTH,                                 4096 ); if( randomize && BUGGIFY ) HOT_KEY_SKETCH_WIDTH = 16;
+	init( HOT_KEY_TOP_K,                                          10 ); if( randomize && BUGGIFY ) HOT_KEY_TOP_K = 2;
+	init( HOT_KEY_LOGGING_INTERVAL,                              5.0 );
+	init( HOT_KEY_DECAY,                                         0.5 ); // Estimates are multiplied by this every HOT_KEY_LOGGING_INTERVAL
+	init( HOT_KEY_MAX_REPORTED_BYTES,                            100 );
 
 	//Storage Server
 	init( STORAGE_LOGGING_DELAY,                                 5.0 );
@@ -327,18 +442,48 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 	init( FUTURE_VERSION_DELAY,                                  1.0 ); if( randomize && BUGGIFY ) FUTURE_VERSION_DELAY = 0.001;
 	init( STORAGE_LIMIT_BYTES,                                500000 );
 	init( BUGGIFY_LIMIT_BYTES,                                  1000 );
+	init( FIND_KEY_MAX_READS,                                     10 ); if( randomize && BUGGIFY ) FIND_KEY_MAX_READS = 1;
+	init( MAX_PINNED_SNAPSHOTS,                                    4 ); if( randomize && BUGGIFY ) MAX_PINNED_SNAPSHOTS = 1;
+	init( MAX_PINNED_SNAPSHOT_LEASE,                           300.0 ); if( randomize && BUGGIFY ) MAX_PINNED_SNAPSHOT_LEASE = 2.0;
+	init( EXPORT_RANGE_FILE_BYTES,                              10e6 ); if( randomize && BUGGIFY ) EXPORT_RANGE_FILE_BYTES = 10e3;
+	init( EXPORT_RANGE_PARALLELISM,                                2 ); if( randomize && BUGGIFY ) EXPORT_RANGE_PARALLELISM = 1;
 	init( FETCH_BLOCK_BYTES,                                     2e6 );
 	init( FETCH_KEYS_PARALLELISM_BYTES,                          5e6 ); if( randomize && BUGGIFY ) FETCH_KEYS_PARALLELISM_BYTES = 4e6;
+	init( FETCH_KEYS_PARALLEL_PARTS,                               4 ); if( randomize && BUGGIFY ) FETCH_KEYS_PARALLEL_PARTS = g_random->randomInt(1, 9);
+	init( FETCH_KEYS_SPLIT_TIMEOUT,                              1.0 );
 	init( BUGGIFY_BLOCK_BYTES,                                 10000 );
 	init( STORAGE_HARD_LIMIT_BYTES,                           1500e6 ); if( randomize && BUGGIFY ) STORAGE_HARD_LIMIT_BYTES = 1500e3;
 	init( STORAGE_COMMIT_BYTES,                             10000000 ); if( randomize && BUGGIFY ) STORAGE_COMMIT_BYTES = 2000000;
 	init( STORAGE_COMMIT_INTERVAL,                               0.5 ); if( randomize && BUGGIFY ) STORAGE_COMMIT_INTERVAL = 2.0;
+	// A positive durability lag target sizes each durable commit to the bytes the disk is measured to write in that time, between STORAGE_COMMIT_BYTES and STORAGE_COMMIT_BYTES_MAX
+	init( STORAGE_DURABILITY_LAG_TARGET,                         0.0 ); if( randomize && BUGGIFY ) STORAGE_DURABILITY_LAG_TARGET = g_random->random01() * 2.0;
+	init( STORAGE_COMMIT_BYTES_MAX,                        100000000 ); if( randomize && BUGGIFY ) STORAGE_COMMIT_BYTES_MAX = 5000000;
+	init( STORAGE_COMMIT_RATE_SMOOTHING_ALPHA,                   0.2 );
 	init( UPDATE_SHARD_VERSION_INTERVAL,                        0.25 ); if( randomize && BUGGIFY ) UPDATE_SHARD_VERSION_INTERVAL = 1.0;
 	init( BYTE_SAMPLING_FACTOR,                                  250 ); //cannot buggify because of differences in restarting tests
 	init( BYTE_SAMPLING_OVERHEAD,                                100 );
 	init( MAX_STORAGE_SERVER_WATCH_BYTES,                      100e6 ); if( randomize && BUGGIFY ) MAX_STORAGE_SERVER_WATCH_BYTES = 10e3;
+	init( STORAGE_COALESCE_WATCHES,                             true ); if( randomize && BUGGIFY ) STORAGE_COALESCE_WATCHES = false;
+	init( STORAGE_PARALLEL_PEEK,                                true ); if( randomize && BUGGIFY ) STORAGE_PARALLEL_PEEK = false;
+	init( STORAGE_FUSE_ATOMIC_OPS,                              true ); if( randomize && BUGGIFY ) STORAGE_FUSE_ATOMIC_OPS = false;
+	init( STORAGE_READ_QUEUE_LATENCY_TARGET,                     1.0 ); if( randomize && BUGGIFY ) STORAGE_READ_QUEUE_LATENCY_TARGET = 0.01;
+	init( STORAGE_BATCH_READ_QUEUE_LATENCY_TARGET,               0.1 ); if( randomize && BUGGIFY ) STORAGE_BATCH_READ_QUEUE_LATENCY_TARGET = 0.001;
 	init( MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE,                        1e9 ); if( randomize && BUGGIFY ) MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE = 1e3;
 	init( LONG_BYTE_SAMPLE_RECOVERY_DELAY,                      60.0 );
+	init( STORAGE_HOT_KEY_CACHE_BYTES,                          16e6 ); if( randomize && BUGGIFY ) STORAGE_HOT_KEY_CACHE_BYTES = g_random->coinflip() ? 0 : 2000;
+	init( STORAGE_PREFETCH_EAGER_READ_KEYS,                    10000 ); if( randomize && BUGGIFY ) STORAGE_PREFETCH_EAGER_READ_KEYS = g_random->coinflip() ? 0 : g_random->randomInt(1, 20);
+	init( STORAGE_VALUE_COMPRESSION,                           false ); if( randomize && BUGGIFY ) STORAGE_VALUE_COMPRESSION = true;
+	init( STORAGE_VALUE_COMPRESSION_MIN_BYTES,                    64 ); if( randomize && BUGGIFY ) STORAGE_VALUE_COMPRESSION_MIN_BYTES = g_random->randomInt(0, 100);
+	init( STORAGE_VALUE_COMPRESSION_LEVEL,                         1 ); if( randomize && BUGGIFY ) STORAGE_VALUE_COMPRESSION_LEVEL = g_random->randomInt(1, 10);
+	init( STORAGE_MEMORY_GOVERNOR,                             false ); if( randomize && BUGGIFY ) STORAGE_MEMORY_GOVERNOR = true;
+	init( STORAGE_MEMORY_GOVERNOR_INTERVAL,                      5.0 ); if( randomize && BUGGIFY ) STORAGE_MEMORY_GOVERNOR_INTERVAL = 0.5;
+	init( STORAGE_MEMORY_GOVERNOR_RESERVE_BYTES,               500e6 );
+	init( STORAGE_MEMORY_GOVERNOR_MVCC_HEADROOM,                 2.0 ); if( randomize && BUGGIFY ) STORAGE_MEMORY_GOVERNOR_MVCC_HEADROOM = 1.0;
+	init( STORAGE_MEMORY_GOVERNOR_MIN_MVCC_BYTES,              500e6 ); if( randomize && BUGGIFY ) STORAGE_MEMORY_GOVERNOR_MIN_MVCC_BYTES = 500e3;
+	init( STORAGE_MEMORY_GOVERNOR_MIN_PAGE_CACHE_BYTES,        100e6 ); if( randomize && BUGGIFY ) STORAGE_MEMORY_GOVERNOR_MIN_PAGE_CACHE_BYTES = 1e6;
+	init( STORAGE_MEMORY_GOVERNOR_MIN_HOT_KEY_CACHE_BYTES,       1e6 ); if( randomize && BUGGIFY ) STORAGE_MEMORY_GOVERNOR_MIN_HOT_KEY_CACHE_BYTES = 2000;
+	init( STORAGE_MEMORY_GOVERNOR_STEP,                         0.05 ); if( randomize && BUGGIFY ) STORAGE_MEMORY_GOVERNOR_STEP = 0.5;
+	init( STORAGE_MEMORY_GOVERNOR_HOT_KEY_MISS_COST,             0.1 );
 
 	//Wait Failure
 	init( BUGGIFY_OUTSTANDING_WAIT_FAILURE_REQUESTS,               2 );
@@ -347,6 +492,7 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 
 	//Worker
 	init( WORKER_LOGGING_INTERVAL,                               5.0 );
+	init( WORKER_HEALTH_REPORT_INTERVAL,                         5.0 ); if( randomize && BUGGIFY ) WORKER_HEALTH_REPORT_INTERVAL = 0.5;
 	init( INCOMPATIBLE_PEER_DELAY_BEFORE_LOGGING,                5.0 );
 
 	// Test harness
@@ -361,12 +507,39 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs) {
 
 	// Status
 	init( STATUS_MIN_TIME_BETWEEN_REQUESTS,                      0.0 );
+	init( STATUS_CACHE_MAX_AGE,                                  1.0 ); if( randomize && BUGGIFY ) STATUS_CACHE_MAX_AGE = g_random->coinflip() ? 0.0 : 10.0;
 	init( CONFIGURATION_ROWS_TO_FETCH,                         20000 );
 
 	// Timekeeper
 	init( TIME_KEEPER_DELAY,                                      10 );
 	init( TIME_KEEPER_MAX_ENTRIES,                              3600 * 24 * 30 * 6); if( randomize && BUGGIFY ) { TIME_KEEPER_MAX_ENTRIES = 2; }
 
+	// Network test
+	init( NETWORK_TEST_CLIENT_COUNT,                               30 );
+	init( NETWORK_TEST_REQUEST_SIZE,                                1 );
+	init( NETWORK_TEST_REPLY_SIZE,                             600000 );
+	init( NETWORK_TEST_SIZE_DISTRIBUTION,                           0 );
+	init( NETWORK_TEST_COMPRESSIBLE,                             true );
+	init( NETWORK_TEST_DURATION,                                  0.0 );
+	init( NETWORK_TEST_REPORT_INTERVAL,                           1.0 );
+
+	// KV bench
+	init( KV_BENCH_STORE_TYPE,                                "ssd-2" );
+	init( KV_BENCH_KEY_COUNT,                                 1000000 );
+	init( KV_BENCH_KEY_BYTES,                                      16 );
+	init( KV_BENCH_VALUE_BYTES,                                   100 );
+	init( KV_BENCH_READ_FRACTION,                                0.50 );
+	init( KV_BENCH_SCAN_FRACTION,                                0.05 );
+	init( KV_BENCH_CLEAR_FRACTION,                               0.05 );
+	init( KV_BENCH_SCAN_ROWS,                                     100 );
+	init( KV_BENCH_KEY_SKEW,                                      1.0 );
+	init( KV_BENCH_OPERATIONS_PER_SECOND,                     10000.0 );
+	init( KV_BENCH_DURATION,                                     60.0 );
+	init( KV_BENCH_COMMIT_INTERVAL,                               0.1 );
+	init( KV_BENCH_MAX_OUTSTANDING_READS,                        1000 );
+	init( KV_BENCH_MEMORY_LIMIT,                               1LL<<30 );
+	init( KV_BENCH_REPORT_INTERVAL,                               5.0 );
+
 	if(clientKnobs)
 		clientKnobs->IS_ACCEPTABLE_DELAY = clientKnobs->IS_ACCEPTABLE_DELAY*std::min(MAX_READ_TRANSACTION_LIFE_VERSIONS, MAX_WRITE_TRANSACTION_LIFE_VERSIONS)/(5.0*VERSIONS_PER_SECOND);
 }
@@ -57,7 +57,20 @@ public:
 	int LOG_SYSTEM_PUSHED_DATA_BLOCK_SIZE;
 	double PEEK_TRACKER_EXPIRATION_TIME;
 	int PARALLEL_GET_MORE_REQUESTS;
+	int PARALLEL_GET_MORE_MIN_REQUESTS;
 	int64_t MAX_QUEUE_COMMIT_BYTES;
+	int TLOG_SPILL_REFERENCE; // If nonzero, spilled versions are recorded in persistentData by their location in the TLog's disk queue rather than by value
+	int TLOG_SPILL_REFERENCE_MAX_PEEK_VERSIONS;
+	int64_t TLOG_PEEK_CACHE_BYTES; // Total size of the serialized peek replies each TLog keeps for reuse by other peeks of the same tag and version
+	double TLOG_PEEK_CACHE_EXPIRATION_TIME;
+	double TLOG_POP_BATCH_INTERVAL; // How often a log system sends each TLog the pops of all its tags that have advanced, in one request
+	double DISK_QUEUE_GROUP_COMMIT_MAX_DELAY; // A disk queue sync waits up to the lesser of this and a fraction of recent sync latency for more commits to join it
+	double DISK_QUEUE_GROUP_COMMIT_LATENCY_FRACTION;
+	int DISK_QUEUE_WRITE_DSYNC; // If nonzero, disk queue files are opened with O_DSYNC
+	int DISK_QUEUE_RECOVERY_READ_BYTES; // Size of each read issued while recovering a disk queue; must be a multiple of the page size
+	int DISK_QUEUE_RECOVERY_READ_AHEAD; // Number of recovery reads kept outstanding ahead of the page being replayed
+	int64_t DISK_QUEUE_PREALLOCATE_BYTES; // When an empty disk queue is created or recovered, its two files together are formatted to this size
+	int USE_CRC32C_PAGE_CHECKSUMS; // If nonzero, disk queue and SQLite pages are written with crc32c checksums; pages with either checksum are always readable
 
 	// Versions
 	int MAX_VERSIONS_IN_FLIGHT;
@@ -73,6 +86,17 @@ public:
 	double BG_DD_POLLING_INTERVAL;
 	double DD_QUEUE_LOGGING_INTERVAL;
 	double RELOCATION_PARALLELISM_PER_SOURCE_SERVER;
+	double RELOCATION_PARALLELISM_PER_DRAINING_SOURCE_SERVER; // Used instead of RELOCATION_PARALLELISM_PER_SOURCE_SERVER for relocations off of servers excluded with drain
+	int RELOCATION_MAX_MB_IN_FLIGHT_PER_DEST_SERVER; // Relocations below PRIORITY_TEAM_UNHEALTHY wait while a destination is fetching more than this, with megabytes scaled by how much slower than DD_DEFAULT_FETCH_BYTES_PER_SECOND it has been fetching
+	double DD_DEFAULT_FETCH_BYTES_PER_SECOND; // Assumed fetch throughput of a server until relocations to or from it have been measured
+	double DD_FETCH_RATE_SMOOTHING; // Weight of each new relocation in a server's measured fetch throughput
+	double DD_RELOCATION_WORK_SECONDS; // A relocation expected to take this long at its sources' throughput counts as one of RELOCATION_PARALLELISM_PER_SOURCE_SERVER
+	double DD_RELOCATION_MIN_WORK_SCALE;
+	int DD_MOVEMENT_BUDGET_MB; // Megabytes all relocations below PRIORITY_TEAM_UNHEALTHY may have in flight at once
+	int DD_MOVEMENT_BUDGET_MIN_MB; // The budget is never cut below this while the foreground is saturated, and no one relocation takes more of it
+	double DD_MOVEMENT_BUDGET_ADJUST_INTERVAL;
+	double DD_MOVEMENT_BUDGET_DECREASE_RATIO;
+	int DD_MOVEMENT_BUDGET_INCREASE_MB;
 	int DD_QUEUE_MAX_KEY_SERVERS;
 	int DD_REBALANCE_PARALLELISM;
 	int DD_REBALANCE_RESET_AMOUNT;
@@ -84,6 +108,7 @@ public:
 	double INFLIGHT_PENALTY_HEALTHY;
 	double INFLIGHT_PENALTY_UNHEALTHY;
 	double INFLIGHT_PENALTY_ONE_LEFT;
+	double INFLIGHT_PENALTY_DRAIN; // Spreads the data of draining servers over many destination teams
 
 	// Data distribution
 	double RETRY_RELOCATESHARD_DELAY;
@@ -92,6 +117,8 @@ public:
 	int64_t SHARD_MAX_BYTES_PER_KSEC, // Shards with more than this bandwidth will be split immediately
 		SHARD_MIN_BYTES_PER_KSEC,     // Shards with more than this bandwidth will not be merged
 		SHARD_SPLIT_BYTES_PER_KSEC;   // When splitting a shard, it is split into pieces with less than this bandwidth
+	int64_t SHARD_MAX_BYTES_READ_PER_KSEC, // Shards with more than this read bandwidth will be split immediately
+		SHARD_SPLIT_BYTES_READ_PER_KSEC;   // When splitting a shard, it is split into pieces with less than this read bandwidth
 	double STORAGE_METRIC_TIMEOUT;
 	double METRIC_DELAY;
 	double ALL_DATA_REMOVED_DELAY;
@@ -100,10 +127,12 @@ public:
 	int BEST_TEAM_MAX_TEAM_TRIES;
 	int BEST_TEAM_OPTION_COUNT;
 	int BEST_OF_AMT;
+	int DD_MAX_ENUMERATED_TEAMS; // Above this many possible teams of the current servers, buildTeams() doesn't try to enumerate them all
 	double SERVER_LIST_DELAY;
 	double RECRUITMENT_IDLE_DELAY;
 	double STORAGE_RECRUITMENT_DELAY;
 	double DATA_DISTRIBUTION_LOGGING_INTERVAL;
+	double DD_EXCLUSION_DRAIN_RATE_FOLDING_TIME; // Of the rate at which data leaves draining servers, used to estimate when they will be empty
 	double DD_ENABLED_CHECK_DELAY;
 	double DD_MERGE_COALESCE_DELAY;
 	double STORAGE_METRICS_POLLING_DELAY;
@@ -132,12 +161,25 @@ public:
 	int64_t SOFT_HEAP_LIMIT;
 
 	int SQLITE_PAGE_SCAN_ERROR_LIMIT;
+	int SQLITE_CHECKPOINT_DEFER_READ_QUEUE;
+	double SQLITE_CHECKPOINT_MAX_DEFERRAL;
+	double SQLITE_CHECKPOINT_DEFER_POLL_INTERVAL;
+	int SQLITE_PAGE_SIZE;
 	int SQLITE_BTREE_PAGE_USABLE;
 	int SQLITE_BTREE_CELL_MAX_LOCAL;
 	int SQLITE_BTREE_CELL_MIN_LOCAL;
 	int SQLITE_FRAGMENT_PRIMARY_PAGE_USABLE;
 	int SQLITE_FRAGMENT_OVERFLOW_PAGE_USABLE;
 	double SQLITE_FRAGMENT_MIN_SAVINGS;
+	int SQLITE_BULK_READ_AHEAD_BYTES;
+	int SQLITE_READ_THREADS_INITIAL;
+	int SQLITE_READ_THREADS_MAX;
+	int SQLITE_SPLIT_READ_PARTS;
+	int SQLITE_SPLIT_READ_MIN_ROWS;
+	int SQLITE_SPLIT_READ_MIN_BYTES;
+	int SQLITE_READER_STACK_SIZE;  // A point or range read stays shallow in the btree...
+	int SQLITE_WRITER_STACK_SIZE;  // ... while commits, vacuuming and integrity checks go deeper
+	int CORO_STACK_POOL_SIZE;  // Freed coroutine stacks kept for reuse, per stack size
 
 	// KeyValueStoreSqlite spring cleaning
 	double CLEANING_INTERVAL;
@@ -149,12 +191,32 @@ public:
 	int SPRING_CLEANING_MIN_VACUUM_PAGES;
 	int SPRING_CLEANING_MAX_VACUUM_PAGES;
 
+	// KeyValueStoreMemory
+	int64_t KVS_MEMORY_SNAPSHOT_BATCH_BYTES; // Snapshot bytes written to the disk queue before the snapshot actor yields
+	int KVS_MEMORY_READ_THREADS; // If nonzero, the memory storage engine serves reads from this many threads instead of the network thread
+
+	// KeyValueStoreLSM
+	int64_t LSM_MEMTABLE_BYTES;
+	int LSM_BLOCK_BYTES;
+	int LSM_BLOCK_RESTART_INTERVAL;
+	int64_t LSM_TARGET_FILE_BYTES;
+	int LSM_WRITE_CHUNK_BYTES;
+	int LSM_L0_COMPACTION_TRIGGER;
+	int LSM_L0_STOP_WRITES_TRIGGER;
+	int64_t LSM_LEVEL1_BYTES;
+	int LSM_LEVEL_SIZE_MULTIPLIER;
+	int LSM_MAX_LEVELS;
+	int LSM_BLOOM_BITS_PER_KEY;
+	int64_t LSM_BLOCK_CACHE_BYTES;
+	double LSM_OBSOLETE_FILE_CHECK_INTERVAL;
+
 	// Leader election
 	double CANDIDATE_MIN_DELAY;
 	double CANDIDATE_MAX_DELAY;
 	double CANDIDATE_GROWTH_RATE;
 	double POLLING_FREQUENCY;
 	double HEARTBEAT_FREQUENCY;
+	int LEADER_NOTIFY_BATCH_SIZE; // A coordinator answers this many waiting leader polls between yields when the nominee changes
 
 	// Master Proxy
 	double START_TRANSACTION_BATCH_INTERVAL_MIN;
@@ -164,22 +226,34 @@ public:
 	double START_TRANSACTION_BATCH_QUEUE_CHECK_INTERVAL;
 	double START_TRANSACTION_MAX_TRANSACTIONS_TO_START;
 	double START_TRANSACTION_MAX_BUDGET_SIZE;
+	double START_TRANSACTION_CACHED_VERSION_MAX_STALENESS;
+	double START_TRANSACTION_CACHED_VERSION_REFRESH_INTERVAL;
 
 	double COMMIT_TRANSACTION_BATCH_INTERVAL_FROM_IDLE;
 	double COMMIT_TRANSACTION_BATCH_INTERVAL_MIN;
 	double COMMIT_TRANSACTION_BATCH_INTERVAL_MAX;
 	double COMMIT_TRANSACTION_BATCH_INTERVAL_LATENCY_FRACTION;
 	double COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA;
+	int    COMMIT_VERSION_REQUESTS_IN_FLIGHT_MAX;
+	int    COMMIT_VERSION_REQUEST_BATCHES_MAX;
 	int    COMMIT_TRANSACTION_BATCH_COUNT_MAX;
 	int    COMMIT_TRANSACTION_BATCH_BYTES_MIN;
 	int    COMMIT_TRANSACTION_BATCH_BYTES_MAX;
 	double COMMIT_TRANSACTION_BATCH_BYTES_SCALE_BASE;
 	double COMMIT_TRANSACTION_BATCH_BYTES_SCALE_POWER;
+	double COMMIT_BATCH_LATENCY_TARGET;
+	int COMMIT_BATCH_ADAPTIVE_BYTES_MIN;
+	int COMMIT_BATCH_ADAPTIVE_BYTES_MAX;
+	int COMMIT_BATCH_ADAPTIVE_COUNT_MIN;
+	double COMMIT_BATCH_ADAPTIVE_RESIZE_FACTOR;
 
 	double TRANSACTION_BUDGET_TIME;
 	double RESOLVER_COALESCE_TIME;
 	int BUGGIFIED_ROW_LIMIT;
 	double PROXY_SPIN_DELAY;
+	int PROXY_COALESCE_CONFLICT_RANGES;
+	int PROXY_MAX_COMMIT_BATCHES_LOGGING;
+	int PROXY_FLAT_KEY_INFO_INDEX;
 
 	// Master Server
 	double MASTER_LOGGING_DELAY;
@@ -194,10 +268,18 @@ public:
 	double SAMPLE_EXPIRATION_TIME;
 	double SAMPLE_POLL_TIME;
 	int64_t RESOLVER_STATE_MEMORY_LIMIT;
+	int RESOLVER_CONFLICT_SET_THREADS;
+	int RESOLVER_CONFLICT_DETECTION_THREAD; // If nonzero, each batch's conflict detection runs on a separate thread while the network thread keeps serving requests
+	int RESOLVER_CONFLICT_SET_PARALLEL_MIN_RANGES;
+	int RESOLVER_BATCH_COMPACTION_NODES_PER_RANGE;
+	double RESOLVER_COMPACTION_INTERVAL;
+	int RESOLVER_COMPACTION_NODES_PER_STEP;
 
 	//Cluster Controller
 	double MASTER_FAILURE_REACTION_TIME;
 	double MASTER_FAILURE_SLOPE_DURING_RECOVERY;
+	int MASTER_SPECULATIVE_RECRUITMENT;
+	int TXN_STATE_CACHED_TRANSFER;
 	int WORKER_COORDINATION_PING_DELAY;
 	double SIM_SHUTDOWN_TIMEOUT;
 	double SHUTDOWN_TIMEOUT;
@@ -219,6 +301,12 @@ public:
 	int EXPECTED_PROXY_FITNESS;
 	int EXPECTED_RESOLVER_FITNESS;
 	double RECRUITMENT_TIMEOUT;
+	int DEGRADED_DISK_MIN_OPERATIONS;  // A worker reports its disk latencies once they cover at least this many reads and writes
+	double DEGRADED_DISK_LATENCY;  // A worker whose disk p99 latency is over this is degraded...
+	double DEGRADED_DISK_PEER_RATIO;  // ... as is one whose p99 is this many times the median of its peers' (of the same class)...
+	double DEGRADED_DISK_PEER_MIN_LATENCY;  // ... and over this
+	int DEGRADED_DISK_MIN_PEERS;
+	double DEGRADED_DISK_DURATION;  // How long a worker counts as degraded after a bad report
 
 	//Move Keys
 	double SHARD_READY_DELAY;
@@ -254,6 +342,11 @@ public:
 
 	double MAX_TL_SS_VERSION_DIFFERENCE; // spring starts at half this value
 	int MAX_MACHINES_FALLING_BEHIND;
+	double RATEKEEPER_PREDICTION_HORIZON;
+	double TAG_THROTTLE_MIN_SHARE;
+	double TAG_THROTTLE_MIN_TPS;
+	double TAG_THROTTLE_RELAX_RATE;
+	int TAG_THROTTLE_MAX_TRACKED_TAGS;
 
 	//Storage Metrics
 	double STORAGE_METRICS_AVERAGE_INTERVAL;
@@ -261,6 +354,15 @@ public:
 	double SPLIT_JITTER_AMOUNT;
 	int64_t IOPS_UNITS_PER_SAMPLE;
 	int64_t BANDWIDTH_UNITS_PER_SAMPLE;
+	int64_t BYTES_READ_UNITS_PER_SAMPLE;
+
+	//Hot keys
+	int HOT_KEY_SKETCH_DEPTH;
+	int HOT_KEY_SKETCH_WIDTH;
+	int HOT_KEY_TOP_K;
+	double HOT_KEY_LOGGING_INTERVAL;
+	double HOT_KEY_DECAY;
+	int HOT_KEY_MAX_REPORTED_BYTES;
 
 	//Storage Server
 	double STORAGE_LOGGING_DELAY;
@@ -268,18 +370,47 @@ public:
 	double FUTURE_VERSION_DELAY;
 	int STORAGE_LIMIT_BYTES;
 	int BUGGIFY_LIMIT_BYTES;
+	int FIND_KEY_MAX_READS;
+	int MAX_PINNED_SNAPSHOTS;  // Per storage server
+	double MAX_PINNED_SNAPSHOT_LEASE;
+	int EXPORT_RANGE_FILE_BYTES;  // Target size of the range files a storage server writes for an ExportRangeRequest
+	int EXPORT_RANGE_PARALLELISM;  // ExportRangeRequests a storage server works on at once
 	int FETCH_BLOCK_BYTES;
 	int FETCH_KEYS_PARALLELISM_BYTES;
+	int FETCH_KEYS_PARALLEL_PARTS;
+	double FETCH_KEYS_SPLIT_TIMEOUT;
 	int BUGGIFY_BLOCK_BYTES;
 	int64_t STORAGE_HARD_LIMIT_BYTES;
 	int STORAGE_COMMIT_BYTES;
 	double STORAGE_COMMIT_INTERVAL;
+	double STORAGE_DURABILITY_LAG_TARGET;
+	int64_t STORAGE_COMMIT_BYTES_MAX;
+	double STORAGE_COMMIT_RATE_SMOOTHING_ALPHA;
 	double UPDATE_SHARD_VERSION_INTERVAL;
 	int BYTE_SAMPLING_FACTOR;
 	int BYTE_SAMPLING_OVERHEAD;
 	int MAX_STORAGE_SERVER_WATCH_BYTES;
+	bool STORAGE_COALESCE_WATCHES;
+	bool STORAGE_PARALLEL_PEEK;
+	bool STORAGE_FUSE_ATOMIC_OPS;
+	double STORAGE_READ_QUEUE_LATENCY_TARGET; // Reads are shed with process_behind while the last read of their priority waited longer than this for its turn
+	double STORAGE_BATCH_READ_QUEUE_LATENCY_TARGET;
 	int MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE;
 	double LONG_BYTE_SAMPLE_RECOVERY_DELAY;
+	int64_t STORAGE_HOT_KEY_CACHE_BYTES;
+	int STORAGE_PREFETCH_EAGER_READ_KEYS;
+	bool STORAGE_VALUE_COMPRESSION;  // Whether storage servers created from now on compress the values they store; each server keeps the setting it was created with
+	int STORAGE_VALUE_COMPRESSION_MIN_BYTES;
+	int STORAGE_VALUE_COMPRESSION_LEVEL;  // zlib level, 1 (fastest) to 9
+	bool STORAGE_MEMORY_GOVERNOR;  // Whether storage servers resize the page cache, hot key cache and e-brake to fit the process's memory
+	double STORAGE_MEMORY_GOVERNOR_INTERVAL;
+	int64_t STORAGE_MEMORY_GOVERNOR_RESERVE_BYTES;  // Left unused below the --memory limit
+	double STORAGE_MEMORY_GOVERNOR_MVCC_HEADROOM;  // Memory kept for MVCC data, as a multiple of what it is using now
+	int64_t STORAGE_MEMORY_GOVERNOR_MIN_MVCC_BYTES;
+	int64_t STORAGE_MEMORY_GOVERNOR_MIN_PAGE_CACHE_BYTES;
+	int64_t STORAGE_MEMORY_GOVERNOR_MIN_HOT_KEY_CACHE_BYTES;
+	double STORAGE_MEMORY_GOVERNOR_STEP;  // Fraction of the cache memory moved between the caches per interval
+	double STORAGE_MEMORY_GOVERNOR_HOT_KEY_MISS_COST;  // Of a hot key cache miss, relative to a page cache miss
 
 	//Wait Failure
 	int BUGGIFY_OUTSTANDING_WAIT_FAILURE_REQUESTS;
@@ -288,6 +419,7 @@ public:
 
 	//Worker
 	double WORKER_LOGGING_INTERVAL;
+	double WORKER_HEALTH_REPORT_INTERVAL;
 	double INCOMPATIBLE_PEER_DELAY_BEFORE_LOGGING;
 
 	// Test harness
@@ -302,12 +434,39 @@ public:
 
 	// Status
 	double STATUS_MIN_TIME_BETWEEN_REQUESTS;
+	double STATUS_CACHE_MAX_AGE;
 	int CONFIGURATION_ROWS_TO_FETCH;
 
 	// Timekeeper
 	int64_t TIME_KEEPER_DELAY;
 	int64_t TIME_KEEPER_MAX_ENTRIES;
 
+	// Network test
+	int NETWORK_TEST_CLIENT_COUNT;  // Requests the client keeps outstanding to each server
+	int NETWORK_TEST_REQUEST_SIZE;  // Mean request payload, in bytes
+	int NETWORK_TEST_REPLY_SIZE;  // Mean reply payload, in bytes
+	int NETWORK_TEST_SIZE_DISTRIBUTION;  // 0: every payload is the mean size; 1: uniform from 0 to twice the mean; 2: exponential
+	bool NETWORK_TEST_COMPRESSIBLE;  // Payloads of one repeated byte rather than random bytes, to exercise packet compression
+	double NETWORK_TEST_DURATION;  // The client prints a summary and exits after this long; 0 runs until killed
+	double NETWORK_TEST_REPORT_INTERVAL;
+
+	// KV bench
+	std::string KV_BENCH_STORE_TYPE;  // ssd-1, ssd-2, memory or lsm
+	int KV_BENCH_KEY_COUNT;  // Loaded before the run if the store is empty
+	int KV_BENCH_KEY_BYTES;
+	int KV_BENCH_VALUE_BYTES;
+	double KV_BENCH_READ_FRACTION;  // Of operations, point reads
+	double KV_BENCH_SCAN_FRACTION;  // Range reads of KV_BENCH_SCAN_ROWS rows
+	double KV_BENCH_CLEAR_FRACTION;  // Clears of one key; the rest of the operations are sets
+	int KV_BENCH_SCAN_ROWS;
+	double KV_BENCH_KEY_SKEW;  // Key i is chosen as KEY_COUNT * r^SKEW for uniform r: 1 is uniform and larger values favor low keys
+	double KV_BENCH_OPERATIONS_PER_SECOND;
+	double KV_BENCH_DURATION;
+	double KV_BENCH_COMMIT_INTERVAL;
+	int KV_BENCH_MAX_OUTSTANDING_READS;  // Reads are not started while this many are outstanding, so a slow store falls behind the target rate rather than queueing without bound
+	int64_t KV_BENCH_MEMORY_LIMIT;  // For the memory store
+	double KV_BENCH_REPORT_INTERVAL;
+
 	ServerKnobs(bool randomize = false, ClientKnobs* clientKnobs = NULL);
 };
 
@@ -82,6 +82,14 @@ struct LogRouterData {
 
 	std::vector<Reference<TagData>> tag_data; //we only store data for the remote tag locality
 
+	// Remote tLogs keep several peeks outstanding (see serverPeekParallelGetMore), and each one begins where the previous one in its sequence ended
+	struct PeekTrackerData {
+		std::map<int, Promise<Version>> sequence_version;
+		double lastUpdate;
+	};
+
+	std::map<UID, PeekTrackerData> peekTracker;
+
 	Reference<TagData> getTagData(Tag tag) {
 		ASSERT(tag.locality == tagLocalityRemoteLog);
 		if(tag.id >= tag_data.size()) {
@@ -167,7 +175,7 @@ ACTOR Future<Void> pullAsyncData( LogRouterData *self, Tag tag ) {
 				when( Void _ = wait( dbInfoChange ) ) { //FIXME: does this actually happen?
 					if(r) tagPopped = std::max(tagPopped, r->popped());
 					if( self->logSystem->get() )
-						r = self->logSystem->get()->peekSingle( tagAt, tag );
+						r = self->logSystem->get()->peekSingle( tagAt, tag, vector<pair<Version,Tag>>(), true );
 					else
 						r = Reference<ILogSystem::IPeekCursor>();
 					dbInfoChange = self->logSystem->onChange();
@@ -256,8 +264,48 @@ Version poppedVersion( LogRouterData* self, Tag tag) {
 	return tagData->popped;
 }
 
+// Records where the peek with the given sequence number ended, which is where the next one in the sequence begins.  Returns false if
+// a retry of the peek ended somewhere else, in which case the peeker has to start over.
+bool setPeekSequenceEnd( LogRouterData* self, UID peekId, int sequence, Version end ) {
+	auto& trackerData = self->peekTracker[peekId];
+	trackerData.lastUpdate = now();
+	auto& sequenceData = trackerData.sequence_version[sequence+1];
+	if(sequenceData.isSet()) {
+		if(sequenceData.getFuture().get() != end) {
+			TEST(true); //log router peek second attempt ended at a different version
+			return false;
+		}
+	} else {
+		sequenceData.send(end);
+	}
+	return true;
+}
+
 ACTOR Future<Void> logRouterPeekMessages( LogRouterData* self, TLogPeekRequest req ) {
 	state BinaryWriter messages(Unversioned());
+	state int sequence = -1;
+	state UID peekId;
+
+	if(req.sequence.present()) {
+		try {
+			peekId = req.sequence.get().first;
+			sequence = req.sequence.get().second;
+			if(sequence > 0) {
+				auto& trackerData = self->peekTracker[peekId];
+				trackerData.lastUpdate = now();
+				Version ver = wait(trackerData.sequence_version[sequence].getFuture());
+				req.begin = ver;
+				Void _ = wait(yield());
+			}
+		} catch( Error &e ) {
+			if(e.code() == error_code_timed_out) {
+				req.reply.sendError(timed_out());
+				return Void();
+			} else {
+				throw;
+			}
+		}
+	}
 
 	//TraceEvent("LogRouterPeek1", self->dbgid).detail("from", req.reply.getEndpoint().address).detail("ver", self->version.get()).detail("begin", req.begin);
 	if( req.returnIfBlocked && self->version.get() < req.begin ) {
@@ -279,6 +327,12 @@ ACTOR Future<Void> logRouterPeekMessages( LogRouterData* self, TLogPeekRequest r
 		rep.maxKnownVersion = self->version.get();
 		rep.popped = poppedVer;
 		rep.end = poppedVer;
+
+		if(req.sequence.present() && !setPeekSequenceEnd(self, peekId, sequence, rep.end)) {
+			req.reply.sendError(timed_out());
+			return Void();
+		}
+
 		req.reply.send( rep );
 		return Void();
 	}
@@ -291,6 +345,11 @@ ACTOR Future<Void> logRouterPeekMessages( LogRouterData* self, TLogPeekRequest r
 	reply.messages = messages.toStringRef();
 	reply.end = endVersion;
 
+	if(req.sequence.present() && !setPeekSequenceEnd(self, peekId, sequence, reply.end)) {
+		req.reply.sendError(timed_out());
+		return Void();
+	}
+
 	req.reply.send( reply );
 	//TraceEvent("LogRouterPeek4", self->dbgid);
 	return Void();
@@ -324,6 +383,38 @@ ACTOR Future<Void> logRouterPop( LogRouterData* self, TLogPopRequest req ) {
 	return Void();
 }
 
+ACTOR Future<Void> logRouterPopBatch( LogRouterData* self, TLogPopBatchRequest req ) {
+	state int i = 0;
+	for(; i < req.pops.size(); i++) {
+		Void _ = wait( logRouterPop( self, TLogPopRequest( req.pops[i].second, req.pops[i].first ) ) );
+	}
+	req.reply.send(Void());
+	return Void();
+}
+
+ACTOR Future<Void> cleanupPeekTrackers( LogRouterData* self ) {
+	loop {
+		double minTimeUntilExpiration = SERVER_KNOBS->PEEK_TRACKER_EXPIRATION_TIME;
+		auto it = self->peekTracker.begin();
+		while(it != self->peekTracker.end()) {
+			double timeUntilExpiration = it->second.lastUpdate + SERVER_KNOBS->PEEK_TRACKER_EXPIRATION_TIME - now();
+			if(timeUntilExpiration < 1.0e-6) {
+				for(auto seq : it->second.sequence_version) {
+					if(!seq.second.isSet()) {
+						seq.second.sendError(timed_out());
+					}
+				}
+				it = self->peekTracker.erase(it);
+			} else {
+				minTimeUntilExpiration = std::min(minTimeUntilExpiration, timeUntilExpiration);
+				++it;
+			}
+		}
+
+		Void _ = wait( delay(minTimeUntilExpiration) );
+	}
+}
+
 ACTOR Future<Void> logRouterCore(
 	TLogInterface interf,
 	Tag tag,
@@ -336,6 +427,7 @@ ACTOR Future<Void> logRouterCore(
 	state Future<Void> dbInfoChange = Void();
 
 	addActor.send( pullAsyncData(&logRouterData, tag) );
+	addActor.send( cleanupPeekTrackers(&logRouterData) );
 
 	loop choose {
 		when( Void _ = wait( dbInfoChange ) ) {
@@ -353,6 +445,9 @@ ACTOR Future<Void> logRouterCore(
 		when( TLogPopRequest req = waitNext( interf.popMessages.getFuture() ) ) {
 			addActor.send( logRouterPop( &logRouterData, req ) );
 		}
+		when( TLogPopBatchRequest req = waitNext( interf.popBatch.getFuture() ) ) {
+			addActor.send( logRouterPopBatch( &logRouterData, req ) );
+		}
 		when (Void _ = wait(error)) {}
 	}
 }
@@ -236,6 +236,7 @@ struct ILogSystem {
 		bool returnIfBlocked;
 
 		bool parallelGetMore;
+		int parallelDepth; // number of peeks serverPeekParallelGetMore keeps outstanding
 		int sequence;
 		Deque<Future<TLogPeekReply>> futureResults;
 		Future<Void> interfaceChanged;
@@ -293,6 +294,7 @@ struct ILogSystem {
 		Tag tag;
 		int bestServer, currentCursor, readQuorum;
 		Optional<LogMessageVersion> nextVersion;
+		Optional<LogMessageVersion> otherCursorsBound; // If present, no cursor other than currentCursor is before this version
 		LogMessageVersion messageVersion;
 		bool hasNextMessage;
 		UID randomID;
@@ -489,8 +491,9 @@ struct ILogSystem {
 		// If pop was previously or concurrently called with upTo > begin, the cursor may not return all such messages.  In that case cursor->popped() will
 		// be greater than begin to reflect that.
 
-	virtual Reference<IPeekCursor> peekSingle( Version begin, Tag tag, vector<pair<Version,Tag>> history = vector<pair<Version,Tag>>() ) = 0;
+	virtual Reference<IPeekCursor> peekSingle( Version begin, Tag tag, vector<pair<Version,Tag>> history = vector<pair<Version,Tag>>(), bool parallelGetMore = false ) = 0;
 		// Same contract as peek(), but blocks until the preferred log server(s) for the given tag are available (and is correspondingly less expensive)
+		// With parallelGetMore, the cursor of the current epoch keeps up to PARALLEL_GET_MORE_REQUESTS peeks outstanding
 
 	virtual void pop( Version upTo, Tag tag ) = 0;
 		// Permits, but does not require, the log subsystem to strip `tag` from any or all messages with message versions < (upTo,0)
@@ -597,12 +600,15 @@ struct LogPushData : NonCopyable {
 			next_message_tags.clear();
 		}
 		uint32_t subseq = this->subsequence++;
-		for(int loc : msg_locations) {
-			messagesWriter[loc] << uint32_t(rawMessageWithoutLength.size() + sizeof(subseq) + sizeof(uint16_t) + sizeof(Tag)*prev_tags.size()) << subseq << uint16_t(prev_tags.size());
-			for(auto& tag : prev_tags)
-				messagesWriter[loc] << tag;
-			messagesWriter[loc].serializeBytes(rawMessageWithoutLength);
-		}
+		if(msg_locations.empty())
+			return;
+		BinaryWriter& wr = messagesWriter[msg_locations.front()];
+		int offset = wr.getLength();
+		wr << uint32_t(rawMessageWithoutLength.size() + sizeof(subseq) + sizeof(uint16_t) + sizeof(Tag)*prev_tags.size()) << subseq << uint16_t(prev_tags.size());
+		for(auto& tag : prev_tags)
+			wr << tag;
+		wr.serializeBytes(rawMessageWithoutLength);
+		copyToOtherLocations(offset);
 	}
 
 	template <class T>
@@ -618,15 +624,15 @@ struct LogPushData : NonCopyable {
 		logSystem->getPushLocations( prev_tags, msg_locations );
 		
 		uint32_t subseq = this->subsequence++;
-		for(int loc : msg_locations) {
-			// FIXME: memcpy after the first time
-			BinaryWriter& wr = messagesWriter[loc];
+		if(!msg_locations.empty()) {
+			BinaryWriter& wr = messagesWriter[msg_locations.front()];
 			int offset = wr.getLength();
 			wr << uint32_t(0) << subseq << uint16_t(prev_tags.size());
 			for(auto& tag : prev_tags)
 				wr << tag;
 			wr << item;
 			*(uint32_t*)((uint8_t*)wr.getData() + offset) = wr.getLength() - offset - sizeof(uint32_t);
+			copyToOtherLocations(offset);
 		}
 		next_message_tags.clear();
 	}
@@ -637,6 +643,15 @@ struct LogPushData : NonCopyable {
 	}
 
 private:
+	// A message is identical (length, subsequence, tags and body) in every location it is pushed to, so it is serialized
+	// only into the first location's buffer, starting at offset, and its bytes are then copied into each other location.
+	void copyToOtherLocations( int offset ) {
+		BinaryWriter& wr = messagesWriter[msg_locations.front()];
+		StringRef message( (uint8_t*)wr.getData() + offset, wr.getLength() - offset );
+		for(int i = 1; i < msg_locations.size(); i++)
+			messagesWriter[msg_locations[i]].serializeBytes(message);
+	}
+
 	Reference<ILogSystem> logSystem;
 	Arena arena;
 	vector<Tag> next_message_tags;
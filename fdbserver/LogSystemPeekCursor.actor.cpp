@@ -24,13 +24,13 @@
 #include "fdbrpc/ReplicationUtils.h"
 
 ILogSystem::ServerPeekCursor::ServerPeekCursor( Reference<AsyncVar<OptionalInterface<TLogInterface>>> const& interf, Tag tag, Version begin, Version end, bool returnIfBlocked, bool parallelGetMore )
-			: interf(interf), tag(tag), messageVersion(begin), end(end), hasMsg(false), rd(results.arena, results.messages, Unversioned()), randomID(g_random->randomUniqueID()), poppedVersion(0), returnIfBlocked(returnIfBlocked), sequence(0), parallelGetMore(parallelGetMore) {
+			: interf(interf), tag(tag), messageVersion(begin), end(end), hasMsg(false), rd(results.arena, results.messages, Unversioned()), randomID(g_random->randomUniqueID()), poppedVersion(0), returnIfBlocked(returnIfBlocked), sequence(0), parallelGetMore(parallelGetMore), parallelDepth(SERVER_KNOBS->PARALLEL_GET_MORE_MIN_REQUESTS) {
 	this->results.maxKnownVersion = 0;
 	//TraceEvent("SPC_starting", randomID).detail("tag", tag.toString()).detail("begin", begin).detail("end", end).backtrace();
 }
 
 ILogSystem::ServerPeekCursor::ServerPeekCursor( TLogPeekReply const& results, LogMessageVersion const& messageVersion, LogMessageVersion const& end, int32_t messageLength, int32_t rawLength, bool hasMsg, Version poppedVersion, Tag tag )
-			: results(results), tag(tag), rd(results.arena, results.messages, Unversioned()), messageVersion(messageVersion), end(end), messageLength(messageLength), rawLength(rawLength), hasMsg(hasMsg), randomID(g_random->randomUniqueID()), poppedVersion(poppedVersion), returnIfBlocked(false), sequence(0), parallelGetMore(false)
+			: results(results), tag(tag), rd(results.arena, results.messages, Unversioned()), messageVersion(messageVersion), end(end), messageLength(messageLength), rawLength(rawLength), hasMsg(hasMsg), randomID(g_random->randomUniqueID()), poppedVersion(poppedVersion), returnIfBlocked(false), sequence(0), parallelGetMore(false), parallelDepth(0)
 {
 	//TraceEvent("SPC_clone", randomID);
 	this->results.maxKnownVersion = 0;
@@ -142,13 +142,19 @@ ACTOR Future<Void> serverPeekParallelGetMore( ILogSystem::ServerPeekCursor* self
 
 	loop {
 		try {
-			while(self->futureResults.size() < SERVER_KNOBS->PARALLEL_GET_MORE_REQUESTS && self->interf->get().present()) {
+			while(self->futureResults.size() < self->parallelDepth && self->interf->get().present()) {
 				self->futureResults.push_back( brokenPromiseToNever( self->interf->get().interf().peekMessages.getReply(TLogPeekRequest(self->messageVersion.version,self->tag,self->returnIfBlocked, std::make_pair(self->randomID, self->sequence++)), taskID) ) );
 			}
 
 			choose {
 				when( TLogPeekReply res = wait( self->interf->get().present() ? self->futureResults.front() : Never() ) ) {
 					self->futureResults.pop_front();
+					// A reply that stops short of what the tLog knows about means we are behind, so keep more peeks in flight until we catch up
+					if(res.end <= res.maxKnownVersion) {
+						self->parallelDepth = std::min(self->parallelDepth * 2, SERVER_KNOBS->PARALLEL_GET_MORE_REQUESTS);
+					} else {
+						self->parallelDepth = std::max(self->parallelDepth - 1, std::min(SERVER_KNOBS->PARALLEL_GET_MORE_MIN_REQUESTS, SERVER_KNOBS->PARALLEL_GET_MORE_REQUESTS));
+					}
 					self->results = res;
 					if(res.popped.present())
 						self->poppedVersion = std::min( std::max(self->poppedVersion, res.popped.get()), self->end.version );
@@ -349,6 +355,17 @@ void ILogSystem::MergedPeekCursor::updateMessage() {
 			break;
 		}
 	}
+
+	// When every cursor is needed for the quorum, messageVersion is just the minimum over the cursors.  Remember the smallest version of the
+	// others so that nextMessage() can keep taking messages from the current cursor without merging again until it catches up to them.
+	otherCursorsBound = Optional<LogMessageVersion>();
+	if(hasNextMessage && readQuorum == serverCursors.size()) {
+		for(int i = 0; i < serverCursors.size(); i++) {
+			if(i != currentCursor && (!otherCursorsBound.present() || serverCursors[i]->version() < otherCursorsBound.get())) {
+				otherCursorsBound = serverCursors[i]->version();
+			}
+		}
+	}
 }
 
 bool ILogSystem::MergedPeekCursor::hasMessage() {
@@ -358,7 +375,14 @@ bool ILogSystem::MergedPeekCursor::hasMessage() {
 void ILogSystem::MergedPeekCursor::nextMessage() {
 	nextVersion = version();
 	nextVersion.get().sub++;
-	serverCursors[currentCursor]->nextMessage();
+	auto& c = serverCursors[currentCursor];
+	c->nextMessage();
+	// Cursor versions only move forward, so a message before otherCursorsBound is still the minimum of the merge
+	if( bestServer < 0 && otherCursorsBound.present() && c->hasMessage() && c->version() < otherCursorsBound.get() ) {
+		messageVersion = c->version();
+		hasNextMessage = true;
+		return;
+	}
 	calcHasMessage();
 	ASSERT(hasMessage() || !version().sub);
 }
@@ -54,6 +54,7 @@ struct MasterInterface {
 struct GetRateInfoRequest {
 	UID requesterID;
 	int64_t totalReleasedTransactions;
+	std::vector<std::pair<Standalone<StringRef>, int64_t>> tagReleasedTransactions;  // Transactions started per tag since the previous request
 	ReplyPromise<struct GetRateInfoReply> reply;
 
 	GetRateInfoRequest() {}
@@ -61,17 +62,18 @@ struct GetRateInfoRequest {
 
 	template <class Ar>
 	void serialize(Ar& ar) {
-		ar & requesterID & totalReleasedTransactions & reply;
+		ar & requesterID & totalReleasedTransactions & tagReleasedTransactions & reply;
 	}
 };
 
 struct GetRateInfoReply {
 	double transactionRate;
 	double leaseDuration;
+	std::vector<std::pair<Standalone<StringRef>, double>> tagTransactionRates;  // Per-proxy start rates of throttled tags
 
 	template <class Ar>
 	void serialize(Ar& ar) {
-		ar & transactionRate & leaseDuration;
+		ar & transactionRate & leaseDuration & tagTransactionRates;
 	}
 };
 
@@ -145,15 +147,16 @@ struct GetCommitVersionRequest {
 	uint64_t requestNum;
 	uint64_t mostRecentProcessedRequestNum;
 	UID requestingProxy;
+	int versionCount;  // The number of commit batches sharing this request; the reply's version range [prevVersion, version] covers at least this many versions
 	ReplyPromise<GetCommitVersionReply> reply;
 
-	GetCommitVersionRequest() { }
-	GetCommitVersionRequest(uint64_t requestNum, uint64_t mostRecentProcessedRequestNum, UID requestingProxy)
-		: requestNum(requestNum), mostRecentProcessedRequestNum(mostRecentProcessedRequestNum), requestingProxy(requestingProxy) {}
+	GetCommitVersionRequest() : versionCount(1) { }
+	GetCommitVersionRequest(uint64_t requestNum, uint64_t mostRecentProcessedRequestNum, UID requestingProxy, int versionCount = 1)
+		: requestNum(requestNum), mostRecentProcessedRequestNum(mostRecentProcessedRequestNum), requestingProxy(requestingProxy), versionCount(versionCount) {}
 
 	template <class Ar>
 	void serialize(Ar& ar) {
-		ar & requestNum & mostRecentProcessedRequestNum & requestingProxy & reply;
+		ar & requestNum & mostRecentProcessedRequestNum & requestingProxy & versionCount & reply;
 	}
 };
 
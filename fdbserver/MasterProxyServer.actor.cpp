@@ -41,6 +41,7 @@
 #include "RecoveryState.h"
 #include "fdbclient/Atomic.h"
 #include "flow/TDMetric.actor.h"
+#include "flow/UnitTest.h"
 
 struct ProxyStats {
 	CounterCollection cc;
@@ -48,21 +49,31 @@ struct ProxyStats {
 	Counter txnSystemPriorityStartIn, txnSystemPriorityStartOut;
 	Counter txnBatchPriorityStartIn, txnBatchPriorityStartOut;
 	Counter txnDefaultPriorityStartIn, txnDefaultPriorityStartOut;
+	Counter txnStartCached;
 	Counter txnCommitIn, txnCommitVersionAssigned, txnCommitResolving, txnCommitResolved, txnCommitOut, txnCommitOutSuccess;
 	Counter txnConflicts;
 	Counter commitBatchIn, commitBatchOut;
 	Counter mutationBytes;
 	Counter mutations;
-	Counter conflictRanges;
+	Counter conflictRanges, conflictRangesCoalesced, conflictRangeBytesCoalesced;
 	Version lastCommitVersionAssigned;
 
+	// Time from the start of a commit batch until its replies are sent, counted once for each transaction in it, and the time
+	// to get a read version
+	LatencySample commitLatency, grvLatency;
+
+	// Time each commit batch spends in each stage of the commit pipeline, logged as ProxyCommitStageLatencies
+	LatencyHistogram commitVersionLatency, resolutionLatency, loggingQueueLatency, taggingLatency, logPushLatency, replyLatency;
+
 	Future<Void> logger;
 
 	explicit ProxyStats(UID id, Version* pVersion, NotifiedVersion* pCommittedVersion)
 	  : cc("ProxyStats", id.toString()),
 		txnStartIn("txnStartIn", cc), txnStartOut("txnStartOut", cc), txnStartBatch("txnStartBatch", cc), txnSystemPriorityStartIn("txnSystemPriorityStartIn", cc), txnSystemPriorityStartOut("txnSystemPriorityStartOut", cc), txnBatchPriorityStartIn("txnBatchPriorityStartIn", cc), txnBatchPriorityStartOut("txnBatchPriorityStartOut", cc),
-		txnDefaultPriorityStartIn("txnDefaultPriorityStartIn", cc), txnDefaultPriorityStartOut("txnDefaultPriorityStartOut", cc), txnCommitIn("txnCommitIn", cc),	txnCommitVersionAssigned("txnCommitVersionAssigned", cc), txnCommitResolving("txnCommitResolving", cc), txnCommitResolved("txnCommitResolved", cc), txnCommitOut("txnCommitOut", cc),
-		txnCommitOutSuccess("txnCommitOutSuccess", cc), txnConflicts("txnConflicts", cc), commitBatchIn("commitBatchIn", cc), commitBatchOut("commitBatchOut", cc), mutationBytes("mutationBytes", cc), mutations("mutations", cc), conflictRanges("conflictRanges", cc), lastCommitVersionAssigned(0)
+		txnDefaultPriorityStartIn("txnDefaultPriorityStartIn", cc), txnDefaultPriorityStartOut("txnDefaultPriorityStartOut", cc), txnStartCached("txnStartCached", cc), txnCommitIn("txnCommitIn", cc),	txnCommitVersionAssigned("txnCommitVersionAssigned", cc), txnCommitResolving("txnCommitResolving", cc), txnCommitResolved("txnCommitResolved", cc), txnCommitOut("txnCommitOut", cc),
+		txnCommitOutSuccess("txnCommitOutSuccess", cc), txnConflicts("txnConflicts", cc), commitBatchIn("commitBatchIn", cc), commitBatchOut("commitBatchOut", cc), mutationBytes("mutationBytes", cc), mutations("mutations", cc), conflictRanges("conflictRanges", cc),
+		conflictRangesCoalesced("conflictRangesCoalesced", cc), conflictRangeBytesCoalesced("conflictRangeBytesCoalesced", cc), lastCommitVersionAssigned(0),
+		commitLatency("commitLatency", cc), grvLatency("grvLatency", cc)
 	{
 		specialCounter(cc, "lastAssignedCommitVersion", [this](){return this->lastCommitVersionAssigned;});
 		specialCounter(cc, "version", [pVersion](){return *pVersion; });
@@ -82,7 +93,8 @@ Future<Void> forwardValue(Promise<T> out, Future<T> in)
 
 int getBytes(Promise<Version> const& r) { return 0; }
 
-ACTOR Future<Void> getRate(UID myID, MasterInterface master, int64_t* inTransactionCount, double* outTransactionRate) {
+ACTOR Future<Void> getRate(UID myID, MasterInterface master, int64_t* inTransactionCount, double* outTransactionRate,
+	std::map<Standalone<StringRef>, int64_t>* inTagTransactionCounts, std::map<Standalone<StringRef>, double>* outTagTransactionRates) {
 	state Future<Void> nextRequestTimer = Void();
 	state Future<Void> leaseTimeout = Never();
 	state Future<GetRateInfoReply> reply;
@@ -91,18 +103,23 @@ ACTOR Future<Void> getRate(UID myID, MasterInterface master, int64_t* inTransact
 	loop choose{
 		when(Void _ = wait(nextRequestTimer)) {
 			nextRequestTimer = Never();
-			reply = brokenPromiseToNever(master.getRateInfo.getReply(GetRateInfoRequest(myID, *inTransactionCount)));
+			GetRateInfoRequest req(myID, *inTransactionCount);
+			req.tagReleasedTransactions = std::vector<std::pair<Standalone<StringRef>, int64_t>>(inTagTransactionCounts->begin(), inTagTransactionCounts->end());
+			inTagTransactionCounts->clear();
+			reply = brokenPromiseToNever(master.getRateInfo.getReply(req));
 		}
 		when(GetRateInfoReply rep = wait(reply)) {
 			reply = Never();
 			*outTransactionRate = rep.transactionRate;
-			TraceEvent("MasterProxyRate", myID).detail("Rate", rep.transactionRate).detail("Lease", rep.leaseDuration).detail("ReleasedTransactions", *inTransactionCount - lastTC);
+			*outTagTransactionRates = std::map<Standalone<StringRef>, double>(rep.tagTransactionRates.begin(), rep.tagTransactionRates.end());
+			TraceEvent("MasterProxyRate", myID).detail("Rate", rep.transactionRate).detail("Lease", rep.leaseDuration).detail("ReleasedTransactions", *inTransactionCount - lastTC).detail("ThrottledTags", rep.tagTransactionRates.size());
 			lastTC = *inTransactionCount;
 			leaseTimeout = delay(rep.leaseDuration);
 			nextRequestTimer = delayJittered(rep.leaseDuration / 2);
 		}
 		when(Void _ = wait(leaseTimeout)) {
 			*outTransactionRate = 0;
+			outTagTransactionRates->clear();
 			TraceEvent("MasterProxyRate", myID).detail("Rate", 0).detail("Lease", "Expired");
 			leaseTimeout = Never();
 		}
@@ -165,6 +182,12 @@ DESCR struct SingleKeyMutation {
 	int64_t tag3;
 };
 
+// The snapshot is owned by the process global, so that it outlives the proxy which left it
+void setTxnStateSnapshot( Standalone<VectorRef<KeyValueRef>>* snapshot ) {
+	delete (Standalone<VectorRef<KeyValueRef>>*)g_network->global(INetwork::enTxnStateSnapshot);
+	g_network->setGlobal(INetwork::enTxnStateSnapshot, (flowGlobalType)snapshot);
+}
+
 struct ProxyCommitData {
 	UID dbgid;
 	ProxyStats stats;
@@ -178,10 +201,11 @@ struct ProxyCommitData {
 	Promise<Void> validState;  // Set once txnStateStore and version are valid
 	double lastVersionTime;
 	KeyRangeMap<std::set<Key>> vecBackupKeys;
+	ClientCacheRangeMap clientCacheRanges;
 	uint64_t commitVersionRequestNumber;
 	uint64_t mostRecentProcessedRequestNumber;
 	KeyRangeMap<Deque<std::pair<Version,int>>> keyResolvers;
-	KeyRangeMap<ServerCacheInfo> keyInfo;
+	KeyRangeMap<Reference<ServerCacheInfo>> keyInfo;
 	std::map<Key, applyMutationsData> uid_applyMutationsData;
 	bool firstProxy;
 	double lastCoalesceTime;
@@ -190,6 +214,13 @@ struct ProxyCommitData {
 	int64_t localCommitBatchesStarted;
 	NotifiedVersion latestLocalCommitBatchResolving;
 	NotifiedVersion latestLocalCommitBatchLogging;
+	int commitBatchesResolving;
+	int commitBatchDesiredCount, commitBatchDesiredBytes;	// Limits at which the batcher closes a commit batch
+	AsyncVar<int> commitBatchesLogging;	// Batches pushed to the log system which have not yet been made durable; bounded by PROXY_MAX_COMMIT_BATCHES_LOGGING
+
+	GetReadVersionReply cachedReadVersion;	// The newest causally consistent live committed version, for requests with FLAG_USE_CACHED_READ_VERSION
+	double cachedReadVersionTime;			// When the request that produced cachedReadVersion was started
+	double lastCachedReadVersionRequestTime;
 
 	PromiseStream<Void> commitBatchStartNotifications;
 	PromiseStream<Future<GetCommitVersionReply>> commitBatchVersions;  // 1:1 with commitBatchStartNotifications
@@ -199,14 +230,13 @@ struct ProxyCommitData {
 	EventMetricHandle<SingleKeyMutation> singleKeyMutationEvent;
 
 	std::map<UID, Reference<StorageInfo>> storageCache;
+	ServerTeamCache teamCache;
 
-	//The tag related to a storage server rarely change, so we keep a vector of tags for each key range to be slightly more CPU efficient.
+	//The tag related to a storage server rarely change, so we keep a vector of tags for each team in teamCache to be slightly more CPU efficient.
 	//When a tag related to a storage server does change, we empty out all of these vectors to signify they must be repopulated.
 	//We do not repopulate them immediately to avoid a slow task.
-	const vector<Tag>& tagsForKey(StringRef key) {
-		auto& tags = keyInfo[key].tags;
-		if(!tags.size()) {
-			auto& r = keyInfo.rangeContaining(key).value();
+	static const vector<Tag>& tagsForTeam(ServerCacheInfo& r) {
+		if(!r.tags.size()) {
 			for(auto info : r.src_info) {
 				r.tags.push_back(info->tag);
 			}
@@ -214,9 +244,56 @@ struct ProxyCommitData {
 				r.tags.push_back(info->tag);
 			}
 			uniquify(r.tags);
-			return r.tags;
 		}
-		return tags;
+		return r.tags;
+	}
+
+	//Every mutation is tagged by looking up its shard, so keyInfo is also kept flattened into sorted arrays of shard
+	//begin keys and teams, which a binary search walks with far fewer cache misses than the tree.  The arrays point
+	//into keyInfo and are rebuilt on the first lookup after applyMetadataMutations changes it.
+	std::vector<KeyRef> keyInfoBegins;
+	std::vector<ServerCacheInfo*> keyInfoTeams;
+	uint64_t keyInfoIndexChanges;
+	std::vector<ServerCacheInfo*> rangeTeams;
+
+	void updateKeyInfoIndex() {
+		if(keyInfoIndexChanges == teamCache.keyInfoChanges)
+			return;
+		keyInfoBegins.clear();
+		keyInfoTeams.clear();
+		for(auto r : keyInfo.ranges()) {
+			keyInfoBegins.push_back(r.begin());
+			keyInfoTeams.push_back(r.value().getPtr());
+		}
+		keyInfoIndexChanges = teamCache.keyInfoChanges;
+	}
+
+	int keyInfoIndexContaining(StringRef key) {
+		return std::upper_bound(keyInfoBegins.begin(), keyInfoBegins.end(), key) - keyInfoBegins.begin() - 1;
+	}
+
+	const vector<Tag>& tagsForKey(StringRef key) {
+		if(!SERVER_KNOBS->PROXY_FLAT_KEY_INFO_INDEX)
+			return tagsForTeam(*keyInfo[key]);
+		updateKeyInfoIndex();
+		return tagsForTeam(*keyInfoTeams[keyInfoIndexContaining(key)]);
+	}
+
+	// Returns the teams of the shards intersecting range, in key order.  The result is only valid until the next call.
+	const std::vector<ServerCacheInfo*>& teamsForRange(KeyRangeRef range) {
+		rangeTeams.clear();
+		if(!SERVER_KNOBS->PROXY_FLAT_KEY_INFO_INDEX) {
+			for(auto r : keyInfo.intersectingRanges(range)) {
+				rangeTeams.push_back(r.value().getPtr());
+			}
+			return rangeTeams;
+		}
+		updateKeyInfoIndex();
+		int end = std::lower_bound(keyInfoBegins.begin(), keyInfoBegins.end(), range.end) - keyInfoBegins.begin();
+		for(int i = keyInfoIndexContaining(range.begin); i < end; i++) {
+			rangeTeams.push_back(keyInfoTeams[i]);
+		}
+		return rangeTeams;
 	}
 
 	ProxyCommitData(UID dbgid, MasterInterface master, RequestStream<GetReadVersionRequest> getConsistentReadVersion, Version recoveryTransactionVersion, RequestStream<CommitTransactionRequest> commit, Reference<AsyncVar<ServerDBInfo>> db, bool firstProxy)
@@ -225,16 +302,82 @@ struct ProxyCommitData {
 			committedVersion(recoveryTransactionVersion), version(0), 
 			lastVersionTime(0), commitVersionRequestNumber(1), mostRecentProcessedRequestNumber(0),
 			getConsistentReadVersion(getConsistentReadVersion), commit(commit), lastCoalesceTime(0),
-			localCommitBatchesStarted(0), locked(false), firstProxy(firstProxy),
+			localCommitBatchesStarted(0), commitBatchesResolving(0), commitBatchDesiredCount(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_COUNT_MAX), commitBatchDesiredBytes(0), commitBatchesLogging(0), cachedReadVersionTime(0), lastCachedReadVersionRequestTime(0), locked(false), firstProxy(firstProxy), keyInfoIndexChanges(0),
 			cx(openDBOnServer(db, TaskDefaultEndpoint, true, true)), singleKeyMutationEvent(LiteralStringRef("SingleKeyMutation"))
-	{}
+	{
+		cachedReadVersion.version = invalidVersion;
+		cachedReadVersion.locked = false;
+		keyInfo.insert(allKeys, getServerCacheInfo(vector<UID>(), vector<UID>(), &teamCache, &storageCache, txnStateStore));
+		teamCache.keyInfoChanges++;
+		specialCounter(stats.cc, "commitBatchesResolving", [this](){ return this->commitBatchesResolving; });
+		specialCounter(stats.cc, "commitBatchesLogging", [this](){ return this->commitBatchesLogging.get(); });
+		specialCounter(stats.cc, "commitBatchDesiredCount", [this](){ return this->commitBatchDesiredCount; });
+		specialCounter(stats.cc, "commitBatchDesiredBytes", [this](){ return this->commitBatchDesiredBytes; });
+	}
+
+	~ProxyCommitData() {
+		// Leave our txnStateStore behind for the next proxy recruited in this process; see applyCachedTxnState()
+		if(SERVER_KNOBS->TXN_STATE_CACHED_TRANSFER && validState.isSet() && txnStateStore) {
+			Future<Standalone<VectorRef<KeyValueRef>>> snapshot = txnStateStore->readRange(allKeys);
+			if(snapshot.isReady() && !snapshot.isError()) {
+				setTxnStateSnapshot(new Standalone<VectorRef<KeyValueRef>>(snapshot.get()));
+			}
+		}
+	}
 };
 
+// Sorts ranges and merges those which overlap or abut, in place.  Conflict ranges only matter as a union,
+//   so this does not change which transactions conflict.  Returns the number of ranges removed and adds the
+//   key bytes that no longer need to be sent to *bytesRemoved.
+int coalesceConflictRanges( Arena& arena, VectorRef<KeyRangeRef>& ranges, int64_t* bytesRemoved ) {
+	if (ranges.size() < 2)
+		return 0;
+
+	std::sort( ranges.begin(), ranges.end(), KeyRangeRef::ArbitraryOrder() );
+	int out = 0;
+	for(int i = 1; i < ranges.size(); i++) {
+		if (ranges[i].begin <= ranges[out].end) {
+			*bytesRemoved += ranges[i].expectedSize();
+			if (ranges[i].end > ranges[out].end) {
+				*bytesRemoved += ranges[out].end.size() - ranges[i].end.size();
+				ranges[out] = KeyRangeRef( ranges[out].begin, ranges[i].end );
+			}
+		} else {
+			ranges[++out] = ranges[i];
+		}
+	}
+
+	int removed = ranges.size() - (out+1);
+	ranges.resize( arena, out+1 );
+	return removed;
+}
+
+// Feedback controller for commit batching, used when COMMIT_BATCH_LATENCY_TARGET is set.  A transaction's commit
+//   latency is roughly the time its batch spends collecting transactions plus the time the pipeline takes to resolve
+//   and log that batch, so the batch interval is whatever the target leaves over after the observed pipeline time.
+//   Batch size limits grow while batches fill up within the target and shrink when the target is missed.
+void updateCommitBatchLimits( ProxyCommitData* self, double pipelineTime, int batchCount, int batchBytes, double* commitBatchInterval ) {
+	double target = SERVER_KNOBS->COMMIT_BATCH_LATENCY_TARGET;
+	double alpha = SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA;
+	double interval = std::max(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN, std::min(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MAX, target - pipelineTime));
+	*commitBatchInterval = interval * alpha + *commitBatchInterval * (1-alpha);
+
+	double factor = SERVER_KNOBS->COMMIT_BATCH_ADAPTIVE_RESIZE_FACTOR;
+	if (*commitBatchInterval + pipelineTime > target) {
+		self->commitBatchDesiredCount = std::max<int>(SERVER_KNOBS->COMMIT_BATCH_ADAPTIVE_COUNT_MIN, self->commitBatchDesiredCount / factor);
+		self->commitBatchDesiredBytes = std::max<int>(SERVER_KNOBS->COMMIT_BATCH_ADAPTIVE_BYTES_MIN, self->commitBatchDesiredBytes / factor);
+	} else if (batchCount >= self->commitBatchDesiredCount || batchBytes >= self->commitBatchDesiredBytes) {
+		self->commitBatchDesiredCount = std::min<int>(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_COUNT_MAX, std::max<int>(self->commitBatchDesiredCount + 1, self->commitBatchDesiredCount * factor));
+		self->commitBatchDesiredBytes = std::min<int>(SERVER_KNOBS->COMMIT_BATCH_ADAPTIVE_BYTES_MAX, self->commitBatchDesiredBytes * factor);
+	}
+}
+
 struct ResolutionRequestBuilder {
 	ProxyCommitData* self;
 	vector<ResolveTransactionBatchRequest> requests;
 	vector<vector<int>> transactionResolverMap;
 	vector<CommitTransactionRef*> outTr;
+	vector<std::pair<int, VectorRef<MutationRef>>> metadataMutations;  // (transaction number, its metadata mutations in order) for just the transactions that have any
 
 	ResolutionRequestBuilder( ProxyCommitData* self, Version version, Version prevVersion, Version lastReceivedVersion) : self(self), requests(self->resolvers.size()) {
 		for(auto& req : requests) {
@@ -273,6 +416,12 @@ struct ResolutionRequestBuilder {
 				getOutTransaction(0, trIn.read_snapshot).mutations.push_back(requests[0].arena, m);
 			}
 		}
+		if (SERVER_KNOBS->PROXY_COALESCE_CONFLICT_RANGES) {
+			int64_t bytesRemoved = 0;
+			self->stats.conflictRangesCoalesced += coalesceConflictRanges( requests[0].arena, trIn.read_conflict_ranges, &bytesRemoved );
+			self->stats.conflictRangesCoalesced += coalesceConflictRanges( requests[0].arena, trIn.write_conflict_ranges, &bytesRemoved );
+			self->stats.conflictRangeBytesCoalesced += bytesRemoved;
+		}
 		for(auto& r : trIn.read_conflict_ranges) {
 			auto ranges = self->keyResolvers.intersectingRanges( r );
 			std::set<int> resolvers;
@@ -297,11 +446,14 @@ struct ResolutionRequestBuilder {
 			for(int resolver : resolvers)
 				getOutTransaction( resolver, trIn.read_snapshot ).write_conflict_ranges.push_back( requests[resolver].arena, r );
 		}
-		if (isTXNStateTransaction)
+		if (isTXNStateTransaction) {
 			for (int r = 0; r<requests.size(); r++) {
 				int transactionNumberInRequest = &getOutTransaction(r, trIn.read_snapshot) - requests[r].transactions.begin();
 				requests[r].txnStateTransactions.push_back(requests[r].arena, transactionNumberInRequest);
 			}
+			// Lives in requests[0].arena; nothing more is added to this transaction's mutations
+			metadataMutations.push_back(std::make_pair(transactionNumberInBatch, getOutTransaction(0, trIn.read_snapshot).mutations));
+		}
 
 		vector<int> resolversUsed;
 		for (int r = 0; r<outTr.size(); r++)
@@ -366,6 +518,8 @@ ACTOR Future<Void> commitBatch(
 
 	state Version commitVersion = versionReply.version;
 	state Version prevVersion = versionReply.prevVersion;
+	state double versionTime = now();
+	self->stats.commitVersionLatency.record(versionTime - t1);
 
 	for(auto it : versionReply.resolverChanges) {
 		auto rs = self->keyResolvers.modify(it.range);
@@ -401,12 +555,18 @@ ACTOR Future<Void> commitBatch(
 	}
 
 	state vector<vector<int>> transactionResolverMap = std::move( requests.transactionResolverMap );
+	state vector<ResolveTransactionBatchRequest> resolverRequests = std::move( requests.requests );  // For the conflicting ranges the resolvers name by index
+	state vector<std::pair<int, VectorRef<MutationRef>>> metadataMutations = std::move( requests.metadataMutations );  // In resolverRequests[0].arena
 
 	ASSERT(self->latestLocalCommitBatchResolving.get() == localBatchNumber-1);
 	self->latestLocalCommitBatchResolving.set(localBatchNumber);
 
 	/////// Phase 2: Resolution (waiting on the network; pipelined)
+	++self->commitBatchesResolving;
 	state vector<ResolveTransactionBatchReply> resolution = wait( getAll(replies) );
+	--self->commitBatchesResolving;
+	state double resolvedTime = now();
+	self->stats.resolutionLatency.record(resolvedTime - versionTime);
 
 	if (debugID.present())
 		g_traceBatch.addEvent("CommitDebug", debugID.get().first(), "MasterProxyServer.commitBatch.AfterResolution");
@@ -414,8 +574,16 @@ ACTOR Future<Void> commitBatch(
 	////// Phase 3: Post-resolution processing (CPU bound except for very rare situations; ordered; currently atomic but doesn't need to be)
 	TEST(self->latestLocalCommitBatchLogging.get() < localBatchNumber-1); // Queuing post-resolution commit processing 
 	Void _ = wait(self->latestLocalCommitBatchLogging.whenAtLeast(localBatchNumber-1));
+	// Bound the queue of batches waiting on the log system, so that a slow log push applies backpressure to the
+	//   batcher (which then forms larger batches) instead of letting work pile up on this proxy
+	while (SERVER_KNOBS->PROXY_MAX_COMMIT_BATCHES_LOGGING > 0 && self->commitBatchesLogging.get() >= SERVER_KNOBS->PROXY_MAX_COMMIT_BATCHES_LOGGING) {
+		TEST(true); // Commit batch waiting for earlier batches to finish logging
+		Void _ = wait(self->commitBatchesLogging.onChange());
+	}
 	Void _ = wait(yield());
 
+	state double taggingStartTime = now();
+	self->stats.loggingQueueLatency.record(taggingStartTime - resolvedTime);
 	self->stats.txnCommitResolved += trs.size();
 
 	if (debugID.present())
@@ -446,7 +614,7 @@ ACTOR Future<Void> commitBatch(
 			for (int resolver = 0; resolver < resolution.size(); resolver++)
 				committed = committed && resolution[resolver].stateMutations[versionIndex][transactionIndex].committed;
 			if (committed)
-				applyMetadataMutations( self->dbgid, arena, resolution[0].stateMutations[versionIndex][transactionIndex].mutations, self->txnStateStore, NULL, &forceRecovery, self->logSystem, 0, &self->vecBackupKeys, &self->keyInfo, self->firstProxy ? &self->uid_applyMutationsData : NULL, self->commit, self->cx, &self->committedVersion, &self->storageCache );
+				applyMetadataMutations( self->dbgid, arena, resolution[0].stateMutations[versionIndex][transactionIndex].mutations, self->txnStateStore, NULL, &forceRecovery, self->logSystem, 0, &self->vecBackupKeys, &self->keyInfo, self->firstProxy ? &self->uid_applyMutationsData : NULL, self->commit, self->cx, &self->committedVersion, &self->storageCache, &self->teamCache, false, &self->clientCacheRanges );
 			
 			if( resolution[0].stateMutations[versionIndex][transactionIndex].mutations.size() && firstStateMutations ) {
 				ASSERT(committed);
@@ -479,13 +647,17 @@ ACTOR Future<Void> commitBatch(
 
 	// Determine which transactions actually committed (conservatively) by combining results from the resolvers
 	state vector<uint8_t> committed(trs.size());
+	state vector<Optional<KeyRangeRef>> conflictingKeyRanges(trs.size());  // Only for transactions with FLAG_REPORT_CONFLICTING_KEYS
 	ASSERT(transactionResolverMap.size() == committed.size());
 	vector<int> nextTr(resolution.size());
 	for (int t = 0; t<trs.size(); t++) {
 		uint8_t commit = ConflictBatch::TransactionCommitted;
 		for (int r : transactionResolverMap[t])
 		{
-			commit = std::min(resolution[r].committed[nextTr[r]++], commit);
+			int i = nextTr[r]++;
+			commit = std::min(resolution[r].committed[i], commit);
+			if (trs[t].reportConflictingKeys() && !conflictingKeyRanges[t].present() && i < resolution[r].conflictingRanges.size() && resolution[r].conflictingRanges[i] >= 0)
+				conflictingKeyRanges[t] = resolverRequests[r].transactions[i].read_conflict_ranges[ resolution[r].conflictingRanges[i] ];
 		}
 		committed[t] = commit;
 	}
@@ -502,14 +674,20 @@ ACTOR Future<Void> commitBatch(
 	}
 
 	// This first pass through committed transactions deals with "metadata" effects (modifications of txnStateStore, changes to storage servers' responsibilities)
+	// Only the metadata mutations found while building the resolution requests are looked at, so most batches don't call applyMetadataMutations at all
 	int t;
+	int nextMetadata = 0;
 	state int commitCount = 0;
 	for (t = 0; t < trs.size() && !forceRecovery; t++)
 	{
+		bool hasMetadata = nextMetadata < metadataMutations.size() && metadataMutations[nextMetadata].first == t;
 		if (committed[t] == ConflictBatch::TransactionCommitted && (!locked || trs[t].isLockAware())) {
 			commitCount++;
-			applyMetadataMutations(self->dbgid, arena, trs[t].transaction.mutations, self->txnStateStore, &toCommit, &forceRecovery, self->logSystem, commitVersion+1, &self->vecBackupKeys, &self->keyInfo, self->firstProxy ? &self->uid_applyMutationsData : NULL, self->commit, self->cx, &self->committedVersion, &self->storageCache);
+			if (hasMetadata)
+				applyMetadataMutations(self->dbgid, arena, metadataMutations[nextMetadata].second, self->txnStateStore, &toCommit, &forceRecovery, self->logSystem, commitVersion+1, &self->vecBackupKeys, &self->keyInfo, self->firstProxy ? &self->uid_applyMutationsData : NULL, self->commit, self->cx, &self->committedVersion, &self->storageCache, &self->teamCache, false, &self->clientCacheRanges);
 		}
+		if (hasMetadata)
+			nextMetadata++;
 		if(firstStateMutations) {
 			ASSERT(committed[t] == ConflictBatch::TransactionCommitted);
 			firstStateMutations = false;
@@ -541,6 +719,7 @@ ACTOR Future<Void> commitBatch(
 	
 	state std::map<Key, MutationListRef> logRangeMutations;
 	state Arena logRangeMutationsArena;
+	state std::set<Key> cachedRangesWritten;  // Version keys of the client cache ranges written to
 	state uint32_t v = commitVersion / CLIENT_KNOBS->LOG_RANGE_BLOCK_SIZE;
 
 	for (int t = 0; t<trs.size(); t++) {
@@ -573,42 +752,21 @@ ACTOR Future<Void> commitBatch(
 					toCommit.addTypedMessage(m);
 				}
 				else if (m.type == MutationRef::ClearRange) {
-					auto ranges = self->keyInfo.intersectingRanges(KeyRangeRef(m.param1, m.param2));
-					auto firstRange = ranges.begin();
-					++firstRange;
-					if (firstRange == ranges.end()) {
+					auto& teams = self->teamsForRange(KeyRangeRef(m.param1, m.param2));
+					if (teams.size() == 1) {
 						// Fast path
+						auto& tags = ProxyCommitData::tagsForTeam(*teams[0]);
 						if (debugMutation("ProxyCommit", commitVersion, m))
-							TraceEvent("ProxyCommitTo", self->dbgid).detail("To", describe(ranges.begin().value().tags)).detail("Mutation", m.toString()).detail("Version", commitVersion);
-						
-						auto& tags = ranges.begin().value().tags;
-						if(!tags.size()) {
-							for( auto info : ranges.begin().value().src_info ) {
-								tags.push_back( info->tag );
-							}
-							for( auto info : ranges.begin().value().dest_info ) {
-								tags.push_back( info->tag );
-							}
-							uniquify(tags);
-						}
-						
+							TraceEvent("ProxyCommitTo", self->dbgid).detail("To", describe(tags)).detail("Mutation", m.toString()).detail("Version", commitVersion);
+
 						for (auto& tag : tags)
 							toCommit.addTag(tag);
 					}
 					else {
 						TEST(true); //A clear range extends past a shard boundary
 						std::set<Tag> allSources;
-						for (auto r : ranges) {
-							auto& tags = r.value().tags;
-							if(!tags.size()) {
-								for( auto info : r.value().src_info ) {
-									tags.push_back(info->tag);
-								}
-								for( auto info : r.value().dest_info ) {
-									tags.push_back(info->tag);
-								}
-								uniquify(tags);
-							}
+						for (auto team : teams) {
+							auto& tags = ProxyCommitData::tagsForTeam(*team);
 							allSources.insert(tags.begin(), tags.end());
 						}
 						if (debugMutation("ProxyCommit", commitVersion, m))
@@ -672,10 +830,36 @@ ACTOR Future<Void> commitBatch(
 						}
 					}
 				}
+
+				if ((self->clientCacheRanges.versionKeys.size() > 1) && normalKeys.contains(m.param1)) {
+					if (m.type == MutationRef::ClearRange) {
+						for (auto r : self->clientCacheRanges.versionKeys.intersectingRanges(KeyRangeRef(m.param1, m.param2)))
+							cachedRangesWritten.insert(r.value().begin(), r.value().end());
+					} else {
+						auto& versionKeys = self->clientCacheRanges.versionKeys[m.param1];
+						cachedRangesWritten.insert(versionKeys.begin(), versionKeys.end());
+					}
+				}
 			}
 		}
 	}
 
+	// Clients only use what they have cached from a range at read versions for which they have read its version key, so it must move
+	// with every commit that writes in the range, and with every change to the range itself
+	cachedRangesWritten.insert(self->clientCacheRanges.changed.begin(), self->clientCacheRanges.changed.end());
+	self->clientCacheRanges.changed.clear();
+	for (auto& versionKey : cachedRangesWritten) {
+		Optional<Value> end = self->txnStateStore->readValue(clientCacheRangeKeyFor(decodeClientCacheVersionKey(versionKey))).get();
+		MutationRef m;
+		if (end.present())
+			m = MutationRef(MutationRef::SetValue, StringRef(arena, versionKey), StringRef(arena, clientCacheVersionValue(commitVersion, end.get())));
+		else
+			m = MutationRef(MutationRef::ClearRange, StringRef(arena, versionKey), keyAfter(versionKey, arena));
+		for (auto& tag : self->tagsForKey(m.param1))
+			toCommit.addTag(tag);
+		toCommit.addTypedMessage(m);
+	}
+
 	// Serialize and backup the mutations as a single mutation
 	if ((self->vecBackupKeys.size() > 1) && logRangeMutations.size()) {
 
@@ -789,6 +973,9 @@ ACTOR Future<Void> commitBatch(
 	if ( prevVersion && commitVersion - prevVersion < SERVER_KNOBS->MAX_VERSIONS_IN_FLIGHT/2 )
 		debug_advanceMaxCommittedVersion(UID(), commitVersion);
 
+	state double pushTime = now();
+	self->stats.taggingLatency.record(pushTime - taggingStartTime);
+	self->commitBatchesLogging.set(self->commitBatchesLogging.get() + 1);
 	Future<Void> loggingComplete = self->logSystem->push( prevVersion, commitVersion, self->committedVersion.get(), toCommit, debugID ) 
 		|| self->committedVersion.whenAtLeast( commitVersion+1 );
 
@@ -799,6 +986,9 @@ ACTOR Future<Void> commitBatch(
 
 	/////// Phase 4: Logging (network bound; pipelined up to MAX_READ_TRANSACTION_LIFE_VERSIONS (limited by loop above))
 	Void _ = wait(loggingComplete);
+	self->commitBatchesLogging.set(self->commitBatchesLogging.get() - 1);
+	state double pushedTime = now();
+	self->stats.logPushLatency.record(pushedTime - pushTime);
 	Void _ = wait(yield());
 
 	/////// Phase 5: Replies (CPU bound; no particular order required, though ordered execution would be best for latency)	
@@ -835,11 +1025,15 @@ ACTOR Future<Void> commitBatch(
 		}
 		else if (committed[t] == ConflictBatch::TransactionTooOld)
 			trs[t].reply.sendError(transaction_too_old());
+		else if (committed[t] == ConflictBatch::TransactionConflict && conflictingKeyRanges[t].present())
+			trs[t].reply.send(CommitID(invalidVersion, t, KeyRange(conflictingKeyRanges[t].get())));
 		else
 			trs[t].reply.sendError(not_committed());
 	}
 
 	++self->stats.commitBatchOut;
+	self->stats.replyLatency.record(now() - pushedTime);
+	self->stats.commitLatency.addMeasurement(now() - t1, trs.size());
 	self->stats.txnCommitOut += trs.size();
 	self->stats.txnConflicts += trs.size() - commitCount;
 	self->stats.txnCommitOutSuccess += commitCount;
@@ -861,17 +1055,44 @@ ACTOR Future<Void> commitBatch(
 	}
 
 	// Dynamic batching for commits
-	double target_latency = (now() - t1) * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_LATENCY_FRACTION;
-	*commitBatchTime = 
-		std::max(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN, 
-			std::min(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MAX, 
-				target_latency * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA + *commitBatchTime * (1-SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA)));
+	if (SERVER_KNOBS->COMMIT_BATCH_LATENCY_TARGET > 0) {
+		int batchBytes = 0;
+		for (auto& tr : trs)
+			batchBytes += getBytes(tr);
+		updateCommitBatchLimits(self, now() - t1, trs.size(), batchBytes, commitBatchTime);
+	} else {
+		double target_latency = (now() - t1) * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_LATENCY_FRACTION;
+		*commitBatchTime = 
+			std::max(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN, 
+				std::min(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MAX, 
+					target_latency * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA + *commitBatchTime * (1-SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA)));
+	}
 
 
 	return Void();
 }
 
 
+void addLatencyDetails( TraceEvent& ev, std::string const& stage, LatencyHistogram& histogram ) {
+	ev.detail( (stage + "Median").c_str(), histogram.median() )
+		.detail( (stage + "P99").c_str(), histogram.percentile(0.99) )
+		.detail( (stage + "Max").c_str(), histogram.max() );
+	histogram.clear();
+}
+
+ACTOR Future<Void> commitStageLatencyLogger( ProxyCommitData* self ) {
+	loop {
+		Void _ = wait( delay( SERVER_KNOBS->WORKER_LOGGING_INTERVAL ) );
+		TraceEvent ev("ProxyCommitStageLatencies", self->dbgid);
+		addLatencyDetails( ev, "CommitVersion", self->stats.commitVersionLatency );
+		addLatencyDetails( ev, "Resolution", self->stats.resolutionLatency );
+		addLatencyDetails( ev, "LoggingQueue", self->stats.loggingQueueLatency );
+		addLatencyDetails( ev, "Tagging", self->stats.taggingLatency );
+		addLatencyDetails( ev, "LogPush", self->stats.logPushLatency );
+		addLatencyDetails( ev, "Reply", self->stats.replyLatency );
+	}
+}
+
 ACTOR Future<GetReadVersionReply> getLiveCommittedVersion(ProxyCommitData* commitData, uint32_t flags, vector<MasterProxyInterface> *otherProxies, Optional<UID> debugID, int transactionCount, int systemTransactionCount, int defaultPriTransactionCount, int batchPriTransactionCount)
 {
 	// Returns a version which (1) is committed, and (2) is >= the latest version reported committed (by a commit response) when this request was sent
@@ -880,6 +1101,7 @@ ACTOR Future<GetReadVersionReply> getLiveCommittedVersion(ProxyCommitData* commi
 	//     and no other proxy could have already committed anything without first ending the epoch
 	++commitData->stats.txnStartBatch;
 
+	state double startTime = now();
 	state vector<Future<GetReadVersionReply>> proxyVersions;
 	for (auto const& p : *otherProxies)
 		proxyVersions.push_back(brokenPromiseToNever(p.getRawCommittedVersion.getReply(GetRawCommittedVersionRequest(debugID), TaskTLogConfirmRunningReply)));
@@ -906,19 +1128,77 @@ ACTOR Future<GetReadVersionReply> getLiveCommittedVersion(ProxyCommitData* commi
 	if (debugID.present())
 		g_traceBatch.addEvent("TransactionDebug", debugID.get().first(), "MasterProxyServer.getLiveCommittedVersion.After");
 
+	// Any version at least as new as one committed when this request started is a valid cached read version until it is too old
+	if (!(flags&GetReadVersionRequest::FLAG_CAUSAL_READ_RISKY) && startTime > commitData->cachedReadVersionTime && rep.version >= commitData->cachedReadVersion.version) {
+		commitData->cachedReadVersion = rep;
+		commitData->cachedReadVersionTime = startTime;
+	}
+
 	commitData->stats.txnStartOut += transactionCount;
 	commitData->stats.txnSystemPriorityStartOut += systemTransactionCount;
 	commitData->stats.txnDefaultPriorityStartOut += defaultPriTransactionCount;
 	commitData->stats.txnBatchPriorityStartOut += batchPriTransactionCount;
+	commitData->stats.grvLatency.addMeasurement(now() - startTime, transactionCount);
 
 	return rep;
 }
 
+// While read version requests are being answered from the cache, keeps it within START_TRANSACTION_CACHED_VERSION_REFRESH_INTERVAL
+//   of the live committed version.  When no such requests arrive the refreshes stop, so an idle proxy does not contact the other proxies.
+ACTOR Future<Void> cachedReadVersionRefresher(ProxyCommitData* commitData, vector<MasterProxyInterface> *otherProxies) {
+	state double lastRefreshTime = 0;
+	loop {
+		Void _ = wait(delayJittered(SERVER_KNOBS->START_TRANSACTION_CACHED_VERSION_REFRESH_INTERVAL, TaskProxyGRVTimer));
+		if (commitData->lastCachedReadVersionRequestTime > lastRefreshTime) {
+			lastRefreshTime = now();
+			GetReadVersionReply _ = wait(getLiveCommittedVersion(commitData, 0, otherProxies, Optional<UID>(), 0, 0, 0, 0));
+		}
+	}
+}
+
+// Splits a reply to a request shared by count commit batches into the reply for the index'th of them.  The batches take the last
+//   count versions of the range in order, so the first one absorbs the gap since the previous reply and the rest follow it by one.
+static GetCommitVersionReply commitVersionForBatch( GetCommitVersionReply const& shared, int index, int count ) {
+	GetCommitVersionReply rep = shared;
+	rep.version = shared.version - (count - 1 - index);
+	if(index > 0) {
+		rep.prevVersion = rep.version - 1;
+		rep.resolverChanges = Standalone<VectorRef<ResolverMoveRef>>();
+		rep.resolverChangesVersion = 0;
+	}
+	return rep;
+}
+
+// Requests a commit version from the master for each commit batch started.  When COMMIT_VERSION_REQUESTS_IN_FLIGHT_MAX requests are
+//   already outstanding, batches that start in the meantime are piggybacked onto a single request for a range of versions.
 ACTOR Future<Void> fetchVersions(ProxyCommitData *commitData) {
+	state FutureStream<Void> batchStarts = commitData->commitBatchStartNotifications.getFuture();
+	state Deque<Future<Void>> inFlight;
 	loop {
-		Void _ = waitNext(commitData->commitBatchStartNotifications.getFuture());
-		GetCommitVersionRequest req(commitData->commitVersionRequestNumber++, commitData->mostRecentProcessedRequestNumber, commitData->dbgid);
-		commitData->commitBatchVersions.send(brokenPromiseToNever(commitData->master.getCommitVersion.getReply(req)));
+		Void _ = waitNext(batchStarts);
+		while(inFlight.size() && inFlight.front().isReady())
+			inFlight.pop_front();
+		if(inFlight.size() >= SERVER_KNOBS->COMMIT_VERSION_REQUESTS_IN_FLIGHT_MAX) {
+			Void _ = wait(inFlight.front());
+			inFlight.pop_front();
+		}
+
+		int count = 1;
+		while(count < SERVER_KNOBS->COMMIT_VERSION_REQUEST_BATCHES_MAX && batchStarts.isReady()) {
+			batchStarts.pop();
+			count++;
+		}
+
+		GetCommitVersionRequest req(commitData->commitVersionRequestNumber++, commitData->mostRecentProcessedRequestNumber, commitData->dbgid, count);
+		Future<GetCommitVersionReply> reply = brokenPromiseToNever(commitData->master.getCommitVersion.getReply(req));
+		inFlight.push_back(ready(reply));
+		if(count == 1) {
+			commitData->commitBatchVersions.send(reply);
+		} else {
+			TEST(true); // Commit batches sharing a commit version request
+			for(int i = 0; i < count; i++)
+				commitData->commitBatchVersions.send(map(reply, [i, count](GetCommitVersionReply const& rep) { return commitVersionForBatch(rep, i, count); }));
+		}
 	}
 }
 
@@ -940,8 +1220,13 @@ ACTOR static Future<Void> transactionStarter(
 	state std::priority_queue<std::pair<GetReadVersionRequest, int64_t>, std::vector<std::pair<GetReadVersionRequest, int64_t>>> transactionQueue;
 	state vector<MasterProxyInterface> otherProxies;
 
+	// Tagged transactions started since the last rate request, and the start rates (with their unspent budgets) of the tags ratekeeper is throttling
+	state std::map<Standalone<StringRef>, int64_t> tagTransactionCounts;
+	state std::map<Standalone<StringRef>, double> tagTransactionRates;
+	state std::map<Standalone<StringRef>, double> tagTransactionBudgets;
+
 	state PromiseStream<double> replyTimes;
-	addActor.send(getRate(proxy.id(), master, &transactionCount, &transactionRate));
+	addActor.send(getRate(proxy.id(), master, &transactionCount, &transactionRate, &tagTransactionCounts, &tagTransactionRates));
 	addActor.send(queueTransactionStartRequests(&transactionQueue, proxy.getConsistentReadVersion.getFuture(), GRVTimer, &lastGRVTime, &GRVBatchTime, replyTimes.getFuture(), &commitData->stats));
 
 	// Get a list of the other proxies that go together with us
@@ -954,6 +1239,9 @@ ACTOR static Future<Void> transactionStarter(
 
 	ASSERT(db->get().recoveryState >= RecoveryState::FULLY_RECOVERED);  // else potentially we could return uncommitted read versions (since self->committedVersion is only a committed version if this recovery succeeds)
 
+	if (SERVER_KNOBS->START_TRANSACTION_CACHED_VERSION_MAX_STALENESS > 0)
+		addActor.send(cachedReadVersionRefresher(commitData, &otherProxies));
+
 	TraceEvent("ProxyReadyForTxnStarts", proxy.id());
 
 	loop{
@@ -966,40 +1254,79 @@ ACTOR static Future<Void> transactionStarter(
 		if(elapsed == 0) elapsed = 1e-15; // resolve a possible indeterminant multiplication with infinite transaction rate
 		double nTransactionsToStart = std::min(transactionRate * elapsed, SERVER_KNOBS->START_TRANSACTION_MAX_TRANSACTIONS_TO_START) + transactionBudget;
 
-		int transactionsStarted[2] = {0,0};
-		int systemTransactionsStarted[2] = {0,0};
-		int defaultPriTransactionsStarted[2] = { 0, 0 };
-		int batchPriTransactionsStarted[2] = { 0, 0 };
+		for (auto b = tagTransactionBudgets.begin(); b != tagTransactionBudgets.end(); ) {
+			if (!tagTransactionRates.count(b->first))
+				b = tagTransactionBudgets.erase(b);
+			else
+				++b;
+		}
+		for (auto& r : tagTransactionRates) {
+			double& budget = tagTransactionBudgets[r.first];
+			budget = std::min(budget + r.second * elapsed, std::max(1.0, r.second * SERVER_KNOBS->START_TRANSACTION_BATCH_INTERVAL_MAX));
+		}
+		std::vector<std::pair<GetReadVersionRequest, int64_t>> throttledRequests;
+
+		int transactionsStarted[3] = {0,0,0};
+		int systemTransactionsStarted[3] = {0,0,0};
+		int defaultPriTransactionsStarted[3] = { 0, 0, 0 };
+		int batchPriTransactionsStarted[3] = { 0, 0, 0 };
 
-		vector<vector<ReplyPromise<GetReadVersionReply>>> start(2);  // start[0] is transactions starting with !(flags&CAUSAL_READ_RISKY), start[1] is transactions starting with flags&CAUSAL_READ_RISKY
+		vector<vector<ReplyPromise<GetReadVersionReply>>> start(3);  // start[0] is transactions starting with !(flags&CAUSAL_READ_RISKY), start[1] is transactions starting with flags&CAUSAL_READ_RISKY,
+																	 // start[2] is transactions with flags&USE_CACHED_READ_VERSION answered from commitData->cachedReadVersion
 		Optional<UID> debugID;
 
+		bool cachedVersionValid = SERVER_KNOBS->START_TRANSACTION_CACHED_VERSION_MAX_STALENESS > 0 &&
+			t - commitData->cachedReadVersionTime <= SERVER_KNOBS->START_TRANSACTION_CACHED_VERSION_MAX_STALENESS;
+
 		double leftToStart = 0;
 		while (!transactionQueue.empty()) {
 			auto& req = transactionQueue.top().first;
 			int tc = req.transactionCount;
-			leftToStart = nTransactionsToStart - transactionsStarted[0] - transactionsStarted[1];
+			leftToStart = nTransactionsToStart - transactionsStarted[0] - transactionsStarted[1] - transactionsStarted[2];
 
 			bool startNext = tc < leftToStart || req.priority() >= GetReadVersionRequest::PRIORITY_SYSTEM_IMMEDIATE || tc * g_random->random01() < leftToStart - std::max(0.0, transactionBudget);
 			if (!startNext) break;
 
+			if (req.tag.present()) {
+				auto budget = tagTransactionBudgets.find(req.tag.get());
+				if (budget != tagTransactionBudgets.end() && req.priority() < GetReadVersionRequest::PRIORITY_SYSTEM_IMMEDIATE) {
+					// Requests from a throttled tag wait for its budget without holding up the requests behind them
+					if (budget->second < tc) {
+						throttledRequests.push_back(transactionQueue.top());
+						transactionQueue.pop();
+						continue;
+					}
+					budget->second -= tc;
+				}
+				tagTransactionCounts[req.tag.get()] += tc;
+			}
+
 			if (req.debugID.present()) {
 				if (!debugID.present()) debugID = g_nondeterministic_random->randomUniqueID();
 				g_traceBatch.addAttach("TransactionAttachID", req.debugID.get().first(), debugID.get().first());
 			}
-			start[req.flags & 1].push_back(std::move(req.reply));  static_assert(GetReadVersionRequest::FLAG_CAUSAL_READ_RISKY == 1, "Implementation dependent on flag value");
+			int kind = req.flags & 1;  static_assert(GetReadVersionRequest::FLAG_CAUSAL_READ_RISKY == 1, "Implementation dependent on flag value");
+			if (req.flags & GetReadVersionRequest::FLAG_USE_CACHED_READ_VERSION) {
+				commitData->lastCachedReadVersionRequestTime = t;
+				if (cachedVersionValid)
+					kind = 2;
+			}
+			start[kind].push_back(std::move(req.reply));
 
-			transactionsStarted[req.flags&1] += tc;
+			transactionsStarted[kind] += tc;
 			if (req.priority() >= GetReadVersionRequest::PRIORITY_SYSTEM_IMMEDIATE)
-				systemTransactionsStarted[req.flags & 1] += tc;
+				systemTransactionsStarted[kind] += tc;
 			else if (req.priority() >= GetReadVersionRequest::PRIORITY_DEFAULT)
-				defaultPriTransactionsStarted[req.flags & 1] += tc;
+				defaultPriTransactionsStarted[kind] += tc;
 			else
-				batchPriTransactionsStarted[req.flags & 1] += tc;
+				batchPriTransactionsStarted[kind] += tc;
 
 			transactionQueue.pop();
 		}
 
+		for (auto& r : throttledRequests)
+			transactionQueue.push(std::move(r));
+
 		if (!transactionQueue.empty())
 			forwardPromise(GRVTimer, delayJittered(SERVER_KNOBS->START_TRANSACTION_BATCH_QUEUE_CHECK_INTERVAL, TaskProxyGRVTimer));
 
@@ -1021,11 +1348,23 @@ ACTOR static Future<Void> transactionStarter(
 			addActor.send(timeReply(GRVReply.getFuture(), replyTimes));
 		}
 
-		transactionCount += transactionsStarted[0] + transactionsStarted[1];
-		transactionBudget = std::max(std::min(nTransactionsToStart - transactionsStarted[0] - transactionsStarted[1], SERVER_KNOBS->START_TRANSACTION_MAX_BUDGET_SIZE), -SERVER_KNOBS->START_TRANSACTION_MAX_BUDGET_SIZE);
+		int totalStarted = transactionsStarted[0] + transactionsStarted[1] + transactionsStarted[2];
+		transactionCount += totalStarted;
+		transactionBudget = std::max(std::min(nTransactionsToStart - totalStarted, SERVER_KNOBS->START_TRANSACTION_MAX_BUDGET_SIZE), -SERVER_KNOBS->START_TRANSACTION_MAX_BUDGET_SIZE);
 		if (debugID.present())
 			g_traceBatch.addEvent("TransactionDebug", debugID.get().first(), "MasterProxyServer.masterProxyServerCore.Broadcast");
-		for (int i = 0; i<start.size(); i++) {
+
+		if (start[2].size()) {
+			for (auto& reply : start[2])
+				reply.send(commitData->cachedReadVersion);
+			commitData->stats.txnStartCached += transactionsStarted[2];
+			commitData->stats.txnStartOut += transactionsStarted[2];
+			commitData->stats.txnSystemPriorityStartOut += systemTransactionsStarted[2];
+			commitData->stats.txnDefaultPriorityStartOut += defaultPriTransactionsStarted[2];
+			commitData->stats.txnBatchPriorityStartOut += batchPriTransactionsStarted[2];
+		}
+
+		for (int i = 0; i<2; i++) {
 			if (start[i].size()) {
 				addActor.send(broadcast(getLiveCommittedVersion(commitData, i, &otherProxies, debugID, transactionsStarted[i], systemTransactionsStarted[i], defaultPriTransactionsStarted[i], batchPriTransactionsStarted[i]), start[i]));
 			}
@@ -1052,8 +1391,8 @@ ACTOR static Future<Void> readRequestServer(
 				if(!req.end.present()) {
 					auto r = req.reverse ? commitData->keyInfo.rangeContainingKeyBefore(req.begin) : commitData->keyInfo.rangeContaining(req.begin);
 					vector<StorageServerInterface> ssis;
-					ssis.reserve(r.value().src_info.size());
-					for(auto& it : r.value().src_info) {
+					ssis.reserve(r.value()->src_info.size());
+					for(auto& it : r.value()->src_info) {
 						ssis.push_back(it->interf);
 					}
 					rep.results.push_back(std::make_pair(r.range(), ssis));
@@ -1061,8 +1400,8 @@ ACTOR static Future<Void> readRequestServer(
 					int count = 0;
 					for(auto r = commitData->keyInfo.rangeContaining(req.begin); r != commitData->keyInfo.ranges().end() && count < req.limit && r.begin() < req.end.get(); ++r) {
 						vector<StorageServerInterface> ssis;
-						ssis.reserve(r.value().src_info.size());
-						for(auto& it : r.value().src_info) {
+						ssis.reserve(r.value()->src_info.size());
+						for(auto& it : r.value()->src_info) {
 							ssis.push_back(it->interf);
 						}
 						rep.results.push_back(std::make_pair(r.range(), ssis));
@@ -1073,8 +1412,8 @@ ACTOR static Future<Void> readRequestServer(
 					auto r = commitData->keyInfo.rangeContainingKeyBefore(req.end.get());
 					while( count < req.limit && req.begin < r.end() ) {
 						vector<StorageServerInterface> ssis;
-						ssis.reserve(r.value().src_info.size());
-						for(auto& it : r.value().src_info) {
+						ssis.reserve(r.value()->src_info.size());
+						for(auto& it : r.value()->src_info) {
 							ssis.push_back(it->interf);
 						}
 						rep.results.push_back(std::make_pair(r.range(), ssis));
@@ -1139,6 +1478,24 @@ ACTOR static Future<Void> readRequestServer(
 	}
 }
 
+// Fills range of store from the txnStateStore snapshot an earlier proxy in this process left behind, if the snapshot's
+// contents of the range match the master's checksum. The snapshot may be from any earlier epoch (or even a different
+// cluster); only the checksum makes it usable.
+bool applyCachedTxnState( IKeyValueStore* store, KeyRangeRef range, uint64_t checksum ) {
+	auto snapshot = (Standalone<VectorRef<KeyValueRef>>*)g_network->global(INetwork::enTxnStateSnapshot);
+	if(!snapshot)
+		return false;
+
+	auto begin = std::lower_bound(snapshot->begin(), snapshot->end(), range.begin, KeyValueRef::OrderByKey());
+	auto end = std::lower_bound(begin, snapshot->end(), range.end, KeyValueRef::OrderByKey());
+	if(txnStateChecksum(begin, end) != checksum)
+		return false;
+
+	for(auto kv = begin; kv != end; ++kv)
+		store->set(*kv, &snapshot->arena());
+	return true;
+}
+
 ACTOR Future<Void> masterProxyServerCore(
 	MasterProxyInterface proxy,
 	MasterInterface master,
@@ -1160,9 +1517,12 @@ ACTOR Future<Void> masterProxyServerCore(
 	state double lastCommit = 0;
 	state std::set<Sequence> txnSequences;
 	state Sequence maxSequence = std::numeric_limits<Sequence>::max();
+	state int txnStateChunksCached = 0;
+	state int txnStateChunksSent = 0;
 	state double commitBatchInterval = SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN;
 
 	addActor.send( fetchVersions(&commitData) );
+	addActor.send( commitStageLatencyLogger(&commitData) );
 	addActor.send( waitFailureServer(proxy.waitFailure.getFuture()) );
 
 	//TraceEvent("ProxyInit1", proxy.id());
@@ -1193,11 +1553,11 @@ ACTOR Future<Void> masterProxyServerCore(
 	// wait for txnStateStore recovery
 	Optional<Value> _ = wait(commitData.txnStateStore->readValue(StringRef()));
 
-	int commitBatchByteLimit = 
+	commitData.commitBatchDesiredBytes = 
 		(int)std::min<double>(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_BYTES_MAX, 
 			std::max<double>(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_BYTES_MIN, 
 				SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_BYTES_SCALE_BASE * pow(db->get().client.proxies.size(), SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_BYTES_SCALE_POWER)));
-	commitBatcher = batcher(batchedCommits, proxy.commit.getFuture(), SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_FROM_IDLE, &commitBatchInterval, SERVER_KNOBS->MAX_COMMIT_BATCH_INTERVAL, SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_COUNT_MAX, commitBatchByteLimit, CLIENT_KNOBS->TRANSACTION_SIZE_LIMIT, commitData.commitBatchStartNotifications, TaskProxyCommitBatcher, &commitData.stats.txnCommitIn);
+	commitBatcher = batcher(batchedCommits, proxy.commit.getFuture(), SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_FROM_IDLE, &commitBatchInterval, SERVER_KNOBS->MAX_COMMIT_BATCH_INTERVAL, &commitData.commitBatchDesiredCount, &commitData.commitBatchDesiredBytes, CLIENT_KNOBS->TRANSACTION_SIZE_LIMIT, commitData.commitBatchStartNotifications, TaskProxyCommitBatcher, &commitData.stats.txnCommitIn);
 	loop choose{
 		when(Void _ = wait(onError)) {}
 		when(vector<CommitTransactionRequest> trs = waitNext(batchedCommits.getFuture())) {
@@ -1221,19 +1581,32 @@ ACTOR Future<Void> masterProxyServerCore(
 			req.reply.send(rep);
 		}
 		when(TxnStateRequest req = waitNext(proxy.txnState.getFuture())) {
-			state ReplyPromise<Void> reply = req.reply;
+			state ReplyPromise<bool> reply = req.reply;
+			state bool applied = true;
 			if(req.last) maxSequence = req.sequence + 1;
 			if (!txnSequences.count(req.sequence)) {
-				txnSequences.insert(req.sequence);
-				
 				ASSERT(!commitData.validState.isSet()); // Although we may receive the CommitTransactionRequest for the recovery transaction before all of the TxnStateRequest, we will not get a resolution result from any resolver until the master has submitted its initial (sequence 0) resolution request, which it doesn't do until we have acknowledged all TxnStateRequests
 
-				for(auto& kv : req.data)
-					commitData.txnStateStore->set(kv, &req.arena);
+				if(req.cachedRange.present()) {
+					applied = applyCachedTxnState(commitData.txnStateStore, req.cachedRange.get(), req.cachedChecksum);
+					if(applied) txnStateChunksCached++;
+				} else {
+					for(auto& kv : req.data)
+						commitData.txnStateStore->set(kv, &req.arena);
+					txnStateChunksSent++;
+				}
+			}
+			if (applied && !txnSequences.count(req.sequence)) {
+				txnSequences.insert(req.sequence);
 				commitData.txnStateStore->commit(true);
 
 				if(txnSequences.size() == maxSequence) {
+					// We have our own copy now
+					setTxnStateSnapshot(NULL);
+					TraceEvent("ProxyTxnStateReceived", proxy.id()).detail("CachedChunks", txnStateChunksCached).detail("SentChunks", txnStateChunksSent);
+
 					state KeyRange txnKeys = allKeys;
+					state int keyInfoShards = 0;
 					loop {
 						Void _ = wait(yield());
 						Standalone<VectorRef<KeyValueRef>> data = commitData.txnStateStore->readRange(txnKeys, SERVER_KNOBS->BUGGIFIED_ROW_LIMIT, SERVER_KNOBS->APPLY_MUTATION_BYTES).get();
@@ -1241,48 +1614,14 @@ ACTOR Future<Void> masterProxyServerCore(
 						((KeyRangeRef&)txnKeys) = KeyRangeRef( keyAfter(data.back().key, txnKeys.arena()), txnKeys.end );
 
 						Standalone<VectorRef<MutationRef>> mutations;
-						std::vector<std::pair<MapPair<Key,ServerCacheInfo>,int>> keyInfoData;
+						std::vector<std::pair<MapPair<Key,Reference<ServerCacheInfo>>,int>> keyInfoData;
 						vector<UID> src, dest;
-						Reference<StorageInfo> storageInfo;
-						ServerCacheInfo info;
 						for(auto &kv : data) {
 							if( kv.key.startsWith(keyServersPrefix) ) {
 								KeyRef k = kv.key.removePrefix(keyServersPrefix);
 								if(k != allKeys.end) {
 									decodeKeyServersValue(kv.value, src, dest);
-									info.tags.clear();
-									info.src_info.clear();
-									info.dest_info.clear();
-									for(auto& id : src) {
-										auto cacheItr = commitData.storageCache.find(id);
-										if(cacheItr == commitData.storageCache.end()) {
-											storageInfo = Reference<StorageInfo>( new StorageInfo() );
-											storageInfo->tag = decodeServerTagValue( commitData.txnStateStore->readValue( serverTagKeyFor(id) ).get().get() );
-											storageInfo->interf = decodeServerListValue( commitData.txnStateStore->readValue( serverListKeyFor(id) ).get().get() );
-											commitData.storageCache[id] = storageInfo;
-										} else {
-											storageInfo = cacheItr->second;
-										}
-										ASSERT(storageInfo->tag != invalidTag);
-										info.tags.push_back( storageInfo->tag );
-										info.src_info.push_back( storageInfo );
-									}
-									for(auto& id : dest) {
-										auto cacheItr = commitData.storageCache.find(id);
-										if(cacheItr == commitData.storageCache.end()) {
-											storageInfo = Reference<StorageInfo>( new StorageInfo() );
-											storageInfo->tag = decodeServerTagValue( commitData.txnStateStore->readValue( serverTagKeyFor(id) ).get().get() );
-											storageInfo->interf = decodeServerListValue( commitData.txnStateStore->readValue( serverListKeyFor(id) ).get().get() );
-											commitData.storageCache[id] = storageInfo;
-										} else {
-											storageInfo = cacheItr->second;
-										}
-										ASSERT(storageInfo->tag != invalidTag);
-										info.tags.push_back( storageInfo->tag );
-										info.dest_info.push_back( storageInfo );
-									}
-									uniquify(info.tags);
-									keyInfoData.push_back( std::make_pair(MapPair<Key,ServerCacheInfo>(k, info), 1) );
+									keyInfoData.push_back( std::make_pair(MapPair<Key,Reference<ServerCacheInfo>>(k, getServerCacheInfo(src, dest, &commitData.teamCache, &commitData.storageCache, commitData.txnStateStore)), 1) );
 								}
 							} else {
 								mutations.push_back(mutations.arena(), MutationRef(MutationRef::SetValue, kv.key, kv.value));
@@ -1291,19 +1630,25 @@ ACTOR Future<Void> masterProxyServerCore(
 						
 						//insert keyTag data separately from metadata mutations so that we can do one bulk insert which avoids a lot of map lookups.
 						commitData.keyInfo.rawInsert(keyInfoData); 
+						commitData.teamCache.keyInfoChanges++;
+						commitData.teamCache.prune();
+						keyInfoShards += keyInfoData.size();
 
 						Arena arena;
 						bool confChanges;
-						applyMetadataMutations(commitData.dbgid, arena, mutations, commitData.txnStateStore, NULL, &confChanges, Reference<ILogSystem>(), 0, &commitData.vecBackupKeys, &commitData.keyInfo, commitData.firstProxy ? &commitData.uid_applyMutationsData : NULL, commitData.commit, commitData.cx, &commitData.committedVersion, &commitData.storageCache, true);
+						applyMetadataMutations(commitData.dbgid, arena, mutations, commitData.txnStateStore, NULL, &confChanges, Reference<ILogSystem>(), 0, &commitData.vecBackupKeys, &commitData.keyInfo, commitData.firstProxy ? &commitData.uid_applyMutationsData : NULL, commitData.commit, commitData.cx, &commitData.committedVersion, &commitData.storageCache, &commitData.teamCache, true, &commitData.clientCacheRanges);
 					}
 
+					// Each shard costs one pointer in keyInfo; the per-team vectors are only paid once per distinct team
+					TraceEvent("ProxyKeyInfo", proxy.id()).detail("Shards", keyInfoShards).detail("Teams", commitData.teamCache.teams.size()).detail("StorageServers", commitData.storageCache.size());
+
 					auto lockedKey = commitData.txnStateStore->readValue(databaseLockedKey).get();
 					commitData.locked = lockedKey.present() && lockedKey.get().size();
 
 					commitData.txnStateStore->enableSnapshot();
 				}
 			}
-			reply.send(Void());
+			reply.send(applied);
 			Void _ = wait(yield());
 		}
 	}
@@ -1340,3 +1685,24 @@ ACTOR Future<Void> masterProxyServer(
 		throw;
 	}
 }
+
+TEST_CASE("fdbserver/MasterProxyServer/coalesceConflictRanges") {
+	Arena arena;
+	VectorRef<KeyRangeRef> ranges;
+	ranges.push_back( arena, KeyRangeRef(LiteralStringRef("d"), LiteralStringRef("e")) );
+	ranges.push_back( arena, KeyRangeRef(LiteralStringRef("a"), LiteralStringRef("b")) );
+	ranges.push_back( arena, KeyRangeRef(LiteralStringRef("b"), LiteralStringRef("c")) );
+	ranges.push_back( arena, KeyRangeRef(LiteralStringRef("a"), LiteralStringRef("b")) );
+	ranges.push_back( arena, KeyRangeRef(LiteralStringRef("dd"), LiteralStringRef("f")) );
+	ranges.push_back( arena, KeyRangeRef(LiteralStringRef("x"), LiteralStringRef("y")) );
+
+	int64_t bytesRemoved = 0;
+	ASSERT( coalesceConflictRanges( arena, ranges, &bytesRemoved ) == 3 );
+	ASSERT( ranges.size() == 3 );
+	ASSERT( ranges[0] == KeyRangeRef(LiteralStringRef("a"), LiteralStringRef("c")) );
+	ASSERT( ranges[1] == KeyRangeRef(LiteralStringRef("d"), LiteralStringRef("f")) );
+	ASSERT( ranges[2] == KeyRangeRef(LiteralStringRef("x"), LiteralStringRef("y")) );
+	ASSERT( bytesRemoved == 7 );
+
+	return Void();
+}
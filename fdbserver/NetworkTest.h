@@ -32,6 +32,9 @@ struct NetworkTestInterface {
 	NetworkTestInterface( INetwork* local );
 };
 
+// The client sends a request with a payload of key.size() bytes and the server replies with a payload of replySize bytes.
+// Payload sizes, the requests kept outstanding and how long the client runs are set by the NETWORK_TEST_* knobs; TLS is used
+// for servers given as <ip>:<port>:tls, and packet compression is controlled as usual by PACKET_COMPRESSION_MIN_BYTES.
 struct NetworkTestRequest {
 	Key key;
 	uint32_t replySize;
@@ -832,6 +832,15 @@ namespace oldTLog {
 		return Void();
 	}
 
+	ACTOR Future<Void> tLogPopBatch( TLogData* self, TLogPopBatchRequest req, Reference<LogData> logData ) {
+		state int i = 0;
+		for(; i < req.pops.size(); i++) {
+			Void _ = wait( tLogPop( self, TLogPopRequest( req.pops[i].second, req.pops[i].first ), logData ) );
+		}
+		req.reply.send(Void());
+		return Void();
+	}
+
 	void peekMessagesFromMemory( Reference<LogData> self, TLogPeekRequest const& req, BinaryWriter& messages, Version& endVersion ) {
 		OldTag oldTag = convertTag(req.tag);
 		ASSERT( !messages.getLength() );
@@ -1146,6 +1155,9 @@ namespace oldTLog {
 			when( TLogPopRequest req = waitNext( tli.popMessages.getFuture() ) ) {
 				logData->addActor.send( tLogPop( self, req, logData ) );
 			}
+			when( TLogPopBatchRequest req = waitNext( tli.popBatch.getFuture() ) ) {
+				logData->addActor.send( tLogPopBatch( self, req, logData ) );
+			}
 			when( TLogCommitRequest req = waitNext( tli.commit.getFuture() ) ) {
 				ASSERT(logData->stopped);
 				req.reply.sendError( tlog_stopped() );
@@ -1278,6 +1290,7 @@ namespace oldTLog {
 
 			DUMPTOKEN( recruited.peekMessages );
 			DUMPTOKEN( recruited.popMessages );
+			DUMPTOKEN( recruited.popBatch );
 			DUMPTOKEN( recruited.commit );
 			DUMPTOKEN( recruited.lock );
 			DUMPTOKEN( recruited.getQueuingMetrics );
@@ -85,11 +85,13 @@ struct StorageQueueInfo {
 	Smoother smoothFreeSpace;
 	Smoother smoothTotalSpace;
 	double readReplyRate;
+	double queueGrowthRate;  // bytes per second, as of the last updateRate()
+	int64_t predictedQueue;  // queue bytes expected RATEKEEPER_PREDICTION_HORIZON seconds after the last updateRate()
 	limitReason_t limitReason;
 	StorageQueueInfo(UID id, LocalityData locality) : valid(false), id(id), locality(locality), smoothDurableBytes(SERVER_KNOBS->SMOOTHING_AMOUNT),
 		smoothInputBytes(SERVER_KNOBS->SMOOTHING_AMOUNT), verySmoothDurableBytes(SERVER_KNOBS->SLOW_SMOOTHING_AMOUNT),
 		smoothDurableVersion(1.), smoothLatestVersion(1.), smoothFreeSpace(SERVER_KNOBS->SMOOTHING_AMOUNT),
-		smoothTotalSpace(SERVER_KNOBS->SMOOTHING_AMOUNT), readReplyRate(0.0), limitReason(limitReason_t::unlimited)
+		smoothTotalSpace(SERVER_KNOBS->SMOOTHING_AMOUNT), readReplyRate(0.0), queueGrowthRate(0.0), predictedQueue(0), limitReason(limitReason_t::unlimited)
 	{
 		// FIXME: this is a tacky workaround for a potential unitialized use in trackStorageServerQueueInfo
 		lastReply.instanceID = -1;
@@ -112,11 +114,21 @@ struct TLogQueueInfo {
 	}
 };
 
+struct TagThrottleInfo {
+	Smoother smoothReleasedTransactions;
+	double TPSLimit;  // infinity when the tag is not throttled
+	TagThrottleInfo() : smoothReleasedTransactions(SERVER_KNOBS->SMOOTHING_AMOUNT), TPSLimit(std::numeric_limits<double>::infinity()) {}
+
+	bool throttled() const { return TPSLimit < std::numeric_limits<double>::infinity(); }
+};
+
 struct Ratekeeper {
 	Map<UID, StorageQueueInfo> storageQueueInfo;
 	Map<UID, TLogQueueInfo> tlogQueueInfo;
 	std::map<UID, std::pair<int64_t, double> > proxy_transactionCountAndTime;
+	std::map<Standalone<StringRef>, TagThrottleInfo> tagThrottles;
 	Smoother smoothReleasedTransactions, smoothTotalDurableBytes;
+	Smoother smoothLimitingVersionLag;
 	double TPSLimit;
 	Standalone<StringRef> dbName;
 	DatabaseConfiguration configuration;
@@ -127,7 +139,7 @@ struct Ratekeeper {
 	double lastWarning;
 	double* lastLimited;
 
-	Ratekeeper() : smoothReleasedTransactions(SERVER_KNOBS->SMOOTHING_AMOUNT), smoothTotalDurableBytes(SERVER_KNOBS->SLOW_SMOOTHING_AMOUNT), TPSLimit(std::numeric_limits<double>::infinity()),
+	Ratekeeper() : smoothReleasedTransactions(SERVER_KNOBS->SMOOTHING_AMOUNT), smoothTotalDurableBytes(SERVER_KNOBS->SLOW_SMOOTHING_AMOUNT), smoothLimitingVersionLag(SERVER_KNOBS->SMOOTHING_AMOUNT), TPSLimit(std::numeric_limits<double>::infinity()),
 		tpsLimitMetric(LiteralStringRef("Ratekeeper.TPSLimit")),
 		actualTpsMetric(LiteralStringRef("Ratekeeper.ActualTPS")),
 		reasonMetric(LiteralStringRef("Ratekeeper.Reason")),
@@ -250,6 +262,70 @@ ACTOR Future<Void> trackEachStorageServer(
 	}
 }
 
+// Storage servers do not know which tags wrote the mutations they are behind on, so a tag's share of the released
+// transaction rate stands in for its share of their queue growth. While storage queues are what limits the cluster and
+// more transactions are being released than the limit allows, the busiest tags are throttled down to a common rate that
+// removes the excess, leaving untagged and lightly used tags alone. Once that stops being the case throttles relax
+// geometrically, and are dropped when they no longer bind.
+int updateTagThrottles( Ratekeeper* self, limitReason_t limitReason ) {
+	double releasedTPS = self->smoothReleasedTransactions.smoothRate();
+	bool storageLimited = limitReason == limitReason_t::storage_server_write_queue_size || limitReason == limitReason_t::storage_server_write_bandwidth_mvcc;
+
+	std::vector<std::pair<double, Standalone<StringRef>>> candidates;
+	for(auto t = self->tagThrottles.begin(); t != self->tagThrottles.end(); ) {
+		double rate = t->second.smoothReleasedTransactions.smoothRate();
+		if(!t->second.throttled() && rate < SERVER_KNOBS->TAG_THROTTLE_MIN_TPS) {
+			t = self->tagThrottles.erase(t);
+			continue;
+		}
+		if(rate >= SERVER_KNOBS->TAG_THROTTLE_MIN_SHARE * releasedTPS)
+			candidates.push_back(std::make_pair(rate, t->first));
+		++t;
+	}
+
+	if(storageLimited && releasedTPS > self->TPSLimit && candidates.size()) {
+		std::sort(candidates.begin(), candidates.end(), std::greater<std::pair<double, Standalone<StringRef>>>());
+
+		// Find the level that, applied to the k busiest tags, releases `excess` fewer transactions per second
+		double excess = releasedTPS - self->TPSLimit;
+		double sum = 0;
+		double level = 0;
+		int k = 0;
+		while(k < candidates.size()) {
+			sum += candidates[k++].first;
+			level = (sum - excess) / k;
+			if(k == candidates.size() || level >= candidates[k].first)
+				break;
+		}
+		level = std::max(level, SERVER_KNOBS->TAG_THROTTLE_MIN_TPS);
+
+		for(int i = 0; i < k; i++) {
+			auto& info = self->tagThrottles[candidates[i].second];
+			if(level < info.TPSLimit) {
+				if(!info.throttled())
+					TraceEvent("RkTagThrottled").detail("Tag", printable(candidates[i].second)).detail("TPSLimit", level).detail("TagTPS", candidates[i].first).detail("ReleasedTPS", releasedTPS).detail("Reason", limitReason);
+				info.TPSLimit = level;
+			}
+		}
+	} else {
+		for(auto& t : self->tagThrottles) {
+			if(!t.second.throttled())
+				continue;
+			t.second.TPSLimit *= SERVER_KNOBS->TAG_THROTTLE_RELAX_RATE;
+			if(t.second.TPSLimit >= self->TPSLimit || t.second.TPSLimit > 2 * std::max(t.second.smoothReleasedTransactions.smoothRate(), SERVER_KNOBS->TAG_THROTTLE_MIN_TPS)) {
+				TraceEvent("RkTagUnthrottled").detail("Tag", printable(t.first)).detail("TagTPS", t.second.smoothReleasedTransactions.smoothRate());
+				t.second.TPSLimit = std::numeric_limits<double>::infinity();
+			}
+		}
+	}
+
+	int throttledTags = 0;
+	for(auto& t : self->tagThrottles)
+		if(t.second.throttled())
+			throttledTags++;
+	return throttledTags;
+}
+
 void updateRate( Ratekeeper* self ) {
 	//double controlFactor = ;  // dt / eFoldingTime
 
@@ -261,6 +337,8 @@ void updateRate( Ratekeeper* self ) {
 	self->TPSLimit = std::numeric_limits<double>::infinity();
 	UID reasonID = UID();
 	limitReason_t limitReason = limitReason_t::unlimited;
+	std::string limitExplanation;
+	double horizon = SERVER_KNOBS->RATEKEEPER_PREDICTION_HORIZON;
 
 	int sscount = 0;
 	double readReplyRateSum=0.0;
@@ -268,6 +346,7 @@ void updateRate( Ratekeeper* self ) {
 	int64_t worstFreeSpaceStorageServer = std::numeric_limits<int64_t>::max();
 	int64_t worstStorageQueueStorageServer = 0;
 	int64_t limitingStorageQueueStorageServer = 0;
+	int64_t limitingPredictedStorageQueueStorageServer = 0;
 
 	std::multimap<double, StorageQueueInfo*> storageTPSLimitReverseIndex;
 
@@ -297,7 +376,12 @@ void updateRate( Ratekeeper* self ) {
 
 		int64_t storageQueue = ss.lastReply.bytesInput - ss.smoothDurableBytes.smoothTotal();
 		worstStorageQueueStorageServer = std::max(worstStorageQueueStorageServer, storageQueue);
-		int64_t b = storageQueue - targetBytes;
+
+		// Control on where the queue is headed rather than where it is, so that the limit tightens before the target is
+		// crossed and loosens before the queue has drained instead of overshooting in both directions
+		ss.queueGrowthRate = ss.smoothInputBytes.smoothRate() - ss.smoothDurableBytes.smoothRate();
+		ss.predictedQueue = std::max<int64_t>(0, storageQueue + ss.queueGrowthRate * horizon);
+		int64_t b = ss.predictedQueue - targetBytes;
 		double targetRateRatio = std::min(( b + springBytes ) / (double)springBytes, 2.0);
 
 		double inputRate = ss.smoothInputBytes.smoothRate();
@@ -344,6 +428,8 @@ void updateRate( Ratekeeper* self ) {
 			reasonID = ss.id;
 			self->TPSLimit = limitTPS;
 			limitReason = ss.limitReason;
+			limitExplanation = format("Storage server has %lld bytes of free space left before its minimum of %lld bytes; its queue target is reduced to %lld bytes.",
+				(int64_t)ss.smoothFreeSpace.smoothTotal() - minFreeSpace, minFreeSpace, targetBytes);
 		}
 	}
 
@@ -358,9 +444,12 @@ void updateRate( Ratekeeper* self ) {
 		}
 
 		limitingStorageQueueStorageServer = ss->second->lastReply.bytesInput - ss->second->smoothDurableBytes.smoothTotal();
+		limitingPredictedStorageQueueStorageServer = ss->second->predictedQueue;
 		self->TPSLimit = ss->first;
 		limitReason = storageTPSLimitReverseIndex.begin()->second->limitReason;
 		reasonID = storageTPSLimitReverseIndex.begin()->second->id; // Although we aren't controlling based on the worst SS, we still report it as the limiting process
+		limitExplanation = format("Storage server queue is %lld bytes and changing by %.0f bytes/s, so it is predicted to be %lld bytes in %.1f seconds against a target of at most %lld bytes.",
+			limitingStorageQueueStorageServer, ss->second->queueGrowthRate, limitingPredictedStorageQueueStorageServer, horizon, SERVER_KNOBS->TARGET_BYTES_PER_STORAGE_SERVER);
 
 		break;
 	}
@@ -391,10 +480,20 @@ void updateRate( Ratekeeper* self ) {
 			maxTLVer = std::max(maxTLVer, tl.lastReply.v);
 		}
 
-		// writeToReadLatencyLimit: 0 = infinte speed; 1 = TL durable speed ; 2 = half TL durable speed
-		writeToReadLatencyLimit = ((maxTLVer - minLimitingSSVer) - SERVER_KNOBS->MAX_TL_SS_VERSION_DIFFERENCE/2) / (SERVER_KNOBS->MAX_TL_SS_VERSION_DIFFERENCE/4);
 		worstVersionLag = std::max((Version)0, maxTLVer - minSSVer);
 		limitingVersionLag = std::max((Version)0, maxTLVer - minLimitingSSVer);
+
+		// As with queues, act on the lag expected after the prediction horizon
+		double predictedVersionLag = limitingVersionLag;
+		if(maxTLVer != std::numeric_limits<Version>::min() && minLimitingSSVer != std::numeric_limits<Version>::max()) {
+			if(self->smoothLimitingVersionLag.time == 0)
+				self->smoothLimitingVersionLag.reset(limitingVersionLag);
+			self->smoothLimitingVersionLag.setTotal(limitingVersionLag);
+			predictedVersionLag = std::max(0.0, limitingVersionLag + self->smoothLimitingVersionLag.smoothRate() * horizon);
+		}
+
+		// writeToReadLatencyLimit: 0 = infinte speed; 1 = TL durable speed ; 2 = half TL durable speed
+		writeToReadLatencyLimit = (predictedVersionLag - SERVER_KNOBS->MAX_TL_SS_VERSION_DIFFERENCE/2) / (SERVER_KNOBS->MAX_TL_SS_VERSION_DIFFERENCE/4);
 	}
 
 	int64_t worstFreeSpaceTLog = std::numeric_limits<int64_t>::max();
@@ -422,7 +521,9 @@ void updateRate( Ratekeeper* self ) {
 		}
 
 		int64_t queue = tl.lastReply.bytesInput - tl.smoothDurableBytes.smoothTotal();
-		int64_t b = queue - targetBytes;
+		double queueGrowthRate = tl.smoothInputBytes.smoothRate() - tl.smoothDurableBytes.smoothRate();
+		int64_t predictedQueue = std::max<int64_t>(0, queue + queueGrowthRate * horizon);
+		int64_t b = predictedQueue - targetBytes;
 		worstStorageQueueTLog = std::max(worstStorageQueueTLog, queue);
 
 		if( tl.lastReply.bytesInput - tl.lastReply.bytesDurable > tl.lastReply.storageBytes.free - minFreeSpace / 2 ) {
@@ -433,6 +534,7 @@ void updateRate( Ratekeeper* self ) {
 			reasonID = tl.id;
 			limitReason = limitReason_t::log_server_min_free_space;
 			self->TPSLimit = 0.0;
+			limitExplanation = format("Log server queue of %lld bytes would leave less than %lld bytes of free space.", tl.lastReply.bytesInput - tl.lastReply.bytesDurable, minFreeSpace / 2);
 		}
 
 		double targetRateRatio = std::min( ( b + springBytes ) / (double)springBytes, 2.0 );
@@ -454,6 +556,10 @@ void updateRate( Ratekeeper* self ) {
 				self->TPSLimit = lim;
 				reasonID = tl.id;
 				limitReason = tlogLimitReason;
+				if (tlogLimitReason == limitReason_t::storage_server_readable_behind)
+					limitExplanation = format("Storage servers are %lld versions behind the logs and are predicted to be %.0f versions behind in %.1f seconds.", limitingVersionLag, limitingVersionLag + self->smoothLimitingVersionLag.smoothRate() * horizon, horizon);
+				else
+					limitExplanation = format("Log server queue is %lld bytes and changing by %.0f bytes/s, so it is predicted to be %lld bytes in %.1f seconds against a target of %lld bytes.", queue, queueGrowthRate, predictedQueue, horizon, targetBytes);
 			}
 		}
 		if (inputRate > 0) {
@@ -464,6 +570,7 @@ void updateRate( Ratekeeper* self ) {
 				self->TPSLimit = lim;
 				reasonID = tl.id;
 				limitReason = limitReason_t::log_server_mvcc_write_bandwidth;
+				limitExplanation = format("Log server input of %.0f bytes/s would use up its queue target within the MVCC window.", inputRate);
 			}
 		}
 	}
@@ -485,6 +592,8 @@ void updateRate( Ratekeeper* self ) {
 	self->tpsLimitMetric = std::min(self->TPSLimit, 1e6);
 	self->reasonMetric = limitReason;
 
+	int throttledTags = updateTagThrottles(self, limitReason);
+
 	if( self->smoothReleasedTransactions.smoothRate() > SERVER_KNOBS->LAST_LIMITED_RATIO * self->TPSLimit ) {
 		(*self->lastLimited) = now();
 	}
@@ -498,12 +607,16 @@ void updateRate( Ratekeeper* self ) {
 			.detail("TPSBasis", actualTPS)
 			.detail("StorageServers", sscount)
 			.detail("Proxies", self->proxy_transactionCountAndTime.size())
+			.detail("TrackedTags", self->tagThrottles.size())
+			.detail("ThrottledTags", throttledTags)
 			.detail("TLogs", tlcount)
 			.detail("ReadReplyRate", readReplyRateSum)
 			.detail("WorstFreeSpaceStorageServer", worstFreeSpaceStorageServer)
 			.detail("WorstFreeSpaceTLog", worstFreeSpaceTLog)
 			.detail("WorstStorageServerQueue", worstStorageQueueStorageServer)
 			.detail("LimitingStorageServerQueue", limitingStorageQueueStorageServer)
+			.detail("PredictedLimitingStorageServerQueue", limitingPredictedStorageQueueStorageServer)
+			.detail("LimitExplanation", limitExplanation)
 			.detail("WorstTLogQueue", worstStorageQueueTLog)
 			.detail("TotalDiskUsageBytes", totalDiskUsageBytes)
 			.detail("WorstStorageServerVersionLag", worstVersionLag)
@@ -566,7 +679,21 @@ ACTOR Future<Void> rateKeeper(
 				p.first = req.totalReleasedTransactions;
 				p.second = now();
 
+				for(auto& t : req.tagReleasedTransactions) {
+					auto tag = self.tagThrottles.find(t.first);
+					if(tag == self.tagThrottles.end()) {
+						if(self.tagThrottles.size() >= SERVER_KNOBS->TAG_THROTTLE_MAX_TRACKED_TAGS)
+							continue;
+						tag = self.tagThrottles.insert(std::make_pair(t.first, TagThrottleInfo())).first;
+					}
+					tag->second.smoothReleasedTransactions.addDelta( t.second );
+				}
+
 				reply.transactionRate = self.TPSLimit / self.proxy_transactionCountAndTime.size();
+				for(auto& t : self.tagThrottles) {
+					if(t.second.throttled())
+						reply.tagTransactionRates.push_back(std::make_pair(t.first, t.second.TPSLimit / self.proxy_transactionCountAndTime.size()));
+				}
 				reply.leaseDuration = SERVER_KNOBS->METRIC_UPDATE_RATE;
 				req.reply.send( reply );
 			}
@@ -30,7 +30,11 @@
 #include "Orderer.actor.h"
 #include "ConflictSet.h"
 #include "StorageMetrics.h"
+#include "HotKeySketch.h"
 #include "fdbclient/SystemData.h"
+#include "flow/Stats.h"
+#include "flow/IThreadPool.h"
+#include "CoroFlow.h"
 
 namespace {
 struct ProxyRequestsInfo {
@@ -42,10 +46,30 @@ struct ProxyRequestsInfo {
 }
 
 namespace{
+struct ResolverStats {
+	CounterCollection cc;
+	Counter resolveBatchIn, compactionSteps, compactionPasses, compactedEntries;
+
+	Future<Void> logger;
+
+	ResolverStats(UID id, ConflictSet* conflictSet)
+	  : cc("ResolverStats", id.toString()),
+		resolveBatchIn("resolveBatchIn", cc), compactionSteps("compactionSteps", cc), compactionPasses("compactionPasses", cc), compactedEntries("compactedEntries", cc)
+	{
+		specialCounter(cc, "compactionBacklogVersions", [conflictSet](){ return getConflictSetCompactionBacklog(conflictSet); });
+		logger = traceCounters("ResolverMetrics", id, SERVER_KNOBS->WORKER_LOGGING_INTERVAL, &cc, "ResolverMetrics");
+	}
+};
+
 struct Resolver : ReferenceCounted<Resolver> {
 	Resolver( UID dbgid, int proxyCount, int resolverCount )
-		: dbgid(dbgid), proxyCount(proxyCount), resolverCount(resolverCount), version(-1), conflictSet( newConflictSet() ), iopsSample( SERVER_KNOBS->IOPS_UNITS_PER_SAMPLE ), debugMinRecentStateVersion(0)
+		: dbgid(dbgid), proxyCount(proxyCount), resolverCount(resolverCount), version(-1), conflictSet( newConflictSet() ), iopsSample( SERVER_KNOBS->IOPS_UNITS_PER_SAMPLE ), debugMinRecentStateVersion(0), stats(dbgid, conflictSet)
 	{
+		if( SERVER_KNOBS->RESOLVER_CONFLICT_DETECTION_THREAD ) {
+			// Coroutines keep simulation deterministic
+			conflictThread = g_network->isSimulated() ? CoroThreadPool::createThreadPool() : createGenericThreadPool();
+			conflictThread->addThread( new NullThreadPoolReceiver );
+		}
 	}
 	~Resolver() {
 		destroyConflictSet( conflictSet );
@@ -62,12 +86,51 @@ struct Resolver : ReferenceCounted<Resolver> {
 	AsyncTrigger checkNeededVersion;
 	std::map<NetworkAddress, ProxyRequestsInfo> proxyInfoMap;
 	ConflictSet *conflictSet;
+	Reference<IThreadPool> conflictThread;  // If RESOLVER_CONFLICT_DETECTION_THREAD, conflict detection runs here instead of on the network thread
+	AsyncVar<bool> detectingConflicts;  // True while conflictThread is using conflictSet
 	TransientStorageMetricSample iopsSample;
+	HotKeySketch conflictSketch;  // Of the begin keys of the read conflict ranges that made transactions conflict, for status
 
 	Version debugMinRecentStateVersion;
+
+	ResolverStats stats;
 };
 }
 
+struct ConflictDetectionResult {
+	vector<int> commitList;
+	vector<int> tooOldList;
+	vector<int> conflictingRanges;
+};
+
+// Doesn't use anything belonging to the network thread, so that it can run on Resolver::conflictThread
+static void detectConflicts( ConflictSet* conflictSet, ResolveTransactionBatchRequest const& req, ConflictDetectionResult* result ) {
+	ConflictBatch conflictBatch( conflictSet );
+	for(int t=0; t<req.transactions.size(); t++)
+		conflictBatch.addTransaction( req.transactions[t] );
+	conflictBatch.detectConflicts( req.version, req.version - SERVER_KNOBS->MAX_WRITE_TRANSACTION_LIFE_VERSIONS, result->commitList, &result->tooOldList, &result->conflictingRanges);
+}
+
+// The thread uses the conflict set, the request and the result until it finishes, so this holds onto all of them and can't be cancelled
+ACTOR static UNCANCELLABLE Future<ConflictDetectionResult> detectConflictsOnThread( Reference<Resolver> self, ResolveTransactionBatchRequest req ) {
+	state ConflictDetectionResult result;
+	ConflictSet* conflictSet = self->conflictSet;
+	ResolveTransactionBatchRequest const* pReq = &req;
+	ConflictDetectionResult* pResult = &result;
+	self->detectingConflicts.set(true);
+	try {
+		Void _ = wait( runOnThreadPool<Void>( self->conflictThread, [conflictSet, pReq, pResult]() {
+			detectConflicts( conflictSet, *pReq, pResult );
+			return Void();
+		} ) );
+	} catch( Error& e ) {
+		self->detectingConflicts.set(false);
+		throw;
+	}
+	self->detectingConflicts.set(false);
+	return result;
+}
+
 ACTOR Future<Void> resolveBatch(
 	Reference<Resolver> self, 
 	ResolveTransactionBatchRequest req)
@@ -78,6 +141,8 @@ ACTOR Future<Void> resolveBatch(
 	state NetworkAddress proxyAddress = req.prevVersion >= 0 ? req.reply.getEndpoint().address : NetworkAddress();
 	state ProxyRequestsInfo &proxyInfo = self->proxyInfoMap[proxyAddress];
 
+	++self->stats.resolveBatchIn;
+
 	if(req.debugID.present()) {
 		debugID = g_nondeterministic_random->randomUniqueID();
 		g_traceBatch.addAttach("CommitAttachID", req.debugID.get().first(), debugID.get().first());
@@ -119,28 +184,25 @@ ACTOR Future<Void> resolveBatch(
 		g_network->setCurrentTask(TaskDefaultEndpoint);
 	}
 
-	if (self->version.get() == req.prevVersion) {  // Not a duplicate (check relies on no waiting between here and self->version.set() below!)
+	if (self->version.get() == req.prevVersion && proxyInfo.lastVersion < req.version) {  // Not a duplicate (check relies on no waiting between here and updating proxyInfo.lastVersion below!)
 		if(proxyInfo.lastVersion > 0) {
 			proxyInfo.outstandingBatches.erase(proxyInfo.outstandingBatches.begin(), proxyInfo.outstandingBatches.upper_bound(req.lastReceivedVersion));
 		}
 
-		Version firstUnseenVersion = proxyInfo.lastVersion + 1;
+		state Version firstUnseenVersion = proxyInfo.lastVersion + 1;
 		proxyInfo.lastVersion = req.version;
 
 		if(req.debugID.present())
 			g_traceBatch.addEvent("CommitDebug", debugID.get().first(), "Resolver.resolveBatch.AfterOrderer");
 		
-		vector<int> commitList;
-		vector<int> tooOldList;
+		state ConflictDetectionResult conflicts;
 		double commitTime = now();
 
 		// Detect conflicts
 		double expire = now() + SERVER_KNOBS->SAMPLE_EXPIRATION_TIME;
-		double tstart = timer();
-		ConflictBatch conflictBatch( self->conflictSet );
-		int keys = 0;
+		state double tstart = timer();
+		state int keys = 0;
 		for(int t=0; t<req.transactions.size(); t++) {
-			conflictBatch.addTransaction( req.transactions[t] );
 			keys += req.transactions[t].write_conflict_ranges.size()*2 + req.transactions[t].read_conflict_ranges.size()*2;
 			
 			if(self->resolverCount > 1) {
@@ -150,7 +212,13 @@ ACTOR Future<Void> resolveBatch(
 					self->iopsSample.addAndExpire( it.begin, SERVER_KNOBS->SAMPLE_OFFSET_PER_KEY + it.begin.size(), expire );
 			}
 		}
-		conflictBatch.detectConflicts( req.version, req.version - SERVER_KNOBS->MAX_WRITE_TRANSACTION_LIFE_VERSIONS, commitList, &tooOldList);
+		if(self->conflictThread) {
+			// No other batch can be resolved until self->version is set below, but the network thread is free to receive them
+			ConflictDetectionResult result = wait( detectConflictsOnThread( self, req ) );
+			conflicts = result;
+		} else {
+			detectConflicts( self->conflictSet, req, &conflicts );
+		}
 		g_counters.conflictTime += timer() - tstart;
 		++g_counters.conflictBatches;
 		g_counters.conflictTransactions += req.transactions.size();
@@ -159,11 +227,18 @@ ACTOR Future<Void> resolveBatch(
 		ResolveTransactionBatchReply &reply = proxyInfo.outstandingBatches[req.version];
 		reply.debugID = req.debugID;
 		reply.committed.resize( reply.arena, req.transactions.size() );
-		for(int c=0; c<commitList.size(); c++)
-			reply.committed[commitList[c]] = ConflictBatch::TransactionCommitted;
+		for(int c=0; c<conflicts.commitList.size(); c++)
+			reply.committed[conflicts.commitList[c]] = ConflictBatch::TransactionCommitted;
 
-		for (int c = 0; c<tooOldList.size(); c++)
-			reply.committed[tooOldList[c]] = ConflictBatch::TransactionTooOld;
+		for (int c = 0; c<conflicts.tooOldList.size(); c++)
+			reply.committed[conflicts.tooOldList[c]] = ConflictBatch::TransactionTooOld;
+
+		reply.conflictingRanges.resize( reply.arena, req.transactions.size() );
+		for(int t = 0; t < req.transactions.size(); t++) {
+			reply.conflictingRanges[t] = conflicts.conflictingRanges[t];
+			if( conflicts.conflictingRanges[t] >= 0 )
+				self->conflictSketch.add( req.transactions[t].read_conflict_ranges[ conflicts.conflictingRanges[t] ].begin );
+		}
 
 		ASSERT(req.prevVersion >= 0 || req.txnStateTransactions.size() == 0); // The master's request should not have any state transactions
 
@@ -236,6 +311,9 @@ ACTOR Future<Void> resolveBatch(
 	else {
 		TEST(true); // Duplicate resolve batch request
 		//TraceEvent("DupResolveBatchReq", self->dbgid).detail("From", proxyAddress);
+
+		// The original request may still be detecting conflicts on the conflict thread
+		Void _ = wait( self->version.whenAtLeast( req.version ) );
 	}
 
 	auto proxyInfoItr = self->proxyInfoMap.find(proxyAddress);
@@ -259,6 +337,41 @@ ACTOR Future<Void> resolveBatch(
 	return Void();
 }
 
+// Removes expired entries from the conflict set in small steps at low priority, so that batches never wait
+//   behind a large removal.  resolveBatch() only reclaims about as much as each batch adds.
+ACTOR Future<Void> conflictSetCompactor( Reference<Resolver> self ) {
+	loop {
+		Void _ = wait( delay( SERVER_KNOBS->RESOLVER_COMPACTION_INTERVAL, TaskLowPriority ) );
+		if( getConflictSetCompactionBacklog( self->conflictSet ) <= 0 )
+			continue;
+
+		// Finish one pass over the key space, so that the backlog reported in ResolverMetrics drops
+		loop {
+			while( self->detectingConflicts.get() )
+				Void _ = wait( self->detectingConflicts.onChange() );
+
+			bool passFinished;
+			self->stats.compactedEntries += compactConflictSet( self->conflictSet, SERVER_KNOBS->RESOLVER_COMPACTION_NODES_PER_STEP, &passFinished );
+			++self->stats.compactionSteps;
+			if( passFinished ) {
+				++self->stats.compactionPasses;
+				break;
+			}
+			Void _ = wait( yield( TaskLowPriority ) );
+		}
+	}
+}
+
+ACTOR Future<Void> traceHotKeys( Reference<Resolver> self ) {
+	loop {
+		Void _ = wait( delay( SERVER_KNOBS->HOT_KEY_LOGGING_INTERVAL ) );
+		TraceEvent ev("HotKeys", self->dbgid);
+		self->conflictSketch.addDetails( ev, "Conflict", SERVER_KNOBS->HOT_KEY_LOGGING_INTERVAL, SERVER_KNOBS->HOT_KEY_DECAY );
+		ev.trackLatest( (self->dbgid.toString() + "/HotKeys").c_str() );
+		self->conflictSketch.decay( SERVER_KNOBS->HOT_KEY_DECAY );
+	}
+}
+
 ACTOR Future<Void> resolverCore(
 	ResolverInterface resolver,
 	InitializeResolverRequest initReq)
@@ -267,6 +380,8 @@ ACTOR Future<Void> resolverCore(
 	state ActorCollection actors(false);
 	state Future<Void> doPollMetrics = self->resolverCount > 1 ? Void() : Future<Void>(Never());
 	actors.add( waitFailureServer(resolver.waitFailure.getFuture()) );
+	actors.add( conflictSetCompactor(self) );
+	actors.add( traceHotKeys(self) );
 
 	TraceEvent("ResolverInit", resolver.id()).detail("RecoveryCount", initReq.recoveryCount);
 	loop choose {
@@ -72,10 +72,11 @@ struct ResolveTransactionBatchReply {
 	VectorRef<uint8_t> committed;
 	Optional<UID> debugID;
 	VectorRef<VectorRef<StateTransactionRef>> stateMutations;  // [version][transaction#] -> (committed, [mutation#])
+	VectorRef<int> conflictingRanges;  // [transaction#] -> index in read_conflict_ranges of a range that conflicted, or -1
 
 	template <class Archive>
 	void serialize(Archive& ar) {
-		ar & committed & stateMutations & arena & debugID;
+		ar & committed & stateMutations & arena & debugID & conflictingRanges;
 	}
 
 };
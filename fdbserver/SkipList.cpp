@@ -25,11 +25,7 @@
 #include <numeric>
 #include <string>
 
-/*
-#ifdef __GNUG__
-#include <smmintrin.h>
-#endif
-*/
+#include <emmintrin.h>
 
 #include "flow/Platform.h"
 #include "fdbrpc/fdbrpc.h"
@@ -37,10 +33,9 @@
 #include "fdbclient/FDBTypes.h"
 #include "fdbclient/KeyRangeMap.h"
 #include "fdbclient/SystemData.h"
+#include "flow/UnitTest.h"
 #include "Knobs.h"
 
-#define PARALLEL_THREAD_COUNT 0	// FIXME: When >1, program execution (e.g. random numbers) is/was nondeterministic.  Why?
-
 using std::min;
 using std::max;
 using std::make_pair;
@@ -98,7 +93,6 @@ PerfDoubleCounter
 	g_checkRead("D.CheckRead", skc),
 	g_checkBatch("D.CheckIntraBatch", skc),
 	g_merge("D.MergeWrite", skc),
-	g_merge_launch("D.Merge.Launch", skc),
 	g_merge_fork("D.Merge.Fork", skc),
 	g_merge_start_var("D.Merge.StartVariance", skc),
 	g_merge_end_var("D.Merge.EndVariance", skc),
@@ -110,10 +104,39 @@ PerfDoubleCounter
 	g_removeBefore("D.RemoveBefore", skc)
 	;
 
+static force_inline int countTrailingZeros( uint32_t x ) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward( &index, x );
+	return index;
+#else
+	return __builtin_ctz( x );
+#endif
+}
+
+// Returns the position of the first byte at which a and b differ, or len if their first len bytes are equal.
+//   Compares 16 bytes per step with SSE2, which every x86-64 processor supports, so there is no need for
+//   a runtime dispatch.  Conflict ranges are mostly tuple encoded keys of 16-64 bytes, which this covers in
+//   one to four steps.
+static force_inline int firstDifference( const uint8_t* a, const uint8_t* b, int len ) {
+	int i = 0;
+	for(; i+16 <= len; i += 16) {
+		__m128i x = _mm_loadu_si128( (const __m128i*)(a+i) );
+		__m128i y = _mm_loadu_si128( (const __m128i*)(b+i) );
+		uint32_t diff = _mm_movemask_epi8( _mm_cmpeq_epi8(x, y) ) ^ 0xffff;
+		if (diff)
+			return i + countTrailingZeros( diff );
+	}
+	for(; i<len; i++)
+		if (a[i] != b[i])
+			return i;
+	return len;
+}
+
 static force_inline int compare( const StringRef& a, const StringRef& b ) {
-	int c = memcmp( a.begin(), b.begin(), min(a.size(), b.size()) );
-	if (c<0) return -1;
-	if (c>0) return +1;
+	int len = min(a.size(), b.size());
+	int i = firstDifference( a.begin(), b.begin(), len );
+	if (i < len) return a[i] < b[i] ? -1 : +1;
 	if (a.size() < b.size()) return -1;
 	if (a.size() == b.size()) return 0;
 	return +1;
@@ -123,8 +146,9 @@ struct ReadConflictRange {
 	StringRef begin, end;
 	Version version;
 	int transaction;
-	ReadConflictRange( StringRef begin, StringRef end, Version version, int transaction )
-		: begin(begin), end(end), version(version), transaction(transaction)
+	int indexInTransaction;  // Of this range in the transaction's read_conflict_ranges
+	ReadConflictRange( StringRef begin, StringRef end, Version version, int transaction, int indexInTransaction )
+		: begin(begin), end(end), version(version), transaction(transaction), indexInTransaction(indexInTransaction)
 	{
 	}
 	bool operator<(const ReadConflictRange& rhs) const { return compare(begin, rhs.begin)<0; }
@@ -177,9 +201,9 @@ force_inline bool getCharacter(const KeyInfo& ki, int character, int &outputChar
 }
 
 bool operator < ( const KeyInfo& lhs, const KeyInfo& rhs ) {
-	int i = min(lhs.key.size(), rhs.key.size());
-	int c = memcmp( lhs.key.begin(), rhs.key.begin(), i );
-	if (c!=0) return c<0;
+	int len = min(lhs.key.size(), rhs.key.size());
+	int i = firstDifference( lhs.key.begin(), rhs.key.begin(), len );
+	if (i < len) return lhs.key[i] < rhs.key[i];
 
 	// SOMEDAY: This is probably not very fast.  Slows D.Sort by ~20% relative to previous (incorrect) version.
 
@@ -241,6 +265,18 @@ void sortPoints(vector<KeyInfo>& points){
 			continue;
 		}
 
+		// Keys in a task often share a long prefix (e.g. tuple encoded keys in one subspace), and each shared
+		//   character would otherwise cost a full counting pass that produces a single bucket.  Skip them.
+		const KeyInfo& first = points[st.begin];
+		int common = first.key.size();
+		for (int i=st.begin+1; i<st.begin+st.size && common > st.character; i++){
+			const KeyInfo& p = points[i];
+			int len = min(common, p.key.size());
+			common = st.character + firstDifference( first.key.begin() + st.character, p.key.begin() + st.character, max(len-st.character, 0) );
+		}
+		if (common > st.character)
+			st.character = common;
+
 		newPoints.resize(st.size);
 		counts.assign(256+5, 0);
 
@@ -378,15 +414,9 @@ private:
 
 	static force_inline bool less( const uint8_t* a, int aLen, const uint8_t* b, int bLen ) {
 		int len = min(aLen, bLen);
-		for(int i=0; i<len; i++)
-			if (a[i] < b[i])
-				return true;
-			else if (a[i] > b[i])
-				return false;
-
-		/*int c = memcmp(a,b,min(aLen,bLen));
-		if (c<0) return true;
-		if (c>0) return false;*/
+		int i = firstDifference( a, b, len );
+		if (i < len)
+			return a[i] < b[i];
 		return aLen < bLen;
 	}
 
@@ -521,7 +551,7 @@ public:
 		}
 	}
 
-	void detectConflicts( ReadConflictRange* ranges, int count, bool* transactionConflictStatus ) {
+	void detectConflicts( ReadConflictRange* ranges, int count, bool* transactionConflictStatus, int* conflictingRange ) {
 		const int M = 16;
 		int nextJob[M];
 		CheckMax inProgress[ M ];
@@ -529,7 +559,7 @@ public:
 
 		int started = min(M,count);
 		for(int i=0; i<started; i++){
-			inProgress[i].init( ranges[i], header, transactionConflictStatus );
+			inProgress[i].init( ranges[i], header, transactionConflictStatus, conflictingRange );
 			nextJob[i] = i+1;
 		}
 		nextJob[started-1] = 0;
@@ -545,7 +575,7 @@ public:
 					job = prevJob;
 				}
 				else
-					inProgress[job].init( ranges[started++], header, transactionConflictStatus );
+					inProgress[job].init( ranges[started++], header, transactionConflictStatus, conflictingRange );
 			}
 			prevJob = job;
 			job = nextJob[job];
@@ -756,18 +786,22 @@ private:
 		Finger start, end;
 		Version version;
 		bool *result;
+		int *resultRange;
+		int rangeIndex;
 		int state;
 
-		void init( const ReadConflictRange& r, Node* header, bool* tCS ) {
+		void init( const ReadConflictRange& r, Node* header, bool* tCS, int* conflictingRange ) {
 			this->start.init( r.begin, header );
 			this->end.init( r.end, header );
 			this->version = r.version;
 			result = &tCS[ r.transaction ];
+			resultRange = &conflictingRange[ r.transaction ];
+			rangeIndex = r.indexInTransaction;
 			this->state = 0;
 		}
 
 		bool noConflict() { return true; }
-		bool conflict() { *result = true; return true; }
+		bool conflict() { *result = true; *resultRange = rangeIndex; return true; }
 
 		// Return true if finished
 		force_inline bool advance() {
@@ -880,30 +914,39 @@ PAction action( F && f ) {
 	return new FAction( std::move(f) );
 };
 
+struct WorkerThreadArgs {
+	PAction* nextAction;
+	Event* nextActionReady;
+	int index;
+	Event* whenFinished;
+};
+
+// Each worker owns a deterministic skiplist level seed, so a given partition of the conflict set
+//   always produces the same node levels no matter how the threads are scheduled
+THREAD_FUNC conflictSetWorkerThread( void* arg ) {
+	WorkerThreadArgs args = *(WorkerThreadArgs*)arg;
+	delete (WorkerThreadArgs*)arg;
+
+	g_seed = args.index*123; skfastrand();
+	while (true) {
+		args.nextActionReady->block();   // auto-reset
+		Action* action = *args.nextAction;
+		*args.nextAction = 0;
+		if (!action) break;
+
+		(*action)();
+	}
+	args.whenFinished->set();
+	THREAD_RETURN;
+}
+
 void workerThread( PAction* nextAction, Event* nextActionReady, int index, Event* whenFinished ) {
-	ASSERT(false);
-	/*
-	inThread<Void>( [nextAction,nextActionReady,index,whenFinished]()->Void {
-		g_seed = index*123; fastrand();
-		setAffinity( index );
-		while (true) {
-			try {
-				nextActionReady->block();   // auto-reset
-				Action* action = *nextAction;
-				*nextAction = 0;
-				if (!action) break;
-
-				(*action)();
-			} catch (Error& e) {
-				fprintf(stderr, "Error in worker thread: %s\n", e.what());
-			} catch (...) {
-				fprintf(stderr, "Error in worker thread: %s\n", unknown_error().what());
-			}
-		}
-		//cout << "Worker thread finished" << endl;
-		whenFinished->set();
-		return Void();
-	});*/
+	WorkerThreadArgs* args = new WorkerThreadArgs;
+	args->nextAction = nextAction;
+	args->nextActionReady = nextActionReady;
+	args->index = index;
+	args->whenFinished = whenFinished;
+	startThread( &conflictSetWorkerThread, args );
 }
 
 StringRef setK( Arena& arena, int i ) {
@@ -924,16 +967,15 @@ StringRef setK( Arena& arena, int i ) {
 #include "ConflictSet.h"
 
 struct ConflictSet {
-	ConflictSet() : oldestVersion(0) {
-		static_assert(PARALLEL_THREAD_COUNT == 0, "workerThread() not implemented");
-		static_assert(PARALLEL_THREAD_COUNT == 0 || FASTALLOC_THREAD_SAFE, "Thread safe fast allocator required for multithreaded conflict set");
-		for (int i = 0; i < PARALLEL_THREAD_COUNT; i++) {
+	explicit ConflictSet( int threadCount ) : oldestVersion(0), passStartVersion(0), compactedVersion(0) {
+		static_assert(FASTALLOC_THREAD_SAFE, "Thread safe fast allocator required for multithreaded conflict set");
+		for (int i = 0; i < threadCount; i++) {
 			worker_nextAction.push_back( NULL );
 			worker_ready.push_back( new Event );
 			worker_finished.push_back( new Event );
 		}
 		for(int t=0; t<worker_nextAction.size(); t++)
-			workerThread( &worker_nextAction[t], worker_ready[t], (t)*2, worker_finished[t] );
+			workerThread( &worker_nextAction[t], worker_ready[t], t+1, worker_finished[t] );
 	}
 	~ConflictSet() {
 		for(int i=0; i<worker_nextAction.size(); i++) {
@@ -943,24 +985,83 @@ struct ConflictSet {
 		// Wait for workers to terminate; otherwise can get crashes at shutdown time
 		for(int i=0; i<worker_finished.size(); i++)
 			worker_finished[i]->block();
+		for(int i=0; i<worker_ready.size(); i++) {
+			delete worker_ready[i];
+			delete worker_finished[i];
+		}
+	}
+
+	int workerCount() const { return worker_nextAction.size(); }
+
+	// Runs f(t) for each t in [0, count) on worker thread t and blocks until all of them are done.
+	//   An error thrown on a worker is rethrown here, after every worker has finished.
+	template <class F>
+	void runOnWorkers( int count, F const& f ) {
+		ASSERT( count <= workerCount() );
+		vector<Event> done( count );
+		vector<Optional<Error>> errors( count );
+		for(int t=0; t<count; t++) {
+			worker_nextAction[t] = action( [&f,&done,&errors,t] {
+				try {
+					f(t);
+				} catch (Error& e) {
+					errors[t] = e;
+				} catch (...) {
+					errors[t] = unknown_error();
+				}
+				done[t].set();
+			});
+			worker_ready[t]->set();
+		}
+		for(int t=0; t<count; t++)
+			done[t].block();
+		for(int t=0; t<count; t++)
+			if (errors[t].present())
+				throw errors[t].get();
 	}
 
 	SkipList versionHistory;
 	Key removalKey;
 	Version oldestVersion;
+	Version passStartVersion;	// oldestVersion when the current compaction pass started at the beginning of the key space
+	Version compactedVersion;	// passStartVersion of the last completed compaction pass
 	vector<PAction> worker_nextAction;
 	vector<Event*> worker_ready;
 	vector<Event*> worker_finished;
 };
 
-ConflictSet* newConflictSet() { return new ConflictSet; }
+ConflictSet* newConflictSet() { return new ConflictSet( SERVER_KNOBS->RESOLVER_CONFLICT_SET_THREADS ); }
 void clearConflictSet( ConflictSet* cs, Version v ) {
 	SkipList(v).swap( cs->versionHistory );
+	cs->removalKey = Key();
+	cs->passStartVersion = cs->compactedVersion = cs->oldestVersion;
 }
 void destroyConflictSet(ConflictSet* cs) {
 	delete cs;
 }
 
+int compactConflictSet( ConflictSet* cs, int nodeBudget, bool* passFinished ) {
+	if (!cs->removalKey.size())
+		cs->passStartVersion = cs->oldestVersion;
+
+	SkipList::Finger finger;
+	int temp;
+	cs->versionHistory.find( &cs->removalKey, &finger, &temp, 1 );
+	int removed = cs->versionHistory.removeBefore( cs->oldestVersion, finger, nodeBudget );
+	cs->removalKey = finger.getValue();
+
+	bool finished = !finger.finger[0]->getNext(0);
+	if (finished)
+		cs->compactedVersion = cs->passStartVersion;
+	if (passFinished)
+		*passFinished = finished;
+	return removed;
+}
+
+Version getConflictSetCompactionBacklog( ConflictSet* cs ) {
+	return cs->oldestVersion - cs->compactedVersion;
+}
+
 ConflictBatch::ConflictBatch( ConflictSet* cs )
 	: cs(cs), transactionCount(0)
 {
@@ -995,7 +1096,7 @@ void ConflictBatch::addTransaction( const CommitTransactionRef& tr ) {
 			points.push_back( KeyInfo( range.begin, false, true, false, t, &info->readRanges[r].first ) );
 			//points.back().keyEnd = StringRef(buf,range.second);
 			points.push_back( KeyInfo( range.end, false, false, false, t, &info->readRanges[r].second ) );
-			combinedReadConflictRanges.push_back( ReadConflictRange( range.begin, range.end, tr.read_snapshot, t ) );
+			combinedReadConflictRanges.push_back( ReadConflictRange( range.begin, range.end, tr.read_snapshot, t, r ) );
 		}
 		for(int r=0; r<tr.write_conflict_ranges.size(); r++) {
 			const KeyRangeRef& range = tr.write_conflict_ranges[r];
@@ -1031,7 +1132,8 @@ class MiniConflictSet : NonCopyable {
 	vector<wordType> values; // undefined when andValues is true for a range of values
 	vector<wordType> orValues;
 	vector<wordType> andValues;
-	MiniConflictSet2 debug;		// SOMEDAY: Test on big ranges, eliminate this
+	bool verify;
+	MiniConflictSet2 debug;		// Cross-checks orImpl() when verify is set; too slow to maintain in production
 
 	uint64_t bitMask(unsigned int bit){ // computes results for bit%word
 		return (((wordType)1) << ( bit & bucketMask )); // '&' unnecesary?
@@ -1091,7 +1193,7 @@ class MiniConflictSet : NonCopyable {
 	}
 
 public:
-	explicit MiniConflictSet( int size ) : debug(size) {
+	explicit MiniConflictSet( int size, bool verify = g_network && g_network->isSimulated() ) : verify(verify), debug(verify ? size : 0) {
 		static_assert((1<<bucketShift) == sizeof(wordType)*8, "BucketShift incorrect");
 
 		values.assign( wordsForNBits(size), false );
@@ -1100,7 +1202,7 @@ public:
 	}
 
 	void set( int begin, int end ) {
-		debug.set(begin,end);
+		if (verify) debug.set(begin,end);
 		if (begin == end) return;
 
 		int beginWord = begin>>bucketShift;
@@ -1113,9 +1215,11 @@ public:
 
 	bool any(int begin, int end) {
 		bool a = orImpl(begin,end);
-		bool b = debug.any(begin,end);
-		ASSERT( a == b );
-		return b;
+		if (verify) {
+			bool b = debug.any(begin,end);
+			ASSERT( a == b );
+		}
+		return a;
 	}
 
 	bool orImpl( int begin, int end ) {
@@ -1143,6 +1247,7 @@ void ConflictBatch::checkIntraBatchConflicts() {
 		for(int i=0; i<tr.readRanges.size(); i++)
 			if ( mcs.any( tr.readRanges[i].first, tr.readRanges[i].second ) ) {
 				conflict = true;
+				transactionConflictingRange[t] = i;
 				break;
 			}
 		transactionConflictStatus[t] = conflict;
@@ -1160,7 +1265,7 @@ void ConflictBatch::GetTooOldTransactions(vector<int>& tooOldTransactions) {
 	}
 }
 
-void ConflictBatch::detectConflicts(Version now, Version newOldestVersion, vector<int>& nonConflicting, vector<int>* tooOldTransactions) {
+void ConflictBatch::detectConflicts(Version now, Version newOldestVersion, vector<int>& nonConflicting, vector<int>* tooOldTransactions, vector<int>* conflictingRanges) {
 	double t = timer();
 	sortPoints( points );
 	//std::sort( combinedReadConflictRanges.begin(), combinedReadConflictRanges.end() );
@@ -1168,6 +1273,7 @@ void ConflictBatch::detectConflicts(Version now, Version newOldestVersion, vecto
 
 	transactionConflictStatus = new bool[ transactionCount ];
 	memset(transactionConflictStatus, 0, transactionCount*sizeof(bool));
+	transactionConflictingRange.assign( transactionCount, -1 );
 
 	t = timer();
 	checkReadConflictRanges();
@@ -1192,17 +1298,17 @@ void ConflictBatch::detectConflicts(Version now, Version newOldestVersion, vecto
 		if (tooOldTransactions && transactionInfo[i]->tooOld)
 			tooOldTransactions->push_back(i);
 	}
+	if (conflictingRanges)
+		conflictingRanges->swap( transactionConflictingRange );
 
 	delete[] transactionConflictStatus;
 
 	t = timer();
 	if (newOldestVersion > cs->oldestVersion) {
+		// Reclaim roughly as many entries as this batch may have added, so that the version history stays bounded
+		//   under sustained load.  The resolver compacts the rest between batches.
 		cs->oldestVersion = newOldestVersion;
-		SkipList::Finger finger; 
-		int temp;
-		cs->versionHistory.find( &cs->removalKey, &finger, &temp, 1 );
-		cs->versionHistory.removeBefore( cs->oldestVersion, finger, combinedWriteConflictRanges.size()*3 + 10 );
-		cs->removalKey = finger.getValue();
+		compactConflictSet( cs, combinedWriteConflictRanges.size()*SERVER_KNOBS->RESOLVER_BATCH_COMPACTION_NODES_PER_RANGE + 10 );
 	}
 	g_removeBefore += timer()-t;
 }
@@ -1211,24 +1317,18 @@ void ConflictBatch::checkReadConflictRanges() {
 	if (!combinedReadConflictRanges.size()) 
 		return;
 
-	if (PARALLEL_THREAD_COUNT) {
-		Event done[PARALLEL_THREAD_COUNT?PARALLEL_THREAD_COUNT:1];
-		for(int t=0; t<PARALLEL_THREAD_COUNT; t++) {
-			cs->worker_nextAction[t] = action( [&,t] {
-#pragma GCC diagnostic push
-DISABLE_ZERO_DIVISION_FLAG
-				auto begin = &combinedReadConflictRanges[0] + t*combinedReadConflictRanges.size()/PARALLEL_THREAD_COUNT;
-				auto end = &combinedReadConflictRanges[0] + (t+1)*combinedReadConflictRanges.size()/PARALLEL_THREAD_COUNT;
-#pragma GCC diagnostic pop
-				cs->versionHistory.detectConflicts( begin, end-begin, transactionConflictStatus );
-				done[t].set();
-			});
-			cs->worker_ready[t]->set();
-		}
-		for(int i=0; i<PARALLEL_THREAD_COUNT; i++)
-			done[i].block();
+	// The version history is only read here, so the workers can share it.  Each worker writes only
+	//   'true' into transactionConflictStatus, so racing on the same transaction is harmless; the
+	//   index of any one of the transaction's conflicting ranges is as good as another's.
+	int threads = std::min<int>( cs->workerCount(), combinedReadConflictRanges.size() / SERVER_KNOBS->RESOLVER_CONFLICT_SET_PARALLEL_MIN_RANGES );
+	if (threads > 1) {
+		cs->runOnWorkers( threads, [this, threads] (int t) {
+			auto begin = &combinedReadConflictRanges[0] + t*combinedReadConflictRanges.size()/threads;
+			auto end = &combinedReadConflictRanges[0] + (t+1)*combinedReadConflictRanges.size()/threads;
+			cs->versionHistory.detectConflicts( begin, end-begin, transactionConflictStatus, &transactionConflictingRange[0] );
+		});
 	} else {
-		cs->versionHistory.detectConflicts( &combinedReadConflictRanges[0], combinedReadConflictRanges.size(), transactionConflictStatus );
+		cs->versionHistory.detectConflicts( &combinedReadConflictRanges[0], combinedReadConflictRanges.size(), transactionConflictStatus, &transactionConflictingRange[0] );
 	}
 }
 
@@ -1261,38 +1361,43 @@ void ConflictBatch::mergeWriteConflictRanges(Version now) {
 	if (!combinedWriteConflictRanges.size()) 
 		return;
 
-	if (PARALLEL_THREAD_COUNT) {
+	// Choose the first write range of each partition.  A partition must not insert its right boundary key
+	//   (see SkipList::partition), so never split between two ranges that abut.
+	vector<int> partBegin( 1, 0 );
+	int threads = std::min<int>( cs->workerCount(), combinedWriteConflictRanges.size() / SERVER_KNOBS->RESOLVER_CONFLICT_SET_PARALLEL_MIN_RANGES );
+	for(int p=1; p<threads; p++) {
+		int r = std::max<int>( p*combinedWriteConflictRanges.size()/threads, partBegin.back()+1 );
+		while (r < combinedWriteConflictRanges.size() && combinedWriteConflictRanges[r-1].second == combinedWriteConflictRanges[r].first)
+			r++;
+		if (r >= combinedWriteConflictRanges.size())
+			break;
+		partBegin.push_back(r);
+	}
+	partBegin.push_back( combinedWriteConflictRanges.size() );
+
+	if (partBegin.size() > 2) {
 		vector<SkipList> parts;
-		for (int i = 0; i < PARALLEL_THREAD_COUNT; i++)
+		for (int i = 0; i < partBegin.size()-1; i++)
 			parts.push_back(SkipList());
 
 		vector<StringRef> splits( parts.size()-1 );
 		for(int s=0; s<splits.size(); s++)
-			splits[s] = combinedWriteConflictRanges[ (s+1)*combinedWriteConflictRanges.size()/parts.size() ].first;
+			splits[s] = combinedWriteConflictRanges[ partBegin[s+1] ].first;
 
-		cs->versionHistory.partition( splits.size() ? &splits[0] : NULL, splits.size(), &parts[0] );
-		vector<double> tstart(PARALLEL_THREAD_COUNT), tend(PARALLEL_THREAD_COUNT);
-		Event done[PARALLEL_THREAD_COUNT ? PARALLEL_THREAD_COUNT : 1];
+		cs->versionHistory.partition( &splits[0], splits.size(), &parts[0] );
+		vector<double> tstart(parts.size()), tend(parts.size());
 		double before = timer();
-		for(int t=0; t<parts.size(); t++) {
-			cs->worker_nextAction[t] = action( [&,t] {
-				tstart[t] = timer();
-				auto begin = combinedWriteConflictRanges.begin() + (t*combinedWriteConflictRanges.size()/parts.size());
-				auto end = combinedWriteConflictRanges.begin() + ((t+1)*combinedWriteConflictRanges.size()/parts.size());
+		cs->runOnWorkers( parts.size(), [&] (int t) {
+			tstart[t] = timer();
+			auto begin = combinedWriteConflictRanges.begin() + partBegin[t];
+			auto end = combinedWriteConflictRanges.begin() + partBegin[t+1];
 
-				addConflictRanges(now, begin, end, &parts[t]);
+			addConflictRanges(now, begin, end, &parts[t]);
 
-				tend[t] = timer();
-				done[t].set();
-			});
-			cs->worker_ready[t]->set();
-		}
-		double launch = timer();
-		for(int i=0; i<PARALLEL_THREAD_COUNT; i++)
-			done[i].block();
+			tend[t] = timer();
+		});
 		double after = timer();
 
-		g_merge_launch += launch-before;
 		//g_merge_start_var += *std::max_element(tstart.begin(), tstart.end()) - before;
 		g_merge_fork += *std::min_element(tstart.begin(), tstart.end()) - before;
 		g_merge_start_var += *std::max_element(tstart.begin(), tstart.end()) - *std::min_element(tstart.begin(), tstart.end());
@@ -1338,32 +1443,43 @@ void ConflictBatch::combineWriteConflictRanges()
 
 //void showNumaStatus();
 
-/*
-bool sse4Less( const uint8_t* a, int aLen, const uint8_t* b, int bLen ) {
-	while (true) {
-		int res = _mm_cmpestri(*(__m128i*)a, aLen, *(__m128i*)b, bLen, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT );
-		printf("%d ", res);
-		if (res == 16) {
-			if (bLen < 16) return false;
-			a += 16; b += 16; aLen -= 16; bLen -= 16;
-		}
-		if (res == bLen) return false;
-		if (res == aLen) return true;
 
-		return a[res] < b[res];
+void miniConflictSetTest() {
+	for(int i=0; i<2000000; i++) {
+		int size = 64*5;		// Also run 64*64*5 to test multiple words of andValues and orValues
+		MiniConflictSet mini(size, true);
+		for(int j=0; j<2; j++) {
+			int a = g_random->randomInt(0, size);
+			int b = g_random->randomInt(a, size);
+			mini.set( a, b );
+		}
+		for(int j=0; j<4; j++) {
+			int a = g_random->randomInt(0, size);
+			int b = g_random->randomInt(a, size);
+			mini.any( a, b );	// Tests correctness internally
+		}
 	}
+	printf("miniConflictSetTest complete\n");
 }
 
-void tless( const char* a, const char* b ) {
-	bool x = sse4Less( (const uint8_t*)a, strlen(a), (const uint8_t*)b, strlen(b) );
-	if (x)
-		printf("%s < %s\n", a, b);
-	else
-		printf("%s >= %s\n", a, b);
+static bool scalarLess( const uint8_t* a, int aLen, const uint8_t* b, int bLen ) {
+	int len = min(aLen, bLen);
+	for(int i=0; i<len; i++)
+		if (a[i] < b[i])
+			return true;
+		else if (a[i] > b[i])
+			return false;
+	return aLen < bLen;
 }
 
-void sse4Test(){
+static void tless( const char* a, const char* b ) {
+	StringRef x( (const uint8_t*)a, strlen(a) ), y( (const uint8_t*)b, strlen(b) );
+	ASSERT( (compare(x, y) < 0) == scalarLess(x.begin(), x.size(), y.begin(), y.size()) );
+	ASSERT( (compare(y, x) < 0) == scalarLess(y.begin(), y.size(), x.begin(), x.size()) );
+	ASSERT( (compare(x, y) == 0) == (x == y) );
+}
 
+void compareTest() {
 	tless("hello", "world");
 	tless("a", "a");
 	tless("world", "hello");
@@ -1378,47 +1494,67 @@ void sse4Test(){
 	tless("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaworry", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaworld");
 	tless("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaahello", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaahello1");
 	tless("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaahello1", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaahello");
-
-	char *a = "hello1worldthisisalonglonglongstring";
-	char *b = "hello";
-	__m128i aa = *(__m128i*)a;
-	__m128i bb = *(__m128i*)a;
-
-	int res = _mm_cmpestri(aa, 2, bb, 2, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT );
-
-	cout << res << endl;
-
+	tless("aaaaaaaaaaaaaaa\xff", "aaaaaaaaaaaaaaa\x01");
+	tless("aaaaaaaaaaaaaaaa\xff", "aaaaaaaaaaaaaaaa\x01");
+
+	for(int i=0; i<100000; i++) {
+		uint8_t a[80], b[80];
+		int aLen = g_random->randomInt(0, 80), bLen = g_random->randomInt(0, 80);
+		for(int c=0; c<80; c++)
+			a[c] = b[c] = g_random->randomInt(0, 256);
+		if (g_random->coinflip())
+			b[ g_random->randomInt(0, 80) ] = g_random->randomInt(0, 256);
+		StringRef x(a, aLen), y(b, bLen);
+		ASSERT( (compare(x, y) < 0) == scalarLess(a, aLen, b, bLen) );
+		ASSERT( (compare(x, y) == 0) == (x == y) );
+	}
+	printf("compareTest complete\n");
 }
-*/
 
-void miniConflictSetTest() {
-	for(int i=0; i<2000000; i++) {
-		int size = 64*5;		// Also run 64*64*5 to test multiple words of andValues and orValues
-		MiniConflictSet mini(size);
-		for(int j=0; j<2; j++) {
-			int a = g_random->randomInt(0, size);
-			int b = g_random->randomInt(a, size);
-			mini.set( a, b );
-		}
-		for(int j=0; j<4; j++) {
-			int a = g_random->randomInt(0, size);
-			int b = g_random->randomInt(a, size);
-			mini.any( a, b );	// Tests correctness internally
+// Compares the scalar loop SkipList::less() used to be with firstDifference() on keys shaped like tuple
+//   encoded index entries: a long prefix shared by every key, followed by a few distinguishing bytes
+void keyComparisonBenchmark() {
+	printf("Key comparison benchmark\n");
+	for(int keySize = 16; keySize <= 64; keySize *= 2) {
+		Arena arena;
+		vector<StringRef> keys;
+		for(int i=0; i<1000; i++) {
+			uint8_t* k = new (arena) uint8_t[keySize];
+			for(int c=0; c<keySize; c++)
+				k[c] = c < keySize-4 ? 'a' + c%26 : g_random->randomInt(0, 256);
+			keys.push_back( StringRef(k, keySize) );
 		}
+
+		int scalarCount = 0, vectorCount = 0;
+		double t = timer();
+		for(int i=0; i<keys.size(); i++)
+			for(int j=0; j<keys.size(); j++)
+				scalarCount += scalarLess( keys[i].begin(), keys[i].size(), keys[j].begin(), keys[j].size() );
+		double scalarTime = timer()-t;
+
+		t = timer();
+		for(int i=0; i<keys.size(); i++)
+			for(int j=0; j<keys.size(); j++)
+				vectorCount += compare( keys[i], keys[j] ) < 0;
+		double vectorTime = timer()-t;
+
+		ASSERT( scalarCount == vectorCount );
+		printf("  %2d byte keys: scalar %0.3f ns, vector %0.3f ns per comparison (%0.2fx)\n", keySize,
+			scalarTime*1e9/(keys.size()*keys.size()), vectorTime*1e9/(keys.size()*keys.size()), scalarTime/vectorTime);
 	}
-	printf("miniConflictSetTest complete\n");
 }
 
 void skipListTest() {
 	printf("Skip list test\n");
 
-	//sse4Test();
+	compareTest();
 
 	//A test case that breaks the old operator<
 	//KeyInfo a( LiteralStringRef("hello"), true, false, true, -1 );
 	//KeyInfo b( LiteralStringRef("hello\0"), false, false, false, 0 );
 
 	miniConflictSetTest();
+	keyComparisonBenchmark();
 
 
 	setAffinity(0);
@@ -1446,7 +1582,7 @@ void skipListTest() {
 		}
 	}
 	printf("Test data generated (%d)\n", g_random->randomInt(0,100000));
-	printf("  %d threads, %d batches, %d/batch\n", PARALLEL_THREAD_COUNT, testData.size(), testData[0].size());
+	printf("  %d threads, %d batches, %d/batch\n", cs->workerCount(), testData.size(), testData[0].size());
 
 	printf("Running\n");
 
@@ -1549,3 +1685,45 @@ void skipListTest() {
 	//for(int i=0; i<testData.size(); i++)
 	//	printf("%d %d %d %d\n", i, nonConflict[i].size(), nonConflict2[i].size()-nonConflict[i].size(), nonConflict[i] != nonConflict2[i]);
 }
+
+TEST_CASE("fdbserver/SkipList/conflictingRanges") {
+	ConflictSet* cs = newConflictSet();
+	Arena arena;
+
+	// Commit a write to "b" at version 10
+	CommitTransactionRef w;
+	w.read_snapshot = 9;
+	w.write_conflict_ranges.push_back( arena, singleKeyRange( LiteralStringRef("b"), arena ) );
+	{
+		vector<int> nonConflicting;
+		ConflictBatch batch( cs );
+		batch.addTransaction( w );
+		batch.detectConflicts( 10, 0, nonConflicting );
+		ASSERT( nonConflicting.size() == 1 );
+	}
+
+	// The first transaction reads "b" from before the write, and so conflicts on its second range.  The second writes
+	// "m", which the third then reads (as its first range) within the same batch.
+	CommitTransactionRef t0, t1, t2;
+	t0.read_snapshot = 5;
+	t0.read_conflict_ranges.push_back( arena, KeyRangeRef( LiteralStringRef("x"), LiteralStringRef("y") ) );
+	t0.read_conflict_ranges.push_back( arena, KeyRangeRef( LiteralStringRef("a"), LiteralStringRef("c") ) );
+	t1.read_snapshot = 10;
+	t1.write_conflict_ranges.push_back( arena, singleKeyRange( LiteralStringRef("m"), arena ) );
+	t2.read_snapshot = 10;
+	t2.read_conflict_ranges.push_back( arena, singleKeyRange( LiteralStringRef("m"), arena ) );
+	t2.read_conflict_ranges.push_back( arena, singleKeyRange( LiteralStringRef("z"), arena ) );
+
+	vector<int> nonConflicting, conflictingRanges;
+	ConflictBatch batch( cs );
+	batch.addTransaction( t0 );
+	batch.addTransaction( t1 );
+	batch.addTransaction( t2 );
+	batch.detectConflicts( 20, 0, nonConflicting, NULL, &conflictingRanges );
+	ASSERT( nonConflicting.size() == 1 && nonConflicting[0] == 1 );
+	ASSERT( conflictingRanges.size() == 3 );
+	ASSERT( conflictingRanges[0] == 1 && conflictingRanges[1] == -1 && conflictingRanges[2] == 0 );
+
+	destroyConflictSet( cs );
+	return Void();
+}
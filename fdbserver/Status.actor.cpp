@@ -30,6 +30,7 @@
 #include "CoordinationInterface.h"
 #include "DataDistribution.h"
 #include "flow/UnitTest.h"
+#include "flow/Histogram.h"
 #include "QuietDatabase.h"
 #include "RecoveryState.h"
 
@@ -577,6 +578,74 @@ struct RolesInfo {
 	}
 };
 
+// Parses the Rpc<n> details of an RpcLatencyMetrics event (see FlowTransport::logRpcLatencyMetrics) into an object keyed by request type
+static StatusObject rpcLatencyStatusFetcher(std::string const& event) {
+	StatusObject rpcLatencyObj;
+	int requestTypes = parseInt(extractAttribute(event, "RequestTypes"));
+	for(int i = 0; i < requestTypes; i++) {
+		std::string rpc = extractAttribute(event, format("Rpc%d", i));
+		long long count;
+		double requestBytes, median, p90, p99, max;
+		int typeStart = 0;
+		if (sscanf(rpc.c_str(), "%lld %lf %lf %lf %lf %lf %n", &count, &requestBytes, &median, &p90, &p99, &max, &typeStart) != 6 || !typeStart)
+			continue;
+
+		StatusObject typeObj;
+		typeObj["count"] = (int64_t)count;
+		typeObj["mean_request_bytes"] = requestBytes;
+		typeObj["median_seconds"] = median;
+		typeObj["p90_seconds"] = p90;
+		typeObj["p99_seconds"] = p99;
+		typeObj["max_seconds"] = max;
+		rpcLatencyObj[rpc.substr(typeStart)] = typeObj;
+	}
+	return rpcLatencyObj;
+}
+
+static StatusObject latencyStatistics( std::vector<std::string> const& events, std::string const& attribute );
+
+// Splits one of the comma separated lists of ProcessMetrics (ThreadGroups or DiskDevices)
+static std::vector<std::string> splitMetricsList( std::string const& event, std::string const& attribute ) {
+	std::vector<std::string> items;
+	std::string list;
+	if( !tryExtractAttribute( StringRef(event), StringRef(attribute), list ) )
+		return items;
+	for(size_t begin = 0; begin < list.size(); ) {
+		size_t end = std::min( list.find(',', begin), list.size() );
+		items.push_back( list.substr(begin, end - begin) );
+		begin = end + 1;
+	}
+	return items;
+}
+
+// The time each group of threads of a process spent on a CPU, and waiting in the run queue for one, as average numbers of cores
+static StatusObject threadGroupStatistics( std::string const& event, double elapsed ) {
+	StatusObject threadsObj;
+	auto groups = splitMetricsList( event, "ThreadGroups" );
+	for(int g = 0; g < groups.size(); g++) {
+		StatusObject groupObj;
+		groupObj["count"] = parseInt(extractAttribute(event, format("Thread%dCount", g)));
+		groupObj["usage_cores"] = parseDouble(extractAttribute(event, format("Thread%dCPUSeconds", g))) / elapsed;
+		groupObj["run_queue_cores"] = parseDouble(extractAttribute(event, format("Thread%dRunQueueSeconds", g))) / elapsed;
+		threadsObj[groups[g]] = groupObj;
+	}
+	return threadsObj;
+}
+
+// The latencies of the reads and writes a process did on each device
+static StatusObject diskDeviceStatistics( std::string const& event ) {
+	StatusObject devicesObj;
+	auto devices = splitMetricsList( event, "DiskDevices" );
+	std::vector<std::string> events(1, event);
+	for(int d = 0; d < devices.size(); d++) {
+		StatusObject deviceObj;
+		deviceObj["read_latency"] = latencyStatistics( events, format("Disk%dReadLatencies", d) );
+		deviceObj["write_latency"] = latencyStatistics( events, format("Disk%dWriteLatencies", d) );
+		devicesObj[devices[d]] = deviceObj;
+	}
+	return devicesObj;
+}
+
 ACTOR static Future<StatusObject> processStatusFetcher(
 		Reference<AsyncVar<struct ServerDBInfo>> db,
 		std::vector<std::pair<WorkerInterface, ProcessClass>> workers,
@@ -585,6 +654,7 @@ ACTOR static Future<StatusObject> processStatusFetcher(
 		WorkerEvents errors,
 		WorkerEvents traceFileOpenErrors,
 		WorkerEvents programStarts,
+		WorkerEvents rpcLatencies,
 		std::map<std::string, StatusObject> processIssues,
 		vector<std::pair<StorageServerInterface, std::string>> storageServers,
 		vector<std::pair<TLogInterface, std::string>> tLogs,
@@ -737,6 +807,9 @@ ACTOR static Future<StatusObject> processStatusFetcher(
 				if (elapsed > 0){
 					StatusObject cpuObj;
 					cpuObj["usage_cores"] = std::max(0.0, cpu_seconds / elapsed);
+					StatusObject threadsObj = threadGroupStatistics(event, elapsed);
+					if (threadsObj.size())
+						cpuObj["threads"] = threadsObj;
 					statusObj["cpu"] = cpuObj;
 
 					diskObj["busy"] = std::max(0.0, std::min((elapsed - diskIdleSeconds) / elapsed, 1.0));
@@ -759,8 +832,29 @@ ACTOR static Future<StatusObject> processStatusFetcher(
 
 				diskObj["total_bytes"] = parseInt64(extractAttribute(event, "DiskTotalBytes"));
 				diskObj["free_bytes"] = parseInt64(extractAttribute(event, "DiskFreeBytes"));
+				StatusObject devicesObj = diskDeviceStatistics(event);
+				if (devicesObj.size())
+					diskObj["devices"] = devicesObj;
 				statusObj["disk"] = diskObj;
 
+				if (elapsed > 0) {
+					StatusObject pageCacheObj;
+					std::string cacheHits, cacheMisses, cacheEvictions;
+					if (tryExtractAttribute(event, LiteralStringRef("CacheHits"), cacheHits) &&
+						tryExtractAttribute(event, LiteralStringRef("CacheMisses"), cacheMisses) &&
+						tryExtractAttribute(event, LiteralStringRef("CacheEvictions"), cacheEvictions))
+					{
+						StatusObject hitsObj, missesObj, evictionsObj;
+						hitsObj["hz"] = parseInt64(cacheHits) / elapsed;
+						missesObj["hz"] = parseInt64(cacheMisses) / elapsed;
+						evictionsObj["hz"] = parseInt64(cacheEvictions) / elapsed;
+						pageCacheObj["hits"] = hitsObj;
+						pageCacheObj["misses"] = missesObj;
+						pageCacheObj["evictions"] = evictionsObj;
+						statusObj["page_cache"] = pageCacheObj;
+					}
+				}
+
 				StatusObject networkObj;
 
 				networkObj["current_connections"] = parseInt64(extractAttribute(event, "CurrentConnections"));
@@ -806,6 +900,16 @@ ACTOR static Future<StatusObject> processStatusFetcher(
 					if (tryExtractAttribute(psxml, LiteralStringRef("CommandLine"), commandLine)) {
 						statusObj["command_line"] = commandLine;
 					}
+
+					// Where the process was placed, e.g. by fdbmonitor's cpu_affinity and numa_node options
+					std::string cpuAffinity, numaNode;
+					if (tryExtractAttribute(psxml, LiteralStringRef("CPUAffinity"), cpuAffinity) && cpuAffinity.size()) {
+						StatusObject placementObj;
+						placementObj["cpus"] = cpuAffinity;
+						if (tryExtractAttribute(psxml, LiteralStringRef("NUMANode"), numaNode) && parseInt(numaNode) >= 0)
+							placementObj["numa_node"] = parseInt(numaNode);
+						statusObj["placement"] = placementObj;
+					}
 				}
 			}
 
@@ -824,6 +928,12 @@ ACTOR static Future<StatusObject> processStatusFetcher(
 
 			statusObj["memory"] = memoryObj;
 
+			if (rpcLatencies.count(address) && rpcLatencies[address].size()) {
+				StatusObject rpcLatencyObj = rpcLatencyStatusFetcher(rpcLatencies[address]);
+				if (!rpcLatencyObj.empty())
+					statusObj["rpc_latency"] = rpcLatencyObj;
+			}
+
 			StatusArray messages;
 
 			if (errors.count(address) && errors[address].size()) {
@@ -1139,8 +1249,10 @@ ACTOR static Future<StatusObject> dataStatusFetcher(std::pair<WorkerInterface, P
 		// TODO:  Should this be serial?
 		futures.push_back(timeoutError(mWorker.first.eventLogRequest.getReply(EventLogRequest(StringRef(dbName + "/DDTrackerStarting"))), 1.0));
 		futures.push_back(timeoutError(mWorker.first.eventLogRequest.getReply(EventLogRequest(StringRef(dbName + "/DDTrackerStats"))), 1.0));
+		futures.push_back(timeoutError(mWorker.first.eventLogRequest.getReply(EventLogRequest(StringRef(dbName + "/ExclusionDrain"))), 1.0));
+		futures.push_back(timeoutError(mWorker.first.eventLogRequest.getReply(EventLogRequest(StringRef(dbName + "/RemoteExclusionDrain"))), 1.0));
 
-		std::vector<Standalone<StringRef>> dataInfo = wait(getAll(futures));
+		state std::vector<Standalone<StringRef>> dataInfo = wait(getAll(futures));
 
 		Standalone<StringRef> startingStats = dataInfo[0];
 		state Standalone<StringRef> dataStats = dataInfo[1];
@@ -1228,6 +1340,27 @@ ACTOR static Future<StatusObject> dataStatusFetcher(std::pair<WorkerInterface, P
 				statusObjData["partitions_count"] = shards;
 			}
 
+			// Servers excluded with drain, in the primary and remote team collections
+			int drainingServers = 0;
+			int64_t drainRemainingBytes = 0;
+			double drainBytesPerSecond = 0;
+			for(int i = 2; i < 4; i++) {
+				if (dataInfo[i].size()) {
+					drainingServers += parseInt(extractAttribute(dataInfo[i], LiteralStringRef("Servers")));
+					drainRemainingBytes += parseInt64(extractAttribute(dataInfo[i], LiteralStringRef("RemainingBytes")));
+					drainBytesPerSecond += parseDouble(extractAttribute(dataInfo[i], LiteralStringRef("BytesPerSecond")));
+				}
+			}
+			if (drainingServers) {
+				StatusObject exclusionDrain;
+				exclusionDrain["servers"] = drainingServers;
+				exclusionDrain["remaining_bytes"] = drainRemainingBytes;
+				exclusionDrain["bytes_per_second"] = drainBytesPerSecond;
+				if (drainBytesPerSecond > 0)
+					exclusionDrain["estimated_seconds_remaining"] = drainRemainingBytes / drainBytesPerSecond;
+				statusObjData["exclusion_drain"] = exclusionDrain;
+			}
+
 		}
 	}
 	catch (Error &e) {
@@ -1296,6 +1429,82 @@ static std::set<StringRef> getTLogEligibleMachines(vector<std::pair<WorkerInterf
 	return tlogEligibleMachines;
 }
 
+// Merges the histograms that LatencySamples logged as `attribute` in each of the given metrics events, so that percentiles are
+// over everything the roles recorded rather than averages of each one's percentiles.  Events without the attribute are skipped.
+static StatusObject latencyStatistics( std::vector<std::string> const& events, std::string const& attribute ) {
+	LatencyHistogram merged;
+	for(auto& e : events) {
+		std::string value;
+		LatencyHistogram h;
+		if( tryExtractAttribute( StringRef(e), StringRef(attribute), value ) && h.fromString( value ) )
+			merged.merge( h );
+	}
+
+	StatusObject obj;
+	obj["count"] = merged.count();
+	obj["mean"] = merged.mean();
+	obj["median"] = merged.median();
+	obj["p99"] = merged.percentile(0.99);
+	obj["p999"] = merged.percentile(0.999);
+	obj["max"] = merged.max();
+	return obj;
+}
+
+// Adds the rates of the hot keys in a HotKeys event with the given detail prefix to hz, summing them if each server sees
+// different requests for a key and taking the greatest if every replica sees the same ones
+static void addHotKeys( std::map<std::string, double>& hz, std::string const& event, std::string const& prefix, bool sum ) {
+	for(int i = 0; ; i++) {
+		std::string key, rate;
+		if( !tryExtractAttribute( StringRef(event), StringRef(format("%sKey%d", prefix.c_str(), i)), key ) ||
+			!tryExtractAttribute( StringRef(event), StringRef(format("%sHz%d", prefix.c_str(), i)), rate ) )
+			break;
+		double r = atof( rate.c_str() );
+		auto it = hz.find( key );
+		if( it == hz.end() )
+			hz[key] = r;
+		else
+			it->second = sum ? it->second + r : std::max( it->second, r );
+	}
+}
+
+static StatusArray hotKeysArray( std::map<std::string, double> const& hz ) {
+	std::vector<std::pair<double, std::string>> sorted;
+	for(auto& k : hz)
+		sorted.push_back( std::make_pair( k.second, k.first ) );
+	std::sort( sorted.begin(), sorted.end(), std::greater<std::pair<double, std::string>>() );
+
+	StatusArray arr;
+	for(int i = 0; i < sorted.size() && i < SERVER_KNOBS->HOT_KEY_TOP_K; i++) {
+		StatusObject obj;
+		obj["key"] = sorted[i].second;
+		obj["hz"] = sorted[i].first;
+		arr.push_back( obj );
+	}
+	return arr;
+}
+
+// The most read and written keys, from the HotKeys events of the storage servers, and the keys most responsible for
+// conflicts, from those of the resolvers.  Range reads and conflict ranges are counted by their begin keys.
+ACTOR static Future<StatusObject> hotKeysFetcher(vector<StorageServerInterface> storageServers, vector<ResolverInterface> resolvers, std::unordered_map<NetworkAddress, WorkerInterface> address_workers) {
+	state Future<vector<std::pair<StorageServerInterface, std::string>>> ssEvents = getServerMetrics(storageServers, address_workers, "/HotKeys");
+	state Future<vector<std::pair<ResolverInterface, std::string>>> resolverEvents = getServerMetrics(resolvers, address_workers, "/HotKeys");
+	Void _ = wait( success(ssEvents) && success(resolverEvents) );
+
+	std::map<std::string, double> reads, writes, conflicts;
+	for(auto& ss : ssEvents.get()) {
+		addHotKeys( reads, ss.second, "Read", true );
+		addHotKeys( writes, ss.second, "Write", false );
+	}
+	for(auto& r : resolverEvents.get())
+		addHotKeys( conflicts, r.second, "Conflict", true );
+
+	StatusObject obj;
+	obj["reads"] = hotKeysArray( reads );
+	obj["writes"] = hotKeysArray( writes );
+	obj["conflicts"] = hotKeysArray( conflicts );
+	return obj;
+}
+
 ACTOR static Future<StatusObject> workloadStatusFetcher(Reference<AsyncVar<struct ServerDBInfo>> db, vector<std::pair<WorkerInterface, ProcessClass>> workers, std::pair<WorkerInterface, ProcessClass> mWorker, std::string dbName, StatusObject *qos, StatusObject *data_overlay, std::set<std::string> *incomplete_reasons) {
 	state StatusObject statusObj;
 	state StatusObject operationsObj;
@@ -1338,6 +1547,14 @@ ACTOR static Future<StatusObject> workloadStatusFetcher(Reference<AsyncVar<struc
 		transactions["committed"] = txnCommitOutSuccess;
 
 		statusObj["transactions"] = transactions;
+
+		std::vector<std::string> proxyEvents;
+		for (auto &ps : proxyStats)
+			proxyEvents.push_back(ps.toString());
+		StatusObject latencyObj;
+		latencyObj["commit_seconds"] = latencyStatistics(proxyEvents, "commitLatency");
+		latencyObj["transaction_start_seconds"] = latencyStatistics(proxyEvents, "grvLatency");
+		statusObj["latency_statistics"] = latencyObj;
 	}
 	catch (Error& e) {
 		if (e.code() == error_code_actor_cancelled)
@@ -1393,6 +1610,9 @@ ACTOR static Future<StatusObject> workloadStatusFetcher(Reference<AsyncVar<struc
 				std::string reason_server_id = extractAttribute(md, LiteralStringRef("ReasonServerID"));
 				if (!reason_server_id.empty())
 					perfLimit["reason_server_id"] = reason_server_id;
+				std::string explanation;
+				if (tryExtractAttribute(md, LiteralStringRef("LimitExplanation"), explanation) && !explanation.empty())
+					perfLimit["explanation"] = explanation;
 			}
 		}
 		else {
@@ -1592,10 +1812,13 @@ ACTOR Future<StatusObject> layerStatusFetcher(Database cx, StatusArray *messages
 					for(j = 0; j < docs.size(); ++j) {
 						state json_spirit::mValue doc;
 						try {
-							json_spirit::read_string(docs[j].value.toString(), doc);
-							Void _ = wait(yield());
-							json.absorb(doc.get_obj());
-							Void _ = wait(yield());
+							if( readJSON(docs[j].value.toString(), doc) && doc.type() == json_spirit::obj_type ) {
+								Void _ = wait(yield());
+								json.absorb(doc.get_obj());
+								Void _ = wait(yield());
+							} else {
+								TraceEvent(SevWarn, "LayerStatusBadJSON").detail("Key", printable(docs[j].key));
+							}
 						} catch(Error &e) {
 							TraceEvent(SevWarn, "LayerStatusBadJSON").detail("Key", printable(docs[j].key));
 						}
@@ -1697,6 +1920,7 @@ ACTOR Future<StatusReply> clusterGetStatus(
 		futures.push_back(latestErrorOnWorkers(workers));
 		futures.push_back(latestEventOnWorkers(workers, "TraceFileOpenError"));
 		futures.push_back(latestEventOnWorkers(workers, "ProgramStart"));
+		futures.push_back(latestEventOnWorkers(workers, "RpcLatencyMetrics"));
 
 		// Wait for all response pairs.
 		state std::vector< Optional <std::pair<WorkerEvents, std::set<std::string>>> > workerEventsVec = wait(getAll(futures));
@@ -1735,6 +1959,7 @@ ACTOR Future<StatusReply> clusterGetStatus(
 		state WorkerEvents latestError = workerEventsVec[2].present() ? workerEventsVec[2].get().first : WorkerEvents();
 		state WorkerEvents traceFileOpenErrors = workerEventsVec[3].present() ? workerEventsVec[3].get().first : WorkerEvents();
 		state WorkerEvents programStarts = workerEventsVec[4].present() ? workerEventsVec[4].get().first : WorkerEvents();
+		state WorkerEvents rpcLatencies = workerEventsVec[5].present() ? workerEventsVec[5].get().first : WorkerEvents();
 
 		state StatusObject statusObj;
 		if(db->get().recoveryCount > 0) {
@@ -1838,13 +2063,34 @@ ACTOR Future<StatusReply> clusterGetStatus(
 			}
 			else
 				messages.push_back(makeMessage("log_servers_error", "Timed out trying to retrieve log servers."));
+
+			if (!storageServers.empty()) {
+				vector<StorageServerInterface> ssInterfaces;
+				for (auto &ss : storageServers)
+					ssInterfaces.push_back(ss.first);
+				StatusObject hotKeys = wait(hotKeysFetcher(ssInterfaces, db->get().resolvers, address_workers));
+				statusObj["hot_keys"] = hotKeys;
+			}
+
+			// Add the latencies of the storage servers and logs, from their metrics events, to those of the proxies
+			if (statusObj.count("workload") && statusObj["workload"].get_obj().count("latency_statistics")) {
+				std::vector<std::string> ssEvents, tLogEvents;
+				for (auto &ss : storageServers)
+					ssEvents.push_back(ss.second);
+				for (auto &log : tLogs)
+					tLogEvents.push_back(log.second);
+				StatusObject latencyObj = statusObj["workload"].get_obj()["latency_statistics"].get_obj();
+				latencyObj["read_seconds"] = latencyStatistics(ssEvents, "readLatency");
+				latencyObj["log_commit_seconds"] = latencyStatistics(tLogEvents, "commitLatency");
+				statusObj["workload"].get_obj()["latency_statistics"] = latencyObj;
+			}
 		}
 		else {
 			// Set layers status to { _valid: false, error: "configurationMissing"}
 			statusObj["layers"] = json_spirit::mObject({{"_valid", false}, {"_error", "configurationMissing"}});
 		}
 
-		StatusObject processStatus = wait(processStatusFetcher(db, workers, pMetrics, mMetrics, latestError, traceFileOpenErrors, programStarts, processIssues, storageServers, tLogs, cx, configuration, &status_incomplete_reasons));
+		StatusObject processStatus = wait(processStatusFetcher(db, workers, pMetrics, mMetrics, latestError, traceFileOpenErrors, programStarts, rpcLatencies, processIssues, storageServers, tLogs, cx, configuration, &status_incomplete_reasons));
 		statusObj["processes"] = processStatus;
 		statusObj["clients"] = clientStatusFetcher(clientVersionMap, traceLogGroupMap);
 
@@ -1883,6 +2129,7 @@ ACTOR Future<StatusReply> clusterGetStatus(
 		if (clusterTime != -1){
 			statusObj["cluster_controller_timestamp"] = clusterTime;
 		}
+		statusObj["status_age_seconds"] = 0.0;
 
 		return statusObj;
 	} catch( Error&e ) {
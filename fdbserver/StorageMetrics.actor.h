@@ -24,10 +24,73 @@
 #include "flow/UnitTest.h"
 #include "fdbclient/StorageServerInterface.h"
 #include "fdbclient/KeyRangeMap.h"
+#include "flow/BTreeIndexedSet.h"
 #include "Knobs.h"
 
+// A key held by a StorageMetricSample.  Keys of up to MAX_INLINE bytes are stored in the sample's tree node itself, and longer
+// keys take a single allocation of their own size, where a Key would also carry an Arena with its header and reference count.
+// It is the same size as a Key, so the tree nodes don't grow.
+struct SampledKey {
+	enum { MAX_INLINE = 23, ON_HEAP = 0xff };
+
+	SampledKey() { bytes[MAX_INLINE] = 0; }
+	SampledKey( KeyRef const& key ) { assign( key ); }
+	SampledKey( SampledKey const& r ) { assign( r ); }
+	SampledKey( SampledKey&& r ) noexcept(true) {
+		memcpy( bytes, r.bytes, sizeof(bytes) );
+		r.bytes[MAX_INLINE] = 0;
+	}
+	~SampledKey() { release(); }
+
+	SampledKey& operator=( KeyRef const& key ) {
+		SampledKey k( key );  // key may refer to our own bytes
+		return *this = std::move( k );
+	}
+	SampledKey& operator=( SampledKey const& r ) { return *this = (KeyRef)r; }
+	SampledKey& operator=( SampledKey&& r ) noexcept(true) {
+		if (this != &r) {
+			release();
+			memcpy( bytes, r.bytes, sizeof(bytes) );
+			r.bytes[MAX_INLINE] = 0;
+		}
+		return *this;
+	}
+
+	operator KeyRef() const {
+		if (bytes[MAX_INLINE] != ON_HEAP)
+			return KeyRef( bytes, bytes[MAX_INLINE] );
+		return KeyRef( heapBytes(), heapSize() );
+	}
+
+private:
+	// Either the key followed by padding and its length, or a pointer to the key and its length followed by padding and ON_HEAP
+	uint8_t bytes[MAX_INLINE+1];
+
+	uint8_t* heapBytes() const { uint8_t* p; memcpy( &p, bytes, sizeof(p) ); return p; }
+	int heapSize() const { int n; memcpy( &n, bytes + sizeof(uint8_t*), sizeof(n) ); return n; }
+
+	void assign( KeyRef const& key ) {
+		if (key.size() <= MAX_INLINE) {
+			memcpy( bytes, key.begin(), key.size() );
+			bytes[MAX_INLINE] = key.size();
+		} else {
+			uint8_t* p = (uint8_t*)allocateFast( key.size() );
+			int n = key.size();
+			memcpy( p, key.begin(), n );
+			memcpy( bytes, &p, sizeof(p) );
+			memcpy( bytes + sizeof(p), &n, sizeof(n) );
+			bytes[MAX_INLINE] = ON_HEAP;
+		}
+	}
+	void release() {
+		if (bytes[MAX_INLINE] == ON_HEAP)
+			freeFast( heapSize(), heapBytes() );
+		bytes[MAX_INLINE] = 0;
+	}
+};
+
 struct StorageMetricSample {
-	IndexedSet<Key, int64_t> sample;
+	BTreeIndexedSet<SampledKey, int64_t> sample;
 	int64_t metricUnitsPerSample;
 
 	StorageMetricSample( int64_t metricUnitsPerSample ) : metricUnitsPerSample(metricUnitsPerSample) {}
@@ -94,6 +157,26 @@ TEST_CASE("fdbserver/StorageMetricSample/simple") {
 	return Void();
 }
 
+TEST_CASE("fdbserver/StorageMetricSample/longKeys") {
+	StorageMetricSample s( 1000 );
+	std::string longKey( 100, 'b' );
+	s.sample.insert(LiteralStringRef("a"), 1000);
+	s.sample.insert(StringRef(longKey), 2000);
+	s.sample.insert(LiteralStringRef("b"), 1000);
+	s.sample.insert(LiteralStringRef("ccccccccccccccccccccccc"), 1000);  // exactly SampledKey::MAX_INLINE bytes
+	s.sample.insert(StringRef(longKey), 3000);
+
+	ASSERT(s.getEstimate(KeyRangeRef(LiteralStringRef("a"), LiteralStringRef("z"))) == 6000);
+	ASSERT(s.getEstimate(KeyRangeRef(LiteralStringRef("ba"), LiteralStringRef("c"))) == 3000);
+	ASSERT((KeyRef)*s.sample.find(StringRef(longKey)) == StringRef(longKey));
+
+	s.sample.erase(StringRef(longKey));
+	ASSERT(s.getEstimate(KeyRangeRef(LiteralStringRef("a"), LiteralStringRef("z"))) == 3000);
+	ASSERT((KeyRef)*s.sample.lastItem() == LiteralStringRef("ccccccccccccccccccccccc"));
+
+	return Void();
+}
+
 struct TransientStorageMetricSample : StorageMetricSample {
 	Deque< std::pair<double, std::pair<Key, int64_t>> > queue;
 
@@ -107,7 +190,7 @@ struct TransientStorageMetricSample : StorageMetricSample {
 	int64_t addAndExpire( KeyRef key, int64_t metric, double expiration ) {
 		int64_t x = add( key, metric );
 		if (x)
-			queue.push_back( std::make_pair( expiration, std::make_pair( *sample.find(key), -x ) ) );
+			queue.push_back( std::make_pair( expiration, std::make_pair( Key(key), -x ) ) );
 		return x;
 	}
 
@@ -184,9 +267,11 @@ struct StorageServerMetrics {
 	KeyRangeMap< vector< PromiseStream< StorageMetrics > > > waitMetricsMap;
 	StorageMetricSample byteSample;
 	TransientStorageMetricSample iopsSample, bandwidthSample;	// FIXME: iops and bandwidth calculations are not effectively tested, since they aren't currently used by data distribution
+	TransientStorageMetricSample bytesReadSample;
 
 	StorageServerMetrics()
-		: byteSample( 0 ), iopsSample( SERVER_KNOBS->IOPS_UNITS_PER_SAMPLE ), bandwidthSample( SERVER_KNOBS->BANDWIDTH_UNITS_PER_SAMPLE )
+		: byteSample( 0 ), iopsSample( SERVER_KNOBS->IOPS_UNITS_PER_SAMPLE ), bandwidthSample( SERVER_KNOBS->BANDWIDTH_UNITS_PER_SAMPLE ),
+		  bytesReadSample( SERVER_KNOBS->BYTES_READ_UNITS_PER_SAMPLE )
 	{
 	}
 
@@ -196,6 +281,7 @@ struct StorageServerMetrics {
 		result.bytes = byteSample.getEstimate( keys );
 		result.bytesPerKSecond = bandwidthSample.getEstimate( keys ) * SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS;
 		result.iosPerKSecond = iopsSample.getEstimate( keys ) * SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS;
+		result.bytesReadPerKSecond = bytesReadSample.getEstimate( keys ) * SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS;
 		return result;
 	}
 
@@ -214,6 +300,8 @@ struct StorageServerMetrics {
 			notifyMetrics.bytesPerKSecond = bandwidthSample.addAndExpire( key, metrics.bytesPerKSecond, expire ) * SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS;
 		if (metrics.iosPerKSecond)
 			notifyMetrics.iosPerKSecond = iopsSample.addAndExpire( key, metrics.iosPerKSecond, expire ) * SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS;
+		if (metrics.bytesReadPerKSecond)
+			notifyMetrics.bytesReadPerKSecond = bytesReadSample.addAndExpire( key, metrics.bytesReadPerKSecond, expire ) * SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS;
 		if (!notifyMetrics.allZero()) {
 			auto& v = waitMetricsMap[key];
 			for(int i=0; i<v.size(); i++) {
@@ -223,6 +311,13 @@ struct StorageServerMetrics {
 		}
 	}
 
+	// Called when bytes are returned to a reader, so that data distribution can see which shards are hot for reads
+	void notifyBytesRead( KeyRef key, int64_t bytes ) {
+		StorageMetrics metrics;
+		metrics.bytesReadPerKSecond = bytes;
+		notify( key, metrics );
+	}
+
 	// Called by StorageServerDisk when the size of a key in byteSample changes, to notify WaitMetricsRequest
 	// Should not be called for keys past allKeys.end
 	void notifyBytes( RangeMap<Key, std::vector<PromiseStream<StorageMetrics>>, KeyRangeRef>::Iterator shard, int64_t bytes ) {
@@ -262,6 +357,7 @@ struct StorageServerMetrics {
 	void poll() {
 		{ StorageMetrics m; m.bytesPerKSecond = SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS; bandwidthSample.poll(waitMetricsMap, m); }
 		{ StorageMetrics m; m.iosPerKSecond = SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS; iopsSample.poll(waitMetricsMap, m); }
+		{ StorageMetrics m; m.bytesReadPerKSecond = SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS; bytesReadSample.poll(waitMetricsMap, m); }
 		// bytesSample doesn't need polling because we never call addExpire() on it
 	}
 
@@ -312,7 +408,7 @@ struct StorageServerMetrics {
 				if( remaining.bytes < 2*SERVER_KNOBS->MIN_SHARD_BYTES )
 					break;
 				KeyRef key = req.keys.end;
-				bool hasUsed = used.bytes != 0 || used.bytesPerKSecond != 0 || used.iosPerKSecond != 0;
+				bool hasUsed = used.bytes != 0 || used.bytesPerKSecond != 0 || used.iosPerKSecond != 0 || used.bytesReadPerKSecond != 0;
 				key = getSplitKey( remaining.bytes, estimated.bytes, req.limits.bytes, used.bytes, 
 					req.limits.infinity, req.isLastShard, byteSample, 1, lastKey, key, hasUsed );
 				if( used.bytes < SERVER_KNOBS->MIN_SHARD_BYTES )
@@ -321,6 +417,8 @@ struct StorageServerMetrics {
 					req.limits.infinity, req.isLastShard, iopsSample, SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS, lastKey, key, hasUsed );
 				key = getSplitKey( remaining.bytesPerKSecond, estimated.bytesPerKSecond, req.limits.bytesPerKSecond, used.bytesPerKSecond, 
 					req.limits.infinity, req.isLastShard, bandwidthSample, SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS, lastKey, key, hasUsed );
+				key = getSplitKey( remaining.bytesReadPerKSecond, estimated.bytesReadPerKSecond, req.limits.bytesReadPerKSecond, used.bytesReadPerKSecond,
+					req.limits.infinity, req.isLastShard, bytesReadSample, SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS, lastKey, key, hasUsed );
 				ASSERT( key != lastKey || hasUsed);
 				if( key == req.keys.end )
 					break;
@@ -341,6 +439,29 @@ struct StorageServerMetrics {
 		}
 	}
 
+	// Unlike splitMetrics, which finds shard boundaries for data distribution, this only divides the range into roughly
+	// equal chunks of about req.chunkSize bytes, as estimated by the byte sample
+	void getSplitPoints( SplitRangeRequest req ) {
+		try {
+			SplitRangeReply reply;
+			KeyRef lastKey = req.keys.begin;
+			while( true ) {
+				int64_t remaining = byteSample.getEstimate( KeyRangeRef(lastKey, req.keys.end) );
+				int64_t chunks = (remaining + req.chunkSize/2) / req.chunkSize;
+				if( chunks <= 1 )
+					break;
+				KeyRef key = byteSample.splitEstimate( KeyRangeRef(lastKey, req.keys.end), remaining / chunks );
+				if( key <= lastKey || key >= req.keys.end )
+					break;
+				reply.splitPoints.push_back_deep( reply.splitPoints.arena(), key );
+				lastKey = reply.splitPoints.back();
+			}
+			req.reply.send(reply);
+		} catch (Error& e) {
+			req.reply.sendError(e);
+		}
+	}
+
 	void getPhysicalMetrics( GetPhysicalMetricsRequest req, StorageBytes sb ){
 		GetPhysicalMetricsReply rep;
 
@@ -357,10 +478,12 @@ struct StorageServerMetrics {
 		rep.free.bytes = sb.free;
 		rep.free.iosPerKSecond = 10e6;
 		rep.free.bytesPerKSecond = 100e9;
+		rep.free.bytesReadPerKSecond = 100e9;
 
 		rep.capacity.bytes = sb.total;
 		rep.capacity.iosPerKSecond = 10e6;
 		rep.capacity.bytesPerKSecond = 100e9;
+		rep.capacity.bytesReadPerKSecond = 100e9;
 
 		req.reply.send(rep);
 	}
@@ -387,6 +510,42 @@ private:
 	}
 };
 
+TEST_CASE("fdbserver/StorageServerMetrics/bytesRead") {
+	StorageServerMetrics metrics;
+	int64_t bytes = SERVER_KNOBS->BYTES_READ_UNITS_PER_SAMPLE * 2;	// Large enough to always be sampled
+	metrics.notifyBytesRead( LiteralStringRef("Banana"), bytes );
+	metrics.notifyBytesRead( LiteralStringRef("Dog"), bytes );
+
+	ASSERT( metrics.getMetrics( KeyRangeRef(LiteralStringRef("A"), LiteralStringRef("C")) ).bytesReadPerKSecond == int64_t( bytes * SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS ) );
+	ASSERT( metrics.getMetrics( KeyRangeRef(LiteralStringRef("A"), LiteralStringRef("E")) ).bytesReadPerKSecond == int64_t( 2 * bytes * SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS ) );
+	ASSERT( metrics.getMetrics( KeyRangeRef(LiteralStringRef("C"), LiteralStringRef("D")) ).bytesReadPerKSecond == 0 );
+	ASSERT( metrics.getMetrics( KeyRangeRef(LiteralStringRef("A"), LiteralStringRef("E")) ).bytesPerKSecond == 0 );
+
+	return Void();
+}
+
+TEST_CASE("fdbserver/StorageServerMetrics/getSplitPoints") {
+	StorageServerMetrics metrics;
+	for(uint8_t c = 'A'; c <= 'H'; c++)
+		metrics.byteSample.sample.insert( StringRef(&c, 1), 1000 );
+
+	SplitRangeRequest req( KeyRangeRef(LiteralStringRef("A"), LiteralStringRef("Z")), 2000 );
+	Future<SplitRangeReply> reply = req.reply.getFuture();
+	metrics.getSplitPoints( req );
+	ASSERT( reply.isReady() && reply.get().splitPoints.size() == 3 );
+	for(int i = 1; i < 3; i++)
+		ASSERT( reply.get().splitPoints[i-1] < reply.get().splitPoints[i] );
+	for(auto s : reply.get().splitPoints)
+		ASSERT( s > LiteralStringRef("A") && s < LiteralStringRef("Z") );
+
+	SplitRangeRequest small( KeyRangeRef(LiteralStringRef("A"), LiteralStringRef("Z")), 10000 );
+	reply = small.reply.getFuture();
+	metrics.getSplitPoints( small );
+	ASSERT( reply.isReady() && reply.get().splitPoints.size() == 0 );
+
+	return Void();
+}
+
 //Contains information about whether or not a key-value pair should be included in a byte sample
 //Also contains size information about the byte sample
 struct ByteSampleInfo {
@@ -35,6 +35,7 @@ struct TLogInterface {
 	UID sharedTLogID;
 	RequestStream< struct TLogPeekRequest > peekMessages;
 	RequestStream< struct TLogPopRequest > popMessages;
+	RequestStream< struct TLogPopBatchRequest > popBatch;
 
 	RequestStream< struct TLogCommitRequest > commit;
 	RequestStream< ReplyPromise< struct TLogLockResult > > lock; // first stage of database recovery
@@ -55,6 +56,7 @@ struct TLogInterface {
 	void initEndpoints() {
 		getQueuingMetrics.getEndpoint( TaskTLogQueuingMetrics );
 		popMessages.getEndpoint( TaskTLogPop );
+		popBatch.getEndpoint( TaskTLogPop );
 		peekMessages.getEndpoint( TaskTLogPeek );
 		confirmRunning.getEndpoint( TaskTLogConfirmRunning );
 		commit.getEndpoint( TaskTLogCommit );
@@ -64,7 +66,7 @@ struct TLogInterface {
 	void serialize( Ar& ar ) {
 		ASSERT(ar.isDeserializing || uniqueID != UID());
 		ar & uniqueID & sharedTLogID & locality & peekMessages & popMessages
-		   & commit & lock & getQueuingMetrics & confirmRunning & waitFailure & recoveryFinished;
+		   & commit & lock & getQueuingMetrics & confirmRunning & waitFailure & recoveryFinished & popBatch;
 	}
 };
 
@@ -179,6 +181,19 @@ struct TLogPopRequest {
 	}
 };
 
+// The pops of several tags, each handled as a TLogPopRequest would be
+struct TLogPopBatchRequest {
+	std::vector<std::pair<Tag, Version>> pops;
+	ReplyPromise<Void> reply;
+
+	TLogPopBatchRequest() {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		ar & pops & reply;
+	}
+};
+
 struct TagMessagesRef {
 	Tag tag;
 	VectorRef<int> messageOffsets;
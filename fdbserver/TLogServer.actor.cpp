@@ -115,17 +115,20 @@ public:
 		return readNext( this );
 	}
 
+	// Returns the locations of the beginning of the packet's payload and of the end of the packet, which can later be passed to readEntry()
 	template <class T>
-	void push( T const& qe ) {
+	std::pair<IDiskQueue::location, IDiskQueue::location> push( T const& qe ) {
 		BinaryWriter wr( Unversioned() );  // outer framing is not versioned
 		wr << uint32_t(0);
 		IncludeVersion().write(wr);  // payload is versioned
 		wr << qe;
 		wr << uint8_t(1);
 		*(uint32_t*)wr.getData() = wr.getLength() - sizeof(uint32_t) - sizeof(uint8_t);
-		auto loc = queue->push( wr.toStringRef() );
+		auto payloadLoc = queue->push( wr.toStringRef().substr(0, sizeof(uint32_t)) );
+		auto loc = queue->push( wr.toStringRef().substr(sizeof(uint32_t)) );
 		//TraceEvent("TLogQueueVersionWritten", dbgid).detail("Size", wr.getLength() - sizeof(uint32_t) - sizeof(uint8_t)).detail("Loc", loc);
 		version_location[qe.version] = loc;
+		return std::make_pair(payloadLoc, loc);
 	}
 	void pop( Version upTo ) {
 		// Keep only the given and all subsequent version numbers
@@ -145,6 +148,14 @@ public:
 	}
 	Future<Void> commit() { return queue->commit(); }
 
+	// The locations, as returned by push(), of the entry most recently returned by readNext()
+	std::pair<IDiskQueue::location, IDiskQueue::location> getLastReadLocation() const { return lastReadLocation; }
+
+	// Reads back a committed and unpopped entry from the queue file
+	Future<TLogQueueEntry> readEntry( std::pair<IDiskQueue::location, IDiskQueue::location> loc ) {
+		return readEntry( this, loc );
+	}
+
 	// Implements IClosable
 	virtual Future<Void> getError() { return queue->getError(); }
 	virtual Future<Void> onClosed() { return queue->onClosed(); }
@@ -154,8 +165,22 @@ public:
 private:
 	IDiskQueue* queue;
 	Map<Version, IDiskQueue::location> version_location;  // For the version of each entry that was push()ed, the end location of the serialized bytes
+	std::pair<IDiskQueue::location, IDiskQueue::location> lastReadLocation;
 	UID dbgid;
 
+	ACTOR static Future<TLogQueueEntry> readEntry( TLogQueue* self, std::pair<IDiskQueue::location, IDiskQueue::location> loc ) {
+		state TLogQueueEntry result;
+		Standalone<StringRef> e = wait( self->queue->read( loc.first, loc.second ) );
+		if (!e.size() || !e.end()[-1]) {
+			TraceEvent(SevError, "TLogQueueReadEntryInvalid", self->dbgid).detail("From", loc.first.lo).detail("To", loc.second.lo).detail("Size", e.size());
+			throw io_error();
+		}
+		Arena a = e.arena();
+		ArenaReader ar( a, e.substr(0, e.size()-1), IncludeVersion() );
+		ar >> result;
+		return result;
+	}
+
 	ACTOR static Future<TLogQueueEntry> readNext( TLogQueue* self ) {
 		state TLogQueueEntry result;
 		state int zeroFillSize = 0;
@@ -174,6 +199,7 @@ private:
 			}
 
 			state uint32_t payloadSize = *(uint32_t*)h.begin();
+			state IDiskQueue::location payloadLocation = self->queue->getNextReadLocation();
 			ASSERT( payloadSize < (100<<20) );
 
 			Standalone<StringRef> e = wait( self->queue->readNext( payloadSize+1 ) );
@@ -188,6 +214,7 @@ private:
 				ArenaReader ar( a, e.substr(0, payloadSize), IncludeVersion() );
 				ar >> result;
 				self->version_location[result.version] = self->queue->getNextReadLocation();
+				self->lastReadLocation = std::make_pair( payloadLocation, self->queue->getNextReadLocation() );
 				return result;
 			}
 		}
@@ -204,13 +231,15 @@ private:
 
 // Immutable keys
 static const KeyValueRef persistFormat( LiteralStringRef( "Format" ), LiteralStringRef("FoundationDB/LogServer/2/4") );
-static const KeyRangeRef persistFormatReadableRange( LiteralStringRef("FoundationDB/LogServer/2/3"), LiteralStringRef("FoundationDB/LogServer/2/5") );
+static const KeyValueRef persistFormatSpillReference( LiteralStringRef( "Format" ), LiteralStringRef("FoundationDB/LogServer/2/5") );  // Spilled versions are stored in persistTagMessageRefsKeys
+static const KeyRangeRef persistFormatReadableRange( LiteralStringRef("FoundationDB/LogServer/2/3"), LiteralStringRef("FoundationDB/LogServer/2/6") );
 static const KeyRangeRef persistRecoveryCountKeys = KeyRangeRef( LiteralStringRef( "DbRecoveryCount/" ), LiteralStringRef( "DbRecoveryCount0" ) );
 
 // Updated on updatePersistentData()
 static const KeyRangeRef persistCurrentVersionKeys = KeyRangeRef( LiteralStringRef( "version/" ), LiteralStringRef( "version0" ) );
 static const KeyRangeRef persistUnrecoveredBeforeVersionKeys = KeyRangeRef( LiteralStringRef( "UnrecoveredBefore/" ), LiteralStringRef( "UnrecoveredBefore0" ) );
 static const KeyRange persistTagMessagesKeys = prefixRange(LiteralStringRef("TagMsg/"));
+static const KeyRange persistTagMessageRefsKeys = prefixRange(LiteralStringRef("TagMsgRef/"));
 static const KeyRange persistTagPoppedKeys = prefixRange(LiteralStringRef("TagPop/"));
 
 static Key persistTagMessagesKey( UID id, Tag tag, Version version ) {
@@ -222,6 +251,21 @@ static Key persistTagMessagesKey( UID id, Tag tag, Version version ) {
 	return wr.toStringRef();
 }
 
+static Key persistTagMessageRefsKey( UID id, Tag tag, Version version ) {
+	BinaryWriter wr( Unversioned() );
+	wr.serializeBytes(persistTagMessageRefsKeys.begin);
+	wr << id;
+	wr << tag;
+	wr << bigEndian64( version );
+	return wr.toStringRef();
+}
+
+static Value persistTagMessageRefsValue( std::pair<IDiskQueue::location, IDiskQueue::location> loc ) {
+	BinaryWriter wr( Unversioned() );
+	wr << loc.first.hi << loc.first.lo << loc.second.hi << loc.second.lo;
+	return wr.toStringRef();
+}
+
 static Key persistTagPoppedKey( UID id, Tag tag ) {
 	BinaryWriter wr(Unversioned());
 	wr.serializeBytes( persistTagPoppedKeys.begin );
@@ -253,6 +297,17 @@ static Version decodeTagMessagesKey( StringRef key ) {
 	return bigEndian64( BinaryReader::fromStringRef<Version>( stripTagMessagesKey(key), Unversioned() ) );
 }
 
+static Version decodeTagMessageRefsKey( StringRef key ) {
+	return bigEndian64( BinaryReader::fromStringRef<Version>( key.substr( sizeof(UID) + sizeof(Tag) + persistTagMessageRefsKeys.begin.size() ), Unversioned() ) );
+}
+
+static std::pair<IDiskQueue::location, IDiskQueue::location> decodeTagMessageRefsValue( ValueRef value ) {
+	std::pair<IDiskQueue::location, IDiskQueue::location> loc;
+	BinaryReader rd( value, Unversioned() );
+	rd >> loc.first.hi >> loc.first.lo >> loc.second.hi >> loc.second.lo;
+	return loc;
+}
+
 struct TLogData : NonCopyable {
 	AsyncTrigger newLogData;
 	Deque<UID> queueOrder;
@@ -284,6 +339,19 @@ struct TLogData : NonCopyable {
 	};
 
 	std::map<UID, peekTrackerData> peekTracker;
+
+	// Serialized peek replies, shared by concurrent peeks of the same tag from the same version
+	struct PeekCacheEntry {
+		Standalone<StringRef> messages;
+		Version end;
+		Version atVersion;  // logData->version when the reply was built.  Unless the reply was limited (end <= atVersion), it is only reused at that version.
+		double lastUsed;
+	};
+
+	std::map<std::pair<UID, std::pair<Tag, Version>>, PeekCacheEntry> peekCache;  // Keyed by (logId, (tag, begin))
+	int64_t peekCacheBytes;
+	int64_t peekCacheHits;
+	int64_t peekCacheMisses;
 	WorkerCache<TLogInterface> tlogCache;
 
 	Future<Void> updatePersist; //SOMEDAY: integrate the recovery and update storage so that only one of them is committing to persistant data.
@@ -291,12 +359,17 @@ struct TLogData : NonCopyable {
 	PromiseStream<Future<Void>> sharedActors;
 	bool terminated;
 
+	// If true, updatePersistentData() records spilled versions by their location in persistentQueue instead of copying their messages
+	// into persistentData, so the queue may only be popped past versions which every tag has popped.  Fixed by the format of persistentData.
+	bool spillByReference;
+
 	TLogData(UID dbgid, IKeyValueStore* persistentData, IDiskQueue * persistentQueue, Reference<AsyncVar<ServerDBInfo>> const& dbInfo)
 			: dbgid(dbgid), instanceID(g_random->randomUniqueID().first()),
 			  persistentData(persistentData), rawPersistentQueue(persistentQueue), persistentQueue(new TLogQueue(persistentQueue, dbgid)),
 			  dbInfo(dbInfo), queueCommitBegin(0), queueCommitEnd(0), prevVersion(0),
 			  diskQueueCommitBytes(0), largeDiskQueueCommitBytes(false),
-			  bytesInput(0), bytesDurable(0), updatePersist(Void()), terminated(false)
+			  bytesInput(0), bytesDurable(0), updatePersist(Void()), terminated(false), spillByReference(SERVER_KNOBS->TLOG_SPILL_REFERENCE != 0),
+			  peekCacheBytes(0), peekCacheHits(0), peekCacheMisses(0)
 		{
 		}
 };
@@ -325,21 +398,23 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		// Erase messages not needed to update *from* versions >= before (thus, messages with toversion <= before)
 		ACTOR Future<Void> eraseMessagesBefore( TagData *self, Version before, int64_t* gBytesErased, Reference<LogData> tlogData, int taskID ) {
 			while(!self->version_messages.empty() && self->version_messages.front().first < before) {
+				// Erase all of one version's entries with a single range erase, which releases whole deque blocks at once, and only
+				// touch version_sizes (a map lookup) once per version, and not at all for tags which are not counted in it.
 				Version version = self->version_messages.front().first;
-				std::pair<int, int> &sizes = tlogData->version_sizes[version];
-				int64_t messagesErased = 0;
-
-				while(!self->version_messages.empty() && self->version_messages.front().first == version) {
-					auto const& m = self->version_messages.front();
-					++messagesErased;
-
-					if(self->update_version_sizes) {
-						sizes.first -= m.second.expectedSize();
-					}
+				auto versionEnd = self->version_messages.begin();
+				int versionBytes = 0;
+				while(versionEnd != self->version_messages.end() && versionEnd->first == version) {
+					versionBytes += versionEnd->second.expectedSize();
+					++versionEnd;
+				}
+				int64_t messagesErased = versionEnd - self->version_messages.begin();
 
-					self->version_messages.pop_front();
+				if(self->update_version_sizes) {
+					tlogData->version_sizes[version].first -= versionBytes;
 				}
 
+				self->version_messages.erase(self->version_messages.begin(), versionEnd);
+
 				int64_t bytesErased = messagesErased * SERVER_KNOBS->VERSION_MESSAGES_ENTRY_BYTES_WITH_OVERHEAD;
 				tlogData->bytesDurable += bytesErased;
 				*gBytesErased += bytesErased;
@@ -401,10 +476,12 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 	}
 
 	Map<Version, std::pair<int,int>> version_sizes;
+	Map<Version, std::pair<IDiskQueue::location, IDiskQueue::location>> version_location;  // For versions not yet in persistentData, the location of their entry in persistentQueue (only tracked when spilling by reference)
 
 	CounterCollection cc;
 	Counter bytesInput;
 	Counter bytesDurable;
+	LatencySample commitLatency;  // From receiving a commit until it is durable and acknowledged
 
 	UID logId;
 	Version newPersistentDataVersion;
@@ -418,7 +495,7 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 	Optional<Tag> remoteTag;
 
 	explicit LogData(TLogData* tLogData, TLogInterface interf, Optional<Tag> remoteTag) : tLogData(tLogData), knownCommittedVersion(0), logId(interf.id()),
-			cc("TLog", interf.id().toString()), bytesInput("bytesInput", cc), bytesDurable("bytesDurable", cc), remoteTag(remoteTag), logSystem(new AsyncVar<Reference<ILogSystem>>()),
+			cc("TLog", interf.id().toString()), bytesInput("bytesInput", cc), bytesDurable("bytesDurable", cc), commitLatency("commitLatency", cc), remoteTag(remoteTag), logSystem(new AsyncVar<Reference<ILogSystem>>()),
 			// These are initialized differently on init() or recovery
 			recoveryCount(), stopped(false), initialized(false), queueCommittingVersion(0), newPersistentDataVersion(invalidVersion), unrecoveredBefore(0)
 	{
@@ -432,6 +509,9 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		specialCounter(cc, "version", [this](){ return this->version.get(); });
 		specialCounter(cc, "sharedBytesInput", [tLogData](){ return tLogData->bytesInput; });
 		specialCounter(cc, "sharedBytesDurable", [tLogData](){ return tLogData->bytesDurable; });
+		specialCounter(cc, "peekCacheHits", [tLogData](){ return tLogData->peekCacheHits; });
+		specialCounter(cc, "peekCacheMisses", [tLogData](){ return tLogData->peekCacheMisses; });
+		specialCounter(cc, "peekCacheBytes", [tLogData](){ return tLogData->peekCacheBytes; });
 		specialCounter(cc, "kvstoreBytesUsed", [tLogData](){ return tLogData->persistentData->getStorageBytes().used; });
 		specialCounter(cc, "kvstoreBytesFree", [tLogData](){ return tLogData->persistentData->getStorageBytes().free; });
 		specialCounter(cc, "kvstoreBytesAvailable", [tLogData](){ return tLogData->persistentData->getStorageBytes().available; });
@@ -456,6 +536,8 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 			tLogData->persistentData->clear( singleKeyRange(logIdKey.withPrefix(persistRecoveryCountKeys.begin)) );
 			Key msgKey = logIdKey.withPrefix(persistTagMessagesKeys.begin);
 			tLogData->persistentData->clear( KeyRangeRef( msgKey, strinc(msgKey) ) );
+			Key msgRefKey = logIdKey.withPrefix(persistTagMessageRefsKeys.begin);
+			tLogData->persistentData->clear( KeyRangeRef( msgRefKey, strinc(msgRefKey) ) );
 			Key poppedKey = logIdKey.withPrefix(persistTagPoppedKeys.begin);
 			tLogData->persistentData->clear( KeyRangeRef( poppedKey, strinc(poppedKey) ) );
 		}
@@ -511,6 +593,11 @@ void updatePersistentPopped( TLogData* self, Reference<LogData> logData, Referen
 	self->persistentData->clear( KeyRangeRef(
 		persistTagMessagesKey( logData->logId, data->tag, Version(0) ),
 		persistTagMessagesKey( logData->logId, data->tag, data->popped ) ) );
+	if (self->spillByReference) {
+		self->persistentData->clear( KeyRangeRef(
+			persistTagMessageRefsKey( logData->logId, data->tag, Version(0) ),
+			persistTagMessageRefsKey( logData->logId, data->tag, data->popped ) ) );
+	}
 	if (data->popped > logData->persistentDataVersion)
 		data->nothing_persistent = true;
 }
@@ -543,12 +630,23 @@ ACTOR Future<Void> updatePersistentData( TLogData* self, Reference<LogData> logD
 					currentVersion = msg->first;
 					anyData = true;
 					tagData->nothing_persistent = false;
-					BinaryWriter wr( Unversioned() );
 
-					for(; msg != tagData->version_messages.end() && msg->first == currentVersion; ++msg)
-						wr << msg->second.toStringRef();
+					if (self->spillByReference) {
+						// The messages stay in persistentQueue, and peeks read them back from there
+						auto loc = logData->version_location.find( currentVersion );
+						ASSERT( loc != logData->version_location.end() );
+						self->persistentData->set( KeyValueRef( persistTagMessageRefsKey( logData->logId, tagData->tag, currentVersion ), persistTagMessageRefsValue( loc->value ) ) );
 
-					self->persistentData->set( KeyValueRef( persistTagMessagesKey( logData->logId, tagData->tag, currentVersion ), wr.toStringRef() ) );
+						while(msg != tagData->version_messages.end() && msg->first == currentVersion)
+							++msg;
+					} else {
+						BinaryWriter wr( Unversioned() );
+
+						for(; msg != tagData->version_messages.end() && msg->first == currentVersion; ++msg)
+							wr << msg->second.toStringRef();
+
+						self->persistentData->set( KeyValueRef( persistTagMessagesKey( logData->logId, tagData->tag, currentVersion ), wr.toStringRef() ) );
+					}
 
 					Future<Void> f = yield(TaskUpdateStorage);
 					if(!f.isReady()) {
@@ -583,6 +681,7 @@ ACTOR Future<Void> updatePersistentData( TLogData* self, Reference<LogData> logD
 	}
 
 	logData->version_sizes.erase(logData->version_sizes.begin(), logData->version_sizes.lower_bound(logData->persistentDataDurableVersion));
+	logData->version_location.erase(logData->version_location.begin(), logData->version_location.lower_bound(logData->persistentDataDurableVersion+1));
 
 	Void _ = wait(yield(TaskUpdateStorage));
 
@@ -601,8 +700,23 @@ ACTOR Future<Void> updatePersistentData( TLogData* self, Reference<LogData> logD
 	ASSERT(logData->bytesDurable.getValue() <= logData->bytesInput.getValue());
 	ASSERT(self->bytesDurable <= self->bytesInput);
 
-	if( self->queueCommitEnd.get() > 0 )
-		self->persistentQueue->pop( newPersistentDataVersion+1 ); // SOMEDAY: this can cause a slow task (~0.5ms), presumably from erasing too many versions. Should we limit the number of versions cleared at a time?
+	if( self->queueCommitEnd.get() > 0 ) {
+		Version popTo = newPersistentDataVersion+1;
+		if (self->spillByReference) {
+			// Entries referenced from persistentData must stay in the queue until every tag which might still peek them has popped them
+			for(auto& it : self->id_data) {
+				for(auto& tags : it.second->tag_data) {
+					for(auto& t : tags) {
+						if(t && !t->nothing_persistent) {
+							popTo = std::min(popTo, t->popped);
+						}
+					}
+				}
+			}
+			TEST( popTo <= newPersistentDataVersion );  // TLog queue pop held back by spilled references
+		}
+		self->persistentQueue->pop( popTo ); // SOMEDAY: this can cause a slow task (~0.5ms), presumably from erasing too many versions. Should we limit the number of versions cleared at a time?
+	}
 
 	return Void();
 }
@@ -858,18 +972,32 @@ std::deque<std::pair<Version, LengthPrefixedStringRef>> & get_version_messages(
 	return tagData->version_messages;
 };
 
-ACTOR Future<Void> tLogPop( TLogData* self, TLogPopRequest req, Reference<LogData> logData ) {
-	auto tagData = logData->getTagData(req.tag);
+ACTOR Future<Void> tLogPopTag( TLogData* self, Tag tag, Version to, Reference<LogData> logData ) {
+	auto tagData = logData->getTagData(tag);
 	if (!tagData) {
-		tagData = logData->createTagData(req.tag, req.to, true, true);
-	} else if (req.to > tagData->popped) {
-		tagData->popped = req.to;
+		tagData = logData->createTagData(tag, to, true, true);
+	} else if (to > tagData->popped) {
+		tagData->popped = to;
 		tagData->popped_recently = true;
-		if ( req.to > logData->persistentDataDurableVersion )
-			Void _ = wait(tagData->eraseMessagesBefore( req.to, &self->bytesDurable, logData, TaskTLogPop ));
-		//TraceEvent("TLogPop", self->dbgid).detail("Tag", req.tag).detail("To", req.to);
+		if ( to > logData->persistentDataDurableVersion )
+			Void _ = wait(tagData->eraseMessagesBefore( to, &self->bytesDurable, logData, TaskTLogPop ));
+		//TraceEvent("TLogPop", self->dbgid).detail("Tag", tag).detail("To", to);
 	}
+	return Void();
+}
 
+ACTOR Future<Void> tLogPop( TLogData* self, TLogPopRequest req, Reference<LogData> logData ) {
+	Void _ = wait( tLogPopTag( self, req.tag, req.to, logData ) );
+	req.reply.send(Void());
+	return Void();
+}
+
+// The tags are popped one after another by a single actor, rather than by one tLogPop per tag
+ACTOR Future<Void> tLogPopBatch( TLogData* self, TLogPopBatchRequest req, Reference<LogData> logData ) {
+	state int i = 0;
+	for(; i < req.pops.size(); i++) {
+		Void _ = wait( tLogPopTag( self, req.pops[i].first, req.pops[i].second, logData ) );
+	}
 	req.reply.send(Void());
 	return Void();
 }
@@ -900,6 +1028,63 @@ void peekMessagesFromMemory( Reference<LogData> self, TLogPeekRequest const& req
 	}
 }
 
+// Appends the messages for tag in versions [begin, end) which were spilled by reference, reading their entries back from persistentQueue.
+// Returns the version to end the reply at if the reply is full.
+ACTOR Future<Optional<Version>> peekMessagesFromQueue( TLogData* self, Reference<LogData> logData, Tag tag, Version begin, Version end, BinaryWriter* messages ) {
+	state Standalone<VectorRef<KeyValueRef>> refs = wait(
+		self->persistentData->readRange(KeyRangeRef(
+			persistTagMessageRefsKey(logData->logId, tag, begin),
+			persistTagMessageRefsKey(logData->logId, tag, end)), SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_PEEK_VERSIONS));
+
+	// Entries before the tag's popped version may be popped from the queue once that pop is persisted, so they must not be read
+	state Version popped = poppedVersion(logData, tag);
+	state std::vector<Future<TLogQueueEntry>> entries;
+	for (auto &kv : refs) {
+		if (decodeTagMessageRefsKey(kv.key) >= popped)
+			entries.push_back( self->persistentQueue->readEntry( decodeTagMessageRefsValue(kv.value) ) );
+		else
+			entries.push_back( TLogQueueEntry() );
+	}
+	Void _ = wait( waitForAll(entries) );
+
+	for (int i = 0; i < refs.size(); i++) {
+		Version ver = decodeTagMessageRefsKey(refs[i].key);
+		if (ver < popped)
+			continue;
+		if (messages->getLength() >= SERVER_KNOBS->DESIRED_TOTAL_BYTES)
+			return ver;
+
+		TLogQueueEntry const& qe = entries[i].get();
+		ASSERT( qe.version == ver && qe.id == logData->logId );
+		*messages << int32_t(-1) << ver;
+
+		// Each message is prefixed by its length, subsequence and tags, just as in commitMessages()
+		ArenaReader rd( qe.arena(), qe.messages, Unversioned() );
+		int32_t messageLength;
+		uint32_t sub;
+		uint16_t tagCount;
+		while(!rd.empty()) {
+			rd.checkpoint();
+			rd >> messageLength >> sub >> tagCount;
+			bool found = false;
+			for(int t = 0; t < tagCount; t++) {
+				Tag messageTag;
+				rd >> messageTag;
+				found = found || messageTag == tag;
+			}
+			rd.rewind();
+			const void* rawMessage = rd.readBytes(messageLength + sizeof(messageLength));
+			if (found)
+				messages->serializeBytes(rawMessage, messageLength + sizeof(messageLength));
+		}
+	}
+
+	TEST( refs.size() == SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_PEEK_VERSIONS ); // TLog peek limited by the number of spilled references
+	if (refs.size() == SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_PEEK_VERSIONS)
+		return decodeTagMessageRefsKey(refs.end()[-1].key) + 1;
+	return Optional<Version>();
+}
+
 ACTOR Future<Void> tLogPeekMessages( TLogData* self, TLogPeekRequest req, Reference<LogData> logData ) {
 	state BinaryWriter messages(Unversioned());
 	state BinaryWriter messages2(Unversioned());
@@ -983,42 +1168,82 @@ ACTOR Future<Void> tLogPeekMessages( TLogData* self, TLogPeekRequest req, Refere
 	}
 
 	state Version endVersion = logData->version.get() + 1;
+	state Version refsBegin = invalidVersion;
+	state Version refsEnd = invalidVersion;
+	state Standalone<StringRef> replyMessages;
+	state std::pair<UID, std::pair<Tag, Version>> cacheKey = std::make_pair(logData->logId, std::make_pair(req.tag, req.begin));
+
+	auto cached = self->peekCache.find(cacheKey);
+	if( cached != self->peekCache.end() && (cached->second.end <= cached->second.atVersion || cached->second.atVersion == logData->version.get()) ) {
+		// Messages at or below the version the reply was built at cannot change, so the reply is shared rather than serialized again
+		TEST(true); // TLog peek reply served from cache
+		++self->peekCacheHits;
+		cached->second.lastUsed = now();
+		replyMessages = cached->second.messages;
+		endVersion = cached->second.end;
+	} else {
+		++self->peekCacheMisses;
+		state Version builtAtVersion = logData->version.get();
+
+		//grab messages from disk
+		//TraceEvent("tLogPeekMessages", self->dbgid).detail("reqBeginEpoch", req.begin.epoch).detail("reqBeginSeq", req.begin.sequence).detail("epoch", self->epoch()).detail("persistentDataSeq", self->persistentDataSequence).detail("Tag1", printable(req.tag1)).detail("Tag2", printable(req.tag2));
+		if( req.begin <= logData->persistentDataDurableVersion ) {
+			// Just in case the durable version changes while we are waiting for the read, we grab this data from memory.  We may or may not actually send it depending on
+			// whether we get enough data from disk.
+			// SOMEDAY: Only do this if an initial attempt to read from disk results in insufficient data and the required data is no longer in memory
+			// SOMEDAY: Should we only send part of the messages we collected, to actually limit the size of the result?
+
+			peekMessagesFromMemory( logData, req, messages2, endVersion );
+			refsEnd = logData->persistentDataDurableVersion + 1;
+
+			Standalone<VectorRef<KeyValueRef>> kvs = wait(
+				self->persistentData->readRange(KeyRangeRef(
+					persistTagMessagesKey(logData->logId, req.tag, req.begin),
+					persistTagMessagesKey(logData->logId, req.tag, logData->persistentDataDurableVersion + 1)), SERVER_KNOBS->DESIRED_TOTAL_BYTES, SERVER_KNOBS->DESIRED_TOTAL_BYTES));
+
+			//TraceEvent("TLogPeekResults", self->dbgid).detail("ForAddress", req.reply.getEndpoint().address).detail("Tag1Results", s1).detail("Tag2Results", s2).detail("Tag1ResultsLim", kv1.size()).detail("Tag2ResultsLim", kv2.size()).detail("Tag1ResultsLast", kv1.size() ? printable(kv1[0].key) : "").detail("Tag2ResultsLast", kv2.size() ? printable(kv2[0].key) : "").detail("Limited", limited).detail("NextEpoch", next_pos.epoch).detail("NextSeq", next_pos.sequence).detail("NowEpoch", self->epoch()).detail("NowSeq", self->sequence.getNextSequence());
+
+			for (auto &kv : kvs) {
+				auto ver = decodeTagMessagesKey(kv.key);
+				messages << int32_t(-1) << ver;
+				messages.serializeBytes(kv.value);
+			}
 
-	//grab messages from disk
-	//TraceEvent("tLogPeekMessages", self->dbgid).detail("reqBeginEpoch", req.begin.epoch).detail("reqBeginSeq", req.begin.sequence).detail("epoch", self->epoch()).detail("persistentDataSeq", self->persistentDataSequence).detail("Tag1", printable(req.tag1)).detail("Tag2", printable(req.tag2));
-	if( req.begin <= logData->persistentDataDurableVersion ) {
-		// Just in case the durable version changes while we are waiting for the read, we grab this data from memory.  We may or may not actually send it depending on
-		// whether we get enough data from disk.
-		// SOMEDAY: Only do this if an initial attempt to read from disk results in insufficient data and the required data is no longer in memory
-		// SOMEDAY: Should we only send part of the messages we collected, to actually limit the size of the result?
-
-		peekMessagesFromMemory( logData, req, messages2, endVersion );
-
-		Standalone<VectorRef<KeyValueRef>> kvs = wait(
-			self->persistentData->readRange(KeyRangeRef(
-				persistTagMessagesKey(logData->logId, req.tag, req.begin),
-				persistTagMessagesKey(logData->logId, req.tag, logData->persistentDataDurableVersion + 1)), SERVER_KNOBS->DESIRED_TOTAL_BYTES, SERVER_KNOBS->DESIRED_TOTAL_BYTES));
-
-		//TraceEvent("TLogPeekResults", self->dbgid).detail("ForAddress", req.reply.getEndpoint().address).detail("Tag1Results", s1).detail("Tag2Results", s2).detail("Tag1ResultsLim", kv1.size()).detail("Tag2ResultsLim", kv2.size()).detail("Tag1ResultsLast", kv1.size() ? printable(kv1[0].key) : "").detail("Tag2ResultsLast", kv2.size() ? printable(kv2[0].key) : "").detail("Limited", limited).detail("NextEpoch", next_pos.epoch).detail("NextSeq", next_pos.sequence).detail("NowEpoch", self->epoch()).detail("NowSeq", self->sequence.getNextSequence());
-
-		for (auto &kv : kvs) {
-			auto ver = decodeTagMessagesKey(kv.key);
-			messages << int32_t(-1) << ver;
-			messages.serializeBytes(kv.value);
+			if (kvs.expectedSize() >= SERVER_KNOBS->DESIRED_TOTAL_BYTES)
+				endVersion = decodeTagMessagesKey(kvs.end()[-1].key) + 1;
+			else if (self->spillByReference)
+				refsBegin = kvs.size() ? decodeTagMessagesKey(kvs.end()[-1].key) + 1 : req.begin;
+			else
+				messages.serializeBytes( messages2.toStringRef() );
+
+			if (refsBegin != invalidVersion) {
+				// Versions recovered from a previous generation are stored by value, and precede all versions spilled by reference
+				Optional<Version> fullAt = wait( peekMessagesFromQueue( self, logData, req.tag, refsBegin, refsEnd, &messages ) );
+				if (fullAt.present())
+					endVersion = fullAt.get();
+				else
+					messages.serializeBytes( messages2.toStringRef() );
+			}
+		} else {
+			peekMessagesFromMemory( logData, req, messages, endVersion );
+			//TraceEvent("TLogPeekResults", self->dbgid).detail("ForAddress", req.reply.getEndpoint().address).detail("MessageBytes", messages.getLength()).detail("NextEpoch", next_pos.epoch).detail("NextSeq", next_pos.sequence).detail("NowSeq", self->sequence.getNextSequence());
 		}
 
-		if (kvs.expectedSize() >= SERVER_KNOBS->DESIRED_TOTAL_BYTES)
-			endVersion = decodeTagMessagesKey(kvs.end()[-1].key) + 1;
-		else
-			messages.serializeBytes( messages2.toStringRef() );
-	} else {
-		peekMessagesFromMemory( logData, req, messages, endVersion );
-		//TraceEvent("TLogPeekResults", self->dbgid).detail("ForAddress", req.reply.getEndpoint().address).detail("MessageBytes", messages.getLength()).detail("NextEpoch", next_pos.epoch).detail("NextSeq", next_pos.sequence).detail("NowSeq", self->sequence.getNextSequence());
+		replyMessages = Standalone<StringRef>( messages.toStringRef() );
+		if( self->peekCacheBytes + replyMessages.size() <= SERVER_KNOBS->TLOG_PEEK_CACHE_BYTES ) {
+			TLogData::PeekCacheEntry& entry = self->peekCache[cacheKey];
+			self->peekCacheBytes += replyMessages.size() - entry.messages.size();
+			entry.messages = replyMessages;
+			entry.end = endVersion;
+			entry.atVersion = builtAtVersion;
+			entry.lastUsed = now();
+		}
 	}
 
 	TLogPeekReply reply;
 	reply.maxKnownVersion = logData->version.get();
-	reply.messages = messages.toStringRef();
+	reply.arena = replyMessages.arena();
+	reply.messages = replyMessages;
 	reply.end = endVersion;
 
 	//TraceEvent("TlogPeek", self->dbgid).detail("logId", logData->logId).detail("endVer", reply.end).detail("msgBytes", reply.messages.expectedSize()).detail("ForAddress", req.reply.getEndpoint().address);
@@ -1117,6 +1342,7 @@ ACTOR Future<Void> tLogCommit(
 		TLogCommitRequest req,
 		Reference<LogData> logData,
 		PromiseStream<Void> warningCollectorInput ) {
+	state double startTime = now();
 	state Optional<UID> tlogDebugID;
 	if(req.debugID.present())
 	{
@@ -1152,7 +1378,8 @@ ACTOR Future<Void> tLogCommit(
 		qe.knownCommittedVersion = req.knownCommittedVersion;
 		qe.messages = req.messages;
 		qe.id = logData->logId;
-		self->persistentQueue->push( qe );
+		auto loc = self->persistentQueue->push( qe );
+		if (self->spillByReference) logData->version_location[qe.version] = loc;
 
 		self->diskQueueCommitBytes += qe.expectedSize();
 		if( self->diskQueueCommitBytes > SERVER_KNOBS->MAX_QUEUE_COMMIT_BYTES ) {
@@ -1180,13 +1407,14 @@ ACTOR Future<Void> tLogCommit(
 		g_traceBatch.addEvent("CommitDebug", tlogDebugID.get().first(), "TLog.tLogCommit.After");
 
 	req.reply.send( Void() );
+	logData->commitLatency.addMeasurement( now() - startTime );
 	return Void();
 }
 
 ACTOR Future<Void> initPersistentState( TLogData* self, Reference<LogData> logData, Version unrecoveredBefore ) {
 	// PERSIST: Initial setup of persistentData for a brand new tLog for a new database
 	IKeyValueStore *storage = self->persistentData;
-	storage->set( persistFormat );
+	storage->set( self->spillByReference ? persistFormatSpillReference : persistFormat );
 	storage->set( KeyValueRef( BinaryWriter::toValue(logData->logId,Unversioned()).withPrefix(persistCurrentVersionKeys.begin), BinaryWriter::toValue(logData->version.get(), Unversioned()) ) );
 	storage->set( KeyValueRef( BinaryWriter::toValue(logData->logId,Unversioned()).withPrefix(persistUnrecoveredBeforeVersionKeys.begin), BinaryWriter::toValue(unrecoveredBefore, Unversioned()) ) );
 	storage->set( KeyValueRef( BinaryWriter::toValue(logData->logId,Unversioned()).withPrefix(persistRecoveryCountKeys.begin), BinaryWriter::toValue(logData->recoveryCount, Unversioned()) ) );
@@ -1280,6 +1508,22 @@ ACTOR Future<Void> respondToRecovered( TLogInterface tli, Promise<Void> recovery
 	}
 }
 
+ACTOR Future<Void> cleanupPeekCache( TLogData* self ) {
+	loop {
+		auto it = self->peekCache.begin();
+		while(it != self->peekCache.end()) {
+			if(it->second.lastUsed + SERVER_KNOBS->TLOG_PEEK_CACHE_EXPIRATION_TIME <= now()) {
+				self->peekCacheBytes -= it->second.messages.size();
+				self->peekCache.erase(it++);
+			} else {
+				++it;
+			}
+		}
+
+		Void _ = wait( delay(SERVER_KNOBS->TLOG_PEEK_CACHE_EXPIRATION_TIME) );
+	}
+}
+
 ACTOR Future<Void> cleanupPeekTrackers( TLogData* self ) {
 	loop {
 		double minTimeUntilExpiration = SERVER_KNOBS->PEEK_TRACKER_EXPIRATION_TIME;
@@ -1316,6 +1560,7 @@ void getQueuingMetrics( TLogData* self, TLogQueuingMetricsRequest const& req ) {
 
 ACTOR Future<Void> serveTLogInterface( TLogData* self, TLogInterface tli, Reference<LogData> logData, PromiseStream<Void> warningCollectorInput ) {
 	state Future<Void> dbInfoChange = Void();
+	state IntrusiveActorCollection requests;
 
 	loop choose {
 		when( Void _ = wait( dbInfoChange ) ) {
@@ -1340,21 +1585,24 @@ ACTOR Future<Void> serveTLogInterface( TLogData* self, TLogInterface tli, Refere
 			}
 		}
 		when( TLogPeekRequest req = waitNext( tli.peekMessages.getFuture() ) ) {
-			logData->addActor.send( tLogPeekMessages( self, req, logData ) );
+			requests.add( tLogPeekMessages( self, req, logData ) );
 		}
 		when( TLogPopRequest req = waitNext( tli.popMessages.getFuture() ) ) {
-			logData->addActor.send( tLogPop( self, req, logData ) );
+			requests.add( tLogPop( self, req, logData ) );
+		}
+		when( TLogPopBatchRequest req = waitNext( tli.popBatch.getFuture() ) ) {
+			requests.add( tLogPopBatch( self, req, logData ) );
 		}
 		when( TLogCommitRequest req = waitNext( tli.commit.getFuture() ) ) {
 			ASSERT(!logData->remoteTag.present());
 			TEST(logData->stopped); // TLogCommitRequest while stopped
 			if (!logData->stopped)
-				logData->addActor.send( tLogCommit( self, req, logData, warningCollectorInput ) );
+				requests.add( tLogCommit( self, req, logData, warningCollectorInput ) );
 			else
 				req.reply.sendError( tlog_stopped() );
 		}
 		when( ReplyPromise< TLogLockResult > reply = waitNext( tli.lock.getFuture() ) ) {
-			logData->addActor.send( tLogLock(self, reply, logData) );
+			requests.add( tLogLock(self, reply, logData) );
 		}
 		when (TLogQueuingMetricsRequest req = waitNext(tli.getQueuingMetrics.getFuture())) {
 			getQueuingMetrics(self, req);
@@ -1370,6 +1618,7 @@ ACTOR Future<Void> serveTLogInterface( TLogData* self, TLogInterface tli, Refere
 			else
 				req.reply.sendError( tlog_stopped() );
 		}
+		when( Void _ = wait( requests.getResult() ) ) {}
 	}
 }
 
@@ -1406,7 +1655,7 @@ ACTOR Future<Void> pullAsyncData( TLogData* self, Reference<LogData> logData, Ta
 				when( Void _ = wait( dbInfoChange ) ) {
 					if(r) tagPopped = std::max(tagPopped, r->popped());
 					if( logData->logSystem->get() )
-						r = logData->logSystem->get()->peek( tagAt, tag );
+						r = logData->logSystem->get()->peek( tagAt, tag, true );
 					else
 						r = Reference<ILogSystem::IPeekCursor>();
 					dbInfoChange = logData->logSystem->onChange();
@@ -1433,7 +1682,8 @@ ACTOR Future<Void> pullAsyncData( TLogData* self, Reference<LogData> logData, Ta
 					qe.knownCommittedVersion = 0;
 					qe.alternativeMessages = &messages;
 					qe.id = logData->logId;
-					self->persistentQueue->push( qe );
+					auto loc = self->persistentQueue->push( qe );
+					if (self->spillByReference) logData->version_location[qe.version] = loc;
 
 					self->diskQueueCommitBytes += qe.expectedSize();
 					if( self->diskQueueCommitBytes > SERVER_KNOBS->MAX_QUEUE_COMMIT_BYTES ) {
@@ -1587,6 +1837,8 @@ ACTOR Future<Void> restorePersistentState( TLogData* self, LocalityData locality
 
 	state std::vector<Future<ErrorOr<Void>>> removed;
 
+	self->spillByReference = fFormat.get().get() == persistFormatSpillReference.value;
+
 	if(fFormat.get().get() == LiteralStringRef("FoundationDB/LogServer/2/3")) {
 		//FIXME: need for upgrades from 5.X to 6.0, remove once this upgrade path is no longer needed
 		if(recovered.canBeSet()) recovered.send(Void());
@@ -1620,6 +1872,7 @@ ACTOR Future<Void> restorePersistentState( TLogData* self, LocalityData locality
 
 		DUMPTOKEN( recruited.peekMessages );
 		DUMPTOKEN( recruited.popMessages );
+		DUMPTOKEN( recruited.popBatch );
 		DUMPTOKEN( recruited.commit );
 		DUMPTOKEN( recruited.lock );
 		DUMPTOKEN( recruited.getQueuingMetrics );
@@ -1696,6 +1949,7 @@ ACTOR Future<Void> restorePersistentState( TLogData* self, LocalityData locality
 					if(logData) {
 						logData->knownCommittedVersion = std::max(logData->knownCommittedVersion, qe.knownCommittedVersion);
 						if( qe.version > logData->version.get() ) {
+							if (self->spillByReference) logData->version_location[qe.version] = self->persistentQueue->getLastReadLocation();
 							commitMessages(logData, qe.version, qe.arena(), qe.messages, self->bytesInput);
 							logData->version.set( qe.version );
 							logData->queueCommittedVersion.set( qe.version );
@@ -1941,6 +2195,7 @@ ACTOR Future<Void> tLogStart( TLogData* self, InitializeTLogRequest req, Localit
 
 	DUMPTOKEN( recruited.peekMessages );
 	DUMPTOKEN( recruited.popMessages );
+	DUMPTOKEN( recruited.popBatch );
 	DUMPTOKEN( recruited.commit );
 	DUMPTOKEN( recruited.lock );
 	DUMPTOKEN( recruited.getQueuingMetrics );
@@ -2042,6 +2297,7 @@ ACTOR Future<Void> tLog( IKeyValueStore* persistentData, IDiskQueue* persistentQ
 		if(recovered.canBeSet()) recovered.send(Void());
 
 		self.sharedActors.send( cleanupPeekTrackers(&self) );
+		self.sharedActors.send( cleanupPeekCache(&self) );
 		self.sharedActors.send( commitQueue(&self) );
 		self.sharedActors.send( updateStorageLoop(&self) );
 
@@ -70,7 +70,7 @@ struct TagPartitionedLogSystem : ILogSystem, ReferenceCounted<TagPartitionedLogS
 	std::set< Tag > epochEndTags;
 	Version knownCommittedVersion;
 	LocalityData locality;
-	std::map< std::pair<UID, Tag>, Version > outstandingPops;  // For each currently running popFromLog actor, (log server #, tag)->popped version
+	std::map< UID, std::map<Tag, Version> > outstandingPops;  // For each currently running popFromLog actor, log server # -> tag -> popped version
 	ActorCollection actors;
 	std::vector<OldLogData> oldLogData;
 
@@ -375,7 +375,7 @@ struct TagPartitionedLogSystem : ILogSystem, ReferenceCounted<TagPartitionedLogS
 			if(bestSet == -1) {
 				return Reference<ILogSystem::ServerPeekCursor>( new ILogSystem::ServerPeekCursor( Reference<AsyncVar<OptionalInterface<TLogInterface>>>(), tag, begin, getPeekEnd(), false, false ) );
 			}
-			return Reference<ILogSystem::MergedPeekCursor>( new ILogSystem::MergedPeekCursor( tLogs[bestSet]->logRouters, -1, (int)tLogs[bestSet]->logRouters.size(), tag, begin, getPeekEnd(), false ) );
+			return Reference<ILogSystem::MergedPeekCursor>( new ILogSystem::MergedPeekCursor( tLogs[bestSet]->logRouters, -1, (int)tLogs[bestSet]->logRouters.size(), tag, begin, getPeekEnd(), parallelGetMore ) );
 		} else {
 			int bestSet = -1;
 			for(int t = 0; t < tLogs.size(); t++) {
@@ -410,7 +410,7 @@ struct TagPartitionedLogSystem : ILogSystem, ReferenceCounted<TagPartitionedLogS
 		}
 	}
 
-	virtual Reference<IPeekCursor> peekSingle( Version begin, Tag tag, vector<pair<Version,Tag>> history ) {
+	virtual Reference<IPeekCursor> peekSingle( Version begin, Tag tag, vector<pair<Version,Tag>> history, bool parallelGetMore ) {
 		int bestSet = -1;
 		for(int t = 0; t < tLogs.size(); t++) {
 			if(tLogs[t]->hasBestPolicy && (tLogs[t]->locality == tag.locality || tag.locality == tagLocalitySpecial || tLogs[t]->locality == tagLocalitySpecial || (tLogs[t]->isLocal && tag.locality == tagLocalityLogRouter))) {
@@ -427,14 +427,14 @@ struct TagPartitionedLogSystem : ILogSystem, ReferenceCounted<TagPartitionedLogS
 
 			return Reference<ILogSystem::ServerPeekCursor>( new ILogSystem::ServerPeekCursor( (tLogs.size() && bestSet >= 0 && tLogs[bestSet]->logServers.size()) ?
 				tLogs[bestSet]->logServers[tLogs[bestSet]->bestLocationFor( tag )] :
-				Reference<AsyncVar<OptionalInterface<TLogInterface>>>(), tag, begin, getPeekEnd(), false, false ) );
+				Reference<AsyncVar<OptionalInterface<TLogInterface>>>(), tag, begin, getPeekEnd(), false, parallelGetMore ) );
 		} else {
 			std::vector< Reference<ILogSystem::IPeekCursor> > cursors;
 			std::vector< LogMessageVersion > epochEnds;
 				
 			cursors.push_back( Reference<ILogSystem::ServerPeekCursor>( new ILogSystem::ServerPeekCursor( (tLogs.size() && bestSet >= 0 && tLogs[bestSet]->logServers.size()) ?
 				tLogs[bestSet]->logServers[tLogs[bestSet]->bestLocationFor( tag )] :
-				Reference<AsyncVar<OptionalInterface<TLogInterface>>>(), tag, begin, getPeekEnd(), false, false ) ) );
+				Reference<AsyncVar<OptionalInterface<TLogInterface>>>(), tag, begin, getPeekEnd(), false, parallelGetMore ) ) );
 
 			for(int i = 0; i < history.size(); i++) {
 				bestSet = -1;
@@ -460,33 +460,47 @@ struct TagPartitionedLogSystem : ILogSystem, ReferenceCounted<TagPartitionedLogS
 		for(auto& t : tLogs) {
 			std::vector<Reference<AsyncVar<OptionalInterface<TLogInterface>>>>& popServers = tag.locality == tagLocalityRemoteLog ? t->logRouters : t->logServers;
 			for(auto& log : popServers) {
-				Version prev = outstandingPops[std::make_pair(log->get().id(),tag)];
+				auto& pops = outstandingPops[log->get().id()];
+				bool running = !pops.empty();
+				Version& prev = pops[tag];
 				if (prev < upTo)
-					outstandingPops[std::make_pair(log->get().id(),tag)] = upTo;
-				if (prev == 0)
-					actors.add( popFromLog( this, log, tag ) );
+					prev = upTo;
+				if (!running)
+					actors.add( popFromLog( this, log ) );
 			}
 		}
 	}
 
-	ACTOR static Future<Void> popFromLog( TagPartitionedLogSystem* self, Reference<AsyncVar<OptionalInterface<TLogInterface>>> log, Tag tag ) {
-		state Version last = 0;
+	// Every TLOG_POP_BATCH_INTERVAL, sends the log the pops of every tag that has advanced since the last time, all in one request
+	ACTOR static Future<Void> popFromLog( TagPartitionedLogSystem* self, Reference<AsyncVar<OptionalInterface<TLogInterface>>> log ) {
+		state std::map<Tag, Version> last;
 		loop {
-			Void _ = wait( delay(1.0) );  //< FIXME: knob
+			Void _ = wait( delay( SERVER_KNOBS->TLOG_POP_BATCH_INTERVAL ) );
 
-			state Version to = self->outstandingPops[ std::make_pair(log->get().id(),tag) ];
+			state TLogPopBatchRequest req;
+			for(auto& p : self->outstandingPops[ log->get().id() ]) {
+				auto l = last.find( p.first );
+				if (l == last.end() || l->second < p.second)
+					req.pops.push_back( p );
+			}
 
-			if (to <= last) {
-				self->outstandingPops.erase( std::make_pair(log->get().id(),tag) );
+			if (req.pops.empty()) {
+				self->outstandingPops.erase( log->get().id() );
 				return Void();
 			}
 
 			try {
 				if( !log->get().present() )
 					return Void();
-				Void _ = wait(log->get().interf().popMessages.getReply( TLogPopRequest( to, tag ) ) );
+				// A single pop goes as a TLogPopRequest, which every kind of log understands
+				if (req.pops.size() == 1) {
+					Void _ = wait(log->get().interf().popMessages.getReply( TLogPopRequest( req.pops[0].second, req.pops[0].first ) ) );
+				} else {
+					Void _ = wait(log->get().interf().popBatch.getReply( req ) );
+				}
 
-				last = to;
+				for(auto& p : req.pops)
+					last[p.first] = p.second;
 			} catch (Error& e) {
 				if (e.code() == error_code_actor_cancelled) throw;
 				TraceEvent( (e.code() == error_code_broken_promise) ? SevInfo : SevError, "LogPopError", self->dbgid ).detail("Log", log->get().id()).error(e);
@@ -25,6 +25,7 @@
 #include "fdbrpc/fdbrpc.h"
 #include "fdbrpc/IAsyncFile.h"
 #include "CoroFlow.h"
+#include "Knobs.h"
 #include "fdbrpc/simulator.h"
 #include "fdbrpc/AsyncFileReadAhead.actor.h"
 
@@ -80,7 +81,14 @@ struct VFSAsyncFile {
 
 	int debug_zcrefs, debug_zcreads, debug_reads;
 
-	VFSAsyncFile(std::string const& filename, int flags) : filename(filename), flags(flags), pLockCount(&filename_lockCount_openCount[filename].first), debug_zcrefs(0), debug_zcreads(0), debug_reads(0) {
+	// Set with SQLITE_FCNTL_BULK_READ for scans, which read ahead in large chunks around the page cache
+	bool bulkRead;
+	std::vector<uint8_t> readAhead;
+	int64_t readAheadOffset;
+	int readAheadLength;
+
+	VFSAsyncFile(std::string const& filename, int flags) : filename(filename), flags(flags), pLockCount(&filename_lockCount_openCount[filename].first), debug_zcrefs(0), debug_zcreads(0), debug_reads(0),
+		bulkRead(false), readAheadOffset(0), readAheadLength(0) {
 		filename_lockCount_openCount[filename].second++;
 	}
 	~VFSAsyncFile();
@@ -102,11 +110,33 @@ static int asyncClose(sqlite3_file *pFile){
 	return SQLITE_OK;
 }
 
+static int asyncBulkRead(VFSAsyncFile *p, void *zBuf, int iAmt, sqlite_int64 iOfst) {
+	int readBytes;
+	if (iOfst % 4096 + iAmt > SERVER_KNOBS->SQLITE_BULK_READ_AHEAD_BYTES) {
+		readBytes = waitForAndGet( p->file->readUncached( zBuf, iAmt, iOfst ) );
+	} else {
+		if (iOfst < p->readAheadOffset || iOfst + iAmt > p->readAheadOffset + p->readAheadLength) {
+			p->readAhead.resize( SERVER_KNOBS->SQLITE_BULK_READ_AHEAD_BYTES );
+			p->readAheadOffset = iOfst - iOfst % 4096;
+			p->readAheadLength = 0;
+			p->readAheadLength = waitForAndGet( p->file->readUncached( &p->readAhead[0], p->readAhead.size(), p->readAheadOffset ) );
+		}
+		readBytes = std::max<int64_t>( 0, std::min<int64_t>( iAmt, p->readAheadOffset + p->readAheadLength - iOfst ) );
+		memcpy( zBuf, &p->readAhead[iOfst - p->readAheadOffset], readBytes );
+	}
+	return readBytes;
+}
+
+static void asyncClearReadAhead(VFSAsyncFile *p) {
+	p->readAheadOffset = 0;
+	p->readAheadLength = 0;
+}
+
 static int asyncRead(sqlite3_file *pFile, void *zBuf, int iAmt, sqlite_int64 iOfst) {
 	VFSAsyncFile *p = (VFSAsyncFile*)pFile;
 	try {
 		++p->debug_reads;
-		int readBytes = waitForAndGet( p->file->read( zBuf, iAmt, iOfst ) );
+		int readBytes = p->bulkRead ? asyncBulkRead( p, zBuf, iAmt, iOfst ) : waitForAndGet( p->file->read( zBuf, iAmt, iOfst ) );
 		if (readBytes < iAmt) {
 			memset((uint8_t*)zBuf + readBytes, 0, iAmt-readBytes);  // When reading past the EOF, sqlite expects the extra portion of the buffer to be zeroed
 			return SQLITE_IOERR_SHORT_READ;
@@ -131,6 +161,9 @@ static int asyncReleaseZeroCopy(sqlite3_file* pFile, void* data, int iAmt, sqlit
 
 static int asyncReadZeroCopy(sqlite3_file *pFile, void **data, int iAmt, sqlite_int64 iOfst, int *pDataWasCached) {
 	VFSAsyncFile *p = (VFSAsyncFile*)pFile;
+	// Zero copy reads pin pages in the page cache, so bulk reads take the slow path through asyncRead instead
+	if (p->bulkRead)
+		return SQLITE_IOERR_READ;
 	try {
 		int readBytes = iAmt;
 		Future<Void> readFuture = p->file->readZeroCopy( data, &readBytes, iOfst );
@@ -175,6 +208,7 @@ static int asyncReleaseZeroCopy(sqlite3_file* pFile, void* data, int iAmt, sqlit
 
 static int asyncWrite(sqlite3_file *pFile, const void *zBuf, int iAmt, sqlite_int64 iOfst) {
 	VFSAsyncFile *p = (VFSAsyncFile*)pFile;
+	asyncClearReadAhead(p);
 	try {
 		waitFor( p->file->write( zBuf, iAmt, iOfst ) );
 		return SQLITE_OK;
@@ -185,6 +219,7 @@ static int asyncWrite(sqlite3_file *pFile, const void *zBuf, int iAmt, sqlite_in
 
 static int asyncTruncate(sqlite3_file *pFile, sqlite_int64 size){
 	VFSAsyncFile *p = (VFSAsyncFile*)pFile;
+	asyncClearReadAhead(p);
 	try {
 		waitFor( p->file->truncate( size ) );
 		return SQLITE_OK;
@@ -242,9 +277,20 @@ static int asyncCheckReservedLock(sqlite3_file *pFile, int *pResOut){
 }
 
 /*
-** No xFileControl() verbs are implemented by this VFS.
+** The only xFileControl() verb implemented by this VFS is SQLITE_FCNTL_BULK_READ,
+** which switches reads of the main database file between the page cache and bulk read ahead.
 */
 static int VFSAsyncFileControl(sqlite3_file *pFile, int op, void *pArg){
+	VFSAsyncFile *p = (VFSAsyncFile*)pFile;
+	if (op == SQLITE_FCNTL_BULK_READ) {
+		if (p->flags & SQLITE_OPEN_WAL)
+			return SQLITE_OK;
+		p->bulkRead = *(int*)pArg != 0;
+		asyncClearReadAhead(p);
+		if (!p->bulkRead)
+			std::vector<uint8_t>().swap( p->readAhead );
+		return SQLITE_OK;
+	}
 	return SQLITE_NOTFOUND;
 }
 
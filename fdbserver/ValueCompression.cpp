@@ -0,0 +1,126 @@
+/*
+ * ValueCompression.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ValueCompression.h"
+#include "flow/UnitTest.h"
+#include "fdbrpc/zlib/zlib.h"
+
+static const int DEFLATED_HEADER_BYTES = 1 + sizeof(uint32_t);
+
+StringRef compressValue( Arena& arena, StringRef value, int minBytes, int level ) {
+	z_stream z;
+	memset( &z, 0, sizeof(z) );
+	if( value.size() >= std::max( minBytes, DEFLATED_HEADER_BYTES + 1 ) && deflateInit( &z, level ) == Z_OK ) {
+		uLong bound = deflateBound( &z, value.size() );
+		uint8_t* out = new (arena) uint8_t[ DEFLATED_HEADER_BYTES + bound ];
+		z.next_in = const_cast<uint8_t*>( value.begin() );
+		z.avail_in = value.size();
+		z.next_out = out + DEFLATED_HEADER_BYTES;
+		z.avail_out = bound;
+		int r = deflate( &z, Z_FINISH );
+		uLong compressedLen = z.total_out;
+		deflateEnd( &z );
+		if( r == Z_STREAM_END && DEFLATED_HEADER_BYTES + compressedLen < value.size() ) {
+			out[0] = VALUE_DEFLATED;
+			uint32_t len = value.size();
+			for(int i = 0; i < sizeof(len); i++)
+				out[1+i] = uint8_t( len >> (8*i) );
+			return StringRef( out, DEFLATED_HEADER_BYTES + compressedLen );
+		}
+	}
+
+	uint8_t* out = new (arena) uint8_t[ value.size() + 1 ];
+	out[0] = VALUE_STORED;
+	memcpy( out + 1, value.begin(), value.size() );
+	return StringRef( out, value.size() + 1 );
+}
+
+StringRef decompressValue( Arena& arena, StringRef stored, int maxLength ) {
+	if( !stored.size() )
+		throw file_corrupt();
+	if( stored[0] == VALUE_STORED )
+		return stored.substr( 1, std::min( stored.size() - 1, std::max( maxLength, 0 ) ) );
+	if( stored[0] != VALUE_DEFLATED || stored.size() < DEFLATED_HEADER_BYTES )
+		throw file_corrupt();
+
+	uint32_t len = 0;
+	for(int i = 0; i < sizeof(len); i++)
+		len |= uint32_t( stored[1+i] ) << (8*i);
+	int outLen = std::min<int64_t>( len, std::max( maxLength, 0 ) );
+	uint8_t* out = new (arena) uint8_t[ outLen ];
+	if( !outLen )
+		return StringRef( out, 0 );
+
+	// Stop inflating once the prefix asked for is out, so that reading a prefix of a large value is cheap
+	z_stream z;
+	memset( &z, 0, sizeof(z) );
+	if( inflateInit( &z ) != Z_OK )
+		throw file_corrupt();
+	z.next_in = const_cast<uint8_t*>( stored.begin() + DEFLATED_HEADER_BYTES );
+	z.avail_in = stored.size() - DEFLATED_HEADER_BYTES;
+	z.next_out = out;
+	z.avail_out = outLen;
+	int r = inflate( &z, Z_FINISH );
+	inflateEnd( &z );
+	if( z.avail_out || (outLen == len ? r != Z_STREAM_END : r != Z_BUF_ERROR && r != Z_OK && r != Z_STREAM_END) )
+		throw file_corrupt();
+	return StringRef( out, outLen );
+}
+
+TEST_CASE("fdbserver/ValueCompression/roundTrip") {
+	Arena arena;
+	for(int t = 0; t < 1000; t++) {
+		// Some compressible, some not
+		int size = g_random->randomInt(0, g_random->coinflip() ? 100 : 100000);
+		int alphabet = g_random->randomInt(1, 257);
+		uint8_t* v = new (arena) uint8_t[ size ];
+		for(int i = 0; i < size; i++)
+			v[i] = uint8_t( g_random->randomInt(0, alphabet) );
+		StringRef value( v, size );
+
+		StringRef stored = compressValue( arena, value, g_random->randomInt(0, 100), g_random->randomInt(1, 10) );
+		ASSERT( stored.size() <= value.size() + 1 );
+		ASSERT( stored[0] == VALUE_STORED || stored[0] == VALUE_DEFLATED );
+		if( alphabet == 1 && size >= 100 )
+			ASSERT( stored[0] == VALUE_DEFLATED );
+		ASSERT( decompressValue( arena, stored ) == value );
+
+		int prefix = g_random->randomInt(0, size + 2);
+		ASSERT( decompressValue( arena, stored, prefix ) == value.substr( 0, std::min( prefix, size ) ) );
+	}
+	return Void();
+}
+
+TEST_CASE("fdbserver/ValueCompression/corrupt") {
+	Arena arena;
+	StringRef value = LiteralStringRef("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+	StringRef stored = compressValue( arena, value, 0, 6 );
+	ASSERT( stored[0] == VALUE_DEFLATED );
+
+	for(StringRef bad : { StringRef(), stored.substr( 0, stored.size() - 3 ), LiteralStringRef("\x07" "abc") }) {
+		try {
+			decompressValue( arena, bad );
+			ASSERT( false );
+		} catch (Error& e) {
+			ASSERT( e.code() == error_code_file_corrupt );
+		}
+	}
+	return Void();
+}
@@ -0,0 +1,41 @@
+/*
+ * ValueCompression.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FDBSERVER_VALUECOMPRESSION_H
+#define FDBSERVER_VALUECOMPRESSION_H
+#pragma once
+
+#include "flow/flow.h"
+#include <limits>
+
+// The form in which a storage server with value compression stores each value: a flag byte, followed either by the value
+// itself (VALUE_STORED) or by its length as a little-endian uint32_t and a zlib stream of it (VALUE_DEFLATED).  Each row
+// carries its own flag, so a value that doesn't shrink is stored as is for the cost of one byte.  Keys are never compressed,
+// so key order and everything computed from keys is unaffected.
+enum { VALUE_STORED = 0, VALUE_DEFLATED = 1 };
+
+// Returns the stored form of value, deflated at the given zlib level if it is at least minBytes long and that makes it smaller
+StringRef compressValue( Arena& arena, StringRef value, int minBytes, int level );
+
+// Returns the first maxLength bytes of the value whose stored form is stored (all of it by default).  Throws file_corrupt if
+// stored is not something compressValue() produced.
+StringRef decompressValue( Arena& arena, StringRef stored, int maxLength = std::numeric_limits<int>::max() );
+
+#endif
@@ -27,6 +27,7 @@
 #include "fdbclient/NativeAPI.h"
 #include "fdbclient/SystemData.h"
 #include "fdbclient/FailureMonitorClient.h"
+#include "fdbclient/MetricLogger.h"
 #include "CoordinationInterface.h"
 #include "WorkerInterface.h"
 #include "ClusterRecruitmentInterface.h"
@@ -75,7 +76,7 @@
 #include "flow/SimpleOpt.h"
 
 enum {
-	OPT_CONNFILE, OPT_SEEDCONNFILE, OPT_SEEDCONNSTRING, OPT_ROLE, OPT_LISTEN, OPT_PUBLICADDR, OPT_DATAFOLDER, OPT_LOGFOLDER, OPT_PARENTPID, OPT_NEWCONSOLE, OPT_NOBOX, OPT_TESTFILE, OPT_RESTARTING, OPT_RANDOMSEED, OPT_KEY, OPT_MEMLIMIT, OPT_STORAGEMEMLIMIT, OPT_MACHINEID, OPT_DCID, OPT_MACHINE_CLASS, OPT_BUGGIFY, OPT_VERSION, OPT_CRASHONERROR, OPT_HELP, OPT_NETWORKIMPL, OPT_NOBUFSTDOUT, OPT_BUFSTDOUTERR, OPT_TRACECLOCK, OPT_NUMTESTERS, OPT_DEVHELP, OPT_ROLLSIZE, OPT_MAXLOGS, OPT_MAXLOGSSIZE, OPT_KNOB, OPT_TESTSERVERS, OPT_TEST_ON_SERVERS, OPT_METRICSCONNFILE, OPT_METRICSPREFIX,
+	OPT_CONNFILE, OPT_SEEDCONNFILE, OPT_SEEDCONNSTRING, OPT_ROLE, OPT_LISTEN, OPT_PUBLICADDR, OPT_DATAFOLDER, OPT_LOGFOLDER, OPT_PARENTPID, OPT_NEWCONSOLE, OPT_NOBOX, OPT_TESTFILE, OPT_RESTARTING, OPT_RANDOMSEED, OPT_KEY, OPT_MEMLIMIT, OPT_STORAGEMEMLIMIT, OPT_MACHINEID, OPT_DCID, OPT_MACHINE_CLASS, OPT_BUGGIFY, OPT_VERSION, OPT_CRASHONERROR, OPT_HELP, OPT_NETWORKIMPL, OPT_NOBUFSTDOUT, OPT_BUFSTDOUTERR, OPT_TRACECLOCK, OPT_TRACE_RATE_LIMIT, OPT_NUMTESTERS, OPT_DEVHELP, OPT_ROLLSIZE, OPT_MAXLOGS, OPT_MAXLOGSSIZE, OPT_KNOB, OPT_TESTSERVERS, OPT_TEST_ON_SERVERS, OPT_METRICSCONNFILE, OPT_METRICSPREFIX, OPT_METRICSEXPORT, OPT_METRICSEXPORTFORMAT,
 	OPT_LOGGROUP, OPT_LOCALITY, OPT_IO_TRUST_SECONDS, OPT_IO_TRUST_WARN_ONLY, OPT_FILESYSTEM, OPT_KVFILE };
 
 CSimpleOpt::SOption g_rgOptions[] = {
@@ -137,6 +138,7 @@ CSimpleOpt::SOption g_rgOptions[] = {
 	{ OPT_NOBUFSTDOUT,          "--unbufferedout",             SO_NONE },
 	{ OPT_BUFSTDOUTERR,         "--bufferedout",               SO_NONE },
 	{ OPT_TRACECLOCK,           "--traceclock",                SO_REQ_SEP },
+	{ OPT_TRACE_RATE_LIMIT,     "--trace_rate_limit",          SO_REQ_SEP },
 	{ OPT_NUMTESTERS,           "--num_testers",               SO_REQ_SEP },
 	{ OPT_HELP,                 "-?",                          SO_NONE },
 	{ OPT_HELP,                 "-h",                          SO_NONE },
@@ -148,6 +150,8 @@ CSimpleOpt::SOption g_rgOptions[] = {
 	{ OPT_TEST_ON_SERVERS,      "--testonservers",             SO_NONE },
 	{ OPT_METRICSCONNFILE,      "--metrics_cluster",           SO_REQ_SEP },
 	{ OPT_METRICSPREFIX,        "--metrics_prefix",            SO_REQ_SEP },
+	{ OPT_METRICSEXPORT,        "--metrics_export",            SO_REQ_SEP },
+	{ OPT_METRICSEXPORTFORMAT,  "--metrics_export_format",     SO_REQ_SEP },
 	{ OPT_IO_TRUST_SECONDS,     "--io_trust_seconds",          SO_REQ_SEP },
 	{ OPT_IO_TRUST_WARN_ONLY,   "--io_trust_warn_only",        SO_NONE },
 
@@ -634,7 +638,8 @@ static void printUsage( const char *name, bool devhelp ) {
 		printf("  -r ROLE, --role ROLE\n"
 			   "                 Server role (valid options are fdbd, test, multitest,\n");
 		printf("                 simulation, networktestclient, networktestserver,\n");
-		printf("                 consistencycheck, kvfileintegritycheck, kvfilegeneratesums). The default is `fdbd'.\n");
+		printf("                 consistencycheck, kvfileintegritycheck, kvfilegeneratesums,\n");
+		printf("                 kvbench). The default is `fdbd'.\n");
 #ifdef _WIN32
 		printf("  -n, --newconsole\n"
 			   "                 Create a new console.\n");
@@ -671,6 +676,9 @@ static void printUsage( const char *name, bool devhelp ) {
 		printf("  --traceclock CLOCKIMPL\n");
 		printf("                 Select clock source for trace files, `now' (default) or\n");
 		printf("                 `realtime'.\n");
+		printf("  --trace_rate_limit LIMITS\n");
+		printf("                 Limit how often trace events of the listed types are logged,\n");
+		printf("                 specified as TYPE:EVENTS_PER_SECOND[:SAMPLE_RATE],...\n");
 		printf("  --num_testers NUM\n");
 		printf("                 A multitester will wait for NUM testers before starting\n");
 		printf("                 (defaults to 1).\n");
@@ -686,6 +694,13 @@ static void printUsage( const char *name, bool devhelp ) {
 		printf("  --metrics_prefix PREFIX\n");
 		printf("                 The prefix where this process will store its metric data.\n");
 		printf("                 Must be specified if using a different database for metrics.\n");
+		printf("  --metrics_export HOST:PORT\n");
+		printf("                 Also send this process's numeric metrics to a metrics agent\n");
+		printf("                 listening on HOST:PORT. This does not need --metrics_prefix,\n");
+		printf("                 so it can replace storing metrics in a database.\n");
+		printf("  --metrics_export_format FORMAT\n");
+		printf("                 The line protocol for --metrics_export, either `statsd'\n");
+		printf("                 (the default) or `graphite'.\n");
 		printf("  --knob_KNOBNAME KNOBVALUE\n");
 		printf("                 Changes a database knob. KNOBNAME should be lowercase.\n");
 		printf("  --locality_LOCALITYKEY LOCALITYVALUE\n");
@@ -836,9 +851,10 @@ int main(int argc, char* argv[]) {
 			NetworkTestServer,
 			KVFileIntegrityCheck,
 			KVFileGenerateIOLogChecksums,
+			KVBench,
 			ConsistencyCheck
 		};
-		std::string fileSystemPath = "", dataFolder, connFile = "", seedConnFile = "", seedConnString = "", logFolder = ".", metricsConnFile = "", metricsPrefix = "";
+		std::string fileSystemPath = "", dataFolder, connFile = "", seedConnFile = "", seedConnString = "", logFolder = ".", metricsConnFile = "", metricsPrefix = "", metricsExport = "", metricsExportFormat = "statsd";
 		std::string logGroup = "default";
 		Role role = FDBD;
 		uint32_t randomSeed = platform::getRandomSeed();
@@ -968,6 +984,7 @@ int main(int argc, char* argv[]) {
 					else if (!strcmp(sRole, "networktestserver")) role = NetworkTestServer;
 					else if (!strcmp(sRole, "kvfileintegritycheck")) role = KVFileIntegrityCheck;
 					else if (!strcmp(sRole, "kvfilegeneratesums")) role = KVFileGenerateIOLogChecksums;
+					else if (!strcmp(sRole, "kvbench")) role = KVBench;
 					else if (!strcmp(sRole, "consistencycheck")) role = ConsistencyCheck;
 					else {
 						fprintf(stderr, "ERROR: Unknown role `%s'\n", sRole);
@@ -1027,6 +1044,16 @@ int main(int argc, char* argv[]) {
 					}
 					break;
 				}
+				case OPT_TRACE_RATE_LIMIT: {
+					try {
+						setTraceEventRateLimits(args.OptionArg());
+					} catch (Error& e) {
+						fprintf(stderr, "ERROR: Could not parse trace rate limits `%s'\n", args.OptionArg());
+						printHelpTeaser(argv[0]);
+						flushAndExit(FDB_EXIT_ERROR);
+					}
+					break;
+				}
 				case OPT_NUMTESTERS: {
 					const char* a = args.OptionArg();
 					if( !sscanf(a, "%d", &minTesterCount) ) {
@@ -1178,6 +1205,17 @@ int main(int argc, char* argv[]) {
 				case OPT_METRICSPREFIX:
 					metricsPrefix = args.OptionArg();
 					break;
+				case OPT_METRICSEXPORT:
+					metricsExport = args.OptionArg();
+					break;
+				case OPT_METRICSEXPORTFORMAT:
+					metricsExportFormat = args.OptionArg();
+					if( metricsExportFormat != "statsd" && metricsExportFormat != "graphite" ) {
+						fprintf(stderr, "ERROR: Unknown metrics export format `%s'\n", metricsExportFormat.c_str());
+						printHelpTeaser(argv[0]);
+						flushAndExit(FDB_EXIT_ERROR);
+					}
+					break;
 				case OPT_IO_TRUST_SECONDS: {
 					const char* a = args.OptionArg();
 					if( !sscanf(a, "%lf", &fileIoTimeout) ) {
@@ -1234,7 +1272,7 @@ int main(int argc, char* argv[]) {
 		bool autoPublicAddress = StringRef(publicAddressStr).startsWith(LiteralStringRef("auto:"));
 
 		Reference<ClusterConnectionFile> connectionFile;
-		if ( (role != Simulation && role != CreateTemplateDatabase && role != KVFileIntegrityCheck && role != KVFileGenerateIOLogChecksums) || autoPublicAddress ) {
+		if ( (role != Simulation && role != CreateTemplateDatabase && role != KVFileIntegrityCheck && role != KVFileGenerateIOLogChecksums && role != KVBench) || autoPublicAddress ) {
 
 				if (seedSpecified && !fileExists(connFile)){
 					std::string connectionString = seedConnString.length() ? seedConnString : "";
@@ -1517,6 +1555,8 @@ int main(int argc, char* argv[]) {
 			.detail("CommandLine", commandLine)
 			.detail("BuggifyEnabled", buggifyEnabled)
 			.detail("MemoryLimit", memLimit)
+			.detail("CPUAffinity", getCPUAffinity())
+			.detail("NUMANode", getMemoryNUMANode())
 			.trackLatest("ProgramStart");
 
 		// Test for TraceEvent length limits
@@ -1599,6 +1639,8 @@ int main(int argc, char* argv[]) {
 			actors.push_back( listenError );
 
 			actors.push_back( fdbd(connectionFile, localities, processClass, dataFolder, dataFolder, storageMemLimit, metricsConnFile, metricsPrefix) );
+			if( metricsExport.size() )
+				actors.push_back( exportMetrics(metricsExport, metricsExportFormat) );
 			//actors.push_back( recurring( []{}, .001 ) );  // for ASIO latency measurement
 
 			f = stopAfter( waitForAll(actors) );
@@ -1630,6 +1672,12 @@ int main(int argc, char* argv[]) {
 		} else if (role == KVFileGenerateIOLogChecksums) {
 			auto f = stopAfter( GenerateIOLogChecksumFile(kvFile) );
 			g_network->run();
+		} else if (role == KVBench) {
+			if (!dataFolder.size())
+				dataFolder = "kvbench";
+			platform::createDirectory( dataFolder );
+			f = stopAfter( kvBench(dataFolder) );
+			g_network->run();
 		}
 
 		int rc = FDB_EXIT_SUCCESS;
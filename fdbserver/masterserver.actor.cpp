@@ -219,6 +219,18 @@ struct MasterData : NonCopyable, ReferenceCounted<MasterData> {
 
 	PromiseStream<Future<Void>> addActor;
 
+	// Workers recruited with the cluster controller's last known configuration while the old log system is still being locked
+	Future<RecruitFromConfigurationReply> speculativeRecruits;
+
+	double recoveryPhaseStart;
+	std::map<std::string, double> recoveryPhaseDurations;
+
+	void finishRecoveryPhase( std::string const& phase ) {
+		double t = now();
+		recoveryPhaseDurations[phase] += t - recoveryPhaseStart;
+		recoveryPhaseStart = t;
+	}
+
 	MasterData(
 		Reference<AsyncVar<ServerDBInfo>> const& dbInfo,
 		MasterInterface const& myInterface,
@@ -246,7 +258,8 @@ struct MasterData : NonCopyable, ReferenceCounted<MasterData> {
 		  memoryLimit(2e9),
 		  cstateUpdated(false),
 		  addActor(addActor),
-		  hasConfiguration(false)
+		  hasConfiguration(false),
+		  recoveryPhaseStart(now())
 	{
 	}
 	~MasterData() { if(txnStateStore) txnStateStore->close(); }
@@ -546,9 +559,27 @@ ACTOR Future<Void> recruitEverything( Reference<MasterData> self, vector<Storage
 			.detail("storeType", self->configuration.storageServerStoreType)
 			.trackLatest("MasterRecoveryState");
 
-	state RecruitFromConfigurationReply recruits = wait(
-		brokenPromiseToNever( self->clusterController.recruitFromConfiguration.getReply(
-			RecruitFromConfigurationRequest( self->configuration, self->lastEpochEnd==0 ) ) ) );
+	state RecruitFromConfigurationReply recruits;
+	state bool haveRecruits = false;
+	if( self->speculativeRecruits.isValid() ) {
+		// Only the first recruitment can use the speculative one; later ones follow an emergency configuration change
+		Future<RecruitFromConfigurationReply> speculative = self->speculativeRecruits;
+		self->speculativeRecruits = Future<RecruitFromConfigurationReply>();
+		bool usable = speculative.isReady() && !speculative.isError() && self->lastEpochEnd != 0 && speculative.get().configuration == self->configuration;
+		TEST( usable );  // Master used speculatively recruited workers
+		TraceEvent("MasterSpeculativeRecruitment", self->dbgid).detail("Ready", speculative.isReady()).detail("Used", usable);
+		if( usable ) {
+			recruits = speculative.get();
+			haveRecruits = true;
+		}
+	}
+
+	if( !haveRecruits ) {
+		RecruitFromConfigurationReply _recruits = wait(
+			brokenPromiseToNever( self->clusterController.recruitFromConfiguration.getReply(
+				RecruitFromConfigurationRequest( self->configuration, self->lastEpochEnd==0 ) ) ) );
+		recruits = _recruits;
+	}
 
 	self->primaryDcId.clear();
 	self->remoteDcIds.clear();
@@ -569,8 +600,10 @@ ACTOR Future<Void> recruitEverything( Reference<MasterData> self, vector<Storage
 
 	// Actually, newSeedServers does both the recruiting and initialization of the seed servers; so if this is a brand new database we are sort of lying that we are
 	// past the recruitment phase.  In a perfect world we would split that up so that the recruitment part happens above (in parallel with recruiting the transaction servers?).
+	// Proxies and resolvers do not depend on the seed servers, so they are initialized meanwhile; the new log system needs the localities the seed servers choose.
+	state Future<Void> proxiesAndResolvers = newProxies( self, recruits ) && newResolvers( self, recruits );
 	Void _ = wait( newSeedServers( self, recruits, seedServers ) );
-	Void _ = wait( newProxies( self, recruits ) && newResolvers( self, recruits ) && newTLogServers( self, recruits, oldLogSystem, initialConfChanges ) );
+	Void _ = wait( proxiesAndResolvers && newTLogServers( self, recruits, oldLogSystem, initialConfChanges ) );
 	return Void();
 }
 
@@ -633,6 +666,23 @@ ACTOR Future<Void> readTransactionSystemState( Reference<MasterData> self, Refer
 	return Void();
 }
 
+ACTOR Future<Void> sendTxnStateChunk( MasterProxyInterface proxy, TxnStateRequest req, KeyRange range, uint64_t checksum ) {
+	// Proxies recruited on a process that hosted an earlier proxy usually have most of the txnStateStore already
+	if( SERVER_KNOBS->TXN_STATE_CACHED_TRANSFER ) {
+		TxnStateRequest cachedReq;
+		cachedReq.sequence = req.sequence;
+		cachedReq.last = req.last;
+		cachedReq.cachedRange = range;
+		cachedReq.cachedChecksum = checksum;
+		cachedReq.arena.dependsOn( range.arena() );
+		bool used = wait( brokenPromiseToNever( proxy.txnState.getReply( cachedReq ) ) );
+		if( used )
+			return Void();
+	}
+	bool _ = wait( brokenPromiseToNever( proxy.txnState.getReply( req ) ) );
+	return Void();
+}
+
 ACTOR Future<Void> sendInitialCommitToResolvers( Reference<MasterData> self ) {
 	state KeyRange txnKeys = allKeys;
 	state Sequence txnSequence = 0;
@@ -643,6 +693,8 @@ ACTOR Future<Void> sendInitialCommitToResolvers( Reference<MasterData> self ) {
 	state int64_t dataOutstanding = 0;
 	loop {
 		if(!data.size()) break;
+		KeyRange chunk = KeyRangeRef( txnKeys.begin, keyAfter(data.back().key) );
+		uint64_t checksum = txnStateChecksum( data.begin(), data.end() );
 		((KeyRangeRef&)txnKeys) = KeyRangeRef( keyAfter(data.back().key, txnKeys.arena()), txnKeys.end );
 		Standalone<VectorRef<KeyValueRef>> nextData = self->txnStateStore->readRange(txnKeys, BUGGIFY ? 3 : SERVER_KNOBS->DESIRED_TOTAL_BYTES, SERVER_KNOBS->DESIRED_TOTAL_BYTES).get();
 
@@ -652,7 +704,7 @@ ACTOR Future<Void> sendInitialCommitToResolvers( Reference<MasterData> self ) {
 			req.data = data;
 			req.sequence = txnSequence;
 			req.last = !nextData.size();
-			txnReplies.push_back( brokenPromiseToNever( r.txnState.getReply( req ) ) );
+			txnReplies.push_back( sendTxnStateChunk( r, req, chunk, checksum ) );
 			dataOutstanding += data.arena().getSize();
 		}
 		data = nextData;
@@ -708,11 +760,13 @@ ACTOR Future<Void> recoverFrom( Reference<MasterData> self, Reference<ILogSystem
 		.detail("Status", RecoveryStatus::names[RecoveryStatus::reading_transaction_system_state])
 		.trackLatest("MasterRecoveryState");
 	self->hasConfiguration = false;
+	self->finishRecoveryPhase("LockingOldTLogs");
 
 	if(BUGGIFY)
 		Void _ = wait( delay(10.0) );
 
 	Void _ = wait( readTransactionSystemState( self, oldLogSystem ) );
+	self->finishRecoveryPhase("ReadingTxnState");
 	for (auto& itr : *initialConfChanges) {
 		for(auto& m : itr.mutations) {
 			self->configuration.applyMutation( m );
@@ -731,6 +785,7 @@ ACTOR Future<Void> recoverFrom( Reference<MasterData> self, Reference<ILogSystem
 		choose {
 			when (Void _ = wait( recruitments )) {
 				provisional.cancel();
+				self->finishRecoveryPhase("Recruiting");
 				break;
 			}
 			when (Standalone<CommitTransactionRef> _req = wait( provisional )) {
@@ -785,9 +840,12 @@ ACTOR Future<Void> getVersion(Reference<MasterData> self, GetCommitVersionReques
 	else {
 		GetCommitVersionReply rep;
 
+		// A request shared by several commit batches gets a range of versions ending at rep.version, which the proxy hands out one
+		// per batch in order.  The range is always contiguous with the previous reply, so the chain of (prevVersion, version) pairs
+		// that resolvers and tlogs rely on is the same as if each batch had asked separately.
 		if(self->version == invalidVersion) {
 			self->lastVersionTime = now();
-			self->version = self->recoveryTransactionVersion;
+			self->version = self->recoveryTransactionVersion + req.versionCount - 1;
 			rep.prevVersion = self->lastEpochEnd;
 		}
 		else {
@@ -796,7 +854,7 @@ ACTOR Future<Void> getVersion(Reference<MasterData> self, GetCommitVersionReques
 				t1 = self->lastVersionTime;
 			}
 			rep.prevVersion = self->version;
-			self->version += std::max(1, std::min(SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS, int(SERVER_KNOBS->VERSIONS_PER_SECOND*(t1-self->lastVersionTime))));
+			self->version += std::max(req.versionCount, std::min(SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS, int(SERVER_KNOBS->VERSIONS_PER_SECOND*(t1-self->lastVersionTime))));
 
 			TEST( self->version - rep.prevVersion == 1 );  // Minimum possible version gap
 			TEST( self->version - rep.prevVersion == SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS );  // Maximum possible version gap
@@ -904,21 +962,28 @@ ACTOR Future<Void> resolutionBalancing(Reference<MasterData> self) {
 		for (auto& p : self->resolvers)
 			futures.push_back(brokenPromiseToNever(p.metrics.getReply(ResolutionMetricsRequest(), TaskResolutionMetrics)));
 		Void _ = wait( waitForAll(futures) );
-		state IndexedSet<std::pair<int64_t, int>, NoMetric> metrics;
+		state std::vector<std::pair<int64_t, int>> metrics;
 
-		int64_t total = 0;
+		state int64_t total = 0;
 		for (int i = 0; i < futures.size(); i++) {
 			total += futures[i].get();
-			metrics.insert(std::make_pair(futures[i].get(), i), NoMetric());
+			metrics.push_back(std::make_pair(futures[i].get(), i));
 			//TraceEvent("ResolverMetric").detail("i", i).detail("metric", futures[i].get());
 		}
-		if( metrics.lastItem()->first - metrics.begin()->first > SERVER_KNOBS->MIN_BALANCE_DIFFERENCE ) {
+		std::sort(metrics.begin(), metrics.end());
+
+		// Pair the busiest resolvers with the least busy ones so that every resolver which is out of balance sheds (or picks up) load
+		// in the same round, instead of only the single hottest one. Each resolver is the source or destination of at most one move,
+		// so the moves never compete for the same ranges, and they are all handed to the proxies together at resolverChangesVersion.
+		state Standalone<VectorRef<ResolverMoveRef>> movedRanges;
+		state int pair = 0;
+		for(; pair < metrics.size() / 2; pair++) {
+			state int src = metrics[metrics.size() - 1 - pair].second;
+			state int dest = metrics[pair].second;
+			state int64_t amount = std::min( metrics[metrics.size() - 1 - pair].first - total/self->resolvers.size(), total/self->resolvers.size() - metrics[pair].first ) / 2;
+			if( metrics[metrics.size() - 1 - pair].first - metrics[pair].first <= SERVER_KNOBS->MIN_BALANCE_DIFFERENCE || amount <= 0 )
+				break;
 			try {
-				state int src = metrics.lastItem()->second;
-				state int dest = metrics.begin()->second;
-				state int64_t amount = std::min( metrics.lastItem()->first - total/self->resolvers.size(), total/self->resolvers.size() - metrics.begin()->first ) / 2;
-				state Standalone<VectorRef<ResolverMoveRef>> movedRanges;
-
 				loop {
 					state std::pair<KeyRangeRef, bool> range = findRange( key_resolver, movedRanges, src, dest );
 
@@ -927,7 +992,7 @@ ACTOR Future<Void> resolutionBalancing(Reference<MasterData> self) {
 					req.offset = amount;
 					req.range = range.first;
 
-					ResolutionSplitReply split = wait( brokenPromiseToNever(self->resolvers[metrics.lastItem()->second].split.getReply(req, TaskResolutionMetrics)) );
+					ResolutionSplitReply split = wait( brokenPromiseToNever(self->resolvers[src].split.getReply(req, TaskResolutionMetrics)) );
 					KeyRangeRef moveRange = range.second ? KeyRangeRef( range.first.begin, split.key ) : KeyRangeRef( split.key, range.first.end );
 					movedRanges.push_back_deep(movedRanges.arena(), ResolverMoveRef(moveRange, dest));
 					TraceEvent("MovingResolutionRange").detail("src", src).detail("dest", dest).detail("amount", amount).detail("startRange", printable(range.first)).detail("moveRange", printable(moveRange)).detail("used", split.used).detail("KeyResolverRanges", key_resolver.size());
@@ -935,20 +1000,23 @@ ACTOR Future<Void> resolutionBalancing(Reference<MasterData> self) {
 					if(moveRange != range.first || amount <= 0 )
 						break;
 				}
-				for(auto& it : movedRanges)
-					key_resolver.insert(it.range, it.dest);
-				//for(auto& it : key_resolver.ranges())
-				//	TraceEvent("KeyResolver").detail("range", printable(it.range())).detail("value", it.value());
-
-				self->resolverChangesVersion = self->version + 1;
-				for (auto& p : self->proxies)
-					self->resolverNeedingChanges.insert(p.id());
-				self->resolverChanges.set(movedRanges);
 			} catch( Error&e ) {
 				if(e.code() != error_code_operation_failed)
 					throw;
 			}
 		}
+
+		if( movedRanges.size() ) {
+			for(auto& it : movedRanges)
+				key_resolver.insert(it.range, it.dest);
+			//for(auto& it : key_resolver.ranges())
+			//	TraceEvent("KeyResolver").detail("range", printable(it.range())).detail("value", it.value());
+
+			self->resolverChangesVersion = self->version + 1;
+			for (auto& p : self->proxies)
+				self->resolverNeedingChanges.insert(p.id());
+			self->resolverChanges.set(movedRanges);
+		}
 	}
 }
 
@@ -1089,6 +1157,14 @@ ACTOR Future<Void> masterCore( Reference<MasterData> self ) {
 		.trackLatest("MasterRecoveryState");
 
 	Void _ = wait( self->cstate.read() );
+	self->finishRecoveryPhase("ReadingCState");
+
+	// Recruitment only needs the configuration, which the cluster controller most likely still has from the previous
+	// master. Ask for workers now, using that configuration, so the reply is waiting once the old log system is locked
+	// and the actual configuration has been read; recruitEverything() discards it if the two differ.
+	if( SERVER_KNOBS->MASTER_SPECULATIVE_RECRUITMENT && self->cstate.prevDBState.tLogs.size() ) {
+		self->speculativeRecruits = self->clusterController.recruitFromConfiguration.getReply( RecruitFromConfigurationRequest( DatabaseConfiguration(), false ) );
+	}
 
 	self->recoveryState = RecoveryState::LOCKING_CSTATE;
 	TraceEvent("MasterRecoveryState", self->dbgid)
@@ -1104,6 +1180,7 @@ ACTOR Future<Void> masterCore( Reference<MasterData> self ) {
 	DBCoreState newState = self->cstate.myDBState;
 	newState.recoveryCount++;
 	Void _ = wait( self->cstate.write(newState) || recoverAndEndEpoch );
+	self->finishRecoveryPhase("LockingCState");
 
 	self->recoveryState = RecoveryState::RECRUITING;
 
@@ -1204,6 +1281,7 @@ ACTOR Future<Void> masterCore( Reference<MasterData> self ) {
 	}
 
 	ASSERT( self->recoveryTransactionVersion != 0 );
+	self->finishRecoveryPhase("RecoveryTransaction");
 
 	self->recoveryState = RecoveryState::WRITING_CSTATE;
 	TraceEvent("MasterRecoveryState", self->dbgid)
@@ -1229,6 +1307,7 @@ ACTOR Future<Void> masterCore( Reference<MasterData> self ) {
 		Void _ = wait(self->cstateUpdated.onChange());
 	}
 	debug_advanceMinCommittedVersion(UID(), self->recoveryTransactionVersion);
+	self->finishRecoveryPhase("WritingCState");
 
 	if( debugResult )
 		TraceEvent(SevError, "DBRecoveryDurabilityError");
@@ -1244,6 +1323,12 @@ ACTOR Future<Void> masterCore( Reference<MasterData> self ) {
 		.detail("recoveryDuration", recoveryDuration)
 		.trackLatest("MasterRecoveryDuration");
 
+	{
+		TraceEvent phases("MasterRecoveryPhases", self->dbgid);
+		for(auto& p : self->recoveryPhaseDurations)
+			phases.detail(p.first.c_str(), p.second);
+	}
+
 	TraceEvent("MasterRecoveryState", self->dbgid)
 		.detail("StatusCode", RecoveryStatus::fully_recovered)
 		.detail("Status", RecoveryStatus::names[RecoveryStatus::fully_recovered])
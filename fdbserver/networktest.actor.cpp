@@ -20,6 +20,8 @@
 
 #include "flow/actorcompiler.h"
 #include "NetworkTest.h"
+#include "Knobs.h"
+#include "flow/Histogram.h"
 
 UID WLTOKEN_NETWORKTEST( -1, 2 );
 
@@ -33,46 +35,116 @@ NetworkTestInterface::NetworkTestInterface( INetwork* local )
 	test.makeWellKnownEndpoint( WLTOKEN_NETWORKTEST, TaskDefaultEndpoint );
 }
 
+// Payloads are substrings of one block, so that the test measures the transport rather than the cost of building messages
+static Standalone<StringRef> networkTestPayload( int size ) {
+	static Standalone<StringRef> block;
+	if( block.size() < size ) {
+		block = makeString( std::max( size, 2*block.size() ) );
+		uint8_t* data = mutateString( block );
+		for(int i = 0; i < block.size(); i++)
+			data[i] = SERVER_KNOBS->NETWORK_TEST_COMPRESSIBLE ? '.' : (uint8_t)g_random->randomInt(0, 256);
+	}
+	return Standalone<StringRef>( block.substr( 0, size ), block.arena() );
+}
+
+static int networkTestSize( int mean ) {
+	switch( SERVER_KNOBS->NETWORK_TEST_SIZE_DISTRIBUTION ) {
+	case 1:
+		return g_random->randomInt( 0, 2*mean+1 );
+	case 2:
+		return (int)std::min( -log( 1 - g_random->random01() ) * mean, 20.0 * mean );
+	default:
+		return mean;
+	}
+}
+
+// Messages, bytes and latencies over one report interval, and over the whole run
+struct NetworkTestStats {
+	int64_t messages, bytes;
+	LatencyHistogram latency;
+	double startTime, startCPU;
+
+	NetworkTestStats() { reset(); }
+
+	void reset() {
+		messages = bytes = 0;
+		latency.clear();
+		startTime = now();
+		startCPU = getProcessorTimeProcess();
+	}
+
+	void add( NetworkTestStats const& r ) {
+		messages += r.messages;
+		bytes += r.bytes;
+		latency.merge( r.latency );
+	}
+
+	void report( const char* name, double startTime, double startCPU ) const {
+		double elapsed = std::max( now() - startTime, 1e-9 );
+		double cpu = getProcessorTimeProcess() - startCPU;
+		fprintf( stderr, "%s: %.0f messages/sec, %.2f MB/sec, %.2f us CPU/message",
+			name, messages / elapsed, bytes / elapsed / 1e6, messages ? 1e6 * cpu / messages : 0.0 );
+		if( latency.count() )
+			fprintf( stderr, ", latency us p50 %.0f p90 %.0f p99 %.0f max %.0f", 1e6*latency.percentile(0.5), 1e6*latency.percentile(0.9), 1e6*latency.percentile(0.99), 1e6*latency.max() );
+		fprintf( stderr, "\n" );
+
+		TraceEvent("NetworkTestReport").detail("Name", name).detail("Elapsed", elapsed).detail("Messages", messages).detail("Bytes", bytes)
+			.detail("CPUSeconds", cpu).detail("LatencyP50", latency.percentile(0.5)).detail("LatencyP90", latency.percentile(0.9))
+			.detail("LatencyP99", latency.percentile(0.99)).detail("LatencyMax", latency.max());
+	}
+};
+
 ACTOR Future<Void> networkTestServer() {
 	state NetworkTestInterface interf( g_network );
-	state Future<Void> logging = delay( 1.0 );
-	state double lastTime = now();
-	state int sent = 0;
+	state Future<Void> logging = delay( SERVER_KNOBS->NETWORK_TEST_REPORT_INTERVAL );
+	state NetworkTestStats stats;
 
 	loop {
 		choose {
 			when( NetworkTestRequest req = waitNext( interf.test.getFuture() ) ) {
-				req.reply.send( NetworkTestReply( Value( std::string( req.replySize, '.' ) ) ) );
-				sent++;
+				req.reply.send( NetworkTestReply( networkTestPayload( req.replySize ) ) );
+				stats.messages++;
+				stats.bytes += req.key.size() + req.replySize;
 			}
 			when( Void _ = wait( logging ) ) {
-				auto spd = sent / (now() - lastTime);
-				fprintf( stderr, "responses per second: %f (%f us)\n", spd, 1e6/spd );
-				lastTime = now();
-				sent = 0;
-				logging = delay( 1.0 );
+				stats.report( "responses", stats.startTime, stats.startCPU );
+				stats.reset();
+				logging = delay( SERVER_KNOBS->NETWORK_TEST_REPORT_INTERVAL );
 			}
 		}
 	}
 }
 
-ACTOR Future<Void> testClient( std::vector<NetworkTestInterface> interfs, int* sent ) {
-	state double lastTime = now();
-
+ACTOR Future<Void> testClient( NetworkTestInterface interf, NetworkTestStats* stats ) {
 	loop {
-		NetworkTestReply rep = wait(  retryBrokenPromise(interfs[g_random->randomInt(0, interfs.size())].test, NetworkTestRequest( LiteralStringRef("."), 600000 ) ) );
-		(*sent)++;
+		state int replySize = networkTestSize( SERVER_KNOBS->NETWORK_TEST_REPLY_SIZE );
+		state NetworkTestRequest req( networkTestPayload( networkTestSize( SERVER_KNOBS->NETWORK_TEST_REQUEST_SIZE ) ), replySize );
+		state double start = timer_monotonic();
+		NetworkTestReply rep = wait( retryBrokenPromise( interf.test, req ) );
+		stats->latency.record( timer_monotonic() - start );
+		stats->messages++;
+		stats->bytes += req.key.size() + rep.value.size();
 	}
 }
 
-ACTOR Future<Void> logger( int* sent ) {
-	state double lastTime = now();
+ACTOR Future<Void> logger( NetworkTestStats* stats ) {
+	state NetworkTestStats total;
+	state double startTime = now();
+	state double startCPU = getProcessorTimeProcess();
+	state Future<Void> end = SERVER_KNOBS->NETWORK_TEST_DURATION > 0 ? delay( SERVER_KNOBS->NETWORK_TEST_DURATION ) : Never();
 	loop {
-		Void _ = wait( delay(1.0) );
-		auto spd = *sent / (now() - lastTime);
-		fprintf( stderr, "messages per second: %f\n", spd);
-		lastTime = now();
-		*sent = 0;
+		choose {
+			when( Void _ = wait( delay( SERVER_KNOBS->NETWORK_TEST_REPORT_INTERVAL ) ) ) {
+				stats->report( "requests", stats->startTime, stats->startCPU );
+				total.add( *stats );
+				stats->reset();
+			}
+			when( Void _ = wait( end ) ) {
+				total.add( *stats );
+				total.report( "total", startTime, startCPU );
+				return Void();
+			}
+		}
 	}
 }
 
@@ -141,19 +213,14 @@ ACTOR Future<Void> networkTestClient( std:: string testServers ) {
 	}
 
 
-	state std::vector<NetworkTestInterface> interfs;
 	state std::vector<NetworkAddress> servers = NetworkAddress::parseList(testServers);
-	state int sent = 0;
-
-	for( int i = 0; i < servers.size(); i++ ) {
-		interfs.push_back( NetworkTestInterface( servers[i] ) );
-	}
+	state NetworkTestStats stats;
 
 	state std::vector<Future<Void>> clients;
-	for( int i = 0; i < 30; i++ )
-		clients.push_back( testClient( interfs, &sent ) );
-	clients.push_back( logger( &sent ) );
+	for( int i = 0; i < servers.size(); i++ )
+		for( int j = 0; j < SERVER_KNOBS->NETWORK_TEST_CLIENT_COUNT; j++ )
+			clients.push_back( testClient( NetworkTestInterface( servers[i] ), &stats ) );
 
-	Void _ = wait( waitForAll( clients ) );
+	Void _ = wait( logger( &stats ) );
 	return Void();
 }
\ No newline at end of file
@@ -7279,6 +7279,54 @@ SQLITE_PRIVATE int sqlite3BtreeDeleteRange(BtCursor *begin, BtCursor *end, int*
   }
 }
 
+static int visitInteriorCells(BtCursor *pCur, int depth, int (*xCell)(BtCursor*, void*), void *pArg) {
+  MemPage *page = pCur->apPage[pCur->iPage];
+  int cell, rc;
+  Pgno child;
+
+  if (page->leaf) return SQLITE_OK;
+
+  // Visit each child subtree (down to depth levels) and then the cell which follows it, so cells are visited in key order
+  for(cell = 0; cell <= page->nCell; cell++) {
+    pCur->aiIdx[pCur->iPage] = cell;
+    pCur->info.nSize = 0;
+    pCur->validNKey = 0;
+    if (depth > 1) {
+      child = cell < page->nCell ? get4byte(findCell(page, cell)) : get4byte(&page->aData[page->hdrOffset+8]);
+      rc = moveToChild(pCur, child);
+      if (rc) return rc;
+      rc = visitInteriorCells(pCur, depth-1, xCell, pArg);
+      if (rc) return rc;
+      moveToParent(pCur);
+    }
+    if (cell < page->nCell) {
+      rc = xCell(pCur, pArg);
+      if (rc) return rc;
+    }
+  }
+  return SQLITE_OK;
+}
+
+/*
+** Call xCell, with the cursor pointing at the cell, for each cell of the interior
+** pages in the top depth levels of the tree, in key order.  Adjacent cells bound
+** subtrees of roughly equal size, so they make good points at which to split a
+** scan of the tree.  Leaf pages are never visited unless depth reaches them.
+** If xCell returns nonzero the visit stops and that value is returned.  The
+** cursor is left pointing at the root page.
+*/
+SQLITE_PRIVATE int sqlite3BtreeVisitInteriorCells(BtCursor *pCur, int depth, int (*xCell)(BtCursor*, void*), void *pArg) {
+  int rc, rc2;
+
+  rc = moveToRoot(pCur);
+  if (rc) return rc;
+  if (pCur->eState != CURSOR_VALID) return SQLITE_OK;  // empty tree
+
+  rc = visitInteriorCells(pCur, depth, xCell, pArg);
+  rc2 = moveToRoot(pCur);
+  return rc ? rc : rc2;
+}
+
 
 /*
 ** Delete the entry that the cursor is pointing to.  The cursor
@@ -748,6 +748,7 @@ struct sqlite3_io_methods {
 #define SQLITE_FCNTL_CHUNK_SIZE       6
 #define SQLITE_FCNTL_FILE_POINTER     7
 #define SQLITE_FCNTL_SYNC_OMITTED     8
+#define SQLITE_FCNTL_BULK_READ        0x46444201  /* FDB extension: *(int*)pArg nonzero reads around the page cache */
 
 
 /*
@@ -32,6 +32,7 @@
 #include "fdbclient/Notified.h"
 #include "fdbclient/MasterProxyInterface.h"
 #include "fdbclient/DatabaseContext.h"
+#include "fdbclient/BackupAgent.h"
 #include "WorkerInterface.h"
 #include "TLogInterface.h"
 #include "MoveKeys.h"
@@ -40,6 +41,8 @@
 #include "IKeyValueStore.h"
 #include "fdbclient/VersionedMap.h"
 #include "StorageMetrics.h"
+#include "HotKeySketch.h"
+#include "ValueCompression.h"
 #include "fdbrpc/sim_validation.h"
 #include "ServerDBInfo.h"
 #include "fdbrpc/Smoother.h"
@@ -48,6 +51,7 @@
 #include "RecoveryState.h"
 #include "LogProtocolMessage.h"
 #include "flow/TDMetric.actor.h"
+#include "fdbrpc/AsyncFileCached.actor.h"
 
 using std::make_pair;
 
@@ -64,13 +68,15 @@ public:
 	bool isValue() const { return !isClear; };
 	bool isClearTo() const { return isClear; }
 
-	ValueRef const& getValue() const { ASSERT( isValue() ); return item; };
-	KeyRef const&  getEndKey() const { ASSERT(isClearTo()); return item; };
+	ValueRef getValue() const { ASSERT( isValue() ); return ValueRef(item, length); };
+	KeyRef getEndKey() const { ASSERT(isClearTo()); return KeyRef(item, length); };
 
 private:
-	ValueOrClearToRef( StringRef item, bool isClear ) : item(item), isClear(isClear) {}
+	ValueOrClearToRef( StringRef item, bool isClear ) : item(item.begin()), length(item.size()), isClear(isClear) {}
 
-	StringRef item;
+	// Not a StringRef, so that isClear fits in its padding and this is 16 bytes rather than 24
+	const uint8_t* item;
+	int length;
 	bool isClear;
 };
 
@@ -142,8 +148,45 @@ struct ShardInfo : ReferenceCounted<ShardInfo>, NonCopyable {
 	}
 };
 
+// Storage server metadata (under PERSIST_PREFIX) is never compressed, so that restoreDurableState() can read it before it knows
+// whether values are
+static bool isCompressibleKey( KeyRef key ) { return !key.startsWith( LiteralStringRef("\xff\xff") ); }
+
+ACTOR Future<Optional<Value>> decompressedValue( Future<Optional<Value>> stored, int maxLength ) {
+	Optional<Value> v = wait( stored );
+	if( !v.present() )
+		return v;
+	Arena arena;
+	StringRef value = decompressValue( arena, v.get(), maxLength );
+	return Value( value, arena );
+}
+
+ACTOR Future<Standalone<VectorRef<KeyValueRef>>> decompressedRange( Future<Standalone<VectorRef<KeyValueRef>>> stored ) {
+	Standalone<VectorRef<KeyValueRef>> _rows = wait( stored );
+	Standalone<VectorRef<KeyValueRef>> rows = _rows;
+	for(auto& kv : rows)
+		if( isCompressibleKey( kv.key ) )
+			kv.value = decompressValue( rows.arena(), kv.value );
+	return rows;
+}
+
+struct DecompressedSnapshot : IKeyValueSnapshot, NonCopyable {
+	Reference<IKeyValueSnapshot> snapshot;
+
+	explicit DecompressedSnapshot( Reference<IKeyValueSnapshot> snapshot ) : snapshot(snapshot) {}
+
+	virtual Future<Optional<Value>> readValue( KeyRef key ) {
+		if( !isCompressibleKey( key ) )
+			return snapshot->readValue( key );
+		return decompressedValue( snapshot->readValue( key ), std::numeric_limits<int>::max() );
+	}
+	virtual Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30, IKeyValueStore::ReadType type = IKeyValueStore::READ_NORMAL ) {
+		return decompressedRange( snapshot->readRange( keys, rowLimit, byteLimit, type ) );
+	}
+};
+
 struct StorageServerDisk {
-	explicit StorageServerDisk( struct StorageServer* data, IKeyValueStore* storage ) : data(data), storage(storage) {}
+	explicit StorageServerDisk( struct StorageServer* data, IKeyValueStore* storage ) : data(data), storage(storage), compressValues(false) {}
 
 	void makeNewStorageServerDurable();
 	bool makeVersionMutationsDurable( Version& prevStorageVersion, Version newStorageVersion, int64_t& bytesLeft );
@@ -154,15 +197,41 @@ struct StorageServerDisk {
 
 	void writeMutation( MutationRef mutation );
 	void writeKeyValue( KeyValueRef kv );
+	void writeSortedKeyValues( VectorRef<KeyValueRef> sortedKeyValues, const Arena* arena );
 	void clearRange( KeyRangeRef keys );
 
-	Future<Void> commit() { return storage->commit(); }
+	Future<Void> commit();
 
 	// SOMEDAY: Put readNextKeyInclusive in IKeyValueStore
 	Future<Key> readNextKeyInclusive( KeyRef key ) { return readFirstKey(storage, KeyRangeRef(key, allKeys.end)); }
-	Future<Optional<Value>> readValue( KeyRef key, Optional<UID> debugID = Optional<UID>() ) { return storage->readValue(key, debugID); }
-	Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID = Optional<UID>() ) { return storage->readValuePrefix(key, maxLength, debugID); }
-	Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30 ) { return storage->readRange(keys, rowLimit, byteLimit); }
+	Future<Optional<Value>> readValue( KeyRef key, Optional<UID> debugID = Optional<UID>() ) {
+		if( !compressValues || !isCompressibleKey( key ) )
+			return storage->readValue(key, debugID);
+		return decompressedValue( storage->readValue(key, debugID), std::numeric_limits<int>::max() );
+	}
+	Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID = Optional<UID>() ) {
+		if( !compressValues || !isCompressibleKey( key ) )
+			return storage->readValuePrefix(key, maxLength, debugID);
+		// The prefix of a compressed value isn't the compressed prefix, but only as much as maxLength of it is inflated
+		return decompressedValue( storage->readValue(key, debugID), maxLength );
+	}
+	Future<Standalone<VectorRef<KeyValueRef>>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30, IKeyValueStore::ReadType type = IKeyValueStore::READ_NORMAL ) {
+		if( !compressValues )
+			return storage->readRange(keys, rowLimit, byteLimit, type);
+		return decompressedRange( storage->readRange(keys, rowLimit, byteLimit, type) );
+	}
+
+	bool canOpenSnapshot() { return storage->canOpenSnapshot(); }
+	Reference<IKeyValueSnapshot> openSnapshot() {
+		Reference<IKeyValueSnapshot> snapshot = storage->openSnapshot();
+		if( compressValues && snapshot )
+			return Reference<IKeyValueSnapshot>( new DecompressedSnapshot( snapshot ) );
+		return snapshot;
+	}
+
+	// Set from the durable state at recovery, or when a new storage server is created with SERVER_KNOBS->STORAGE_VALUE_COMPRESSION
+	void setCompressValues( bool compress ) { compressValues = compress; }
+	bool getCompressValues() const { return compressValues; }
 
 	KeyValueStoreType getKeyValueStoreType() { return storage->getType(); }
 	StorageBytes getStorageBytes() { return storage->getStorageBytes(); }
@@ -170,8 +239,10 @@ struct StorageServerDisk {
 private:
 	struct StorageServer* data;
 	IKeyValueStore* storage;
+	bool compressValues;
 
 	void writeMutations( MutationListRef mutations, Version debugVersion, const char* debugContext );
+	void setStored( KeyValueRef kv );
 
 	ACTOR static Future<Key> readFirstKey( IKeyValueStore* storage, KeyRangeRef range ) {
 		Standalone<VectorRef<KeyValueRef>> r = wait( storage->readRange( range, 1 ) );
@@ -180,6 +251,123 @@ private:
 	}
 };
 
+// A least recently used cache of values recently read from storage, so that the reads of a few very hot keys that are not in versionedData
+// don't each pay for an IKeyValueStore lookup.  StorageServerDisk invalidates the keys covered by every write, and again once the commit
+// including the write completes, since until then storage may go on returning the old value.  A read that was in flight when one of its
+// keys was invalidated is not cached.
+class HotKeyCache : NonCopyable {
+public:
+	explicit HotKeyCache( int64_t maxBytes ) : maxBytes(maxBytes), bytes(0), lastReadID(0) {}
+
+	bool enabled() const { return maxBytes > 0; }
+	int64_t getBytes() const { return bytes; }
+	int64_t getMaxBytes() const { return maxBytes; }
+
+	// Evicts as much as it takes to fit.  Cannot enable or disable the cache.
+	void setMaxBytes( int64_t newMaxBytes ) {
+		if( !enabled() )
+			return;
+		maxBytes = std::max<int64_t>( 1, newMaxBytes );
+		while( bytes > maxBytes && lru.size() )
+			erase( items.find( lru.back() ) );
+	}
+	int size() const { return items.size(); }
+
+	// Returns the cached value of key, if there is one
+	Optional<Optional<Value>> get( KeyRef key ) {
+		auto i = items.find( key );
+		if( i == items.end() || i->second.readID )
+			return Optional<Optional<Value>>();
+		lru.splice( lru.begin(), lru, i->second.lru );
+		return i->second.value;
+	}
+
+	// Call before reading key from storage, and pass the result to finishRead() along with the value read
+	uint64_t startRead( KeyRef key ) {
+		if( !enabled() )
+			return 0;
+		auto i = items.find( key );
+		if( i == items.end() ) {
+			i = items.insert( std::make_pair( Key(key), Item() ) ).first;
+			lru.push_front( i->first );
+			i->second.lru = lru.begin();
+			bytes += itemBytes( i );
+		} else {
+			lru.splice( lru.begin(), lru, i->second.lru );
+		}
+		i->second.readID = ++lastReadID;
+		return lastReadID;
+	}
+
+	void finishRead( KeyRef key, uint64_t readID, Optional<Value> const& value ) {
+		if( !readID )
+			return;
+		auto i = items.find( key );
+		if( i == items.end() || i->second.readID != readID )
+			return;
+		bytes -= itemBytes( i );
+		i->second.readID = 0;
+		i->second.value = value;
+		bytes += itemBytes( i );
+		while( bytes > maxBytes && lru.size() )
+			erase( items.find( lru.back() ) );
+	}
+
+	void invalidate( KeyRangeRef keys ) {
+		if( !enabled() )
+			return;
+		eraseRange( keys );
+		uncommittedWrites.push_back_deep( uncommittedWrites.arena(), keys );
+	}
+	void invalidate( KeyRef key ) {
+		if( !enabled() )
+			return;
+		auto i = items.find( key );
+		if( i != items.end() )
+			erase( i );
+		KeyRef k( uncommittedWrites.arena(), key );
+		uncommittedWrites.push_back( uncommittedWrites.arena(), KeyRangeRef( k, keyAfter( k, uncommittedWrites.arena() ) ) );
+	}
+
+	// Returns the ranges invalidated since the last call, to be passed to invalidateCommitted() once a commit started after this call completes
+	Standalone<VectorRef<KeyRangeRef>> takeUncommittedWrites() {
+		Standalone<VectorRef<KeyRangeRef>> writes;
+		std::swap( writes, uncommittedWrites );
+		return writes;
+	}
+	void invalidateCommitted( VectorRef<KeyRangeRef> const& writes ) {
+		for(auto& w : writes)
+			eraseRange( w );
+	}
+
+private:
+	struct Item {
+		Optional<Value> value;
+		uint64_t readID;		// Nonzero while a read from storage is in flight, in which case value is meaningless
+		std::list<Key>::iterator lru;
+		Item() : readID(0) {}
+	};
+	typedef std::map<Key, Item> Items;
+
+	int64_t maxBytes, bytes;
+	uint64_t lastReadID;
+	Items items;
+	std::list<Key> lru;		// Most recently used first
+	Standalone<VectorRef<KeyRangeRef>> uncommittedWrites;
+
+	static int itemBytes( Items::iterator i ) { return 2*i->first.size() + (i->second.value.present() ? i->second.value.get().size() : 0) + 128; }
+
+	void eraseRange( KeyRangeRef keys ) {
+		for(auto i = items.lower_bound( keys.begin ); i != items.end() && i->first < keys.end; )
+			erase( i++ );
+	}
+	void erase( Items::iterator i ) {
+		bytes -= itemBytes( i );
+		lru.erase( i->second.lru );
+		items.erase( i );
+	}
+};
+
 struct UpdateEagerReadInfo {
 	vector<KeyRef> keyBegin;
 	vector<Key> keyEnd; // these are for ClearRange
@@ -223,6 +411,54 @@ struct UpdateEagerReadInfo {
 	}
 };
 
+// Eager reads for the next batch of mutations, issued while the current batch was still waiting on its own.  They can be
+// used only if no fetchKeys changed the shards and no storage commit became effective (see eagerReadEpoch) in between.
+struct PrefetchedEagerReads : ReferenceCounted<PrefetchedEagerReads> {
+	Reference<ILogSystem::IPeekCursor> messages;  // keeps the keys in eager alive
+	UpdateEagerReadInfo eager;
+	uint64_t shardChangeCounter;
+	uint64_t eagerReadEpoch;
+	Future<Void> reads;  // declared after eager so that it is cancelled first
+};
+
+// A batch of messages from the log, deserialized once for both the eager reads and the application of its mutations.  The
+// mutations point into the messages of the cursor it was decoded from, which it keeps alive.
+struct DecodedLogBatch {
+	struct Message {
+		LogMessageVersion version;
+		bool isProtocol;  // A LogProtocolMessage rather than a mutation
+		uint64_t protocol;  // The protocol of the messages after a LogProtocolMessage
+		MutationRef mutation;
+	};
+
+	Reference<ILogSystem::IPeekCursor> messages;
+	std::vector<Message> decoded;
+	LogMessageVersion end;  // The version of the cursor after the last message
+
+	void decode( Reference<ILogSystem::IPeekCursor> const& cursor, uint64_t logProtocol ) {
+		messages = cursor->cloneNoMore();
+		messages->setProtocolVersion(logProtocol);
+		decoded.clear();
+		for (; messages->hasMessage(); messages->nextMessage()) {
+			ArenaReader& reader = *messages->reader();
+			Message m;
+			m.version = messages->version();
+			m.protocol = 0;
+			m.isProtocol = LogProtocolMessage::isNextIn(reader);
+			if (m.isProtocol) {
+				LogProtocolMessage lpm;
+				reader >> lpm;
+				m.protocol = reader.protocolVersion();
+				messages->setProtocolVersion(m.protocol);
+			}
+			else
+				reader >> m.mutation;
+			decoded.push_back(m);
+		}
+		end = messages->version();
+	}
+};
+
 const int VERSION_OVERHEAD = 64 + sizeof(Version) + sizeof(Standalone<VersionUpdateRef>) + //mutationLog, 64b overhead for map
 							 2 * (64 + sizeof(Version) + sizeof(Reference<VersionedMap<KeyRef, ValueOrClearToRef>::PTreeT>)); //versioned map [ x2 for createNewVersion(version+1) ], 64b overhead for map
 static int mvccStorageBytes( MutationRef const& m ) { return VersionedMap<KeyRef, ValueOrClearToRef>::overheadPerItem * 2 + (MutationRef::OVERHEAD_BYTES + m.param1.size() + m.param2.size()) * 2; }
@@ -322,6 +558,8 @@ public:
 	}
 
 	StorageServerDisk storage;
+	HotKeyCache hotKeyCache;  // Of values in storage, invalidated by StorageServerDisk as it writes
+	HotKeySketch readSketch, writeSketch;  // Of the keys read (the begin keys of range reads) and mutated, for status
 
 	KeyRangeMap< Reference<ShardInfo> > shards;
 	uint64_t shardChangeCounter;      // max( shards->changecounter )
@@ -359,6 +597,50 @@ public:
 
 	AsyncMap<Key,bool> watches;
 	int64_t watchBytes;
+
+	// Durable commit sizing (see updateStorage)
+	int64_t desiredCommitBytes;
+	double commitBytesPerSecond;  // Smoothed rate at which recent durable commits have written bytes
+	int64_t lastCommitBytes;
+	double lastCommitDuration;
+
+	int64_t mvccLimitBytes;  // The e-brake: update() waits while queueSize() is at least this.  Adjusted by memoryGovernor().
+
+	// Versions that clients have pinned (see PinSnapshotRequest).  updateStorage() stops at each of them and takes a snapshot of
+	// storage there, which serves reads at that version after it falls out of the MVCC window.
+	struct PinnedSnapshot {
+		Reference<IKeyValueSnapshot> snapshot;  // Invalid until storage reaches the version
+		Standalone<VectorRef<KeyRangeRef>> readable;  // What was readable from storage at the version, sorted and coalesced
+		double expires;
+	};
+	std::map<Version, PinnedSnapshot> pinnedSnapshots;
+
+	// Returns the snapshot of storage at a pinned version, or an invalid reference if version has not been pinned or storage has
+	// not yet reached it.  Throws wrong_shard_server if keys were not all readable at the version.
+	Reference<IKeyValueSnapshot> getPinnedSnapshot( Version version, KeyRangeRef keys ) {
+		auto pin = pinnedSnapshots.find( version );
+		if( pin == pinnedSnapshots.end() || !pin->second.snapshot )
+			return Reference<IKeyValueSnapshot>();
+		auto& readable = pin->second.readable;
+		auto r = std::upper_bound( readable.begin(), readable.end(), keys.begin, []( KeyRef const& k, KeyRangeRef const& range ) { return k < range.end; } );
+		if( r == readable.end() || !r->contains( keys ) )
+			throw wrong_shard_server();
+		return pin->second.snapshot;
+	}
+
+	// Watch requests for the same key and value share one server side watch, which replies to all of them
+	struct SharedWatch : ReferenceCounted<SharedWatch>, NonCopyable {
+		Optional<Value> value;
+		Future<Version> watch;
+		int waiters;
+
+		explicit SharedWatch( Optional<Value> const& value ) : value(value), waiters(1) {}
+	};
+	std::map<Key, Reference<SharedWatch>> sharedWatches;
+
+	// Watch triggers from the mutations applied by update(), fired once per batch of versions
+	std::vector<KeyRange> pendingWatchTriggers;
+
 	AsyncVar<bool> noRecentUpdates;
 	double lastUpdate;
 
@@ -368,9 +650,12 @@ public:
 
 	// defined only during splitMutations()/addMutation()
 	UpdateEagerReadInfo *updateEagerReads;
+	Reference<PrefetchedEagerReads> prefetchedEagerReads;
 
 	FlowLock durableVersionLock;
+	uint64_t eagerReadEpoch;  // incremented by updateStorage() while holding durableVersionLock
 	FlowLock fetchKeysParallelismLock;
+	FlowLock exportRangeLock;
 	vector< Promise<FetchInjectionInfo*> > readyFetchKeys;
 
 	int64_t instanceID;
@@ -386,6 +671,10 @@ public:
 	bool debug_inApplyUpdate;
 	double debug_lastValidateTime;
 
+	// How long the last read of each ReadPriority waited for its turn in the run loop, and when it got it
+	double readQueueLatency[ReadPriorityCount];
+	double readQueueLatencyTime[ReadPriorityCount];
+
 	int maxQueryQueue;
 	int getAndResetMaxQueryQueueSize() {
 		int val = maxQueryQueue;
@@ -395,17 +684,29 @@ public:
 
 	struct Counters {
 		CounterCollection cc;
-		Counter allQueries, getKeyQueries, getValueQueries, getRangeQueries, finishedQueries, rowsQueried, bytesQueried;
+		Counter allQueries, getKeyQueries, getValueQueries, getValuesQueries, getRangeQueries, getRangeStreamQueries, getRangeChecksumQueries, getRangeAggregateQueries, exportRangeQueries, finishedQueries, rowsQueried, bytesQueried;
 		Counter bytesInput, bytesDurable, bytesFetched,
 			mutationBytes;  // Like bytesInput but without MVCC accounting
 		Counter updateBatches, updateVersions;
 		Counter loops;
+		Counter hotKeyCacheHits, hotKeyCacheMisses;
+		Counter watchQueries, coalescedWatches;
+		Counter fusedAtomicOps;
+		Counter batchPriorityQueries, shedQueries;
+		Counter durableCommits, bytesCommitted;
+		Counter compressionInputBytes, compressionOutputBytes;  // Of the values written to storage, before and after compression
+		LatencySample readLatency;  // Of successful getValue requests
 
 		Counters(StorageServer* self)
 			: cc("StorageServer", self->thisServerID.toString()),
 			getKeyQueries("getKeyQueries", cc),
 			getValueQueries("getValueQueries",cc),
+			getValuesQueries("getValuesQueries",cc),
 			getRangeQueries("getRangeQueries", cc),
+			getRangeStreamQueries("getRangeStreamQueries", cc),
+			getRangeChecksumQueries("getRangeChecksumQueries", cc),
+			getRangeAggregateQueries("getRangeAggregateQueries", cc),
+			exportRangeQueries("exportRangeQueries", cc),
 			allQueries("QueryQueue", cc),
 			finishedQueries("finishedQueries", cc),
 			rowsQueried("rowsQueried", cc),
@@ -416,7 +717,19 @@ public:
 			mutationBytes("mutationBytes", cc),
 			updateBatches("updateBatches", cc),
 			updateVersions("updateVersions", cc),
-			loops("loops", cc)
+			loops("loops", cc),
+			hotKeyCacheHits("hotKeyCacheHits", cc),
+			hotKeyCacheMisses("hotKeyCacheMisses", cc),
+			watchQueries("watchQueries", cc),
+			coalescedWatches("coalescedWatches", cc),
+			fusedAtomicOps("fusedAtomicOps", cc),
+			batchPriorityQueries("batchPriorityQueries", cc),
+			shedQueries("shedQueries", cc),
+			durableCommits("durableCommits", cc),
+			bytesCommitted("bytesCommitted", cc),
+			compressionInputBytes("compressionInputBytes", cc),
+			compressionOutputBytes("compressionOutputBytes", cc),
+			readLatency("readLatency", cc)
 		{
 			specialCounter(cc, "lastTLogVersion", [self](){return self->lastTLogVersion; });
 			specialCounter(cc, "version", [self](){return self->version.get(); });
@@ -428,8 +741,18 @@ public:
 			specialCounter(cc, "FetchKeysWaiting", [self](){return self->fetchKeysParallelismLock.waiters(); });
 
 			specialCounter(cc, "QueryQueueMax", [self](){return self->getAndResetMaxQueryQueueSize(); });
+			specialCounter(cc, "ReadQueueLatency", [self](){return self->readQueueLatency[ReadPriorityDefault]; });
+			specialCounter(cc, "BatchReadQueueLatency", [self](){return self->readQueueLatency[ReadPriorityBatch]; });
 
 			specialCounter(cc, "bytesStored", [self](){return self->metrics.byteSample.getEstimate(allKeys); });
+			specialCounter(cc, "hotKeyCacheBytes", [self](){ return self->hotKeyCache.getBytes(); });
+			specialCounter(cc, "hotKeyCacheKeys", [self](){ return self->hotKeyCache.size(); });
+			specialCounter(cc, "activeWatches", [self](){ return self->sharedWatches.size(); });
+			specialCounter(cc, "watchBytes", [self](){ return self->watchBytes; });
+
+			specialCounter(cc, "desiredCommitBytes", [self](){ return self->desiredCommitBytes; });
+			specialCounter(cc, "lastCommitBytes", [self](){ return self->lastCommitBytes; });
+			specialCounter(cc, "lastCommitDuration", [self](){ return self->lastCommitDuration; });
 
 			specialCounter(cc, "kvstoreBytesUsed", [self](){ return self->storage.getStorageBytes().used; });
 			specialCounter(cc, "kvstoreBytesFree", [self](){ return self->storage.getStorageBytes().free; });
@@ -440,13 +763,15 @@ public:
 
 	StorageServer(IKeyValueStore* storage, Reference<AsyncVar<ServerDBInfo>> const& db, StorageServerInterface const& ssi)
 		:	instanceID(g_random->randomUniqueID().first()),
-			storage(this, storage), db(db),
+			storage(this, storage), hotKeyCache(SERVER_KNOBS->STORAGE_HOT_KEY_CACHE_BYTES), db(db),
 			lastTLogVersion(0), lastVersionWithData(0), restoredVersion(0),
-			updateEagerReads(0),
+			updateEagerReads(0), eagerReadEpoch(0),
 			shardChangeCounter(0),
-			fetchKeysParallelismLock(SERVER_KNOBS->FETCH_KEYS_PARALLELISM_BYTES),
+			fetchKeysParallelismLock(SERVER_KNOBS->FETCH_KEYS_PARALLELISM_BYTES), exportRangeLock(SERVER_KNOBS->EXPORT_RANGE_PARALLELISM),
 			shuttingDown(false), readReplyRate(SERVER_KNOBS->STORAGE_LOGGING_DELAY / 2.0),
 			debug_inApplyUpdate(false), debug_lastValidateTime(0), watchBytes(0),
+			desiredCommitBytes(SERVER_KNOBS->STORAGE_COMMIT_BYTES), commitBytesPerSecond(0), lastCommitBytes(0), lastCommitDuration(0),
+			mvccLimitBytes(SERVER_KNOBS->STORAGE_HARD_LIMIT_BYTES),
 			logProtocol(0), counters(this), tag(invalidTag), maxQueryQueue(0), thisServerID(ssi.id()),
 			readQueueSizeMetric(LiteralStringRef("StorageServer.ReadQueueSize")),
 			behind(false), byteSampleClears(false, LiteralStringRef("\xff\xff\xff")), noRecentUpdates(false), lastUpdate(now())
@@ -460,6 +785,11 @@ public:
 		newestDirtyVersion.insert(allKeys, invalidVersion);
 		addShard( ShardInfo::newNotAssigned( allKeys ) );
 
+		for(int p = 0; p < ReadPriorityCount; p++) {
+			readQueueLatency[p] = 0;
+			readQueueLatencyTime[p] = 0;
+		}
+
 		cx = openDBOnServer(db, TaskDefaultEndpoint, false, true);
 	}
 	//~StorageServer() { fclose(log); }
@@ -624,14 +954,7 @@ void validate(StorageServer* data, bool force = false) {
 
 ///////////////////////////////////// Queries /////////////////////////////////
 #pragma region Queries
-ACTOR Future<Version> waitForVersion( StorageServer* data, Version version ) {
-	// This could become an Actor transparently, but for now it just does the lookup
-	if (version == latestVersion)
-		version = std::max(Version(1), data->version.get());
-	if (version < data->oldestVersion.get() || version <= 0) throw transaction_too_old();
-	else if (version <= data->version.get())
-		return version;
-
+ACTOR Future<Version> waitForVersionActor( StorageServer* data, Version version ) {
 	if(data->behind && version > data->version.get()) {
 		throw process_behind();
 	}
@@ -656,12 +979,25 @@ ACTOR Future<Version> waitForVersion( StorageServer* data, Version version ) {
 	}
 }
 
-ACTOR Future<Version> waitForVersionNoTooOld( StorageServer* data, Version version ) {
-	// This could become an Actor transparently, but for now it just does the lookup
+// Nearly every read is at a version the storage server already has, so the common case returns a ready future without
+// allocating and running an actor.  With allowPinned, a version older than oldestVersion is accepted if there is a pinned
+// snapshot of it to read from.
+Future<Version> waitForVersion( StorageServer* data, Version version, bool allowPinned = false ) {
 	if (version == latestVersion)
 		version = std::max(Version(1), data->version.get());
-	if (version <= data->version.get())
+	if (allowPinned && version < data->oldestVersion.get() && version > 0) {
+		auto pin = data->pinnedSnapshots.find( version );
+		if( pin != data->pinnedSnapshots.end() && pin->second.snapshot )
+			return version;
+	}
+	if (version < data->oldestVersion.get() || version <= 0)
+		return transaction_too_old();
+	else if (version <= data->version.get())
 		return version;
+	return waitForVersionActor( data, version );
+}
+
+ACTOR Future<Version> waitForVersionNoTooOldActor( StorageServer* data, Version version ) {
 	choose {
 		when ( Void _ = wait( data->version.whenAtLeast(version) ) ) {
 			return version;
@@ -677,23 +1013,78 @@ ACTOR Future<Version> waitForVersionNoTooOld( StorageServer* data, Version versi
 	}
 }
 
+Future<Version> waitForVersionNoTooOld( StorageServer* data, Version version ) {
+	if (version == latestVersion)
+		version = std::max(Version(1), data->version.get());
+	if (version <= data->version.get())
+		return version;
+	return waitForVersionNoTooOldActor( data, version );
+}
+
+ACTOR Future<Optional<Value>> readValueAndCache( StorageServer* data, Key key, uint64_t readID, Optional<UID> debugID ) {
+	Optional<Value> value = wait( data->storage.readValue( key, debugID ) );
+	data->hotKeyCache.finishRead( key, readID, value );
+	return value;
+}
+
+// Reads key from storage, or from hotKeyCache if it was read recently
+Future<Optional<Value>> readValueCached( StorageServer* data, KeyRef key, Optional<UID> debugID ) {
+	if( !data->hotKeyCache.enabled() )
+		return data->storage.readValue( key, debugID );
+
+	Optional<Optional<Value>> cached = data->hotKeyCache.get( key );
+	if( cached.present() ) {
+		++data->counters.hotKeyCacheHits;
+		return cached.get();
+	}
+	++data->counters.hotKeyCacheMisses;
+	return readValueAndCache( data, key, data->hotKeyCache.startRead( key ), debugID );
+}
+
+// Waits for a read's turn in the run loop.  Batch priority reads run below every default priority read, and a read is shed with
+// process_behind (so the client tries another replica, and once it has tried them all retries after FUTURE_VERSION_RETRY_DELAY)
+// while the last read of its priority waited longer than the target for its turn.  If no read of that priority has been admitted
+// for that long, the measurement is stale and reads are admitted again.
+ACTOR Future<Void> waitForReadTurn( StorageServer* data, uint8_t readPriority ) {
+	state int priority = readPriority == ReadPriorityBatch ? ReadPriorityBatch : ReadPriorityDefault;
+	state double start = now();
+	double target = priority == ReadPriorityBatch ? SERVER_KNOBS->STORAGE_BATCH_READ_QUEUE_LATENCY_TARGET : SERVER_KNOBS->STORAGE_READ_QUEUE_LATENCY_TARGET;
+
+	if( priority == ReadPriorityBatch )
+		++data->counters.batchPriorityQueries;
+	if( data->readQueueLatency[priority] > target && start - data->readQueueLatencyTime[priority] < target ) {
+		TEST(priority == ReadPriorityBatch); // Batch priority read shed
+		TEST(priority == ReadPriorityDefault); // Default priority read shed
+		++data->counters.shedQueries;
+		throw process_behind();
+	}
+
+	// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
+	// so we need to downgrade here
+	Void _ = wait( delay(0, priority == ReadPriorityBatch ? TaskLowPriorityRead : TaskDefaultEndpoint) );
+	data->readQueueLatency[priority] = now() - start;
+	data->readQueueLatencyTime[priority] = now();
+	return Void();
+}
+
 ACTOR Future<Void> getValueQ( StorageServer* data, GetValueRequest req ) {
-	state double startTime = timer();
+	state double startTime = now();
 	try {
 		// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
 		// so we need to downgrade here
 		++data->counters.getValueQueries;
 		++data->counters.allQueries;
 		++data->readQueueSizeMetric;
+		data->readSketch.add( req.key );
 		data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
 
-		Void _ = wait( delay(0, TaskDefaultEndpoint) );
+		Void _ = wait( waitForReadTurn( data, req.priority ) );
 
 		if( req.debugID.present() )
 			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValueQ.DoRead"); //.detail("TaskID", g_network->getCurrentTask());
 
 		state Optional<Value> v;
-		state Version version = wait( waitForVersion( data, req.version ) );
+		state Version version = wait( waitForVersion( data, req.version, true ) );
 		if( req.debugID.present() )
 			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValueQ.AfterVersion"); //.detail("TaskID", g_network->getCurrentTask());
 
@@ -705,31 +1096,36 @@ ACTOR Future<Void> getValueQ( StorageServer* data, GetValueRequest req ) {
 		}
 
 		state int path = 0;
-		auto i = data->data().at(version).lastLessOrEqual(req.key);
-		if (i && i->isValue() && i.key() == req.key) {
-			v = (Value)i->getValue();
-			path = 1;
-		} else if (!i || !i->isClearTo() || i->getEndKey() <= req.key) {
-			path = 2;
-			Optional<Value> vv = wait( data->storage.readValue( req.key, req.debugID ) );
-			// Validate that while we were reading the data we didn't lose the version or shard
-			if (version < data->storageVersion()) {
-				TEST(true); // transaction_too_old after readValue
+		if (version < data->oldestVersion.get()) {
+			// A pinned version that is out of the MVCC window
+			state Reference<IKeyValueSnapshot> snapshot = data->getPinnedSnapshot( version, KeyRangeRef( req.key, keyAfter(req.key) ) );
+			if (!snapshot)
 				throw transaction_too_old();
-			}
-			data->checkChangeCounter(changeCounter, req.key);
+			path = 3;
+			Optional<Value> vv = wait( snapshot->readValue( req.key ) );
 			v = vv;
+		} else {
+			auto i = data->data().at(version).lastLessOrEqual(req.key);
+			if (i && i->isValue() && i.key() == req.key) {
+				v = (Value)i->getValue();
+				path = 1;
+			} else if (!i || !i->isClearTo() || i->getEndKey() <= req.key) {
+				path = 2;
+				Optional<Value> vv = wait( readValueCached( data, req.key, req.debugID ) );
+				// Validate that while we were reading the data we didn't lose the version or shard
+				if (version < data->storageVersion()) {
+					TEST(true); // transaction_too_old after readValue
+					throw transaction_too_old();
+				}
+				data->checkChangeCounter(changeCounter, req.key);
+				v = vv;
+			}
 		}
 
 		debugMutation("ShardGetValue", version, MutationRef(MutationRef::DebugKey, req.key, v.present()?v.get():LiteralStringRef("<null>")));
 		debugMutation("ShardGetPath", version, MutationRef(MutationRef::DebugKey, req.key, path==0?LiteralStringRef("0"):path==1?LiteralStringRef("1"):LiteralStringRef("2")));
 
-		/*
-		StorageMetrics m;
-		m.bytesPerKSecond = req.key.size() + (v.present() ? v.get().size() : 0);
-		m.iosPerKSecond = 1;
-		data->metrics.notify(req.key, m);
-		*/
+		data->metrics.notifyBytesRead( req.key, req.key.size() + (v.present() ? v.get().size() : 0) );
 
 		data->readReplyRate.addDelta(1);
 
@@ -744,6 +1140,7 @@ ACTOR Future<Void> getValueQ( StorageServer* data, GetValueRequest req ) {
 		GetValueReply reply(v);
 		reply.penalty = data->getPenalty();
 		req.reply.send(reply);
+		data->counters.readLatency.addMeasurement(now() - startTime);
 	} catch (Error& e) {
 		if (e.code() == error_code_internal_error || e.code() == error_code_actor_cancelled) throw;
 		req.reply.sendError(e);
@@ -755,82 +1152,214 @@ ACTOR Future<Void> getValueQ( StorageServer* data, GetValueRequest req ) {
 	return Void();
 };
 
-ACTOR Future<Void> watchValue_impl( StorageServer* data, WatchValueRequest req ) {
+ACTOR Future<Void> getValuesQ( StorageServer* data, GetValuesRequest req ) {
+	// Like getValueQ for a sorted batch of keys: one waitForVersion, one pass over the versioned data in key order, and the
+	// keys which fall through to the storage engine read together (in key order)
 	try {
-		if( req.debugID.present() )
-			g_traceBatch.addEvent("WatchValueDebug", req.debugID.get().first(), "watchValueQ.Before"); //.detail("TaskID", g_network->getCurrentTask());
-
-		Version version = wait( waitForVersionNoTooOld( data, req.version ) );
-		if( req.debugID.present() )
-			g_traceBatch.addEvent("WatchValueDebug", req.debugID.get().first(), "watchValueQ.AfterVersion"); //.detail("TaskID", g_network->getCurrentTask());
+		++data->counters.getValuesQueries;
+		data->counters.getValueQueries += req.keys.size();
+		++data->counters.allQueries;
+		++data->readQueueSizeMetric;
+		data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
 
-		loop {
-			try {
-				state Version latest = data->data().latestVersion;
-				state Future<Void> watchFuture = data->watches.onChange(req.key);
-				GetValueRequest getReq( req.key, latest, req.debugID );
-				state Future<Void> getValue = getValueQ( data, getReq ); //we are relying on the delay zero at the top of getValueQ, if removed we need one here
-				GetValueReply reply = wait( getReq.reply.getFuture() );
-				//TraceEvent("watcherCheckValue").detail("key", printable( req.key ) ).detail("value", printable( req.value ) ).detail("currentValue", printable( v ) ).detail("ver", latest);
+		Void _ = wait( waitForReadTurn( data, req.priority ) );
 
-				debugMutation("ShardWatchValue", latest, MutationRef(MutationRef::DebugKey, req.key, reply.value.present() ? StringRef( reply.value.get() ) : LiteralStringRef("<null>") ) );
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.DoRead");
 
-				if( req.debugID.present() )
-					g_traceBatch.addEvent("WatchValueDebug", req.debugID.get().first(), "watchValueQ.AfterRead"); //.detail("TaskID", g_network->getCurrentTask());
+		state Version version = wait( waitForVersion( data, req.version ) );
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.AfterVersion");
 
-				if( reply.value != req.value ) {
-					req.reply.send( latest );
-					return Void();
+		state GetValuesReply reply;
+		if (req.keys.size()) {
+			state uint64_t changeCounter = data->shardChangeCounter;
+			state KeyRange keys = KeyRangeRef( req.keys.front(), keyAfter( req.keys.back() ) );
+
+			if (!data->isReadable(keys))
+				throw wrong_shard_server();
+
+			state std::vector<Optional<ValueRef>> values( req.keys.size() );
+			state std::vector<int> readIndices;
+			state std::vector<Future<Optional<Value>>> reads;
+			{
+				auto view = data->data().at(version);
+				for(int k = 0; k < req.keys.size(); k++) {
+					auto i = view.lastLessOrEqual(req.keys[k]);
+					if (i && i->isValue() && i.key() == req.keys[k]) {
+						values[k] = ValueRef( reply.arena, i->getValue() );
+					} else if (!i || !i->isClearTo() || i->getEndKey() <= req.keys[k]) {
+						readIndices.push_back(k);
+						reads.push_back( readValueCached( data, req.keys[k], req.debugID ) );
+					}
 				}
+			}
 
-				if( data->watchBytes > SERVER_KNOBS->MAX_STORAGE_SERVER_WATCH_BYTES ) {
-					TEST(true); //Too many watches, reverting to polling
-					req.reply.sendError( watch_cancelled() );
-					return Void();
+			if (reads.size()) {
+				Void _ = wait( waitForAll( reads ) );
+				// Validate that while we were reading the data we didn't lose the version or shard
+				if (version < data->storageVersion()) {
+					TEST(true); // transaction_too_old after readValue in getValuesQ
+					throw transaction_too_old();
 				}
+				data->checkChangeCounter(changeCounter, keys);
+				for(int r = 0; r < reads.size(); r++)
+					if (reads[r].get().present())
+						values[readIndices[r]] = ValueRef( reply.arena, reads[r].get().get() );
+			}
 
-				data->watchBytes += ( req.key.expectedSize() + req.value.expectedSize() + 1000 );
-				try {
-					Void _ = wait( watchFuture );
-					data->watchBytes -= ( req.key.expectedSize() + req.value.expectedSize() + 1000 );
-				} catch( Error &e ) {
-					data->watchBytes -= ( req.key.expectedSize() + req.value.expectedSize() + 1000 );
-					throw;
+			reply.arena.dependsOn( req.arena );
+			for(int k = 0; k < req.keys.size(); k++) {
+				debugMutation("ShardGetValue", version, MutationRef(MutationRef::DebugKey, req.keys[k], values[k].present()?values[k].get():LiteralStringRef("<null>")));
+				data->metrics.notifyBytesRead( req.keys[k], req.keys[k].size() + (values[k].present() ? values[k].get().size() : 0) );
+				if (values[k].present()) {
+					reply.data.push_back( reply.arena, KeyValueRef( req.keys[k], values[k].get() ) );
+					data->counters.bytesQueried += values[k].get().size();
 				}
-			} catch( Error &e ) {
-				if( e.code() != error_code_transaction_too_old )
-					throw;
 			}
+			data->counters.rowsQueried += reply.data.size();
 		}
+
+		data->readReplyRate.addDelta(1);
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.AfterRead");
+
+		reply.penalty = data->getPenalty();
+		req.reply.send(reply);
 	} catch (Error& e) {
-		if( e.code() == error_code_internal_error || e.code() == error_code_actor_cancelled ) throw;
+		if (e.code() == error_code_internal_error || e.code() == error_code_actor_cancelled) throw;
 		req.reply.sendError(e);
 	}
+
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+
 	return Void();
 }
 
-ACTOR Future<Void> watchValueQ( StorageServer* data, WatchValueRequest req ) {
-	state Future<Void> watch = watchValue_impl( data, req );
-	state double startTime = now();
-	
+// Returns the first version at which key no longer has value
+ACTOR Future<Version> watchValue_impl( StorageServer* data, Key key, Optional<Value> value, Version minVersion, Optional<UID> debugID ) {
+	if( debugID.present() )
+		g_traceBatch.addEvent("WatchValueDebug", debugID.get().first(), "watchValueQ.Before"); //.detail("TaskID", g_network->getCurrentTask());
+
+	Version version = wait( waitForVersionNoTooOld( data, minVersion ) );
+	if( debugID.present() )
+		g_traceBatch.addEvent("WatchValueDebug", debugID.get().first(), "watchValueQ.AfterVersion"); //.detail("TaskID", g_network->getCurrentTask());
+
 	loop {
-		double timeoutDelay = -1;
-		if(data->noRecentUpdates.get()) {
-			timeoutDelay = std::max(CLIENT_KNOBS->FAST_WATCH_TIMEOUT - (now() - startTime), 0.0);
-		} else if(!BUGGIFY) {
-			timeoutDelay = std::max(CLIENT_KNOBS->WATCH_TIMEOUT - (now() - startTime), 0.0);
+		try {
+			state Version latest = data->data().latestVersion;
+			state Future<Void> watchFuture = data->watches.onChange(key);
+			GetValueRequest getReq( key, latest, debugID );
+			state Future<Void> getValue = getValueQ( data, getReq ); //we are relying on the delay zero at the top of getValueQ, if removed we need one here
+			GetValueReply reply = wait( getReq.reply.getFuture() );
+			//TraceEvent("watcherCheckValue").detail("key", printable( key ) ).detail("value", printable( value ) ).detail("currentValue", printable( v ) ).detail("ver", latest);
+
+			debugMutation("ShardWatchValue", latest, MutationRef(MutationRef::DebugKey, key, reply.value.present() ? StringRef( reply.value.get() ) : LiteralStringRef("<null>") ) );
+
+			if( debugID.present() )
+				g_traceBatch.addEvent("WatchValueDebug", debugID.get().first(), "watchValueQ.AfterRead"); //.detail("TaskID", g_network->getCurrentTask());
+
+			if( reply.value != value )
+				return latest;
+
+			if( data->watchBytes > SERVER_KNOBS->MAX_STORAGE_SERVER_WATCH_BYTES ) {
+				TEST(true); //Too many watches, reverting to polling
+				throw watch_cancelled();
+			}
+
+			data->watchBytes += ( key.expectedSize() + value.expectedSize() + 1000 );
+			try {
+				Void _ = wait( watchFuture );
+				data->watchBytes -= ( key.expectedSize() + value.expectedSize() + 1000 );
+			} catch( Error &e ) {
+				data->watchBytes -= ( key.expectedSize() + value.expectedSize() + 1000 );
+				throw;
+			}
+		} catch( Error &e ) {
+			if( e.code() != error_code_transaction_too_old )
+				throw;
 		}
-		choose {
-			when( Void _ = wait( watch ) ) {
-				return Void();
+	}
+}
+
+// Returns a shared watch on req.key that req can wait for.  A watch that is already running for the same value is
+// reused, so that any number of clients watching a hot key cost the storage server one watch.
+Reference<StorageServer::SharedWatch> joinSharedWatch( StorageServer* data, WatchValueRequest const& req ) {
+	auto it = data->sharedWatches.find( req.key );
+	if( it != data->sharedWatches.end() && it->second->value == req.value && !it->second->watch.isReady() ) {
+		TEST(true); // Watch coalesced with an existing watch on the same key
+		++data->counters.coalescedWatches;
+		it->second->waiters++;
+		return it->second;
+	}
+
+	Reference<StorageServer::SharedWatch> shared( new StorageServer::SharedWatch( req.value ) );
+	shared->watch = watchValue_impl( data, req.key, req.value, req.version, req.debugID );
+	if( SERVER_KNOBS->STORAGE_COALESCE_WATCHES ) {
+		// A running watch for a different value keeps its place; this one just isn't shared
+		if( it == data->sharedWatches.end() )
+			data->sharedWatches[req.key] = shared;
+		else if( it->second->watch.isReady() )
+			it->second = shared;
+	}
+	return shared;
+}
+
+// Once the last waiter leaves (or the watch has fired) the watch is no longer offered to new requests, and it is
+// cancelled when the last reference to it is dropped
+void leaveSharedWatch( StorageServer* data, KeyRef key, Reference<StorageServer::SharedWatch> const& shared ) {
+	if( --shared->waiters == 0 || shared->watch.isReady() ) {
+		auto it = data->sharedWatches.find( key );
+		if( it != data->sharedWatches.end() && it->second == shared )
+			data->sharedWatches.erase( it );
+	}
+}
+
+ACTOR Future<Void> watchValueQ( StorageServer* data, WatchValueRequest req ) {
+	state Reference<StorageServer::SharedWatch> shared = joinSharedWatch( data, req );
+	state Future<Version> watch = shared->watch;
+	state double startTime = now();
+
+	++data->counters.watchQueries;
+	try {
+		loop {
+			double timeoutDelay = -1;
+			if(data->noRecentUpdates.get()) {
+				timeoutDelay = std::max(CLIENT_KNOBS->FAST_WATCH_TIMEOUT - (now() - startTime), 0.0);
+			} else if(!BUGGIFY) {
+				timeoutDelay = std::max(CLIENT_KNOBS->WATCH_TIMEOUT - (now() - startTime), 0.0);
 			}
-			when( Void _ = wait( timeoutDelay < 0 ? Never() : delay(timeoutDelay) ) ) {
-				req.reply.sendError( timed_out() );
-				return Void();
+			choose {
+				when( Version ver = wait( watch ) ) {
+					if( ver >= req.version ) {
+						req.reply.send( ver );
+						break;
+					}
+					// The shared watch saw a change that this request had already read past, so watch on our own from req.version
+					TEST(true); // Shared watch fired before the version of a coalesced request
+					leaveSharedWatch( data, req.key, shared );
+					shared = Reference<StorageServer::SharedWatch>();
+					watch = watchValue_impl( data, req.key, req.value, req.version, req.debugID );
+				}
+				when( Void _ = wait( timeoutDelay < 0 ? Never() : delay(timeoutDelay) ) ) {
+					req.reply.sendError( timed_out() );
+					break;
+				}
+				when( Void _ = wait( data->noRecentUpdates.onChange()) ) {}
 			}
-			when( Void _ = wait( data->noRecentUpdates.onChange()) ) {}
 		}
+	} catch (Error& e) {
+		if( shared )
+			leaveSharedWatch( data, req.key, shared );
+		if( e.code() == error_code_internal_error || e.code() == error_code_actor_cancelled ) throw;
+		req.reply.sendError(e);
+		return Void();
 	}
+	if( shared )
+		leaveSharedWatch( data, req.key, shared );
+	return Void();
 }
 
 ACTOR Future<Void> getShardState_impl( StorageServer* data, GetShardStateRequest req ) {
@@ -872,6 +1401,134 @@ ACTOR Future<Void> getShardStateQ( StorageServer* data, GetShardStateRequest req
 	return Void();
 }
 
+void pinSnapshotQ( StorageServer* data, PinSnapshotRequest const& req ) {
+	if( !data->storage.canOpenSnapshot() ) {
+		req.reply.sendError( unsupported_operation() );
+		return;
+	}
+
+	double expires = now() + std::max( 0.0, std::min( req.lease, SERVER_KNOBS->MAX_PINNED_SNAPSHOT_LEASE ) );
+	auto pin = data->pinnedSnapshots.find( req.version );
+	if( pin != data->pinnedSnapshots.end() ) {
+		pin->second.expires = std::max( pin->second.expires, expires );
+		req.reply.send( Void() );
+		return;
+	}
+
+	// updateStorage() can only stop at a version it has not yet passed
+	if( req.version <= data->storageVersion() ) {
+		req.reply.sendError( transaction_too_old() );
+		return;
+	}
+	if( data->pinnedSnapshots.size() >= SERVER_KNOBS->MAX_PINNED_SNAPSHOTS ) {
+		TEST(true); // Too many pinned snapshots
+		req.reply.sendError( operation_failed() );
+		return;
+	}
+
+	data->pinnedSnapshots[req.version].expires = expires;
+	TraceEvent("SnapshotPinned", data->thisServerID).detail("Version", req.version).detail("Lease", expires - now());
+	req.reply.send( Void() );
+}
+
+ACTOR Future<Void> expirePinnedSnapshots( StorageServer* data ) {
+	loop {
+		Void _ = wait( delay( 1.0 ) );
+		for(auto pin = data->pinnedSnapshots.begin(); pin != data->pinnedSnapshots.end(); ) {
+			if( pin->second.expires <= now() ) {
+				TraceEvent("PinnedSnapshotExpired", data->thisServerID).detail("Version", pin->first).detail("Taken", pin->second.snapshot.isValid());
+				pin = data->pinnedSnapshots.erase( pin );
+			} else
+				++pin;
+		}
+	}
+}
+
+// Splits the memory the process can spare between MVCC data, the page cache and the hot key cache, instead of leaving each to its knob.
+// The budget is the --memory limit less what everything else in the process is using and STORAGE_MEMORY_GOVERNOR_RESERVE_BYTES; in
+// simulation, and without a limit, it is just what the knobs added up to at the start.  MVCC data is kept first, since the versions not yet
+// durable have nowhere else to go: STORAGE_MEMORY_GOVERNOR_MVCC_HEADROOM times what it uses now is set aside for it, and the e-brake
+// moves so that it can take all but the caches' minimums before writes stop.  The rest goes to the caches, and each interval a step of
+// it moves to whichever cache is full and missing more (a hot key cache miss is only a storage read, which may hit the page cache, so it
+// counts for STORAGE_MEMORY_GOVERNOR_HOT_KEY_MISS_COST of a page cache miss).
+// The page cache is shared by the whole process, so only one storage server in a process governs it; the others keep their knobs.
+ACTOR Future<Void> memoryGovernor( StorageServer* data ) {
+	state Reference<EvictablePageCache> pageCache = AsyncFileCached::getPageCache( 0 );
+	if( pageCache->governor )
+		return Void();
+	pageCache->governor = data;
+
+	state int64_t fixedBudget = pageCache->getMaxSizeBytes() + data->hotKeyCache.getMaxBytes() + data->mvccLimitBytes;
+	state int64_t lastPageHits = pageCache->hits;
+	state int64_t lastPageMisses = pageCache->misses;
+	state int64_t lastKeyMisses = data->counters.hotKeyCacheMisses.getValue();
+	try {
+		loop {
+			Void _ = wait( delay( SERVER_KNOBS->STORAGE_MEMORY_GOVERNOR_INTERVAL ) );
+
+			int64_t pageHits = pageCache->hits - lastPageHits;
+			int64_t pageMisses = pageCache->misses - lastPageMisses;
+			int64_t keyMisses = data->counters.hotKeyCacheMisses.getValue() - lastKeyMisses;
+			lastPageHits = pageCache->hits;
+			lastPageMisses = pageCache->misses;
+			lastKeyMisses = data->counters.hotKeyCacheMisses.getValue();
+
+			int64_t mvccBytes = data->queueSize();
+			int64_t budget = fixedBudget;
+			int64_t quota = getMemoryQuota();
+			if( quota && !g_network->isSimulated() ) {
+				int64_t governed = pageCache->getSizeBytes() + data->hotKeyCache.getBytes() + mvccBytes;
+				int64_t other = std::max<int64_t>( 0, (int64_t)getMemoryUsage() - governed );
+				budget = quota - other - SERVER_KNOBS->STORAGE_MEMORY_GOVERNOR_RESERVE_BYTES;
+			}
+
+			bool keyCacheEnabled = data->hotKeyCache.enabled();
+			int64_t minPage = SERVER_KNOBS->STORAGE_MEMORY_GOVERNOR_MIN_PAGE_CACHE_BYTES;
+			int64_t minKey = keyCacheEnabled ? SERVER_KNOBS->STORAGE_MEMORY_GOVERNOR_MIN_HOT_KEY_CACHE_BYTES : 0;
+			int64_t minMvcc = std::min( SERVER_KNOBS->STORAGE_MEMORY_GOVERNOR_MIN_MVCC_BYTES, SERVER_KNOBS->STORAGE_HARD_LIMIT_BYTES );
+			int64_t mvccReserve = std::max( minMvcc, std::min<int64_t>( SERVER_KNOBS->STORAGE_HARD_LIMIT_BYTES, mvccBytes * SERVER_KNOBS->STORAGE_MEMORY_GOVERNOR_MVCC_HEADROOM ) );
+			int64_t mvccLimit = std::max( minMvcc, std::min( SERVER_KNOBS->STORAGE_HARD_LIMIT_BYTES, budget - minPage - minKey ) );
+			int64_t cacheBudget = std::max( minPage + minKey, budget - mvccReserve );
+
+			// Keep the caches' current proportions of the new cache budget, then move a step toward the one that needs it more
+			double pageTarget = pageCache->getMaxSizeBytes();
+			double keyTarget = keyCacheEnabled ? data->hotKeyCache.getMaxBytes() : 0;
+			double scale = cacheBudget / std::max( 1.0, pageTarget + keyTarget );
+			pageTarget *= scale;
+			keyTarget *= scale;
+			if( keyCacheEnabled ) {
+				double step = cacheBudget * SERVER_KNOBS->STORAGE_MEMORY_GOVERNOR_STEP;
+				double keyCost = keyMisses * SERVER_KNOBS->STORAGE_MEMORY_GOVERNOR_HOT_KEY_MISS_COST;
+				bool pageFull = pageCache->getSizeBytes() >= 0.9 * pageCache->getMaxSizeBytes();
+				bool keyFull = data->hotKeyCache.getBytes() >= 0.9 * data->hotKeyCache.getMaxBytes();
+				double move = 0;
+				if( pageFull && pageMisses > keyCost )
+					move = std::max( 0.0, std::min( step, keyTarget - minKey ) );
+				else if( keyFull && keyCost > pageMisses )
+					move = -std::max( 0.0, std::min( step, pageTarget - minPage ) );
+				pageTarget += move;
+				keyTarget -= move;
+			}
+			pageTarget = std::max<double>( pageTarget, minPage );
+			keyTarget = std::max<double>( keyTarget, minKey );
+
+			pageCache->setMaxSize( pageTarget );
+			data->hotKeyCache.setMaxBytes( keyTarget );
+			data->mvccLimitBytes = mvccLimit;
+
+			TraceEvent("StorageMemoryGovernor", data->thisServerID)
+				.detail("Budget", budget).detail("MVCCBytes", mvccBytes).detail("MVCCLimit", mvccLimit)
+				.detail("PageCacheBytes", pageCache->getSizeBytes()).detail("PageCacheLimit", pageCache->getMaxSizeBytes())
+				.detail("PageCacheHits", pageHits).detail("PageCacheMisses", pageMisses)
+				.detail("HotKeyCacheBytes", data->hotKeyCache.getBytes()).detail("HotKeyCacheLimit", data->hotKeyCache.getMaxBytes())
+				.detail("HotKeyCacheMisses", keyMisses);
+		}
+	} catch( Error& e ) {
+		pageCache->governor = NULL;
+		throw;
+	}
+}
+
 void merge( Arena& arena, VectorRef<KeyValueRef>& output, VectorRef<KeyValueRef> const& base,
 	        StorageServer::VersionedData::iterator& start, StorageServer::VersionedData::iterator const& end,
 			int versionedDataCount, int limit, bool stopAtEndOfBase, int limitBytes = 1<<30 )
@@ -913,7 +1570,8 @@ void merge( Arena& arena, VectorRef<KeyValueRef>& output, VectorRef<KeyValueRef>
 // readRange reads up to |limit| rows from the given range and version, combining data->storage and data->versionedData.
 // If limit>=0, it returns the first rows in the range (sorted ascending), otherwise the last rows (sorted descending).
 // readRange has O(|result|) + O(log |data|) cost
-ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version, KeyRange range, int limit, int* pLimitBytes ) {
+// type is passed on to data->storage, so that READ_BULK scans don't displace the page cache
+ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version, KeyRange range, int limit, int* pLimitBytes, IKeyValueStore::ReadType type = IKeyValueStore::READ_NORMAL ) {
 	state GetKeyValuesReply result;
 	state StorageServer::VersionedData::ViewAtVersion view = data->data().at(version);
 	state StorageServer::VersionedData::iterator vStart = view.end();
@@ -972,7 +1630,7 @@ ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version,
 			// Read the data on disk up to vEnd (or the end of the range)
 			readEnd = vEnd ? std::min( vEnd.key(), range.end ) : range.end;
 			Standalone<VectorRef<KeyValueRef>> atStorageVersion = wait(
-					data->storage.readRange( KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes ) );
+					data->storage.readRange( KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes, type ) );
 
 			/*if (track) {
 				printf("read [%s,%s): %d rows\n", printable(readBegin).c_str(), printable(readEnd).c_str(), atStorageVersion.size());
@@ -1071,7 +1729,7 @@ ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version,
 			if (vEnd)
 				readBegin = std::max( readBegin, vEnd->isClearTo() ? vEnd->getEndKey() : vEnd.key() );
 
-			Standalone<VectorRef<KeyValueRef>> atStorageVersion = wait( data->storage.readRange( KeyRangeRef(readBegin, readEnd), limit ) );
+			Standalone<VectorRef<KeyValueRef>> atStorageVersion = wait( data->storage.readRange( KeyRangeRef(readBegin, readEnd), limit, 1<<30, type ) );
 			if (data->storageVersion() > version) throw transaction_too_old();
 
 			int prevSize = result.data.size();
@@ -1096,12 +1754,43 @@ ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version,
 	return result;
 }
 
+// As readRange, but a version older than oldestVersion (or one that falls out of the MVCC window during the read) is read from
+// its pinned snapshot, if it has one
+ACTOR Future<GetKeyValuesReply> readRangeAt( StorageServer* data, Version version, KeyRange range, int limit, int* pLimitBytes, IKeyValueStore::ReadType type = IKeyValueStore::READ_NORMAL ) {
+	state int limitBytes = *pLimitBytes;
+	if (version >= data->oldestVersion.get()) {
+		try {
+			GetKeyValuesReply r = wait( readRange( data, version, range, limit, pLimitBytes, type ) );
+			return r;
+		} catch (Error& e) {
+			if (e.code() != error_code_transaction_too_old || !data->getPinnedSnapshot( version, range ))
+				throw;
+		}
+		TEST(true); // Pinned version fell out of the MVCC window during a range read
+		*pLimitBytes = limitBytes;
+	}
+
+	state Reference<IKeyValueSnapshot> snapshot = data->getPinnedSnapshot( version, range );
+	if (!snapshot)
+		throw transaction_too_old();
+	Standalone<VectorRef<KeyValueRef>> rows = wait( snapshot->readRange( range, limit, *pLimitBytes, type ) );
+
+	GetKeyValuesReply result;
+	result.arena.dependsOn( rows.arena() );
+	result.data = rows;
+	for(auto& kv : rows)
+		*pLimitBytes -= sizeof(KeyValueRef) + kv.expectedSize();
+	result.more = rows.size() == std::abs(limit) || *pLimitBytes <= 0;
+	result.version = version;
+	return result;
+}
+
 bool selectorInRange( KeySelectorRef const& sel, KeyRangeRef const& range ) {
 	// Returns true if the given range suffices to at least begin to resolve the given KeySelectorRef
 	return sel.getKey() >= range.begin && (sel.isBackward() ? sel.getKey() <= range.end : sel.getKey() < range.end);
 }
 
-ACTOR Future<Key> findKey( StorageServer* data, KeySelectorRef sel, Version version, KeyRange range, int* pOffset)
+ACTOR Future<Key> findKeyInRead( StorageServer* data, KeySelectorRef sel, Version version, KeyRange range, int* pOffset)
 // Attempts to find the key indicated by sel in the data at version, within range.
 // Precondition: selectorInRange(sel, range)
 // If it is found, offset is set to 0 and a key is returned which falls inside range.
@@ -1111,7 +1800,7 @@ ACTOR Future<Key> findKey( StorageServer* data, KeySelectorRef sel, Version vers
 // The range passed in to this function should specify a shard.  If range.begin is repeatedly not the beginning of a shard, then it is possible to get stuck looping here
 {
 	ASSERT( version != latestVersion );
-	ASSERT( selectorInRange(sel, range) && version >= data->oldestVersion.get() );
+	ASSERT( selectorInRange(sel, range) );
 
 	// Count forward or backward distance items, skipping the first one if it == key and skipEqualKey
 	state bool forward = sel.offset > 0;                  // If forward, result >= sel.getKey(); else result <= sel.getKey()
@@ -1126,14 +1815,14 @@ ACTOR Future<Key> findKey( StorageServer* data, KeySelectorRef sel, Version vers
 	else
 		maxBytes = BUGGIFY ? SERVER_KNOBS->BUGGIFY_LIMIT_BYTES : SERVER_KNOBS->STORAGE_LIMIT_BYTES;
 
-	state GetKeyValuesReply rep = wait( readRange( data, version, forward ? KeyRangeRef(sel.getKey(), range.end) : KeyRangeRef(range.begin, keyAfter(sel.getKey())), (distance + skipEqualKey)*sign, &maxBytes ) );
+	state GetKeyValuesReply rep = wait( readRangeAt( data, version, forward ? KeyRangeRef(sel.getKey(), range.end) : KeyRangeRef(range.begin, keyAfter(sel.getKey())), (distance + skipEqualKey)*sign, &maxBytes ) );
 	state bool more = rep.more && rep.data.size() != distance + skipEqualKey;
 
 	//If we get only one result in the reverse direction as a result of the data being too large, we could get stuck in a loop
 	if(more && !forward && rep.data.size() == 1) {
 		TEST(true); //Reverse key selector returned only one result in range read
 		maxBytes = std::numeric_limits<int>::max();
-		GetKeyValuesReply rep2 = wait( readRange( data, version, KeyRangeRef(range.begin, keyAfter(sel.getKey())), -2, &maxBytes ) );
+		GetKeyValuesReply rep2 = wait( readRangeAt( data, version, KeyRangeRef(range.begin, keyAfter(sel.getKey())), -2, &maxBytes ) );
 		rep = rep2;
 		more = rep.more && rep.data.size() != distance + skipEqualKey;
 		ASSERT(rep.data.size() == 2 || !more);
@@ -1168,6 +1857,25 @@ ACTOR Future<Key> findKey( StorageServer* data, KeySelectorRef sel, Version vers
 	}
 }
 
+ACTOR Future<Key> findKey( StorageServer* data, KeySelectorRef sel, Version version, KeyRange range, int* pOffset)
+// As findKeyInRead, but a large offset is counted through with up to FIND_KEY_MAX_READS range reads rather than one, saving the
+// client a request for each of them
+{
+	state int reads = 0;
+	state Key key;
+	loop {
+		Key k = wait( findKeyInRead( data, sel, version, range, pOffset ) );
+		key = k;
+		if( !*pOffset || ++reads >= SERVER_KNOBS->FIND_KEY_MAX_READS || key == (*pOffset > 0 ? range.end : range.begin) )
+			return key;
+
+		// The read stopped at its byte limit inside range, so the rest of the offset can be counted from where it stopped
+		TEST(true); // Key selector counted through several range reads
+		sel = *pOffset < 0 ? KeySelectorRef(key, false, *pOffset + 1) : KeySelectorRef(key, false, *pOffset);
+		ASSERT( selectorInRange(sel, range) );
+	}
+}
+
 KeyRange getShardKeyRange( StorageServer* data, const KeySelectorRef& sel )
 // Returns largest range such that the shard state isReadable and selectorInRange(sel, range) or wrong_shard_server if no such range exists
 {
@@ -1177,6 +1885,22 @@ KeyRange getShardKeyRange( StorageServer* data, const KeySelectorRef& sel )
 	return i->range();
 }
 
+// Replaces the rows of r with what the filter says to send of them.  When rows are dropped the client cannot continue from the last
+// row it gets, so r.scannedThrough says where the read stopped.
+void applyReadFilter( ReadFilterRef const& filter, GetKeyValuesReply* r ) {
+	if( filter.dropsRows() && r->more && r->data.size() )
+		r->scannedThrough = r->data.back().key;
+
+	int out = 0;
+	for(int i = 0; i < r->data.size(); i++)
+		if( filter.matches( r->data[i] ) )
+			r->data[out++] = filter.project( r->arena, r->data[i] );
+	if( out < r->data.size() ) {
+		TEST(true); // Range read filter dropped rows
+		r->data.resize( r->arena, out );
+	}
+}
+
 ACTOR Future<Void> getKeyValues( StorageServer* data, GetKeyValuesRequest req )
 // Throws a wrong_shard_server if the keys in the request or result depend on data outside this server OR if a large selector offset prevents
 // all data from being read in one range read
@@ -1184,16 +1908,18 @@ ACTOR Future<Void> getKeyValues( StorageServer* data, GetKeyValuesRequest req )
 	++data->counters.getRangeQueries;
 	++data->counters.allQueries;
 	++data->readQueueSizeMetric;
+	data->readSketch.add( req.begin.getKey() );
 	data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
 
-	// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
-	// so we need to downgrade here
-	Void _ = wait( delay(0, TaskDefaultEndpoint) );
-
 	try {
+		if( req.filter.present() && !req.filter.get().isValid() )
+			throw client_invalid_operation();
+
+		Void _ = wait( waitForReadTurn( data, req.priority ) );
+
 		if( req.debugID.present() )
 			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValues.Before");
-		state Version version = wait( waitForVersion( data, req.version ) );
+		state Version version = wait( waitForVersion( data, req.version, true ) );
 
 		state uint64_t changeCounter = data->shardChangeCounter;
 //		try {
@@ -1247,7 +1973,7 @@ ACTOR Future<Void> getKeyValues( StorageServer* data, GetKeyValuesRequest req )
 		} else {
 			state int remainingLimitBytes = req.limitBytes;
 
-			GetKeyValuesReply _r = wait( readRange(data, version, KeyRangeRef(begin, end), req.limit, &remainingLimitBytes) );
+			GetKeyValuesReply _r = wait( readRangeAt(data, version, KeyRangeRef(begin, end), req.limit, &remainingLimitBytes) );
 			GetKeyValuesReply r = _r;
 
 			if( req.debugID.present() )
@@ -1260,20 +1986,151 @@ ACTOR Future<Void> getKeyValues( StorageServer* data, GetKeyValuesRequest req )
 				ASSERT(r.data.size() <= std::abs(req.limit));
 			}
 
-			/*for( int i = 0; i < r.data.size(); i++ ) {
-				StorageMetrics m;
-				m.bytesPerKSecond = r.data[i].expectedSize();
-				m.iosPerKSecond = 1; //FIXME: this should be 1/r.data.size(), but we cannot do that because it is an int
-				data->metrics.notify(r.data[i].key, m);
-			}*/
+			for( int i = 0; i < r.data.size(); i++ )
+				data->metrics.notifyBytesRead( r.data[i].key, r.data[i].expectedSize() );
 			data->readReplyRate.addDelta(1);
 
+			data->counters.rowsQueried += r.data.size();
+			data->counters.bytesQueried += req.limitBytes - remainingLimitBytes;
+
+			if( req.filter.present() )
+				applyReadFilter( req.filter.get(), &r );
+
 			r.penalty = data->getPenalty();
 			req.reply.send( r );
+		}
+	} catch (Error& e) {
+		if (e.code() == error_code_internal_error || e.code() == error_code_actor_cancelled) throw;
+		req.reply.sendError(e);
+	}
 
-			data->counters.rowsQueried += r.data.size();
-			data->counters.bytesQueried += req.limitBytes - remainingLimitBytes;
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+
+	return Void();
+}
+
+ACTOR Future<Void> getKeyValuesStreamQ( StorageServer* data, GetKeyValuesStreamRequest req )
+// Sends each chunk of the range as soon as it is read, rather than waiting for the client to ask for it.  Errors, including a
+// wrong_shard_server if the range is not entirely within a readable shard, are sent to every chunk not yet answered.
+{
+	state int chunk = 0;
+
+	++data->counters.getRangeStreamQueries;
+	++data->counters.allQueries;
+	++data->readQueueSizeMetric;
+	data->readSketch.add( req.begin.getKey() );
+	data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+	try {
+		Void _ = wait( waitForReadTurn( data, req.priority ) );
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.Before");
+		state Version version = wait( waitForVersion( data, req.version ) );
+
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state KeyRange shard = getShardKeyRange( data, firstGreaterOrEqual(req.keys.begin) );
+		if ( req.keys.end > shard.end )
+			throw wrong_shard_server();
+
+		state KeyRange range = req.keys;
+		state int rowsRemaining = req.limit;
+		while( chunk < req.replies.size() && rowsRemaining > 0 && !range.empty() ) {
+			state int remainingLimitBytes = req.limitBytes;
+			GetKeyValuesReply _r = wait( readRange(data, version, range, rowsRemaining, &remainingLimitBytes, IKeyValueStore::READ_BULK) );
+			{
+				GetKeyValuesReply r = _r;
+				data->checkChangeCounter( changeCounter, range );
+
+				rowsRemaining -= r.data.size();
+				if( r.more && r.data.size() )
+					range = KeyRange( KeyRangeRef( keyAfter(r.data.end()[-1].key), range.end ) );
+				else {
+					r.more = false;
+					range = KeyRange( KeyRangeRef( range.end, range.end ) );
+				}
+
+				data->counters.rowsQueried += r.data.size();
+				data->counters.bytesQueried += req.limitBytes - remainingLimitBytes;
+				data->readReplyRate.addDelta(1);
+				for( int i = 0; i < r.data.size(); i++ )
+					data->metrics.notifyBytesRead( r.data[i].key, r.data[i].expectedSize() );
+
+				r.penalty = data->getPenalty();
+				req.replies[chunk++].send( r );
+			}
+
+			// Let other queries in between chunks
+			Void _ = wait( yield() );
+		}
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.Send");
+
+		// The chunks past the end of the data still need an answer, since the client may already be waiting on them
+		GetKeyValuesReply none;
+		none.version = version;
+		none.more = false;
+		none.penalty = data->getPenalty();
+		for(; chunk < req.replies.size(); chunk++)
+			req.replies[chunk].send( none );
+	} catch (Error& e) {
+		if (e.code() == error_code_internal_error || e.code() == error_code_actor_cancelled) throw;
+		for(; chunk < req.replies.size(); chunk++)
+			req.replies[chunk].sendError(e);
+	}
+
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+
+	return Void();
+}
+
+ACTOR Future<Void> getRangeChecksumQ( StorageServer* data, GetRangeChecksumRequest req )
+// Reads the range (which must lie within a single shard) in chunks, as getKeyValuesStreamQ does, but replies with only a hash of it
+{
+	++data->counters.getRangeChecksumQueries;
+	++data->counters.allQueries;
+	++data->readQueueSizeMetric;
+	data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+	try {
+		Void _ = wait( waitForReadTurn( data, req.priority ) );
+		state Version version = wait( waitForVersion( data, req.version ) );
+
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state KeyRange shard = getShardKeyRange( data, firstGreaterOrEqual(req.keys.begin) );
+		if ( req.keys.end > shard.end )
+			throw wrong_shard_server();
+
+		state GetRangeChecksumReply reply;
+		state KeyRange range = req.keys;
+		while( !range.empty() ) {
+			state int remainingLimitBytes = CLIENT_KNOBS->REPLY_BYTE_LIMIT;
+			GetKeyValuesReply _r = wait( readRange(data, version, range, CLIENT_KNOBS->REPLY_BYTE_LIMIT, &remainingLimitBytes, IKeyValueStore::READ_BULK) );
+			{
+				GetKeyValuesReply const& r = _r;
+				data->checkChangeCounter( changeCounter, range );
+
+				reply.checksum.add( r.data );
+				data->counters.rowsQueried += r.data.size();
+				data->counters.bytesQueried += CLIENT_KNOBS->REPLY_BYTE_LIMIT - remainingLimitBytes;
+				if( r.more && r.data.size() )
+					range = KeyRange( KeyRangeRef( keyAfter(r.data.end()[-1].key), range.end ) );
+				else
+					range = KeyRange( KeyRangeRef( range.end, range.end ) );
+			}
+
+			// Let other queries in between chunks
+			Void _ = wait( yield() );
 		}
+
+		data->checkChangeCounter( changeCounter, req.keys );
+		data->readReplyRate.addDelta(1);
+		reply.version = version;
+		reply.penalty = data->getPenalty();
+		req.reply.send( reply );
 	} catch (Error& e) {
 		if (e.code() == error_code_internal_error || e.code() == error_code_actor_cancelled) throw;
 		req.reply.sendError(e);
@@ -1285,6 +2142,146 @@ ACTOR Future<Void> getKeyValues( StorageServer* data, GetKeyValuesRequest req )
 	return Void();
 }
 
+ACTOR Future<Void> getRangeAggregateQ( StorageServer* data, GetRangeAggregateRequest req )
+// Reads the range (which must lie within a single shard) in chunks, as getRangeChecksumQ does, but replies with only its count and sums
+{
+	++data->counters.getRangeAggregateQueries;
+	++data->counters.allQueries;
+	++data->readQueueSizeMetric;
+	data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+	try {
+		Void _ = wait( waitForReadTurn( data, req.priority ) );
+		state Version version = wait( waitForVersion( data, req.version ) );
+
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state KeyRange shard = getShardKeyRange( data, firstGreaterOrEqual(req.keys.begin) );
+		if ( req.keys.end > shard.end )
+			throw wrong_shard_server();
+
+		state GetRangeAggregateReply reply;
+		state KeyRange range = req.keys;
+		state int64_t bytesRead = 0;
+		while( !range.empty() && bytesRead < req.limitBytes ) {
+			state int remainingLimitBytes = CLIENT_KNOBS->REPLY_BYTE_LIMIT;
+			GetKeyValuesReply _r = wait( readRange(data, version, range, CLIENT_KNOBS->REPLY_BYTE_LIMIT, &remainingLimitBytes, IKeyValueStore::READ_BULK) );
+			{
+				GetKeyValuesReply const& r = _r;
+				data->checkChangeCounter( changeCounter, range );
+
+				reply.aggregate.add( r.data );
+				for( int i = 0; i < r.data.size(); i++ )
+					data->metrics.notifyBytesRead( r.data[i].key, r.data[i].expectedSize() );
+				data->counters.rowsQueried += r.data.size();
+				data->counters.bytesQueried += CLIENT_KNOBS->REPLY_BYTE_LIMIT - remainingLimitBytes;
+				bytesRead += CLIENT_KNOBS->REPLY_BYTE_LIMIT - remainingLimitBytes;
+				if( r.more && r.data.size() )
+					range = KeyRange( KeyRangeRef( keyAfter(r.data.end()[-1].key), range.end ) );
+				else
+					range = KeyRange( KeyRangeRef( range.end, range.end ) );
+			}
+
+			// Let other queries in between chunks
+			Void _ = wait( yield() );
+		}
+		if( !range.empty() ) {
+			TEST(true); // Range aggregate stopped at its byte limit
+			reply.resumeKey = Key(range.begin);
+		}
+
+		data->checkChangeCounter( changeCounter, req.keys );
+		data->readReplyRate.addDelta(1);
+		reply.version = version;
+		reply.penalty = data->getPenalty();
+		req.reply.send( reply );
+	} catch (Error& e) {
+		if (e.code() == error_code_internal_error || e.code() == error_code_actor_cancelled) throw;
+		req.reply.sendError(e);
+	}
+
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+
+	return Void();
+}
+
+ACTOR Future<Void> exportRangeQ( StorageServer* data, ExportRangeRequest req )
+// Reads the range (which must lie within a single shard) in chunks, as getRangeAggregateQ does, at batch priority, and writes each
+// EXPORT_RANGE_FILE_BYTES or so of it to a range file in the container while reading the next
+{
+	state FlowLock::Releaser holding;
+	++data->counters.exportRangeQueries;
+
+	try {
+		Void _ = wait( data->exportRangeLock.take() );
+		holding = FlowLock::Releaser( data->exportRangeLock );
+		state Version version = wait( waitForVersion( data, req.version, true ) );
+
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state KeyRange shard = getShardKeyRange( data, firstGreaterOrEqual(req.keys.begin) );
+		if ( req.keys.end > shard.end )
+			throw wrong_shard_server();
+
+		state Reference<IBackupContainer> bc = IBackupContainer::openContainer( req.containerURL );
+		state int blockSize = CLIENT_KNOBS->BACKUP_RANGEFILE_BLOCK_SIZE;
+		state ExportRangeReply reply;
+		state Reference<IBackupFile> file;
+		state Future<Void> writing = Void();
+		state KeyRange range = req.keys;
+		loop {
+			state Key fileBegin = range.begin;
+			state Standalone<VectorRef<KeyValueRef>> kvs;
+			state int64_t fileBytes = 0;
+			while( !range.empty() && fileBytes < SERVER_KNOBS->EXPORT_RANGE_FILE_BYTES ) {
+				Void _ = wait( waitForReadTurn( data, ReadPriorityBatch ) );
+				state int remainingLimitBytes = CLIENT_KNOBS->REPLY_BYTE_LIMIT;
+				GetKeyValuesReply _r = wait( readRangeAt(data, version, range, CLIENT_KNOBS->REPLY_BYTE_LIMIT, &remainingLimitBytes, IKeyValueStore::READ_BULK) );
+				{
+					GetKeyValuesReply const& r = _r;
+					data->checkChangeCounter( changeCounter, range );
+
+					kvs.arena().dependsOn( r.arena );
+					kvs.append( kvs.arena(), r.data.begin(), r.data.size() );
+					for( int i = 0; i < r.data.size(); i++ )
+						data->metrics.notifyBytesRead( r.data[i].key, r.data[i].expectedSize() );
+					data->counters.rowsQueried += r.data.size();
+					data->counters.bytesQueried += CLIENT_KNOBS->REPLY_BYTE_LIMIT - remainingLimitBytes;
+					fileBytes += CLIENT_KNOBS->REPLY_BYTE_LIMIT - remainingLimitBytes;
+					if( r.more && r.data.size() )
+						range = KeyRange( KeyRangeRef( keyAfter(r.data.end()[-1].key), range.end ) );
+					else
+						range = KeyRange( KeyRangeRef( range.end, range.end ) );
+				}
+			}
+
+			Void _ = wait( writing );
+			if( file )
+				reply.bytes += file->size();
+
+			// Each file ends where the next begins, so together they cover the whole range even where it has no keys
+			Reference<IBackupFile> f = wait( bc->writeRangeFile( version, blockSize ) );
+			file = f;
+			reply.fileNames.push_back( file->getFileName() );
+			writing = writeRangeFileKVs( file, blockSize, KeyRangeRef( fileBegin, range.begin ), kvs, req.compressBlocks );
+			if( range.empty() )
+				break;
+			TEST(true); // Export of a range wrote several files
+		}
+		Void _ = wait( writing );
+		reply.bytes += file->size();
+
+		data->checkChangeCounter( changeCounter, req.keys );
+		TraceEvent("ExportedRange", data->thisServerID).detail("Begin", printable(req.keys.begin)).detail("End", printable(req.keys.end))
+			.detail("Version", version).detail("Files", reply.fileNames.size()).detail("Bytes", reply.bytes).suppressFor(1.0);
+		req.reply.send( reply );
+	} catch (Error& e) {
+		if (e.code() == error_code_internal_error || e.code() == error_code_actor_cancelled) throw;
+		req.reply.sendError(e);
+	}
+
+	return Void();
+}
+
 ACTOR Future<Void> getKey( StorageServer* data, GetKeyRequest req ) {
 	++data->counters.getKeyQueries;
 	++data->counters.allQueries;
@@ -1585,13 +2582,19 @@ void applyMutation( StorageServer *self, MutationRef const& m, Arena& arena, Sto
 			}
 		}
 		data.insert( m.param1, ValueOrClearToRef::value(m.param2) );
-		self->watches.trigger( m.param1 );
+		if( !self->updateEagerReads )
+			self->watches.trigger( m.param1 );
+		else if( self->watches.count( m.param1 ) )
+			self->pendingWatchTriggers.push_back( singleKeyRange( m.param1 ) );
 	} else if (m.type == MutationRef::ClearRange) {
 		data.erase( m.param1, m.param2 );
 		ASSERT( m.param2 > m.param1 );
 		ASSERT( !isClearContaining( data.atLatest(), m.param1 ) );
 		data.insert( m.param1, ValueOrClearToRef::clearTo(m.param2) );
-		self->watches.triggerRange( m.param1, m.param2 );
+		if( !self->updateEagerReads )
+			self->watches.triggerRange( m.param1, m.param2 );
+		else
+			self->pendingWatchTriggers.push_back( KeyRangeRef( m.param1, m.param2 ) );
 	}
 
 }
@@ -1721,6 +2724,55 @@ ACTOR Future<Standalone<RangeResultRef>> tryGetRange( Database cx, Version versi
 	}
 }
 
+// Returns up to parts+1 boundaries, from keys.begin to keys.end, that split keys into ranges of about blockBytes each according
+// to the byte samples of the source servers.  If the split points can't be had quickly, keys is fetched as a single part.
+ACTOR Future<Standalone<VectorRef<KeyRef>>> getFetchKeysBoundaries( Database cx, KeyRange keys, int parts, int blockBytes ) {
+	state Standalone<VectorRef<KeyRef>> boundaries;
+	state Transaction tr( cx );
+	boundaries.push_back_deep( boundaries.arena(), keys.begin );
+
+	if( parts > 1 ) {
+		StorageMetrics limit;
+		limit.bytes = blockBytes;
+		limit.bytesPerKSecond = limit.infinity;
+		limit.iosPerKSecond = limit.infinity;
+		limit.bytesReadPerKSecond = limit.infinity;
+
+		try {
+			Standalone<VectorRef<KeyRef>> splits = wait( timeout( tr.splitStorageMetrics( keys, limit, StorageMetrics() ),
+				SERVER_KNOBS->FETCH_KEYS_SPLIT_TIMEOUT, Standalone<VectorRef<KeyRef>>() ) );
+			for( int i = 0; i < splits.size() && boundaries.size() < parts; i++ ) {
+				if( splits[i] > boundaries.back() && splits[i] < keys.end )
+					boundaries.push_back_deep( boundaries.arena(), splits[i] );
+			}
+		} catch( Error &e ) {
+			if( e.code() == error_code_actor_cancelled )
+				throw;
+			TraceEvent(SevWarn, "FetchKeysSplitError").error(e).suppressFor(1.0);
+		}
+	}
+
+	boundaries.push_back_deep( boundaries.arena(), keys.end );
+	return boundaries;
+}
+
+// Joins the blocks fetched for consecutive parts of a range into a single block for a prefix of that range.  Everything after
+// the first part that wasn't read to its end is dropped, and left for the fetchKeys of the remaining keys.
+Standalone<RangeResultRef> joinFetchedParts( vector<Standalone<RangeResultRef>> const& parts ) {
+	Standalone<RangeResultRef> joined;
+	for( int i = 0; i < parts.size(); i++ ) {
+		joined.arena().dependsOn( parts[i].arena() );
+		joined.append( joined.arena(), parts[i].begin(), parts[i].size() );
+		joined.more = parts[i].more;
+		joined.readThrough = parts[i].readThrough;
+		if( parts[i].more ) {
+			TEST( i < parts.size() - 1 ); // fetchKeys dropped parts fetched after an incomplete part
+			break;
+		}
+	}
+	return joined;
+}
+
 template <class T>
 void addMutation( T& target, Version version, MutationRef const& mutation ) {
 	target.addMutation( version, mutation );
@@ -1795,8 +2847,16 @@ ACTOR Future<Void> fetchKeys( StorageServer *data, AddingShard* shard ) {
 
 		TraceEvent(SevDebug, "FetchKeysVersionSatisfied", data->thisServerID).detail("FKID", interval.pairID);
 
-		Void _ = wait( data->fetchKeysParallelismLock.take( TaskDefaultYield, fetchBlockBytes ) );
-		state FlowLock::Releaser holdingFKPL( data->fetchKeysParallelismLock, fetchBlockBytes );
+		// Split keys so that up to FETCH_KEYS_PARALLEL_PARTS blocks can be fetched at once, which spreads the reads over the
+		// source team.  Every part holds a block's worth of fetchKeysParallelismLock, which bounds the memory used.
+		state Standalone<VectorRef<KeyRef>> fetchBoundaries = wait( getFetchKeysBoundaries( data->cx, keys,
+			std::max( 1, std::min( SERVER_KNOBS->FETCH_KEYS_PARALLEL_PARTS, SERVER_KNOBS->FETCH_KEYS_PARALLELISM_BYTES / fetchBlockBytes ) ),
+			fetchBlockBytes ) );
+		state int fetchLockBytes = fetchBlockBytes * (fetchBoundaries.size() - 1);
+		TEST( fetchBoundaries.size() > 2 ); // fetchKeys fetching a shard in parallel parts
+
+		Void _ = wait( data->fetchKeysParallelismLock.take( TaskDefaultYield, fetchLockBytes ) );
+		state FlowLock::Releaser holdingFKPL( data->fetchKeysParallelismLock, fetchLockBytes );
 
 		Void _ = wait(delay(0));
 
@@ -1814,7 +2874,12 @@ ACTOR Future<Void> fetchKeys( StorageServer *data, AddingShard* shard ) {
 			try {
 				TEST(true);		// Fetching keys for transferred shard
 
-				state Standalone<RangeResultRef> this_block = wait( tryGetRange( data->cx, fetchVersion, keys, GetRangeLimits( CLIENT_KNOBS->ROW_LIMIT_UNLIMITED, fetchBlockBytes ), &isTooOld ) );
+				state vector<Future<Standalone<RangeResultRef>>> fetchParts;
+				for( int i = 0; i < fetchBoundaries.size() - 1; i++ )
+					fetchParts.push_back( tryGetRange( data->cx, fetchVersion, KeyRangeRef( fetchBoundaries[i], fetchBoundaries[i+1] ), GetRangeLimits( CLIENT_KNOBS->ROW_LIMIT_UNLIMITED, fetchBlockBytes ), &isTooOld ) );
+				vector<Standalone<RangeResultRef>> fetchedParts = wait( getAll( fetchParts ) );
+				fetchParts.clear();
+				state Standalone<RangeResultRef> this_block = joinFetchedParts( fetchedParts );
 
 				int expectedSize = (int)this_block.expectedSize() + (8-(int)sizeof(KeyValueRef))*this_block.size();
 
@@ -1827,22 +2892,19 @@ ACTOR Future<Void> fetchKeys( StorageServer *data, AddingShard* shard ) {
 				for(auto k = this_block.begin(); k != this_block.end(); ++k) debugMutation("fetch", fetchVersion, MutationRef(MutationRef::SetValue, k->key, k->value));
 
 				data->counters.bytesFetched += expectedSize;
-				if( fetchBlockBytes > expectedSize ) {
-					holdingFKPL.release( fetchBlockBytes - expectedSize );
+				if( fetchLockBytes > expectedSize ) {
+					holdingFKPL.release( fetchLockBytes - expectedSize );
 				}
 
 				// Wait for permission to proceed
 				//Void _ = wait( data->fetchKeysStorageWriteLock.take() );
 				//state FlowLock::Releaser holdingFKSWL( data->fetchKeysStorageWriteLock );
 
-				// Write this_block to storage
-				state KeyValueRef *kvItr = this_block.begin();
-				for(; kvItr != this_block.end(); ++kvItr) {
-					data->storage.writeKeyValue( *kvItr );
-					Void _ = wait(yield());
-				}
+				// Write this_block to storage.  It is sorted, so the storage engine can take it as a single run.
+				data->storage.writeSortedKeyValues( this_block, &this_block.arena() );
+				Void _ = wait(yield());
 
-				kvItr = this_block.begin();
+				state KeyValueRef *kvItr = this_block.begin();
 				for(; kvItr != this_block.end(); ++kvItr) {
 					data->byteSampleApplySet( *kvItr, invalidVersion );
 					Void _ = wait(yield());
@@ -2318,6 +3380,112 @@ private:
 	}
 };
 
+// Starts the eager reads for the batch of messages that cursor has just received, so that they overlap with the eager
+// reads and application of the batch before it.  Batches with more than STORAGE_PREFETCH_EAGER_READ_KEYS reads are left
+// alone.
+void prefetchEagerReads( StorageServer* data, Reference<ILogSystem::IPeekCursor> const& cursor, uint64_t logProtocol ) {
+	Reference<PrefetchedEagerReads> prefetch( new PrefetchedEagerReads );
+	prefetch->messages = cursor->cloneNoMore();
+	prefetch->messages->setProtocolVersion(logProtocol);
+
+	for (; prefetch->messages->hasMessage(); prefetch->messages->nextMessage()) {
+		ArenaReader& reader = *prefetch->messages->reader();
+
+		if (LogProtocolMessage::isNextIn(reader)) {
+			LogProtocolMessage lpm;
+			reader >> lpm;
+			prefetch->messages->setProtocolVersion(reader.protocolVersion());
+		}
+		else {
+			MutationRef msg;
+			reader >> msg;
+			prefetch->eager.addMutation(msg);
+			if (prefetch->eager.keyBegin.size() + prefetch->eager.keys.size() > SERVER_KNOBS->STORAGE_PREFETCH_EAGER_READ_KEYS)
+				return;
+		}
+	}
+
+	if (prefetch->eager.keyBegin.empty() && prefetch->eager.keys.empty())
+		return;
+
+	prefetch->shardChangeCounter = data->shardChangeCounter;
+	prefetch->eagerReadEpoch = data->eagerReadEpoch;
+	prefetch->reads = doEagerReads( data, &prefetch->eager );
+	data->prefetchedEagerReads = prefetch;
+}
+
+// Folds the atomic ops that one version makes to a key into a single mutation before update() applies them, so that a hot
+// counter costs one versioned data insert and one mutation log entry per version rather than one per increment.  Ops are
+// held back until the version ends or another mutation touches their key; holding back ops on different keys doesn't
+// change the result.  Private mutations can move shards, so everything held is applied before them.
+class AtomicOpFuser {
+public:
+	AtomicOpFuser() : version(invalidVersion) {}
+
+	void applyMutation( StorageServer* data, StorageUpdater& updater, MutationRef const& m, Version ver ) {
+		if( ver != version ) {
+			flush( data, updater );
+			version = ver;
+		}
+
+		if( isFusableAtomicOp( (MutationRef::Type)m.type ) && !m.param1.startsWith( systemKeys.end ) ) {
+			auto it = pending.find( m.param1 );
+			if( it == pending.end() ) {
+				pending[m.param1] = m;
+			} else if( fuseAtomicOps( it->second, m, arena ) ) {
+				TEST(true); // Storage server fused atomic ops on the same key
+				++data->counters.fusedAtomicOps;
+			} else {
+				updater.applyMutation( data, it->second, version );
+				it->second = m;
+			}
+			return;
+		}
+
+		if( !pending.empty() ) {
+			if( m.param1.startsWith( systemKeys.end ) ) {
+				flush( data, updater );
+			} else {
+				auto begin = pending.lower_bound( m.param1 );
+				auto end = m.type == MutationRef::ClearRange ? pending.lower_bound( m.param2 ) : pending.upper_bound( m.param1 );
+				for( auto it = begin; it != end; ++it )
+					updater.applyMutation( data, it->second, version );
+				pending.erase( begin, end );
+			}
+		}
+		updater.applyMutation( data, m, ver );
+	}
+
+	void flush( StorageServer* data, StorageUpdater& updater ) {
+		for( auto& p : pending )
+			updater.applyMutation( data, p.second, version );
+		pending.clear();
+	}
+
+private:
+	Version version;
+	std::map<KeyRef, MutationRef> pending;
+	Arena arena;  // fused operands, which applyMutation copies into the mutation log
+};
+
+// Fires the watch triggers collected while update() applied a batch of versions.  A key set many times in the batch,
+// or covered by several clears, wakes its watchers once.
+void triggerPendingWatches( StorageServer* data ) {
+	std::vector<KeyRange> triggers;
+	triggers.swap( data->pendingWatchTriggers );
+	std::sort( triggers.begin(), triggers.end(), []( KeyRange const& a, KeyRange const& b ) { return a.begin < b.begin || ( a.begin == b.begin && a.end > b.end ); } );
+	KeyRef triggeredEnd;
+	for( auto& r : triggers ) {
+		if( r.end <= triggeredEnd )
+			continue;
+		triggeredEnd = r.end;
+		if( r.singleKeyRange() )
+			data->watches.trigger( r.begin );
+		else
+			data->watches.triggerRange( r.begin, r.end );
+	}
+}
+
 ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 {
 	state double start;
@@ -2325,7 +3493,7 @@ ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 		// If we are disk bound and durableVersion is very old, we need to block updates or we could run out of memory
 		// This is often referred to as the storage server e-brake (emergency brake)
 		state double waitStartT = 0;
-		while ( data->queueSize() >= SERVER_KNOBS->STORAGE_HARD_LIMIT_BYTES && data->durableVersion.get() < data->desiredOldestVersion.get() )
+		while ( data->queueSize() >= data->mvccLimitBytes && data->durableVersion.get() < data->desiredOldestVersion.get() )
 		{
 			if (now() - waitStartT >= .1) {
 				TraceEvent(SevWarn, "StorageServerUpdateLag", data->thisServerID)
@@ -2364,7 +3532,14 @@ ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 		state UpdateEagerReadInfo eager;
 		state FetchInjectionInfo fii;
 		state Version minNewOldestVersion = 0;
-		state Reference<ILogSystem::IPeekCursor> cloneCursor2;
+		state DecodedLogBatch batch;
+		state Reference<PrefetchedEagerReads> prefetched = data->prefetchedEagerReads;
+		state Future<Void> eagerReads;
+		state Future<Void> nextBatch = Never();
+		state bool peekedAhead = false;
+		state uint64_t nextLogProtocol;
+		data->prefetchedEagerReads.clear();
+		batch.decode( cursor, data->logProtocol );
 
 		loop{
 			state uint64_t changeCounter = data->shardChangeCounter;
@@ -2372,24 +3547,15 @@ ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 			bool hasPrivateData = false;
 			bool firstMutation = true;
 			bool dbgLastMessageWasProtocol = false;
+			uint64_t batchEndProtocol = data->logProtocol;
 
-			Reference<ILogSystem::IPeekCursor> cloneCursor1 = cursor->cloneNoMore();
-			cloneCursor2 = cursor->cloneNoMore();
-
-			cloneCursor1->setProtocolVersion(data->logProtocol);
-
-			for (; cloneCursor1->hasMessage(); cloneCursor1->nextMessage()) {
-				ArenaReader& cloneReader = *cloneCursor1->reader();
-
-				if (LogProtocolMessage::isNextIn(cloneReader)) {
-					LogProtocolMessage lpm;
-					cloneReader >> lpm;
+			for (auto& m : batch.decoded) {
+				if (m.isProtocol) {
 					dbgLastMessageWasProtocol = true;
-					cloneCursor1->setProtocolVersion(cloneReader.protocolVersion());
+					batchEndProtocol = m.protocol;
 				}
 				else {
-					MutationRef msg;
-					cloneReader >> msg;
+					MutationRef const& msg = m.mutation;
 
 					if (firstMutation && msg.param1.startsWith(systemKeys.end))
 						hasPrivateData = true;
@@ -2416,7 +3582,39 @@ ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 			for(auto& c : fii.changes)
 				eager.addMutations(c.mutations);
 
-			Void _ = wait( doEagerReads( data, &eager ) );
+			// Peek the next batch now, so that its eager reads can start while this batch is still being read and applied.
+			// Recovery replaces the log cursor, so there is no lookahead across an epoch end.
+			if (!peekedAhead && !epochEnd && SERVER_KNOBS->STORAGE_PREFETCH_EAGER_READ_KEYS > 0) {
+				peekedAhead = true;
+				nextLogProtocol = batchEndProtocol;
+				cursor->advanceTo( batch.end );
+				nextBatch = cursor->getMore();
+			}
+
+			state bool usePrefetched = false;
+			if (prefetched) {
+				eager.finishKeyBegin();
+				usePrefetched = prefetched->shardChangeCounter == changeCounter && prefetched->eagerReadEpoch == data->eagerReadEpoch &&
+					prefetched->eager.keyBegin == eager.keyBegin && prefetched->eager.keys == eager.keys;
+				TEST(!usePrefetched); // Prefetched eager reads are outdated or do not match this batch
+			}
+			eagerReads = usePrefetched ? prefetched->reads : doEagerReads( data, &eager );
+
+			loop choose {
+				when( Void _ = wait( eagerReads ) ) { break; }
+				when( Void _ = wait( nextBatch ) ) {
+					nextBatch = Never();
+					if (cursor->popped() == 0)
+						prefetchEagerReads( data, cursor, nextLogProtocol );
+				}
+			}
+
+			if (usePrefetched) {
+				TEST(true); // Storage server used eager reads prefetched during the previous update
+				eager.keyEnd = prefetched->eager.keyEnd;
+				eager.value = prefetched->eager.value;
+			}
+			prefetched.clear();
 			if (data->shardChangeCounter == changeCounter) break;
 			TEST(true); // A fetchKeys completed while we were doing this, so eager might be outdated.  Read it again.
 			// SOMEDAY: Theoretically we could check the change counters of individual shards and retry the reads only selectively
@@ -2443,49 +3641,49 @@ ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 		}
 
 		Version ver = invalidVersion;
-		cloneCursor2->setProtocolVersion(data->logProtocol);
+		AtomicOpFuser fuser;
 		//TraceEvent("SSUpdatePeeked", data->thisServerID).detail("FromEpoch", data->updateEpoch).detail("FromSeq", data->updateSequence).detail("ToEpoch", results.end_epoch).detail("ToSeq", results.end_seq).detail("MsgSize", results.messages.size());
-		for (;cloneCursor2->hasMessage(); cloneCursor2->nextMessage()) {
-			auto &rd = *cloneCursor2->reader();
+		for (auto& m : batch.decoded) {
+			if (m.version.version > ver) ASSERT(m.version.version > data->version.get());
 
-			if (cloneCursor2->version().version > ver) ASSERT(cloneCursor2->version().version > data->version.get());
-
-			if (cloneCursor2->version().version > ver && cloneCursor2->version().version > data->version.get()) {
+			if (m.version.version > ver && m.version.version > data->version.get()) {
 				++data->counters.updateVersions;
-				ver = cloneCursor2->version().version;
+				ver = m.version.version;
 			}
 
-			if (LogProtocolMessage::isNextIn(rd)) {
-				LogProtocolMessage lpm;
-				rd >> lpm;
-
-				data->logProtocol = rd.protocolVersion();
+			if (m.isProtocol) {
+				data->logProtocol = m.protocol;
 				data->storage.changeLogProtocol(ver, data->logProtocol);
-				cloneCursor2->setProtocolVersion(rd.protocolVersion());
 			}
 			else {
-				MutationRef msg;
-				rd >> msg;
+				MutationRef const& msg = m.mutation;
 
 				if (ver != invalidVersion) {  // This change belongs to a version < minVersion
 					if (debugMutation("SSPeek", ver, msg) || ver == 1)
-						TraceEvent("SSPeekMutation", data->thisServerID).detail("Mutation", msg.toString()).detail("Version", cloneCursor2->version().toString());
+						TraceEvent("SSPeekMutation", data->thisServerID).detail("Mutation", msg.toString()).detail("Version", m.version.toString());
 
-					updater.applyMutation(data, msg, ver);
+					if( SERVER_KNOBS->STORAGE_FUSE_ATOMIC_OPS )
+						fuser.applyMutation(data, updater, msg, ver);
+					else
+						updater.applyMutation(data, msg, ver);
 
 					data->counters.mutationBytes += msg.totalSize();
+					data->writeSketch.add( msg.param1 );
 				}
 				else
-					TraceEvent(SevError, "DiscardingPeekedData", data->thisServerID).detail("Mutation", msg.toString()).detail("Version", cloneCursor2->version().toString());
+					TraceEvent(SevError, "DiscardingPeekedData", data->thisServerID).detail("Mutation", msg.toString()).detail("Version", m.version.toString());
 			}
 		}
 
+		fuser.flush(data, updater);
+
 		if(ver != invalidVersion) data->lastVersionWithData = ver;
-		ver = cloneCursor2->version().version - 1;
+		ver = batch.end.version - 1;
 		if(injectedChanges) data->lastVersionWithData = ver;
 
 		data->updateEagerReads = NULL;
 		data->debug_inApplyUpdate = false;
+		triggerPendingWatches( data );
 
 		if(ver == invalidVersion && !fii.changes.empty() ) {
 			ver = updater.currentVersion;
@@ -2517,7 +3715,7 @@ ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 
 		validate(data);
 
-		data->logCursor->advanceTo( cloneCursor2->version() );
+		data->logCursor->advanceTo( batch.end );
 		if(cursor->version().version >= data->lastTLogVersion) {
 			if(data->behind) {
 				TraceEvent("StorageServerNoLongerBehind", data->thisServerID).detail("CursorVersion", cursor->version().version).detail("TLogVersion", data->lastTLogVersion);
@@ -2533,6 +3731,47 @@ ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 	}
 }
 
+// With STORAGE_DURABILITY_LAG_TARGET set, sizes the next durable commit so that writing it is expected to take about that long at the
+//   rate recent commits achieved.  When the disk is the bottleneck, each commit fills up and the rate rises as commits get larger
+//   (SQLite pays one sync per commit), so commits grow until they take the target time; when the storage server keeps up, commits
+//   are small and the desired size drifts back down to STORAGE_COMMIT_BYTES.
+void updateCommitBytes( StorageServer* data ) {
+	if( SERVER_KNOBS->STORAGE_DURABILITY_LAG_TARGET <= 0 || data->lastCommitDuration <= 0 )
+		return;
+
+	double rate = data->lastCommitBytes / data->lastCommitDuration;
+	double alpha = SERVER_KNOBS->STORAGE_COMMIT_RATE_SMOOTHING_ALPHA;
+	data->commitBytesPerSecond = data->commitBytesPerSecond == 0 ? rate : alpha * rate + (1 - alpha) * data->commitBytesPerSecond;
+	data->desiredCommitBytes = std::max<int64_t>( SERVER_KNOBS->STORAGE_COMMIT_BYTES,
+		std::min<int64_t>( SERVER_KNOBS->STORAGE_COMMIT_BYTES_MAX, data->commitBytesPerSecond * SERVER_KNOBS->STORAGE_DURABILITY_LAG_TARGET ) );
+}
+
+// Called when storage has just been committed at a pinned version
+void takePinnedSnapshot( StorageServer* data, Version version ) {
+	auto pin = data->pinnedSnapshots.find( version );
+	if( pin == data->pinnedSnapshots.end() || pin->second.snapshot )
+		return;
+
+	pin->second.snapshot = data->storage.openSnapshot();
+	auto& readable = pin->second.readable;
+	auto available = data->newestAvailableVersion.ranges();
+	for(auto a = available.begin(); a != available.end(); ++a) {
+		if( a->value() <= version )
+			continue;
+		auto sh = data->shards.intersectingRanges( a->range() );
+		for(auto s = sh.begin(); s != sh.end(); ++s) {
+			if( !s->value()->isReadable() )
+				continue;
+			KeyRangeRef r = a->range() & s->range();
+			if( readable.size() && readable.back().end == r.begin )
+				readable.back() = KeyRangeRef( readable.back().begin, StringRef( readable.arena(), r.end ) );
+			else
+				readable.push_back_deep( readable.arena(), r );
+		}
+	}
+	TraceEvent("PinnedSnapshotTaken", data->thisServerID).detail("Version", version).detail("ReadableRanges", readable.size());
+}
+
 ACTOR Future<Void> updateStorage(StorageServer* data) {
 	loop {
 		ASSERT( data->durableVersion.get() == data->storageVersion() );
@@ -2542,8 +3781,15 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 		state Version startOldestVersion = data->storageVersion();
 		state Version newOldestVersion = data->storageVersion();
 		state Version desiredVersion = data->desiredOldestVersion.get();
-		state int64_t bytesLeft = SERVER_KNOBS->STORAGE_COMMIT_BYTES;
+		state int64_t commitBytes = data->desiredCommitBytes;
+		state int64_t bytesLeft = commitBytes;
+		state double commitStart = now();
 		loop {
+			// Stop at the next pinned version (which may have been pinned since the last pass), so that storage is committed exactly
+			// there and can be snapshotted
+			auto pin = data->pinnedSnapshots.upper_bound( newOldestVersion );
+			if( pin != data->pinnedSnapshots.end() && pin->first < desiredVersion )
+				desiredVersion = pin->first;
 			state bool done = data->storage.makeVersionMutationsDurable(newOldestVersion, desiredVersion, bytesLeft);
 			// We want to forget things from these data structures atomically with changing oldestVersion (and "before", since oldestVersion.set() may trigger waiting actors)
 			// forgetVersionsBeforeAsync visibly forgets immediately (without waiting) but asynchronously frees memory.
@@ -2560,6 +3806,7 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 		debug_advanceMaxCommittedVersion( data->thisServerID, newOldestVersion );
 		state Future<Void> durable = data->storage.commit();
 		state Future<Void> durableDelay = Void();
+		takePinnedSnapshot( data, newOldestVersion );
 
 		if (bytesLeft > 0)
 			durableDelay = delay(SERVER_KNOBS->STORAGE_COMMIT_INTERVAL);
@@ -2568,9 +3815,16 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 
 		debug_advanceMinCommittedVersion( data->thisServerID, newOldestVersion );
 
+		data->lastCommitBytes = commitBytes - bytesLeft;
+		data->lastCommitDuration = now() - commitStart;
+		++data->counters.durableCommits;
+		data->counters.bytesCommitted += data->lastCommitBytes;
+		updateCommitBytes( data );
+
 		// Taking and releasing the durableVersionLock ensures that no eager reads both begin before the commit was effective and
 		// are applied after we change the durable version.
 		Void _ = wait( data->durableVersionLock.take() );
+		++data->eagerReadEpoch;
 		data->durableVersionLock.release();
 
 		Void _ = wait( delay(0, TaskUpdateStorage) );
@@ -2581,7 +3835,7 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 			Void _ = wait( yield(TaskUpdateStorage) );
 		}
 
-		TraceEvent("StorageServerDurable", data->thisServerID).detail("Version", newOldestVersion);
+		TraceEvent("StorageServerDurable", data->thisServerID).detail("Version", newOldestVersion).detail("Bytes", data->lastCommitBytes).detail("Duration", data->lastCommitDuration).detail("DesiredCommitBytes", data->desiredCommitBytes);
 
 		Void _ = wait( durableDelay );
 	}
@@ -2598,6 +3852,7 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 static const KeyValueRef persistFormat( LiteralStringRef( PERSIST_PREFIX "Format" ), LiteralStringRef("FoundationDB/StorageServer/1/4") );
 static const KeyRangeRef persistFormatReadableRange( LiteralStringRef("FoundationDB/StorageServer/1/2"), LiteralStringRef("FoundationDB/StorageServer/1/5") );
 static const KeyRef persistID = LiteralStringRef( PERSIST_PREFIX "ID" );
+static const KeyRef persistValueCompression = LiteralStringRef( PERSIST_PREFIX "ValueCompression" );  // Present if values are stored compressed
 
 // (Potentially) change with the durable version or when fetchKeys completes
 static const KeyRef persistVersion = LiteralStringRef( PERSIST_PREFIX "Version" );
@@ -2614,6 +3869,10 @@ void StorageServerDisk::makeNewStorageServerDurable() {
 	storage->set( KeyValueRef(persistVersion, BinaryWriter::toValue(data->version.get(), Unversioned())) );
 	storage->set( KeyValueRef(persistShardAssignedKeys.begin.toString(), LiteralStringRef("0")) );
 	storage->set( KeyValueRef(persistShardAvailableKeys.begin.toString(), LiteralStringRef("0")) );
+	if( SERVER_KNOBS->STORAGE_VALUE_COMPRESSION ) {
+		compressValues = true;
+		storage->set( KeyValueRef(persistValueCompression, LiteralStringRef("1")) );
+	}
 }
 
 void setAvailableStatus( StorageServer* self, KeyRangeRef keys, bool available ) {
@@ -2650,19 +3909,73 @@ void setAssignedStatus( StorageServer* self, KeyRangeRef keys, bool nowAssigned
 	}
 }
 
+ACTOR Future<Void> commitAndInvalidateHotKeys( IKeyValueStore* storage, HotKeyCache* hotKeyCache ) {
+	state Standalone<VectorRef<KeyRangeRef>> writes = hotKeyCache->takeUncommittedWrites();
+	Void _ = wait( storage->commit() );
+	hotKeyCache->invalidateCommitted( writes );
+	return Void();
+}
+
+Future<Void> StorageServerDisk::commit() {
+	if( !data->hotKeyCache.enabled() )
+		return storage->commit();
+	return commitAndInvalidateHotKeys( storage, &data->hotKeyCache );
+}
+
 void StorageServerDisk::clearRange( KeyRangeRef keys ) {
+	data->hotKeyCache.invalidate( keys );
 	storage->clear(keys);
 }
 
+void StorageServerDisk::setStored( KeyValueRef kv ) {
+	if( !compressValues || !isCompressibleKey( kv.key ) ) {
+		storage->set( kv );
+		return;
+	}
+	Arena arena;
+	StringRef stored = compressValue( arena, kv.value, SERVER_KNOBS->STORAGE_VALUE_COMPRESSION_MIN_BYTES, SERVER_KNOBS->STORAGE_VALUE_COMPRESSION_LEVEL );
+	data->counters.compressionInputBytes += kv.value.size();
+	data->counters.compressionOutputBytes += stored.size();
+	storage->set( KeyValueRef(kv.key, stored), &arena );
+}
+
 void StorageServerDisk::writeKeyValue( KeyValueRef kv ) {
-	storage->set( kv );
+	data->hotKeyCache.invalidate( kv.key );
+	setStored( kv );
+}
+
+void StorageServerDisk::writeSortedKeyValues( VectorRef<KeyValueRef> sortedKeyValues, const Arena* arena ) {
+	if (!sortedKeyValues.size()) return;
+	data->hotKeyCache.invalidate( KeyRangeRef( sortedKeyValues.begin()->key, keyAfter( sortedKeyValues.end()[-1].key ) ) );
+	if( !compressValues ) {
+		storage->ingestSorted( sortedKeyValues, arena );
+		return;
+	}
+	Arena storedArena;
+	VectorRef<KeyValueRef> stored;
+	stored.reserve( storedArena, sortedKeyValues.size() );
+	for(auto& kv : sortedKeyValues) {
+		if( !isCompressibleKey( kv.key ) ) {
+			stored.push_back( storedArena, kv );
+			continue;
+		}
+		StringRef value = compressValue( storedArena, kv.value, SERVER_KNOBS->STORAGE_VALUE_COMPRESSION_MIN_BYTES, SERVER_KNOBS->STORAGE_VALUE_COMPRESSION_LEVEL );
+		data->counters.compressionInputBytes += kv.value.size();
+		data->counters.compressionOutputBytes += value.size();
+		stored.push_back( storedArena, KeyValueRef( kv.key, value ) );
+	}
+	if( arena )
+		storedArena.dependsOn( *arena );
+	storage->ingestSorted( stored, &storedArena );
 }
 
 void StorageServerDisk::writeMutation( MutationRef mutation ) {
 	// FIXME: debugMutation(debugContext, debugVersion, *m);
 	if (mutation.type == MutationRef::SetValue) {
-		storage->set( KeyValueRef(mutation.param1, mutation.param2) );
+		data->hotKeyCache.invalidate( mutation.param1 );
+		setStored( KeyValueRef(mutation.param1, mutation.param2) );
 	} else if (mutation.type == MutationRef::ClearRange) {
+		data->hotKeyCache.invalidate( KeyRangeRef(mutation.param1, mutation.param2) );
 		storage->clear( KeyRangeRef(mutation.param1, mutation.param2) );
 	} else
 		ASSERT(false);
@@ -2672,8 +3985,10 @@ void StorageServerDisk::writeMutations( MutationListRef mutations, Version debug
 	for(auto m = mutations.begin(); m; ++m) {
 		debugMutation(debugContext, debugVersion, *m);
 		if (m->type == MutationRef::SetValue) {
-			storage->set( KeyValueRef(m->param1, m->param2) );
+			data->hotKeyCache.invalidate( m->param1 );
+			setStored( KeyValueRef(m->param1, m->param2) );
 		} else if (m->type == MutationRef::ClearRange) {
+			data->hotKeyCache.invalidate( KeyRangeRef(m->param1, m->param2) );
 			storage->clear( KeyRangeRef(m->param1, m->param2) );
 		}
 	}
@@ -2724,7 +4039,10 @@ ACTOR Future<Void> applyByteSampleResult( StorageServer* data, KeyRange range, F
 	return Void();
 }
 
-ACTOR Future<Void> restoreByteSample(StorageServer* data, IKeyValueStore* storage, Standalone<VectorRef<KeyValueRef>> bsSample) {
+ACTOR Future<Void> restoreByteSample(StorageServer* data, IKeyValueStore* storage, Future<Standalone<VectorRef<KeyValueRef>>> fByteSampleSample) {
+	state double start = now();
+	Void _ = wait( applyByteSampleResult(data, persistByteSampleSampleKeys.removePrefix(persistByteSampleKeys.begin), fByteSampleSample) );
+	state Standalone<VectorRef<KeyValueRef>> bsSample = fByteSampleSample.get();
 	Void _ = wait( delay( BUGGIFY ? g_random->random01() * 2.0 : 0.0001 ) );
 
 	TraceEvent("RecoveredByteSampleSample", data->thisServerID).detail("Keys", bsSample.size()).detail("ReadBytes", bsSample.expectedSize());
@@ -2754,7 +4072,7 @@ ACTOR Future<Void> restoreByteSample(StorageServer* data, IKeyValueStore* storag
 	sampleRanges.push_back( applyByteSampleResult(data, KeyRangeRef(lastStart.removePrefix(persistByteSampleKeys.begin), LiteralStringRef("\xff\xff\xff")), storage->readRange( sampleRange )) );
 
 	Void _ = wait( waitForAll( sampleRanges ) );
-	TraceEvent("RecoveredByteSampleChunkedRead", data->thisServerID).detail("Ranges",sampleRanges.size());
+	TraceEvent("RecoveredByteSampleChunkedRead", data->thisServerID).detail("Ranges",sampleRanges.size()).detail("Duration", now() - start);
 
 	if( BUGGIFY )
 		Void _ = wait( delay( g_random->random01() * 10.0 ) );
@@ -2767,14 +4085,16 @@ ACTOR Future<bool> restoreDurableState( StorageServer* data, IKeyValueStore* sto
 	state Future<Optional<Value>> fID = storage->readValue(persistID);
 	state Future<Optional<Value>> fVersion = storage->readValue(persistVersion);
 	state Future<Optional<Value>> fLogProtocol = storage->readValue(persistLogProtocol);
+	state Future<Optional<Value>> fValueCompression = storage->readValue(persistValueCompression);
 	state Future<Standalone<VectorRef<KeyValueRef>>> fShardAssigned = storage->readRange(persistShardAssignedKeys);
 	state Future<Standalone<VectorRef<KeyValueRef>>> fShardAvailable = storage->readRange(persistShardAvailableKeys);
 	state Future<Standalone<VectorRef<KeyValueRef>>> fByteSampleSample = storage->readRange(persistByteSampleSampleKeys);
+	state double start = now();
 
 	TraceEvent("ReadingDurableState", data->thisServerID);
-	Void _ = wait( waitForAll( (vector<Future<Optional<Value>>>(), fFormat, fID, fVersion, fLogProtocol) ) );
-	Void _ = wait( waitForAll( (vector<Future<Standalone<VectorRef<KeyValueRef>>>>(), fShardAssigned, fShardAvailable, fByteSampleSample) ) );
-	TraceEvent("RestoringDurableState", data->thisServerID);
+	Void _ = wait( waitForAll( (vector<Future<Optional<Value>>>(), fFormat, fID, fVersion, fLogProtocol, fValueCompression) ) );
+	Void _ = wait( waitForAll( (vector<Future<Standalone<VectorRef<KeyValueRef>>>>(), fShardAssigned, fShardAvailable) ) );
+	TraceEvent("RestoringDurableState", data->thisServerID).detail("Duration", now() - start);
 
 	if (!fFormat.get().present()) {
 		// The DB was never initialized
@@ -2794,10 +4114,18 @@ ACTOR Future<bool> restoreDurableState( StorageServer* data, IKeyValueStore* sto
 	if (fLogProtocol.get().present())
 		data->logProtocol = BinaryReader::fromStringRef<uint64_t>(fLogProtocol.get().get(), Unversioned());
 
+	// Whatever SERVER_KNOBS->STORAGE_VALUE_COMPRESSION says now, the values were written the way the server was created to write them
+	data->storage.setCompressValues( fValueCompression.get().present() );
+	TraceEvent("StorageValueCompression", data->thisServerID).detail("Enabled", data->storage.getCompressValues());
+
 	state Version version = BinaryReader::fromStringRef<Version>( fVersion.get().get(), Unversioned() );
 	debug_checkRestoredVersion( data->thisServerID, version, "StorageServer" );
 	data->setInitialVersion( version );
 
+	// The byte sample is only needed for metrics, which wait for it, so rather than holding up recovery it is loaded in the
+	// background; byteSampleClears keeps changes made meanwhile from being overwritten by what is read
+	data->byteSampleRecovery = restoreByteSample(data, storage, fByteSampleSample);
+
 	state Standalone<VectorRef<KeyValueRef>> available = fShardAvailable.get();
 	state int availableLoc;
 	for(availableLoc=0; availableLoc<available.size(); availableLoc++) {
@@ -2828,8 +4156,7 @@ ACTOR Future<bool> restoreDurableState( StorageServer* data, IKeyValueStore* sto
 		Void _ = wait(yield());
 	}
 
-	Void _ = wait( applyByteSampleResult(data, persistByteSampleSampleKeys.removePrefix(persistByteSampleKeys.begin), fByteSampleSample) );
-	data->byteSampleRecovery = restoreByteSample(data, storage, fByteSampleSample.get());
+	TraceEvent("RestoredShardMaps", data->thisServerID).detail("Available", available.size()).detail("Assigned", assigned.size()).detail("Duration", now() - start);
 
 	Void _ = wait( delay( 0.0001 ) );
 
@@ -3041,6 +4368,18 @@ Future<Void> StorageServerMetrics::waitMetrics(WaitMetricsRequest req, Future<Vo
 /////////////////////////////// Core //////////////////////////////////////
 #pragma region Core
 
+ACTOR Future<Void> traceHotKeys( StorageServer* self ) {
+	loop {
+		Void _ = wait( delay( SERVER_KNOBS->HOT_KEY_LOGGING_INTERVAL ) );
+		TraceEvent ev("HotKeys", self->thisServerID);
+		self->readSketch.addDetails( ev, "Read", SERVER_KNOBS->HOT_KEY_LOGGING_INTERVAL, SERVER_KNOBS->HOT_KEY_DECAY );
+		self->writeSketch.addDetails( ev, "Write", SERVER_KNOBS->HOT_KEY_LOGGING_INTERVAL, SERVER_KNOBS->HOT_KEY_DECAY );
+		ev.trackLatest( (self->thisServerID.toString() + "/HotKeys").c_str() );
+		self->readSketch.decay( SERVER_KNOBS->HOT_KEY_DECAY );
+		self->writeSketch.decay( SERVER_KNOBS->HOT_KEY_DECAY );
+	}
+}
+
 ACTOR Future<Void> metricsCore( StorageServer* self, StorageServerInterface ssi ) {
 	state Future<Void> doPollMetrics = Void();
 	state ActorCollection actors(false);
@@ -3048,6 +4387,7 @@ ACTOR Future<Void> metricsCore( StorageServer* self, StorageServerInterface ssi
 	Void _ = wait( self->byteSampleRecovery );
 
 	actors.add(traceCounters("StorageMetrics", self->thisServerID, SERVER_KNOBS->STORAGE_LOGGING_DELAY, &self->counters.cc, self->thisServerID.toString() + "/StorageMetrics"));
+	actors.add(traceHotKeys(self));
 
 	loop {
 		choose {
@@ -3067,6 +4407,14 @@ ACTOR Future<Void> metricsCore( StorageServer* self, StorageServerInterface ssi
 					self->metrics.splitMetrics( req );
 				}
 			}
+			when (SplitRangeRequest req = waitNext(ssi.getRangeSplitPoints.getFuture())) {
+				if (!self->isReadable( req.keys )) {
+					TEST( true );	// getRangeSplitPoints immediate wrong_shard_server()
+					req.reply.sendError(wrong_shard_server());
+				} else {
+					self->metrics.getSplitPoints( req );
+				}
+			}
 			when (GetPhysicalMetricsRequest req = waitNext(ssi.getPhysicalMetrics.getFuture())) {
 				StorageBytes sb = self->storage.getStorageBytes();
 				self->metrics.getPhysicalMetrics( req, sb );
@@ -3095,7 +4443,7 @@ ACTOR Future<Void> storageServerCore( StorageServer* self, StorageServerInterfac
 {
 	state Future<Void> doUpdate = Void();
 	state bool updateReceived = false;  // true iff the current update() actor assigned to doUpdate has already received an update from the tlog
-	state ActorCollection actors(false);
+	state IntrusiveActorCollection actors;
 	state double lastLoopTopTime = now();
 	state Future<Void> dbInfoChange = Void();
 	state Future<Void> checkLastUpdate = Void();
@@ -3105,6 +4453,9 @@ ACTOR Future<Void> storageServerCore( StorageServer* self, StorageServerInterfac
 	actors.add(self->otherError.getFuture());
 	actors.add(metricsCore(self, ssi));
 	actors.add(logLongByteSampleRecovery(self->byteSampleRecovery));
+	actors.add(expirePinnedSnapshots(self));
+	if( SERVER_KNOBS->STORAGE_MEMORY_GOVERNOR )
+		actors.add(memoryGovernor(self));
 
 	self->coreStarted.send( Void() );
 
@@ -3134,7 +4485,7 @@ ACTOR Future<Void> storageServerCore( StorageServer* self, StorageServerInterfac
 				if( self->db->get().recoveryState >= RecoveryState::FULLY_RECOVERED ) {
 					self->logSystem = ILogSystem::fromServerDBInfo( self->thisServerID, self->db->get() );
 					if (self->logSystem) {
-						self->logCursor = self->logSystem->peekSingle( self->version.get() + 1, self->tag, self->history );
+						self->logCursor = self->logSystem->peekSingle( self->version.get() + 1, self->tag, self->history, SERVER_KNOBS->STORAGE_PARALLEL_PEEK );
 						self->popVersion( self->durableVersion.get() + 1, true );
 					}
 					// If update() is waiting for results from the tlog, it might never get them, so needs to be cancelled.  But if it is waiting later,
@@ -3154,9 +4505,15 @@ ACTOR Future<Void> storageServerCore( StorageServer* self, StorageServerInterfac
 				else
 					actors.add( getValueQ( self, req ) );
 			}
+			when( GetValuesRequest req = waitNext(ssi.getValues.getFuture()) ) {
+				// Warning: This code is executed at extremely high priority (TaskLoadBalancedEndpoint), so downgrade before doing real work
+				if( req.debugID.present() )
+					g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "storageServer.recieved");
+
+				actors.add( getValuesQ( self, req ) );
+			}
 			when( WatchValueRequest req = waitNext(ssi.watchValue.getFuture()) ) {
 				// TODO: fast load balancing?
-				// SOMEDAY: combine watches for the same key/value into a single watch
 				actors.add( watchValueQ( self, req ) );
 			}
 			when (GetKeyRequest req = waitNext(ssi.getKey.getFuture())) {
@@ -3167,6 +4524,24 @@ ACTOR Future<Void> storageServerCore( StorageServer* self, StorageServerInterfac
 				// Warning: This code is executed at extremely high priority (TaskLoadBalancedEndpoint), so downgrade before doing real work
 				actors.add( getKeyValues( self, req ) );
 			}
+			when (GetKeyValuesStreamRequest req = waitNext(ssi.getKeyValuesStream.getFuture()) ) {
+				// Warning: This code is executed at extremely high priority (TaskLoadBalancedEndpoint), so downgrade before doing real work
+				actors.add( getKeyValuesStreamQ( self, req ) );
+			}
+			when (GetRangeChecksumRequest req = waitNext(ssi.getRangeChecksum.getFuture()) ) {
+				// Warning: This code is executed at extremely high priority (TaskLoadBalancedEndpoint), so downgrade before doing real work
+				actors.add( getRangeChecksumQ( self, req ) );
+			}
+			when (GetRangeAggregateRequest req = waitNext(ssi.getRangeAggregate.getFuture()) ) {
+				// Warning: This code is executed at extremely high priority (TaskLoadBalancedEndpoint), so downgrade before doing real work
+				actors.add( getRangeAggregateQ( self, req ) );
+			}
+			when (PinSnapshotRequest req = waitNext(ssi.pinSnapshot.getFuture()) ) {
+				pinSnapshotQ( self, req );
+			}
+			when (ExportRangeRequest req = waitNext(ssi.exportRange.getFuture()) ) {
+				actors.add( exportRangeQ( self, req ) );
+			}
 			when (GetShardStateRequest req = waitNext(ssi.getShardState.getFuture()) ) {
 				if (req.mode == GetShardStateRequest::NO_WAIT ) {
 					if( self->isReadable( req.keys ) )
@@ -3374,16 +4749,16 @@ ACTOR Future<Void> storageServer( IKeyValueStore* persistentData, StorageServerI
 
 /*
 4 Reference count
-4 priority
+30 bits priority
+2 bits updated, replacedPointer
 24 pointers
 8 lastUpdateVersion
-2 updated, replacedPointer
 --
-42 PTree overhead
+40 PTree overhead
 
 8 Version insertVersion
 --
-50 VersionedMap overhead
+48 VersionedMap overhead
 
 12 KeyRef
 12 ValueRef
@@ -3392,19 +4767,17 @@ ACTOR Future<Void> storageServer( IKeyValueStore* persistentData, StorageServerI
 25 payload
 
 
-50 overhead
+48 overhead
 25 payload
-21 structure padding
-32 allocator rounds up
+7 structure padding
 ---
-128 allocated
+80 allocated (PTreeAllocator slots are exact multiples of 16 bytes; FastAllocated rounded 96 bytes up to 128)
 
-To reach 64, need to save: 11 bytes + all padding
+To reach 64, need to save: 9 bytes + all padding
 
 Possibilities:
   -8 Combine lastUpdateVersion, insertVersion?
-  -2 Fold together updated, replacedPointer, isClear bits
-  -3 Fold away updated, replacedPointer, isClear
+  -1 Fold isClear into a length bit
   -8 Move value lengths into arena
   -4 Replace priority with H(pointer)
   -12 Compress pointers (using special allocator)
@@ -3414,12 +4787,13 @@ Possibilities:
 void versionedMapTest() {
 	VersionedMap<int,int> vm;
 
-	printf("SS Ptree node is %zu bytes\n", sizeof( StorageServer::VersionedData::PTreeT ) );
+	printf("SS Ptree node is %zu bytes, allocated as %d bytes\n", sizeof( StorageServer::VersionedData::PTreeT ), StorageServer::VersionedData::PTreeT::allocatedSize );
 
 	const int NSIZE = sizeof(VersionedMap<int,int>::PTreeT);
-	const int ASIZE = NSIZE<=64 ? 64 : NextPowerOfTwo<NSIZE>::Result;
+	const int ASIZE = VersionedMap<int,int>::PTreeT::allocatedSize;
 
-	auto before = FastAllocator< ASIZE >::getMemoryUsed();
+	auto before = VersionedMap<int,int>::PTreeT::getMemoryUsed();
+	double startTime = timer();
 
 	for(int v=1; v<=1000; ++v) {
 		vm.createNewVersion(v);
@@ -3433,14 +4807,35 @@ void versionedMapTest() {
 		}
 	}
 
-	auto after = FastAllocator< ASIZE >::getMemoryUsed();
+	double insertTime = timer() - startTime;
+	auto after = VersionedMap<int,int>::PTreeT::getMemoryUsed();
 
 	int count = 0;
 	for(auto i = vm.atLatest().begin(); i != vm.atLatest().end(); ++i)
 		++count;
 
+	// Reads at a version in the middle of the window, which is where a storage server's reads mostly land
+	auto view = vm.at(500);
+	startTime = timer();
+	int found = 0;
+	for(int i=0; i<1000000; i++)
+		if( view.find( g_random->randomInt(0, 2000000) ) != view.end() )
+			++found;
+	double findTime = timer() - startTime;
+
+	startTime = timer();
+	int scanned = 0;
+	for(int i=0; i<10000; i++) {
+		auto it = view.lower_bound( g_random->randomInt(0, 2000000) );
+		for(int j=0; j<100 && it != view.end(); j++, ++it)
+			++scanned;
+	}
+	double scanTime = timer() - startTime;
+
 	printf("PTree node is %d bytes, allocated as %d bytes\n", NSIZE, ASIZE);
-	printf("%d distinct after %d insertions\n", count, 1000*1000);
+	printf("%d distinct after %d insertions in %f s\n", count, 1000*1000, insertTime);
 	printf("Memory used: %f MB\n",
 		 (after - before)/ 1e6);
+	printf("%d of 1000000 finds hit in %f s\n", found, findTime);
+	printf("%d items scanned in %f s\n", scanned, scanTime);
 }
@@ -36,6 +36,7 @@
 #include "fdbclient/FailureMonitorClient.h"
 #include "CoordinationInterface.h"
 #include "fdbclient/ManagementAPI.h"
+#include "fdbclient/Status.h"
 
 using namespace std;
 
@@ -775,10 +776,79 @@ ACTOR Future<Void> checkConsistency(Database cx, std::vector< TesterInterface >
 	}
 }
 
+void writeBenchmarkResults( TestSpec const& spec, vector<PerfMetric> const& metrics ) {
+	StatusObject values;
+	for(auto& m : metrics)
+		values[m.name()] = m.value();
+	StatusObject result;
+	result["title"] = printable(spec.title);
+	result["time"] = timer();
+	result["metrics"] = values;
+
+	std::ofstream out( spec.benchmarkResultsFile.c_str(), std::ios::out | std::ios::app );
+	out << json_spirit::write_string( json_spirit::mValue(result) ) << std::endl;
+	if( !out.good() )
+		TraceEvent(SevWarnAlways, "BenchmarkResultsNotWritten").detail("File", spec.benchmarkResultsFile).detail("Test", printable(spec.title));
+}
+
+// Lower is better for latencies, durations and failures; higher is better for rates and everything else
+bool benchmarkLowerIsBetter( std::string name ) {
+	std::transform( name.begin(), name.end(), name.begin(), ::tolower );
+	for(auto word : { "latency", "duration", "time", "retries", "conflict", "error", "fail" })
+		if( name.find(word) != std::string::npos )
+			return true;
+	return false;
+}
+
+// Returns false if any metric regressed from the baseline by more than spec.benchmarkRegressionTolerance
+bool checkBenchmarkBaseline( TestSpec const& spec, vector<PerfMetric> const& metrics ) {
+	std::string title = printable(spec.title);
+	std::ifstream in( spec.benchmarkBaselineFile.c_str() );
+	json_spirit::mObject baseline;
+	bool found = false;
+	std::string line;
+	while( std::getline( in, line ) ) {
+		json_spirit::mValue v;
+		if( !json_spirit::read_string( line, v ) || v.type() != json_spirit::obj_type )
+			continue;
+		json_spirit::mObject& o = v.get_obj();
+		auto t = o.find("title");
+		auto m = o.find("metrics");
+		if( t != o.end() && t->second.type() == json_spirit::str_type && t->second.get_str() == title && m != o.end() && m->second.type() == json_spirit::obj_type ) {
+			baseline = m->second.get_obj();
+			found = true;
+		}
+	}
+	if( !found ) {
+		TraceEvent(SevWarnAlways, "BenchmarkBaselineMissing").detail("File", spec.benchmarkBaselineFile).detail("Test", title);
+		return true;
+	}
+
+	bool ok = true;
+	for(auto& m : metrics) {
+		auto b = baseline.find(m.name());
+		if( b == baseline.end() || (b->second.type() != json_spirit::real_type && b->second.type() != json_spirit::int_type) )
+			continue;
+		double base = b->second.get_real();
+		if( base == 0 )
+			continue;
+		double change = (m.value() - base) / fabs(base);
+		bool regressed = benchmarkLowerIsBetter(m.name()) ? change > spec.benchmarkRegressionTolerance : change < -spec.benchmarkRegressionTolerance;
+		TraceEvent(regressed ? SevWarnAlways : SevInfo, regressed ? "BenchmarkRegression" : "BenchmarkComparison")
+			.detail("Test", title).detail("Metric", m.name()).detail("Baseline", base).detail("Value", m.value()).detail("Change", change);
+		if( regressed ) {
+			printf("REGRESSION: %s: %s = %f (baseline %f, %+.1f%%)\n", title.c_str(), m.name().c_str(), m.value(), base, change*100);
+			ok = false;
+		}
+	}
+	return ok;
+}
+
 ACTOR Future<bool> runTest( Database cx, std::vector< TesterInterface > testers, 
 			StringRef database, TestSpec spec ) 
 {
 	state DistributedTestResults testResults;
+	state bool benchmarkOk = true;
 
 	try {
 		Future<DistributedTestResults> fTestResults = runWorkload( cx, testers, database, spec );
@@ -788,6 +858,10 @@ ACTOR Future<bool> runTest( Database cx, std::vector< TesterInterface > testers,
 		DistributedTestResults _testResults = wait( fTestResults );
 		testResults = _testResults;
 		logMetrics( testResults.metrics );
+		if( spec.benchmarkResultsFile.size() )
+			writeBenchmarkResults( spec, testResults.metrics );
+		if( spec.benchmarkBaselineFile.size() )
+			benchmarkOk = checkBenchmarkBaseline( spec, testResults.metrics );
 	} catch(Error& e) {
 		if( e.code() == error_code_timed_out ) {
 			TraceEvent(SevError, "TestFailure").detail("Reason", "Test timed out").detail("Timeout", spec.timeout).error(e);
@@ -798,7 +872,7 @@ ACTOR Future<bool> runTest( Database cx, std::vector< TesterInterface > testers,
 			throw;
 	}
 
-	state bool ok = testResults.ok();
+	state bool ok = testResults.ok() && benchmarkOk;
 
 	if( spec.useDB ) {
 		if( spec.dumpAfterTest ) {
@@ -876,7 +950,11 @@ vector<TestSpec> readTests( ifstream& ifs ) {
 			}
 			if( spec.options.size() && spec.title.size() ) {
 				result.push_back( spec );
-				spec = TestSpec();
+				TestSpec next;
+				next.benchmarkResultsFile = spec.benchmarkResultsFile;
+				next.benchmarkBaselineFile = spec.benchmarkBaselineFile;
+				next.benchmarkRegressionTolerance = spec.benchmarkRegressionTolerance;
+				spec = next;
 			}
 
 			spec.title = StringRef( value );
@@ -961,6 +1039,16 @@ vector<TestSpec> readTests( ifstream& ifs ) {
 			TraceEvent("TestParserTest").detail("ParsedMinimumReplication", "");
 		} else if( attrib == "buggify" ) {
 			TraceEvent("TestParserTest").detail("ParsedBuggify", "");
+		} else if( attrib == "benchmarkResultsFile" ) {
+			spec.benchmarkResultsFile = value;
+			TraceEvent("TestParserTest").detail("ParsedBenchmarkResultsFile", value);
+		} else if( attrib == "benchmarkBaselineFile" ) {
+			spec.benchmarkBaselineFile = value;
+			TraceEvent("TestParserTest").detail("ParsedBenchmarkBaselineFile", value);
+		} else if( attrib == "benchmarkRegressionTolerance" ) {
+			sscanf( value.c_str(), "%lf", &spec.benchmarkRegressionTolerance );
+			ASSERT( spec.benchmarkRegressionTolerance >= 0 );
+			TraceEvent("TestParserTest").detail("ParsedBenchmarkRegressionTolerance", spec.benchmarkRegressionTolerance);
 		} else if( attrib == "checkOnly" ) {
 			if(value == "true")
 				spec.phases = TestWorkload::CHECK;
@@ -38,6 +38,7 @@
 #include "fdbclient/MonitorLeader.h"
 #include "fdbclient/ClientWorkerInterface.h"
 #include "flow/Profiler.h"
+#include "CoroFlow.h"
 
 #ifdef __linux__
 #ifdef USE_GPERFTOOLS
@@ -129,6 +130,13 @@ ACTOR Future<Void> handleIOErrors( Future<Void> actor, IClosable* store, UID id,
 	}
 }
 
+// Traces how long after the worker started the given role's restored data was recovered
+ACTOR Future<Void> traceRecovery( Future<Void> recovery, const char* role, UID id, double startTime ) {
+	Void _ = wait( recovery );
+	TraceEvent("RoleRecovered", id).detail("Role", role).detail("Duration", now() - startTime);
+	return Void();
+}
+
 ACTOR Future<Void> workerHandleErrors(FutureStream<ErrorInfo> errors) {
 	loop choose {
 		when( ErrorInfo _err = waitNext(errors) ) {
@@ -180,6 +188,7 @@ StringRef fileLogQueuePrefix = LiteralStringRef("logqueue-");
 std::pair<KeyValueStoreType, std::string> bTreeV1Suffix  = std::make_pair( KeyValueStoreType::SSD_BTREE_V1, ".fdb" );
 std::pair<KeyValueStoreType, std::string> bTreeV2Suffix = std::make_pair(KeyValueStoreType::SSD_BTREE_V2,   ".sqlite");
 std::pair<KeyValueStoreType, std::string> memorySuffix = std::make_pair( KeyValueStoreType::MEMORY,         "-0.fdq" );
+std::pair<KeyValueStoreType, std::string> lsmSuffix = std::make_pair( KeyValueStoreType::LSM,               ".lsm" );
 
 std::string validationFilename = "_validate";
 
@@ -190,6 +199,8 @@ std::string filenameFromSample( KeyValueStoreType storeType, std::string folder,
 		return joinPath(folder, sample_filename);
 	else if( storeType == KeyValueStoreType::MEMORY )
 		return joinPath( folder, sample_filename.substr(0, sample_filename.size() - 5) );
+	else if( storeType == KeyValueStoreType::LSM )
+		return joinPath( folder, sample_filename );
 
 	UNREACHABLE();
 }
@@ -201,6 +212,8 @@ std::string filenameFromId( KeyValueStoreType storeType, std::string folder, std
 		return joinPath(folder, prefix + id.toString() + ".sqlite");
 	else if( storeType == KeyValueStoreType::MEMORY )
 		return joinPath( folder, prefix + id.toString() + "-" );
+	else if( storeType == KeyValueStoreType::LSM )
+		return joinPath( folder, prefix + id.toString() + ".lsm" );
 
 	UNREACHABLE();
 }
@@ -247,6 +260,8 @@ std::vector< DiskStore > getDiskStores( std::string folder ) {
 	result.insert( result.end(), result1.begin(), result1.end() );
 	auto result2 = getDiskStores( folder, memorySuffix.second, memorySuffix.first );
 	result.insert( result.end(), result2.begin(), result2.end() );
+	auto result3 = getDiskStores( folder, lsmSuffix.second, lsmSuffix.first );
+	result.insert( result.end(), result3.begin(), result3.end() );
 	return result;
 }
 
@@ -267,6 +282,19 @@ ACTOR Future<Void> registrationClient( Reference<AsyncVar<Optional<ClusterContro
 	}
 }
 
+ACTOR Future<Void> reportWorkerHealth( Reference<AsyncVar<Optional<ClusterControllerFullInterface>>> ccInterface, WorkerInterface interf ) {
+	// Sends the cluster controller the latencies of this process's disk operations, so that recruitment can avoid a degraded disk
+	loop {
+		Void _ = wait( delay( SERVER_KNOBS->WORKER_HEALTH_REPORT_INTERVAL ) );
+		LatencyHistogram& recent = g_network->diskLatencyProfile.recent;
+		if( recent.count() >= SERVER_KNOBS->DEGRADED_DISK_MIN_OPERATIONS ) {
+			if( ccInterface->get().present() )
+				ccInterface->get().get().updateWorkerHealth.send( UpdateWorkerHealthRequest( interf.locality.processId(), recent.toString() ) );
+			recent.clear();
+		}
+	}
+}
+
 #if defined(__linux__) && defined(USE_GPERFTOOLS)
 //A set of threads that should be profiled
 std::set<std::thread::id> profiledThreads;
@@ -310,6 +338,8 @@ void updateCpuProfiler(ProfilerRequest req) {
 		case ProfilerRequest::Action::RUN:
 			ASSERT(false);  // User should have called runProfiler.
 			break;
+		default:
+			break;
 		}
 #endif
 		break;
@@ -324,6 +354,25 @@ void updateCpuProfiler(ProfilerRequest req) {
 		case ProfilerRequest::Action::RUN:
 			ASSERT(false);  // User should have called runProfiler.
 			break;
+		case ProfilerRequest::Action::DUMP:
+			dumpContinuousProfile(req.outputFile.toString());
+			break;
+		}
+		break;
+	case ProfilerRequest::Type::HEAP:
+		switch (req.action) {
+		case ProfilerRequest::Action::ENABLE:
+			setHeapSampleBytes(FLOW_KNOBS->HEAP_PROFILER_SAMPLE_BYTES);
+			break;
+		case ProfilerRequest::Action::DISABLE:
+			setHeapSampleBytes(0);
+			break;
+		case ProfilerRequest::Action::RUN:
+			ASSERT(false);  // User should have called runProfiler.
+			break;
+		case ProfilerRequest::Action::DUMP:
+			dumpHeapSamples(req.outputFile.toString());
+			break;
 		}
 		break;
 	}
@@ -334,6 +383,11 @@ ACTOR Future<Void> runProfiler(ProfilerRequest req) {
 		req.action = ProfilerRequest::Action::ENABLE;
 		updateCpuProfiler(req);
 		Void _ = wait(delay(req.duration));
+		if (req.type == ProfilerRequest::Type::HEAP) {
+			// The heap samples are only kept in memory, so write them out before dropping them
+			req.action = ProfilerRequest::Action::DUMP;
+			updateCpuProfiler(req);
+		}
 		req.action = ProfilerRequest::Action::DISABLE;
 		updateCpuProfiler(req);
 		return Void();
@@ -572,6 +626,7 @@ ACTOR Future<Void> workerServer( Reference<ClusterConnectionFile> connFile, Refe
 	}
 
 	try {
+		state double recoveryStart = now();
 		std::vector<DiskStore> stores = getDiskStores( folder );
 		bool validateDataFiles = deleteFile(joinPath(folder, validationFilename));
 		std::vector<Future<Void>> recoveries;
@@ -594,11 +649,18 @@ ACTOR Future<Void> workerServer( Reference<ClusterConnectionFile> connFile, Refe
 
 				DUMPTOKEN(recruited.getVersion);
 				DUMPTOKEN(recruited.getValue);
+				DUMPTOKEN(recruited.getValues);
 				DUMPTOKEN(recruited.getKey);
 				DUMPTOKEN(recruited.getKeyValues);
+				DUMPTOKEN(recruited.getKeyValuesStream);
+				DUMPTOKEN(recruited.getRangeChecksum);
+				DUMPTOKEN(recruited.getRangeAggregate);
+				DUMPTOKEN(recruited.pinSnapshot);
+				DUMPTOKEN(recruited.exportRange);
 				DUMPTOKEN(recruited.getShardState);
 				DUMPTOKEN(recruited.waitMetrics);
 				DUMPTOKEN(recruited.splitMetrics);
+				DUMPTOKEN(recruited.getRangeSplitPoints);
 				DUMPTOKEN(recruited.getPhysicalMetrics);
 				DUMPTOKEN(recruited.waitFailure);
 				DUMPTOKEN(recruited.getQueuingMetrics);
@@ -607,7 +669,7 @@ ACTOR Future<Void> workerServer( Reference<ClusterConnectionFile> connFile, Refe
 
 				Promise<Void> recovery;
 				Future<Void> f = storageServer( kv, recruited, dbInfo, folder, recovery );
-				recoveries.push_back(recovery.getFuture());
+				recoveries.push_back( traceRecovery( recovery.getFuture(), "StorageServer", s.storeID, recoveryStart ) );
 				f =  handleIOErrors( f, kv, s.storeID, kvClosed );
 				f = storageServerRollbackRebooter( f, s.storeType, s.filename, recruited.id(), recruited.locality, dbInfo, folder, &filesClosed, memoryLimit );
 				errorForwarders.add( forwardError( errors, "StorageServer", recruited.id(), f ) );
@@ -625,7 +687,7 @@ ACTOR Future<Void> workerServer( Reference<ClusterConnectionFile> connFile, Refe
 				Promise<Void> oldLog;
 				Promise<Void> recovery;
 				Future<Void> tl = tLog( kv, queue, dbInfo, locality, tlog.isReady() ? tlogRequests : PromiseStream<InitializeTLogRequest>(), s.storeID, true, oldLog, recovery );
-				recoveries.push_back(recovery.getFuture());
+				recoveries.push_back( traceRecovery( recovery.getFuture(), "SharedTLog", s.storeID, recoveryStart ) );
 
 				tl = handleIOErrors( tl, kv, s.storeID );
 				tl = handleIOErrors( tl, queue, s.storeID );
@@ -641,11 +703,13 @@ ACTOR Future<Void> workerServer( Reference<ClusterConnectionFile> connFile, Refe
 		details["DataFolder"] = folder;
 		details["StoresPresent"] = format("%d", stores.size());
 		startRole( interf.id(), interf.id(), "Worker", details );
+		TraceEvent("WorkerStoresOpened", interf.id()).detail("Stores", stores.size()).detail("Duration", now() - recoveryStart);
 
 		Void _ = wait(waitForAll(recoveries));
 		errorForwarders.add( registrationClient( ccInterface, interf, asyncPriorityInfo, initialClass ) );
+		errorForwarders.add( reportWorkerHealth( ccInterface, interf ) );
 
-		TraceEvent("RecoveriesComplete", interf.id());
+		TraceEvent("RecoveriesComplete", interf.id()).detail("Duration", now() - recoveryStart);
 
 		loop choose {
 
@@ -743,11 +807,18 @@ ACTOR Future<Void> workerServer( Reference<ClusterConnectionFile> connFile, Refe
 
 					DUMPTOKEN(recruited.getVersion);
 					DUMPTOKEN(recruited.getValue);
+					DUMPTOKEN(recruited.getValues);
 					DUMPTOKEN(recruited.getKey);
 					DUMPTOKEN(recruited.getKeyValues);
+					DUMPTOKEN(recruited.getKeyValuesStream);
+					DUMPTOKEN(recruited.getRangeChecksum);
+					DUMPTOKEN(recruited.getRangeAggregate);
+					DUMPTOKEN(recruited.pinSnapshot);
+					DUMPTOKEN(recruited.exportRange);
 					DUMPTOKEN(recruited.getShardState);
 					DUMPTOKEN(recruited.waitMetrics);
 					DUMPTOKEN(recruited.splitMetrics);
+					DUMPTOKEN(recruited.getRangeSplitPoints);
 					DUMPTOKEN(recruited.getPhysicalMetrics);
 					DUMPTOKEN(recruited.waitFailure);
 					DUMPTOKEN(recruited.getQueuingMetrics);
@@ -817,6 +888,7 @@ ACTOR Future<Void> workerServer( Reference<ClusterConnectionFile> connFile, Refe
 
 				DUMPTOKEN( recruited.peekMessages );
 				DUMPTOKEN( recruited.popMessages );
+				DUMPTOKEN( recruited.popBatch );
 				DUMPTOKEN( recruited.commit );
 				DUMPTOKEN( recruited.lock );
 				DUMPTOKEN( recruited.getQueuingMetrics );
@@ -862,6 +934,9 @@ ACTOR Future<Void> workerServer( Reference<ClusterConnectionFile> connFile, Refe
 						else if (d.storeType == KeyValueStoreType::SSD_BTREE_V2) {
 							included = fileExists(d.filename + ".sqlite-wal");
 						}
+						else if (d.storeType == KeyValueStoreType::LSM) {
+							included = fileExists(d.filename + "-log1.fdq");
+						}
 						else {
 							ASSERT(d.storeType == KeyValueStoreType::MEMORY);
 							included = fileExists(d.filename + "1.fdq");
@@ -879,6 +954,8 @@ ACTOR Future<Void> workerServer( Reference<ClusterConnectionFile> connFile, Refe
 			}
 			when( Void _ = wait( loggingTrigger ) ) {
 				systemMonitor();
+				FlowTransport::transport().logRpcLatencyMetrics();
+				CoroThreadPool::logMetrics();
 				loggingTrigger = delay( loggingDelay, TaskFlushTrace );
 			}
 			when( Void _ = wait( errorForwarders.getResult() ) ) {}
@@ -340,6 +340,7 @@ struct AsyncFileReadWorkload : public AsyncFileWorkload
 		{
 			m.push_back(PerfMetric("Bytes read/sec", bytesRead.getValue() / testDuration, false));
 			m.push_back(PerfMetric("Average CPU Utilization (Percentage)", averageCpuUtilization * 100, false));
+			m.push_back(PerfMetric("Using io_uring", FLOW_KNOBS->USE_IO_URING, false)); // distinguishes results when comparing against kernel AIO
 		}
 	}
  };
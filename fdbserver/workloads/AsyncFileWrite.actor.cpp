@@ -169,6 +169,7 @@ struct AsyncFileWriteWorkload : public AsyncFileWorkload
 		{
 			m.push_back(PerfMetric("Bytes written/sec", bytesWritten.getValue() / testDuration, false));
 			m.push_back(PerfMetric("Average CPU Utilization (Percentage)", averageCpuUtilization * 100, false));
+			m.push_back(PerfMetric("Using io_uring", FLOW_KNOBS->USE_IO_URING, false)); // distinguishes results when comparing against kernel AIO
 		}
 	}
  };
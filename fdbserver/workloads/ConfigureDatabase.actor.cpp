@@ -26,7 +26,7 @@
 #include "fdbrpc/simulator.h"
 
 // "ssd" is an alias to the preferred type which skews the random distribution toward it but that's okay.
-static const char* storeTypes[] = { "ssd", "ssd-1", "ssd-2", "memory" };
+static const char* storeTypes[] = { "ssd", "ssd-1", "ssd-2", "memory", "lsm" };
 static const char* redundancies[] = { "single", "double", "triple" };
 
 struct ConfigureDatabaseWorkload : TestWorkload {
@@ -62,6 +62,9 @@ struct ConsistencyCheckWorkload : TestWorkload
 	//Randomize shard order with each iteration if true
 	bool shuffleShards;
 
+	//If true, read each range in full from only one storage server and compare the others' checksums of it, reading in full only from those that differ
+	bool compareChecksums;
+
 	bool success;
 
 	//Number of times this client has run its portion of the consistency check
@@ -80,6 +83,7 @@ struct ConsistencyCheckWorkload : TestWorkload
 		failureIsError = getOption(options, LiteralStringRef("failureIsError"), false);
 		rateLimit = getOption(options, LiteralStringRef("rateLimit"), 0);
 		shuffleShards = getOption(options, LiteralStringRef("shuffleShards"), false);
+		compareChecksums = getOption(options, LiteralStringRef("compareChecksums"), g_network->isSimulated() ? g_random->random01() < 0.5 : true);
 		indefinite = getOption(options, LiteralStringRef("indefinite"), false);
 
 		success = true;
@@ -709,11 +713,51 @@ struct ConsistencyCheckWorkload : TestWorkload
 
 						//Try getting the entries in the specified range
 						state vector<Future<ErrorOr<GetKeyValuesReply>>> keyValueFutures;
+						state vector<bool> matchedByChecksum(storageServerInterfaces.size(), false);
 						state int j = 0;
-						for(j = 0; j < storageServerInterfaces.size(); j++)
+						if(self->compareChecksums && storageServerInterfaces.size() > 1)
 						{
+							//Read the entries from the first storage server, and ask the others for a checksum of the same range
 							resetReply(req);
-							keyValueFutures.push_back(storageServerInterfaces[j].getKeyValues.getReplyUnlessFailedFor(req, 2, 0));
+							keyValueFutures.push_back(storageServerInterfaces[0].getKeyValues.getReplyUnlessFailedFor(req, 2, 0));
+							ErrorOr<GetKeyValuesReply> firstReply = wait(keyValueFutures[0]);
+
+							state vector<Future<ErrorOr<GetRangeChecksumReply>>> checksumFutures;
+							state RangeChecksum firstChecksum;
+							if(firstReply.present() && (firstReply.get().data.size() || !firstReply.get().more))
+							{
+								firstChecksum.add(firstReply.get().data);
+								Key hashedBegin = req.begin.orEqual ? keyAfter(req.begin.getKey()) : Key(req.begin.getKey());
+								Key hashedEnd = firstReply.get().more ? keyAfter(firstReply.get().data.end()[-1].key) : range.end;
+								GetRangeChecksumRequest checksumReq(KeyRangeRef(hashedBegin, hashedEnd), req.version);
+								for(j = 1; j < storageServerInterfaces.size(); j++)
+									checksumFutures.push_back(storageServerInterfaces[j].getRangeChecksum.getReplyUnlessFailedFor(checksumReq, 2, 0));
+							}
+
+							Void _ = wait(waitForAll(checksumFutures));
+
+							//The entries of a server whose checksum matches are the first server's; the rest are read in full, to be compared below
+							for(j = 1; j < storageServerInterfaces.size(); j++)
+							{
+								if(j - 1 < checksumFutures.size() && checksumFutures[j - 1].get().present() && checksumFutures[j - 1].get().get().checksum == firstChecksum)
+								{
+									matchedByChecksum[j] = true;
+									keyValueFutures.push_back(keyValueFutures[0]);
+								}
+								else
+								{
+									resetReply(req);
+									keyValueFutures.push_back(storageServerInterfaces[j].getKeyValues.getReplyUnlessFailedFor(req, 2, 0));
+								}
+							}
+						}
+						else
+						{
+							for(j = 0; j < storageServerInterfaces.size(); j++)
+							{
+								resetReply(req);
+								keyValueFutures.push_back(storageServerInterfaces[j].getKeyValues.getReplyUnlessFailedFor(req, 2, 0));
+							}
 						}
 
 						Void _ = wait(waitForAll(keyValueFutures));
@@ -729,7 +773,8 @@ struct ConsistencyCheckWorkload : TestWorkload
 							if(rangeResult.present())
 							{
 								state GetKeyValuesReply current = rangeResult.get();
-								totalReadAmount += current.data.expectedSize();
+								if(!matchedByChecksum[j])
+									totalReadAmount += current.data.expectedSize();
 								//If we haven't encountered a valid storage server yet, then mark this as the baseline to compare against
 								if(firstValidServer == -1)
 									firstValidServer = j;
@@ -27,7 +27,7 @@
 #include "workloads.h"
 
 struct FastTriggeredWatchesWorkload : TestWorkload {
-	int nodes, keyBytes;
+	int nodes, keyBytes, extraWatchers;
 	double testDuration;
 	vector<Future<Void>> clients;
 	PerfIntCounter operations, retries;
@@ -40,6 +40,8 @@ struct FastTriggeredWatchesWorkload : TestWorkload {
 		nodes = getOption( options, LiteralStringRef("nodes"), 100 );
 		defaultValue = StringRef(format( "%010d", g_random->randomInt( 0, 1000 ) ));
 		keyBytes = std::max( getOption( options, LiteralStringRef("keyBytes"), 16 ), 16 );
+		// Additional watches on each set key, which should all be triggered about as fast as the measured one
+		extraWatchers = getOption( options, LiteralStringRef("extraWatchers"), 0 );
 	}
 
 	virtual std::string description() { return "Watches"; }
@@ -93,9 +95,30 @@ struct FastTriggeredWatchesWorkload : TestWorkload {
 		}
 	}
 
+	ACTOR static Future<Void> extraWatcher( Database cx, Key key, Optional<Value> value, FastTriggeredWatchesWorkload* self ) {
+		loop {
+			state ReadYourWritesTransaction tr( cx );
+			try {
+				Optional<Value> val = wait( tr.get( key ) );
+				if( val == value ) {
+					++self->operations;
+					return Void();
+				}
+				state Future<Void> watchFuture = tr.watch( key );
+				Void _ = wait( tr.commit() );
+				Void _ = wait( watchFuture );
+			} catch( Error &e ) {
+				++self->retries;
+				Void _ = wait( tr.onError(e) );
+			}
+		}
+	}
+
 	ACTOR static Future<Void> _start( Database cx, FastTriggeredWatchesWorkload* self ) {
 		state double testStart = now();
 		state Version lastReadVersion = 0;
+		if( self->extraWatchers )
+			cx->maxOutstandingWatches = CLIENT_KNOBS->ABSOLUTE_MAX_WATCHES;
 		try {
 			loop {
 				state double getDuration = 0;
@@ -105,6 +128,9 @@ struct FastTriggeredWatchesWorkload : TestWorkload {
 				state Optional<Value> setValue;
 				if( g_random->random01() > 0.5 )
 					setValue = StringRef(format( "%010d", g_random->randomInt( 0, 1000 )));
+				state std::vector<Future<Void>> extraWatches;
+				for( int i = 0; i < self->extraWatchers; i++ )
+					extraWatches.push_back( self->extraWatcher( cx, setKey, setValue, self ) );
 				state Future<Version> setFuture = self->setter( cx, setKey, setValue );
 				Void _ = wait( delay( g_random->random01() ) );
 				loop {
@@ -132,6 +158,7 @@ struct FastTriggeredWatchesWorkload : TestWorkload {
 						Void _ = wait( tr.onError(e) );
 					}
 				}
+				Void _ = wait( waitForAll( extraWatches ) );
 				Version ver = wait( setFuture );
 				//TraceEvent("FTWWatchDone").detail("key", printable(setKey));
 				ASSERT( lastReadVersion - ver >= SERVER_KNOBS->MAX_VERSIONS_IN_FLIGHT || lastReadVersion - ver < SERVER_KNOBS->VERSIONS_PER_SECOND*(12+getDuration) );
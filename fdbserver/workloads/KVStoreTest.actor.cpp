@@ -204,6 +204,7 @@ struct KVStoreTestWorkload : TestWorkload {
 	Histogram<float> readLatency, commitLatency;
 	double setupTook;
 	std::string storeType;
+	int pageSize;
 
 	KVStoreTestWorkload( WorkloadContext const& wcx )
 		: TestWorkload(wcx), reads("Reads"), sets("Sets"), commits("Commits"), setupTook(0)
@@ -222,6 +223,7 @@ struct KVStoreTestWorkload : TestWorkload {
 		filename = getOption( options, LiteralStringRef("filename"), Value() ).toString();
 		saturation = getOption( options, LiteralStringRef("saturation"), false );
 		storeType = getOption( options, LiteralStringRef("storeType"), LiteralStringRef("ssd") ).toString();
+		pageSize = getOption( options, LiteralStringRef("pageSize"), 0 ); // For ssd stores created by the test; 0 uses SQLITE_PAGE_SIZE
 	}
 	virtual std::string description() { return "KVStoreTest"; }
 	virtual Future<Void> setup( Database const& cx ) { return Void(); }
@@ -374,13 +376,15 @@ ACTOR Future<Void> testKVStore(KVStoreTestWorkload* workload) {
 	UID id = g_random->randomUniqueID();
 	std::string fn = workload->filename.size() ? workload->filename : id.toString();
 	if (workload->storeType == "ssd")
-		test.store = keyValueStoreSQLite( fn, id, KeyValueStoreType::SSD_BTREE_V2);
+		test.store = keyValueStoreSQLite( fn, id, KeyValueStoreType::SSD_BTREE_V2, false, false, workload->pageSize);
 	else if (workload->storeType == "ssd-1")
-		test.store = keyValueStoreSQLite( fn, id, KeyValueStoreType::SSD_BTREE_V1);
+		test.store = keyValueStoreSQLite( fn, id, KeyValueStoreType::SSD_BTREE_V1, false, false, workload->pageSize);
 	else if (workload->storeType == "ssd-2")
-		test.store = keyValueStoreSQLite( fn, id, KeyValueStoreType::SSD_BTREE_V2);
+		test.store = keyValueStoreSQLite( fn, id, KeyValueStoreType::SSD_BTREE_V2, false, false, workload->pageSize);
 	else if (workload->storeType == "memory")
 		test.store = keyValueStoreMemory( fn, id, 500e6 );
+	else if (workload->storeType == "lsm")
+		test.store = keyValueStoreLSM( fn, id );
 	else
 		ASSERT(false);
 
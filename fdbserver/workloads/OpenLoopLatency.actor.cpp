@@ -0,0 +1,186 @@
+/*
+ * OpenLoopLatency.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flow/actorcompiler.h"
+#include "fdbclient/NativeAPI.h"
+#include "fdbserver/TesterInterface.h"
+#include "workloads.h"
+#include "BulkSetup.actor.h"
+#include "flow/Histogram.h"
+
+// Issues transactions at a target arrival rate regardless of how many are still outstanding (an open loop), in a series of
+// steps of increasing rate.  Latency is measured from when each transaction was supposed to start, so time spent queued behind
+// a slow system is counted rather than hidden the way it is by closed-loop clients (coordinated omission).  Each step's latency
+// distribution is reported, giving latency as a function of throughput up to the step where the cluster saturates.
+struct OpenLoopLatencyWorkload : KVWorkload {
+	struct Step {
+		double targetRate;  // Over all clients
+		double duration;
+		int64_t issued, completed, dropped, retries, outstanding;
+		LatencyHistogram latency;  // From intended start to completion
+		LatencyHistogram startDelay;  // From intended start to actual start
+
+		explicit Step( double targetRate ) : targetRate(targetRate), duration(0), issued(0), completed(0), dropped(0), retries(0), outstanding(0) {}
+		double achievedRate() const { return duration ? completed / duration : 0; }
+	};
+
+	double stepDuration, warmingDelay, saturationThreshold;
+	int readsPerTransaction, writesPerTransaction, maxOutstanding;
+	std::string valueString;
+	std::vector<Step> steps;  // Never resized while running, since transactions hold pointers into it
+	int stepsRun;
+
+	OpenLoopLatencyWorkload(WorkloadContext const& wcx)
+		: KVWorkload(wcx), stepsRun(0)
+	{
+		stepDuration = getOption( options, LiteralStringRef("stepDuration"), 30.0 );
+		warmingDelay = getOption( options, LiteralStringRef("warmingDelay"), 0.0 );
+		readsPerTransaction = getOption( options, LiteralStringRef("readsPerTransaction"), 10 );
+		writesPerTransaction = getOption( options, LiteralStringRef("writesPerTransaction"), 0 );
+		// Arrivals while this many transactions are outstanding on a client are counted as dropped rather than issued
+		maxOutstanding = getOption( options, LiteralStringRef("maxOutstanding"), 10000 );
+		// A step at which the achieved rate is less than this fraction of the target rate is saturated, and is the last step
+		saturationThreshold = getOption( options, LiteralStringRef("saturationThreshold"), 0.9 );
+		valueString = std::string( maxValueBytes, '.' );
+
+		double startRate = getOption( options, LiteralStringRef("startRate"), 1000.0 );
+		double rateMultiplier = getOption( options, LiteralStringRef("rateMultiplier"), 2.0 );
+		double maxRate = getOption( options, LiteralStringRef("maxRate"), 1e6 );
+		int maxSteps = getOption( options, LiteralStringRef("maxSteps"), 20 );
+		ASSERT( startRate > 0 && rateMultiplier > 1 );
+		for(double rate = startRate; rate <= maxRate && steps.size() < maxSteps; rate *= rateMultiplier)
+			steps.push_back( Step( rate ) );
+	}
+
+	virtual std::string description() { return "OpenLoopLatency"; }
+
+	virtual Future<Void> setup( Database const& cx ) {
+		return bulkSetup( cx, this, nodeCount, Promise<double>(), writesPerTransaction == 0, warmingDelay );
+	}
+
+	virtual Future<Void> start( Database const& cx ) {
+		return _start( cx, this );
+	}
+
+	virtual Future<bool> check( Database const& cx ) {
+		return true;
+	}
+
+	virtual void getMetrics( vector<PerfMetric>& m ) {
+		for(int i = 0; i < stepsRun; i++) {
+			Step& s = steps[i];
+			std::string prefix = format( "Step %02d (%.0f/sec) ", i, s.targetRate );
+			m.push_back( PerfMetric( prefix + "Transactions/sec", s.achievedRate(), false ) );
+			m.push_back( PerfMetric( prefix + "Dropped", s.dropped, false ) );
+			m.push_back( PerfMetric( prefix + "Retries", s.retries, false ) );
+			m.push_back( PerfMetric( prefix + "Mean Latency (ms, averaged)", 1000 * s.latency.mean(), true ) );
+			m.push_back( PerfMetric( prefix + "Median Latency (ms, averaged)", 1000 * s.latency.median(), true ) );
+			m.push_back( PerfMetric( prefix + "99% Latency (ms, averaged)", 1000 * s.latency.percentile( 0.99 ), true ) );
+			m.push_back( PerfMetric( prefix + "99.9% Latency (ms, averaged)", 1000 * s.latency.percentile( 0.999 ), true ) );
+			m.push_back( PerfMetric( prefix + "Max Latency (ms, averaged)", 1000 * s.latency.max(), true ) );
+			m.push_back( PerfMetric( prefix + "99% Start Delay (ms, averaged)", 1000 * s.startDelay.percentile( 0.99 ), true ) );
+		}
+	}
+
+	Value randomValue() { return StringRef( (uint8_t*)valueString.c_str(), g_random->randomInt(minValueBytes, maxValueBytes+1) ); }
+
+	Standalone<KeyValueRef> operator()( uint64_t n ) {
+		return KeyValueRef( keyForIndex( n, false ), randomValue() );
+	}
+
+	ACTOR static Future<Void> timedTransaction( Database cx, OpenLoopLatencyWorkload* self, Step* step, double intendedStart ) {
+		state double begin = now();
+		state Transaction tr( cx );
+		++step->outstanding;
+		loop {
+			try {
+				state std::vector<Future<Optional<Value>>> reads;
+				for(int i = 0; i < self->readsPerTransaction; i++)
+					reads.push_back( tr.get( self->keyForIndex( g_random->randomInt64( 0, self->nodeCount ), false ) ) );
+				Void _ = wait( waitForAll( reads ) );
+				if( self->writesPerTransaction ) {
+					for(int i = 0; i < self->writesPerTransaction; i++)
+						tr.set( self->keyForIndex( g_random->randomInt64( 0, self->nodeCount ), false ), self->randomValue() );
+					Void _ = wait( tr.commit() );
+				}
+				break;
+			} catch( Error& e ) {
+				Void _ = wait( tr.onError( e ) );
+				++step->retries;
+			}
+		}
+		--step->outstanding;
+		++step->completed;
+		step->latency.record( now() - intendedStart );
+		step->startDelay.record( begin - intendedStart );
+		return Void();
+	}
+
+	ACTOR static Future<Void> runStep( Database cx, OpenLoopLatencyWorkload* self, Step* step ) {
+		state double meanInterval = self->clientCount / step->targetRate;
+		state double begin = now();
+		state double next = begin;
+		state std::vector<Future<Void>> transactions;
+		state int64_t completedInStep;
+
+		loop {
+			Void _ = wait( poisson( &next, meanInterval ) );
+			if( next - begin >= self->stepDuration )
+				break;
+			if( step->outstanding >= self->maxOutstanding ) {
+				++step->dropped;
+				continue;
+			}
+			++step->issued;
+			transactions.push_back( timedTransaction( cx, self, step, next ) );
+		}
+		// Transactions still outstanding at the end of the step count toward this step's latency but not its throughput
+		step->duration = now() - begin;
+		completedInStep = step->completed;
+		Void _ = wait( timeout( waitForAll( transactions ), self->stepDuration, Void() ) );
+
+		TraceEvent("OpenLoopLatencyStep").detail("ClientId", self->clientId).detail("TargetRate", step->targetRate)
+			.detail("AchievedRate", completedInStep / step->duration * self->clientCount).detail("Issued", step->issued)
+			.detail("Completed", step->completed).detail("Dropped", step->dropped).detail("Retries", step->retries)
+			.detail("MeanLatency", step->latency.mean()).detail("MedianLatency", step->latency.median())
+			.detail("P99Latency", step->latency.percentile(0.99)).detail("P999Latency", step->latency.percentile(0.999))
+			.detail("MaxLatency", step->latency.max()).detail("P99StartDelay", step->startDelay.percentile(0.99))
+			.detail("LatencyHistogram", step->latency.toString()).detail("StartDelayHistogram", step->startDelay.toString());
+		step->completed = completedInStep;
+		return Void();
+	}
+
+	ACTOR static Future<Void> _start( Database cx, OpenLoopLatencyWorkload* self ) {
+		state Step* step;
+		while( self->stepsRun < self->steps.size() ) {
+			step = &self->steps[self->stepsRun++];
+			Void _ = wait( runStep( cx, self, step ) );
+			// Rates in the metrics are over all clients, which the tester gets by summing them
+			if( step->achievedRate() * self->clientCount < self->saturationThreshold * step->targetRate ) {
+				TraceEvent("OpenLoopLatencySaturated").detail("ClientId", self->clientId).detail("TargetRate", step->targetRate)
+					.detail("AchievedRate", step->achievedRate() * self->clientCount);
+				break;
+			}
+		}
+		return Void();
+	}
+};
+
+WorkloadFactory<OpenLoopLatencyWorkload> OpenLoopLatencyWorkloadFactory("OpenLoopLatency");
@@ -21,13 +21,15 @@
 #include "flow/actorcompiler.h"
 #include "fdbrpc/ContinuousSample.h"
 #include "fdbclient/NativeAPI.h"
+#include "fdbclient/AppendLog.h"
+#include "fdbclient/ReadYourWrites.h"
 #include "fdbserver/TesterInterface.h"
 #include "workloads.h"
 
 const int keyBytes = 16;
 
 struct QueuePushWorkload : TestWorkload {
-	int actorCount, valueBytes;
+	int actorCount, valueBytes, appendLogShards;
 	double testDuration;
 	bool forward;
 	std::string valueString;
@@ -48,6 +50,8 @@ struct QueuePushWorkload : TestWorkload {
 		valueString = std::string( valueBytes, 'x' );
 
 		forward = getOption( options, LiteralStringRef("forward"), true );
+		// If nonzero, push onto an AppendLog with this many shards instead of after the last key
+		appendLogShards = getOption( options, LiteralStringRef("appendLogShards"), 0 );
 
 		endingKey = LiteralStringRef("9999999900000001");
 		startingKey = LiteralStringRef("0000000000000001");
@@ -56,7 +60,11 @@ struct QueuePushWorkload : TestWorkload {
 	virtual std::string description() { return "QueuePush"; }
 	virtual Future<Void> start( Database const& cx ) { return _start( cx, this ); }
 
-	virtual Future<bool> check( Database const& cx ) { return true; }
+	virtual Future<bool> check( Database const& cx ) {
+		if( appendLogShards && clientId == 0 )
+			return checkAppendLog( cx, this );
+		return true;
+	}
 
 	virtual void getMetrics( vector<PerfMetric>& m ) {
 		double duration = testDuration;
@@ -93,9 +101,11 @@ struct QueuePushWorkload : TestWorkload {
 			throw client_invalid_operation();
 	}
 
+	AppendLog appendLog() const { return AppendLog( LiteralStringRef("QueuePushLog/"), appendLogShards ); }
+
 	ACTOR Future<Void> _start( Database cx, QueuePushWorkload *self ) {
 		for( int i = 0; i < self->actorCount; i++ ) {
-			self->clients.push_back( self->writeClient( cx, self ) );
+			self->clients.push_back( self->appendLogShards ? self->appendClient( cx, self ) : self->writeClient( cx, self ) );
 		}
 
 		Void _ = wait( timeout( waitForAll( self->clients ), self->testDuration, Void() ) );
@@ -148,6 +158,63 @@ struct QueuePushWorkload : TestWorkload {
 			++self->transactions;
 		}
 	}
+
+	ACTOR Future<Void> appendClient( Database cx, QueuePushWorkload *self ) {
+		state AppendLog log = self->appendLog();
+		loop {
+			state Reference<ReadYourWritesTransaction> tr( new ReadYourWritesTransaction( cx ) );
+			loop {
+				try {
+					state double start = now();
+					Version v = wait( tr->getReadVersion() );
+					self->GRVLatencies.addSample( now() - start );
+
+					ValueRef value = StringRef(self->valueString);
+					log.append( tr, VectorRef<ValueRef>( &value, 1 ) );
+
+					start = now();
+					Void _ = wait( tr->commit() );
+					self->commitLatencies.addSample( now() - start );
+					break;
+				} catch( Error& e ) {
+					Void _ = wait( tr->onError( e ) );
+					++self->retries;
+				}
+			}
+			++self->transactions;
+		}
+	}
+
+	// Reads the whole log back, which should hold every committed push in strictly increasing positions
+	ACTOR static Future<bool> checkAppendLog( Database cx, QueuePushWorkload *self ) {
+		state AppendLog log = self->appendLog();
+		state Key after;
+		state int64_t entries = 0;
+		loop {
+			state Reference<ReadYourWritesTransaction> tr( new ReadYourWritesTransaction( cx ) );
+			try {
+				Standalone<RangeResultRef> r = wait( log.read( tr, after, 10000 ) );
+				for( int i = 0; i < r.size(); i++ ) {
+					if( r[i].key <= after ) {
+						TraceEvent(SevError, "QueuePushLogOutOfOrder").detail("Position", printable(r[i].key)).detail("After", printable(after));
+						return false;
+					}
+					after = r[i].key;
+				}
+				entries += r.size();
+				if( !r.more )
+					break;
+			} catch( Error& e ) {
+				Void _ = wait( tr->onError( e ) );
+			}
+		}
+		// A push that committed with commit_unknown_result may be in the log twice
+		if( entries < self->transactions.getValue() ) {
+			TraceEvent(SevError, "QueuePushLogMissingEntries").detail("Entries", entries).detail("Transactions", self->transactions.getValue());
+			return false;
+		}
+		return true;
+	}
 };
 
 WorkloadFactory<QueuePushWorkload> QueuePushWorkloadFactory("QueuePush");
@@ -29,6 +29,7 @@ struct StreamingReadWorkload : TestWorkload {
 	int actorCount, keyBytes, valueBytes, readsPerTransaction, nodeCount;
 	int rangesPerTransaction;
 	bool readSequentially;
+	bool scanWholeRange;
 	double testDuration, warmingDelay;
 	Value constantValue;
 
@@ -52,6 +53,8 @@ struct StreamingReadWorkload : TestWorkload {
 		warmingDelay = getOption( options, LiteralStringRef("warmingDelay"), 0.0 );
 		constantValue = Value( format( valueFormat.c_str(), 42 ) );
 		readSequentially = getOption( options, LiteralStringRef("readSequentially"), false);
+		// Each transaction reads all of its actor's keys with a single unlimited getRange, which is served by streaming chunks from the storage servers
+		scanWholeRange = getOption( options, LiteralStringRef("scanWholeRange"), false);
 	}
 
 	virtual std::string description() { return "StreamingRead"; }
@@ -108,42 +111,58 @@ struct StreamingReadWorkload : TestWorkload {
 			state Transaction tr(cx);
 			state int rangeSize = (double)self->readsPerTransaction / self->rangesPerTransaction + 0.5;
 			state int range = 0;
-			loop
-			{
-				state int thisRangeSize = (range < self->rangesPerTransaction - 1) ? rangeSize : self->readsPerTransaction - (self->rangesPerTransaction - 1) * rangeSize;
-				if(self->readSequentially && thisRangeSize > maxIndex - minIndex)
-					thisRangeSize = maxIndex - minIndex;
+			if(self->scanWholeRange) {
 				loop {
 					try {
-						if(!self->readSequentially)
-							currentIndex = g_random->randomInt( 0, self->nodeCount - thisRangeSize );
-						else if(currentIndex > maxIndex - thisRangeSize)
-							currentIndex = minIndex;
-
-						Standalone<RangeResultRef> values = 
-							wait( tr.getRange(
-								firstGreaterOrEqual( self->keyForIndex( currentIndex ) ),
-								firstGreaterOrEqual( self->keyForIndex( currentIndex + thisRangeSize ) ),
-								thisRangeSize ) );
-	
+						Standalone<RangeResultRef> values = wait( tr.getRange( KeyRangeRef( self->keyForIndex( minIndex ), self->keyForIndex( maxIndex ) ), GetRangeLimits() ) );
+
 						for(int i = 0; i < values.size(); i++)
 							self->readValueBytes += values[i].value.size();
 
-						if(self->readSequentially)
-							currentIndex += values.size();
-	
 						self->readKeys += values.size();
 						break;
 					} catch (Error& e) {
 						Void _ = wait( tr.onError(e) );
 					}
 				}
+			} else {
+				loop
+				{
+					state int thisRangeSize = (range < self->rangesPerTransaction - 1) ? rangeSize : self->readsPerTransaction - (self->rangesPerTransaction - 1) * rangeSize;
+					if(self->readSequentially && thisRangeSize > maxIndex - minIndex)
+						thisRangeSize = maxIndex - minIndex;
+					loop {
+						try {
+							if(!self->readSequentially)
+								currentIndex = g_random->randomInt( 0, self->nodeCount - thisRangeSize );
+							else if(currentIndex > maxIndex - thisRangeSize)
+								currentIndex = minIndex;
+
+							Standalone<RangeResultRef> values = 
+								wait( tr.getRange(
+									firstGreaterOrEqual( self->keyForIndex( currentIndex ) ),
+									firstGreaterOrEqual( self->keyForIndex( currentIndex + thisRangeSize ) ),
+									thisRangeSize ) );
+	
+							for(int i = 0; i < values.size(); i++)
+								self->readValueBytes += values[i].value.size();
+
+							if(self->readSequentially)
+								currentIndex += values.size();
+	
+							self->readKeys += values.size();
+							break;
+						} catch (Error& e) {
+							Void _ = wait( tr.onError(e) );
+						}
+					}
 
-				if(now() - tstart > 3)
-					break;
+					if(now() - tstart > 3)
+						break;
 
-				if(++range == self->rangesPerTransaction)
-					break;
+					if(++range == self->rangesPerTransaction)
+						break;
+				}
 			}
 			self->latencies.addSample( now() - tstart );
 			++self->transactions;
@@ -23,6 +23,8 @@
 
 void forceLinkIndexedSetTests();
 void forceLinkDequeTests();
+void forceLinkTimerWheelTests();
+void forceLinkHistogramTests();
 void forceLinkFlowTests();
 
 struct UnitTestWorkload : TestWorkload {
@@ -41,6 +43,8 @@ struct UnitTestWorkload : TestWorkload {
 		testRunLimit = getOption(options, LiteralStringRef("maxTestCases"), -1);
 		forceLinkIndexedSetTests();
 		forceLinkDequeTests();
+		forceLinkTimerWheelTests();
+		forceLinkHistogramTests();
 		forceLinkFlowTests();
 	}
 
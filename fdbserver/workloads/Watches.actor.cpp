@@ -28,20 +28,22 @@
 const int sampleSize = 10000;
 
 struct WatchesWorkload : TestWorkload {
-	int nodes, keyBytes, extraPerNode;
+	int nodes, keyBytes, extraPerNode, extraWatchesPerNode;
 	double testDuration;
 	vector<Future<Void>> clients;
-	PerfIntCounter cycles;
+	PerfIntCounter cycles, extraWatchTriggers;
 	ContinuousSample<double> cycleLatencies;
 	std::vector<int> nodeOrder;
 
 	WatchesWorkload(WorkloadContext const& wcx)
-		: TestWorkload(wcx), cycles("Cycles"), cycleLatencies( sampleSize )
+		: TestWorkload(wcx), cycles("Cycles"), extraWatchTriggers("ExtraWatchTriggers"), cycleLatencies( sampleSize )
 	{
 		testDuration = getOption( options, LiteralStringRef("testDuration"), 600.0 );
 		nodes = getOption( options, LiteralStringRef("nodeCount"), 100 );
 		extraPerNode = getOption( options, LiteralStringRef("extraPerNode"), 1000 );
 		keyBytes = std::max( getOption( options, LiteralStringRef("keyBytes"), 16 ), 16 );
+		// Additional watches on every key of the chain, which the storage servers should coalesce into one watch per key
+		extraWatchesPerNode = getOption( options, LiteralStringRef("extraWatchesPerNode"), 0 );
 
 		for(int i=0; i<nodes+1; i++)
 			nodeOrder.push_back(i);
@@ -75,6 +77,8 @@ struct WatchesWorkload : TestWorkload {
 			m.push_back( cycles.getMetric() );
 			m.push_back( PerfMetric( "Mean Latency (ms)", 1000 * cycleLatencies.mean() / nodes, true ) );
 		}
+		if( extraWatchesPerNode )
+			m.push_back( extraWatchTriggers.getMetric() );
 	}
 
 	Key keyForIndex( uint64_t index ) {
@@ -99,10 +103,36 @@ struct WatchesWorkload : TestWorkload {
 		for(int i=0; i<self->nodes; i++)
 			if( i % self->clientCount == self->clientId )
 				self->clients.push_back( self->watcher( cx, self->keyForIndex(self->nodeOrder[i]), self->keyForIndex(self->nodeOrder[i+1]), self->extraPerNode ) );
-		
+
+		if( self->extraWatchesPerNode ) {
+			cx->maxOutstandingWatches = CLIENT_KNOBS->ABSOLUTE_MAX_WATCHES;
+			for(int i=0; i<=self->nodes; i++)
+				for(int j=self->clientId; j<self->extraWatchesPerNode; j+=self->clientCount)
+					self->clients.push_back( self->extraWatcher( cx, self->keyForIndex(self->nodeOrder[i]), self ) );
+		}
+
 		return Void();
 	}
 
+	// Watches key only to be woken up as the chain passes through it
+	ACTOR static Future<Void> extraWatcher( Database cx, Key key, WatchesWorkload* self ) {
+		loop {
+			state Transaction tr( cx );
+			loop {
+				try {
+					Optional<Value> value = wait( tr.get( key ) );
+					state Future<Void> watchFuture = tr.watch( Reference<Watch>( new Watch(key, value) ) );
+					Void _ = wait( tr.commit() );
+					Void _ = wait( watchFuture );
+					++self->extraWatchTriggers;
+					break;
+				} catch( Error &e ) {
+					Void _ = wait( tr.onError(e) );
+				}
+			}
+		}
+	}
+
 	ACTOR static Future<Void> watcherInit( Database cx, Key watchKey, Key setKey, int extraNodes ) {
 		state Transaction tr( cx );
 		state int extraLoc = 0;
@@ -165,6 +165,7 @@ public:
 		simConnectionFailuresDisableDuration = 0;
 		simBackupAgents = ISimulator::NoBackupAgents;
 		simDrAgents = ISimulator::NoBackupAgents;
+		benchmarkRegressionTolerance = 0.1;
 	}
 	TestSpec( StringRef title, bool dump, bool clear, double startDelay = 30.0, bool useDB = true, double databasePingDelay = -1.0 ) : 
 			title( title ), dumpAfterTest( dump ), 
@@ -172,7 +173,8 @@ public:
 				useDB( useDB ), timeout( 600 ),
 				databasePingDelay( databasePingDelay ), runConsistencyCheck( g_network->isSimulated() ),
 				waitForQuiescenceBegin( true ), waitForQuiescenceEnd( true ), simCheckRelocationDuration( false ), 
-				simConnectionFailuresDisableDuration( 0 ), simBackupAgents( ISimulator::NoBackupAgents ), simDrAgents( ISimulator::NoBackupAgents ) {
+				simConnectionFailuresDisableDuration( 0 ), simBackupAgents( ISimulator::NoBackupAgents ), simDrAgents( ISimulator::NoBackupAgents ),
+				benchmarkRegressionTolerance( 0.1 ) {
 		phases = TestWorkload::SETUP | TestWorkload::EXECUTION | TestWorkload::CHECK | TestWorkload::METRICS;
 		if( databasePingDelay < 0 )
 			databasePingDelay = g_network->isSimulated() ? 0.0 : 15.0;
@@ -195,6 +197,13 @@ public:
 	double simConnectionFailuresDisableDuration;
 	ISimulator::BackupAgentType simBackupAgents; //If set to true, then the simulation runs backup agents on the workers. Can only be used in simulation.
 	ISimulator::BackupAgentType simDrAgents;
+
+	// If set, the test's metrics are appended to benchmarkResultsFile as a line of JSON, and compared against the last result for
+	// the same test title in benchmarkBaselineFile (a results file from an earlier run).  A metric that is worse than the baseline by
+	// more than benchmarkRegressionTolerance (a fraction) fails the test.  These carry over to later tests in the same file.
+	std::string benchmarkResultsFile;
+	std::string benchmarkBaselineFile;
+	double benchmarkRegressionTolerance;
 };
 
 Future<DistributedTestResults> runWorkload( 
@@ -63,4 +63,84 @@ public:
 	void clear( bool returnWhenEmptied ) { m_out.cancel(); m_out = actorCollection(m_add.getFuture(), NULL, NULL, NULL, NULL, returnWhenEmptied ); }
 };
 
+// IntrusiveActorCollection is ActorCollection(false) for actors that are added and forgotten, such as one per request, without
+// the actorCollection() actor, PromiseStream and map behind it.  Each unready future added costs one small node, linked into
+// the collection, that waits on the future directly; a ready future costs nothing.
+//   - getResult() is set to the first error thrown by any future, and the remaining futures are then cancelled
+//   - Cancels the remaining futures, in the order they were added, when destroyed
+class IntrusiveActorCollection : NonCopyable {
+	struct Member : Callback<Void>, FastAllocated<Member> {
+		IntrusiveActorCollection* owner;
+		Member *prevMember, *nextMember;
+
+		virtual void fire( Void const& ) { owner->finished( this ); }
+		virtual void error( Error e ) {
+			IntrusiveActorCollection* o = owner;
+			o->finished( this );
+			o->fail( e );
+		}
+	};
+
+	Member members;  // Sentinel of the circular list of members
+	int m_size;
+	Promise<Void> m_result;
+
+	void unlink( Member* m ) {
+		m->prevMember->nextMember = m->nextMember;
+		m->nextMember->prevMember = m->prevMember;
+		--m_size;
+	}
+
+	void finished( Member* m ) {
+		unlink( m );
+		m->remove();
+		delete m;
+	}
+
+	void cancelAll() {
+		// Cancelling one actor can make others finish, and they unlink themselves
+		while( members.nextMember != &members ) {
+			Member* m = members.nextMember;
+			unlink( m );
+			m->remove();  // Drops the last reference to the future, cancelling the actor
+			delete m;
+		}
+	}
+
+	void fail( Error e ) {
+		if( !m_result.canBeSet() )
+			return;
+		cancelAll();
+		Promise<Void> result = m_result;  // Whoever is waiting on the result may destroy this collection
+		result.sendError( e );
+	}
+
+public:
+	IntrusiveActorCollection() : m_size(0) {
+		members.prevMember = members.nextMember = &members;
+	}
+	~IntrusiveActorCollection() { cancelAll(); }
+
+	void add( Future<Void> a ) {
+		if( a.isReady() ) {
+			if( a.isError() )
+				fail( a.getError() );
+			return;
+		}
+		if( !m_result.canBeSet() )
+			return;  // Cancels a
+		Member* m = new Member;
+		m->owner = this;
+		m->nextMember = &members;
+		m->prevMember = members.prevMember;
+		members.prevMember->nextMember = m;
+		members.prevMember = m;
+		++m_size;
+		a.addCallbackAndClear( m );
+	}
+
+	Future<Void> getResult() { return m_result.getFuture(); }
+	int size() const { return m_size; }
+};
+
 #endif
\ No newline at end of file
@@ -116,7 +116,8 @@ struct ArenaBlock : NonCopyable, ThreadSafeReferenceCounted<ArenaBlock>
 {
 	enum {
 		SMALL = 64,
-		LARGE = 4097 // If size == used == LARGE, then use hugeSize, hugeUsed
+		LARGE = 4097, // If size == used == LARGE, then use hugeSize, hugeUsed
+		POOLED = 16384 // Blocks up to this size come from a FastAllocator, bigger ones from new
 	};
 
 	enum { NOT_TINY = 255, TINY_HEADER = 6 };
@@ -217,8 +218,9 @@ struct ArenaBlock : NonCopyable, ThreadSafeReferenceCounted<ArenaBlock>
 				// Each block should be larger than the previous block, up to a limit, to minimize allocations
 				// Worst-case allocation pattern: 1 +10 +17 +42 +67 +170 +323 +681 +1348 +2728 +2210 +2211 (+1K +3K+1 +4K)*
 				// Overhead: 4X for small arenas, 3X intermediate, 1.33X for large arenas
+				// Once an arena has outgrown a page it keeps doubling up to POOLED, so that large arenas take a few pooled blocks instead of many pages
 				int prevSize = next ? next->size() : 0;
-				reqSize = std::max( reqSize, std::min( prevSize*2, std::max( LARGE-1, reqSize*4 ) ) );
+				reqSize = std::max( reqSize, std::min( prevSize*2, std::max( prevSize >= LARGE-1 ? (int)POOLED : LARGE-1, reqSize*4 ) ) );
 			}
 
 			if (reqSize < LARGE) {
@@ -231,16 +233,21 @@ struct ArenaBlock : NonCopyable, ThreadSafeReferenceCounted<ArenaBlock>
 				b->tinySize = b->tinyUsed = NOT_TINY;
 				b->bigUsed = sizeof(ArenaBlock);
 			} else {
-				#ifdef ALLOC_INSTRUMENTATION
-					allocInstr[ "ArenaHugeKB" ].alloc( (reqSize+1023)>>10 );
-				#endif
-				b = (ArenaBlock*)new uint8_t[ reqSize ];
+				if (reqSize <= 8192) { b = (ArenaBlock*)FastAllocator<8192>::allocate(); b->bigSize = 8192; INSTRUMENT_ALLOCATE("Arena8192"); }
+				else if (reqSize <= POOLED) { b = (ArenaBlock*)FastAllocator<16384>::allocate(); b->bigSize = 16384; INSTRUMENT_ALLOCATE("Arena16384"); }
+				else {
+					#ifdef ALLOC_INSTRUMENTATION
+						allocInstr[ "ArenaHugeKB" ].alloc( (reqSize+1023)>>10 );
+					#endif
+					b = (ArenaBlock*)new uint8_t[ reqSize ];
+					b->bigSize = reqSize;
+					recordHeapAllocation( b, reqSize );
+				}
 				b->tinySize = b->tinyUsed = NOT_TINY;
-				b->bigSize = reqSize;
 				b->bigUsed = sizeof(ArenaBlock);
 
 				// If the new block has less free space than the old block, make the old block depend on it
-				if (next && !next->isTiny() && next->unused() >= reqSize-dataSize) {
+				if (next && !next->isTiny() && next->unused() >= (int)b->bigSize-dataSize) {
 					b->nextBlockOffset = 0;
 					b->setrefCountUnsafe(1);
 					next->makeReference(b);
@@ -269,10 +276,13 @@ struct ArenaBlock : NonCopyable, ThreadSafeReferenceCounted<ArenaBlock>
 			else if (bigSize <= 1024) { FastAllocator<1024>::release(this); INSTRUMENT_RELEASE("Arena1024"); }
 			else if (bigSize <= 2048) { FastAllocator<2048>::release(this); INSTRUMENT_RELEASE("Arena2048"); }
 			else if (bigSize <= 4096) { FastAllocator<4096>::release(this); INSTRUMENT_RELEASE("Arena4096"); }
+			else if (bigSize <= 8192) { FastAllocator<8192>::release(this); INSTRUMENT_RELEASE("Arena8192"); }
+			else if (bigSize <= POOLED) { FastAllocator<16384>::release(this); INSTRUMENT_RELEASE("Arena16384"); }
 			else {
 				#ifdef ALLOC_INSTRUMENTATION
 					allocInstr[ "ArenaHugeKB" ].dealloc( (bigSize+1023)>>10 );
 				#endif
+				recordHeapRelease( this );
 				delete[] (uint8_t*)this;
 			}
 		}
@@ -684,6 +694,32 @@ private:
 		m_capacity = requiredCapacity;
 	}
 };
+
+template <class T> struct is_binary_serializable;  // defined in serialize.h
+
+// The wire format of binary serializable items is their memory layout, so a VectorRef of them is
+// copied in one piece, with one bounds check, instead of item by item
+template <class Archive, class T>
+inline void loadItems( Archive& ar, VectorRef<T>& value, std::true_type ) {
+	if (value.size())
+		ar.serializeBytes( value.begin(), value.size()*sizeof(T) );
+}
+template <class Archive, class T>
+inline void loadItems( Archive& ar, VectorRef<T>& value, std::false_type ) {
+	for(int i=0; i<value.size(); i++)
+		ar >> value[i];
+}
+template <class Archive, class T>
+inline void saveItems( Archive& ar, const VectorRef<T>& value, std::true_type ) {
+	if (value.size())
+		ar.serializeBytes( value.begin(), value.size()*sizeof(T) );
+}
+template <class Archive, class T>
+inline void saveItems( Archive& ar, const VectorRef<T>& value, std::false_type ) {
+	for(int i=0; i<value.size(); i++)
+		ar << value[i];
+}
+
 template <class Archive, class T>
 inline void load( Archive& ar, VectorRef<T>& value ) {
 	// FIXME: range checking for length, here and in other serialize code
@@ -692,15 +728,13 @@ inline void load( Archive& ar, VectorRef<T>& value ) {
 	UNSTOPPABLE_ASSERT( length*sizeof(T) < (100<<20) );
 	// SOMEDAY: Can we avoid running constructors for all the values?
 	value.resize(ar.arena(), length);
-	for(uint32_t i=0; i<length; i++)
-		ar >> value[i];
+	loadItems( ar, value, std::integral_constant<bool, is_binary_serializable<T>::value>() );
 }
 template <class Archive, class T>
 inline void save( Archive& ar, const VectorRef<T>& value ) {
 	uint32_t length = value.size();
 	ar << length;
-	for(uint32_t i=0; i<length; i++)
-		ar << value[i];
+	saveItems( ar, value, std::integral_constant<bool, is_binary_serializable<T>::value>() );
 }
 
  void ArenaBlock::destroy() {
@@ -0,0 +1,872 @@
+/*
+ * BTreeIndexedSet.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOW_BTREEINDEXEDSET_H
+#define FLOW_BTREEINDEXEDSET_H
+#pragma once
+
+#include "IndexedSet.h"
+
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// BTreeIndexedSet<T, Metric> has the interface of IndexedSet<T, Metric>, including metric sums, sumTo() and index(), but keeps
+// its items in a B+-tree with many items per node.  A lookup reads a few nodes of NodeBytes each (a whole number of cache lines)
+// instead of chasing a pointer per comparison through the heap, and each item costs less memory than an IndexedSet node.
+// It differs from IndexedSet in that:
+//   - Any insert or erase invalidates all iterators, since items move between nodes
+//   - Internal nodes hold copies of some items as separators, so T must be copyable and should be cheap to copy
+//     (a key, rather than a key and a large value)
+//   - getElementBytes() is an upper bound rather than exact
+// Existing users opt in by replacing IndexedSet in a declaration, or for Map<> by passing it as the Set template parameter.
+
+template <class T, class Metric, int NodeBytes = 512>
+struct BTreeIndexedSet {
+	typedef T value_type;
+	typedef T key_type;
+
+private:
+	static_assert( NodeBytes >= 128 && NodeBytes <= 16384 && NodeBytes % 64 == 0, "BTreeIndexedSet nodes should be a whole number of cache lines" );
+
+	struct Node {
+		int count;		// items in a leaf, children in an internal node
+		bool isLeaf;
+
+		explicit Node( bool isLeaf ) : count(0), isLeaf(isLeaf) {}
+	};
+
+	typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type ItemStorage;
+
+	// Every node has one slot beyond its capacity, so that an insert can be done in place before the node is split
+	enum {
+		LeafSlots = (NodeBytes - sizeof(Node) - 2*sizeof(void*)) / (sizeof(T) + sizeof(Metric)),
+		InternalSlots = (NodeBytes - sizeof(Node)) / (sizeof(void*) + sizeof(Metric) + sizeof(int) + sizeof(T)),
+		LeafCapacity = LeafSlots > 4 ? LeafSlots-1 : 4,
+		InternalCapacity = InternalSlots > 4 ? InternalSlots-1 : 4
+	};
+
+	static void destroy( T* items, int n ) {
+		for(int i=0; i<n; i++)
+			items[i].~T();
+	}
+
+	// Moves n items from `from` to the uninitialized space at `to`, which may overlap, leaving `from` uninitialized
+	static void relocate( T* to, T* from, int n ) {
+		if (to < from) {
+			for(int i=0; i<n; i++) {
+				new (&to[i]) T( std::move(from[i]) );
+				from[i].~T();
+			}
+		} else if (to > from) {
+			for(int i=n-1; i>=0; i--) {
+				new (&to[i]) T( std::move(from[i]) );
+				from[i].~T();
+			}
+		}
+	}
+
+	template <class X>
+	static void shift( X* to, X* from, int n ) {
+		if (to < from)
+			std::move( from, from+n, to );
+		else
+			std::move_backward( from, from+n, to+n );
+	}
+
+	struct Leaf : Node, FastAllocated<Leaf> {
+		Leaf *prev, *next;
+		Metric metric[LeafCapacity+1];
+		ItemStorage storage[LeafCapacity+1];
+
+		Leaf() : Node(true), prev(NULL), next(NULL) {}
+		~Leaf() { destroy( items(), this->count ); }
+
+		T* items() { return (T*)storage; }
+	};
+
+	struct Internal : Node, FastAllocated<Internal> {
+		Node* child[InternalCapacity+1];
+		Metric total[InternalCapacity+1];	// the sum of the metrics in each child's subtree
+		int size[InternalCapacity+1];		// the number of items in each child's subtree
+		ItemStorage storage[InternalCapacity];	// keys()[i-1] is <= every item under child[i] and > every item under child[i-1]
+
+		Internal() : Node(false) {}
+		~Internal() { destroy( keys(), std::max(this->count-1, 0) ); }  // children are freed by freeNodes()
+
+		T* keys() { return (T*)storage; }
+	};
+
+public:
+	struct iterator{
+		typename BTreeIndexedSet::Leaf *leaf;
+		int pos;
+		iterator() : leaf(0), pos(0) {};
+		iterator(typename BTreeIndexedSet::Leaf *leaf, int pos) : leaf(leaf), pos(pos) {};
+		T& operator*() { return leaf->items()[pos]; };
+		T* operator->() { return &leaf->items()[pos]; }
+		void operator++() { if (++pos == leaf->count) { leaf = leaf->next; pos = 0; } }
+		void decrementNonEnd() { if (pos) --pos; else { leaf = leaf->prev; pos = leaf->count-1; } }
+		bool operator == ( const iterator& r ) const { return leaf == r.leaf && pos == r.pos; }
+		bool operator != ( const iterator& r ) const { return !(*this == r); }
+	};
+
+	BTreeIndexedSet() : root(NULL) {}
+	~BTreeIndexedSet() { clear(); }
+	BTreeIndexedSet(BTreeIndexedSet&& r) noexcept(true) : root(r.root) { r.root = NULL; }
+	BTreeIndexedSet& operator=(BTreeIndexedSet&& r) noexcept(true) { clear(); root = r.root; r.root = NULL; return *this; }
+
+	iterator begin() const;
+	iterator end() const { return iterator(); }
+	iterator previous(iterator i) const {
+		if (i == end()) return lastItem();
+		i.decrementNonEnd();
+		return i;
+	}
+	iterator lastItem() const;
+
+	bool empty() const { return !root; }
+	void clear() {
+		std::vector<Node*> toFree;
+		if (root) toFree.push_back(root);
+		root = NULL;
+		freeNodes( toFree, std::numeric_limits<int>::max() );
+	}
+	void swap( BTreeIndexedSet& r ) { std::swap( root, r.root ); }
+
+	// Place data in the set with the given metric.  If an item equal to data is already in the set and,
+	//   replaceExisting == true, it will be overwritten (and its metric will be replaced)
+	template <class T_, class Metric_>
+	iterator insert(T_ &&data, Metric_ &&metric, bool replaceExisting = true) {
+		InsertResult r;
+		insert( std::forward<T_>(data), Metric(std::forward<Metric_>(metric)), replaceExisting, r );
+		return r.at;
+	}
+
+	// Insert all items from data into set. If an item equal to data is already in the set and, replaceExisting == true,
+	//   it will be overwritten (and its metric will be replaced). returns the number of items inserted or replaced.
+	int insert(const std::vector<std::pair<T,Metric>>& data, bool replaceExisting = true);
+
+	// Increase the metric for the given item by the given amount.  Inserts data into the set if it
+	//   doesn't exist. Returns the new sum.
+	template <class T_, class Metric_>
+	Metric addMetric( T_ && data, Metric_ && metric );
+
+	// Remove the data item, if any, which is equal to key
+	template <class Key>
+	void erase(const Key &key) { erase( find(key) ); }
+
+	// Erase the indicated item.  No effect if item == end().
+	void erase(iterator item) {
+		if (item == end()) return;
+		std::vector<Node*> toFree;
+		eraseRange( rank(item), 1, toFree );
+		freeNodes( toFree, std::numeric_limits<int>::max() );
+	}
+
+	// Erase all data items x for which begin<=x<end
+	template <class Key>
+	void erase(const Key& begin, const Key& end) { erase( lower_bound(begin), lower_bound(end) ); }
+
+	// Erase data items with a deferred (async) free process. The data structure has the items removed
+	//  synchronously with the invocation of this method so any subsequent call will see this new state.
+	template <class Key>
+	Future<Void> eraseAsync(const Key& begin, const Key& end) { return eraseAsync( lower_bound(begin), lower_bound(end) ); }
+
+	// Erase the items in the indicated range.
+	void erase(iterator begin, iterator end) {
+		std::vector<Node*> toFree;
+		int b = rank(begin);
+		eraseRange( b, rank(end) - b, toFree );
+		freeNodes( toFree, std::numeric_limits<int>::max() );
+	}
+
+	// Erase data items with a deferred (async) free process. The data structure has the items removed
+	//  synchronously with the invocation of this method so any subsequent call will see this new state.
+	Future<Void> eraseAsync(iterator begin, iterator end);
+
+	// Returns the number of items equal to key (either 0 or 1)
+	template <class Key>
+	int count(const Key &key) const { return find(key) != end(); }
+
+	// Returns x such that key==*x, or end()
+	template <class Key>
+	iterator find(const Key &key) const {
+		Leaf* l = findLeaf(key);
+		if (!l) return end();
+		int i = lowerBoundIndex(l, key);
+		if (i < l->count && !(key < l->items()[i]))
+			return iterator(l, i);
+		return end();
+	}
+
+	// Returns the smallest x such that *x>=key, or end()
+	template <class Key>
+	iterator lower_bound(const Key &key) const {
+		Leaf* l = findLeaf(key);
+		return l ? position(l, lowerBoundIndex(l, key)) : end();
+	}
+
+	// Returns the smallest x such that *x>key, or end()
+	template <class Key>
+	iterator upper_bound(const Key &key) const {
+		Leaf* l = findLeaf(key);
+		return l ? position(l, upperBoundIndex(l, key)) : end();
+	}
+
+	// Returns the largest x such that *x<=key, or end()
+	template <class Key>
+	iterator lastLessOrEqual( const Key &key ) const {
+		iterator i = upper_bound(key);
+		if (i == begin()) return end();
+		return previous(i);
+	}
+
+	// Returns smallest x such that sumTo(x+1) > metric, or end()
+	template <class M>
+	iterator index( M const& metric ) const;
+
+	// Return the metric inserted with item x
+	Metric getMetric(iterator x) const { return x.leaf->metric[x.pos]; }
+
+	// Return the sum of getMetric(x) for begin()<=x<to
+	Metric sumTo(iterator to) const;
+
+	// Return the sum of getMetric(x) for begin<=x<end
+	Metric sumRange(iterator begin, iterator end) const { return sumTo(end) - sumTo(begin); }
+
+	// Return the sum of getMetric(x) for all x s.t. begin <= *x && *x < end
+	template <class Key>
+	Metric sumRange(const Key& begin, const Key& end) const { return sumRange(lower_bound(begin), lower_bound(end)); }
+
+	// Return an upper bound on the amount of memory used by an entry in the set, which is when leaves are half full
+	static int getElementBytes() { return (sizeof(Leaf) + sizeof(Internal) / (InternalCapacity/2)) / (LeafCapacity/2); }
+
+private:
+	// Copy operations unimplemented.
+	BTreeIndexedSet( const BTreeIndexedSet& );
+	BTreeIndexedSet& operator=( const BTreeIndexedSet& );
+
+	Node *root;
+
+	struct InsertResult {
+		iterator at;
+		Metric metricDelta;		// change in the total of the subtree inserted into, including anything split off
+		int sizeDelta;
+	};
+
+	template <class T_>
+	void insert( T_&& data, Metric const& metric, bool replaceExisting, InsertResult& r );
+	template <class T_>
+	Node* insertInto( Node* n, T_&& data, Metric const& metric, bool replaceExisting, InsertResult& r );
+	void insertChild( Internal* n, int i, Node* child, Metric const& total, int size );
+
+	void eraseRange( int begin, int count, std::vector<Node*>& toFree );
+	enum { RangeAtStart = 1, RangeAtEnd = 2 };
+	Metric eraseRange( Node* n, int begin, int count, std::vector<Node*>& toFree, int& edges );
+	void removeChildren( Internal* n, int begin, int count );
+	bool balanceChildren( Internal* n, int i );
+	static bool freeNodes( std::vector<Node*>& toFree, int limit );
+
+	static iterator position( Leaf* l, int i ) { return i < l->count ? iterator(l, i) : iterator(l->next, 0); }
+
+	// Index of the child of n whose subtree contains (or would contain) key
+	template <class Key>
+	static int childIndex( Internal* n, Key const& key ) {
+		T* keys = n->keys();
+		int lo = 0, hi = n->count-1;
+		while (lo < hi) {
+			int mid = (lo+hi) / 2;
+			if (key < keys[mid]) hi = mid;
+			else lo = mid+1;
+		}
+		return lo;
+	}
+
+	template <class Key>
+	static int lowerBoundIndex( Leaf* l, Key const& key ) {
+		T* items = l->items();
+		int lo = 0, hi = l->count;
+		while (lo < hi) {
+			int mid = (lo+hi) / 2;
+			if (items[mid] < key) lo = mid+1;
+			else hi = mid;
+		}
+		return lo;
+	}
+
+	template <class Key>
+	static int upperBoundIndex( Leaf* l, Key const& key ) {
+		T* items = l->items();
+		int lo = 0, hi = l->count;
+		while (lo < hi) {
+			int mid = (lo+hi) / 2;
+			if (key < items[mid]) hi = mid;
+			else lo = mid+1;
+		}
+		return lo;
+	}
+
+	template <class Key>
+	Leaf* findLeaf( Key const& key ) const {
+		Node* n = root;
+		if (!n) return NULL;
+		while (!n->isLeaf) {
+			Internal* in = (Internal*)n;
+			n = in->child[ childIndex(in, key) ];
+		}
+		return (Leaf*)n;
+	}
+
+	static Leaf* firstLeaf( Node* n ) {
+		while (!n->isLeaf) n = ((Internal*)n)->child[0];
+		return (Leaf*)n;
+	}
+
+	static Leaf* lastLeaf( Node* n ) {
+		while (!n->isLeaf) n = ((Internal*)n)->child[ n->count-1 ];
+		return (Leaf*)n;
+	}
+
+	static Metric subtreeTotal( Node* n ) {
+		Metric m = Metric();
+		if (n->isLeaf) {
+			for(int i=0; i<n->count; i++) m = m + ((Leaf*)n)->metric[i];
+		} else {
+			for(int i=0; i<n->count; i++) m = m + ((Internal*)n)->total[i];
+		}
+		return m;
+	}
+
+	static int subtreeSize( Node* n ) {
+		if (n->isLeaf) return n->count;
+		int s = 0;
+		for(int i=0; i<n->count; i++) s += ((Internal*)n)->size[i];
+		return s;
+	}
+
+	static bool underfull( Node* n ) { return n->count < (n->isLeaf ? LeafCapacity : InternalCapacity) / 2; }
+
+	// Moves the separator between left and its new right sibling right into uninitialized space at to.  A leaf's
+	// separator is a copy of its first item; an internal node's is left in the last key slot of the split node.
+	static void takeSeparator( T* to, Node* left, Node* right ) {
+		if (right->isLeaf) {
+			new (to) T( ((Leaf*)right)->items()[0] );
+		} else {
+			T* k = &((Internal*)left)->keys()[ left->count-1 ];
+			new (to) T( std::move(*k) );
+			k->~T();
+		}
+	}
+
+	// Returns the number of items before x
+	int rank( iterator x ) const {
+		if (!x.leaf) return root ? subtreeSize(root) : 0;
+		T& key = *x;
+		int r = 0;
+		Node* n = root;
+		while (!n->isLeaf) {
+			Internal* in = (Internal*)n;
+			int i = childIndex(in, key);
+			for(int j=0; j<i; j++) r += in->size[j];
+			n = in->child[i];
+		}
+		ASSERT( n == x.leaf );
+		return r + x.pos;
+	}
+
+	// Returns the item with r items before it
+	iterator select( int r ) const {
+		Node* n = root;
+		while (!n->isLeaf) {
+			Internal* in = (Internal*)n;
+			int i = 0;
+			while (r >= in->size[i]) r -= in->size[i++];
+			n = in->child[i];
+		}
+		return iterator( (Leaf*)n, r );
+	}
+
+public: // but testonly
+	void testonly_assertBalanced();
+};
+
+/////////////////////// implementation //////////////////////////
+
+template <class T, class Metric, int NodeBytes>
+typename BTreeIndexedSet<T,Metric,NodeBytes>::iterator BTreeIndexedSet<T,Metric,NodeBytes>::begin() const {
+	return root ? iterator( firstLeaf(root), 0 ) : end();
+}
+
+template <class T, class Metric, int NodeBytes>
+typename BTreeIndexedSet<T,Metric,NodeBytes>::iterator BTreeIndexedSet<T,Metric,NodeBytes>::lastItem() const {
+	if (!root) return end();
+	Leaf* l = lastLeaf(root);
+	return iterator( l, l->count-1 );
+}
+
+template <class T, class Metric, int NodeBytes> template <class T_, class Metric_>
+Metric BTreeIndexedSet<T,Metric,NodeBytes>::addMetric(T_&& data, Metric_&& metric) {
+	auto i = find( data );
+	if (i == end()) {
+		insert( std::forward<T_>(data), std::forward<Metric_>(metric) );
+		return metric;
+	} else {
+		Metric m = metric + getMetric(i);
+		insert( std::forward<T_>(data), m );
+		return m;
+	}
+}
+
+template <class T, class Metric, int NodeBytes>
+int BTreeIndexedSet<T,Metric,NodeBytes>::insert(const std::vector<std::pair<T,Metric>>& dataVector, bool replaceExisting) {
+	int num_inserted = 0;
+	for(int i = 0; i < dataVector.size(); ++i) {
+		InsertResult r;
+		insert( dataVector[i].first, dataVector[i].second, replaceExisting, r );
+		if (r.sizeDelta || replaceExisting)
+			num_inserted++;
+	}
+	return num_inserted;
+}
+
+template <class T, class Metric, int NodeBytes> template <class T_>
+void BTreeIndexedSet<T,Metric,NodeBytes>::insert( T_&& data, Metric const& metric, bool replaceExisting, InsertResult& r ) {
+	if (!root)
+		root = new Leaf;
+
+	Node* split = insertInto( root, std::forward<T_>(data), metric, replaceExisting, r );
+	if (split) {
+		Internal* n = new Internal;
+		n->child[0] = root;
+		n->child[1] = split;
+		n->total[0] = subtreeTotal(root);
+		n->total[1] = subtreeTotal(split);
+		n->size[0] = subtreeSize(root);
+		n->size[1] = subtreeSize(split);
+		n->count = 2;
+		takeSeparator( n->keys(), root, split );
+		root = n;
+	}
+}
+
+template <class T, class Metric, int NodeBytes> template <class T_>
+typename BTreeIndexedSet<T,Metric,NodeBytes>::Node* BTreeIndexedSet<T,Metric,NodeBytes>::insertInto( Node* n, T_&& data, Metric const& metric, bool replaceExisting, InsertResult& r ) {
+	// Inserts data into the subtree at n, returning n's new right sibling if n had to be split
+	if (n->isLeaf) {
+		Leaf* l = (Leaf*)n;
+		T* items = l->items();
+		int pos = lowerBoundIndex(l, data);
+		r.sizeDelta = 0;
+		r.metricDelta = Metric();
+		r.at = iterator(l, pos);
+
+		if (pos < l->count && !(data < items[pos])) {	// items[pos] == data
+			if (replaceExisting) {
+				items[pos] = std::forward<T_>(data);
+				r.metricDelta = metric - l->metric[pos];
+				l->metric[pos] = metric;
+			}
+			return NULL;
+		}
+
+		relocate( items+pos+1, items+pos, l->count-pos );
+		new (&items[pos]) T( std::forward<T_>(data) );
+		shift( l->metric+pos+1, l->metric+pos, l->count-pos );
+		l->metric[pos] = metric;
+		l->count++;
+		r.sizeDelta = 1;
+		r.metricDelta = metric;
+		if (l->count <= LeafCapacity)
+			return NULL;
+
+		// Appending to the last leaf leaves it full, so that ascending inserts fill every leaf
+		int mid = (pos == l->count-1 && !l->next) ? LeafCapacity : l->count/2;
+		Leaf* right = new Leaf;
+		right->count = l->count - mid;
+		relocate( right->items(), items+mid, right->count );
+		shift( right->metric, l->metric+mid, right->count );
+		l->count = mid;
+
+		right->prev = l;
+		right->next = l->next;
+		if (right->next) right->next->prev = right;
+		l->next = right;
+
+		if (pos >= mid)
+			r.at = iterator(right, pos-mid);
+		return right;
+	}
+
+	Internal* in = (Internal*)n;
+	int i = childIndex(in, data);
+	Node* split = insertInto( in->child[i], std::forward<T_>(data), metric, replaceExisting, r );
+	in->total[i] = in->total[i] + r.metricDelta;
+	in->size[i] += r.sizeDelta;
+	if (!split)
+		return NULL;
+
+	Metric splitTotal = subtreeTotal(split);
+	int splitSize = subtreeSize(split);
+	in->total[i] = in->total[i] - splitTotal;
+	in->size[i] -= splitSize;
+	insertChild( in, i+1, split, splitTotal, splitSize );
+	if (in->count <= InternalCapacity)
+		return NULL;
+
+	int mid = in->count/2;
+	Internal* right = new Internal;
+	right->count = in->count - mid;
+	std::copy( in->child+mid, in->child+in->count, right->child );
+	shift( right->total, in->total+mid, right->count );
+	std::copy( in->size+mid, in->size+in->count, right->size );
+	relocate( right->keys(), in->keys()+mid, right->count-1 );
+	in->count = mid;	// keys()[mid-1] stays behind as the separator for takeSeparator()
+	return right;
+}
+
+template <class T, class Metric, int NodeBytes>
+void BTreeIndexedSet<T,Metric,NodeBytes>::insertChild( Internal* n, int i, Node* child, Metric const& total, int size ) {
+	// Inserts child at index i >= 1, just after the node it was split from
+	shift( n->child+i+1, n->child+i, n->count-i );
+	shift( n->total+i+1, n->total+i, n->count-i );
+	shift( n->size+i+1, n->size+i, n->count-i );
+	n->child[i] = child;
+	n->total[i] = total;
+	n->size[i] = size;
+
+	T* keys = n->keys();
+	relocate( keys+i, keys+i-1, n->count-i );
+	takeSeparator( &keys[i-1], n->child[i-1], child );
+	n->count++;
+}
+
+template <class T, class Metric, int NodeBytes>
+void BTreeIndexedSet<T,Metric,NodeBytes>::eraseRange( int begin, int count, std::vector<Node*>& toFree ) {
+	// Removes the count items starting with the one that has begin items before it.  Completely removed subtrees are
+	// appended to toFree, and must not be freed until this returns.
+	if (!count) return;
+
+	int size = subtreeSize(root);
+	if (count == size) {
+		toFree.push_back(root);
+		root = NULL;
+		return;
+	}
+
+	int edges;
+	eraseRange( root, begin, count, toFree, edges );
+
+	while (!root->isLeaf && root->count == 1) {
+		Internal* r = (Internal*)root;
+		root = r->child[0];
+		r->count = 0;
+		delete r;
+	}
+
+	// The leaves on either side of the range have been linked to each other, but the ones at the ends of the set were not
+	if (edges & RangeAtStart) firstLeaf(root)->prev = NULL;
+	if (edges & RangeAtEnd) lastLeaf(root)->next = NULL;
+}
+
+template <class T, class Metric, int NodeBytes>
+Metric BTreeIndexedSet<T,Metric,NodeBytes>::eraseRange( Node* n, int begin, int count, std::vector<Node*>& toFree, int& edges ) {
+	// Removes count items starting at index begin of the subtree at n, which keeps at least one item, and returns the
+	// sum of their metrics.  The subtree's children are rebalanced, but n itself may be left underfull.  The leaves on
+	// either side of the range are linked to each other if both are in the subtree, and otherwise edges reports which
+	// ends of the subtree the range reached.
+	Metric removed = Metric();
+
+	if (n->isLeaf) {
+		Leaf* l = (Leaf*)n;
+		T* items = l->items();
+		for(int i=begin; i<begin+count; i++)
+			removed = removed + l->metric[i];
+		destroy( items+begin, count );
+		relocate( items+begin, items+begin+count, l->count-begin-count );
+		shift( l->metric+begin, l->metric+begin+count, l->count-begin-count );
+		edges = (begin ? 0 : RangeAtStart) | (begin+count < l->count ? 0 : RangeAtEnd);
+		l->count -= count;
+		return removed;
+	}
+
+	Internal* in = (Internal*)n;
+	int i = 0;
+	while (begin >= in->size[i])
+		begin -= in->size[i++];
+
+	// Children entirely in the range are detached whole, so only the first and last can be partly erased
+	int first = i;
+	int firstWhole = -1, wholeCount = 0;
+	int firstEdges = RangeAtStart | RangeAtEnd, lastEdges = RangeAtStart | RangeAtEnd;	// as if the child were erased whole
+	for(; count; i++) {
+		int c = std::min( count, in->size[i] - begin );
+		lastEdges = RangeAtStart | RangeAtEnd;
+		if (c == in->size[i]) {
+			if (firstWhole < 0) firstWhole = i;
+			wholeCount++;
+			removed = removed + in->total[i];
+			toFree.push_back( in->child[i] );
+		} else {
+			Metric m = eraseRange( in->child[i], begin, c, toFree, lastEdges );
+			in->total[i] = in->total[i] - m;
+			in->size[i] -= c;
+			removed = removed + m;
+		}
+		if (i == first) firstEdges = lastEdges;
+		count -= c;
+		begin = 0;
+	}
+	int last = i-1;
+
+	if (first == last && !firstEdges) {
+		edges = 0;	// the range was within one child, which linked the leaves around it
+	} else {
+		Leaf* before = !(firstEdges & RangeAtStart) ? lastLeaf(in->child[first]) : first > 0 ? lastLeaf(in->child[first-1]) : NULL;
+		Leaf* after = !(lastEdges & RangeAtEnd) ? firstLeaf(in->child[last]) : last+1 < in->count ? firstLeaf(in->child[last+1]) : NULL;
+		if (before && after) {
+			before->next = after;
+			after->prev = before;
+		}
+		edges = (before ? 0 : RangeAtStart) | (after ? 0 : RangeAtEnd);
+	}
+
+	if (wholeCount)
+		removeChildren( in, firstWhole, wholeCount );
+
+	for(i = 0; i < in->count; ) {
+		if (in->count > 1 && underfull(in->child[i])) {
+			int left = i+1 < in->count ? i : i-1;
+			i = balanceChildren(in, left) ? left : left+1;	// a merged node may still be underfull
+		} else
+			i++;
+	}
+
+	return removed;
+}
+
+template <class T, class Metric, int NodeBytes>
+void BTreeIndexedSet<T,Metric,NodeBytes>::removeChildren( Internal* n, int begin, int count ) {
+	// Removes count children starting at begin, along with the separators made redundant
+	int after = n->count - begin - count;
+	shift( n->child+begin, n->child+begin+count, after );
+	shift( n->total+begin, n->total+begin+count, after );
+	shift( n->size+begin, n->size+begin+count, after );
+
+	T* keys = n->keys();
+	int k = begin ? begin-1 : 0;
+	destroy( keys+k, count );
+	relocate( keys+k, keys+k+count, n->count-1-k-count );
+	n->count -= count;
+}
+
+template <class T, class Metric, int NodeBytes>
+bool BTreeIndexedSet<T,Metric,NodeBytes>::balanceChildren( Internal* n, int i ) {
+	// Merges children i and i+1 of n if they fit in one node and returns true, or else evens out their items
+	T& separator = n->keys()[i];
+	int capacity = n->child[i]->isLeaf ? LeafCapacity : InternalCapacity;
+
+	if (n->child[i]->count + n->child[i+1]->count <= capacity) {
+		if (n->child[i]->isLeaf) {
+			Leaf* l = (Leaf*)n->child[i];
+			Leaf* r = (Leaf*)n->child[i+1];
+			relocate( l->items() + l->count, r->items(), r->count );
+			shift( l->metric + l->count, r->metric, r->count );
+			l->count += r->count;
+			r->count = 0;
+			l->next = r->next;
+			if (l->next) l->next->prev = l;
+			delete r;
+		} else {
+			Internal* l = (Internal*)n->child[i];
+			Internal* r = (Internal*)n->child[i+1];
+			new (&l->keys()[l->count-1]) T( std::move(separator) );
+			relocate( l->keys() + l->count, r->keys(), r->count-1 );
+			std::copy( r->child, r->child + r->count, l->child + l->count );
+			shift( l->total + l->count, r->total, r->count );
+			std::copy( r->size, r->size + r->count, l->size + l->count );
+			l->count += r->count;
+			r->count = 0;
+			delete r;
+		}
+		n->total[i] = n->total[i] + n->total[i+1];
+		n->size[i] += n->size[i+1];
+		removeChildren( n, i+1, 1 );
+		return true;
+	}
+
+	int target = (n->child[i]->count + n->child[i+1]->count) / 2;
+	Metric moved = Metric();
+	int movedSize = 0;
+
+	if (n->child[i]->isLeaf) {
+		Leaf* l = (Leaf*)n->child[i];
+		Leaf* r = (Leaf*)n->child[i+1];
+		if (l->count < target) {
+			int k = target - l->count;
+			for(int j=0; j<k; j++) moved = moved + r->metric[j];
+			relocate( l->items() + l->count, r->items(), k );
+			shift( l->metric + l->count, r->metric, k );
+			relocate( r->items(), r->items() + k, r->count - k );
+			shift( r->metric, r->metric + k, r->count - k );
+			l->count += k;
+			r->count -= k;
+			movedSize = k;
+		} else {
+			int k = l->count - target;
+			for(int j=target; j<l->count; j++) moved = moved - l->metric[j];
+			relocate( r->items() + k, r->items(), r->count );
+			shift( r->metric + k, r->metric, r->count );
+			relocate( r->items(), l->items() + target, k );
+			shift( r->metric, l->metric + target, k );
+			l->count -= k;
+			r->count += k;
+			movedSize = -k;
+		}
+		separator = r->items()[0];
+	} else {
+		Internal* l = (Internal*)n->child[i];
+		Internal* r = (Internal*)n->child[i+1];
+		T* lk = l->keys();
+		T* rk = r->keys();
+		if (l->count < target) {
+			// The first k children of r move to l, and the separator before the rest of r comes up from r
+			int k = target - l->count;
+			for(int j=0; j<k; j++) {
+				moved = moved + r->total[j];
+				movedSize += r->size[j];
+			}
+			new (&lk[l->count-1]) T( std::move(separator) );
+			relocate( lk + l->count, rk, k-1 );
+			separator = std::move( rk[k-1] );
+			rk[k-1].~T();
+			relocate( rk, rk + k, r->count-1-k );
+
+			std::copy( r->child, r->child + k, l->child + l->count );
+			shift( l->total + l->count, r->total, k );
+			std::copy( r->size, r->size + k, l->size + l->count );
+			shift( r->child, r->child + k, r->count - k );
+			shift( r->total, r->total + k, r->count - k );
+			shift( r->size, r->size + k, r->count - k );
+			l->count += k;
+			r->count -= k;
+		} else {
+			// The last k children of l move to r, and the separator before them comes up from l
+			int k = l->count - target;
+			for(int j=target; j<l->count; j++) {
+				moved = moved - l->total[j];
+				movedSize -= l->size[j];
+			}
+			relocate( rk + k, rk, r->count-1 );
+			new (&rk[k-1]) T( std::move(separator) );
+			relocate( rk, lk + target, k-1 );
+			separator = std::move( lk[target-1] );
+			lk[target-1].~T();
+
+			shift( r->child + k, r->child, r->count );
+			shift( r->total + k, r->total, r->count );
+			shift( r->size + k, r->size, r->count );
+			std::copy( l->child + target, l->child + l->count, r->child );
+			shift( r->total, l->total + target, k );
+			std::copy( l->size + target, l->size + l->count, r->size );
+			l->count -= k;
+			r->count += k;
+		}
+	}
+
+	n->total[i] = n->total[i] + moved;
+	n->total[i+1] = n->total[i+1] - moved;
+	n->size[i] += movedSize;
+	n->size[i+1] -= movedSize;
+	return false;
+}
+
+template <class T, class Metric, int NodeBytes>
+bool BTreeIndexedSet<T,Metric,NodeBytes>::freeNodes( std::vector<Node*>& toFree, int limit ) {
+	// Frees up to limit nodes of the subtrees in toFree, and returns true if any are left
+	while (!toFree.empty() && limit-- > 0) {
+		Node* n = toFree.back();
+		toFree.pop_back();
+		if (n->isLeaf) {
+			delete (Leaf*)n;
+		} else {
+			Internal* in = (Internal*)n;
+			toFree.insert( toFree.end(), in->child, in->child + in->count );
+			delete in;
+		}
+	}
+	return !toFree.empty();
+}
+
+// Returns first x such that metric < sum(begin(), x+1), or end()
+template <class T, class Metric, int NodeBytes>
+template <class M>
+typename BTreeIndexedSet<T,Metric,NodeBytes>::iterator BTreeIndexedSet<T,Metric,NodeBytes>::index( M const& metric ) const {
+	M m = metric;
+	Node* n = root;
+	if (!n) return end();
+	while (!n->isLeaf) {
+		Internal* in = (Internal*)n;
+		int i = 0;
+		while (!(m < in->total[i])) {
+			m = m - in->total[i];
+			if (++i == in->count) return end();
+		}
+		n = in->child[i];
+	}
+	Leaf* l = (Leaf*)n;
+	for(int i=0; i<l->count; i++) {
+		m = m - l->metric[i];
+		if (m < M())
+			return iterator(l, i);
+	}
+	return end();
+}
+
+template <class T, class Metric, int NodeBytes>
+Metric BTreeIndexedSet<T,Metric,NodeBytes>::sumTo(typename BTreeIndexedSet<T,Metric,NodeBytes>::iterator to) const {
+	if (!to.leaf)
+		return root ? subtreeTotal(root) : Metric();
+
+	T& key = *to;
+	Metric m = Metric();
+	Node* n = root;
+	while (!n->isLeaf) {
+		Internal* in = (Internal*)n;
+		int i = childIndex(in, key);
+		for(int j=0; j<i; j++) m = m + in->total[j];
+		n = in->child[i];
+	}
+	for(int j=0; j<to.pos; j++)
+		m = m + to.leaf->metric[j];
+	return m;
+}
+
+template <class T, class Metric, int NodeBytes>
+Future<Void> BTreeIndexedSet<T,Metric,NodeBytes>::eraseAsync(typename BTreeIndexedSet<T,Metric,NodeBytes>::iterator begin, typename BTreeIndexedSet<T,Metric,NodeBytes>::iterator end) {
+	std::vector<Node*> toFree;
+	int b = rank(begin);
+	eraseRange( b, rank(end) - b, toFree );
+	if (!freeNodes( toFree, 1000 ))
+		return Void();
+	return uncancellable( ISFreeIncrementally( [toFree]() mutable { return freeNodes( toFree, 1000 ); } ) );
+}
+
+#endif
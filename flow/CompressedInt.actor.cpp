@@ -105,3 +105,48 @@ TEST_CASE("flow/compressed_ints") {
 	}
 	return Void();
 }
+
+template<typename IntType>
+void testPackedInts(int count, int maxBits) {
+	Standalone<VectorRef<IntType>> values;
+	for(int i = 0; i < count; ++i) {
+		int bits = g_random->randomInt(0, maxBits);
+		IntType v = IntType((uint64_t(g_random->randomUInt32()) << 32 | g_random->randomUInt32()) & ((uint64_t(2) << bits) - 1));
+		if(std::is_signed<IntType>::value && g_random->coinflip())
+			v = ~v;
+		values.push_back(values.arena(), v);
+	}
+
+	BinaryWriter w(AssumeVersion(currentProtocolVersion));
+	w << PackedInts<IntType>(values);
+
+	Standalone<VectorRef<IntType>> decoded;
+	BinaryReader r(w.toStringRef(), AssumeVersion(currentProtocolVersion));
+	PackedInts<IntType> p(decoded);
+	r >> p;
+	decoded.arena().dependsOn(r.arena());
+
+	ASSERT(r.empty());
+	ASSERT(decoded.size() == values.size());
+	for(int i = 0; i < count; ++i)
+		ASSERT(decoded[i] == values[i]);
+}
+
+TEST_CASE("flow/packed_ints") {
+	Standalone<VectorRef<int64_t>> known;
+	int64_t knownValues[] = { 0, 1, -1, 300 };
+	for(auto v : knownValues)
+		known.push_back(known.arena(), v);
+	BinaryWriter w(AssumeVersion(currentProtocolVersion));
+	w << PackedInts<int64_t>(known);
+	ASSERT(w.toStringRef() == LiteralStringRef("\x84\x40\x00\x02\x01\x58\x02"));
+
+	for(int i = 0; i < 10000; ++i) {
+		int count = g_random->randomInt(0, 50);
+		testPackedInts<int64_t>(count, 64);
+		testPackedInts<uint64_t>(count, 64);
+		testPackedInts<int32_t>(count, 32);
+		testPackedInts<uint32_t>(count, 8);
+	}
+	return Void();
+}
@@ -20,6 +20,11 @@
 
 #pragma once
 
+#include "Arena.h"
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
 // A signed compressed integer format that retains ordering in compressed form.
 // Format is: [~sign_bit] [unary_len] [value_bits]
 //   If the sign bit is 0 then all other bits are inverted to maintain sort order
@@ -131,3 +136,86 @@ struct CompressedInt {
 		}
 	}
 };
+
+// Bulk encoding of an array of 32 or 64 bit integers in the stream-vbyte layout: a 2-bit length code for each value,
+// four to a byte, followed by the little-endian bytes of every value with its leading zero bytes dropped.  Keeping the
+// lengths apart from the data makes decoding a lookup and a short copy per value rather than CompressedInt's scan of each
+// value's header bits, and is the layout SIMD decoders shuffle four values at a time out of.  Signed values are zigzag
+// encoded so that small negative numbers stay short.  Unlike CompressedInt, the encoding does not preserve order.
+//
+// Serializing a PackedInts<T> writes the count as a CompressedInt<int> and then the encoded values; encode() and decode()
+// handle arrays whose length the caller already knows.
+template <typename IntType>
+struct PackedInts {
+	static_assert( sizeof(IntType) == 4 || sizeof(IntType) == 8, "PackedInts handles 32 and 64 bit integers" );
+	typedef typename std::make_unsigned<IntType>::type UIntType;
+
+	VectorRef<IntType>& data;
+	explicit PackedInts( VectorRef<IntType>& data ) : data(data) {}
+
+	// Byte lengths 1, 2, 3, 4 for 32 bit integers and 1, 2, 4, 8 for 64 bit integers
+	static int codeLength( int code ) { return sizeof(IntType) == 8 ? 1<<code : code+1; }
+	static int lengthCode( UIntType u ) {
+		if( sizeof(IntType) == 8 )
+			return u < (uint64_t(1)<<8) ? 0 : u < (uint64_t(1)<<16) ? 1 : u < (uint64_t(1)<<32) ? 2 : 3;
+		return u < (uint64_t(1)<<8) ? 0 : u < (uint64_t(1)<<16) ? 1 : u < (uint64_t(1)<<24) ? 2 : 3;
+	}
+
+	static UIntType zigzag( IntType v ) {
+		if( !std::is_signed<IntType>::value ) return UIntType(v);
+		return (UIntType(v) << 1) ^ UIntType( v < 0 ? -1 : 0 );
+	}
+	static IntType unzigzag( UIntType u ) {
+		if( !std::is_signed<IntType>::value ) return IntType(u);
+		return IntType( (u >> 1) ^ (UIntType(0) - (u & 1)) );
+	}
+
+	template <class Ar>
+	static void encode( Ar& ar, IntType const* values, int count ) {
+		if( !count ) return;
+		int controlBytes = (count+3)/4;
+		std::vector<uint8_t> buf( controlBytes + count*sizeof(IntType), 0 );
+		uint8_t* out = &buf[0] + controlBytes;
+		for(int i = 0; i < count; i++) {
+			UIntType u = zigzag( values[i] );
+			int code = lengthCode( u );
+			buf[i/4] |= code << (2*(i%4));
+			memcpy( out, &u, codeLength(code) );  // Little endian, as everything else BinaryWriter writes
+			out += codeLength(code);
+		}
+		ar.serializeBytes( &buf[0], out - &buf[0] );
+	}
+
+	template <class Ar>
+	static void decode( Ar& ar, IntType* values, int count ) {
+		if( !count ) return;
+		int controlBytes = (count+3)/4;
+		const uint8_t* control = (const uint8_t*)ar.readBytes( controlBytes );
+		int dataBytes = 0;
+		for(int i = 0; i < count; i++)
+			dataBytes += codeLength( (control[i/4] >> (2*(i%4))) & 3 );
+		const uint8_t* in = (const uint8_t*)ar.readBytes( dataBytes );
+		for(int i = 0; i < count; i++) {
+			int length = codeLength( (control[i/4] >> (2*(i%4))) & 3 );
+			UIntType u = 0;
+			memcpy( &u, in, length );
+			in += length;
+			values[i] = unzigzag( u );
+		}
+	}
+};
+
+template <class Archive, class IntType>
+inline void save( Archive& ar, const PackedInts<IntType>& p ) {
+	ar << CompressedInt<int>(p.data.size());
+	PackedInts<IntType>::encode( ar, p.data.begin(), p.data.size() );
+}
+
+template <class Archive, class IntType>
+inline void load( Archive& ar, PackedInts<IntType>& p ) {
+	CompressedInt<int> count;
+	ar >> count;
+	UNSTOPPABLE_ASSERT( count.value >= 0 && count.value*sizeof(IntType) < (100<<20) );
+	p.data.resize( ar.arena(), count.value );
+	PackedInts<IntType>::decode( ar, p.data.begin(), count.value );
+}
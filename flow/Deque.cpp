@@ -20,6 +20,9 @@
 
 #include "UnitTest.h"
 #include "Deque.h"
+#include <deque>
+#include <string>
+#include <vector>
 
 TEST_CASE("flow/Deque/12345") {
 	Deque<int> q;
@@ -80,5 +83,77 @@ TEST_CASE("flow/Deque/max_size") {
 	return Void();
 }
 
+TEST_CASE("flow/Deque/bulk") {
+	Deque<int> q;
+	std::deque<int> d;
+	std::vector<int> items;
+	int next = 0;
+	for (int i = 0; i < 10000; i++) {
+		int n = g_random->randomInt(0, 100);
+		if (g_random->random01() < 0.5) {
+			items.clear();
+			for (int j = 0; j < n; j++)
+				items.push_back(next++);
+			q.append(items.data(), n);
+			d.insert(d.end(), items.begin(), items.end());
+		} else {
+			n = std::min<int>(n, d.size());
+			items.resize(n);
+			q.copyTo(items.data(), n);
+			ASSERT(std::equal(items.begin(), items.end(), d.begin()));
+			q.pop_front(n);
+			d.erase(d.begin(), d.begin() + n);
+		}
+		ASSERT(q.size() == d.size());
+		ASSERT(!(q.capacity() & (q.capacity() - 1)));
+		ASSERT(q.empty() || q.frontSpan() > 0);
+		ASSERT(q.frontSpan() <= q.size());
+		for (int j = 0; j < q.frontSpan(); j++)
+			ASSERT((&q.front())[j] == d[j]);
+		for (int j = 0; j < q.size(); j++)
+			ASSERT(q[j] == d[j]);
+	}
+	return Void();
+}
+
+TEST_CASE("flow/Deque/bulk strings") {
+	Deque<std::string> q;
+	std::deque<std::string> d;
+	std::string items[] = { "a", "b", "c" };
+	for (int i = 0; i < 100; i++) {
+		q.append(items, 3);
+		d.insert(d.end(), items, items + 3);
+		q.pop_front(2);
+		d.erase(d.begin(), d.begin() + 2);
+	}
+	ASSERT(q.size() == d.size());
+	for (int i = 0; i < q.size(); i++)
+		ASSERT(q[i] == d[i]);
+	return Void();
+}
+
+struct CountingDequeAllocator {
+	static int64_t allocatedBytes;
+	int* allocate(size_t n) { allocatedBytes += n*sizeof(int); return new int[n]; }
+	void deallocate(int* p, size_t n) { allocatedBytes -= n*sizeof(int); delete[] p; }
+};
+int64_t CountingDequeAllocator::allocatedBytes = 0;
+
+TEST_CASE("flow/Deque/allocator") {
+	CountingDequeAllocator::allocatedBytes = 0;
+	{
+		Deque<int, CountingDequeAllocator> q;
+		for (int i = 0; i < 1000; i++)
+			q.push_back(i);
+		ASSERT(CountingDequeAllocator::allocatedBytes == q.capacity()*sizeof(int));
+		q.reserve(5000);
+		ASSERT(q.capacity() == 8192);
+		ASSERT(CountingDequeAllocator::allocatedBytes == 8192*sizeof(int));
+		for (int i = 0; i < 1000; i++)
+			ASSERT(q[i] == i);
+	}
+	ASSERT(CountingDequeAllocator::allocatedBytes == 0);
+	return Void();
+}
 
 void forceLinkDequeTests() {}
\ No newline at end of file
@@ -23,13 +23,27 @@
 #pragma once
 
 #include "Platform.h"
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
+#include <type_traits>
 
+// The default allocator of Deque<>, which aligns its buffer for T.  Any allocator with the allocate(n) and
+// deallocate(p, n) members of std::allocator<T> can be used instead, for example to account for memory use.
 template <class T>
+struct DequeAlignedAllocator {
+	T* allocate(size_t n) { return (T*)aligned_alloc(__alignof(T), n*sizeof(T)); }
+	void deallocate(T* p, size_t n) { aligned_free(p); }
+};
+
+template <class T, class Allocator = DequeAlignedAllocator<T>>
 class Deque {
 	// Double ended queue implemented using circular array (and on-demand reallocation, like std::vector)
 	// Interface similar to std::deque, but incomplete (also reallocation invalidates all iterators like std::vector)
 	// Capacity is limited to 2^32-1 items even in 64 bit
+	// The capacity is always a power of two, and the items are in at most two contiguous spans: front() and the
+	// frontSpan()-1 items after it, then the rest starting at the beginning of the buffer.  Bulk operations
+	// (append, pop_front(n), copyTo) work a span at a time, and use memcpy for trivial types.
 
 public:
 	typedef T value_type;
@@ -43,7 +57,7 @@ public:
 	// TODO: iterator construction, other constructors
 	Deque(Deque const& r) : arr(0), begin(0), end(r.size()), mask(r.mask) {
 		if(r.capacity() > 0)
-			arr = (T*)aligned_alloc(__alignof(T), capacity()*sizeof(T));
+			arr = allocator.allocate(capacity());
 		ASSERT(capacity() >= end || end == 0);
 		for(int i=0; i<end; i++)
 			new (&arr[i]) T(r[i]);
@@ -58,7 +72,7 @@ public:
 		end = r.size();
 		mask = r.mask;
 		if(r.capacity() > 0)
-			arr = (T*)aligned_alloc(__alignof(T), capacity()*sizeof(T));
+			arr = allocator.allocate(capacity());
 		ASSERT(capacity() >= end || end == 0);
 		for(int i=0; i<end; i++)
 			new (&arr[i]) T(r[i]);
@@ -127,6 +141,49 @@ public:
 			begin++;
 	}
 
+	// Appends the n items at items, growing at most once
+	void append(T const* items, size_type n) {
+		if (!n) return;
+		if (size_t(size()) + n > capacity()) reserve(size_t(size()) + n);
+		size_type first = std::min<size_type>(n, capacity() - (end&mask));
+		copyItems(&arr[end&mask], items, first);
+		copyItems(arr, items + first, n - first);
+		end += n;
+	}
+
+	// Removes the first n items
+	void pop_front(size_type n) {
+		ASSERT(n <= size());
+		if (!std::is_trivial<T>::value)
+			for (uint32_t i = begin; i != begin + n; i++)
+				arr[i&mask].~T();
+		begin += n;
+		if (begin > mask) {
+			begin -= mask + 1;
+			end -= mask + 1;
+		}
+	}
+
+	// Copies the first n items to the uninitialized space at out
+	void copyTo(T* out, size_type n) const {
+		ASSERT(n <= size());
+		size_type first = std::min<size_type>(n, frontSpan());
+		copyItems(out, &arr[begin], first);
+		copyItems(out + first, arr, n - first);
+	}
+
+	// The number of items stored contiguously starting at front()
+	size_type frontSpan() const { return std::min<size_type>(size(), capacity() - begin); }
+
+	// Makes room for at least n items without further reallocation
+	void reserve(size_t n) {
+		if (n <= capacity() && arr) return;
+		size_t newSize = 8;
+		while (newSize < n) newSize *= 2;
+		if (newSize > max_size()) throw std::bad_alloc();
+		reallocate(newSize);
+	}
+
 	void clear() {
 		for (int i = begin; i != end; i++)
 			arr[i&mask].~T();
@@ -152,21 +209,28 @@ public:
 private:
 	T *arr;
 	uint32_t begin, end, mask;
+	Allocator allocator;
 
 	bool full() const { return end == begin + mask + 1; }
 	void grow() {
-		// This doubles capacity (or makes it at least 8), and arbitrarily moves begin to be 0
+		// This doubles capacity (or makes it at least 8)
 
 		size_t mp1 = arr ? size_t(mask) + 1 : 4;
 		size_t newSize = mp1 * 2;
 		if (newSize > max_size()) throw std::bad_alloc();
+		reallocate(newSize);
+	}
+
+	void reallocate(size_t newSize) {
+		// Moves the items to a buffer of newSize items, arbitrarily moving begin to be 0
 		//printf("Growing to %lld (%u-%u mask %u)\n", (long long)newSize, begin, end, mask);
-		T *newArr = (T*)aligned_alloc(__alignof(T), newSize*sizeof(T));   // SOMEDAY: FastAllocator, exception safety
+		T *newArr = allocator.allocate(newSize);   // SOMEDAY: exception safety
 		for (int i = begin; i != end; i++) {
 			new (&newArr[i - begin]) T(std::move(arr[i&mask]));
 			arr[i&mask].~T();
 		}
-		aligned_free(arr);
+		if (arr)
+			allocator.deallocate(arr, capacity());
 		arr = newArr;
 		end -= begin;
 		begin = 0;
@@ -177,7 +241,18 @@ private:
 		for (int i = begin; i != end; i++)
 			arr[i&mask].~T();
 		if(arr)
-			aligned_free(arr);
+			allocator.deallocate(arr, capacity());
+	}
+
+	// Copies n items into uninitialized space (or out of the deque, for copyTo)
+	static void copyItems(T* to, T const* from, size_type n) {
+		if (!n)
+			return;
+		if (std::is_trivial<T>::value)
+			memcpy(to, from, n*sizeof(T));
+		else
+			for (size_type i = 0; i < n; i++)
+				new (&to[i]) T(from[i]);
 	}
 };
 
@@ -24,6 +24,8 @@
 #include "Trace.h"
 #include "Error.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <unordered_map>
 
@@ -38,6 +40,10 @@
 #include <linux/mman.h>
 #endif
 
+#ifdef __APPLE__
+#include <sys/mman.h>
+#endif
+
 #define FAST_ALLOCATOR_DEBUG 0
 
 #ifdef _MSC_VER
@@ -172,13 +178,166 @@ void recordDeallocation( void *ptr ) {
 #endif
 }
 
+INIT_SEG std::atomic<int64_t> heapSampleBytes(0);
+thread_local int64_t heapSampleCountdown = 0;
+INIT_SEG std::atomic<uint16_t> heapSampleFilter[1<<HEAP_SAMPLE_FILTER_BITS];
+
+namespace {
+struct HeapSampleSite {
+	std::vector<void*> stack;
+	int64_t liveCount, liveBytes;
+	int64_t totalCount, totalBytes;
+	HeapSampleSite() : liveCount(0), liveBytes(0), totalCount(0), totalBytes(0) {}
+};
+
+enum { HEAP_SAMPLE_STACK_DEPTH = 64 };
+
+INIT_SEG ThreadSpinLock heapSampleLock;
+INIT_SEG std::unordered_map<uint32_t, HeapSampleSite> heapSampleSites;  // keyed by a hash of the stack
+INIT_SEG std::unordered_map<void*, std::pair<uint32_t, size_t>> heapSamples;  // live sampled address -> site, size
+thread_local bool heapSample_entered = false;
+thread_local uint64_t heapSampleRandom = 0;
+
+// The number of bytes to allocate before taking the next sample.  Drawing it from an exponential distribution makes
+// every byte equally likely to be sampled, which is what pprof assumes when it scales a heap_v2 profile back up.
+int64_t nextHeapSampleCountdown( int64_t meanBytes ) {
+	if (!heapSampleRandom)
+		heapSampleRandom = (uint64_t)&heapSampleRandom ^ 0x9E3779B97F4A7C15ULL;
+	heapSampleRandom ^= heapSampleRandom << 13;
+	heapSampleRandom ^= heapSampleRandom >> 7;
+	heapSampleRandom ^= heapSampleRandom << 17;
+	double u = ((heapSampleRandom >> 11) + 1) * (1.0 / 9007199254740993.0);  // in (0, 1)
+	return (int64_t)std::min( -std::log(u) * meanBytes, 1e15 );
+}
+}
+
+void sampleHeapAllocation( void* ptr, size_t size ) {
+	int64_t meanBytes = heapSampleBytes.load(std::memory_order_relaxed);
+	heapSampleCountdown = nextHeapSampleCountdown(meanBytes);
+	if (heapSample_entered || !meanBytes)
+		return;
+	heapSample_entered = true;
+
+	void* stack[HEAP_SAMPLE_STACK_DEPTH];
+#ifdef __unixish__
+	int depth = platform::raw_backtrace( stack, HEAP_SAMPLE_STACK_DEPTH );
+#else
+	int depth = 0;
+#endif
+	uint32_t a = 0, b = 0;
+	hashlittle2( stack, depth * sizeof(void*), &a, &b );
+	{
+		ThreadSpinLockHolder holder( heapSampleLock );
+		// Check again under the lock, since sampling may have been turned off (and the samples dropped) since we looked
+		if (heapSampleBytes.load(std::memory_order_relaxed) && heapSamples.emplace( ptr, std::make_pair(a, size) ).second) {
+			auto& site = heapSampleSites[a];
+			if (site.stack.empty())
+				site.stack.assign( stack, stack + depth );
+			site.liveCount++;
+			site.liveBytes += size;
+			site.totalCount++;
+			site.totalBytes += size;
+			heapSampleFilter[heapSampleSlot(ptr)]++;
+		}
+	}
+	heapSample_entered = false;
+}
+
+void releaseHeapSample( void* ptr ) {
+	if (heapSample_entered)
+		return;
+	heapSample_entered = true;
+	{
+		ThreadSpinLockHolder holder( heapSampleLock );
+		auto it = heapSamples.find( ptr );
+		if (it != heapSamples.end()) {
+			auto& site = heapSampleSites[it->second.first];
+			site.liveCount--;
+			site.liveBytes -= it->second.second;
+			heapSampleFilter[heapSampleSlot(ptr)]--;
+			heapSamples.erase( it );
+		}
+	}
+	heapSample_entered = false;
+}
+
+void setHeapSampleBytes( int64_t bytes ) {
+	heapSample_entered = true;
+	{
+		ThreadSpinLockHolder holder( heapSampleLock );
+		heapSampleBytes = std::max<int64_t>( bytes, 0 );
+		if (!bytes) {
+			heapSamples.clear();
+			heapSampleSites.clear();
+			for(auto& slot : heapSampleFilter)
+				slot = 0;
+		}
+	}
+	heapSample_entered = false;
+}
+
+void dumpHeapSamples( std::string const& filename ) {
+	int64_t meanBytes;
+	std::unordered_map<uint32_t, HeapSampleSite> sites;
+	heapSample_entered = true;
+	{
+		ThreadSpinLockHolder holder( heapSampleLock );
+		meanBytes = heapSampleBytes.load();
+		sites = heapSampleSites;
+	}
+	heapSample_entered = false;
+
+	if (!meanBytes)
+		throw operation_failed();
+
+	int64_t liveCount = 0, liveBytes = 0, totalCount = 0, totalBytes = 0;
+	for(auto& site : sites) {
+		liveCount += site.second.liveCount;
+		liveBytes += site.second.liveBytes;
+		totalCount += site.second.totalCount;
+		totalBytes += site.second.totalBytes;
+	}
+
+	char buf[128];
+	snprintf( buf, sizeof(buf), "heap profile: %6lld: %8lld [%6lld: %8lld] @ heap_v2/%lld\n", (long long)liveCount, (long long)liveBytes, (long long)totalCount, (long long)totalBytes, (long long)meanBytes );
+	std::string out = buf;
+	for(auto& site : sites) {
+		snprintf( buf, sizeof(buf), "%6lld: %8lld [%6lld: %8lld] @", (long long)site.second.liveCount, (long long)site.second.liveBytes, (long long)site.second.totalCount, (long long)site.second.totalBytes );
+		out += buf;
+		for(void* pc : site.second.stack) {
+			snprintf( buf, sizeof(buf), " %p", pc );
+			out += buf;
+		}
+		out += "\n";
+	}
+#ifdef __linux__
+	out += "\nMAPPED_LIBRARIES:\n";
+	out += readFileBytes( "/proc/self/maps", 1<<24 );
+#endif
+
+	FILE* f = fopen( filename.c_str(), "wb" );
+	if (!f)
+		throw io_error();
+	bool ok = fwrite( out.data(), 1, out.size(), f ) == out.size();
+	ok = (fclose(f) == 0) && ok;
+	if (!ok)
+		throw io_error();
+
+	TraceEvent("HeapSamplesDumped").detail("Filename", filename).detail("Sites", sites.size())
+		.detail("SampledLiveBytes", liveBytes).detail("SampleBytes", meanBytes);
+}
+
 template <int Size>
 struct FastAllocator<Size>::GlobalData {
 	CRITICAL_SECTION mutex;
 	std::vector<void*> magazines;   // These magazines are always exactly magazine_size ("full")
 	std::vector<std::pair<int, void*>> partial_magazines;  // Magazines that are not "full" and their counts.  Only created by releaseThreadMagazines().
+	std::vector<void*> released;  // Objects whose pages have been returned to the OS by releaseUnusedMemory()
+	uint8_t* slab;      // The next magazine to be carved out of the current slab
+	int slabMagazines;  // The number of magazines left in the current slab
 	long long memoryUsed;
-	GlobalData() : memoryUsed(0) { 
+	long long memoryReleased;
+	GlobalData() : slab(0), slabMagazines(0), memoryUsed(0), memoryReleased(0) { 
 		InitializeCriticalSection(&mutex);
 	}
 };
@@ -190,7 +349,12 @@ long long FastAllocator<Size>::getMemoryUsed() {
 
 template <int Size>
 long long FastAllocator<Size>::getMemoryUnused() {
-	return globalData()->magazines.size() * magazine_size * Size;
+	return (globalData()->magazines.size() + globalData()->slabMagazines) * magazine_size * Size;
+}
+
+template <int Size>
+long long FastAllocator<Size>::getMemoryReleased() {
+	return globalData()->memoryReleased;
 }
 
 static int64_t getSizeCode(int i) {
@@ -204,7 +368,9 @@ static int64_t getSizeCode(int i) {
 		case 1024: return 7;
 		case 2048: return 8;
 		case 4096: return 9;
-		default: return 10;
+		case 8192: return 10;
+		case 16384: return 11;
+		default: return 12;
 	}
 }
 
@@ -241,11 +407,13 @@ void *FastAllocator<Size>::allocate() {
 #if defined(ALLOC_INSTRUMENTATION) || defined(ALLOC_INSTRUMENTATION_STDOUT)
 	recordAllocation(p, Size);
 #endif
+	recordHeapAllocation(p, Size);
 	return p;
 }
 
 template<int Size>
 void FastAllocator<Size>::release(void *ptr) {
+	recordHeapRelease(ptr);
 #if FASTALLOC_THREAD_SAFE
 	ThreadData& thr = threadData;
 	if (thr.count == magazine_size) {
@@ -341,17 +509,34 @@ void FastAllocator<Size>::getMagazine() {
 		threadData.freelist = p.second;
 		threadData.count = p.first;
 		return;
+	} else if (globalData()->released.size()) {
+		// Reuse objects whose pages were returned to the OS; relinking them faults the pages back in
+		int count = std::min<int>(magazine_size, globalData()->released.size());
+		std::vector<void*> objects(globalData()->released.end() - count, globalData()->released.end());
+		globalData()->released.resize(globalData()->released.size() - count);
+		globalData()->memoryReleased -= (long long)count*Size;
+		globalData()->memoryUsed += (long long)count*Size;
+		LeaveCriticalSection(&globalData()->mutex);
+
+		for(int i=0; i<count; i++) {
+			void** p = (void**)objects[i];
+			p[1] = p[0] = i+1<count ? objects[i+1] : 0;
+			check( p, false );
+		}
+		threadData.freelist = objects[0];
+		threadData.count = count;
+		return;
 	}
-	globalData()->memoryUsed += magazine_size*Size;
-	LeaveCriticalSection(&globalData()->mutex);
 
-	// Allocate a new page of data from the system allocator
+	// Carve a new magazine out of memory from the system allocator
 	#ifdef ALLOC_INSTRUMENTATION
 	interlockedIncrement(&pageCount);
 	#endif
 
 	void** block = 0;
 #if FAST_ALLOCATOR_DEBUG
+	globalData()->memoryUsed += magazine_size*Size;
+	LeaveCriticalSection(&globalData()->mutex);
 #ifdef WIN32
 	static int alt = 0; alt++;
 	block = (void**)VirtualAllocEx( GetCurrentProcess(), 
@@ -363,7 +548,16 @@ void FastAllocator<Size>::getMagazine() {
 	ASSERT( block == desiredBlock );
 #endif
 #else
-	block = (void **)::allocate(magazine_size * Size, true);
+	if (!globalData()->slabMagazines) {
+		// Large pages can't be partially returned to the OS, so they only back allocators that will never try
+		globalData()->slab = (uint8_t*)::allocate(slab_size, !releasable);
+		globalData()->slabMagazines = slab_size / (magazine_size*Size);
+		globalData()->memoryUsed += slab_size;
+	}
+	block = (void**)globalData()->slab;
+	globalData()->slab += magazine_size*Size;
+	globalData()->slabMagazines--;
+	LeaveCriticalSection(&globalData()->mutex);
 #endif
 
 	//void** block = new void*[ magazine_size * PSize ];
@@ -398,6 +592,69 @@ void FastAllocator<Size>::releaseThreadMagazines() {
 	thr.freelist = 0;
 }
 
+static bool releasePages( void* begin, size_t length ) {
+#ifdef _WIN32
+	return VirtualAlloc( begin, length, MEM_RESET, PAGE_READWRITE ) != NULL;
+#elif defined(__APPLE__)
+	return madvise( begin, length, MADV_FREE ) == 0;
+#else
+	return madvise( begin, length, MADV_DONTNEED ) == 0;
+#endif
+}
+
+template <int Size>
+long long FastAllocator<Size>::releaseUnusedMemory( long long retainBytes ) {
+	if (!releasable || FAST_ALLOCATOR_DEBUG) return 0;
+
+	std::vector<void*> mags;
+	EnterCriticalSection(&globalData()->mutex);
+	while ( (long long)globalData()->magazines.size() * magazine_size * Size > retainBytes ) {
+		mags.push_back( globalData()->magazines.back() );
+		globalData()->magazines.pop_back();
+	}
+	LeaveCriticalSection(&globalData()->mutex);
+	if (mags.empty()) return 0;
+
+	// The objects of a magazine need not be adjacent, so release them in sorted runs to keep the number of system calls down
+	std::vector<void*> objects;
+	objects.reserve( mags.size() * magazine_size );
+	for(auto m : mags)
+		for(void* p = m; p; p = *(void**)p)
+			objects.push_back(p);
+	std::sort( objects.begin(), objects.end() );
+
+	bool ok = true;
+	for(int i=0; i<objects.size() && ok; ) {
+		int j = i+1;
+		while (j<objects.size() && (uint8_t*)objects[j] == (uint8_t*)objects[j-1] + Size) j++;
+		ok = releasePages( objects[i], (size_t)(j-i)*Size );
+		i = j;
+	}
+
+	EnterCriticalSection(&globalData()->mutex);
+	if (ok) {
+		globalData()->released.insert( globalData()->released.end(), objects.begin(), objects.end() );
+		globalData()->memoryReleased += (long long)objects.size()*Size;
+		globalData()->memoryUsed -= (long long)objects.size()*Size;
+	} else {
+		// Pages that were released anyway just read back as zero, so the magazines have to be rebuilt before they are reused
+		for(int i=0; i<objects.size(); i+=magazine_size) {
+			int count = std::min<int>(magazine_size, objects.size()-i);
+			for(int k=0; k<count; k++) {
+				void** p = (void**)objects[i+k];
+				p[1] = p[0] = k+1<count ? objects[i+k+1] : 0;
+			}
+			if (count == magazine_size)
+				globalData()->magazines.push_back( objects[i] );
+			else
+				globalData()->partial_magazines.push_back( std::make_pair(count, objects[i]) );
+		}
+	}
+	LeaveCriticalSection(&globalData()->mutex);
+
+	return ok ? (long long)objects.size()*Size : 0;
+}
+
 void releaseAllThreadMagazines() {
 	FastAllocator<16>::releaseThreadMagazines();
 	FastAllocator<32>::releaseThreadMagazines();
@@ -408,6 +665,23 @@ void releaseAllThreadMagazines() {
 	FastAllocator<1024>::releaseThreadMagazines();
 	FastAllocator<2048>::releaseThreadMagazines();
 	FastAllocator<4096>::releaseThreadMagazines();
+	FastAllocator<8192>::releaseThreadMagazines();
+	FastAllocator<16384>::releaseThreadMagazines();
+}
+
+long long releaseUnusedFastAllocatorMemory( long long retainBytes ) {
+	// Only the page sized allocators can release anything; the smaller ones return 0 immediately
+	return FastAllocator<16>::releaseUnusedMemory(retainBytes) +
+		FastAllocator<32>::releaseUnusedMemory(retainBytes) +
+		FastAllocator<64>::releaseUnusedMemory(retainBytes) +
+		FastAllocator<128>::releaseUnusedMemory(retainBytes) +
+		FastAllocator<256>::releaseUnusedMemory(retainBytes) +
+		FastAllocator<512>::releaseUnusedMemory(retainBytes) +
+		FastAllocator<1024>::releaseUnusedMemory(retainBytes) +
+		FastAllocator<2048>::releaseUnusedMemory(retainBytes) +
+		FastAllocator<4096>::releaseUnusedMemory(retainBytes) +
+		FastAllocator<8192>::releaseUnusedMemory(retainBytes) +
+		FastAllocator<16384>::releaseUnusedMemory(retainBytes);
 }
 
 template class FastAllocator<16>;
@@ -419,4 +693,6 @@ template class FastAllocator<512>;
 template class FastAllocator<1024>;
 template class FastAllocator<2048>;
 template class FastAllocator<4096>;
+template class FastAllocator<8192>;
+template class FastAllocator<16384>;
 
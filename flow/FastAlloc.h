@@ -43,6 +43,8 @@
 #include <cstdlib>
 #include <cstdio>
 #include <unordered_map>
+#include <atomic>
+#include <string>
 
 #if defined(ALLOC_INSTRUMENTATION) && defined(__linux__)
 #include <execinfo.h>
@@ -99,6 +101,33 @@ void recordAllocation( void *ptr, size_t size );
 void recordDeallocation( void *ptr );
 #endif
 
+// A sampling heap profiler that can be turned on and off at runtime.  While heapSampleBytes is nonzero, about one
+// allocation in every heapSampleBytes bytes allocated from a FastAllocator (which includes all pooled arena blocks)
+// or as a huge arena block has its stack recorded, and is counted against that stack until it is released.
+extern std::atomic<int64_t> heapSampleBytes;
+extern thread_local int64_t heapSampleCountdown;
+
+// Counts the live samples whose address hashes to each slot, so that releasing memory that was not sampled
+// (nearly always) does not need to take a lock
+enum { HEAP_SAMPLE_FILTER_BITS = 16 };
+extern std::atomic<uint16_t> heapSampleFilter[1<<HEAP_SAMPLE_FILTER_BITS];
+inline int heapSampleSlot( void* ptr ) { return (int)(((uint64_t)ptr * 0x9E3779B97F4A7C15ULL) >> (64 - HEAP_SAMPLE_FILTER_BITS)); }
+
+void sampleHeapAllocation( void* ptr, size_t size );
+void releaseHeapSample( void* ptr );
+
+inline void recordHeapAllocation( void* ptr, size_t size ) {
+	if (heapSampleBytes.load(std::memory_order_relaxed) && (heapSampleCountdown -= size) < 0)
+		sampleHeapAllocation( ptr, size );
+}
+inline void recordHeapRelease( void* ptr ) {
+	if (heapSampleFilter[heapSampleSlot(ptr)].load(std::memory_order_relaxed))
+		releaseHeapSample( ptr );
+}
+
+void setHeapSampleBytes( int64_t bytes );  // 0 turns sampling off and drops all samples
+void dumpHeapSamples( std::string const& filename );  // Writes the live samples in the heap profile format pprof reads
+
 template <int Size>
 class FastAllocator {
 public:
@@ -108,8 +137,10 @@ public:
 
 	static long long getMemoryUsed();
 	static long long getMemoryUnused();
+	static long long getMemoryReleased();
 
 	static void releaseThreadMagazines();
+	static long long releaseUnusedMemory( long long retainBytes );  // Returns the pages of full unused magazines beyond retainBytes to the OS; returns the number of bytes released
 
 #ifdef ALLOC_INSTRUMENTATION
 	static volatile int32_t pageCount;
@@ -121,6 +152,8 @@ private:
 #endif
 
 	static const int magazine_size = (128<<10) / Size;
+	static const int slab_size = 2<<20;  // Magazines are carved out of slabs this big, so that one large page backs many magazines
+	static const bool releasable = Size % 4096 == 0;  // Only objects that cover whole pages can have their pages returned to the OS
 	static const int PSize = Size / sizeof(void*);
 	struct GlobalData;
 	struct ThreadData {
@@ -149,6 +182,7 @@ private:
 };
 
 void releaseAllThreadMagazines();
+long long releaseUnusedFastAllocatorMemory( long long retainBytes );
 void setFastAllocatorThreadInitFunction( void (*)() );  // The given function will be called at least once in each thread that allocates from a FastAllocator.  Currently just one such function is tracked.
 
 template<int X>
@@ -0,0 +1,73 @@
+/*
+ * Histogram.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "UnitTest.h"
+#include "Histogram.h"
+#include <vector>
+#include <algorithm>
+
+TEST_CASE("flow/Histogram/percentiles") {
+	// Every percentile is within a bucket's width of the exact one
+	LatencyHistogram h;
+	std::vector<double> values;
+	int n = g_random->randomInt(1, 10000);
+	for (int i = 0; i < n; i++) {
+		double v = g_random->random01() < 0.9 ? g_random->random01() * 0.01 : g_random->random01() * 10;
+		values.push_back(v);
+		h.record(v);
+	}
+	std::sort(values.begin(), values.end());
+	ASSERT(h.count() == n && h.min() == values.front() && h.max() == values.back());
+	for (double p : { 0.0, 0.5, 0.9, 0.99, 0.999, 1.0 }) {
+		double exact = values[std::max<int>(0, int(ceil(p * n)) - 1)];
+		ASSERT(fabs(h.percentile(p) - exact) <= std::max(2e-6, exact / (LatencyHistogram::HALF - 1)));
+	}
+	return Void();
+}
+
+TEST_CASE("flow/Histogram/merge") {
+	// Merging, directly or through toString(), gives exactly the histogram of all the values
+	LatencyHistogram all, merged, parsed;
+	for (int i = 0; i < 10; i++) {
+		LatencyHistogram part;
+		int n = g_random->randomInt(0, 1000);
+		for (int j = 0; j < n; j++) {
+			double v = g_random->random01() * (i + 1) * 0.001;
+			part.record(v);
+			all.record(v);
+		}
+		merged.merge(part);
+		LatencyHistogram copy;
+		ASSERT(copy.fromString(part.toString()));
+		parsed.merge(copy);
+	}
+	ASSERT(merged.count() == all.count() && parsed.count() == all.count());
+	for (double p : { 0.5, 0.99, 0.999 }) {
+		ASSERT(merged.percentile(p) == all.percentile(p));
+		ASSERT(parsed.percentile(p) == all.percentile(p));
+	}
+
+	LatencyHistogram bad;
+	ASSERT(!bad.fromString("") && !bad.fromString("1 2 3 x") && !bad.fromString("1 2 3 100000:1"));
+	ASSERT(bad.count() == 0);
+	return Void();
+}
+
+void forceLinkHistogramTests() {}
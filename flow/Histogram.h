@@ -0,0 +1,144 @@
+/*
+ * Histogram.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOW_HISTOGRAM_H
+#define FLOW_HISTOGRAM_H
+#pragma once
+
+#include "Platform.h"
+#include "Arena.h"
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// An HDR-style histogram of latencies.  Values are counted in microseconds, in buckets that are linear within each power of
+// two, so a percentile is accurate to within 1/SUB_BUCKETS of the true value no matter how many values are recorded.
+// Unlike a ContinuousSample nothing is sampled away: memory is constant, record() neither allocates nor takes a lock, and two
+// histograms merge exactly, so a percentile over many processes can be computed from their serialized histograms.
+class LatencyHistogram {
+public:
+	enum { SUB_BUCKET_BITS = 5, SUB_BUCKETS = 1<<SUB_BUCKET_BITS, HALF = SUB_BUCKETS/2, MAX_BITS = 40, BUCKETS = MAX_BITS*HALF };
+
+	LatencyHistogram() { clear(); }
+
+	void record( double seconds, int64_t times = 1 ) {
+		counts[ bucketFor( int64_t(seconds * 1e6) ) ] += times;
+		if( !total || seconds < minValue ) minValue = seconds;
+		if( !total || seconds > maxValue ) maxValue = seconds;
+		total += times;
+		sum += seconds * times;
+	}
+
+	void merge( LatencyHistogram const& r ) {
+		if( !r.total )
+			return;
+		for(int b = 0; b < BUCKETS; b++)
+			counts[b] += r.counts[b];
+		minValue = total ? std::min( minValue, r.minValue ) : r.minValue;
+		maxValue = total ? std::max( maxValue, r.maxValue ) : r.maxValue;
+		total += r.total;
+		sum += r.sum;
+	}
+
+	void clear() {
+		memset( counts, 0, sizeof(counts) );
+		total = 0;
+		sum = minValue = maxValue = 0;
+	}
+
+	int64_t count() const { return total; }
+	double mean() const { return total ? sum / total : 0; }
+	double min() const { return minValue; }
+	double max() const { return maxValue; }
+	double median() const { return percentile( 0.5 ); }
+
+	// The smallest recorded value (to bucket accuracy) that at least fraction p of the recorded values are no greater than
+	double percentile( double p ) const {
+		if( !total )
+			return 0;
+		int64_t target = std::max<int64_t>( 1, int64_t( ceil( p * total ) ) );
+		int64_t seen = 0;
+		for(int b = 0; b < BUCKETS; b++) {
+			seen += counts[b];
+			if( seen >= target )
+				return std::max( minValue, std::min( bucketValue(b), maxValue ) );
+		}
+		return maxValue;
+	}
+
+	// "<sum> <min> <max>" followed by " <bucket>:<count>" for each nonempty bucket.  fromString() recovers the histogram exactly,
+	// which is how a histogram gets from a trace event to Status.
+	std::string toString() const {
+		std::string s = format( "%.17g %.17g %.17g", sum, minValue, maxValue );
+		for(int b = 0; b < BUCKETS; b++)
+			if( counts[b] )
+				s += format( " %d:%lld", b, (long long)counts[b] );
+		return s;
+	}
+
+	// Returns false, leaving the histogram cleared, if s is not something toString() produced
+	bool fromString( std::string const& s ) {
+		clear();
+		int pos = 0;
+		if( sscanf( s.c_str(), "%lf %lf %lf%n", &sum, &minValue, &maxValue, &pos ) < 3 ) {
+			clear();
+			return false;
+		}
+		while( pos < s.size() ) {
+			int b, len = 0;
+			long long c;
+			if( sscanf( s.c_str() + pos, " %d:%lld%n", &b, &c, &len ) < 2 || !len || b < 0 || b >= BUCKETS || c < 0 ) {
+				clear();
+				return false;
+			}
+			counts[b] += c;
+			total += c;
+			pos += len;
+		}
+		return true;
+	}
+
+	static int bucketFor( int64_t us ) {
+		if( us < SUB_BUCKETS )
+			return std::max<int64_t>( us, 0 );
+		int msb = SUB_BUCKET_BITS;
+		while( us >> (msb+1) ) ++msb;
+		int shift = msb - (SUB_BUCKET_BITS-1);  // Brings us into [HALF, SUB_BUCKETS)
+		return std::min<int64_t>( (shift+1)*HALF + ((us>>shift) - HALF), BUCKETS-1 );
+	}
+
+	// The midpoint, in seconds, of the values that go in bucket b
+	static double bucketValue( int b ) {
+		if( b < SUB_BUCKETS )
+			return b * 1e-6;
+		int shift = b/HALF - 1;
+		int64_t low = int64_t(b%HALF + HALF) << shift;
+		return (low + ((int64_t(1)<<shift) - 1) / 2.0) * 1e-6;
+	}
+
+private:
+	int64_t counts[BUCKETS];
+	int64_t total;
+	double sum, minValue, maxValue;
+};
+
+#endif
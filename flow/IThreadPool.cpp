@@ -19,6 +19,7 @@
  */
 
 #include "IThreadPool.h"
+#include "UnitTest.h"
 
 #include <algorithm>
 #define BOOST_SYSTEM_NO_LIB
@@ -65,15 +66,20 @@ class ThreadPool : public IThreadPool, public ReferenceCounted<ThreadPool> {
 	enum Mode { Run=0, Shutdown=2 };
 	volatile int mode;
 
-	struct ActionWrapper {
-		PThreadAction action;
-		ActionWrapper(PThreadAction action) : action(action) {}
-		// HACK: Boost won't use move constructors, so we just assume the last copy made is the one that will be called or cancelled
-		ActionWrapper(ActionWrapper const& r) : action(r.action) { const_cast<ActionWrapper&>(r).action=NULL; }
-		void operator()() { Thread::dispatch(action); action = NULL; }
-		~ActionWrapper() { if (action) { action->cancel(); } }
-	private:
-		void operator=(ActionWrapper const&);
+	// Actions wait in queue, in lanes; each action posted also posts one RunNext to ios, which starts whichever action
+	// should go next when a thread takes it
+	ThreadSpinLock queueLock;
+	ThreadPoolQueue queue;
+
+	struct RunNext {
+		ThreadPool *pool;
+		explicit RunNext(ThreadPool *pool) : pool(pool) {}
+		void operator()() {
+			pool->queueLock.enter();
+			PThreadAction action = pool->queue.pop( timer_monotonic() );
+			pool->queueLock.leave();
+			Thread::dispatch(action);
+		}
 	};
 public:
 	ThreadPool() : dontstop(ios), mode(Run) {}
@@ -87,6 +93,7 @@ public:
 			threads[i]->stopped.block();
 			delete threads[i];
 		}
+		queue.cancelAll();
 		ReferenceCounted<ThreadPool>::delref();
 		return Void();
 	}
@@ -98,7 +105,17 @@ public:
 		startThread(start, threads.back());
 	}
 	void post( PThreadAction action ) {
-		ios.post( ActionWrapper( action ) );
+		post( action, THREAD_POOL_NORMAL );
+	}
+	void post( PThreadAction action, ThreadPoolLane lane ) {
+		queueLock.enter();
+		queue.push( action, lane, timer_monotonic() );
+		queueLock.leave();
+		ios.post( RunNext( this ) );
+	}
+	ThreadPoolQueueMetrics getQueueMetrics() {
+		ThreadSpinLockHolder holder( queueLock );
+		return queue.takeMetrics();
 	}
 };
 
@@ -109,3 +126,43 @@ Reference<IThreadPool>	createGenericThreadPool()
 }
 
 thread_local IThreadPoolReceiver* ThreadPool::Thread::threadUserObject;
+
+struct TestThreadAction : ThreadAction {
+	virtual void operator()(IThreadPoolReceiver*) { delete this; }
+	virtual void cancel() { delete this; }
+	virtual double getTimeEstimate() { return 0; }
+};
+
+TEST_CASE("flow/ThreadPoolQueue/lanes") {
+	double d = FLOW_KNOBS->THREAD_POOL_STARVATION_DELAY;
+	ThreadPoolQueue q;
+	PThreadAction a[4];
+	for(int i = 0; i < 4; i++)
+		a[i] = new TestThreadAction;
+
+	// The most urgent lane goes first, and each lane in order
+	q.push( a[0], THREAD_POOL_BULK, 0 );
+	q.push( a[1], THREAD_POOL_NORMAL, 0 );
+	q.push( a[2], THREAD_POOL_URGENT, 0.1*d );
+	q.push( a[3], THREAD_POOL_URGENT, 0.2*d );
+	ASSERT( q.size() == 4 );
+	ASSERT( q.pop(0.5*d) == a[2] && q.pop(0.5*d) == a[3] && q.pop(0.5*d) == a[1] && q.pop(0.5*d) == a[0] );
+	ASSERT( q.empty() );
+
+	// Until an action has waited too long
+	q.push( a[0], THREAD_POOL_BULK, 0 );
+	q.push( a[1], THREAD_POOL_URGENT, 2*d );
+	q.push( a[2], THREAD_POOL_NORMAL, 2*d );
+	ASSERT( q.pop(3*d) == a[0] && q.pop(3*d) == a[1] );
+
+	ThreadPoolQueueMetrics m = q.takeMetrics();
+	ASSERT( m.queued[THREAD_POOL_NORMAL] == 1 && m.delay[THREAD_POOL_URGENT].count() == 3 && m.delay[THREAD_POOL_BULK].count() == 2 );
+	ASSERT( q.takeMetrics().delay[THREAD_POOL_URGENT].count() == 0 );
+
+	q.cancelAll();
+	ASSERT( q.empty() );
+	for(int i = 0; i < 2; i++)
+		delete a[i];
+	delete a[3];
+	return Void();
+}
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "flow.h"
+#include "Histogram.h"
 
 // The IThreadPool interface represents a thread pool suitable for doing blocking disk-intensive work
 // (as opposed to a one-thread-per-core pool for CPU-intensive work)
@@ -41,6 +42,10 @@
 
 // ThreadReturnPromise<> can be safely use to pass return values from thread actions back to the g_network thread
 
+// An action may be posted to one of several lanes.  Actions in the same lane start in the order they were posted, and a
+// thread that becomes free takes from the most urgent nonempty lane, except that an action that has waited longer than
+// THREAD_POOL_STARVATION_DELAY starts ahead of everything posted after it.
+
 class IThreadPoolReceiver {
 public:
 	virtual ~IThreadPoolReceiver() {}
@@ -54,12 +59,89 @@ struct ThreadAction {
 };
 typedef ThreadAction* PThreadAction;
 
+enum ThreadPoolLane { THREAD_POOL_URGENT, THREAD_POOL_NORMAL, THREAD_POOL_BULK, THREAD_POOL_LANES };
+
+struct ThreadPoolQueueMetrics {
+	int64_t queued[THREAD_POOL_LANES];  // Waiting now
+	LatencyHistogram delay[THREAD_POOL_LANES];  // From post() until a thread started the action
+
+	ThreadPoolQueueMetrics() { memset( queued, 0, sizeof(queued) ); }
+};
+
+// The queue of a thread pool that supports lanes.  Not thread safe: the pool serializes access to it.
+class ThreadPoolQueue : NonCopyable {
+public:
+	void push( PThreadAction action, int lane, double now ) {
+		ASSERT( lane >= 0 && lane < THREAD_POOL_LANES );
+		lanes[lane].push_back( std::make_pair( action, now ) );
+	}
+
+	bool empty() const {
+		for(int l = 0; l < THREAD_POOL_LANES; l++)
+			if( !lanes[l].empty() )
+				return false;
+		return true;
+	}
+
+	size_t size() const {
+		size_t n = 0;
+		for(int l = 0; l < THREAD_POOL_LANES; l++)
+			n += lanes[l].size();
+		return n;
+	}
+
+	// The next action to start, which must exist
+	PThreadAction pop( double now ) {
+		int next = -1;
+		for(int l = 0; l < THREAD_POOL_LANES; l++) {
+			if( lanes[l].empty() )
+				continue;
+			if( next < 0 )
+				next = l;
+			else if( now - lanes[l].front().second > FLOW_KNOBS->THREAD_POOL_STARVATION_DELAY && lanes[l].front().second < lanes[next].front().second )
+				next = l;
+		}
+		ASSERT( next >= 0 );
+		PThreadAction action = lanes[next].front().first;
+		delay[next].record( now - lanes[next].front().second );
+		lanes[next].pop_front();
+		return action;
+	}
+
+	void cancelAll() {
+		for(int l = 0; l < THREAD_POOL_LANES; l++) {
+			for(int i = 0; i < lanes[l].size(); i++)
+				lanes[l][i].first->cancel();
+			lanes[l].clear();
+		}
+	}
+
+	// Returns the delays recorded since the last call
+	ThreadPoolQueueMetrics takeMetrics() {
+		ThreadPoolQueueMetrics m;
+		for(int l = 0; l < THREAD_POOL_LANES; l++) {
+			m.queued[l] = lanes[l].size();
+			m.delay[l] = delay[l];
+			delay[l].clear();
+		}
+		return m;
+	}
+
+private:
+	Deque<std::pair<PThreadAction, double>> lanes[THREAD_POOL_LANES];  // Each action, with when it was posted
+	LatencyHistogram delay[THREAD_POOL_LANES];
+};
+
 class IThreadPool {
 public:
 	virtual ~IThreadPool() {}
 	virtual Future<Void> getError() = 0;  // asynchronously throws an error if there is an internal error
 	virtual void addThread( IThreadPoolReceiver* userData ) = 0;
 	virtual void post( PThreadAction action ) = 0;
+	// Pools without lanes run every action in the order it was posted
+	virtual void post( PThreadAction action, ThreadPoolLane lane ) { post( action ); }
+	// The pool's queue delays since the last call, for pools with lanes
+	virtual ThreadPoolQueueMetrics getQueueMetrics() { return ThreadPoolQueueMetrics(); }
 	virtual Future<Void> stop() = 0;
 	virtual bool isCoro() const { return false; }
 	virtual void addref() = 0;
@@ -105,5 +187,44 @@ private:
 
 Reference<IThreadPool>	createGenericThreadPool();
 
+// A receiver for thread pools whose actions need no per-thread state, such as those posted by runOnThreadPool()
+class NullThreadPoolReceiver : public IThreadPoolReceiver {
+public:
+	virtual void init() {}
+};
+
+template <class T>
+class FunctionThreadAction : public ThreadAction, public FastAllocated<FunctionThreadAction<T>> {
+public:
+	FunctionThreadAction( std::function<T()> const& f, double timeEstimate ) : f(f), timeEstimate(timeEstimate) {}
+
+	virtual void operator()(IThreadPoolReceiver*) {
+		try {
+			result.send( f() );
+		} catch( Error& e ) {
+			result.sendError( e );
+		} catch( ... ) {
+			result.sendError( unknown_error() );
+		}
+		delete this;
+	}
+	virtual void cancel() { delete this; }
+	virtual double getTimeEstimate() { return timeEstimate; }
+
+	std::function<T()> f;
+	double timeEstimate;
+	ThreadReturnPromise<T> result;
+};
+
+// Runs f() on one of pool's threads, and returns its result or error to the g_network thread.  f must not touch anything that
+// belongs to the g_network thread: actors, futures, reference counts shared with it, or trace events.
+template <class T>
+Future<T> runOnThreadPool( Reference<IThreadPool> const& pool, std::function<T()> const& f, double timeEstimate = 0 ) {
+	auto action = new FunctionThreadAction<T>( f, timeEstimate );
+	Future<T> result = action->result.getFuture();
+	pool->post( action );
+	return result;
+}
+
 
 #endif
\ No newline at end of file
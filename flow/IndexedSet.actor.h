@@ -66,4 +66,13 @@ Future<Void> ISFreeNodes(std::vector<Node*> toFree, bool synchronous) {
 	return Void();
 }
 
+ACTOR template <class FreeSome>
+Future<Void> ISFreeIncrementally(FreeSome freeSome) {
+	// Calls freeSome(), which frees a batch of nodes and returns whether any are left, until it is done
+	while (freeSome())
+		Void _ = wait(yield());
+
+	return Void();
+}
+
 #endif
\ No newline at end of file
@@ -18,10 +18,11 @@
  * limitations under the License.
  */
 
-// At the moment, this file just contains tests.  IndexedSet<> is a template
-// and so all the important implementation is in the header file
+// At the moment, this file just contains tests.  IndexedSet<> and BTreeIndexedSet<> are templates
+// and so all the important implementation is in the header files
 
 #include "IndexedSet.h"
+#include "BTreeIndexedSet.h"
 #include "IRandom.h"
 #include "ThreadPrimitives.h"
 #include <algorithm>
@@ -426,4 +427,304 @@ TEST_CASE("flow/IndexedSet/all numbers") {
 	return Void();
 }
 
+template <class T, class Metric, int NodeBytes>
+void BTreeIndexedSet<T, Metric, NodeBytes>::testonly_assertBalanced() {
+	/* A BTreeIndexedSet has the following invariants:
+		(1) Order: the items of a leaf are in increasing order, keys()[i-1] of an internal node is <= every item under child[i] and
+		    greater than every item under child[i-1], and so iterating through the leaves visits every item in order
+		(2) Depth: every leaf is at the same depth, and no node is empty or over capacity
+		(3) Totals: total[i] and size[i] of an internal node are the sum of the metrics and the number of items under child[i]
+		(4) Links: prev and next of each leaf are its neighbors in order
+	It assumes that every item was inserted with a metric of 3 in order to check the metric totals.
+	*/
+	if (!root) return;
+
+	struct Checker {
+		Leaf* lastLeaf;
+		int leafDepth;
+
+		// Returns the number of items under n, whose items all lie within (lower, upper) where given
+		int check( Node* n, int depth, T* lower, T* upper ) {
+			ASSERT( n->count > 0 );
+			if (n->isLeaf) {
+				Leaf* l = (Leaf*)n;
+				ASSERT( l->count <= LeafCapacity );
+				if (leafDepth < 0) leafDepth = depth;
+				ASSERT( depth == leafDepth );
+				ASSERT( l->prev == lastLeaf );
+				if (lastLeaf) ASSERT( lastLeaf->next == l );
+				lastLeaf = l;
+				for(int i=0; i<l->count; i++) {
+					ASSERT( l->metric[i] == 3 );
+					if (i) ASSERT( l->items()[i-1] < l->items()[i] );
+					if (lower) ASSERT( !(l->items()[i] < *lower) );
+					if (upper) ASSERT( l->items()[i] < *upper );
+				}
+				return l->count;
+			}
+			Internal* in = (Internal*)n;
+			ASSERT( in->count <= InternalCapacity );
+			int size = 0;
+			for(int i=0; i<in->count; i++) {
+				int s = check( in->child[i], depth+1, i ? &in->keys()[i-1] : lower, i+1 < in->count ? &in->keys()[i] : upper );
+				ASSERT( in->size[i] == s );
+				ASSERT( in->total[i] == s*3 );
+				size += s;
+			}
+			return size;
+		}
+	};
+
+	Checker c = { NULL, -1 };
+	c.check( root, 0, NULL, NULL );
+	ASSERT( c.lastLeaf->next == NULL );
+}
+
+// A key large enough that BTreeIndexedSet<BTreeTestKey, int, 128> has the minimum node capacity, so that small sets are deep trees
+struct BTreeTestKey {
+	int value;
+	char padding[20];
+	BTreeTestKey( int value ) : value(value) { memset(padding, 0, sizeof(padding)); }
+	bool operator<( BTreeTestKey const& r ) const { return value < r.value; }
+};
+bool operator < (BTreeTestKey const& l, int r) { return l.value < r; }
+bool operator < (int l, BTreeTestKey const& r) { return l < r.value; }
+
+TEST_CASE("flow/BTreeIndexedSet/random ops") {
+	for (int t = 0; t<200; t++) {
+		BTreeIndexedSet<BTreeTestKey, int, 128> bs;
+		std::set<int> ss;
+		int range = g_random->randomInt(1, 5000);
+		int ops = g_random->randomInt(0, 2000);
+		for (int n = 0; n<ops; n++) {
+			int k = g_random->randomInt(0, range);
+			int op = g_random->randomInt(0, 10);
+			if (op < 5) {
+				ASSERT(bs.insert(BTreeTestKey(k), 3, op < 3)->value == k);
+				ss.insert(k);
+			} else if (op < 7) {
+				bs.erase(k);
+				ss.erase(k);
+			} else if (op < 8) {
+				int e = k + g_random->randomInt(0, range/2 + 1);
+				bs.erase(k, e);
+				ss.erase(ss.lower_bound(k), ss.lower_bound(e));
+			} else {
+				auto bi = bs.lower_bound(k);
+				auto si = ss.lower_bound(k);
+				ASSERT((bi == bs.end()) == (si == ss.end()));
+				if (si != ss.end()) ASSERT(bi->value == *si);
+
+				bi = bs.upper_bound(k);
+				si = ss.upper_bound(k);
+				ASSERT((bi == bs.end()) == (si == ss.end()));
+				if (si != ss.end()) ASSERT(bi->value == *si);
+
+				ASSERT(bs.count(k) == ss.count(k));
+
+				bi = bs.lastLessOrEqual(k);
+				if (si == ss.begin())
+					ASSERT(bi == bs.end());
+				else
+					ASSERT(bi->value == *--si);
+
+				int m = g_random->randomInt(0, 3*ss.size() + 6);
+				bi = bs.index(m);
+				if (m/3 >= ss.size())
+					ASSERT(bi == bs.end());
+				else {
+					ASSERT(bi->value == *std::next(ss.begin(), m/3));
+					ASSERT(bs.sumTo(bi) == m/3*3);
+				}
+			}
+		}
+		bs.testonly_assertBalanced();
+
+		int count = 0;
+		for (auto si = ss.begin(); si != ss.end(); ++si) {
+			ASSERT(bs.find(*si) != bs.end());
+			ASSERT(bs.find(*si)->value == *si);
+			++count;
+		}
+		for (auto bi = bs.begin(); bi != bs.end(); ++bi)
+			--count;
+		ASSERT(count == 0);
+		ASSERT(bs.sumTo(bs.end()) == ss.size()*3);
+
+		if (!ss.empty()) {
+			auto bi = bs.lastItem();
+			for (auto si = ss.rbegin(); si != ss.rend(); ++si) {
+				ASSERT(bi->value == *si);
+				if (bi != bs.begin()) bi.decrementNonEnd();
+			}
+		}
+	}
+	return Void();
+}
+
+TEST_CASE("flow/BTreeIndexedSet/erase ranges") {
+	for (int t = 0; t<1000; t++) {
+		BTreeIndexedSet<BTreeTestKey, int, 128> bs;
+		std::set<int> ss;
+		int n = g_random->randomInt(0, 2000);
+		for (int i = 0; i<n; i++) {
+			int k = g_random->randomInt(0, 10000);
+			bs.insert(BTreeTestKey(k), 3);
+			ss.insert(k);
+		}
+
+		int b = g_random->randomInt(0, 10000);
+		int e = g_random->randomInt(0, 10000);
+		if (e<b) std::swap(b, e);
+		ss.erase(ss.lower_bound(b), ss.lower_bound(e));
+		if (g_random->random01() < 0.5)
+			bs.erase(b, e);
+		else
+			bs.eraseAsync(b, e);
+		bs.testonly_assertBalanced();
+
+		auto bi = bs.begin();
+		for (auto si = ss.begin(); si != ss.end(); ++si, ++bi)
+			ASSERT(bi->value == *si);
+		ASSERT(bi == bs.end());
+		ASSERT(bs.sumTo(bs.end()) == ss.size()*3);
+	}
+	return Void();
+}
+
+TEST_CASE("flow/BTreeIndexedSet/all numbers") {
+	BTreeIndexedSet<int, int64_t> is;
+
+	std::vector<int> allNumbers;
+	for (int i = 0; i<1000000; i++)
+		allNumbers.push_back(i);
+	std::random_shuffle(allNumbers.begin(), allNumbers.end());
+
+	for (int i = 0; i<allNumbers.size(); i++)
+		is.insert(allNumbers[i], allNumbers[i]);
+
+	ASSERT(is.sumTo(is.end()) == allNumbers.size()*(allNumbers.size() - 1) / 2);
+
+	for (int i = 0; i<100000; i++) {
+		int b = g_random->randomInt(1, (int)allNumbers.size());
+		int64_t ntotal = int64_t(b)*(b - 1) / 2;
+		auto ii = is.index(ntotal);
+		ASSERT(ii != is.end() && *ii == b);
+	}
+
+	for (int i = 0; i<100000; i++) {
+		int a = g_random->randomInt(0, (int)allNumbers.size());
+		int b = g_random->randomInt(0, (int)allNumbers.size());
+		if (a>b) std::swap(a, b);
+		ASSERT(is.sumRange(a, b) == int64_t(b - a)*(a + b - 1) / 2);
+	}
+
+	is.erase(is.lower_bound(300000), is.lower_bound(700001));
+	int count = 0;
+	for (auto i : is) ++count;
+	ASSERT(count == 1000000 - 400001);
+
+	is.erase(is.begin(), is.end());
+	ASSERT(is.empty());
+
+	return Void();
+}
+
+TEST_CASE("flow/BTreeIndexedSet/strings") {
+	Map< std::string, int, MapPair<std::string, int>, NoMetric, BTreeIndexedSet<MapPair<std::string, int>, NoMetric> > myMap;
+	myMap["Hello"] = 1;
+	myMap["Planet"] = 5;
+
+	ASSERT(myMap.find("Hello")->value == 1);
+	ASSERT(myMap.find("World") == myMap.end());
+	ASSERT(myMap["Hello"] == 1);
+
+	auto a = myMap.upper_bound("A")->key;
+	auto x = myMap.lower_bound("M")->key;
+
+	ASSERT((a + x) == (std::string)"HelloPlanet");
+
+	return Void();
+}
+
+TEST_CASE("flow/BTreeIndexedSet/data constructor and destructor calls match") {
+	static int count;
+	count = 0;
+	struct Counter {
+		int value;
+		Counter(int value) : value(value) { count++; }
+		~Counter() { count--; }
+		Counter(const Counter& r) :value(r.value) { count++; }
+		void operator=(const Counter& r) { value = r.value; }
+		bool operator<(const Counter& r) const { return value < r.value; }
+	};
+	BTreeIndexedSet<Counter, NoMetric> mySet;
+	for (int i = 0; i<1000000; i++) {
+		mySet.insert(Counter(g_random->randomInt(0, 1000000)), NoMetric());
+		mySet.erase(Counter(g_random->randomInt(0, 1000000)));
+	}
+	int count2 = 0;
+	for (int i = 0; i<1000000; i++)
+		count2 += mySet.count(Counter(i));
+	ASSERT(count >= count2);	// separators in internal nodes are copies of items
+	mySet.clear();
+	ASSERT(count == 0);
+	return Void();
+}
+
+template <class Set>
+void benchmarkIndexedSet( const char* name, std::vector<int> const& x ) {
+	Set is;
+	double start = timer();
+	for (int i = 0; i<x.size(); i++)
+		is.insert(x[i], 3);
+	double end = timer();
+	printf("%s: %0.1f Kinsert/sec\n", name, x.size() / 1000.0 / (end - start));
+
+	start = timer();
+	int found = 0;
+	for (int i = 0; i<x.size(); i++)
+		found += is.find(x[i]) != is.end();
+	end = timer();
+	ASSERT(found == x.size());
+	printf("%s: %0.1f Kfind/sec\n", name, x.size() / 1000.0 / (end - start));
+
+	start = timer();
+	int64_t sum = 0;
+	for (int i = 0; i<x.size(); i++)
+		sum += is.sumTo(is.lower_bound(x[i]));
+	end = timer();
+	printf("%s: %0.1f KsumTo/sec\n", name, x.size() / 1000.0 / (end - start));
+
+	int total = is.sumTo(is.end());
+	start = timer();
+	for (int i = 0; i<x.size(); i++)
+		found += is.index(x[i] % total) != is.end();
+	end = timer();
+	ASSERT(found == 2*x.size());
+	printf("%s: %0.1f Kindex/sec\n", name, x.size() / 1000.0 / (end - start));
+
+	start = timer();
+	for (int i = 0; i<x.size(); i++)
+		is.erase(x[i]);
+	end = timer();
+	ASSERT(is.empty());
+	printf("%s: %0.1f Kerase/sec\n", name, x.size() / 1000.0 / (end - start));
+}
+
+TEST_CASE("flow/BTreeIndexedSet/performance") {
+	// Not a correctness test; compares the two containers on the same random keys.
+	std::vector<int> x;
+	for (int i = 0; i<1000000; i++)
+		x.push_back(g_random->randomInt(0, 10000000));
+	std::sort(x.begin(), x.end());
+	x.resize(std::unique(x.begin(), x.end()) - x.begin());
+	std::random_shuffle(x.begin(), x.end());
+
+	benchmarkIndexedSet<IndexedSet<int, int>>("IndexedSet", x);
+	benchmarkIndexedSet<BTreeIndexedSet<int, int>>("BTreeIndexedSet", x);
+
+	return Void();
+}
+
 void forceLinkIndexedSetTests() {}
\ No newline at end of file
@@ -48,7 +48,8 @@
 
 // Map<Key,Value> is similar to a std::map<Key,Value>, except that it inherits the search key type
 //     flexibility of IndexedSet<>, uses MapPair<Key,Value> by default instead of pair<Key,Value>
-//     (use iterator->key instead of iterator->first), and uses FastAllocator for nodes.
+//     (use iterator->key instead of iterator->first), and uses FastAllocator for nodes.  The Set parameter selects the
+//     underlying container, which can be a BTreeIndexedSet<Pair,Metric> instead (see BTreeIndexedSet.h).
 
 template <class T>
 class Future;
@@ -262,10 +263,10 @@ bool operator<(MapPair<Key, Value> const& l, CompatibleWithKey const& r) { retur
 template <class Key, class Value, class CompatibleWithKey>
 bool operator<(CompatibleWithKey const& l, MapPair<Key, Value> const& r) { return l < r.key; }
 
-template <class Key, class Value, class Pair = MapPair<Key,Value>, class Metric=NoMetric >
+template <class Key, class Value, class Pair = MapPair<Key,Value>, class Metric=NoMetric, class Set = IndexedSet<Pair,Metric> >
 class Map {
 public:
-	typedef typename IndexedSet<Pair,Metric>::iterator iterator;
+	typedef typename Set::iterator iterator;
 
 	Map() {}
 	iterator begin() const { return set.begin(); }
@@ -314,16 +315,16 @@ public:
 	template <class KeyCompatible> 
 	Metric sumRange(const KeyCompatible& begin, const KeyCompatible& end) const { return set.sumRange(begin,end); }
 
-	static int getElementBytes() { return IndexedSet< Pair, Metric >::getElementBytes(); }
+	static int getElementBytes() { return Set::getElementBytes(); }
 
 	Map(Map&& r) noexcept(true) : set(std::move(r.set)) {}
 	void operator=(Map&& r) noexcept(true) { set = std::move(r.set); }
 
 private:
-	Map( Map<Key,Value,Pair> const& ); // unimplemented
-	void operator=( Map<Key,Value,Pair> const& ); // unimplemented
+	Map( Map const& ); // unimplemented
+	void operator=( Map const& ); // unimplemented
 
-	IndexedSet< Pair, Metric > set;
+	Set set;
 };
 
 /////////////////////// implementation //////////////////////////
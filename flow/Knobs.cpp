@@ -59,19 +59,35 @@ FlowKnobs::FlowKnobs(bool randomize, bool isSimulated) {
 	init( MAX_RECONNECTION_TIME,                               0.5 );
 	init( RECONNECTION_TIME_GROWTH_RATE,                       1.2 );
 	init( RECONNECTION_RESET_TIME,                             5.0 );
+	init( DNS_CACHE_TTL,                                      60.0 ); if( randomize && BUGGIFY ) DNS_CACHE_TTL = 1.0;
+	init( DNS_CACHE_STALE_TTL,                               600.0 );
 
 	//AsyncFileCached
 	init( PAGE_CACHE_4K,                                2000LL<<20 );
+	init( PAGE_CACHE_PAGE_SIZE,                               4096 ); // Page size of the PAGE_CACHE_4K (and SIM_PAGE_CACHE_4K) cache; set it to match SQLITE_PAGE_SIZE
 	init( PAGE_CACHE_64K,                                200LL<<20 );
 	init( SIM_PAGE_CACHE_4K,                                   1e8 );
 	init( SIM_PAGE_CACHE_64K,                                  1e7 );
 	init( BUGGIFY_SIM_PAGE_CACHE_4K,                           1e6 );
 	init( BUGGIFY_SIM_PAGE_CACHE_64K,                          1e6 );
 	init( MAX_EVICT_ATTEMPTS,                                  100 ); if( randomize && BUGGIFY ) MAX_EVICT_ATTEMPTS = 2;
+	init( CACHE_EVICTION_POLICY,                          "random" ); if( randomize && BUGGIFY ) CACHE_EVICTION_POLICY = g_random->coinflip() ? "random" : "slru";
+	init( CACHE_PROTECTED_FRACTION,                           0.75 ); if( randomize && BUGGIFY ) CACHE_PROTECTED_FRACTION = g_random->random01();
+
+	//IThreadPool
+	init( THREAD_POOL_STARVATION_DELAY,                        1.0 ); if( randomize && BUGGIFY ) THREAD_POOL_STARVATION_DELAY = 0.001;
 
 	//AsyncFileKAIO
 	init( MAX_OUTSTANDING,                                      64 );
 	init( MIN_SUBMIT,                                           10 );
+	init( KAIO_COALESCE_LIMIT,                                  16 ); // Maximum number of contiguous reads or writes merged into one vectored I/O
+	init( KAIO_MAX_OUTSTANDING_PER_FILE,                         0 ); // 0 means only MAX_OUTSTANDING applies
+	init( KAIO_MAX_BACKGROUND_OUTSTANDING_PER_DEVICE,           40 ); // Leaves room in the device queue for I/Os at or above TaskDefaultYield
+
+	//AsyncFileIOUring
+	init( USE_IO_URING,                                          0 );
+	init( IO_URING_SQPOLL,                                       0 );
+	init( IO_URING_FIXED_FILES,                                128 );
 
 	init( PAGE_WRITE_CHECKSUM_HISTORY,                           0 ); if( randomize && BUGGIFY ) PAGE_WRITE_CHECKSUM_HISTORY = 10000000;
 
@@ -86,16 +102,26 @@ FlowKnobs::FlowKnobs(bool randomize, bool isSimulated) {
 	init( INCREMENTAL_DELETE_TRUNCATE_AMOUNT,                  5e8 ); //500MB
 	init( INCREMENTAL_DELETE_INTERVAL,                         1.0 ); //every 1 second
 		
+	//FastAlloc
+	init( FAST_ALLOC_RETAINED_UNUSED_BYTES,              100LL<<20 ); if( randomize && BUGGIFY ) FAST_ALLOC_RETAINED_UNUSED_BYTES = g_random->randomInt(0, 4) << 20;
+
 	//Net2 and FlowTransport
 	init( MIN_COALESCE_DELAY,                                10e-6 ); if( randomize && BUGGIFY ) MIN_COALESCE_DELAY = 0;
 	init( MAX_COALESCE_DELAY,                                20e-6 ); if( randomize && BUGGIFY ) MAX_COALESCE_DELAY = 0;
 	init( SLOW_LOOP_CUTOFF,                          15.0 / 1000.0 );
 	init( SLOW_LOOP_SAMPLING_RATE,                             0.1 );
+	init( RUN_LOOP_PROFILE_SAMPLE_INTERVAL,                   1000 );
 	init( TSC_YIELD_TIME,                                  1000000 );
+	init( THREAD_READY_RING_SIZE,                            16384 );
+	init( TIMER_WHEEL_RESOLUTION,                             10e-6 );
 
 	//Network
 	init( PACKET_LIMIT,                                  100LL<<20 );
 	init( PACKET_WARNING,                                  2LL<<20 );  // 2MB packet warning quietly allows for 1MB system messages
+	init( PACKET_COMPRESSION_MIN_BYTES,                          0 ); if( randomize && BUGGIFY ) PACKET_COMPRESSION_MIN_BYTES = g_random->randomInt(1, 10000);
+	init( PACKET_COMPRESSION_LEVEL,                              1 ); if( randomize && BUGGIFY ) PACKET_COMPRESSION_LEVEL = g_random->randomInt(1, 10);
+	init( RPC_LATENCY_SAMPLE_RATE,                             0.0 ); if( randomize && BUGGIFY ) RPC_LATENCY_SAMPLE_RATE = g_random->random01();
+	init( RPC_LATENCY_SAMPLE_SIZE,                            1000 );
 	init( TIME_OFFSET_LOGGING_INTERVAL,                       60.0 );
 
 	//Sim2
@@ -108,6 +134,7 @@ FlowKnobs::FlowKnobs(bool randomize, bool isSimulated) {
 	init( SLOW_NETWORK_LATENCY,                             100e-3 );
 	init( MAX_CLOGGING_LATENCY,                                  0 ); if( randomize && BUGGIFY ) MAX_CLOGGING_LATENCY =  0.1 * g_random->random01();
 	init( MAX_BUGGIFIED_DELAY,                                   0 ); if( randomize && BUGGIFY ) MAX_BUGGIFIED_DELAY =  0.2 * g_random->random01();
+	init( SIM_PROFILE_INTERVAL,                                  0 ); // Wall clock seconds between SimulatorProfile events; 0 disables profiling the simulator
 
 	//Tracefiles
 	init( ZERO_LENGTH_FILE_PAD,                                  1 );
@@ -119,6 +146,13 @@ FlowKnobs::FlowKnobs(bool randomize, bool isSimulated) {
 	init( TRACE_EVENT_METRIC_UNITS_PER_SAMPLE,				   500 );
 	init( TRACE_EVENT_THROTLLER_SAMPLE_EXPIRY,				   1800.0 ); // 30 mins
 	init( TRACE_EVENT_THROTTLER_MSG_LIMIT,					  20000 );
+	init( TRACE_RATE_LIMIT_REPORT_INTERVAL,                    5.0 );
+
+	//Profiling
+	init( CONTINUOUS_PROFILER_PERIOD,                            0 ); // In microseconds of CPU time; 0 disables
+	init( CONTINUOUS_PROFILER_WINDOW,                        300.0 );
+	init( HEAP_PROFILER_ENABLED,                                 0 ); // Heap sampling can also be turned on and off through the worker's profiler interface
+	init( HEAP_PROFILER_SAMPLE_BYTES,                      1<<19 );
 
 	//TDMetrics
 	init( MAX_METRICS,                                         600 );
@@ -127,6 +161,7 @@ FlowKnobs::FlowKnobs(bool randomize, bool isSimulated) {
 	init( METRIC_LEVEL_DIVISOR,                             log(4) ); 
 	init( METRIC_LIMIT_START_QUEUE_SIZE,                        10 );  // The queue size at which to start restricting logging by disabling levels
 	init( METRIC_LIMIT_RESPONSE_FACTOR,                         10 );  // The additional queue size at which to disable logging of another level (higher == less restrictive)
+	init( METRIC_EXPORT_INTERVAL,                             10.0 );
 
 	//Load Balancing
 	init( LOAD_BALANCE_MAX_BACKOFF,                            5.0 );
@@ -139,6 +174,8 @@ FlowKnobs::FlowKnobs(bool randomize, bool isSimulated) {
 	init( SECOND_REQUEST_MULTIPLIER_DECAY,                 0.00025 );
 	init( SECOND_REQUEST_BUDGET_GROWTH,                       0.05 );
 	init( SECOND_REQUEST_MAX_BUDGET,                         100.0 );
+	init( SECOND_REQUEST_LATENCY_PERCENTILE,                  0.95 ); if( randomize && BUGGIFY ) SECOND_REQUEST_LATENCY_PERCENTILE = g_random->random01();
+	init( SECOND_REQUEST_PERCENTILE_STEP,                      0.1 );
 	init( ALTERNATIVES_FAILURE_RESET_TIME,                     5.0 );
 	init( ALTERNATIVES_FAILURE_MAX_DELAY,                      1.0 );
 	init( ALTERNATIVES_FAILURE_MIN_DELAY,                     0.05 );
@@ -176,6 +213,15 @@ bool Knobs::setKnob( std::string const& knob, std::string const& value ) {
 		}
 		return true;
 	}
+	if (bool_knobs.count(knob)) {
+		if (value == "true" || value == "1")
+			*bool_knobs[knob] = true;
+		else if (value == "false" || value == "0")
+			*bool_knobs[knob] = false;
+		else
+			throw invalid_option_value();
+		return true;
+	}
 	if (string_knobs.count(knob)) {
 		*string_knobs[knob] = value;
 		return true;
@@ -208,6 +254,11 @@ void Knobs::initKnob( int& knob, int value, std::string const& name ) {
 	int_knobs[toLower(name)] = &knob;
 }
 
+void Knobs::initKnob( bool& knob, bool value, std::string const& name ) {
+	knob = value;
+	bool_knobs[toLower(name)] = &knob;
+}
+
 void Knobs::initKnob( std::string& knob, const std::string& value, const std::string& name ) {
 	knob = value;
 	string_knobs[toLower(name)] = &knob;
@@ -220,6 +271,8 @@ void Knobs::trace() {
 		TraceEvent("Knob").detail(k.first.c_str(), *k.second );
 	for(auto &k : int64_knobs)
 		TraceEvent("Knob").detail(k.first.c_str(), *k.second );
+	for(auto &k : bool_knobs)
+		TraceEvent("Knob").detail(k.first.c_str(), *k.second );
 	for(auto &k : string_knobs)
 		TraceEvent("Knob").detail(k.first.c_str(), *k.second );
 }
@@ -37,11 +37,13 @@ protected:
 	void initKnob( double& knob, double value, std::string const& name );
 	void initKnob( int64_t& knob, int64_t value, std::string const& name );
 	void initKnob( int& knob, int value, std::string const& name );
+	void initKnob( bool& knob, bool value, std::string const& name );
 	void initKnob( std::string& knob, const std::string& value, const std::string& name );
 
 	std::map<std::string, double*> double_knobs;
 	std::map<std::string, int64_t*> int64_knobs;
 	std::map<std::string, int*> int_knobs;
+	std::map<std::string, bool*> bool_knobs;
 	std::map<std::string, std::string*> string_knobs;
 };
 
@@ -79,19 +81,35 @@ public:
 	double MAX_RECONNECTION_TIME;
 	double RECONNECTION_TIME_GROWTH_RATE;
 	double RECONNECTION_RESET_TIME;
+	double DNS_CACHE_TTL;  // How long a lookup is used before it is refreshed
+	double DNS_CACHE_STALE_TTL;  // How long a lookup is still used, while it is refreshed in the background or if refreshing fails
 
 	//AsyncFileCached
 	int64_t PAGE_CACHE_4K;
+	int PAGE_CACHE_PAGE_SIZE;
 	int64_t PAGE_CACHE_64K;
 	int64_t SIM_PAGE_CACHE_4K;
 	int64_t SIM_PAGE_CACHE_64K;
 	int64_t BUGGIFY_SIM_PAGE_CACHE_4K;
 	int64_t BUGGIFY_SIM_PAGE_CACHE_64K;
 	int MAX_EVICT_ATTEMPTS;
+	std::string CACHE_EVICTION_POLICY; // "random" or "slru" (segmented LRU)
+	double CACHE_PROTECTED_FRACTION;
+
+	//IThreadPool
+	double THREAD_POOL_STARVATION_DELAY;  // An action waiting longer than this starts ahead of more urgent lanes' later actions
 
 	//AsyncFileKAIO
 	int MAX_OUTSTANDING;
 	int MIN_SUBMIT;
+	int KAIO_COALESCE_LIMIT;
+	int KAIO_MAX_OUTSTANDING_PER_FILE;
+	int KAIO_MAX_BACKGROUND_OUTSTANDING_PER_DEVICE;
+
+	//AsyncFileIOUring
+	int USE_IO_URING; // If nonzero, unbuffered files on Linux use io_uring instead of kernel AIO
+	int IO_URING_SQPOLL;
+	int IO_URING_FIXED_FILES;
 
 	int PAGE_WRITE_CHECKSUM_HISTORY;
 
@@ -106,17 +124,27 @@ public:
 	int64_t INCREMENTAL_DELETE_TRUNCATE_AMOUNT;
 	double INCREMENTAL_DELETE_INTERVAL;
 
+	//FastAlloc
+	int64_t FAST_ALLOC_RETAINED_UNUSED_BYTES; // Unused memory in each page sized allocator class beyond this is returned to the OS by the system monitor
+
 	//Net2
 	double MIN_COALESCE_DELAY;
 	double MAX_COALESCE_DELAY;
 	double SLOW_LOOP_CUTOFF;
 	double SLOW_LOOP_SAMPLING_RATE;
+	int RUN_LOOP_PROFILE_SAMPLE_INTERVAL; // One in this many run loop tasks is timed for the RunLoopProfile trace event; 0 disables
 	int64_t TSC_YIELD_TIME;
+	int THREAD_READY_RING_SIZE; // Capacity (rounded up to a power of two) of the preallocated queue other threads use to hand tasks to the network thread
+	double TIMER_WHEEL_RESOLUTION; // Seconds per tick of Net2's timer wheel; a delay() can expire up to this much late
 	int64_t REACTOR_FLAGS;
 
 	//Network
 	int64_t PACKET_LIMIT;
 	int64_t PACKET_WARNING;  // 2MB packet warning quietly allows for 1MB system messages
+	int PACKET_COMPRESSION_MIN_BYTES; // Unreliable packets at least this big are deflated for peers that can inflate them; 0 disables
+	int PACKET_COMPRESSION_LEVEL;
+	double RPC_LATENCY_SAMPLE_RATE; // Fraction of remote getReply/tryGetReply calls whose latency and request size are recorded per request type; 0 disables
+	int RPC_LATENCY_SAMPLE_SIZE;
 	double TIME_OFFSET_LOGGING_INTERVAL;
 
 	//Sim2
@@ -130,6 +158,7 @@ public:
 	double SLOW_NETWORK_LATENCY;
 	double MAX_CLOGGING_LATENCY;
 	double MAX_BUGGIFIED_DELAY;
+	double SIM_PROFILE_INTERVAL;
 
 	//Tracefiles
 	int ZERO_LENGTH_FILE_PAD;
@@ -141,6 +170,13 @@ public:
 	int TRACE_EVENT_METRIC_UNITS_PER_SAMPLE;
 	int TRACE_EVENT_THROTLLER_SAMPLE_EXPIRY;
 	int TRACE_EVENT_THROTTLER_MSG_LIMIT;
+	double TRACE_RATE_LIMIT_REPORT_INTERVAL;
+
+	//Profiling
+	int CONTINUOUS_PROFILER_PERIOD;
+	double CONTINUOUS_PROFILER_WINDOW;
+	int HEAP_PROFILER_ENABLED;
+	int64_t HEAP_PROFILER_SAMPLE_BYTES;
 
 	//TDMetrics
 	int64_t MAX_METRIC_SIZE;
@@ -149,6 +185,7 @@ public:
 	int METRIC_LIMIT_START_QUEUE_SIZE;
 	int METRIC_LIMIT_RESPONSE_FACTOR;
 	int MAX_METRICS;
+	double METRIC_EXPORT_INTERVAL;
 
 	//Load Balancing
 	double LOAD_BALANCE_MAX_BACKOFF;
@@ -161,6 +198,8 @@ public:
 	double SECOND_REQUEST_MULTIPLIER_DECAY;
 	double SECOND_REQUEST_BUDGET_GROWTH;
 	double SECOND_REQUEST_MAX_BUDGET;
+	double SECOND_REQUEST_LATENCY_PERCENTILE; // The second request of a load balanced read is sent once the first has taken this percentile of its server's latency
+	double SECOND_REQUEST_PERCENTILE_STEP;
 	double ALTERNATIVES_FAILURE_RESET_TIME;
 	double ALTERNATIVES_FAILURE_MAX_DELAY;
 	double ALTERNATIVES_FAILURE_MIN_DELAY;
@@ -33,6 +33,7 @@
 
 #include "ActorCollection.h"
 #include "ThreadSafeQueue.h"
+#include "TimerWheel.h"
 #include "ThreadHelper.actor.h"
 #include "TDMetric.actor.h"
 #include "AsioReactor.h"
@@ -51,12 +52,15 @@ using namespace boost::asio::ip;
 // These impact both communications and the deserialization of certain database and IKeyValueStore keys
 //                                                 xyzdev
 //                                                 vvvv
-uint64_t currentProtocolVersion        = 0x0FDB00A560010001LL;
+uint64_t currentProtocolVersion        = 0x0FDB00A570010008LL;
 uint64_t compatibleProtocolVersionMask = 0xffffffffffff0000LL;
 uint64_t minValidProtocolVersion       = 0x0FDB00A200060001LL;
 
 
 #if defined(__linux__)
+#include <climits>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <execinfo.h>
 
 volatile double net2liveness = 0;
@@ -108,12 +112,19 @@ struct OrderedTask {
 	int64_t priority;
 	int taskID;
 	Task *task;
-	OrderedTask(int64_t priority, int taskID, Task* task) : priority(priority), taskID(taskID), task(task) {}
+	double readyTime;  // Set only for the tasks sampled for the run loop profile
+	OrderedTask() : priority(0), taskID(0), task(0), readyTime(0) {}
+	OrderedTask(int64_t priority, int taskID, Task* task) : priority(priority), taskID(taskID), task(task), readyTime(0) {}
 	bool operator < (OrderedTask const& rhs) const { return priority < rhs.priority; }
 };
 
 thread_local INetwork* thread_network = 0;
 
+// Set once a thread has had to hand a task to the network thread through Net2::threadReady because
+// Net2::threadReadyRing was full.  From then on that thread only uses threadReady, which keeps the tasks
+// it submits in order (see Net2::processThreadReady).
+static thread_local bool threadReadyRingOverflowed = false;
+
 class Net2 sealed : public INetwork, public INetworkConnections {
 
 public:
@@ -164,11 +175,21 @@ public:
 	double taskBegin;
 	int currentTaskID;
 	uint64_t tasksIssued;
+	int64_t tasksUntilProfileSample;
 	TDMetricCollection tdmetrics;
 	double currentTime;
 	bool stopped;
 	std::map< uint32_t, bool > addressOnHostCache;
 
+	struct DNSCacheEntry {
+		std::vector<NetworkAddress> addresses;
+		double resolved;  // When addresses were looked up, or -1 if no lookup has succeeded
+		Future<Void> lookup;  // Ready unless a lookup is in progress
+
+		DNSCacheEntry() : resolved(-1), lookup(Void()) {}
+	};
+	std::map< std::pair<std::string, std::string>, DNSCacheEntry > dnsCache;  // Entries are never removed
+
 	uint64_t numYields;
 
 	double lastPriorityTrackTime;
@@ -176,21 +197,25 @@ public:
 	double priorityTimer[NetworkMetrics::PRIORITY_BINS];
 
 	std::priority_queue<OrderedTask, std::vector<OrderedTask>> ready;
+	// Tasks submitted by other threads.  Submissions go to the preallocated ring unless it is (or once was) full
+	BoundedThreadSafeQueue<OrderedTask> threadReadyRing;
 	ThreadSafeQueue<OrderedTask> threadReady;
+	std::vector<OrderedTask> threadReadyBatch;
+	int64_t threadReadyBatchEnd;
 
-	struct DelayedTask : OrderedTask {
-		double at;
-		DelayedTask(double at, int64_t priority, int taskID, Task* task) : at(at), OrderedTask(priority, taskID, task) {}
-		bool operator < (DelayedTask const& rhs) const { return at > rhs.at; } // Ordering is reversed for priority_queue
-	};
-	std::priority_queue<DelayedTask, std::vector<DelayedTask>> timers;
+	// Pending delay()s.  A tick is FLOW_KNOBS->TIMER_WHEEL_RESOLUTION seconds, and a delay expires at the first tick
+	// boundary after its time
+	double timerResolution;
+	TimerWheel timers;
+	int64_t timerTick( double t ) const { return int64_t(t / timerResolution) + 1; }
 
 	void checkForSlowTask(int64_t tscBegin, int64_t tscEnd, double duration, int64_t priority);
 	bool check_yield(int taskId, bool isRunLoop);
 	void processThreadReady();
+	void pushReady( OrderedTask t );
 	void trackMinPriority( int minTaskID, double now );
 	void stopImmediately() {
-		stopped=true; decltype(ready) _1; ready.swap(_1); decltype(timers) _2; timers.swap(_2);
+		stopped=true; decltype(ready) _1; ready.swap(_1); timers.clear();
 	}
 
 	Future<Void> timeOffsetLogger;
@@ -337,7 +362,7 @@ public:
 		boost::system::error_code err;
 		++g_net2->countWrites;
 
-		size_t sent = socket.write_some( boost::iterator_range<SendBufferIterator>(SendBufferIterator(data, limit), SendBufferIterator()), err );
+		size_t sent = writeSome( data, limit, err );
 
 		if (err) {
 			// Since there was an error, sent's value can't be used to infer that the buffer has data and the limit is positive so check explicitly.
@@ -372,6 +397,41 @@ private:
 	tcp::socket socket;
 	NetworkAddress peer_address;
 
+	size_t writeSome( SendBuffer const* data, int limit, boost::system::error_code& err ) {
+#ifdef __linux__
+		// boost::asio gathers at most 64 buffers per send, so go to sendmsg directly to cover as much of the unsent queue as
+		// the kernel will take in one call
+		struct iovec iov[IOV_MAX];
+		int count = 0;
+		for(auto p = data; p && limit > 0 && count < IOV_MAX; p = p->next) {
+			int len = std::min(limit, p->bytes_written - p->bytes_sent);
+			if (!len) continue;
+			iov[count].iov_base = (void*)(p->data + p->bytes_sent);
+			iov[count].iov_len = len;
+			limit -= len;
+			count++;
+		}
+
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+
+		ssize_t sent;
+		do {
+			sent = ::sendmsg( socket.native_handle(), &msg, MSG_NOSIGNAL );
+		} while (sent < 0 && errno == EINTR);
+
+		if (sent < 0) {
+			err = boost::system::error_code( errno, boost::asio::error::get_system_category() );
+			return 0;
+		}
+		return sent;
+#else
+		return socket.write_some( boost::iterator_range<SendBufferIterator>(SendBufferIterator(data, limit), SendBufferIterator()), err );
+#endif
+	}
+
 	struct SendBufferIterator {
 		typedef boost::asio::const_buffer value_type;
 		typedef std::forward_iterator_tag iterator_category;
@@ -475,6 +535,31 @@ struct PromiseTask : public Task, public FastAllocated<PromiseTask> {
 	}
 };
 
+// The state behind the future returned by a nonzero delay().  Like an actor it is its own SAV, so that it is told when every
+// future has been dropped and can take itself out of Net2::timers right away.
+struct DelayedTask : SAV<Void>, Task, TimerWheelNode, FastAllocated<DelayedTask> {
+	using FastAllocated<DelayedTask>::operator new;
+	using FastAllocated<DelayedTask>::operator delete;
+
+	TimerWheel& timers;
+	int64_t priority;
+	int taskID;
+
+	DelayedTask( TimerWheel& timers, int64_t priority, int taskID ) : SAV<Void>(1, 1), timers(timers), priority(priority), taskID(taskID) {}
+
+	virtual void operator()() {
+		sendAndDelPromiseRef(Void());
+	}
+	virtual void cancel() {
+		// Once it has expired it is waiting in Net2::ready, and operator() will destroy it
+		if (isScheduled()) {
+			timers.remove(this);
+			delPromiseRef();
+		}
+	}
+	virtual void destroy() { delete this; }
+};
+
 Net2::Net2(NetworkAddress localAddress, bool useThreadPool, bool useMetrics)
 	: useThreadPool(useThreadPool),
 	  network(this),
@@ -482,6 +567,11 @@ Net2::Net2(NetworkAddress localAddress, bool useThreadPool, bool useMetrics)
 	  tcpResolver(reactor.ios),
 	  stopped(false),
 	  tasksIssued(0),
+	  tasksUntilProfileSample(0),
+	  threadReadyRing(FLOW_KNOBS->THREAD_READY_RING_SIZE),
+	  threadReadyBatchEnd(0),
+	  timerResolution(FLOW_KNOBS->TIMER_WHEEL_RESOLUTION),
+	  timers(int64_t(timer_monotonic() / FLOW_KNOBS->TIMER_WHEEL_RESOLUTION)),
 	  // Until run() is called, yield() will always yield
 	  tsc_begin(0), tsc_end(0), taskBegin(0), currentTaskID(TaskDefaultYield),
 	  lastMinTaskID(0),
@@ -559,6 +649,9 @@ void Net2::run() {
 		// The empty string check is to allow running `FLOW_PROFILER_ENABLED= ./fdbserver` to force disabling flow profiling at startup.
 		startProfiling(this);
 	}
+	startContinuousProfiling();
+	if (FLOW_KNOBS->HEAP_PROFILER_ENABLED)
+		setHeapSampleBytes(FLOW_KNOBS->HEAP_PROFILER_SAMPLE_BYTES);
 
 	// Get the address to the launch function
 	typedef void (*runCycleFuncPtr)();
@@ -579,14 +672,14 @@ void Net2::run() {
 		double sleepTime = 0;
 		bool b = ready.empty();
 		if (b) {
-			b = threadReady.canSleep();
+			b = threadReady.canSleep() && threadReadyRing.canSleep();
 			if (!b) ++countCantSleep;
 		} else
 			++countWontSleep;
 		if (b) {
 			sleepTime = 1e99;
 			if (!timers.empty())
-				sleepTime = timers.top().at - timer_monotonic();  // + 500e-6?
+				sleepTime = timers.nextEventTick() * timerResolution - timer_monotonic();
 		}
 
 		awakeMetric = false;
@@ -602,11 +695,11 @@ void Net2::run() {
 			TraceEvent("SomewhatSlowRunLoopTop").detail("Elapsed", now - nnow);
 
 		if (sleepTime) trackMinPriority( 0, now );
-		while (!timers.empty() && timers.top().at < now) {
+		timers.advance( int64_t(now / timerResolution), [this](TimerWheelNode* n) {
 			++countTimers;
-			ready.push( timers.top() );
-			timers.pop();
-		}
+			DelayedTask* t = static_cast<DelayedTask*>(n);
+			pushReady( OrderedTask( t->priority, t->taskID, t ) );
+		} );
 
 		processThreadReady();
 
@@ -622,8 +715,10 @@ void Net2::run() {
 			priorityMetric = currentTaskID;
 			minTaskID = std::min(minTaskID, currentTaskID);
 			Task* task = ready.top().task;
+			double readyTime = ready.top().readyTime;
 			ready.pop();
 
+			double runBegin = readyTime ? timer_monotonic() : 0;
 			try {
 				(*task)();
 			} catch (Error& e) {
@@ -631,6 +726,8 @@ void Net2::run() {
 			} catch (...) {
 				TraceEvent(SevError, "TaskError").error(unknown_error());
 			}
+			if (readyTime)
+				runLoopProfile.byPriority[currentTaskID].add( runBegin - readyTime, timer_monotonic() - runBegin );
 
 			if (check_yield(TaskMaxPriority, true)) { ++countYields; break; }
 		}
@@ -708,15 +805,46 @@ void Net2::trackMinPriority( int minTaskID, double now ) {
 }
 
 void Net2::processThreadReady() {
+	// A thread switches from threadReadyRing to threadReady at most once, so its tasks in threadReady were submitted
+	// after all of its tasks in threadReadyRing.  Tasks taken from threadReady are therefore held back until the ring
+	// has been drained past every cell claimed before they were taken, so that they are issued after those.
+	bool taken = false;
 	while (true) {
 		Optional<OrderedTask> t = threadReady.pop();
 		if (!t.present()) break;
+		threadReadyBatch.push_back( t.get() );
+		taken = true;
+	}
+	if (taken)
+		threadReadyBatchEnd = threadReadyRing.claimed();
+
+	while (true) {
+		Optional<OrderedTask> t = threadReadyRing.pop();
+		if (!t.present()) break;
 		t.get().priority -= ++tasksIssued;
 		ASSERT( t.get().task != 0 );
-		ready.push( t.get() );
+		pushReady( t.get() );
+	}
+
+	if (threadReadyBatch.size() && threadReadyRing.popped() >= threadReadyBatchEnd) {
+		for(auto& t : threadReadyBatch) {
+			t.priority -= ++tasksIssued;
+			ASSERT( t.task != 0 );
+			pushReady( t );
+		}
+		threadReadyBatch.clear();
 	}
 }
 
+void Net2::pushReady( OrderedTask t ) {
+	// One in every RUN_LOOP_PROFILE_SAMPLE_INTERVAL tasks records when it became ready, so that the run loop can profile it
+	if (FLOW_KNOBS->RUN_LOOP_PROFILE_SAMPLE_INTERVAL > 0 && --tasksUntilProfileSample <= 0) {
+		tasksUntilProfileSample = FLOW_KNOBS->RUN_LOOP_PROFILE_SAMPLE_INTERVAL;
+		t.readyTime = timer_monotonic();
+	}
+	ready.push( t );
+}
+
 void Net2::checkForSlowTask(int64_t tscBegin, int64_t tscEnd, double duration, int64_t priority) {
 	int64_t elapsed = tscEnd-tscBegin;
 	if (elapsed > FLOW_KNOBS->TSC_YIELD_TIME && tscBegin > 0) {
@@ -799,16 +927,15 @@ Future<class Void> Net2::yield( int taskID ) {
 Future<Void> Net2::delay( double seconds, int taskId ) {
 	if (seconds <= 0.) {
 		PromiseTask* t = new PromiseTask;
-		this->ready.push( OrderedTask( (int64_t(taskId)<<32)-(++tasksIssued), taskId, t) );
+		pushReady( OrderedTask( (int64_t(taskId)<<32)-(++tasksIssued), taskId, t) );
 		return t->promise.getFuture();
 	}
 	if (seconds >= 4e12)  // Intervals that overflow an int64_t in microseconds (more than 100,000 years) are treated as infinite
 		return Never();
 
-	double at = now() + seconds;
-	PromiseTask* t = new PromiseTask;
-	this->timers.push( DelayedTask( at, (int64_t(taskId)<<32)-(++tasksIssued), taskId, t ) );
-	return t->promise.getFuture();
+	DelayedTask* t = new DelayedTask( timers, (int64_t(taskId)<<32)-(++tasksIssued), taskId );
+	timers.insert( t, timerTick( now() + seconds ) );
+	return Future<Void>( t );
 }
 
 void Net2::onMainThread(Promise<Void>&& signal, int taskID) {
@@ -818,9 +945,14 @@ void Net2::onMainThread(Promise<Void>&& signal, int taskID) {
 
 	if ( thread_network == this )
 	{
-		this->ready.push( OrderedTask( priority-(++tasksIssued), taskID, p ) );
+		pushReady( OrderedTask( priority-(++tasksIssued), taskID, p ) );
 	} else {
-		if (threadReady.push( OrderedTask( priority, taskID, p ) ))
+		bool wake = false;
+		if (threadReadyRingOverflowed || !threadReadyRing.tryPush( OrderedTask( priority, taskID, p ), wake )) {
+			threadReadyRingOverflowed = true;
+			wake = threadReady.push( OrderedTask( priority, taskID, p ) );
+		}
+		if (wake)
 			reactor.wake();
 	}
 }
@@ -861,8 +993,40 @@ ACTOR static Future<std::vector<NetworkAddress>> resolveTCPEndpoint_impl( Net2 *
 	return addresses;
 }
 
+ACTOR static Future<Void> refreshDNSCacheEntry( Net2::DNSCacheEntry* entry, Net2 *self, std::string host, std::string service ) {
+	try {
+		std::vector<NetworkAddress> addresses = wait( resolveTCPEndpoint_impl(self, host, service) );
+		entry->addresses = addresses;
+		entry->resolved = now();
+	} catch( Error& e ) {
+		if( e.code() == error_code_actor_cancelled )
+			throw;
+		TraceEvent(SevWarn, "DNSLookupFailed").error(e).detail("Host", host).detail("Service", service)
+			.detail("CachedAge", entry->resolved < 0 ? -1.0 : now() - entry->resolved);
+	}
+	return Void();
+}
+
+ACTOR static Future<std::vector<NetworkAddress>> waitForDNSCacheEntry( Net2::DNSCacheEntry* entry ) {
+	Void _ = wait( entry->lookup );
+	if( entry->resolved < 0 || now() - entry->resolved >= FLOW_KNOBS->DNS_CACHE_STALE_TTL )
+		throw lookup_failed();
+	return entry->addresses;
+}
+
+// Lookups are cached, so that reconnecting to the same host (a blob store, say, which gets a new connection for many requests)
+// does not wait on DNS each time.  After DNS_CACHE_TTL a lookup is still used, until DNS_CACHE_STALE_TTL, while a single lookup
+// in the background refreshes it; callers only wait when nothing usable is cached, and then share one lookup between them.
 Future<std::vector<NetworkAddress>> Net2::resolveTCPEndpoint( std::string host, std::string service) {
-	return resolveTCPEndpoint_impl(this, host, service);
+	DNSCacheEntry* entry = &dnsCache[ std::make_pair(host, service) ];
+	double age = entry->resolved < 0 ? std::numeric_limits<double>::max() : now() - entry->resolved;
+	if( age < FLOW_KNOBS->DNS_CACHE_TTL )
+		return entry->addresses;
+	if( entry->lookup.isReady() )
+		entry->lookup = refreshDNSCacheEntry(entry, this, host, service);
+	if( age < FLOW_KNOBS->DNS_CACHE_STALE_TTL )
+		return entry->addresses;
+	return waitForDNSCacheEntry(entry);
 }
 
 bool Net2::isAddressOnThisHost( NetworkAddress const& addr ) {
@@ -98,6 +98,8 @@
 #include <sys/resource.h>
 /* Needed for crash handler */
 #include <signal.h>
+/* Needed for setThreadName */
+#include <sys/prctl.h>
 #endif
 
 #ifdef __APPLE__
@@ -272,6 +274,78 @@ uint64_t getResidentMemoryUsage() {
 #endif
 }
 
+void getThreadTimes(std::map<std::string, ThreadTimes>& groups) {
+#if defined(__linux__)
+	std::string processName;
+	std::ifstream comm_stream("/proc/self/comm", std::ifstream::in);
+	getline(comm_stream, processName);
+
+	DIR* dir = opendir("/proc/self/task");
+	if (!dir)
+		return;
+	while (struct dirent* entry = readdir(dir)) {
+		if (entry->d_name[0] == '.')
+			continue;
+		std::string task = std::string("/proc/self/task/") + entry->d_name;
+
+		// Nanoseconds on a CPU, nanoseconds runnable but waiting for one, and timeslices run.  Kernels without
+		// CONFIG_SCHED_INFO have no schedstat, so fall back on the (tick granularity) user and system times of stat.
+		double cpuSeconds = 0, runQueueSeconds = 0;
+		std::ifstream schedstat_stream(task + "/schedstat", std::ifstream::in);
+		uint64_t runNanos = 0, waitNanos = 0;
+		if (schedstat_stream >> runNanos >> waitNanos) {
+			cpuSeconds = runNanos / 1e9;
+			runQueueSeconds = waitNanos / 1e9;
+		} else {
+			std::ifstream stat_stream(task + "/stat", std::ifstream::in);
+			std::string stat;
+			if (!getline(stat_stream, stat) || stat.rfind(')') == std::string::npos)
+				continue;  // The thread has exited
+			std::istringstream fields(stat.substr(stat.rfind(')') + 1));
+			std::string ignore;
+			uint64_t utime = 0, stime = 0;
+			for (int f = 3; f < 14; f++)
+				fields >> ignore;
+			if (!(fields >> utime >> stime))
+				continue;
+			cpuSeconds = double(utime + stime) / sysconf(_SC_CLK_TCK);
+		}
+
+		std::string name;
+		std::ifstream thread_comm_stream(task + "/comm", std::ifstream::in);
+		getline(thread_comm_stream, name);
+		if (atoi(entry->d_name) == getpid())
+			name = "network";
+		else if (name.size() >= 4 && name.compare(name.size() - 4, 4, "/eio") == 0)
+			name = "eio";
+		else if (name.empty() || name == processName)
+			name = "other";
+
+		ThreadTimes& t = groups[name];
+		t.threads++;
+		t.cpuSeconds += cpuSeconds;
+		t.runQueueSeconds += runQueueSeconds;
+	}
+	closedir(dir);
+#endif
+}
+
+std::string getDeviceName(uint64_t device) {
+#if defined(_WIN32)
+	return format("%llu", (unsigned long long)device);
+#else
+	std::string name = format("%u:%u", (unsigned)major(device), (unsigned)minor(device));
+#if defined(__linux__)
+	std::ifstream uevent_stream("/sys/dev/block/" + name + "/uevent", std::ifstream::in);
+	std::string line;
+	while (getline(uevent_stream, line))
+		if (line.compare(0, 8, "DEVNAME=") == 0)
+			return line.substr(8);
+#endif
+	return name;
+#endif
+}
+
 uint64_t getMemoryUsage() {
 #if defined(__linux__)
 	uint64_t vmsize = 0;
@@ -954,6 +1028,7 @@ struct SystemStatisticsState {
 	double lastClockProcess;
 	uint64_t processLastSent;
 	uint64_t processLastReceived;
+	std::map<std::string, ThreadTimes> lastThreadTimes;
 #if defined(_WIN32)
 	struct {
 		std::string diskDevice;
@@ -1092,6 +1167,20 @@ SystemStatistics getSystemStatistics(std::string dataFolder, uint32_t ip, System
 	returnStats.processMemory = getMemoryUsage();
 	returnStats.processResidentMemory = getResidentMemoryUsage();
 
+	std::map<std::string, ThreadTimes> threadTimes;
+	getThreadTimes(threadTimes);
+	if( returnStats.initialized ) {
+		for(auto& g : threadTimes) {
+			// A group's time goes backwards if some of its threads have exited
+			ThreadTimes const& last = (*statState)->lastThreadTimes[g.first];
+			ThreadTimes& t = returnStats.threadTimes[g.first];
+			t.threads = g.second.threads;
+			t.cpuSeconds = std::max(0.0, g.second.cpuSeconds - last.cpuSeconds);
+			t.runQueueSeconds = std::max(0.0, g.second.runQueueSeconds - last.runQueueSeconds);
+		}
+	}
+	(*statState)->lastThreadTimes = threadTimes;
+
 	MachineRAMInfo memInfo;
 	getMachineRAMInfo(memInfo);
 	returnStats.machineTotalRAM = memInfo.total;
@@ -1361,8 +1450,15 @@ void getLocalTime(const time_t *timep, struct tm *result) {
 #endif
 }
 
+static size_t memoryQuota = 0;
+
+size_t getMemoryQuota() {
+	return memoryQuota;
+}
+
 void setMemoryQuota( size_t limit ) {
 	INJECT_FAULT( platform_error, "setMemoryQuota" );
+	memoryQuota = limit;
 #if defined(_WIN32)
 	HANDLE job = CreateJobObject( NULL, NULL );
 	if (!job) {
@@ -1558,6 +1654,44 @@ void setAffinity(int proc) {
 #endif
 }
 
+std::string getCPUAffinity() {
+#ifdef __linux__
+	cpu_set_t set;
+	if (sched_getaffinity(0, sizeof(set), &set) != 0)
+		return "";
+	std::string s;
+	for (int c = 0; c < CPU_SETSIZE; c++) {
+		if (!CPU_ISSET(c, &set))
+			continue;
+		int last = c;
+		while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set))
+			last++;
+		s += format(s.empty() ? "%d" : ",%d", c);
+		if (last > c)
+			s += format("-%d", last);
+		c = last;
+	}
+	return s;
+#else
+	return "";
+#endif
+}
+
+int getMemoryNUMANode() {
+#ifdef __linux__
+	// MPOL_PREFERRED and MPOL_BIND, from <linux/mempolicy.h>
+	enum { PREFERRED = 1, BIND = 2 };
+	int mode = 0;
+	unsigned long nodemask[4] = {};
+	if (syscall(SYS_get_mempolicy, &mode, nodemask, 8 * sizeof(nodemask) + 1, NULL, 0) != 0 || (mode != PREFERRED && mode != BIND))
+		return -1;
+	for (int n = 0; n < 8 * sizeof(nodemask); n++)
+		if (nodemask[n / (8 * sizeof(unsigned long))] & (1UL << (n % (8 * sizeof(unsigned long)))))
+			return n;
+#endif
+	return -1;
+}
+
 
 namespace platform {
 
@@ -2024,6 +2158,13 @@ void deprioritizeThread() {
 #endif
 }
 
+void setThreadName(const char* name) {
+#ifdef __linux__
+	if (syscall(SYS_gettid) != getpid())
+		prctl(PR_SET_NAME, (unsigned long)name, 0, 0, 0);
+#endif
+}
+
 bool fileExists(std::string const& filename) {
 	FILE* f = fopen(filename.c_str(), "rb");
 	if (!f) return false;
@@ -2289,6 +2430,8 @@ void outOfMemory() {
 	TRACEALLOCATOR(1024);
 	TRACEALLOCATOR(2048);
 	TRACEALLOCATOR(4096);
+	TRACEALLOCATOR(8192);
+	TRACEALLOCATOR(16384);
 	g_traceBatch.dump();
 #endif
 
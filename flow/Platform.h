@@ -161,6 +161,7 @@ inline static T& makeDependent(T& value) { return value; }
 
 #include <string>
 #include <vector>
+#include <map>
 
 #if defined(_WIN32)
 #include <process.h>
@@ -202,10 +203,23 @@ void waitThread(THREAD_HANDLE thread);
 // Linux-only for now.  Set thread priority "low"
 void deprioritizeThread();
 
+// Linux-only for now.  Names the calling thread, which is how getThreadTimes() groups it; at most 15 characters.  Does
+// nothing on the main thread, whose name is the process's.
+void setThreadName(const char* name);
+
 #define DEBUG_DETERMINISM 0
 
 std::string removeWhitespace(const std::string &t);
 
+// The time the threads of a group spent running on a CPU, and runnable but waiting for one
+struct ThreadTimes {
+	int threads;
+	double cpuSeconds;
+	double runQueueSeconds;
+
+	ThreadTimes() : threads(0), cpuSeconds(0), runQueueSeconds(0) {}
+};
+
 struct SystemStatistics {
 	bool initialized;
 	double elapsed;
@@ -230,6 +244,7 @@ struct SystemStatistics {
 	int64_t machineTotalRAM;
 	int64_t machineCommittedRAM;
 	int64_t machineAvailableRAM;
+	std::map<std::string, ThreadTimes> threadTimes;  // Since the last call, by thread group (see getThreadTimes())
 
 	SystemStatistics() : initialized(false), elapsed(0), processCPUSeconds(0), mainThreadCPUSeconds(0), processMemory(0),
 		processResidentMemory(0), processDiskTotalBytes(0), processDiskFreeBytes(0), processDiskQueueDepth(0), processDiskIdleSeconds(0), processDiskRead(0), processDiskWrite(0),
@@ -249,6 +264,15 @@ uint64_t getMemoryUsage();
 
 uint64_t getResidentMemoryUsage();
 
+// Adds up the times of this process's threads since they started, grouped by name: "network" for the main thread, "eio" for
+// the EIO thread pool, "other" for the threads that were never named, and otherwise the name given to setThreadName().
+// Linux-only for now; elsewhere there are no groups.
+void getThreadTimes(std::map<std::string, ThreadTimes>& groups);
+
+// The name of the block device with the given device number (a dev_t), such as "nvme0n1", or "<major>:<minor>" if it
+// can't be found
+std::string getDeviceName(uint64_t device);
+
 struct MachineRAMInfo {
 	int64_t total;
 	int64_t committed;
@@ -273,11 +297,18 @@ uint64_t timer_int(); // Return timer as uint64_t
 void getLocalTime(const time_t *timep, struct tm *result);
 
 void setMemoryQuota(size_t limit);
+size_t getMemoryQuota();  // The limit last set by setMemoryQuota(), or 0 if it has not been called
 
 void *allocate(size_t length, bool allowLargePages);
 
 void setAffinity(int proc);
 
+// The CPUs this process may run on, as a list such as "0-7,16-23", or "" where that isn't known
+std::string getCPUAffinity();
+
+// The NUMA node this process's memory is preferably or only allocated from, or -1 if there is none
+int getMemoryNUMANode();
+
 void threadSleep( double seconds );
 
 void threadYield();  // Attempt to yield to other processes or threads
@@ -393,6 +424,7 @@ inline static int64_t interlockedIncrement64(volatile int64_t *a) { return _Inte
 inline static int32_t interlockedDecrement(volatile int32_t *a) { return _InterlockedDecrement((long*)a); }
 inline static int64_t interlockedDecrement64(volatile int64_t *a) { return _InterlockedDecrement64(a); }
 inline static int32_t interlockedCompareExchange(volatile int32_t *a, int32_t b, int32_t c) { return _InterlockedCompareExchange((long*)a, (long)b, (long)c); }
+inline static int64_t interlockedCompareExchange64(volatile int64_t *a, int64_t b, int64_t c) { return _InterlockedCompareExchange64(a, b, c); }
 inline static int64_t interlockedExchangeAdd64(volatile int64_t *a, int64_t b) { return _InterlockedExchangeAdd64(a, b); }
 inline static int64_t interlockedExchange64(volatile int64_t *a, int64_t b) { return _InterlockedExchange64(a, b); }
 inline static int64_t interlockedOr64(volatile int64_t *a, int64_t b) { return _InterlockedOr64(a, b); }
@@ -403,6 +435,7 @@ inline static int64_t interlockedIncrement64(volatile int64_t *a) { return __syn
 inline static int32_t interlockedDecrement(volatile int32_t *a) { return __sync_add_and_fetch(a, -1); }
 inline static int64_t interlockedDecrement64(volatile int64_t *a) { return __sync_add_and_fetch(a, -1); }
 inline static int32_t interlockedCompareExchange(volatile int32_t *a, int32_t b, int32_t c) { return __sync_val_compare_and_swap(a, c, b); }
+inline static int64_t interlockedCompareExchange64(volatile int64_t *a, int64_t b, int64_t c) { return __sync_val_compare_and_swap(a, c, b); }
 inline static int64_t interlockedExchangeAdd64(volatile int64_t *a, int64_t b) { return __sync_fetch_and_add(a, b); }
 inline static int64_t interlockedExchange64(volatile int64_t *a, int64_t b) {
 	__sync_synchronize();
@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <sys/syscall.h>
 #include <link.h>
+#include <deque>
 
 #include "Platform.h"
 
@@ -251,6 +252,148 @@ struct Profiler {
 
 Profiler* Profiler::active_profiler = 0;
 
+// Samples the network thread's stack every CONTINUOUS_PROFILER_PERIOD microseconds of CPU time for as long as the process
+// runs, and keeps the samples from the last CONTINUOUS_PROFILER_WINDOW seconds aggregated by stack so that they can be
+// dumped at any time.  Stacks are kept as raw addresses and symbolized by whatever reads the dump.
+struct ContinuousProfiler {
+	typedef std::map<std::vector<void*>, int64_t> StackCounts;
+
+	enum { MAX_STACK_DEPTH = 64 };
+
+	void* addresses[MAX_STACK_DEPTH];
+	SignalClosure signalClosure;
+	Profiler::OutputBuffer* output_buffer;
+	sigset_t profilingSignals;
+	timer_t periodic_timer;
+	int period;
+	std::deque<std::pair<double, StackCounts>> intervals;  // Oldest first
+	Future<Void> actor;
+	static ContinuousProfiler* active_profiler;
+
+	explicit ContinuousProfiler(int period) : signalClosure(signal_handler_for_closure, this), period(period) {
+		actor = aggregate(this);
+	}
+
+	void signal_handler() {  // async signal safe!
+		if(profilingEnabled) {
+			size_t n = platform::raw_backtrace(addresses, MAX_STACK_DEPTH);
+			for(int i=0; i<n; i++)
+				output_buffer->push(addresses[i]);
+			output_buffer->push((void*)-1LL);
+		}
+	}
+
+	static void signal_handler_for_closure(int, siginfo_t* si, void*, void* self) {  // async signal safe!
+		((ContinuousProfiler*)self)->signal_handler();
+	}
+
+	void enableSignal(bool enabled) {
+		sigprocmask( enabled?SIG_UNBLOCK:SIG_BLOCK, &profilingSignals, NULL );
+	}
+
+	void addSamples( Profiler::OutputBuffer* samples, StackCounts& counts ) {
+		auto begin = samples->output.begin();
+		for(auto i = begin; i != samples->output.end(); ++i) {
+			if(*i == (void*)-1LL) {
+				++counts[std::vector<void*>(begin, i)];
+				begin = i + 1;
+			}
+		}
+	}
+
+	// Writes the profile in the legacy binary format of gperftools' CPU profiler, which pprof reads directly
+	void dump( std::string const& filename ) {
+		StackCounts counts;
+		for(auto& interval : intervals)
+			for(auto& stack : interval.second)
+				counts[stack.first] += stack.second;
+
+		std::vector<uintptr_t> words = { 0, 3, 0, (uintptr_t)period, 0 };
+		for(auto& stack : counts) {
+			words.push_back(stack.second);
+			words.push_back(stack.first.size());
+			for(void* pc : stack.first)
+				words.push_back((uintptr_t)pc);
+		}
+		words.push_back(0);
+		words.push_back(1);
+		words.push_back(0);
+
+		FILE* f = fopen(filename.c_str(), "wb");
+		if(!f)
+			throw io_error();
+		bool ok = fwrite(&words[0], sizeof(uintptr_t), words.size(), f) == words.size();
+		std::string maps = readFileBytes("/proc/self/maps", 1<<24);
+		ok = ok && fwrite(maps.data(), 1, maps.size(), f) == maps.size();
+		ok = (fclose(f) == 0) && ok;
+		if(!ok)
+			throw io_error();
+
+		TraceEvent("ContinuousProfileDumped").detail("Filename", filename).detail("Stacks", counts.size()).detail("WindowSeconds", FLOW_KNOBS->CONTINUOUS_PROFILER_WINDOW);
+	}
+
+	ACTOR static Future<Void> aggregate(ContinuousProfiler* self) {
+		platform::raw_backtrace(self->addresses, MAX_STACK_DEPTH);
+
+		self->output_buffer = new Profiler::OutputBuffer;
+		state Profiler::OutputBuffer* otherBuffer = new Profiler::OutputBuffer;
+
+		sigemptyset( &self->profilingSignals );
+		sigaddset( &self->profilingSignals, SIGPROF );
+
+		// Any profiler's handler will do, since SignalClosure dispatches each timer's signal to its own closure
+		struct sigaction act;
+		act.sa_sigaction = SignalClosure::signal_handler;
+		sigemptyset(&act.sa_mask);
+		act.sa_flags = SA_SIGINFO;
+		sigaction( SIGPROF, &act, NULL );
+
+		int64_t period_ns = (int64_t)self->period * 1000;
+		itimerspec tv;
+		tv.it_interval.tv_sec = period_ns / 1000000000;
+		tv.it_interval.tv_nsec = period_ns % 1000000000;
+		tv.it_value.tv_sec = 0;
+		tv.it_value.tv_nsec = g_nondeterministic_random->randomInt(1, std::min<int64_t>(period_ns, 999999999) + 1);
+
+		sigevent sev;
+		sev.sigev_notify = SIGEV_THREAD_ID;
+		sev.sigev_signo = SIGPROF;
+		sev.sigev_value.sival_ptr = &(self->signalClosure);
+		sev._sigev_un._tid = gettid();
+		timer_create( CLOCK_THREAD_CPUTIME_ID, &sev, &self->periodic_timer );
+		timer_settime( self->periodic_timer, 0, &tv, NULL );
+
+		loop {
+			Void _ = wait( delay(1.0, TaskMinPriority) || delay(2.0, TaskMaxPriority) );
+
+			self->enableSignal(false);
+			std::swap( self->output_buffer, otherBuffer );
+			self->enableSignal(true);
+
+			double t = now();
+			self->intervals.push_back(std::make_pair(t, StackCounts()));
+			self->addSamples(otherBuffer, self->intervals.back().second);
+			otherBuffer->clear();
+
+			while(self->intervals.front().first < t - FLOW_KNOBS->CONTINUOUS_PROFILER_WINDOW)
+				self->intervals.pop_front();
+		}
+	}
+};
+
+ContinuousProfiler* ContinuousProfiler::active_profiler = 0;
+
+void startContinuousProfiling() {
+	if (!ContinuousProfiler::active_profiler && FLOW_KNOBS->CONTINUOUS_PROFILER_PERIOD > 0 && !g_network->isSimulated())
+		ContinuousProfiler::active_profiler = new ContinuousProfiler( FLOW_KNOBS->CONTINUOUS_PROFILER_PERIOD );
+}
+
+void dumpContinuousProfile(std::string const& filename) {
+	if (!ContinuousProfiler::active_profiler)
+		throw operation_failed();
+	ContinuousProfiler::active_profiler->dump(filename);
+}
+
 std::string findAndReplace( std::string const& fn, std::string const& symbol, std::string const& value ) {
 	auto i = fn.find(symbol);
 	if (i == std::string::npos) return fn;
@@ -290,5 +433,7 @@ void stopProfiling() {
 
 void startProfiling(INetwork* network, Optional<int> period, Optional<StringRef> outputFile) {}
 void stopProfiling() {}
+void startContinuousProfiling() {}
+void dumpContinuousProfile(std::string const& filename) { throw operation_failed(); }
 
 #endif
@@ -29,4 +29,9 @@ class INetwork;
 void startProfiling(INetwork* network, Optional<int> period = {}, Optional<StringRef> outputFile = {});
 void stopProfiling();
 
+// Starts sampling the network thread's stack at a low rate if CONTINUOUS_PROFILER_PERIOD is set, and
+// dumpContinuousProfile() writes the samples from the last CONTINUOUS_PROFILER_WINDOW seconds in pprof's format.
+void startContinuousProfiling();
+void dumpContinuousProfile(std::string const& filename);
+
 #endif  // _FDB_FLOW_PROFILER_H_
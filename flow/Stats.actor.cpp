@@ -61,6 +61,23 @@ void Counter::resetInterval() {
 	last_event = interval_start;  // <FIXME: Is this right?
 }
 
+LatencySample::LatencySample(std::string const& name, CounterCollection& collection)
+: name(name)
+{
+	std::string metricName = collection.name + "." + (char)toupper(name.at(0)) + name.substr(1);
+	medianMetric.init(metricName + "Median", collection.id);
+	p99Metric.init(metricName + "P99", collection.id);
+	maxMetric.init(metricName + "Max", collection.id);
+	collection.latencySamples.push_back(this);
+}
+
+void LatencySample::resetInterval() {
+	medianMetric = int64_t(histogram.median() * 1e6);
+	p99Metric = int64_t(histogram.percentile(0.99) * 1e6);
+	maxMetric = int64_t(histogram.max() * 1e6);
+	histogram.clear();
+}
+
 void Counter::clear() {
 	resetInterval();
 	interval_start_value = 0;
@@ -73,6 +90,8 @@ ACTOR Future<Void> traceCounters(std::string traceEventName, UID traceEventID, d
 
 	for (ICounter* c : counters->counters)
 		c->resetInterval();
+	for (LatencySample* s : counters->latencySamples)
+		s->resetInterval();
 
 	state double last_interval = now();
 
@@ -86,6 +105,10 @@ ACTOR Future<Void> traceCounters(std::string traceEventName, UID traceEventID, d
 				te.detail(c->getName().c_str(), c->getValue());
 			c->resetInterval();
 		}
+		for (LatencySample* s : counters->latencySamples) {
+			te.detail(s->getName().c_str(), s->getHistogram().toString());
+			s->resetInterval();
+		}
 		if (!trackLatestName.empty())
 			te.trackLatest(trackLatestName.c_str());
 
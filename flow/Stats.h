@@ -35,6 +35,7 @@ MyCounters() : foo("foo", cc), bar("bar", cc), baz("baz", cc) {}
 
 #include "flow.h"
 #include "TDMetric.actor.h"
+#include "Histogram.h"
 
 struct ICounter {
 	// All counters have a name and value
@@ -55,6 +56,7 @@ struct ICounter {
 struct CounterCollection {
 	CounterCollection(std::string name, std::string id = std::string()) : name(name), id(id) {}
 	std::vector<struct ICounter*> counters, counters_to_remove;
+	std::vector<struct LatencySample*> latencySamples;
 	~CounterCollection() { for (auto c : counters_to_remove) c->remove(); }
 	std::string name;
 	std::string id;
@@ -87,6 +89,24 @@ private:
 	Int64MetricHandle metric;
 };
 
+// A LatencyHistogram reported along with a CounterCollection.  Each interval traceCounters() logs the whole histogram (see
+// LatencyHistogram::toString()), so that Status can merge it exactly with those of other processes, and publishes its median,
+// p99 and max in microseconds as TDMetrics; then it starts over.
+struct LatencySample : NonCopyable {
+	LatencySample(std::string const& name, CounterCollection& collection);
+
+	void addMeasurement(double seconds, int64_t times = 1) { histogram.record(seconds, times); }
+
+	std::string const& getName() const { return name; }
+	LatencyHistogram const& getHistogram() const { return histogram; }
+	void resetInterval();
+
+private:
+	std::string name;
+	LatencyHistogram histogram;
+	Int64MetricHandle medianMetric, p99Metric, maxMetric;
+};
+
 template <class F>
 struct SpecialCounter : ICounter, FastAllocated<SpecialCounter<F>> {
 	SpecialCounter(CounterCollection& collection, std::string const& name, F && f) : name(name), f(f) { collection.counters.push_back(this); collection.counters_to_remove.push_back(this); }
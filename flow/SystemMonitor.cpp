@@ -38,11 +38,12 @@ void initializeSystemMonitorMachineState(SystemMonitorMachineState machineState)
 
 void systemMonitor() {
 	static StatisticsState statState = StatisticsState();
+	releaseUnusedFastAllocatorMemory( FLOW_KNOBS->FAST_ALLOC_RETAINED_UNUSED_BYTES );
 	customSystemMonitor("ProcessMetrics", &statState, true );
 }
 
 #define TRACEALLOCATOR( size ) TraceEvent("MemSample").detail("Count", FastAllocator<size>::getMemoryUnused()/size).detail("TotalSize", FastAllocator<size>::getMemoryUnused()).detail("SampleCount", 1).detail("Hash", "FastAllocatedUnused" #size ).detail("Bt", "na")
-#define DETAILALLOCATORMEMUSAGE( size ) detail("AllocatedMemory"#size, FastAllocator<size>::getMemoryUsed()).detail("ApproximateUnusedMemory"#size, FastAllocator<size>::getMemoryUnused())
+#define DETAILALLOCATORMEMUSAGE( size ) detail("AllocatedMemory"#size, FastAllocator<size>::getMemoryUsed()).detail("ApproximateUnusedMemory"#size, FastAllocator<size>::getMemoryUnused()).detail("ReleasedMemory"#size, FastAllocator<size>::getMemoryReleased())
 
 SystemStatistics customSystemMonitor(std::string eventName, StatisticsState *statState, bool machineMetrics) {
 	SystemStatistics currentStats = getSystemStatistics(machineState.folder.present() ? machineState.folder.get() : "", 
@@ -81,6 +82,9 @@ SystemStatistics customSystemMonitor(std::string eventName, StatisticsState *sta
 				.detail("CachePageReadsMerged", netData.countFileCachePageReadsMerged - statState->networkState.countFileCachePageReadsMerged)
 				.detail("CacheWrites", netData.countFileCacheWrites - statState->networkState.countFileCacheWrites)
 				.detail("CacheReads", netData.countFileCacheReads - statState->networkState.countFileCacheReads)
+				.detail("CacheHits", netData.countFileCacheHits - statState->networkState.countFileCacheHits)
+				.detail("CacheMisses", netData.countFileCacheMisses - statState->networkState.countFileCacheMisses)
+				.detail("CacheEvictions", netData.countFileCacheEvictions - statState->networkState.countFileCacheEvictions)
 				.detailext("ZoneID", machineState.zoneId)
 				.detailext("MachineID", machineState.machineId)
 				.detail("AIO_SubmitCount", netData.countAIOSubmit - statState->networkState.countAIOSubmit)
@@ -90,8 +94,36 @@ SystemStatistics customSystemMonitor(std::string eventName, StatisticsState *sta
 				.detail("CurrentConnections", netData.countConnEstablished - netData.countConnClosedWithError - netData.countConnClosedWithoutError)
 				.detail("ConnectionsEstablished", (double) (netData.countConnEstablished - statState->networkState.countConnEstablished) / currentStats.elapsed)
 				.detail("ConnectionsClosed", ((netData.countConnClosedWithError - statState->networkState.countConnClosedWithError) + (netData.countConnClosedWithoutError - statState->networkState.countConnClosedWithoutError)) / currentStats.elapsed)
-				.detail("ConnectionErrors", (netData.countConnClosedWithError - statState->networkState.countConnClosedWithError) / currentStats.elapsed)
-				.trackLatest(eventName.c_str());
+				.detail("ConnectionErrors", (netData.countConnClosedWithError - statState->networkState.countConnClosedWithError) / currentStats.elapsed);
+
+			// The times of each group of threads, and the latencies of reads and writes on each device, numbered in the order
+			// of the ThreadGroups and DiskDevices lists
+			std::string threadGroups;
+			int g = 0;
+			for (auto& it : currentStats.threadTimes) {
+				threadGroups += (g ? "," : "") + it.first;
+				e.detail(format("Thread%dCount", g).c_str(), it.second.threads)
+					.detail(format("Thread%dCPUSeconds", g).c_str(), it.second.cpuSeconds)
+					.detail(format("Thread%dRunQueueSeconds", g).c_str(), it.second.runQueueSeconds);
+				g++;
+			}
+			e.detail("ThreadGroups", threadGroups);
+
+			std::string diskDevices;
+			int d = 0;
+			for (auto& it : g_network->diskLatencyProfile.byDevice) {
+				if (!it.second.reads.count() && !it.second.writes.count())
+					continue;
+				diskDevices += (d ? "," : "") + getDeviceName(it.first);
+				e.detail(format("Disk%dReadLatencies", d).c_str(), it.second.reads.toString())
+					.detail(format("Disk%dWriteLatencies", d).c_str(), it.second.writes.toString());
+				it.second.reads.clear();
+				it.second.writes.clear();
+				d++;
+			}
+			e.detail("DiskDevices", diskDevices);
+
+			e.trackLatest(eventName.c_str());
 
 			TraceEvent("MemoryMetrics")
 				.DETAILALLOCATORMEMUSAGE(16)
@@ -102,7 +134,9 @@ SystemStatistics customSystemMonitor(std::string eventName, StatisticsState *sta
 				.DETAILALLOCATORMEMUSAGE(512)
 				.DETAILALLOCATORMEMUSAGE(1024)
 				.DETAILALLOCATORMEMUSAGE(2048)
-				.DETAILALLOCATORMEMUSAGE(4096);
+				.DETAILALLOCATORMEMUSAGE(4096)
+				.DETAILALLOCATORMEMUSAGE(8192)
+				.DETAILALLOCATORMEMUSAGE(16384);
 
 			TraceEvent n("NetworkMetrics");
 			n
@@ -119,11 +153,16 @@ SystemStatistics customSystemMonitor(std::string eventName, StatisticsState *sta
 				.detail("N2_ASIOEventsProcessed", netData.countASIOEvents - statState->networkState.countASIOEvents)
 				.detail("N2_ReadCalls", netData.countReads - statState->networkState.countReads)
 				.detail("N2_WriteCalls", netData.countWrites - statState->networkState.countWrites)
+				.detail("N2_WriteCallsPerMB", netData.bytesSent > statState->networkState.bytesSent ? (netData.countWrites - statState->networkState.countWrites) / ((netData.bytesSent - statState->networkState.bytesSent) / 1e6) : 0.0)
 				.detail("N2_ReadProbes", netData.countReadProbes - statState->networkState.countReadProbes)
 				.detail("N2_WriteProbes", netData.countWriteProbes - statState->networkState.countWriteProbes)
 				.detail("N2_PacketsRead", netData.countPacketsReceived - statState->networkState.countPacketsReceived)
 				.detail("N2_PacketsGenerated", netData.countPacketsGenerated - statState->networkState.countPacketsGenerated)
-				.detail("N2_WouldBlock", netData.countWouldBlock - statState->networkState.countWouldBlock);
+				.detail("N2_WouldBlock", netData.countWouldBlock - statState->networkState.countWouldBlock)
+				.detail("N2_CompressionInputBytes", netData.compressionInputBytes - statState->networkState.compressionInputBytes)
+				.detail("N2_CompressionOutputBytes", netData.compressionOutputBytes - statState->networkState.compressionOutputBytes)
+				.detail("N2_CompressionCPUSeconds", (netData.compressionMicroseconds - statState->networkState.compressionMicroseconds) / 1e6)
+				.detail("N2_DecompressionCPUSeconds", (netData.decompressionMicroseconds - statState->networkState.decompressionMicroseconds) / 1e6);
 
 			for (int i = 0; i<NetworkMetrics::SLOW_EVENT_BINS; i++)
 				if (int c = g_network->networkMetrics.countSlowEvents[i] - statState->networkMetricsState.countSlowEvents[i])
@@ -131,6 +170,28 @@ SystemStatistics customSystemMonitor(std::string eventName, StatisticsState *sta
 			for (int i = 0; i<NetworkMetrics::PRIORITY_BINS; i++)
 				if (double x = g_network->networkMetrics.secSquaredPriorityBlocked[i] - statState->networkMetricsState.secSquaredPriorityBlocked[i])
 					n.detail(format("N2_S2Pri%d", g_network->networkMetrics.priorityBins[i]).c_str(), x);
+
+			RunLoopProfile& profile = g_network->runLoopProfile;
+			if (profile.byPriority.size()) {
+				TraceEvent p("RunLoopProfile");
+				p.detail("Elapsed", currentStats.elapsed);
+				for (auto& it : profile.byPriority) {
+					RunLoopProfile::Stats const& s = it.second;
+					std::string queueHistogram, runHistogram;
+					for (int b = 0; b < RunLoopProfile::HISTOGRAM_BINS; b++) {
+						queueHistogram += format(b ? " %lld" : "%lld", (long long)s.queueHistogram[b]);
+						runHistogram += format(b ? " %lld" : "%lld", (long long)s.runHistogram[b]);
+					}
+					p.detail(format("Pri%d_Samples", it.first).c_str(), s.samples)
+						.detail(format("Pri%d_QueueMean", it.first).c_str(), s.queueSeconds / s.samples)
+						.detail(format("Pri%d_QueueMax", it.first).c_str(), s.maxQueueSeconds)
+						.detail(format("Pri%d_QueueHistogram", it.first).c_str(), queueHistogram)
+						.detail(format("Pri%d_RunMean", it.first).c_str(), s.runSeconds / s.samples)
+						.detail(format("Pri%d_RunMax", it.first).c_str(), s.maxRunSeconds)
+						.detail(format("Pri%d_RunHistogram", it.first).c_str(), runHistogram);
+				}
+				profile.byPriority.clear();
+			}
 		}
 
 		if(machineMetrics) {
@@ -252,6 +313,8 @@ SystemStatistics customSystemMonitor(std::string eventName, StatisticsState *sta
 			TRACEALLOCATOR(1024);
 			TRACEALLOCATOR(2048);
 			TRACEALLOCATOR(4096);
+			TRACEALLOCATOR(8192);
+			TRACEALLOCATOR(16384);
 		}
 	}
 #endif
@@ -73,9 +73,16 @@ struct NetworkData {
 	int64_t countFileCachePageReadsMerged;
 	int64_t countFileCacheFinds;
 	int64_t countFileCacheReadBytes;
+	int64_t countFileCacheHits;
+	int64_t countFileCacheMisses;
+	int64_t countFileCacheEvictions;
 	int64_t countConnEstablished;
 	int64_t countConnClosedWithError;
 	int64_t countConnClosedWithoutError;
+	int64_t compressionInputBytes;
+	int64_t compressionOutputBytes;
+	int64_t compressionMicroseconds;
+	int64_t decompressionMicroseconds;
 
 	void init() {
 		auto getValue = [] (StringRef name) -> int64_t {
@@ -103,6 +110,10 @@ struct NetworkData {
 		countYields = getValue(LiteralStringRef("Net2.CountYields"));
 		countYieldBigStack = getValue(LiteralStringRef("Net2.CountYieldBigStack"));
 		countYieldCalls = getValue(LiteralStringRef("Net2.CountYieldCalls"));
+		compressionInputBytes = getValue(LiteralStringRef("Net2.CompressionInputBytes"));
+		compressionOutputBytes = getValue(LiteralStringRef("Net2.CompressionOutputBytes"));
+		compressionMicroseconds = getValue(LiteralStringRef("Net2.CompressionMicroseconds"));
+		decompressionMicroseconds = getValue(LiteralStringRef("Net2.DecompressionMicroseconds"));
 		countASIOEvents = getValue(LiteralStringRef("Net2.CountASIOEvents"));
 		countYieldCallsTrue = getValue(LiteralStringRef("Net2.CountYieldCallsTrue"));
 		countSlowTaskSignals = getValue(LiteralStringRef("Net2.CountSlowTaskSignals"));
@@ -120,6 +131,9 @@ struct NetworkData {
 		countFileCachePageReadsMerged = getValue(LiteralStringRef("AsyncFile.CountCachePageReadsMerged"));
 		countFileCacheFinds = getValue(LiteralStringRef("AsyncFile.CountCacheFinds"));
 		countFileCacheReadBytes = getValue(LiteralStringRef("AsyncFile.CountCacheReadBytes"));
+		countFileCacheHits = getValue(LiteralStringRef("AsyncFile.CountCacheHits"));
+		countFileCacheMisses = getValue(LiteralStringRef("AsyncFile.CountCacheMisses"));
+		countFileCacheEvictions = getValue(LiteralStringRef("AsyncFile.CountCacheEvictions"));
 	}
 };
 
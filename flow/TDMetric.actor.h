@@ -694,6 +694,10 @@ struct BaseMetric {
 	virtual void flushData(const MetricKeyRef &mk, uint64_t rollTime, MetricUpdateBatch &batch) = 0;
 	virtual void registerFields(const MetricKeyRef &mk, std::vector<Standalone<StringRef>>& fieldKeys) {};
 
+	// Sets value to the metric's current value and returns true if the metric has a single numeric value that can be
+	// exported.  Unlike logging, this works whether or not the metric is enabled.
+	virtual bool getNumericValue(double &value) const { return false; }
+
 	// Set the metric's config.  An assert will fail if the metric is enabled before the metrics collection is available.
 	void setConfig(bool enable, int minLogLevel = 0) {
 		bool wasEnabled = enabled;
@@ -1181,6 +1185,12 @@ struct FieldValueBlockEncoding<TimeAndValue<bool>> {
 	int64_t prev_combined;
 };
 
+inline bool metricNumericValue(int64_t v, double &value) { value = (double)v; return true; }
+inline bool metricNumericValue(double v, double &value) { value = v; return true; }
+inline bool metricNumericValue(bool v, double &value) { value = v ? 1 : 0; return true; }
+template <typename T>
+inline bool metricNumericValue(T const &v, double &value) { return false; }
+
 template <typename T>
 struct ContinuousMetric: NonCopyable, ReferenceCounted<ContinuousMetric<T>>, MetricUtil<ContinuousMetric<T>, T>, BaseMetric {
 	// Needed for MetricUtil
@@ -1204,6 +1214,10 @@ public:
 		return tv.value;
 	}
 
+	bool getNumericValue(double &value) const {
+		return metricNumericValue(tv.value, value);
+	}
+
 	void flushData(const MetricKeyRef &mk, uint64_t rollTime, MetricUpdateBatch &batch) {
 		if( !recorded ) {
 			batch.updates.push_back(std::make_pair(mk.packLatestKey(), getLatestAsValue()));
@@ -121,4 +121,92 @@ public:
 		delete n;
 		return Optional<T>( std::move(data) );
 	}
-};
\ No newline at end of file
+};
+
+// BoundedThreadSafeQueue<T> is a multi-producer, single-consumer queue with a fixed capacity, based
+// on Dmitry Vyukov's bounded MPMC queue.  Its storage is allocated once at construction, so unlike
+// ThreadSafeQueue a push() costs one compare-and-swap and no allocation.  tryPush() fails (and
+// leaves the queue unchanged) when the queue is full, so callers need somewhere else to put overflow.
+
+// As with ThreadSafeQueue, a producer stopped between claiming and publishing a cell makes pop()
+// return Optional<T>() until it makes progress, and canSleep()/push() support event loop integration.
+template <class T>
+class BoundedThreadSafeQueue : NonCopyable {
+	struct Cell {
+		volatile int64_t sequence;
+		T data;
+	};
+
+	Cell* cells;
+	int64_t mask;
+	char pad0[64];
+	volatile int64_t enqueuePos;
+	char pad1[64];
+	int64_t dequeuePos;
+	volatile int64_t sleeping;
+
+public:
+	// capacity is rounded up to a power of two
+	explicit BoundedThreadSafeQueue( int64_t minCapacity ) : enqueuePos(0), dequeuePos(0), sleeping(0) {
+		ASSERT( minCapacity > 0 );
+		int64_t capacity = 1;
+		while (capacity < minCapacity) capacity <<= 1;
+		mask = capacity-1;
+		cells = new Cell[capacity];
+		for(int64_t i = 0; i < capacity; i++)
+			cells[i].sequence = i;
+	}
+	~BoundedThreadSafeQueue() {
+		delete[] cells;
+	}
+
+	// Returns false if the queue is full.  Otherwise sets wake to true if the consumer may be sleeping and should be woken
+	bool tryPush( T const& data, bool& wake ) {
+		int64_t pos = enqueuePos;
+		Cell* cell;
+		while(true) {
+			cell = &cells[pos & mask];
+			int64_t dif = cell->sequence - pos;
+			if (dif == 0) {
+				int64_t prev = interlockedCompareExchange64( &enqueuePos, pos+1, pos );
+				if (prev == pos) break;
+				pos = prev;
+			} else if (dif < 0) {
+				return false;
+			} else {
+				pos = enqueuePos;
+			}
+		}
+		cell->data = data;
+		interlockedExchange64( &cell->sequence, pos+1 );  // Publishes data; a full barrier before the read of sleeping below
+		wake = sleeping && interlockedExchange64( &sleeping, 0 );
+		return true;
+	}
+
+	///////////// The below functions may only be called by a single, consumer thread //////////////////
+
+	// If canSleep returns true, then the queue is empty and the next push() will set wake
+	bool canSleep() {
+		if (enqueuePos != dequeuePos) return false;
+		interlockedExchange64( &sleeping, 1 );
+		if (enqueuePos != dequeuePos) {
+			sleeping = 0;
+			return false;
+		}
+		return true;
+	}
+
+	// The number of cells claimed by producers so far, whether or not they have been published yet
+	int64_t claimed() const { return enqueuePos; }
+	// The number of elements popped so far
+	int64_t popped() const { return dequeuePos; }
+
+	Optional<T> pop() {
+		Cell* cell = &cells[dequeuePos & mask];
+		if (cell->sequence != dequeuePos+1) return Optional<T>();
+		T data = std::move(cell->data);
+		interlockedExchange64( &cell->sequence, dequeuePos+mask+1 );
+		dequeuePos++;
+		return Optional<T>( std::move(data) );
+	}
+};
@@ -0,0 +1,112 @@
+/*
+ * TimerWheel.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "UnitTest.h"
+#include "TimerWheel.h"
+#include <map>
+#include <vector>
+
+struct TimerWheelTestNode : TimerWheelNode {
+	int id;
+};
+
+static int64_t randomTicksAhead() {
+	switch (g_random->randomInt(0, 4)) {
+		case 0: return g_random->randomInt(0, 300);  // The finest level
+		case 1: return g_random->randomInt(0, 1000000);
+		case 2: return int64_t(g_random->randomInt(0, 1<<30)) << 2;
+		default: return int64_t(g_random->randomInt(0, 1<<30)) << 18;  // Mostly in the overflow list
+	}
+}
+
+TEST_CASE("flow/TimerWheel/random") {
+	for (int trial = 0; trial < 20; trial++) {
+		int64_t now = int64_t(g_random->randomInt(0, 1<<30)) << g_random->randomInt(0, 20);
+		TimerWheel w(now);
+		std::vector<TimerWheelTestNode> nodes(1000);
+		std::map<int, int64_t> expected;  // id -> tick
+		for (int i = 0; i < nodes.size(); i++)
+			nodes[i].id = i;
+
+		for (int step = 0; step < 5000; step++) {
+			double r = g_random->random01();
+			TimerWheelTestNode& n = nodes[g_random->randomInt(0, nodes.size())];
+			if (r < 0.5) {
+				if (!n.isScheduled()) {
+					int64_t tick = now + randomTicksAhead();
+					w.insert(&n, tick);
+					expected[n.id] = std::max(tick, w.getCurrentTick() + 1);
+					ASSERT(n.tick == expected[n.id]);
+				}
+			} else if (r < 0.7) {
+				if (n.isScheduled()) {
+					w.remove(&n);
+					expected.erase(n.id);
+				}
+			} else {
+				if (!expected.empty()) {
+					int64_t earliest = std::numeric_limits<int64_t>::max();
+					for (auto& e : expected)
+						earliest = std::min(earliest, e.second);
+					int64_t next = w.nextEventTick();
+					ASSERT(next > w.getCurrentTick() && next <= earliest);
+				}
+				now += randomTicksAhead() >> g_random->randomInt(0, 20);
+				w.advance(now, [&](TimerWheelNode* node) {
+					TimerWheelTestNode* t = static_cast<TimerWheelTestNode*>(node);
+					ASSERT(!t->isScheduled());
+					auto e = expected.find(t->id);
+					ASSERT(e != expected.end() && e->second <= now);
+					expected.erase(e);
+				});
+				for (auto& e : expected)
+					ASSERT(e.second > now);
+				ASSERT(w.size() == expected.size());
+			}
+		}
+
+		w.clear();
+		ASSERT(w.empty());
+		for (auto& n : nodes)
+			ASSERT(!n.isScheduled());
+	}
+	return Void();
+}
+
+TEST_CASE("flow/TimerWheel/changes while expiring") {
+	TimerWheel w(100);
+	TimerWheelTestNode a, b, c;
+	std::vector<TimerWheelNode*> fired;
+	w.insert(&a, 150);
+	w.insert(&b, 5000);
+	w.advance(200, [&](TimerWheelNode* node) {
+		fired.push_back(node);
+		if (node == &a) {
+			w.remove(&b);
+			w.insert(&c, 180);  // In the past of nowTick, but after a, so it expires in this same call
+		}
+	});
+	ASSERT(fired.size() == 2 && fired[0] == &a && fired[1] == &c);
+	ASSERT(w.empty() && w.getCurrentTick() == 200);
+	return Void();
+}
+
+void forceLinkTimerWheelTests() {}
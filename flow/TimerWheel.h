@@ -0,0 +1,237 @@
+/*
+ * TimerWheel.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOW_TIMERWHEEL_H
+#define FLOW_TIMERWHEEL_H
+#pragma once
+
+#include "Platform.h"
+#include "Error.h"
+#include <limits>
+
+// An element of a TimerWheel.  Nodes are intrusive: the wheel never allocates or frees them.
+struct TimerWheelNode {
+	TimerWheelNode *wheelPrev, *wheelNext;  // NULL when not scheduled
+	TimerWheelNode *wheelSlot;  // The head of the list this node is in
+	int64_t tick;
+
+	TimerWheelNode() : wheelPrev(NULL), wheelNext(NULL), wheelSlot(NULL), tick(0) {}
+	bool isScheduled() const { return wheelNext != NULL; }
+};
+
+// A hierarchical timer wheel.  Time is divided into ticks; LEVELS wheels of SLOTS slots each cover ticks at a granularity of
+// SLOTS^level, and as time advances the slot of a coarser level that comes due is cascaded into the finer levels.  Inserting
+// and removing a node are both O(1), so a cancelled timer is gone immediately rather than staying around until it would have
+// expired.  Nodes further in the future than the wheels cover wait in an overflow list, which is rechecked once the coarsest
+// level has come close enough to the earliest of them.
+// A node scheduled for tick t expires when advance() is called with a nowTick >= t, never earlier.
+class TimerWheel {
+public:
+	enum { SLOT_BITS = 8, SLOTS = 1<<SLOT_BITS, LEVELS = 4 };
+
+	explicit TimerWheel( int64_t startTick = 0 ) : overflowMinTick(std::numeric_limits<int64_t>::max()), currentTick(startTick), count(0) {
+		for(int l = 0; l < LEVELS; l++) {
+			for(int s = 0; s < SLOTS; s++)
+				initHead( &slots[l][s] );
+			for(int w = 0; w < SLOTS/64; w++)
+				occupied[l][w] = 0;
+		}
+		initHead( &overflow );
+	}
+
+	int size() const { return count; }
+	bool empty() const { return count == 0; }
+	int64_t getCurrentTick() const { return currentTick; }
+
+	// Schedules node, which must not be scheduled already, to expire at the given tick (or the next one, if that is not
+	// in the future)
+	void insert( TimerWheelNode* node, int64_t tick ) {
+		ASSERT( !node->isScheduled() );
+		node->tick = std::max( tick, currentTick+1 );
+		place( node );
+		++count;
+	}
+
+	void remove( TimerWheelNode* node ) {
+		ASSERT( node->isScheduled() );
+		unlink( node );
+		--count;
+	}
+
+	// Returns the earliest tick at which advance() has work to do: a node expiring or a coarser slot cascading.  Returns
+	// std::numeric_limits<int64_t>::max() if the wheel is empty.
+	int64_t nextEventTick() const {
+		int64_t next = std::numeric_limits<int64_t>::max();
+		if( !count )
+			return next;
+		for(int l = 0; l < LEVELS; l++) {
+			int shift = l*SLOT_BITS;
+			int64_t unit = currentTick>>shift;
+			int d = nextOccupied( l, int((unit+1) & (SLOTS-1)) );
+			if( d >= 0 )
+				next = std::min( next, (unit+1+d)<<shift );
+		}
+		if( overflow.wheelNext != &overflow )
+			next = std::min( next, std::max( overflowCheckTick(), currentTick+1 ) );
+		return next;
+	}
+
+	// Moves time forward to nowTick, calling expired(node) for each node whose tick has been reached.  A node is no longer
+	// scheduled when it is passed to expired(), which may insert or remove other nodes.
+	template <class F>
+	void advance( int64_t nowTick, F const& expired ) {
+		while( count ) {
+			int64_t next = nextEventTick();
+			if( next > nowTick )
+				break;
+			currentTick = next;
+
+			if( overflow.wheelNext != &overflow && overflowCheckTick() <= currentTick )
+				cascade( &overflow );
+
+			for(int l = LEVELS-1; l > 0; l--)
+				cascade( &slots[l][(currentTick>>(l*SLOT_BITS)) & (SLOTS-1)] );
+
+			TimerWheelNode* head = &slots[0][currentTick & (SLOTS-1)];
+			while( head->wheelNext != head ) {
+				TimerWheelNode* n = head->wheelNext;
+				ASSERT( n->tick == currentTick );
+				remove( n );
+				expired( n );
+			}
+		}
+		currentTick = std::max( currentTick, nowTick );
+	}
+
+	// Unschedules every node without expiring it
+	void clear() {
+		for(int l = 0; l < LEVELS; l++)
+			for(int s = 0; s < SLOTS; s++)
+				while( slots[l][s].wheelNext != &slots[l][s] )
+					remove( slots[l][s].wheelNext );
+		while( overflow.wheelNext != &overflow )
+			remove( overflow.wheelNext );
+	}
+
+private:
+	TimerWheelNode slots[LEVELS][SLOTS];  // Circular lists, headed by these sentinels
+	uint64_t occupied[LEVELS][SLOTS/64];
+	TimerWheelNode overflow;
+	int64_t overflowMinTick;  // No greater than the tick of anything in overflow
+	int64_t currentTick;  // Every tick up to and including this one has been processed
+	int count;
+
+	TimerWheel( TimerWheel const& );  // Not copyable: the lists point at their heads
+	void operator=( TimerWheel const& );
+
+	static void initHead( TimerWheelNode* head ) {
+		head->wheelPrev = head->wheelNext = head;
+	}
+
+	void place( TimerWheelNode* node ) {
+		for(int l = 0; l < LEVELS; l++) {
+			int shift = l*SLOT_BITS;
+			if( (node->tick>>shift) - (currentTick>>shift) < SLOTS ) {
+				int s = int((node->tick>>shift) & (SLOTS-1));
+				occupied[l][s/64] |= uint64_t(1)<<(s%64);
+				link( node, &slots[l][s] );
+				return;
+			}
+		}
+		overflowMinTick = std::min( overflowMinTick, node->tick );
+		link( node, &overflow );
+	}
+
+	// The first tick at which the earliest node in overflow might fit in the coarsest level
+	int64_t overflowCheckTick() const {
+		int shift = (LEVELS-1)*SLOT_BITS;
+		return ((overflowMinTick>>shift)-(SLOTS-1)) << shift;
+	}
+
+	static void link( TimerWheelNode* node, TimerWheelNode* head ) {
+		node->wheelSlot = head;
+		node->wheelPrev = head->wheelPrev;
+		node->wheelNext = head;
+		head->wheelPrev->wheelNext = node;
+		head->wheelPrev = node;
+	}
+
+	void unlink( TimerWheelNode* node ) {
+		TimerWheelNode* head = node->wheelSlot;
+		node->wheelPrev->wheelNext = node->wheelNext;
+		node->wheelNext->wheelPrev = node->wheelPrev;
+		node->wheelPrev = node->wheelNext = node->wheelSlot = NULL;
+		if( head->wheelNext == head && head != &overflow ) {
+			int i = int(head - &slots[0][0]);
+			occupied[i/SLOTS][(i%SLOTS)/64] &= ~(uint64_t(1)<<(i%64));
+		}
+	}
+
+	// Reinserts everything in the given slot relative to currentTick, which moves it to a finer level (or, for the
+	// overflow list, possibly back into the overflow list)
+	void cascade( TimerWheelNode* head ) {
+		if( head->wheelNext == head )
+			return;
+		TimerWheelNode list;
+		initHead( &list );
+		// Splice the slot's contents onto a local list first, since a node may be placed back into this same slot
+		list.wheelNext = head->wheelNext;
+		list.wheelPrev = head->wheelPrev;
+		list.wheelNext->wheelPrev = &list;
+		list.wheelPrev->wheelNext = &list;
+		initHead( head );
+		if( head != &overflow ) {
+			int i = int(head - &slots[0][0]);
+			occupied[i/SLOTS][(i%SLOTS)/64] &= ~(uint64_t(1)<<(i%64));
+		} else
+			overflowMinTick = std::numeric_limits<int64_t>::max();
+		while( list.wheelNext != &list ) {
+			TimerWheelNode* n = list.wheelNext;
+			list.wheelNext = n->wheelNext;
+			n->wheelNext->wheelPrev = &list;
+			place( n );
+		}
+	}
+
+	// Returns how many slots after `from` (circularly) the first occupied slot of the level is, or -1 if the level is empty
+	int nextOccupied( int level, int from ) const {
+		for(int i = 0; i <= SLOTS/64; i++) {
+			int w = (from/64 + i) % (SLOTS/64);
+			uint64_t bits = occupied[level][w];
+			if( i == 0 )
+				bits &= ~uint64_t(0) << (from%64);
+			else if( i == SLOTS/64 )
+				bits &= (uint64_t(1) << (from%64)) - 1;
+			if( bits ) {
+				int s = w*64 + ctz64( bits );
+				return (s - from + SLOTS) % SLOTS;
+			}
+		}
+		return -1;
+	}
+
+	static int ctz64( uint64_t x ) {
+		int n = 0;
+		while( !(x & 1) ) { x >>= 1; ++n; }
+		return n;
+	}
+};
+
+#endif
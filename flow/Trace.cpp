@@ -58,6 +58,107 @@
 #define TRACEFILE_MODE _S_IWRITE
 #endif
 
+// A TraceEvent records its header and details in this compact binary form, and they are not formatted as XML until the
+// writer thread writes them out.  Each record starts with TRACE_RECORD_MARKER, which tells it apart from the
+// preformatted XML that is also written to the log, followed by the severity, time, machine address and type.  Each
+// detail is then a field type byte, a length-prefixed key and a value encoded as per its type.
+enum TraceFieldType : uint8_t { TRACE_FIELD_STRING, TRACE_FIELD_INT64, TRACE_FIELD_UINT64, TRACE_FIELD_DOUBLE };
+static const uint8_t TRACE_RECORD_MARKER = 0;
+
+static void appendEscaped( std::string& out, const char* data, int length ) {
+	const char* end = data + length;
+	while (data != end) {
+		if (*data == '&') {
+			out.append( "&amp;", 5 );
+			data++;
+		} else if (*data == '"') {
+			out.append( "&quot;", 6 );
+			data++;
+		} else if (*data == '<') {
+			out.append( "&lt;", 4 );
+			data++;
+		} else if (*data == '>') {
+			out.append( "&gt;", 4 );
+			data++;
+		} else {
+			const char* e = data;
+			while (e != end && *e != '"' && *e != '&' && *e != '<' && *e != '>') e++;
+			out.append( data, e-data );
+			data = e;
+		}
+	}
+}
+
+// Appends the XML for a record without the closing "/>", so that the caller can add attributes of its own
+static void formatTraceRecord( const uint8_t* record, int length, std::string& out ) {
+	ASSERT( length > 0 && record[0] == TRACE_RECORD_MARKER );
+	const uint8_t* p = record + 1;
+	const uint8_t* end = record + length;
+	auto read = [&p](void* to, int n) { memcpy(to, p, n); p += n; };
+
+	int32_t severity;
+	double time;
+	uint32_t ip;
+	uint16_t port, typeLength;
+	read(&severity, sizeof(severity));
+	read(&time, sizeof(time));
+	read(&ip, sizeof(ip));
+	read(&port, sizeof(port));
+	read(&typeLength, sizeof(typeLength));
+
+	char temp[128];
+	snprintf( temp, sizeof(temp), "<Event Severity=\"%d\" Time=\"%.6f\" Type=\"", (int)severity, time );
+	out += temp;
+	out.append( (const char*)p, typeLength );
+	p += typeLength;
+	snprintf( temp, sizeof(temp), "\" Machine=\"%d.%d.%d.%d:%d\"", (ip>>24)&0xff, (ip>>16)&0xff, (ip>>8)&0xff, ip&0xff, (int)port );
+	out += temp;
+
+	while (p < end) {
+		uint8_t fieldType = *p++;
+		uint16_t keyLength;
+		read(&keyLength, sizeof(keyLength));
+		out += ' ';
+		out.append( (const char*)p, keyLength );
+		p += keyLength;
+		out += "=\"";
+
+		switch (fieldType) {
+			case TRACE_FIELD_STRING: {
+				uint16_t valueLength;
+				read(&valueLength, sizeof(valueLength));
+				appendEscaped( out, (const char*)p, valueLength );
+				p += valueLength;
+				break;
+			}
+			case TRACE_FIELD_INT64: {
+				int64_t value;
+				read(&value, sizeof(value));
+				snprintf( temp, sizeof(temp), "%lld", (long long)value );
+				out += temp;
+				break;
+			}
+			case TRACE_FIELD_UINT64: {
+				uint64_t value;
+				read(&value, sizeof(value));
+				snprintf( temp, sizeof(temp), "%llu", (unsigned long long)value );
+				out += temp;
+				break;
+			}
+			case TRACE_FIELD_DOUBLE: {
+				double value;
+				read(&value, sizeof(value));
+				snprintf( temp, sizeof(temp), "%g", value );
+				out += temp;
+				break;
+			}
+			default:
+				ASSERT(false);
+		}
+		out += '"';
+	}
+}
+
 class DummyThreadPool : public IThreadPool, ReferenceCounted<DummyThreadPool> {
 public:
 	~DummyThreadPool() {}
@@ -124,6 +225,100 @@ struct SuppressionMap {
 	}
 };
 
+// Per event type rate limits and sampling, which unlike suppressFor() are configured centrally and can be changed at any
+// time.  Events that are dropped are counted and the counts are reported every TRACE_RATE_LIMIT_REPORT_INTERVAL.
+struct TraceRateLimits {
+	struct Limit {
+		double eventsPerSecond;
+		double sampleRate;
+		double budget;
+		double lastTime;
+		int64_t limitedEventCount;
+		int64_t unsampledEventCount;
+
+		Limit() : eventsPerSecond(0), sampleRate(1), budget(0), lastTime(0), limitedEventCount(0), unsampledEventCount(0) {}
+	};
+
+	Mutex mutex;
+	std::map<std::string, Limit> limits;
+	bool anyLimits;
+	double lastReport;
+
+	TraceRateLimits() : anyLimits(false), lastReport(0) {}
+
+	void set(std::string const& type, double eventsPerSecond, double sampleRate) {
+		MutexHolder hold(mutex);
+		Limit &limit = limits[type];
+		limit.eventsPerSecond = eventsPerSecond;
+		limit.sampleRate = std::max(0.0, std::min(sampleRate, 1.0));
+		limit.budget = std::max(eventsPerSecond, 1.0);
+		anyLimits = true;
+	}
+
+	void clear() {
+		MutexHolder hold(mutex);
+		limits.clear();
+		anyLimits = false;
+	}
+
+	// Returns false if this event should be dropped
+	bool allow(const char* type, double t) {
+		if(!anyLimits)
+			return true;
+
+		MutexHolder hold(mutex);
+		auto it = limits.find(type);
+		if(it == limits.end())
+			return true;
+
+		Limit &limit = it->second;
+		if(limit.eventsPerSecond > 0) {
+			limit.budget = std::min(limit.budget + (t - limit.lastTime) * limit.eventsPerSecond, std::max(limit.eventsPerSecond, 1.0));
+			limit.lastTime = t;
+			if(limit.budget < 1) {
+				++limit.limitedEventCount;
+				return false;
+			}
+			limit.budget -= 1;
+		}
+		if(limit.sampleRate < 1 && TraceEvent::isNetworkThread() && trace_random && trace_random->random01() >= limit.sampleRate) {
+			++limit.unsampledEventCount;
+			return false;
+		}
+		return true;
+	}
+
+	// Events must be logged outside the lock, since logging them checks the limits again
+	void report(double t) {
+		if(!anyLimits || t - lastReport < FLOW_KNOBS->TRACE_RATE_LIMIT_REPORT_INTERVAL)
+			return;
+		lastReport = t;
+
+		std::vector<std::pair<std::string, Limit>> dropped;
+		{
+			MutexHolder hold(mutex);
+			for(auto &it : limits) {
+				if(it.second.limitedEventCount || it.second.unsampledEventCount) {
+					dropped.push_back(it);
+					it.second.limitedEventCount = 0;
+					it.second.unsampledEventCount = 0;
+				}
+			}
+		}
+
+		for(auto &it : dropped) {
+			TraceEvent("TraceEventsDropped")
+				.detail("DroppedType", it.first)
+				.detail("EventsPerSecond", it.second.eventsPerSecond)
+				.detail("SampleRate", it.second.sampleRate)
+				.detail("RateLimited", it.second.limitedEventCount)
+				.detail("NotSampled", it.second.unsampledEventCount);
+		}
+	}
+};
+
+TraceRateLimits traceRateLimits;
+
 TraceBatch g_traceBatch;
 trace_clock_t g_trace_clock = TRACE_CLOCK_NOW;
 std::set<StringRef> suppress;
@@ -296,8 +491,21 @@ struct TraceLog {
 		};
 		void action( WriteBuffer& a ) {
 			if ( traceFileFD ) {
-				for ( auto i = a.buffer.begin(); i != a.buffer.end(); ++i )
-					writeReliable( i->begin(), i->size() );
+				std::string out;
+				for ( auto i = a.buffer.begin(); i != a.buffer.end(); ++i ) {
+					if ( i->size() && (*i)[0] == TRACE_RECORD_MARKER ) {
+						formatTraceRecord( i->begin(), i->size(), out );
+						out += "/>\r\n";
+					}
+					else
+						out.append( (const char*)i->begin(), i->size() );
+
+					if ( out.size() >= 1<<16 ) {
+						writeReliable( (const uint8_t*)out.data(), out.size() );
+						out.clear();
+					}
+				}
+				writeReliable( (const uint8_t*)out.data(), out.size() );
 
 				if(FLOW_KNOBS->TRACE_FSYNC_ENABLED) {
 					__fsync( traceFileFD );
@@ -556,9 +764,41 @@ static TraceLog g_traceLog;
 ThreadFuture<Void> flushTraceFile() {
 	if (!g_traceLog.isOpen())
 		return Void();
+	if (TraceEvent::isNetworkThread())
+		traceRateLimits.report(now());
 	return g_traceLog.flush();
 }
 
+void setTraceEventRateLimit(std::string const& type, double eventsPerSecond, double sampleRate) {
+	traceRateLimits.set(type, eventsPerSecond, sampleRate);
+}
+
+void setTraceEventRateLimits(std::string const& spec) {
+	std::vector<std::tuple<std::string, double, double>> limits;
+	for (size_t begin = 0; begin <= spec.size(); ) {
+		size_t end = std::min(spec.find(',', begin), spec.size());
+		std::string item = spec.substr(begin, end - begin);
+		begin = end + 1;
+		if (item.empty())
+			continue;
+
+		size_t colon = item.find(':');
+		if (colon == 0 || colon == item.npos)
+			throw invalid_option_value();
+
+		double eventsPerSecond, sampleRate = 1.0;
+		char extra;
+		int n = sscanf(item.c_str() + colon + 1, "%lf:%lf%c", &eventsPerSecond, &sampleRate, &extra);
+		if (n != 1 && n != 2)
+			throw invalid_option_value();
+		limits.push_back(std::make_tuple(item.substr(0, colon), eventsPerSecond, sampleRate));
+	}
+
+	traceRateLimits.clear();
+	for (auto &limit : limits)
+		traceRateLimits.set(std::get<0>(limit), std::get<1>(limit), std::get<2>(limit));
+}
+
 void flushTraceFileVoid() {
 	if ( g_network && g_network->isSimulated() )
 		flushTraceFile();
@@ -678,14 +918,22 @@ bool TraceEvent::init( Severity severity, const char* type ) {
 	tmpEventMetric->setField("Severity", (int64_t)severity);
 
 	length = 0;
-	if (isEnabled(type, severity)) {
+	if (isEnabled(type, severity) && (severity >= SevError || traceRateLimits.allow(type, now()))) {
 		enabled = true;
 		buffer[sizeof(buffer)-1]=0;
 		NetworkAddress local = g_network->isSimulated() ? g_network->getLocalAddress() : g_traceLog.localAddress;
 		double time = g_trace_clock == TRACE_CLOCK_NOW ? now() : timer();
-		writef( "<Event Severity=\"%d\" Time=\"%.6f\" Type=\"%s\" Machine=\"%d.%d.%d.%d:%d\"",
-			(int)severity, time, type,
-			(local.ip>>24)&0xff,(local.ip>>16)&0xff,(local.ip>>8)&0xff,local.ip&0xff,local.port );
+		int32_t sev = severity;
+		uint32_t ip = local.ip;
+		uint16_t port = local.port;
+		uint16_t typeLength = strlen(type);
+		write( sizeof(TRACE_RECORD_MARKER), &TRACE_RECORD_MARKER );
+		write( sizeof(sev), &sev );
+		write( sizeof(time), &time );
+		write( sizeof(ip), &ip );
+		write( sizeof(port), &port );
+		write( sizeof(typeLength), &typeLength );
+		write( typeLength, type );
 	} else
 		enabled = false;
 
@@ -718,10 +966,9 @@ TraceEvent& TraceEvent::detail( const char* key, const char* value ) {
 			strcpy( &replacement[495], "\\..." );
 			value = replacement;
 		}
-		writef( " %s=\"", key );
-		writeEscaped( value );
-		writef( "\"" );
-		tmpEventMetric->setField(key, Standalone<StringRef>(StringRef((const uint8_t *)value, strlen(value))));
+		int valueLength = strlen(value);
+		writeField( TRACE_FIELD_STRING, key, value, valueLength );
+		tmpEventMetric->setField(key, Standalone<StringRef>(StringRef((const uint8_t *)value, valueLength)));
 	}
 	return *this;
 }
@@ -729,39 +976,60 @@ TraceEvent& TraceEvent::detail( const char* key, const std::string& value ) {
 	return detail( key, value.c_str() );
 }
 TraceEvent& TraceEvent::detail( const char* key, double value ) {
-	if(enabled)
+	if (enabled) {
 		tmpEventMetric->setField(key, value);
-	return _detailf( key, "%g", value );
+		double v = value;
+		writeField( TRACE_FIELD_DOUBLE, key, &v, sizeof(v) );
+	}
+	return *this;
 }
 TraceEvent& TraceEvent::detail( const char* key, int value ) {
-	if(enabled)
+	if (enabled) {
 		tmpEventMetric->setField(key, (int64_t)value);
-	return _detailf( key, "%d", value );
+		int64_t v = value;
+		writeField( TRACE_FIELD_INT64, key, &v, sizeof(v) );
+	}
+	return *this;
 }
 TraceEvent& TraceEvent::detail( const char* key, unsigned value ) {
-	if(enabled)
+	if (enabled) {
 		tmpEventMetric->setField(key, (int64_t)value);
-	return _detailf( key, "%u", value );
+		uint64_t v = value;
+		writeField( TRACE_FIELD_UINT64, key, &v, sizeof(v) );
+	}
+	return *this;
 }
 TraceEvent& TraceEvent::detail( const char* key, long int value ) {
-	if(enabled)
+	if (enabled) {
 		tmpEventMetric->setField(key, (int64_t)value);
-	return _detailf( key, "%ld", value );
+		int64_t v = value;
+		writeField( TRACE_FIELD_INT64, key, &v, sizeof(v) );
+	}
+	return *this;
 }
 TraceEvent& TraceEvent::detail( const char* key, long unsigned int value ) {
-	if(enabled)
+	if (enabled) {
 		tmpEventMetric->setField(key, (int64_t)value);
-	return _detailf( key, "%lu", value );
+		uint64_t v = value;
+		writeField( TRACE_FIELD_UINT64, key, &v, sizeof(v) );
+	}
+	return *this;
 }
 TraceEvent& TraceEvent::detail( const char* key, long long int value ) {
-	if(enabled)
+	if (enabled) {
 		tmpEventMetric->setField(key, (int64_t)value);
-	return _detailf( key, "%lld", value );
+		int64_t v = value;
+		writeField( TRACE_FIELD_INT64, key, &v, sizeof(v) );
+	}
+	return *this;
 }
 TraceEvent& TraceEvent::detail( const char* key, long long unsigned int value ) {
-	if(enabled)
+	if (enabled) {
 		tmpEventMetric->setField(key, (int64_t)value);
-	return _detailf( key, "%llu", value );
+		uint64_t v = value;
+		writeField( TRACE_FIELD_UINT64, key, &v, sizeof(v) );
+	}
+	return *this;
 }
 TraceEvent& TraceEvent::detail( const char* key, NetworkAddress const& value ) {
 	return detail( key, value.toString() );
@@ -795,21 +1063,15 @@ TraceEvent& TraceEvent::_detailf( const char* key, const char* valueFormat, ...
 }
 TraceEvent& TraceEvent::detailfv( const char* key, const char* valueFormat, va_list args, bool writeEventMetricField ) {
 	if (enabled) {
-		writef( " %s=\"", key );
-		va_list args2;
-		va_copy(args2, args);
-		writeEscapedfv( valueFormat, args );
-		writef( "\"" );
+		char temp[ 1024 ];
+		int n = vsnprintf(temp, sizeof(temp)-1, valueFormat, args);
+		if(n < 0)
+			n = 0;
+		else if(n > sizeof(temp) - 2)
+			n = sizeof(temp) - 2;
+		writeField( TRACE_FIELD_STRING, key, temp, n );
 		if(writeEventMetricField)
-		{
-			// TODO: It would be better to make use of the formatted string created in writeEscapedfv above
-			char temp[ 1024 ];
-			size_t n = vsnprintf(temp, sizeof(temp)-1, valueFormat, args2);
-			if(n > sizeof(temp) - 1)
-				n = sizeof(temp) - 1;
-			temp[n] = 0;
 			tmpEventMetric->setField(key, Standalone<StringRef>(StringRef((uint8_t *)temp, n)));
-		}
 	}
 	return *this;
 }
@@ -890,14 +1152,14 @@ TraceEvent::~TraceEvent() {
 				}
 			} // End of Throttler
 
-			_detailf("logGroup", "%.*s", g_traceLog.logGroup.size(), g_traceLog.logGroup.data());
+			writeField( TRACE_FIELD_STRING, "logGroup", g_traceLog.logGroup.data(), g_traceLog.logGroup.size() );
 			if (!trackingKey.empty()) {
 				if(!isNetworkThread()) {
 					TraceEvent(SevError, "TrackLatestFromNonNetworkThread");
 					detail("__InvalidTrackLatest__", ""); // Choosing a detail name that is unlikely to collide with other names
 				}
 				else {
-					latestEventCache.set( trackingKey, std::string(buffer, length) + " TrackLatestType=\"Rolled\"/>\r\n" );
+					latestEventCache.set( trackingKey, formatXML() + " TrackLatestType=\"Rolled\"/>\r\n" );
 				}
 
 				detail("TrackLatestType", "Original");
@@ -909,7 +1171,6 @@ TraceEvent::~TraceEvent() {
 				severity = SevError;
 			}
 			if (g_traceLog.isOpen()) {
-				writef("/>\r\n");
 				g_traceLog.write( buffer, length );
 				TraceEvent::eventCounts[severity/10]++;
 
@@ -925,7 +1186,7 @@ TraceEvent::~TraceEvent() {
 				}
 			}
 			if (severity > SevWarnAlways) {
-				latestEventCache.setLatestError( std::string(buffer, length) + " latestError=\"1\"/>\r\n" );
+				latestEventCache.setLatestError( formatXML() + " latestError=\"1\"/>\r\n" );
 			}
 		}
 	} catch( Error &e ) {
@@ -938,8 +1199,8 @@ TraceEvent::~TraceEvent() {
 
 void TraceEvent::write( int length, const void* bytes ) {
 	if (!(this->length + length <= sizeof(buffer))) {
-		buffer[300] = 0;
-		TraceEvent(SevError, "TraceEventOverflow").detail("TraceFirstBytes", buffer);
+		std::string firstBytes = formatXML().substr(0, 300);
+		TraceEvent(SevError, "TraceEventOverflow").detail("TraceFirstBytes", firstBytes);
 		enabled = false;
 	} else {
 		memcpy( buffer + this->length, bytes, length );
@@ -947,49 +1208,29 @@ void TraceEvent::write( int length, const void* bytes ) {
 	}
 }
 
-void TraceEvent::writef( const char* format, ... ) {
-	va_list args;
-	va_start( args, format );
-	int size = sizeof(buffer)-1-length;
-	int i = size<0 ? -1 : vsnprintf( buffer + length, size, format, args );
-	if( i < 0 || i >= size ) {  // first block catches truncations on windows, second on linux
-		buffer[300] = 0;
-		TraceEvent(SevError, "TraceEventOverflow").detail("TraceFirstBytes", buffer);
-		enabled = false;
-	} else {
-		length += i;
+void TraceEvent::writeField( uint8_t fieldType, const char* key, const void* value, int valueLength ) {
+	uint16_t keyLength = strlen(key);
+	int fieldLength = 1 + sizeof(keyLength) + keyLength + (fieldType == TRACE_FIELD_STRING ? sizeof(uint16_t) : 0) + valueLength;
+	if (!(this->length + fieldLength <= sizeof(buffer))) {
+		write( fieldLength, NULL ); // Reports the overflow
+		return;
 	}
-	va_end(args);
-}
 
-void TraceEvent::writeEscaped( const char* data ) {
-	while (*data) {
-		if (*data == '&') {
-			write( 5, "&amp;" );
-			data++;
-		} else if (*data == '"') {
-			write( 6, "&quot;" );
-			data++;
-		} else if (*data == '<') {
-			write( 4, "&lt;" );
-			data++;
-		} else if (*data == '>') {
-			write( 4, "&gt;" );
-			data++;
-		} else {
-			const char* e = data;
-			while (*e && *e != '"' && *e != '&' && *e != '<' && *e != '>') e++;
-			write( e-data, data );
-			data = e;
-		}
+	buffer[this->length++] = fieldType;
+	write( sizeof(keyLength), &keyLength );
+	write( keyLength, key );
+	if (fieldType == TRACE_FIELD_STRING) {
+		uint16_t n = valueLength;
+		write( sizeof(n), &n );
 	}
+	write( valueLength, value );
 }
 
-void TraceEvent::writeEscapedfv( const char* format, va_list args ) {
-	char temp[ 1024 ];
-	vsnprintf(temp, sizeof(temp)-1, format, args);
-	temp[sizeof(temp)-1] = 0;
-	writeEscaped( temp );
+std::string TraceEvent::formatXML() const {
+	std::string xml;
+	if (length)
+		formatTraceRecord( (const uint8_t*)buffer, length, xml );
+	return xml;
 }
 
 thread_local bool TraceEvent::networkThread = false;
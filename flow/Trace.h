@@ -164,9 +164,8 @@ private:
 	bool init( Severity, struct TraceInterval& );
 
 	void write( int length, const void* data );
-	void writef( const char* format, ... );
-	void writeEscaped( const char* data );
-	void writeEscapedfv( const char* format, va_list args );
+	void writeField( uint8_t fieldType, const char* key, const void* value, int valueLength );
+	std::string formatXML() const;
 };
 #else
 struct TraceEvent {
@@ -245,6 +244,13 @@ void initTraceEventMetrics();
 void closeTraceFile();
 bool traceFileIsOpen();
 
+// Limits events of the given type to eventsPerSecond, or only samples them if eventsPerSecond is not positive, and keeps
+// each remaining event with probability sampleRate.  Events at SevError and above are never dropped.  The number of
+// events dropped is logged periodically.  These may be changed at any time and from any thread.
+void setTraceEventRateLimit(std::string const& type, double eventsPerSecond, double sampleRate = 1.0);
+// Replaces all limits with those in spec, a comma separated list of Type:eventsPerSecond[:sampleRate]
+void setTraceEventRateLimits(std::string const& spec);
+
 enum trace_clock_t { TRACE_CLOCK_NOW, TRACE_CLOCK_REALTIME };
 extern trace_clock_t g_trace_clock;
 extern TraceBatch g_traceBatch;
@@ -23,9 +23,11 @@
 #pragma once
 
 #include <string>
+#include <map>
 #include <stdint.h>
 #include "serialize.h"
 #include "IRandom.h"
+#include "Histogram.h"
 
 enum {
 	TaskMaxPriority = 1000000,
@@ -62,6 +64,7 @@ enum {
 	TaskDefaultYield = 7000,
 	TaskDiskRead = 5010,
 	TaskDefaultEndpoint = 5000,
+	TaskLowPriorityRead = 4500,
 	TaskUnknownEndpoint = 4000,
 	TaskMoveKeys = 3550,
 	TaskDataDistributionLaunch = 3530,
@@ -130,6 +133,59 @@ struct NetworkMetrics {
 	NetworkMetrics() { memset(this, 0, sizeof(*this)); }
 };
 
+// Queueing delay (from becoming ready to starting to run) and run time of a sample of the run loop's tasks, by task priority
+struct RunLoopProfile {
+	enum { HISTOGRAM_BINS = 7 };  // Decades from 10us: <10us, <100us, <1ms, <10ms, <100ms, <1s, and the rest
+
+	struct Stats {
+		int64_t samples;
+		double queueSeconds, maxQueueSeconds;
+		double runSeconds, maxRunSeconds;
+		int64_t queueHistogram[HISTOGRAM_BINS];
+		int64_t runHistogram[HISTOGRAM_BINS];
+
+		Stats() { memset(this, 0, sizeof(*this)); }
+
+		static int bin( double seconds ) {
+			int b = 0;
+			for(double limit = 10e-6; b < HISTOGRAM_BINS-1 && seconds >= limit; limit *= 10)
+				b++;
+			return b;
+		}
+		void add( double queue, double run ) {
+			samples++;
+			queueSeconds += queue;
+			maxQueueSeconds = std::max(maxQueueSeconds, queue);
+			runSeconds += run;
+			maxRunSeconds = std::max(maxRunSeconds, run);
+			queueHistogram[bin(queue)]++;
+			runHistogram[bin(run)]++;
+		}
+	};
+
+	std::map<int, Stats> byPriority;
+};
+
+// Latencies, from submission to completion, of the reads and writes of AsyncFileKAIO and AsyncFileEIO files, by the device
+// (a dev_t) the file is on.  Recorded and read only on the network thread.
+struct DiskLatencyProfile {
+	struct Latencies {
+		LatencyHistogram reads, writes;
+	};
+
+	std::map<uint64_t, Latencies> byDevice;  // Entries are never removed, so files may keep pointers to them
+	LatencyHistogram recent;  // Of every device, since the worker last reported its disk health to the cluster controller
+	int64_t bytesRead, bytesWritten;  // Of every device, since the process started
+
+	DiskLatencyProfile() : bytesRead(0), bytesWritten(0) {}
+
+	void record( Latencies* device, bool write, double seconds, int64_t times = 1, int64_t bytes = 0 ) {
+		(write ? device->writes : device->reads).record( seconds, times );
+		recent.record( seconds, times );
+		(write ? bytesWritten : bytesRead) += bytes;
+	}
+};
+
 class IEventFD : public ReferenceCounted<IEventFD> {
 public:
 	virtual ~IEventFD() {}
@@ -198,7 +254,8 @@ public:
 
 	enum enumGlobal {
 		enFailureMonitor = 0, enFlowTransport = 1, enTDMetrics = 2, enNetworkConnections = 3,
-		enNetworkAddressFunc = 4, enFileSystem = 5, enASIOService = 6, enEventFD = 7, enRunCycleFunc = 8, enASIOTimedOut = 9, enBlobCredentialFiles = 10
+		enNetworkAddressFunc = 4, enFileSystem = 5, enASIOService = 6, enEventFD = 7, enRunCycleFunc = 8, enASIOTimedOut = 9, enBlobCredentialFiles = 10,
+		enTxnStateSnapshot = 11
 	};
 
 	virtual void longTaskCheck( const char* name ) {}
@@ -257,6 +314,8 @@ public:
 	}
 
 	NetworkMetrics networkMetrics;
+	RunLoopProfile runLoopProfile;  // Filled in by Net2 when FLOW_KNOBS->RUN_LOOP_PROFILE_SAMPLE_INTERVAL > 0; cleared by the system monitor each time it is logged
+	DiskLatencyProfile diskLatencyProfile;  // Cleared (but not emptied) by the system monitor each time it is logged
 protected:
 	INetwork() {}
 